@@ -0,0 +1,66 @@
+#include "plumed/wrapper/Plumed.h"
+#include <mpi.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace PLMD;
+
+// Each replica runs with one process and the two replicas are exchanged.
+// The two atoms are at distance 1+r in replica r and the bias is
+// a restraint with KAPPA=1+r, so the expected differences of the bias are
+// 0.5*1*2^2-0.5*1*1^2=1.5 on replica 0 and 0.5*2*1^2-0.5*2*2^2=-3 on replica 1
+double exchange(const std::string & name,const std::string & label,int rep) {
+  MPI_Comm intracomm=MPI_COMM_SELF;
+  MPI_Comm intercomm=MPI_COMM_WORLD;
+  Plumed p;
+  int natoms=2;
+  p.cmd("setMPIComm",&intracomm);
+  p.cmd("setNatoms",natoms);
+  p.cmd("setTimestep",0.005);
+  p.cmd("setLogFile",(name+"."+std::to_string(rep)).c_str());
+  p.cmd("init");
+  p.cmd("GREX setMPIIntracomm",&intracomm);
+  p.cmd("GREX setMPIIntercomm",&intercomm);
+  p.cmd("GREX init");
+  p.cmd("readInputLine","d1: DISTANCE ATOMS=1,2");
+  p.cmd("readInputLine",(label+": RESTRAINT ARG=d1 AT=0 KAPPA="+std::to_string(1+rep)).c_str());
+
+  std::vector<double> positions(3*natoms,0.0), forces(3*natoms,0.0), masses(natoms,1.0);
+  positions[3]=1.0+rep;
+  double cell[3][3]= {{10,0,0},{0,10,0},{0,0,10}};
+  double virial[3][3]= {{0,0,0},{0,0,0},{0,0,0}};
+  int step=0;
+  p.cmd("setStep",step);
+  p.cmd("setBox",cell);
+  p.cmd("setVirial",virial);
+  p.cmd("setMasses",masses.data());
+  p.cmd("setPositions",positions.data());
+  p.cmd("setForces",forces.data());
+  p.cmd("calc");
+
+  int partner=1-rep;
+  double delta=0.0;
+  p.cmd("GREX savePositions");
+  p.cmd("GREX setPartner",partner);
+  p.cmd("GREX calculate");
+  p.cmd("GREX getLocalDeltaBias",&delta);
+  return delta;
+}
+
+int main(int argc,char**argv) {
+  MPI_Init(&argc,&argv);
+  int rep;
+  MPI_Comm_rank(MPI_COMM_WORLD,&rep);
+  setenv("PLUMED_GREX_CV_EXCHANGE","1",1);
+  // same labels and arguments on both replicas: only the arguments are exchanged
+  double same=exchange("log_same","r",rep);
+  // different labels: the whole configuration is exchanged and the biases are recalculated
+  double different=exchange("log_different",rep==0 ? "r" : "rr",rep);
+  FILE* fp=std::fopen(("deltabias."+std::to_string(rep)).c_str(),"w");
+  std::fprintf(fp,"%d %12.8f %12.8f\n",rep,same,different);
+  std::fclose(fp);
+  MPI_Finalize();
+  return 0;
+}
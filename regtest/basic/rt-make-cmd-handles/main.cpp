@@ -0,0 +1,90 @@
+#include "plumed/wrapper/Plumed.h"
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace PLMD;
+
+// The same short trajectory is computed by passing the commands as strings,
+// as single handles, as a batch of handles from C++ and as a batch from C.
+// The bias and the forces should be identical in all cases.
+void run(const std::string & mode,FILE* out) {
+  Plumed p;
+  int natoms=4;
+  p.cmd("setNatoms",natoms);
+  p.cmd("setTimestep",0.005);
+  p.cmd("setLogFile",("log_"+mode).c_str());
+  p.cmd("init");
+  p.cmd("readInputLine","d: DISTANCE ATOMS=1,3");
+  p.cmd("readInputLine","t: TORSION ATOMS=1,2,3,4");
+  p.cmd("readInputLine","RESTRAINT ARG=d,t AT=1.0,0.5 KAPPA=10.0,2.0");
+
+  const char* names[]= {"setStep","setBox","setMasses","setPositions","setForces","setVirial"};
+  std::vector<Plumed::CommandHandle> handles;
+  for(unsigned i=0; i<6; i++) {
+    int id=-1;
+    p.cmd(std::string("getCommandHandle ")+names[i],&id);
+    handles.push_back(Plumed::CommandHandle(id));
+  }
+  int id=-1;
+  p.cmd("getCommandHandle calc",&id);
+  Plumed::CommandHandle calc(id);
+
+  std::vector<double> positions(3*natoms), forces(3*natoms), masses(natoms,1.0);
+  double cell[3][3]= {{10,0,0},{0,10,0},{0,0,10}};
+  double virial[3][3];
+  double bias;
+  for(int step=0; step<5; step++) {
+    for(int i=0; i<3*natoms; i++) positions[i]=std::sin(0.7*i+0.3*step)+(i/3);
+    for(int i=0; i<3*natoms; i++) forces[i]=0.0;
+    for(int i=0; i<3; i++) for(int j=0; j<3; j++) virial[i][j]=0.0;
+    const void* vals[]= {&step,cell,masses.data(),positions.data(),forces.data(),virial};
+    if(mode=="string") {
+      p.cmd("setStep",step);
+      p.cmd("setBox",cell);
+      p.cmd("setMasses",masses.data(),{masses.size()});
+      p.cmd("setPositions",positions.data(),{std::size_t(natoms),3});
+      p.cmd("setForces",forces.data(),{std::size_t(natoms),3});
+      p.cmd("setVirial",virial);
+      p.cmd("calc");
+    } else if(mode=="handle") {
+      p.cmd(handles[0],step);
+      p.cmd(handles[1],cell);
+      p.cmd(handles[2],masses.data(),{masses.size()});
+      p.cmd(handles[3],positions.data(),{std::size_t(natoms),3});
+      p.cmd(handles[4],forces.data(),{std::size_t(natoms),3});
+      p.cmd(handles[5],virial);
+      p.cmd(calc);
+    } else if(mode=="batch") {
+      p.cmd_handles(6,handles.data(),vals);
+      p.cmd(calc);
+    } else if(mode=="c") {
+      int ids[6];
+      for(unsigned i=0; i<6; i++) ids[i]=handles[i].id;
+      plumed c=p;
+      plumed_cmd_handles(c,6,ids,vals);
+      plumed_cmd_handle(c,calc.id,NULL);
+    }
+    p.cmd("getBias",&bias);
+    std::fprintf(out,"%s %d %12.8f",mode.c_str(),step,bias);
+    for(int i=0; i<3*natoms; i++) std::fprintf(out," %12.8f",forces[i]);
+    std::fprintf(out,"\n");
+  }
+
+  try {
+    p.cmd(Plumed::CommandHandle(100),nullptr);
+  } catch(Plumed::Exception & e) {
+    std::fprintf(out,"%s invalid handle rejected\n",mode.c_str());
+  }
+}
+
+int main() {
+  FILE* out=std::fopen("output","w");
+  run("string",out);
+  run("handle",out);
+  run("batch",out);
+  run("c",out);
+  std::fclose(out);
+  return 0;
+}
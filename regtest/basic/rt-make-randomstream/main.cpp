@@ -0,0 +1,60 @@
+#include "plumed/tools/RandomStream.h"
+#include "plumed/tools/OpenMP.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace PLMD;
+
+// The bulk fills should not depend on the number of threads
+bool sameFills(unsigned nt) {
+  std::vector<double> u1(10001), g1(10001), u2(10001), g2(10001);
+  RandomStream r1(1234,7), r2(1234,7);
+  OpenMP::setNumThreads(1);
+  r1.fillU01(u1); r1.fillGaussian(g1);
+  OpenMP::setNumThreads(nt);
+  r2.fillU01(u2); r2.fillGaussian(g2);
+  OpenMP::setNumThreads(1);
+  return u1==u2 && g1==g2 && r1.getCounter()==r2.getCounter();
+}
+
+int main() {
+  std::FILE* fp=std::fopen("output","w");
+  std::fprintf(fp,"fills with 1 and 2 threads are identical: %d\n",sameFills(2));
+  std::fprintf(fp,"fills with 1 and 4 threads are identical: %d\n",sameFills(4));
+
+  // Uniform and gaussian draws keep separate leftovers: mixing them gives the same
+  // numbers as drawing them from streams that only produce uniform or gaussian numbers
+  // from the same blocks
+  RandomStream mixed(42), blocks(42);
+  std::vector<double> u, g;
+  for(unsigned i=0; i<5; ++i) { u.push_back(mixed.U01()); g.push_back(mixed.Gaussian()); g.push_back(mixed.Gaussian()); u.push_back(mixed.U01()); }
+  // blocks were used in the order U,G,U,G,... so uniform numbers come from even counters and gaussian ones from odd counters
+  bool mixok=true;
+  for(unsigned i=0; i<5; ++i) {
+    RandomStream us(42), gs(42);
+    us.setCounter(2*i); gs.setCounter(2*i+1);
+    double u1=us.U01(), u2=us.U01(), g1=gs.Gaussian(), g2=gs.Gaussian();
+    if( u[2*i]!=u1 || u[2*i+1]!=u2 || g[2*i]!=g1 || g[2*i+1]!=g2 ) mixok=false;
+  }
+  std::fprintf(fp,"mixed draws use separate leftovers: %d\n",mixok);
+  std::fprintf(fp,"counter after mixed draws: %llu\n",static_cast<unsigned long long>(mixed.getCounter()));
+
+  // The leftovers are saved with the state
+  mixed.U01(); mixed.Gaussian();
+  std::string state; mixed.toString(state);
+  std::fprintf(fp,"state: %s\n",state.c_str());
+  RandomStream restored; restored.fromString(state);
+  bool restoreok=true;
+  for(unsigned i=0; i<4; ++i) {
+    if( mixed.U01()!=restored.U01() ) restoreok=false;
+    if( mixed.Gaussian()!=restored.Gaussian() ) restoreok=false;
+  }
+  std::fprintf(fp,"restored state gives the same numbers: %d\n",restoreok);
+
+  // Old states without the leftovers can still be read
+  RandomStream old; old.fromString("42|0|3");
+  std::fprintf(fp,"counter read from old state: %llu\n",static_cast<unsigned long long>(old.getCounter()));
+  std::fclose(fp);
+  return 0;
+}
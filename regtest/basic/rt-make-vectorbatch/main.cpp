@@ -0,0 +1,105 @@
+#include "plumed/tools/VectorBatch.h"
+#include "plumed/tools/Vector.h"
+#include "plumed/tools/Tensor.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace PLMD;
+
+// Every operation of VectorBatch is compared with the same loop written with Vector and Tensor
+static const double tol=1e-12;
+
+static bool same(const VectorBatch& b, const std::vector<Vector>& v) {
+  if( b.size()!=v.size() ) return false;
+  for(unsigned i=0; i<v.size(); ++i) if( modulo(b.get(i)-v[i])>tol ) return false;
+  return true;
+}
+
+static bool same(const std::vector<double>& a, const std::vector<double>& b) {
+  if( a.size()!=b.size() ) return false;
+  for(unsigned i=0; i<a.size(); ++i) if( std::fabs(a[i]-b[i])>tol ) return false;
+  return true;
+}
+
+int main() {
+  std::FILE* fp=std::fopen("output","w");
+  // an odd number of vectors so that the remainder of any vectorized loop is also tested
+  const unsigned n=37;
+  std::vector<Vector> a(n), b(n);
+  std::vector<double> s(n);
+  for(unsigned i=0; i<n; ++i) {
+    a[i]=Vector(std::sin(0.3*i),std::cos(0.7*i),0.1*i-1.0);
+    b[i]=Vector(0.5*i,std::sin(1.1*i+0.2),std::cos(0.4*i));
+    s[i]=1.0+0.05*i;
+  }
+  const Vector c(0.3,-1.2,2.5);
+  const Tensor t(1.0,0.5,-0.2,0.3,2.0,0.1,-0.7,0.4,1.5);
+
+  VectorBatch ba(a), bb(b);
+  std::fprintf(fp,"load and get: %d\n",same(ba,a));
+  std::vector<Vector> stored; ba.store(stored);
+  bool storeok=stored.size()==n;
+  for(unsigned i=0; storeok && i<n; ++i) if( modulo(stored[i]-a[i])>tol ) storeok=false;
+  std::fprintf(fp,"store: %d\n",storeok);
+
+  VectorBatch empty(n); bool zerook=true;
+  for(unsigned i=0; i<n; ++i) if( modulo(empty.get(i))>0 ) zerook=false;
+  VectorBatch zeroed(a); zeroed.zero();
+  for(unsigned i=0; i<n; ++i) if( modulo(zeroed.get(i))>0 ) zerook=false;
+  std::fprintf(fp,"null vectors and zero: %d\n",zerook);
+
+  VectorBatch sa(n); std::vector<Vector> va(n);
+  for(unsigned i=0; i<n; ++i) { sa.set(i,a[i]); sa.add(i,b[i]); va[i]=a[i]+b[i]; }
+  std::fprintf(fp,"set and add: %d\n",same(sa,va));
+
+  std::vector<Vector> acc(b); ba.addTo(acc);
+  std::fprintf(fp,"addTo: %d\n",same(sa,acc));
+
+  VectorBatch m(a); m*=2.5; std::vector<Vector> vm(n);
+  for(unsigned i=0; i<n; ++i) vm[i]=2.5*a[i];
+  std::fprintf(fp,"multiply by scalar: %d\n",same(m,vm));
+
+  VectorBatch sc(a); sc.scale(s); std::vector<Vector> vs(n);
+  for(unsigned i=0; i<n; ++i) vs[i]=s[i]*a[i];
+  std::fprintf(fp,"scale: %d\n",same(sc,vs));
+
+  VectorBatch d1; delta(c,bb,d1); std::vector<Vector> vd1(n);
+  for(unsigned i=0; i<n; ++i) vd1[i]=delta(c,b[i]);
+  std::fprintf(fp,"delta from a vector: %d\n",same(d1,vd1));
+
+  VectorBatch d2; delta(ba,bb,d2); std::vector<Vector> vd2(n);
+  for(unsigned i=0; i<n; ++i) vd2[i]=delta(a[i],b[i]);
+  std::fprintf(fp,"delta between batches: %d\n",same(d2,vd2));
+
+  std::vector<double> m2, vm2(n);
+  modulo2(ba,m2);
+  for(unsigned i=0; i<n; ++i) vm2[i]=a[i].modulo2();
+  std::fprintf(fp,"modulo2: %d\n",same(m2,vm2));
+
+  VectorBatch cr; crossProduct(ba,bb,cr); std::vector<Vector> vcr(n);
+  for(unsigned i=0; i<n; ++i) vcr[i]=crossProduct(a[i],b[i]);
+  std::fprintf(fp,"crossProduct: %d\n",same(cr,vcr));
+
+  std::vector<double> dp, vdp(n);
+  dotProduct(ba,bb,dp);
+  for(unsigned i=0; i<n; ++i) vdp[i]=dotProduct(a[i],b[i]);
+  std::fprintf(fp,"dotProduct: %d\n",same(dp,vdp));
+
+  VectorBatch mm; matmul(t,ba,mm); std::vector<Vector> vmm(n);
+  for(unsigned i=0; i<n; ++i) vmm[i]=matmul(t,a[i]);
+  std::fprintf(fp,"matmul: %d\n",same(mm,vmm));
+
+  Tensor so=sumOuterProduct(ba,bb), vso;
+  for(unsigned i=0; i<n; ++i) vso+=Tensor(a[i],b[i]);
+  bool sook=true;
+  for(unsigned i=0; i<3; ++i) for(unsigned j=0; j<3; ++j) if( std::fabs(so(i,j)-vso(i,j))>tol ) sook=false;
+  std::fprintf(fp,"sumOuterProduct: %d\n",sook);
+
+  VectorBatch none;
+  std::vector<double> nm2; modulo2(none,nm2);
+  Tensor nso=sumOuterProduct(none,none);
+  std::fprintf(fp,"empty batch: %d\n",none.size()==0 && nm2.size()==0 && determinant(nso)==0.0 && nso(0,0)==0.0);
+  std::fclose(fp);
+  return 0;
+}
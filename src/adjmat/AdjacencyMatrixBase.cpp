@@ -21,6 +21,7 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "AdjacencyMatrixBase.h"
 #include "core/PlumedMain.h"
+#include "core/ActionSet.h"
 #include "tools/Communicator.h"
 #include "tools/OpenMP.h"
 
@@ -38,6 +39,8 @@ void AdjacencyMatrixBase::registerKeywords( Keywords& keys ) {
   keys.addFlag("NOPBC",false,"don't use pbc");
   keys.add("compulsory","NL_CUTOFF","0.0","The cutoff for the neighbor list.  A value of 0 means we are not using a neighbor list");
   keys.add("compulsory","NL_STRIDE","1","The frequency with which we are updating the atoms in the neighbor list");
+  keys.addFlag("NL_SORT",false,"store the atoms in the link cells along a Morton curve so that atoms that are close in space are also close in memory when the neighbor list is built");
+  keys.add("compulsory","NL_SKIN","0.0","If this is greater than zero the neighbor list is only updated when an atom has moved by more than half this distance and NL_STRIDE is ignored");
   keys.addOutputComponent("w","COMPONENTS","matrix","a matrix containing the weights for the bonds between each pair of atoms");
   keys.addOutputComponent("x","COMPONENTS","matrix","the projection of the bond on the x axis");
   keys.addOutputComponent("y","COMPONENTS","matrix","the projection of the bond on the y axis");
@@ -49,11 +52,15 @@ AdjacencyMatrixBase::AdjacencyMatrixBase(const ActionOptions& ao):
   Action(ao),
   ActionWithMatrix(ao),
   read_one_group(false),
+  nl_sort(false),
   neighbour_list_updated(false),
   linkcells(comm),
   threecells(comm),
   maxcol(0),
-  natoms_per_list(0)
+  natoms_per_list(0),
+  nl_owner(this),
+  nl_shared(false),
+  nl_step(-1)
 {
   std::vector<unsigned> shape(2); std::vector<AtomNumber> t; parseAtomList("GROUP", t );
   if( t.size()==0 ) {
@@ -107,9 +114,13 @@ AdjacencyMatrixBase::AdjacencyMatrixBase(const ActionOptions& ao):
   else { addComponent( "w", shape ); componentIsNotPeriodic("w"); }
   getPntrToComponent(0)->setDerivativeIsZeroWhenValueIsZero();
   // Stuff for neighbor list
-  parse("NL_CUTOFF",nl_cut); nl_cut2=nl_cut*nl_cut; parse("NL_STRIDE",nl_stride);
+  parse("NL_CUTOFF",nl_cut); nl_cut2=nl_cut*nl_cut; parse("NL_STRIDE",nl_stride); parse("NL_SKIN",nl_skin);
   if( nl_cut==0 && nl_stride>1 ) error("NL_CUTOFF must be set if NL_STRIDE is set greater than 1");
-  if( nl_cut>0 ) log.printf("  using neighbor list with cutoff %f.  List is updated every %u steps.\n",nl_cut,nl_stride);
+  if( nl_skin>0 && nl_skin>=nl_cut ) error("NL_CUTOFF must be set and larger than NL_SKIN");
+  if( nl_skin>0 ) log.printf("  using neighbor list with cutoff %f.  List is updated when an atom has moved by more than half the skin %f.\n",nl_cut,nl_skin);
+  else if( nl_cut>0 ) log.printf("  using neighbor list with cutoff %f.  List is updated every %u steps.\n",nl_cut,nl_stride);
+  parseFlag("NL_SORT",nl_sort); linkcells.setMortonOrdering( nl_sort );
+  if( nl_sort ) log.printf("  atoms in link cells are stored along a Morton curve\n");
 
   if( components ) {
     addComponent( "x", shape ); componentIsNotPeriodic("x");
@@ -137,16 +148,64 @@ void AdjacencyMatrixBase::setLinkCellCutoff( const bool& symmetric, const double
   if( nl_cut>0 ) linkcells.setCutoff( nl_cut ); else linkcells.setCutoff( lcut );
   if( linkcells.getCutoff()<std::numeric_limits<double>::max() ) log.printf("  set link cell cutoff to %f \n", linkcells.getCutoff() );
   threecells.setCutoff( tcut );
+  findNeighbourListOwner();
+}
+
+void AdjacencyMatrixBase::findNeighbourListOwner() {
+  std::vector<AdjacencyMatrixBase*> all( plumed.getActionSet().select<AdjacencyMatrixBase*>() );
+  for(const auto & aa : all ) {
+    if( aa==this || aa->nl_owner!=aa ) continue;
+    if( aa->nopbc!=nopbc || aa->read_one_group!=read_one_group || aa->nl_sort!=nl_sort ) continue;
+    if( aa->nl_cut!=nl_cut || aa->nl_skin!=nl_skin || aa->nl_stride!=nl_stride ) continue;
+    if( aa->linkcells.getCutoff()!=linkcells.getCutoff() ) continue;
+    if( aa->ablocks!=ablocks || aa->getAbsoluteIndexes()!=getAbsoluteIndexes() ) continue;
+    nl_owner=aa; aa->nl_shared=true;
+    log.printf("  using the same neighbor list as action with label %s\n", aa->getLabel().c_str() );
+    return;
+  }
+}
+
+bool AdjacencyMatrixBase::sharedNeighbourListIsCurrent() const {
+  if( !nl_owner->nl_shared || nl_owner->nl_step!=getStep() ) return false;
+  const Tensor& box( getPbc().getBox() );
+  for(unsigned i=0; i<3; ++i) for(unsigned j=0; j<3; ++j) if( nl_owner->nl_box(i,j)!=box(i,j) ) return false;
+  const std::vector<Vector>& pos( getPositions() ); if( nl_owner->nl_positions.size()!=pos.size() ) return false;
+  for(unsigned i=0; i<pos.size(); ++i) {
+    if( nl_owner->nl_positions[i][0]!=pos[i][0] || nl_owner->nl_positions[i][1]!=pos[i][1] || nl_owner->nl_positions[i][2]!=pos[i][2] ) return false;
+  }
+  return true;
+}
+
+bool AdjacencyMatrixBase::canCalculateConcurrently() const {
+  // Actions that share a neighbor list read and write the owner's list, step and box so they must run in order
+  if( nl_shared || nl_owner!=this ) return false;
+  return ActionWithVector::canCalculateConcurrently();
 }
 
 void AdjacencyMatrixBase::prepare() {
   ActionWithVector::prepare(); neighbour_list_updated=false;
 }
 
+bool AdjacencyMatrixBase::neighbourListNeedsRebuild() {
+  if( nl_skin==0 ) return getStep()%nl_stride==0;
+  const std::vector<Vector>& pos( getPositions() ); std::vector<Vector>& nl_reference( nl_owner->nl_reference );
+  bool rebuild=(nl_reference.size()!=pos.size()) || getExchangeStep();
+  const double d2=0.25*nl_skin*nl_skin;
+  for(unsigned i=0; i<pos.size() && !rebuild; ++i) {
+    Vector disp; if( nopbc ) disp=delta( nl_reference[i], pos[i] ); else disp=pbcDistance( nl_reference[i], pos[i] );
+    if( modulo2(disp)>d2 ) rebuild=true;
+  }
+  if( rebuild ) nl_reference=pos;
+  return rebuild;
+}
+
 void AdjacencyMatrixBase::updateNeighbourList() {
   neighbour_list_updated=true;
+  // The list is stored in the action that owns it so it is only built once per step by the actions that share it
+  std::vector<unsigned>& nlist( nl_owner->nlist ); unsigned& natoms_per_list( nl_owner->natoms_per_list );
+  bool current = sharedNeighbourListIsCurrent();
   // Build link cells here so that this is done in stream if it needed in stream
-  if( getStep()%nl_stride==0 ) {
+  if( !current && neighbourListNeedsRebuild() ) {
     // Build the link cells
     std::vector<Vector> ltmp_pos( ablocks.size() );
     for(unsigned i=0; i<ablocks.size(); ++i) ltmp_pos[i]=ActionAtomistic::getPosition( ablocks[i] );
@@ -163,14 +222,16 @@ void AdjacencyMatrixBase::updateNeighbourList() {
     unsigned nt=OpenMP::getNumThreads();
     if( nt*stride*10>getConstPntrToComponent(0)->getShape()[0] ) nt=getConstPntrToComponent(0)->getShape()[0]/stride/10;
     if( nt==0 ) nt=1;
-    // Create a vector from the input set of tasks
-    std::vector<unsigned> & pTaskList( getListOfActiveTasks(this) );
+    // Create a vector from the input set of tasks.  A shared list is built for all the atoms as the actions that use it may need different tasks
+    std::vector<unsigned> alltasks;
+    if( nl_owner->nl_shared ) { alltasks.resize( getConstPntrToComponent(0)->getShape()[0] ); for(unsigned i=0; i<alltasks.size(); ++i) alltasks[i]=i; }
+    std::vector<unsigned> & pTaskList( nl_owner->nl_shared ? alltasks : getListOfActiveTasks(this) );
 
     #pragma omp parallel num_threads(nt)
     {
       // Get the number of tasks we have to deal with
       unsigned ntasks=getConstPntrToComponent(0)->getShape()[0];
-      if( nl_stride==1 ) ntasks=pTaskList.size();
+      if( nl_stride==1 && nl_skin==0 ) ntasks=pTaskList.size();
       // Build a tempory nlist so we can do omp parallelism
       std::vector<unsigned> omp_nlist;
       if( nt>1 ) omp_nlist.resize( nlist.size(), 0 );
@@ -184,8 +245,13 @@ void AdjacencyMatrixBase::updateNeighbourList() {
         linkcells.addRequiredCells( linkcells.findMyCell( ActionAtomistic::getPosition(pTaskList[i]) ), ncells_required, cells_required );
         // Now get the indices of the atoms in the link cells positions
         unsigned natoms=1; indices[0]=pTaskList[i];
-        linkcells.retrieveAtomsInCells( ncells_required, cells_required, natoms, indices );
-        if( nl_stride==1 ) {
+        if( nl_stride==1 && nl_skin==0 ) linkcells.retrieveAtomsInCells( ncells_required, cells_required, natoms, indices );
+        else {
+          // The positions are read from the copy stored in the link cells so memory is accessed cell by cell
+          t_atoms[0]=ActionAtomistic::getPosition(indices[0]);
+          linkcells.retrieveAtomsInCells( ncells_required, cells_required, natoms, indices, t_atoms );
+        }
+        if( nl_stride==1 && nl_skin==0 ) {
           if( nt>1 ) omp_nlist[indices[0]]=0; else nlist[indices[0]] = 0;
           unsigned lstart = getConstPntrToComponent(0)->getShape()[0] + indices[0]*(1+natoms_per_list);
           for(unsigned j=0; j<natoms; ++j) {
@@ -194,7 +260,8 @@ void AdjacencyMatrixBase::updateNeighbourList() {
           }
         } else {
           // Get the positions of all the atoms in the link cells relative to the central atom
-          for(unsigned j=0; j<natoms; ++j) t_atoms[j] = ActionAtomistic::getPosition(indices[j]) - ActionAtomistic::getPosition(indices[0]);
+          for(unsigned j=1; j<natoms; ++j) t_atoms[j] = t_atoms[j] - t_atoms[0];
+          t_atoms[0].zero();
           if( !nopbc ) pbcApply( t_atoms, natoms );
           // Now construct the neighbor list
           if( nt>1 ) omp_nlist[indices[0]] = 0; else nlist[indices[0]] = 0;
@@ -224,6 +291,7 @@ void AdjacencyMatrixBase::updateNeighbourList() {
     // MPI gather
     if( !runInSerial() ) comm.Sum( nlist );
   }
+  if( nl_owner->nl_shared && !current ) { nl_owner->nl_step=getStep(); nl_owner->nl_box=getPbc().getBox(); nl_owner->nl_positions=getPositions(); }
   if( threeblocks.size()>0 ) {
     std::vector<Vector> ltmp_pos2( threeblocks.size() );
     for(unsigned i=0; i<threeblocks.size(); ++i) {
@@ -258,6 +326,7 @@ void AdjacencyMatrixBase::getAdditionalTasksRequired( ActionWithVector* action,
 }
 
 unsigned AdjacencyMatrixBase::retrieveNeighbours( const unsigned& current, std::vector<unsigned> & indices ) const {
+  const std::vector<unsigned>& nlist( nl_owner->nlist ); const unsigned& natoms_per_list( nl_owner->natoms_per_list );
   unsigned natoms=nlist[current]; indices[0]=current;
   unsigned lstart = getConstPntrToComponent(0)->getShape()[0] + current*(1+natoms_per_list); plumed_dbg_assert( nlist[lstart]==current );
   for(unsigned i=1; i<nlist[current]; ++i) { indices[i] = nlist[ lstart + i ]; }
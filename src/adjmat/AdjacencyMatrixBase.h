@@ -31,15 +31,32 @@ namespace adjmat {
 
 class AdjacencyMatrixBase : public ActionWithMatrix {
 private:
-  bool nopbc, components, read_one_group;
+  bool nopbc, components, read_one_group, nl_sort;
   bool neighbour_list_updated;
   LinkCells linkcells, threecells;
   std::vector<unsigned> ablocks, threeblocks;
-  double nl_cut, nl_cut2;
+  double nl_cut, nl_cut2, nl_skin;
   unsigned maxcol;
   unsigned nl_stride;
+/// The positions of the atoms when the neighbor list was last built (only stored if NL_SKIN is set)
+  std::vector<Vector> nl_reference;
+/// Check if the neighbor list needs to be rebuilt on this step
+  bool neighbourListNeedsRebuild();
   unsigned natoms_per_list;
   std::vector<unsigned> nlist;
+/// The action whose neighbor list is used by this action.  This is a pointer to this action unless an earlier
+/// adjacency matrix was constructed from the same atoms with the same cutoffs and periodic boundary conditions
+  AdjacencyMatrixBase* nl_owner;
+/// Is the neighbor list of this action used by other actions
+  bool nl_shared;
+/// The step, box and positions when the shared neighbor list was last updated
+  long long int nl_step;
+  Tensor nl_box;
+  std::vector<Vector> nl_positions;
+/// Find an earlier adjacency matrix whose neighbor list can be used by this action
+  void findNeighbourListOwner();
+/// Check if the shared neighbor list has already been updated for the current positions
+  bool sharedNeighbourListIsCurrent() const ;
   void setupThirdAtomBlock( const std::vector<AtomNumber>& tc, std::vector<AtomNumber>& t );
 protected:
   Vector getPosition( const unsigned& indno, MultiValue& myvals ) const ;
@@ -54,6 +71,7 @@ public:
   unsigned getNumberOfDerivatives() override ;
   unsigned getNumberOfColumns() const override;
   void prepare() override;
+  bool canCalculateConcurrently() const override ;
   void getAdditionalTasksRequired( ActionWithVector* action, std::vector<unsigned>& atasks ) override ;
   void setupForTask( const unsigned& current, std::vector<unsigned> & indices, MultiValue& myvals ) const override;
   // void setupCurrentTaskList() override;
@@ -61,6 +61,8 @@ private:
   Vector dij, dik;
   SwitchingFunction sf1;
   SwitchingFunction sf2;
+/// The square of the cutoff on the distance between the bridging atom and the first atom
+  double sf1_dmax2;
 public:
   static void registerKeywords( Keywords& keys );
   explicit BridgeMatrix(const ActionOptions&);
@@ -107,8 +109,9 @@ BridgeMatrix::BridgeMatrix(const ActionOptions&ao):
   log.printf("  distance between bridging atoms and atoms in GROUPA must be less than %s\n",sf1.description().c_str());
   log.printf("  distance between bridging atoms and atoms in GROUPB must be less than %s\n",sf2.description().c_str());
 
-  // Setup link cells
-  setLinkCellCutoff( oneswitch, sf1.get_dmax() + sf2.get_dmax() );
+  // Setup link cells.  Bridging atoms must be within the cutoff of the first atom so the link cells for them are only as large as this cutoff
+  sf1_dmax2 = sf1.get_dmax()*sf1.get_dmax();
+  setLinkCellCutoff( oneswitch, sf1.get_dmax() + sf2.get_dmax(), sf1.get_dmax() );
 
   // And check everything has been read in correctly
   checkRead();
@@ -118,6 +121,8 @@ double BridgeMatrix::calculateWeight( const Vector& pos1, const Vector& pos2, co
   double tot=0; if( pos2.modulo2()<epsilon ) return 0.0;
   for(unsigned i=0; i<natoms; ++i) {
     Vector dij= getPosition(i,myvals); double dijm = dij.modulo2();
+    // w1 and its derivative are zero beyond the cutoff so this atom does not contribute
+    if( dijm>sf1_dmax2 ) continue;
     double dw1, w1=sf1.calculateSqr( dijm, dw1 ); if( dijm<epsilon ) { w1=0.0; dw1=0.0; }
     Vector dik=pbcDistance( getPosition(i,myvals), pos2 ); double dikm=dik.modulo2();
     double dw2, w2=sf2.calculateSqr( dikm, dw2 ); if( dikm<epsilon ) { w2=0.0; dw2=0.0; }
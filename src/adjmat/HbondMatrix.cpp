@@ -85,6 +85,8 @@ private:
   SwitchingFunction distanceOOSwitch;
   SwitchingFunction distanceOHSwitch;
   SwitchingFunction angleSwitch;
+/// The squares of the cutoffs on the donor-acceptor and donor-hydrogen distances
+  double oo_dmax2, oh_dmax2;
 public:
   static void registerKeywords( Keywords& keys );
   explicit HbondMatrix(const ActionOptions&);
@@ -126,8 +128,9 @@ HbondMatrix::HbondMatrix(const ActionOptions&ao):
   angleSwitch.set(asfinput,errors);
   if( errors.length()!=0 ) error("problem reading SWITCH keyword : " + errors );
 
-  // Setup link cells
-  setLinkCellCutoff( false, distanceOOSwitch.get_dmax() );
+  // Setup link cells.  Hydrogens must be within the cutoff of the donor so the link cells for them are only as large as this cutoff
+  oo_dmax2 = distanceOOSwitch.get_dmax()*distanceOOSwitch.get_dmax(); oh_dmax2 = distanceOHSwitch.get_dmax()*distanceOHSwitch.get_dmax();
+  setLinkCellCutoff( false, distanceOOSwitch.get_dmax(), distanceOHSwitch.get_dmax() );
 
   // And check everything has been read in correctly
   checkRead();
@@ -135,12 +138,14 @@ HbondMatrix::HbondMatrix(const ActionOptions&ao):
 
 double HbondMatrix::calculateWeight( const Vector& pos1, const Vector& pos2, const unsigned& natoms, MultiValue& myvals ) const {
   Vector ood = pos2; double ood_l = ood.modulo2(); // acceptor - donor
-  if( ood_l<epsilon) return 0;
+  if( ood_l<epsilon || ood_l>oo_dmax2 ) return 0;
   double ood_df, ood_sw=distanceOOSwitch.calculateSqr( ood_l, ood_df );
 
   double value=0;
   for(unsigned i=0; i<natoms; ++i) {
     Vector ohd=getPosition(i,myvals); double ohd_l=ohd.modulo2();
+    // The switching function and its derivative are both zero beyond the cutoff so the angle is not needed
+    if( ohd_l>oh_dmax2 ) continue;
     double ohd_df, ohd_sw=distanceOHSwitch.calculateSqr( ohd_l, ohd_df );
 
     Angle a; Vector ood_adf, ohd_adf; double angle=a.compute( ood, ohd, ood_adf, ohd_adf );
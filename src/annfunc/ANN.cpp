@@ -23,6 +23,7 @@ SOFTWARE.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "function/Function.h"
 #include "core/ActionRegister.h"
+#include "blas/blas.h"
 #include "cassert"
 
 #include <string>
@@ -83,28 +84,75 @@ BIASES1=13
 
 To access its components, we use "ann.node-0", "ann.node-1", ..., which represents the components of neural network outputs.
 
+The weights of each layer are stored as contiguous matrices, and the network and its derivatives are evaluated with
+BLAS matrix-vector and matrix-matrix products. The derivatives of all the outputs are back-propagated together, so each
+weight matrix is read once per step in the backward pass whatever the number of outputs. By using the FLOAT flag
+the weights are stored and the network is evaluated in single precision, which is faster for large networks but less accurate.
+
 
 */
 //+ENDPLUMEDOC
 
+namespace {
+/// y = W x, for a row-major matrix W with m rows and n columns
+inline void matVec(int m, int n, const double* w, const double* x, double* y) {
+  double one=1.0, zero=0.0; int inc=1;
+  // the row-major matrix is the transpose of a column-major one
+  plumed_blas_dgemv( "T", &n, &m, &one, const_cast<double*>(w), &n, const_cast<double*>(x), &inc, &zero, y, &inc );
+}
+inline void matVec(int m, int n, const float* w, const float* x, float* y) {
+  float one=1.0, zero=0.0; int inc=1;
+  plumed_blas_sgemv( "T", &n, &m, &one, const_cast<float*>(w), &n, const_cast<float*>(x), &inc, &zero, y, &inc );
+}
+/// C = A W, for a row-major matrix A with p rows and m columns and a row-major matrix W with m rows and n columns
+inline void matMat(int p, int m, int n, const double* a, const double* w, double* c) {
+  double one=1.0, zero=0.0;
+  // in column-major order this is C^T = W^T A^T
+  plumed_blas_dgemm( "N", "N", &n, &p, &m, &one, const_cast<double*>(w), &n, const_cast<double*>(a), &m, &zero, c, &n );
+}
+inline void matMat(int p, int m, int n, const float* a, const float* w, float* c) {
+  float one=1.0, zero=0.0;
+  plumed_blas_sgemm( "N", "N", &n, &p, &m, &one, const_cast<float*>(w), &n, const_cast<float*>(a), &m, &zero, c, &n );
+}
+}
+
 class ANN : public Function
 {
 private:
+  enum Activation {linear, hyperbolic_tangent, circular};
   int num_layers;
   vector<int> num_nodes;
   vector<string> activations;   // activation functions
+  vector<Activation> activation_types;  // activation functions, decoded once
   vector<vector<double> > weights;  // flattened weight arrays
   vector<vector<double> > biases;
-  vector<vector<double> > output_of_each_layer;
-  vector<vector<double> > input_of_each_layer;
-  vector<double** > coeff;  // weight matrix arrays, reshaped from "weights"
+  // weights, biases and work space of the network in the precision used for the calculation
+  template<typename T>
+  struct Network {
+    vector<vector<T> > coeff;  // row-major weight matrices, coeff[ii] has num_nodes[ii + 1] rows and num_nodes[ii] columns
+    vector<vector<T> > bias;
+    vector<vector<T> > input_of_each_layer;
+    vector<vector<T> > output_of_each_layer;
+    // derivatives of all the outputs with respect to the outputs of each layer, with a row for each output
+    vector<vector<T> > derivatives_of_each_layer;
+    vector<T> derivatives_of_input;
+  };
+  bool single_precision;
+  Network<double> network;
+  Network<float> network_float;
+  template<typename T>
+  void setup_network(Network<T>& net);
+  template<typename T>
+  void evaluate(Network<T>& net);
 
 public:
   static void registerKeywords( Keywords& keys );
   explicit ANN(const ActionOptions&);
   virtual void calculate();
-  void calculate_output_of_each_layer(const vector<double>& input);
-  void back_prop(vector<vector<double> >& derivatives_of_each_layer, int index_of_output_component);
+  template<typename T>
+  void calculate_output_of_each_layer(Network<T>& net);
+  template<typename T>
+  void back_prop(Network<T>& net);
 };
 
 PLUMED_REGISTER_ACTION(ANN,"ANN")
@@ -120,6 +168,7 @@ void ANN::registerKeywords( Keywords& keys ) {
            "WEIGHTS1 represents flattened weight array connecting layer 1 and layer 2, ...");
   keys.add("numbered", "BIASES", "bias array for each layer of the neural network, "
            "BIASES0 represents bias array for layer 1, BIASES1 represents bias array for layer 2, ...");
+  keys.addFlag("FLOAT", false, "store the weights and evaluate the neural network in single precision");
   // since v2.2 plumed requires all components be registered
   keys.addOutputComponent("node", "default", "scalar", "components of ANN outputs");
 }
@@ -131,11 +180,9 @@ ANN::ANN(const ActionOptions&ao):
   parse("NUM_LAYERS", num_layers);
   num_nodes = vector<int>(num_layers);
   activations = vector<string>(num_layers - 1);
-  output_of_each_layer = vector<vector<double> >(num_layers);
-  input_of_each_layer = vector<vector<double> >(num_layers);
-  coeff = vector<double** >(num_layers - 1);
   parseVector("NUM_NODES", num_nodes);
   parseVector("ACTIVATIONS", activations);
+  parseFlag("FLOAT", single_precision);
   log.printf("\nactivations = ");
   for (const auto & ss: activations) {
     log.printf("%s, ", ss.c_str());
@@ -144,6 +191,22 @@ ANN::ANN(const ActionOptions&ao):
   for (auto ss: num_nodes) {
     log.printf("%d, ", ss);
   }
+  activation_types.resize(num_layers - 1);
+  for (int ii = 0; ii < num_layers - 1; ii ++) {
+    if (activations[ii] == string("Linear")) {
+      activation_types[ii] = linear;
+    }
+    else if (activations[ii] == string("Tanh")) {
+      activation_types[ii] = hyperbolic_tangent;
+    }
+    else if (activations[ii] == string("Circular")) {
+      if (num_nodes[ii + 1] % 2 != 0) error("Circular layers must have an even number of nodes");
+      activation_types[ii] = circular;
+    }
+    else {
+      error("layer type " + activations[ii] + " not found");
+    }
+  }
   vector<double> temp_single_coeff, temp_single_bias;
   for (int ii = 0; ; ii ++) {
     // parse coeff
@@ -167,27 +230,19 @@ ANN::ANN(const ActionOptions&ao):
     error("Number of arguments is wrong");
   }
 
-  auto temp_coeff = weights;
   for (int ii = 0; ii < num_layers - 1; ii ++) {
     int num_of_rows, num_of_cols; // num of rows/cols for the coeff matrix of this connection
     num_of_rows = num_nodes[ii + 1];
     num_of_cols = num_nodes[ii];
-    assert (num_of_rows * num_of_cols == temp_coeff[ii].size()); // check whether the size matches
-    // create a 2d array to hold coefficients
-    coeff[ii] = new double*[num_of_rows];
-    for (int kk = 0; kk < num_of_rows; kk ++) {
-      coeff[ii][kk] = new double[num_of_cols];
-    }
-    for (int jj = 0; jj < temp_coeff[ii].size(); jj ++) {
-      coeff[ii][jj / num_of_cols][jj % num_of_cols] = temp_coeff[ii][jj];
-    }
+    if (num_of_rows * num_of_cols != int(weights[ii].size())) error("size of WEIGHTS" + to_string(ii) + " does not match the number of nodes");
+    if (num_of_rows != int(biases[ii].size())) error("size of BIASES" + to_string(ii) + " does not match the number of nodes");
   }
   // check coeff
   for (int ii = 0; ii < num_layers - 1; ii ++) {
     log.printf("coeff %d = \n", ii);
     for (int jj = 0; jj < num_nodes[ii + 1]; jj ++) {
       for (int kk = 0; kk < num_nodes[ii]; kk ++) {
-        log.printf("%f ", coeff[ii][jj][kk]);
+        log.printf("%f ", weights[ii][jj * num_nodes[ii] + kk]);
       }
       log.printf("\n");
     }
@@ -200,6 +255,13 @@ ANN::ANN(const ActionOptions&ao):
     }
     log.printf("\n");
   }
+  if (single_precision) {
+    log.printf("the network is evaluated in single precision\n");
+    setup_network(network_float);
+  }
+  else {
+    setup_network(network);
+  }
   log.printf("initialization ended\n");
   // create components
   for (int ii = 0; ii < num_nodes[num_layers - 1]; ii ++) {
@@ -210,50 +272,63 @@ ANN::ANN(const ActionOptions&ao):
   checkRead();
 }
 
-void ANN::calculate_output_of_each_layer(const vector<double>& input) {
-  // first layer
-  output_of_each_layer[0] = input;
+template<typename T>
+void ANN::setup_network(Network<T>& net) {
+  int num_outputs = num_nodes[num_layers - 1];
+  net.coeff.resize(num_layers - 1);
+  net.bias.resize(num_layers - 1);
+  for (int ii = 0; ii < num_layers - 1; ii ++) {
+    net.coeff[ii].assign(weights[ii].begin(), weights[ii].end());
+    net.bias[ii].assign(biases[ii].begin(), biases[ii].end());
+  }
+  net.input_of_each_layer.resize(num_layers);
+  net.output_of_each_layer.resize(num_layers);
+  net.derivatives_of_each_layer.resize(num_layers);
+  int max_nodes = 0;
+  for (int ii = 0; ii < num_layers; ii ++) {
+    net.input_of_each_layer[ii].resize(num_nodes[ii]);
+    net.output_of_each_layer[ii].resize(num_nodes[ii]);
+    net.derivatives_of_each_layer[ii].resize(num_outputs * num_nodes[ii]);
+    max_nodes = std::max(max_nodes, num_nodes[ii]);
+  }
+  net.derivatives_of_input.resize(num_outputs * max_nodes);
+}
+
+template<typename T>
+void ANN::calculate_output_of_each_layer(Network<T>& net) {
   // following layers
-  for(int ii = 1; ii < num_nodes.size(); ii ++) {
-    output_of_each_layer[ii].resize(num_nodes[ii]);
-    input_of_each_layer[ii].resize(num_nodes[ii]);
+  for(int ii = 1; ii < num_layers; ii ++) {
+    vector<T>& input = net.input_of_each_layer[ii];
+    vector<T>& output = net.output_of_each_layer[ii];
     // first calculate input
+    matVec(num_nodes[ii], num_nodes[ii - 1], net.coeff[ii - 1].data(), net.output_of_each_layer[ii - 1].data(), input.data());
     for (int jj = 0; jj < num_nodes[ii]; jj ++) {
-      input_of_each_layer[ii][jj] = biases[ii - 1][jj];  // add bias term
-      for (int kk = 0; kk < num_nodes[ii - 1]; kk ++) {
-        input_of_each_layer[ii][jj] += coeff[ii - 1][jj][kk] * output_of_each_layer[ii - 1][kk];
-      }
+      input[jj] += net.bias[ii - 1][jj];  // add bias term
     }
     // then get output
-    if (activations[ii - 1] == string("Linear")) {
+    switch (activation_types[ii - 1]) {
+    case linear:
       for(int jj = 0; jj < num_nodes[ii]; jj ++) {
-        output_of_each_layer[ii][jj] = input_of_each_layer[ii][jj];
+        output[jj] = input[jj];
       }
-    }
-    else if (activations[ii - 1] == string("Tanh")) {
+      break;
+    case hyperbolic_tangent:
       for(int jj = 0; jj < num_nodes[ii]; jj ++) {
-        output_of_each_layer[ii][jj] = tanh(input_of_each_layer[ii][jj]);
+        output[jj] = tanh(input[jj]);
       }
-    }
-    else if (activations[ii - 1] == string("Circular")) {
-      assert (num_nodes[ii] % 2 == 0);
+      break;
+    case circular:
       for(int jj = 0; jj < num_nodes[ii] / 2; jj ++) {
-        double radius = sqrt(input_of_each_layer[ii][2 * jj] * input_of_each_layer[ii][2 * jj]
-                             +input_of_each_layer[ii][2 * jj + 1] * input_of_each_layer[ii][2 * jj + 1]);
-        output_of_each_layer[ii][2 * jj] = input_of_each_layer[ii][2 * jj] / radius;
-        output_of_each_layer[ii][2 * jj + 1] = input_of_each_layer[ii][2 * jj + 1] / radius;
-
+        T radius = sqrt(input[2 * jj] * input[2 * jj] + input[2 * jj + 1] * input[2 * jj + 1]);
+        output[2 * jj] = input[2 * jj] / radius;
+        output[2 * jj + 1] = input[2 * jj + 1] / radius;
       }
-    }
-    else {
-      printf("layer type not found!\n\n");
-      return;
+      break;
     }
   }
 #ifdef DEBUG_2
   // print out the result for debugging
   printf("output_of_each_layer = \n");
-  // for (int ii = num_layers - 1; ii < num_layers; ii ++) {
   for (int ii = 0; ii < num_layers; ii ++) {
     printf("layer[%d]: ", ii);
     if (ii != 0) {
@@ -263,123 +338,90 @@ void ANN::calculate_output_of_each_layer(const vector<double>& input) {
       cout << "input \t" ;
     }
     for (int jj = 0; jj < num_nodes[ii]; jj ++) {
-      printf("%lf\t", output_of_each_layer[ii][jj]);
+      printf("%lf\t", double(net.output_of_each_layer[ii][jj]));
     }
     printf("\n");
   }
   printf("\n");
 #endif
-  return;
 }
 
-void ANN::back_prop(vector<vector<double> >& derivatives_of_each_layer, int index_of_output_component) {
-  derivatives_of_each_layer = output_of_each_layer;  // the data structure and size should be the same, so I simply deep copy it
-  // first calculate derivatives for bottleneck layer
-  for (int ii = 0; ii < num_nodes[num_nodes.size() - 1]; ii ++ ) {
-    if (ii == index_of_output_component) {
-      derivatives_of_each_layer[num_nodes.size() - 1][ii] = 1;
-    }
-    else {
-      derivatives_of_each_layer[num_nodes.size() - 1][ii] = 0;
-    }
+template<typename T>
+void ANN::back_prop(Network<T>& net) {
+  // the derivatives of all the outputs are propagated together, row kk holds the derivatives of output kk
+  int num_outputs = num_nodes[num_layers - 1];
+  vector<T>& last = net.derivatives_of_each_layer[num_layers - 1];
+  std::fill(last.begin(), last.end(), T(0));
+  for (int ii = 0; ii < num_outputs; ii ++ ) {
+    last[ii * num_outputs + ii] = 1;
   }
   // the use back propagation to calculate derivatives for previous layers
-  for (int jj = num_nodes.size() - 2; jj >= 0; jj --) {
-    if (activations[jj] == string("Circular")) {
-      vector<double> temp_derivative_of_input_for_this_layer;
-      temp_derivative_of_input_for_this_layer.resize(num_nodes[jj + 1]);
-#ifdef DEBUG
-      assert (num_nodes[jj + 1] % 2 == 0);
-#endif
-      // first calculate the derivative of input from derivative of output of this circular layer
-      for(int ii = 0; ii < num_nodes[jj + 1] / 2; ii ++) {
-        // printf("size of input_of_each_layer[%d] = %d\n",jj,  input_of_each_layer[jj].size());
-        double x_p = input_of_each_layer[jj + 1][2 * ii];
-        double x_q = input_of_each_layer[jj + 1][2 * ii + 1];
-        double radius = sqrt(x_p * x_p + x_q * x_q);
-        temp_derivative_of_input_for_this_layer[2 * ii] = x_q / (radius * radius * radius)
-            * (x_q * derivatives_of_each_layer[jj + 1][2 * ii]
-               - x_p * derivatives_of_each_layer[jj + 1][2 * ii + 1]);
-        temp_derivative_of_input_for_this_layer[2 * ii + 1] = x_p / (radius * radius * radius)
-            * (x_p * derivatives_of_each_layer[jj + 1][2 * ii + 1]
-               - x_q * derivatives_of_each_layer[jj + 1][2 * ii]);
-      }
-#ifdef DEBUG
-      for (int mm = 0; mm < num_nodes[jj + 1]; mm ++) {
-        printf("temp_derivative_of_input_for_this_layer[%d] = %lf\n", mm, temp_derivative_of_input_for_this_layer[mm]);
-        printf("derivatives_of_each_layer[%d + 1][%d] = %lf\n", jj, mm, derivatives_of_each_layer[jj + 1][mm]);
-      }
-#endif
-      // the calculate the derivative of output of layer jj, from derivative of input of layer (jj + 1)
-      for (int mm = 0; mm < num_nodes[jj]; mm ++) {
-        derivatives_of_each_layer[jj][mm] = 0;
-        for (int kk = 0; kk < num_nodes[jj + 1]; kk ++) {
-          derivatives_of_each_layer[jj][mm] += coeff[jj][kk][mm] \
-                                               * temp_derivative_of_input_for_this_layer[kk];
-#ifdef DEBUG
-          printf("derivatives_of_each_layer[%d][%d] = %lf\n", jj, mm, derivatives_of_each_layer[jj][mm]);
-          printf("coeff[%d][%d][%d] = %lf\n", jj, kk, mm, coeff[jj][kk][mm]);
-#endif
+  for (int jj = num_layers - 2; jj >= 0; jj --) {
+    int n = num_nodes[jj + 1];
+    const vector<T>& derivatives_of_output = net.derivatives_of_each_layer[jj + 1];
+    const vector<T>& input = net.input_of_each_layer[jj + 1];
+    const vector<T>& output = net.output_of_each_layer[jj + 1];
+    T* derivatives_of_input = net.derivatives_of_input.data();
+    // first calculate the derivative of input from derivative of output of this layer
+    for (int kk = 0; kk < num_outputs; kk ++) {
+      const T* d = derivatives_of_output.data() + kk * n;
+      T* g = derivatives_of_input + kk * n;
+      switch (activation_types[jj]) {
+      case linear:
+        for (int mm = 0; mm < n; mm ++) {
+          g[mm] = d[mm];
         }
-      }
-      // TODO: should be fine, pass all tests, although there seems to be some problems here previously
-    }
-    else {
-      for (int mm = 0; mm < num_nodes[jj]; mm ++) {
-        derivatives_of_each_layer[jj][mm] = 0;
-        for (int kk = 0; kk < num_nodes[jj + 1]; kk ++) {
-          if (activations[jj] == string("Tanh")) {
-            // printf("tanh\n");
-            derivatives_of_each_layer[jj][mm] += derivatives_of_each_layer[jj + 1][kk] \
-                                                 * coeff[jj][kk][mm] \
-                                                 * (1 - output_of_each_layer[jj + 1][kk] * output_of_each_layer[jj + 1][kk]);
-          }
-          else if (activations[jj] == string("Linear")) {
-            // printf("linear\n");
-            derivatives_of_each_layer[jj][mm] += derivatives_of_each_layer[jj + 1][kk] \
-                                                 * coeff[jj][kk][mm] \
-                                                 * 1;
-          }
-          else {
-            printf("layer type not found!\n\n");
-            return;
-          }
+        break;
+      case hyperbolic_tangent:
+        for (int mm = 0; mm < n; mm ++) {
+          g[mm] = d[mm] * (1 - output[mm] * output[mm]);
         }
+        break;
+      case circular:
+        for(int ii = 0; ii < n / 2; ii ++) {
+          T x_p = input[2 * ii];
+          T x_q = input[2 * ii + 1];
+          T radius = sqrt(x_p * x_p + x_q * x_q);
+          T radius3 = radius * radius * radius;
+          g[2 * ii] = x_q / radius3 * (x_q * d[2 * ii] - x_p * d[2 * ii + 1]);
+          g[2 * ii + 1] = x_p / radius3 * (x_p * d[2 * ii + 1] - x_q * d[2 * ii]);
+        }
+        break;
       }
     }
+    // then calculate the derivative of output of layer jj, from derivative of input of layer (jj + 1)
+    matMat(num_outputs, n, num_nodes[jj], derivatives_of_input, net.coeff[jj].data(), net.derivatives_of_each_layer[jj].data());
   }
 #ifdef DEBUG
   // print out the result for debugging
   printf("derivatives_of_each_layer = \n");
   for (int ii = 0; ii < num_layers; ii ++) {
     printf("layer[%d]: ", ii);
-    for (int jj = 0; jj < num_nodes[ii]; jj ++) {
-      printf("%lf\t", derivatives_of_each_layer[ii][jj]);
+    for (unsigned jj = 0; jj < net.derivatives_of_each_layer[ii].size(); jj ++) {
+      printf("%lf\t", double(net.derivatives_of_each_layer[ii][jj]));
     }
     printf("\n");
   }
   printf("\n");
 #endif
-  return;
 }
 
-void ANN::calculate() {
-
-  vector<double> input_layer_data(num_nodes[0]);
+template<typename T>
+void ANN::evaluate(Network<T>& net) {
+  // first layer
   for (int ii = 0; ii < num_nodes[0]; ii ++) {
-    input_layer_data[ii] = getArgument(ii);
+    net.output_of_each_layer[0][ii] = getArgument(ii);
   }
 
-  calculate_output_of_each_layer(input_layer_data);
-  vector<vector<double> > derivatives_of_each_layer;
+  calculate_output_of_each_layer(net);
+  back_prop(net);
 
   for (int ii = 0; ii < num_nodes[num_layers - 1]; ii ++) {
-    back_prop(derivatives_of_each_layer, ii);
-    string name_of_this_component = "node-" + to_string(ii);
-    Value* value_new=getPntrToComponent(name_of_this_component);
-    value_new -> set(output_of_each_layer[num_layers - 1][ii]);
+    Value* value_new=getPntrToComponent(ii);
+    value_new -> set(net.output_of_each_layer[num_layers - 1][ii]);
+    const T* derivatives = net.derivatives_of_each_layer[0].data() + ii * num_nodes[0];
     for (int jj = 0; jj < num_nodes[0]; jj ++) {
-      value_new -> setDerivative(jj, derivatives_of_each_layer[0][jj]);  // TODO: setDerivative or addDerivative?
+      value_new -> setDerivative(jj, derivatives[jj]);
     }
 #ifdef DEBUG_3
     printf("derivatives = ");
@@ -389,7 +431,15 @@ void ANN::calculate() {
     printf("\n");
 #endif
   }
+}
 
+void ANN::calculate() {
+  if (single_precision) {
+    evaluate(network_float);
+  }
+  else {
+    evaluate(network);
+  }
 }
 
 }
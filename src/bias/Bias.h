@@ -57,6 +57,9 @@ public:
   static void registerKeywords(Keywords&);
   explicit Bias(const ActionOptions&ao);
   void apply() override;
+/// Derivatives of the arguments are only needed on the steps where the forces are applied
+/// or on the steps where the derived class needs the gradients (e.g. ADAPTIVE=GEOM in METAD)
+  bool checkNeedsDerivatives() const override { return onStep() || checkNeedsGradients(); }
   unsigned getNumberOfDerivatives() override;
 };
 
@@ -22,6 +22,8 @@
 #include "Bias.h"
 #include "core/ActionRegister.h"
 #include "tools/Grid.h"
+#include "tools/MappedGrid.h"
+#include "tools/Communicator.h"
 #include "tools/Exception.h"
 #include "tools/File.h"
 
@@ -103,6 +105,20 @@ the one hundredth block of data where t1 is fixed at \f$+pi\f$.
 
 Please note the order that the order of arguments in the plumed.dat file must be the same as
 the order of arguments in the header of the grid file.
+
+Large grids can be stored in a binary file that is memory mapped read-only, so that
+it is loaded without parsing and a single copy is shared by all the processes
+running on the same node. With the following input
+the grid in bias.grid is converted to bias.bin the first time that PLUMED runs,
+and bias.bin is mapped in this and in the following runs:
+
+\plumedfile
+DISTANCE ATOMS=3,5 LABEL=d1
+EXTERNAL ARG=d1 FILE=bias.grid MAPPED_FILE=bias.bin LABEL=external
+\endplumedfile
+
+The binary file is not updated when bias.grid changes, so it should be removed in that case.
+A binary file can also be given directly with FILE.
 */
 //+ENDPLUMEDOC
 
@@ -126,6 +142,7 @@ void External::registerKeywords(Keywords& keys) {
   keys.addFlag("NOSPLINE",false,"specifies that no spline interpolation is to be used when calculating the energy and forces due to the external potential");
   keys.addFlag("SPARSE",false,"specifies that the external potential uses a sparse grid");
   keys.add("compulsory","SCALE","1.0","a factor that multiplies the external potential, useful to invert free energies");
+  keys.add("optional","MAPPED_FILE","a binary copy of the grid in FILE that is memory mapped read-only and shared by the processes on a node. It is written from FILE if it does not exist");
 }
 
 External::External(const ActionOptions& ao):
@@ -140,19 +157,47 @@ External::External(const ActionOptions& ao):
   parseFlag("NOSPLINE",nospline);
   bool spline=!nospline;
   parse("SCALE",scale_);
+  std::string mappedname;
+  parse("MAPPED_FILE",mappedname);
 
   checkRead();
 
+  if(MappedGrid::isBinary(filename)) {
+    if(mappedname.length()>0 && mappedname!=filename) error("MAPPED_FILE cannot be used when FILE is already a binary grid file");
+    mappedname=filename;
+  }
+  if(sparsegrid && mappedname.length()>0) error("SPARSE cannot be used with binary grid files");
+
   log.printf("  External potential from file %s\n",filename.c_str());
   log.printf("  Multiplied by %lf\n",scale_);
   if(spline) {log.printf("  External potential uses spline interpolation\n");}
   if(sparsegrid) {log.printf("  External potential uses sparse grid\n");}
 
 // read grid
-  IFile gridfile; gridfile.open(filename);
   std::string funcl=getLabel() + ".bias";
-  BiasGrid_=GridBase::create(funcl,getArguments(),gridfile,sparsegrid,spline,true);
+  if(mappedname.length()>0) {
+    if(mappedname!=filename) {
+      // the binary file is written once, the other processes wait for it
+      if(comm.Get_rank()==0 && !MappedGrid::isBinary(mappedname)) {
+        log.printf("  Writing binary grid file %s\n",mappedname.c_str());
+        IFile gridfile; gridfile.open(filename);
+        MappedGrid::write(mappedname,*GridBase::create(funcl,getArguments(),gridfile,false,spline,true));
+      }
+      comm.Barrier();
+    }
+    log.printf("  External potential memory mapped from binary file %s\n",mappedname.c_str());
+    BiasGrid_=Tools::make_unique<MappedGrid>(mappedname,spline);
+    if(!BiasGrid_->hasDerivatives()) error("missing derivatives from grid file");
+  } else {
+    IFile gridfile; gridfile.open(filename);
+    BiasGrid_=GridBase::create(funcl,getArguments(),gridfile,sparsegrid,spline,true);
+  }
   if(BiasGrid_->getDimension()!=getNumberOfArguments()) error("mismatch between dimensionality of input grid and number of arguments");
+  if(mappedname.length()>0) {
+    for(unsigned i=0; i<getNumberOfArguments(); ++i) {
+      if(BiasGrid_->getArgNames()[i]!=getPntrToArgument(i)->getName()) error("arguments in input are not in same order as in grid file");
+    }
+  }
   for(unsigned i=0; i<getNumberOfArguments(); ++i) {
     if( getPntrToArgument(i)->isPeriodic()!=BiasGrid_->getIsPeriodic()[i] ) error("periodicity mismatch between arguments and input bias");
   }
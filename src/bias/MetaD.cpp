@@ -23,6 +23,7 @@
 #include "core/ActionRegister.h"
 #include "core/ActionSet.h"
 #include "core/PlumedMain.h"
+#include "core/Checkpoint.h"
 #include "core/FlexibleBin.h"
 #include "tools/Exception.h"
 #include "tools/Grid.h"
@@ -31,8 +32,13 @@
 #include "tools/Random.h"
 #include "tools/File.h"
 #include "tools/Communicator.h"
+#include "tools/SharedRingBuffer.h"
+#include "tools/HillsBinaryFile.h"
+#include "tools/MappedGrid.h"
+#include "tools/KernelCells.h"
 #include <ctime>
 #include <numeric>
+#include <algorithm>
 
 namespace PLMD {
 namespace bias {
@@ -84,10 +90,17 @@ from the position they were at last neighbor list update. Gaussians are added to
 is within 6.*DP2CUTOFF*sigma*sigma. While the list is updated if the CVs are farther from the center than 0.5 of the
 standard deviation of the Gaussian center distribution of the list. These parameters (6 and 0.5) can be modified using
 NLIST_PARAMETERS. Note that the use of neighbor list does not provide the exact bias.
+Without grids and with fixed Gaussian widths the HILLS_CELLS flag can also be used. The centers of the Gaussians are then
+stored in cells as wide as the Gaussian cutoff, so that only the Gaussians in the cells around the CVs are summed (or
+searched when the neighbor list is updated). In contrast with NLIST the bias computed this way is exact.
 
 Metadynamics can be restarted either from a HILLS file as well as from a GRID, in this second
 case one can first save a GRID using GRID_WFILE (and GRID_WSTRIDE) and at a later stage read
 it using GRID_RFILE.
+When the MD code passes a checkpoint file to plumed with cmd("setCheckpointFile"), the grid (or the list of Gaussians
+when grids are not used) is also stored in the binary checkpoint that is written on the checkpointing steps.
+The bias can then be restored exactly with cmd("readCheckpoint") without reading the HILLS file again.
+This is not possible when multiple walkers share their Gaussians through files.
 
 The work performed by the METAD bias can be calculated using CALC_WORK, note that this is expensive when not using grids.
 
@@ -231,6 +244,16 @@ where all the walkers are located. WALKERS_RSTRIDE is the number of step between
 one update and the other. Since version 2.2.5, hills files are automatically
 flushed every WALKERS_RSTRIDE steps.
 
+When all the walkers run as separate processes on the same node the hills can also
+be exchanged through shared memory by adding WALKERS_SHM=name. Every walker then
+appends its hills to a ring buffer in the shared memory segment with this name and
+reads the hills of the others from there every WALKERS_RSTRIDE steps, without parsing
+their hills files. The hills files are still written and are used when restarting.
+The segment is kept after the run so that the walkers can be restarted. When a new
+simulation that is not a restart is started, the walker with WALKERS_ID=0 replaces the
+segment of the previous run with a new one, and the other walkers wait for it.
+At most 64 walkers can share a segment.
+
 \par
 The \f$c(t)\f$ reweighting factor can be calculated on the fly using the equations
 presented in \cite Tiwary_jp504920s as described above.
@@ -415,15 +438,49 @@ private:
   std::vector<double> sigma0max_;
   // Gaussians
   std::vector<Gaussian> hills_;
+  // Diagonal Gaussians are also stored as structure of arrays so that the bias is computed in vectorizable loops
+  struct HillsArrays {
+    std::vector<double> height;
+    std::vector<std::vector<double> > center;
+    std::vector<std::vector<double> > invsigma;
+    void clear() {
+      height.clear();
+      for(auto & c : center) c.clear();
+      for(auto & c : invsigma) c.clear();
+    }
+    void add(const Gaussian& hill) {
+      if(center.size()!=hill.center.size()) { center.resize(hill.center.size()); invsigma.resize(hill.center.size()); }
+      height.push_back(hill.height);
+      for(unsigned i=0; i<hill.center.size(); ++i) { center[i].push_back(hill.center[i]); invsigma[i].push_back(hill.invsigma[i]); }
+    }
+  };
+  HillsArrays hills_arrays_;
+  // this is false as soon as a multivariate Gaussian is added, the hills_arrays_ are then not used
+  bool hills_arrays_valid_;
+  // the number of Gaussians that are evaluated together in evaluateHillsBlock
+  static constexpr unsigned hills_block_=256;
+  // With HILLS_CELLS the indices of the diagonal Gaussians are also stored in a grid of cells in CV space
+  bool hills_cells_;
+  KernelCells hills_cells_grid_;
+  // the half width of the cells in units of sigma and scratch space for the cell search
+  double hills_cells_cutoff_;
+  std::vector<unsigned> hills_cells_candidates_;
   std::unique_ptr<FlexibleBin> flexbin_;
   int adaptive_;
   OFile hillsOfile_;
+  // binary copy of the hills file
+  std::string hillsBinaryFname_;
+  HillsBinaryFile hillsBinaryOfile_;
   std::vector<std::unique_ptr<IFile>> ifiles_;
   std::vector<std::string> ifilesnames_;
   // Grids
   bool grid_;
   std::unique_ptr<GridBase> BiasGrid_;
   OFile gridfile_;
+  // name of the grid file when it is written in binary format
+  std::string gridBinaryFname_;
+  bool gridBinary_;
+  bool gridCompress_;
   bool storeOldGrids_;
   int wgridstride_;
   // multiple walkers
@@ -432,6 +489,9 @@ private:
   int mw_id_;
   int mw_rstride_;
   bool walkers_mpi_;
+  // hills exchanged through shared memory by walkers on the same node
+  std::string mw_shm_;
+  std::unique_ptr<SharedRingBuffer> mw_shm_buffer_;
   unsigned mpi_nw_;
   // flying gaussians
   bool flying_;
@@ -472,7 +532,8 @@ private:
   bool nlist_update_;
   unsigned nlist_steps_;
   std::array<double,2> nlist_param_;
-  std::vector<Gaussian> nlist_hills_;
+  // the indices in hills_ of the Gaussians in the neighbor list
+  std::vector<unsigned> nlist_hills_;
   std::vector<double> nlist_center_;
   std::vector<double> nlist_dev2_;
 
@@ -492,7 +553,12 @@ private:
   void   readTemperingSpecs(TemperingSpecs &t_specs);
   void   logTemperingSpecs(const TemperingSpecs &t_specs);
   void   readGaussians(IFile*);
+  void   readSharedGaussians();
+  void   pushSharedGaussian(const Gaussian&);
   void   writeGaussian(const Gaussian&,OFile&);
+  void   readBinaryGaussians(const std::string&);
+  std::vector<double> getFileSigma(const Gaussian&);
+  std::vector<double> getSigmaFromFile(const std::vector<double>&);
   void   addGaussian(const Gaussian&);
   double getHeight(const std::vector<double>&);
   void   temperHeight(double &height, const TemperingSpecs &t_specs, const double tempering_bias);
@@ -500,6 +566,11 @@ private:
   double getBiasAndDerivatives(const std::vector<double>&, std::vector<double>&);
   double evaluateGaussian(const std::vector<double>&, const Gaussian&);
   double evaluateGaussianAndDerivatives(const std::vector<double>&, const Gaussian&,std::vector<double>&,std::vector<double>&);
+  double evaluateHillsBlock(const std::vector<double>& cv, const unsigned* index, const unsigned first, const unsigned last, double* der, std::vector<double>& scratch) const;
+  double getBiasFromHillsArrays(const std::vector<double>& cv, std::vector<double>* der);
+  void   addToHillsCells(const Gaussian&, const unsigned index);
+  void   getGaussianStencil(const Gaussian&, const std::vector<Grid::index_t>&, std::vector<double>&, std::vector<double>&);
+  void   addSharedGaussianToGrid(const Gaussian&);
   double getGaussianNormalization(const Gaussian&);
   std::vector<unsigned> getGaussianSupport(const Gaussian&);
   bool   scanOneHill(IFile* ifile, std::vector<Value>& v, std::vector<double>& center, std::vector<double>& sigma, double& height, bool& multivariate);
@@ -512,8 +583,14 @@ public:
   explicit MetaD(const ActionOptions&);
   void calculate() override;
   void update() override;
+  void writeCheckpoint(std::ostream&) override;
+  void readCheckpoint(std::istream&) override;
   static void registerKeywords(Keywords& keys);
   bool checkNeedsGradients()const override;
+  void addMemoryUsage(MemoryUsage& usage) const override;
+/// With a neighbor list only the hills close to the current CVs are summed
+  bool canComputeBiasFromArguments() const override { return !nlist_ && adaptive_!=FlexibleBin::diffusion; }
+  double computeBiasFromArguments( const std::vector<double>& args ) override { return biasf_!=1.0 ? getBias(args) : 0.0; }
 };
 
 PLUMED_REGISTER_ACTION(MetaD,"METAD")
@@ -533,6 +610,8 @@ void MetaD::registerKeywords(Keywords& keys) {
   keys.add("compulsory","SIGMA","the widths of the Gaussian hills");
   keys.add("compulsory","PACE","the frequency for hill addition");
   keys.add("compulsory","FILE","HILLS","a file in which the list of added hills is stored");
+  keys.add("optional","BINARY_FILE","a file in which the list of added hills is also stored in binary format. When restarting the hills are read from this file if it exists");
+  keys.addFlag("BINARY_CHECKSUM",false,"store a checksum with each hill in BINARY_FILE");
   keys.add("optional","HEIGHT","the heights of the Gaussian hills. Compulsory unless TAU and either BIASFACTOR or DAMPFACTOR are given");
   keys.add("optional","FMT","specify format for HILLS files (useful for decrease the number of digits in regtests)");
   keys.add("optional","BIASFACTOR","use well tempered metadynamics and use this bias factor.  Please note you must also specify temp");
@@ -554,13 +633,18 @@ void MetaD::registerKeywords(Keywords& keys) {
   keys.add("optional","GRID_BIN","the number of bins for the grid");
   keys.add("optional","GRID_SPACING","the approximate grid spacing (to be used as an alternative or together with GRID_BIN)");
   keys.addFlag("GRID_SPARSE",false,"use a sparse grid to store hills");
+  keys.addFlag("GRID_TILED",false,"store the grid in dense tiles that are allocated only in the regions visited by the hills, useful for grids in many dimensions");
   keys.addFlag("GRID_NOSPLINE",false,"don't use spline interpolation with grids");
+  keys.addFlag("GRID_SPLINE_TABLE",false,"store the polynomial coefficients of the spline in each cell of the grid, so that the bias is interpolated faster. The coefficients are recomputed only in the cells where hills are added, and take up to 4^d times the memory of the region of the grid where the bias is evaluated. It cannot be used with GRID_SPARSE or GRID_TILED");
   keys.add("optional","GRID_WSTRIDE","write the grid to a file every N steps");
   keys.add("optional","GRID_WFILE","the file on which to write the grid");
-  keys.add("optional","GRID_RFILE","a grid file from which the bias should be read at the initial step of the simulation");
+  keys.add("optional","GRID_RFILE","a grid file from which the bias should be read at the initial step of the simulation. Binary grid files are recognized automatically");
+  keys.addFlag("GRID_WBINARY",false,"write the grid in binary format, which is faster to write and to read at restart and can be converted to text with convert_grid. Only the latest grid is kept");
+  keys.addFlag("GRID_WCOMPRESS",false,"compress the binary grid with zlib, implies GRID_WBINARY");
   keys.addFlag("STORE_GRIDS",false,"store all the grid files the calculation generates. They will be deleted if this keyword is not present");
   keys.addFlag("NLIST",false,"Use neighbor list for kernels summation, faster but experimental");
   keys.add("optional", "NLIST_PARAMETERS","(default=6.,0.5) the two cutoff parameters for the Gaussians neighbor list");
+  keys.addFlag("HILLS_CELLS",false,"Store the Gaussians in cells in CV space so that only the Gaussians close to the CVs are summed. This is only possible without GRID, ADAPTIVE and INTERVAL. If a multivariate Gaussian is read from a file the cells are not used anymore and a warning is written in the log");
   keys.add("optional","ADAPTIVE","use a geometric (=GEOM) or diffusion (=DIFF) based hills width scheme. Sigma is one number that has distance units or time step dimensions");
   keys.add("optional","SIGMA_MAX","the upper bounds for the sigmas (in CV units) when using adaptive hills. Negative number means no bounds ");
   keys.add("optional","SIGMA_MIN","the lower bounds for the sigmas (in CV units) when using adaptive hills. Negative number means no bounds ");
@@ -568,6 +652,8 @@ void MetaD::registerKeywords(Keywords& keys) {
   keys.add("optional","WALKERS_N", "number of walkers");
   keys.add("optional","WALKERS_DIR", "shared directory with the hills files from all the walkers");
   keys.add("optional","WALKERS_RSTRIDE","stride for reading hills files");
+  keys.add("optional","WALKERS_SHM","name of a shared memory segment that is used to exchange the hills between walkers running on the same node");
+  keys.add("optional","WALKERS_SHM_SIZE","(default=100000) the number of hills that are kept in the shared memory segment");
   keys.addFlag("WALKERS_MPI",false,"Switch on MPI version of multiple walkers - not compatible with WALKERS_* options other than WALKERS_DIR");
   keys.add("optional","INTERVAL","one dimensional lower and upper limits, outside the limits the system will not feel the biasing force.");
   keys.addFlag("FLYING_GAUSSIAN",false,"Switch on flying Gaussian method, must be used with WALKERS_MPI");
@@ -604,6 +690,8 @@ MetaD::MetaD(const ActionOptions& ao):
   height0_(std::numeric_limits<double>::max()),
   adaptive_(FlexibleBin::none),
   grid_(false),
+  gridBinary_(false),
+  gridCompress_(false),
   wgridstride_(0),
   mw_n_(1), mw_dir_(""), mw_id_(0), mw_rstride_(1),
   walkers_mpi_(false), mpi_nw_(0),
@@ -627,6 +715,9 @@ MetaD::MetaD(const ActionOptions& ao):
   nlist_update_(false),
   nlist_steps_(0)
 {
+  hills_arrays_valid_=true;
+  hills_cells_=false;
+  hills_cells_cutoff_=0.0;
   if(!dp2cutoffNoStretch()) {
     stretchA=dp2cutoffA;
     stretchB=dp2cutoffB;
@@ -692,6 +783,9 @@ MetaD::MetaD(const ActionOptions& ao):
   current_stride_ = stride_;
   std::string hillsfname="HILLS";
   parse("FILE",hillsfname);
+  parse("BINARY_FILE",hillsBinaryFname_);
+  bool binaryChecksum=false;
+  parseFlag("BINARY_CHECKSUM",binaryChecksum);
 
   // Manually set to calculate special bias quantities
   // throughout the course of simulation. (These are chosen due to
@@ -808,13 +902,27 @@ MetaD::MetaD(const ActionOptions& ao):
 
   bool sparsegrid=false;
   parseFlag("GRID_SPARSE",sparsegrid);
+  bool tiledgrid=false;
+  parseFlag("GRID_TILED",tiledgrid);
+  if(sparsegrid && tiledgrid) error("GRID_SPARSE and GRID_TILED cannot be used together");
   bool nospline=false;
   parseFlag("GRID_NOSPLINE",nospline);
   bool spline=!nospline;
+  bool splinetable=false;
+  parseFlag("GRID_SPLINE_TABLE",splinetable);
+  if(splinetable && !spline) error("GRID_SPLINE_TABLE cannot be used with GRID_NOSPLINE");
+  if(splinetable && !grid_) error("GRID_SPLINE_TABLE requires a grid");
+  if(splinetable && (sparsegrid || tiledgrid)) error("GRID_SPLINE_TABLE cannot be used with GRID_SPARSE or GRID_TILED");
   parse("GRID_WSTRIDE",wgridstride_);
   std::string gridfilename_;
   parse("GRID_WFILE",gridfilename_);
   parseFlag("STORE_GRIDS",storeOldGrids_);
+  parseFlag("GRID_WBINARY",gridBinary_);
+  parseFlag("GRID_WCOMPRESS",gridCompress_);
+  if(gridCompress_) gridBinary_=true;
+  if(gridBinary_ && storeOldGrids_) error("STORE_GRIDS cannot be used with a binary grid file");
+  if(gridBinary_ && gridfilename_.length()==0) error("GRID_WBINARY requires GRID_WFILE");
+  if(gridBinary_) gridBinaryFname_=gridfilename_;
   if(grid_ && gridfilename_.length()>0) {
     if(wgridstride_==0 ) error("frequency with which to output grid not specified use GRID_WSTRIDE");
   }
@@ -850,6 +958,25 @@ MetaD::MetaD(const ActionOptions& ao):
     nlist_param_[0]=nlist_param[0];
     nlist_param_[1]=nlist_param[1];
   }
+  parseFlag("HILLS_CELLS",hills_cells_);
+  if(hills_cells_) {
+    if(grid_) error("HILLS_CELLS and GRID cannot be combined!");
+    if(adaptive_!=FlexibleBin::none) error("HILLS_CELLS cannot be used with ADAPTIVE");
+    const unsigned ncv=getNumberOfArguments();
+    std::vector<double> cmin(ncv,0.0), cperiod(ncv,0.0);
+    for(unsigned i=0; i<ncv; ++i) {
+      if(!getPntrToArgument(i)->isPeriodic()) continue;
+      double min, max; getPntrToArgument(i)->getDomain(min,max);
+      cmin[i]=min; cperiod[i]=max-min;
+    }
+    // a Gaussian contributes only if its center is closer than sigma*sqrt(2*DP2CUTOFF) along every CV
+    hills_cells_cutoff_=std::sqrt(2.0*dp2cutoff);
+    hills_cells_grid_.setup(cmin,cperiod,hills_cells_cutoff_);
+    hills_cells_grid_.updateWidths(sigma0_);
+    log.printf("  Gaussians are stored in cells with widths");
+    for(unsigned i=0; i<ncv; ++i) log.printf(" %f",hills_cells_grid_.getWidths()[i]);
+    log.printf("\n");
+  }
 
   // Reweighting factor rct
   parseFlag("CALC_RCT",calc_rct_);
@@ -866,6 +993,9 @@ MetaD::MetaD(const ActionOptions& ao):
   if(mw_n_<=mw_id_) error("walker ID should be a numerical value less than the total number of walkers");
   parse("WALKERS_DIR",mw_dir_);
   parse("WALKERS_RSTRIDE",mw_rstride_);
+  parse("WALKERS_SHM",mw_shm_);
+  unsigned mw_shm_size=100000;
+  parse("WALKERS_SHM_SIZE",mw_shm_size);
 
   // MPI version
   parseFlag("WALKERS_MPI",walkers_mpi_);
@@ -889,6 +1019,7 @@ MetaD::MetaD(const ActionOptions& ao):
     if(getNumberOfArguments()!=1) error("INTERVAL limits correction works only for monodimensional metadynamics!");
     if(uppI_<lowI_) error("The Upper limit must be greater than the Lower limit!");
     if(getPntrToArgument(0)->isPeriodic()) error("INTERVAL cannot be used with periodic variables!");
+    if(hills_cells_) error("HILLS_CELLS cannot be used with INTERVAL");
     doInt_=true;
   }
 
@@ -1007,8 +1138,11 @@ MetaD::MetaD(const ActionOptions& ao):
     for(unsigned i=0; i<gbin.size(); ++i) log.printf(" %u",gbin[i]);
     log.printf("\n");
     if(spline) {log.printf("  Grid uses spline interpolation\n");}
+    if(splinetable) {log.printf("  Grid stores the coefficients of the spline in each cell\n");}
     if(sparsegrid) {log.printf("  Grid uses sparse grid\n");}
+    if(tiledgrid) {log.printf("  Grid uses tiles allocated on first use\n");}
     if(wgridstride_>0) {log.printf("  Grid is written on file %s with stride %d\n",gridfilename_.c_str(),wgridstride_);}
+    if(gridBinary_) {log.printf("  Grid file is written in binary format%s\n",gridCompress_ ? " with compression" : "");}
   }
 
   if(mw_n_>1) {
@@ -1017,7 +1151,16 @@ MetaD::MetaD(const ActionOptions& ao):
     log.printf("  walker id %d\n",mw_id_);
     log.printf("  reading stride %d\n",mw_rstride_);
     if(mw_dir_!="")log.printf("  directory with hills files %s\n",mw_dir_.c_str());
+    if(mw_shm_.length()>0) {
+      if(!SharedRingBuffer::available()) error("WALKERS_SHM is not available on this system");
+      log.printf("  hills are exchanged through shared memory segment %s holding %u hills\n",mw_shm_.c_str(),mw_shm_size);
+      // the Gaussians are stored already in the form used in the bias, a full matrix is needed with ADAPTIVE
+      const unsigned ncv=getNumberOfArguments();
+      const unsigned nsigma=(adaptive_!=FlexibleBin::none ? ncv*(ncv+1)/2 : ncv);
+      if(comm.Get_rank()==0) mw_shm_buffer_=Tools::make_unique<SharedRingBuffer>(mw_shm_,3+ncv+nsigma,mw_shm_size,mw_id_,!getRestart());
+    }
   } else {
+    if(mw_shm_.length()>0) error("WALKERS_SHM can only be used with WALKERS_N");
     if(walkers_mpi_) {
       log.printf("  Multiple walkers active using MPI communnication\n");
       if(mw_dir_!="")log.printf("  directory with hills files %s\n",mw_dir_.c_str());
@@ -1174,7 +1317,8 @@ MetaD::MetaD(const ActionOptions& ao):
         }
       }
       std::string funcl=getLabel() + ".bias";
-      if(!sparsegrid) {BiasGrid_=Tools::make_unique<Grid>(funcl,getArguments(),gmin,gmax,gbin,spline,true);}
+      if(tiledgrid) {BiasGrid_=Tools::make_unique<TiledGrid>(funcl,getArguments(),gmin,gmax,gbin,spline,true);}
+      else if(!sparsegrid) {BiasGrid_=Tools::make_unique<Grid>(funcl,getArguments(),gmin,gmax,gbin,spline,true);}
       else {BiasGrid_=Tools::make_unique<SparseGrid>(funcl,getArguments(),gmin,gmax,gbin,spline,true);}
       std::vector<std::string> actualmin=BiasGrid_->getMin();
       std::vector<std::string> actualmax=BiasGrid_->getMax();
@@ -1196,13 +1340,20 @@ MetaD::MetaD(const ActionOptions& ao):
       }
       IFile gridfile;
       gridfile.link(*this);
-      if(gridfile.FileExist(gridreadfilename_)) {
-        gridfile.open(gridreadfilename_);
+      if(!gridfile.FileExist(gridreadfilename_)) error("The GRID file you want to read: " + gridreadfilename_ + ", cannot be found!");
+      std::string funcl=getLabel() + ".bias";
+      if(MappedGrid::isBinary(gridreadfilename_)) {
+        BiasGrid_=MappedGrid::load(funcl, getArguments(), gridreadfilename_, gmin, gmax, gbin, sparsegrid||tiledgrid, spline, true);
       } else {
-        error("The GRID file you want to read: " + gridreadfilename_ + ", cannot be found!");
+        gridfile.open(gridreadfilename_);
+        BiasGrid_=GridBase::create(funcl, getArguments(), gridfile, gmin, gmax, gbin, sparsegrid||tiledgrid, spline, true);
+      }
+      if(tiledgrid) {
+        // the file is read in a sparse grid and then moved in the tiles
+        auto tiled=Tools::make_unique<TiledGrid>(funcl,getArguments(),gmin,gmax,gbin,spline,true);
+        tiled->copyFrom(*BiasGrid_);
+        BiasGrid_=std::move(tiled);
       }
-      std::string funcl=getLabel() + ".bias";
-      BiasGrid_=GridBase::create(funcl, getArguments(), gridfile, gmin, gmax, gbin, sparsegrid, spline, true);
       if(BiasGrid_->getDimension()!=getNumberOfArguments()) error("mismatch between dimensionality of input grid and number of arguments");
       for(unsigned i=0; i<getNumberOfArguments(); ++i) {
         if( getPntrToArgument(i)->isPeriodic()!=BiasGrid_->getIsPeriodic()[i] ) error("periodicity mismatch between arguments and input bias");
@@ -1215,6 +1366,7 @@ MetaD::MetaD(const ActionOptions& ao):
       log.printf("  Restarting from %s\n",gridreadfilename_.c_str());
       if(getRestart()) restartedFromGrid=true;
     }
+    if(splinetable) BiasGrid_->enableSplineTable();
   }
 
   // if we are restarting from GRID and using WALKERS_MPI we can check that all walkers have actually read the grid
@@ -1262,7 +1414,13 @@ MetaD::MetaD(const ActionOptions& ao):
     IFile *ifile = ifiles_.back().get();
     ifilesnames_.push_back(fname);
     ifile->link(*this);
-    if(ifile->FileExist(fname)) {
+    const bool readbinary=(i==mw_id_ && hillsBinaryFname_.length()>0 && getRestart() && !restartedFromGrid && HillsBinaryFile::isBinary(hillsBinaryFname_));
+    if(readbinary) {
+      // the binary file contains the same hills of the text one
+      log.printf("  Restarting from %s:",hillsBinaryFname_.c_str());
+      readBinaryGaussians(hillsBinaryFname_);
+      restartedFromHills=true;
+    } else if(ifile->FileExist(fname)) {
       ifile->open(fname);
       if(getRestart()&&!restartedFromGrid) {
         log.printf("  Restarting from %s:",ifilesnames_[i].c_str());
@@ -1278,6 +1436,9 @@ MetaD::MetaD(const ActionOptions& ao):
     }
   }
 
+  // the hills already in the shared memory segment have been read from the files
+  if(mw_shm_buffer_ && getRestart()) mw_shm_buffer_->skipToEnd();
+
   // if we are restarting from FILE and using WALKERS_MPI we can check that all walkers have actually read the FILE
   if(getRestart()&&walkers_mpi_) {
     std::vector<int> restarted(mpi_nw_,0);
@@ -1324,7 +1485,22 @@ MetaD::MetaD(const ActionOptions& ao):
   }
 
   // open grid file for writing
-  if(wgridstride_>0) {
+  if(wgridstride_>0 && gridBinary_) {
+    // the binary file is written only by the first process of the first walker
+    if(walkers_mpi_) {
+      int r=0;
+      if(comm.Get_rank()==0) r=multi_sim_comm.Get_rank();
+      comm.Bcast(r,0);
+      if(r>0) gridBinaryFname_.clear();
+    }
+    if(comm.Get_rank()>0) gridBinaryFname_.clear();
+    // same suffix that would be used for the text file
+    if(!walkers_mpi_ && mw_n_==1) gridBinaryFname_=FileBase::appendSuffix(gridBinaryFname_,plumed.getSuffix());
+    if(!getRestart() && gridBinaryFname_.length()>0) {
+      // as for the text file, an existing binary file is backed up
+      OFile bck; bck.link(*this); bck.enforceSuffix(""); bck.backupFile("bck",gridBinaryFname_);
+    }
+  } else if(wgridstride_>0) {
     gridfile_.link(*this);
     if(walkers_mpi_) {
       int r=0;
@@ -1358,6 +1534,21 @@ MetaD::MetaD(const ActionOptions& ao):
   hillsOfile_.setHeavyFlush();
   // output periodicities of variables
   for(unsigned i=0; i<getNumberOfArguments(); ++i) hillsOfile_.setupPrintValue( getPntrToArgument(i) );
+  if(hillsBinaryFname_.length()>0) {
+    if(mw_n_>1 || walkers_mpi_) error("BINARY_FILE cannot be used with multiple walkers");
+    std::vector<HillsBinaryFile::Variable> vars(getNumberOfArguments());
+    for(unsigned i=0; i<vars.size(); ++i) {
+      vars[i].name=getPntrToArgument(i)->getName();
+      vars[i].periodic=getPntrToArgument(i)->isPeriodic();
+      if(vars[i].periodic) getPntrToArgument(i)->getDomain(vars[i].min,vars[i].max);
+    }
+    if(!getRestart()) {
+      // as for the text file, an existing binary file is backed up
+      OFile bck; bck.link(*this); bck.backupFile("bck",hillsBinaryFname_);
+    }
+    if(comm.Get_rank()==0) hillsBinaryOfile_.create(hillsBinaryFname_,vars,binaryChecksum,getRestart());
+    log.printf("  hills are also written in binary format on file %s%s\n",hillsBinaryFname_.c_str(),binaryChecksum ? " with checksums" : "");
+  }
 
   bool concurrent=false;
   const ActionSet&actionSet(plumed.getActionSet());
@@ -1446,6 +1637,46 @@ void MetaD::readGaussians(IFile *ifile)
   log.printf("      %d Gaussians read\n",nhills);
 }
 
+void MetaD::pushSharedGaussian(const Gaussian& hill)
+{
+  if(!mw_shm_buffer_) return;
+  // record layout: walker id, multivariate, height, center, sigma
+  std::vector<double> rec;
+  rec.reserve(3+hill.center.size()+hill.sigma.size());
+  rec.push_back(mw_id_);
+  rec.push_back(hill.multivariate ? 1.0 : 0.0);
+  rec.push_back(hill.height);
+  rec.insert(rec.end(),hill.center.begin(),hill.center.end());
+  rec.insert(rec.end(),hill.sigma.begin(),hill.sigma.end());
+  mw_shm_buffer_->push(rec);
+}
+
+void MetaD::readSharedGaussians()
+{
+  const unsigned ncv=getNumberOfArguments();
+  const unsigned nsigma=(adaptive_!=FlexibleBin::none ? ncv*(ncv+1)/2 : ncv);
+  const unsigned recsize=3+ncv+nsigma;
+  std::vector<double> recs;
+  unsigned nrec=0;
+  if(comm.Get_rank()==0) nrec=mw_shm_buffer_->pull(recs);
+  comm.Bcast(nrec,0);
+  if(nrec==0) return;
+  recs.resize(nrec*recsize);
+  comm.Bcast(recs,0);
+  std::vector<double> center(ncv), sigma(nsigma);
+  int nhills=0;
+  for(unsigned k=0; k<nrec; ++k) {
+    const double* rec=recs.data()+k*recsize;
+    // don't read your own Gaussians
+    if(static_cast<int>(rec[0])==mw_id_) continue;
+    for(unsigned i=0; i<ncv; ++i) center[i]=rec[3+i];
+    for(unsigned i=0; i<nsigma; ++i) sigma[i]=rec[3+ncv+i];
+    addGaussian(Gaussian(rec[1]>0.5,rec[2],center,sigma));
+    nhills++;
+  }
+  log.printf("  Reading hills from shared memory segment %s:      %d Gaussians read\n",mw_shm_.c_str(),nhills);
+}
+
 void MetaD::writeGaussian(const Gaussian& hill, OFile&file)
 {
   unsigned ncv=getNumberOfArguments();
@@ -1454,40 +1685,21 @@ void MetaD::writeGaussian(const Gaussian& hill, OFile&file)
     file.printField(getPntrToArgument(i),hill.center[i]);
   }
   hillsOfile_.printField("kerneltype","stretched-gaussian");
+  const std::vector<double> filesigma=getFileSigma(hill);
   if(hill.multivariate) {
     hillsOfile_.printField("multivariate","true");
-    Matrix<double> mymatrix(ncv,ncv);
-    unsigned k=0;
-    for(unsigned i=0; i<ncv; i++) {
-      for(unsigned j=i; j<ncv; j++) {
-        // recompose the full inverse matrix
-        mymatrix(i,j)=mymatrix(j,i)=hill.sigma[k];
-        k++;
-      }
-    }
-    // invert it
-    Matrix<double> invmatrix(ncv,ncv);
-    Invert(mymatrix,invmatrix);
-    // enforce symmetry
-    for(unsigned i=0; i<ncv; i++) {
-      for(unsigned j=i; j<ncv; j++) {
-        invmatrix(i,j)=invmatrix(j,i);
-      }
-    }
-
-    // do cholesky so to have a "sigma like" number
-    Matrix<double> lower(ncv,ncv);
-    cholesky(invmatrix,lower);
     // loop in band form
+    unsigned k=0;
     for(unsigned i=0; i<ncv; i++) {
       for(unsigned j=0; j<ncv-i; j++) {
-        file.printField("sigma_"+getPntrToArgument(j+i)->getName()+"_"+getPntrToArgument(j)->getName(),lower(j+i,j));
+        file.printField("sigma_"+getPntrToArgument(j+i)->getName()+"_"+getPntrToArgument(j)->getName(),filesigma[k]);
+        k++;
       }
     }
   } else {
     hillsOfile_.printField("multivariate","false");
     for(unsigned i=0; i<ncv; ++i)
-      file.printField("sigma_"+getPntrToArgument(i)->getName(),hill.sigma[i]);
+      file.printField("sigma_"+getPntrToArgument(i)->getName(),filesigma[i]);
   }
   double height=hill.height;
   // note that for gamma=1 we store directly -F
@@ -1495,6 +1707,103 @@ void MetaD::writeGaussian(const Gaussian& hill, OFile&file)
   file.printField("height",height).printField("biasf",biasf_);
   if(mw_n_>1) file.printField("clock",int(std::time(0)));
   file.printField();
+  if(hillsBinaryOfile_.isOpen()) {
+    HillsBinaryFile::Record rec;
+    rec.time=getTimeStep()*getStep(); rec.height=height; rec.biasf=biasf_;
+    rec.multivariate=hill.multivariate; rec.center=hill.center; rec.sigma=filesigma;
+    hillsBinaryOfile_.write(rec);
+    hillsBinaryOfile_.flush();
+  }
+}
+
+void MetaD::readBinaryGaussians(const std::string& fname)
+{
+  unsigned ncv=getNumberOfArguments();
+  HillsBinaryFile bfile;
+  bfile.open(fname);
+  const std::vector<HillsBinaryFile::Variable>& vars=bfile.getVariables();
+  if(vars.size()!=ncv) error("number of variables in binary hills file "+fname+" does not match input");
+  for(unsigned i=0; i<ncv; ++i) {
+    if(vars[i].name!=getPntrToArgument(i)->getName()) error("variable "+vars[i].name+" in binary hills file "+fname+" does not match input");
+    if(vars[i].periodic!=getPntrToArgument(i)->isPeriodic()) error("in binary hills file periodicity for variable "+vars[i].name+" does not match periodicity in input");
+    if(vars[i].periodic) {
+      std::string rmin, rmax; getPntrToArgument(i)->getDomain( rmin, rmax );
+      if(vars[i].min!=rmin || vars[i].max!=rmax) error("in binary hills file periodicity for variable "+vars[i].name+" does not match periodicity in input");
+    }
+  }
+  HillsBinaryFile::Record rec;
+  int nhills=0;
+  while(bfile.read(rec)) {
+    nhills++;
+    double height=rec.height;
+    // note that for gamma=1 we store directly -F
+    if(welltemp_ && biasf_>1.0) height*=(biasf_-1.0)/biasf_;
+    addGaussian(Gaussian(rec.multivariate,height,rec.center,rec.multivariate ? getSigmaFromFile(rec.sigma) : rec.sigma));
+  }
+  log.printf("      %d Gaussians read\n",nhills);
+}
+
+std::vector<double> MetaD::getFileSigma(const Gaussian& hill)
+{
+  if(!hill.multivariate) return hill.sigma;
+  unsigned ncv=getNumberOfArguments();
+  Matrix<double> mymatrix(ncv,ncv);
+  unsigned k=0;
+  for(unsigned i=0; i<ncv; i++) {
+    for(unsigned j=i; j<ncv; j++) {
+      // recompose the full inverse matrix
+      mymatrix(i,j)=mymatrix(j,i)=hill.sigma[k];
+      k++;
+    }
+  }
+  // invert it
+  Matrix<double> invmatrix(ncv,ncv);
+  Invert(mymatrix,invmatrix);
+  // enforce symmetry
+  for(unsigned i=0; i<ncv; i++) {
+    for(unsigned j=i; j<ncv; j++) {
+      invmatrix(i,j)=invmatrix(j,i);
+    }
+  }
+
+  // do cholesky so to have a "sigma like" number
+  Matrix<double> lower(ncv,ncv);
+  cholesky(invmatrix,lower);
+  // store in band form
+  std::vector<double> filesigma;
+  for(unsigned i=0; i<ncv; i++) {
+    for(unsigned j=0; j<ncv-i; j++) filesigma.push_back(lower(j+i,j));
+  }
+  return filesigma;
+}
+
+std::vector<double> MetaD::getSigmaFromFile(const std::vector<double>& filesigma)
+{
+  unsigned ncv=getNumberOfArguments();
+  std::vector<double> sigma(ncv*(ncv+1)/2);
+  Matrix<double> upper(ncv,ncv);
+  Matrix<double> lower(ncv,ncv);
+  unsigned k=0;
+  for(unsigned i=0; i<ncv; i++) {
+    for(unsigned j=0; j<ncv-i; j++) {
+      lower(j+i,j)=filesigma[k]; k++;
+      upper(j,j+i)=lower(j+i,j);
+    }
+  }
+  Matrix<double> mymult(ncv,ncv);
+  Matrix<double> invmatrix(ncv,ncv);
+  mult(lower,upper,mymult);
+  // now invert and get the sigmas
+  Invert(mymult,invmatrix);
+  // put the sigmas in the usual order: upper diagonal (this time in normal form and not in band form)
+  k=0;
+  for(unsigned i=0; i<ncv; i++) {
+    for(unsigned j=i; j<ncv; j++) {
+      sigma[k]=invmatrix(i,j);
+      k++;
+    }
+  }
+  return sigma;
 }
 
 void MetaD::addGaussian(const Gaussian& hill)
@@ -1502,6 +1811,11 @@ void MetaD::addGaussian(const Gaussian& hill)
   if(grid_) {
     size_t ncv=getNumberOfArguments();
     std::vector<unsigned> nneighb=getGaussianSupport(hill);
+    if(comm.Get_size()==1 && !hill.multivariate && !doInt_) {
+      // the Gaussian is a product of one dimensional Gaussians so these are computed once for each bin along each direction
+      BiasGrid_->addSeparableGaussian(hill.center,hill.invsigma,hill.height,nneighb,dp2cutoff,stretchA,stretchB);
+      return;
+    }
     std::vector<Grid::index_t> neighbors=BiasGrid_->getNeighbors(hill.center,nneighb);
     std::vector<double> der(ncv);
     std::vector<double> xx(ncv);
@@ -1516,29 +1830,107 @@ void MetaD::addGaussian(const Gaussian& hill)
         BiasGrid_->addValueAndDerivatives(ineigh,bias,der);
       }
     } else {
-      unsigned stride=comm.Get_size();
-      unsigned rank=comm.Get_rank();
-      std::vector<double> allder(ncv*neighbors.size(),0.0);
-      std::vector<double> n_der(ncv,0.0);
-      std::vector<double> allbias(neighbors.size(),0.0);
-      // for performance reasons and thread safety
-      std::vector<double> dp(ncv);
-      for(unsigned i=rank; i<neighbors.size(); i+=stride) {
-        Grid::index_t ineigh=neighbors[i];
-        for(unsigned j=0; j<ncv; ++j) n_der[j]=0.0;
-        BiasGrid_->getPoint(ineigh,xx);
-        allbias[i]=evaluateGaussianAndDerivatives(xx,hill,n_der,dp);
-        for(unsigned j=0; j<ncv; j++) allder[ncv*i+j]=n_der[j];
-      }
-      comm.Sum(allbias);
-      comm.Sum(allder);
+      std::vector<double> allbias, allder;
+      getGaussianStencil(hill,neighbors,allbias,allder);
       for(unsigned i=0; i<neighbors.size(); ++i) {
         Grid::index_t ineigh=neighbors[i];
         for(unsigned j=0; j<ncv; ++j) der[j]=allder[ncv*i+j];
         BiasGrid_->addValueAndDerivatives(ineigh,allbias[i],der);
       }
     }
-  } else hills_.push_back(hill);
+  } else {
+    hills_.push_back(hill);
+    if(hill.multivariate && hills_arrays_valid_) {
+      hills_arrays_valid_=false;
+      if(hills_cells_) log<<"  WARNING: a multivariate Gaussian was added so HILLS_CELLS is not used anymore and all the Gaussians are summed\n";
+    }
+    if(hills_arrays_valid_) hills_arrays_.add(hill);
+    if(hills_cells_ && hills_arrays_valid_) addToHillsCells(hill,hills_.size()-1);
+  }
+}
+
+void MetaD::getGaussianStencil(const Gaussian& hill, const std::vector<Grid::index_t>& neighbors, std::vector<double>& allbias, std::vector<double>& allder)
+{
+  const unsigned ncv=getNumberOfArguments();
+  unsigned stride=comm.Get_size();
+  unsigned rank=comm.Get_rank();
+  allder.assign(ncv*neighbors.size(),0.0);
+  allbias.assign(neighbors.size(),0.0);
+  std::vector<double> n_der(ncv,0.0);
+  std::vector<double> xx(ncv);
+  // for performance reasons and thread safety
+  std::vector<double> dp(ncv);
+  for(unsigned i=rank; i<neighbors.size(); i+=stride) {
+    Grid::index_t ineigh=neighbors[i];
+    for(unsigned j=0; j<ncv; ++j) n_der[j]=0.0;
+    BiasGrid_->getPoint(ineigh,xx);
+    allbias[i]=evaluateGaussianAndDerivatives(xx,hill,n_der,dp);
+    for(unsigned j=0; j<ncv; j++) allder[ncv*i+j]=n_der[j];
+  }
+  if(stride>1) {
+    comm.Sum(allbias);
+    comm.Sum(allder);
+  }
+}
+
+void MetaD::addSharedGaussianToGrid(const Gaussian& hill)
+{
+  const unsigned ncv=getNumberOfArguments();
+  std::vector<Grid::index_t> neighbors=BiasGrid_->getNeighbors(hill.center,getGaussianSupport(hill));
+  std::vector<double> allbias, allder;
+  getGaussianStencil(hill,neighbors,allbias,allder);
+  // the grid points are sent as ranges of consecutive indices (start and length) followed by the values and the derivatives
+  std::vector<Grid::index_t> ranges;
+  for(unsigned i=0; i<neighbors.size(); ++i) {
+    if(i>0 && neighbors[i]==neighbors[i-1]+1) ranges.back()++;
+    else { ranges.push_back(neighbors[i]); ranges.push_back(1); }
+  }
+  std::vector<double> data((ncv+1)*neighbors.size());
+  for(unsigned i=0; i<neighbors.size(); ++i) {
+    data[(ncv+1)*i]=allbias[i];
+    for(unsigned j=0; j<ncv; ++j) data[(ncv+1)*i+1+j]=allder[ncv*i+j];
+  }
+  std::vector<int> all_nranges(mpi_nw_,0), all_ndata(mpi_nw_,0);
+  if(comm.Get_rank()==0) {
+    multi_sim_comm.Allgather(int(ranges.size()),all_nranges);
+    multi_sim_comm.Allgather(int(data.size()),all_ndata);
+  }
+  comm.Bcast(all_nranges,0);
+  comm.Bcast(all_ndata,0);
+  std::vector<int> displ_ranges(mpi_nw_,0), displ_data(mpi_nw_,0);
+  for(unsigned i=1; i<mpi_nw_; ++i) {
+    displ_ranges[i]=displ_ranges[i-1]+all_nranges[i-1];
+    displ_data[i]=displ_data[i-1]+all_ndata[i-1];
+  }
+  std::vector<Grid::index_t> all_ranges(displ_ranges[mpi_nw_-1]+all_nranges[mpi_nw_-1]);
+  std::vector<double> all_data(displ_data[mpi_nw_-1]+all_ndata[mpi_nw_-1]);
+  if(comm.Get_rank()==0) {
+    multi_sim_comm.Allgatherv(ranges,all_ranges,all_nranges.data(),displ_ranges.data());
+    multi_sim_comm.Allgatherv(data,all_data,all_ndata.data(),displ_data.data());
+  }
+  comm.Bcast(all_ranges,0);
+  comm.Bcast(all_data,0);
+  // the contributions are added in the order of the walkers so that all the grids are identical
+  std::vector<double> der(ncv);
+  const double* d=all_data.data();
+  for(unsigned r=0; r<all_ranges.size(); r+=2) {
+    for(Grid::index_t k=0; k<all_ranges[r+1]; ++k) {
+      for(unsigned j=0; j<ncv; ++j) der[j]=d[1+j];
+      BiasGrid_->addValueAndDerivatives(all_ranges[r]+k,d[0],der);
+      d+=ncv+1;
+    }
+  }
+}
+
+void MetaD::addToHillsCells(const Gaussian& hill, const unsigned index)
+{
+  if(!hills_cells_grid_.updateWidths(hill.sigma)) { hills_cells_grid_.add(hill.center,index); return; }
+  // the cells were too narrow for this Gaussian and have been emptied
+  std::vector<double> center(hill.center.size());
+  for(unsigned k=0; k<hills_.size(); ++k) {
+    for(unsigned i=0; i<center.size(); ++i) center[i]=hills_arrays_.center[i][k];
+    hills_cells_grid_.add(center,k);
+  }
 }
 
 std::vector<unsigned> MetaD::getGaussianSupport(const Gaussian& hill)
@@ -1599,6 +1991,7 @@ double MetaD::getBias(const std::vector<double>& cv)
 {
   double bias=0.0;
   if(grid_) bias = BiasGrid_->getValue(cv);
+  else if(hills_arrays_valid_ && !doInt_) bias = getBiasFromHillsArrays(cv,NULL);
   else {
     unsigned nt=OpenMP::getNumThreads();
     unsigned stride=comm.Get_size();
@@ -1614,7 +2007,7 @@ double MetaD::getBias(const std::vector<double>& cv)
       #pragma omp parallel num_threads(nt)
       {
         #pragma omp for reduction(+:bias) nowait
-        for(unsigned i=rank; i<nlist_hills_.size(); i+=stride) bias+=evaluateGaussian(cv,nlist_hills_[i]);
+        for(unsigned i=rank; i<nlist_hills_.size(); i+=stride) bias+=evaluateGaussian(cv,hills_[nlist_hills_[i]]);
       }
     }
     comm.Sum(bias);
@@ -1631,6 +2024,8 @@ double MetaD::getBiasAndDerivatives(const std::vector<double>& cv, std::vector<d
     std::vector<double> vder(ncv);
     bias=BiasGrid_->getValueAndDerivatives(cv,vder);
     for(unsigned i=0; i<ncv; i++) der[i]=vder[i];
+  } else if(hills_arrays_valid_ && !doInt_) {
+    bias=getBiasFromHillsArrays(cv,&der);
   } else {
     unsigned nt=OpenMP::getNumThreads();
     unsigned stride=comm.Get_size();
@@ -1662,7 +2057,7 @@ double MetaD::getBiasAndDerivatives(const std::vector<double>& cv, std::vector<d
         // for performance reasons and thread safety
         std::vector<double> dp(ncv);
         for(unsigned i=rank; i<nlist_hills_.size(); i+=stride) {
-          bias+=evaluateGaussianAndDerivatives(cv,nlist_hills_[i],der,dp);
+          bias+=evaluateGaussianAndDerivatives(cv,hills_[nlist_hills_[i]],der,dp);
         }
       } else {
         #pragma omp parallel num_threads(nt)
@@ -1672,7 +2067,7 @@ double MetaD::getBiasAndDerivatives(const std::vector<double>& cv, std::vector<d
           std::vector<double> dp(ncv);
           #pragma omp for reduction(+:bias) nowait
           for(unsigned i=rank; i<nlist_hills_.size(); i+=stride) {
-            bias+=evaluateGaussianAndDerivatives(cv,nlist_hills_[i],omp_deriv,dp);
+            bias+=evaluateGaussianAndDerivatives(cv,hills_[nlist_hills_[i]],omp_deriv,dp);
           }
           #pragma omp critical
           for(unsigned i=0; i<ncv; i++) der[i]+=omp_deriv[i];
@@ -1686,6 +2081,95 @@ double MetaD::getBiasAndDerivatives(const std::vector<double>& cv, std::vector<d
   return bias;
 }
 
+double MetaD::getBiasFromHillsArrays(const std::vector<double>& cv, std::vector<double>* der)
+{
+  unsigned nt=OpenMP::getNumThreads();
+  const unsigned stride=comm.Get_size();
+  const unsigned rank=comm.Get_rank();
+  const unsigned ncv=getNumberOfArguments();
+  const unsigned* index=NULL;
+  unsigned n=hills_arrays_.height.size();
+  if(nlist_) { index=nlist_hills_.data(); n=nlist_hills_.size(); }
+  else if(hills_cells_) {
+    hills_cells_grid_.getCandidates(cv,hills_cells_cutoff_,hills_cells_candidates_);
+    index=hills_cells_candidates_.data(); n=hills_cells_candidates_.size();
+  }
+  // each rank gets a contiguous part of the hills that is split in blocks over the threads
+  const unsigned first=(static_cast<std::size_t>(rank)*n)/stride, last=(static_cast<std::size_t>(rank+1)*n)/stride;
+  if((last-first)<2*nt*hills_block_) nt=1;
+
+  double bias=0.0;
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double> omp_deriv(ncv,0.), scratch;
+    #pragma omp for reduction(+:bias) nowait
+    for(unsigned b=first; b<last; b+=hills_block_) {
+      bias+=evaluateHillsBlock(cv,index,b,std::min(b+hills_block_,last),der ? omp_deriv.data() : NULL,scratch);
+    }
+    if(der) {
+      #pragma omp critical
+      for(unsigned i=0; i<ncv; i++) (*der)[i]+=omp_deriv[i];
+    }
+  }
+  comm.Sum(bias);
+  if(der) comm.Sum(*der);
+  return bias;
+}
+
+double MetaD::evaluateHillsBlock(const std::vector<double>& cv, const unsigned* index, const unsigned first, const unsigned last, double* der, std::vector<double>& scratch) const
+{
+  const unsigned ncv=cv.size(), n=last-first;
+  // scratch holds the scaled distances from the centers for all the CVs and then the squared distance
+  scratch.assign((ncv+1)*n,0.0);
+  double* dp2=scratch.data()+ncv*n;
+  const double* height=hills_arrays_.height.data();
+  for(unsigned i=0; i<ncv; i++) {
+    const double* center=hills_arrays_.center[i].data();
+    const double* invsigma=hills_arrays_.invsigma[i].data();
+    double* dp=scratch.data()+i*n;
+    const double x=cv[i];
+    if(getPntrToArgument(i)->isPeriodic()) {
+      double min, max; getPntrToArgument(i)->getDomain(min,max);
+      const double period=max-min, invperiod=1.0/period;
+      for(unsigned k=0; k<n; k++) {
+        const unsigned h=index ? index[first+k] : first+k;
+        dp[k]=Tools::pbc((x-center[h])*invperiod)*period*invsigma[h];
+      }
+    } else {
+      for(unsigned k=0; k<n; k++) {
+        const unsigned h=index ? index[first+k] : first+k;
+        dp[k]=(x-center[h])*invsigma[h];
+      }
+    }
+    for(unsigned k=0; k<n; k++) dp2[k]+=dp[k]*dp[k];
+  }
+
+  double bias=0.0;
+  for(unsigned k=0; k<n; k++) {
+    const unsigned h=index ? index[first+k] : first+k;
+    const double d=0.5*dp2[k];
+    // dp2 is overwritten with the value of the Gaussian (zero beyond the cutoff)
+    dp2[k]=0.0;
+    if(d<dp2cutoff) {
+      dp2[k]=height[h]*std::exp(-d);
+      bias+=stretchA*dp2[k]+height[h]*stretchB;
+    }
+  }
+  if(der) {
+    for(unsigned i=0; i<ncv; i++) {
+      const double* invsigma=hills_arrays_.invsigma[i].data();
+      const double* dp=scratch.data()+i*n;
+      double tmp=0.0;
+      for(unsigned k=0; k<n; k++) {
+        const unsigned h=index ? index[first+k] : first+k;
+        tmp+=dp2[k]*dp[k]*invsigma[h];
+      }
+      der[i]-=tmp*stretchA;
+    }
+  }
+  return bias;
+}
+
 double MetaD::getGaussianNormalization(const Gaussian& hill)
 {
   double norm=1;
@@ -1982,9 +2466,19 @@ void MetaD::update()
       // Flying Gaussian
       if (flying_) {
         hills_.clear();
+        hills_arrays_.clear(); hills_arrays_valid_=true;
+        hills_cells_grid_.clear();
+        nlist_hills_.clear();
         comm.Barrier();
       }
 
+      // with a grid every walker only computes the grid points covered by its own hill
+      // and the contributions of all the walkers are then exchanged
+      const bool shared_grid=grid_ && !flying_;
+      if(shared_grid) {
+        addSharedGaussianToGrid(Gaussian(multivariate,height,cv,thissigma));
+      }
+
       for(unsigned i=0; i<mpi_nw_; i++) {
         // actually add hills one by one
         std::vector<double> cv_now(ncv);
@@ -1994,13 +2488,14 @@ void MetaD::update()
         // notice that if gamma=1 we store directly -F so this scaling is not necessary:
         double fact=(biasf_>1.0?(biasf_-1.0)/biasf_:1.0);
         Gaussian newhill=Gaussian(all_multivariate[i],all_height[i]*fact,cv_now,sigma_now);
-        addGaussian(newhill);
+        if(!shared_grid) addGaussian(newhill);
         if(!flying_) writeGaussian(newhill,hillsOfile_);
       }
     } else {
       Gaussian newhill=Gaussian(multivariate,height,cv,thissigma);
       addGaussian(newhill);
       writeGaussian(newhill,hillsOfile_);
+      if(mw_shm_.length()>0) pushSharedGaussian(newhill);
     }
 
     // this is to update the hills neighbor list
@@ -2018,7 +2513,10 @@ void MetaD::update()
   }
 
   // dump grid on file
-  if(wgridstride_>0&&(getStep()%wgridstride_==0||getCPT())) {
+  if(wgridstride_>0&&(getStep()%wgridstride_==0||getCPT())&&gridBinary_) {
+    // the file is replaced atomically, so that it is never left partially written
+    if(gridBinaryFname_.length()>0) MappedGrid::write(gridBinaryFname_,*BiasGrid_,true,gridCompress_);
+  } else if(wgridstride_>0&&(getStep()%wgridstride_==0||getCPT())) {
     // in case old grids are stored, a sequence of grids should appear
     // this call results in a repetition of the header:
     if(storeOldGrids_) gridfile_.clearFields();
@@ -2043,7 +2541,10 @@ void MetaD::update()
   }
 
   // if multiple walkers and time to read Gaussians
-  if(mw_n_>1 && getStep()%mw_rstride_==0) {
+  if(mw_n_>1 && getStep()%mw_rstride_==0 && mw_shm_.length()>0) {
+    readSharedGaussians();
+    if(nlist_) nlist_update_=true;
+  } else if(mw_n_>1 && getStep()%mw_rstride_==0) {
     for(int i=0; i<mw_n_; ++i) {
       // don't read your own Gaussians
       if(i==mw_id_) continue;
@@ -2118,28 +2619,15 @@ bool MetaD::scanOneHill(IFile* ifile, std::vector<Value>& tmpvalues, std::vector
     else if(sss=="false") multivariate=false;
     else plumed_merror("cannot parse multivariate = "+ sss);
     if(multivariate) {
-      sigma.resize(ncv*(ncv+1)/2);
-      Matrix<double> upper(ncv,ncv);
-      Matrix<double> lower(ncv,ncv);
-      for(unsigned i=0; i<ncv; i++) {
-        for(unsigned j=0; j<ncv-i; j++) {
-          ifile->scanField("sigma_"+getPntrToArgument(j+i)->getName()+"_"+getPntrToArgument(j)->getName(),lower(j+i,j));
-          upper(j,j+i)=lower(j+i,j);
-        }
-      }
-      Matrix<double> mymult(ncv,ncv);
-      Matrix<double> invmatrix(ncv,ncv);
-      mult(lower,upper,mymult);
-      // now invert and get the sigmas
-      Invert(mymult,invmatrix);
-      // put the sigmas in the usual order: upper diagonal (this time in normal form and not in band form)
+      std::vector<double> filesigma(ncv*(ncv+1)/2);
       unsigned k=0;
       for(unsigned i=0; i<ncv; i++) {
-        for(unsigned j=i; j<ncv; j++) {
-          sigma[k]=invmatrix(i,j);
+        for(unsigned j=0; j<ncv-i; j++) {
+          ifile->scanField("sigma_"+getPntrToArgument(j+i)->getName()+"_"+getPntrToArgument(j)->getName(),filesigma[k]);
           k++;
         }
       }
+      sigma=getSigmaFromFile(filesigma);
     } else {
       for(unsigned i=0; i<ncv; ++i) {
         ifile->scanField("sigma_"+getPntrToArgument(i)->getName(),sigma[i]);
@@ -2238,6 +2726,20 @@ void MetaD::updateFrequencyAdaptiveStride()
   getPntrToComponent("pace")->set(current_stride_);
 }
 
+void MetaD::addMemoryUsage(MemoryUsage& usage) const
+{
+  Bias::addMemoryUsage(usage);
+  usage.lists+=Tools::getMemoryUsage(hills_);
+  for(const auto & h : hills_) usage.lists+=Tools::getMemoryUsage(h.center)+Tools::getMemoryUsage(h.sigma)+Tools::getMemoryUsage(h.invsigma);
+  usage.lists+=Tools::getMemoryUsage(hills_arrays_.height)+Tools::getMemoryUsage(hills_arrays_.center)+Tools::getMemoryUsage(hills_arrays_.invsigma);
+  for(const auto & c : hills_arrays_.center) usage.lists+=Tools::getMemoryUsage(c);
+  for(const auto & c : hills_arrays_.invsigma) usage.lists+=Tools::getMemoryUsage(c);
+  usage.lists+=Tools::getMemoryUsage(hills_cells_candidates_);
+  usage.lists+=Tools::getMemoryUsage(nlist_hills_)+Tools::getMemoryUsage(nlist_center_)+Tools::getMemoryUsage(nlist_dev2_);
+  if(BiasGrid_) usage.grids+=BiasGrid_->getMemoryUsage();
+  if(TargetGrid_) usage.grids+=TargetGrid_->getMemoryUsage();
+}
+
 bool MetaD::checkNeedsGradients()const
 {
   if(adaptive_==FlexibleBin::geometry) {
@@ -2253,27 +2755,38 @@ void MetaD::updateNlist()
 
   // here we generate the neighbor list
   nlist_hills_.clear();
-  std::vector<Gaussian> local_flat_nl;
+  // with HILLS_CELLS only the Gaussians in the cells around the CVs are checked
+  const bool usecells=hills_cells_ && hills_arrays_valid_;
+  if(usecells) {
+    std::vector<double> cv(getNumberOfArguments());
+    for(unsigned i=0; i<cv.size(); i++) cv[i]=getArgument(i);
+    hills_cells_grid_.getCandidates(cv,std::sqrt(nlist_param_[0]*dp2cutoff),hills_cells_candidates_);
+  }
+  const unsigned ncand=usecells ? hills_cells_candidates_.size() : hills_.size();
+  std::vector<unsigned> local_flat_nl;
   unsigned nt=OpenMP::getNumThreads();
-  if(hills_.size()<2*nt) nt=1;
+  if(ncand<2*nt) nt=1;
   #pragma omp parallel num_threads(nt)
   {
-    std::vector<Gaussian> private_flat_nl;
+    std::vector<unsigned> private_flat_nl;
     #pragma omp for nowait
-    for(unsigned k=0; k<hills_.size(); k++)
+    for(unsigned m=0; m<ncand; m++)
     {
+      const unsigned k=usecells ? hills_cells_candidates_[m] : m;
       double dist2=0;
       for(unsigned i=0; i<getNumberOfArguments(); i++)
       {
         const double d=difference(i,getArgument(i),hills_[k].center[i])/hills_[k].sigma[i];
         dist2+=d*d;
       }
-      if(dist2<=nlist_param_[0]*dp2cutoff) private_flat_nl.push_back(hills_[k]);
+      if(dist2<=nlist_param_[0]*dp2cutoff) private_flat_nl.push_back(k);
     }
     #pragma omp critical
     local_flat_nl.insert(local_flat_nl.end(), private_flat_nl.begin(), private_flat_nl.end());
   }
   nlist_hills_ = local_flat_nl;
+  // keep the indices ordered so that the hills are read in the order in which they are stored
+  std::sort(nlist_hills_.begin(),nlist_hills_.end());
 
   // here we set some properties that are used to decide when to update it again
   for(unsigned i=0; i<getNumberOfArguments(); i++) nlist_center_[i]=getArgument(i);
@@ -2283,7 +2796,7 @@ void MetaD::updateNlist()
   {
     for(unsigned i=0; i<getNumberOfArguments(); i++)
     {
-      const double d=difference(i,getArgument(i),nlist_hills_[k].center[i]);
+      const double d=difference(i,getArgument(i),hills_[nlist_hills_[k]].center[i]);
       dev2[i]+=d*d;
     }
   }
@@ -2299,5 +2812,94 @@ void MetaD::updateNlist()
   nlist_update_=false;
 }
 
+void MetaD::writeCheckpoint(std::ostream&o)
+{
+  // Gaussians read from the files of the other walkers cannot be restored from a checkpoint
+  if(mw_n_>1) return;
+  checkpoint::write(o,isFirstStep_);
+  checkpoint::write(o,acc_);
+  checkpoint::write(o,work_);
+  checkpoint::write(o,max_bias_);
+  checkpoint::write(o,transition_bias_);
+  checkpoint::write(o,reweight_factor_);
+  checkpoint::write(o,current_stride_);
+  if(grid_) {
+    // only the points where the bias has been deposited are stored
+    const unsigned ncv=getNumberOfArguments();
+    std::vector<double> der(ncv);
+    Grid::index_t maxsize=1;
+    for(const auto n : BiasGrid_->getNbin()) maxsize*=n;
+    std::vector<Grid::index_t> indices;
+    std::vector<double> values;
+    for(Grid::index_t i=0; i<maxsize; ++i) {
+      double v=BiasGrid_->getValueAndDerivatives(i,der);
+      bool zero=(v==0.0);
+      for(unsigned j=0; j<ncv; ++j) if(der[j]!=0.0) zero=false;
+      if(zero) continue;
+      indices.push_back(i);
+      values.push_back(v);
+      values.insert(values.end(),der.begin(),der.end());
+    }
+    checkpoint::write(o,indices);
+    checkpoint::write(o,values);
+  } else {
+    checkpoint::write<std::size_t>(o,hills_.size());
+    for(const auto & h : hills_) {
+      checkpoint::write(o,h.multivariate);
+      checkpoint::write(o,h.height);
+      checkpoint::write(o,h.center);
+      checkpoint::write(o,h.sigma);
+    }
+  }
+}
+
+void MetaD::readCheckpoint(std::istream&i)
+{
+  if(mw_n_>1) error("checkpoints cannot be used with multiple walkers sharing files");
+  checkpoint::read(i,isFirstStep_);
+  checkpoint::read(i,acc_);
+  checkpoint::read(i,work_);
+  checkpoint::read(i,max_bias_);
+  checkpoint::read(i,transition_bias_);
+  checkpoint::read(i,reweight_factor_);
+  checkpoint::read(i,current_stride_);
+  if(grid_) {
+    const unsigned ncv=getNumberOfArguments();
+    std::vector<Grid::index_t> indices;
+    std::vector<double> values;
+    checkpoint::read(i,indices);
+    checkpoint::read(i,values);
+    if(values.size()!=indices.size()*(ncv+1)) error("grid in checkpoint does not match the input");
+    // the bias that might have been read from the HILLS files is replaced
+    std::vector<double> der(ncv,0.0);
+    Grid::index_t maxsize=1;
+    for(const auto n : BiasGrid_->getNbin()) maxsize*=n;
+    for(Grid::index_t k=0; k<maxsize; ++k) if(BiasGrid_->getValue(k)!=0.0) BiasGrid_->setValueAndDerivatives(k,0.0,der);
+    for(unsigned k=0; k<indices.size(); ++k) {
+      if(indices[k]>=maxsize) error("grid in checkpoint does not match the input");
+      for(unsigned j=0; j<ncv; ++j) der[j]=values[k*(ncv+1)+1+j];
+      BiasGrid_->setValueAndDerivatives(indices[k],values[k*(ncv+1)],der);
+    }
+  } else {
+    hills_.clear();
+    hills_arrays_.clear();
+    hills_arrays_valid_=true;
+    if(hills_cells_) hills_cells_grid_.clear();
+    std::size_t nhills;
+    checkpoint::read(i,nhills);
+    for(std::size_t k=0; k<nhills; ++k) {
+      bool multivariate;
+      double height;
+      std::vector<double> center, sigma;
+      checkpoint::read(i,multivariate);
+      checkpoint::read(i,height);
+      checkpoint::read(i,center);
+      checkpoint::read(i,sigma);
+      addGaussian(Gaussian(multivariate,height,center,sigma));
+    }
+  }
+  if(nlist_) nlist_update_=true;
+}
+
 }
 }
@@ -313,7 +313,10 @@ private:
   void   readGaussians(unsigned iarg, IFile*);
   void   writeGaussian(unsigned iarg, const Gaussian&, OFile*);
   void   addGaussian(unsigned iarg, const Gaussian&);
-  double getBiasAndDerivatives(unsigned iarg, const std::vector<double>&, double* der=NULL);
+  // add many hills at once, the grid stencils of all of them are split over threads and ranks
+  void   addGaussians(const std::vector<unsigned>& iargs, const std::vector<Gaussian>&);
+  // the bias (and derivative, if der is not NULL) of every CV, the CVs are split over threads and ranks
+  void   getAllBiases(const std::vector<double>& cv, std::vector<double>& bias, std::vector<double>* der=NULL);
   double evaluateGaussian(unsigned iarg, const std::vector<double>&, const Gaussian&,double* der=NULL);
   std::vector<unsigned> getGaussianSupport(unsigned iarg, const Gaussian&);
   bool   scanOneHill(unsigned iarg, IFile *ifile,  std::vector<Value> &v, std::vector<double> &center, std::vector<double>  &sigma, double &height, bool &multivariate);
@@ -933,39 +936,51 @@ void PBMetaD::writeGaussian(unsigned iarg, const Gaussian& hill, OFile *ofile)
 
 void PBMetaD::addGaussian(unsigned iarg, const Gaussian& hill)
 {
-  if(!grid_) {hills_[iarg].push_back(hill);}
-  else {
-    std::vector<unsigned> nneighb=getGaussianSupport(iarg, hill);
-    std::vector<Grid::index_t> neighbors=BiasGrids_[iarg]->getNeighbors(hill.center,nneighb);
-    std::vector<double> der(1);
+  addGaussians(std::vector<unsigned>(1,iarg),std::vector<Gaussian>(1,hill));
+}
+
+void PBMetaD::addGaussians(const std::vector<unsigned>& iargs, const std::vector<Gaussian>& hills)
+{
+  if(!grid_) {
+    for(unsigned k=0; k<hills.size(); ++k) hills_[iargs[k]].push_back(hills[k]);
+    return;
+  }
+  // the grid points touched by all the hills are flattened in a single list,
+  // so that the work is balanced even when the stencils have different sizes
+  std::vector<Grid::index_t> points;
+  std::vector<unsigned> owner;
+  for(unsigned k=0; k<hills.size(); ++k) {
+    std::vector<unsigned> nneighb=getGaussianSupport(iargs[k], hills[k]);
+    std::vector<Grid::index_t> neighbors=BiasGrids_[iargs[k]]->getNeighbors(hills[k].center,nneighb);
+    points.insert(points.end(),neighbors.begin(),neighbors.end());
+    owner.resize(points.size(),k);
+  }
+  const unsigned stride=comm.Get_size();
+  const unsigned rank=comm.Get_rank();
+  std::vector<double> allder(points.size(),0.0);
+  std::vector<double> allbias(points.size(),0.0);
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*stride*10>points.size()) nt=1;
+  #pragma omp parallel num_threads(nt)
+  {
     std::vector<double> xx(1);
-    if(comm.Get_size()==1) {
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        der[0]=0.0;
-        BiasGrids_[iarg]->getPoint(ineigh,xx);
-        double bias=evaluateGaussian(iarg,xx,hill,&der[0]);
-        BiasGrids_[iarg]->addValueAndDerivatives(ineigh,bias,der);
-      }
-    } else {
-      unsigned stride=comm.Get_size();
-      unsigned rank=comm.Get_rank();
-      std::vector<double> allder(neighbors.size(),0.0);
-      std::vector<double> allbias(neighbors.size(),0.0);
-      for(unsigned i=rank; i<neighbors.size(); i+=stride) {
-        Grid::index_t ineigh=neighbors[i];
-        BiasGrids_[iarg]->getPoint(ineigh,xx);
-        allbias[i]=evaluateGaussian(iarg,xx,hill,&allder[i]);
-      }
-      comm.Sum(allbias);
-      comm.Sum(allder);
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        der[0]=allder[i];
-        BiasGrids_[iarg]->addValueAndDerivatives(ineigh,allbias[i],der);
-      }
+    #pragma omp for
+    for(unsigned n=rank; n<points.size(); n+=stride) {
+      const unsigned k=owner[n];
+      BiasGrids_[iargs[k]]->getPoint(points[n],xx);
+      allbias[n]=evaluateGaussian(iargs[k],xx,hills[k],&allder[n]);
     }
   }
+  if(stride>1) {
+    comm.Sum(allbias);
+    comm.Sum(allder);
+  }
+  // hills of the same family share the grid, so they are added serially
+  std::vector<double> der(1);
+  for(unsigned n=0; n<points.size(); ++n) {
+    der[0]=allder[n];
+    BiasGrids_[iargs[owner[n]]]->addValueAndDerivatives(points[n],allbias[n],der);
+  }
 }
 
 std::vector<unsigned> PBMetaD::getGaussianSupport(unsigned iarg, const Gaussian& hill)
@@ -994,29 +1009,51 @@ std::vector<unsigned> PBMetaD::getGaussianSupport(unsigned iarg, const Gaussian&
   return nneigh;
 }
 
-double PBMetaD::getBiasAndDerivatives(unsigned iarg, const std::vector<double>& cv, double* der)
+void PBMetaD::getAllBiases(const std::vector<double>& cv, std::vector<double>& bias, std::vector<double>* der)
 {
-  double bias=0.0;
-  int family = pfs_[iarg];
+  const unsigned ncv=getNumberOfArguments();
+  const unsigned stride=comm.Get_size();
+  const unsigned rank=comm.Get_rank();
+  bias.assign(ncv,0.0);
+  if(der) der->assign(ncv,0.0);
+  double* pder=(der ? der->data() : NULL);
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt>ncv) nt=ncv;
   if(!grid_) {
-    unsigned stride=comm.Get_size();
-    unsigned rank=comm.Get_rank();
-    for(unsigned i=rank; i<hills_[family].size(); i+=stride) {
-      bias += evaluateGaussian(iarg,cv,hills_[family][i],der);
+    // the hills of each CV are split over the ranks, so that the load is balanced
+    // even if the families have different numbers of hills, and the CVs over the threads
+    #pragma omp parallel num_threads(nt)
+    {
+      std::vector<double> x(1);
+      #pragma omp for schedule(dynamic)
+      for(unsigned i=0; i<ncv; ++i) {
+        const std::vector<Gaussian>& hills=hills_[pfs_[i]];
+        x[0]=cv[i];
+        for(unsigned k=rank; k<hills.size(); k+=stride) bias[i]+=evaluateGaussian(i,x,hills[k],(pder ? pder+i : NULL));
+      }
     }
-    comm.Sum(bias);
-    if(der) comm.Sum(der,1);
   } else {
-    if(der) {
-      std::vector<double> vder(1);
-      bias = BiasGrids_[family]->getValueAndDerivatives(cv,vder);
-      der[0] = vder[0];
-    } else {
-      bias = BiasGrids_[family]->getValue(cv);
+    // each rank interpolates its own subset of CVs
+    #pragma omp parallel num_threads(nt)
+    {
+      std::vector<double> x(1), vder(1);
+      #pragma omp for
+      for(unsigned i=rank; i<ncv; i+=stride) {
+        x[0]=cv[i];
+        if(pder) {
+          bias[i]=BiasGrids_[pfs_[i]]->getValueAndDerivatives(x,vder);
+          pder[i]=vder[0];
+        } else {
+          bias[i]=BiasGrids_[pfs_[i]]->getValue(x);
+        }
+      }
     }
   }
-
-  return bias;
+  // a single reduction for all the CVs
+  if(stride>1) {
+    comm.Sum(bias);
+    if(der) comm.Sum(*der);
+  }
 }
 
 double PBMetaD::evaluateGaussian(unsigned iarg, const std::vector<double>& cv, const Gaussian& hill, double* der)
@@ -1066,18 +1103,15 @@ void PBMetaD::calculate()
   // on adaptive hills (diff) after exchanges:
   if(adaptive_==FlexibleBin::diffusion && getExchangeStep()) error("ADAPTIVE=DIFF is not compatible with replica exchange");
 
-  std::vector<double> cv(1);
-  double der[1];
+  std::vector<double> cv(getNumberOfArguments());
   std::vector<double> bias(getNumberOfArguments());
   std::vector<double> deriv(getNumberOfArguments());
 
   double ncv = (double) getNumberOfArguments();
   double bmin = 1.0e+19;
+  for(unsigned i=0; i<getNumberOfArguments(); ++i) cv[i] = getArgument(i);
+  getAllBiases(cv, bias, &deriv);
   for(unsigned i=0; i<getNumberOfArguments(); ++i) {
-    cv[0]    = getArgument(i);
-    der[0]   = 0.0;
-    bias[i]  = getBiasAndDerivatives(i, cv, der);
-    deriv[i] = der[0];
     if(bias[i] < bmin) bmin = bias[i];
   }
   double ene = 0.;
@@ -1139,8 +1173,9 @@ void PBMetaD::update()
       if(adaptive_!=FlexibleBin::none) thissigma[i]=flexbin_[family].getInverseMatrix(i)[0];
       else thissigma[i]=sigma0_[family];
       cv[i]     = getArgument(i);
-      cv_tmp[0] = getArgument(i);
-      bias[i] = getBiasAndDerivatives(i, cv_tmp);
+    }
+    getAllBiases(cv, bias);
+    for(unsigned i=0; i<getNumberOfArguments(); ++i) {
       if(bias[i] < bmin) bmin = bias[i];
     }
     // calculate heights and norm
@@ -1178,7 +1213,9 @@ void PBMetaD::update()
       comm.Sum(&all_cv[0], all_cv.size());
       comm.Sum(&all_sigma[0], all_sigma.size());
       comm.Sum(&all_height[0], all_height.size());
-      // now add hills one by one
+      // now add all the hills together
+      std::vector<unsigned> families;
+      std::vector<Gaussian> newhills;
       for(unsigned j=0; j<mpi_nw_; ++j) {
         for(unsigned i=0; i<getNumberOfArguments(); ++i) {
           // Add CVs of same family together and write to same file
@@ -1186,23 +1223,27 @@ void PBMetaD::update()
           cv_tmp[0]    = all_cv[j*cv.size()+i];
           double height_tmp = all_height[j*cv.size()+i];
           sigma_tmp[0] = all_sigma[j*cv.size()+i];
-          Gaussian newhill = Gaussian(cv_tmp, sigma_tmp, height_tmp, multivariate);
-          addGaussian(family, newhill);
-          writeGaussian(i, newhill, hillsOfiles_[family].get());
+          newhills.push_back(Gaussian(cv_tmp, sigma_tmp, height_tmp, multivariate));
+          families.push_back(family);
+          writeGaussian(i, newhills.back(), hillsOfiles_[family].get());
         }
       }
+      addGaussians(families, newhills);
       // just add your own hills
     } else {
+      std::vector<unsigned> families;
+      std::vector<Gaussian> newhills;
       for(unsigned i=0; i<getNumberOfArguments(); ++i) {
         // Add CVs of same family together and write to same file
         int family = pfs_[i];
         cv_tmp[0] = cv[i];
         if(adaptive_!=FlexibleBin::none) sigma_tmp[0]=thissigma[i];
         else sigma_tmp[0] = sigma0_[family];
-        Gaussian newhill = Gaussian(cv_tmp, sigma_tmp, height[i], multivariate);
-        addGaussian(family, newhill);
-        writeGaussian(i, newhill, hillsOfiles_[family].get());
+        newhills.push_back(Gaussian(cv_tmp, sigma_tmp, height[i], multivariate));
+        families.push_back(family);
+        writeGaussian(i, newhills.back(), hillsOfiles_[family].get());
       }
+      addGaussians(families, newhills);
     }
   }
 
@@ -74,6 +74,8 @@ public:
   explicit Restraint(const ActionOptions&);
   void calculate() override;
   static void registerKeywords(Keywords& keys);
+  bool canComputeBiasFromArguments() const override { return true; }
+  double computeBiasFromArguments( const std::vector<double>& args ) override;
 };
 
 PLUMED_REGISTER_ACTION(Restraint,"RESTRAINT_SCALAR")
@@ -129,6 +131,15 @@ void Restraint::calculate() {
   valueForce2->set(totf2);
 }
 
+double Restraint::computeBiasFromArguments( const std::vector<double>& args ) {
+  double ene=0.0;
+  for(unsigned i=0; i<getNumberOfArguments(); ++i) {
+    const double cv=difference(i,at[i],args[i]);
+    ene+=0.5*kappa[i]*cv*cv+slope[i]*cv;
+  }
+  return ene;
+}
+
 }
 
 
@@ -30,6 +30,8 @@
 #include "tools/DLLoader.h"
 #include "tools/Random.h"
 
+#include <array>
+#include <cmath>
 #include <cstdio>
 #include <string>
 #include <vector>
@@ -156,6 +158,72 @@ instances will be done, showing the ratio between the total time and the time me
 instance, which will act as a reference. Errors will be estimated with bootstrapping. The warm-up phase will be discarded for
 this analysis.
 
+\par Atom distributions
+
+Besides the simple synthetic layouts (`line`, `cube`, `sphere`, `globs` and `sc`), `--atom-distribution`
+offers generators that reproduce the neighbor counts of condensed phases, which are important
+when benchmarking \ref COORDINATION, \ref Q6 or contact matrices:
+- `water`: bulk water at liquid density, with molecules (O, H, H) on a jittered lattice and randomly oriented.
+- `slab`: the same water in the middle of a box three times longer along z, with two interfaces.
+- `droplets`: eight spherical water droplets separated by vacuum.
+- `replay`: the frames of the xyz file given with `--trajectory` are used in turn. The second line of each frame
+  can contain the box (3 or 9 numbers), as in the files written with `--dump-trajectory`.
+  The whole file is read before starting, so that reading it is not timed.
+
+\par Scaling sweeps
+
+To size a deployment, the same input can be run over several numbers of atoms, OpenMP threads
+and MPI ranks using the `--sweep-natoms`, `--sweep-threads` and `--sweep-ranks` options, which take
+colon separated lists:
+
+\verbatim
+mpirun -np 4 plumed-runtime benchmark --sweep-natoms 1000:10000:100000 --sweep-threads 1:2:4 --sweep-ranks 1:2:4 --report sweep.csv
+\endverbatim
+
+Every configuration is run on a new plumed instance for `--nsteps` steps, with the atoms generated by `--atom-distribution`.
+Runs with fewer ranks than the available MPI processes use a subset of them, and runs with more than one rank emulate domain
+decomposition as with `--domain-decomposition`. The log of the plumed instances is discarded and `--sleep` is ignored.
+The wall time per step of the slowest rank is averaged after the warm-up phase (first 20% of the steps).
+For each instance, the strong scaling efficiency is computed with respect to the run with the same number of atoms
+and the fewest workers (threads times ranks), and the weak scaling efficiency with respect to the run with the same
+number of atoms per worker and the fewest workers. With `--report` the table is also written in CSV or JSON format,
+ready to be plotted.
+
+\par Domain decomposition communication
+
+When PLUMED runs inside a large MD simulation, every step the atoms it needs are gathered from the ranks
+that own them. The cost of this data passing can be measured in isolation with `--dd-fractions`,
+which takes a colon separated list of fractions of the atoms that are requested:
+
+\verbatim
+mpirun -np 8 plumed-runtime benchmark --natoms 1000000 --dd-fractions 0.001:0.01:0.1:1 --sweep-ranks 2:4:8 --report dd.csv
+\endverbatim
+
+For each fraction and each number of ranks in `--sweep-ranks` (all the processes by default) a new instance of the
+first kernel is run with atoms shuffled among the ranks and a trivial input (a restraint on the center of mass of the
+requested atoms), so that the time of the calculation is negligible. The time spent gathering the atoms and the time spent
+calculating and applying the forces are reported per step, with their minimum, mean and maximum over the ranks, together with
+the estimated number of bytes received by each rank. The `--plumed` files are not used in this mode.
+
+\par Per-action timings
+
+With `--detailed-timers` the time spent by each action in its calculate and apply
+methods is collected at every step, as done by \ref DEBUG `DETAILED_TIMERS`.
+After the warm-up phase, the average time per step with its 95% confidence interval
+is reported for each action, with the instances shown side by side.
+Kernels that do not provide per-action timings are skipped in this report.
+
+The results can also be saved in a machine readable format, useful to keep
+track of the performance in a continuous integration setup:
+
+\verbatim
+plumed-runtime benchmark --kernel /path/to/lib/libplumedKernel.so:this --detailed-timers --report timings.json
+\endverbatim
+
+The format is JSON if the file name ends with `.json` and CSV otherwise.
+The report contains the comparative timings of the instances and, when available,
+the per-action timings in microseconds.
+
 */
 //+ENDPLUMEDOC
 
@@ -212,6 +280,12 @@ struct KernelBase {
   std::vector<long long int> timings;
   double comparative_timing=-1.0;
   double comparative_timing_error=-1.0;
+  /// true if the kernel provides per-action timings
+  bool detailedTimers=false;
+  /// labels of the actions, in the order used by the kernel
+  std::vector<std::string> actionLabels;
+  /// for each step, time spent in calculate and apply by each action
+  std::vector<std::vector<long long int>> actionTimings;
   KernelBase(const std::string & path_,const std::string & plumed_dat_, Log* log_):
     path(path_),
     plumed_dat(plumed_dat_),
@@ -222,6 +296,27 @@ struct KernelBase {
   stopwatch(*log_)
   {
   }
+  /// Retrieve the list of actions from the kernel
+  void retrieveActionLabels() {
+    int length=0;
+    handle.cmd("getActionLabelsLength",&length);
+    std::vector<char> buffer(length);
+    handle.cmd("getActionLabels",buffer.data(), {buffer.size()});
+    actionLabels.clear();
+    std::string_view labels(buffer.data());
+    for(std::size_t start=0; start<labels.length();) {
+      auto end=labels.find('\n',start);
+      if(end==std::string_view::npos) end=labels.length();
+      actionLabels.emplace_back(labels.substr(start,end-start));
+      start=end+1;
+    }
+  }
+  /// Store the per-action timings of the last step
+  void collectActionTimings() {
+    std::vector<long long int> t(2*actionLabels.size());
+    handle.cmd("getActionTimings",t.data(), {actionLabels.size(),2});
+    actionTimings.push_back(std::move(t));
+  }
 };
 
 /// Local structure handling a kernel and the related timers.
@@ -265,6 +360,135 @@ struct Kernel :
   }
 };
 
+/// Mean and 95% confidence interval of a set of timings, in microseconds
+std::pair<double,double> timingStatistics(const std::vector<std::vector<long long int>> & timings,unsigned column) {
+  const auto n=timings.size();
+  if(n==0) return {0.0,0.0};
+  double sum=0.0;
+  double sum2=0.0;
+  for(const auto & t : timings) {
+    const double x=t[column]*1e-3;
+    sum+=x;
+    sum2+=x*x;
+  }
+  const double mean=sum/n;
+  if(n<2) return {mean,0.0};
+  const double var=std::max(0.0,(sum2-n*mean*mean)/(n-1));
+  return {mean,1.96*std::sqrt(var/n)};
+}
+
+/// Escape a string so that it can be written in a JSON file
+std::string jsonString(const std::string & str) {
+  std::string ret="\"";
+  for(auto c : str) {
+    if(c=='"' || c=='\\') ret+='\\';
+    ret+=c;
+  }
+  return ret+"\"";
+}
+
+/// Quote a string so that it can be written in a CSV file
+std::string csvString(const std::string & str) {
+  std::string ret="\"";
+  for(auto c : str) {
+    if(c=='"') ret+='"';
+    ret+=c;
+  }
+  return ret+"\"";
+}
+
+/// Report the per-action timings side by side and optionally write them on a file.
+/// Kernels are stored in reverse order
+void reportActionTimings(const std::vector<Kernel> & kernels,Log & log,const std::string & reportFile) {
+  std::vector<const Kernel*> ordered;
+  for(auto it=kernels.rbegin(); it!=kernels.rend(); ++it) ordered.push_back(&(*it));
+
+  // union of the labels, in the order in which they appear
+  std::vector<std::string> labels;
+  bool anyDetailed=false;
+  for(const auto k : ordered) {
+    if(!k->detailedTimers || k->actionTimings.empty()) continue;
+    anyDetailed=true;
+    for(const auto & l : k->actionLabels) if(std::find(labels.begin(),labels.end(),l)==labels.end()) labels.push_back(l);
+  }
+
+  if(anyDetailed) {
+    log<<"Per-action timings (microseconds per step, mean +- 95% confidence interval)\n";
+    std::size_t width=6;
+    for(const auto & l : labels) width=std::max(width,l.length());
+    std::string header=std::string(width,' ');
+    for(unsigned i=0; i<ordered.size(); i++) {
+      char buffer[128];
+      std::snprintf(buffer,sizeof(buffer)," | %-23s %-23s",("calculate ("+std::to_string(i)+")").c_str(),("apply ("+std::to_string(i)+")").c_str());
+      header+=buffer;
+    }
+    log<<header<<"\n";
+    for(const auto & l : labels) {
+      std::string line=l+std::string(width-l.length(),' ');
+      for(const auto k : ordered) {
+        auto it=std::find(k->actionLabels.begin(),k->actionLabels.end(),l);
+        char buffer[128];
+        if(!k->detailedTimers || k->actionTimings.empty() || it==k->actionLabels.end()) {
+          std::snprintf(buffer,sizeof(buffer)," | %-23s %-23s","-","-");
+        } else {
+          const unsigned j=it-k->actionLabels.begin();
+          auto calc=timingStatistics(k->actionTimings,2*j);
+          auto apply=timingStatistics(k->actionTimings,2*j+1);
+          std::snprintf(buffer,sizeof(buffer)," | %10.3f +- %-9.3f %10.3f +- %-9.3f",calc.first,calc.second,apply.first,apply.second);
+        }
+        line+=buffer;
+      }
+      log<<line<<"\n";
+    }
+  }
+
+  if(reportFile.empty()) return;
+  const bool json=reportFile.length()>=5 && reportFile.substr(reportFile.length()-5)==".json";
+  std::ofstream ofile(reportFile);
+  plumed_massert(ofile,"cannot open report file " + reportFile);
+  char buffer[256];
+  if(json) {
+    ofile<<"{\n  \"kernels\": [";
+    for(unsigned i=0; i<ordered.size(); i++) {
+      const auto k=ordered[i];
+      ofile<<(i>0?",":"")<<"\n    {\n";
+      ofile<<"      \"kernel\": "<<jsonString(k->path)<<",\n";
+      ofile<<"      \"plumed\": "<<jsonString(k->plumed_dat)<<",\n";
+      std::snprintf(buffer,sizeof(buffer),"      \"comparative\": %.6f,\n      \"comparative_error\": %.6f,\n",k->comparative_timing,k->comparative_timing_error);
+      ofile<<buffer;
+      ofile<<"      \"actions\": [";
+      if(k->detailedTimers) for(unsigned j=0; j<k->actionLabels.size() && !k->actionTimings.empty(); j++) {
+          auto calc=timingStatistics(k->actionTimings,2*j);
+          auto apply=timingStatistics(k->actionTimings,2*j+1);
+          ofile<<(j>0?",":"")<<"\n        {\"label\": "<<jsonString(k->actionLabels[j]);
+          std::snprintf(buffer,sizeof(buffer),", \"calculate_us\": %.6f, \"calculate_ci_us\": %.6f, \"apply_us\": %.6f, \"apply_ci_us\": %.6f, \"samples\": %zu}",
+                        calc.first,calc.second,apply.first,apply.second,k->actionTimings.size());
+          ofile<<buffer;
+        }
+      ofile<<"\n      ]\n    }";
+    }
+    ofile<<"\n  ]\n}\n";
+  } else {
+    ofile<<"instance,kernel,plumed,comparative,comparative_error,label,calculate_us,calculate_ci_us,apply_us,apply_ci_us,samples\n";
+    for(unsigned i=0; i<ordered.size(); i++) {
+      const auto k=ordered[i];
+      std::snprintf(buffer,sizeof(buffer),"%.6f,%.6f",k->comparative_timing,k->comparative_timing_error);
+      const std::string prefix=std::to_string(i)+","+csvString(k->path)+","+csvString(k->plumed_dat)+","+buffer;
+      if(!k->detailedTimers || k->actionTimings.empty()) {
+        ofile<<prefix<<",,,,,,\n";
+        continue;
+      }
+      for(unsigned j=0; j<k->actionLabels.size(); j++) {
+        auto calc=timingStatistics(k->actionTimings,2*j);
+        auto apply=timingStatistics(k->actionTimings,2*j+1);
+        std::snprintf(buffer,sizeof(buffer),",%.6f,%.6f,%.6f,%.6f,%zu",calc.first,calc.second,apply.first,apply.second,k->actionTimings.size());
+        ofile<<prefix<<","<<csvString(k->actionLabels[j])<<buffer<<"\n";
+      }
+    }
+  }
+  log<<"Report written on "<<reportFile<<"\n";
+}
+
 namespace  {
 
 class UniformSphericalVector {
@@ -414,7 +638,173 @@ struct tiledSimpleCubic:public AtomDistribution {
 
   }
 };
-std::unique_ptr<AtomDistribution> getAtomDistribution(std::string_view atomicDistr) {
+/// Lattice spacing (nm) giving the density of liquid water, about 33.4 molecules per nm^3
+constexpr double waterSpacing=0.3104;
+
+/// Place water molecules (O,H,H) on the given sites, with a small jitter and a random orientation.
+/// If the number of atoms is not a multiple of three the last molecule is truncated
+void placeWater(std::vector<Vector>& posToUpdate,const std::vector<Vector>& sites,Random& rng) {
+  constexpr double bond=0.09572;
+  const double angle=104.52*PLMD::pi/180.0;
+  constexpr double jitter=0.03;
+  const auto nat=posToUpdate.size();
+  for(unsigned i=0; 3*i<nat; ++i) {
+    const Vector o=sites[i]+jitter*Vector(rng.RandU01()-0.5,rng.RandU01()-0.5,rng.RandU01()-0.5);
+    posToUpdate[3*i]=o;
+    // random orientation of the molecular plane
+    Vector u,w;
+    do {
+      u=Vector(rng.RandU01()-0.5,rng.RandU01()-0.5,rng.RandU01()-0.5);
+    } while(modulo2(u)<1e-4);
+    u/=modulo(u);
+    do {
+      w=crossProduct(u,Vector(rng.RandU01()-0.5,rng.RandU01()-0.5,rng.RandU01()-0.5));
+    } while(modulo2(w)<1e-4);
+    w/=modulo(w);
+    if(3*i+1<nat) posToUpdate[3*i+1]=o+bond*u;
+    if(3*i+2<nat) posToUpdate[3*i+2]=o+bond*(std::cos(angle)*u+std::sin(angle)*w);
+  }
+}
+
+/// Sites of a simple cubic lattice with n points per side
+std::vector<Vector> waterLattice(unsigned nmol,unsigned n,const Vector & origin) {
+  std::vector<Vector> sites;
+  sites.reserve(nmol);
+  for (unsigned k=0; k<n && sites.size()<nmol; ++k) {
+    for (unsigned j=0; j<n && sites.size()<nmol; ++j) {
+      for (unsigned i=0; i<n && sites.size()<nmol; ++i) {
+        sites.push_back(origin+waterSpacing*Vector(i+0.5,j+0.5,k+0.5));
+      }
+    }
+  }
+  return sites;
+}
+
+unsigned waterMolecules(unsigned natoms) {
+  return (natoms+2)/3;
+}
+
+unsigned waterLatticeSide(unsigned natoms) {
+  return std::ceil(std::cbrt(static_cast<double>(waterMolecules(natoms))));
+}
+
+/// Bulk water at liquid density, in a cubic box
+struct bulkWater:public AtomDistribution {
+  void positions(std::vector<Vector>& posToUpdate, unsigned /*step*/, Random& rng) override {
+    const auto nat=posToUpdate.size();
+    placeWater(posToUpdate,waterLattice(waterMolecules(nat),waterLatticeSide(nat),Vector(0,0,0)),rng);
+  }
+  void box(std::vector<double>& box, unsigned natoms, unsigned /*step*/, Random&) override {
+    const double rmax=waterSpacing*waterLatticeSide(natoms);
+    box[0]=rmax; box[1]=0.0;  box[2]=0.0;
+    box[3]=0.0;  box[4]=rmax; box[5]=0.0;
+    box[6]=0.0;  box[7]=0.0;  box[8]=rmax;
+  }
+};
+
+/// A slab of water in the middle of a box three times as long along z,
+/// with two liquid/vapour interfaces
+struct waterSlab:public AtomDistribution {
+  void positions(std::vector<Vector>& posToUpdate, unsigned /*step*/, Random& rng) override {
+    const auto nat=posToUpdate.size();
+    const auto n=waterLatticeSide(nat);
+    placeWater(posToUpdate,waterLattice(waterMolecules(nat),n,Vector(0,0,waterSpacing*n)),rng);
+  }
+  void box(std::vector<double>& box, unsigned natoms, unsigned /*step*/, Random&) override {
+    const double rmax=waterSpacing*waterLatticeSide(natoms);
+    box[0]=rmax; box[1]=0.0;  box[2]=0.0;
+    box[3]=0.0;  box[4]=rmax; box[5]=0.0;
+    box[6]=0.0;  box[7]=0.0;  box[8]=3.0*rmax;
+  }
+};
+
+/// Eight spherical droplets of water, separated by vacuum
+struct waterDroplets:public AtomDistribution {
+  static constexpr unsigned ndroplets=8;
+  /// Lattice sites of a single droplet, ordered by distance from its center
+  std::vector<Vector> droplet;
+  double spacing=0.0;
+  void setup(unsigned natoms) {
+    const unsigned nmol=(waterMolecules(natoms)+ndroplets-1)/ndroplets;
+    if(droplet.size()==nmol) return;
+    const unsigned n=std::ceil(std::cbrt(6.0*nmol/PLMD::pi))+2;
+    auto sites=waterLattice(n*n*n,n,Vector(-0.5*waterSpacing*n,-0.5*waterSpacing*n,-0.5*waterSpacing*n));
+    std::stable_sort(sites.begin(),sites.end(),[](const Vector & a,const Vector & b) {return modulo2(a)<modulo2(b);});
+    sites.resize(nmol);
+    droplet=sites;
+    // droplets are separated by at least 1 nm
+    spacing=2.0*(sites.empty()?0.0:modulo(sites.back()))+waterSpacing+1.0;
+  }
+  void positions(std::vector<Vector>& posToUpdate, unsigned /*step*/, Random& rng) override {
+    setup(posToUpdate.size());
+    std::vector<Vector> sites;
+    sites.reserve(ndroplets*droplet.size());
+    for(unsigned d=0; d<ndroplets; d++) {
+      const Vector center=spacing*Vector((d&1)+0.5,((d>>1)&1)+0.5,((d>>2)&1)+0.5);
+      for(const auto & s : droplet) sites.push_back(center+s);
+    }
+    placeWater(posToUpdate,sites,rng);
+  }
+  void box(std::vector<double>& box, unsigned natoms, unsigned /*step*/, Random&) override {
+    setup(natoms);
+    const double rmax=2.0*spacing;
+    box[0]=rmax; box[1]=0.0;  box[2]=0.0;
+    box[3]=0.0;  box[4]=rmax; box[5]=0.0;
+    box[6]=0.0;  box[7]=0.0;  box[8]=rmax;
+  }
+};
+
+/// Replay the frames of a xyz trajectory, cycling over them.
+/// The second line of each frame might contain the box (3 or 9 numbers).
+/// Frames are all read at construction so that reading the file is not timed
+struct replayTrajectory:public AtomDistribution {
+  std::vector<std::vector<Vector>> frames;
+  std::vector<std::vector<double>> boxes;
+  explicit replayTrajectory(const std::string & filename) {
+    std::ifstream ifile(filename);
+    plumed_massert(ifile,"cannot open trajectory file " + filename);
+    std::string line;
+    while(std::getline(ifile,line)) {
+      unsigned nat;
+      if(Tools::getWords(line).empty()) continue;
+      plumed_massert(Tools::convertNoexcept(Tools::getWords(line)[0],nat),"wrong number of atoms in trajectory file " + filename);
+      plumed_massert(std::getline(ifile,line),"truncated trajectory file " + filename);
+      std::vector<double> cell(9,0.0);
+      auto words=Tools::getWords(line);
+      std::vector<double> values;
+      for(const auto & w : words) {
+        double v;
+        if(!Tools::convertNoexcept(w,v)) break;
+        values.push_back(v);
+      }
+      if(values.size()==3) {
+        cell[0]=values[0]; cell[4]=values[1]; cell[8]=values[2];
+      } else if(values.size()==9) {
+        cell=values;
+      }
+      std::vector<Vector> pos(nat);
+      for(unsigned i=0; i<nat; i++) {
+        plumed_massert(std::getline(ifile,line),"truncated trajectory file " + filename);
+        words=Tools::getWords(line);
+        plumed_massert(words.size()>=4,"wrong atom line in trajectory file " + filename);
+        for(unsigned j=0; j<3; j++) Tools::convert(words[j+1],pos[i][j]);
+      }
+      frames.push_back(std::move(pos));
+      boxes.push_back(std::move(cell));
+    }
+    plumed_massert(!frames.empty(),"no frames found in trajectory file " + filename);
+  }
+  void positions(std::vector<Vector>& posToUpdate, unsigned step, Random&) override {
+    const auto & frame=frames[step%frames.size()];
+    plumed_massert(posToUpdate.size()<=frame.size(),"the trajectory contains fewer atoms than --natoms");
+    std::copy(frame.begin(),frame.begin()+posToUpdate.size(),posToUpdate.begin());
+  }
+  void box(std::vector<double>& box, unsigned /*natoms*/, unsigned step, Random&) override {
+    box=boxes[step%boxes.size()];
+  }
+};
+
+std::unique_ptr<AtomDistribution> getAtomDistribution(std::string_view atomicDistr,const std::string & trajectory) {
   std::unique_ptr<AtomDistribution> distribution;
   if(atomicDistr == "line") {
     distribution = std::make_unique<theLine>();
@@ -426,13 +816,358 @@ std::unique_ptr<AtomDistribution> getAtomDistribution(std::string_view atomicDis
     distribution = std::make_unique<twoGlobs>();
   } else if (atomicDistr == "sc") {
     distribution = std::make_unique<tiledSimpleCubic>();
+  } else if (atomicDistr == "water") {
+    distribution = std::make_unique<bulkWater>();
+  } else if (atomicDistr == "slab") {
+    distribution = std::make_unique<waterSlab>();
+  } else if (atomicDistr == "droplets") {
+    distribution = std::make_unique<waterDroplets>();
+  } else if (atomicDistr == "replay") {
+    plumed_massert(trajectory.length()>0,"the replay atomic distribution requires --trajectory");
+    distribution = std::make_unique<replayTrajectory>(trajectory);
   } else {
-    plumed_error() << R"(The atomic distribution can be only "line", "cube", "sphere", "globs" and "sc", the input was ")"
+    plumed_error() << R"(The atomic distribution can be only "line", "cube", "sphere", "globs", "sc", "water", "slab", "droplets" and "replay", the input was ")"
                    << atomicDistr <<'"';
   }
   return distribution;
 }
 } //anonymus namespace for benchmark distributions
+
+/// Atoms handled by a rank when emulating domain decomposition
+struct LocalAtoms {
+  int shift=0;
+  int n=0;
+};
+
+LocalAtoms getLocalAtoms(unsigned natoms,int nproc,int myrank) {
+  LocalAtoms local;
+  const int nn=natoms/nproc;
+  //using int to remove warning, MPI don't work with unsigned
+  int excess=natoms%nproc;
+  local.n=nn;
+  if(myrank<excess) local.n+=1;
+  for(int i=0; i<myrank; i++) {
+    local.shift+=nn;
+    if(i<excess) local.shift+=1;
+  }
+  return local;
+}
+
+/// A single configuration of a scaling sweep
+struct SweepPoint {
+  unsigned instance=0;
+  std::string kernel;
+  std::string plumed_dat;
+  unsigned natoms=0;
+  /// zero means that the default number of threads is used
+  unsigned threads=0;
+  unsigned ranks=1;
+  /// wall time per step in seconds, with its 95% confidence interval
+  double time=0.0;
+  double error=0.0;
+  unsigned workers() const {
+    return std::max(threads,1U)*ranks;
+  }
+};
+
+/// Run a configuration of a scaling sweep on a fresh plumed instance.
+/// Returns the wall time of the steps after the warm-up, taking the slowest rank at each step
+std::vector<double> runSweepPoint(const SweepPoint & point,Communicator & comm,bool domain_decomposition,bool shuffled,
+                                  AtomDistribution & distribution,int nsteps,FILE* plumedLog) {
+  // deterministic initializations to avoid issues with MPI
+  generator rng;
+  PLMD::Random atomicGenerator;
+  const unsigned natoms=point.natoms;
+  PlumedHandle p=(point.kernel=="this"?PlumedHandle():PlumedHandle::dlopen(point.kernel.c_str()));
+  if(Communicator::plumedHasMPI() && domain_decomposition) p.cmd("setMPIComm",&comm.Get_comm());
+  p.cmd("setRealPrecision",(int)sizeof(double));
+  p.cmd("setMDLengthUnits",1.0);
+  p.cmd("setMDChargeUnits",1.0);
+  p.cmd("setMDMassUnits",1.0);
+  p.cmd("setMDEngine","benchmarks");
+  p.cmd("setTimestep",1.0);
+  p.cmd("setPlumedDat",point.plumed_dat.c_str());
+  p.cmd("setLog",plumedLog);
+  p.cmd("setNatoms",natoms);
+  if(point.threads>0) p.cmd("setNumOMPthreads",point.threads);
+  p.cmd("init");
+
+  std::vector<double> cell( 9 ), virial( 9 );
+  std::vector<Vector> pos( natoms ), forces( natoms );
+  std::vector<double> masses( natoms, 1 ), charges( natoms, 0 );
+  std::vector<int> shuffled_indexes;
+  if(shuffled) {
+    shuffled_indexes.resize(natoms);
+    for(unsigned i=0; i<natoms; i++) shuffled_indexes[i]=i;
+    std::shuffle(shuffled_indexes.begin(),shuffled_indexes.end(),rng);
+  }
+  LocalAtoms local;
+  if(domain_decomposition) local=getLocalAtoms(natoms,comm.Get_size(),comm.Get_rank());
+  else local.n=natoms;
+
+  int plumedStopCondition=0;
+  std::vector<double> times;
+  for(int step=0; step<nsteps; ++step) {
+    distribution.positions(pos,step,atomicGenerator);
+    distribution.box(cell,natoms,step,atomicGenerator);
+    comm.Barrier();
+    const auto start=std::chrono::high_resolution_clock::now();
+    p.cmd("setStep",step);
+    p.cmd("setStopFlag",&plumedStopCondition);
+    p.cmd("setForces",&forces[local.shift][0], {local.n,3});
+    p.cmd("setBox",&cell[0], {3,3});
+    p.cmd("setVirial",&virial[0], {3,3});
+    p.cmd("setPositions",&pos[local.shift][0], {local.n,3});
+    p.cmd("setMasses",&masses[local.shift], {local.n});
+    p.cmd("setCharges",&charges[local.shift], {local.n});
+    if(shuffled) {
+      p.cmd("setAtomsNlocal",local.n);
+      p.cmd("setAtomsGatindex",shuffled_indexes.data()+local.shift, {local.n});
+    }
+    p.cmd("prepareCalc");
+    p.cmd("performCalc");
+    double elapsed=std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-start).count();
+    comm.Max(elapsed);
+    // the first 20% of the steps is the warm-up
+    if(step>=nsteps/5) times.push_back(elapsed);
+    if(plumedStopCondition) break;
+  }
+  return times;
+}
+
+/// Run all the configurations of a scaling sweep and report
+/// the strong and weak scaling efficiencies
+void scalingSweep(std::vector<SweepPoint> & points,Communicator & pc,bool domain_decomposition,bool shuffled,
+                  AtomDistribution & distribution,int nsteps,FILE* plumedLog,Log & log,const std::string & reportFile) {
+  // configurations are grouped by number of ranks, so that the communicator is split only once per group
+  std::stable_sort(points.begin(),points.end(),[](const SweepPoint & a,const SweepPoint & b) {return a.ranks<b.ranks;});
+  std::size_t first=0;
+  while(first<points.size()) {
+    const unsigned ranks=points[first].ranks;
+    std::size_t last=first;
+    while(last<points.size() && points[last].ranks==ranks) last++;
+    Communicator sub;
+    const bool active=(unsigned(pc.Get_rank())<ranks);
+    if(pc.Get_size()>1) pc.Split((active?0:1),pc.Get_rank(),sub);
+    for(auto i=first; i<last; i++) {
+      auto & point(points[i]);
+      if(active) {
+        log.printf("Running instance %u with %u atoms, %u threads, %u ranks\n",point.instance,point.natoms,point.threads,point.ranks);
+        auto times=runSweepPoint(point,sub,domain_decomposition || ranks>1,shuffled || ranks>1,distribution,nsteps,plumedLog);
+        double sum=0.0;
+        double sum2=0.0;
+        for(auto t : times) {
+          sum+=t;
+          sum2+=t*t;
+        }
+        const auto n=times.size();
+        if(n>0) point.time=sum/n;
+        if(n>1) point.error=1.96*std::sqrt(std::max(0.0,(sum2-n*point.time*point.time)/(n-1))/n);
+      }
+      pc.Barrier();
+    }
+    first=last;
+  }
+  std::stable_sort(points.begin(),points.end(),[](const SweepPoint & a,const SweepPoint & b) {
+    if(a.instance!=b.instance) return a.instance<b.instance;
+    if(a.natoms!=b.natoms) return a.natoms<b.natoms;
+    return a.workers()<b.workers();
+  });
+
+  // efficiencies are computed with respect to the configuration with the fewest workers:
+  // strong scaling at fixed number of atoms, weak scaling at fixed number of atoms per worker
+  std::vector<double> strong(points.size(),1.0);
+  std::vector<double> weak(points.size(),1.0);
+  for(unsigned i=0; i<points.size(); i++) {
+    const SweepPoint* strongRef=nullptr;
+    const SweepPoint* weakRef=nullptr;
+    for(const auto & q : points) {
+      if(q.instance!=points[i].instance) continue;
+      if(q.natoms==points[i].natoms && (!strongRef || q.workers()<strongRef->workers())) strongRef=&q;
+      if((unsigned long long)q.natoms*points[i].workers()==(unsigned long long)points[i].natoms*q.workers() && (!weakRef || q.workers()<weakRef->workers())) weakRef=&q;
+    }
+    if(points[i].time>0.0) {
+      strong[i]=strongRef->time*strongRef->workers()/(points[i].time*points[i].workers());
+      weak[i]=weakRef->time/points[i].time;
+    }
+  }
+
+  log<<"Scaling sweep (time per step in milliseconds, mean +- 95% confidence interval)\n";
+  log.printf("%8s %10s %8s %6s %22s %16s %10s %10s\n","instance","natoms","threads","ranks","time/step","atoms*steps/s","strong","weak");
+  for(unsigned i=0; i<points.size(); i++) {
+    const auto & point(points[i]);
+    log.printf("%8u %10u %8u %6u %10.4f +- %-8.4f %16.4e %10.3f %10.3f\n",point.instance,point.natoms,point.threads,point.ranks,
+               point.time*1e3,point.error*1e3,(point.time>0.0?point.natoms/point.time:0.0),strong[i],weak[i]);
+  }
+
+  if(reportFile.empty() || pc.Get_rank()!=0) return;
+  const bool json=reportFile.length()>=5 && reportFile.substr(reportFile.length()-5)==".json";
+  std::ofstream ofile(reportFile);
+  plumed_massert(ofile,"cannot open report file " + reportFile);
+  char buffer[256];
+  if(json) ofile<<"{\n  \"sweep\": [";
+  else ofile<<"instance,kernel,plumed,natoms,threads,ranks,time_s,time_ci_s,strong_efficiency,weak_efficiency\n";
+  for(unsigned i=0; i<points.size(); i++) {
+    const auto & point(points[i]);
+    if(json) {
+      ofile<<(i>0?",":"")<<"\n    {\"instance\": "<<point.instance<<", \"kernel\": "<<jsonString(point.kernel)<<", \"plumed\": "<<jsonString(point.plumed_dat);
+      std::snprintf(buffer,sizeof(buffer),", \"natoms\": %u, \"threads\": %u, \"ranks\": %u, \"time_s\": %.9g, \"time_ci_s\": %.9g, \"strong_efficiency\": %.6f, \"weak_efficiency\": %.6f}",
+                    point.natoms,point.threads,point.ranks,point.time,point.error,strong[i],weak[i]);
+      ofile<<buffer;
+    } else {
+      std::snprintf(buffer,sizeof(buffer),",%u,%u,%u,%.9g,%.9g,%.6f,%.6f\n",point.natoms,point.threads,point.ranks,point.time,point.error,strong[i],weak[i]);
+      ofile<<point.instance<<","<<csvString(point.kernel)<<","<<csvString(point.plumed_dat)<<buffer;
+    }
+  }
+  if(json) ofile<<"\n  ]\n}\n";
+  log<<"Report written on "<<reportFile<<"\n";
+}
+
+/// A configuration of the domain decomposition communication benchmark
+struct CommunicationPoint {
+  double fraction=1.0;
+  unsigned ranks=1;
+  unsigned requested=0;
+  /// estimated bytes received by each rank at every step
+  double bytes=0.0;
+  /// time per step (seconds) spent gathering the atoms and computing/applying the forces, min/mean/max over ranks
+  std::array<double,3> share{};
+  std::array<double,3> calc{};
+};
+
+/// Measure the cost of passing the atoms between the ranks when a fraction of them is requested.
+/// A trivial input (center of mass of the first atoms with a restraint on it) is used,
+/// so that the time spent in the calculation is negligible with respect to the communication
+void communicationBenchmark(std::vector<CommunicationPoint> & points,Communicator & pc,const std::string & kernel,unsigned natoms,
+                            AtomDistribution & distribution,int nsteps,FILE* plumedLog,Log & log,const std::string & reportFile) {
+  std::stable_sort(points.begin(),points.end(),[](const CommunicationPoint & a,const CommunicationPoint & b) {return a.ranks<b.ranks;});
+  std::size_t first=0;
+  while(first<points.size()) {
+    const unsigned ranks=points[first].ranks;
+    std::size_t last=first;
+    while(last<points.size() && points[last].ranks==ranks) last++;
+    Communicator sub;
+    const bool active=(unsigned(pc.Get_rank())<ranks);
+    if(pc.Get_size()>1) pc.Split((active?0:1),pc.Get_rank(),sub);
+    for(auto i=first; i<last; i++) {
+      auto & point(points[i]);
+      point.requested=std::max(1U,std::min(natoms,unsigned(std::lround(point.fraction*natoms))));
+      // positions and global index of the requested atoms are gathered from all the ranks
+      point.bytes=(ranks>1 ? point.requested*(3*sizeof(double)+sizeof(int)) : 0.0);
+      if(active) {
+        log.printf("Running with %u ranks and %u requested atoms out of %u\n",ranks,point.requested,natoms);
+        generator rng;
+        PLMD::Random atomicGenerator;
+        PlumedHandle p=(kernel=="this"?PlumedHandle():PlumedHandle::dlopen(kernel.c_str()));
+        if(Communicator::plumedHasMPI()) p.cmd("setMPIComm",&sub.Get_comm());
+        p.cmd("setRealPrecision",(int)sizeof(double));
+        p.cmd("setMDLengthUnits",1.0);
+        p.cmd("setMDChargeUnits",1.0);
+        p.cmd("setMDMassUnits",1.0);
+        p.cmd("setMDEngine","benchmarks");
+        p.cmd("setTimestep",1.0);
+        p.cmd("setPlumedDat","/dev/null");
+        p.cmd("setLog",plumedLog);
+        p.cmd("setNatoms",natoms);
+        p.cmd("init");
+        p.cmd("readInputLine",("benchmark_com: COM ATOMS=1-"+std::to_string(point.requested)+" NOPBC").c_str());
+        p.cmd("readInputLine","benchmark_pos: POSITION ATOM=benchmark_com NOPBC");
+        p.cmd("readInputLine","RESTRAINT ARG=benchmark_pos.x AT=0.0 KAPPA=1.0");
+
+        std::vector<double> cell( 9 ), virial( 9 );
+        std::vector<Vector> pos( natoms ), forces( natoms );
+        std::vector<double> masses( natoms, 1 ), charges( natoms, 0 );
+        std::vector<int> shuffled_indexes(natoms);
+        for(unsigned j=0; j<natoms; j++) shuffled_indexes[j]=j;
+        std::shuffle(shuffled_indexes.begin(),shuffled_indexes.end(),rng);
+        const auto local=getLocalAtoms(natoms,sub.Get_size(),sub.Get_rank());
+
+        double shareTime=0.0,calcTime=0.0;
+        unsigned counted=0;
+        for(int step=0; step<nsteps; ++step) {
+          distribution.positions(pos,step,atomicGenerator);
+          distribution.box(cell,natoms,step,atomicGenerator);
+          sub.Barrier();
+          p.cmd("setStep",step);
+          p.cmd("setForces",&forces[local.shift][0], {local.n,3});
+          p.cmd("setBox",&cell[0], {3,3});
+          p.cmd("setVirial",&virial[0], {3,3});
+          p.cmd("setPositions",&pos[local.shift][0], {local.n,3});
+          p.cmd("setMasses",&masses[local.shift], {local.n});
+          p.cmd("setCharges",&charges[local.shift], {local.n});
+          p.cmd("setAtomsNlocal",local.n);
+          p.cmd("setAtomsGatindex",shuffled_indexes.data()+local.shift, {local.n});
+          p.cmd("prepareDependencies");
+          const auto start=std::chrono::high_resolution_clock::now();
+          p.cmd("shareData");
+          const auto shared=std::chrono::high_resolution_clock::now();
+          p.cmd("performCalc");
+          const auto end=std::chrono::high_resolution_clock::now();
+          // the first 20% of the steps is the warm-up
+          if(step>=nsteps/5) {
+            shareTime+=std::chrono::duration<double>(shared-start).count();
+            calcTime+=std::chrono::duration<double>(end-shared).count();
+            counted++;
+          }
+        }
+        if(counted>0) {
+          shareTime/=counted;
+          calcTime/=counted;
+        }
+        std::vector<double> all(2*sub.Get_size());
+        std::vector<double> mine {shareTime,calcTime};
+        if(sub.Get_size()>1) sub.Allgather(mine,all);
+        else all=mine;
+        for(unsigned k=0; k<2; k++) {
+          auto & stats(k==0?point.share:point.calc);
+          stats= {all[k],0.0,all[k]};
+          for(int r=0; r<sub.Get_size(); r++) {
+            stats[0]=std::min(stats[0],all[2*r+k]);
+            stats[1]+=all[2*r+k]/sub.Get_size();
+            stats[2]=std::max(stats[2],all[2*r+k]);
+          }
+        }
+      }
+      pc.Barrier();
+    }
+    first=last;
+  }
+  // the results are on the ranks that took part to each run, rank 0 took part to all of them
+  std::sort(points.begin(),points.end(),[](const CommunicationPoint & a,const CommunicationPoint & b) {
+    if(a.ranks!=b.ranks) return a.ranks<b.ranks;
+    return a.fraction<b.fraction;
+  });
+
+  log<<"Domain decomposition communication (time per step in milliseconds, min/mean/max over ranks)\n";
+  log.printf("%6s %10s %10s %14s %32s %32s\n","ranks","fraction","requested","bytes/rank","gather","calculation and forces");
+  for(const auto & point : points) {
+    log.printf("%6u %10.4f %10u %14.0f %10.4f %10.4f %10.4f %10.4f %10.4f %10.4f\n",point.ranks,point.fraction,point.requested,point.bytes,
+               point.share[0]*1e3,point.share[1]*1e3,point.share[2]*1e3,point.calc[0]*1e3,point.calc[1]*1e3,point.calc[2]*1e3);
+  }
+
+  if(reportFile.empty() || pc.Get_rank()!=0) return;
+  const bool json=reportFile.length()>=5 && reportFile.substr(reportFile.length()-5)==".json";
+  std::ofstream ofile(reportFile);
+  plumed_massert(ofile,"cannot open report file " + reportFile);
+  char buffer[512];
+  if(json) ofile<<"{\n  \"communication\": [";
+  else ofile<<"ranks,fraction,requested,bytes_per_rank,gather_min_s,gather_mean_s,gather_max_s,calc_min_s,calc_mean_s,calc_max_s\n";
+  for(unsigned i=0; i<points.size(); i++) {
+    const auto & point(points[i]);
+    if(json) {
+      std::snprintf(buffer,sizeof(buffer),"%s\n    {\"ranks\": %u, \"fraction\": %.6g, \"requested\": %u, \"bytes_per_rank\": %.0f, "
+                    "\"gather_s\": [%.9g, %.9g, %.9g], \"calc_s\": [%.9g, %.9g, %.9g]}",(i>0?",":""),
+                    point.ranks,point.fraction,point.requested,point.bytes,point.share[0],point.share[1],point.share[2],point.calc[0],point.calc[1],point.calc[2]);
+    } else {
+      std::snprintf(buffer,sizeof(buffer),"%u,%.6g,%u,%.0f,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n",
+                    point.ranks,point.fraction,point.requested,point.bytes,point.share[0],point.share[1],point.share[2],point.calc[0],point.calc[1],point.calc[2]);
+    }
+    ofile<<buffer;
+  }
+  if(json) ofile<<"\n  ]\n}\n";
+  log<<"Report written on "<<reportFile<<"\n";
+}
+
 class Benchmark:
   public CLTool
 {
@@ -455,10 +1190,17 @@ void Benchmark::registerKeywords( Keywords& keys ) {
   keys.add("compulsory","--nsteps","2000","number of steps of MD to perform (-1 means forever)");
   keys.add("compulsory","--maxtime","-1","maximum number of seconds (-1 means forever)");
   keys.add("compulsory","--sleep","0","number of seconds of sleep, mimicking MD calculation");
-  keys.add("compulsory","--atom-distribution","line","the kind of possible atomic displacement at each step");
+  keys.add("compulsory","--atom-distribution","line","the kind of possible atomic displacement at each step (line, cube, sphere, globs, sc, water, slab, droplets or replay)");
+  keys.add("optional","--trajectory","xyz trajectory replayed with --atom-distribution replay");
   keys.add("optional","--dump-trajectory","dump the trajectory to this file");
   keys.addFlag("--domain-decomposition",false,"simulate domain decomposition, implies --shuffle");
   keys.addFlag("--shuffled",false,"reshuffle atoms");
+  keys.addFlag("--detailed-timers",false,"collect and compare the time spent by each action");
+  keys.add("optional","--sweep-natoms","colon separated numbers of atoms for a scaling sweep");
+  keys.add("optional","--sweep-threads","colon separated numbers of OpenMP threads for a scaling sweep");
+  keys.add("optional","--sweep-ranks","colon separated numbers of MPI ranks for a scaling sweep");
+  keys.add("optional","--dd-fractions","colon separated fractions of requested atoms for a domain decomposition communication benchmark");
+  keys.add("optional","--report","write a machine readable report on this file (JSON if the name ends with .json, CSV otherwise)");
 }
 
 Benchmark::Benchmark(const CLToolOptions& co ):
@@ -491,10 +1233,12 @@ int Benchmark::main(FILE* in, FILE*out,Communicator& pc) {
   log.setLinePrefix("BENCH:  ");
   log <<"Welcome to PLUMED benchmark\n";
   std::vector<Kernel> kernels;
+  std::string reportFile;
+  const bool isRoot=(pc.Get_rank()==0);
 
   // perform comparative analysis
   // ensure that kernels vector is destroyed from last to first element upon exit
-  auto kernels_deleter=[&log](auto f) {
+  auto kernels_deleter=[&log,&reportFile,isRoot](auto f) {
     if(!f) {
       return;
     }
@@ -581,6 +1325,13 @@ int Benchmark::main(FILE* in, FILE*out,Communicator& pc) {
         log<<"Unexpected error during comparative analysis\n";
         log<<e.what()<<"\n";
       }
+
+    try {
+      reportActionTimings(*f,log,(isRoot?reportFile:std::string()));
+    } catch(std::exception & e) {
+      log<<"Unexpected error while reporting per-action timings\n";
+      log<<e.what()<<"\n";
+    }
     while(!f->empty()) f->pop_back();
 
   };
@@ -652,6 +1403,14 @@ int Benchmark::main(FILE* in, FILE*out,Communicator& pc) {
   if(pc.Get_size()>1) domain_decomposition=true;
   if(domain_decomposition) shuffled=true;
 
+  bool detailedTimers=false;
+  parseFlag("--detailed-timers",detailedTimers);
+  if (detailedTimers)
+    log << "Using --detailed-timers\n";
+
+  if(parse("--report",reportFile))
+    log << "Using --report=" << reportFile << "\n";
+
   double timeToSleep;
   parse("--sleep",timeToSleep);
   log << "Using --sleep=" << timeToSleep << "\n";
@@ -661,7 +1420,9 @@ int Benchmark::main(FILE* in, FILE*out,Communicator& pc) {
   {
     std::string atomicDistr;
     parse("--atom-distribution",atomicDistr);
-    distribution = getAtomDistribution(atomicDistr);
+    std::string trajectory;
+    if(parse("--trajectory",trajectory)) log << "Using --trajectory=" << trajectory << "\n";
+    distribution = getAtomDistribution(atomicDistr,trajectory);
     log << "Using --atom-distribution=" << atomicDistr << "\n";
   }
 
@@ -693,6 +1454,72 @@ int Benchmark::main(FILE* in, FILE*out,Communicator& pc) {
     }
   }
 
+  {
+    std::string sweepNatoms,sweepThreads,sweepRanks;
+    bool sweep=false;
+    if(parse("--sweep-natoms",sweepNatoms)) { sweep=true; log << "Using --sweep-natoms=" << sweepNatoms << "\n"; }
+    if(parse("--sweep-threads",sweepThreads)) { sweep=true; log << "Using --sweep-threads=" << sweepThreads << "\n"; }
+    if(parse("--sweep-ranks",sweepRanks)) { sweep=true; log << "Using --sweep-ranks=" << sweepRanks << "\n"; }
+    std::string ddFractions;
+    if(parse("--dd-fractions",ddFractions)) {
+      log << "Using --dd-fractions=" << ddFractions << "\n";
+      plumed_massert(nf>0,"the communication benchmark requires a positive --nsteps");
+      std::vector<unsigned> ranksList;
+      for(const auto & w : Tools::getWords(sweepRanks,":")) {
+        unsigned r;
+        plumed_massert(Tools::convertNoexcept(w,r) && r>0 && r<=unsigned(pc.Get_size()),"--sweep-ranks should be between 1 and the number of MPI processes");
+        ranksList.push_back(r);
+      }
+      if(ranksList.empty()) ranksList.push_back(pc.Get_size());
+      std::vector<CommunicationPoint> points;
+      for(auto r : ranksList) for(const auto & w : Tools::getWords(ddFractions,":")) {
+          CommunicationPoint point;
+          plumed_massert(Tools::convertNoexcept(w,point.fraction) && point.fraction>0.0 && point.fraction<=1.0,"--dd-fractions should be between 0 and 1");
+          point.ranks=r;
+          points.push_back(point);
+        }
+      const std::string kernel=kernels.back().path;
+      while(!kernels.empty()) kernels.pop_back();
+      communicationBenchmark(points,pc,kernel,natoms,*distribution,nf,log_dev_null.get(),log,reportFile);
+      return 0;
+    }
+    if(sweep) {
+      plumed_massert(nf>0,"a scaling sweep requires a positive --nsteps");
+      auto parseList=[](const std::string & str,unsigned def) {
+        std::vector<unsigned> list;
+        for(const auto & w : Tools::getWords(str,":")) {
+          unsigned v;
+          plumed_massert(Tools::convertNoexcept(w,v),"cannot parse " + w + " in a sweep list");
+          list.push_back(v);
+        }
+        if(list.empty()) list.push_back(def);
+        return list;
+      };
+      const auto natomsList=parseList(sweepNatoms,natoms);
+      const auto threadsList=parseList(sweepThreads,0);
+      const auto ranksList=parseList(sweepRanks,pc.Get_size());
+      for(auto r : ranksList) {
+        plumed_massert(r>0 && r<=unsigned(pc.Get_size()),"--sweep-ranks should be between 1 and the number of MPI processes");
+      }
+      std::vector<SweepPoint> points;
+      unsigned instance=0;
+      for(auto it=kernels.rbegin(); it!=kernels.rend(); ++it,++instance) for(auto r : ranksList) for(auto t : threadsList) for(auto n : natomsList) {
+              SweepPoint point;
+              point.instance=instance;
+              point.kernel=it->path;
+              point.plumed_dat=it->plumed_dat;
+              point.natoms=n;
+              point.threads=t;
+              point.ranks=r;
+              points.push_back(point);
+            }
+      // the kernels loaded for the standard benchmark are not needed
+      while(!kernels.empty()) kernels.pop_back();
+      scalingSweep(points,pc,domain_decomposition,shuffled,*distribution,nf,log_dev_null.get(),log,reportFile);
+      return 0;
+    }
+  }
+
   log <<"Initializing the setup of the kernel(s)\n";
   const auto initial_time=std::chrono::high_resolution_clock::now();
 
@@ -709,7 +1536,16 @@ int Benchmark::main(FILE* in, FILE*out,Communicator& pc) {
     p.cmd("setPlumedDat",k.plumed_dat.c_str());
     p.cmd("setLog",out);
     p.cmd("setNatoms",natoms);
+    if(detailedTimers) {
+      try {
+        p.cmd("setDetailedTimers",1);
+        k.detailedTimers=true;
+      } catch(std::exception & e) {
+        log<<"Kernel "<<k.path<<" does not provide per-action timings\n";
+      }
+    }
     p.cmd("init");
+    if(k.detailedTimers) k.retrieveActionLabels();
   }
 
   std::vector<double> cell( 9 ), virial( 9 );
@@ -748,18 +1584,9 @@ int Benchmark::main(FILE* in, FILE*out,Communicator& pc) {
     int n_local_atoms;
 
     if(domain_decomposition) {
-      const auto nproc=pc.Get_size();
-      const auto nn=natoms/nproc;
-      //using int to remove warning, MPI don't work with unsigned
-      int excess=natoms%nproc;
-      const auto myrank=pc.Get_rank();
-      auto shift=0;
-      n_local_atoms=nn;
-      if(myrank<excess) n_local_atoms+=1;
-      for(int i=0; i<myrank; i++) {
-        shift+=nn;
-        if(i<excess) shift+=1;
-      }
+      const auto local=getLocalAtoms(natoms,pc.Get_size(),pc.Get_rank());
+      const auto shift=local.shift;
+      n_local_atoms=local.n;
       pos_ptr=&pos[shift][0];
       for_ptr=&forces[shift][0];
       charges_ptr=&charges[shift];
@@ -815,6 +1642,7 @@ int Benchmark::main(FILE* in, FILE*out,Communicator& pc) {
       }
 
       if(kernels_ptr.size()>1 && part>1) kernels_ptr[i]->timings.push_back(kernels_ptr[i]->stopwatch.getLastCycle(sw_name));
+      if(kernels_ptr[i]->detailedTimers && part>1) kernels_ptr[i]->collectActionTimings();
       if(plumedStopCondition || signalReceived.load()) fast_finish=true;
     }
     auto elapsed=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now()-initial_time).count();
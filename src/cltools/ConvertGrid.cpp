@@ -0,0 +1,171 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "CLTool.h"
+#include "core/CLToolRegister.h"
+#include "tools/Tools.h"
+#include "tools/IFile.h"
+#include "tools/OFile.h"
+#include "tools/Grid.h"
+#include "tools/MappedGrid.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace PLMD {
+namespace cltools {
+
+//+PLUMEDOC TOOLS convert_grid
+/*
+Convert a grid file between the text and the binary formats.
+
+Binary grid files are written by \ref METAD with GRID_WBINARY and by \ref DUMPGRID with BINARY.
+They can be read by \ref METAD with GRID_RFILE, by \ref EXTERNAL and by \ref REFERENCE_GRID.
+The direction of the conversion is chosen from the format of the input file.
+Text files written both by \ref METAD and by \ref DUMPGRID can be converted, text files
+are always written in the format used by \ref METAD.
+
+\par Examples
+
+The following command converts a text grid to a compressed binary file without derivatives
+\verbatim
+plumed convert_grid --ifile bias.grid --ofile bias.bin --compress --noderiv
+\endverbatim
+and this command converts it back to text
+\verbatim
+plumed convert_grid --ifile bias.bin --ofile bias.txt
+\endverbatim
+
+*/
+//+ENDPLUMEDOC
+
+class ConvertGrid:
+  public CLTool
+{
+  void toBinary(const std::string& ifname, const std::string& ofname, bool withder, bool compress, FILE* out);
+  void toText(const std::string& ifname, const std::string& ofname, FILE* out);
+public:
+  static void registerKeywords( Keywords& keys );
+  explicit ConvertGrid(const CLToolOptions& co );
+  int main(FILE* in, FILE*out,Communicator& pc) override;
+  std::string description()const override {
+    return "convert a grid file between the text and the binary formats";
+  }
+};
+
+PLUMED_REGISTER_CLTOOL(ConvertGrid,"convert_grid")
+
+void ConvertGrid::registerKeywords( Keywords& keys ) {
+  CLTool::registerKeywords( keys );
+  keys.add("compulsory","--ifile","specify the name of the input grid file");
+  keys.add("compulsory","--ofile","specify the name of the output grid file");
+  keys.addFlag("--compress",false,"compress the data with zlib when writing a binary file");
+  keys.addFlag("--noderiv",false,"do not store the derivatives when writing a binary file");
+}
+
+ConvertGrid::ConvertGrid(const CLToolOptions& co ):
+  CLTool(co)
+{
+  inputdata=commandline;
+}
+
+void ConvertGrid::toBinary(const std::string& ifname, const std::string& ofname, bool withder, bool compress, FILE* out) {
+  IFile ifile;
+  ifile.allowIgnoredFields();
+  ifile.open(ifname);
+  std::vector<std::string> fields;
+  ifile.scanFieldList(fields);
+  // the names of the variables are found from the constant fields of the header
+  std::vector<std::string> names;
+  for(const auto & f : fields) if(f.compare(0,4,"min_")==0) names.push_back(f.substr(4));
+  const unsigned nvar=names.size();
+  plumed_assert(nvar>0 && fields.size()>nvar) << "cannot find the header of the grid in file " << ifname;
+  // the function follows the coordinates, its derivatives are labelled as in METAD or as in DUMPGRID
+  const std::string funcname=fields[nvar];
+  std::vector<std::string> dernames(nvar);
+  bool hasder=true, dumpgrid=false;
+  for(unsigned i=0; i<nvar; ++i) {
+    plumed_assert(fields[i]==names[i]) << "column " << i+1 << " of grid file " << ifname << " should be " << names[i];
+    if(ifile.FieldExist("der_"+names[i])) dernames[i]="der_"+names[i];
+    else if(ifile.FieldExist("d"+funcname+"_"+names[i])) {dernames[i]="d"+funcname+"_"+names[i]; dumpgrid=true;}
+    else hasder=false;
+  }
+  withder=withder && hasder;
+
+  std::vector<std::string> gmin(nvar), gmax(nvar);
+  std::vector<unsigned> gbin(nvar);
+  std::vector<bool> periodic(nvar);
+  for(unsigned i=0; i<nvar; ++i) {
+    std::string pstring; int gbin1;
+    ifile.scanField("min_"+names[i],gmin[i]);
+    ifile.scanField("max_"+names[i],gmax[i]);
+    ifile.scanField("periodic_"+names[i],pstring);
+    ifile.scanField("nbins_"+names[i],gbin1);
+    plumed_assert(gbin1>0);
+    periodic[i]=(pstring=="true");
+    // the header written by METAD includes the extra point of non periodic grids
+    gbin[i]=(periodic[i] || dumpgrid) ? gbin1 : gbin1-1;
+  }
+  Grid grid(funcname,names,gmin,gmax,gbin,false,withder,periodic,gmin,gmax);
+
+  std::vector<double> xx(nvar), dder(nvar), dx(grid.getDx());
+  double f, x;
+  unsigned npoints=0;
+  while(ifile.scanField(funcname,f)) {
+    for(unsigned i=0; i<nvar; ++i) {
+      ifile.scanField(names[i],x); xx[i]=x+dx[i]/2.0;
+    }
+    if(hasder) for(unsigned i=0; i<nvar; ++i) ifile.scanField(dernames[i],dder[i]);
+    const GridBase::index_t index=grid.getIndex(xx);
+    if(withder) grid.setValueAndDerivatives(index,f,dder);
+    else grid.setValue(index,f);
+    ifile.scanField();
+    npoints++;
+  }
+  MappedGrid::write(ofname,grid,withder,compress);
+  std::fprintf(out,"  %u grid points converted%s\n",npoints,withder ? "" : " without derivatives");
+}
+
+void ConvertGrid::toText(const std::string& ifname, const std::string& ofname, FILE* out) {
+  MappedGrid grid(ifname,false);
+  OFile ofile;
+  ofile.open(ofname);
+  grid.writeToFile(ofile);
+  ofile.close();
+  std::fprintf(out,"  %u grid points converted\n",static_cast<unsigned>(grid.getSize()));
+}
+
+int ConvertGrid::main(FILE* in, FILE*out,Communicator& pc) {
+  std::string ifname, ofname;
+  parse("--ifile",ifname);
+  parse("--ofile",ofname);
+  bool compress=false, noderiv=false;
+  parseFlag("--compress",compress);
+  parseFlag("--noderiv",noderiv);
+  plumed_assert(ifname.length()>0) << "please specify the input file with --ifile";
+  plumed_assert(ofname.length()>0) << "please specify the output file with --ofile";
+  if(MappedGrid::isBinary(ifname)) toText(ifname,ofname,out);
+  else toBinary(ifname,ofname,!noderiv,compress,out);
+  return 0;
+}
+
+}
+} // End of namespace
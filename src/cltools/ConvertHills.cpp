@@ -0,0 +1,192 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "CLTool.h"
+#include "core/CLToolRegister.h"
+#include "tools/Tools.h"
+#include "tools/IFile.h"
+#include "tools/OFile.h"
+#include "tools/HillsBinaryFile.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace PLMD {
+namespace cltools {
+
+//+PLUMEDOC TOOLS convert_hills
+/*
+Convert a file of hills deposited by \ref METAD between the text and the binary formats.
+
+The binary format is written by \ref METAD when BINARY_FILE is used.
+Restarting from a binary file avoids parsing the text fields of large HILLS files.
+The direction of the conversion is chosen from the format of the input file.
+
+\par Examples
+
+The following command converts a text HILLS file to binary format
+\verbatim
+plumed convert_hills --ifile HILLS --ofile HILLS.bin
+\endverbatim
+and this command converts it back to text, for instance to be used with \ref sum_hills
+\verbatim
+plumed convert_hills --ifile HILLS.bin --ofile HILLS.txt
+\endverbatim
+
+*/
+//+ENDPLUMEDOC
+
+class ConvertHills:
+  public CLTool
+{
+  void toBinary(const std::string& ifname, const std::string& ofname, bool checksum, FILE* out);
+  void toText(const std::string& ifname, const std::string& ofname, FILE* out);
+public:
+  static void registerKeywords( Keywords& keys );
+  explicit ConvertHills(const CLToolOptions& co );
+  int main(FILE* in, FILE*out,Communicator& pc) override;
+  std::string description()const override {
+    return "convert a file of hills between the text and the binary formats";
+  }
+};
+
+PLUMED_REGISTER_CLTOOL(ConvertHills,"convert_hills")
+
+void ConvertHills::registerKeywords( Keywords& keys ) {
+  CLTool::registerKeywords( keys );
+  keys.add("compulsory","--ifile","specify the name of the input hills file");
+  keys.add("compulsory","--ofile","specify the name of the output hills file");
+  keys.addFlag("--checksum",false,"store a checksum with each hill when writing a binary file");
+}
+
+ConvertHills::ConvertHills(const CLToolOptions& co ):
+  CLTool(co)
+{
+  inputdata=commandline;
+}
+
+void ConvertHills::toBinary(const std::string& ifname, const std::string& ofname, bool checksum, FILE* out) {
+  IFile ifile;
+  ifile.allowIgnoredFields();
+  ifile.open(ifname);
+  std::vector<std::string> fields;
+  ifile.scanFieldList(fields);
+  plumed_assert(fields.size()>0 && fields[0]=="time") << "cannot find the fields of the hills in file " << ifname;
+  // the CVs are the fields between time and the widths
+  std::vector<HillsBinaryFile::Variable> vars;
+  for(unsigned i=1; i<fields.size(); ++i) {
+    if(fields[i]=="kerneltype" || fields[i]=="multivariate" || fields[i]=="height" || fields[i].compare(0,6,"sigma_")==0) break;
+    HillsBinaryFile::Variable v;
+    v.name=fields[i];
+    v.periodic=ifile.FieldExist("min_"+v.name);
+    if(v.periodic) {
+      ifile.scanField("min_"+v.name,v.min);
+      ifile.scanField("max_"+v.name,v.max);
+    }
+    vars.push_back(v);
+  }
+  const unsigned ncv=vars.size();
+  std::fprintf(out,"  converting text hills file %s with %u variables to binary file %s\n",ifname.c_str(),ncv,ofname.c_str());
+  HillsBinaryFile ofile;
+  ofile.create(ofname,vars,checksum,false);
+  HillsBinaryFile::Record rec;
+  rec.center.resize(ncv);
+  unsigned nhills=0;
+  while(ifile.scanField("time",rec.time)) {
+    for(unsigned i=0; i<ncv; ++i) ifile.scanField(vars[i].name,rec.center[i]);
+    std::string sss="false";
+    if(ifile.FieldExist("multivariate")) ifile.scanField("multivariate",sss);
+    rec.multivariate=(sss=="true");
+    if(rec.multivariate) {
+      rec.sigma.clear();
+      for(unsigned i=0; i<ncv; i++) {
+        for(unsigned j=0; j<ncv-i; j++) {
+          double s; ifile.scanField("sigma_"+vars[j+i].name+"_"+vars[j].name,s);
+          rec.sigma.push_back(s);
+        }
+      }
+    } else {
+      rec.sigma.resize(ncv);
+      for(unsigned i=0; i<ncv; ++i) ifile.scanField("sigma_"+vars[i].name,rec.sigma[i]);
+    }
+    ifile.scanField("height",rec.height);
+    ifile.scanField("biasf",rec.biasf);
+    ifile.scanField();
+    ofile.write(rec);
+    nhills++;
+  }
+  std::fprintf(out,"  %u hills converted\n",nhills);
+}
+
+void ConvertHills::toText(const std::string& ifname, const std::string& ofname, FILE* out) {
+  HillsBinaryFile ifile;
+  ifile.open(ifname);
+  const std::vector<HillsBinaryFile::Variable>& vars=ifile.getVariables();
+  const unsigned ncv=vars.size();
+  std::fprintf(out,"  converting binary hills file %s with %u variables to text file %s\n",ifname.c_str(),ncv,ofname.c_str());
+  OFile ofile;
+  ofile.open(ofname);
+  ofile.addConstantField("multivariate");
+  ofile.addConstantField("kerneltype");
+  for(const auto & v : vars) {
+    if(v.periodic) { ofile.addConstantField("min_"+v.name); ofile.addConstantField("max_"+v.name); }
+  }
+  HillsBinaryFile::Record rec;
+  unsigned nhills=0;
+  while(ifile.read(rec)) {
+    ofile.printField("time",rec.time);
+    for(unsigned i=0; i<ncv; ++i) {
+      ofile.printField(vars[i].name,rec.center[i]);
+      if(vars[i].periodic) ofile.printField("min_"+vars[i].name,vars[i].min).printField("max_"+vars[i].name,vars[i].max);
+    }
+    ofile.printField("kerneltype","stretched-gaussian");
+    if(rec.multivariate) {
+      ofile.printField("multivariate","true");
+      unsigned k=0;
+      for(unsigned i=0; i<ncv; i++) {
+        for(unsigned j=0; j<ncv-i; j++) { ofile.printField("sigma_"+vars[j+i].name+"_"+vars[j].name,rec.sigma[k]); k++; }
+      }
+    } else {
+      ofile.printField("multivariate","false");
+      for(unsigned i=0; i<ncv; ++i) ofile.printField("sigma_"+vars[i].name,rec.sigma[i]);
+    }
+    ofile.printField("height",rec.height).printField("biasf",rec.biasf);
+    ofile.printField();
+    nhills++;
+  }
+  std::fprintf(out,"  %u hills converted\n",nhills);
+}
+
+int ConvertHills::main(FILE* in, FILE*out,Communicator& pc) {
+  std::string ifname, ofname;
+  parse("--ifile",ifname);
+  parse("--ofile",ofname);
+  bool checksum=false;
+  parseFlag("--checksum",checksum);
+  plumed_assert(ifname.length()>0) << "please specify the input file with --ifile";
+  plumed_assert(ofname.length()>0) << "please specify the output file with --ofile";
+  if(HillsBinaryFile::isBinary(ifname)) toText(ifname,ofname,out);
+  else toBinary(ifname,ofname,checksum,out);
+  return 0;
+}
+
+}
+} // End of namespace
@@ -32,13 +32,17 @@
 #include "tools/Pbc.h"
 #include <cstdio>
 #include <cstring>
+#include <cstdint>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <memory>
 #include "tools/Units.h"
 #include "tools/PDB.h"
 #include "tools/FileBase.h"
 #include "tools/IFile.h"
+#include "tools/OFile.h"
+#include "tools/Prefetcher.h"
 #include "xdrfile/xdrfile_trr.h"
 #include "xdrfile/xdrfile_xtc.h"
 
@@ -174,6 +178,32 @@ Notice that the xdrfile implementation of xtc and trr
 is more robust than the molfile one, since it provides support for generic cell shapes.
 In addition, it allows \ref DUMPATOMS to write compressed xtc files.
 
+When analyzing long trajectories, decompressing and reading the frames can take as long as the analysis.
+With `--prefetch N` the trajectory is read by a separate thread that keeps up to N frames ready
+(blocks of lines for xyz, gro and DL_POLY_4 files) while PLUMED is working on the current frame:
+
+\verbatim
+plumed driver --plumed plumed.dat --ixtc trajectory.xtc --prefetch 4
+\endverbatim
+
+If the quantities computed for each frame do not depend on what was computed for the previous frames
+(e.g. there is no \ref METAD or \ref AVERAGE in the input) the frames can be analyzed in parallel with the `--frame-parallel` flag.
+The frames are then assigned in turn to the MPI processes, each of which runs its own copy of PLUMED.
+Notice that with most formats every process reads the whole trajectory, so this is only useful if the analysis takes longer than the reading.
+With xtc and trr files read with `--ixtc` and `--itrr` each process instead reads only its own frames, which are located using an index (see below).
+At the end, the files that contain the time in the first field (e.g. those written by \ref PRINT) are merged in a single file
+that is sorted by time. Other files are left in one file per process, with the rank of the process as suffix.
+
+\verbatim
+mpirun -np 8 plumed driver --plumed plumed.dat --ixtc trajectory.xtc --frame-parallel
+\endverbatim
+
+The analysis can be started from a later frame with `--first-frame N`, where the first frame of the trajectory is frame 0.
+The step of the first analyzed frame is then N times the trajectory stride.
+For xtc and trr files read with `--ixtc` and `--itrr` the frames that are not analyzed are not read at all.
+The offsets of the frames are found when the file is first used in this way and are stored in a file with the same name and the suffix .idx,
+so that they need not be computed again. If the trajectory has grown since the index was written, only the new frames are scanned.
+
 
 */
 //+ENDPLUMEDOC
@@ -195,6 +225,150 @@ static int register_cb(void *v, vmdplugin_t *p) {
 }
 #endif
 
+/// A frame read from a xtc or trr file
+struct XdrFrame {
+  int ret=xdrfile::exdrOK;
+  int step=0;
+  xdrfile::matrix box;
+  std::unique_ptr<xdrfile::rvec[]> pos;
+};
+
+/// A block of lines read from a text trajectory
+struct LineBlock {
+  std::vector<std::string> lines;
+  std::size_t nlines=0;
+};
+
+/// Number of lines of a text trajectory that are handed to the main thread at once
+static constexpr std::size_t lineBlockSize=4096;
+
+#ifdef __PLUMED_HAS_MOLFILE_PLUGINS
+/// A frame read with a molfile plugin, ts.coords points to coords
+struct MolfileFrame {
+  molfile_timestep_t ts;
+  std::vector<float> coords;
+};
+#endif
+
+/// Remove the suffix that was added to path with FileBase::appendSuffix, returns an empty string if this is not possible
+static std::string removeSuffix(const std::string & path,const std::string & suffix) {
+  std::vector<std::string> candidates;
+  if(path.length()>suffix.length() && path.compare(path.length()-suffix.length(),suffix.length(),suffix)==0) {
+    candidates.push_back(path.substr(0,path.length()-suffix.length()));
+  }
+  auto n=path.rfind(suffix+".");
+  if(n!=std::string::npos) candidates.push_back(path.substr(0,n)+path.substr(n+suffix.length()));
+  for(const auto & c : candidates) if(FileBase::appendSuffix(c,suffix)==path) return c;
+  return "";
+}
+
+/// Get the offsets of the frames of an xtc or trr file.
+/// They are cached in a file with suffix .idx, that is also used to find
+/// the frames that have been added since it was written
+static std::vector<long> getXdrFrameOffsets(const std::string & fname,bool xtc,bool writeCache) {
+  static const char magic[8]= {'P','L','M','D','X','I','D','X'};
+  std::vector<long> offsets;
+  auto deleter=[](auto f) { if(f) std::fclose(f); };
+  long size=0;
+  {
+    std::unique_ptr<FILE,decltype(deleter)> fp(std::fopen(fname.c_str(),"rb"),deleter);
+    if(!fp || std::fseek(fp.get(),0,SEEK_END)!=0) return offsets;
+    size=std::ftell(fp.get());
+  }
+  const std::string idxname=fname+".idx";
+  long indexedSize=0;
+  {
+    std::unique_ptr<FILE,decltype(deleter)> fp(std::fopen(idxname.c_str(),"rb"),deleter);
+    char m[8];
+    std::uint64_t n;
+    if(fp && std::fread(m,1,8,fp.get())==8 && std::memcmp(m,magic,8)==0 &&
+        std::fread(&indexedSize,sizeof(long),1,fp.get())==1 && std::fread(&n,sizeof(n),1,fp.get())==1) {
+      offsets.resize(n);
+      if(std::fread(offsets.data(),sizeof(long),n,fp.get())!=n || indexedSize>size) offsets.clear();
+    }
+  }
+  if(!offsets.empty() && indexedSize==size) return offsets;
+  auto xdr_deleter=[](auto xd) { if(xd) xdrfile::xdrfile_close(xd); };
+  std::unique_ptr<xdrfile::XDRFILE,decltype(xdr_deleter)> xd(xdrfile::xdrfile_open(fname.c_str(),"r"),xdr_deleter);
+  if(!xd) return std::vector<long>();
+// the last indexed frame is checked again since it might have been incomplete
+  long pos=0;
+  if(!offsets.empty()) {
+    pos=offsets.back();
+    offsets.pop_back();
+  }
+  if(xdrfile::xdrfile_seek(xd.get(),pos)!=0) return std::vector<long>();
+  while(true) {
+    int step;
+    float time;
+    pos=xdrfile::xdrfile_tell(xd.get());
+    int ret=xtc ? xdrfile::skip_xtc(xd.get(),&step,&time) : xdrfile::skip_trr(xd.get(),&step,&time);
+// seeking beyond the end of the file does not fail, so truncated frames are detected from the size
+    if(ret!=xdrfile::exdrOK || xdrfile::xdrfile_tell(xd.get())>size) break;
+    offsets.push_back(pos);
+  }
+  if(writeCache) {
+// failing to write the index (e.g. in a read only directory) is not an error
+    std::unique_ptr<FILE,decltype(deleter)> fp(std::fopen(idxname.c_str(),"wb"),deleter);
+    if(fp) {
+      const std::uint64_t n=offsets.size();
+      std::fwrite(magic,1,8,fp.get());
+      std::fwrite(&size,sizeof(long),1,fp.get());
+      std::fwrite(&n,sizeof(n),1,fp.get());
+      std::fwrite(offsets.data(),sizeof(long),n,fp.get());
+    }
+  }
+  return offsets;
+}
+
+/// Merge the files written by the processes of a frame parallel run.
+/// The lines are sorted according to the time, which should be the first field.
+/// Returns false if the files cannot be merged in this way
+static bool mergeFrameParallelFiles(const std::vector<std::string> & inputs,const std::string & output) {
+  struct Row {
+    double time;
+    std::string line;
+  };
+  std::vector<std::string> header;
+  std::vector<Row> rows;
+  auto deleter=[](auto f) { if(f) std::fclose(f); };
+  for(unsigned r=0; r<inputs.size(); r++) {
+    std::unique_ptr<FILE,decltype(deleter)> fp(std::fopen(inputs[r].c_str(),"r"),deleter);
+    if(!fp) return false;
+    std::string line;
+    unsigned nheader=0;
+    bool indata=false;
+    while(Tools::getline(fp.get(),line)) {
+      if(line.compare(0,2,"#!")==0) {
+        // the fields should be the same for all processes and should not change during the run
+        if(indata) return false;
+        if(nheader==0 && line.compare(0,14,"#! FIELDS time")!=0) return false;
+        if(r==0) header.push_back(line);
+        else if(nheader>=header.size() || header[nheader]!=line) return false;
+        nheader++;
+        continue;
+      }
+      std::vector<std::string> words=Tools::getWords(line);
+      if(words.empty()) continue;
+      // processes that did not analyze any frame write no header
+      if(nheader==0) return false;
+      indata=true;
+      Row row;
+      if(!Tools::convertNoexcept(words[0],row.time)) return false;
+      row.line=line;
+      rows.push_back(std::move(row));
+    }
+  }
+  if(header.empty()) return false;
+  std::stable_sort(rows.begin(),rows.end(),[](const Row & a,const Row & b) { return a.time<b.time; });
+  OFile of;
+  of.open(output);
+  for(const auto & h : header) of.printf("%s\n",h.c_str());
+  for(const auto & row : rows) of.printf("%s\n",row.line.c_str());
+  of.close();
+  return true;
+}
+
 template<typename real>
 class Driver : public CLTool {
 public:
@@ -204,6 +378,9 @@ public:
   void evaluateNumericalDerivatives( const long long int& step, PlumedMain& p, const std::vector<real>& coordinates,
                                      const std::vector<real>& masses, const std::vector<real>& charges,
                                      std::vector<real>& cell, const double& base, std::vector<real>& numder );
+  void evaluateDirectionalDerivatives( const long long int& step, PlumedMain& p, const std::vector<real>& coordinates,
+                                       const std::vector<real>& masses, const std::vector<real>& charges,
+                                       std::vector<real>& cell, const std::vector<real>& directions, std::vector<real>& numder );
   std::string description()const override;
 };
 
@@ -218,6 +395,11 @@ void Driver<real>::registerKeywords( Keywords& keys ) {
            " currently working only for xtc/trr files read with --ixtc/--trr)"
           );
   keys.add("compulsory","--multi","0","set number of replicas for multi environment (needs MPI)");
+  keys.add("compulsory","--prefetch","0","number of frames (or blocks of lines for text formats) that are read ahead by a separate thread while plumed is running."
+           " 0 means that the trajectory is read by the main thread");
+  keys.add("compulsory","--first-frame","0","the index of the first frame of the trajectory that is analyzed, the first frame in the file has index 0");
+  keys.addFlag("--frame-parallel",false,"distribute the frames of the trajectory among the MPI processes, each of which runs its own copy of plumed."
+               " Only use this if the quantities computed for each frame do not depend on the previous frames");
   keys.addFlag("--noatoms",false,"don't read in a trajectory.  Just use colvar files as specified in plumed.dat");
   keys.addFlag("--parse-only",false,"read the plumed input file and stop");
   keys.addFlag("--restart",false,"makes driver behave as if restarting");
@@ -242,6 +424,8 @@ void Driver<real>::registerKeywords( Keywords& keys ) {
   keys.add("optional","--initial-step","provides a number for the initial step, default is 0");
   keys.add("optional","--debug-forces","output a file containing the forces due to the bias evaluated using numerical derivatives "
            "and using the analytical derivatives implemented in plumed");
+  keys.add("optional","--debug-forces-directions","with --debug-forces, compare the analytical and numerical derivatives of the bias along this number of random directions "
+           "in the space of all the atomic coordinates rather than along every coordinate.  Each direction needs two evaluations of the bias whatever the number of atoms");
   keys.add("hidden","--debug-float","[yes/no] turns on the single precision version (to check float interface)");
   keys.add("hidden","--debug-dd","[yes/no] use a fake domain decomposition");
   keys.add("hidden","--debug-pd","[yes/no] use a fake particle decomposition");
@@ -331,9 +515,21 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
 // set up for multi replica driver:
   int multi=0;
   parse("--multi",multi);
+// set up for frame parallel analysis:
+  bool frameparallel; parseFlag("--frame-parallel",frameparallel);
+  if(frameparallel) {
+    if(multi) error("--frame-parallel cannot be used with --multi");
+    if(noatoms || parseOnly) error("--frame-parallel needs a trajectory");
+    if(restart) error("--frame-parallel cannot be used with --restart");
+    if(debug_pd || debug_dd) error("--frame-parallel cannot be used with --debug-pd or --debug-dd");
+    if(!Communicator::initialized() || pc.Get_size()<2) frameparallel=false;
+  }
   Communicator intracomm;
   Communicator intercomm;
-  if(multi) {
+  if(frameparallel) {
+// each process runs its own serial copy of plumed, so intracomm is left to its default
+    std::fprintf(out,"DRIVER: the frames are distributed among %d processes\n",pc.Get_size());
+  } else if(multi) {
     int ntot=pc.Get_size();
     int nintra=ntot/multi;
     if(multi*nintra!=ntot) error("invalid number of processes for multi environment");
@@ -345,6 +541,7 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
 
 // set up for debug replica exchange:
   bool debug_grex=parse("--debug-grex",fakein);
+  if(debug_grex && frameparallel) error("--frame-parallel cannot be used with --debug-grex");
   int  grex_stride=0;
   FILE*grex_log=NULL;
 // call fclose when fp goes out of scope
@@ -372,6 +569,10 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
   real timestep=real(t);
 // the stride
   unsigned stride; parse("--trajectory-stride",stride);
+  long long int firstframe; parse("--first-frame",firstframe);
+  if(firstframe<0) error("--first-frame should not be negative");
+// the number of frames to read ahead
+  unsigned prefetch; parse("--prefetch",prefetch);
 // are we writing forces
   std::string dumpforces(""), debugforces(""), dumpforcesFmt("%f");;
   bool dumpfullvirial=false;
@@ -379,6 +580,8 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
     parse("--dump-forces",dumpforces);
     parse("--debug-forces",debugforces);
   }
+  unsigned debugdirections=0;
+  if(debugforces!="") parse("--debug-forces-directions",debugdirections);
   if(dumpforces!="" || debugforces!="" ) parse("--dump-forces-fmt",dumpforcesFmt);
   if(dumpforces!="") parseFlag("--dump-full-virial",dumpfullvirial);
   if( debugforces!="" && (debug_dd || debug_pd) ) error("cannot debug forces and domain/particle decomposition at same time");
@@ -500,13 +703,8 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
   void *h_in=NULL;
   std::unique_ptr<void,decltype(mf_deleter)> h_in_deleter(h_in,mf_deleter);
 
-  molfile_timestep_t ts_in; // this is the structure that has the timestep
-// a std::vector<float> with the same scope as ts_in
-// it is necessary in order to store the pointer to ts_in.coords
-  std::vector<float> ts_in_coords;
-  ts_in.coords=ts_in_coords.data();
-  ts_in.velocities=NULL;
-  ts_in.A=-1; // we use this to check whether cell is provided or not
+  MolfileFrame mfframe; // this is the structure that has the timestep
+  molfile_timestep_t & ts_in(mfframe.ts);
 #endif
 
 
@@ -538,9 +736,15 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
   p.cmd("setMDEngine","driver");
   p.cmd("setTimestep",timestep);
   if( !parseOnly || full_outputfile.length()==0 ) p.cmd("setPlumedDat",plumedFile.c_str());
-  p.cmd("setLog",out);
+// in a frame parallel run the files written by each process have a different suffix and only the first process writes the log
+  if(frameparallel) {
+    std::string n; Tools::convert(pc.Get_rank(),n);
+    p.setSuffix("."+n);
+  }
+  if(frameparallel && pc.Get_rank()>0) p.cmd("setLogFile","/dev/null");
+  else p.cmd("setLog",out);
 
-  int natoms;
+  int natoms=0;
   int lvl=0;
   int pb=1;
 
@@ -583,8 +787,6 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
           if(command_line_natoms>=0) natoms=command_line_natoms;
           else error("this file format does not provide number of atoms; use --natoms on the command line");
         }
-        ts_in_coords.resize(3*natoms);
-        ts_in.coords = ts_in_coords.data();
 #endif
       } else if(trajectory_fmt=="xdr-xtc" || trajectory_fmt=="xdr-trr") {
         xd=xdrfile::xdrfile_open(trajectoryFile.c_str(),"r");
@@ -625,6 +827,86 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
     }
   }
 
+// With xtc and trr files, the frames that are not analyzed are skipped by seeking to the offsets of the frames
+  bool xdrSeek=false;
+  std::vector<long> xdrOffsets;
+  std::size_t nextXdrFrame=0;
+  std::size_t xdrFrameIncrement=1;
+  if(xd && (firstframe>0 || frameparallel)) {
+    bool xtc=(trajectory_fmt=="xdr-xtc");
+    bool root=!frameparallel || pc.Get_rank()==0;
+    if(root) xdrOffsets=getXdrFrameOffsets(trajectoryFile,xtc,true);
+    if(frameparallel) {
+      pc.Barrier();
+      if(!root) xdrOffsets=getXdrFrameOffsets(trajectoryFile,xtc,false);
+    }
+    xdrSeek=true;
+    nextXdrFrame=firstframe;
+    if(frameparallel) {
+      nextXdrFrame+=pc.Get_rank();
+      xdrFrameIncrement=pc.Get_size();
+    }
+    step=nextXdrFrame*stride;
+    std::fprintf(out,"DRIVER: found %zu frames in the index of %s\n",xdrOffsets.size(),trajectoryFile.c_str());
+  }
+
+// Functions reading the next frame (or block of lines). They are called either
+// directly or by the Prefetcher threads, so they only use the files and natoms
+  bool readTrajectory=!noatoms && !parseOnly;
+  auto readXdr=[&trajectory_fmt,xd,natoms,xdrSeek,&xdrOffsets,&nextXdrFrame,xdrFrameIncrement](XdrFrame & f) {
+    if(!f.pos) f.pos=Tools::make_unique<xdrfile::rvec[]>(natoms);
+    if(xdrSeek) {
+      if(nextXdrFrame>=xdrOffsets.size() || xdrfile::xdrfile_seek(xd,xdrOffsets[nextXdrFrame])!=0) {
+        f.ret=xdrfile::exdrENDOFFILE;
+        return false;
+      }
+      nextXdrFrame+=xdrFrameIncrement;
+    }
+    float time,prec,lambda;
+    if(trajectory_fmt=="xdr-xtc") f.ret=xdrfile::read_xtc(xd,natoms,&f.step,&time,f.box,f.pos.get(),&prec);
+    if(trajectory_fmt=="xdr-trr") f.ret=xdrfile::read_trr(xd,natoms,&f.step,&time,&lambda,f.box,f.pos.get(),NULL,NULL);
+    return f.ret==xdrfile::exdrOK;
+  };
+  auto readLines=[fp](LineBlock & b) {
+    b.lines.resize(lineBlockSize);
+    b.nlines=0;
+    while(b.nlines<lineBlockSize && Tools::getline(fp,b.lines[b.nlines])) b.nlines++;
+    return b.nlines>0;
+  };
+#ifdef __PLUMED_HAS_MOLFILE_PLUGINS
+  auto readMolfile=[api,h_in,natoms](MolfileFrame & f) {
+    f.coords.resize(3*natoms);
+    f.ts.coords=f.coords.data();
+    f.ts.velocities=NULL;
+    f.ts.A=-1; // we use this to check whether cell is provided or not
+    std::unique_ptr<std::lock_guard<std::mutex>> lck;
+    if(api->is_reentrant==VMDPLUGIN_THREADUNSAFE) lck=Tools::molfile_lock();
+    return api->read_next_timestep(h_in, natoms, &f.ts)!=MOLFILE_EOF;
+  };
+  std::unique_ptr<Prefetcher<MolfileFrame>> mfPrefetcher;
+  if(readTrajectory && prefetch>0 && use_molfile) mfPrefetcher=Tools::make_unique<Prefetcher<MolfileFrame>>(prefetch,readMolfile);
+#endif
+  XdrFrame xdrframe;
+  std::unique_ptr<Prefetcher<XdrFrame>> xdrPrefetcher;
+  if(readTrajectory && prefetch>0 && (trajectory_fmt=="xdr-xtc" || trajectory_fmt=="xdr-trr")) {
+    xdrPrefetcher=Tools::make_unique<Prefetcher<XdrFrame>>(prefetch,readXdr);
+  }
+  LineBlock lineblock;
+  std::size_t nextline=0;
+  std::unique_ptr<Prefetcher<LineBlock>> linePrefetcher;
+  if(readTrajectory && prefetch>0 && (trajectory_fmt=="xyz" || trajectory_fmt=="gro" || trajectory_fmt=="dlp4")) {
+    linePrefetcher=Tools::make_unique<Prefetcher<LineBlock>>(prefetch,readLines);
+  }
+  auto readLine=[&](std::string & l) {
+    if(!linePrefetcher) return Tools::getline(fp,l);
+    if(nextline==lineblock.nlines) {
+      if(!linePrefetcher->next(lineblock)) return false;
+      nextline=0;
+    }
+    l.swap(lineblock.lines[nextline++]);
+    return true;
+  };
+
   std::string line;
   std::vector<real> coordinates;
   std::vector<real> forces;
@@ -649,32 +931,30 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
   Random rnd;
 
   if(trajectory_fmt=="dlp4") {
-    if(!Tools::getline(fp,line)) error("error reading title");
-    if(!Tools::getline(fp,line)) error("error reading atoms");
+    if(!readLine(line)) error("error reading title");
+    if(!readLine(line)) error("error reading atoms");
     std::sscanf(line.c_str(),"%d %d %d",&lvl,&pb,&natoms);
 
   }
   bool lstep=true;
+  long long int nframe=0;
   while(true) {
     if(!noatoms&&!parseOnly) {
       if(use_molfile==true) {
 #ifdef __PLUMED_HAS_MOLFILE_PLUGINS
-        std::unique_ptr<std::lock_guard<std::mutex>> lck;
-        if(api->is_reentrant==VMDPLUGIN_THREADUNSAFE) lck=Tools::molfile_lock();
-        int rc;
-        rc = api->read_next_timestep(h_in, natoms, &ts_in);
-        if(rc==MOLFILE_EOF) {
+        bool ok=mfPrefetcher ? mfPrefetcher->next(mfframe) : readMolfile(mfframe);
+        if(!ok) {
           break;
         }
 #endif
       } else if(trajectory_fmt=="xyz" || trajectory_fmt=="gro" || trajectory_fmt=="dlp4") {
-        if(!Tools::getline(fp,line)) break;
+        if(!readLine(line)) break;
       }
     }
     bool first_step=false;
     if(!noatoms&&!parseOnly) {
       if(use_molfile==false && (trajectory_fmt=="xyz" || trajectory_fmt=="gro")) {
-        if(trajectory_fmt=="gro") if(!Tools::getline(fp,line)) error("premature end of trajectory file");
+        if(trajectory_fmt=="gro") if(!readLine(line)) error("premature end of trajectory file");
         std::sscanf(line.c_str(),"%100d",&natoms);
       }
       if(use_molfile==false && trajectory_fmt=="dlp4") {
@@ -941,25 +1221,20 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
         }
 #endif
       } else if(trajectory_fmt=="xdr-xtc" || trajectory_fmt=="xdr-trr") {
-        int localstep;
-        float time;
-        xdrfile::matrix box;
-// here we cannot use a std::vector<rvec> since it does not compile.
-// we thus use a std::unique_ptr<rvec[]>
-        auto pos=Tools::make_unique<xdrfile::rvec[]>(natoms);
-        float prec,lambda;
-        int ret=xdrfile::exdrOK;
-        if(trajectory_fmt=="xdr-xtc") ret=xdrfile::read_xtc(xd,natoms,&localstep,&time,box,pos.get(),&prec);
-        if(trajectory_fmt=="xdr-trr") ret=xdrfile::read_trr(xd,natoms,&localstep,&time,&lambda,box,pos.get(),NULL,NULL);
-        if(stride==0) step=localstep;
-        if(ret==xdrfile::exdrENDOFFILE) break;
-        if(ret!=xdrfile::exdrOK) break;
-        for(unsigned i=0; i<3; i++) for(unsigned j=0; j<3; j++) cell[3*i+j]=box[i][j];
+        if(xdrPrefetcher) {
+          if(!xdrPrefetcher->next(xdrframe)) break;
+        } else {
+          readXdr(xdrframe);
+        }
+        if(stride==0) step=xdrframe.step;
+        if(xdrframe.ret==xdrfile::exdrENDOFFILE) break;
+        if(xdrframe.ret!=xdrfile::exdrOK) break;
+        for(unsigned i=0; i<3; i++) for(unsigned j=0; j<3; j++) cell[3*i+j]=xdrframe.box[i][j];
         for(int i=0; i<natoms; i++) for(unsigned j=0; j<3; j++)
-            coordinates[3*i+j]=real(pos[i][j]);
+            coordinates[3*i+j]=real(xdrframe.pos[i][j]);
       } else {
         if(trajectory_fmt=="xyz") {
-          if(!Tools::getline(fp,line)) error("premature end of trajectory file");
+          if(!readLine(line)) error("premature end of trajectory file");
 
           std::vector<double> celld(9,0.0);
           if(pbc_cli_given==false) {
@@ -988,11 +1263,11 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
         if(trajectory_fmt=="dlp4") {
           std::vector<double> celld(9,0.0);
           if(pbc_cli_given==false) {
-            if(!Tools::getline(fp,line)) error("error reading vector a of cell");
+            if(!readLine(line)) error("error reading vector a of cell");
             std::sscanf(line.c_str(),"%lf %lf %lf",&celld[0],&celld[1],&celld[2]);
-            if(!Tools::getline(fp,line)) error("error reading vector b of cell");
+            if(!readLine(line)) error("error reading vector b of cell");
             std::sscanf(line.c_str(),"%lf %lf %lf",&celld[3],&celld[4],&celld[5]);
-            if(!Tools::getline(fp,line)) error("error reading vector c of cell");
+            if(!readLine(line)) error("error reading vector c of cell");
             std::sscanf(line.c_str(),"%lf %lf %lf",&celld[6],&celld[7],&celld[8]);
           } else {
             celld=pbc_cli_box;
@@ -1002,7 +1277,7 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
         int ddist=0;
         // Read coordinates
         for(int i=0; i<natoms; i++) {
-          bool ok=Tools::getline(fp,line);
+          bool ok=readLine(line);
           if(!ok) error("premature end of trajectory file");
           double cc[3];
           if(trajectory_fmt=="xyz") {
@@ -1035,16 +1310,16 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
             std::sscanf(line.c_str(),"%8s %d %lf %lf",dummy,&idummy,&m,&c);
             masses[i]=real(m);
             charges[i]=real(c);
-            if(!Tools::getline(fp,line)) error("error reading coordinates");
+            if(!readLine(line)) error("error reading coordinates");
             std::sscanf(line.c_str(),"%lf %lf %lf",&cc[0],&cc[1],&cc[2]);
             cc[0]*=0.1;
             cc[1]*=0.1;
             cc[2]*=0.1;
             if(lvl>0) {
-              if(!Tools::getline(fp,line)) error("error skipping velocities");
+              if(!readLine(line)) error("error skipping velocities");
             }
             if(lvl>1) {
-              if(!Tools::getline(fp,line)) error("error skipping forces");
+              if(!readLine(line)) error("error skipping forces");
             }
           } else plumed_error();
           if(!debug_pd || ( i>=pd_start && i<pd_start+pd_nlocal) ) {
@@ -1054,7 +1329,7 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
           }
         }
         if(trajectory_fmt=="gro") {
-          if(!Tools::getline(fp,line)) error("premature end of trajectory file");
+          if(!readLine(line)) error("premature end of trajectory file");
           std::vector<std::string> words=Tools::getWords(line);
           if(words.size()<3) error("cannot understand box format");
           Tools::convert(words[0],cell[0]);
@@ -1070,6 +1345,16 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
 
       }
 
+// frames before --first-frame are skipped and in a frame parallel run the frames are assigned to the processes in turn.
+// When the frames are located with the index this is already done while reading
+      if(!xdrSeek) {
+        long long int iframe=nframe++;
+        if(iframe<firstframe || (frameparallel && (iframe-firstframe)%pc.Get_size()!=pc.Get_rank())) {
+          step+=stride;
+          continue;
+        }
+      }
+
       p.cmd("setStepLongLong",step);
       p.cmd("setStopFlag",&plumedStopCondition);
 
@@ -1156,7 +1441,30 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
       for(int i=0; i<natoms; i++)
         std::fprintf(fp_forces,fmt.c_str(),forces[3*i],forces[3*i+1],forces[3*i+2]);
     }
-    if(debugforces.length()>0) {
+    if(debugforces.length()>0 && debugdirections>0) {
+      // The directions are random unit vectors that are the same on every step
+      Random rnd; rnd.setSeed(-1);
+      std::vector<real> directions( 3*natoms*debugdirections );
+      for(unsigned d=0; d<debugdirections; ++d) {
+        real norm=0;
+        for(int i=0; i<3*natoms; ++i) { directions[3*natoms*d+i]=rnd.Gaussian(); norm+=directions[3*natoms*d+i]*directions[3*natoms*d+i]; }
+        norm=1.0/std::sqrt(norm);
+        for(int i=0; i<3*natoms; ++i) directions[3*natoms*d+i]*=norm;
+      }
+      numder.assign(debugdirections,real(0.0));
+      evaluateDirectionalDerivatives( step, p, coordinates, masses, charges, cell, directions, numder );
+
+      // And output the projections of the forces on each direction
+      fp_dforces.fmtField(" " + dumpforcesFmt);
+      for(unsigned d=0; d<debugdirections; ++d) {
+        real proj=0;
+        for(int i=0; i<3*natoms; ++i) proj+=forces[i]*directions[3*natoms*d+i];
+        fp_dforces.printField("direction",(int)d);
+        fp_dforces.printField("analytical",proj);
+        fp_dforces.printField("numerical",-numder[d]);
+        fp_dforces.printField();
+      }
+    } else if(debugforces.length()>0) {
       // Now call the routine to work out the derivatives numerically
       numder.assign(3*natoms+9,real(0.0)); real base=0;
       p.cmd("getBias",&base);
@@ -1182,10 +1490,34 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
 
     if(plumedStopCondition) break;
 
-    step+=stride;
+    step+=stride*xdrFrameIncrement;
   }
   if(!parseOnly) p.cmd("runFinalJobs");
 
+  if(frameparallel) {
+// merge the files written by the processes
+    p.fflush();
+    pc.Barrier();
+    if(pc.Get_rank()==0) {
+      for(const auto & path : p.getOutputFilePaths()) {
+        std::string base=removeSuffix(path,p.getSuffix());
+        if(base.length()==0) continue;
+        std::vector<std::string> inputs(pc.Get_size());
+        for(int i=0; i<pc.Get_size(); i++) {
+          std::string n; Tools::convert(i,n);
+          inputs[i]=FileBase::appendSuffix(base,"."+n);
+        }
+        if(mergeFrameParallelFiles(inputs,base)) {
+          std::fprintf(out,"DRIVER: merged the output of all processes in %s\n",base.c_str());
+          for(const auto & i : inputs) std::remove(i.c_str());
+        } else {
+          std::fprintf(out,"DRIVER: the output of %s cannot be merged and is left in one file per process\n",base.c_str());
+        }
+      }
+    }
+    pc.Barrier();
+  }
+
   return 0;
 }
 
@@ -1246,6 +1578,33 @@ void Driver<real>::evaluateNumericalDerivatives( const long long int& step, Plum
   for(unsigned i=0; i<3; i++) for(unsigned k=0; k<3; k++)  numder[3*natoms+3*i+k] = nvirial(i,k);
 
 }
+template<typename real>
+void Driver<real>::evaluateDirectionalDerivatives( const long long int& step, PlumedMain& p, const std::vector<real>& coordinates,
+    const std::vector<real>& masses, const std::vector<real>& charges,
+    std::vector<real>& cell, const std::vector<real>& directions, std::vector<real>& numder ) {
+
+  // Central differences are used so that the error is second order in the displacement
+  int natoms = coordinates.size() / 3; real delta = std::cbrt(epsilon);
+  std::vector<real> pos( 3*natoms ), fake_forces( 3*natoms ), fake_virial(9); real bias[2];
+
+  for(unsigned d=0; d<numder.size(); ++d) {
+    for(unsigned n=0; n<2; ++n) {
+      const real sign = n==0 ? 1.0 : -1.0;
+      for(int i=0; i<3*natoms; ++i) pos[i] = coordinates[i] + sign*delta*directions[3*natoms*d+i];
+      p.cmd("setStepLongLong",step);
+      p.cmd("setPositions",&pos[0], {natoms,3});
+      p.cmd("setForces",&fake_forces[0], {natoms,3});
+      p.cmd("setMasses",&masses[0], {natoms});
+      p.cmd("setCharges",&charges[0], {natoms});
+      p.cmd("setBox",&cell[0], {3,3});
+      p.cmd("setVirial",&fake_virial[0], {3,3});
+      p.cmd("prepareCalc");
+      p.cmd("performCalcNoUpdate");
+      p.cmd("getBias",&bias[n]);
+    }
+    numder[d] = ( bias[0] - bias[1] ) / ( 2*delta );
+  }
+}
 
 }
 }
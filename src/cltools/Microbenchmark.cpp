@@ -0,0 +1,459 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "CLTool.h"
+#include "core/CLToolRegister.h"
+#include "core/Value.h"
+#include "core/ActionRegister.h"
+#include "core/PlumedMain.h"
+#include "tools/Communicator.h"
+#include "tools/Tools.h"
+#include "tools/Vector.h"
+#include "tools/Tensor.h"
+#include "tools/Random.h"
+#include "tools/Pbc.h"
+#include "tools/SwitchingFunction.h"
+#include "tools/LinkCells.h"
+#include "tools/NeighborList.h"
+#include "tools/RMSD.h"
+#include "tools/Grid.h"
+#include "tools/KernelFunctions.h"
+#include "tools/LeptonCall.h"
+#include "tools/AtomNumber.h"
+
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+
+namespace PLMD {
+namespace cltools {
+
+//+PLUMEDOC TOOLS microbenchmark
+/*
+microbenchmark times the low level kernels of the tools library in isolation
+
+Whereas \ref benchmark measures the time spent by PLUMED on a complete input file,
+this tool measures single kernels of the tools library on synthetic data.
+It can thus be used to evaluate a change to one of these kernels without the
+noise introduced by the rest of the calculation.
+
+The following cases are available:
+- `switching`: SwitchingFunction::calculateSqr for each of the switching function types.
+- `pbc`: Pbc::distance with no box, an orthorhombic box and a triclinic box.
+- `linkcells`: construction of the link cells and search of the neighbors of each atom.
+- `neighborlist`: NeighborList::update, with and without periodic boundary conditions.
+- `rmsd`: RMSD::calculate with the SIMPLE and OPTIMAL alignments.
+- `grid`: Grid::getValueAndDerivatives on a two dimensional grid, with and without splines.
+- `kernelfunctions`: KernelFunctions::evaluate for a two dimensional Gaussian.
+- `lepton`: evaluation of a compiled Lepton expression and of its derivative.
+- `vector`: elementary Vector and Tensor operations.
+- `startup`: construction of the keywords of the registered actions, both from scratch and
+  from the cache used when actions are created, and initialization of an empty PlumedMain
+  (at most 100 per repetition).
+
+Every case is run for each of the sizes given with `--sizes`, which are
+the number of atoms, pairs or points processed in a repetition.
+After a warm-up repetition, `--repeats` repetitions are timed and
+the median time per element is reported together with the minimum and the
+median absolute deviation, which are less sensitive to outliers than the mean and the standard deviation.
+
+\par Examples
+
+Time all the kernels:
+\verbatim
+plumed microbenchmark
+\endverbatim
+
+Time only the switching functions and the neighbor lists, with two sizes, and save the results:
+\verbatim
+plumed microbenchmark --cases switching:neighborlist --sizes 1000:100000 --report micro.csv
+\endverbatim
+
+The report is written in JSON format if the file name ends with `.json` and in CSV format otherwise.
+
+*/
+//+ENDPLUMEDOC
+
+class Microbenchmark:
+  public CLTool
+{
+public:
+  static void registerKeywords( Keywords& keys );
+  explicit Microbenchmark(const CLToolOptions& co );
+  int main(FILE* in, FILE*out,Communicator& pc) override;
+  std::string description()const override {
+    return "time the low level kernels of the tools library";
+  }
+};
+
+PLUMED_REGISTER_CLTOOL(Microbenchmark,"microbenchmark")
+
+void Microbenchmark::registerKeywords( Keywords& keys ) {
+  CLTool::registerKeywords( keys );
+  keys.add("compulsory","--cases","all","colon separated list of cases (switching, pbc, linkcells, neighborlist, rmsd, grid, kernelfunctions, lepton, vector, startup) or all");
+  keys.add("compulsory","--sizes","1000:10000","colon separated list of sizes");
+  keys.add("compulsory","--repeats","10","number of timed repetitions");
+  keys.add("compulsory","--seed","1234","seed for the random number generator");
+  keys.add("optional","--report","write a machine readable report on this file (JSON if the name ends with .json, CSV otherwise)");
+}
+
+Microbenchmark::Microbenchmark(const CLToolOptions& co ):
+  CLTool(co)
+{
+  inputdata=commandline;
+}
+
+namespace {
+
+/// Result of a timed case
+struct Result {
+  std::string name;
+  std::string variant;
+  unsigned size=0;
+  /// times per element in nanoseconds
+  double median=0.0;
+  double min=0.0;
+  double mad=0.0;
+};
+
+/// Prevents the compiler from removing the timed calculations
+volatile double sink=0.0;
+
+/// Run a case once for warm-up and then repeats times, returning the statistics of the time per element
+Result timeCase(const std::string & name,const std::string & variant,unsigned size,unsigned repeats,const std::function<double()> & run) {
+  Result r;
+  r.name=name;
+  r.variant=variant;
+  r.size=size;
+  sink=sink+run();
+  std::vector<double> times(repeats);
+  for(unsigned i=0; i<repeats; i++) {
+    const auto start=std::chrono::high_resolution_clock::now();
+    sink=sink+run();
+    times[i]=std::chrono::duration<double,std::nano>(std::chrono::high_resolution_clock::now()-start).count()/size;
+  }
+  std::sort(times.begin(),times.end());
+  r.min=times[0];
+  r.median=times[repeats/2];
+  std::vector<double> dev(repeats);
+  for(unsigned i=0; i<repeats; i++) dev[i]=std::fabs(times[i]-r.median);
+  std::sort(dev.begin(),dev.end());
+  r.mad=dev[repeats/2];
+  return r;
+}
+
+/// Random positions in a cubic box with one atom per unit volume
+std::vector<Vector> randomPositions(unsigned n,Random & rng,double side) {
+  std::vector<Vector> pos(n);
+  for(auto & p : pos) p=Vector(rng.RandU01()*side,rng.RandU01()*side,rng.RandU01()*side);
+  return pos;
+}
+
+Pbc makePbc(const std::string & type,double side) {
+  Pbc pbc;
+  Tensor box;
+  if(type=="orthorhombic") {
+    box=Tensor(side,0,0,0,side,0,0,0,side);
+  } else if(type=="triclinic") {
+    box=Tensor(side,0,0,0.3*side,side,0,0.2*side,0.1*side,side);
+  }
+  pbc.setBox(box);
+  return pbc;
+}
+
+}
+
+int Microbenchmark::main(FILE* in, FILE*out,Communicator& pc) {
+  std::string casesString,sizesString,reportFile;
+  unsigned repeats;
+  int seed;
+  parse("--cases",casesString);
+  parse("--sizes",sizesString);
+  parse("--repeats",repeats);
+  parse("--seed",seed);
+  parse("--report",reportFile);
+  plumed_massert(repeats>0,"--repeats should be positive");
+
+  const std::vector<std::string> allCases= {"switching","pbc","linkcells","neighborlist","rmsd","grid","kernelfunctions","lepton","vector","startup"};
+  std::vector<std::string> cases=(casesString=="all"?allCases:Tools::getWords(casesString,":"));
+  for(const auto & c : cases) plumed_massert(std::find(allCases.begin(),allCases.end(),c)!=allCases.end(),"unknown case " + c);
+  std::vector<unsigned> sizes;
+  for(const auto & w : Tools::getWords(sizesString,":")) {
+    unsigned s;
+    plumed_massert(Tools::convertNoexcept(w,s) && s>0,"cannot parse size " + w);
+    sizes.push_back(s);
+  }
+
+  auto has=[&](const std::string & name) {return std::find(cases.begin(),cases.end(),name)!=cases.end();};
+
+  // a single process is used, so that the kernels are timed in isolation
+  Communicator serial;
+  std::vector<Result> results;
+  for(auto size : sizes) {
+    Random rng;
+    rng.setSeed(-seed);
+    const double side=std::cbrt(double(size));
+
+    if(has("switching")) {
+      std::vector<double> d2(size),res(size),dfunc(size);
+      for(auto & d : d2) d=rng.RandU01()*1.5;
+      const std::vector<std::string> definitions= {
+        "RATIONAL R_0=0.5","RATIONAL R_0=0.5 NN=8 MM=16","EXP R_0=0.5","GAUSSIAN R_0=0.5","SMAP R_0=0.5 A=8 B=8",
+        "CUBIC D_0=0.0 D_MAX=1.0","TANH R_0=0.5","COSINUS R_0=1.0","CUSTOM FUNC=1/(1+x^6) R_0=0.5"
+      };
+      for(const auto & definition : definitions) {
+        SwitchingFunction sf;
+        std::string errors;
+        sf.set(definition,errors);
+        plumed_massert(errors.length()==0,"problem with switching function " + definition + ": " + errors);
+        results.push_back(timeCase("switching",definition,size,repeats,[&]() {
+          sf.calculateSqr(d2.data(),res.data(),dfunc.data(),size);
+          return res[0]+dfunc[size-1];
+        }));
+      }
+    }
+
+    if(has("pbc")) {
+      auto pos=randomPositions(size+1,rng,side);
+      for(const std::string type : {"none","orthorhombic","triclinic"}) {
+        auto pbc=makePbc(type,side);
+        results.push_back(timeCase("pbc",type,size,repeats,[&]() {
+          double s=0.0;
+          for(unsigned i=0; i<size; i++) s+=pbc.distance(pos[i],pos[i+1])[0];
+          return s;
+        }));
+      }
+    }
+
+    if(has("linkcells")) {
+      auto pos=randomPositions(size,rng,side);
+      auto pbc=makePbc("orthorhombic",side);
+      std::vector<unsigned> indices(size);
+      for(unsigned i=0; i<size; i++) indices[i]=i;
+      LinkCells linkcells(serial);
+      linkcells.setCutoff(1.0);
+      std::vector<unsigned> cell_list,atoms(size);
+      results.push_back(timeCase("linkcells","build",size,repeats,[&]() {
+        linkcells.buildCellLists(pos,indices,pbc);
+        return double(linkcells.getMaxInCell());
+      }));
+      results.push_back(timeCase("linkcells","neighbors",size,repeats,[&]() {
+        double s=0.0;
+        for(unsigned i=0; i<size; i++) {
+          unsigned natoms=1;
+          atoms[0]=i;
+          linkcells.retrieveNeighboringAtoms(pos[i],cell_list,natoms,atoms);
+          s+=natoms;
+        }
+        return s;
+      }));
+    }
+
+    if(has("neighborlist")) {
+      auto pos=randomPositions(size,rng,side);
+      std::vector<AtomNumber> list(size);
+      for(unsigned i=0; i<size; i++) list[i].setIndex(i);
+      for(const std::string type : {"none","orthorhombic"}) {
+        auto pbc=makePbc(type,side);
+        NeighborList nl(list,true,type!="none",pbc,serial,1.0);
+        results.push_back(timeCase("neighborlist",type,size,repeats,[&]() {
+          nl.update(pos);
+          return double(nl.size());
+        }));
+      }
+    }
+
+    if(has("rmsd")) {
+      auto reference=randomPositions(size,rng,side);
+      auto pos=randomPositions(size,rng,side);
+      std::vector<double> weights(size,1.0);
+      std::vector<Vector> derivatives(size);
+      for(const std::string type : {"SIMPLE","OPTIMAL"}) {
+        RMSD rmsd;
+        rmsd.set(weights,weights,reference,type);
+        results.push_back(timeCase("rmsd",type,size,repeats,[&]() {
+          return rmsd.calculate(pos,derivatives);
+        }));
+      }
+    }
+
+    if(has("grid")) {
+      std::vector<std::vector<double>> points(size,std::vector<double>(2));
+      for(auto & p : points) {
+        p[0]=rng.RandU01()*2.0-1.0;
+        p[1]=rng.RandU01()*2.0-1.0;
+      }
+      for(const bool spline : {false,true}) {
+        Grid grid("grid",{"x","y"}, {"-1.0","-1.0"}, {"1.0","1.0"}, {100,100},spline,true, {false,false}, {"0","0"}, {"0","0"});
+        std::vector<double> der(2);
+        for(Grid::index_t i=0; i<grid.getSize(); i++) {
+          auto x=grid.getPoint(i);
+          der[0]=-2.0*x[0]; der[1]=-2.0*x[1];
+          grid.setValueAndDerivatives(i,1.0-x[0]*x[0]-x[1]*x[1],der);
+        }
+        results.push_back(timeCase("grid",(spline?"spline":"nearest"),size,repeats,[&]() {
+          double s=0.0;
+          for(const auto & p : points) s+=grid.getValueAndDerivatives(p,der);
+          return s;
+        }));
+      }
+    }
+
+    if(has("kernelfunctions")) {
+      KernelFunctions kernel({0.0,0.0}, {0.3,0.2},"gaussian","DIAGONAL",1.0);
+      Value x("x"),y("y");
+      x.setNotPeriodic();
+      y.setNotPeriodic();
+      std::vector<Value*> args= {&x,&y};
+      std::vector<double> der(2);
+      std::vector<double> xs(size),ys(size);
+      for(unsigned i=0; i<size; i++) {
+        xs[i]=rng.RandU01()*2.0-1.0;
+        ys[i]=rng.RandU01()*2.0-1.0;
+      }
+      results.push_back(timeCase("kernelfunctions","gaussian",size,repeats,[&]() {
+        double s=0.0;
+        for(unsigned i=0; i<size; i++) {
+          x.set(xs[i]);
+          y.set(ys[i]);
+          s+=kernel.evaluate(args,der);
+        }
+        return s;
+      }));
+    }
+
+    if(has("lepton")) {
+      LeptonCall lepton;
+      lepton.set("exp(-x^2)*cos(y)+x*y", {"x","y"});
+      std::vector<std::vector<double>> args(size,std::vector<double>(2));
+      for(auto & a : args) {
+        a[0]=rng.RandU01();
+        a[1]=rng.RandU01();
+      }
+      results.push_back(timeCase("lepton","value",size,repeats,[&]() {
+        double s=0.0;
+        for(const auto & a : args) s+=lepton.evaluate(a);
+        return s;
+      }));
+      results.push_back(timeCase("lepton","derivative",size,repeats,[&]() {
+        double s=0.0;
+        for(const auto & a : args) s+=lepton.evaluateDeriv(0,a);
+        return s;
+      }));
+    }
+
+    if(has("vector")) {
+      auto a=randomPositions(size,rng,1.0);
+      auto b=randomPositions(size,rng,1.0);
+      Tensor t(1.0,0.1,0.2,0.3,1.0,0.4,0.5,0.6,1.0);
+      results.push_back(timeCase("vector","dot",size,repeats,[&]() {
+        double s=0.0;
+        for(unsigned i=0; i<size; i++) s+=dotProduct(a[i],b[i]);
+        return s;
+      }));
+      results.push_back(timeCase("vector","cross",size,repeats,[&]() {
+        Vector s;
+        for(unsigned i=0; i<size; i++) s+=crossProduct(a[i],b[i]);
+        return s[0];
+      }));
+      results.push_back(timeCase("vector","modulo",size,repeats,[&]() {
+        double s=0.0;
+        for(unsigned i=0; i<size; i++) s+=modulo(a[i]);
+        return s;
+      }));
+      results.push_back(timeCase("vector","matmul",size,repeats,[&]() {
+        Vector s;
+        for(unsigned i=0; i<size; i++) s+=matmul(t,a[i]);
+        return s[0];
+      }));
+      results.push_back(timeCase("vector","extProduct",size,repeats,[&]() {
+        Tensor s;
+        for(unsigned i=0; i<size; i++) s+=extProduct(a[i],b[i]);
+        return s[0][0];
+      }));
+    }
+
+    if(has("startup")) {
+      const auto names=actionRegister().getActionNames();
+      const std::vector<void*> images;
+      results.push_back(timeCase("startup","keywords-build",size,repeats,[&]() {
+        double s=0.0;
+        for(unsigned i=0; i<size; i++) {
+          Keywords keys;
+          actionRegister().get(names[i%names.size()]).keys(keys);
+          s+=keys.size();
+        }
+        return s;
+      }));
+      results.push_back(timeCase("startup","keywords-cached",size,repeats,[&]() {
+        double s=0.0;
+        for(unsigned i=0; i<size; i++) s+=actionRegister().getCachedKeywords(images,names[i%names.size()]).size();
+        return s;
+      }));
+      const unsigned ninit=std::min(size,100u);
+      results.push_back(timeCase("startup","plumedmain-init",ninit,repeats,[&]() {
+        for(unsigned i=0; i<ninit; i++) {
+          PlumedMain p;
+          int natoms=1;
+          p.cmd("setNatoms",&natoms);
+          p.cmd("setLogFile","/dev/null");
+          p.cmd("init");
+        }
+        return 0.0;
+      }));
+    }
+  }
+
+  std::fprintf(out,"%-14s %-32s %10s %14s %14s %14s\n","case","variant","size","median(ns)","min(ns)","mad(ns)");
+  for(const auto & r : results) {
+    std::fprintf(out,"%-14s %-32s %10u %14.3f %14.3f %14.3f\n",r.name.c_str(),r.variant.c_str(),r.size,r.median,r.min,r.mad);
+  }
+
+  if(reportFile.length()>0 && pc.Get_rank()==0) {
+    const bool json=reportFile.length()>=5 && reportFile.substr(reportFile.length()-5)==".json";
+    std::ofstream ofile(reportFile);
+    plumed_massert(ofile,"cannot open report file " + reportFile);
+    char buffer[256];
+    if(json) ofile<<"{\n  \"results\": [";
+    else ofile<<"case,variant,size,median_ns,min_ns,mad_ns\n";
+    for(unsigned i=0; i<results.size(); i++) {
+      const auto & r(results[i]);
+      if(json) {
+        std::snprintf(buffer,sizeof(buffer),"%s\n    {\"case\": \"%s\", \"variant\": \"%s\", \"size\": %u, \"median_ns\": %.6f, \"min_ns\": %.6f, \"mad_ns\": %.6f}",
+                      (i>0?",":""),r.name.c_str(),r.variant.c_str(),r.size,r.median,r.min,r.mad);
+      } else {
+        std::snprintf(buffer,sizeof(buffer),"%s,\"%s\",%u,%.6f,%.6f,%.6f\n",r.name.c_str(),r.variant.c_str(),r.size,r.median,r.min,r.mad);
+      }
+      ofile<<buffer;
+    }
+    if(json) ofile<<"\n  ]\n}\n";
+  }
+  return 0;
+}
+
+} // End of namespace
+}
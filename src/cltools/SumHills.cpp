@@ -34,6 +34,7 @@
 #include "tools/File.h"
 #include "core/Value.h"
 #include "tools/Matrix.h"
+#include "tools/HillsBinaryFile.h"
 
 namespace PLMD {
 namespace cltools {
@@ -91,6 +92,11 @@ plumed sum_hills --bin 99,99 --min -pi,-pi --max pi,pi --hills PATHTOMYHILLSFILE
 
 You can of course use numbers instead of -pi/pi.
 
+The hills files can also be the binary files that are written by \ref METAD with the BINARY_FILE keyword.
+These are recognized automatically and are read much faster than the text files.
+The hills are added on the grid as soon as they are read and are then discarded, so that the memory needed does not depend on the length of the
+file, and the evaluation of each hill on the grid is shared between the MPI processes and the OpenMP threads.
+
 You can use a --stride keyword to have a dump each bunch of hills you read
 \verbatim
 plumed sum_hills --stride 300 --hills PATHTOMYHILLSFILE
@@ -536,7 +542,25 @@ bool CLToolSumHills::findCvsAndPeriodic(const std::string & filename, std::vecto
   IFile ifile;
   ifile.allowIgnoredFields();
   std::vector<std::string> fields;
-  if(ifile.FileExist(filename)) {
+  if(ifile.FileExist(filename) && HillsBinaryFile::isBinary(filename)) {
+    // the names and the periodicity of the variables are in the header of binary files
+    HillsBinaryFile bfile; bfile.open(filename);
+    cvs.clear(); pmin.clear(); pmax.clear();
+    for(const auto & v : bfile.getVariables()) {
+      std::vector<std::string> ss;
+      size_t dot=v.name.find_first_of('.');
+      if(dot!=std::string::npos) { ss.push_back(v.name.substr(0,dot)); ss.push_back(v.name.substr(dot+1)); }
+      else ss.push_back(v.name);
+      cvs.push_back(ss);
+      pmin.push_back(v.periodic ? v.min : "none");
+      pmax.push_back(v.periodic ? v.max : "none");
+    }
+    HillsBinaryFile::Record rec;
+    multivariate=bfile.read(rec) && rec.multivariate;
+    lowI_="-1.";
+    uppI_="-1.";
+    return true;
+  } else if(ifile.FileExist(filename)) {
     cvs.clear(); pmin.clear(); pmax.clear();
     ifile.open(filename);
     ifile.scanFieldList(fields);
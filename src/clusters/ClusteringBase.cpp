@@ -76,12 +76,9 @@ void ClusteringBase::calculate() {
   // Order the clusters in the system by size (this returns ascending order )
   std::sort( cluster_sizes.begin(), cluster_sizes.end() );
   // Set the elements of the value to the cluster identies
-  for(unsigned i=0; i<cluster_sizes.size(); ++i) {
-    double this_size = static_cast<double>(cluster_sizes.size()-i);
-    for(unsigned j=0; j<cluster_sizes.size(); ++j) {
-      if( which_cluster[j]==cluster_sizes[i].second ) getPntrToValue()->set( j, this_size );
-    }
-  }
+  if( cluster_rank.size()!=cluster_sizes.size() ) cluster_rank.resize( cluster_sizes.size() );
+  for(unsigned i=0; i<cluster_sizes.size(); ++i) cluster_rank[cluster_sizes[i].second] = cluster_sizes.size()-i;
+  for(unsigned j=0; j<which_cluster.size(); ++j) getPntrToValue()->set( j, static_cast<double>( cluster_rank[which_cluster[j]] ) );
 }
 
 void ClusteringBase::apply() {
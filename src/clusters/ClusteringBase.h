@@ -36,6 +36,8 @@ protected:
   int number_of_cluster;
 /// Vector that identifies the cluster each atom belongs to
   std::vector<unsigned> which_cluster;
+/// The position of each cluster in the list of clusters ordered by size
+  std::vector<unsigned> cluster_rank;
 /// Get the number of nodes
   unsigned getNumberOfNodes() const ;
 /// Get the neighbour list based on the adjacency matrix
@@ -21,6 +21,10 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "ClusteringBase.h"
 #include "core/ActionRegister.h"
+#include "tools/Communicator.h"
+#include "tools/OpenMP.h"
+#include <algorithm>
+#include <iterator>
 
 #ifdef __PLUMED_HAS_BOOST_GRAPH
 #include <boost/graph/adjacency_list.hpp>
@@ -43,6 +47,19 @@ https://en.wikipedia.org/wiki/Depth-first_search
 This action is useful if you are looking at a phenomenon such as nucleation where the aim is to detect the sizes of the crystalline nuclei that have formed
 in your simulation cell.
 
+Unless PLUMED has been compiled with the boost graph library the connected components are not found with a depth first search but with
+a union-find (disjoint set) algorithm that works directly on the non-zero elements of the matrix.  The rows of the matrix are divided between
+the OpenMP threads and MPI processes and the partial forests that are found by each of them are merged at the end.  Clusters are numbered in
+the same way as in a depth first search so the output is unchanged.  Use the SERIAL flag to do this calculation on a single thread.
+
+If the INCREMENTAL flag is used the list of edges from the previous step is stored.  On each step only the clusters that contain
+atoms that have gained or lost a bond are searched again.  Each cluster is also given an identifier that is kept for as long as the
+cluster exists.  When two clusters merge the new cluster keeps the identifier that was held by most of its atoms and when a cluster splits
+the largest fragment keeps the identifier.  These identifiers are used to order clusters that have the same size so the numbering of the
+clusters in the output does not change from one step to the next when clusters only have the same size by chance.
+If more than half of the edges change, the clusters are found from scratch and the identifiers are carried over by looking at
+which cluster each atom was in beforehand.
+
 \par Examples
 
 The input below calculates the coordination numbers of atoms 1-100 and then computes the an adjacency
@@ -69,14 +86,36 @@ namespace clusters {
 class DFSClustering : public ClusteringBase {
 private:
 #ifndef __PLUMED_HAS_BOOST_GRAPH
-/// The number of neighbors each atom has
-  std::vector<unsigned> nneigh;
-/// The adjacency list
-  Matrix<unsigned> adj_list;
-/// The color that tells us whether a node has been visited
-  std::vector<unsigned> color;
-/// The recursive function at the heart of this method
-  int explore( const unsigned& index );
+  bool serial;
+/// The parent of each node in the disjoint set forest
+  std::vector<unsigned> parent;
+/// The forests found by all the MPI processes
+  std::vector<unsigned> all_parents;
+/// Find the root of the tree that contains a node.  The root is always the lowest numbered node in the tree
+  static unsigned findRoot( std::vector<unsigned>& forest, unsigned i );
+/// Merge the trees that contain two nodes
+  static void join( std::vector<unsigned>& forest, unsigned i, unsigned j );
+/// Find the connected components and number them in order of their lowest numbered node
+  void findComponents();
+/// Are we updating the clusters incrementally and is this the first step
+  bool incremental, firststep;
+/// The sorted lists of edges on this step and the previous step and the edges that differ between them
+  std::vector<std::pair<unsigned,unsigned> > edges, old_edges, changed;
+/// The identifier of the cluster that each node is in, the number of nodes with each identifier and the unused identifiers
+  std::vector<unsigned> cluster_id, id_size, free_ids;
+/// The adjacency lists of the graph in compressed sparse row format
+  std::vector<unsigned> adj_start, adj;
+/// The components that are being given identifiers
+  std::vector<unsigned> comp_start, comp_nodes;
+/// Work arrays for the searches over the components that have changed
+  std::vector<unsigned> visited, claimed, id_count, touched;
+  unsigned stamp;
+/// Get the sorted list of edges from the matrix
+  void retrieveSortedEdges();
+/// Give identifiers to the components in comp_start and comp_nodes
+  void assignIdentifiers();
+/// Update the clusters using the edges that have changed since the last step
+  void updateClusters();
 #endif
 public:
 /// Create manual
@@ -92,6 +131,8 @@ PLUMED_REGISTER_ACTION(DFSClustering,"DFSCLUSTERING")
 void DFSClustering::registerKeywords( Keywords& keys ) {
   ClusteringBase::registerKeywords( keys );
   keys.addFlag("LOWMEM",false,"this flag does nothing and is present only to ensure back-compatibility");
+  keys.addFlag("SERIAL",false,"do the calculation in serial.  Do not parallelize");
+  keys.addFlag("INCREMENTAL",false,"update the clusters from the edges that have changed since the previous step and keep the identifiers of the clusters from one step to the next");
 }
 
 DFSClustering::DFSClustering(const ActionOptions&ao):
@@ -99,7 +140,16 @@ DFSClustering::DFSClustering(const ActionOptions&ao):
   ClusteringBase(ao)
 {
 #ifndef __PLUMED_HAS_BOOST_GRAPH
-  nneigh.resize( getNumberOfNodes() ); color.resize(getNumberOfNodes());
+  parseFlag("SERIAL",serial); parent.resize( getNumberOfNodes() );
+  parseFlag("INCREMENTAL",incremental); firststep=true; stamp=0;
+  if( incremental ) {
+    log.printf("  clusters are updated incrementally from the bonds that change on each step\n");
+    unsigned nnodes=getNumberOfNodes(); cluster_id.resize( nnodes ); id_size.resize( nnodes, 0 );
+    visited.resize( nnodes, 0 ); claimed.resize( nnodes, 0 ); id_count.resize( nnodes, 0 );
+  }
+#else
+  bool incremental; parseFlag("INCREMENTAL",incremental);
+  if( incremental ) error("INCREMENTAL cannot be used when clustering is done with the boost graph library");
 #endif
   bool lowmem; parseFlag("LOWMEM",lowmem);
   if( lowmem ) warning("LOWMEM flag is deprecated and is no longer required for this action");
@@ -119,30 +169,151 @@ void DFSClustering::performClustering() {
   // And work out the size of each cluster
   for(unsigned i=0; i<which_cluster.size(); ++i) cluster_sizes[which_cluster[i]].first++;
 #else
-  // Get the adjacency matrix
-  retrieveAdjacencyLists( nneigh, adj_list );
-
-  // Perform clustering
-  number_of_cluster=-1; color.assign(color.size(),0);
-  for(unsigned i=0; i<getNumberOfNodes(); ++i) {
-    if( color[i]==0 ) { number_of_cluster++; color[i]=explore(i); }
-  }
+  if( incremental ) { updateClusters(); return; }
+  findComponents();
+  for(unsigned i=0; i<getNumberOfNodes(); ++i) cluster_sizes[which_cluster[i]].first++;
 #endif
 }
 
 #ifndef __PLUMED_HAS_BOOST_GRAPH
-int DFSClustering::explore( const unsigned& index ) {
+void DFSClustering::findComponents() {
+  Value* mat=getPntrToArgument(0); unsigned nnodes=getNumberOfNodes(), ncols=mat->getNumberOfColumns();
+  unsigned stride=comm.Get_size(), rank=comm.Get_rank(); if( serial ) { stride=1; rank=0; }
+  unsigned nt=OpenMP::getNumThreads(); if( nt*stride*10>nnodes ) nt=nnodes/stride/10; if( nt==0 ) nt=1;
+  for(unsigned i=0; i<nnodes; ++i) parent[i]=i;
+  // Each thread builds a forest from the non-zero elements in its rows of the matrix
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<unsigned> omp_parent;
+    if( nt>1 ) { omp_parent.resize( nnodes ); for(unsigned i=0; i<nnodes; ++i) omp_parent[i]=i; }
+    std::vector<unsigned>& myparent( nt>1 ? omp_parent : parent );
+    #pragma omp for nowait
+    for(unsigned i=rank; i<nnodes; i+=stride) {
+      unsigned nrow=mat->getRowLength(i);
+      for(unsigned j=0; j<nrow; ++j) {
+        if( fabs(mat->get(i*ncols+j,false))<epsilon ) continue;
+        join( myparent, i, mat->getRowIndex(i,j) );
+      }
+    }
+    #pragma omp critical
+    if( nt>1 ) {
+      for(unsigned i=0; i<nnodes; ++i) if( omp_parent[i]!=i ) join( parent, i, omp_parent[i] );
+    }
+  }
+  // And the forests from the MPI processes are merged
+  if( stride>1 ) {
+    all_parents.resize( stride*nnodes ); comm.Allgather( parent, all_parents );
+    for(unsigned k=0; k<all_parents.size(); ++k) {
+      unsigned i=k%nnodes; if( all_parents[k]!=i ) join( parent, i, all_parents[k] );
+    }
+  }
+  // Clusters are numbered in order of their lowest numbered node as they would be in a depth first search
+  number_of_cluster=-1;
+  for(unsigned i=0; i<nnodes; ++i) {
+    unsigned r=findRoot( parent, i );
+    if( r==i ) { number_of_cluster++; which_cluster[i]=number_of_cluster; }
+    else which_cluster[i]=which_cluster[r];
+  }
+}
 
-  color[index]=1;
-  for(unsigned i=0; i<nneigh[index]; ++i) {
-    unsigned j=adj_list(index,i);
-    if( color[j]==0 ) color[j]=explore(j);
+unsigned DFSClustering::findRoot( std::vector<unsigned>& forest, unsigned i ) {
+  // Path halving keeps the trees shallow
+  while( forest[i]!=i ) { forest[i]=forest[forest[i]]; i=forest[i]; }
+  return i;
+}
+
+void DFSClustering::join( std::vector<unsigned>& forest, unsigned i, unsigned j ) {
+  i=findRoot( forest, i ); j=findRoot( forest, j );
+  if( i<j ) forest[j]=i; else if( j<i ) forest[i]=j;
+}
+
+void DFSClustering::retrieveSortedEdges() {
+  Value* mat=getPntrToArgument(0); unsigned ncols=mat->getNumberOfColumns(); edges.resize(0);
+  for(unsigned i=0; i<getNumberOfNodes(); ++i) {
+    unsigned nrow=mat->getRowLength(i);
+    for(unsigned j=0; j<nrow; ++j) {
+      if( fabs(mat->get(i*ncols+j,false))<epsilon ) continue;
+      unsigned k=mat->getRowIndex(i,j); if( k==i ) continue;
+      if( k<i ) edges.push_back( std::pair<unsigned,unsigned>(k,i) ); else edges.push_back( std::pair<unsigned,unsigned>(i,k) );
+    }
   }
+  std::sort( edges.begin(), edges.end() ); edges.erase( std::unique( edges.begin(), edges.end() ), edges.end() );
+}
 
-  // Count the size of the cluster
-  cluster_sizes[number_of_cluster].first++;
-  which_cluster[index] = number_of_cluster;
-  return color[index];
+void DFSClustering::assignIdentifiers() {
+  // Components are done in descending order of size so the largest fragment of a cluster that splits keeps its identifier
+  unsigned ncomp=comp_start.size()-1; std::vector<std::pair<unsigned,unsigned> > order( ncomp );
+  for(unsigned c=0; c<ncomp; ++c) { order[c].first=comp_start[c+1]-comp_start[c]; order[c].second=c; }
+  std::sort( order.begin(), order.end(), []( const std::pair<unsigned,unsigned>& a, const std::pair<unsigned,unsigned>& b ) {
+    return a.first>b.first || ( a.first==b.first && a.second<b.second );
+  } );
+  stamp++;
+  for(unsigned k=0; k<ncomp; ++k) {
+    unsigned c=order[k].second, best=getNumberOfNodes(), bestcount=0; touched.resize(0);
+    // The component takes the identifier held by most of its nodes that has not been taken by a larger component
+    for(unsigned n=comp_start[c]; n<comp_start[c+1]; ++n) {
+      unsigned id=cluster_id[comp_nodes[n]]; if( id_count[id]==0 ) touched.push_back(id);
+      id_count[id]++;
+    }
+    for(const auto & id : touched) {
+      if( claimed[id]!=stamp && ( id_count[id]>bestcount || ( id_count[id]==bestcount && id<best ) ) ) { best=id; bestcount=id_count[id]; }
+      id_count[id]=0;
+    }
+    if( bestcount==0 ) { plumed_assert( free_ids.size()>0 ); best=free_ids.back(); free_ids.pop_back(); }
+    claimed[best]=stamp;
+    for(unsigned n=comp_start[c]; n<comp_start[c+1]; ++n) {
+      unsigned& id=cluster_id[comp_nodes[n]]; if( id==best ) continue;
+      id_size[id]--; if( id_size[id]==0 && claimed[id]!=stamp ) free_ids.push_back(id);
+      id=best; id_size[best]++;
+    }
+  }
+}
+
+void DFSClustering::updateClusters() {
+  unsigned nnodes=getNumberOfNodes(); retrieveSortedEdges(); changed.resize(0);
+  std::set_symmetric_difference( edges.begin(), edges.end(), old_edges.begin(), old_edges.end(), std::back_inserter(changed) );
+  if( firststep || 2*changed.size()>edges.size() ) {
+    // Find the clusters from scratch and sort the nodes by component
+    findComponents(); unsigned ncomp=number_of_cluster+1;
+    comp_start.assign( ncomp+1, 0 ); for(unsigned i=0; i<nnodes; ++i) comp_start[which_cluster[i]+1]++;
+    for(unsigned c=0; c<ncomp; ++c) comp_start[c+1]+=comp_start[c];
+    comp_nodes.resize( nnodes ); std::vector<unsigned> pos( comp_start.begin(), comp_start.end()-1 );
+    for(unsigned i=0; i<nnodes; ++i) comp_nodes[pos[which_cluster[i]]++]=i;
+    if( firststep ) {
+      // On the first step the identifiers are the same as those used without INCREMENTAL
+      for(unsigned i=0; i<nnodes; ++i) cluster_id[i]=which_cluster[i];
+      for(unsigned c=0; c<ncomp; ++c) id_size[c]=comp_start[c+1]-comp_start[c];
+      free_ids.resize(0); for(unsigned id=nnodes; id>ncomp; --id) free_ids.push_back(id-1);
+      firststep=false;
+    } else assignIdentifiers();
+  } else if( changed.size()>0 ) {
+    // Build the adjacency lists of the new graph
+    adj_start.assign( nnodes+1, 0 );
+    for(const auto & e : edges) { adj_start[e.first+1]++; adj_start[e.second+1]++; }
+    for(unsigned i=0; i<nnodes; ++i) adj_start[i+1]+=adj_start[i];
+    adj.resize( adj_start[nnodes] ); std::vector<unsigned> pos( adj_start.begin(), adj_start.end()-1 );
+    for(const auto & e : edges) { adj[pos[e.first]++]=e.second; adj[pos[e.second]++]=e.first; }
+    // Search the components that contain a node whose bonds have changed
+    stamp++; comp_start.assign( 1, 0 ); comp_nodes.resize(0);
+    for(const auto & e : changed) {
+      for(unsigned seed : {e.first, e.second} ) {
+        if( visited[seed]==stamp ) continue;
+        visited[seed]=stamp; unsigned start=comp_nodes.size(); comp_nodes.push_back(seed);
+        for(unsigned n=start; n<comp_nodes.size(); ++n) {
+          unsigned node=comp_nodes[n];
+          for(unsigned j=adj_start[node]; j<adj_start[node+1]; ++j) {
+            if( visited[adj[j]]!=stamp ) { visited[adj[j]]=stamp; comp_nodes.push_back(adj[j]); }
+          }
+        }
+        comp_start.push_back( comp_nodes.size() );
+      }
+    }
+    assignIdentifiers();
+  }
+  old_edges.swap( edges );
+  // Clusters are labelled by their identifiers so that clusters of equal size keep their order
+  number_of_cluster=-1;
+  for(unsigned i=0; i<nnodes; ++i) { which_cluster[i]=cluster_id[i]; cluster_sizes[i].first=id_size[i]; if( id_size[i]>0 ) number_of_cluster++; }
 }
 #endif
 
@@ -22,6 +22,18 @@
 #include "CoordinationBase.h"
 #include "tools/SwitchingFunction.h"
 #include "core/ActionRegister.h"
+#include "core/PlumedMain.h"
+#include "tools/Communicator.h"
+
+#ifdef __PLUMED_HAS_ARRAYFIRE
+#include <arrayfire.h>
+#include <af/util.h>
+#ifdef __PLUMED_HAS_ARRAYFIRE_CUDA
+#include <af/cuda.h>
+#elif __PLUMED_HAS_ARRAYFIRE_OCL
+#include <af/opencl.h>
+#endif
+#endif
 
 namespace PLMD {
 namespace colvar {
@@ -87,6 +99,13 @@ c2: COMBINE ARG=x COEFFICIENTS=2 PERIODIC=NO
 PRINT ARG=c1,c2 STRIDE=10
 \endplumedfile
 
+If PLUMED is compiled with ARRAYFIRE the GPU flag can be used to compute all the pairs on an
+accelerator device.  This is only possible with the default rational switching function, without
+PAIR and NLIST and with orthorhombic boxes.  As all the pairs are computed the memory
+that is required grows with the product of the sizes of the two groups.
+\plumedfile
+c: COORDINATION GROUPA=1-1000 GROUPB=1001-20000 R_0=0.3 GPU
+\endplumedfile
 
 
 */
@@ -94,12 +113,26 @@ PRINT ARG=c1,c2 STRIDE=10
 
 class Coordination : public CoordinationBase {
   SwitchingFunction switchingFunction;
+/// Are we doing the calculation on a GPU
+  bool gpu;
+  int deviceid;
+/// The parameters of the rational switching function that is used on the GPU
+  int nn, mm;
+  double d0, r0, dmax, stretch, shift;
+#ifdef __PLUMED_HAS_ARRAYFIRE
+/// This is one for the pairs that are counted and zero for self contacts
+  af::array pair_mask;
+#endif
+  void setDevice() const ;
+  void calculate_gpu();
 
 public:
   explicit Coordination(const ActionOptions&);
 // active methods:
   static void registerKeywords( Keywords& keys );
+  void calculate() override;
   double pairing(double distance,double&dfunc,unsigned i,unsigned j)const override;
+  void pairingBlock(const double* distance2,double* res,double* dfunc,const unsigned* i,const unsigned* j,unsigned n)const override;
 };
 
 PLUMED_REGISTER_ACTION(Coordination,"COORDINATION")
@@ -113,12 +146,23 @@ void Coordination::registerKeywords( Keywords& keys ) {
   keys.add("optional","SWITCH","This keyword is used if you want to employ an alternative to the continuous switching function defined above. "
            "The following provides information on the \\ref switchingfunction that are available. "
            "When this keyword is present you no longer need the NN, MM, D_0 and R_0 keywords.");
+  keys.addFlag("GPU",false,"calculate all the pairs using ARRAYFIRE on an accelerator device");
+  keys.add("compulsory","DEVICEID","-1","Identifier of the GPU to be used");
   keys.setValueDescription("scalar","the value of the coordination");
 }
 
 Coordination::Coordination(const ActionOptions&ao):
   Action(ao),
-  CoordinationBase(ao)
+  CoordinationBase(ao),
+  gpu(false),
+  deviceid(-1),
+  nn(6),
+  mm(0),
+  d0(0.0),
+  r0(0.0),
+  dmax(0.0),
+  stretch(1.0),
+  shift(0.0)
 {
 
   std::string sw,errors;
@@ -127,29 +171,164 @@ Coordination::Coordination(const ActionOptions&ao):
     switchingFunction.set(sw,errors);
     if( errors.length()!=0 ) error("problem reading SWITCH keyword : " + errors );
   } else {
-    int nn=6;
-    int mm=0;
-    double d0=0.0;
-    double r0=0.0;
     parse("R_0",r0);
     if(r0<=0.0) error("R_0 should be explicitly specified and positive");
     parse("D_0",d0);
     parse("NN",nn);
     parse("MM",mm);
     switchingFunction.set(nn,mm,r0,d0);
+    if(mm==0) mm=2*nn;
+    // the rational function is shifted and stretched so that it is zero at dmax
+    dmax=switchingFunction.get_dmax();
+    const double x=(dmax-d0)/r0;
+    const double sd=(1.0-std::pow(x,nn))/(1.0-std::pow(x,mm));
+    stretch=1.0/(1.0-sd); shift=-sd*stretch;
+  }
+
+  parseFlag("GPU",gpu);
+#ifndef  __PLUMED_HAS_ARRAYFIRE
+  if(gpu) error("To use the GPU mode PLUMED must be compiled with ARRAYFIRE");
+#endif
+  parse("DEVICEID",deviceid);
+  if(gpu) {
+    if(sw.length()>0) error("the GPU mode can only be used with the rational switching function defined by NN, MM, D_0 and R_0");
+    if(!computesAllPairs()) error("the GPU mode cannot be used with PAIR or NLIST");
+    log<<"  all pairs are computed on the GPU\n";
   }
+#ifdef  __PLUMED_HAS_ARRAYFIRE
+  if(gpu&&comm.Get_rank()==0) {
+    // if not set try to check the one set by the API
+    if(deviceid==-1) deviceid=plumed.getGpuDeviceId();
+    // if still not set use 0
+    if(deviceid==-1) deviceid=0;
+    setDevice();
+    char dname[64], dplatform[10], dtoolkit[64], dcompute[10];
+    af::deviceInfo(dname,dplatform,dtoolkit,dcompute);
+    log.printf("  using GPU device %d: %s (%s %s, compute %s)\n",deviceid,dname,dplatform,dtoolkit,dcompute);
+    if(!af::isDoubleAvailable(af::getDevice())) error("the GPU mode needs a device that supports double precision");
+    // Build the mask that removes self contacts and, for a single group, the pairs that are counted twice
+    const unsigned na=getNumberOfAtomsInGroupA();
+    const unsigned nb=getNumberOfAtomsInGroupB()>0 ? getNumberOfAtomsInGroupB() : na;
+    const unsigned bstart=getNumberOfAtomsInGroupB()>0 ? na : 0;
+    std::vector<double> mask(na*nb);
+    for(unsigned j=0; j<nb; ++j) for(unsigned i=0; i<na; ++i) {
+        bool counted=getAbsoluteIndex(i)!=getAbsoluteIndex(bstart+j);
+        if(getNumberOfAtomsInGroupB()==0) counted=(i<j);
+        mask[i+j*na] = counted ? 1.0 : 0.0;
+      }
+    pair_mask = af::array(na, nb, mask.data());
+  }
+#endif
 
   checkRead();
 
   log<<"  contacts are counted with cutoff "<<switchingFunction.description()<<"\n";
 }
 
+void Coordination::setDevice() const {
+#ifdef  __PLUMED_HAS_ARRAYFIRE_CUDA
+  af::setDevice(afcu::getNativeId(deviceid));
+#elif   __PLUMED_HAS_ARRAYFIRE_OCL
+  af::setDevice(afcl::getNativeId(deviceid));
+#elif   __PLUMED_HAS_ARRAYFIRE
+  af::setDevice(deviceid);
+#endif
+}
+
+void Coordination::calculate() {
+  if(gpu) calculate_gpu();
+  else CoordinationBase::calculate();
+}
+
+void Coordination::calculate_gpu() {
+#ifdef __PLUMED_HAS_ARRAYFIRE
+  const unsigned na=getNumberOfAtomsInGroupA();
+  const bool onegroup=(getNumberOfAtomsInGroupB()==0);
+  const unsigned nb=onegroup ? na : getNumberOfAtomsInGroupB();
+  const unsigned bstart=onegroup ? 0 : na;
+  const bool dopbc=usesPbc() && getPbc().isSet();
+  if(dopbc && !getPbc().isOrthorombic()) error("the GPU mode only works with orthorhombic boxes");
+
+  // value, virial and derivatives on group A and then group B
+  std::vector<double> results(10+3*(na+nb));
+  // on gpu only the master rank run the calculation
+  if(comm.Get_rank()==0) {
+    std::vector<double> posa(3*na), posb(3*nb);
+    for(unsigned i=0; i<na; ++i) for(unsigned k=0; k<3; ++k) posa[3*i+k]=getPosition(i)[k];
+    for(unsigned i=0; i<nb; ++i) for(unsigned k=0; k<3; ++k) posb[3*i+k]=getPosition(bstart+i)[k];
+    setDevice();
+    // 3,na and 3,nb
+    af::array pos_a = af::array(3, na, posa.data());
+    af::array pos_b = af::array(3, nb, posb.data());
+    // the components of the distances between atoms in b and atoms in a, each of them is na,nb
+    af::array dist[3];
+    for(unsigned k=0; k<3; ++k) {
+      dist[k] = af::tile(pos_b.row(k), na, 1) - af::tile(af::moddims(pos_a.row(k), na, 1), 1, nb);
+      if(dopbc) {
+        const double l=getPbc().getBox()(k,k);
+        dist[k] = dist[k] - l*af::round(dist[k]/l);
+      }
+    }
+    af::array r = af::sqrt(dist[0]*dist[0] + dist[1]*dist[1] + dist[2]*dist[2]);
+    af::array x = (r - d0)/r0;
+    af::array sw, dsw;
+    if(mm==2*nn) {
+      af::array xn1 = af::pow(x, nn-1);
+      sw = 1.0/(1.0 + xn1*x);
+      dsw = -nn*xn1*sw*sw;
+    } else {
+      af::array xn1 = af::pow(x, nn-1), xm1 = af::pow(x, mm-1);
+      af::array num = 1.0 - xn1*x, iden = 1.0/(1.0 - xm1*x);
+      sw = num*iden;
+      dsw = (mm*sw*xm1 - nn*xn1)*iden;
+      // close to x=1 a first order expansion is used as the rational function is ill defined there
+      const double dsw1=0.5*nn*(nn-mm)/double(mm);
+      af::array nearone = af::abs(x - 1.0) < 1.0e-4;
+      sw = af::select(nearone, double(nn)/mm + (x - 1.0)*dsw1, sw);
+      dsw = af::select(nearone, dsw1, dsw);
+    }
+    // apply the stretch, remove the pairs beyond dmax and set the switching function to one below d0
+    sw = af::select(r > dmax, 0.0, af::select(x > 0.0, sw*stretch + shift, 1.0));
+    dsw = af::select(r > dmax || x <= 0.0, 0.0, dsw*stretch/(r0*r));
+    sw = sw*pair_mask;
+    dsw = dsw*pair_mask;
+    results[0] = af::sum<double>(sw);
+    af::array dd[3];
+    for(unsigned k=0; k<3; ++k) dd[k] = dsw*dist[k];
+    for(unsigned k=0; k<3; ++k) for(unsigned l=0; l<3; ++l) results[1+3*k+l] = -af::sum<double>(dd[k]*dist[l]);
+    for(unsigned k=0; k<3; ++k) {
+      std::vector<double> deriva(na), derivb(nb);
+      af::array da = -af::sum(dd[k], 1), db = af::sum(dd[k], 0);
+      da.host(deriva.data()); db.host(derivb.data());
+      for(unsigned i=0; i<na; ++i) results[10+3*i+k] = deriva[i];
+      for(unsigned i=0; i<nb; ++i) results[10+3*(na+i)+k] = derivb[i];
+    }
+  }
+  comm.Bcast(results, 0);
+
+  Tensor virial;
+  for(unsigned k=0; k<3; ++k) for(unsigned l=0; l<3; ++l) virial(k,l)=results[1+3*k+l];
+  std::vector<Vector> deriv(getNumberOfAtoms());
+  for(unsigned i=0; i<na; ++i) deriv[i]+=Vector(results[10+3*i],results[10+3*i+1],results[10+3*i+2]);
+  for(unsigned i=0; i<nb; ++i) deriv[bstart+i]+=Vector(results[10+3*(na+i)],results[10+3*(na+i)+1],results[10+3*(na+i)+2]);
+  for(unsigned i=0; i<deriv.size(); ++i) setAtomsDerivatives(i,deriv[i]);
+  setValue(results[0]);
+  setBoxDerivatives(virial);
+#endif
+}
+
 double Coordination::pairing(double distance,double&dfunc,unsigned i,unsigned j)const {
   (void) i; // avoid warnings
   (void) j; // avoid warnings
   return switchingFunction.calculateSqr(distance,dfunc);
 }
 
+void Coordination::pairingBlock(const double* distance2,double* res,double* dfunc,const unsigned* i,const unsigned* j,const unsigned n)const {
+  (void) i; // avoid warnings
+  (void) j; // avoid warnings
+  switchingFunction.calculateSqr(distance2,res,dfunc,n);
+}
+
 }
 
 }
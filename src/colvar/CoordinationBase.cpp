@@ -23,6 +23,8 @@
 #include "tools/NeighborList.h"
 #include "tools/Communicator.h"
 #include "tools/OpenMP.h"
+#include <array>
+#include <algorithm>
 
 namespace PLMD {
 namespace colvar {
@@ -33,7 +35,8 @@ void CoordinationBase::registerKeywords( Keywords& keys ) {
   keys.addFlag("PAIR",false,"Pair only 1st element of the 1st group with 1st element in the second, etc");
   keys.addFlag("NLIST",false,"Use a neighbor list to speed up the calculation");
   keys.add("optional","NL_CUTOFF","The cutoff for the neighbor list");
-  keys.add("optional","NL_STRIDE","The frequency with which we are updating the atoms in the neighbor list");
+  keys.add("optional","NL_STRIDE","The frequency with which we are updating the atoms in the neighbor list.  If NL_SKIN is used this is the maximum number of steps between two updates");
+  keys.add("optional","NL_SKIN","If this is set the neighbor list is only updated when an atom has moved by more than half this distance or, if NL_STRIDE is also given, every NL_STRIDE steps.  NL_CUTOFF should then be at least the cutoff of the switching function plus the skin");
   keys.add("atoms","GROUPA","First list of atoms");
   keys.add("atoms","GROUPB","Second list of atoms (if empty, N*(N-1)/2 pairs in GROUPA are counted)");
 }
@@ -43,7 +46,11 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
   pbc(true),
   serial(false),
   invalidateList(true),
-  firsttime(true)
+  firsttime(true),
+  dopair(false),
+  doneigh(false),
+  ngroupa(0),
+  ngroupb(0)
 {
 
   parseFlag("SERIAL",serial);
@@ -51,25 +58,28 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
   std::vector<AtomNumber> ga_lista,gb_lista;
   parseAtomList("GROUPA",ga_lista);
   parseAtomList("GROUPB",gb_lista);
+  ngroupa=ga_lista.size(); ngroupb=gb_lista.size();
 
   bool nopbc=!pbc;
   parseFlag("NOPBC",nopbc);
   pbc=!nopbc;
 
 // pair stuff
-  bool dopair=false;
   parseFlag("PAIR",dopair);
 
 // neighbor list stuff
-  bool doneigh=false;
-  double nl_cut=0.0;
+  double nl_cut=0.0, nl_skin=0.0;
   int nl_st=0;
   parseFlag("NLIST",doneigh);
   if(doneigh) {
     parse("NL_CUTOFF",nl_cut);
     if(nl_cut<=0.0) error("NL_CUTOFF should be explicitly specified and positive");
+    parse("NL_SKIN",nl_skin);
+    if(nl_skin<0.0 || nl_skin>=nl_cut) error("NL_SKIN should be positive and smaller than NL_CUTOFF");
     parse("NL_STRIDE",nl_st);
-    if(nl_st<=0) error("NL_STRIDE should be explicitly specified and positive");
+    // with a skin the list is checked on every step and NL_STRIDE is optional
+    if(nl_skin>0.0 && nl_st<0) error("NL_STRIDE should be positive");
+    if(nl_skin==0.0 && nl_st<=0) error("NL_STRIDE should be explicitly specified and positive");
   }
 
   addValueWithDerivatives(); setNotPeriodic();
@@ -80,6 +90,7 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
     if(doneigh)  nl=Tools::make_unique<NeighborList>(ga_lista,serial,pbc,getPbc(),comm,nl_cut,nl_st);
     else         nl=Tools::make_unique<NeighborList>(ga_lista,serial,pbc,getPbc(),comm);
   }
+  if(nl_skin>0.0) nl->setSkin(nl_skin);
 
   requestAtoms(nl->getFullAtomList());
 
@@ -100,7 +111,11 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
   if(dopair) log.printf("  with PAIR option\n");
   if(doneigh) {
     log.printf("  using neighbor lists with\n");
-    log.printf("  update every %d steps and cutoff %f\n",nl_st,nl_cut);
+    if(nl_skin>0.0) {
+      log.printf("  cutoff %f updated when an atom has moved by more than half the skin %f\n",nl_cut,nl_skin);
+      if(nl_st>0) log.printf("  and at least every %d steps\n",nl_st);
+    }
+    else log.printf("  update every %d steps and cutoff %f\n",nl_st,nl_cut);
   }
 }
 
@@ -108,8 +123,17 @@ CoordinationBase::~CoordinationBase() {
 // destructor required to delete forward declared class
 }
 
+void CoordinationBase::addMemoryUsage( MemoryUsage& usage ) const {
+  Colvar::addMemoryUsage( usage );
+  if(nl) usage.lists+=nl->getMemoryUsage();
+}
+
 void CoordinationBase::prepare() {
-  if(nl->getStride()>0) {
+  if(nl->getSkin()>0) {
+    // The positions of all the atoms are needed on every step to check if they have moved too far
+    if(firsttime || getExchangeStep() || (nl->getStride()>0 && getStep()%nl->getStride()==0)) invalidateList=true;
+    firsttime=false;
+  } else if(nl->getStride()>0) {
     if(firsttime || (getStep()%nl->getStride()==0)) {
       requestAtoms(nl->getFullAtomList());
       invalidateList=true;
@@ -117,12 +141,16 @@ void CoordinationBase::prepare() {
     } else {
       requestAtoms(nl->getReducedAtomList());
       invalidateList=false;
-      if(getExchangeStep()) error("Neighbor lists should be updated on exchange steps - choose a NL_STRIDE which divides the exchange stride!");
+      if(getExchangeStep()) error("Neighbor lists should be updated on exchange steps - choose a NL_STRIDE which divides the exchange stride or use NL_SKIN, which updates the list on exchange steps!");
     }
     if(getExchangeStep()) firsttime=true;
   }
 }
 
+void CoordinationBase::pairingBlock(const double* distance2,double* res,double* dfunc,const unsigned* i,const unsigned* j,const unsigned n)const {
+  for(unsigned k=0; k<n; ++k) res[k]=pairing(distance2[k],dfunc[k],i[k],j[k]);
+}
+
 // calculator
 void CoordinationBase::calculate()
 {
@@ -131,7 +159,10 @@ void CoordinationBase::calculate()
   Tensor virial;
   std::vector<Vector> deriv(getNumberOfAtoms());
 
-  if(nl->getStride()>0 && invalidateList) {
+  if(nl->getSkin()>0) {
+    if(invalidateList || nl->displacementExceedsSkin(getPositions())) nl->update(getPositions());
+    invalidateList=false;
+  } else if(nl->getStride()>0 && invalidateList) {
     nl->update(getPositions());
   }
 
@@ -153,39 +184,50 @@ void CoordinationBase::calculate()
   const unsigned int start= rank*elementsPerRank;
   const unsigned int end = ((start + elementsPerRank)< nn)?(start + elementsPerRank): nn;
 
+  // The pairs are processed in blocks so that the switching function can be evaluated for many distances at once
+  constexpr unsigned blocksize=64;
+
   #pragma omp parallel num_threads(nt)
   {
     std::vector<Vector> omp_deriv(getPositions().size());
     Tensor omp_virial;
+    std::array<double,blocksize> dx, dy, dz, d2, fsw, dfunc;
+    std::array<unsigned,blocksize> ind0, ind1;
 
     #pragma omp for reduction(+:ncoord) nowait
-    for(unsigned int i=start; i<end; ++i) {
+    for(unsigned int b=start; b<end; b+=blocksize) {
 
-      Vector distance;
-      const unsigned i0=nl->getClosePair(i).first;
-      const unsigned i1=nl->getClosePair(i).second;
+      unsigned nb=0;
+      const unsigned bend=std::min(b+blocksize,end);
+      for(unsigned i=b; i<bend; ++i) {
+        const unsigned i0=nl->getClosePair(i).first;
+        const unsigned i1=nl->getClosePair(i).second;
 
-      if(getAbsoluteIndex(i0)==getAbsoluteIndex(i1)) continue;
+        if(getAbsoluteIndex(i0)==getAbsoluteIndex(i1)) continue;
 
-      if(pbc) {
-        distance=pbcDistance(getPosition(i0),getPosition(i1));
-      } else {
-        distance=delta(getPosition(i0),getPosition(i1));
+        const Vector dd(delta(getPosition(i0),getPosition(i1)));
+        dx[nb]=dd[0]; dy[nb]=dd[1]; dz[nb]=dd[2]; dfunc[nb]=0.; ind0[nb]=i0; ind1[nb]=i1; nb++;
       }
-
-      double dfunc=0.;
-      ncoord += pairing(distance.modulo2(), dfunc,i0,i1);
-
-      Vector dd(dfunc*distance);
-      Tensor vv(dd,distance);
-      if(nt>1) {
-        omp_deriv[i0]-=dd;
-        omp_deriv[i1]+=dd;
-        omp_virial-=vv;
-      } else {
-        deriv[i0]-=dd;
-        deriv[i1]+=dd;
-        virial-=vv;
+      // The minimum image convention is applied to the whole block at once
+      if(pbc) getPbc().apply(dx.data(), dy.data(), dz.data(), nb);
+      for(unsigned k=0; k<nb; ++k) d2[k]=dx[k]*dx[k]+dy[k]*dy[k]+dz[k]*dz[k];
+
+      pairingBlock(d2.data(), fsw.data(), dfunc.data(), ind0.data(), ind1.data(), nb);
+
+      for(unsigned k=0; k<nb; ++k) {
+        ncoord += fsw[k];
+        const Vector distance(dx[k],dy[k],dz[k]);
+        Vector dd(dfunc[k]*distance);
+        Tensor vv(dd,distance);
+        if(nt>1) {
+          omp_deriv[ind0[k]]-=dd;
+          omp_deriv[ind1[k]]+=dd;
+          omp_virial-=vv;
+        } else {
+          deriv[ind0[k]]-=dd;
+          deriv[ind1[k]]+=dd;
+          virial-=vv;
+        }
       }
 
     }
@@ -36,14 +36,30 @@ class CoordinationBase : public Colvar {
   std::unique_ptr<NeighborList> nl;
   bool invalidateList;
   bool firsttime;
+  bool dopair, doneigh;
+  unsigned ngroupa, ngroupb;
+
+protected:
+/// Get the number of atoms in the first group
+  unsigned getNumberOfAtomsInGroupA() const { return ngroupa; }
+/// Get the number of atoms in the second group (zero if only GROUPA was given)
+  unsigned getNumberOfAtomsInGroupB() const { return ngroupb; }
+/// Check if all pairs between the two groups are computed, i.e. neither PAIR nor NLIST are used
+  bool computesAllPairs() const { return !dopair && !doneigh; }
+/// Check if periodic boundary conditions are used
+  bool usesPbc() const { return pbc; }
 
 public:
   explicit CoordinationBase(const ActionOptions&);
   ~CoordinationBase();
+  void addMemoryUsage( MemoryUsage& usage ) const override;
 // active methods:
   void calculate() override;
   void prepare() override;
   virtual double pairing(double distance,double&dfunc,unsigned i,unsigned j)const=0;
+/// Calculate the pairing for a block of n pairs.  By default this calls pairing() for each pair but
+/// it can be overridden so that the whole block is evaluated at once
+  virtual void pairingBlock(const double* distance2,double* res,double* dfunc,const unsigned* i,const unsigned* j,unsigned n)const;
   static void registerKeywords( Keywords& keys );
 };
 
@@ -29,6 +29,8 @@
 #include "core/GenericMolInfo.h"
 #include "tools/Communicator.h"
 #include "tools/OpenMP.h"
+#include "tools/LinkCells.h"
+#include "tools/Pbc.h"
 #include <initializer_list>
 
 #define INV_PI_SQRT_PI 0.179587122
@@ -86,9 +88,16 @@ private:
   double nl_buffer;
   unsigned nl_stride;
   unsigned nl_update;
-  std::vector<std::vector<unsigned> > nl;
-  std::vector<std::vector<bool> > nlexpo;
   std::vector<std::vector<double> > parameter;
+  // neighbor list in compressed row format, the neighbors of i are nl_j[nl_start[i]:nl_start[i+1]]
+  std::vector<unsigned> nl_start;
+  std::vector<unsigned> nl_j;
+  // per pair coefficients: coef_a multiplies the exponential with the parameters of i,
+  // coef_b the one with the parameters of j (zero when the two exponentials coincide)
+  std::vector<double> nl_coef_a;
+  std::vector<double> nl_coef_b;
+  std::vector<double> nl_lambda_b;
+  std::vector<double> nl_radius_b;
   void setupConstants(const std::vector<AtomNumber> &atoms, std::vector<std::vector<double> > &parameter, bool tcorr);
   std::map<std::string, std::map<std::string, std::string> > setupTypeMap();
   std::map<std::string, std::vector<double> > setupValueMap();
@@ -139,8 +148,7 @@ EEFSolv::EEFSolv(const ActionOptions&ao):
 
   log << "  Bibliography " << plumed.cite("Lazaridis T, Karplus M, Proteins Struct. Funct. Genet. 35, 133 (1999)"); log << "\n";
 
-  nl.resize(size);
-  nlexpo.resize(size);
+  nl_start.assign(size+1,0);
   parameter.resize(size, std::vector<double>(4, 0));
   setupConstants(atoms, parameter, tcorr);
 
@@ -152,29 +160,101 @@ EEFSolv::EEFSolv(const ActionOptions&ao):
 void EEFSolv::update_neighb() {
   const double lower_c2 = 0.24 * 0.24; // this is the cut-off for bonded atoms
   const unsigned size = getNumberOfAtoms();
+  if(size==0) return;
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*10>size) nt=1;
 
+  std::vector<Vector> cellpos(size);
+  std::vector<unsigned> cellind(size);
+  Vector lo=getPosition(0), hi=getPosition(0);
+  double max_lambda=0.;
   for (unsigned i=0; i<size; i++) {
-    nl[i].clear();
-    nlexpo[i].clear();
-    const Vector posi = getPosition(i);
-    // Loop through neighboring atoms, add the ones below cutoff
-    for (unsigned j=i+1; j<size; j++) {
-      if(parameter[i][1]==0&&parameter[j][1]==0) continue;
-      const double d2 = delta(posi, getPosition(j)).modulo2();
-      if (d2 < lower_c2 && j < i+14) {
-        // crude approximation for i-i+1/2 interactions,
-        // we want to exclude atoms separated by less than three bonds
-        continue;
+    cellpos[i]=getPosition(i);
+    cellind[i]=i;
+    for(unsigned k=0; k<3; k++) {
+      lo[k]=std::min(lo[k],cellpos[i][k]);
+      hi[k]=std::max(hi[k],cellpos[i][k]);
+    }
+    max_lambda=std::max(max_lambda,1./parameter[i][2]);
+  }
+
+  // the molecule is whole, so the cells are built in a box that contains it
+  // with enough empty space to separate it from its periodic images
+  const double cutoff = 2. * max_lambda + nl_buffer;
+  Tensor box;
+  for(unsigned k=0; k<3; k++) box[k][k]=hi[k]-lo[k]+cutoff;
+  for(auto & p : cellpos) p-=lo;
+  Pbc cellpbc;
+  cellpbc.setBox(box);
+  Communicator cellcomm;
+  LinkCells cells(cellcomm);
+  cells.setCutoff(cutoff);
+  cells.buildCellLists(cellpos,cellind,cellpbc);
+
+  std::vector<std::vector<unsigned> > neighbors(size);
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<unsigned> cell_list(cells.getNumberOfCells()), atoms(1+size);
+    #pragma omp for
+    for (unsigned i=0; i<size; i++) {
+      // The first element is skipped by retrieveNeighboringAtoms so it is set to the atom itself
+      unsigned natomsper=1; atoms[0]=i;
+      cells.retrieveNeighboringAtoms(cellpos[i],cell_list,natomsper,atoms);
+      const Vector posi = getPosition(i);
+      for (unsigned m=1; m<natomsper; m++) {
+        const unsigned j=atoms[m];
+        if(j<=i) continue;
+        if(parameter[i][1]==0&&parameter[j][1]==0) continue;
+        const double d2 = delta(posi, getPosition(j)).modulo2();
+        if (d2 < lower_c2 && j < i+14) {
+          // crude approximation for i-i+1/2 interactions,
+          // we want to exclude atoms separated by less than three bonds
+          continue;
+        }
+        // We choose the maximum lambda value and use a more conservative cutoff
+        double mlambda = 1./parameter[i][2];
+        if (1./parameter[j][2] > mlambda) mlambda = 1./parameter[j][2];
+        const double c2 = (2. * mlambda + nl_buffer) * (2. * mlambda + nl_buffer);
+        if (d2 < c2 ) neighbors[i].push_back(j);
       }
-      // We choose the maximum lambda value and use a more conservative cutoff
-      double mlambda = 1./parameter[i][2];
-      if (1./parameter[j][2] > mlambda) mlambda = 1./parameter[j][2];
-      const double c2 = (2. * mlambda + nl_buffer) * (2. * mlambda + nl_buffer);
-      if (d2 < c2 ) {
-        nl[i].push_back(j);
-        if(parameter[i][2] == parameter[j][2] && parameter[i][3] == parameter[j][3]) {
-          nlexpo[i].push_back(true);
-        } else nlexpo[i].push_back(false);
+      // keep the same order of the all-pairs search
+      std::sort(neighbors[i].begin(),neighbors[i].end());
+    }
+  }
+
+  nl_start[0]=0;
+  for (unsigned i=0; i<size; i++) nl_start[i+1]=nl_start[i]+neighbors[i].size();
+  const unsigned npairs=nl_start[size];
+  nl_j.resize(npairs);
+  nl_coef_a.resize(npairs);
+  nl_coef_b.resize(npairs);
+  nl_lambda_b.resize(npairs);
+  nl_radius_b.resize(npairs);
+  #pragma omp parallel for num_threads(nt)
+  for (unsigned i=0; i<size; i++) {
+    const double vdw_volume_i   = parameter[i][0];
+    const double delta_g_free_i = parameter[i][1];
+    const double inv_lambda_i   = parameter[i][2];
+    const double vdw_radius_i   = parameter[i][3];
+    for (unsigned m=0; m<neighbors[i].size(); m++) {
+      const unsigned p=nl_start[i]+m;
+      const unsigned j=neighbors[i][m];
+      const double vdw_volume_j   = parameter[j][0];
+      const double delta_g_free_j = parameter[j][1];
+      const double inv_lambda_j   = parameter[j][2];
+      const double vdw_radius_j   = parameter[j][3];
+      const double fact_ij = delta_g_free_i * vdw_volume_j * INV_PI_SQRT_PI * inv_lambda_i;
+      const double fact_ji = delta_g_free_j * vdw_volume_i * INV_PI_SQRT_PI * inv_lambda_j;
+      nl_j[p] = j;
+      nl_lambda_b[p] = inv_lambda_j;
+      nl_radius_b[p] = vdw_radius_j;
+      // in this case we can calculate a single exponential
+      if(inv_lambda_i == inv_lambda_j && vdw_radius_i == vdw_radius_j) {
+        nl_coef_a[p] = fact_ij + fact_ji;
+        nl_coef_b[p] = 0.;
+      } else {
+        nl_coef_a[p] = fact_ij;
+        nl_coef_b[p] = fact_ji;
       }
     }
   }
@@ -202,82 +282,56 @@ void EEFSolv::calculate() {
   unsigned nt=OpenMP::getNumThreads();
   if(nt*stride*10>size) nt=1;
 
+  unsigned maxneigh=0;
+  for (unsigned i=0; i<size; i++) maxneigh=std::max(maxneigh,nl_start[i+1]-nl_start[i]);
+
   #pragma omp parallel num_threads(nt)
   {
-    std::vector<Vector> deriv_omp(size, Vector(0,0,0));
+    std::vector<Vector> deriv_omp(nt>1 ? size : 0, Vector(0,0,0));
+    std::vector<Vector> & deriv_t = (nt>1 ? deriv_omp : deriv);
+    std::vector<double> dx(maxneigh), dy(maxneigh), dz(maxneigh), g(maxneigh);
     #pragma omp for reduction(+:bias) nowait
     for (unsigned i=rank; i<size; i+=stride) {
       const Vector posi = getPosition(i);
       double fedensity = 0.0;
       Vector deriv_i;
-      const double vdw_volume_i   = parameter[i][0];
-      const double delta_g_free_i = parameter[i][1];
       const double inv_lambda_i   = parameter[i][2];
       const double vdw_radius_i   = parameter[i][3];
+      const unsigned start = nl_start[i];
+      const unsigned nn = nl_start[i+1]-start;
+      const double* coef_a   = nl_coef_a.data()+start;
+      const double* coef_b   = nl_coef_b.data()+start;
+      const double* lambda_b = nl_lambda_b.data()+start;
+      const double* radius_b = nl_radius_b.data()+start;
 
-      // The pairwise interactions are unsymmetric, but we can get away with calculating the distance only once
-      for (unsigned i_nl=0; i_nl<nl[i].size(); i_nl++) {
-        const unsigned j = nl[i][i_nl];
-        const double vdw_volume_j   = parameter[j][0];
-        const double delta_g_free_j = parameter[j][1];
-        const double inv_lambda_j   = parameter[j][2];
-        const double vdw_radius_j   = parameter[j][3];
+      for (unsigned k=0; k<nn; k++) {
+        const Vector dist = delta(posi, getPosition(nl_j[start+k]));
+        dx[k]=dist[0]; dy[k]=dist[1]; dz[k]=dist[2];
+      }
 
-        const Vector dist     = delta(posi, getPosition(j));
-        const double rij      = dist.modulo();
+      // The pairwise interactions are unsymmetric, but we can get away with calculating the distance only once;
+      // both exponentials are evaluated and masked so that the loop can be vectorized
+      #pragma omp simd reduction(+:fedensity)
+      for (unsigned k=0; k<nn; k++) {
+        const double rij      = std::sqrt(dx[k]*dx[k]+dy[k]*dy[k]+dz[k]*dz[k]);
         const double inv_rij  = 1.0 / rij;
         const double inv_rij2 = inv_rij * inv_rij;
-        const double fact_ij  = inv_rij2 * delta_g_free_i * vdw_volume_j * INV_PI_SQRT_PI * inv_lambda_i;
-        const double fact_ji  = inv_rij2 * delta_g_free_j * vdw_volume_i * INV_PI_SQRT_PI * inv_lambda_j;
-
-        // in this case we can calculate a single exponential
-        if(!nlexpo[i][i_nl]) {
-          // i-j interaction
-          if(inv_rij > 0.5*inv_lambda_i && delta_g_free_i!=0.)
-          {
-            const double e_arg = (rij - vdw_radius_i)*inv_lambda_i;
-            const double expo  = std::exp(-e_arg*e_arg);
-            const double fact  = expo*fact_ij;
-            const double e_deriv = inv_rij*fact*(inv_rij + e_arg*inv_lambda_i);
-            const Vector dd    = e_deriv*dist;
-            fedensity    += fact;
-            deriv_i      += dd;
-            if(nt>1) deriv_omp[j] -= dd;
-            else deriv[j] -= dd;
-          }
-
-          // j-i interaction
-          if(inv_rij > 0.5*inv_lambda_j && delta_g_free_j!=0.)
-          {
-            const double e_arg = (rij - vdw_radius_j)*inv_lambda_j;
-            const double expo  = std::exp(-e_arg*e_arg);
-            const double fact  = expo*fact_ji;
-            const double e_deriv = inv_rij*fact*(inv_rij + e_arg*inv_lambda_j);
-            const Vector dd    = e_deriv*dist;
-            fedensity    += fact;
-            deriv_i      += dd;
-            if(nt>1) deriv_omp[j] -= dd;
-            else deriv[j] -= dd;
-          }
-        } else {
-          // i-j interaction
-          if(inv_rij > 0.5*inv_lambda_i)
-          {
-            const double e_arg = (rij - vdw_radius_i)*inv_lambda_i;
-            const double expo  = std::exp(-e_arg*e_arg);
-            const double fact  = expo*(fact_ij + fact_ji);
-            const double e_deriv = inv_rij*fact*(inv_rij + e_arg*inv_lambda_i);
-            const Vector dd    = e_deriv*dist;
-            fedensity    += fact;
-            deriv_i      += dd;
-            if(nt>1) deriv_omp[j] -= dd;
-            else deriv[j] -= dd;
-          }
-        }
+        // i-j interaction
+        const double e_arg_a = (rij - vdw_radius_i)*inv_lambda_i;
+        const double fact_a  = (inv_rij > 0.5*inv_lambda_i) ? coef_a[k]*inv_rij2*std::exp(-e_arg_a*e_arg_a) : 0.0;
+        // j-i interaction
+        const double e_arg_b = (rij - radius_b[k])*lambda_b[k];
+        const double fact_b  = (inv_rij > 0.5*lambda_b[k]) ? coef_b[k]*inv_rij2*std::exp(-e_arg_b*e_arg_b) : 0.0;
+        fedensity += fact_a + fact_b;
+        g[k] = inv_rij*(fact_a*(inv_rij + e_arg_a*inv_lambda_i) + fact_b*(inv_rij + e_arg_b*lambda_b[k]));
+      }
 
+      for (unsigned k=0; k<nn; k++) {
+        const Vector dd(g[k]*dx[k], g[k]*dy[k], g[k]*dz[k]);
+        deriv_i += dd;
+        deriv_t[nl_j[start+k]] -= dd;
       }
-      if(nt>1) deriv_omp[i] += deriv_i;
-      else deriv[i] += deriv_i;
+      deriv_t[i] += deriv_i;
       bias += 0.5*fedensity;
     }
     #pragma omp critical
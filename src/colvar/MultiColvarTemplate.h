@@ -23,6 +23,7 @@
 #define __PLUMED_colvar_MultiColvarTemplate_h
 
 #include "core/ActionWithVector.h"
+#include "small_vector/small_vector.h"
 
 namespace PLMD {
 namespace colvar {
@@ -47,6 +48,7 @@ public:
   void setupStreamedComponents( const std::string& headstr, unsigned& nquants, unsigned& nmat, unsigned& maxcol, unsigned& nbookeeping ) override ;
   void performTask( const unsigned&, MultiValue& ) const override ;
   void calculate() override;
+  bool canDeferReduction() const override { return true; }
 };
 
 template <class T>
@@ -150,13 +152,15 @@ void MultiColvarTemplate<T>::performTask( const unsigned& task_index, MultiValue
     }
   } else if( fpositions.size()==1 ) fpositions[0]=delta(Vector(0.0,0.0,0.0),getPosition( ablocks[0][task_index] ) );
   // Retrieve the masses and charges
-  myvals.resizeTemporyVector(2);
+  myvals.resizeTemporyVector(3);
   std::vector<double> & mass( myvals.getTemporyVector(0) );
   std::vector<double> & charge( myvals.getTemporyVector(1) );
   if( mass.size()!=ablocks.size() ) { mass.resize(ablocks.size()); charge.resize(ablocks.size()); }
   for(unsigned i=0; i<ablocks.size(); ++i) { mass[i]=getMass( ablocks[i][task_index] ); charge[i]=getCharge( ablocks[i][task_index] ); }
-  // Make some space to store various things
-  std::vector<double> values( getNumberOfComponents() );
+  // Make some space to store various things.  The buffers in the MultiValue are reused by all the tasks that run on a thread
+  // so nothing is allocated once the first task has been performed
+  std::vector<double> & values( myvals.getTemporyVector(2) );
+  values.assign( getNumberOfComponents(), 0.0 );
   std::vector<Tensor> & virial( myvals.getFirstAtomVirialVector() );
   std::vector<std::vector<Vector> > & derivs( myvals.getFirstAtomDerivativeVector() );
   if( derivs.size()!=values.size() ) { derivs.resize( values.size() ); virial.resize( values.size() ); }
@@ -169,11 +173,15 @@ void MultiColvarTemplate<T>::performTask( const unsigned& task_index, MultiValue
   // Finish if there are no derivatives
   if( doNotCalculateDerivatives() ) return;
 
+  // Positions of the components in the stream, kept on the stack
+  const unsigned ncomp=getNumberOfComponents();
+  gch::small_vector<unsigned,8> jvals( ncomp );
+  for(unsigned j=0; j<ncomp; ++j) jvals[j]=getConstPntrToComponent(j)->getPositionInStream();
   // Now transfer the derivatives to the underlying MultiValue
   for(unsigned i=0; i<ablocks.size(); ++i) {
     unsigned base=3*ablocks[i][task_index];
-    for(int j=0; j<getNumberOfComponents(); ++j) {
-      unsigned jval=getConstPntrToComponent(j)->getPositionInStream();
+    for(unsigned j=0; j<ncomp; ++j) {
+      const unsigned jval=jvals[j];
       myvals.addDerivative( jval, base + 0, derivs[j][i][0] );
       myvals.addDerivative( jval, base + 1, derivs[j][i][1] );
       myvals.addDerivative( jval, base + 2, derivs[j][i][2] );
@@ -184,16 +192,16 @@ void MultiColvarTemplate<T>::performTask( const unsigned& task_index, MultiValue
       if( ablocks[j][task_index]==ablocks[i][task_index] ) { newi=false; break; }
     }
     if( !newi ) continue;
-    for(int j=0; j<getNumberOfComponents(); ++j) {
-      unsigned jval=getConstPntrToComponent(j)->getPositionInStream();
+    for(unsigned j=0; j<ncomp; ++j) {
+      const unsigned jval=jvals[j];
       myvals.updateIndex( jval, base );
       myvals.updateIndex( jval, base + 1 );
       myvals.updateIndex( jval, base + 2 );
     }
   }
   unsigned nvir=3*getNumberOfAtoms();
-  for(int j=0; j<getNumberOfComponents(); ++j) {
-    unsigned jval=getConstPntrToComponent(j)->getPositionInStream();
+  for(unsigned j=0; j<ncomp; ++j) {
+    const unsigned jval=jvals[j];
     for(unsigned i=0; i<3; ++i) {
       for(unsigned k=0; k<3; ++k) {
         myvals.addDerivative( jval, nvir + 3*i + k, virial[j][i][k] );
@@ -27,6 +27,8 @@
 #include "tools/PDB.h"
 #include "tools/RMSD.h"
 #include "tools/Tools.h"
+#include "tools/OpenMP.h"
+#include <algorithm>
 
 namespace PLMD {
 namespace colvar {
@@ -37,6 +39,7 @@ void PathMSDBase::registerKeywords(Keywords& keys) {
   keys.add("compulsory","REFERENCE","the pdb is needed to provide the various milestones");
   keys.add("optional","NEIGH_SIZE","size of the neighbor list");
   keys.add("optional","NEIGH_STRIDE","how often the neighbor list needs to be calculated in time units");
+  keys.addFlag("NEIGH_SCREEN",false,"when the neighbor list is rebuilt, skip the frames for which a lower bound on the MSD shows that they cannot enter the list. On these steps the path variables are computed from the frames that were not skipped");
   keys.add("optional", "EPSILON", "(default=-1) the maximum distance between the close and the current structure, the positive value turn on the close structure method");
   keys.add("optional", "LOG_CLOSE", "(default=0) value 1 enables logging regarding the close structure");
   keys.add("optional", "DEBUG_CLOSE", "(default=0) value 1 enables extensive debugging info regarding the close structure, the simulation will run much slower");
@@ -47,6 +50,7 @@ PathMSDBase::PathMSDBase(const ActionOptions&ao):
   nopbc(false),
   neigh_size(-1),
   neigh_stride(-1),
+  neigh_screen(false),
   epsilonClose(-1),
   debugClose(0),
   logClose(0),
@@ -56,6 +60,7 @@ PathMSDBase::PathMSDBase(const ActionOptions&ao):
   parse("LAMBDA",lambda);
   parse("NEIGH_SIZE",neigh_size);
   parse("NEIGH_STRIDE",neigh_stride);
+  parseFlag("NEIGH_SCREEN",neigh_screen);
   parse("REFERENCE",reference);
   parse("EPSILON", epsilonClose);
   parse("LOG_CLOSE", logClose);
@@ -106,6 +111,10 @@ PathMSDBase::PathMSDBase(const ActionOptions&ao):
     //set up rmsdRefClose, initialize it to the first structure loaded from reference file
     rmsdPosClose.set(pdbv[0], "OPTIMAL");
     firstPosClose = true;
+    common_align=msdv[0].getAlign();
+    for(unsigned i=1; i<msdv.size(); ++i) {
+      if(msdv[i].getAlign()!=common_align) { common_align.clear(); break; }
+    }
   }
   if(neigh_stride>0 || neigh_size>0) {
     if(neigh_size>int(nframes)) {
@@ -115,10 +124,23 @@ PathMSDBase::PathMSDBase(const ActionOptions&ao):
     log.printf("  Neighbor list enabled: \n");
     log.printf("                size   :  %d elements\n",neigh_size);
     log.printf("                stride :  %d timesteps \n",neigh_stride);
+    if(neigh_screen) {
+      if(common_align.empty()) error("NEIGH_SCREEN requires all the frames to have the same align weights");
+      for(unsigned i=0; i<nframes; ++i) {
+        if(msdv[i].getDisplace()!=common_align) error("NEIGH_SCREEN requires the align and displace weights to be equal");
+        const std::vector<Vector>& ref(msdv[i].getReference());
+        Vector c; for(unsigned j=0; j<ref.size(); ++j) c+=ref[j]*common_align[j];
+        double m=0; for(unsigned j=0; j<ref.size(); ++j) m+=modulo2(ref[j]-c)*common_align[j];
+        ref_moment.push_back(m);
+      }
+      log.printf("                frames that cannot enter the list are skipped when it is rebuilt\n");
+    }
   } else {
     log.printf("  Neighbor list NOT enabled \n");
+    if(neigh_screen) error("NEIGH_SCREEN can only be used with NEIGH_SIZE and NEIGH_STRIDE");
   }
   if (epsilonClose > 0) {
+    if(neigh_screen) error("NEIGH_SCREEN cannot be used with the close structure method");
     log.printf(" Computing with the close structure, epsilon = %lf\n", epsilonClose);
     log << "  Bibliography " << plumed.cite("Pazurikova J, Krenek A, Spiwok V, Simkova M J. Chem. Phys. 146, 115101 (2017)") << "\n";
   }
@@ -140,6 +162,62 @@ PathMSDBase::PathMSDBase(const ActionOptions&ao):
 PathMSDBase::~PathMSDBase() {
 }
 
+void PathMSDBase::calculateDistances(const unsigned& first, std::vector<double>& distances, std::vector<Vector>& derivs) const {
+  const unsigned stride=comm.Get_size(), rank=comm.Get_rank(), nat=pdbv[0].size();
+  // if all frames use the same weights the running structure is centered only once
+  const std::vector<Vector>& pos(getPositions());
+  Vector center;
+  if(!common_align.empty()) for(unsigned j=0; j<nat; j++) center+=pos[j]*common_align[j];
+  const unsigned n=imgVec.size()-first;
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*stride>n) nt=1;
+  // store temporary local results, the frames are distributed over the threads
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<Vector> omp_derivs;
+    #pragma omp for
+    for(unsigned i=rank; i<n; i+=stride) {
+      const RMSD& msd(msdv[imgVec[first+i].index]);
+      if(common_align.empty()) distances[i]=msd.calculate(pos,omp_derivs,true);
+      else distances[i]=msd.calculate(pos,center,omp_derivs,true);
+      plumed_assert(omp_derivs.size()==nat);
+      #pragma omp simd
+      for(unsigned j=0; j<nat; j++) derivs[i*nat+j]=omp_derivs[j];
+    }
+  }
+}
+
+void PathMSDBase::getLowerBounds(std::vector<double>& bounds) const {
+  const std::vector<Vector>& pos(getPositions());
+  Vector center; for(unsigned j=0; j<pos.size(); ++j) center+=pos[j]*common_align[j];
+  double m=0; for(unsigned j=0; j<pos.size(); ++j) m+=modulo2(pos[j]-center)*common_align[j];
+  // The optimal MSD is rr00+rr11-2*max_R tr(R rr01) and Cauchy-Schwarz gives tr(R rr01)<=sqrt(rr00*rr11)
+  bounds.resize(nframes); const double sm=std::sqrt(m);
+  for(unsigned i=0; i<nframes; ++i) { const double d=sm-std::sqrt(ref_moment[i]); bounds[i]=d*d; }
+}
+
+void PathMSDBase::addUnscreenedFrames(const std::vector<double>& bounds) {
+  double maxdist=0;
+  for(const auto & it : imgVec) if(it.distance>maxdist) maxdist=it.distance;
+  std::vector<bool> done(nframes,false);
+  for(const auto & it : imgVec) done[it.index]=true;
+  const unsigned first=imgVec.size();
+  for(unsigned i=0; i<nframes; ++i) {
+    if(done[i] || bounds[i]>=maxdist) continue;
+    ImagePath img; img.index=i; img.property=indexvec[i]; imgVec.push_back(img);
+  }
+  if(imgVec.size()==first) return;
+  const unsigned n=imgVec.size()-first, nat=pdbv[0].size();
+  std::vector<double> tmp_distances(n,0.0);
+  std::vector<Vector> tmp_derivs2(n*nat);
+  calculateDistances(first,tmp_distances,tmp_derivs2);
+  comm.Sum(tmp_distances); comm.Sum(tmp_derivs2);
+  for(unsigned i=0; i<n; i++) {
+    imgVec[first+i].distance=tmp_distances[i];
+    imgVec[first+i].distder.assign(&tmp_derivs2[i*nat],nat+&tmp_derivs2[i*nat]);
+  }
+}
+
 void PathMSDBase::calculate() {
 
   if(neigh_size>0 && getExchangeStep()) error("Neighbor lists for this collective variable are not compatible with replica exchange, sorry for that!");
@@ -150,12 +228,28 @@ void PathMSDBase::calculate() {
 
 
   // resize the list to full
+  bool rebuild=false;
+  std::vector<double> bounds;
   if(imgVec.empty()) { // this is the signal that means: recalculate all
-    imgVec.resize(nframes);
-    #pragma omp simd
-    for(unsigned i=0; i<nframes; i++) {
-      imgVec[i].property=indexvec[i];
-      imgVec[i].index=i;
+    rebuild=true;
+    if(neigh_screen) {
+      // start from the frames with the smallest lower bounds, the others are added below if they could enter the list
+      getLowerBounds(bounds);
+      std::vector<std::pair<double,unsigned> > order(nframes);
+      for(unsigned i=0; i<nframes; i++) order[i]=std::pair<double,unsigned>(bounds[i],i);
+      std::sort(order.begin(),order.end());
+      imgVec.resize(neigh_size);
+      for(unsigned i=0; i<imgVec.size(); i++) {
+        imgVec[i].property=indexvec[order[i].second];
+        imgVec[i].index=order[i].second;
+      }
+    } else {
+      imgVec.resize(nframes);
+      #pragma omp simd
+      for(unsigned i=0; i<nframes; i++) {
+        imgVec[i].property=indexvec[i];
+        imgVec[i].index=i;
+      }
     }
   }
 
@@ -236,12 +330,7 @@ void PathMSDBase::calculate() {
   }
   else {
     // store temporary local results
-    for(unsigned i=rank; i<imgVec.size(); i+=stride) {
-      tmp_distances[i]=msdv[imgVec[i].index].calculate(getPositions(),tmp_derivs,true);
-      plumed_assert(tmp_derivs.size()==nat);
-      #pragma omp simd
-      for(unsigned j=0; j<nat; j++) tmp_derivs2[i*nat+j]=tmp_derivs[j];
-    }
+    calculateDistances(0,tmp_distances,tmp_derivs2);
   }
 
 // reduce over all processors
@@ -258,6 +347,7 @@ void PathMSDBase::calculate() {
     imgVec[i].distance=tmp_distances[i];
     imgVec[i].distder.assign(&tmp_derivs2[i*nat],nat+&tmp_derivs2[i*nat]);
   }
+  if(rebuild && neigh_screen) addUnscreenedFrames(bounds);
 
 // END OF THE HEAVY PART
 
@@ -322,7 +412,7 @@ void PathMSDBase::calculate() {
       imgVec.clear();
     }
     // time to analyze the results:
-    if(imgVec.size()==nframes) {
+    if(rebuild && !imgVec.empty()) {
       //sort by msd
       sort(imgVec.begin(), imgVec.end(), imgOrderByDist());
       //resize
@@ -64,6 +64,19 @@ class PathMSDBase : public Colvar {
   int neigh_size;
   int neigh_stride;
   std::vector<RMSD> msdv;
+/// The align weights if they are the same for all the frames (empty otherwise).  The center of the
+/// running structure is then computed once and reused for all the frames
+  std::vector<double> common_align;
+/// Are frames that cannot enter the neighbor list skipped when it is rebuilt
+  bool neigh_screen;
+/// The weighted second moment of each reference frame about its center, used for the lower bound on the MSD
+  std::vector<double> ref_moment;
+/// Compute the MSD and its derivatives for the frames in imgVec starting from first
+  void calculateDistances(const unsigned& first, std::vector<double>& distances, std::vector<Vector>& derivs) const ;
+/// Get the lower bound (sqrt(I_pos)-sqrt(I_ref))^2 on the MSD from each frame
+  void getLowerBounds(std::vector<double>& bounds) const ;
+/// Add the frames whose lower bound is smaller than the largest MSD in imgVec and compute their distances
+  void addUnscreenedFrames(const std::vector<double>& bounds);
   std::string reference;
   std::vector<Vector> derivs_s;
   std::vector<Vector> derivs_z;
@@ -22,6 +22,7 @@
 #include "FindContour.h"
 #include "core/ActionRegister.h"
 #include "core/PlumedMain.h"
+#include "tools/OpenMP.h"
 
 //+PLUMEDOC GRIDANALYSIS FIND_CONTOUR
 /*
@@ -138,29 +139,57 @@ void FindContour::getNumberOfTasks( unsigned& ntasks ) {
   ntasks = active_cells.size();
 
   Value* gval=getPntrToArgument(0);
-  unsigned npoints = gval->getNumberOfValues();
-  std::vector<unsigned> ind( gval->getRank() );
-  std::vector<unsigned> ones( gval->getRank(), 1 );
-  std::vector<unsigned> nbin( getInputGridObject().getNbin( false ) );
-  unsigned num_neighbours; std::vector<unsigned> neighbours;
+  const unsigned npoints = gval->getNumberOfValues();
+  const unsigned rank = gval->getRank();
+  const gridtools::GridCoordinatesObject& gridobj=getInputGridObject();
+  std::vector<unsigned> nbin( gridobj.getNbin( false ) );
+
+  // If a buffer is used only look near the grid points where the contour was on the last step
+  const bool searchall = gbuffer==0 || last_points.empty();
+  if( !searchall ) {
+    to_check.assign( npoints, 0 );
+    std::vector<unsigned> ind( rank ), nneigh( rank, gbuffer ), neighbours; unsigned num_neighbours;
+    for(const auto & p : last_points) {
+      gridobj.getIndices( p, ind );
+      gridobj.getNeighbors( ind, nneigh, num_neighbours, neighbours );
+      for(unsigned k=0; k<num_neighbours; ++k) to_check[neighbours[k]]=1;
+    }
+  }
 
   std::fill( active_cells.begin(), active_cells.end(), 0 );
-  for(unsigned i=0; i<npoints; ++i) {
-    // Get the index of the current grid point
-    getInputGridObject().getIndices( i, ind );
-    getInputGridObject().getNeighbors( ind, ones, num_neighbours, neighbours );
-    // Get the value of a point on the grid
-    double val1=gval->get( i ) - contour;
-    bool edge=false;
-    for(unsigned j=0; j<gval->getRank(); ++j) {
-      // Make sure we don't search at the edge of the grid
-      if( !getInputGridObject().isPeriodic(j) && (ind[j]+1)==nbin[j] ) continue;
-      else if( (ind[j]+1)==nbin[j] ) { edge=true; ind[j]=0; }
-      else ind[j]+=1;
-      double val2=gval->get( getInputGridObject().getIndex(ind) ) - contour;
-      if( val1*val2<0 ) active_cells[gval->getRank()*i + j] = 1;
-      if( getInputGridObject().isPeriodic(j) && edge ) { edge=false; ind[j]=nbin[j]-1; }
-      else ind[j]-=1;
+  // Only the cells whose edges join points on opposite sides of the contour are searched
+  unsigned nt=OpenMP::getNumThreads();
+  if( nt*64>npoints ) nt=1;
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<unsigned> ind( rank );
+    #pragma omp for
+    for(unsigned i=0; i<npoints; ++i) {
+      if( !searchall && !to_check[i] ) continue;
+      // Get the index of the current grid point
+      gridobj.getIndices( i, ind );
+      // Get the value of a point on the grid
+      double val1=gval->get( i ) - contour;
+      bool edge=false;
+      for(unsigned j=0; j<rank; ++j) {
+        // Make sure we don't search at the edge of the grid
+        if( !gridobj.isPeriodic(j) && (ind[j]+1)==nbin[j] ) continue;
+        else if( (ind[j]+1)==nbin[j] ) { edge=true; ind[j]=0; }
+        else ind[j]+=1;
+        double val2=gval->get( gridobj.getIndex(ind) ) - contour;
+        if( val1*val2<0 ) active_cells[rank*i + j] = 1;
+        if( gridobj.isPeriodic(j) && edge ) { edge=false; ind[j]=nbin[j]-1; }
+        else ind[j]-=1;
+      }
+    }
+  }
+
+  if( gbuffer>0 ) {
+    last_points.clear();
+    for(unsigned i=0; i<npoints; ++i) {
+      for(unsigned j=0; j<rank; ++j) {
+        if( active_cells[rank*i + j]>0 ) { last_points.push_back(i); break; }
+      }
     }
   }
 }
@@ -32,6 +32,10 @@ class FindContour : public ContourFindingBase {
 private:
   unsigned gbuffer;
   std::vector<unsigned> active_cells;
+/// The grid points that had an active cell on the last step, used when BUFFER is set
+  std::vector<unsigned> last_points;
+/// The grid points that are checked on this step when BUFFER is set
+  std::vector<char> to_check;
 public:
   static void registerKeywords( Keywords& keys );
   explicit FindContour(const ActionOptions&ao);
@@ -41,6 +45,7 @@ public:
   void areAllTasksRequired( std::vector<ActionWithVector*>& task_reducing_actions ) override ;
   void getNumberOfTasks( unsigned& ntasks ) override ;
   int checkTaskStatus( const unsigned& taskno, int& flag ) const override ;
+  bool checkTaskStatusIsUnchanged() const override { return false; }
   std::vector<std::string> getGridCoordinateNames() const override { plumed_error(); }
   const gridtools::GridCoordinatesObject& getGridCoordinatesObject() const override { plumed_error(); }
   void performTask( const unsigned& current, MultiValue& myvals ) const override;
@@ -141,6 +141,16 @@ int Action::fclose(FILE*fp) {
   return plumed.fclose(fp);
 }
 
+Action::MemoryUsage Action::getMemoryUsage() {
+  MemoryUsage usage;
+  ActionWithValue* av=castToActionWithValue();
+  if(av) for(int i=0; i<av->getNumberOfComponents(); ++i) usage.values+=av->copyOutput(i)->getMemoryUsage();
+  ActionAtomistic* aa=castToActionAtomistic();
+  if(aa) usage.atoms+=aa->getAtomsMemoryUsage();
+  addMemoryUsage(usage);
+  return usage;
+}
+
 void Action::fflush() {
   for(const auto & p : files) {
     std::fflush(p);
@@ -216,6 +226,15 @@ void Action::activate() {
   active=true;
 }
 
+void Action::activateDerivatives() {
+  ActionWithValue* av=castToActionWithValue();
+  if( av ) {
+    if( av->derivativesOnStep() ) return;
+    av->setDerivativesOnStep( true );
+  }
+  for(const auto & p : after) p->activateDerivatives();
+}
+
 void Action::setOption(const std::string &s) {
 // This overloads the action and activate some options
   options.insert(s);
@@ -325,6 +344,19 @@ void Action::calculateFromPDB( const PDB& pdb ) {
   calculate();
 }
 
+bool Action::canCalculateConcurrently() const {
+  // Actions that modify the positions (e.g. WHOLEMOLECULES or FIT_TO_TEMPLATE, which has a value) and actions without values
+  // can change the atoms that are used by later actions so they must be done in order
+  const ActionAtomistic* aa=dynamic_cast<const ActionAtomistic*>(this);
+  if( aa && aa->modifiesGlobalPositions() ) return false;
+  return dynamic_cast<const ActionWithValue*>(this)!=NULL;
+}
+
+bool Action::canApplyConcurrently() const {
+  // All atomistic actions add forces to the same atoms so they must apply their forces one at a time
+  return dynamic_cast<const ActionWithValue*>(this)!=NULL && dynamic_cast<const ActionAtomistic*>(this)==NULL;
+}
+
 bool Action::getExchangeStep()const {
   return plumed.getExchangeStep();
 }
@@ -21,9 +21,11 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #ifndef __PLUMED_core_Action_h
 #define __PLUMED_core_Action_h
+#include <array>
 #include <vector>
 #include <string>
 #include <set>
+#include <iosfwd>
 #include "tools/Keywords.h"
 #include "tools/Tools.h"
 #include "tools/Units.h"
@@ -94,6 +96,9 @@ class Action {
 /// Save the timestep here
   double timestep;
 
+/// Time spent computing and waiting in collective communications, see addLoadBalanceTimes
+  std::array<double,2> loadBalanceTimes{ {0.0,0.0} };
+
 protected:
 /// Get the units that we are operating in
   const Units& getUnits() const;
@@ -265,6 +270,45 @@ public:
 /// The set of all Actions in run for the final time in forward order.
   virtual void runFinalJobs() {}
 
+/// Write the internal state of the action on a binary checkpoint.
+/// Actions that accumulate information during the simulation can override this
+/// together with readCheckpoint so as to be restarted exactly (see PlumedMain::writeCheckpoint).
+/// The state should be written without communicating, since this is only called on the root process
+  virtual void writeCheckpoint(std::ostream&) {}
+
+/// Restore the state written by writeCheckpoint
+  virtual void readCheckpoint(std::istream&) {}
+
+/// Memory allocated by an action, in bytes, split in categories
+  struct MemoryUsage {
+/// Data and forces of the values
+    std::size_t values=0;
+/// Positions, forces, masses and charges of the atoms
+    std::size_t atoms=0;
+/// Buffers and workspaces used during the calculation
+    std::size_t buffers=0;
+/// Grids
+    std::size_t grids=0;
+/// Neighbor lists, lists of hills and similar
+    std::size_t lists=0;
+    std::size_t total() const { return values+atoms+buffers+grids+lists; }
+  };
+
+/// Get the memory allocated by this action.
+/// The memory of the values and of the atoms is collected here, the rest is added by addMemoryUsage
+  MemoryUsage getMemoryUsage();
+
+/// Add the memory of the buffers, grids and lists owned by the action.
+/// Classes overriding this should call the method of their parent class
+  virtual void addMemoryUsage(MemoryUsage&) const {}
+
+/// Accumulate the time (in seconds) spent by this process computing and
+/// waiting for the other processes in collective communications
+  void addLoadBalanceTimes(double compute,double wait) { loadBalanceTimes[0]+=compute; loadBalanceTimes[1]+=wait; }
+/// Time spent computing and waiting since the last call to resetLoadBalanceTimes
+  const std::array<double,2> & getLoadBalanceTimes() const { return loadBalanceTimes; }
+  void resetLoadBalanceTimes() { loadBalanceTimes= {0.0,0.0}; }
+
 /// Tell to the Action to flush open files
   void fflush();
 
@@ -300,6 +344,19 @@ public:
 /// Check if the action needs gradient
   virtual bool checkNeedsGradients()const {return false;}
 
+/// Check if the action needs the derivatives of the actions it depends on on this step
+  virtual bool checkNeedsDerivatives()const {return checkNeedsGradients();}
+
+/// Switch on the derivatives for this step in this action and in all the actions it depends on
+  void activateDerivatives();
+
+/// Check if this action can be calculated at the same time as other actions that it does not depend on.
+/// This is only used if the concurrent calculation of independent actions has been requested with PLUMED_CONCURRENT_ACTIONS
+  virtual bool canCalculateConcurrently() const ;
+
+/// Check if this action can apply its forces at the same time as other actions that do not share any of its dependencies
+  virtual bool canApplyConcurrently() const ;
+
 /// Perform calculation using numerical derivatives
 /// N.B. only pass an ActionWithValue to this routine if you know exactly what you
 /// are doing.
@@ -48,7 +48,8 @@ ActionAtomistic::ActionAtomistic(const ActionOptions&ao):
   donotretrieve(false),
   donotforce(false),
   massesWereSet(false),
-  chargesWereSet(false)
+  chargesWereSet(false),
+  massesAndChargesRetrieved(false)
 {
   ActionWithValue* bv = plumed.getActionSet().selectWithLabel<ActionWithValue*>("Box");
   if( bv ) boxValue=bv->copyOutput(0);
@@ -91,6 +92,11 @@ void ActionAtomistic::getAtomValuesFromPlumedObject( const PlumedMain& plumed, s
   }
 }
 
+std::size_t ActionAtomistic::getAtomsMemoryUsage() const {
+  return Tools::getMemoryUsage(indexes)+Tools::getMemoryUsage(unique)+Tools::getMemoryUsage(unique_local)
+         +Tools::getMemoryUsage(positions)+Tools::getMemoryUsage(masses)+Tools::getMemoryUsage(charges)+Tools::getMemoryUsage(forces);
+}
+
 void ActionAtomistic::registerKeywords( Keywords& keys ) {
   (void) keys; // avoid warning
 }
@@ -104,6 +110,7 @@ void ActionAtomistic::requestAtoms(const std::vector<AtomNumber> & a, const bool
   forces.resize(nat);
   masses.resize(nat);
   charges.resize(nat);
+  massesAndChargesRetrieved=false;
   atom_value_ind.resize( a.size() );
   int n=getTotAtoms();
   if(clearDep) clearDependencies();
@@ -373,11 +380,23 @@ void ActionAtomistic::retrieveAtoms( const bool& force ) {
 //   j++;
 // }
 
+  // Masses and charges that are constant are only copied the first time they are available
+  bool allconstant=massesWereSet && chargesWereSet;
   for(const auto & a : atom_value_ind_grouped) {
     const auto nn=a.first;
     auto & xp=xpos[nn]->data;
     auto & yp=ypos[nn]->data;
     auto & zp=zpos[nn]->data;
+    if( massesAndChargesRetrieved && masv[nn]->isConstant() && chargev[nn]->isConstant() ) {
+      for(const auto & kk : a.second) {
+        positions[j][0] = xp[kk];
+        positions[j][1] = yp[kk];
+        positions[j][2] = zp[kk];
+        j++;
+      }
+      continue;
+    }
+    if( !masv[nn]->isConstant() || !chargev[nn]->isConstant() ) allconstant=false;
     auto & ch=chargev[nn]->data;
     auto & ma=masv[nn]->data;
     for(const auto & kk : a.second) {
@@ -389,6 +408,7 @@ void ActionAtomistic::retrieveAtoms( const bool& force ) {
       j++;
     }
   }
+  if( allconstant ) massesAndChargesRetrieved=true;
 
 }
 
@@ -449,6 +469,7 @@ void ActionAtomistic::readAtomsFromPDB(const PDB& pdb) {
   }
   for(unsigned j=0; j<indexes.size(); j++) charges[j]=pdb.getBeta()[indexes[j].index()];
   for(unsigned j=0; j<indexes.size(); j++) masses[j]=pdb.getOccupancy()[indexes[j].index()];
+  massesAndChargesRetrieved=false;
 }
 
 unsigned ActionAtomistic::getTotAtoms()const {
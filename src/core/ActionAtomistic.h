@@ -82,6 +82,8 @@ class ActionAtomistic :
 protected:
   bool                  massesWereSet;
   bool                  chargesWereSet;
+/// Set true once constant masses and charges have been copied so they are not copied again on every step
+  bool                  massesAndChargesRetrieved;
   void setExtraCV(const std::string &name);
 /// Used to interpret whether this index is a virtual atom or a real atom
   std::pair<std::size_t, std::size_t> getValueIndices( const AtomNumber& i ) const ;
@@ -175,6 +177,9 @@ public:
   ~ActionAtomistic();
   static void registerKeywords( Keywords& keys );
 
+/// Number of bytes allocated to store the positions, masses, charges and forces of the atoms
+  std::size_t getAtomsMemoryUsage() const ;
+
 /// N.B. only pass an ActionWithValue to this routine if you know exactly what you
 /// are doing.  The default will be correct for the vast majority of cases
   void   calculateNumericalDerivatives( ActionWithValue* a=NULL ) override;
@@ -194,6 +199,8 @@ public:
   void getGradient( const unsigned& ind, Vector& deriv, std::map<AtomNumber,Vector>& gradients ) const ;
   ActionAtomistic* castToActionAtomistic() noexcept final { return this; }
   virtual bool actionHasForces();
+/// Return true if this action changes the positions (or the box) that are used by the actions that follow it (e.g. WHOLEMOLECULES or FIT_TO_TEMPLATE)
+  virtual bool modifiesGlobalPositions() const { return false; }
 };
 
 inline
@@ -39,8 +39,7 @@ std::unique_ptr<Action> ActionRegister::create(const std::vector<void*> & images
   if(ao.line.size()<1)return nullptr;
 
   auto content=get(images,ao.line[0]);
-  Keywords keys; keys.thisactname = ao.line[0];
-  content.keys(keys);
+  const Keywords& keys=getCachedKeywords(images,ao.line[0]);
   ActionOptions nao( ao,keys );
   auto fullPath=getFullPath(images,ao.line[0]);
   nao.setFullPath(fullPath);
@@ -84,17 +83,43 @@ ActionRegister::ID ActionRegister::add(std::string key,creator_pointer cp,keywor
   return RegisterBase::add(key,Pointers{cp,kp});
 }
 
+void ActionRegister::remove(ID id) {
+  {
+    std::lock_guard<std::mutex> lock(keywordsCacheMutex);
+    keywordsCache.clear();
+  }
+  RegisterBase::remove(id);
+}
+
+const Keywords& ActionRegister::getCachedKeywords(const std::vector<void*> & images,const std::string& action) {
+  auto content=get(images,action);
+  std::string key=getFullPath(images,action)+":"+action;
+  {
+    std::lock_guard<std::mutex> lock(keywordsCacheMutex);
+    auto found=keywordsCache.find(key);
+    if(found!=keywordsCache.end()) return *found->second;
+  }
+// keywords are built without holding the lock, so that registerKeywords can use the register
+  auto keys=std::make_unique<Keywords>();
+  keys->thisactname = action;
+  content.keys(*keys);
+  std::lock_guard<std::mutex> lock(keywordsCacheMutex);
+  auto & cached=keywordsCache[key];
+  if(!cached) cached=std::move(keys);
+  return *cached;
+}
+
 bool ActionRegister::getKeywords(const std::string& action, Keywords& keys) {
   if(check(action)) {
-    keys.thisactname = action;
-    get(action).keys(keys);
+    std::vector<void*> images; // empty vector
+    keys=getCachedKeywords(images,action);
     return true;
   }
   return false;
 }
 
 void ActionRegister::getKeywords(const std::vector<void*> & images, const std::string& action, Keywords& keys) {
-  auto content=get(images,action); keys.thisactname = action; content.keys(keys);
+  keys=getCachedKeywords(images,action);
 }
 
 }
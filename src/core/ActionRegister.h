@@ -25,6 +25,9 @@
 #include "RegisterBase.h"
 
 #include "tools/Keywords.h"
+#include <map>
+#include <memory>
+#include <mutex>
 
 namespace PLMD {
 
@@ -54,8 +57,18 @@ class ActionRegister:
   typedef ActionRegisterPointers::keywords_pointer keywords_pointer;
   typedef ActionRegisterPointers Pointers;
 
+/// Keywords of the actions that have been used, indexed by full path and directive.
+/// Registration only stores the function pointers, keywords are built the first time they are needed
+  std::map<std::string,std::unique_ptr<const Keywords>> keywordsCache;
+  std::mutex keywordsCacheMutex;
+
 public:
   ID add(std::string key,creator_pointer cp,keywords_pointer kp);
+/// Remove a registered action, clearing the cached keywords
+  void remove(ID id);
+/// Get the keywords of an action, building them the first time they are requested.
+/// The returned reference stays valid until an action is removed from the register
+  const Keywords& getCachedKeywords(const std::vector<void*> & images,const std::string& action);
 /// Create an Action of the type indicated in the options
 /// \param ao object containing information for initialization, such as the full input line, a pointer to PlumedMain, etc
   std::unique_ptr<Action> create(const ActionOptions&ao);
@@ -38,7 +38,7 @@ PLUMED_REGISTER_ACTION(ActionToGetData,"GET")
 
 void ActionToGetData::registerKeywords(Keywords& keys) {
   Action::registerKeywords(keys); ActionPilot::registerKeywords(keys); ActionWithArguments::registerKeywords(keys);
-  keys.addInputKeyword("optional","ARG","scalar/vector/matrix/grid","the label of the value that you would like to GET");
+  keys.addInputKeyword("optional","ARG","scalar/vector/matrix/grid","the labels of the values that you would like to GET.  If more than one value is given they are passed out one after the other in a single vector");
   keys.add("compulsory","STRIDE","1","the frequency with which the quantities of interest should be stored");
   keys.add("compulsory","TYPE","value","what do you want to collect for the value can be derivative/force");
   keys.setValueDescription("scalar/vector/matrix/grid","a copy of the data in the value specified by the ARG keyword");
@@ -58,28 +58,42 @@ ActionToGetData::ActionToGetData(const ActionOptions&ao):
 
   if( gtype!=val ) error("not implemented functionality to pass derviatives or forces to python.  Email gareth.tribello@gmail.com if you want this.");
 
-  if( getNumberOfArguments()!=1 ) error("python interface works best when you ask for one argument at a time");
-  if( getPntrToArgument(0)->getNumberOfValues()==0 ) error("cannot get data as shape of value " + getPntrToArgument(0)->getName() + " has not been set");
-  getPntrToArgument(0)->buildDataStore(); data.resize( getPntrToArgument(0)->getNumberOfValues() );
+  if( getNumberOfArguments()==0 ) error("no values to get");
+  unsigned ntot=0;
+  for(unsigned i=0; i<getNumberOfArguments(); ++i) {
+    if( getPntrToArgument(i)->getNumberOfValues()==0 ) error("cannot get data as shape of value " + getPntrToArgument(i)->getName() + " has not been set");
+    getPntrToArgument(i)->buildDataStore(); ntot += getPntrToArgument(i)->getNumberOfValues();
+  }
+  // With more than one argument the values are collected here and passed out as a single vector
+  if( getNumberOfArguments()>1 ) data.resize( ntot );
 }
 
 void ActionToGetData::get_rank( const TypesafePtr & dims ) {
-  if( getPntrToArgument(0)->getRank()==0 ) { dims.set(long(1)); return; }
+  if( getNumberOfArguments()>1 || getPntrToArgument(0)->getRank()==0 ) { dims.set(long(1)); return; }
   dims.set(long(getPntrToArgument(0)->getRank()));
 }
 
 void ActionToGetData::get_shape( const TypesafePtr & dims ) {
+  if( getNumberOfArguments()>1 ) { dims.set(long(data.size())); return; }
   if( getPntrToArgument(0)->getRank()==0 ) { dims.set(long(1)); return; }
   auto dims_=dims.get<long*>( { getPntrToArgument(0)->getRank() } );
   for(unsigned j=0; j<getPntrToArgument(0)->getRank(); ++j) dims_[j] = getPntrToArgument(0)->getShape()[j];
 }
 
 void ActionToGetData::set_memory( const TypesafePtr & val ) {
-  mydata->setValuePointer(val,getPntrToArgument(0)->getShape(),false);
+  if( getNumberOfArguments()>1 ) { std::vector<unsigned> shape(1,data.size()); mydata->setValuePointer(val,shape,false); }
+  else mydata->setValuePointer(val,getPntrToArgument(0)->getShape(),false);
 }
 
 void ActionToGetData::calculate() {
-  plumed_assert( gtype==val ); mydata->setData( getPntrToArgument(0) );
+  plumed_assert( gtype==val );
+  if( getNumberOfArguments()==1 ) { mydata->setData( getPntrToArgument(0) ); return; }
+  unsigned k=0;
+  for(unsigned i=0; i<getNumberOfArguments(); ++i) {
+    Value* myval=getPntrToArgument(i); unsigned nvals=myval->getNumberOfValues();
+    for(unsigned j=0; j<nvals; ++j) data[k++] = myval->get(j);
+  }
+  mydata->setData( data );
 }
 
 }
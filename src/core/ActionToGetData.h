@@ -37,7 +37,7 @@ private:
   enum {val,deriv,force} gtype;
 /// This holds the pointer that we are setting
   std::unique_ptr<DataPassingObject> mydata;
-/// This temporarily holds the data so it can be passed out
+/// This holds the values of all the arguments when several are passed out in one array
   std::vector<double> data;
 public:
   static void registerKeywords(Keywords& keys);
@@ -42,6 +42,11 @@ ActionWithMatrix::~ActionWithMatrix() {
   if( matrix_to_do_before ) { matrix_to_do_before->matrix_to_do_after=NULL; matrix_to_do_before->next_action_in_chain=NULL; }
 }
 
+void ActionWithMatrix::addMemoryUsage( MemoryUsage& usage ) const {
+  ActionWithVector::addMemoryUsage( usage );
+  usage.buffers+=Tools::getMemoryUsage(matrix_bookeeping);
+}
+
 void ActionWithMatrix::getAllActionLabelsInMatrixChain( std::vector<std::string>& mylabels ) const {
   bool found=false;
   for(unsigned i=0; i<mylabels.size(); ++i) {
@@ -174,6 +179,15 @@ void ActionWithMatrix::gatherThreads( const unsigned& nt, const unsigned& bufsiz
   for(unsigned i=0; i<matrix_bookeeping.size(); ++i) matrix_bookeeping[i] += myvals.getMatrixBookeeping()[i];
 }
 
+void ActionWithMatrix::gatherThreadsInRange( const unsigned& ithread, const unsigned& nt, std::vector<double>& buffer ) {
+  ActionWithVector::gatherThreadsInRange( ithread, nt, buffer );
+  unsigned start, end; getThreadRange( ithread, nt, matrix_bookeeping.size(), start, end );
+  for(unsigned j=0; j<nt; ++j) {
+    const std::vector<unsigned>& matbook( getThreadMultiValue(j).getMatrixBookeeping() );
+    for(unsigned i=start; i<end; ++i) matrix_bookeeping[i] += matbook[i];
+  }
+}
+
 void ActionWithMatrix::gatherProcesses( std::vector<double>& buffer ) {
   ActionWithVector::gatherProcesses( buffer );
   if( matrix_bookeeping.size()>0 && !runInSerial() ) comm.Sum( matrix_bookeeping );
@@ -64,6 +64,8 @@ public:
   virtual bool isAdjacencyMatrix() const { return false; }
 ///
   void getAllActionLabelsInMatrixChain( std::vector<std::string>& mylabels ) const override ;
+/// Add the memory used for the bookeeping of the sparse matrices
+  void addMemoryUsage( MemoryUsage& usage ) const override;
 /// Get the first matrix in this chain
   const ActionWithMatrix* getFirstMatrixInChain() const ;
 ///
@@ -80,6 +82,7 @@ public:
   void gatherStoredValue( const unsigned& valindex, const unsigned& code, const MultiValue& myvals, const unsigned& bufstart, std::vector<double>& buffer ) const override;
 /// Gather all the data from the threads
   void gatherThreads( const unsigned& nt, const unsigned& bufsize, const std::vector<double>& omp_buffer, std::vector<double>& buffer, MultiValue& myvals ) override ;
+  void gatherThreadsInRange( const unsigned& ithread, const unsigned& nt, std::vector<double>& buffer ) override ;
 /// Gather all the data from the MPI processes
   void gatherProcesses( std::vector<double>& buffer ) override;
 /// This is the virtual that will do the calculation of the task for a particular matrix element
@@ -55,6 +55,7 @@ ActionWithValue::ActionWithValue(const ActionOptions&ao):
   Action(ao),
   firststep(true),
   noderiv(true),
+  derivsOnStep(true),
   numericalDerivatives(false)
 {
   if( keywords.exists("NUMERICAL_DERIVATIVES") ) parseFlag("NUMERICAL_DERIVATIVES",numericalDerivatives);
@@ -313,6 +314,12 @@ bool ActionWithValue::checkForForces() {
     for(unsigned i=rank; i<nvalsWithForce; i+=stride) {
       double ff=values[valsToForce[i]]->inputForce[0];
       std::vector<double> & thisderiv( values[valsToForce[i]]->data );
+      // only the derivatives that are not zero are used if they are known
+      if( values[valsToForce[i]]->hasSparseDerivatives() ) {
+        std::vector<double> & f( nt>1 ? omp_f : forcesForApply );
+        for(const auto & j : values[valsToForce[i]]->getActiveDerivatives() ) f[j] += ff*thisderiv[1+j];
+        continue;
+      }
       int nn=nder;
       int one1=1;
       int one2=1;
@@ -79,6 +79,8 @@ private:
   std::vector<unsigned> valsToForce;
 /// Are we skipping the calculation of the derivatives
   bool noderiv;
+/// Are the derivatives needed by one of the actions that is active on this step
+  bool derivsOnStep;
 /// Are we using numerical derivatives to differentiate
   bool numericalDerivatives;
 /// Return the index for the component named name
@@ -137,10 +139,19 @@ public:
   static void useCustomisableComponents(Keywords& keys);
 /// Are we not calculating derivatives
   virtual bool doNotCalculateDerivatives() const ;
+/// Are the derivatives needed on this step
+  bool derivativesOnStep() const { return derivsOnStep; }
+/// Set whether the derivatives are needed on this step
+  void setDerivativesOnStep( const bool& d ) { derivsOnStep=d; }
 /// Get the value of one of the components of the PLMD::Action
   double getOutputQuantity( const unsigned j ) const ;
 /// Get the value with a specific name (N.B. if there is no such value this returns zero)
   double getOutputQuantity( const std::string& name ) const ;
+/// Actions with a bias component override this if they can compute their bias for any value of their arguments
+/// without changing their state.  GREX then only needs the arguments of the partner replica to get its bias
+  virtual bool canComputeBiasFromArguments() const { return false; }
+/// Compute the bias for the given values of the arguments, see canComputeBiasFromArguments
+  virtual double computeBiasFromArguments( const std::vector<double>& /*args*/ ) { plumed_merror("the bias cannot be computed from the arguments in " + getLabel() ); }
 
 //  --- Routines for passing stuff to ActionWithArguments -- //
 
@@ -233,7 +244,7 @@ bool ActionWithValue::checkNumericalDerivatives() const {
 
 inline
 bool ActionWithValue::doNotCalculateDerivatives() const {
-  return noderiv;
+  return noderiv || !derivsOnStep;
 }
 
 inline
@@ -24,6 +24,8 @@
 #include "ActionSet.h"
 #include "tools/OpenMP.h"
 #include "tools/Communicator.h"
+#include <algorithm>
+#include <chrono>
 
 namespace PLMD {
 
@@ -33,6 +35,14 @@ void ActionWithVector::registerKeywords( Keywords& keys ) {
   ActionWithValue::registerKeywords( keys ); keys.remove("NUMERICAL_DERIVATIVES");
   ActionWithArguments::registerKeywords( keys );
   keys.addFlag("SERIAL",false,"do the calculation in serial.  Do not parallelize");
+  keys.add("optional","THREAD_REDUCTION","the method used to sum the data accumulated by the OpenMP threads.  With CRITICAL (the default) the threads add their buffers one at a time. "
+           "With RANGE each thread sums one part of the buffers from all the threads, which is faster when the buffers are large and many threads are used. "
+           "With ATOMIC the threads add their data directly to a single buffer using atomic updates so the memory required does not grow with the number of threads. "
+           "ATOMIC is only available for actions that accumulate data on grids such as KDE");
+  keys.add("optional","TASK_SCHEDULE","the method used to distribute the tasks over the MPI processes and OpenMP threads.  With STATIC (the default) the tasks are shared out cyclically between processes "
+           "and in equal blocks between threads.  DYNAMIC and GUIDED use the corresponding OpenMP schedules for the threads.  COST measures the time taken by each task and uses these timings "
+           "to give each process a block of tasks with the same total cost; the threads then use the DYNAMIC schedule.  This is useful when the costs of the tasks are very different");
+  keys.add("optional","TASK_BALANCE_STRIDE","the number of calculations between updates of the task costs with TASK_SCHEDULE=COST (default 100)");
 }
 
 ActionWithVector::ActionWithVector(const ActionOptions&ao):
@@ -41,14 +51,44 @@ ActionWithVector::ActionWithVector(const ActionOptions&ao):
   ActionWithValue(ao),
   ActionWithArguments(ao),
   serial(false),
+  reduce_threads_by_range(false),
+  reduce_threads_atomically(false),
+  buffer_is_shared(false),
+  task_schedule(staticSchedule),
+  task_balance_stride(100),
+  ncalls_since_balance(0),
+  defer_reduction(false),
+  reduction_pending(false),
+  reduction_compute_time(0),
   action_to_do_before(NULL),
   action_to_do_after(NULL),
   never_reduce_tasks(false),
   reduce_tasks(false),
   atomsWereRetrieved(false),
+  ncached_tasks(0),
   done_in_chain(false)
 {
   if( keywords.exists("SERIAL") ) parseFlag("SERIAL",serial);
+  if( keywords.exists("THREAD_REDUCTION") ) {
+    std::string reduction="CRITICAL"; parse("THREAD_REDUCTION",reduction);
+    if( reduction=="RANGE" ) reduce_threads_by_range=true;
+    else if( reduction=="ATOMIC" ) reduce_threads_atomically=true;
+    else if( reduction!="CRITICAL" ) error("THREAD_REDUCTION should be CRITICAL, RANGE or ATOMIC");
+    if( reduce_threads_by_range ) log.printf("  data from OpenMP threads will be summed in parallel with each thread reducing one part of the buffers\n");
+    if( reduce_threads_atomically ) log.printf("  data from OpenMP threads will be added to a single buffer using atomic updates\n");
+  }
+  if( keywords.exists("TASK_SCHEDULE") ) {
+    std::string schedule="STATIC"; parse("TASK_SCHEDULE",schedule);
+    if( schedule=="DYNAMIC" ) task_schedule=dynamicSchedule;
+    else if( schedule=="GUIDED" ) task_schedule=guidedSchedule;
+    else if( schedule=="COST" ) task_schedule=costSchedule;
+    else if( schedule!="STATIC" ) error("TASK_SCHEDULE should be STATIC, DYNAMIC, GUIDED or COST");
+    if( task_schedule==costSchedule ) {
+      parse("TASK_BALANCE_STRIDE",task_balance_stride);
+      if( task_balance_stride==0 ) error("TASK_BALANCE_STRIDE should be greater than zero");
+      log.printf("  tasks will be distributed using their costs, which are updated every %u calculations\n", task_balance_stride );
+    } else if( task_schedule!=staticSchedule ) log.printf("  using %s schedule for OpenMP threads\n", schedule.c_str() );
+  }
 }
 
 ActionWithVector::~ActionWithVector() {
@@ -370,6 +410,17 @@ void ActionWithVector::taskIsActive( const unsigned& current, int& flag ) const
   if( flag<=0 && action_to_do_after ) action_to_do_after->taskIsActive( current, flag );
 }
 
+void ActionWithVector::getChainActiveState( std::vector<bool>& state ) const {
+  state.push_back( isActive() );
+  if( action_to_do_after ) action_to_do_after->getChainActiveState( state );
+}
+
+bool ActionWithVector::taskStatusIsUnchanged() const {
+  if( isActive() && !checkTaskStatusIsUnchanged() ) return false;
+  if( action_to_do_after ) return action_to_do_after->taskStatusIsUnchanged();
+  return true;
+}
+
 void ActionWithVector::getAdditionalTasksRequired( ActionWithVector* action, std::vector<unsigned>& atasks ) {
   for(unsigned i=0; i<task_control_list.size(); ++i ) task_control_list[i]->getAdditionalTasksRequired( action, atasks );
 }
@@ -392,6 +443,8 @@ std::vector<unsigned>& ActionWithVector::getListOfActiveTasks( ActionWithVector*
   if( nt==0 ) nt=1;
 
   if( !never_reduce_tasks && reduce_tasks ) {
+    // Actions that are switched on or off change which tasks are active so the cached list cannot be used if this has happened
+    std::vector<bool> chain_active; if( task_control_list.size()==0 ) getChainActiveState( chain_active );
     if( task_control_list.size()>0 ) {
       // Get the list of tasks that are active in the action that uses the output of this action
       for(unsigned i=0; i<task_control_list.size(); ++i) {
@@ -400,27 +453,39 @@ std::vector<unsigned>& ActionWithVector::getListOfActiveTasks( ActionWithVector*
       }
       // Now work out else we need from here to calculate the later action
       getAdditionalTasksRequired( action, active_tasks );
+    } else if( ntasks==ncached_tasks && chain_active==cached_chain_active && taskStatusIsUnchanged() ) {
+      // The status of the tasks has not changed since the last time they were checked so we reuse the old list
+      active_tasks = cached_active_tasks;
+      getAdditionalTasksRequired( this, active_tasks );
     } else {
-      std::vector<int> taskFlags( ntasks, -1 );
+      // Each process checks a contiguous block of tasks so the lists of active tasks from the processes
+      // can be concatenated in rank order to give a sorted list.  Only the indices of the active tasks are communicated
+      unsigned tstart, tend; getThreadRange( rank, stride, ntasks, tstart, tend );
+      std::vector<int> taskFlags( tend-tstart, -1 );
 
       #pragma omp parallel num_threads(nt)
       {
         #pragma omp for nowait
-        for(unsigned i=rank; i<ntasks; i+=stride ) {
-          taskIsActive( i, taskFlags[i] );
+        for(unsigned i=tstart; i<tend; ++i ) {
+          taskIsActive( i, taskFlags[i-tstart] );
         }
       }
-      for(unsigned i=0; i<ntasks; ++i) taskFlags[i] = std::abs( taskFlags[i] );
-      if( !serial ) comm.Sum( taskFlags );
-
-      unsigned nt=0;
-      for(unsigned i=0; i<ntasks; ++i) {
-        if( taskFlags[i]>=stride ) nt++;
+      // Tasks whose flag was not set to zero by any action are active
+      std::vector<unsigned> my_active_tasks;
+      for(unsigned i=tstart; i<tend; ++i) {
+        if( taskFlags[i-tstart]!=0 ) my_active_tasks.push_back(i);
       }
-      active_tasks.resize(nt); nt=0;
-      for(unsigned i=0; i<ntasks; ++i) {
-        if( taskFlags[i]>=stride ) { active_tasks[nt]=i; nt++; }
+      if( stride==1 ) active_tasks = my_active_tasks;
+      else {
+        std::vector<int> counts( stride ), displs( stride ); int nmine=my_active_tasks.size();
+        comm.Allgather( nmine, counts );
+        unsigned ntot=0;
+        for(unsigned i=0; i<stride; ++i) { displs[i]=ntot; ntot+=counts[i]; }
+        active_tasks.resize( ntot ); unsigned dummy=0;
+        if( ntot>0 ) comm.Allgatherv( nmine>0 ? my_active_tasks.data() : &dummy, nmine, active_tasks.data(), counts.data(), displs.data() );
       }
+      // Store the list in case the status of the tasks does not change before the next step
+      cached_active_tasks = active_tasks; ncached_tasks = ntasks; cached_chain_active = chain_active;
       getAdditionalTasksRequired( this, active_tasks );
     }
   } else {
@@ -433,6 +498,7 @@ std::vector<unsigned>& ActionWithVector::getListOfActiveTasks( ActionWithVector*
 void ActionWithVector::runAllTasks() {
 // Skip this if this is done elsewhere
   if( action_to_do_before ) return;
+  auto start=std::chrono::steady_clock::now();
 
   unsigned stride=comm.Get_size();
   unsigned rank=comm.Get_rank();
@@ -463,38 +529,178 @@ void ActionWithVector::runAllTasks() {
   unsigned nderivatives = 0; bool gridsInStream=checkForGrids(nderivatives);
   if( !doNotCalculateDerivatives() && !gridsInStream ) getNumberOfStreamedDerivatives( nderivatives, NULL );
 
-  #pragma omp parallel num_threads(nt)
-  {
-    std::vector<double> omp_buffer;
-    if( nt>1 ) omp_buffer.resize( bufsize, 0.0 );
-    MultiValue myvals( nquants, nderivatives, nmatrices, maxcol, nbooks );
-    myvals.clearAll();
-
-    #pragma omp for nowait
-    for(unsigned i=rank; i<nactive_tasks; i+=stride) {
-      // Calculate the stuff in the loop for this action
-      runTask( partialTaskList[i], myvals );
+  // Make sure there is a workspace for every thread
+  if( task_workspace.size()<nt ) task_workspace.resize( nt );
+  // Check if the threads can all add their data to the same buffer
+  buffer_is_shared = nt>1 && reduce_threads_atomically;
+  if( buffer_is_shared ) {
+    for(const ActionWithVector* av=this; av; av=av->action_to_do_after) {
+      if( !av->canAccumulateAtomically() ) error("THREAD_REDUCTION=ATOMIC cannot be used as " + av->getLabel() + " does not support atomic accumulation");
+    }
+  }
 
-      // Now transfer the data to the actions that accumulate values from the calculated quantities
-      if( nt>1 ) gatherAccumulators( partialTaskList[i], myvals, omp_buffer );
-      else gatherAccumulators( partialTaskList[i], myvals, buffer );
+  // Work out which of the active tasks this process is responsible for
+  unsigned tstart=rank, tend=nactive_tasks, tstride=stride;
+  if( task_schedule==costSchedule ) {
+    getCostBalancedTaskRange( partialTaskList, rank, stride, tstart, tend ); tstride=1;
+    if( nactive_tasks>0 && local_task_costs.size()<=partialTaskList[nactive_tasks-1] ) local_task_costs.resize( partialTaskList[nactive_tasks-1]+1, 0 );
+  }
+  // The chunk size for the dynamic schedule
+  unsigned nmine=0; if( tend>tstart ) nmine=(tend-tstart+tstride-1)/tstride;
+  unsigned chunk=nmine/(nt*16); if( chunk==0 ) chunk=1;
 
-      // Clear the value
-      myvals.clearAll();
+  #pragma omp parallel num_threads(nt)
+  {
+    ThreadWorkspace& myws( task_workspace[OpenMP::getThreadNum()] );
+    std::vector<double>& omp_buffer( myws.buffer );
+    if( nt>1 && !buffer_is_shared ) omp_buffer.assign( bufsize, 0.0 );
+    MultiValue& myvals( myws.getMultiValue( nquants, nderivatives, nmatrices, maxcol, nbooks ) );
+    std::vector<double>& mybuffer( nt>1 && !buffer_is_shared ? omp_buffer : buffer );
+
+    if( task_schedule==staticSchedule ) {
+      #pragma omp for nowait
+      for(unsigned i=tstart; i<tend; i+=tstride) runAndGatherTask( partialTaskList[i], myvals, mybuffer );
+    } else if( task_schedule==guidedSchedule ) {
+      #pragma omp for schedule(guided) nowait
+      for(unsigned i=tstart; i<tend; i+=tstride) runAndGatherTask( partialTaskList[i], myvals, mybuffer );
+    } else {
+      #pragma omp for schedule(dynamic,chunk) nowait
+      for(unsigned i=tstart; i<tend; i+=tstride) runAndGatherTask( partialTaskList[i], myvals, mybuffer );
+    }
+    if( buffer_is_shared ) {
+      // Everything was added directly to the shared buffer
+    } else if( nt>1 && reduce_threads_by_range ) {
+      // Wait for every thread to finish its tasks and then get each thread to sum one part of the buffers.
+      // Only the buffers of the threads in the team are summed as the runtime may give us fewer than nt threads
+      #pragma omp barrier
+      gatherThreadsInRange( OpenMP::getThreadNum(), OpenMP::getTeamSize(), buffer );
+    } else {
+      #pragma omp critical
+      gatherThreads( nt, bufsize, omp_buffer, buffer, myvals );
     }
-    #pragma omp critical
-    gatherThreads( nt, bufsize, omp_buffer, buffer, myvals );
   }
 
+  buffer_is_shared=false;
   // MPI Gather everything
-  if( !serial && buffer.size()>0 ) gatherProcesses( buffer );
+  if( !serial && buffer.size()>0 ) {
+    // The time spent in the reduction is mostly spent waiting for the slowest process
+    auto computed=std::chrono::steady_clock::now();
+    if( defer_reduction ) {
+      // The buffer is summed together with those of the other actions and the values are set in completeReduction
+      reduction_compute_time=std::chrono::duration<double>( computed - start ).count();
+      reduction_pending=true;
+      return;
+    }
+    gatherProcesses( buffer );
+    addLoadBalanceTimes( std::chrono::duration<double>( computed - start ).count(),
+                         std::chrono::duration<double>( std::chrono::steady_clock::now() - computed ).count() );
+  }
+  finishAllTasks();
+}
+
+void ActionWithVector::completeReduction( const double& wait ) {
+  if( !reduction_pending ) return;
+  reduction_pending=false;
+  addLoadBalanceTimes( reduction_compute_time, wait );
+  finishAllTasks();
+}
+
+void ActionWithVector::finishAllTasks() {
   finishComputations( buffer );
+  // Update the costs of the tasks
+  if( task_schedule==costSchedule ) updateTaskCosts();
+}
+
+void ActionWithVector::runAndGatherTask( const unsigned& taskno, MultiValue& myvals, std::vector<double>& mybuffer ) {
+  std::chrono::time_point<std::chrono::steady_clock> start;
+  if( task_schedule==costSchedule ) start=std::chrono::steady_clock::now();
+  // Calculate the stuff in the loop for this action
+  runTask( taskno, myvals );
+
+  // Now transfer the data to the actions that accumulate values from the calculated quantities
+  gatherAccumulators( taskno, myvals, mybuffer );
+
+  // Clear the value
+  myvals.clearAll();
+  // Each task is done by only one thread so there are no race conditions here
+  if( task_schedule==costSchedule ) local_task_costs[taskno] += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+void ActionWithVector::getCostBalancedTaskRange( const std::vector<unsigned>& partialTaskList, const unsigned& rank, const unsigned& stride, unsigned& start, unsigned& end ) const {
+  unsigned nactive_tasks = partialTaskList.size();
+  // Tasks that have not been timed yet are assumed to have the average cost
+  double total=0, mean=0; unsigned nknown=0;
+  for(unsigned i=0; i<nactive_tasks; ++i) {
+    if( partialTaskList[i]<task_costs.size() && task_costs[partialTaskList[i]]>0 ) { mean += task_costs[partialTaskList[i]]; nknown++; }
+  }
+  // If there are no timings we just divide the tasks into equal blocks
+  if( nknown==0 ) {
+    getThreadRange( rank, stride, nactive_tasks, start, end );
+    return;
+  }
+  mean = mean / nknown;
+  std::vector<double> cumulative( nactive_tasks );
+  for(unsigned i=0; i<nactive_tasks; ++i) {
+    double cost = mean;
+    if( partialTaskList[i]<task_costs.size() && task_costs[partialTaskList[i]]>0 ) cost = task_costs[partialTaskList[i]];
+    total += cost; cumulative[i] = total;
+  }
+  // Every process does the tasks whose cumulative cost is in its share of the total
+  double lower = rank*total/stride, upper = (rank+1)*total/stride;
+  start = std::lower_bound( cumulative.begin(), cumulative.end(), lower ) - cumulative.begin();
+  if( rank==0 ) start = 0;
+  end = std::lower_bound( cumulative.begin(), cumulative.end(), upper ) - cumulative.begin();
+  if( rank+1==stride ) end = nactive_tasks;
+  if( end>nactive_tasks ) end=nactive_tasks;
+  if( start>end ) start=end;
+}
+
+void ActionWithVector::updateTaskCosts() {
+  ncalls_since_balance++;
+  if( ncalls_since_balance<task_balance_stride && task_costs.size()>0 ) return;
+  // Every process has to have the same costs so that they all get the same division of tasks
+  task_costs.assign( local_task_costs.begin(), local_task_costs.end() );
+  if( !serial ) comm.Sum( task_costs );
+  local_task_costs.assign( local_task_costs.size(), 0 ); ncalls_since_balance=0;
+}
+
+std::size_t ActionWithVector::ThreadWorkspace::getMemoryUsage() const {
+  std::size_t bytes=Tools::getMemoryUsage(buffer);
+  if(myvals) bytes+=myvals->getMemoryUsage();
+  return bytes;
+}
+
+void ActionWithVector::addMemoryUsage( MemoryUsage& usage ) const {
+  usage.buffers+=Tools::getMemoryUsage(buffer)+Tools::getMemoryUsage(task_costs)+Tools::getMemoryUsage(local_task_costs)+Tools::getMemoryUsage(active_tasks);
+  for(const auto & w : task_workspace) usage.buffers+=w.getMemoryUsage();
+  for(const auto & w : force_workspace) usage.buffers+=w.getMemoryUsage();
+}
+
+MultiValue& ActionWithVector::ThreadWorkspace::getMultiValue( const unsigned& nquants, const unsigned& nder, const unsigned& nmat, const unsigned& maxcol, const unsigned& nbooks ) {
+  std::array<unsigned,5> newshape{ {nquants, nder, nmat, maxcol, nbooks} };
+  if( !myvals || shape!=newshape ) {
+    myvals=Tools::make_unique<MultiValue>( nquants, nder, nmat, maxcol, nbooks ); shape=newshape;
+  } else myvals->clearMatrixBookeeping();
+  myvals->clearAll();
+  return *myvals;
 }
 
 void ActionWithVector::gatherThreads( const unsigned& nt, const unsigned& bufsize, const std::vector<double>& omp_buffer, std::vector<double>& buffer, MultiValue& myvals ) {
   if( nt>1 ) for(unsigned i=0; i<bufsize; ++i) buffer[i]+=omp_buffer[i];
 }
 
+void ActionWithVector::sumThreadBuffersInRange( const unsigned& ithread, const unsigned& nt, const std::vector<ThreadWorkspace>& workspace, std::vector<double>& buffer ) {
+  unsigned start, end; getThreadRange( ithread, nt, buffer.size(), start, end );
+  for(unsigned j=0; j<nt; ++j) {
+    const std::vector<double>& omp_buffer( workspace[j].buffer );
+    for(unsigned i=start; i<end; ++i) buffer[i]+=omp_buffer[i];
+  }
+}
+
+void ActionWithVector::gatherThreadsInRange( const unsigned& ithread, const unsigned& nt, std::vector<double>& buffer ) {
+  sumThreadBuffersInRange( ithread, nt, task_workspace, buffer );
+}
+
 void ActionWithVector::gatherProcesses( std::vector<double>& buffer ) {
   comm.Sum( buffer );
 }
@@ -624,6 +830,13 @@ void ActionWithVector::finishComputations( const std::vector<double>& buf ) {
     for(int i=0; i<getNumberOfComponents(); ++i) {
       // This gathers vectors and grids at the end of the calculation
       unsigned bufstart = getPntrToComponent(i)->bufstart;
+      // Scalars with derivatives only store the derivatives that are not zero, so clearing them and
+      // applying forces scales with the number of atoms they depend on rather than with the size of the chain
+      if( getPntrToComponent(i)->getRank()==0 && getPntrToComponent(i)->hasDeriv ) {
+        getPntrToComponent(i)->clearDerivatives( true ); getPntrToComponent(i)->set( buf[bufstart] );
+        if( !doNotCalculateDerivatives() ) getPntrToComponent(i)->setSparseDerivatives( buf.data()+bufstart+1 );
+        continue;
+      }
       getPntrToComponent(i)->data.assign( getPntrToComponent(i)->data.size(), 0 );
       if( (getPntrToComponent(i)->getRank()>0 && getPntrToComponent(i)->hasDerivatives()) || getPntrToComponent(i)->storedata ) {
         unsigned sz_v = getPntrToComponent(i)->data.size();
@@ -633,10 +846,6 @@ void ActionWithVector::finishComputations( const std::vector<double>& buf ) {
         }
         // Make sure single values are set
       } else if( getPntrToComponent(i)->getRank()==0 ) getPntrToComponent(i)->set( buf[bufstart] );
-      // This gathers derivatives of scalars
-      if( !doNotCalculateDerivatives() && getPntrToComponent(i)->hasDeriv && getPntrToComponent(i)->getRank()==0 ) {
-        for(unsigned j=0; j<getPntrToComponent(i)->getNumberOfDerivatives(); ++j) getPntrToComponent(i)->setDerivative( j, buf[bufstart+1+j] );
-      }
     }
   }
   if( action_to_do_after ) action_to_do_after->finishComputations( buf );
@@ -656,6 +865,7 @@ bool ActionWithVector::checkForForces() {
 
   // Check if there are any forces
   if( !checkChainForNonScalarForces() ) return false;
+  auto start=std::chrono::steady_clock::now();
 
   // Setup MPI parallel loop
   unsigned stride=comm.Get_size();
@@ -680,12 +890,15 @@ bool ActionWithVector::checkForForces() {
   // Clear force buffer
   forcesForApply.assign( forcesForApply.size(), 0.0 );
 
+  // Make sure there is a workspace for every thread
+  if( force_workspace.size()<nt ) force_workspace.resize( nt );
+
   #pragma omp parallel num_threads(nt)
   {
-    std::vector<double> omp_forces;
-    if( nt>1 ) omp_forces.resize( forcesForApply.size(), 0.0 );
-    MultiValue myvals( nquants, nderiv, nmatrices, maxcol, nbooks );
-    myvals.clearAll();
+    ThreadWorkspace& myws( force_workspace[OpenMP::getThreadNum()] );
+    std::vector<double>& omp_forces( myws.buffer );
+    if( nt>1 ) omp_forces.assign( forcesForApply.size(), 0.0 );
+    MultiValue& myvals( myws.getMultiValue( nquants, nderiv, nmatrices, maxcol, nbooks ) );
 
     #pragma omp for nowait
     for(unsigned i=rank; i<nf_tasks; i+=stride) {
@@ -697,11 +910,21 @@ bool ActionWithVector::checkForForces() {
 
       myvals.clearAll();
     }
-    #pragma omp critical
-    if(nt>1) for(unsigned i=0; i<forcesForApply.size(); ++i) forcesForApply[i]+=omp_forces[i];
+    if( nt>1 && reduce_threads_by_range ) {
+      #pragma omp barrier
+      sumThreadBuffersInRange( OpenMP::getThreadNum(), OpenMP::getTeamSize(), force_workspace, forcesForApply );
+    } else {
+      #pragma omp critical
+      if(nt>1) for(unsigned i=0; i<forcesForApply.size(); ++i) forcesForApply[i]+=omp_forces[i];
+    }
   }
   // MPI Gather on forces
-  if( !serial ) comm.Sum( forcesForApply );
+  if( !serial ) {
+    auto computed=std::chrono::steady_clock::now();
+    comm.Sum( forcesForApply );
+    addLoadBalanceTimes( std::chrono::duration<double>( computed - start ).count(),
+                         std::chrono::duration<double>( std::chrono::steady_clock::now() - computed ).count() );
+  }
   return true;
 }
 
@@ -756,6 +979,11 @@ void ActionWithVector::gatherForces( const unsigned& itask, const MultiValue& my
   if( action_to_do_after ) action_to_do_after->gatherForces( itask, myvals, forces );
 }
 
+bool ActionWithVector::canCalculateConcurrently() const {
+  // The active tasks are retrieved from the actions in the task control list while calculating this action
+  return task_control_list.size()==0 && ActionWithValue::canCalculateConcurrently();
+}
+
 void ActionWithVector::apply() {
   if( !checkForForces() ) return;
   // Find the top of the chain and add forces
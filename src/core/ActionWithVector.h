@@ -27,6 +27,8 @@
 #include "ActionWithArguments.h"
 #include "tools/MultiValue.h"
 #include <vector>
+#include <memory>
+#include <array>
 
 namespace PLMD {
 
@@ -37,10 +39,58 @@ class ActionWithVector:
 {
   friend class Value;
 private:
+/// This holds the memory that is used by a single OpenMP thread in the task loops.  It is kept
+/// between steps so that the MultiValue and the buffer are only reallocated when their sizes change
+  class ThreadWorkspace {
+  private:
+/// The sizes that were used to construct the MultiValue
+    std::array<unsigned,5> shape;
+/// The MultiValue that is used to run the tasks
+    std::unique_ptr<MultiValue> myvals;
+  public:
+/// The buffer that is used to accumulate data on this thread
+    std::vector<double> buffer;
+/// Get a MultiValue of the required size that has been cleared and is ready to use
+    MultiValue& getMultiValue( const unsigned& nquants, const unsigned& nder, const unsigned& nmat, const unsigned& maxcol, const unsigned& nbooks );
+/// Get the MultiValue that was used in the last loop over tasks
+    const MultiValue& getCurrentMultiValue() const { return *myvals; }
+/// Number of bytes allocated by this workspace
+    std::size_t getMemoryUsage() const ;
+  };
 /// Is the calculation to be done in serial
   bool serial;
+/// Do the threads each reduce one part of the buffers rather than adding their buffers one at a time
+  bool reduce_threads_by_range;
+/// Do the threads add their data directly to the shared buffer using atomic updates
+  bool reduce_threads_atomically;
+/// Is the buffer shared between the threads in the current loop over tasks
+  bool buffer_is_shared;
+/// The method that is used to distribute the tasks over the MPI processes and OpenMP threads
+  enum {staticSchedule,dynamicSchedule,guidedSchedule,costSchedule} task_schedule;
+/// How often the costs of the tasks are summed over the MPI processes when task_schedule==costSchedule
+  unsigned task_balance_stride, ncalls_since_balance;
+/// The time taken for each task during the last balancing period (summed over all processes) and on this process since the last balance
+  std::vector<double> task_costs, local_task_costs;
+/// Run a task and then gather the data that it calculated
+  void runAndGatherTask( const unsigned& taskno, MultiValue& myvals, std::vector<double>& mybuffer );
+/// Get the part of the list of active tasks that this process should do so that all processes are given the same cost
+  void getCostBalancedTaskRange( const std::vector<unsigned>& partialTaskList, const unsigned& rank, const unsigned& stride, unsigned& start, unsigned& end ) const ;
+/// Accumulate the time spent on the tasks and update the task costs if it is time to do so
+  void updateTaskCosts();
+/// Sum the part of the thread buffers that is owned by thread ithread into the final array
+  static void sumThreadBuffersInRange( const unsigned& ithread, const unsigned& nt, const std::vector<ThreadWorkspace>& workspace, std::vector<double>& buffer );
 /// The buffer that we use (we keep a copy here to avoid resizing)
   std::vector<double> buffer;
+/// Is the MPI reduction of the buffer left to the caller of runAllTasks, which then calls completeReduction
+  bool defer_reduction;
+/// Is there a buffer that has to be summed over the processes before the values can be set
+  bool reduction_pending;
+/// The time spent on the tasks before the reduction was deferred
+  double reduction_compute_time;
+/// Transfer the reduced buffer to the values and update the task costs
+  void finishAllTasks();
+/// The workspaces for the threads in runAllTasks and checkForForces
+  std::vector<ThreadWorkspace> task_workspace, force_workspace;
 /// The list of active tasks
   std::vector<unsigned> active_tasks;
   /// Action that must be done before this one
@@ -89,6 +139,15 @@ private:
   bool reduce_tasks;
 /// Were the atoms retrieved in some earlier action
   bool atomsWereRetrieved;
+/// The list of active tasks that was found the last time the status of the tasks was checked and the total number of tasks at that time
+  std::vector<unsigned> cached_active_tasks;
+  unsigned ncached_tasks;
+/// Which of the actions in the chain were active when the list of active tasks was cached
+  std::vector<bool> cached_chain_active;
+/// Get which of the actions in the chain are active
+  void getChainActiveState( std::vector<bool>& state ) const ;
+/// Check if the status of the tasks is unchanged for all the actions in the chain
+  bool taskStatusIsUnchanged() const ;
 /// This is used to build the argument store when we cannot use the chain
   unsigned reallyBuildArgumentStore( const unsigned& argstart );
 protected:
@@ -100,6 +159,8 @@ protected:
   void updateTaskListReductionStatus();
 /// Run all calculations in serial
   bool runInSerial() const ;
+/// Get the MultiValue that was used by thread ithread in the last call to runAllTasks
+  const MultiValue& getThreadMultiValue( const unsigned& ithread ) const ;
 /// Get the list of tasks that are active
   std::vector<unsigned>& getListOfActiveTasks( ActionWithVector* action );
 /// Check if the arguments of this action depend on thearg
@@ -110,7 +171,13 @@ protected:
   void runAllTasks();
 /// Accumulate the forces from the Values
   bool checkForForces();
+/// Add a value to an element of the buffer.  An atomic update is used if the buffer is shared between the threads
+  void addToBuffer( const unsigned& i, const double& v, std::vector<double>& buffer ) const ;
+/// Actions whose gatherStoredValue only updates the buffer through addToBuffer override this to allow THREAD_REDUCTION=ATOMIC
+  virtual bool canAccumulateAtomically() const { return false; }
 public:
+/// Get the part of an array of size n that thread ithread of nt is responsible for when reducing by range
+  static void getThreadRange( const unsigned& ithread, const unsigned& nt, const unsigned& n, unsigned& start, unsigned& end );
   static void registerKeywords( Keywords& keys );
   explicit ActionWithVector(const ActionOptions&);
   virtual ~ActionWithVector();
@@ -121,6 +188,8 @@ public:
   void calculateNumericalDerivatives(ActionWithValue* av) override;
 /// Are we running this command in a chain
   bool actionInChain() const ;
+/// Are there other actions that are run after this one in the chain
+  bool chainContinues() const ;
 /// This is overwritten within ActionWithMatrix and is used to build the chain of just matrix actions
   virtual void finishChainBuild( ActionWithVector* act );
 /// Check if there are any stored values in arguments
@@ -138,6 +207,8 @@ public:
   void clearInputForces( const bool& force=false ) override;
 /// We override clearDerivatives here to prevent data in streams from being deleted
   void clearDerivatives( const bool& force=false ) override;
+/// Add the memory used by the buffers and by the workspaces of the threads
+  void addMemoryUsage( MemoryUsage& usage ) const override;
 /// Check if we can be after another ActionWithVector
   virtual bool canBeAfterInChain( ActionWithVector* av ) { return true; }
 /// Do we always need to do all the tasks for this action
@@ -146,6 +217,9 @@ public:
   virtual void getNumberOfTasks( unsigned& ntasks );
 /// Check the status of the ith task
   virtual int checkTaskStatus( const unsigned& taskno, int& flag ) const { return flag; }
+/// This should return true if the values returned by checkTaskStatus cannot have changed since the last step.
+/// Actions that override checkTaskStatus and can switch tasks off based on positions or arguments must override this and return false
+  virtual bool checkTaskStatusIsUnchanged() const { return true; }
 /// Check if we are in a subchain
   virtual bool isInSubChain( unsigned& nder ) { return false; }
 /// Get the additional tasks that are required here
@@ -158,6 +232,8 @@ public:
   virtual void updateAdditionalIndices( const unsigned& ostrn, MultiValue& myvals ) const {}
 /// Gather the data from all the OpenMP threads
   virtual void gatherThreads( const unsigned& nt, const unsigned& bufsize, const std::vector<double>& omp_buffer, std::vector<double>& buffer, MultiValue& myvals );
+/// Gather the part of the data from all the OpenMP threads that thread ithread is responsible for when reducing by range
+  virtual void gatherThreadsInRange( const unsigned& ithread, const unsigned& nt, std::vector<double>& buffer );
 /// Can be used to reduce the number of tasks that are performed when you use an ation from elsewhere
   virtual void switchTaskReduction( const bool& task_reduction, ActionWithVector* aselect ) {}
 /// Gather all the data from the MPI processes
@@ -174,18 +250,61 @@ public:
   void finishComputations( const std::vector<double>& buf );
 /// Apply the forces on this data
   virtual void apply();
+/// Actions that control the tasks in other actions cannot be calculated concurrently
+  bool canCalculateConcurrently() const override ;
+/// Forces are applied through the whole chain so they cannot be applied concurrently
+  bool canApplyConcurrently() const override { return false; }
+/// Actions whose calculate() returns right after runAllTasks and that do not override gatherProcesses
+/// override this so that the MPI reduction of their buffer can overlap with the calculation of other actions
+  virtual bool canDeferReduction() const { return false; }
+/// Do not sum the buffer over the MPI processes at the end of runAllTasks.  The caller must sum the buffer
+/// returned by getPendingReduction (possibly together with the buffers of other actions) and then call completeReduction
+  void setDeferReduction( const bool& defer ) { defer_reduction=defer; }
+/// Is there a reduction that must be completed with completeReduction before the values can be used
+  bool reductionIsPending() const { return reduction_pending; }
+/// The buffer that must be summed over the processes before completeReduction is called
+  std::vector<double>& getPendingReduction() { return buffer; }
+/// Set the values from the buffer once it has been summed.  wait is the time spent in the reduction
+  void completeReduction( const double& wait );
 };
 
+inline
+void ActionWithVector::addToBuffer( const unsigned& i, const double& v, std::vector<double>& buffer ) const {
+  plumed_dbg_assert( i<buffer.size() );
+  if( buffer_is_shared ) {
+    #pragma omp atomic
+    buffer[i] += v;
+  } else buffer[i] += v;
+}
+
 inline
 bool ActionWithVector::actionInChain() const {
   return (action_to_do_before!=NULL);
 }
 
+inline
+bool ActionWithVector::chainContinues() const {
+  return (action_to_do_after!=NULL);
+}
+
 inline
 bool ActionWithVector::runInSerial() const {
   return serial;
 }
 
+inline
+const MultiValue& ActionWithVector::getThreadMultiValue( const unsigned& ithread ) const {
+  plumed_dbg_assert( ithread<task_workspace.size() );
+  return task_workspace[ithread].getCurrentMultiValue();
+}
+
+inline
+void ActionWithVector::getThreadRange( const unsigned& ithread, const unsigned& nt, const unsigned& n, unsigned& start, unsigned& end ) {
+  unsigned chunk = (n + nt - 1) / nt; start = ithread*chunk;
+  if( start>n ) start=n;
+  end = start + chunk; if( end>n ) end=n;
+}
+
 }
 
 #endif
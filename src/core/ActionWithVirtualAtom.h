@@ -52,6 +52,10 @@ protected:
   void requestAtoms(const std::vector<AtomNumber> & a);
 /// Set the derivatives of virtual atom coordinate wrt atoms on which it dependes
   void setAtomsDerivatives(const std::vector<Tensor> &d);
+/// Set the derivatives of a virtual atom that is a linear combination of the atoms
+/// on which it depends, so that the derivative wrt atom j is w[j] times the identity.
+/// Only the diagonal elements are written, the derivatives should have been cleared.
+  void setAtomsDerivatives(const std::vector<double> &w);
 /// Set the box derivatives.
 /// This should be a vector of size 3. First index corresponds
 /// to the components of the virtual atom.
@@ -115,6 +119,18 @@ void ActionWithVirtualAtom::setAtomsDerivatives(const std::vector<Tensor> &d) {
   }
 }
 
+inline
+void ActionWithVirtualAtom::setAtomsDerivatives(const std::vector<double> &w) {
+  Value* xval=getPntrToComponent(0);
+  Value* yval=getPntrToComponent(1);
+  Value* zval=getPntrToComponent(2);
+  for(unsigned j=0; j<getNumberOfAtoms(); ++j) {
+    xval->setDerivative( 3*j, w[j] );
+    yval->setDerivative( 3*j+1, w[j] );
+    zval->setDerivative( 3*j+2, w[j] );
+  }
+}
+
 }
 
 #endif
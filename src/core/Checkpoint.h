@@ -0,0 +1,92 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_core_Checkpoint_h
+#define __PLUMED_core_Checkpoint_h
+
+#include "tools/Exception.h"
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace PLMD {
+
+/**
+Helpers for the binary checkpoints written by PlumedMain::writeCheckpoint.
+
+Each action that overrides Action::writeCheckpoint writes its own state in a separate
+block of the checkpoint using these functions, and reads it back in the same order in
+Action::readCheckpoint. Numbers are stored with the byte order of the machine, so that
+checkpoints can only be read on machines of the same type, as it is for the checkpoints
+written by the MD codes.
+*/
+namespace checkpoint {
+
+template<typename T>
+void write(std::ostream&o,const T&t) {
+  static_assert(std::is_trivially_copyable<T>::value,"only trivially copyable types can be written directly");
+  o.write(reinterpret_cast<const char*>(&t),sizeof(T));
+}
+
+template<typename T>
+void write(std::ostream&o,const std::vector<T>&v) {
+  static_assert(std::is_trivially_copyable<T>::value,"only vectors of trivially copyable types can be written directly");
+  write<std::size_t>(o,v.size());
+  if(v.size()>0) o.write(reinterpret_cast<const char*>(v.data()),v.size()*sizeof(T));
+}
+
+inline void write(std::ostream&o,const std::string&s) {
+  write<std::size_t>(o,s.length());
+  o.write(s.data(),s.length());
+}
+
+template<typename T>
+void read(std::istream&i,T&t) {
+  static_assert(std::is_trivially_copyable<T>::value,"only trivially copyable types can be read directly");
+  i.read(reinterpret_cast<char*>(&t),sizeof(T));
+  plumed_massert(i,"checkpoint is truncated");
+}
+
+template<typename T>
+void read(std::istream&i,std::vector<T>&v) {
+  static_assert(std::is_trivially_copyable<T>::value,"only vectors of trivially copyable types can be read directly");
+  std::size_t n;
+  read(i,n);
+  v.resize(n);
+  if(n>0) i.read(reinterpret_cast<char*>(v.data()),n*sizeof(T));
+  plumed_massert(i,"checkpoint is truncated");
+}
+
+inline void read(std::istream&i,std::string&s) {
+  std::size_t n;
+  read(i,n);
+  s.resize(n);
+  if(n>0) i.read(&s[0],n);
+  plumed_massert(i,"checkpoint is truncated");
+}
+
+}
+
+}
+
+#endif
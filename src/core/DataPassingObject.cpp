@@ -39,6 +39,8 @@ private:
   TypesafePtr v;
 /// A pointer to the force
   TypesafePtr f;
+/// Check if this object and the two others read consecutive elements of the same array with stride three
+  bool isInterleavedWith( const DataPassingObjectTyped<T>* y, const DataPassingObjectTyped<T>* z, const TypesafePtr DataPassingObjectTyped<T>::* p ) const ;
 public:
 /// This convers a number from the MD code into a double
   double MD2double(const TypesafePtr &) const override ;
@@ -55,14 +57,18 @@ public:
   void share_data( const unsigned& j, const unsigned& k, Value* value ) override;
 /// Share the data and put it in the value from a scattered data
   void share_data( const std::vector<AtomNumber>&index, const std::vector<unsigned>& i, Value* value ) override;
+/// Share the data of three values that are stored in one interleaved array
+  bool share_data_interleaved( DataPassingObject& y, DataPassingObject& z, const unsigned& j, const unsigned& k, Value* vx, Value* vy, Value* vz ) override;
 /// Pass the force from the value to the output value
   void add_force( Value* vv ) override;
   void add_force( const std::vector<int>& index, Value* value ) override;
   void add_force( const std::vector<AtomNumber>& index, const std::vector<unsigned>& i, Value* value ) override;
+  bool add_force_interleaved( DataPassingObject& y, DataPassingObject& z, Value* vx, Value* vy, Value* vz ) override;
 /// Rescale the force on the output value
   void rescale_force( const unsigned& n, const double& factor, Value* value ) override;
 /// This transfers everything to the output
   void setData( Value* value ) override;
+  void setData( const std::vector<double>& values ) override;
 };
 
 std::unique_ptr<DataPassingObject> DataPassingObject::create(unsigned n) {
@@ -110,9 +116,23 @@ template <class T>
 void DataPassingObjectTyped<T>::setData( Value* value ) {
   if( value->getRank()==0 ) { *v.template get<T*>() = static_cast<T>(value->get()) / unit; return; }
   T* pp; getPointer( v, value->getShape(), start, stride, pp ); unsigned nvals=value->getNumberOfValues();
+  if( value->getRank()==1 && !value->hasDerivatives() ) {
+    // vectors without derivatives are stored contiguously so they can be copied directly
+    const std::vector<double> & d=value->data;
+    #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(d))
+    for(unsigned i=0; i<nvals; ++i) pp[i] = T( d[i] );
+    return;
+  }
   for(unsigned i=0; i<nvals; ++i) pp[i] = T( value->get(i) );
 }
 
+template <class T>
+void DataPassingObjectTyped<T>::setData( const std::vector<double>& values ) {
+  std::vector<unsigned> shape(1,values.size()); T* pp; getPointer( v, shape, start, stride, pp );
+  #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(values))
+  for(unsigned i=0; i<values.size(); ++i) pp[i] = T( values[i] );
+}
+
 template <class T>
 void DataPassingObjectTyped<T>::share_data( const unsigned& j, const unsigned& k, Value* value ) {
   if( value->getRank()==0 ) {
@@ -148,14 +168,53 @@ void DataPassingObjectTyped<T>::share_data( const std::vector<AtomNumber>&index,
   unsigned k=0; for(const auto & p : index) { value->data[p.index()]=unit*pp[i[k]*stride]; k++; }
 }
 
+template <class T>
+bool DataPassingObjectTyped<T>::isInterleavedWith( const DataPassingObjectTyped<T>* y, const DataPassingObjectTyped<T>* z, const TypesafePtr DataPassingObjectTyped<T>::* p ) const {
+  if( !y || !z || stride!=3 || y->stride!=3 || z->stride!=3 ) return false;
+  if( y->start!=start+1 || z->start!=start+2 ) return false;
+  return (this->*p).getRaw() && (this->*p).getRaw()==(y->*p).getRaw() && (this->*p).getRaw()==(z->*p).getRaw();
+}
+
+template <class T>
+bool DataPassingObjectTyped<T>::share_data_interleaved( DataPassingObject& y, DataPassingObject& z, const unsigned& j, const unsigned& k, Value* vx, Value* vy, Value* vz ) {
+  const auto yy=dynamic_cast<DataPassingObjectTyped<T>*>(&y); const auto zz=dynamic_cast<DataPassingObjectTyped<T>*>(&z);
+  if( vx->getRank()!=1 || vy->getRank()!=1 || vz->getRank()!=1 || !isInterleavedWith( yy, zz, &DataPassingObjectTyped<T>::v ) ) return false;
+  std::vector<unsigned> s(1,k-j); const T* pp; getPointer( v, s, start, stride, pp );
+  double* dx=vx->data.data(); double* dy=vy->data.data(); double* dz=vz->data.data();
+  const double ux=unit, uy=yy->unit, uz=zz->unit;
+// the three components of each atom are converted together so the input array is only read once
+  #pragma omp parallel for simd num_threads(vx->getGoodNumThreads(j,k))
+  for(unsigned i=j; i<k; ++i) { dx[i]=ux*pp[3*i]; dy[i]=uy*pp[3*i+1]; dz[i]=uz*pp[3*i+2]; }
+  return true;
+}
+
 template <class T>
 void DataPassingObjectTyped<T>::add_force( Value* value ) {
   if( value->getRank()==0 ) { *f.template get<T*>() += funit*static_cast<T>(value->getForce(0)); return; }
   T* pp; getPointer( f, value->getShape(), start, stride, pp ); unsigned nvals=value->getNumberOfValues();
+  if( stride==1 ) {
+// contiguous arrays can be vectorized
+    const double* ff=value->inputForce.data(); const T u=funit;
+    #pragma omp parallel for simd num_threads(OpenMP::getGoodNumThreads(pp,nvals))
+    for(unsigned i=0; i<nvals; ++i) pp[i] += u*T(ff[i]);
+    return;
+  }
   #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(pp,nvals))
   for(unsigned i=0; i<nvals; ++i) pp[i*stride] += funit*T(value->getForce(i));
 }
 
+template <class T>
+bool DataPassingObjectTyped<T>::add_force_interleaved( DataPassingObject& y, DataPassingObject& z, Value* vx, Value* vy, Value* vz ) {
+  const auto yy=dynamic_cast<DataPassingObjectTyped<T>*>(&y); const auto zz=dynamic_cast<DataPassingObjectTyped<T>*>(&z);
+  if( vx->getRank()!=1 || vy->getRank()!=1 || vz->getRank()!=1 || !isInterleavedWith( yy, zz, &DataPassingObjectTyped<T>::f ) ) return false;
+  T* pp; getPointer( f, vx->getShape(), start, stride, pp ); unsigned nvals=vx->getNumberOfValues();
+  const double* fx=vx->inputForce.data(); const double* fy=vy->inputForce.data(); const double* fz=vz->inputForce.data();
+  const T ux=funit, uy=yy->funit, uz=zz->funit;
+  #pragma omp parallel for simd num_threads(OpenMP::getGoodNumThreads(pp,nvals))
+  for(unsigned i=0; i<nvals; ++i) { pp[3*i] += ux*T(fx[i]); pp[3*i+1] += uy*T(fy[i]); pp[3*i+2] += uz*T(fz[i]); }
+  return true;
+}
+
 template <class T>
 void DataPassingObjectTyped<T>::add_force( const std::vector<int>& index, Value* value ) {
   plumed_assert( value->getRank()==1 ); std::vector<unsigned> s(1,index.size()); T* pp; getPointer( f, s, start, stride, pp );
@@ -173,7 +232,9 @@ void DataPassingObjectTyped<T>::add_force( const std::vector<AtomNumber>& index,
   maxel[0]=0;
 #endif
   T* pp; getPointer( f, maxel, start, stride, pp );
-  unsigned k=0; for(const auto & p : index) { pp[stride*i[k]] += funit*T(value->getForce(p.index())); k++; }
+// local indexes of unique atoms are all different, so threads never write the same element
+  #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(pp,index.size()))
+  for(unsigned k=0; k<index.size(); ++k) pp[stride*i[k]] += funit*T(value->getForce(index[k].index()));
 }
 
 template <class T>
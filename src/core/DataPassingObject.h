@@ -72,14 +72,21 @@ public:
   virtual void share_data( const unsigned& j, const unsigned& k, Value* value )=0;
 /// Share the data and put it in the value from a scattered data
   virtual void share_data( const std::vector<AtomNumber>&index, const std::vector<unsigned>& i, Value* value )=0;
+/// Share the data for this object and two others that read the following elements of the same interleaved array (e.g. x, y and z of the positions)
+/// This returns false if the three objects do not read one interleaved array so share_data must be called for each of them
+  virtual bool share_data_interleaved( DataPassingObject& y, DataPassingObject& z, const unsigned& j, const unsigned& k, Value* vx, Value* vy, Value* vz )=0;
 /// Pass the force from the value to the output value
   virtual void add_force( Value* vv )=0;
   virtual void add_force( const std::vector<int>& index, Value* value )=0;
   virtual void add_force( const std::vector<AtomNumber>& index, const std::vector<unsigned>& i, Value* value )=0;
+/// Pass the forces on three values to an interleaved array in one pass.  This returns false if the forces are not interleaved
+  virtual bool add_force_interleaved( DataPassingObject& y, DataPassingObject& z, Value* vx, Value* vy, Value* vz )=0;
 /// Rescale the forces that were passed
   virtual void rescale_force( const unsigned& n, const double& factor, Value* value )=0;
 /// This transfers everything to the output
   virtual void setData( Value* value )=0;
+/// This transfers a flat array of values to the output
+  virtual void setData( const std::vector<double>& values )=0;
 };
 
 }
@@ -28,6 +28,8 @@
 
 #include "small_vector/small_vector.h"
 #include "tools/MergeVectorTools.h"
+#include <algorithm>
+#include <chrono>
 
 //+PLUMEDOC ANALYSIS DOMAIN_DECOMPOSITION
 /*
@@ -81,6 +83,13 @@ void DomainDecomposition::DomainComms::enable(Communicator& c) {
     else if(s=="no") async=false;
     else plumed_merror("PLUMED_ASYNC_SHARE variable is set to " + s + "; should be yes or no");
   }
+  if(std::getenv("PLUMED_DD_SINGLE_PRECISION")) {
+    std::string s(std::getenv("PLUMED_DD_SINGLE_PRECISION"));
+    if(s=="yes") singlePrecision=true;
+    else if(s=="no") singlePrecision=false;
+    else plumed_merror("PLUMED_DD_SINGLE_PRECISION variable is set to " + s + "; should be yes or no");
+  }
+  indexValid=false;
 }
 
 void DomainDecomposition::registerKeywords(Keywords& keys) {
@@ -123,6 +132,7 @@ DomainDecomposition::DomainDecomposition(const ActionOptions&ao):
     else plumed_merror("missing information on whether value is constant");
     // And save the list of values that are set from here
     ActionToPutData* ap=plumed.getActionSet().selectWithLabel<ActionToPutData*>(valname); ap->addDependency( this ); inputs.push_back( ap );
+    inputIsPosition.push_back( role=="x" || role=="y" || role=="z" );
   }
   std::string pbclabel; parse("PBCLABEL",pbclabel); plumed.readInputLine(pbclabel + ": PBC",true);
   // Turn on the domain decomposition
@@ -188,6 +198,7 @@ void DomainDecomposition::setAtomsNlocal(int n) {
     dd.positionsToBeReceived.resize(natoms*nvals,0.0);
     dd.indexToBeSent.resize(n,0);
     dd.indexToBeReceived.resize(natoms,0);
+    dd.indexValid=false;
   }
 }
 
@@ -322,15 +333,26 @@ void DomainDecomposition::share(const std::vector<AtomNumber>& unique) {
     }
   } else {
 // faster version, which retrieves all atoms
-    for(const auto & ip : inputs) {
-      if( (!ip->fixed || firststep) && ip->wasset ) { (ip->mydata)->share_data( 0, getNumberOfAtoms(), ip->copyOutput(0) ); values_to_get.push_back(ip->copyOutput(0)); ndata++; }
+    for(unsigned i=0; i<inputs.size(); ++i) {
+      ActionToPutData* ip=inputs[i];
+      if( !(!ip->fixed || firststep) || !ip->wasset ) continue;
+      // interleaved arrays (e.g. positions passed as x,y,z triplets) are converted in one pass
+      if( i+2<inputs.size() && inputs[i+1]->wasset && inputs[i+2]->wasset && ip->fixed==inputs[i+1]->fixed && ip->fixed==inputs[i+2]->fixed &&
+          (ip->mydata)->share_data_interleaved( *(inputs[i+1]->mydata), *(inputs[i+2]->mydata), 0, getNumberOfAtoms(), ip->copyOutput(0), inputs[i+1]->copyOutput(0), inputs[i+2]->copyOutput(0) ) ) {
+        for(unsigned k=0; k<3; ++k) values_to_get.push_back(inputs[i+k]->copyOutput(0));
+        ndata+=3; i+=2; continue;
+      }
+      (ip->mydata)->share_data( 0, getNumberOfAtoms(), ip->copyOutput(0) ); values_to_get.push_back(ip->copyOutput(0)); ndata++;
     }
   }
 
   if(dd && shuffledAtoms>0) {
+    auto start=std::chrono::steady_clock::now();
+    double waiting=0.0;
     if(dd.async) {
       for(unsigned i=0; i<dd.mpi_request_positions.size(); i++) dd.mpi_request_positions[i].wait();
       for(unsigned i=0; i<dd.mpi_request_index.size(); i++)     dd.mpi_request_index[i].wait();
+      waiting+=std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
     }
 
     int count=0;
@@ -357,14 +379,63 @@ void DomainDecomposition::share(const std::vector<AtomNumber>& unique) {
       std::vector<int> displ(n);
       std::vector<int> counts5(n);
       std::vector<int> displ5(n);
-      dd.Allgather(count,counts);
+// The index lists only change when atoms migrate or the set of requested atoms changes,
+// so each domain reports whether its list changed together with its count
+      const bool changed=!dd.indexValid || count!=int(dd.lastIndexSent.size()) ||
+                         !std::equal(dd.lastIndexSent.begin(),dd.lastIndexSent.end(),dd.indexToBeSent.begin());
+      std::vector<int> local(2),gathered(2*n);
+      local[0]=count; local[1]=changed;
+      auto gathering=std::chrono::steady_clock::now();
+      dd.Allgather(local,gathered);
+      bool anyChanged=false;
+      for(int i=0; i<n; ++i) { counts[i]=gathered[2*i]; if(gathered[2*i+1]) anyChanged=true; }
       displ[0]=0;
       for(int i=1; i<n; ++i) displ[i]=displ[i-1]+counts[i-1];
       for(int i=0; i<n; ++i) counts5[i]=counts[i]*ndata;
       for(int i=0; i<n; ++i) displ5[i]=displ[i]*ndata;
-      dd.Allgatherv(&dd.indexToBeSent[0],count,&dd.indexToBeReceived[0],&counts[0],&displ[0]);
-      dd.Allgatherv(&dd.positionsToBeSent[0],ndata*count,&dd.positionsToBeReceived[0],&counts5[0],&displ5[0]);
+      if(anyChanged) {
+        dd.Allgatherv(&dd.indexToBeSent[0],count,&dd.indexToBeReceived[0],&counts[0],&displ[0]);
+        dd.lastIndexSent.assign(dd.indexToBeSent.begin(),dd.indexToBeSent.begin()+count);
+        dd.indexValid=true;
+      }
       int tot=displ[n-1]+counts[n-1];
+// only positions are sent in single precision, masses and charges are always transferred in double precision
+      if(dd.singlePrecision) {
+        std::vector<bool> inFloat(ndata,false); int nfloat=0;
+        for(int j=0; j<ndata; ++j) {
+          for(unsigned k=0; k<inputs.size(); ++k) if( inputs[k]->copyOutput(0)==values_to_get[j] ) inFloat[j]=inputIsPosition[k];
+          if(inFloat[j]) nfloat++;
+        }
+        const int nother=ndata-nfloat;
+        std::vector<int> countsf(n), displf(n), countso(n), displo(n);
+        for(int i=0; i<n; ++i) {
+          countsf[i]=counts[i]*nfloat; displf[i]=displ[i]*nfloat;
+          countso[i]=counts[i]*nother; displo[i]=displ[i]*nother;
+        }
+        dd.positionsToBeSentFloat.resize(std::max(1,nfloat*count));
+        dd.positionsToBeReceivedFloat.resize(std::max(1,nfloat*tot));
+        dd.othersToBeSent.resize(std::max(1,nother*count));
+        dd.othersToBeReceived.resize(std::max(1,nother*tot));
+        for(int i=0; i<count; i++) {
+          int kf=0, ko=0;
+          for(int j=0; j<ndata; j++) {
+            if(inFloat[j]) dd.positionsToBeSentFloat[nfloat*i+kf++]=dd.positionsToBeSent[ndata*i+j];
+            else dd.othersToBeSent[nother*i+ko++]=dd.positionsToBeSent[ndata*i+j];
+          }
+        }
+        if(nfloat>0) dd.Allgatherv(&dd.positionsToBeSentFloat[0],nfloat*count,&dd.positionsToBeReceivedFloat[0],&countsf[0],&displf[0]);
+        if(nother>0) dd.Allgatherv(&dd.othersToBeSent[0],nother*count,&dd.othersToBeReceived[0],&countso[0],&displo[0]);
+        for(int i=0; i<tot; i++) {
+          int kf=0, ko=0;
+          for(int j=0; j<ndata; j++) {
+            if(inFloat[j]) dd.positionsToBeReceived[ndata*i+j]=dd.positionsToBeReceivedFloat[nfloat*i+kf++];
+            else dd.positionsToBeReceived[ndata*i+j]=dd.othersToBeReceived[nother*i+ko++];
+          }
+        }
+      } else {
+        dd.Allgatherv(&dd.positionsToBeSent[0],ndata*count,&dd.positionsToBeReceived[0],&counts5[0],&displ5[0]);
+      }
+      waiting+=std::chrono::duration<double>( std::chrono::steady_clock::now() - gathering ).count();
       for(int i=0; i<tot; i++) {
         int dpoint=0;
         for(unsigned j=0; j<values_to_get.size(); ++j) {
@@ -372,6 +443,8 @@ void DomainDecomposition::share(const std::vector<AtomNumber>& unique) {
         }
       }
     }
+    double elapsed=std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    addLoadBalanceTimes( elapsed-waiting, waiting );
   }
 }
 
@@ -388,12 +461,14 @@ void DomainDecomposition::wait() {
     if(asyncSent) {
       Communicator::Status status;
       std::size_t count=0;
+      auto start=std::chrono::steady_clock::now();
       for(int i=0; i<dd.Get_size(); i++) {
         dd.Recv(&dd.indexToBeReceived[count],dd.indexToBeReceived.size()-count,i,666,status);
         int c=status.Get_count<int>();
         dd.Recv(&dd.positionsToBeReceived[ndata*count],dd.positionsToBeReceived.size()-ndata*count,i,667);
         count+=c;
       }
+      addLoadBalanceTimes( 0.0, std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() );
       for(int i=0; i<count; i++) {
         int dpoint=0;
         for(unsigned j=0; j<values_to_set.size(); ++j) {
@@ -411,8 +486,21 @@ unsigned DomainDecomposition::getNumberOfForcesToRescale() const {
 }
 
 void DomainDecomposition::apply() {
+// when all the atoms are passed in order the forces are added directly to the MD arrays
+  const bool contiguous=(int(gatindex.size())==getNumberOfAtoms() && shuffledAtoms==0);
+  if( contiguous && !unique_serial ) {
+    for(unsigned i=0; i<inputs.size(); ++i) {
+      ActionToPutData* ip=inputs[i];
+      if( !(ip->getPntrToValue())->forcesWereAdded() || ip->noforce ) continue;
+      if( i+2<inputs.size() && (inputs[i+1]->getPntrToValue())->forcesWereAdded() && !inputs[i+1]->noforce &&
+          (inputs[i+2]->getPntrToValue())->forcesWereAdded() && !inputs[i+2]->noforce &&
+          (ip->mydata)->add_force_interleaved( *(inputs[i+1]->mydata), *(inputs[i+2]->mydata), ip->getPntrToValue(), inputs[i+1]->getPntrToValue(), inputs[i+2]->getPntrToValue() ) ) { i+=2; continue; }
+      (ip->mydata)->add_force( ip->getPntrToValue() );
+    }
+    return;
+  }
   std::vector<unsigned> forced_uniq_index(forced_unique.size());
-  if(!(int(gatindex.size())==getNumberOfAtoms() && shuffledAtoms==0)) {
+  if(!contiguous) {
     for(unsigned i=0; i<forced_unique.size(); i++) forced_uniq_index[i]=g2l[forced_unique[i].index()];
   } else {
     for(unsigned i=0; i<forced_unique.size(); i++) forced_uniq_index[i]=forced_unique[i].index();
@@ -44,8 +44,18 @@ private:
     std::vector<double> positionsToBeReceived;
     std::vector<int>    indexToBeSent;
     std::vector<int>    indexToBeReceived;
+/// Positions are sent in single precision (PLUMED_DD_SINGLE_PRECISION=yes)
+    bool singlePrecision;
+    std::vector<float>  positionsToBeSentFloat;
+    std::vector<float>  positionsToBeReceivedFloat;
+/// Masses, charges and any other value are still sent in double precision
+    std::vector<double> othersToBeSent;
+    std::vector<double> othersToBeReceived;
+/// Index list sent at the previous step, used to skip the index exchange when no domain changed it
+    std::vector<int>    lastIndexSent;
+    bool indexValid;
     operator bool() const {return on;}
-    DomainComms(): on(false), async(false) {}
+    DomainComms(): on(false), async(false), singlePrecision(false), indexValid(false) {}
     void enable(Communicator& c);
   };
   DomainComms dd;
@@ -70,6 +80,8 @@ private:
   std::vector<AtomNumber> forced_unique;
 /// This holds the list of actions that are set from this action
   std::vector<ActionToPutData*> inputs;
+/// This tells which of the inputs are positions (ROLE x, y or z)
+  std::vector<bool> inputIsPosition;
 /// This holds all the actions that read atoms
   std::vector<ActionAtomistic*> actions;
 /// The list that holds all the atom indexes we need
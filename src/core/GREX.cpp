@@ -21,12 +21,27 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "GREX.h"
 #include "PlumedMain.h"
+#include "ActionSet.h"
+#include "ActionWithValue.h"
+#include "ActionWithArguments.h"
 #include "tools/Tools.h"
 #include "tools/Communicator.h"
+#include "tools/Log.h"
+#include <cstdlib>
+#include <functional>
 #include <sstream>
 
 namespace PLMD {
 
+class GREX::DeltaBiasExchange {
+public:
+  Communicator::Request request;
+  bool pending=false;
+/// The value that is sent, which must not change until the request has been completed
+  double sent=0.0;
+  std::vector<int> counts, displs;
+};
+
 GREX::GREX(PlumedMain&p):
   initialized(false),
   plumedMain(p),
@@ -35,7 +50,9 @@ GREX::GREX(PlumedMain&p):
   foreignDeltaBias(0),
   localUNow(0),
   localUSwap(0),
-  myreplica(-1) // = unset
+  myreplica(-1), // = unset
+  cvExchange(-1), // = unset
+  cvExchangeNow(false)
 {
   p.setSuffix(".NA");
 }
@@ -152,14 +169,26 @@ void GREX::cmd(std::string_view key,const TypesafePtr & val) {
     case cmd_shareAllDeltaBias:
       CHECK_INIT(initialized,key);
       if(intracomm.Get_rank()!=0) return;
-      allDeltaBias.assign(intercomm.Get_size(),0.0);
-      allDeltaBias[intercomm.Get_rank()]=localDeltaBias;
-      intercomm.Sum(allDeltaBias);
+      waitAllDeltaBias();
+// each replica contributes one value: they are gathered in the background and
+// only waited for when the first of them is retrieved with getDeltaBias
+      {
+        const int n=intercomm.Get_size();
+        DeltaBiasExchange& ex(deltaBiasExchange);
+        allDeltaBias.assign(n,0.0);
+        ex.counts.assign(n,1);
+        ex.displs.resize(n);
+        for(int i=0; i<n; i++) ex.displs[i]=i;
+        ex.sent=localDeltaBias;
+        ex.request=intercomm.Iallgatherv(&ex.sent,1,allDeltaBias.data(),ex.counts.data(),ex.displs.data());
+        ex.pending=true;
+      }
       break;
     case cmd_getDeltaBias:
       CHECK_INIT(initialized,key);
       CHECK_NOTNULL(val,key);
       plumed_assert(nw==2);
+      waitAllDeltaBias();
       plumed_massert(allDeltaBias.size()==static_cast<unsigned>(intercomm.Get_size()),
                      "to retrieve bias with cmd(\"GREX getDeltaBias\"), first share it with cmd(\"GREX shareAllDeltaBias\")");
       {
@@ -176,7 +205,55 @@ void GREX::cmd(std::string_view key,const TypesafePtr & val) {
   }
 }
 
+void GREX::waitAllDeltaBias() {
+  if(!deltaBiasExchange.pending) return;
+  deltaBiasExchange.request.wait();
+  deltaBiasExchange.pending=false;
+}
+
+void GREX::setupCVExchange() {
+  if(cvExchange>=0) return;
+// every action that contributes to the bias must be able to compute it from its arguments
+  int ok=(std::getenv("PLUMED_GREX_CV_EXCHANGE")!=NULL);
+  for(const auto & p : plumedMain.getActionSet()) {
+    ActionWithValue* av=p->castToActionWithValue();
+    if(!av || !av->exists(av->getLabel()+".bias")) continue;
+    if(!av->canComputeBiasFromArguments() || !p->castToActionWithArguments()) ok=0;
+  }
+// the same choice must be made on all the replicas
+  if(intracomm.Get_rank()==0) intercomm.Min(ok);
+  intracomm.Bcast(ok,0);
+  cvExchange=ok;
+  if(cvExchange) plumedMain.getLog()<<"GREX: only the arguments of the biases are exchanged between replicas (PLUMED_GREX_CV_EXCHANGE)\n";
+}
+
 void GREX::savePositions() {
+  setupCVExchange();
+  if(cvExchange) {
+// the arguments of the biases have been calculated at this step
+    cvBiases.resize(0); cvBiasArguments.resize(0); cvBuffer.resize(0);
+    std::string signature;
+    for(const auto & p : plumedMain.getActionSet()) {
+      ActionWithValue* av=p->castToActionWithValue();
+      if(!av || !p->isActive() || !av->exists(av->getLabel()+".bias")) continue;
+      ActionWithArguments* aa=p->castToActionWithArguments();
+      cvBiases.push_back(av); cvBiasArguments.push_back(aa);
+      signature+=av->getLabel()+":";
+      for(unsigned i=0; i<aa->getNumberOfArguments(); ++i) {
+        cvBuffer.push_back(aa->getPntrToArgument(i)->get());
+        signature+=aa->getPntrToArgument(i)->getName()+",";
+      }
+      signature+=";";
+    }
+// the arguments can only be exchanged if all the replicas have the same biases acting on the same arguments
+    unsigned long long hmin=std::hash<std::string>()(signature), hmax=hmin;
+    if(intracomm.Get_rank()==0) { intercomm.Min(hmin); intercomm.Max(hmax); }
+    int same=(hmin==hmax);
+    intracomm.Bcast(same,0);
+    cvExchangeNow=same;
+    if(cvExchangeNow) return;
+    plumedMain.getLog()<<"GREX: the biases or their arguments differ between replicas, the whole configuration is exchanged at step "<<plumedMain.getStep()<<"\n";
+  }
   plumedMain.prepareDependencies();
   plumedMain.resetActive(true);
   plumedMain.shareAll();
@@ -186,7 +263,30 @@ void GREX::savePositions() {
   buffer=o.str();
 }
 
+void GREX::calculateFromArguments() {
+  std::vector<double> rbuf(cvBuffer.size());
+  if(intracomm.Get_rank()==0) {
+    Communicator::Request req=intercomm.Isend(cvBuffer,partner,1068);
+    Communicator::Status status;
+    intercomm.Recv(rbuf,partner,1068,status);
+    req.wait();
+    plumed_massert(status.Get_count<double>()==int(rbuf.size()),"with PLUMED_GREX_CV_EXCHANGE the biases of all the replicas should have the same number of arguments");
+  }
+  intracomm.Bcast(rbuf,0);
+  localDeltaBias=0.0;
+  std::vector<double> args;
+  unsigned k=0;
+  for(unsigned b=0; b<cvBiases.size(); ++b) {
+    args.assign(rbuf.begin()+k,rbuf.begin()+k+cvBiasArguments[b]->getNumberOfArguments());
+    k+=args.size();
+    localDeltaBias+=cvBiases[b]->computeBiasFromArguments(args)-cvBiases[b]->getOutputQuantity("bias");
+  }
+  localDeltaBias+=localUSwap-localUNow;
+  exchangeDeltaBias();
+}
+
 void GREX::calculate() {
+  if(cvExchangeNow) { calculateFromArguments(); return; }
   unsigned nn=buffer.size();
   std::vector<char> rbuf(nn);
   localDeltaBias=-plumedMain.getBias();
@@ -204,6 +304,10 @@ void GREX::calculate() {
   plumedMain.setExchangeStep(false);
   localDeltaBias+=plumedMain.getBias();
   localDeltaBias+=localUSwap-localUNow;
+  exchangeDeltaBias();
+}
+
+void GREX::exchangeDeltaBias() {
   if(intracomm.Get_rank()==0) {
     Communicator::Request req=intercomm.Isend(localDeltaBias,partner,1067);
     intercomm.Recv(foreignDeltaBias,partner,1067);
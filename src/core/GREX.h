@@ -31,6 +31,8 @@ namespace PLMD {
 
 class PlumedMain;
 class Communicator;
+class ActionWithValue;
+class ActionWithArguments;
 
 class GREX:
   public WithCmd
@@ -47,8 +49,28 @@ class GREX:
   double localUNow;
   double localUSwap;
   std::vector<double> allDeltaBias;
+/// State of the gathering of allDeltaBias, which is done in the background
+  class DeltaBiasExchange;
+  ForwardDecl<DeltaBiasExchange> deltaBiasExchange_fwd;
+  DeltaBiasExchange& deltaBiasExchange=*deltaBiasExchange_fwd;
+/// Wait until allDeltaBias has been gathered
+  void waitAllDeltaBias();
   std::string buffer;
   int myreplica;
+/// Are only the arguments of the biases exchanged (1) or the whole configuration (0).  -1 if not decided yet
+  int cvExchange;
+/// The active biases and their arguments when only the arguments are exchanged
+  std::vector<ActionWithValue*> cvBiases;
+  std::vector<ActionWithArguments*> cvBiasArguments;
+  std::vector<double> cvBuffer;
+/// Are only the arguments exchanged at this step.  This is false if the biases or their arguments differ between the replicas
+  bool cvExchangeNow;
+/// Decide if only the arguments of the biases can be exchanged (collective over all the replicas)
+  void setupCVExchange();
+/// Compute localDeltaBias from the arguments of the biases in the partner replica
+  void calculateFromArguments();
+/// Send localDeltaBias to the partner and receive foreignDeltaBias
+  void exchangeDeltaBias();
 public:
   explicit GREX(PlumedMain&);
   ~GREX();
@@ -245,6 +245,9 @@ void GenericMolInfo::getBackbone( std::vector<std::string>& restrings, const std
 }
 
 void GenericMolInfo::interpretSymbol( const std::string& symbol, std::vector<AtomNumber>& atoms ) {
+  // the structure does not change so symbols that are used many times in the input are only interpreted once
+  const auto cached=symbol_cache.find(symbol);
+  if( cached!=symbol_cache.end() ) { atoms=cached->second; return; }
   if(Tools::startWith(symbol,"mdt:") || Tools::startWith(symbol,"mda:") || Tools::startWith(symbol,"vmd:") || Tools::startWith(symbol,"vmdexec:")) {
 
     plumed_assert(enablePythonInterpreter);
@@ -318,6 +321,7 @@ void GenericMolInfo::interpretSymbol( const std::string& symbol, std::vector<Ato
       atoms.resize(nat);
       comm.Bcast(atoms,0);
     }
+    symbol_cache[symbol]=atoms;
     log<<"  selection interpreted using ";
     if(Tools::startWith(symbol,"mdt:")) log<<"mdtraj "<<cite("McGibbon et al, Biophys. J., 109, 1528 (2015)")<<"\n";
     if(Tools::startWith(symbol,"mda:")) log<<"MDAnalysis "<<cite("Gowers et al, Proceedings of the 15th Python in Science Conference, doi:10.25080/majora-629e541a-00e (2016)")<<"\n";
@@ -327,6 +331,7 @@ void GenericMolInfo::interpretSymbol( const std::string& symbol, std::vector<Ato
   }
   MolDataClass::specialSymbol( mytype, symbol, pdb, atoms );
   if(atoms.empty()) error(symbol + " not found in your MOLINFO structure");
+  symbol_cache[symbol]=atoms;
 }
 
 std::string GenericMolInfo::getAtomName(AtomNumber a)const {
@@ -61,6 +61,8 @@ private:
   bool selector_running=false;
 /// Structure in pdb file is whole
   bool iswhole_;
+/// The atoms that were found for the symbols that have already been interpreted
+  std::map<std::string,std::vector<AtomNumber> > symbol_cache;
 public:
   ~GenericMolInfo();
   void calculate() override {}
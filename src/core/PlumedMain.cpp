@@ -27,6 +27,8 @@
 #include "ActionSet.h"
 #include "ActionWithValue.h"
 #include "ActionWithVirtualAtom.h"
+#include "ActionWithVector.h"
+#include "Checkpoint.h"
 #include "ActionToGetData.h"
 #include "ActionToPutData.h"
 #include "CLToolMain.h"
@@ -34,15 +36,19 @@
 #include "GREX.h"
 #include "DomainDecomposition.h"
 #include "config/Config.h"
+#include "tools/AsyncWriter.h"
 #include "tools/Citations.h"
 #include "tools/Communicator.h"
 #include "tools/DLLoader.h"
 #include "tools/Exception.h"
 #include "tools/IFile.h"
 #include "tools/Log.h"
+#include "tools/OFile.h"
 #include "tools/OpenMP.h"
 #include "tools/Tools.h"
 #include "tools/Stopwatch.h"
+#include "tools/Tracer.h"
+#include "tools/PerfCounters.h"
 #include "tools/TypesafePtr.h"
 #include "lepton/Exception.h"
 #include "DataPassingTools.h"
@@ -50,6 +56,7 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <cerrno>
 #include <set>
 #include <exception>
 #include <stdexcept>
@@ -58,6 +65,7 @@
 #include <typeinfo>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
 #include <system_error>
 #include <future>
 #include <memory>
@@ -67,6 +75,10 @@
 #include <optional>
 #include <variant>
 #include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <cstdint>
 
 namespace PLMD {
 
@@ -210,6 +222,32 @@ namespace PLMD {
 }
 
 namespace {
+/// Append to key the content of a source file and, recursively, of the files that it includes
+/// with #include "..." and that are found in its directory.  This is used for the key of the
+/// LOAD cache.  Headers that are not found next to the file (e.g. the PLUMED headers) are skipped
+void appendSourceWithLocalIncludes(const std::filesystem::path& file,std::string& key,std::set<std::string>& done) {
+  std::ifstream src(file,std::ios::binary);
+  if(!src) plumed_error()<<"cannot open file "<<file.string()<<" to be compiled";
+  if(!done.insert(std::filesystem::weakly_canonical(file).string()).second) return;
+  std::stringstream content; content<<src.rdbuf();
+  const std::string text=content.str();
+  key+=text;
+  std::istringstream lines(text);
+  std::string line;
+  while(std::getline(lines,line)) {
+    std::size_t p=line.find_first_not_of(" \t");
+    if(p==std::string::npos || line[p]!='#') continue;
+    p=line.find_first_not_of(" \t",p+1);
+    if(p==std::string::npos || line.compare(p,7,"include")!=0) continue;
+    std::size_t open=line.find('"',p+7);
+    if(open==std::string::npos) continue;
+    std::size_t close=line.find('"',open+1);
+    if(close==std::string::npos) continue;
+    std::filesystem::path inc=file.parent_path()/line.substr(open+1,close-open-1);
+    if(std::filesystem::is_regular_file(inc)) appendSourceWithLocalIncludes(inc,key,done);
+  }
+}
+
 /// This is an internal tool used to count how many PlumedMain objects have been created
 /// and if they were correctly destroyed.
 /// When using debug options, it leads to a crash
@@ -268,6 +306,16 @@ PlumedMain::PlumedMain():
 
 // destructor needed to delete forward declarated objects
 PlumedMain::~PlumedMain() {
+// the memory report is written before the timings, which are printed when stopwatch is destroyed
+  if(initialized && log.isOpen()) {
+    try {
+      reportMemoryUsage("Memory usage at the end of the simulation");
+      perfCounters.print(log);
+      tracer.write(comm);
+    } catch(...) {
+      // a destructor should not throw
+    }
+  }
   CountInstances::decrease();
 }
 
@@ -279,33 +327,52 @@ PlumedMain::~PlumedMain() {
 #define CHECK_NOTNULL(val,word) plumed_assert(val)<<"NULL pointer received in cmd(\"" << word << "\")"
 
 
-void PlumedMain::cmd(std::string_view word,const TypesafePtr & val) {
-
+namespace {
 // Enumerate all possible commands:
-  enum {
+enum {
 #include "PlumedMainEnum.inc"
-  };
+};
+}
 
 // Static object (initialized once) containing the map of commands:
+static const Tools::FastStringUnorderedMap<int> & getCmdWordMap() {
   const static Tools::FastStringUnorderedMap<int> word_map = {
 #include "PlumedMainMap.inc"
   };
+  return word_map;
+}
+
+void PlumedMain::cmd(std::string_view word,const TypesafePtr & val) {
+  gch::small_vector<std::string_view> words;
+// the commands that are called at every step are single words, so they are not split
+  if( word.find(' ')==std::string_view::npos ) { if( word.length()>0 ) words.push_back(word); }
+  else Tools::getWordsSimple(words,word);
+
+  int iword=-1;
+  if(words.size()>0) {
+    const auto & word_map=getCmdWordMap();
+    const auto it=word_map.find(words[0]);
+    if(it!=word_map.end()) iword=it->second;
+  }
+  cmdExecute(iword,word,words.data(),words.size(),val);
+}
+
+void PlumedMain::cmdHandle(int handle,const TypesafePtr & val) {
+  plumed_assert(handle>=0 && handle<int(commandHandles.size())) << "invalid command handle " << handle << ", handles should be obtained with cmd(\"getCommandHandle\")";
+  const auto & h=commandHandles[handle];
+  gch::small_vector<std::string_view> words;
+  for(const auto & w : h.words) words.push_back(w);
+  cmdExecute(h.iword,h.key,words.data(),words.size(),val);
+}
 
+void PlumedMain::cmdExecute(int iword,std::string_view word,const std::string_view* words,unsigned nw,const TypesafePtr & val) {
   try {
 
     auto ss=stopwatch.startPause();
 
-    gch::small_vector<std::string_view> words;
-    Tools::getWordsSimple(words,word);
-
-    unsigned nw=words.size();
     if(nw==0) {
       // do nothing
     } else {
-      int iword=-1;
-      const auto it=word_map.find(words[0]);
-      if(it!=word_map.end()) iword=it->second;
-
       switch(iword) {
       case cmd_setBox:
         CHECK_INIT(initialized,word);
@@ -565,7 +632,7 @@ void PlumedMain::cmd(std::string_view word,const TypesafePtr & val) {
       break;
       case cmd_getApiVersion:
         CHECK_NOTNULL(val,word);
-        val.set(int(10));
+        val.set(int(11));
         break;
       // commands which can be used only before initialization:
       case cmd_init:
@@ -728,6 +795,77 @@ void PlumedMain::cmd(std::string_view word,const TypesafePtr & val) {
         else nestedExceptions=false;
         break;
       /* STOP API */
+      case cmd_setCheckpointFile:
+        CHECK_NOTNULL(val,word);
+        checkpointFile=val.getCString();
+        break;
+      case cmd_readCheckpoint:
+        CHECK_INIT(initialized,word);
+        CHECK_NOTNULL(val,word);
+        readCheckpoint(val.getCString());
+        break;
+      case cmd_setTraceFile:
+        CHECK_NOTINIT(initialized,word);
+        CHECK_NOTNULL(val,word);
+        tracer.setFile(val.getCString());
+        break;
+      case cmd_setTraceSteps:
+        CHECK_NOTNULL(val,word);
+        {
+          auto steps=val.get<const long long int*>({2});
+          tracer.setWindow(steps[0],steps[1]);
+        }
+        break;
+      case cmd_setPerfCounters:
+        CHECK_NOTINIT(initialized,word);
+        CHECK_NOTNULL(val,word);
+        if(val.get<int>()!=0) usePerfCounters=true;
+        break;
+      case cmd_setLoadBalanceStride:
+        CHECK_NOTNULL(val,word);
+        loadBalanceStride=val.get<int>();
+        break;
+      case cmd_setDetailedTimers:
+        CHECK_NOTNULL(val,word);
+        detailedTimers=(val.get<int>()!=0);
+        break;
+      case cmd_getActionLabelsLength:
+        CHECK_INIT(initialized,word);
+        CHECK_NOTNULL(val,word);
+        {
+          std::size_t length=1;
+          for(const auto & p : actionSet) length+=p->getLabel().length()+1;
+          val.set(int(length));
+        }
+        break;
+      case cmd_getActionLabels:
+        CHECK_INIT(initialized,word);
+        CHECK_NOTNULL(val,word);
+        {
+// labels are separated by newlines, in the same order used by getActionTimings
+          std::string labels;
+          for(const auto & p : actionSet) labels+=p->getLabel()+"\n";
+          auto buffer=val.get<char*>({labels.length()+1});
+          std::memcpy(buffer,labels.c_str(),labels.length()+1);
+        }
+        break;
+      case cmd_getActionTimings:
+        CHECK_INIT(initialized,word);
+        CHECK_NOTNULL(val,word);
+        {
+          auto timings=val.get<long long int*>({actionSet.size(),2});
+          for(unsigned i=0; i<2*actionSet.size(); i++) timings[i]=(i<actionTimings.size()?actionTimings[i]:0);
+        }
+        break;
+      case cmd_printMemoryUsage:
+        CHECK_INIT(initialized,word);
+        reportMemoryUsage("Memory usage");
+        break;
+      case cmd_getMemoryUsage:
+        CHECK_INIT(initialized,word);
+        CHECK_NOTNULL(val,word);
+        val.set((long long int) updateMemoryHighWater());
+        break;
       case cmd_setMDEngine:
         CHECK_NOTINIT(initialized,word);
         CHECK_NOTNULL(val,word);
@@ -822,7 +960,7 @@ void PlumedMain::cmd(std::string_view word,const TypesafePtr & val) {
         plumed_massert(grex,"error allocating grex");
         {
           std::string kk=std::string(words[1]);
-          for(unsigned i=2; i<words.size(); i++) kk+=" "+std::string(words[i]);
+          for(unsigned i=2; i<nw; i++) kk+=" "+std::string(words[i]);
           grex->cmd(kk.c_str(),val);
         }
         break;
@@ -831,7 +969,7 @@ void PlumedMain::cmd(std::string_view word,const TypesafePtr & val) {
         if(!cltool) cltool=Tools::make_unique<CLToolMain>();
         {
           std::string kk(words[1]);
-          for(unsigned i=2; i<words.size(); i++) kk+=" "+std::string(words[i]);
+          for(unsigned i=2; i<nw; i++) kk+=" "+std::string(words[i]);
           cltool->cmd(kk.c_str(),val);
         }
         break;
@@ -840,10 +978,29 @@ void PlumedMain::cmd(std::string_view word,const TypesafePtr & val) {
       case cmd_convert:
       {
         double v;
-        plumed_assert(words.size()==2);
+        plumed_assert(nw==2);
         if(Tools::convertNoexcept(std::string(words[1]),v)) passtools->double2MD(v,val);
       }
       break;
+      /* ADDED WITH API==11 */
+      case cmd_getCommandHandle:
+        CHECK_NOTNULL(val,word);
+        plumed_assert(nw>1) << "cmd(\"getCommandHandle\") should be followed by the command to be resolved";
+        {
+          CommandHandle h;
+          const auto & word_map=getCmdWordMap();
+          const auto it=word_map.find(words[1]);
+          if(it!=word_map.end()) h.iword=it->second;
+          plumed_assert(h.iword>=0 && h.iword!=cmd_getCommandHandle) << "cannot interpret cmd(\"" << words[1] << "\"). check plumed developers manual to see the available commands.";
+          for(unsigned i=1; i<nw; i++) {
+            if(i>1) h.key+=" ";
+            h.key+=words[i];
+            h.words.emplace_back(words[i]);
+          }
+          commandHandles.push_back(std::move(h));
+          val.set(int(commandHandles.size()-1));
+        }
+        break;
       default:
         plumed_error() << "cannot interpret cmd(\"" << word << "\"). check plumed developers manual to see the available commands.";
         break;
@@ -888,6 +1045,40 @@ void PlumedMain::init() {
   log.printf("Running over %d %s\n",comm.Get_size(),(comm.Get_size()>1?"nodes":"node"));
   log<<"Number of threads: "<<OpenMP::getNumThreads()<<"\n";
   log<<"Cache line size: "<<OpenMP::getCachelineSize()<<"\n";
+  concurrentActions=std::getenv("PLUMED_CONCURRENT_ACTIONS");
+  if(concurrentActions) log<<"Independent actions will be calculated concurrently (PLUMED_CONCURRENT_ACTIONS)\n";
+  if(auto minBytes=std::getenv("PLUMED_HIERARCHICAL_SUM")) {
+// the value is the size in bytes above which the arrays are summed first within each node
+    std::size_t bytes=0;
+    if(*minBytes && !Tools::convertNoexcept(std::string(minBytes),bytes)) plumed_merror("PLUMED_HIERARCHICAL_SUM should be a number of bytes");
+    comm.setHierarchicalSum(bytes);
+    if(comm.hierarchicalSum()) log<<"Sums of arrays of at least "<<bytes<<" bytes are done through node shared memory (PLUMED_HIERARCHICAL_SUM)\n";
+  }
+  if(AsyncWriter::enabled()) log<<"Output files will be written by background threads (PLUMED_ASYNC_OUTPUT)\n";
+  if(std::getenv("PLUMED_LOG_BUFFER")) log<<"Log is buffered in memory (PLUMED_LOG_BUFFER/PLUMED_LOG_FLUSH_INTERVAL)\n";
+// the trace can be requested either with cmd("setTraceFile") or with PLUMED_TRACE=file
+// and the window of steps with PLUMED_TRACE_STEPS=first:last
+  if(!tracer.enabled()) if(auto file=std::getenv("PLUMED_TRACE")) {
+      tracer.setFile(file);
+      if(auto window=std::getenv("PLUMED_TRACE_STEPS")) {
+        std::vector<std::string> words=Tools::getWords(window,":");
+        long long int first=0,last=-1;
+        if(words.size()!=2 || !Tools::convertNoexcept(words[0],first) || !Tools::convertNoexcept(words[1],last))
+          plumed_merror("PLUMED_TRACE_STEPS should be in the form first:last");
+        tracer.setWindow(first,last);
+      }
+    }
+  if(std::getenv("PLUMED_PERF_COUNTERS")) usePerfCounters=true;
+  if(usePerfCounters) {
+    if(perfCounters.open()) log<<"Hardware counters are collected for each phase and action\n";
+    else log<<"WARNING: hardware counters are not available on this system (see /proc/sys/kernel/perf_event_paranoid)\n";
+  }
+  if(loadBalanceStride==0) if(auto stride=std::getenv("PLUMED_LOAD_BALANCE_STRIDE")) Tools::convert(std::string(stride),loadBalanceStride);
+  if(loadBalanceStride>0) log<<"Load balance across processes is reported every "<<loadBalanceStride<<" steps\n";
+  if(tracer.enabled()) {
+    tracer.setFile(FileBase::appendSuffix(tracer.getFile(),getSuffix()));
+    log<<"Writing a timeline of the calculation to "<<tracer.getFile()<<"\n";
+  }
   for(const auto & pp : inputs ) {
     plumed_assert(pp);
     DomainDecomposition* dd=pp->castToDomainDecomposition();
@@ -912,6 +1103,7 @@ void PlumedMain::init() {
   log<<"Relevant bibliography:\n";
   log<<citations;
   log<<"Please read and cite where appropriate!\n";
+  reportMemoryUsage("Memory usage after setup");
   log<<"Finished setup\n";
 }
 
@@ -1039,6 +1231,9 @@ void PlumedMain::prepareDependencies() {
 
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("1 Prepare dependencies");
+  if(tracer.enabled() && tracer.setStep(step)) tracer.write(comm);
+  auto ts=tracer.scope("1 Prepare dependencies","phase");
+  auto pc=perfCounters.measure("1 Prepare dependencies");
 
 // activate all the actions which are on step
 // activation is recursive and enables also the dependencies
@@ -1070,6 +1265,16 @@ void PlumedMain::prepareDependencies() {
     }
   }
 
+// derivatives are only calculated in the actions that are needed by an action that uses
+// derivatives on this step (e.g. a bias that applies forces)
+  for(const auto & p : actionSet) {
+    ActionWithValue* av=p->castToActionWithValue();
+    if(av) av->setDerivativesOnStep(false);
+  }
+  for(const auto & p : actionSet) {
+    if(p->isActive() && p->checkNeedsDerivatives()) p->activateDerivatives();
+  }
+
 }
 
 bool PlumedMain::inputsAreActive() const {
@@ -1088,6 +1293,8 @@ void PlumedMain::shareData() {
   if(!active)return;
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("2 Sharing data");
+  auto ts=tracer.scope("2 Sharing data","phase");
+  auto pc=perfCounters.measure("2 Sharing data");
   for(const auto & ip : inputs) ip->share();
 }
 
@@ -1115,6 +1322,8 @@ void PlumedMain::waitData() {
   if(!active)return;
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("3 Waiting for data");
+  auto ts=tracer.scope("3 Waiting for data","phase");
+  auto pc=perfCounters.measure("3 Waiting for data");
   for(const auto & ip : inputs) {
     if( ip->isActive() && ip->hasBeenSet() ) ip->wait();
     else if( ip->isActive() ) ip->warning("input requested but this quantity has not been set");
@@ -1125,6 +1334,8 @@ void PlumedMain::justCalculate() {
   if(!active)return;
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("4 Calculating (forward loop)");
+  auto ts=tracer.scope("4 Calculating (forward loop)","phase");
+  auto pc=perfCounters.measure("4 Calculating (forward loop)");
   bias=0.0;
   work=0.0;
 
@@ -1136,51 +1347,191 @@ void PlumedMain::justCalculate() {
   }
   if( firststep ) { for(const auto & ip : inputs) ip->firststep=false; }
 
+  unsigned nt=OpenMP::getNumThreads();
+  if( concurrentActions && nt>1 && comm.Get_size()==1 && multi_sim_comm.Get_size()==1 && !firststep && !detailedTimers && !perfCounters.enabled() ) {
+    if( nactionsInGroups!=actionSet.size() ) setupConcurrentGroups();
+// calculate groups of independent actions one after the other
+    for(const auto & group : calculateGroups) {
+      if( group.size()==1 ) { calculateAction( group[0], 0, firststep, bias, work ); continue; }
+      std::vector<std::exception_ptr> errors( group.size() );
+      double gbias=0.0, gwork=0.0;
+      #pragma omp parallel for num_threads(std::min(nt,unsigned(group.size()))) schedule(dynamic,1) reduction(+:gbias,gwork)
+      for(unsigned i=0; i<group.size(); ++i) {
+        try {
+          calculateAction( group[i], 0, firststep, gbias, gwork );
+        } catch(...) {
+          errors[i]=std::current_exception();
+        }
+      }
+      for(const auto & e : errors) if( e ) std::rethrow_exception( e );
+      bias+=gbias; work+=gwork;
+    }
+    return;
+  }
+  if( concurrentActions && comm.Get_size()>1 && !firststep && !detailedTimers ) {
+    if( nactionsInGroups!=actionSet.size() ) setupConcurrentGroups();
+// the buffers of the independent actions in a group are summed over the processes with a single
+// allreduce once all the actions in the group have been calculated
+    std::vector<ActionWithVector*> pending;
+    for(const auto & group : calculateGroups) {
+      pending.resize(0);
+      for(const auto & p : group) {
+        ActionWithVector* av=dynamic_cast<ActionWithVector*>(p);
+        if( av && group.size()>1 && av->canDeferReduction() ) av->setDeferReduction( true );
+        calculateAction( p, 0, firststep, bias, work );
+        if( av ) av->setDeferReduction( false );
+        if( av && av->reductionIsPending() ) pending.push_back( av );
+      }
+      if( pending.empty() ) continue;
+      std::size_t ntot=0;
+      for(const auto & av : pending) ntot+=av->getPendingReduction().size();
+      reductionBuffer.resize( ntot ); ntot=0;
+      for(const auto & av : pending) {
+        const std::vector<double>& buf( av->getPendingReduction() );
+        std::copy( buf.begin(), buf.end(), reductionBuffer.begin()+ntot ); ntot+=buf.size();
+      }
+      auto waiting=std::chrono::steady_clock::now();
+      comm.Sum( reductionBuffer );
+      const double wait=std::chrono::duration<double>( std::chrono::steady_clock::now() - waiting ).count();
+      ntot=0;
+      for(const auto & av : pending) {
+        std::vector<double>& buf( av->getPendingReduction() );
+        std::copy( reductionBuffer.begin()+ntot, reductionBuffer.begin()+ntot+buf.size(), buf.begin() ); ntot+=buf.size();
+        try {
+          av->completeReduction( wait );
+          finishCalculation( av, firststep, bias, work );
+        } catch(...) {
+          plumed_error_nested() << "An error happened while calculating " << av->getLabel();
+        }
+      }
+    }
+    return;
+  }
+
   int iaction=0;
+  if(detailedTimers) actionTimings.assign(2*actionSet.size(),0);
 // calculate the active actions in order (assuming *backward* dependence)
   for(const auto & pp : actionSet) {
-    Action* p(pp.get());
-    plumed_assert(p);
-    try {
-      if(p->isActive()) {
+    calculateAction( pp.get(), iaction, firststep, bias, work );
+    if(detailedTimers && pp->isActive()) actionTimings[2*iaction]=stopwatch.getLastCycle(detailedTimerName("4A",iaction,pp.get()));
+    iaction++;
+  }
+}
+
+std::string PlumedMain::detailedTimerName(const std::string & prefix,int iaction,const Action* p) const {
+  auto actionNumberLabel=std::to_string(iaction);
+  const unsigned m=actionSet.size();
+  unsigned k=0; unsigned n=1; while(n<m) { n*=10; k++; }
+  auto spaces=std::string(k-actionNumberLabel.length(),' ');
+  return prefix + " " + spaces + actionNumberLabel+" "+p->getLabel();
+}
+
+void PlumedMain::calculateAction( Action* p, const int& iaction, const bool& firststep, double& mybias, double& mywork ) {
+  plumed_assert(p);
+  try {
+    if(p->isActive()) {
 // Stopwatch is stopped when sw goes out of scope.
 // We explicitly declare a Stopwatch::Handler here to allow for conditional initialization.
-        Stopwatch::Handler sw;
-        if(detailedTimers) {
-          auto actionNumberLabel=std::to_string(iaction);
-          const unsigned m=actionSet.size();
-          unsigned k=0; unsigned n=1; while(n<m) { n*=10; k++; }
-          auto spaces=std::string(k-actionNumberLabel.length(),' ');
-          sw=stopwatch.startStop("4A " + spaces + actionNumberLabel+" "+p->getLabel());
-        }
-        ActionWithValue*av=p->castToActionWithValue();
-        ActionAtomistic*aa=p->castToActionAtomistic();
-        {
-          if(av) av->clearInputForces();
-          if(av) av->clearDerivatives();
-          if( av && av->calculateOnUpdate() ) continue ;
-        }
-        {
-          if(aa) if(aa->isActive()) aa->retrieveAtoms();
-        }
-        if(p->checkNumericalDerivatives()) p->calculateNumericalDerivatives();
-        else p->calculate();
-        // This retrieves components called bias
-        if(av) {
-          bias+=av->getOutputQuantity("bias");
-          work+=av->getOutputQuantity("work");
-          av->setGradientsIfNeeded();
-        }
-        // This makes all values that depend on the (fixed) masses and charges constant
-        if( firststep ) p->setupConstantValues( true );
-        ActionWithVirtualAtom*avv=p->castToActionWithVirtualAtom();
-        if(avv)avv->setGradientsIfNeeded();
+      Stopwatch::Handler sw;
+      if(detailedTimers) sw=stopwatch.startStop(detailedTimerName("4A",iaction,p));
+      auto ts=tracer.scope("calculate ",p->getLabel(),"action");
+      auto pc=perfCounters.measure("4A ",p->getLabel());
+      ActionWithValue*av=p->castToActionWithValue();
+      ActionAtomistic*aa=p->castToActionAtomistic();
+      {
+        if(av) av->clearInputForces();
+        if(av) av->clearDerivatives();
+        if( av && av->calculateOnUpdate() ) return ;
       }
-    } catch(...) {
-      plumed_error_nested() << "An error happened while calculating " << p->getLabel();
+      {
+        if(aa) if(aa->isActive()) aa->retrieveAtoms();
+      }
+      if(p->checkNumericalDerivatives()) p->calculateNumericalDerivatives();
+      else p->calculate();
+      // The values of actions that are still summing their data over the processes are finished later
+      ActionWithVector*avec=dynamic_cast<ActionWithVector*>(p);
+      if( avec && avec->reductionIsPending() ) return;
+      finishCalculation( p, firststep, mybias, mywork );
     }
-    iaction++;
+  } catch(...) {
+    plumed_error_nested() << "An error happened while calculating " << p->getLabel();
+  }
+}
+
+void PlumedMain::finishCalculation( Action* p, const bool& firststep, double& mybias, double& mywork ) {
+  ActionWithValue*av=p->castToActionWithValue();
+  // This retrieves components called bias
+  if(av) {
+    mybias+=av->getOutputQuantity("bias");
+    mywork+=av->getOutputQuantity("work");
+    av->setGradientsIfNeeded();
+  }
+  // This makes all values that depend on the (fixed) masses and charges constant
+  if( firststep ) p->setupConstantValues( true );
+  ActionWithVirtualAtom*avv=p->castToActionWithVirtualAtom();
+  if(avv)avv->setGradientsIfNeeded();
+}
+
+void PlumedMain::setupConcurrentGroups() {
+  nactionsInGroups=actionSet.size();
+  std::map<Action*,unsigned> position;
+  for(unsigned i=0; i<actionSet.size(); ++i) position[actionSet[i].get()]=i;
+
+// In the forward loop an action must be calculated after all its dependencies.  Actions that
+// cannot be calculated concurrently are given a level of their own.
+  std::vector<unsigned> level( actionSet.size(), 0 );
+  unsigned floor=0, maxlevel=0;
+  for(unsigned i=0; i<actionSet.size(); ++i) {
+    Action* p=actionSet[i].get();
+    if( p->canCalculateConcurrently() ) {
+      level[i]=floor;
+      for(const auto & d : p->getDependencies() ) {
+        auto pos=position.find(d);
+        if( pos!=position.end() && pos->second<i ) level[i]=std::max( level[i], level[pos->second]+1 );
+      }
+    } else {
+      level[i]=(i==0?0:maxlevel+1); floor=level[i]+1;
+    }
+    maxlevel=std::max(maxlevel,level[i]);
+  }
+  calculateGroups.assign( actionSet.size()>0 ? maxlevel+1 : 0, std::vector<Action*>() );
+  for(unsigned i=0; i<actionSet.size(); ++i) calculateGroups[level[i]].push_back( actionSet[i].get() );
+
+// In the backward loop an action must apply its forces after all the actions that depend on it
+  std::vector<unsigned> need( actionSet.size(), 0 );
+  floor=0; maxlevel=0;
+  for(int i=actionSet.size()-1; i>=0; --i) {
+    Action* p=actionSet[i].get();
+    if( p->canApplyConcurrently() ) level[i]=std::max( floor, need[i] );
+    else { level[i]=(i==int(actionSet.size())-1?0:maxlevel+1); floor=level[i]+1; }
+    maxlevel=std::max(maxlevel,level[i]);
+    for(const auto & d : p->getDependencies() ) {
+      auto pos=position.find(d);
+      if( pos!=position.end() ) need[pos->second]=std::max( need[pos->second], level[i]+1 );
+    }
+  }
+// Actions that add forces on the same dependency cannot apply their forces at the same time
+  applyGroups.resize(0);
+  for(unsigned l=0; actionSet.size()>0 && l<=maxlevel; ++l) {
+    std::vector<std::vector<Action*> > subgroups;
+    std::vector<std::set<Action*> > used;
+    for(int i=actionSet.size()-1; i>=0; --i) {
+      if( level[i]!=l ) continue;
+      Action* p=actionSet[i].get();
+      unsigned k=0;
+      for(; k<subgroups.size(); ++k) {
+        bool clash=false;
+        for(const auto & d : p->getDependencies() ) if( used[k].count(d) ) { clash=true; break; }
+        if( !clash ) break;
+      }
+      if( k==subgroups.size() ) { subgroups.emplace_back(); used.emplace_back(); }
+      subgroups[k].push_back(p);
+      for(const auto & d : p->getDependencies() ) used[k].insert(d);
+    }
+    for(auto & g : subgroups) applyGroups.push_back( std::move(g) );
   }
+  unsigned nconcurrent=0; for(const auto & g : calculateGroups) if( g.size()>1 ) nconcurrent+=g.size();
+  log.printf("  %u of %u actions can be calculated concurrently in %u groups\n", nconcurrent, nactionsInGroups, unsigned(calculateGroups.size()) );
 }
 
 void PlumedMain::justApply() {
@@ -1194,6 +1545,29 @@ void PlumedMain::backwardPropagate() {
   int iaction=0;
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("5 Applying (backward loop)");
+  auto ts=tracer.scope("5 Applying (backward loop)","phase");
+  auto pc=perfCounters.measure("5 Applying (backward loop)");
+  unsigned nt=OpenMP::getNumThreads();
+  if( concurrentActions && nt>1 && comm.Get_size()==1 && multi_sim_comm.Get_size()==1 && !detailedTimers && !perfCounters.enabled() && nactionsInGroups==actionSet.size() ) {
+// apply groups of actions that do not share dependencies one after the other
+    for(const auto & group : applyGroups) {
+      if( group.size()==1 ) {
+        if( group[0]->isActive() ) { auto ts=tracer.scope("apply ",group[0]->getLabel(),"action"); group[0]->apply(); }
+        continue;
+      }
+      std::vector<std::exception_ptr> errors( group.size() );
+      #pragma omp parallel for num_threads(std::min(nt,unsigned(group.size()))) schedule(dynamic,1)
+      for(unsigned i=0; i<group.size(); ++i) {
+        try {
+          if( group[i]->isActive() ) { auto ts=tracer.scope("apply ",group[i]->getLabel(),"action"); group[i]->apply(); }
+        } catch(...) {
+          errors[i]=std::current_exception();
+        }
+      }
+      for(const auto & e : errors) if( e ) std::rethrow_exception( e );
+    }
+    return;
+  }
 // apply them in reverse order
   for(auto pp=actionSet.rbegin(); pp!=actionSet.rend(); ++pp) {
     const auto & p(pp->get());
@@ -1202,16 +1576,14 @@ void PlumedMain::backwardPropagate() {
 // Stopwatch is stopped when sw goes out of scope.
 // We explicitly declare a Stopwatch::Handler here to allow for conditional initialization.
       Stopwatch::Handler sw;
-      if(detailedTimers) {
-        auto actionNumberLabel=std::to_string(iaction);
-        const unsigned m=actionSet.size();
-        unsigned k=0; unsigned n=1; while(n<m) { n*=10; k++; }
-        auto spaces=std::string(k-actionNumberLabel.length(),' ');
-        sw=stopwatch.startStop("5A " + spaces + actionNumberLabel+" "+p->getLabel());
-      }
+      if(detailedTimers) sw=stopwatch.startStop(detailedTimerName("5A",iaction,p));
+      auto ts=tracer.scope("apply ",p->getLabel(),"action");
+      auto pc=perfCounters.measure("5A ",p->getLabel());
 
       p->apply();
     }
+    if(detailedTimers && p->isActive() && actionTimings.size()==2*actionSet.size())
+      actionTimings[2*(actionSet.size()-1-iaction)+1]=stopwatch.getLastCycle(detailedTimerName("5A",iaction,p));
     iaction++;
   }
 
@@ -1221,17 +1593,92 @@ void PlumedMain::backwardPropagate() {
   if(detailedTimers) sw1=stopwatch.startStop("5B Update forces");
 }
 
+std::size_t PlumedMain::updateMemoryHighWater() {
+  if(memoryHighWater.size()!=actionSet.size()) memoryHighWater.resize(actionSet.size(),0);
+  std::size_t total=0;
+  for(unsigned i=0; i<actionSet.size(); i++) {
+    std::size_t bytes=actionSet[i]->getMemoryUsage().total();
+    memoryHighWater[i]=std::max(memoryHighWater[i],bytes);
+    total+=bytes;
+  }
+  totalMemoryHighWater=std::max(totalMemoryHighWater,total);
+  return total;
+}
+
+void PlumedMain::reportMemoryUsage(const std::string & title) {
+  updateMemoryHighWater();
+  auto kb=[](std::size_t bytes) { return bytes/1024.0; };
+  log<<title<<" (kB):\n";
+  log.printf("  %-30s %12s %12s %12s %12s %12s %12s %12s\n","action","values","atoms","buffers","grids","lists","total","peak");
+  Action::MemoryUsage sum;
+  for(unsigned i=0; i<actionSet.size(); i++) {
+    const auto usage=actionSet[i]->getMemoryUsage();
+    log.printf("  %-30s %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f\n",actionSet[i]->getLabel().c_str(),
+               kb(usage.values),kb(usage.atoms),kb(usage.buffers),kb(usage.grids),kb(usage.lists),kb(usage.total()),kb(memoryHighWater[i]));
+    sum.values+=usage.values; sum.atoms+=usage.atoms; sum.buffers+=usage.buffers; sum.grids+=usage.grids; sum.lists+=usage.lists;
+  }
+  log.printf("  %-30s %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f\n","TOTAL",
+             kb(sum.values),kb(sum.atoms),kb(sum.buffers),kb(sum.grids),kb(sum.lists),kb(sum.total()),kb(totalMemoryHighWater));
+}
+
+void PlumedMain::reportLoadBalance() {
+  const unsigned n=actionSet.size();
+  const unsigned nproc=comm.Get_size();
+  std::vector<double> local(2*n), all(2*n*nproc);
+  for(unsigned i=0; i<n; i++) {
+    const auto & t=actionSet[i]->getLoadBalanceTimes();
+    local[2*i]=t[0]; local[2*i+1]=t[1];
+    actionSet[i]->resetLoadBalanceTimes();
+  }
+  if(nproc>1) comm.Allgather(local,all);
+  else all=local;
+// times are reported in milliseconds per step
+  const double scale=1000.0/loadBalanceSteps;
+  log.printf("Load balance over the last %lld steps on %u processes (ms per step):\n",loadBalanceSteps,nproc);
+  log.printf("  %-30s %30s %30s %10s\n","","computing (min/mean/max)","waiting (min/mean/max)","imbalance");
+  std::vector<double> totals(2*nproc,0.0);
+  auto printLine=[&](const std::string & label,const std::function<double(unsigned,unsigned)> & get) {
+    double stats[2][3];
+    for(unsigned k=0; k<2; k++) {
+      stats[k][0]=get(0,k); stats[k][1]=0.0; stats[k][2]=get(0,k);
+      for(unsigned p=0; p<nproc; p++) {
+        stats[k][0]=std::min(stats[k][0],get(p,k));
+        stats[k][1]+=get(p,k)/nproc;
+        stats[k][2]=std::max(stats[k][2],get(p,k));
+      }
+    }
+// the imbalance is the time lost by the average process waiting for the slowest one
+    double imbalance=(stats[0][2]>0.0 ? 100.0*(stats[0][2]-stats[0][1])/stats[0][2] : 0.0);
+    log.printf("  %-30s %9.3f %9.3f %9.3f  %9.3f %9.3f %9.3f  %9.1f%%\n",label.c_str(),
+               scale*stats[0][0],scale*stats[0][1],scale*stats[0][2],scale*stats[1][0],scale*stats[1][1],scale*stats[1][2],imbalance);
+  };
+  for(unsigned i=0; i<n; i++) {
+    bool timed=false;
+    for(unsigned p=0; p<nproc; p++) {
+      if(all[2*n*p+2*i]>0.0 || all[2*n*p+2*i+1]>0.0) timed=true;
+      totals[2*p]+=all[2*n*p+2*i]; totals[2*p+1]+=all[2*n*p+2*i+1];
+    }
+    if(timed) printLine(actionSet[i]->getLabel(),[&](unsigned p,unsigned k) { return all[2*n*p+2*i+k]; });
+  }
+  printLine("TOTAL",[&](unsigned p,unsigned k) { return totals[2*p+k]; });
+  loadBalanceSteps=0;
+}
+
 void PlumedMain::update() {
   if(!active)return;
 
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("6 Update");
+  auto ts=tracer.scope("6 Update","phase");
+  auto pc=perfCounters.measure("6 Update");
 
 // update step (for statistics, etc)
   updateFlags.push(true);
   for(const auto & p : actionSet) {
     p->beforeUpdate();
     if(p->isActive() && p->checkUpdate() && updateFlagsTop()) {
+      auto ts=tracer.scope("update ",p->getLabel(),"action");
+      auto pc=perfCounters.measure("6A ",p->getLabel());
       ActionWithValue* av=dynamic_cast<ActionWithValue*>(p.get());
       if( av && av->calculateOnUpdate() ) { p->prepare(); p->calculate(); }
       else p->update();
@@ -1239,6 +1686,8 @@ void PlumedMain::update() {
   }
   while(!updateFlags.empty()) updateFlags.pop();
   if(!updateFlags.empty()) plumed_merror("non matching changes in the update flags");
+  if(step%memoryHighWaterStride==0) updateMemoryHighWater();
+  if(loadBalanceStride>0 && ++loadBalanceSteps>=loadBalanceStride) reportLoadBalance();
 // Check that no action has told the calculation to stop
   if(stopNow) {
     if(stopFlag) stopFlag.set(int(1));
@@ -1253,9 +1702,10 @@ void PlumedMain::update() {
     log.flush();
     for(const auto & p : actionSet) p->fflush();
   }
+  if(doCheckPoint && checkpointFile.length()>0) writeCheckpoint(checkpointFile);
 }
 
-void PlumedMain::load(const std::string& fileName) {
+void PlumedMain::load(const std::string& fileName,const std::string& cache) {
   if(DLLoader::installed()) {
     std::string libName=fileName;
     size_t n=libName.find_last_of(".");
@@ -1267,14 +1717,33 @@ void PlumedMain::load(const std::string& fileName) {
       base=libName.substr(0,n);
 
     if(extension=="cpp") {
-      libName="./"+base+"."+config::getVersionLong()+"."+config::getSoExt();
 // full path command, including environment setup
 // this will work even if plumed is not in the execution path or if it has been
 // installed with a name different from "plumed"
-      std::string cmd=config::getEnvCommand()+" \""+config::getPlumedRoot()+"\"/scripts/mklib.sh -n -o "+libName+" "+fileName;
+      std::string mklib=config::getEnvCommand()+" \""+config::getPlumedRoot()+"\"/scripts/mklib.sh -n -o ";
+
+      std::string cacheDir=cache;
+      if(cacheDir.length()==0) if(auto env=std::getenv("PLUMED_LOAD_CACHE")) cacheDir=env;
+      if(cacheDir.length()>0) {
+        // The library is named after a hash of the source file, of the local headers that it includes and of the compilation command.
+        // Replicas and later jobs loading the same file thus find the library that was already compiled.
+        // The PLUMED headers are accounted for by the version, but system headers and headers found through -I are not tracked
+        std::string key; std::set<std::string> done;
+        appendSourceWithLocalIncludes(fileName,key,done);
+        key+=mklib+config::getVersionLong();
+        // 64 bit FNV-1a hash
+        std::uint64_t hash=14695981039346656037ULL;
+        for(const auto c : key) { hash^=static_cast<unsigned char>(c); hash*=1099511628211ULL; }
+        std::stringstream hex; hex<<std::hex<<hash;
+        libName=cacheDir+"/"+std::filesystem::path(base).filename().string()+"."+hex.str()+"."+config::getVersionLong()+"."+config::getSoExt();
+      } else {
+        libName="./"+base+"."+config::getVersionLong()+"."+config::getSoExt();
+      }
+      std::string cmd=mklib+libName+" "+fileName;
 
       if(std::getenv("PLUMED_LOAD_ACTION_DEBUG")) log<<"Executing: "<<cmd;
       else log<<"Compiling: "<<fileName<<" to "<<libName;
+      if(cacheDir.length()>0) log<<" (unless already in cache "<<cacheDir<<")";
 
       if(comm.Get_size()>0) log<<" (only on master node)";
       log<<"\n";
@@ -1288,8 +1757,21 @@ void PlumedMain::load(const std::string& fileName) {
         // the library is already there, even if running simultaneously).
         // It however decreases the system load if many threads are used.
         auto s=section.startStop(cmd);
-        int ret=std::system(cmd.c_str());
-        if(ret!=0) plumed_error() <<"An error happened while executing command "<<cmd<<"\n";
+        if(cacheDir.length()==0) {
+          int ret=std::system(cmd.c_str());
+          if(ret!=0) plumed_error() <<"An error happened while executing command "<<cmd<<"\n";
+        } else if(!std::filesystem::exists(libName)) {
+          // The library is compiled to a temporary name and then renamed, so that other processes
+          // never see a partially written library.  If two processes compile it at the same time
+          // the last rename wins, which is harmless since the libraries are identical.
+          std::filesystem::create_directories(cacheDir);
+          std::random_device rd;
+          std::string tmpName=libName+".tmp."+std::to_string(rd())+"."+config::getSoExt();
+          std::string tmpcmd=mklib+tmpName+" "+fileName;
+          int ret=std::system(tmpcmd.c_str());
+          if(ret!=0) plumed_error() <<"An error happened while executing command "<<tmpcmd<<"\n";
+          std::filesystem::rename(tmpName,libName);
+        } else log<<"Library "<<libName<<" found in cache\n";
       }
       comm.Barrier();
     } else {
@@ -1347,6 +1829,20 @@ void PlumedMain::fflush() {
   for(const auto  & p : files) {
     p->flush();
   }
+// make sure that the asynchronous writes have reached the files
+  for(const auto  & p : files) {
+    if(auto of=dynamic_cast<OFile*>(p)) of->sync();
+  }
+}
+
+std::vector<std::string> PlumedMain::getOutputFilePaths()const {
+  std::vector<std::string> paths;
+  for(const auto & p : files) {
+    const OFile* of=dynamic_cast<const OFile*>(p);
+    if(of && of->getFILE()) paths.push_back(of->getPath());
+  }
+  std::sort(paths.begin(),paths.end());
+  return paths;
 }
 
 void PlumedMain::insertFile(FileBase&f) {
@@ -1429,6 +1925,69 @@ void PlumedMain::readBinary(std::istream&i) {
   for(const auto & ip : inputs) ip->readBinary(i);
 }
 
+/// First bytes of a binary checkpoint
+static constexpr char checkpointMagic[8]= {'P','L','M','D','C','P','T','1'};
+
+void PlumedMain::writeCheckpoint(const std::string& fname)const {
+  if(comm.Get_rank()!=0) return;
+  std::string path=FileBase::appendSuffix(fname,getSuffix());
+// the state of each action is collected separately so that it can be skipped
+// when reading if the corresponding action is not present
+  std::vector<std::pair<std::string,std::string>> blocks;
+  for(const auto & p : actionSet) {
+    std::ostringstream oss(std::ios::binary);
+    p->writeCheckpoint(oss);
+    if(oss.tellp()>0) blocks.emplace_back(p->getLabel(),oss.str());
+  }
+// the checkpoint is written on a temporary file and then renamed,
+// so that a crash while writing does not destroy the previous checkpoint
+  std::string tmp=path+".tmp";
+  {
+    std::ofstream o(tmp,std::ios::binary);
+    if(!o) plumed_merror("cannot open checkpoint file " + tmp);
+    o.write(checkpointMagic,sizeof(checkpointMagic));
+    checkpoint::write(o,step);
+    checkpoint::write<std::size_t>(o,blocks.size());
+    for(const auto & b : blocks) {
+      checkpoint::write(o,b.first);
+      checkpoint::write(o,b.second);
+    }
+    if(!o) plumed_merror("error writing checkpoint file " + tmp);
+  }
+  int check=std::rename(tmp.c_str(),path.c_str());
+  plumed_massert(check==0,"renaming "+tmp+" into "+path+" failed for reason: "+std::strerror(errno));
+}
+
+void PlumedMain::readCheckpoint(const std::string& fname) {
+  std::string path=FileBase::appendSuffix(fname,getSuffix());
+  std::ifstream i(path,std::ios::binary);
+  if(!i) plumed_merror("cannot open checkpoint file " + path);
+  char magic[sizeof(checkpointMagic)];
+  i.read(magic,sizeof(magic));
+  if(!i || std::memcmp(magic,checkpointMagic,sizeof(magic))!=0) plumed_merror("file " + path + " is not a plumed checkpoint");
+  long long int cptstep;
+  checkpoint::read(i,cptstep);
+  std::size_t nblocks;
+  checkpoint::read(i,nblocks);
+  std::map<std::string,std::string> blocks;
+  for(std::size_t k=0; k<nblocks; k++) {
+    std::string label, data;
+    checkpoint::read(i,label);
+    checkpoint::read(i,data);
+    blocks[label]=std::move(data);
+  }
+  log<<"Reading checkpoint "<<path<<" written at step "<<cptstep<<"\n";
+  for(const auto & p : actionSet) {
+    auto b=blocks.find(p->getLabel());
+    if(b==blocks.end()) continue;
+    std::istringstream iss(b->second,std::ios::binary);
+    p->readCheckpoint(iss);
+    log<<"  restored state of action "<<p->getLabel()<<"\n";
+    blocks.erase(b);
+  }
+  for(const auto & b : blocks) log<<"  WARNING: action "<<b.first<<" found in checkpoint is not present in the input\n";
+}
+
 void PlumedMain::setEnergyValue( const std::string& name ) {
   name_of_energy = name;
 }
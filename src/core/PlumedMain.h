@@ -53,6 +53,7 @@ namespace PLMD {
 
 
 
+class Action;
 class ActionAtomistic;
 class ActionPilot;
 class ActionForInterface;
@@ -62,6 +63,8 @@ class ActionSet;
 class DLLoader;
 class Communicator;
 class Stopwatch;
+class Tracer;
+class PerfCounters;
 class Citations;
 class ExchangePatterns;
 class FileBase;
@@ -160,6 +163,16 @@ private:
   ForwardDecl<Stopwatch> stopwatch_fwd;
   Stopwatch& stopwatch=*stopwatch_fwd;
 
+/// Forward declaration.
+  ForwardDecl<Tracer> tracer_fwd;
+/// Timeline of the events of a window of steps, see PLUMED_TRACE
+  Tracer& tracer=*tracer_fwd;
+
+/// Forward declaration.
+  ForwardDecl<PerfCounters> perfCounters_fwd;
+/// Hardware counters of each phase and action, see PLUMED_PERF_COUNTERS
+  PerfCounters& perfCounters=*perfCounters_fwd;
+
 /// Forward declaration.
   ForwardDecl<Citations> citations_fwd;
 /// tools/Citations.holder
@@ -205,6 +218,35 @@ private:
 /// This computed by accumulating the change in external potentials.
   double work=0.0;
 
+/// Set to true (with PLUMED_CONCURRENT_ACTIONS) to calculate actions that do not depend on each other at the same time.
+/// Setting the environment variable to any value switches this on.  With PLUMED_NUM_THREADS larger than one the actions
+/// in each group found by setupConcurrentGroups() are calculated (and their forces applied) by different threads.
+/// With more than one MPI process the reductions of these actions are done together instead.
+/// The groups are only used after the first step and not when detailed timers or hardware counters are active.
+/// Actions without values and actions that modify the positions (see ActionAtomistic::modifiesGlobalPositions())
+/// are barriers: they are calculated alone after all the actions that precede them in the input.
+  bool concurrentActions=false;
+
+/// Number of actions in the action set when the groups of concurrent actions were last set up
+  unsigned nactionsInGroups=0;
+
+/// Groups of actions that can be calculated at the same time in the forward loop
+  std::vector<std::vector<Action*> > calculateGroups;
+
+/// Groups of actions that can apply their forces at the same time in the backward loop
+  std::vector<std::vector<Action*> > applyGroups;
+
+/// The buffers of the actions in a group that are summed over the MPI processes together
+  std::vector<double> reductionBuffer;
+
+/// Set up the groups of actions that can be calculated and applied at the same time
+  void setupConcurrentGroups();
+
+/// Calculate a single action in the forward loop and accumulate its bias and work
+  void calculateAction( Action* p, const int& iaction, const bool& firststep, double& mybias, double& mywork );
+/// Retrieve the bias and set the gradients after an action has been calculated
+  void finishCalculation( Action* p, const bool& firststep, double& mybias, double& mywork );
+
 /// Forward declaration.
   ForwardDecl<ExchangePatterns> exchangePatterns_fwd;
 /// Class of possible exchange patterns, used for BIASEXCHANGE but also for future parallel tempering
@@ -219,6 +261,10 @@ private:
 /// Flag for checkpointig
   bool doCheckPoint=false;
 
+/// File where the state of the actions is written on checkpointing steps.
+/// Empty if no binary checkpoint is requested
+  std::string checkpointFile;
+
 /// A string that holds the name of the action that gets the energy from the MD
 /// code.  Set empty if energy is not used.
   std::string name_of_energy{""};
@@ -233,6 +279,19 @@ private:
   bool doParseOnly=false;
 
 private:
+/// A command resolved in advance with cmd("getCommandHandle")
+  struct CommandHandle {
+/// Index of the command in the interpreter
+    int iword=-1;
+/// The full command, used in the error messages
+    std::string key;
+/// The command split in words
+    std::vector<std::string> words;
+  };
+/// The commands resolved so far, indexed by their handle
+  std::vector<CommandHandle> commandHandles;
+/// Execute a command that has been already split in words and looked up
+  void cmdExecute(int iword,std::string_view key,const std::string_view* words,unsigned nw,const TypesafePtr & val);
 /// Forward declaration.
   ForwardDecl<TypesafePtr> stopFlag_fwd;
 public:
@@ -263,6 +322,37 @@ public:
 /// Flag to switch on detailed timers
   bool detailedTimers=false;
 
+/// Time in nanoseconds spent by each action during the last step,
+/// stored as calculate/apply pairs in the order of actionSet.
+/// Only filled when detailedTimers is set
+  std::vector<long long int> actionTimings;
+
+/// Name of the stopwatch used for an action when detailedTimers is set
+  std::string detailedTimerName(const std::string & prefix,int iaction,const Action* p) const;
+
+/// Largest number of bytes seen for each action (in the order of actionSet) and in total
+  std::vector<std::size_t> memoryHighWater;
+  std::size_t totalMemoryHighWater=0;
+/// The high-water mark is sampled every memoryHighWaterStride steps
+  static constexpr long long int memoryHighWaterStride=100;
+/// Sample the memory used by the actions and update the high-water mark.
+/// Returns the total number of bytes currently used.
+  std::size_t updateMemoryHighWater();
+/// Write to the log a table with the memory used by each action
+  void reportMemoryUsage(const std::string & title);
+
+/// Collect hardware counters, set with cmd("setPerfCounters") or PLUMED_PERF_COUNTERS
+  bool usePerfCounters=false;
+
+/// Number of steps between the reports of the load balance across processes (0 means never)
+  long long int loadBalanceStride=0;
+/// Number of steps since the last load balance report
+  long long int loadBalanceSteps=0;
+/// Write to the log the time spent by each action computing and waiting in collective
+/// communications, with its minimum, mean and maximum over the processes.
+/// Must be called by all the processes
+  void reportLoadBalance();
+
 /// GpuDevice Identifier
   int gpuDeviceId=-1;
 
@@ -299,6 +389,14 @@ public:
    Notice that this interface should always keep retro-compatibility
   */
   void cmd(std::string_view key,const TypesafePtr & val) override;
+  /**
+   Execute a command that has been resolved in advance.
+   \param handle The handle returned by cmd("getCommandHandle"), for instance cmd("getCommandHandle setPositions").
+   \param val The argument of the command to be executed.
+   It is equivalent to cmd() with the resolved command, but the command string is not parsed at every call.
+   It is called as plumed_cmd_handle() or as PLMD::Plumed::cmd() with a PLMD::Plumed::CommandHandle
+  */
+  void cmdHandle(int handle,const TypesafePtr & val);
   ~PlumedMain();
   /**
     Turn on parse only mode to deactivate restart in all actions.
@@ -433,8 +531,8 @@ public:
   long long int getStep()const {return step;}
 /// Stop the run
   void exit(int c=0);
-/// Load a shared library
-  void load(const std::string&);
+/// Load a shared library.  Libraries compiled from cpp files are stored in and reused from the cache directory if one is given
+  void load(const std::string&,const std::string& cache="");
 /// Get the suffix string
   const std::string & getSuffix()const;
 /// Set the suffix string
@@ -455,6 +553,8 @@ public:
   void eraseFile(FileBase&);
 /// Flush all files
   void fflush();
+/// Get the paths of the files that are currently open for writing
+  std::vector<std::string> getOutputFilePaths()const;
 /// Check if restarting
   bool getRestart()const;
 /// Set restart flag
@@ -511,6 +611,10 @@ public:
 /// Transfer information from input MD code
   void writeBinary(std::ostream&)const;
   void readBinary(std::istream&);
+/// Write the state of all the actions on a binary checkpoint
+  void writeCheckpoint(const std::string& fname)const;
+/// Restore the state of the actions from a binary checkpoint
+  void readCheckpoint(const std::string& fname);
 /// Used to set the name of the action that holds the energy
   void setEnergyValue( const std::string& name );
 /// Get the real preicision
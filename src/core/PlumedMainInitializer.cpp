@@ -386,6 +386,43 @@ extern "C" {
   }
 }
 
+/// Execute n commands resolved with getCommandHandle, with the pointers in safe
+static void cmd_handles(void*plumed,int n,const int*handles,const plumed_safeptr_x*safe) {
+  plumed_massert(plumed,"trying to use a plumed object which is not initialized");
+  auto p=static_cast<PLMD::PlumedMain*>(plumed);
+  for(int i=0; i<n; i++) {
+    auto s=safe[i];
+    p->cmdHandle(handles[i],PLMD::TypesafePtr::fromSafePtr(&s));
+  }
+}
+
+extern "C" {
+  static void plumed_plumedmain_cmd_handles_safe_nothrow(void*plumed,int n,const int*handles,const plumed_safeptr_x*safe,plumed_nothrow_handler_x nothrow) {
+// As in plumed_plumedmain_cmd_safe_nothrow, a null handler means that exceptions are not translated
+    if(!nothrow.handler) {
+      cmd_handles(plumed,n,handles,safe);
+      return;
+    }
+    auto p=static_cast<PLMD::PlumedMain*>(plumed);
+    try {
+      cmd_handles(plumed,n,handles,safe);
+    } catch(...) {
+      if(p->getNestedExceptions()) {
+        translate_nested(nothrow);
+      } else {
+        auto msg=PLMD::Tools::concatenateExceptionMessages();
+        translate_current(nothrow,nullptr,msg.c_str());
+      }
+    }
+  }
+}
+
+extern "C" {
+  static void plumed_plumedmain_cmd_handle_safe_nothrow(void*plumed,int handle,plumed_safeptr_x safe,plumed_nothrow_handler_x nothrow) {
+    plumed_plumedmain_cmd_handles_safe_nothrow(plumed,1,&handle,&safe,nothrow);
+  }
+}
+
 extern "C" void plumed_plumedmain_finalize(void*plumed) {
   plumed_massert(plumed,"trying to deallocate a plumed object which is not initialized");
 // I think it is not possible to replace this delete with a smart pointer
@@ -395,19 +432,21 @@ extern "C" void plumed_plumedmain_finalize(void*plumed) {
 
 // values here should be consistent with those in plumed_symbol_table_init !!!!
 plumed_symbol_table_type_x plumed_symbol_table= {
-  4,
+  5,
   {plumed_plumedmain_create,plumed_plumedmain_cmd,plumed_plumedmain_finalize},
   plumed_plumedmain_cmd_nothrow,
   plumed_plumedmain_cmd_safe,
   plumed_plumedmain_cmd_safe_nothrow,
   plumed_plumedmain_create_reference,
   plumed_plumedmain_delete_reference,
-  plumed_plumedmain_use_count
+  plumed_plumedmain_use_count,
+  plumed_plumedmain_cmd_handle_safe_nothrow,
+  plumed_plumedmain_cmd_handles_safe_nothrow
 };
 
 // values here should be consistent with those above !!!!
 extern "C" void plumed_symbol_table_init() {
-  plumed_symbol_table.version=4;
+  plumed_symbol_table.version=5;
   plumed_symbol_table.functions.create=plumed_plumedmain_create;
   plumed_symbol_table.functions.cmd=plumed_plumedmain_cmd;
   plumed_symbol_table.functions.finalize=plumed_plumedmain_finalize;
@@ -417,6 +456,8 @@ extern "C" void plumed_symbol_table_init() {
   plumed_symbol_table.create_reference=plumed_plumedmain_create_reference;
   plumed_symbol_table.delete_reference=plumed_plumedmain_delete_reference;
   plumed_symbol_table.use_count=plumed_plumedmain_use_count;
+  plumed_symbol_table.cmd_handle_safe_nothrow=plumed_plumedmain_cmd_handle_safe_nothrow;
+  plumed_symbol_table.cmd_handles_safe_nothrow=plumed_plumedmain_cmd_handles_safe_nothrow;
 }
 
 namespace PLMD {
@@ -66,6 +66,8 @@ typedef struct {
   unsigned (*create_reference)(void*plumed);
   unsigned (*delete_reference)(void*plumed);
   unsigned (*use_count)(void*plumed);
+  void (*cmd_handle_safe_nothrow)(void*plumed,int handle,plumed_safeptr_x,plumed_nothrow_handler_x);
+  void (*cmd_handles_safe_nothrow)(void*plumed,int n,const int*handles,const plumed_safeptr_x*,plumed_nothrow_handler_x);
 } plumed_symbol_table_type_x;
 
 
@@ -28,7 +28,9 @@
 #include "tools/Exception.h"
 #include "tools/OpenMP.h"
 #include "tools/OFile.h"
+#include "tools/Tools.h"
 #include "PlumedMain.h"
+#include <algorithm>
 
 namespace PLMD {
 
@@ -104,7 +106,7 @@ Value::Value(ActionWithValue* av, const std::string& name, const bool withderiv,
   derivativeIsZeroWhenValueIsZero(false)
 {
   if( action ) {
-    if( action->getName()=="ACCUMULATE" || action->getName()=="COLLECT" ) valtype=average;
+    if( action->getName()=="ACCUMULATE" || action->getName()=="COLLECT" || action->getName()=="BINNED_WHAM" ) valtype=average;
   }
   if( action ) storedata=action->getName()=="PUT" || valtype==average;
   if( ss.size() && withderiv ) storedata=true;
@@ -119,8 +121,12 @@ void Value::setValType( const std::string& vtype ) {
   else plumed_merror("invalid valtype " + vtype );
 }
 
+std::size_t Value::getMemoryUsage() const {
+  return Tools::getMemoryUsage(data)+Tools::getMemoryUsage(inputForce)+Tools::getMemoryUsage(shape)+Tools::getMemoryUsage(matrix_bookeeping);
+}
+
 void Value::setShape( const std::vector<unsigned>&ss ) {
-  std::size_t tot=1; shape.resize( ss.size() );
+  std::size_t tot=1; shape.resize( ss.size() ); sparseDerivatives=false;
   for(unsigned i=0; i<shape.size(); ++i) { tot = tot*ss[i]; shape[i]=ss[i]; }
 
   if( shape.size()>0 && hasDeriv ) {
@@ -162,6 +168,16 @@ bool Value::applyForce(std::vector<double>& forces ) const {
   return true;
 }
 
+void Value::setSparseDerivatives( const double* der ) {
+  plumed_dbg_assert( hasDeriv && shape.size()==0 );
+  const unsigned nder=data.size()-1; activeDerivatives.clear();
+  for(unsigned j=0; j<nder; ++j) {
+    if( der[j]!=0 ) { data[1+j]=der[j]; activeDerivatives.push_back(j); }
+  }
+  // When most of the derivatives are not zero going through the whole array is faster
+  sparseDerivatives = 4*activeDerivatives.size()<nder;
+}
+
 void Value::setNotPeriodic() {
   min=0; max=0; periodicity=notperiodic;
 }
@@ -353,6 +369,20 @@ void Value::retrieveEdgeList( unsigned& nedge, std::vector<std::pair<unsigned,un
   }
 }
 
+void Value::retrieveCSR( std::vector<unsigned>& row_starts, std::vector<unsigned>& cols, std::vector<double>& elems ) const {
+  plumed_dbg_assert( shape.size()==2 && !hasDeriv && ncols>0 );
+  row_starts.resize( shape[0]+1 ); row_starts[0]=0;
+  for(unsigned i=0; i<shape[0]; ++i) row_starts[i+1] = row_starts[i] + getRowLength(i);
+  cols.resize( row_starts[shape[0]] ); elems.resize( row_starts[shape[0]] );
+  std::vector<std::pair<unsigned,double> > row;
+  for(unsigned i=0; i<shape[0]; ++i) {
+    unsigned ncol = getRowLength(i); row.resize( ncol );
+    for(unsigned j=0; j<ncol; ++j) { row[j].first = getRowIndex(i,j); row[j].second = data[i*ncols+j]; }
+    std::sort( row.begin(), row.end() );
+    for(unsigned j=0; j<ncol; ++j) { cols[row_starts[i]+j] = row[j].first; elems[row_starts[i]+j] = row[j].second; }
+  }
+}
+
 void Value::readBinary(std::istream&i) {
   i.read(reinterpret_cast<char*>(&data[0]),data.size()*sizeof(double));
 }
@@ -85,6 +85,11 @@ private:
   std::vector<unsigned> shape;
 /// Does this quanity have derivatives
   bool hasDeriv;
+/// For scalars with many derivatives, the indices of the derivatives that are not zero.
+/// This list is only used when sparseDerivatives is true. Any change to the derivatives
+/// that does not go through setSparseDerivatives makes the derivatives dense again
+  std::vector<unsigned> activeDerivatives;
+  bool sparseDerivatives=false;
 /// Variables for storing data
   unsigned bufstart, streampos, matpos, ngrid_der, ncols, book_start;
 /// If we are storing a matrix is it symmetric?
@@ -113,6 +118,8 @@ public:
   Value(ActionWithValue* av, const std::string& name, const bool withderiv,const std::vector<unsigned>&ss=std::vector<unsigned>());
 /// Set the shape of the Value
   void setShape( const std::vector<unsigned>&ss );
+/// Number of bytes allocated to store the data and the forces of this value
+  std::size_t getMemoryUsage() const ;
 /// Set the value of the function
   void set(double);
 /// Set the value of the stored data
@@ -153,6 +160,13 @@ public:
   void setDerivative(unsigned i, double d);
 /// Get the derivative with respect to component n
   double getDerivative(const unsigned n) const;
+/// Set the derivatives of a scalar from an array with getNumberOfDerivatives() elements. The derivatives should have been cleared.
+/// Only the elements that are not zero are copied and, if they are few, they are remembered so that the
+/// derivatives can be cleared and used without going through the whole array
+  void setSparseDerivatives( const double* der );
+/// True if the list returned by getActiveDerivatives contains all the derivatives that are not zero
+  bool hasSparseDerivatives() const { return sparseDerivatives; }
+  const std::vector<unsigned>& getActiveDerivatives() const { return activeDerivatives; }
 /// Clear the input force on the variable
   void clearInputForce();
 /// Special method for clearing forces on variables used by DataPassingObject
@@ -236,6 +250,8 @@ public:
   bool isSymmetric() const ;
 /// Retrieve the non-zero edges in a matrix
   void retrieveEdgeList( unsigned& nedge, std::vector<std::pair<unsigned,unsigned> >& active, std::vector<double>& elems );
+/// Retrieve the stored elements of a matrix in compressed sparse row format with the columns in each row sorted
+  void retrieveCSR( std::vector<unsigned>& row_starts, std::vector<unsigned>& cols, std::vector<double>& elems ) const ;
 /// Get the number of derivatives that the grid has
   unsigned getNumberOfGridDerivatives() const ;
 /// get the derivative of a grid at a point n with resepct to argument j
@@ -309,18 +325,19 @@ inline
 void Value::resizeDerivatives(int n) {
   if( shape.size()>0 ) return;
   if(hasDeriv) data.resize(1+n);
+  sparseDerivatives=false;
 }
 
 inline
 void Value::addDerivative(unsigned i,double d) {
   plumed_dbg_massert(i<getNumberOfDerivatives(),"derivative is out of bounds");
-  data[1+i]+=d;
+  data[1+i]+=d; sparseDerivatives=false;
 }
 
 inline
 void Value::setDerivative(unsigned i, double d) {
   plumed_dbg_massert(i<getNumberOfDerivatives(),"derivative is out of bounds");
-  data[1+i]=d;
+  data[1+i]=d; sparseDerivatives=false;
 }
 
 inline
@@ -340,7 +357,10 @@ void Value::clearDerivatives( const bool force ) {
   if( !force && (valtype==constant || valtype==average) ) return;
 
   value_set=false;
-  if( data.size()>1 ) std::fill(data.begin()+1, data.end(), 0);
+  if( sparseDerivatives ) {
+    for(const auto & j : activeDerivatives) data[1+j]=0;
+    sparseDerivatives=false;
+  } else if( data.size()>1 ) std::fill(data.begin()+1, data.end(), 0);
 }
 
 inline
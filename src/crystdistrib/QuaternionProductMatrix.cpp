@@ -37,11 +37,13 @@ namespace crystdistrib {
 class QuaternionProductMatrix : public ActionWithMatrix {
 private:
   unsigned nderivatives;
+/// Are we only computing the elements that are in the sparsity pattern of a mask matrix
+  bool hasmask;
 public:
   static void registerKeywords( Keywords& keys );
   explicit QuaternionProductMatrix(const ActionOptions&);
   unsigned getNumberOfDerivatives();
-  unsigned getNumberOfColumns() const override { return getConstPntrToComponent(0)->getShape()[1]; }
+  unsigned getNumberOfColumns() const override ;
   void setupForTask( const unsigned& task_index, std::vector<unsigned>& indices, MultiValue& myvals ) const ;
   void performTask( const std::string& controller, const unsigned& index1, const unsigned& index2, MultiValue& myvals ) const override;
   void runEndOfRowJobs( const unsigned& ival, const std::vector<unsigned> & indices, MultiValue& myvals ) const override ;
@@ -52,6 +54,7 @@ PLUMED_REGISTER_ACTION(QuaternionProductMatrix,"QUATERNION_PRODUCT_MATRIX")
 void QuaternionProductMatrix::registerKeywords( Keywords& keys ) {
   ActionWithMatrix::registerKeywords(keys);
   keys.addInputKeyword("compulsory","ARG","vector","the labels of the quaternion vectors that you are outer product of");
+  keys.addInputKeyword("optional","MASK","matrix","a matrix with the same shape as the output.  If this is used the products are only computed for the pairs of molecules that have an element in this matrix (e.g. the pairs that are within the cutoff of a contact matrix)");
   keys.addOutputComponent("w","default","matrix","the real component of quaternion");
   keys.addOutputComponent("i","default","matrix","the i component of the quaternion");
   keys.addOutputComponent("j","default","matrix","the j component of the quaternion");
@@ -60,7 +63,8 @@ void QuaternionProductMatrix::registerKeywords( Keywords& keys ) {
 
 QuaternionProductMatrix::QuaternionProductMatrix(const ActionOptions&ao):
   Action(ao),
-  ActionWithMatrix(ao)
+  ActionWithMatrix(ao),
+  hasmask(false)
 {
   if( getNumberOfArguments()!=8 ) error("should be eight arguments to this action.  Four quaternions for each set of atoms.  You can repeat actions");
   unsigned nquat = getPntrToArgument(0)->getNumberOfValues();
@@ -75,6 +79,15 @@ QuaternionProductMatrix::QuaternionProductMatrix(const ActionOptions&ao):
     if( (i==3 || i==7) && mylab.substr(dot+1)!="k" ) error("quaternion arguments are in wrong order");
   }
   std::vector<unsigned> shape(2); shape[0]=getPntrToArgument(0)->getShape()[0]; shape[1]=getPntrToArgument(4)->getShape()[0];
+  std::vector<Value*> mask; parseArgumentList("MASK",mask);
+  if( mask.size()>1 ) error("should only be one input for mask");
+  if( mask.size()==1 ) {
+    if( mask[0]->getRank()!=2 || mask[0]->getShape()[0]!=shape[0] || mask[0]->getShape()[1]!=shape[1] ) error("mask should be a matrix with the same shape as the output");
+    if( !dynamic_cast<ActionWithMatrix*>( mask[0]->getPntrToAction() ) ) error("mask should be calculated by an action that computes a matrix");
+    log.printf("  only computing products for pairs that have an element in matrix %s \n", mask[0]->getName().c_str() );
+    hasmask=true; std::vector<Value*> args( getArguments() ); args.push_back( mask[0] ); requestArguments( args );
+    mask[0]->buildDataStore();
+  }
   addComponent( "w", shape ); componentIsNotPeriodic("w");
   addComponent( "i", shape ); componentIsNotPeriodic("i");
   addComponent( "j", shape ); componentIsNotPeriodic("j");
@@ -86,8 +99,22 @@ unsigned QuaternionProductMatrix::getNumberOfDerivatives() {
   return nderivatives;
 }
 
+unsigned QuaternionProductMatrix::getNumberOfColumns() const {
+  if( !hasmask ) return getConstPntrToComponent(0)->getShape()[1];
+  const ActionWithMatrix* am=dynamic_cast<const ActionWithMatrix*>( getPntrToArgument(8)->getPntrToAction() );
+  plumed_assert( am ); return am->getNumberOfColumns();
+}
+
 void QuaternionProductMatrix::setupForTask( const unsigned& task_index, std::vector<unsigned>& indices, MultiValue& myvals ) const {
   unsigned start_n = getPntrToArgument(0)->getShape()[0], size_v = getPntrToArgument(4)->getShape()[0];
+  if( hasmask ) {
+    // Only the elements that are stored for this row of the mask are computed so the cost and storage are linear in the number of molecules
+    const Value* maskval=getPntrToArgument(8); unsigned nrow=maskval->getRowLength( task_index );
+    if( indices.size()!=nrow+1 ) indices.resize( nrow+1 );
+    for(unsigned i=0; i<nrow; ++i) indices[i+1] = start_n + maskval->getRowIndex( task_index, i );
+    myvals.setSplitIndex( nrow + 1 );
+    return;
+  }
   if( indices.size()!=size_v+1 ) indices.resize( size_v+1 );
   for(unsigned i=0; i<size_v; ++i) indices[i+1] = start_n + i;
   myvals.setSplitIndex( size_v + 1 );
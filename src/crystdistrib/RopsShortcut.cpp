@@ -123,7 +123,7 @@ RopsShortcut::RopsShortcut(const ActionOptions&ao):
 
   if( specA.length()==0 ) {
     std::string quatstr; parse("QUATERNIONS",quatstr);
-    readInputLine( getShortcutLabel() + "_quatprod: QUATERNION_PRODUCT_MATRIX ARG=" + quatstr + ".*," + quatstr + ".*" );
+    readInputLine( getShortcutLabel() + "_quatprod: QUATERNION_PRODUCT_MATRIX ARG=" + quatstr + ".*," + quatstr + ".*" + " MASK=" + getShortcutLabel() + "_cmat" );
   }  else {
     plumed_error();
   }
@@ -22,6 +22,7 @@
 #include "core/ActionShortcut.h"
 #include "core/ActionRegister.h"
 #include "core/ActionWithValue.h"
+#include "core/ActionWithArguments.h"
 #include "core/ActionPilot.h"
 #include "core/ActionAtomistic.h"
 #include "core/PlumedMain.h"
@@ -92,6 +93,31 @@ pca: PCA USE_OUTPUT_DATA_FROM=ff METRIC=EUCLIDEAN NLOW_DIM=2
 OUTPUT_PCA_PROJECTION USE_OUTPUT_DATA_FROM=pca STRIDE=100 FILE=PCA-comp.pdb
 \endplumedfile
 
+If you do not need the projections of the stored frames on the principal components you can avoid storing the trajectory by using the output of
+an \ref ACCUMULATE_COVARIANCE action as input.  The mean and covariance are then accumulated as the simulation proceeds and the PCA action outputs the
+projection of the instantaneous values of the arguments on the principal components.  The input below computes the principal components from the six distances
+that were used in the previous example and outputs them every 1000 steps.
+
+\plumedfile
+d1: DISTANCE ATOMS=1,2
+d2: DISTANCE ATOMS=1,3
+d3: DISTANCE ATOMS=1,4
+d4: DISTANCE ATOMS=2,3
+d5: DISTANCE ATOMS=2,4
+d6: DISTANCE ATOMS=3,4
+cov: ACCUMULATE_COVARIANCE ARG=d1,d2,d3,d4,d5,d6 STRIDE=5
+pca: PCA ARG=cov NLOW_DIM=2 FILE=PCA-comp.pdb STRIDE=1000
+\endplumedfile
+
+When there are many input coordinates and only a few principal components are required the RANDOMIZED flag can be used.  The principal components are then found
+using \ref RANDOMIZED_SVD on the matrix of weighted displacements from the mean, so the covariance matrix is never computed or diagonalized.  The input
+below finds the first ten principal components of the positions of 3000 atoms.
+
+\plumedfile
+ff: COLLECT_FRAMES ATOMS=1-3000 STRIDE=10
+pca: PCA ARG=ff NLOW_DIM=10 RANDOMIZED OVERSAMPLE=20 FILE=PCA-comp.pdb
+\endplumedfile
+
 */
 //+ENDPLUMEDOC
 
@@ -99,6 +125,9 @@ namespace PLMD {
 namespace dimred {
 
 class PCA : public ActionShortcut {
+private:
+/// Create the actions to do PCA using the mean and covariance from an ACCUMULATE_COVARIANCE action
+  void createOnlinePCA( ActionWithArguments* acc );
 public:
   static void registerKeywords( Keywords& keys );
   PCA( const ActionOptions& );
@@ -108,15 +137,19 @@ PLUMED_REGISTER_ACTION(PCA,"PCA")
 
 void PCA::registerKeywords( Keywords& keys ) {
   ActionShortcut::registerKeywords( keys );
-  keys.add("compulsory","ARG","the arguments that you would like to make the histogram for");
+  keys.add("compulsory","ARG","the label of the COLLECT_FRAMES or ACCUMULATE_COVARIANCE action that holds the data to analyze");
   keys.add("compulsory","NLOW_DIM","number of low-dimensional coordinates required");
   keys.add("compulsory","STRIDE","0","the frequency with which to perform this analysis");
   keys.add("optional","FILE","the file on which to output the low dimensional coordinates");
   keys.add("optional","FMT","the format to use when outputting the low dimensional coordinates");
-  keys.setValueDescription("matrix","the projections of the input coordinates on the PCA components that were found from the covariance matrix");
+  keys.addFlag("RANDOMIZED",false,"find the principal components with a randomized singular value decomposition of the data rather than by diagonalizing the covariance matrix");
+  keys.add("compulsory","OVERSAMPLE","10","the number of additional random vectors that are used when RANDOMIZED is present");
+  keys.add("compulsory","NITER","2","the number of power iterations that are used when RANDOMIZED is present");
+  keys.setValueDescription("matrix/vector","the projections of the input coordinates on the PCA components that were found from the covariance matrix.  This is a vector with the projection of the instantaneous values of the arguments if the input is an ACCUMULATE_COVARIANCE action");
   keys.needsAction("LOGSUMEXP"); keys.needsAction("TRANSPOSE"); keys.needsAction("MATRIX_VECTOR_PRODUCT");
   keys.needsAction("CONSTANT"); keys.needsAction("COLLECT"); keys.needsAction("OUTER_PRODUCT"); keys.needsAction("CUSTOM");
-  keys.needsAction("MATRIX_PRODUCT"); keys.needsAction("DIAGONALIZE"); keys.needsAction("VSTACK"); keys.needsAction("DUMPPDB");
+  keys.needsAction("MATRIX_PRODUCT"); keys.needsAction("DIAGONALIZE"); keys.needsAction("RANDOMIZED_SVD"); keys.needsAction("VSTACK"); keys.needsAction("DUMPPDB");
+  keys.needsAction("CONCATENATE");
 }
 
 
@@ -126,8 +159,10 @@ PCA::PCA(const ActionOptions&ao):
 {
   // Find the argument name
   std::string argn; parse("ARG",argn);
+  ActionWithArguments* acc = plumed.getActionSet().selectWithLabel<ActionWithArguments*>( argn );
+  if( acc && acc->getName()=="ACCUMULATE_COVARIANCE" ) { createOnlinePCA( acc ); return; }
   ActionShortcut* as = plumed.getActionSet().getShortcutActionWithLabel( argn );
-  if( !as || as->getName()!="COLLECT_FRAMES" ) error("found no COLLECT_FRAMES action with label " + argn );
+  if( !as || as->getName()!="COLLECT_FRAMES" ) error("found no COLLECT_FRAMES or ACCUMULATE_COVARIANCE action with label " + argn );
   // Get the final weights using the logsumexp trick
   readInputLine( getShortcutLabel() + "_weights: LOGSUMEXP ARG=" + argn + "_logweights");
   // Now transpose the collected frames
@@ -146,14 +181,21 @@ PCA::PCA(const ActionOptions&ao):
   // And compute the data substract the mean
   readInputLine( getShortcutLabel() + "_diff: CUSTOM ARG=" + argn + "_data," + getShortcutLabel() + "_averages FUNC=(x-y) PERIODIC=NO");
   readInputLine( getShortcutLabel() + "_wdiff: CUSTOM ARG=" + getShortcutLabel() + "_wmat," + getShortcutLabel() + "_diff FUNC=sqrt(x)*y PERIODIC=NO");
-  // And the covariance
-  readInputLine( getShortcutLabel() + "_wdiffT: TRANSPOSE ARG=" + getShortcutLabel() + "_wdiff");
-  readInputLine( getShortcutLabel() + "_covar: MATRIX_PRODUCT ARG=" + getShortcutLabel() + "_wdiffT," + getShortcutLabel() + "_wdiff");
   // Read the dimensionality of the low dimensional space
   unsigned ndim; parse("NLOW_DIM",ndim); std::string vecstr="1";
   if( ndim<=0 || ndim>nones ) error("cannot generate projection in space of dimension higher than input coordinates");
-  for(unsigned i=1; i<ndim; ++i) { std::string num; Tools::convert( i+1, num ); vecstr += "," + num; }
-  readInputLine( getShortcutLabel() + "_eig: DIAGONALIZE ARG=" + getShortcutLabel() + "_covar VECTORS=" + vecstr );
+  bool randomized; parseFlag("RANDOMIZED",randomized);
+  if( randomized ) {
+    // Get the principal components from the weighted displacements without computing the covariance
+    std::string nlow, oversample, niter; Tools::convert( ndim, nlow ); parse("OVERSAMPLE",oversample); parse("NITER",niter);
+    readInputLine( getShortcutLabel() + "_eig: RANDOMIZED_SVD ARG=" + getShortcutLabel() + "_wdiff RANK=" + nlow + " OVERSAMPLE=" + oversample + " NITER=" + niter );
+  } else {
+    // And the covariance
+    readInputLine( getShortcutLabel() + "_wdiffT: TRANSPOSE ARG=" + getShortcutLabel() + "_wdiff");
+    readInputLine( getShortcutLabel() + "_covar: MATRIX_PRODUCT ARG=" + getShortcutLabel() + "_wdiffT," + getShortcutLabel() + "_wdiff");
+    for(unsigned i=1; i<ndim; ++i) { std::string num; Tools::convert( i+1, num ); vecstr += "," + num; }
+    readInputLine( getShortcutLabel() + "_eig: DIAGONALIZE ARG=" + getShortcutLabel() + "_covar VECTORS=" + vecstr );
+  }
   // Now create a matrix to hold the output data
   std::string outd = "ARG=" + getShortcutLabel() + "_mean";
   for(unsigned i=0; i<ndim; ++i) { std::string num; Tools::convert( i+1, num ); outd += "," + getShortcutLabel() + "_eig.vecs-" + num; }
@@ -180,5 +222,45 @@ PCA::PCA(const ActionOptions&ao):
   readInputLine( getShortcutLabel() + ": MATRIX_PRODUCT ARG=" + getShortcutLabel() + "_diff," + getShortcutLabel() + "_eigv");
 }
 
+void PCA::createOnlinePCA( ActionWithArguments* acc ) {
+  std::string argn = acc->getLabel();
+  ActionWithValue* av = dynamic_cast<ActionWithValue*>( acc ); plumed_assert( av );
+  unsigned nones = (av->copyOutput(0))->getShape()[0];
+  // Get the names of the arguments that were accumulated.  The last argument may be the log weights so we stop when we have enough data
+  std::vector<std::string> argnames; std::string argstr; unsigned ndata=0;
+  for(unsigned i=0; i<acc->getNumberOfArguments() && ndata<nones; ++i) {
+    Value* myarg = acc->getPntrToArgument(i); ndata += myarg->getNumberOfValues();
+    if( i==0 ) argstr = myarg->getName(); else argstr += "," + myarg->getName();
+    if( myarg->getRank()==0 ) { argnames.push_back( myarg->getName() ); continue; }
+    for(unsigned j=0; j<myarg->getNumberOfValues(); ++j) { std::string num; Tools::convert( j+1, num ); argnames.push_back( myarg->getName() + "-" + num ); }
+  }
+  // Read the dimensionality of the low dimensional space
+  unsigned ndim; parse("NLOW_DIM",ndim); std::string vecstr="1";
+  if( ndim<=0 || ndim>nones ) error("cannot generate projection in space of dimension higher than input coordinates");
+  bool randomized; parseFlag("RANDOMIZED",randomized);
+  if( randomized ) error("RANDOMIZED needs the collected frames and cannot be used with the output of ACCUMULATE_COVARIANCE");
+  for(unsigned i=1; i<ndim; ++i) { std::string num; Tools::convert( i+1, num ); vecstr += "," + num; }
+  readInputLine( getShortcutLabel() + "_eig: DIAGONALIZE ARG=" + argn + ".covar VECTORS=" + vecstr );
+  // Output the mean and the eigenvectors
+  std::string outd = "ARG=" + argn + ".mean";
+  for(unsigned i=0; i<ndim; ++i) { std::string num; Tools::convert( i+1, num ); outd += "," + getShortcutLabel() + "_eig.vecs-" + num; }
+  readInputLine( getShortcutLabel() + "_pcaT: VSTACK " + outd );
+  readInputLine( getShortcutLabel() + "_pca: TRANSPOSE ARG=" + getShortcutLabel() + "_pcaT");
+  std::string filename, pstride; parse("STRIDE",pstride); parse("FILE",filename);
+  if( filename.length()>0 ) {
+    std::string argname_str=argnames[0]; for(unsigned i=1; i<argnames.size(); ++i) argname_str += "," + argnames[i];
+    std::string fmt; parse("FMT",fmt); if( fmt.length()>0 ) fmt=" FMT=" + fmt;
+    readInputLine("DUMPPDB DESCRIPTION=PCA ARG_NAMES=" + argname_str + " ARG=" + getShortcutLabel() + "_pca FILE=" + filename + " STRIDE=" + pstride + fmt );
+  }
+  // And project the instantaneous values of the arguments on the eigenvectors
+  readInputLine( getShortcutLabel() + "_data: CONCATENATE ARG=" + argstr );
+  readInputLine( getShortcutLabel() + "_diff: CUSTOM ARG=" + getShortcutLabel() + "_data," + argn + ".mean FUNC=(x-y) PERIODIC=NO");
+  outd = "ARG=" + getShortcutLabel() + "_eig.vecs-1";
+  for(unsigned i=1; i<ndim; ++i) { std::string num; Tools::convert( i+1, num ); outd += "," + getShortcutLabel() + "_eig.vecs-" + num; }
+  readInputLine( getShortcutLabel() + "_eigv: VSTACK " + outd );
+  readInputLine( getShortcutLabel() + "_eigvT: TRANSPOSE ARG=" + getShortcutLabel() + "_eigv");
+  readInputLine( getShortcutLabel() + ": MATRIX_VECTOR_PRODUCT ARG=" + getShortcutLabel() + "_eigvT," + getShortcutLabel() + "_diff");
+}
+
 }
 }
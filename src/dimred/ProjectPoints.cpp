@@ -25,6 +25,8 @@
 #include "tools/SwitchingFunction.h"
 #include "tools/OpenMP.h"
 #include "tools/Random.h"
+#include <algorithm>
+#include <limits>
 
 namespace PLMD {
 namespace dimred {
@@ -33,6 +35,12 @@ namespace dimred {
 /*
 Find the projection of a point in a low dimensional space by matching the (transformed) distance between it and a series of reference configurations that were input
 
+When all the functions given with FUNC have a D_MAX, the landmarks whose target quantity is equal to one (i.e. the
+high dimensional distance is beyond the D_MAX of the switching function used to compute the targets) only contribute to the stress
+when their projection is closer than D_MAX to the point. Only these landmarks are then searched for, so the stress is not
+summed over all the landmarks at every step of the minimization. With WARM_START the minimization starts from the projection found
+at the previous step instead of from the closest landmark.
+
 \par Examples
 
 */
@@ -44,6 +52,19 @@ private:
   unsigned dimout;
   mutable std::vector<unsigned> rowstart;
   std::vector<SwitchingFunction> switchingFunction;
+/// The largest D_MAX of the switching functions, landmarks are skipped if it is finite
+  double lowdmax;
+/// Landmarks sorted by their first low dimensional coordinate, used to find those that are closer than lowdmax
+  std::vector<unsigned> landmarkOrder;
+  std::vector<double> landmarkFirst;
+/// For each thread the landmarks with a target quantity different from one, which always contribute to the stress
+  mutable std::vector<std::vector<unsigned> > nearLandmarks;
+  mutable std::vector<std::vector<char> > isNear;
+/// Start the minimization from the projections found at the previous step
+  bool warmstart;
+  mutable std::vector<double> lastProjection;
+  mutable std::vector<char> hasLastProjection;
+  double addLandmarkStress( const unsigned& i, const std::vector<double>& pp, std::vector<double>& dtmp, std::vector<double>& der, const unsigned& rstart ) const ;
   ConjugateGradient<ProjectPoints> myminimiser;
   void getProjection( const unsigned& current, std::vector<double>& point ) const ;
 public:
@@ -66,6 +87,7 @@ void ProjectPoints::registerKeywords( Keywords& keys ) {
   keys.add("numbered","FUNC","a function that is applied on the distances between the points in the low dimensional space");
   keys.addInputKeyword("numbered","WEIGHTS","vector","the matrix with the weights of the target quantities");
   keys.add("compulsory","CGTOL","1E-6","the tolerance for the conjugate gradient minimization");
+  keys.addFlag("WARM_START",false,"start the minimization from the projection found at the previous step");
   keys.addOutputComponent("coord","default","scalar/vector","the coordinates of the points in the low dimensional space");
 }
 
@@ -74,6 +96,9 @@ ProjectPoints::ProjectPoints( const ActionOptions& ao ) :
   Action(ao),
   ActionWithVector(ao),
   rowstart(OpenMP::getNumThreads()),
+  lowdmax(0),
+  nearLandmarks(OpenMP::getNumThreads()),
+  isNear(OpenMP::getNumThreads()),
   myminimiser( this )
 {
   dimout = getNumberOfArguments(); unsigned nvals=getPntrToArgument(0)->getNumberOfValues();
@@ -115,6 +140,10 @@ ProjectPoints::ProjectPoints( const ActionOptions& ao ) :
   }
   // Create a list of tasks to perform
   parse("CGTOL",cgtol); log.printf("  tolerance for conjugate gradient algorithm equals %f \n",cgtol);
+  for(const auto & sf : switchingFunction) lowdmax = std::max( lowdmax, sf.get_dmax() );
+  if( lowdmax<std::numeric_limits<double>::max() ) log.printf("  landmarks with unit target quantity are only considered within %f of the projection \n",lowdmax);
+  parseFlag("WARM_START",warmstart);
+  if( warmstart ) log.printf("  minimization starts from the projection at the previous step \n");
   requestArguments( args ); checkRead();
 }
 
@@ -122,32 +151,50 @@ void ProjectPoints::prepare() {
   if( getPntrToComponent(0)->getRank()==0 ) return;
 
   std::vector<unsigned> shape(1); shape[0] = getPntrToArgument(dimout)->getShape()[0];
+  if( warmstart && hasLastProjection.size()!=shape[0] ) { hasLastProjection.assign( shape[0], 0 ); lastProjection.resize( shape[0]*dimout ); }
   for(unsigned i=0; i<dimout; ++i) {
     if( getPntrToComponent(i)->getShape()[0]!=shape[0] ) getPntrToComponent(i)->setShape(shape);
   }
 }
 
-double ProjectPoints::calculateStress( const std::vector<double>& pp, std::vector<double>& der ) {
+double ProjectPoints::addLandmarkStress( const unsigned& i, const std::vector<double>& pp, std::vector<double>& dtmp, std::vector<double>& der, const unsigned& rstart ) const {
   unsigned nmatrices = ( getNumberOfArguments() - dimout ) / 2; double stress=0;
+  // Calculate distance in low dimensional space
+  double dd2 = 0; for(unsigned k=0; k<pp.size(); ++k) { dtmp[k] = pp[k] - getPntrToArgument(k)->get(i); dd2 += dtmp[k]*dtmp[k]; }
+
+  for(unsigned k=0; k<nmatrices; ++k ) {
+    // Now do transformations and calculate differences
+    double df, fd = 1. - switchingFunction[k].calculateSqr( dd2, df );
+    // Get the weight for this connection
+    double weight = getPntrToArgument( dimout + 2*k + 1 )->get( i );
+    // Get the difference for the connection
+    double fdiff = fd - getPntrToArgument( dimout + 2*k )->get( rstart+i );
+    // Calculate derivatives
+    double pref = -2.*weight*fdiff*df; for(unsigned n=0; n<pp.size(); ++n) der[n]+=pref*dtmp[n];
+    // Accumulate the total stress
+    stress += weight*fdiff*fdiff;
+  }
+  return stress;
+}
+
+double ProjectPoints::calculateStress( const std::vector<double>& pp, std::vector<double>& der ) {
+  double stress=0;
 
   unsigned t=OpenMP::getThreadNum();
-  std::vector<double> dtmp( pp.size() ); unsigned nland = getPntrToArgument(0)->getShape()[0];
-  for(unsigned i=0; i<nland; ++i) {
-    // Calculate distance in low dimensional space
-    double dd2 = 0; for(unsigned k=0; k<pp.size(); ++k) { dtmp[k] = pp[k] - getPntrToArgument(k)->get(i); dd2 += dtmp[k]*dtmp[k]; }
-
-    for(unsigned k=0; k<nmatrices; ++k ) {
-      // Now do transformations and calculate differences
-      double df, fd = 1. - switchingFunction[k].calculateSqr( dd2, df );
-      // Get the weight for this connection
-      double weight = getPntrToArgument( dimout + 2*k + 1 )->get( i );
-      // Get the difference for the connection
-      double fdiff = fd - getPntrToArgument( dimout + 2*k )->get( rowstart[t]+i );
-      // Calculate derivatives
-      double pref = -2.*weight*fdiff*df; for(unsigned n=0; n<pp.size(); ++n) der[n]+=pref*dtmp[n];
-      // Accumulate the total stress
-      stress += weight*fdiff*fdiff;
-    }
+  std::vector<double> dtmp( pp.size() );
+  if( landmarkOrder.size()==0 ) {
+    unsigned nland = getPntrToArgument(0)->getShape()[0];
+    for(unsigned i=0; i<nland; ++i) stress += addLandmarkStress( i, pp, dtmp, der, rowstart[t] );
+    return stress;
+  }
+  // The landmarks with a target different from one
+  for(const auto & i : nearLandmarks[t]) stress += addLandmarkStress( i, pp, dtmp, der, rowstart[t] );
+  // The others only contribute if their projection is closer than lowdmax
+  auto first = std::lower_bound( landmarkFirst.begin(), landmarkFirst.end(), pp[0] - lowdmax );
+  auto last = std::upper_bound( first, landmarkFirst.end(), pp[0] + lowdmax );
+  for(auto it=first; it!=last; ++it) {
+    unsigned i = landmarkOrder[it - landmarkFirst.begin()];
+    if( !isNear[t][i] ) stress += addLandmarkStress( i, pp, dtmp, der, rowstart[t] );
   }
   return stress;
 }
@@ -160,12 +207,31 @@ void ProjectPoints::getProjection( const unsigned& current, std::vector<double>&
     double dist = targ->get( base + i );
     if( dist<mindist ) { mindist=dist; closest=i; }
   }
-  // Put the initial guess near to the closest landmark  -- may wish to use grid here again Sandip??
-  Random random; random.setSeed(-1234);
-  for(unsigned j=0; j<dimout; ++j) point[j] = getPntrToArgument(j)->get(closest) + (random.RandU01() - 0.5)*0.01;
+  if( warmstart && current<hasLastProjection.size() && hasLastProjection[current] ) {
+    for(unsigned j=0; j<dimout; ++j) point[j] = lastProjection[current*dimout+j];
+  } else {
+    // Put the initial guess near to the closest landmark  -- may wish to use grid here again Sandip??
+    Random random; random.setSeed(-1234);
+    for(unsigned j=0; j<dimout; ++j) point[j] = getPntrToArgument(j)->get(closest) + (random.RandU01() - 0.5)*0.01;
+  }
+  unsigned t=OpenMP::getThreadNum();
+  rowstart[t]=current; if( targ->getRank()==2 ) rowstart[t] = current*targ->getShape()[1];
+  if( landmarkOrder.size()>0 ) {
+    // Find the landmarks that have to be included whatever the position of the projection
+    unsigned nmatrices = ( getNumberOfArguments() - dimout ) / 2;
+    nearLandmarks[t].resize(0); isNear[t].assign( nland, 0 );
+    for(unsigned i=0; i<nland; ++i) {
+      for(unsigned k=0; k<nmatrices; ++k ) {
+        if( getPntrToArgument( dimout + 2*k )->get( rowstart[t]+i )!=1.0 ) { nearLandmarks[t].push_back(i); isNear[t][i]=1; break; }
+      }
+    }
+  }
   // And do the optimisation
-  rowstart[OpenMP::getThreadNum()]=current; if( targ->getRank()==2 ) rowstart[OpenMP::getThreadNum()] = current*targ->getShape()[1];
   myminimiser.minimise( cgtol, point, &ProjectPoints::calculateStress );
+  if( warmstart && current<hasLastProjection.size() ) {
+    for(unsigned j=0; j<dimout; ++j) lastProjection[current*dimout+j] = point[j];
+    hasLastProjection[current]=1;
+  }
 }
 
 void ProjectPoints::performTask( const unsigned& current, MultiValue& myvals ) const {
@@ -174,6 +240,15 @@ void ProjectPoints::performTask( const unsigned& current, MultiValue& myvals ) c
 }
 
 void ProjectPoints::calculate() {
+  if( warmstart && getPntrToComponent(0)->getRank()==0 && hasLastProjection.size()!=1 ) { hasLastProjection.assign( 1, 0 ); lastProjection.resize( dimout ); }
+  if( lowdmax<std::numeric_limits<double>::max() ) {
+    // Sort the landmarks along the first low dimensional coordinate
+    unsigned nland = getPntrToArgument(0)->getShape()[0];
+    landmarkOrder.resize( nland ); for(unsigned i=0; i<nland; ++i) landmarkOrder[i]=i;
+    Value* first = getPntrToArgument(0);
+    std::sort( landmarkOrder.begin(), landmarkOrder.end(), [first]( unsigned a, unsigned b ) { return first->get(a)<first->get(b); } );
+    landmarkFirst.resize( nland ); for(unsigned i=0; i<nland; ++i) landmarkFirst[i] = first->get( landmarkOrder[i] );
+  }
   if( getPntrToComponent(0)->getRank()==0 ) {
     std::vector<double> point( dimout ); getProjection( 0, point );
     for(unsigned i=0; i<dimout; ++i) getPntrToComponent(i)->set(point[i]);
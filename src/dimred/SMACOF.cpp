@@ -20,6 +20,7 @@
    along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "SMACOF.h"
+#include "tools/OpenMP.h"
 
 namespace PLMD {
 namespace dimred {
@@ -41,44 +42,55 @@ void SMACOF::optimize( const double& tol, const unsigned& maxloops, std::vector<
     for(unsigned j=0; j<nlow; ++j) { Z(i,j)=proj[k]; k++; }
   }
 
-  // Calculate V
-  Matrix<double> V(M,M);
-  for(unsigned i=0; i<M; ++i) {
-    for(unsigned j=0; j<M; ++j) {
-      if(i==j) continue;
-      V(i,j)=-Weights(i,j);
-    }
-    for(unsigned j=0; j<M; ++j) {
-      if(i==j)continue;
-      V(i,i)-=V(i,j);
+  // Calculate V and pseudo invert it, V is only needed here
+  Matrix<double> mypseudo(M, M);
+  {
+    Matrix<double> V(M,M);
+    for(unsigned i=0; i<M; ++i) {
+      for(unsigned j=0; j<M; ++j) {
+        if(i==j) continue;
+        V(i,j)=-Weights(i,j);
+      }
+      for(unsigned j=0; j<M; ++j) {
+        if(i==j)continue;
+        V(i,i)-=V(i,j);
+      }
     }
+    pseudoInvert(V, mypseudo);
   }
-  // And pseudo invert V
-  Matrix<double> mypseudo(M, M); pseudoInvert(V, mypseudo);
   Matrix<double> dists( M, M ); double myfirstsig = calculateSigma( Z, dists );
 
   // initial sigma is made up of the original distances minus the distances between the projections all squared.
-  Matrix<double> temp( M, M ), BZ( M, M ), newZ( M, nlow );
+  // The Guttman transform V^+ B(Z) Z is computed as V^+ (B(Z) Z) so that no M x M product is needed,
+  // and B(Z) is never stored
+  Matrix<double> BZZ( M, nlow ), newZ( M, nlow );
+  const unsigned nt=OpenMP::getGoodNumThreads( &BZZ(0,0), M );
   for(unsigned n=0; n<maxloops; ++n) {
     if(n==maxloops-1) plumed_merror("ran out of steps in SMACOF algorithm");
 
-    // Recompute BZ matrix
+    // Recompute BZ matrix times Z
+    #pragma omp parallel for num_threads(nt)
     for(unsigned i=0; i<M; ++i) {
+      for(unsigned k=0; k<nlow; ++k) BZZ(i,k)=0;
+      double diag=0;
       for(unsigned j=0; j<M; ++j) {
         if(i==j) continue;  //skips over the diagonal elements
-
-        if( dists(i,j)>0 ) BZ(i,j) = -Weights(i,j)*Distances(i,j) / dists(i,j);
-        else BZ(i,j)=0.;
+        if( !(dists(i,j)>0) ) continue;
+        double bz = -Weights(i,j)*Distances(i,j) / dists(i,j);
+        //the diagonal elements are -off diagonal elements BZ(i,i)-=BZ(i,j)   (Equation 8.25)
+        diag-=bz;
+        for(unsigned k=0; k<nlow; ++k) BZZ(i,k)+=bz*Z(j,k);
       }
-      //the diagonal elements are -off diagonal elements BZ(i,i)-=BZ(i,j)   (Equation 8.25)
-      BZ(i,i)=0; //create the space memory for the diagonal elements which are scalars
+      for(unsigned k=0; k<nlow; ++k) BZZ(i,k)+=diag*Z(i,k);
+    }
+    #pragma omp parallel for num_threads(nt)
+    for(unsigned i=0; i<M; ++i) {
+      for(unsigned k=0; k<nlow; ++k) newZ(i,k)=0;
       for(unsigned j=0; j<M; ++j) {
-        if(i==j) continue;
-        BZ(i,i)-=BZ(i,j);
+        double p=mypseudo(i,j);
+        for(unsigned k=0; k<nlow; ++k) newZ(i,k)+=p*BZZ(j,k);
       }
     }
-
-    mult( mypseudo, BZ, temp); mult(temp, Z, newZ);
     //Compute new sigma
     double newsig = calculateSigma( newZ, dists );
     //Computing whether the algorithm has converged (has the mass of the potato changed
@@ -96,6 +108,8 @@ void SMACOF::optimize( const double& tol, const unsigned& maxloops, std::vector<
 
 double SMACOF::calculateSigma( const Matrix<double>& Z, Matrix<double>& dists ) {
   unsigned M = Distances.nrows(); double sigma=0; double totalWeight=0;
+  // each row writes only the pairs (i,j) and (j,i) with j<i
+  #pragma omp parallel for schedule(dynamic,16) reduction(+:sigma,totalWeight) num_threads(OpenMP::getGoodNumThreads( &dists(0,0), M ))
   for(unsigned i=1; i<M; ++i) {
     for(unsigned j=0; j<i; ++j) {
       double dlow=0; for(unsigned k=0; k<Z.ncols(); ++k) { double tmp=Z(i,k) - Z(j,k); dlow+=tmp*tmp; }
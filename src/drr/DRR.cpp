@@ -75,26 +75,17 @@ size_t DRRForceGrid::index1D(const DRRAxis &c, double x) {
   return idx;
 }
 
-void DRRForceGrid::fillTable(const vector<vector<double>> &in) {
-  table.resize(ndims, vector<double>(sampleSize, 0));
-  for (size_t i = 0; i < ndims; ++i) {
-    size_t repeatAll = 1, repeatOne = 1;
-    for (size_t j = i + 1; j < ndims; ++j)
-      repeatOne *= in[j].size();
-    for (size_t j = 0; j < i; ++j)
-      repeatAll *= in[j].size();
-    size_t in_i_sz = in[i].size();
-    for (size_t l = 0; l < in_i_sz; ++l)
-      std::fill_n(begin(table[i]) + l * repeatOne, repeatOne, in[i][l]);
-    for (size_t k = 0; k < repeatAll - 1; ++k)
-      std::copy_n(begin(table[i]), repeatOne * in_i_sz,
-                  begin(table[i]) + repeatOne * in_i_sz * (k + 1));
+void DRRForceGrid::rowPosition(size_t row, vector<double> &pos) const {
+  for (size_t j = ndims; j-- > 0;) {
+    const size_t nbins = middlePoints[j].size();
+    pos[j] = middlePoints[j][row % nbins];
+    row /= nbins;
   }
 }
 
 DRRForceGrid::DRRForceGrid()
   : suffix(""), ndims(0), dimensions(0), sampleSize(0),
-    headers(""), table(0), forces(0), samples(0), endpoints(0), shifts(0),
+    headers(""), middlePoints(0), forces(0), samples(0), endpoints(0), shifts(0),
     outputunit(1.0) {}
 
 DRRForceGrid::DRRForceGrid(const vector<DRRAxis> &p_dimensions,
@@ -121,8 +112,7 @@ DRRForceGrid::DRRForceGrid(const vector<DRRAxis> &p_dimensions,
       ss << " 0" << '\n';
   }
   headers = ss.str();
-  if (initializeTable)
-    fillTable(mp);
+  middlePoints = mp;
   forces.resize(sampleSize * ndims, 0.0);
   samples.resize(sampleSize, 0);
   outputunit = 1.0;
@@ -344,7 +334,7 @@ void DRRForceGrid::write1DPMF(string filename, const string &fmt) const {
   fprintf(ppmf, fmtv.c_str(), endpoints[0], pmf);
   for (size_t i = 0; i < dimensions[0].nbins; ++i) {
     vector<double> pos(1, 0);
-    pos[0] = table[0][i];
+    pos[0] = middlePoints[0][i];
     const vector<double> f = getGradient(pos, true);
     pmf += f[0] * w / outputunit;
     fprintf(ppmf, fmtv.c_str(), endpoints[i + 1], pmf);
@@ -366,18 +356,20 @@ void DRRForceGrid::writeAll(const string &filename, const string &fmt, bool addi
     pCount = fopen(countname.c_str(), "w");
   }
 
+  // The buffers are bounded, large 3D grids would otherwise double the memory
+  const size_t bufsize = std::min(sizeof(double) * sampleSize * ndims, size_t(1) << 20);
   char *buffer1, *buffer2;
-  buffer1 = (char *)malloc((sizeof(double)) * sampleSize * ndims);
-  buffer2 = (char *)malloc((sizeof(double)) * sampleSize * ndims);
-  setvbuf(pGrad, buffer1, _IOFBF, (sizeof(double)) * sampleSize * ndims);
-  setvbuf(pCount, buffer2, _IOFBF, (sizeof(double)) * sampleSize * ndims);
+  buffer1 = (char *)malloc(bufsize);
+  buffer2 = (char *)malloc(bufsize);
+  setvbuf(pGrad, buffer1, _IOFBF, bufsize);
+  setvbuf(pCount, buffer2, _IOFBF, bufsize);
   fwrite(headers.c_str(), sizeof(char), strlen(headers.c_str()), pGrad);
   fwrite(headers.c_str(), sizeof(char), strlen(headers.c_str()), pCount);
   for (size_t i = 0; i < sampleSize; ++i) {
+    rowPosition(i, pos);
     for (size_t j = 0; j < ndims; ++j) {
-      pos[j] = table[j][i];
-      fprintf(pGrad, fmtv.c_str(), table[j][i]);
-      fprintf(pCount, fmtv.c_str(), table[j][i]);
+      fprintf(pGrad, fmtv.c_str(), pos[j]);
+      fprintf(pCount, fmtv.c_str(), pos[j]);
     }
     fprintf(pCount, " %lu\n", getCount(pos, true));
     vector<double> f = getGradient(pos, true);
@@ -403,9 +395,9 @@ void DRRForceGrid::writeDivergence(const string &filename, const string &fmt) co
   pDiv = fopen(divname.c_str(), "w");
   fwrite(headers.c_str(), sizeof(char), strlen(headers.c_str()), pDiv);
   for (size_t i = 0; i < sampleSize; ++i) {
+    rowPosition(i, pos);
     for (size_t j = 0; j < ndims; ++j) {
-      pos[j] = table[j][i];
-      fprintf(pDiv, fmtv.c_str(), table[j][i]);
+      fprintf(pDiv, fmtv.c_str(), pos[j]);
     }
     const double divergence = getDivergence(pos);
     fprintf(pDiv, fmtv.c_str(), (divergence / outputunit));
@@ -451,9 +443,7 @@ ABF ABF::mergewindow(const ABF &aWA, const ABF &aWB) {
   const size_t ncols = result.ndims;
   vector<double> pos(ncols, 0);
   for (size_t i = 0; i < nrows; ++i) {
-    for (size_t j = 0; j < ncols; ++j) {
-      pos[j] = result.table[j][i];
-    }
+    result.rowPosition(i, pos);
     const unsigned long int countA = aWA.getCount(pos);
     const unsigned long int countB = aWB.getCount(pos);
     const vector<double> aForceA = aWA.getAccumulatedForces(pos);
@@ -499,9 +489,7 @@ CZAR CZAR::mergewindow(const CZAR &cWA, const CZAR &cWB) {
   const size_t ncols = result.ndims;
   vector<double> pos(ncols, 0);
   for (size_t i = 0; i < nrows; ++i) {
-    for (size_t j = 0; j < ncols; ++j) {
-      pos[j] = result.table[j][i];
-    }
+    result.rowPosition(i, pos);
     const unsigned long int countA = cWA.getCount(pos);
     const unsigned long int countB = cWB.getCount(pos);
     const vector<double> aForceA = cWA.getAccumulatedForces(pos);
@@ -528,10 +516,10 @@ void CZAR:: writeZCountZGrad(const string &filename, bool addition) const {
   fwrite(headers.c_str(), sizeof(char), strlen(headers.c_str()), pCount);
   fwrite(headers.c_str(), sizeof(char), strlen(headers.c_str()), pGrad);
   for (size_t i = 0; i < sampleSize; ++i) {
+    rowPosition(i, pos);
     for (size_t j = 0; j < ndims; ++j) {
-      pos[j] = table[j][i];
-      fprintf(pCount, " %.9f", table[j][i]);
-      fprintf(pGrad, " %.9f", table[j][i]);
+      fprintf(pCount, " %.9f", pos[j]);
+      fprintf(pGrad, " %.9f", pos[j]);
     }
     const size_t baseaddr = sampleAddress(pos);
     const auto& current_sample = samples[baseaddr];
@@ -151,10 +151,8 @@ public:
   /// Empty constructor
   DRRForceGrid();
   /// "Real" constructor
-  /// The 2D table vector is mainly used for print grid points in grad and count
-  /// file.
-  /// So when use binary output we can set initializeTable to false to save
-  /// memory.
+  /// The grid points in the grad and count files are computed from the middle
+  /// points of each axis, so initializeTable is kept only for compatibility.
   explicit DRRForceGrid(const vector<DRRAxis> &p_dimensions,
                         const string &p_suffix,
                         bool initializeTable = true);
@@ -201,6 +199,10 @@ public:
   string getSuffix() const { return suffix; }
   /// Set unit for .grad output
   void setOutputUnit(double unit) { outputunit = unit; }
+  /// Raw accumulated forces, used to merge the grids of several walkers
+  vector<double> &getRawForces() { return forces; }
+  /// Raw counts, used to merge the grids of several walkers
+  vector<unsigned long int> &getRawSamples() { return samples; }
   /// Destructor
   virtual ~DRRForceGrid() {}
 
@@ -216,9 +218,10 @@ protected:
   size_t sampleSize;
   /// The header lines of .grad and .count files
   string headers;
-  /// A table stores the middle points of all dimensions.
-  /// For output in .grad and .count files
-  vector<vector<double>> table;
+  /// The middle points of the bins of each dimension.
+  /// The points in .grad and .count files are computed from these on the fly,
+  /// so the memory does not grow with the number of bins of the whole grid
+  vector<vector<double>> middlePoints;
   /// Store the average force of each bins
   vector<double> forces;
   /// Store counts of each bins
@@ -233,7 +236,8 @@ protected:
 
   /// Miscellaneous helper functions
   static size_t index1D(const DRRAxis &c, double x);
-  void fillTable(const vector<vector<double>> &in);
+  /// Position of a line in the output files (the last dimension runs fastest)
+  void rowPosition(size_t row, vector<double> &pos) const;
 
   /// Boost serialization functions
   friend class boost::serialization::access;
@@ -271,7 +275,7 @@ protected:
       else
         ss << " 0" << '\n';
     }
-    fillTable(mp);
+    middlePoints = mp;
     headers = ss.str();
     outputunit = 1.0;
     // For 1D pmf
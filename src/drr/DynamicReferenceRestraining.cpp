@@ -20,6 +20,7 @@
 #include "bias/Bias.h"
 #include "core/PlumedMain.h"
 #include "DRR.h"
+#include "tools/Communicator.h"
 #include "tools/Random.h"
 #include "tools/Tools.h"
 #include "colvar_UIestimator.h"
@@ -223,6 +224,8 @@ private:
   bool textoutput;
   bool withExternalForce;
   bool withExternalFict;
+  bool walkersMPI;
+  long long int walkersStride;
   vector<unsigned> reflectingWall;
   ABF ABFGrid;
   CZAR CZARestimator;
@@ -230,6 +233,12 @@ private:
   vector<double> maxFactors;
   UIestimator::UIestimator eabf_UI;
   Random rand;
+  // Accumulators of the grids at the last merge between walkers
+  vector<vector<double>> walkersLastForces;
+  vector<vector<unsigned long int>> walkersLastSamples;
+  vector<double> walkersBuffer;
+  vector<DRRForceGrid *> getWalkersGrids();
+  void mergeWalkers();
 
 public:
   explicit DynamicReferenceRestraining(const ActionOptions &);
@@ -308,6 +317,10 @@ void DynamicReferenceRestraining::registerKeywords(Keywords &keys) {
                "to a single file rather than multiple .drrstate files. "
                "This option is effective only when textOutput is on.");
   keys.add("optional","FMT","specify format for outfiles files (useful for decrease the number of digits in regtests)");
+  keys.addFlag("WALKERS_MPI", false, "share the accumulated forces and counts of the "
+               "ABF and CZAR grids among all the replicas using MPI");
+  keys.add("compulsory", "WALKERS_STRIDE", "1", "merge the grids of the replicas every N steps "
+           "(this option is effective only with WALKERS_MPI)");
   keys.addOutputComponent(
     "_fict", "default",
     "one or multiple instances of this quantity can be referenced "
@@ -355,6 +368,7 @@ DynamicReferenceRestraining::DynamicReferenceRestraining(
     outputfreq(0.0), historyfreq(-1.0), isRestart(false),
     useCZARestimator(true), useUIestimator(false), mergeHistoryFiles(false),
     textoutput(false), withExternalForce(false), withExternalFict(false),
+    walkersMPI(false), walkersStride(1),
     reflectingWall(getNumberOfArguments(), 0),
     maxFactors(getNumberOfArguments(), 1.0)
 {
@@ -392,6 +406,8 @@ DynamicReferenceRestraining::DynamicReferenceRestraining(
 //   noCZAR == false ? useCZARestimator = true : useCZARestimator = false;
   parseFlag("TEXTOUTPUT", textoutput);
   parseFlag("MERGEHISTORYFILES", mergeHistoryFiles);
+  parseFlag("WALKERS_MPI", walkersMPI);
+  parse("WALKERS_STRIDE", walkersStride);
   parseVector("TAU", tau);
   parseVector("FRICTION", friction);
   parseVector("EXTTEMP", etemp);
@@ -698,6 +714,18 @@ DynamicReferenceRestraining::DynamicReferenceRestraining(
                 lowerboundary, upperboundary, width, kappa, outputprefix, int(outputfreq),
                 uirestart, input_filename, kbt / getKBoltzmann());
   }
+  if (walkersMPI) {
+    if (walkersStride <= 0) {
+      error("eABF/DRR: WALKERS_STRIDE should be positive!");
+    }
+    log << "eABF/DRR: Merging the grids of " << multi_sim_comm.Get_size()
+        << " walkers every " << walkersStride << " steps." << '\n';
+    // Only the samples collected from now on are shared
+    for (const auto grid : getWalkersGrids()) {
+      walkersLastForces.push_back(grid->getRawForces());
+      walkersLastSamples.push_back(grid->getRawSamples());
+    }
+  }
 }
 
 void DynamicReferenceRestraining::calculate() {
@@ -826,6 +854,57 @@ void DynamicReferenceRestraining::update() {
       }
     }
   }
+  if (walkersMPI && getStep() % walkersStride == 0) {
+    mergeWalkers();
+  }
+}
+
+vector<DRRForceGrid *> DynamicReferenceRestraining::getWalkersGrids() {
+  vector<DRRForceGrid *> grids(1, &ABFGrid);
+  if (useCZARestimator) {
+    grids.push_back(&CZARestimator);
+  }
+  return grids;
+}
+
+void DynamicReferenceRestraining::mergeWalkers() {
+  // The increments of all the grids since the last merge are packed in a
+  // single buffer, so that the walkers are merged with one collective.
+  // Counts are exactly representable as doubles up to 2^53.
+  const vector<DRRForceGrid *> grids = getWalkersGrids();
+  size_t bufsize = 0;
+  for (const auto grid : grids) {
+    bufsize += grid->getRawForces().size() + grid->getRawSamples().size();
+  }
+  walkersBuffer.resize(bufsize);
+  double *buf = walkersBuffer.data();
+  for (size_t k = 0; k < grids.size(); ++k) {
+    const vector<double> &forces = grids[k]->getRawForces();
+    const vector<unsigned long int> &samples = grids[k]->getRawSamples();
+    for (size_t i = 0; i < forces.size(); ++i) {
+      *buf++ = forces[i] - walkersLastForces[k][i];
+    }
+    for (size_t i = 0; i < samples.size(); ++i) {
+      *buf++ = double(samples[i] - walkersLastSamples[k][i]);
+    }
+  }
+  if (comm.Get_rank() == 0) {
+    multi_sim_comm.Sum(walkersBuffer);
+  }
+  comm.Bcast(walkersBuffer, 0);
+  buf = walkersBuffer.data();
+  for (size_t k = 0; k < grids.size(); ++k) {
+    vector<double> &forces = grids[k]->getRawForces();
+    vector<unsigned long int> &samples = grids[k]->getRawSamples();
+    for (size_t i = 0; i < forces.size(); ++i) {
+      forces[i] = walkersLastForces[k][i] + (*buf++);
+    }
+    for (size_t i = 0; i < samples.size(); ++i) {
+      samples[i] = walkersLastSamples[k][i] + static_cast<unsigned long int>(std::llround(*buf++));
+    }
+    walkersLastForces[k] = forces;
+    walkersLastSamples[k] = samples;
+  }
 }
 
 void DynamicReferenceRestraining::save(const string &filename,
@@ -19,6 +19,7 @@ along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 #include "core/ActionAtomistic.h"
 #include "core/ActionRegister.h"
 #include "core/PlumedMain.h"
+#include "tools/Communicator.h"
 #include "tools/File.h"
 #include "tools/Matrix.h"
 #include "tools/Random.h"
@@ -216,6 +217,10 @@ private:
   std::vector<double> ssds_;
   std::vector<double> step_size_;
   std::vector<double> pseudo_virial_;
+  std::vector<double> args_;          // arguments of the current step
+  std::vector<double> deltas_;        // weighted deviations from the running means
+  std::vector<double> walker_buffer_; // statistics that are averaged over the walkers
+  std::vector<ActionAtomistic *> virial_cvs_;
   std::vector<Value *> out_coupling_;
   Matrix<double> covar_;
   Matrix<double> covar2_;
@@ -237,6 +242,7 @@ private:
   bool b_virial_;
   bool b_update_virial_;
   bool b_weights_;
+  bool b_walkers_;
   int seed_;
   int update_period_;
   int avg_coupling_count_;
@@ -259,6 +265,7 @@ private:
   /*write output restart*/
   void writeOutRestart();
   void update_statistics();
+  void average_walkers();
   void update_pseudo_virial();
   void calc_lm_step_size();
   void calc_covar_step_size();
@@ -300,6 +307,8 @@ void EDS::registerKeywords(Keywords &keys)
   keys.addInputKeyword("optional", "LOGWEIGHTS", "scalar", "Add weights to use for computing statistics. For example, if biasing with metadynamics.");
   keys.addFlag("LM", false, "Use Levenberg-Marquadt algorithm along with simultaneous keyword. Otherwise use gradient descent.");
   keys.add("compulsory", "LM_MIXING", "1", "Initial mixing parameter when using Levenberg-Marquadt minimization.");
+  keys.addFlag("WALKERS_MPI", false, "Average the statistics of all the replicas before each update of the coupling constants. "
+               "All the replicas should use the same SEED so that they take the same steps.");
   keys.add("optional", "RESTART_FMT", "the format that should be used to output real numbers in EDS restarts");
   keys.add("optional", "OUT_RESTART", "Output file for all information needed to continue EDS simulation. "
            "If you have the RESTART directive set (global or for EDS), this file will be appended to. "
@@ -333,6 +342,8 @@ EDS::EDS(const ActionOptions &ao) : PLUMED_BIAS_INIT(ao),
   means_(ncvs_, 0.0),
   step_size_(ncvs_, 0.0),
   pseudo_virial_(ncvs_),
+  args_(ncvs_, 0.0),
+  deltas_(ncvs_, 0.0),
   out_coupling_(ncvs_, NULL),
   in_restart_name_(""),
   out_restart_name_(""),
@@ -347,6 +358,7 @@ EDS::EDS(const ActionOptions &ao) : PLUMED_BIAS_INIT(ao),
   b_lm_(false),
   b_virial_(false),
   b_weights_(false),
+  b_walkers_(false),
   seed_(0),
   update_period_(0),
   avg_coupling_count_(1),
@@ -397,6 +409,7 @@ EDS::EDS(const ActionOptions &ao) : PLUMED_BIAS_INIT(ao),
   parseFlag("FREEZE", b_freeze_);
   parseFlag("MEAN", b_mean);
   parseFlag("COVAR", b_covar_);
+  parseFlag("WALKERS_MPI", b_walkers_);
   parse("IN_RESTART", in_restart_name_);
   checkRead();
 
@@ -502,6 +515,7 @@ EDS::EDS(const ActionOptions &ao) : PLUMED_BIAS_INIT(ao),
       error("Minimizing the virial is only valid with multiply correlated collective variables.");
     // check that the CVs can be used to compute pseudo-virial
     log.printf("  EDS will compute virials of CVs and penalize with scale of %f. Checking CVs are valid...", virial_scaling_);
+    virial_cvs_.resize(ncvs_);
     for (unsigned int i = 0; i < ncvs_; ++i)
     {
       auto a = dynamic_cast<ActionAtomistic *>(getPntrToArgument(i)->getPntrToAction());
@@ -510,6 +524,7 @@ EDS::EDS(const ActionOptions &ao) : PLUMED_BIAS_INIT(ao),
       // cppcheck-suppress nullPointerRedundantCheck
       if (!(a->getPbc().isOrthorombic()))
         log.printf("  WARNING: EDS Virial should have a orthorombic cell\n");
+      virial_cvs_[i] = a;
     }
     log.printf("done.\n");
     addComponent("pressure");
@@ -517,6 +532,13 @@ EDS::EDS(const ActionOptions &ao) : PLUMED_BIAS_INIT(ao),
     value_pressure_ = getPntrToComponent("pressure");
   }
 
+  if (b_walkers_)
+  {
+    log.printf("  statistics will be averaged over %d walkers before each update\n", multi_sim_comm.Get_size());
+    // means, second moments and (if needed) pseudo virials are sent with a single collective
+    walker_buffer_.resize(ncvs_ + ((b_covar_ || b_lm_) ? ncvs_ * ncvs_ : ncvs_) + (b_virial_ ? ncvs_ + 1 : 0));
+  }
+
   if (b_mean && !b_freeze_)
   {
     error("EDS keyword MEAN can only be used along with keyword FREEZE");
@@ -861,7 +883,6 @@ void EDS::apply_bias()
 void EDS::update_statistics()
 {
   double s, N, w = 1.0;
-  std::vector<double> deltas(ncvs_);
 
   // update weight max, if necessary
   if (b_weights_)
@@ -885,20 +906,23 @@ void EDS::update_statistics()
 
   // Welford, West, and Hanso online variance method
   // with weights (default =  1.0)
+  for (unsigned int i = 0; i < ncvs_; ++i)
+    args_[i] = getArgument(i);
   for (unsigned int i = 0; i < ncvs_; ++i)
   {
-    deltas[i] = difference(i, means_[i], getArgument(i)) * w;
-    means_[i] += deltas[i] / N;
+    deltas_[i] = difference(i, means_[i], args_[i]) * w;
+    means_[i] += deltas_[i] / N;
     if (!b_covar_ && !b_lm_)
-      ssds_[i] += deltas[i] * difference(i, means_[i], getArgument(i));
+      ssds_[i] += deltas_[i] * difference(i, means_[i], args_[i]);
   }
   if (b_covar_ || b_lm_)
   {
     for (unsigned int i = 0; i < ncvs_; ++i)
     {
+      const double di = deltas_[i];
       for (unsigned int j = i; j < ncvs_; ++j)
       {
-        s = (N - 1) * deltas[i] * deltas[j] / N / N - covar_(i, j) / N;
+        s = (N - 1) * di * deltas_[j] / N / N - covar_(i, j) / N;
         covar_(i, j) += s;
         // do this so we don't double count
         covar_(j, i) = covar_(i, j);
@@ -909,6 +933,64 @@ void EDS::update_statistics()
     update_pseudo_virial();
 }
 
+void EDS::average_walkers()
+{
+  // The statistics of each walker are combined as if all the samples had been
+  // collected by a single walker, with the same number of samples on every walker
+  const double nw = multi_sim_comm.Get_size();
+  const double N = fmax(1, update_calls_);
+  const bool b_matrix = b_covar_ || b_lm_;
+  double *means = walker_buffer_.data();
+  double *moments = means + ncvs_;
+  double *virials = moments + (b_matrix ? ncvs_ * ncvs_ : ncvs_);
+
+  for (unsigned int i = 0; i < ncvs_; ++i)
+    means[i] = means_[i];
+  if (b_matrix)
+  {
+    for (unsigned int i = 0; i < ncvs_; ++i)
+      for (unsigned int j = 0; j < ncvs_; ++j)
+        moments[i * ncvs_ + j] = covar_(i, j) + means_[i] * means_[j];
+  }
+  else
+  {
+    for (unsigned int i = 0; i < ncvs_; ++i)
+      moments[i] = ssds_[i] + N * means_[i] * means_[i];
+  }
+  if (b_virial_)
+  {
+    for (unsigned int i = 0; i < ncvs_; ++i)
+      virials[i] = pseudo_virial_[i];
+    virials[ncvs_] = pseudo_virial_sum_;
+  }
+
+  if (comm.Get_rank() == 0)
+    multi_sim_comm.Sum(walker_buffer_);
+  comm.Bcast(walker_buffer_, 0);
+  for (auto &b : walker_buffer_)
+    b /= nw;
+
+  for (unsigned int i = 0; i < ncvs_; ++i)
+    means_[i] = means[i];
+  if (b_matrix)
+  {
+    for (unsigned int i = 0; i < ncvs_; ++i)
+      for (unsigned int j = 0; j < ncvs_; ++j)
+        covar_(i, j) = moments[i * ncvs_ + j] - means_[i] * means_[j];
+  }
+  else
+  {
+    for (unsigned int i = 0; i < ncvs_; ++i)
+      ssds_[i] = moments[i] - N * means_[i] * means_[i];
+  }
+  if (b_virial_)
+  {
+    for (unsigned int i = 0; i < ncvs_; ++i)
+      pseudo_virial_[i] = virials[i];
+    pseudo_virial_sum_ = virials[ncvs_];
+  }
+}
+
 void EDS::reset_statistics()
 {
   for (unsigned int i = 0; i < ncvs_; ++i)
@@ -964,9 +1046,10 @@ void EDS::calc_covar_step_size()
   double tmp;
   for (unsigned int i = 0; i < ncvs_; ++i)
   {
+    const double d = difference(i, center_[i], means_[i]);
     tmp = 0;
     for (unsigned int j = 0; j < ncvs_; ++j)
-      tmp += difference(i, center_[i], means_[i]) * covar_(i, j);
+      tmp += d * covar_(i, j);
     step_size_[i] = 2 * tmp / kbt_ / scale_[i] * update_calls_ / fmax(1, update_calls_ - 1);
   }
 }
@@ -990,7 +1073,7 @@ void EDS::update_pseudo_virial()
   for (unsigned int i = 0; i < ncvs_; ++i)
   {
     // checked in setup to ensure this cast is valid.
-    ActionAtomistic *cv = dynamic_cast<ActionAtomistic *>(getPntrToArgument(i)->getPntrToAction());
+    ActionAtomistic *cv = virial_cvs_[i];
     Tensor v(cv->getVirial());
     Tensor box(cv->getBox());
     const unsigned int natoms = cv->getNumberOfAtoms();
@@ -1028,6 +1111,8 @@ void EDS::update_pseudo_virial()
 void EDS::update_bias()
 {
   log.flush();
+  if (b_walkers_)
+    average_walkers();
   if (b_lm_)
     calc_lm_step_size();
   else if (b_covar_)
@@ -0,0 +1,116 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) envsim 2023-2024 The code team
+   (see the PEOPLE-envsim file at the root of the distribution for a list of names)
+
+   This file is part of envsim code module.
+
+   The envsim code module is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   The envsim code module is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with the envsim code module.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "function/FunctionTemplateBase.h"
+#include "function/FunctionShortcut.h"
+#include "function/FunctionOfMatrix.h"
+#include "core/ActionRegister.h"
+
+#include <string>
+#include <cmath>
+
+namespace PLMD {
+namespace envsim {
+
+//+PLUMEDOC MCOLVAR ENVIRONMENT_KERNEL
+/*
+Calculate the overlap between the density around an atom and a reference environment from the components of a distance matrix.
+
+This action is used by \ref ENVIRONMENTSIMILARITY.
+
+\par Examples
+
+*/
+//+ENDPLUMEDOC
+
+//+PLUMEDOC MCOLVAR ENVIRONMENT_KERNEL_MATRIX
+/*
+Calculate the overlap between the density around an atom and a reference environment from the components of a distance matrix.
+
+This action is used by \ref ENVIRONMENTSIMILARITY.
+
+\par Examples
+
+*/
+//+ENDPLUMEDOC
+
+class EnvironmentKernel : public function::FunctionTemplateBase {
+private:
+/// The positions of the reference atoms
+  std::vector<double> refx, refy, refz;
+/// One over four sigma squared
+  double inv_four_sig2;
+/// The range of distances in which the kernel is not zero
+  double lcutoff, cutoff;
+/// One over the number of atoms in the reference environment
+  double norm;
+public:
+  void registerKeywords( Keywords& keys ) override;
+  void read( ActionWithArguments* action ) override;
+  void calc( const ActionWithArguments* action, const std::vector<double>& args, std::vector<double>& vals, Matrix<double>& derivatives ) const override;
+};
+
+typedef function::FunctionShortcut<EnvironmentKernel> EnvironmentKernelShortcut;
+PLUMED_REGISTER_ACTION(EnvironmentKernelShortcut,"ENVIRONMENT_KERNEL")
+typedef function::FunctionOfMatrix<EnvironmentKernel> MatrixEnvironmentKernel;
+PLUMED_REGISTER_ACTION(MatrixEnvironmentKernel,"ENVIRONMENT_KERNEL_MATRIX")
+
+void EnvironmentKernel::registerKeywords( Keywords& keys ) {
+  keys.add("compulsory","REFERENCE","the x, y and z components of the vectors connecting the central atom to the atoms in the reference environment");
+  keys.add("compulsory","SIGMA","the width to use for the gaussian kernels");
+  keys.add("compulsory","LCUTOFF","0.0001","any atoms separated by less than this tolerance should be ignored");
+  keys.add("compulsory","CUTOFF","atoms separated by more than this distance are ignored");
+  keys.add("compulsory","NATOMS","the number of atoms in the reference environment, which is used to normalize the overlap");
+  keys.setValueDescription("matrix","the overlap between the density around each atom and the reference environment");
+}
+
+void EnvironmentKernel::read( ActionWithArguments* action ) {
+  if( action->getNumberOfArguments()!=4 ) action->error("should have four arguments: the x, y and z components of the distances and the distances");
+  std::vector<double> ref; parseVector(action,"REFERENCE",ref);
+  if( ref.size()%3!=0 ) action->error("the number of elements in REFERENCE should be a multiple of three");
+  unsigned nref=ref.size()/3; refx.resize(nref); refy.resize(nref); refz.resize(nref);
+  for(unsigned i=0; i<nref; ++i) { refx[i]=ref[3*i]; refy[i]=ref[3*i+1]; refz[i]=ref[3*i+2]; }
+  double sig; parse(action,"SIGMA",sig); inv_four_sig2 = 1.0 / (4*sig*sig);
+  parse(action,"LCUTOFF",lcutoff); parse(action,"CUTOFF",cutoff);
+  double natoms; parse(action,"NATOMS",natoms); norm = 1.0 / natoms;
+  action->log.printf("  overlap with %d reference atoms computed with gaussians of width %f \n", nref, sig );
+  action->log.printf("  ignoring atoms closer than %f and further than %f \n", lcutoff, cutoff );
+}
+
+void EnvironmentKernel::calc( const ActionWithArguments* /*action*/, const std::vector<double>& args, std::vector<double>& vals, Matrix<double>& derivatives ) const {
+  // The step functions at the cutoffs have zero derivative
+  vals[0]=0; for(unsigned j=0; j<4; ++j) derivatives(0,j)=0;
+  if( args[3]<lcutoff || args[3]>cutoff ) return;
+  const double x=args[0], y=args[1], z=args[2]; const unsigned nref=refx.size();
+  const double* rx=refx.data(); const double* ry=refy.data(); const double* rz=refz.data();
+  double val=0, dx=0, dy=0, dz=0;
+  #pragma omp simd reduction(+:val,dx,dy,dz)
+  for(unsigned i=0; i<nref; ++i) {
+    const double ddx=x-rx[i], ddy=y-ry[i], ddz=z-rz[i];
+    const double expo=std::exp( -(ddx*ddx+ddy*ddy+ddz*ddz)*inv_four_sig2 );
+    val+=expo; dx+=expo*ddx; dy+=expo*ddy; dz+=expo*ddz;
+  }
+  vals[0]=norm*val;
+  if( noderiv ) return;
+  const double pref=-2*norm*inv_four_sig2;
+  derivatives(0,0)=pref*dx; derivatives(0,1)=pref*dy; derivatives(0,2)=pref*dz;
+}
+
+}
+}
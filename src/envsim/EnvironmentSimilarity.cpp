@@ -222,7 +222,7 @@ void EnvironmentSimilarity::registerKeywords( Keywords& keys ) {
   keys.setValueDescription("vector","the environmental similar parameter for each of the input atoms");
   multicolvar::MultiColvarShortcuts::shortcutKeywords( keys ); keys.needsAction("GROUP");
   keys.needsAction("DISTANCE_MATRIX"); keys.needsAction("ONES"); keys.needsAction("CONSTANT");
-  keys.needsAction("CUSTOM"); keys.needsAction("MATRIX_VECTOR_PRODUCT"); keys.needsAction("COMBINE");
+  keys.needsAction("CUSTOM"); keys.needsAction("ENVIRONMENT_KERNEL"); keys.needsAction("MATRIX_VECTOR_PRODUCT"); keys.needsAction("COMBINE");
 }
 
 EnvironmentSimilarity::EnvironmentSimilarity(const ActionOptions&ao):
@@ -349,19 +349,22 @@ EnvironmentSimilarity::EnvironmentSimilarity(const ActionOptions&ao):
   }
   std::string matlab = getShortcutLabel() + "_cmat";
   double cutoff, sig; parse("SIGMA",sig); parse("CUTOFF",cutoff); std::string lcutoff; parse("LCUTOFF",lcutoff);
-  std::string sig2; Tools::convert( sig*sig, sig2 ); std::vector<std::vector<std::string> > funcstr(environments.size());
+  std::vector<std::vector<std::string> > funcstr(environments.size());
+  std::string str_sig; Tools::convert( sig, str_sig );
   std::string str_cutoff; Tools::convert( maxdist + cutoff*sig, str_cutoff );
   std::string str_natoms, xpos, ypos, zpos; Tools::convert( environments[0].size(), str_natoms );
+  // The gaussians of each reference environment are summed by ENVIRONMENT_KERNEL, which keeps the reference positions in contiguous arrays
   for(unsigned j=0; j<environments.size(); ++j) {
     funcstr[j].resize( allspec.size() );
     for(unsigned k=0; k<allspec.size(); ++k) {
       for(unsigned i=0; i<environments[j].size(); ++i) {
         if( environments[j][i].first!=k ) continue ;
         Tools::convert( environments[j][i].second[0], xpos ); Tools::convert( environments[j][i].second[1], ypos ); Tools::convert( environments[j][i].second[2], zpos );
-        if( i==0 ) funcstr[j][k] = "FUNC=(step(w-" + lcutoff + ")*step(" + str_cutoff + "-w)/" + str_natoms + ")*(exp(-((x-" + xpos + ")^2+(y-" + ypos + ")^2+(z-" + zpos + ")^2)/(4*" + sig2 + "))";
-        else funcstr[j][k] += "+exp(-((x-" + xpos + ")^2+(y-" + ypos + ")^2+(z-" + zpos + ")^2)/(4*" + sig2 + "))";
+        if( funcstr[j][k].length()==0 ) funcstr[j][k] = "REFERENCE=" + xpos + "," + ypos + "," + zpos;
+        else funcstr[j][k] += "," + xpos + "," + ypos + "," + zpos;
       }
-      if( funcstr[j][k].length()>0 ) funcstr[j][k] += ")"; else funcstr[j][k] ="FUNC=0";
+      if( funcstr[j][k].length()>0 ) funcstr[j][k] = "ENVIRONMENT_KERNEL " + funcstr[j][k] + " SIGMA=" + str_sig + " LCUTOFF=" + lcutoff + " CUTOFF=" + str_cutoff + " NATOMS=" + str_natoms;
+      else funcstr[j][k] = "CUSTOM VAR=x,y,z,w PERIODIC=NO FUNC=0";
     }
   }
 
@@ -411,14 +414,14 @@ EnvironmentSimilarity::EnvironmentSimilarity(const ActionOptions&ao):
     if( allspec.size()>1 ) {
       std::string argnames;
       for(unsigned i=0; i<allspec.size(); ++i) {
-        readInputLine( getShortcutLabel() + "_" + allspec[i] + "_matenv" + jnum + ": CUSTOM ARG=" + matlab + ".x," + matlab + ".y," + matlab + ".z," + matlab + ".w VAR=x,y,z,w PERIODIC=NO " + funcstr[j][i] );
+        readInputLine( getShortcutLabel() + "_" + allspec[i] + "_matenv" + jnum + ": " + funcstr[j][i] + " ARG=" + matlab + ".x," + matlab + ".y," + matlab + ".z," + matlab + ".w" );
         readInputLine( getShortcutLabel() + "_" + allspec[i] + "_env" + jnum + ": MATRIX_VECTOR_PRODUCT ARG=" + getShortcutLabel() + "_" + allspec[i] + "_matenv" + jnum + "," + getShortcutLabel() + "_ones_" + allspec[i] );
         if( i==0 ) argnames = getShortcutLabel() + "_" + allspec[i] + "_env" + jnum; else argnames += "," + getShortcutLabel() + "_" + allspec[i] + "_env" + jnum;
       }
       if( funcstr.size()==1) readInputLine( getShortcutLabel() + ": COMBINE PERIODIC=NO ARG=" + argnames );
       else readInputLine( getShortcutLabel() + "_env" + jnum + ": COMBINE PERIODIC=NO ARG=" + argnames );
     } else {
-      readInputLine( getShortcutLabel() + "_matenv" + jnum + ": CUSTOM ARG=" + matlab + ".x," + matlab + ".y," + matlab + ".z," + matlab + ".w VAR=x,y,z,w PERIODIC=NO " + funcstr[j][0] );
+      readInputLine( getShortcutLabel() + "_matenv" + jnum + ": " + funcstr[j][0] + " ARG=" + matlab + ".x," + matlab + ".y," + matlab + ".z," + matlab + ".w" );
       if( funcstr.size()==1) readInputLine( getShortcutLabel() + ": MATRIX_VECTOR_PRODUCT ARG=" + getShortcutLabel() + "_matenv" + jnum + "," + getShortcutLabel() + "_ones");
       else readInputLine( getShortcutLabel() + "_env" + jnum + ": MATRIX_VECTOR_PRODUCT ARG=" + getShortcutLabel() + "_matenv" + jnum + "," + getShortcutLabel() + "_ones");
     }
@@ -19,6 +19,7 @@ along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 #include "tools/File.h"
 #include "tools/Matrix.h"
 #include "tools/Random.h"
+#include "tools/OpenMP.h"
 #include "legendre_rule_fast.h"
 
 #include <iostream>
@@ -109,6 +110,8 @@ private:
   std::vector<double> gauss_weight_;
   std::vector<double> partition_estimate_;
   std::vector<double> observable_weight_;
+  // exp(beta*f_j*Q_i) for the current step, stored as [i*n_interpolation_+j]
+  std::vector<double> boltzmann_;
 
   std::string in_restart_name_;
   std::string out_restart_name_;
@@ -140,6 +143,7 @@ private:
 
 
   Value* value_force2_;
+  unsigned nthreads_;
   void readInRestart();
   void NormalizeForceWeights();
   /*setup output restart*/
@@ -152,6 +156,7 @@ private:
   void update_bias();
   void apply_bias();
   void compute_observable_weight();
+  void compute_boltzmann_factors();
 
 public:
   explicit FISST(const ActionOptions&);
@@ -219,7 +224,8 @@ FISST::FISST(const ActionOptions&ao):
   reset_period_(0),
   observable_freq_(0),
   kbt_(0.0),
-  value_force2_(NULL)
+  value_force2_(NULL),
+  nthreads_(1)
 {
   if(ncvs_==0)
     error("Must specify at least one CV with ARG");
@@ -324,6 +330,12 @@ FISST::FISST(const ActionOptions&ao):
   //set inverse temperature
   beta_ = 1/kbt_;
 
+  // the quadrature is fixed, only the Boltzmann factors change with the CV
+  boltzmann_.resize(ncvs_*n_interpolation_);
+  nthreads_ = OpenMP::getNumThreads();
+  if(nthreads_*64>static_cast<unsigned>(n_interpolation_)) nthreads_ = n_interpolation_/64;
+  if(nthreads_==0) nthreads_ = 1;
+
   if(b_freeze_ && b_restart_) {
     log.printf("  freezing weights read in from the restart file\n");
   }
@@ -500,6 +512,8 @@ void FISST::calculate() {
     if(b_write_observable_) writeOutObservable();
   }
 
+  compute_boltzmann_factors();
+
   if(! b_freeze_) {
     if(b_restart_ && b_first_restart_sample_) {
       //dont' update statistics if restarting and first sample
@@ -546,6 +560,19 @@ void FISST::apply_bias() {
   //log.flush();
 }
 
+void FISST::compute_boltzmann_factors() {
+  // the CV only changes between steps, so these exponentials are shared by
+  // update_statistics, update_bias and compute_observable_weight
+  const unsigned n = n_interpolation_;
+  for(unsigned int i = 0; i < ncvs_; ++i) {
+    const double bQ_i = beta_*difference(i, center_[i], getArgument(i));
+    const double* f = forces_.data();
+    double* e = boltzmann_.data() + i*n;
+    #pragma omp parallel for simd num_threads(nthreads_)
+    for(unsigned int j=0; j<n; j++) e[j] = exp(f[j]*bQ_i);
+  }
+}
+
 void FISST::update_statistics()  {
 //get stride is for multiple time stepping
   double dt=getTimeStep()*getStride();
@@ -559,32 +586,27 @@ void FISST::update_statistics()  {
   else {
     n_samples_++;
   }
-  double d_n_samples = (double)n_samples_;
-
-  for(unsigned int i = 0; i < ncvs_; ++i) {
-    double Q_i = difference(i, center_[i], getArgument(i));
-    for(unsigned int j=0; j<n_interpolation_; j++)
-    {
-      //if multiple cvs, these need to be updated to have 2 columns
-      double f_j = forces_[j];
-      double w_j = force_weight_[j];
-      double g_j = gauss_weight_[j];
-
-      fbar_denum_integral += g_j * w_j * exp(beta_*f_j * Q_i);
-    }
+  const double d_n_samples = (double)n_samples_;
+  const double old_fraction = (d_n_samples-1)/d_n_samples;
 
-    for(unsigned int j=0; j<n_interpolation_; j++)
-    {
-      double f_j = forces_[j];
-      double sample_weight = exp(beta_*f_j * Q_i) / fbar_denum_integral;
+  const unsigned n = n_interpolation_;
+  const double* g = gauss_weight_.data();
+  double* w = force_weight_.data();
+  double* z = partition_estimate_.data();
 
-      partition_estimate_[j] = sample_weight/d_n_samples + partition_estimate_[j]*(d_n_samples-1)/(d_n_samples);
-
-      double w_jn = force_weight_[j];
-      double z_jn = partition_estimate_[j];
-
-      double w_jp1 = (1.0 - h) * w_jn + h / z_jn;
-      force_weight_[j] = w_jp1;
+  for(unsigned int i = 0; i < ncvs_; ++i) {
+    //if multiple cvs, these need to be updated to have 2 columns
+    const double* e = boltzmann_.data() + i*n;
+
+    #pragma omp parallel for simd num_threads(nthreads_) reduction(+:fbar_denum_integral)
+    for(unsigned int j=0; j<n; j++) fbar_denum_integral += g[j] * w[j] * e[j];
+
+    const double inv_denum = 1.0/(fbar_denum_integral*d_n_samples);
+    #pragma omp parallel for simd num_threads(nthreads_)
+    for(unsigned int j=0; j<n; j++) {
+      // sample_weight/d_n_samples + z_jn*(d_n_samples-1)/d_n_samples
+      z[j] = e[j]*inv_denum + z[j]*old_fraction;
+      w[j] = (1.0 - h) * w[j] + h / z[j];
     }
   }
 
@@ -595,18 +617,21 @@ void FISST::update_statistics()  {
 
 void FISST::update_bias()
 {
+  const unsigned n = n_interpolation_;
+  const double* f = forces_.data();
+  const double* g = gauss_weight_.data();
+  const double* w = force_weight_.data();
+
   for(unsigned int i = 0; i < ncvs_; ++i) {
-    double Q_i = difference(i, center_[i], getArgument(i));
+    const double* e = boltzmann_.data() + i*n;
     double fbar_num_integral = 0.0;
     double fbar_denum_integral = 0.0;
 
-    for(unsigned int j=0; j<n_interpolation_; j++ ) {
-      double f_j = forces_[j];
-      double w_j = force_weight_[j];
-      double g_j = gauss_weight_[j];
-
-      fbar_num_integral += g_j * f_j * w_j * exp(beta_*f_j*Q_i);
-      fbar_denum_integral += g_j * w_j * exp(beta_*f_j*Q_i);
+    #pragma omp parallel for simd num_threads(nthreads_) reduction(+:fbar_num_integral,fbar_denum_integral)
+    for(unsigned int j=0; j<n; j++ ) {
+      const double gwe = g[j] * w[j] * e[j];
+      fbar_num_integral += gwe * f[j];
+      fbar_denum_integral += gwe;
     }
 
     current_avg_force_[i] = fbar_num_integral/fbar_denum_integral;
@@ -615,23 +640,21 @@ void FISST::update_bias()
 
 void FISST::compute_observable_weight() {
   double obs_num = (max_force_ - min_force_);
+  const unsigned n = n_interpolation_;
+  const double* g = gauss_weight_.data();
+  const double* w = force_weight_.data();
 
   for(unsigned int i = 0; i < ncvs_; ++i) {
-    double Q_i = difference(i, center_[i], getArgument(i));
+    const double* e = boltzmann_.data() + i*n;
 
-    for(unsigned int j=0; j<n_interpolation_; j++ ) {
-      double z_j = partition_estimate_[j];
-      double f_j = forces_[j];
-      double denum_integral = 0.0;
+    // sum_k g_k w_k exp(beta*(f_k-f_j)*Q_i) = exp(-beta*f_j*Q_i) sum_k g_k w_k exp(beta*f_k*Q_i),
+    // so the double loop over the quadrature points reduces to a single sum
+    double denum_integral = 0.0;
+    #pragma omp parallel for simd num_threads(nthreads_) reduction(+:denum_integral)
+    for( unsigned int k=0; k<n; k++ ) denum_integral += g[k] * w[k] * e[k];
 
-      for( unsigned int k=0; k<n_interpolation_; k++ ) {
-        double f_k = forces_[k];
-        double w_k = force_weight_[k];
-        double g_k = gauss_weight_[k];
-
-        denum_integral += g_k * w_k * exp(beta_*(f_k-f_j)*Q_i);
-      }
-      observable_weight_[j] = obs_num/(denum_integral*z_j);
+    for(unsigned int j=0; j<n; j++ ) {
+      observable_weight_[j] = obs_num*e[j]/(denum_integral*partition_estimate_[j]);
     }
   }
 }
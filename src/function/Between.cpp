@@ -103,6 +103,14 @@ void Between::calc( const ActionWithArguments* action, const std::vector<double>
   plumed_dbg_assert( args.size()==1 ); vals[0] = hist.calculate( args[0], derivatives(0,0) );
 }
 
+bool Between::calcBlock( std::size_t npoints, const double* const* args, const std::size_t* strides, double* vals, double* derivatives ) const {
+  for(std::size_t k=0; k<npoints; ++k) {
+    double df; vals[k] = hist.calculate( args[0][k*strides[0]], df );
+    if( derivatives ) derivatives[k] = df;
+  }
+  return true;
+}
+
 }
 }
 
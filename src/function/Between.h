@@ -35,6 +35,7 @@ public:
   void read( ActionWithArguments* action ) override;
   bool getDerivativeZeroIfValueIsZero() const override { return true; }
   void calc( const ActionWithArguments* action, const std::vector<double>& args, std::vector<double>& vals, Matrix<double>& derivatives ) const override;
+  bool calcBlock( std::size_t npoints, const double* const* args, const std::size_t* strides, double* vals, double* derivatives ) const override;
 };
 
 }
@@ -131,6 +131,8 @@ void Combine::read( ActionWithArguments* action ) {
   parseVector(action,"POWERS",powers); if(powers.size()!=static_cast<unsigned>(action->getNumberOfArguments())) action->error("Size of POWERS array should be the same as number for arguments");
 
   parseFlag(action,"NORMALIZE",normalize);
+  periodicArgs=false; for(unsigned i=0; i<action->getNumberOfArguments(); ++i) if( action->getPntrToArgument(i)->isPeriodic() ) periodicArgs=true;
+  linear=true; for(unsigned i=0; i<powers.size(); ++i) if( powers[i]!=1.0 ) linear=false;
   if(normalize) {
     double n=0.0;
     for(unsigned i=0; i<coefficients.size(); i++) n+=coefficients[i];
@@ -155,6 +157,32 @@ void Combine::calc( const ActionWithArguments* action, const std::vector<double>
   }
 }
 
+bool Combine::calcBlock( std::size_t npoints, const double* const* args, const std::size_t* strides, double* vals, double* derivatives ) const {
+  // Differences between periodic arguments need the action
+  if( periodicArgs ) return false;
+  const std::size_t nargs=coefficients.size();
+  if( linear ) {
+    // Linear combinations are accumulated one argument at a time so the inner loops can be vectorized
+    for(std::size_t k=0; k<npoints; ++k) vals[k]=0.0;
+    for(std::size_t i=0; i<nargs; ++i) {
+      const double* x=args[i]; const std::size_t s=strides[i]; const double c=coefficients[i], a=parameters[i];
+      for(std::size_t k=0; k<npoints; ++k) vals[k] += c*(x[k*s]-a);
+      if( derivatives ) for(std::size_t k=0; k<npoints; ++k) derivatives[k*nargs+i] = c;
+    }
+    return true;
+  }
+  for(std::size_t k=0; k<npoints; ++k) {
+    double v=0.0;
+    for(std::size_t i=0; i<nargs; ++i) {
+      const double cv=args[i][k*strides[i]]-parameters[i];
+      v += coefficients[i]*pow( cv, powers[i] );
+      if( derivatives ) derivatives[k*nargs+i] = coefficients[i]*powers[i]*pow( cv, powers[i]-1.0 );
+    }
+    vals[k]=v;
+  }
+  return true;
+}
+
 }
 }
 
@@ -33,10 +33,15 @@ class Combine : public FunctionTemplateBase
   std::vector<double> coefficients;
   std::vector<double> parameters;
   std::vector<double> powers;
+/// Are any of the arguments periodic
+  bool periodicArgs;
+/// Are all the powers equal to one
+  bool linear;
 public:
   void registerKeywords(Keywords& keys) override;
   void read( ActionWithArguments* action ) override;
   void calc( const ActionWithArguments* action, const std::vector<double>& args, std::vector<double>& vals, Matrix<double>& derivatives ) const override;
+  bool calcBlock( std::size_t npoints, const double* const* args, const std::size_t* strides, double* vals, double* derivatives ) const override;
 };
 
 }
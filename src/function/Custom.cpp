@@ -357,10 +357,34 @@ void Custom::calc( const ActionWithArguments* action, const std::vector<double>&
       return;
     }
   }
-  vals[0] = function.evaluate( args );
-  if( !noderiv ) {
-    for(unsigned i=0; i<args.size(); i++) derivatives(0,i) = function.evaluateDeriv( i, args );
+  if( noderiv ) vals[0] = function.evaluate( args );
+  else vals[0] = function.evaluateWithDerivatives( args, &derivatives(0,0) );
+}
+
+bool Custom::calcBlock( std::size_t npoints, const double* const* args, const std::size_t* strides, double* vals, double* derivatives ) const {
+  const unsigned nargs=function.getNumberOfArguments();
+  function.evaluateBlock( npoints, args, strides, vals, noderiv ? NULL : derivatives );
+  if( nargs<2 || (check_multiplication_vars.size()==0 && !zerowhenallzero) ) return true;
+  // Points where the function is known to be zero are set as in calc
+  for(std::size_t k=0; k<npoints; ++k) {
+    bool allzero=false;
+    if( check_multiplication_vars.size()>0 ) {
+      for(unsigned i=0; i<check_multiplication_vars.size(); ++i) {
+        unsigned j=check_multiplication_vars[i];
+        if( fabs(args[j][k*strides[j]])<epsilon ) { allzero=true; break; }
+      }
+    } else {
+      allzero=(fabs(args[0][k*strides[0]])<epsilon);
+      for(unsigned i=1; i<nargs; ++i) {
+        if( fabs(args[i][k*strides[i]])>epsilon ) { allzero=false; break; }
+      }
+    }
+    if( allzero ) {
+      vals[k]=0;
+      if( !noderiv && derivatives ) for(unsigned i=0; i<nargs; ++i) derivatives[k*nargs+i]=0.0;
+    }
   }
+  return true;
 }
 
 }
@@ -42,6 +42,7 @@ public:
   bool getDerivativeZeroIfValueIsZero() const override;
   std::vector<Value*> getArgumentsToCheck( const std::vector<Value*>& args ) override;
   void calc( const ActionWithArguments* action, const std::vector<double>& args, std::vector<double>& vals, Matrix<double>& derivatives ) const override;
+  bool calcBlock( std::size_t npoints, const double* const* args, const std::size_t* strides, double* vals, double* derivatives ) const override;
 };
 
 }
@@ -23,6 +23,9 @@
 #include "tools/Communicator.h"
 #include "core/ActionRegister.h"
 #include "core/PlumedMain.h"
+#include "core/ActionSet.h"
+
+#include <map>
 
 namespace PLMD {
 namespace function {
@@ -43,6 +46,10 @@ ens: ENSEMBLE ARG=dist
 PRINT ARG=dist,ens.dist
 \endplumedfile
 
+When there are several ENSEMBLE actions, the values of all the ENSEMBLE actions whose arguments are
+calculated before the first of them are exchanged between the replicas with a single communication.
+Inputs with one ENSEMBLE action per restraint thus do not need a collective communication per action.
+
 */
 //+ENDPLUMEDOC
 
@@ -61,6 +68,18 @@ class Ensemble :
   double   kbt;
   double   moment;
   double   power;
+/// The ENSEMBLE actions whose values are exchanged together with the values of this one (only set for the first of them)
+  std::vector<Ensemble*> batch;
+/// The action that exchanges the values of this one
+  Ensemble* leader;
+/// The arguments of this action on all the replicas, one replica after the other
+  std::vector<double> replicaValues;
+/// True if replicaValues has been filled for this step by the leader
+  bool replicaValuesReady;
+/// Group the ENSEMBLE actions that can exchange their values together
+  void setupBatch();
+/// Exchange the arguments of a set of ENSEMBLE actions between the replicas with a single collective communication
+  static void exchange( const std::vector<Ensemble*>& actions );
 public:
   explicit Ensemble(const ActionOptions&);
   std::string getOutputComponentDescription( const std::string& cname, const Keywords& keys ) const override ;
@@ -90,7 +109,9 @@ Ensemble::Ensemble(const ActionOptions&ao):
   do_powers(false),
   kbt(-1.0),
   moment(0),
-  power(0)
+  power(0),
+  leader(NULL),
+  replicaValuesReady(false)
 {
   parseFlag("REWEIGHT", do_reweight);
   if(do_reweight) {
@@ -156,25 +177,71 @@ std::string Ensemble::getOutputComponentDescription( const std::string& cname, c
 }
 
 
+void Ensemble::setupBatch() {
+  // Each ENSEMBLE action that is not part of a batch starts a new one, which also includes the
+  // ENSEMBLE actions that follow it and whose arguments are all calculated before it
+  std::map<const Action*,unsigned> position; unsigned k=0;
+  for(const auto & a : plumed.getActionSet()) position[a.get()]=k++;
+  std::vector<Ensemble*> all=plumed.getActionSet().select<Ensemble*>();
+  for(unsigned i=0; i<all.size(); ++i) {
+    if( all[i]->leader ) continue;
+    all[i]->leader=all[i]; all[i]->batch.assign( 1, all[i] );
+    for(unsigned j=i+1; j<all.size(); ++j) {
+      if( all[j]->leader ) continue;
+      bool before=true;
+      for(unsigned n=0; n<all[j]->getNumberOfArguments(); ++n) {
+        const Action* a=all[j]->getPntrToArgument(n)->getPntrToAction();
+        if( position[a]>=position[all[i]] ) { before=false; break; }
+      }
+      if( before ) { all[j]->leader=all[i]; all[i]->batch.push_back( all[j] ); }
+    }
+    if( all[i]->batch.size()>1 ) all[i]->log.printf("  exchanging the values of %zu ENSEMBLE actions between replicas with a single communication\n", all[i]->batch.size() );
+  }
+}
+
+void Ensemble::exchange( const std::vector<Ensemble*>& actions ) {
+  Ensemble* first=actions[0]; const unsigned ens_dim=first->ens_dim;
+  unsigned ntot=0; for(const auto & e : actions) ntot+=e->getNumberOfArguments();
+  std::vector<double> local( ntot ), all( ntot*ens_dim, 0.0 );
+  if( first->master ) {
+    unsigned k=0;
+    for(const auto & e : actions) for(unsigned i=0; i<e->getNumberOfArguments(); ++i) local[k++]=e->getArgument(i);
+    if( ens_dim>1 ) first->multi_sim_comm.Allgather( local, all );
+    else all=local;
+  }
+  first->comm.Sum( all );
+  unsigned start=0;
+  for(const auto & e : actions) {
+    const unsigned n=e->getNumberOfArguments(); e->replicaValues.resize( ens_dim*n );
+    for(unsigned r=0; r<ens_dim; ++r) for(unsigned i=0; i<n; ++i) e->replicaValues[r*n+i]=all[r*ntot+start+i];
+    e->replicaValuesReady=true; start+=n;
+  }
+}
+
 void Ensemble::calculate() {
+  if( !leader ) setupBatch();
+  if( leader==this ) {
+    // The values of the actions in the batch that are calculated at this step are exchanged now
+    std::vector<Ensemble*> active;
+    for(const auto & e : batch) if( e==this || e->isActive() ) active.push_back( e );
+    exchange( active );
+  } else if( !replicaValuesReady ) exchange( std::vector<Ensemble*>( 1, this ) );
+  replicaValuesReady=false;
+  const unsigned nvals=getNumberOfArguments();
+
   double norm = 0.0;
   double fact = 0.0;
 
   // calculate the weights either from BIAS
+  std::vector<double> weight(ens_dim,1.0);
   if(do_reweight) {
-    std::vector<double> bias;
-    bias.resize(ens_dim);
-    if(master) {
-      bias[my_repl] = getArgument(narg);
-      if(ens_dim>1) multi_sim_comm.Sum(&bias[0], ens_dim);
+    double maxbias=replicaValues[narg];
+    for(unsigned r=1; r<ens_dim; ++r) maxbias=std::max( maxbias, replicaValues[r*nvals+narg] );
+    for(unsigned r=0; r<ens_dim; ++r) {
+      weight[r] = exp((replicaValues[r*nvals+narg]-maxbias)/kbt);
+      norm += weight[r];
     }
-    comm.Sum(&bias[0], ens_dim);
-    const double maxbias = *(std::max_element(bias.begin(), bias.end()));
-    for(unsigned i=0; i<ens_dim; ++i) {
-      bias[i] = exp((bias[i]-maxbias)/kbt);
-      norm += bias[i];
-    }
-    fact = bias[my_repl]/norm;
+    fact = weight[my_repl]/norm;
     // or arithmetic ones
   } else {
     norm = static_cast<double>(ens_dim);
@@ -183,54 +250,30 @@ void Ensemble::calculate() {
 
   const double fact_kbt = fact/kbt;
 
-  std::vector<double> mean(narg);
+  std::vector<double> mean(narg,0.0);
   std::vector<double> dmean(narg,fact);
   // calculate the mean
-  if(master) {
-    for(unsigned i=0; i<narg; ++i) mean[i] = fact*getArgument(i);
-    if(ens_dim>1) multi_sim_comm.Sum(&mean[0], narg);
+  for(unsigned r=0; r<ens_dim; ++r) {
+    for(unsigned i=0; i<narg; ++i) mean[i] += weight[r]/norm*replicaValues[r*nvals+i];
   }
-  comm.Sum(&mean[0], narg);
 
   std::vector<double> v_moment, dv_moment;
   // calculate other moments
   if(do_moments) {
-    v_moment.resize(narg);
+    v_moment.assign(narg,0.0);
     dv_moment.resize(narg);
-    // standard moment
-    if(!do_central) {
-      if(master) {
-        for(unsigned i=0; i<narg; ++i) {
-          const double tmp = fact*std::pow(getArgument(i),moment-1);
-          v_moment[i]      = tmp*getArgument(i);
-          dv_moment[i]     = moment*tmp;
-        }
-        if(ens_dim>1) multi_sim_comm.Sum(&v_moment[0], narg);
-      } else {
-        for(unsigned i=0; i<narg; ++i) {
-          const double tmp = fact*std::pow(getArgument(i),moment-1);
-          dv_moment[i]     = moment*tmp;
-        }
-      }
-      // central moment
-    } else {
-      if(master) {
-        for(unsigned i=0; i<narg; ++i) {
-          const double tmp = std::pow(getArgument(i)-mean[i],moment-1);
-          v_moment[i]      = fact*tmp*(getArgument(i)-mean[i]);
-          dv_moment[i]     = moment*tmp*(fact-fact/norm);
-        }
-        if(ens_dim>1) multi_sim_comm.Sum(&v_moment[0], narg);
+    for(unsigned i=0; i<narg; ++i) {
+      // standard moment
+      if(!do_central) {
+        for(unsigned r=0; r<ens_dim; ++r) v_moment[i] += weight[r]/norm*std::pow(replicaValues[r*nvals+i],moment);
+        dv_moment[i] = moment*fact*std::pow(getArgument(i),moment-1);
+        // central moment
       } else {
-        for(unsigned i=0; i<narg; ++i) {
-          const double tmp = std::pow(getArgument(i)-mean[i],moment-1);
-          dv_moment[i]     = moment*tmp*(fact-fact/norm);
-        }
+        for(unsigned r=0; r<ens_dim; ++r) v_moment[i] += weight[r]/norm*std::pow(replicaValues[r*nvals+i]-mean[i],moment);
+        dv_moment[i] = moment*std::pow(getArgument(i)-mean[i],moment-1)*(fact-fact/norm);
       }
     }
-    comm.Sum(&v_moment[0], narg);
   }
-
   // calculate powers of moments
   if(do_powers) {
     for(unsigned i=0; i<narg; ++i) {
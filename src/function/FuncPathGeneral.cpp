@@ -89,13 +89,14 @@ class FuncPathGeneral : public Function {
   std::vector<double> coefficients;
   std::vector< std::vector<double> > path_cv_values;
 
-  // For faster calculation
+  // For faster calculation: the squared coefficients and the frames stored one after the other
+  std::vector<double> sqcoefficients;
+  std::vector<double> frames;
   std::vector<double> expdists;
 
-  // For calculating derivatives
-  std::vector< std::vector<double> > numerators;
-  std::vector<double> s_path_ders;
-  std::vector<double> z_path_ders;
+  // For calculating derivatives: the differences between the CVs and each frame
+  std::vector<double> differences;
+  std::vector<double> cvs, s_ders, z_ders;
 
   // For handling periodicity
   std::vector<double> domains;
@@ -207,13 +208,17 @@ FuncPathGeneral::FuncPathGeneral(const ActionOptions&ao):
   addComponentWithDerivatives("z"); componentIsNotPeriodic("z");
 
   // Initialise vectors
-  std::vector<double> temp (coefficients.size());
+  const unsigned ncv = coefficients.size();
   for (unsigned i = 0; i < path_cv_values.size(); ++i) {
-    numerators.push_back(temp);
-    expdists.push_back(0.);
-    s_path_ders.push_back(0.);
-    z_path_ders.push_back(0.);
+    if (path_cv_values[i].size() != ncv)
+      plumed_merror("The number of CVs in the reference file is different from the number of coefficients!");
+    frames.insert(frames.end(), path_cv_values[i].begin(), path_cv_values[i].end());
   }
+  for (unsigned j = 0; j < ncv; ++j)
+    sqcoefficients.push_back(coefficients[j] * coefficients[j]);
+  expdists.resize(path_cv_values.size());
+  differences.resize(path_cv_values.size() * ncv);
+  cvs.resize(ncv); s_ders.resize(ncv); z_ders.resize(ncv);
 
   // Store the arguments
   for (unsigned i=0; i<getNumberOfArguments(); i++)
@@ -233,16 +238,9 @@ FuncPathGeneral::FuncPathGeneral(const ActionOptions&ao):
 
 // Calculator
 void FuncPathGeneral::calculate() {
+  const unsigned ncv = coefficients.size();
   double s_path = 0.;
   double partition = 0.;
-  double tmp, value, diff, expdist, s_der, z_der;
-  int ii;
-
-  typedef std::vector< std::pair< int,double> >::iterator pairiter;
-
-  for (pairiter it = neighpair.begin(); it != neighpair.end(); ++it) {
-    (*it).second = 0.;
-  }
 
   if (neighpair.empty()) {
     // Resize at the first step
@@ -254,51 +252,58 @@ void FuncPathGeneral::calculate() {
   Value* val_s_path=getPntrToComponent("s");
   Value* val_z_path=getPntrToComponent("z");
 
-  for(unsigned j = 0; j < allArguments.size(); ++j) {
-    value = allArguments[j]->get();
-    for (pairiter it = neighpair.begin(); it != neighpair.end(); ++it) {
-      diff = (value - path_cv_values[(*it).first][j]);
+  for (unsigned j = 0; j < ncv; ++j)
+    cvs[j] = allArguments[j]->get();
+
+  // Distances from the frames in the neighbour list, each frame is contiguous in memory
+  double maxexponent = -std::numeric_limits<double>::max();
+  for (auto & np : neighpair) {
+    const double* ref = frames.data() + np.first * ncv;
+    double* diff = differences.data() + np.first * ncv;
+    double dist = 0.;
+    for (unsigned j = 0; j < ncv; ++j) {
+      double d = cvs[j] - ref[j];
       if (domains[j] > 0) {
-        if (diff > domains[j])
-          diff -= 2 * domains[j];
-        if (diff < -domains[j])
-          diff += 2 * domains[j];
+        if (d > domains[j])
+          d -= 2 * domains[j];
+        if (d < -domains[j])
+          d += 2 * domains[j];
       }
-      (*it).second += Tools::fastpow(coefficients[j] * diff, 2);
-      numerators[(*it).first][j] = 2 * Tools::fastpow(coefficients[j], 2) * diff;
+      diff[j] = d;
+      dist += sqcoefficients[j] * d * d;
     }
+    np.second = dist;
+    maxexponent = std::max(maxexponent, -lambda * dist);
   }
 
-  for (pairiter it = neighpair.begin(); it != neighpair.end(); ++it) {
-    expdist = std::exp(-lambda * (*it).second);
-    expdists[(*it).first] = expdist;
-    s_path += ((*it).first + 1) * expdist;
+  // The exponentials are shifted by the largest exponent (log-sum-exp) so that the partition function cannot underflow
+  for (const auto & np : neighpair) {
+    const double expdist = std::exp(-lambda * np.second - maxexponent);
+    expdists[np.first] = expdist;
+    s_path += (np.first + 1) * expdist;
     partition += expdist;
   }
 
-  if(partition==0.0) partition=std::numeric_limits<double>::min();
-
   s_path /= partition;
   val_s_path->set(s_path);
-  val_z_path->set(-(1. / lambda) * std::log(partition));
+  val_z_path->set(-(1. / lambda) * (maxexponent + std::log(partition)));
 
   // Derivatives
-  for (pairiter it = neighpair.begin(); it != neighpair.end(); ++it) {
-    ii = (*it).first;
-    tmp = lambda * expdists[ii] * (s_path - (ii + 1)) / partition;
-    s_path_ders[ii] = tmp;
-    z_path_ders[ii] = expdists[ii] / partition;
-  }
-  for (unsigned i = 0; i < coefficients.size(); ++i) {
-    s_der = 0.;
-    z_der = 0.;
-    for (pairiter it = neighpair.begin(); it != neighpair.end(); ++it) {
-      ii = (*it).first;
-      s_der += s_path_ders[ii] * numerators[ii][i];
-      z_der += z_path_ders[ii] * numerators[ii][i];
+  std::fill(s_ders.begin(), s_ders.end(), 0.);
+  std::fill(z_ders.begin(), z_ders.end(), 0.);
+  for (const auto & np : neighpair) {
+    const int ii = np.first;
+    const double s_der = lambda * expdists[ii] * (s_path - (ii + 1)) / partition;
+    const double z_der = expdists[ii] / partition;
+    const double* diff = differences.data() + ii * ncv;
+    for (unsigned j = 0; j < ncv; ++j) {
+      s_ders[j] += s_der * diff[j];
+      z_ders[j] += z_der * diff[j];
     }
-    setDerivative(val_s_path, i, s_der);
-    setDerivative(val_z_path, i, z_der);
+  }
+  for (unsigned i = 0; i < ncv; ++i) {
+    setDerivative(val_s_path, i, 2 * sqcoefficients[i] * s_ders[i]);
+    setDerivative(val_z_path, i, 2 * sqcoefficients[i] * z_ders[i]);
   }
 }
 
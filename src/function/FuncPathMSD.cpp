@@ -22,6 +22,7 @@
 
 #include "Function.h"
 #include "core/ActionRegister.h"
+#include <limits>
 
 namespace PLMD {
 namespace function {
@@ -172,6 +173,7 @@ class FuncPathMSD : public Function {
   std::vector< std::pair<Value *,double> > neighpair;
   std::map<Value *,double > indexmap; // use double to allow isomaps
   std::vector <Value*> allArguments;
+  std::vector<double> neighindex; // the index of each element of neighpair
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // this below is useful when one wants to sort a vector of double and have back the order
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -282,18 +284,25 @@ void FuncPathMSD::calculate() {
   Value* val_s_path=getPntrToComponent("s");
   Value* val_z_path=getPntrToComponent("z");
 
-  for(auto & it : neighpair) {
-    it.second=std::exp(-lambda*(it.first->get()));
-    s_path+=(indexmap[it.first])*it.second;
-    partition+=it.second;
+  // the exponentials are shifted by the largest exponent (log-sum-exp) so that the partition function cannot underflow
+  double maxexponent=-std::numeric_limits<double>::max();
+  neighindex.resize(neighpair.size());
+  for(unsigned n=0; n<neighpair.size(); ++n) {
+    neighindex[n]=indexmap[neighpair[n].first];
+    maxexponent=std::max(maxexponent,-lambda*neighpair[n].first->get());
+  }
+  for(unsigned n=0; n<neighpair.size(); ++n) {
+    neighpair[n].second=std::exp(-lambda*neighpair[n].first->get()-maxexponent);
+    s_path+=neighindex[n]*neighpair[n].second;
+    partition+=neighpair[n].second;
   }
   s_path/=partition;
   val_s_path->set(s_path);
-  val_z_path->set(-(1./lambda)*std::log(partition));
+  val_z_path->set(-(1./lambda)*(maxexponent+std::log(partition)));
   int n=0;
   for(const auto & it : neighpair) {
     double expval=it.second;
-    double tmp=lambda*expval*(s_path-(indexmap[it.first]))/partition;
+    double tmp=lambda*expval*(s_path-neighindex[n])/partition;
     setDerivative(val_s_path,n,tmp);
     setDerivative(val_z_path,n,expval/partition);
     n++;
@@ -29,6 +29,7 @@
 #include "tools/Tools.h"
 #include "tools/Stopwatch.h"
 #include "tools/Grid.h"
+#include "tools/HillsBinaryFile.h"
 
 namespace PLMD {
 namespace function {
@@ -51,15 +52,20 @@ There are currently no examples for this keyword.
 class FilesHandler {
   std::vector <std::string> filenames;
   std::vector <std::unique_ptr<IFile>>  ifiles;
+/// the files written with BINARY_FILE in METAD are read with these
+  std::vector <std::unique_ptr<HillsBinaryFile>> bfiles;
   Action *action;
   Log *log;
   bool parallelread;
   unsigned beingread;
   bool isopen;
+  void openFile(BiasRepresentation *br, unsigned i);
+  void closeFile(unsigned i);
 public:
   FilesHandler(const std::vector<std::string> &filenames, const bool &parallelread,  Action &myaction, Log &mylog);
   bool readBunch(BiasRepresentation *br, int stride);
   bool scanOneHill(BiasRepresentation *br, IFile *ifile );
+  bool scanOneHill(BiasRepresentation *br, HillsBinaryFile *bfile );
   void getMinMaxBin(const std::vector<Value*> & vals, Communicator &cc, std::vector<double> &vmin, std::vector<double> &vmax, std::vector<unsigned> &vbin);
   void getMinMaxBin(const std::vector<Value*> & vals, Communicator &cc, std::vector<double> &vmin, std::vector<double> &vmax, std::vector<unsigned> &vbin, const std::vector<double> &histosigma);
 };
@@ -70,10 +76,38 @@ FilesHandler::FilesHandler(const std::vector<std::string> &filenames, const bool
     ifile->link(action);
     plumed_massert((ifile->FileExist(filenames[i])), "the file "+filenames[i]+" does not exist " );
     ifiles.emplace_back(std::move(ifile));
+    if(HillsBinaryFile::isBinary(filenames[i])) bfiles.emplace_back(Tools::make_unique<HillsBinaryFile>());
+    else bfiles.emplace_back(nullptr);
   }
 
 }
 
+void FilesHandler::openFile(BiasRepresentation *br, unsigned i) {
+  (*log)<<"  opening file "<<filenames[i]<<"\n";
+  if(!bfiles[i]) { ifiles[i]->open(filenames[i]); isopen=true; return; }
+  plumed_massert(!br->hasSigmaInInput(),"binary hills file "+filenames[i]+" cannot be used to build a histogram");
+  bfiles[i]->open(filenames[i]);
+  const std::vector<HillsBinaryFile::Variable>& vars=bfiles[i]->getVariables();
+  plumed_massert(vars.size()==br->getNumberOfDimensions(),"number of variables in binary hills file "+filenames[i]+" does not match input");
+  for(unsigned j=0; j<vars.size(); ++j) {
+    Value* val=br->getPtrToValue(j);
+    plumed_massert(vars[j].name==br->getName(j),"variable "+vars[j].name+" in binary hills file "+filenames[i]+" does not match input");
+    plumed_massert(vars[j].periodic==val->isPeriodic(),"the input periodicity in hills and in value definition does not match");
+    if(vars[j].periodic) {
+      std::string mini,maxi; val->getDomain(mini,maxi);
+      plumed_massert(mini==vars[j].min && maxi==vars[j].max,"the input periodicity in hills and in value definition does not match");
+    }
+  }
+  isopen=true;
+}
+
+void FilesHandler::closeFile(unsigned i) {
+  (*log)<<"  closing file "<<filenames[i]<<"\n";
+  if(bfiles[i]) bfiles[i]->close();
+  else ifiles[i]->close();
+  isopen=false;
+}
+
 // note that the FileHandler is completely transparent respect to the biasrepresentation
 // no check are made at this level
 bool FilesHandler::readBunch(BiasRepresentation *br, int stride = -1) {
@@ -85,16 +119,11 @@ bool FilesHandler::readBunch(BiasRepresentation *br, int stride = -1) {
     (*log)<<"  doing serialread \n";
     // read one by one hills
     // is the type defined? if not, assume it is a gaussian
-    IFile *ff;
-    ff=ifiles[beingread].get();
-    if(!isopen) {
-      (*log)<<"  opening file "<<filenames[beingread]<<"\n";
-      ff->open(filenames[beingread]); isopen=true;
-    }
+    if(!isopen) openFile(br,beingread);
     int n=0;
     while(true) {
       bool fileisover=true;
-      while(scanOneHill(br,ff)) {
+      while(bfiles[beingread] ? scanOneHill(br,bfiles[beingread].get()) : scanOneHill(br,ifiles[beingread].get())) {
         // here do the dump if needed
         n=br->getNumberOfKernels();
         if(stride>0 && n%stride==0 && n!=0  ) {
@@ -104,15 +133,11 @@ bool FilesHandler::readBunch(BiasRepresentation *br, int stride = -1) {
         }
       }
       if(fileisover) {
-        (*log)<<"  closing file "<<filenames[beingread]<<"\n";
-        ff->close();
-        isopen=false;
+        closeFile(beingread);
         (*log)<<"  now total "<<br->getNumberOfKernels()<<" kernels \n";
         beingread++;
         if(beingread<ifiles.size()) {
-          ff=ifiles[beingread].get(); ff->open(filenames[beingread]);
-          (*log)<<"  opening file "<<filenames[beingread]<<"\n";
-          isopen=true;
+          openFile(br,beingread);
         } else {
           morefiles=false;
           (*log)<<"  final chunk: now with "<<n<<" kernels  \n";
@@ -161,6 +186,33 @@ bool FilesHandler::scanOneHill(BiasRepresentation *br, IFile *ifile ) {
   }
 }
 
+bool FilesHandler::scanOneHill(BiasRepresentation *br, HillsBinaryFile *bfile ) {
+  HillsBinaryFile::Record rec;
+  if(!bfile->read(rec)) return false;
+  unsigned ncv=br->getNumberOfDimensions();
+  std::unique_ptr<KernelFunctions> kk;
+  if(!rec.multivariate) {
+    std::vector<double> sig(rec.sigma.begin(),rec.sigma.begin()+ncv);
+    kk=Tools::make_unique<KernelFunctions>(rec.center,sig,"stretched-gaussian","DIAGONAL",rec.height);
+  } else {
+    // the widths are the elements of the cholesky factor in the same band order used in the text files
+    Matrix<double> upper(ncv,ncv), lower(ncv,ncv), mymult(ncv,ncv), invmatrix(ncv,ncv);
+    unsigned k=0;
+    for(unsigned i=0; i<ncv; ++i) {
+      for(unsigned j=0; j<ncv-i; j++) { lower(j+i,j)=upper(j,j+i)=rec.sigma[k]; k++; }
+    }
+    mult(lower,upper,mymult);
+    Invert(mymult,invmatrix);
+    std::vector<double> sig; sig.reserve((ncv*(ncv+1))/2);
+    for(unsigned i=0; i<ncv; i++) {
+      for(unsigned j=i; j<ncv; j++) sig.push_back(invmatrix(i,j));
+    }
+    kk=Tools::make_unique<KernelFunctions>(rec.center,sig,"stretched-gaussian","MULTIVARIATE",rec.height);
+  }
+  br->pushKernel(std::move(kk),rec.biasf);
+  return true;
+}
+
 
 double  mylog( double v1 ) {
   return std::log(v1);
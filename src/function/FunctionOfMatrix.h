@@ -43,6 +43,8 @@ private:
   std::vector<bool> stored_arguments;
 /// Switch off updating the arguments for this action
   std::vector<bool> update_arguments;
+/// The storage for the calls to myfunc.calc on each thread
+  mutable std::vector<FunctionWorkspace> workspaces;
 /// The list of actiosn in this chain
   std::vector<std::string> actionsLabelsInChain;
 /// Get the shape of the output matrix
@@ -96,7 +98,8 @@ template <class T>
 FunctionOfMatrix<T>::FunctionOfMatrix(const ActionOptions&ao):
   Action(ao),
   ActionWithMatrix(ao),
-  firststep(true)
+  firststep(true),
+  workspaces(OpenMP::getNumThreads())
 {
   if( myfunc.getArgStart()>0 ) error("this has not beeen implemented -- if you are interested email gareth.tribello@gmail.com");
   // Get the shape of the output
@@ -266,7 +269,9 @@ void FunctionOfMatrix<T>::setupStreamedComponents( const std::string& headstr, u
 
 template <class T>
 void FunctionOfMatrix<T>::performTask( const std::string& controller, const unsigned& index1, const unsigned& index2, MultiValue& myvals ) const {
-  unsigned argstart=myfunc.getArgStart(); std::vector<double> args( getNumberOfArguments() - argstart );
+  unsigned argstart=myfunc.getArgStart(); FunctionWorkspace& ws( workspaces[OpenMP::getThreadNum()] );
+  ws.reset( getNumberOfArguments()-argstart, getNumberOfComponents() );
+  std::vector<double>& args( ws.args ); std::vector<double>& vals( ws.vals ); Matrix<double>& derivatives( ws.derivatives );
   unsigned ind2 = index2;
   if( getConstPntrToComponent(0)->getRank()==2 && index2>=getConstPntrToComponent(0)->getShape()[0] ) ind2 = index2 - getConstPntrToComponent(0)->getShape()[0];
   else if( index2>=getPntrToArgument(0)->getShape()[0] ) ind2 = index2 - getPntrToArgument(0)->getShape()[0];
@@ -283,7 +288,6 @@ void FunctionOfMatrix<T>::performTask( const std::string& controller, const unsi
     }
   }
   // Calculate the function and its derivatives
-  std::vector<double> vals( getNumberOfComponents() ); Matrix<double> derivatives( getNumberOfComponents(), getNumberOfArguments()-argstart );
   myfunc.calc( this, args, vals, derivatives );
   // And set the values
   for(unsigned i=0; i<vals.size(); ++i) myvals.addValue( getConstPntrToComponent(i)->getPositionInStream(), vals[i] );
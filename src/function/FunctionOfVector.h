@@ -26,6 +26,7 @@
 //#include "core/CollectFrames.h"
 #include "core/ActionSetup.h"
 #include "tools/Matrix.h"
+#include "tools/OpenMP.h"
 #include "Sum.h"
 
 namespace PLMD {
@@ -38,12 +39,23 @@ private:
   bool doAtEnd;
 /// Is this the first time we are doing the calc
   bool firststep;
+/// Are we summing the elements of the output vector
+  bool sumelements;
 /// The function that is being computed
   T myfunc;
 /// The number of derivatives for this action
   unsigned nderivatives;
 /// A vector that tells us if we have stored the input value
   std::vector<bool> stored_arguments;
+/// The storage for the calls to myfunc.calc on each thread
+  mutable std::vector<FunctionWorkspace> workspaces;
+/// Are the values and derivatives taken from the ones computed by calculateInBlocks
+  bool use_blocks;
+/// Arguments, values and derivatives of all the elements computed by calculateInBlocks
+  std::vector<double> block_args, block_values, block_derivatives;
+/// Evaluate the function on all the elements with myfunc.calcBlock before running the tasks.
+/// Returns false if the function cannot be evaluated in blocks
+  bool calculateInBlocks();
 public:
   static void registerKeywords(Keywords&);
 /// This method is used to run the calculation with functions such as highest/lowest and sort.
@@ -66,6 +78,7 @@ public:
   std::string writeInGraph() const override { return myfunc.getGraphInfo( getName() ); }
 /// This builds the task list for the action
   void calculate() override;
+  bool canDeferReduction() const override { return true; }
 /// This ensures that we create some bookeeping stuff during the first step
   void setupStreamedComponents( const std::string& headstr, unsigned& nquants, unsigned& nmat, unsigned& maxcol, unsigned& nbookeeping ) override ;
 /// Calculate the function
@@ -80,6 +93,9 @@ void FunctionOfVector<T>::registerKeywords(Keywords& keys ) {
   keys.reserve("compulsory","PERIODIC","if the output of your function is periodic then you should specify the periodicity of the function.  If the output is not periodic you must state this using PERIODIC=NO");
   keys.add("hidden","NO_ACTION_LOG","suppresses printing from action on the log");
   T tfunc; tfunc.registerKeywords( keys );
+  if( keys.outputComponentExists(".#!value") && keys.getDisplayName()!="SUM" && keys.getDisplayName()!="MEAN" ) {
+    keys.addFlag("SUM_ELEMENTS",false,"output the sum of the elements of the vector that is obtained by applying the function.  The sum is accumulated as each element is computed so the vector is never stored");
+  }
   if( keys.getDisplayName()=="SUM" ) {
     keys.setValueDescription("scalar","the sum of all the elements in the input vector");
   } else if( keys.getDisplayName()=="MEAN" ) {
@@ -91,7 +107,7 @@ void FunctionOfVector<T>::registerKeywords(Keywords& keys ) {
   } else if( keys.getDisplayName()=="SORT" ) {
     keys.setValueDescription("vector","a vector that has been sorted into ascending order");
   } else if( keys.outputComponentExists(".#!value") ) {
-    keys.setValueDescription("vector","the vector obtained by doing an element-wise application of " + keys.getOutputComponentDescription(".#!value") + " to the input vectors");
+    keys.setValueDescription("scalar/vector","the vector obtained by doing an element-wise application of " + keys.getOutputComponentDescription(".#!value") + " to the input vectors or the sum of the elements of this vector if SUM_ELEMENTS is used");
   }
 }
 
@@ -101,12 +117,17 @@ FunctionOfVector<T>::FunctionOfVector(const ActionOptions&ao):
   ActionWithVector(ao),
   doAtEnd(true),
   firststep(true),
-  nderivatives(0)
+  sumelements(false),
+  nderivatives(0),
+  workspaces(OpenMP::getNumThreads()),
+  use_blocks(false)
 {
   // Get the shape of the output
   std::vector<unsigned> shape(1); shape[0]=getNumberOfFinalTasks();
   // Read the input and do some checks
   myfunc.read( this );
+  if( keywords.exists("SUM_ELEMENTS") ) parseFlag("SUM_ELEMENTS",sumelements);
+  if( sumelements && (myfunc.zeroRank() || !myfunc.doWithTasks() || myfunc.getComponentsPerLabel().size()>0) ) error("SUM_ELEMENTS can only be used for functions that output a single vector");
   // Create the task list
   if( myfunc.doWithTasks() ) {
     doAtEnd=false; if( shape[0]>0 ) done_in_chain=true;
@@ -132,11 +153,12 @@ FunctionOfVector<T>::FunctionOfVector(const ActionOptions&ao):
           else addComponent( getPntrToArgument(i)->getName() + components[i], shape );
         }
       }
-    } else if( components[i]==".#!value" && myfunc.zeroRank() ) addValueWithDerivatives();
+    } else if( components[i]==".#!value" && (myfunc.zeroRank() || sumelements) ) addValueWithDerivatives();
     else if( components[i]==".#!value" ) addValue(shape);
     else if( myfunc.zeroRank() ) addComponentWithDerivatives( components[i] );
     else addComponent( components[i], shape );
   }
+  if( sumelements && (getNumberOfComponents()!=1 || getPntrToComponent(0)->getRank()!=0) ) error("SUM_ELEMENTS can only be used for functions that output a single vector");
   // Check if we can turn off the derivatives when they are zero
   if( myfunc.getDerivativeZeroIfValueIsZero() )  {
     for(int i=0; i<getNumberOfComponents(); ++i) getPntrToComponent(i)->setDerivativeIsZeroWhenValueIsZero();
@@ -159,6 +181,14 @@ FunctionOfVector<T>::FunctionOfVector(const ActionOptions&ao):
     if( getPntrToArgument(i)->getRank()==0 ) {
       FunctionOfVector<Sum>* as = dynamic_cast<FunctionOfVector<Sum>*>( getPntrToArgument(i)->getPntrToAction() );
       if(as) done_in_chain=false;
+      // Scalars that are accumulated in a chain are only available once the whole chain has been run
+      ActionWithVector* sv=dynamic_cast<ActionWithVector*>( getPntrToArgument(i)->getPntrToAction() );
+      if( sv && sv->actionInChain() ) {
+        for(unsigned j=argstart; j<getNumberOfArguments(); ++j) {
+          ActionWithVector* vv=dynamic_cast<ActionWithVector*>( getPntrToArgument(j)->getPntrToAction() );
+          if( getPntrToArgument(j)->getRank()>0 && vv && vv->getFirstActionInChain()==sv->getFirstActionInChain() ) { done_in_chain=false; break; }
+        }
+      }
     } else {
       ActionWithVector* av=dynamic_cast<ActionWithVector*>( getPntrToArgument(i)->getPntrToAction() );
       if( !av ) done_in_chain=false;
@@ -222,7 +252,9 @@ void FunctionOfVector<T>::setupStreamedComponents( const std::string& headstr, u
 
 template <class T>
 void FunctionOfVector<T>::performTask( const unsigned& current, MultiValue& myvals ) const {
-  unsigned argstart=myfunc.getArgStart(); std::vector<double> args( getNumberOfArguments()-argstart);
+  unsigned argstart=myfunc.getArgStart(); FunctionWorkspace& ws( workspaces[OpenMP::getThreadNum()] );
+  ws.reset( getNumberOfArguments()-argstart, getNumberOfComponents() );
+  std::vector<double>& args( ws.args ); std::vector<double>& vals( ws.vals ); Matrix<double>& derivatives( ws.derivatives );
   if( actionInChain() ) {
     for(unsigned i=argstart; i<getNumberOfArguments(); ++i) {
       if(  getPntrToArgument(i)->getRank()==0 ) args[i-argstart] = getPntrToArgument(i)->get();
@@ -236,8 +268,10 @@ void FunctionOfVector<T>::performTask( const unsigned& current, MultiValue& myva
     }
   }
   // Calculate the function and its derivatives
-  std::vector<double> vals( getNumberOfComponents() ); Matrix<double> derivatives( getNumberOfComponents(), args.size() );
-  myfunc.calc( this, args, vals, derivatives );
+  if( use_blocks ) {
+    vals[0] = block_values[current];
+    if( !doNotCalculateDerivatives() ) for(unsigned j=0; j<args.size(); ++j) derivatives(0,j) = block_derivatives[current*args.size()+j];
+  } else myfunc.calc( this, args, vals, derivatives );
   // And set the values
   for(unsigned i=0; i<vals.size(); ++i) myvals.addValue( getConstPntrToComponent(i)->getPositionInStream(), vals[i] );
   // Return if we are not computing derivatives
@@ -340,18 +374,51 @@ void FunctionOfVector<T>::runSingleTaskCalculation( const Value* arg, ActionWith
   for(unsigned i=0; i<vals.size(); ++i) action->copyOutput(i)->set( vals[i] );
   // Return if we are not computing derivatives
   if( action->doNotCalculateDerivatives() ) return;
-  // Now set the derivatives
+  // Now set the derivatives, only the non-zero ones as the derivatives of the outputs have been cleared
   for(unsigned j=0; j<nv; ++j) {
-    for(unsigned i=0; i<vals.size(); ++i) action->copyOutput(i)->setDerivative( j, derivatives(i,j) );
+    for(unsigned i=0; i<vals.size(); ++i) if( derivatives(i,j)!=0 ) action->copyOutput(i)->setDerivative( j, derivatives(i,j) );
   }
 }
 
+template <class T>
+bool FunctionOfVector<T>::calculateInBlocks() {
+  // Only functions with a single vector output that implement calcBlock are evaluated in blocks
+  if( getNumberOfComponents()!=1 || getPntrToComponent(0)->getRank()!=1 ) return false;
+  if( !myfunc.calcBlock( 0, NULL, NULL, NULL, NULL ) ) return false;
+  unsigned argstart=myfunc.getArgStart(), nargs=getNumberOfArguments()-argstart;
+  unsigned n=getPntrToComponent(0)->getShape()[0];
+  if( nargs==0 || n==0 ) return false;
+  // The arguments are copied in a structure of arrays, scalars are read with a zero stride
+  block_args.resize( nargs*n ); std::vector<const double*> args( nargs ); std::vector<std::size_t> strides( nargs );
+  for(unsigned j=0; j<nargs; ++j) {
+    const Value* myarg=getPntrToArgument(argstart+j); double* dest=block_args.data()+j*n;
+    if( myarg->getRank()==0 ) { dest[0]=myarg->get(); strides[j]=0; }
+    else { for(unsigned k=0; k<n; ++k) dest[k]=myarg->get(k); strides[j]=1; }
+    args[j]=dest;
+  }
+  block_values.resize( n );
+  if( !doNotCalculateDerivatives() ) block_derivatives.resize( n*nargs );
+  unsigned nt=OpenMP::getNumThreads(); if( nt*10>n ) nt=n/10; if( nt==0 ) nt=1;
+  bool done=true;
+  #pragma omp parallel num_threads(nt) reduction(&&:done)
+  {
+    unsigned start, end; getThreadRange( OpenMP::getThreadNum(), nt, n, start, end );
+    std::vector<const double*> myargs( nargs );
+    for(unsigned j=0; j<nargs; ++j) myargs[j]=args[j]+start*strides[j];
+    double* myderivs = doNotCalculateDerivatives() ? NULL : block_derivatives.data()+start*nargs;
+    done = myfunc.calcBlock( end-start, myargs.data(), strides.data(), block_values.data()+start, myderivs );
+  }
+  return done;
+}
+
 template <class T>
 void FunctionOfVector<T>::calculate() {
   // Everything is done elsewhere
   if( actionInChain() ) return;
   // This is done if we are calculating a function of multiple cvs
-  if( !doAtEnd ) runAllTasks();
+  if( !doAtEnd ) {
+    use_blocks=calculateInBlocks(); runAllTasks(); use_blocks=false;
+  }
   // This is used if we are doing sorting actions on a single vector
   else if( !myfunc.doWithTasks() ) runSingleTaskCalculation( getPntrToArgument(0), this, myfunc );
 }
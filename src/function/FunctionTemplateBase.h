@@ -30,6 +30,22 @@
 namespace PLMD {
 namespace function {
 
+/// The arguments, values and derivatives that are passed to FunctionTemplateBase::calc.
+/// FunctionOfVector and FunctionOfMatrix keep one of these for each thread so nothing is allocated for each element
+class FunctionWorkspace {
+public:
+  std::vector<double> args;
+  std::vector<double> vals;
+  Matrix<double> derivatives;
+/// Set the sizes and zero the values and the derivatives
+  void reset( const unsigned nargs, const unsigned nvals ) {
+    if( args.size()!=nargs ) args.resize( nargs );
+    vals.assign( nvals, 0.0 );
+    if( derivatives.nrows()!=nvals || derivatives.ncols()!=nargs ) derivatives.resize( nvals, nargs );
+    derivatives=0.0;
+  }
+};
+
 class FunctionTemplateBase {
 protected:
 /// Are we using derivatives
@@ -60,6 +76,10 @@ public:
   virtual unsigned getArgStart() const { return 0; }
   virtual void setup( ActionWithValue* action );
   virtual void calc( const ActionWithArguments* action, const std::vector<double>& args, std::vector<double>& vals, Matrix<double>& derivatives ) const = 0;
+/// Evaluate a function with a single output on a block of npoints points.
+/// See LeptonCall::evaluateBlock for the layout of the arguments and of the outputs.
+/// Returns false if the function cannot be evaluated in blocks, in which case calc is used
+  virtual bool calcBlock( std::size_t, const double* const*, const std::size_t*, double*, double* ) const { return false; }
 };
 
 template<class T>
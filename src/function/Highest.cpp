@@ -24,6 +24,7 @@
 #include "FunctionOfScalar.h"
 #include "FunctionOfVector.h"
 #include "FunctionTemplateBase.h"
+#include "tools/OpenMP.h"
 
 namespace PLMD {
 namespace function {
@@ -32,6 +33,9 @@ namespace function {
 /*
 This function can be used to find the highest colvar by magnitude in a set.
 
+When the input is a single long vector the search is divided among the OpenMP threads.
+Only the derivative with respect to the highest element is different from zero.
+
 \par Examples
 
 */
@@ -85,6 +89,8 @@ Calculate the lowest element in a vector of inputs
 class Highest : public FunctionTemplateBase {
 private:
   bool min, scalar_out;
+/// Index of the lowest or highest element in the range [start,end). Ties go to the lowest index
+  unsigned findExtremum( const std::vector<double>& args, unsigned start, unsigned end ) const ;
 public:
   void registerKeywords( Keywords& keys ) override ;
   void read( ActionWithArguments* action ) override;
@@ -117,14 +123,29 @@ void Highest::read( ActionWithArguments* action ) {
   if( scalar_out && action->getPntrToArgument(0)->getRank()==0 ) action->error("sorting a single scalar is trivial");
 }
 
+unsigned Highest::findExtremum( const std::vector<double>& args, unsigned start, unsigned end ) const {
+  if( min ) return std::min_element(args.begin()+start, args.begin()+end) - args.begin();
+  return std::max_element(args.begin()+start, args.begin()+end) - args.begin();
+}
+
 void Highest::calc( const ActionWithArguments* action, const std::vector<double>& args, std::vector<double>& vals, Matrix<double>& derivatives ) const {
-  if( min ) {
-    vals[0] = *std::min_element(args.begin(), args.end());
-    derivatives(0,std::min_element(args.begin(), args.end()) - args.begin()) = 1;
-  } else {
-    vals[0] = *std::max_element(args.begin(), args.end());
-    derivatives(0,std::max_element(args.begin(), args.end()) - args.begin()) = 1;
-  }
+  const unsigned n=args.size(); unsigned ibest;
+  // Long vectors are divided among the threads. This is not done when there is one task per element as the tasks are already parallel
+  unsigned nt=1; if( scalar_out ) { nt=OpenMP::getNumThreads(); if( nt*1000>n ) nt=n/1000; if( nt==0 ) nt=1; }
+  if( nt>1 ) {
+    std::vector<unsigned> best( nt );
+    #pragma omp parallel num_threads(nt)
+    {
+      const unsigned t=OpenMP::getThreadNum(); unsigned start, end;
+      ActionWithVector::getThreadRange( t, nt, n, start, end ); best[t]=findExtremum( args, start, end );
+    }
+    // The ranges are in order, so keeping the first of equal values gives the same element as the serial search
+    ibest=best[0];
+    for(unsigned t=1; t<nt; ++t) {
+      if( min ? args[best[t]]<args[ibest] : args[best[t]]>args[ibest] ) ibest=best[t];
+    }
+  } else ibest=findExtremum( args, 0, n );
+  vals[0] = args[ibest]; derivatives(0,ibest) = 1;
 }
 
 }
@@ -104,6 +104,24 @@ void LessThan::calc( const ActionWithArguments* action, const std::vector<double
   derivatives(0,0) = args[0]*derivatives(0,0);
 }
 
+bool LessThan::calcBlock( std::size_t npoints, const double* const* args, const std::size_t* strides, double* vals, double* derivatives ) const {
+  const double* x=args ? args[0] : NULL;
+  if( squared && npoints>0 && strides[0]==1 ) {
+    // The switching function is evaluated on the whole block with a single virtual call
+    std::vector<double> df; double* dfunc=derivatives;
+    if( !dfunc ) { df.resize( npoints ); dfunc=df.data(); }
+    switchingFunction.calculateSqr( x, vals, dfunc, npoints );
+    if( derivatives ) for(std::size_t k=0; k<npoints; ++k) derivatives[k] *= x[k];
+    return true;
+  }
+  for(std::size_t k=0; k<npoints; ++k) {
+    const double xk=x[k*strides[0]]; double df;
+    vals[k] = squared ? switchingFunction.calculateSqr( xk, df ) : switchingFunction.calculate( xk, df );
+    if( derivatives ) derivatives[k] = xk*df;
+  }
+  return true;
+}
+
 }
 }
 
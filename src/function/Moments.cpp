@@ -24,7 +24,9 @@
 #include "FunctionOfVector.h"
 #include "core/ActionRegister.h"
 #include "FunctionTemplateBase.h"
+#include "tools/OpenMP.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace PLMD {
@@ -34,6 +36,10 @@ namespace function {
 /*
 Calculate the moments of the distribution of input quantities
 
+For non periodic quantities the mean and the central moments are accumulated in a single pass
+over the input values, using updates that remain accurate when the mean is large compared to the spread
+of the values. When the input is a single long vector the values are divided among the OpenMP threads.
+
 \par Examples
 
 */
@@ -57,6 +63,58 @@ Calculate the moments of the distribution of input vectors
 */
 //+ENDPLUMEDOC
 
+/// Mean and sums of the powers of the deviations from the mean, accumulated in a single pass
+/// with the numerically stable updates of P. Pebay, Sandia report SAND2008-6212 (2008).
+/// The sums for two sets of values can be combined, so each thread can work on part of the values.
+class CentralMoments {
+  double n, mean;
+/// sums[p] is the sum of the p-th powers of the deviations from the mean
+  std::vector<double> sums;
+  std::vector<std::vector<double> > binomial;
+public:
+  explicit CentralMoments( const unsigned& maxpow );
+/// Add the values in another set, given their number, mean and sums of powers of the deviations (NULL for a single value)
+  void combine( const double& nb, const double& meanb, const double* sumsb );
+  void add( const double& x ) { combine( 1, x, NULL ); }
+  void add( const CentralMoments& other ) { combine( other.n, other.mean, other.sums.data() ); }
+  double getMean() const { return mean; }
+  const std::vector<double>& getSums() const { return sums; }
+};
+
+CentralMoments::CentralMoments( const unsigned& maxpow ):
+  n(0),
+  mean(0),
+  sums(maxpow+1,0.0),
+  binomial(maxpow+1)
+{
+  for(unsigned p=0; p<=maxpow; ++p) {
+    binomial[p].resize(p+1,1.0);
+    for(unsigned k=1; k<p; ++k) binomial[p][k]=binomial[p-1][k-1]+binomial[p-1][k];
+  }
+}
+
+void CentralMoments::combine( const double& nb, const double& meanb, const double* sumsb ) {
+  if( nb==0 ) return;
+  if( n==0 ) {
+    n=nb; mean=meanb; if( sumsb ) std::copy( sumsb, sumsb+sums.size(), sums.begin() );
+    return;
+  }
+  const double nt=n+nb, delta=meanb-mean, fa=-nb/nt, fb=n/nt, c=n*nb*delta/nt;
+  // The higher sums are updated first as they depend on the lower ones
+  for(unsigned p=sums.size()-1; p>=2; --p) {
+    double s=sums[p] + ( sumsb ? sumsb[p] : 0.0 ), dk=1, fak=1, fbk=1;
+    for(unsigned k=1; k+2<=p; ++k) {
+      dk*=delta; fak*=fa; fbk*=fb;
+      s += binomial[p][k]*dk*( fak*sums[p-k] + ( sumsb ? fbk*sumsb[p-k] : 0.0 ) );
+    }
+    // c^p ( 1/nb^(p-1) - (-1/n)^(p-1) )
+    double cp=c, inb=1, ina=1;
+    for(unsigned q=1; q<p; ++q) { cp*=c; inb/=nb; ina*=-1.0/n; }
+    sums[p] = s + cp*( inb - ina );
+  }
+  mean += delta*nb/nt; n=nt;
+}
+
 class Moments : public FunctionTemplateBase {
   bool isperiodic, scalar_out;
   double min, max, pfactor;
@@ -127,25 +185,51 @@ void Moments::setPeriodicityForOutputs( ActionWithValue* action ) {
 }
 
 void Moments::calc( const ActionWithArguments* action, const std::vector<double>& args, std::vector<double>& vals, Matrix<double>& derivatives ) const {
-  double mean=0; double inorm = 1.0 / static_cast<double>( args.size() );
+  const unsigned n=args.size(), maxpow=*std::max_element( powers.begin(), powers.end() );
+  const double inorm = 1.0 / static_cast<double>( n );
+  // Long vectors are divided among the threads. This is not done when there is one task per element as the tasks are already parallel
+  unsigned nt=1; if( scalar_out ) { nt=OpenMP::getNumThreads(); if( nt*1000>n ) nt=n/1000; if( nt==0 ) nt=1; }
+
+  double mean=0; std::vector<double> sums( maxpow+1, 0.0 );
+  Value* arg0 = action->getPntrToArgument(0);
   if( isperiodic ) {
     double sinsum=0, cossum=0, val;
-    for(unsigned i=0; i<args.size(); ++i) { val=pfactor*( args[i] - min ); sinsum+=sin(val); cossum+=cos(val); }
+    for(unsigned i=0; i<n; ++i) { val=pfactor*( args[i] - min ); sinsum+=sin(val); cossum+=cos(val); }
     mean = 0.5 + atan2( inorm*sinsum, inorm*cossum ) / (2*pi);
     mean = min + (max-min)*mean;
+    // The deviations are only known once the circular mean has been computed
+    for(unsigned i=0; i<n; ++i) {
+      double tmp=arg0->difference( mean, args[i] ), dev=tmp;
+      for(unsigned p=1; p<=maxpow; ++p) { sums[p]+=dev; dev*=tmp; }
+    }
   } else {
-    for(unsigned i=0; i<args.size(); ++i) mean+=args[i];
-    mean *= inorm;
+    std::vector<CentralMoments> partial( nt, CentralMoments( maxpow ) );
+    #pragma omp parallel num_threads(nt)
+    {
+      const unsigned t=OpenMP::getThreadNum(); unsigned start, end;
+      ActionWithVector::getThreadRange( t, nt, n, start, end );
+      for(unsigned i=start; i<end; ++i) partial[t].add( args[i] );
+    }
+    for(unsigned t=1; t<nt; ++t) partial[0].add( partial[t] );
+    mean = partial[0].getMean(); sums = partial[0].getSums();
   }
-
-  Value* arg0 = action->getPntrToArgument(0);
-  for(unsigned npow=0; npow<powers.size(); ++npow) {
-    double dev1=0;
-    for(unsigned i=0; i<args.size(); ++i) dev1+=pow( arg0->difference( mean, args[i] ), powers[npow] - 1 );
-    dev1*=inorm; vals[npow] = 0; double prefactor = powers[npow]*inorm;
-    for(unsigned i=0; i<args.size(); ++i) {
-      double tmp=arg0->difference( mean, args[i] ); vals[npow] += inorm*pow( tmp, powers[npow] );
-      derivatives(npow,i) = prefactor*(pow( tmp, powers[npow] - 1 ) - dev1);
+  for(unsigned npow=0; npow<powers.size(); ++npow) vals[npow] = inorm*sums[powers[npow]];
+
+  const ActionWithValue* av=dynamic_cast<const ActionWithValue*>( action );
+  if( av && av->doNotCalculateDerivatives() ) return;
+  // The derivative of the m-th moment with respect to each value is m/N ( (s_i - mean)^(m-1) - <(s - mean)^(m-1)> )
+  #pragma omp parallel num_threads(nt)
+  {
+    const unsigned t=OpenMP::getThreadNum(); unsigned start, end;
+    ActionWithVector::getThreadRange( t, nt, n, start, end );
+    std::vector<double> devpow( maxpow );
+    for(unsigned i=start; i<end; ++i) {
+      const double tmp=arg0->difference( mean, args[i] ); devpow[0]=1;
+      for(unsigned p=1; p<maxpow; ++p) devpow[p]=devpow[p-1]*tmp;
+      for(unsigned npow=0; npow<powers.size(); ++npow) {
+        const unsigned m=powers[npow];
+        derivatives(npow,i) = m*inorm*( devpow[m-1] - inorm*sums[m-1] );
+      }
     }
   }
 }
@@ -23,6 +23,8 @@
 #include "FunctionTemplateBase.h"
 #include "FunctionShortcut.h"
 #include "FunctionOfScalar.h"
+#include "FunctionOfVector.h"
+#include <algorithm>
 
 namespace PLMD {
 namespace function {
@@ -75,13 +77,27 @@ Compute a piece wise straight line through its arguments that passes through a s
 */
 //+ENDPLUMEDOC
 
+//+PLUMEDOC FUNCTION PIECEWISE_VECTOR
+/*
+Compute a piece wise straight line through each of the elements of the input vectors that passes through a set of ordered control points.
+
+\par Examples
+
+*/
+//+ENDPLUMEDOC
+
 class Piecewise : public FunctionTemplateBase {
   std::vector<std::pair<double,double> > points;
+/// Abscissas of the points, used to find the interval of each argument
+  std::vector<double> abscissas;
+/// For each interval, the slope and the point the straight line passes through. Outside the points the slope is zero
+  std::vector<double> slopes, xref, yref;
 public:
   void registerKeywords(Keywords& keys) override;
   void read( ActionWithArguments* action ) override;
   void setPeriodicityForOutputs( ActionWithValue* action ) override;
   void calc( const ActionWithArguments* action, const std::vector<double>& args, std::vector<double>& vals, Matrix<double>& derivatives ) const override;
+  bool calcBlock( std::size_t npoints, const double* const* args, const std::size_t* strides, double* vals, double* derivatives ) const override;
 };
 
 
@@ -89,11 +105,13 @@ typedef FunctionShortcut<Piecewise> PiecewiseShortcut;
 PLUMED_REGISTER_ACTION(PiecewiseShortcut,"PIECEWISE")
 typedef FunctionOfScalar<Piecewise> ScalarPiecewise;
 PLUMED_REGISTER_ACTION(ScalarPiecewise,"PIECEWISE_SCALAR")
+typedef FunctionOfVector<Piecewise> VectorPiecewise;
+PLUMED_REGISTER_ACTION(VectorPiecewise,"PIECEWISE_VECTOR")
 
 void Piecewise::registerKeywords(Keywords& keys) {
   keys.add("numbered","POINT","This keyword is used to specify the various points in the function above.");
   keys.reset_style("POINT","compulsory");
-  keys.addOutputComponent("_pfunc","default","scalar","one or multiple instances of this quantity can be referenced elsewhere "
+  keys.addOutputComponent("_pfunc","default","scalar/vector","one or multiple instances of this quantity can be referenced elsewhere "
                           "in the input file.  These quantities will be named with the arguments of the "
                           "function followed by the character string _pfunc.  These quantities tell the "
                           "user the values of the piece wise functions of each of the arguments.");
@@ -111,6 +129,14 @@ void Piecewise::read( ActionWithArguments* action ) {
   for(unsigned i=0; i<action->getNumberOfArguments(); i++) {
     if(action->getPntrToArgument(i)->isPeriodic()) action->error("Cannot use PIECEWISE on periodic arguments");
   }
+  // Interval p contains the arguments between the abscissas of points p-1 and p
+  abscissas.resize( points.size() ); slopes.assign( points.size()+1, 0.0 ); xref.assign( points.size()+1, 0.0 ); yref.resize( points.size()+1 );
+  for(unsigned p=0; p<points.size(); ++p) abscissas[p]=points[p].first;
+  yref[0]=points[0].second; yref[points.size()]=points[points.size()-1].second;
+  for(unsigned p=1; p<points.size(); ++p) {
+    slopes[p]=(points[p].second-points[p-1].second) / (points[p].first-points[p-1].first);
+    xref[p]=points[p-1].first; yref[p]=points[p-1].second;
+  }
   action->log.printf("  on points:");
   for(unsigned i=0; i<points.size(); i++) action->log.printf("   (%f,%f)",points[i].first,points[i].second);
   action->log.printf("\n");
@@ -140,6 +166,17 @@ void Piecewise::calc( const ActionWithArguments* action, const std::vector<doubl
   }
 }
 
+bool Piecewise::calcBlock( std::size_t npoints, const double* const* args, const std::size_t* strides, double* vals, double* derivatives ) const {
+  // The interval is found with a binary search, then the same expression is used for all the intervals
+  for(std::size_t k=0; k<npoints; ++k) {
+    const double x=args[0][k*strides[0]];
+    const std::size_t p=std::upper_bound( abscissas.begin(), abscissas.end(), x ) - abscissas.begin();
+    vals[k]=slopes[p]*(x-xref[p])+yref[p];
+    if( derivatives ) derivatives[k]=slopes[p];
+  }
+  return true;
+}
+
 }
 }
 
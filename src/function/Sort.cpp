@@ -24,6 +24,7 @@
 #include "FunctionOfVector.h"
 #include "core/ActionRegister.h"
 #include "FunctionTemplateBase.h"
+#include "tools/OpenMP.h"
 
 namespace PLMD {
 namespace function {
@@ -50,6 +51,17 @@ sort: SORT ARG=d12,d13,d14,d15
 PRINT ARG=sort.1,sort.4
 \endplumedfile
 
+If only a few of the lowest values are needed you can use the NUMBER keyword.
+The following input only calculates the three shortest distances between atom 1 and the other atoms.
+Only these values are put in order, so this is much faster than sorting the whole vector
+when there are many atoms.
+
+\plumedfile
+d: DISTANCE ATOMS1=1,2 ATOMS2=1,3 ATOMS3=1,4 ATOMS4=1,5 ATOMS5=1,6
+sort: SORT ARG=d NUMBER=3
+PRINT ARG=sort.1,sort.2,sort.3
+\endplumedfile
+
 */
 //+ENDPLUMEDOC
 
@@ -75,6 +87,8 @@ class Sort : public FunctionTemplateBase {
 private:
   bool scalar_out;
   unsigned nargs;
+/// Number of values that are output
+  unsigned number;
 public:
   void registerKeywords(Keywords& keys) override ;
   void read( ActionWithArguments* action ) override;
@@ -96,6 +110,7 @@ void Sort::registerKeywords(Keywords& keys) {
   keys.setValueDescription("vector","sorted");
   keys.setComponentsIntroduction("The names of the components in this action will be customized in accordance with the contents of the input file. "
                                  "The largest value is called label.1th, the second largest label.2th, the third label.3th and so on");
+  keys.add("optional","NUMBER","only calculate the NUMBER lowest values rather than sorting all of them");
 }
 
 
@@ -105,18 +120,21 @@ void Sort::read( ActionWithArguments* action ) {
   for(unsigned i=0; i<action->getNumberOfArguments(); ++i) {
     if((action->getPntrToArgument(i))->isPeriodic()) action->error("Cannot sort periodic values (check argument "+ (action->getPntrToArgument(i))->getName() +")");
   }
+  number = nargs; action->parse("NUMBER",number);
+  if( number==0 || number>nargs ) action->error("NUMBER should be between 1 and the number of values to sort");
+  if( number<nargs ) action->log.printf("  only calculating the %u lowest values \n", number );
 }
 
 std::vector<std::string> Sort::getComponentsPerLabel() const {
   std::vector<std::string> comp; std::string num;
-  for(unsigned i=0; i<nargs; ++i) {
+  for(unsigned i=0; i<number; ++i) {
     Tools::convert(i+1,num); comp.push_back( num );
   }
   return comp;
 }
 
 void Sort::setPeriodicityForOutputs( ActionWithValue* action ) {
-  for(unsigned i=0; i<nargs; ++i) { std::string num; Tools::convert(i+1,num); action->componentIsNotPeriodic( num ); }
+  for(unsigned i=0; i<number; ++i) { std::string num; Tools::convert(i+1,num); action->componentIsNotPeriodic( num ); }
 }
 
 void Sort::calc( const ActionWithArguments* action, const std::vector<double>& args, std::vector<double>& vals, Matrix<double>& derivatives ) const {
@@ -126,8 +144,31 @@ void Sort::calc( const ActionWithArguments* action, const std::vector<double>& a
 // In this manner I remember from which argument the component depends:
     data[i].second=i;
   }
+  const unsigned n=data.size(), k=vals.size();
+  // For a single long vector each thread selects the k lowest values in its own range. These candidates
+  // are moved to the front of the vector and the final selection is done on them only
+  unsigned nt=1; if( scalar_out && k<n ) { nt=OpenMP::getNumThreads(); if( nt*1000>n ) nt=n/1000; if( nt==0 ) nt=1; }
+  if( nt>1 ) {
+    std::vector<unsigned> nselected( nt );
+    #pragma omp parallel num_threads(nt)
+    {
+      const unsigned t=OpenMP::getThreadNum(); unsigned start, end;
+      ActionWithVector::getThreadRange( t, nt, n, start, end ); nselected[t]=std::min( k, end-start );
+      std::partial_sort( data.begin()+start, data.begin()+start+nselected[t], data.begin()+end );
+    }
+    unsigned ncandidates=0;
+    for(unsigned t=0; t<nt; ++t) {
+      unsigned start, end; ActionWithVector::getThreadRange( t, nt, n, start, end );
+      for(unsigned i=0; i<nselected[t]; ++i) data[ncandidates+i]=data[start+i];
+      ncandidates+=nselected[t];
+    }
+    data.resize( ncandidates );
+  }
 // STL sort sorts based on first element (value) then second (index)
-  std::sort(data.begin(),data.end()); derivatives = 0;
+// when only the lowest k values are needed the rest of the vector is not sorted
+  if( k<data.size() ) std::partial_sort(data.begin(),data.begin()+k,data.end());
+  else std::sort(data.begin(),data.end());
+  derivatives = 0;
   for(int i=0; i<vals.size(); ++i) { vals[i] = data[i].first; derivatives(i, data[i].second ) = 1; }
 }
 
@@ -171,32 +171,36 @@ void Stats::calculate()
 
   } else {
 
-    double scx=0., scx2=0., scy=0., scy2=0., scxy=0.;
+    /* means and sums of the products of the deviations from the means, accumulated in a single pass
+       with Welford's updates, which do not suffer from the cancellation between large sums of squares */
+    double mx=0., my=0., m2x=0., m2y=0., cxy=0., nsqd=0.;
 
     for(unsigned i=0; i<parameters.size(); ++i) {
       const double tmpx=getArgument(i);
       const double tmpy=parameters[i];
-      scx  += tmpx;
-      scx2 += tmpx*tmpx;
-      scy  += tmpy;
-      scy2 += tmpy*tmpy;
-      scxy += tmpx*tmpy;
+      const double dx=tmpx-mx, dy=tmpy-my, in=1./(i+1);
+      mx += dx*in;
+      my += dy*in;
+      m2x += dx*(tmpx-mx);
+      m2y += dy*(tmpy-my);
+      cxy += dx*(tmpy-my);
+      /* sd */
+      nsqd += (tmpx-tmpy)*(tmpx-tmpy);
     }
 
     const double ns = parameters.size();
+    const double scx = ns*mx, scy = ns*my;
 
-    const double num = ns*scxy - scx*scy;
-    const double idev2x = 1./(ns*scx2-scx*scx);
+    const double num = ns*cxy;
+    const double idev2x = 1./(ns*m2x);
     const double idevx = std::sqrt(idev2x);
-    const double idevy = 1./std::sqrt(ns*scy2-scy*scy);
+    const double idevy = 1./std::sqrt(ns*m2y);
 
-    /* sd */
-    const double nsqd = scx2 + scy2 - 2.*scxy;
     /* correlation */
     const double correlation = num * idevx * idevy;
     /* slope and intercept */
     const double slope = num * idev2x;
-    const double inter = (scy - slope * scx)/ns;
+    const double inter = my - slope * mx;
 
     Value* valuea=getPntrToComponent("sqdevsum");
     Value* valueb=getPntrToComponent("corr");
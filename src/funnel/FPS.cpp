@@ -101,6 +101,17 @@ class FUNNEL_PS : public Colvar {
   bool squared;
 private:
   vector<double> points;
+  // Geometry of the funnel axis and of the reference, fixed at construction
+  Vector p1;
+  Vector s;
+  double s_modulo;
+  double s_modulo2;
+  Vector der_prj;
+  Vector centerreference;
+  // Work buffers reused at every step
+  Matrix<std::vector<Vector> > drotdpos;
+  std::vector<Vector> buffer;
+  std::vector<Vector> sourcePositions;
 public:
   explicit FUNNEL_PS(const ActionOptions&);
 // active methods:
@@ -128,7 +139,10 @@ void FUNNEL_PS::registerKeywords(Keywords& keys) {
 
 FUNNEL_PS::FUNNEL_PS(const ActionOptions&ao):
   PLUMED_COLVAR_INIT(ao),
-  pbc(true),squared(true)
+  pbc(true),squared(true),
+  s_modulo(0.0),
+  s_modulo2(0.0),
+  drotdpos(3,3)
 {
   string reference;
   parse("REFERENCE",reference);
@@ -167,6 +181,20 @@ FUNNEL_PS::FUNNEL_PS(const ActionOptions&ao):
   // reset again to reimpose uniform weights (safe to disable this)
   alignment.set(align,displace,pdb.getPositions(),type,remove_com,normalize_weights);
 
+  // The two points that define the axis
+  p1 = VectorGeneric<3>(points[0],points[1],points[2]);
+  Vector p2 = VectorGeneric<3>(points[3],points[4],points[5]);
+  s = p2 - p1;
+  s_modulo=s.modulo();
+  s_modulo2=s.modulo2();
+  // derivative of the prj: only on the com of the ligand
+  der_prj=s/s_modulo;
+
+  // To Plumed developers: it would be interesting to make the functions to calculate centers of mass public or protected
+  centerreference.zero();
+  for(unsigned i=0; i<pdb.size(); i++) {
+    centerreference+=pdb.getPositions()[i]*align[i]/align.size();
+  }
 
 
   // Array with inside both the structure to align and the atom to be aligned
@@ -195,51 +223,17 @@ void FUNNEL_PS::calculate() {
   if(pbc) makeWhole();
 
   Tensor Rotation;
-  Matrix<std::vector<Vector> > drotdpos(3,3);
-  std::vector<Vector> alignedpos;
-  std::vector<Vector> centeredpos;
-  std::vector<Vector> centeredref;
-  std::vector<Vector> ddistdpos;
-
-  std::vector<Vector> buffer;
-
-  Vector centerreference;
   Vector centerpositions;
 
-  // Created only to give the correct object to calc_FitElements
-  std::vector<Vector> sourceAllPositions;
-  std::vector<Vector> sourcePositions;
-
-  // SourcePositions contains only the coordinates of the COM of the ligand, we need only this point
-  sourceAllPositions=getPositions();
-  sourcePositions=sourceAllPositions;
-  sourcePositions.resize(sourcePositions.size()-2);// just the protein
-
-  // The two points that define the axis : this can be moved in the initialization
-  Vector p1 = VectorGeneric<3>(points[0],points[1],points[2]);
-  Vector p2 = VectorGeneric<3>(points[3],points[4],points[5]);
-  Vector s = p2 - p1;
+  // SourcePositions contains only the coordinates of the protein, the anchor and the ligand are the last two atoms
+  const std::vector<Vector> & allPositions=getPositions();
+  sourcePositions.assign(allPositions.begin(),allPositions.end()-2);
 
   // I call the method calc_FitElements that initializes all feature that I need
-  // except for centerreference that I need to calculate from scratch
+  // except for centerreference, which is computed once in the constructor
   // Buffer has no meaning but I had to fulfill the requirements of calc_FitElements
   double rmsd = alignment.calc_FitElements( sourcePositions, Rotation, drotdpos, buffer, centerpositions, squared);
 
-  // To Plumed developers: it would be interesting to make the functions to calculate centers of mass public or protected
-  centerreference.zero();
-  for(unsigned i=0; i<pdb.size(); i++) {
-    centerreference+=pdb.getPositions()[i]*align[i]/align.size();
-  }
-
-  /*
-  // I cancelled the additional lines in the library of RMSD.h, thus I am missing the center of the reference
-  // Creating variable kito to extract only the center of the reference, since no method is calling
-  // function getReferenceCenter()
-  PLMD::RMSDCoreData* kito; kito = new RMSDCoreData(align,displace,sourcePositions,pdb->getPositions());
-  centerreference = kito->getReferenceCenter();
-  delete kito;
-  */
-
   // DEBUG
   /*    log.printf(" RMSD: %13.6lf\n",rmsd );
       log.printf(" cpos: %13.6lf %13.6lf %13.6lf\n",centerpositions[0],centerpositions[1],centerpositions[2] );
@@ -258,7 +252,8 @@ void FUNNEL_PS::calculate() {
 
   //Projection vector v onto s
 
-  Vector prj = (dotProduct(s,v)/dotProduct(s,s))*s;
+  const double sv=dotProduct(s,v);
+  Vector prj = (sv/s_modulo2)*s;
   const double prj_length = prj.modulo() ;
   const double inv_prj_length = 1.0/prj_length;
 
@@ -266,18 +261,12 @@ void FUNNEL_PS::calculate() {
   const double prj_height = height.modulo() ;
   const double inv_prj_height = 1.0/prj_height;
 
-  // derivative of the prj: only on the com of the ligand
-  Vector der_prj;
-  der_prj=s/s.modulo();
-
   // derivative of the height: only on the com of the ligand
-  Vector der_height(inv_prj_height*(height[0]-(s[0]/s.modulo2())*dotProduct(height,s)),
-                    inv_prj_height*(height[1]-(s[1]/s.modulo2())*dotProduct(height,s)),
-                    inv_prj_height*(height[2]-(s[2]/s.modulo2())*dotProduct(height,s)));
+  Vector der_height=inv_prj_height*(height-(dotProduct(height,s)/s_modulo2)*s);
 
   Value* valuelp=getPntrToComponent("lp");
   Value* valueld=getPntrToComponent("ld");
-  valuelp->set(dotProduct(s,v)/s.modulo()); // this includes the sign
+  valuelp->set(sv/s_modulo); // this includes the sign
   valueld->set(prj_height);
 
   // DEBUG
@@ -286,21 +275,28 @@ void FUNNEL_PS::calculate() {
   setAtomsDerivatives(valuelp,getNumberOfAtoms()-1,matmul(transpose(Rotation),der_prj));
   setAtomsDerivatives(valueld,getNumberOfAtoms()-1,matmul(transpose(Rotation),der_height));
 
-  Vector der_h;
-  Vector der_l;
-  double weight=1./float(getNumberOfAtoms()-2.);
-
-  for(unsigned iat=0; iat<getNumberOfAtoms()-2; iat++) {
-    der_h.zero();
-    der_l.zero();
-    for(unsigned a=0; a<3; a++) {
-      for(unsigned b=0; b<3; b++) {
-        for(unsigned g=0; g<3; g++) {
-          der_h[a]+=der_height[b]*drotdpos[b][g][iat][a]*ligand_centered[g];
-          der_l[a]+=der_prj[b]*drotdpos[b][g][iat][a]*ligand_centered[g];
-        }
-        der_h[a]-=der_height[b]*Rotation[b][a]*weight;
-        der_l[a]-=der_prj[b]*Rotation[b][a]*weight;
+  const unsigned nprot=getNumberOfAtoms()-2;
+  const double weight=1./float(nprot);
+
+  // The coefficients of drotdpos do not depend on the atom
+  double coef_h[3][3], coef_l[3][3];
+  for(unsigned b=0; b<3; b++) {
+    for(unsigned g=0; g<3; g++) {
+      coef_h[b][g]=der_height[b]*ligand_centered[g];
+      coef_l[b][g]=der_prj[b]*ligand_centered[g];
+    }
+  }
+  const Vector com_h=weight*matmul(transpose(Rotation),der_height);
+  const Vector com_l=weight*matmul(transpose(Rotation),der_prj);
+
+  for(unsigned iat=0; iat<nprot; iat++) {
+    Vector der_h=-com_h;
+    Vector der_l=-com_l;
+    for(unsigned b=0; b<3; b++) {
+      for(unsigned g=0; g<3; g++) {
+        const Vector & d=drotdpos[b][g][iat];
+        der_h+=coef_h[b][g]*d;
+        der_l+=coef_l[b][g]*d;
       }
     }
     setAtomsDerivatives(valuelp,iat,der_l);
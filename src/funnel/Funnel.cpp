@@ -120,6 +120,10 @@ private:
   double MAXS;
   double ZCC;
   double scale_;
+  //Analytic evaluation of the potential
+  bool analytic_;
+  bool sphere_;
+  double tg_alpha_;
 
 
 public:
@@ -166,6 +170,8 @@ void Funnel::registerKeywords(Keywords& keys) {
   keys.add("compulsory","ZCC","ZCC","switching point between cylinder and cone");
   keys.add("compulsory","FILE","name of the Funnel potential file");
   keys.addFlag("WALKERS_MPI",false,"To be used when gromacs + multiple walkers are used");
+  keys.addFlag("ANALYTIC",false,"evaluate the funnel-shape restraint directly from its definition instead of interpolating the grid in FILE. "
+               "This gives the values of the grid points exactly and does not need the grid in memory");
 }
 
 // Old version 2.3
@@ -184,8 +190,10 @@ Funnel::Funnel(const ActionOptions& ao):
   RCYL(0.1),
   safety(1.0),
   slope(1.0),
-  ALPHA(1.413)
-
+  ALPHA(1.413),
+  analytic_(false),
+  sphere_(false),
+  tg_alpha_(0.0)
 {
   bool sparsegrid=false;
   parseFlag("SPARSE",sparsegrid);
@@ -198,6 +206,7 @@ Funnel::Funnel(const ActionOptions& ao):
 //  parseFlag("POINTS",components);
   bool sphere=false;
   parseFlag("SPHERE",sphere);
+  parseFlag("ANALYTIC",analytic_);
   parse("SAFETY",safety);
   string file;
   parse("FILE",file);
@@ -218,8 +227,11 @@ Funnel::Funnel(const ActionOptions& ao):
 
 
   checkRead();
+  sphere_=sphere;
+  tg_alpha_=tan(ALPHA);
 
-  log.printf("  External potential from file %s\n",file.c_str());
+  if(analytic_) log.printf("  External potential evaluated analytically (the grid is only written to file %s)\n",file.c_str());
+  else log.printf("  External potential from file %s\n",file.c_str());
   log.printf("  Multiplied by %lf\n",scale_);
   if(spline) {
     log.printf("  External potential uses spline interpolation\n");
@@ -270,13 +282,17 @@ Funnel::Funnel(const ActionOptions& ao):
   comm.Barrier();
 
 // read grid
-  IFile gridfile;
-  gridfile.open(file);
-  BiasGrid_=Grid::create(funcl,getArguments(),gridfile,sparsegrid,spline,true);
+  if(analytic_) {
+    if(getNumberOfArguments()!=2) error("ANALYTIC needs two arguments, fps.lp and fps.ld");
+  } else {
+    IFile gridfile;
+    gridfile.open(file);
+    BiasGrid_=Grid::create(funcl,getArguments(),gridfile,sparsegrid,spline,true);
 //not necessary anymore?  gridfile.close();
-  if(BiasGrid_->getDimension()!=getNumberOfArguments()) error("mismatch between dimensionality of input grid and number of arguments");
-  for(unsigned i=0; i<getNumberOfArguments(); ++i) {
-    if( getPntrToArgument(i)->isPeriodic()!=BiasGrid_->getIsPeriodic()[i] ) error("periodicity mismatch between arguments and input bias");
+    if(BiasGrid_->getDimension()!=getNumberOfArguments()) error("mismatch between dimensionality of input grid and number of arguments");
+    for(unsigned i=0; i<getNumberOfArguments(); ++i) {
+      if( getPntrToArgument(i)->isPeriodic()!=BiasGrid_->getIsPeriodic()[i] ) error("periodicity mismatch between arguments and input bias");
+    }
   }
   comm.Barrier();
   if(comm.Get_rank()==0 && walkers_mpi) multi_sim_comm.Barrier();
@@ -284,6 +300,85 @@ Funnel::Funnel(const ActionOptions& ao):
 }
 
 
+// The funnel-shape restraint at a point (SS,ZZ), i.e. (fps.lp,fps.ld).
+// FS and FZ are the values written in the der_ columns of the grid file.
+static void funnelPotential(const double SS, const double ZZ, const double R_cyl, const double z_cc,
+                            const double tg_alpha, const double KAPPA, const bool sphere, const double slope,
+                            double& POT, double& FS, double& FZ) {
+  double Zmax, D, d;
+  bool cone = false;
+  if (sphere==false) {
+    if(SS <= z_cc) cone = true;
+  }
+  else {
+    if (SS <= sqrt(pow(z_cc,2)-pow(R_cyl,2))) cone = true;
+  }
+  //Set wall boundaries properly
+  if(cone == true) {
+    if(sphere==false) {
+      Zmax = R_cyl + (z_cc - SS) * tg_alpha;
+    }
+    else {
+      if (SS > -z_cc) {
+        Zmax = sqrt(pow(z_cc,2) - pow(SS,2));
+      }
+      else {
+        Zmax = 0;
+      }
+    }
+  }
+  else Zmax = R_cyl;
+  //Inside or outside?
+  bool inside;
+  if(ZZ < Zmax) inside = true;
+  else inside = false;
+
+  if(inside == true) {
+    POT = 0;
+    FS = 0;
+    FZ = 0;
+  }
+  else {
+    if(cone == true) {
+      if(sphere==false) {
+        POT = 0.5 * KAPPA * (ZZ - Zmax) * (ZZ - Zmax);
+        FZ = - KAPPA * (ZZ - Zmax);
+        FS = - KAPPA * (ZZ - Zmax) * tg_alpha;
+      }
+      else {
+        D = sqrt(pow(ZZ,2)+pow(SS,2));
+        d = D - z_cc;
+        POT = 0.5 * KAPPA * pow(d,2);
+        FZ = - KAPPA * d * ZZ / D;
+        FS = - KAPPA * d * SS / D;
+      }
+    }
+    else {
+      if(sphere==false) {
+        POT = 0.5 * KAPPA * (ZZ - Zmax) * (ZZ - Zmax);
+        FZ = - KAPPA * (ZZ - Zmax);
+        FS = 0;
+      }
+      else {
+        D = sqrt(pow(ZZ,2)+pow(SS,2));
+        d = D - z_cc;
+        if(ZZ>=R_cyl+slope*(SS-z_cc)) {
+          POT = 0.5 * KAPPA * pow(d,2);
+          FZ = - KAPPA * d * ZZ / D;
+          FS = - KAPPA * d * SS / D;
+        }
+        else {
+          POT = 0.5 * KAPPA * pow(sqrt(pow((ZZ+slope*z_cc-R_cyl)/slope,2)+pow(ZZ,2))-
+                                  z_cc,2);
+          FZ = - KAPPA*(sqrt(pow((ZZ+slope*z_cc-R_cyl)/slope,2)+pow(ZZ,2))-z_cc)*
+               ZZ/sqrt(pow((ZZ+slope*z_cc-R_cyl)/slope,2)+pow(ZZ,2));
+          FS = 0;
+        }
+      }
+    }
+  }
+}
+
 void Funnel::createBIAS(const double& R_cyl, const double& z_cc, const double& alpha,
                         const double& KAPPA, const double& MIN_S, const double& MAX_S, const double& NBIN_S,
                         const double& NBIN_Z, const double& safety, const bool& sphere, const double& slope,
@@ -315,7 +410,7 @@ void Funnel::createBIAS(const double& R_cyl, const double& z_cc, const double& a
     DX_S=(MAX_S + z_cc + safety)/NBIN_S;
   }
 
-  double SS, Zmax, ZZ, D, d;
+  double SS, ZZ;
   double POT, FZ, FS;
 
   PLMD::OFile pof;
@@ -343,81 +438,9 @@ void Funnel::createBIAS(const double& R_cyl, const double& z_cc, const double& a
     else {
       SS = - z_cc - safety + is * DX_S;
     }
-    bool cone = false;
-    if (sphere==false) {
-      if(SS <= z_cc) cone = true;
-    }
-    else {
-      if (SS <= sqrt(pow(z_cc,2)-pow(R_cyl,2))) cone = true;
-    }
-    //Set wall boundaries properly
-    if(cone == true) {
-      if(sphere==false) {
-        Zmax = R_cyl + (z_cc - SS) * tg_alpha;
-      }
-      else {
-        if (SS > -z_cc) {
-          Zmax = sqrt(pow(z_cc,2) - pow(SS,2));
-        }
-        else {
-          Zmax = 0;
-        }
-      }
-    }
-    else Zmax = R_cyl;
-
     for(int iz=0; iz <= NBIN_Z; iz++) {
       ZZ = MIN_Z + iz * DX_Z;
-
-      //Inside or outside?
-      bool inside;
-      if(ZZ < Zmax) inside = true;
-      else inside = false;
-
-      if(inside == true) {
-        POT = 0;
-        FS = 0;
-        FZ = 0;
-      }
-      else {
-        if(cone == true) {
-          if(sphere==false) {
-            POT = 0.5 * KAPPA * (ZZ - Zmax) * (ZZ - Zmax);
-            FZ = - KAPPA * (ZZ - Zmax);
-            FS = - KAPPA * (ZZ - Zmax) * tg_alpha;
-          }
-          else {
-            D = sqrt(pow(ZZ,2)+pow(SS,2));
-            d = D - z_cc;
-            POT = 0.5 * KAPPA * pow(d,2);
-            FZ = - KAPPA * d * ZZ / D;
-            FS = - KAPPA * d * SS / D;
-          }
-        }
-        else {
-          if(sphere==false) {
-            POT = 0.5 * KAPPA * (ZZ - Zmax) * (ZZ - Zmax);
-            FZ = - KAPPA * (ZZ - Zmax);
-            FS = 0;
-          }
-          else {
-            D = sqrt(pow(ZZ,2)+pow(SS,2));
-            d = D - z_cc;
-            if(ZZ>=R_cyl+slope*(SS-z_cc)) {
-              POT = 0.5 * KAPPA * pow(d,2);
-              FZ = - KAPPA * d * ZZ / D;
-              FS = - KAPPA * d * SS / D;
-            }
-            else {
-              POT = 0.5 * KAPPA * pow(sqrt(pow((ZZ+slope*z_cc-R_cyl)/slope,2)+pow(ZZ,2))-
-                                      z_cc,2);
-              FZ = - KAPPA*(sqrt(pow((ZZ+slope*z_cc-R_cyl)/slope,2)+pow(ZZ,2))-z_cc)*
-                   ZZ/sqrt(pow((ZZ+slope*z_cc-R_cyl)/slope,2)+pow(ZZ,2));
-              FS = 0;
-            }
-          }
-        }
-      }
+      funnelPotential(SS, ZZ, R_cyl, z_cc, tg_alpha, KAPPA, sphere, slope, POT, FS, FZ);
       pof.printf("%13.6lf %13.6lf %13.6lf %13.6lf %13.6lf\n", SS, ZZ, POT, FS, FZ);
     }
     pof.printf("\n");
@@ -427,6 +450,16 @@ void Funnel::createBIAS(const double& R_cyl, const double& z_cc, const double& a
 
 void Funnel::calculate()
 {
+  if(analytic_) {
+    // Same values and derivatives that are stored in the grid file
+    double POT, FS, FZ;
+    funnelPotential(getArgument(0), getArgument(1), RCYL, ZCC, tg_alpha_, KAPPA, sphere_, slope, POT, FS, FZ);
+    setBias(scale_*POT);
+    setOutputForce(0,-scale_*FS);
+    setOutputForce(1,-scale_*FZ);
+    return;
+  }
+
   unsigned ncv=getNumberOfArguments();
   vector<double> cv(ncv), der(ncv);
 
@@ -25,6 +25,7 @@
 #include "core/ActionRegister.h"
 #include "core/PlumedMain.h"
 #include "core/ActionSet.h"
+#include "core/Checkpoint.h"
 
 //+PLUMEDOC GRIDCALC ACCUMULATE
 /*
@@ -55,6 +56,8 @@ public:
   void calculate() override {}
   void apply() override {}
   void update() override ;
+  void writeCheckpoint( std::ostream& o ) override ;
+  void readCheckpoint( std::istream& i ) override ;
 };
 
 PLUMED_REGISTER_ACTION(Accumulate,"ACCUMULATE")
@@ -117,5 +120,18 @@ void Accumulate::update() {
   if( clearstride>0 && getStep()%clearstride==0 ) clearnextstep=true;
 }
 
+void Accumulate::writeCheckpoint( std::ostream& o ) {
+  checkpoint::write( o, clearnextstep );
+  checkpoint::write<std::size_t>( o, getPntrToComponent(0)->getNumberOfValues() );
+  getPntrToComponent(0)->writeBinary( o );
+}
+
+void Accumulate::readCheckpoint( std::istream& i ) {
+  checkpoint::read( i, clearnextstep ); std::size_t nvals; checkpoint::read( i, nvals );
+  if( getPntrToComponent(0)->getNumberOfValues()!=getPntrToArgument(0)->getNumberOfValues() ) getPntrToComponent(0)->setShape( getPntrToArgument(0)->getShape() );
+  if( nvals!=getPntrToComponent(0)->getNumberOfValues() ) error("number of accumulated values in checkpoint does not match the input");
+  getPntrToComponent(0)->readBinary( i );
+}
+
 }
 }
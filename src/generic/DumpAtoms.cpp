@@ -28,8 +28,12 @@
 #include "core/PlumedMain.h"
 #include "tools/Units.h"
 #include "tools/CheckInRange.h"
+#include "tools/AsyncWriter.h"
+#include "tools/CompressedTrajectory.h"
+#include "tools/Communicator.h"
 #include <cstdio>
 #include <memory>
+#include <functional>
 #include "core/GenericMolInfo.h"
 #include "core/ActionSet.h"
 #include "xdrfile/xdrfile_xtc.h"
@@ -103,6 +107,16 @@ DUMPATOMS STRIDE=10 FILE=file.xtc ATOMS=1-10,c1
 \endplumedfile
 Notice that xtc files are significantly smaller than gro and xyz files.
 
+For long simulations where many atoms are dumped frequently, a ptrj file can be used instead.
+Coordinates are stored in single precision, each frame is compressed separately with zlib
+and the position of each frame is stored in an index file (with suffix .idx), so that
+single frames can be extracted quickly. The format is described in the documentation of the CompressedTrajectory class.
+Adding the ASYNC flag, the frames are compressed and written by a separate thread, so that the MD
+simulation does not wait for the output:
+\plumedfile
+DUMPATOMS STRIDE=100 FILE=file.ptrj ATOMS=1-5000 ASYNC
+\endplumedfile
+
 Finally, consider that gro and xtc file store coordinates with limited precision set by the
 `PRECISION` keyword. Default value is 3, which means "3 digits after dot" in nm (1/1000 of a nm).
 The following will write a larger xtc file with high resolution coordinates:
@@ -133,6 +147,11 @@ class DumpAtoms:
   std::string fmt_gro_box;
   std::string fmt_xyz;
   xdrfile::XDRFILE* xd;
+  std::unique_ptr<CompressedTrajectory> ctraj;
+/// True if binary frames are compressed and written by the AsyncWriter thread
+  bool async;
+/// The thread that writes the binary frames
+  std::unique_ptr<AsyncWriter> writer;
 public:
   explicit DumpAtoms(const ActionOptions&);
   ~DumpAtoms();
@@ -159,7 +178,8 @@ void DumpAtoms::registerKeywords( Keywords& keys ) {
   keys.add("compulsory", "FILE", "file on which to output coordinates; extension is automatically detected");
   keys.add("compulsory", "UNITS","PLUMED","the units in which to print out the coordinates. PLUMED means internal PLUMED units");
   keys.add("optional", "PRECISION","The number of digits in trajectory file");
-  keys.add("optional", "TYPE","file type, either xyz, gro, xtc, or trr, can override an automatically detected file extension");
+  keys.add("optional", "TYPE","file type, either xyz, gro, xtc, trr or ptrj, can override an automatically detected file extension");
+  keys.addFlag("ASYNC",false,"write the file on a separate thread. This is also done if the environment variable PLUMED_ASYNC_OUTPUT is set to yes");
   keys.add("optional","LESS_THAN_OR_EQUAL","when printing with arguments that are vectors only print components of vectors have a value less than or equal to this value");
   keys.add("optional","GREATER_THAN_OR_EQUAL","when printing with arguments that are vectors only print components of vectors have a value greater than or equal to this value");
   keys.use("RESTART");
@@ -172,7 +192,9 @@ DumpAtoms::DumpAtoms(const ActionOptions&ao):
   ActionAtomistic(ao),
   ActionWithArguments(ao),
   ActionPilot(ao),
-  iprecision(3)
+  iprecision(3),
+  xd(NULL),
+  async(false)
 {
   std::vector<AtomNumber> atoms;
   std::string file;
@@ -180,7 +202,7 @@ DumpAtoms::DumpAtoms(const ActionOptions&ao):
   if(file.length()==0) error("name out output file was not specified");
   type=Tools::extension(file);
   log<<"  file name "<<file<<"\n";
-  if(type=="gro" || type=="xyz" || type=="xtc" || type=="trr") {
+  if(type=="gro" || type=="xyz" || type=="xtc" || type=="trr" || type=="ptrj") {
     log<<"  file extension indicates a "<<type<<" file\n";
   } else {
     log<<"  file extension not detected, assuming xyz\n";
@@ -189,7 +211,7 @@ DumpAtoms::DumpAtoms(const ActionOptions&ao):
   std::string ntype;
   parse("TYPE",ntype);
   if(ntype.length()>0) {
-    if(ntype!="xyz" && ntype!="gro" && ntype!="xtc" && ntype!="trr"
+    if(ntype!="xyz" && ntype!="gro" && ntype!="xtc" && ntype!="trr" && ntype!="ptrj"
       ) error("TYPE cannot be understood");
     log<<"  file type enforced to be "<<ntype<<"\n";
     type=ntype;
@@ -220,8 +242,9 @@ DumpAtoms::DumpAtoms(const ActionOptions&ao):
     if(myunit.getLength()!=1.0 && type=="gro") error("gro files should be in nm");
     if(myunit.getLength()!=1.0 && type=="xtc") error("xtc files should be in nm");
     if(myunit.getLength()!=1.0 && type=="trr") error("trr files should be in nm");
+    if(myunit.getLength()!=1.0 && type=="ptrj") error("ptrj files should be in nm");
     lenunit=getUnits().getLength()/myunit.getLength();
-  } else if(type=="gro" || type=="xtc" || type=="trr") lenunit=getUnits().getLength();
+  } else if(type=="gro" || type=="xtc" || type=="trr" || type=="ptrj") lenunit=getUnits().getLength();
   else lenunit=1.0;
 
   of.link(*this);
@@ -229,12 +252,26 @@ DumpAtoms::DumpAtoms(const ActionOptions&ao):
   std::string path=of.getPath();
   log<<"  Writing on file "<<path<<"\n";
   std::string mode=of.getMode();
+// binary files are only written by the root process
   if(type=="xtc") {
     of.close();
-    xd=xdrfile::xdrfile_open(path.c_str(),mode.c_str());
+    if(comm.Get_rank()==0) xd=xdrfile::xdrfile_open(path.c_str(),mode.c_str());
   } else if(type=="trr") {
     of.close();
-    xd=xdrfile::xdrfile_open(path.c_str(),mode.c_str());
+    if(comm.Get_rank()==0) xd=xdrfile::xdrfile_open(path.c_str(),mode.c_str());
+  } else if(type=="ptrj") {
+    of.close();
+    if(comm.Get_rank()==0) {
+      ctraj=Tools::make_unique<CompressedTrajectory>();
+      ctraj->create(path,atoms.size(),mode=="a");
+    }
+  }
+  parseFlag("ASYNC",async);
+  if(AsyncWriter::enabled()) async=true;
+  if(async) {
+    log<<"  writing on a separate thread\n";
+    if(type=="xyz" || type=="gro") of.setAsync(true);
+    else if(comm.Get_rank()==0) writer=Tools::make_unique<AsyncWriter>();
   }
   log.printf("  printing the following atoms in %s :", unitname.c_str() );
   for(unsigned i=0; i<atoms.size(); ++i) log.printf(" %d",atoms[i].serial() );
@@ -330,30 +367,50 @@ void DumpAtoms::update() {
               lenunit*t(0,0),lenunit*t(1,1),lenunit*t(2,2),
               lenunit*t(0,1),lenunit*t(0,2),lenunit*t(1,0),
               lenunit*t(1,2),lenunit*t(2,0),lenunit*t(2,1));
-  } else if(type=="xtc" || type=="trr") {
-    xdrfile::matrix box;
+  } else if(type=="xtc" || type=="trr" || type=="ptrj") {
+    if(comm.Get_rank()!=0) return;
+// the frame is copied so that it can be compressed and written by the AsyncWriter thread
+    auto frame=std::make_shared<CompressedTrajectory::Frame>();
     const Tensor & t(getPbc().getBox());
     int natoms=getNumberOfAtoms();
-    int step=getStep();
-    float time=getTime()/getUnits().getTime();
-    float precision=Tools::fastpow(10.0,iprecision);
-    for(int i=0; i<3; i++) for(int j=0; j<3; j++) box[i][j]=lenunit*t(i,j);
-// here we cannot use a std::vector<rvec> since it does not compile.
-// we thus use a std::unique_ptr<rvec[]>
-    auto pos = Tools::make_unique<xdrfile::rvec[]>(natoms);
-    for(int i=0; i<natoms; i++) for(int j=0; j<3; j++) pos[i][j]=lenunit*getPosition(i)(j);
-    if(type=="xtc") {
-      write_xtc(xd,natoms,step,time,box,&pos[0],precision);
-    } else if(type=="trr") {
-      write_trr(xd,natoms,step,time,0.0,box,&pos[0],NULL,NULL);
+    frame->step=getStep();
+    frame->time=getTime()/getUnits().getTime();
+    for(int i=0; i<3; i++) for(int j=0; j<3; j++) frame->box[3*i+j]=lenunit*t(i,j);
+    frame->positions.resize(3*natoms);
+    for(int i=0; i<natoms; i++) for(int j=0; j<3; j++) frame->positions[3*i+j]=lenunit*getPosition(i)(j);
+    std::function<void()> job;
+    if(type=="ptrj") {
+      job=[this,frame]() { ctraj->write(*frame); };
+    } else {
+      float precision=Tools::fastpow(10.0,iprecision);
+      bool xtc=(type=="xtc");
+      job=[this,frame,natoms,precision,xtc]() {
+        xdrfile::matrix box;
+        for(int i=0; i<3; i++) for(int j=0; j<3; j++) box[i][j]=frame->box[3*i+j];
+// rvec is an array of three floats, so the positions can be passed directly
+        xdrfile::rvec* pos=reinterpret_cast<xdrfile::rvec*>(frame->positions.data());
+        if(xtc) write_xtc(xd,natoms,frame->step,frame->time,box,pos,precision);
+        else write_trr(xd,natoms,frame->step,frame->time,0.0,box,pos,NULL,NULL);
+      };
     }
+    if(writer) writer->submit(job,frame->positions.size()*sizeof(float));
+    else job();
   } else plumed_merror("unknown file type "+type);
 }
 
 DumpAtoms::~DumpAtoms() {
-  if(type=="xtc") {
+  if(writer) {
+// errors cannot be reported from a destructor
+    try {
+      writer->drain();
+    } catch(...) {
+    }
+// the thread is joined before the files that it writes are closed
+    writer.reset();
+  }
+  if(type=="xtc" && xd) {
     xdrfile_close(xd);
-  } else if(type=="trr") {
+  } else if(type=="trr" && xd) {
     xdrfile_close(xd);
   }
 }
@@ -65,6 +65,7 @@ public:
   static void registerKeywords(Keywords& keys);
   void apply() override {}
   void update() override;
+  bool checkNeedsDerivatives()const override {return true;}
   ~DumpDerivatives();
 };
 
@@ -34,6 +34,9 @@ namespace generic {
 /*
 Print a vector to a file
 
+The BINARY keyword can be used to write the values as float32 or float64 numbers rather than as text.
+The resulting file can be read with \ref READ in the same way as a text file.
+
 \par Examples
 
 */
@@ -44,6 +47,8 @@ class DumpVector :
   public ActionPilot {
 private:
   bool onefile;
+/// Bytes per value when writing a binary file, zero for text files
+  unsigned binaryPrecision;
   std::vector<std::string> argnames;
   std::string fmt, filename;
   void buildArgnames();
@@ -66,6 +71,7 @@ void DumpVector::registerKeywords( Keywords& keys ) {
   keys.add("compulsory","STRIDE","0","the frequency with which the grid should be output to the file.");
   keys.add("compulsory","FILE","density","the file on which to write the vetors");
   keys.add("optional","FMT","the format that should be used to output real numbers");
+  keys.add("optional","BINARY","write a binary file with float32 or float64 numbers rather than a text file");
   keys.addFlag("PRINT_ONE_FILE",false,"output vectors one after the other in a single file");
 }
 
@@ -73,6 +79,7 @@ DumpVector::DumpVector(const ActionOptions&ao):
   Action(ao),
   ActionWithArguments(ao),
   ActionPilot(ao),
+  binaryPrecision(0),
   fmt("%f")
 {
   if( getNumberOfArguments()==0 ) error("found no arguments");
@@ -81,6 +88,11 @@ DumpVector::DumpVector(const ActionOptions&ao):
 
   log.printf("  outputting data with label %s to file named %s",getPntrToArgument(0)->getName().c_str(), filename.c_str() );
   parse("FMT",fmt); log.printf(" with format %s \n", fmt.c_str() ); fmt = " " + fmt;
+  std::string binary; parse("BINARY",binary);
+  if( binary=="float32" ) binaryPrecision=4;
+  else if( binary=="float64" ) binaryPrecision=8;
+  else if( binary.length()>0 ) error("BINARY should be either float32 or float64");
+  if( binaryPrecision>0 ) log.printf("  writing binary files with %s numbers \n", binary.c_str() );
   if( onefile ) log.printf("  printing all grids on a single file \n");
   else log.printf("  printing all grids on separate files \n");
 }
@@ -103,6 +115,7 @@ void DumpVector::update() {
   OFile ofile; ofile.link(*this);
   if( onefile ) ofile.enforceRestart();
   else ofile.setBackupString("analysis");
+  if( binaryPrecision>0 ) ofile.setBinary( binaryPrecision );
   ofile.open( filename );
 
   unsigned totargs = 0;
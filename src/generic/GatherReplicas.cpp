@@ -23,11 +23,18 @@
 #include "core/ActionWithArguments.h"
 #include "core/ActionRegister.h"
 #include "tools/Communicator.h"
+#include "tools/SharedWindow.h"
 
 //+PLUMEDOC ANALYSIS GATHER_REPLICAS
 /*
 Create a vector that contains the copies of the input quantities from all replicas
 
+When all the replicas run on the same node and the gathered quantity is large (e.g. a grid or a matrix)
+the flag SHARED_MEMORY can be used. Each replica then writes its copy of the quantity
+in an MPI shared memory window and reads the copies of the others directly from there,
+instead of exchanging them with MPI. If the replicas are not all on the same node
+the usual MPI communication is used.
+
 \par Examples
 
 
@@ -42,6 +49,10 @@ class GatherReplicas :
   public ActionWithArguments {
 private:
   unsigned nreplicas;
+/// Shared memory window used with SHARED_MEMORY
+  std::unique_ptr<SharedWindow> window;
+/// Number of times the values were gathered, used to tag the data in the window
+  long long int ngathered;
 public:
   static void registerKeywords( Keywords& keys );
   explicit GatherReplicas( const ActionOptions& );
@@ -55,17 +66,21 @@ PLUMED_REGISTER_ACTION(GatherReplicas,"GATHER_REPLICAS")
 void GatherReplicas::registerKeywords( Keywords& keys ) {
   Action::registerKeywords( keys ); ActionWithValue::registerKeywords( keys ); ActionWithArguments::registerKeywords( keys );
   keys.addInputKeyword("compulsory","ARG","scalar/vector/matrix/grid","the argument from the various replicas that you would like to gather");
+  keys.addFlag("SHARED_MEMORY",false,"exchange the values through shared memory when all the replicas are on the same node");
   keys.addOutputComponent("rep","default","scalar/vector/matrix/grid","the input arguments for each of the replicas");
 }
 
 GatherReplicas::GatherReplicas( const ActionOptions& ao ):
   Action(ao),
   ActionWithValue(ao),
-  ActionWithArguments(ao)
+  ActionWithArguments(ao),
+  ngathered(0)
 {
   if( getNumberOfArguments()!=1 ) error("you can only gather one argument at a time with GatherReplicas");
 
   std::vector<unsigned> shape( getPntrToArgument(0)->getShape() );
+  // The values of a vector or matrix are read in calculate so they must be stored
+  if( shape.size()>0 ) getPntrToArgument(0)->buildDataStore();
   std::string min, max; nreplicas=multi_sim_comm.Get_size(); bool periodic=false;
   if( getPntrToArgument(0)->isPeriodic() ) { periodic=true; getPntrToArgument(0)->getDomain( min, max ); }
 
@@ -76,33 +91,56 @@ GatherReplicas::GatherReplicas( const ActionOptions& ao ):
     if( periodic ) componentIsPeriodic( "rep-" + num, min, max );
     else componentIsNotPeriodic( "rep-" + num );
   }
+
+  bool shared=false; parseFlag("SHARED_MEMORY",shared);
+  if( shared ) {
+    int enabled=0;
+    if( comm.Get_rank()==0 ) {
+      window=Tools::make_unique<SharedWindow>( multi_sim_comm );
+      enabled=window->enabled();
+      if( !enabled ) window.reset();
+    }
+    comm.Bcast( enabled, 0 );
+    if( enabled ) log.printf("  values are exchanged through shared memory\n");
+    else log.printf("  replicas are not all on the same node, values are exchanged with MPI\n");
+  }
 }
 
 unsigned GatherReplicas::getNumberOfDerivatives() {
+  if( !getPntrToArgument(0)->hasDerivatives() ) return 0;
   return getPntrToArgument(0)->getNumberOfDerivatives();
 }
 
 void GatherReplicas::calculate() {
   Value* myarg = getPntrToArgument(0);
-  unsigned nvals = myarg->getNumberOfValues(), nder = myarg->getNumberOfDerivatives();
-  std::vector<double> dval( nvals*(1+nder) ), datap(nreplicas*nvals*(1+nder) );
+  unsigned nvals = myarg->getNumberOfValues(), nder = getNumberOfDerivatives();
+  std::vector<double> dval( nvals*(1+nder) ), datap;
   for(unsigned i=0; i<nvals; ++i) {
     dval[i*(1+nder)] = myarg->get(i);
     if( myarg->getRank()==0 ) { for(unsigned j=0; j<nder; ++j) dval[i*(1+nder)+1+j] = myarg->getDerivative(j); }
     else if( myarg->hasDerivatives() ) { for(unsigned j=0; j<nder; ++j) dval[i*(1+nder)+1+j] = myarg->getGridDerivative( i, j ); }
   }
-  if(comm.Get_rank()==0) multi_sim_comm.Allgather(dval,datap);
+  if( window ) {
+// the copies of the other replicas are read in place from their slices of the window
+    window->reserve( dval.size() );
+    std::copy( dval.begin(), dval.end(), window->write(ngathered) );
+    window->publish();
+  } else {
+    datap.resize( nreplicas*nvals*(1+nder) );
+    if(comm.Get_rank()==0) multi_sim_comm.Allgather(dval,datap);
+  }
 
   for(unsigned k=0; k<nreplicas; k++) {
     Value* myout = getPntrToComponent(k);
-    if( myout->getNumberOfDerivatives()!=myarg->getNumberOfDerivatives() ) myout->resizeDerivatives( myarg->getNumberOfDerivatives() );
-    unsigned sstart=k*nvals*(1+nder);
+    if( myout->hasDerivatives() && myout->getNumberOfDerivatives()!=nder ) myout->resizeDerivatives( nder );
+    const double* repdata = window ? window->read( k, ngathered ) : datap.data()+k*nvals*(1+nder);
     for(unsigned i=0; i<nvals; ++i) {
-      myout->set( i, datap[sstart+i*(1+nder)] );
+      myout->set( i, repdata[i*(1+nder)] );
       if( myarg->getRank()==0 ) { for(unsigned j=0; j<nder; ++j) myout->setDerivative( j, dval[i*(1+nder)+1+j] ); }
       else if( myarg->hasDerivatives() ) { for(unsigned j=0; j<nder; ++j) myout->addGridDerivatives( i, j, dval[i*(1+nder)+1+j] ); }
     }
   }
+  ngathered++;
 }
 
 void GatherReplicas::apply() {
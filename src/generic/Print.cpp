@@ -62,6 +62,18 @@ PRINT ARG=distance,energy   STRIDE=1000 FILE=COLVAR_ALL
 Notice that \ref DISTANCE and \ref ENERGY are computed respectively every 10 and 1000 steps, that is
 only when required.
 
+When many values are printed frequently, formatting the numbers as text can take a sizeable fraction of the time.
+The BINARY keyword can then be used to write the values as single (float32) or double (float64) precision little endian numbers.
+Integer fields are stored as 32 or 64 bit integers whatever the precision that is chosen, so no digits are lost.
+The file starts with a header that lists the names of the fields, the domains of the periodic arguments and the units,
+so that it can be read back with \ref READ or used with `driver --noatoms` exactly like a text file.
+If the name of the file ends with .gz the output is compressed.
+
+\plumedfile
+d: DISTANCE ATOMS=1,2 COMPONENTS
+PRINT ARG=d.x,d.y,d.z STRIDE=1 FILE=COLVAR.bin BINARY=float32
+\endplumedfile
+
 */
 //+ENDPLUMEDOC
 
@@ -103,6 +115,7 @@ void Print::registerKeywords(Keywords& keys) {
   keys.add("compulsory","STRIDE","1","the frequency with which the quantities of interest should be output");
   keys.add("optional","FILE","the name of the file on which to output these quantities");
   keys.add("optional","FMT","the format that should be used to output real numbers");
+  keys.add("optional","BINARY","write a binary file with float32 or float64 numbers rather than a text file");
   keys.add("hidden","_ROTATE","some funky thing implemented by GBussi");
   keys.use("RESTART");
   keys.use("UPDATE_FROM");
@@ -118,6 +131,14 @@ Print::Print(const ActionOptions&ao):
 {
   ofile.link(*this);
   parse("FILE",file);
+  std::string binary; parse("BINARY",binary);
+  if(binary.length()>0) {
+    if(file.length()==0) error("BINARY can only be used when printing on a FILE");
+    if(binary=="float32") ofile.setBinary(4);
+    else if(binary=="float64") ofile.setBinary(8);
+    else error("BINARY should be either float32 or float64");
+    log.printf("  writing a binary file with %s numbers\n",binary.c_str());
+  }
   if(file.length()>0) {
     ofile.open(file);
     log.printf("  on file %s\n",file.c_str());
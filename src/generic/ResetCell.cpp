@@ -102,6 +102,7 @@ class ResetCell:
 public:
   explicit ResetCell(const ActionOptions&ao);
   static void registerKeywords( Keywords& keys );
+  bool modifiesGlobalPositions() const override { return true; }
   void calculate() override;
   void apply() override;
 };
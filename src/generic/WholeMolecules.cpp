@@ -104,13 +104,18 @@ class WholeMolecules:
   public ActionAtomistic
 {
   std::vector<std::vector<std::pair<std::size_t,std::size_t> > > p_groups;
-  std::vector<std::vector<std::pair<std::size_t,std::size_t> > > p_roots;
+/// For each atom of an entity, the position in the entity of the atom it is made whole with
+/// (the previous one, or its root in the tree if EMST is used)
+  std::vector<std::vector<unsigned> > p_prev;
   std::vector<Vector> refs;
   bool doemst, addref;
+/// true if some atom belongs to more than one entity, in which case entities are processed in order
+  bool shared_atoms;
 public:
   explicit WholeMolecules(const ActionOptions&ao);
   static void registerKeywords( Keywords& keys );
   bool actionHasForces() override { return false; }
+  bool modifiesGlobalPositions() const override { return true; }
   void calculate() override;
   void apply() override {}
 };
@@ -137,7 +142,7 @@ WholeMolecules::WholeMolecules(const ActionOptions&ao):
   Action(ao),
   ActionPilot(ao),
   ActionAtomistic(ao),
-  doemst(false), addref(false)
+  doemst(false), addref(false), shared_atoms(false)
 {
   std::vector<std::vector<AtomNumber> > groups;
   std::vector<std::vector<AtomNumber> > roots;
@@ -225,45 +230,71 @@ WholeMolecules::WholeMolecules(const ActionOptions&ao):
     p_groups[i].resize( groups[i].size() );
     for(unsigned j=0; j<groups[i].size(); ++j) p_groups[i][j] = getValueIndices( groups[i][j] );
   }
-  // Convert roots to p_roots
-  p_roots.resize( roots.size() );
-  for(unsigned i=0; i<roots.size(); ++i) {
-    p_roots[i].resize( roots[i].size() );
-    for(unsigned j=0; j<roots[i].size(); ++j) p_roots[i][j] = getValueIndices( roots[i][j] );
+  // Convert roots to positions in the entity; roots always precede the atoms they are bonded to
+  p_prev.resize( groups.size() );
+  for(unsigned i=0; i<groups.size(); ++i) {
+    p_prev[i].resize( groups[i].size(), 0 );
+    for(unsigned j=1; j<groups[i].size(); ++j) {
+      // the closest preceding occurrence, as the same atom might be listed twice
+      unsigned k=j;
+      while( k>0 && groups[i][k-1]!=roots[i][j-1] ) k--;
+      if( k==0 ) error("root of atom " + std::to_string(groups[i][j].serial()) + " does not precede it in its entity");
+      p_prev[i][j]=k-1;
+    }
   }
 
 
   checkRead();
+  unsigned nmerge=merge.size();
+  for(unsigned i=0; i<groups.size(); ++i) {
+    std::vector<AtomNumber> g(groups[i]);
+    Tools::removeDuplicates(g);
+    nmerge+=g.size()-groups[i].size();
+  }
   Tools::removeDuplicates(merge);
+  // atoms repeated within an entity are harmless, across entities they force the serial loop
+  shared_atoms=(merge.size()!=nmerge);
+  if(shared_atoms) log.printf("  some atoms belong to more than one entity, entities will be reconstructed serially\n");
   requestAtoms(merge);
   doNotRetrieve();
   doNotForce();
 }
 
 void WholeMolecules::calculate() {
-  for(unsigned i=0; i<p_groups.size(); ++i) {
-    Vector first = getGlobalPosition(p_groups[i][0]);
-    if(addref) {
-      first = refs[i]+pbcDistance(refs[i],first);
-      setGlobalPosition( p_groups[i][0], first );
-    }
-    if(!doemst) {
-      for(unsigned j=1; j<p_groups[i].size(); ++j) {
-        Vector second=getGlobalPosition(p_groups[i][j]);
-        first = first+pbcDistance(first,second);
-        setGlobalPosition(p_groups[i][j], first );
+  // Each atom is shifted by a lattice vector, so the bond to the atom it is made whole with
+  // can be computed from the unshifted positions. This way all the minimum-image distances of
+  // an entity are computed in a single batch and the positions are then accumulated along the chain.
+  const Pbc & pbc=getPbc();
+  unsigned nt=OpenMP::getNumThreads();
+  if(shared_atoms || p_groups.size()<2*nt) nt=1;
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<Vector> pos;
+    std::vector<double> dx, dy, dz;
+    #pragma omp for schedule(dynamic,16)
+    for(unsigned i=0; i<p_groups.size(); ++i) {
+      const auto & group=p_groups[i];
+      const auto & prev=p_prev[i];
+      const unsigned n=group.size();
+      pos.resize(n); dx.resize(n); dy.resize(n); dz.resize(n);
+      for(unsigned j=0; j<n; ++j) pos[j]=getGlobalPosition(group[j]);
+      dx[0]=dy[0]=dz[0]=0.0;
+      for(unsigned j=1; j<n; ++j) {
+        const Vector d=delta(pos[prev[j]],pos[j]);
+        dx[j]=d[0]; dy[j]=d[1]; dz[j]=d[2];
+      }
+      if(n>1) pbc.apply(&dx[1],&dy[1],&dz[1],n-1);
+      if(addref) {
+        pos[0] = refs[i]+pbc.distance(refs[i],pos[0]);
+        setGlobalPosition( group[0], pos[0] );
       }
-    } else {
-      for(unsigned j=1; j<p_groups[i].size(); ++j) {
-        Vector first=getGlobalPosition(p_roots[i][j-1]);
-        Vector second=getGlobalPosition(p_groups[i][j]);
-        second=first+pbcDistance(first,second);
-        setGlobalPosition(p_groups[i][j], second );
+      for(unsigned j=1; j<n; ++j) {
+        pos[j]=pos[prev[j]]+Vector(dx[j],dy[j],dz[j]);
+        setGlobalPosition( group[j], pos[j] );
       }
     }
   }
 }
 
-
 }
 }
@@ -157,6 +157,7 @@ public:
   explicit WrapAround(const ActionOptions&ao);
   static void registerKeywords( Keywords& keys );
   bool actionHasForces() override { return false; }
+  bool modifiesGlobalPositions() const override { return true; }
   void calculate() override;
   void apply() override {}
 };
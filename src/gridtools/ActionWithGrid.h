@@ -29,7 +29,8 @@ namespace PLMD {
 namespace gridtools {
 
 class ActionWithGrid : public ActionWithVector {
-private:
+protected:
+/// Has the grid been setup by calling setupOnFirstStep from calculate
   bool firststep;
 public:
   static void registerKeywords( Keywords& keys );
@@ -25,6 +25,8 @@
 #include "core/PlumedMain.h"
 #include "ActionWithGrid.h"
 #include "tools/OFile.h"
+#include "tools/MappedGrid.h"
+#include "tools/Communicator.h"
 
 namespace PLMD {
 namespace gridtools {
@@ -174,6 +176,26 @@ HISTOGRAM ...
 DUMPGRID GRID=hh FILE=histo STRIDE=100000
 \endplumedfile
 
+Large grids can be written in binary format using the BINARY flag, which is much faster
+than formatting the text file and produces a smaller file.  The size can be reduced further by
+compressing the data with COMPRESS and by omitting the derivatives with NODERIV.  A binary
+grid can be read by \ref REFERENCE_GRID or converted to the text format with \ref convert_grid.
+
+\plumedfile
+TORSION ATOMS=1,2,3,4 LABEL=r1
+TORSION ATOMS=2,3,4,5 LABEL=r2
+HISTOGRAM ...
+  ARG=r1,r2
+  GRID_MIN=-3.14,-3.14
+  GRID_MAX=3.14,3.14
+  GRID_BIN=200,200
+  BANDWIDTH=0.05,0.05
+  LABEL=hh
+... HISTOGRAM
+
+DUMPGRID GRID=hh FILE=histo.bin STRIDE=100000 BINARY COMPRESS
+\endplumedfile
+
 */
 //+ENDPLUMEDOC
 
@@ -183,6 +205,9 @@ class DumpGrid :
 private:
   std::string fmt, filename;
   bool onefile, xyzfile;
+/// Options for the binary format
+  bool binary, compress, noderiv;
+  void writeBinary();
 public:
   static void registerKeywords( Keywords& keys );
   explicit DumpGrid(const ActionOptions&ao);
@@ -206,13 +231,19 @@ void DumpGrid::registerKeywords( Keywords& keys ) {
   keys.add("optional","FMT","the format that should be used to output real numbers");
   keys.addFlag("PRINT_XYZ",false,"output coordinates on fibonacci grid to xyz file");
   keys.addFlag("PRINT_ONE_FILE",false,"output grids one after the other in a single file");
+  keys.addFlag("BINARY",false,"output the grid in binary format");
+  keys.addFlag("COMPRESS",false,"compress the binary grid with zlib, implies BINARY");
+  keys.addFlag("NODERIV",false,"do not store the derivatives in the binary grid");
 }
 
 DumpGrid::DumpGrid(const ActionOptions&ao):
   Action(ao),
   ActionWithArguments(ao),
   ActionPilot(ao),
-  fmt("%f")
+  fmt("%f"),
+  binary(false),
+  compress(false),
+  noderiv(false)
 {
   if( getNumberOfArguments()==0 ) {
     std::vector<Value*> grids; parseArgumentList("GRID",grids); requestArguments(grids);
@@ -234,11 +265,41 @@ DumpGrid::DumpGrid(const ActionOptions&ao):
     if( ag->getGridCoordinatesObject().getGridType()=="flat" ) error("can only use PRINT_XYZ option for fibonacci grids");
     log.printf("  outputting grid to xyzfile\n");
   }
+  parseFlag("BINARY",binary); parseFlag("COMPRESS",compress); parseFlag("NODERIV",noderiv);
+  if( compress ) binary=true;
+  if( noderiv && !binary ) error("NODERIV can only be used with binary files");
+  if( binary ) {
+    if( getName()!="DUMPGRID" ) error("BINARY can only be used with DUMPGRID");
+    if( onefile || xyzfile ) error("BINARY is not compatible with PRINT_ONE_FILE and PRINT_XYZ");
+    if( ag->getGridCoordinatesObject().getGridType()!="flat" ) error("BINARY can only be used for flat grids");
+    log.printf("  grid is written in binary format%s%s\n", compress ? " with compression" : "", noderiv ? " without derivatives" : "");
+  }
   if( onefile ) log.printf("  printing all grids on a single file \n");
   else log.printf("  printing all grids on separate files \n");
 }
 
+void DumpGrid::writeBinary() {
+  ActionWithGrid* ag = ActionWithGrid::getInputActionWithGrid( getPntrToArgument(0)->getPntrToAction() );
+  plumed_assert( ag ); const GridCoordinatesObject & mygrid = ag->getGridCoordinatesObject();
+  // the values are copied in a Grid that has the same layout of the grid coordinates object
+  Value* gval=getPntrToArgument(0); const unsigned rank=gval->getRank();
+  std::vector<bool> ipbc( rank ); for(unsigned j=0; j<rank; ++j) ipbc[j]=mygrid.isPeriodic(j);
+  Grid mapgrid( gval->getName(), ag->getGridCoordinateNames(), mygrid.getMin(), mygrid.getMax(), mygrid.getNbin(false),
+                false, !noderiv, ipbc, mygrid.getMin(), mygrid.getMax() );
+  plumed_assert( mapgrid.getSize()==gval->getNumberOfValues() );
+  std::vector<double> der( rank );
+  for(unsigned i=0; i<gval->getNumberOfValues(); ++i) {
+    if( noderiv ) { mapgrid.setValue( i, gval->get(i) ); continue; }
+    for(unsigned j=0; j<rank; ++j) der[j]=gval->getGridDerivative(i,j);
+    mapgrid.setValueAndDerivatives( i, gval->get(i), der );
+  }
+  if( comm.Get_rank()!=0 ) return;
+  OFile bck; bck.link(*this); bck.backupFile( "analysis", filename );
+  MappedGrid::write( FileBase::appendSuffix( filename, plumed.getSuffix() ), mapgrid, !noderiv, compress );
+}
+
 void DumpGrid::update() {
+  if( binary ) { writeBinary(); return; }
   OFile ofile; ofile.link(*this);
   if( onefile ) {
     ofile.enforceRestart();
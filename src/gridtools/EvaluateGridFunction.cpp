@@ -75,44 +75,48 @@ void EvaluateGridFunction::setup( ActionWithValue* action ) {
 }
 
 void EvaluateGridFunction::calc( const ActionWithArguments* action, const std::vector<double>& args, std::vector<double>& vals, Matrix<double>& derivatives ) const {
-  if( set_zero_outside_range && !gridobject.inbounds( args ) ) { vals[0]=0.0; return; }
   unsigned dimension = gridobject.getDimension(); plumed_dbg_assert( args.size()==dimension && vals.size()==1 );
-  if( interpolation_type==spline ) {
-    std::vector<double> der( dimension );
-    vals[0] =  spline_interpolator->splineInterpolation( args, der );
-    for(unsigned j=0; j<dimension; ++j) derivatives(0,j) = der[j];
-  } else if( interpolation_type==linear ) {
-    Value* values=action->getPntrToArgument(0); std::vector<double> xfloor(dimension);
-    std::vector<unsigned> indices(dimension), nindices(dimension), ind(dimension);
-    gridobject.getIndices( args, indices ); unsigned nn=gridobject.getIndex(args);
-    gridobject.getGridPointCoordinates( nn, nindices, xfloor );
-    double y1 = values->get(nn); vals[0] = y1;
-    for(unsigned i=0; i<args.size(); ++i) {
-      int x0=1; if(nindices[i]==indices[i]) x0=0;
-      double ddx=gridobject.getGridSpacing()[i];
-      double X = fabs((args[i]-xfloor[i])/ddx-(double)x0);
-      for(unsigned j=0; j<args.size(); ++j) ind[j] = indices[j];
-      if( gridobject.isPeriodic(i) && (ind[i]+1)==gridobject.getNbin(false)[i] ) ind[i]=0;
-      else ind[i] = ind[i] + 1;
-      vals[0] += ( values->get( gridobject.getIndex(ind) ) - y1 )*X;
-      derivatives(0,i) = ( values->get( gridobject.getIndex(ind) ) - y1 ) / ddx;
-    }
-  } else if( interpolation_type==floor ) {
-    Value* values=action->getPntrToArgument(0); std::vector<unsigned> indices(dimension);
-    gridobject.getIndices( args, indices ); unsigned nn = gridobject.getIndex(indices);
-    plumed_dbg_assert( nn<values->getNumberOfValues() );
-    vals[0] = values->get( nn );
-    for(unsigned j=0; j<dimension; ++j) derivatives(0,j) = values->getGridDerivative( nn, j );
-  } else if( interpolation_type==ceiling ) {
-    Value* values=action->getPntrToArgument(0); std::vector<unsigned> indices(dimension);
-    gridobject.getIndices( args, indices );
-    for(unsigned i=0; i<indices.size(); ++i) {
-      if( gridobject.isPeriodic(i) && (indices[i]+1)==gridobject.getNbin(false)[i] ) indices[i]=0;
-      else indices[i] = indices[i] + 1;
+  std::vector<double> der( dimension ); calc( action, 1, args.data(), vals.data(), der.data() );
+  for(unsigned j=0; j<dimension; ++j) derivatives(0,j) = der[j];
+}
+
+void EvaluateGridFunction::calc( const ActionWithArguments* action, const unsigned& npoints, const double* args, double* vals, double* derivatives ) const {
+  unsigned dimension = gridobject.getDimension(); Value* values=action->getPntrToArgument(0);
+  if( interpolation_type==spline && !set_zero_outside_range ) { spline_interpolator->splineInterpolation( npoints, args, vals, derivatives ); return; }
+  const std::vector<unsigned>& stride( gridobject.getStride() ); std::vector<unsigned> nbin( gridobject.getNbin(true) );
+  const std::vector<double>& dx( gridobject.getGridSpacing() );
+  std::vector<unsigned> indices(dimension); std::vector<double> xfloor(dimension);
+  for(unsigned ip=0; ip<npoints; ++ip) {
+    const double* xp = args + ip*dimension; double* dp = derivatives + ip*dimension;
+    if( set_zero_outside_range && !gridobject.inbounds( xp ) ) {
+      vals[ip]=0.0; for(unsigned j=0; j<dimension; ++j) dp[j]=0.0;
+      continue;
     }
-    unsigned nn = gridobject.getIndex(indices); vals[0] = values->get( nn );
-    for(unsigned j=0; j<dimension; ++j) derivatives(0,j) = values->getGridDerivative( nn, j );
-  } else plumed_error();
+    if( interpolation_type==spline ) { spline_interpolator->splineInterpolation( 1, xp, vals+ip, dp ); continue; }
+    unsigned nn = gridobject.getCellOrigin( xp, indices.data(), xfloor.data() );
+    if( interpolation_type==linear ) {
+      double y1 = values->get(nn); vals[ip] = y1;
+      for(unsigned i=0; i<dimension; ++i) {
+        // The point one grid spacing along direction i.  There is no such point past the upper bound of a non periodic grid
+        unsigned nind = nn;
+        if( indices[i]+1<nbin[i] ) nind += stride[i];
+        else if( gridobject.isPeriodic(i) ) nind -= indices[i]*stride[i];
+        double X = (xp[i]-xfloor[i])/dx[i], dy = values->get( nind ) - y1;
+        vals[ip] += dy*X; dp[i] = dy / dx[i];
+      }
+    } else if( interpolation_type==floor ) {
+      plumed_dbg_assert( nn<values->getNumberOfValues() );
+      vals[ip] = values->get( nn );
+      for(unsigned j=0; j<dimension; ++j) dp[j] = values->getGridDerivative( nn, j );
+    } else if( interpolation_type==ceiling ) {
+      for(unsigned i=0; i<dimension; ++i) {
+        if( indices[i]+1<nbin[i] ) nn += stride[i];
+        else if( gridobject.isPeriodic(i) ) nn -= indices[i]*stride[i];
+      }
+      vals[ip] = values->get( nn );
+      for(unsigned j=0; j<dimension; ++j) dp[j] = values->getGridDerivative( nn, j );
+    } else plumed_error();
+  }
 }
 
 void EvaluateGridFunction::applyForce( const ActionWithArguments* action, const std::vector<double>& args, const double& force, std::vector<double>& forcesToApply ) const {
@@ -45,6 +45,8 @@ public:
   unsigned getArgStart() const override { return 1; }
   void setup( ActionWithValue* action ) override;
   void calc( const ActionWithArguments* action, const std::vector<double>& args, std::vector<double>& vals, Matrix<double>& derivatives ) const override ;
+/// Evaluate the function at a block of npoints points that are stored one after the other in args
+  void calc( const ActionWithArguments* action, const unsigned& npoints, const double* args, double* vals, double* derivatives ) const ;
 /// Get the vector containing the minimum value of the grid in each dimension
   std::vector<std::string> getMin() const ;
 /// Get the vector containing the maximum value of the grid in each dimension
@@ -129,8 +129,12 @@ unsigned GridCoordinatesObject::getIndex( const std::vector<unsigned>& indices )
 }
 
 bool GridCoordinatesObject::inbounds( const std::vector<double>& point ) const {
+  plumed_dbg_assert( point.size()==dimension ); return inbounds( point.data() );
+}
+
+bool GridCoordinatesObject::inbounds( const double* point ) const {
   if( gtype==fibonacci ) return true;
-  plumed_dbg_assert( bounds_set && point.size()==dimension );
+  plumed_dbg_assert( bounds_set );
   for(unsigned i=0; i<dimension; ++i) {
     if( pbc[i] ) continue;
     if( point[i]<min[i] || point[i]>(max[i]-dx[i]) ) return false;
@@ -147,6 +151,17 @@ void GridCoordinatesObject::getIndices( const std::vector<double>& point, std::v
   }
 }
 
+unsigned GridCoordinatesObject::getCellOrigin( const double* point, unsigned* indices, double* xfloor ) const {
+  plumed_dbg_assert( gtype==flat && bounds_set ); unsigned index=0;
+  for(unsigned i=0; i<dimension; ++i) {
+    indices[i]=std::floor( (point[i] - min[i])/dx[i] );
+    if( pbc[i] ) indices[i]=indices[i]%nbin[i];
+    else if( indices[i]>nbin[i] ) plumed_merror("point is outside grid range");
+    xfloor[i] = min[i] + dx[i]*indices[i]; index += stride[i]*indices[i];
+  }
+  return index;
+}
+
 unsigned GridCoordinatesObject::getIndex( const std::vector<double>& point ) const {
   plumed_dbg_assert( bounds_set && point.size()==dimension );
   if( gtype==flat ) {
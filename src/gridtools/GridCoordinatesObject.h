@@ -73,6 +73,7 @@ public:
   void convertIndexToIndices( const unsigned& index, const std::vector<unsigned>& nnbin, std::vector<unsigned>& indices ) const ;
 /// Check if a point is within the grid boundaries
   bool inbounds( const std::vector<double>& point ) const ;
+  bool inbounds( const double* point ) const ;
 /// Convert a point in space the the correspoinding grid point
   unsigned getIndex( const std::vector<double>& p ) const ;
 ///  Flatten the grid and get the grid index for a point
@@ -81,6 +82,8 @@ public:
   void getIndices( const unsigned& index, std::vector<unsigned>& indices ) const ;
 /// Get the indices of a particular point
   void getIndices( const std::vector<double>& point, std::vector<unsigned>& indices ) const ;
+/// Get the indices and coordinates of the grid point at the corner of the cell that contains a point.  The index of this grid point is returned
+  unsigned getCellOrigin( const double* point, unsigned* indices, double* xfloor ) const ;
 /// Get the number of points in the grid
   unsigned getNumberOfPoints() const;
 /// Get the coordinates for a point in the grid
@@ -216,6 +216,8 @@ void Histogram::registerKeywords( Keywords& keys ) {
   keys.add("optional","LOGWEIGHTS","the logarithm of the quantity to use as the weights when calculating averages");
   keys.add("compulsory","STRIDE","1","the frequency with which to store data for averaging");
   keys.add("compulsory","CLEAR","0","the frequency with whihc to clear the data that is being averaged");
+  keys.add("optional","THREAD_REDUCTION","the method used to sum the data accumulated by the OpenMP threads in the KDE action (CRITICAL, RANGE or ATOMIC). "
+           "ATOMIC avoids the need for a copy of the grid on every thread");
   keys.setValueDescription("grid","the estimate of the histogram as a function of the argument that was obtained");
   keys.needsAction("COMBINE"); keys.needsAction("CUSTOM"); keys.needsAction("ONES");
   keys.needsAction("KDE"); keys.needsAction("ACCUMULATE");
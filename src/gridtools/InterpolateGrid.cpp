@@ -23,6 +23,7 @@
 #include "core/PlumedMain.h"
 #include "EvaluateGridFunction.h"
 #include "ActionWithGrid.h"
+#include "tools/OpenMP.h"
 
 //+PLUMEDOC GRIDANALYSIS INTERPOLATE_GRID
 /*
@@ -65,6 +66,7 @@ public:
   unsigned getNumberOfDerivatives() override ;
   const GridCoordinatesObject& getGridCoordinatesObject() const override ;
   std::vector<std::string> getGridCoordinateNames() const override ;
+  void calculate() override ;
   void performTask( const unsigned& current, MultiValue& myvals ) const override ;
   void gatherStoredValue( const unsigned& valindex, const unsigned& code, const MultiValue& myvals,
                           const unsigned& bufstart, std::vector<double>& buffer ) const ;
@@ -160,6 +162,32 @@ std::vector<std::string> InterpolateGrid::getGridCoordinateNames() const {
   plumed_assert( ag ); return ag->getGridCoordinateNames();
 }
 
+void InterpolateGrid::calculate() {
+  if( firststep ) { setupOnFirstStep( true ); firststep=false; }
+  Value* myval=getPntrToComponent(0); unsigned dimension=output_grid.getDimension(), npoints=output_grid.getNumberOfPoints();
+  // The grid points are interpolated in blocks so the coordinates are passed to the interpolator in contiguous arrays
+  const unsigned blocksize=64; unsigned nt=OpenMP::getNumThreads();
+  if( nt*blocksize>npoints ) nt=1;
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double> x( dimension ), pos( blocksize*dimension ), vals( blocksize ), der( blocksize*dimension );
+    std::vector<unsigned> ind( dimension );
+    #pragma omp for
+    for(unsigned b=0; b<npoints; b+=blocksize) {
+      unsigned nb=std::min( blocksize, npoints-b );
+      for(unsigned k=0; k<nb; ++k) {
+        output_grid.getGridPointCoordinates( b+k, ind, x );
+        for(unsigned j=0; j<dimension; ++j) pos[k*dimension+j]=x[j];
+      }
+      input_grid.calc( this, nb, pos.data(), vals.data(), der.data() );
+      for(unsigned k=0; k<nb; ++k) {
+        myval->set( b+k, vals[k] );
+        for(unsigned j=0; j<dimension; ++j) myval->setGridDerivatives( b+k, j, der[k*dimension+j] );
+      }
+    }
+  }
+}
+
 void InterpolateGrid::performTask( const unsigned& current, MultiValue& myvals ) const {
   std::vector<double> pos( output_grid.getDimension() ); output_grid.getGridPointCoordinates( current, pos );
   std::vector<double> val(1); Matrix<double> der( 1, output_grid.getDimension() ); input_grid.calc( this, pos, val, der );
@@ -25,50 +25,57 @@ namespace PLMD {
 namespace gridtools {
 
 double Interpolator::splineInterpolation( const std::vector<double>& x, std::vector<double>& der ) const {
-  plumed_dbg_assert( gridobject.getGridType()=="flat" ); unsigned dimension = gridobject.getDimension();
-
-  double X,X2,X3,value=0; der.assign(der.size(),0.0);
-  std::vector<double> fd(dimension);
-  std::vector<double> C(dimension);
-  std::vector<double> D(dimension);
-  std::vector<double> dder(dimension);
+  plumed_dbg_assert( x.size()==gridobject.getDimension() && der.size()==gridobject.getDimension() );
+  double value; splineInterpolation( 1, x.data(), &value, der.data() ); return value;
+}
 
-  std::vector<unsigned> nindices(dimension);
-  std::vector<unsigned> indices(dimension); gridobject.getIndices( x, indices );
-  std::vector<double> xfloor(dimension); gridobject.getGridPointCoordinates( gridobject.getIndex(x), nindices, xfloor );
+void Interpolator::splineInterpolation( const unsigned& npoints, const double* x, double* vals, double* der ) const {
+  plumed_dbg_assert( gridobject.getGridType()=="flat" ); unsigned dimension = gridobject.getDimension();
+  const std::vector<unsigned>& stride( gridobject.getStride() ); std::vector<unsigned> nbin( gridobject.getNbin(true) );
+  const std::vector<double>& dx( gridobject.getGridSpacing() );
 
-  // loop over neighbors
-  std::vector<unsigned> neigh; unsigned n_neigh;
-  gridobject.getSplineNeighbors( gridobject.getIndex(indices), n_neigh, neigh );
-  for(unsigned int ipoint=0; ipoint<n_neigh; ++ipoint) {
-    double grid=values->get( neigh[ipoint] );
-    for(unsigned j=0; j<dimension; ++j) dder[j] = values->getGridDerivative( neigh[ipoint], j );
+  // The workspace is allocated once for the whole block of points
+  double X,X2,X3; unsigned ncorners = 1<<dimension;
+  std::vector<double> fd(dimension), C(dimension), D(dimension), xfloor(dimension);
+  std::vector<unsigned> indices(dimension);
+  for(unsigned ip=0; ip<npoints; ++ip) {
+    const double* xp = x + ip*dimension; double* dp = der + ip*dimension; double value=0;
+    for(unsigned j=0; j<dimension; ++j) dp[j]=0;
+    unsigned mybox = gridobject.getCellOrigin( xp, indices.data(), xfloor.data() );
 
-    gridobject.getIndices( neigh[ipoint], nindices );
-    double ff=1.0;
-    for(unsigned j=0; j<dimension; ++j) {
-      int x0=1;
-      if(nindices[j]==indices[j]) x0=0;
-      double ddx=gridobject.getGridSpacing()[j];
-      X=fabs((x[j]-xfloor[j])/ddx-(double)x0);
-      X2=X*X;
-      X3=X2*X;
-      double yy;
-      if(fabs(grid)<0.0000001) yy=0.0;
-      else yy=-dder[j]/grid;
-      C[j]=(1.0-3.0*X2+2.0*X3) - (x0?-1.0:1.0)*yy*(X-2.0*X2+X3)*ddx;
-      D[j]=( -6.0*X +6.0*X2) - (x0?-1.0:1.0)*yy*(1.0-4.0*X +3.0*X2)*ddx;
-      D[j]*=(x0?-1.0:1.0)/ddx;
-      ff*=C[j];
-    }
-    for(unsigned j=0; j<dimension; ++j) {
-      fd[j]=D[j];
-      for(unsigned i=0; i<dimension; ++i) if(i!=j) fd[j]*=C[i];
+    // loop over the corners of the cell that contains the point
+    for(unsigned icorner=0; icorner<ncorners; ++icorner) {
+      unsigned neigh=mybox; bool inside=true;
+      for(unsigned j=0; j<dimension; ++j) {
+        if( !((icorner>>j)&1) ) continue;
+        if( indices[j]+1<nbin[j] ) neigh += stride[j];
+        else if( gridobject.isPeriodic(j) ) neigh -= indices[j]*stride[j];
+        else { inside=false; break; }
+      }
+      if( !inside ) continue;
+      double grid=values->get( neigh ), ff=1.0;
+      for(unsigned j=0; j<dimension; ++j) {
+        int x0=(icorner>>j)&1; double ddx=dx[j];
+        X=fabs((xp[j]-xfloor[j])/ddx-(double)x0);
+        X2=X*X;
+        X3=X2*X;
+        double yy;
+        if(fabs(grid)<0.0000001) yy=0.0;
+        else yy=-values->getGridDerivative( neigh, j )/grid;
+        C[j]=(1.0-3.0*X2+2.0*X3) - (x0?-1.0:1.0)*yy*(X-2.0*X2+X3)*ddx;
+        D[j]=( -6.0*X +6.0*X2) - (x0?-1.0:1.0)*yy*(1.0-4.0*X +3.0*X2)*ddx;
+        D[j]*=(x0?-1.0:1.0)/ddx;
+        ff*=C[j];
+      }
+      for(unsigned j=0; j<dimension; ++j) {
+        fd[j]=D[j];
+        for(unsigned i=0; i<dimension; ++i) if(i!=j) fd[j]*=C[i];
+      }
+      value+=grid*ff;
+      for(unsigned j=0; j<dimension; ++j) dp[j]+=grid*fd[j];
     }
-    value+=grid*ff;
-    for(unsigned j=0; j<dimension; ++j) der[j]+=grid*fd[j];
+    vals[ip]=value;
   }
-  return value;
 }
 
 }
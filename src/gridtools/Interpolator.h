@@ -37,6 +37,8 @@ public:
   Interpolator( Value* myval, const GridCoordinatesObject& mygrid ) : values(myval), gridobject(mygrid) {}
   /// Interpolate the function using splines
   double splineInterpolation( const std::vector<double>& x, std::vector<double>& der ) const ;
+  /// Interpolate the function using splines at a block of npoints points that are stored one after the other in x
+  void splineInterpolation( const unsigned& npoints, const double* x, double* vals, double* der ) const ;
 };
 
 }
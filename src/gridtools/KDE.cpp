@@ -27,13 +27,32 @@
 #include "tools/HistogramBead.h"
 #include "tools/SwitchingFunction.h"
 #include "tools/Matrix.h"
+#include <complex>
+#ifdef __PLUMED_HAS_FFTW
+#include <fftw3.h>
+#endif
 
 //+PLUMEDOC ANALYSIS KDE
 /*
 Create a histogram from the input scalar/vector/matrix using KDE
 
+When the FFT flag is used the kernels are not added to the grid one at a time.  The heights of the kernels are instead
+deposited on the grid points by linear (cloud-in-cell) interpolation and the resulting array is convolved with the kernel
+using fast Fourier transforms.  The cost of the calculation is then independent of the number of kernels and the width of the kernels
+so this option is useful when a large number of wide kernels are added on a fine grid.  The result differs from the one obtained
+without FFT by an amount that is set by the size of the grid spacing relative to the bandwidth.  This option requires PLUMED to be
+compiled with FFTW, the bandwidth must be constant, GRID_MIN and GRID_MAX must be set explicitly and kernels whose centers are outside the grid are ignored.
+
 \par Examples
 
+The following input computes the density of a large number of distances on a fine grid using FFTs:
+
+\plumedfile
+d: DISTANCE ATOMS1=1,2 ATOMS2=3,4 ATOMS3=5,6 ATOMS4=7,8
+hA: KDE ARG=d GRID_MIN=0 GRID_MAX=5 GRID_BIN=1000 BANDWIDTH=0.2 FFT
+DUMPGRID ARG=hA FILE=density
+\endplumedfile
+
 
 */
 //+ENDPLUMEDOC
@@ -68,21 +87,45 @@ private:
   unsigned numberOfKernels, nbins;
   SwitchingFunction switchingFunction;
   double von_misses_concentration, von_misses_norm;
+/// Is the density computed by convolving the binned kernel centers with the kernel using FFTs
+  bool usefft, fft_firststep;
+/// The lower bounds of the grid and the size of the (padded) array that is transformed in each direction
+  std::vector<double> fft_min;
+  std::vector<unsigned> fft_nbin;
+/// The work arrays for the transforms and the transforms of the input and of the kernel and its derivatives
+  std::vector<double> fft_real;
+  std::vector<std::complex<double> > fft_complex, fft_input;
+  std::vector<std::vector<std::complex<double> > > fft_kernel;
+#ifdef __PLUMED_HAS_FFTW
+  fftw_plan fft_forward, fft_backward;
+#endif
   void setupNeighborsVector();
+/// Setup the arrays and plans for the fft and transform the kernel
+  void setupFFT();
+/// Get the index of a point in the array that is transformed
+  unsigned getFFTIndex( const std::vector<unsigned>& ind ) const ;
+/// Get the height of a kernel and the interpolation weights that are used to move it on the grid points around its center
+  bool getFFTInterpolationWeights( const unsigned& k, double& height, std::vector<unsigned>& pnts, std::vector<double>& weights ) const ;
   void retrieveArgumentsAndHeight( const MultiValue& myvals, std::vector<double>& args, double& height ) const ;
   double evaluateKernel( const std::vector<double>& gpoint, const std::vector<double>& args, const double& height, std::vector<double>& der ) const ;
   void setupHistogramBeads( std::vector<HistogramBead>& bead ) const ;
-  double evaluateBeadValue( std::vector<HistogramBead>& bead, const std::vector<double>& gpoint, const std::vector<double>& args, const double& height, std::vector<double>& der ) const ;
+  void evaluateBeadValues( const std::vector<double>& args, const double& height, const unsigned& num_neigh, const std::vector<unsigned>& neighbors,
+                           std::vector<double>& vals, std::vector<double>& ders ) const ;
 public:
   static void registerKeywords( Keywords& keys );
   explicit KDE(const ActionOptions&ao);
+  ~KDE();
+  void calculate() override ;
+  void apply() override ;
   std::vector<std::string> getGridCoordinateNames() const override ;
   const GridCoordinatesObject& getGridCoordinatesObject() const override ;
   unsigned getNumberOfDerivatives() override;
   void setupOnFirstStep( const bool incalc ) override ;
   void getNumberOfTasks( unsigned& ntasks ) override ;
+  bool canAccumulateAtomically() const override { return true; }
   void areAllTasksRequired( std::vector<ActionWithVector*>& task_reducing_actions ) override ;
   int checkTaskStatus( const unsigned& taskno, int& flag ) const override ;
+  bool checkTaskStatusIsUnchanged() const override ;
   void performTask( const unsigned& current, MultiValue& myvals ) const override ;
   void gatherStoredValue( const unsigned& valindex, const unsigned& code, const MultiValue& myvals,
                           const unsigned& bufstart, std::vector<double>& buffer ) const override ;
@@ -111,6 +154,7 @@ void KDE::registerKeywords( Keywords& keys ) {
   keys.add("optional","GRID_BIN","the number of bins for the grid");
   keys.addFlag("IGNORE_IF_OUT_OF_RANGE",false,"if a kernel is outside of the range of the grid it is safe to ignore");
   keys.add("optional","GRID_SPACING","the approximate grid spacing (to be used as an alternative or together with GRID_BIN)");
+  keys.addFlag("FFT",false,"compute the histogram by convolving the binned kernel centers with the kernel using fast Fourier transforms");
   // Keywords for spherical KDE
   keys.add("compulsory","CONCENTRATION","the concentration parameter for Von Mises-Fisher distributions (only required for SPHERICAL_KDE)");
   keys.setValueDescription("grid","a function on a grid that was obtained by doing a Kernel Density Estimation using the input arguments");
@@ -120,7 +164,9 @@ KDE::KDE(const ActionOptions&ao):
   Action(ao),
   ActionWithGrid(ao),
   hasheight(false),
-  fixed_width(false)
+  fixed_width(false),
+  usefft(false),
+  fft_firststep(true)
 {
   std::vector<unsigned> shape( getNumberOfArguments() ); center.resize( getNumberOfArguments() );
   numberOfKernels=getPntrToArgument(0)->getNumberOfValues();
@@ -244,6 +290,18 @@ KDE::KDE(const ActionOptions&ao):
   }
   parseFlag("IGNORE_IF_OUT_OF_RANGE",ignore_out_of_bounds);
   if( ignore_out_of_bounds ) log.printf("  ignoring kernels that are outside of grid \n");
+  if( getName()=="KDE" ) parseFlag("FFT",usefft);
+  if( usefft ) {
+#ifndef __PLUMED_HAS_FFTW
+    error("FFT can only be used if PLUMED is compiled with FFTW");
+#endif
+    if( kerneltype=="DISCRETE" || kerneltype.find("bin")!=std::string::npos ) error("FFT cannot be used with DISCRETE or histogram bin kernels");
+    for(unsigned i=0; i<gmin.size(); ++i) {
+      if( gmin[i]=="auto" ) error("GRID_MIN and GRID_MAX must be set explicitly if FFT is used");
+    }
+    if( !getPntrToArgument(bwargno)->isConstant() ) error("bandwidth must be constant if FFT is used");
+    log.printf("  computing histogram by convolution with fast Fourier transforms\n");
+  }
   addValueWithDerivatives( shape ); setNotPeriodic();
   getPntrToComponent(0)->setDerivativeIsZeroWhenValueIsZero();
   // Make sure we store all the arguments
@@ -252,6 +310,12 @@ KDE::KDE(const ActionOptions&ao):
   updateTaskListReductionStatus(); setupOnFirstStep( false );
 }
 
+KDE::~KDE() {
+#ifdef __PLUMED_HAS_FFTW
+  if( usefft && !fft_firststep ) { fftw_destroy_plan( fft_forward ); fftw_destroy_plan( fft_backward ); }
+#endif
+}
+
 void KDE::setupOnFirstStep( const bool incalc ) {
   if( getName()=="SPHERICAL_KDE" ) return ;
 
@@ -328,6 +392,141 @@ void KDE::setupNeighborsVector() {
   }
 }
 
+void KDE::setupFFT() {
+  plumed_assert( fixed_width );
+  unsigned dim = gridobject.getDimension(); fft_min.resize( dim ); fft_nbin.resize( dim );
+  std::vector<unsigned> gbin( gridobject.getNbin(true) ); unsigned nreal=1;
+  for(unsigned i=0; i<dim; ++i) {
+    Tools::convert( gridobject.getMin()[i], fft_min[i] );
+    // Non periodic directions are padded so that the kernels do not wrap around the edges of the grid
+    if( gridobject.isPeriodic(i) ) fft_nbin[i] = gbin[i];
+    else fft_nbin[i] = std::max( gbin[i] + nneigh[i] + 1, 2*nneigh[i] + 1 );
+    nreal *= fft_nbin[i];
+  }
+  unsigned ncomplex = nreal / fft_nbin[0]*( fft_nbin[0]/2 + 1 );
+  fft_real.resize( nreal ); fft_complex.resize( ncomplex ); fft_input.resize( ncomplex );
+#ifdef __PLUMED_HAS_FFTW
+  // FFTW expects the data in row major order while the index of the first coordinate is the fastest on our grids
+  std::vector<int> nfftw( dim ); for(unsigned i=0; i<dim; ++i) nfftw[i] = fft_nbin[dim-1-i];
+  fft_forward = fftw_plan_dft_r2c( dim, nfftw.data(), fft_real.data(), reinterpret_cast<fftw_complex*>(fft_complex.data()), FFTW_ESTIMATE );
+  fft_backward = fftw_plan_dft_c2r( dim, nfftw.data(), reinterpret_cast<fftw_complex*>(fft_complex.data()), fft_real.data(), FFTW_ESTIMATE );
+
+  // Tabulate the kernel and its derivatives at the displacements between grid points and transform them
+  std::vector<unsigned> noff( dim ); unsigned ntot=1;
+  for(unsigned i=0; i<dim; ++i) {
+    if( gridobject.isPeriodic(i) ) noff[i] = fft_nbin[i];
+    else noff[i] = 2*nneigh[i] + 1;
+    ntot *= noff[i];
+  }
+  std::vector<double> zero( dim, 0 ), gpoint( dim ), der( dim ); std::vector<unsigned> ind( dim );
+  std::vector<std::vector<double> > ktab( dim+1, std::vector<double>( nreal, 0 ) );
+  for(unsigned n=0; n<ntot; ++n) {
+    unsigned kk=n;
+    for(unsigned i=0; i<dim; ++i) {
+      unsigned r = kk%noff[i]; kk /= noff[i]; int off;
+      if( gridobject.isPeriodic(i) ) off = ( 2*r<=fft_nbin[i] ) ? static_cast<int>(r) : static_cast<int>(r) - static_cast<int>(fft_nbin[i]);
+      else off = static_cast<int>(r) - static_cast<int>(nneigh[i]);
+      gpoint[i] = off*gridobject.getGridSpacing()[i];
+      ind[i] = off<0 ? off + fft_nbin[i] : off;
+    }
+    double val = evaluateKernel( gpoint, zero, 1.0, der ); unsigned pos = getFFTIndex( ind );
+    ktab[0][pos] = val / nreal; for(unsigned i=0; i<dim; ++i) ktab[i+1][pos] = der[i] / nreal;
+  }
+  fft_kernel.resize( dim+1 );
+  for(unsigned n=0; n<=dim; ++n) {
+    fft_real = ktab[n]; fftw_execute( fft_forward ); fft_kernel[n] = fft_complex;
+  }
+#endif
+}
+
+unsigned KDE::getFFTIndex( const std::vector<unsigned>& ind ) const {
+  unsigned index=ind[ind.size()-1];
+  for(unsigned i=ind.size()-1; i>0; --i) index = index*fft_nbin[i-1] + ind[i-1];
+  return index;
+}
+
+bool KDE::getFFTInterpolationWeights( const unsigned& k, double& height, std::vector<unsigned>& pnts, std::vector<double>& weights ) const {
+  unsigned dim = gridobject.getDimension(); height=1.0;
+  if( hasheight && getPntrToArgument(dim)->getRank()==0 ) height = getPntrToArgument(dim)->get();
+  else if( hasheight ) height = getPntrToArgument(dim)->get(k);
+  if( fabs(height)<epsilon ) return false;
+
+  std::vector<unsigned> base( dim ), ind( dim ); std::vector<double> frac( dim );
+  std::vector<unsigned> gbin( gridobject.getNbin(true) );
+  for(unsigned i=0; i<dim; ++i) {
+    double u = ( getPntrToArgument(i)->get(k) - fft_min[i] ) / gridobject.getGridSpacing()[i];
+    if( gridobject.isPeriodic(i) ) u -= gbin[i]*std::floor( u / gbin[i] );
+    else if( u<0 || u>gbin[i]-1 ) return false;
+    base[i] = static_cast<unsigned>( std::floor(u) ); frac[i] = u - base[i];
+    if( base[i]>=fft_nbin[i] ) { base[i]=0; frac[i]=0; }
+  }
+  unsigned ncorners = 1<<dim; pnts.resize( ncorners ); weights.resize( ncorners );
+  for(unsigned c=0; c<ncorners; ++c) {
+    double w=1.0;
+    for(unsigned i=0; i<dim; ++i) {
+      if( c & (1<<i) ) { ind[i] = base[i] + 1; w *= frac[i]; if( ind[i]==fft_nbin[i] ) ind[i]=0; }
+      else { ind[i] = base[i]; w *= 1 - frac[i]; }
+    }
+    pnts[c] = getFFTIndex( ind ); weights[c] = w;
+  }
+  return true;
+}
+
+void KDE::calculate() {
+  if( !usefft ) { ActionWithGrid::calculate(); return; }
+#ifdef __PLUMED_HAS_FFTW
+  if( fft_firststep ) { setupOnFirstStep( true ); setupFFT(); fft_firststep=false; }
+  unsigned dim = gridobject.getDimension(); numberOfKernels = getPntrToArgument(0)->getNumberOfValues();
+  // Spread the heights of the kernels on the grid points around their centers
+  double height; std::vector<unsigned> pnts; std::vector<double> weights;
+  std::fill( fft_real.begin(), fft_real.end(), 0 );
+  for(unsigned k=0; k<numberOfKernels; ++k) {
+    if( !getFFTInterpolationWeights( k, height, pnts, weights ) ) continue;
+    for(unsigned c=0; c<pnts.size(); ++c) fft_real[pnts[c]] += height*weights[c];
+  }
+  fftw_execute( fft_forward ); fft_input = fft_complex;
+  // And convolve with the kernel and its derivatives
+  Value* myval = getPntrToComponent(0); std::vector<unsigned> ind( dim );
+  for(unsigned n=0; n<=dim; ++n) {
+    for(unsigned i=0; i<fft_complex.size(); ++i) fft_complex[i] = fft_input[i]*fft_kernel[n][i];
+    fftw_execute( fft_backward );
+    for(unsigned i=0; i<myval->getNumberOfValues(); ++i) {
+      gridobject.getIndices( i, ind ); double val = fft_real[ getFFTIndex( ind ) ];
+      if( n==0 ) myval->set( i, val ); else myval->setGridDerivatives( i, n-1, val );
+    }
+  }
+#endif
+}
+
+void KDE::apply() {
+  if( !usefft ) { ActionWithVector::apply(); return; }
+#ifdef __PLUMED_HAS_FFTW
+  Value* myval = getPntrToComponent(0); if( !myval->forcesWereAdded() ) return;
+  unsigned dim = gridobject.getDimension(); std::vector<unsigned> ind( dim );
+  std::fill( fft_real.begin(), fft_real.end(), 0 );
+  for(unsigned i=0; i<myval->getNumberOfValues(); ++i) { gridobject.getIndices( i, ind ); fft_real[ getFFTIndex( ind ) ] = myval->getForce( i ); }
+  fftw_execute( fft_forward ); fft_input = fft_complex;
+
+  unsigned nforces=0; std::vector<unsigned> fstart( getNumberOfArguments() );
+  for(unsigned j=0; j<getNumberOfArguments(); ++j) { fstart[j]=nforces; nforces += getPntrToArgument(j)->getNumberOfStoredValues(); }
+  std::vector<double> forces( nforces, 0 ); double height; std::vector<unsigned> pnts; std::vector<double> weights;
+  // The force on each kernel is obtained by correlating the forces on the grid with the kernel and its derivatives
+  for(unsigned n=0; n<=dim; ++n) {
+    if( n==0 && !hasheight ) continue;
+    for(unsigned i=0; i<fft_complex.size(); ++i) fft_complex[i] = fft_input[i]*std::conj( fft_kernel[n][i] );
+    fftw_execute( fft_backward );
+    for(unsigned k=0; k<numberOfKernels; ++k) {
+      if( !getFFTInterpolationWeights( k, height, pnts, weights ) ) continue;
+      double ff=0; for(unsigned c=0; c<pnts.size(); ++c) ff += weights[c]*fft_real[pnts[c]];
+      if( n==0 && getPntrToArgument(dim)->getRank()==0 ) forces[ fstart[dim] ] += ff;
+      else if( n==0 ) forces[ fstart[dim] + getPntrToArgument(dim)->getIndexInStore(k) ] += ff;
+      else forces[ fstart[n-1] + getPntrToArgument(n-1)->getIndexInStore(k) ] -= height*ff;
+    }
+  }
+  unsigned find=0; addForcesOnArguments( 0, forces, find, getLabel() );
+#endif
+}
+
 unsigned KDE::getNumberOfDerivatives() {
   return gridobject.getDimension();
 }
@@ -366,6 +565,12 @@ void KDE::getNumberOfTasks( unsigned& ntasks ) {
   return;
 }
 
+bool KDE::checkTaskStatusIsUnchanged() const {
+  // When there are many kernels all tasks are active unless the heights can be zero
+  if( numberOfKernels>1 ) return !(hasheight && getPntrToArgument(gridobject.getDimension())->getRank()>0);
+  return false;
+}
+
 int KDE::checkTaskStatus( const unsigned& taskno, int& flag ) const {
   if( numberOfKernels>1 ) {
     if( hasheight && getPntrToArgument(gridobject.getDimension())->getRank()>0
@@ -453,20 +658,40 @@ void KDE::setupHistogramBeads( std::vector<HistogramBead>& bead ) const {
   }
 }
 
-double KDE::evaluateBeadValue( std::vector<HistogramBead>& bead, const std::vector<double>& gpoint, const std::vector<double>& args,
-                               const double& height, std::vector<double>& der ) const {
-  double val=height; std::vector<double> contr( args.size() ); Value* bw_arg=getPntrToArgument(bwargno);
-  if( bw_arg->getRank()<2 ) {
-    for(unsigned j=0; j<args.size(); ++j) {
-      bead[j].set( gpoint[j], gpoint[j]+gridobject.getGridSpacing()[j], 1/sqrt(bw_arg->get(j)) );
-      contr[j] = bead[j].calculateWithCutoff( args[j], der[j] );
-      val = val*contr[j];
+void KDE::evaluateBeadValues( const std::vector<double>& args, const double& height, const unsigned& num_neigh, const std::vector<unsigned>& neighbors,
+                              std::vector<double>& vals, std::vector<double>& ders ) const {
+  const unsigned ndim=args.size(); Value* bw_arg=getPntrToArgument(bwargno);
+  if( bw_arg->getRank()>=2 ) plumed_error();
+  plumed_dbg_assert( gridobject.getGridType()=="flat" );
+  std::vector<HistogramBead> bead( ndim ); setupHistogramBeads( bead );
+  // The bins are separable so along each direction the bead is evaluated only once for each of the distinct bins
+  // that are in the neighbourhood rather than once for every neighbouring grid point
+  std::vector<unsigned> tindices( ndim ), which( ndim*num_neigh ); std::vector<double> gpoint( ndim );
+  std::vector<std::vector<unsigned> > binind( ndim ); std::vector<std::vector<double> > lb( ndim ), ub( ndim );
+  for(unsigned i=0; i<num_neigh; ++i) {
+    gridobject.getGridPointCoordinates( neighbors[i], tindices, gpoint );
+    for(unsigned j=0; j<ndim; ++j) {
+      unsigned k=0; for(; k<binind[j].size(); ++k) { if( binind[j][k]==tindices[j] ) break; }
+      if( k==binind[j].size() ) { binind[j].push_back( tindices[j] ); lb[j].push_back( gpoint[j] ); ub[j].push_back( gpoint[j]+gridobject.getGridSpacing()[j] ); }
+      which[ndim*i+j]=k;
+    }
+  }
+  std::vector<std::vector<double> > contr( ndim ), dcontr( ndim );
+  for(unsigned j=0; j<ndim; ++j) {
+    bead[j].set( lb[j][0], ub[j][0], 1/sqrt(bw_arg->get(j)) );
+    bead[j].calculateWithCutoff( args[j], lb[j], ub[j], contr[j], dcontr[j] );
+  }
+  // And combine the contributions from each direction
+  vals.resize( num_neigh ); ders.resize( ndim*num_neigh );
+  for(unsigned i=0; i<num_neigh; ++i) {
+    double val=height;
+    for(unsigned j=0; j<ndim; ++j) val = val*contr[j][which[ndim*i+j]];
+    vals[i]=val;
+    for(unsigned j=0; j<ndim; ++j) {
+      const double cc=contr[j][which[ndim*i+j]]; ders[ndim*i+j]=dcontr[j][which[ndim*i+j]];
+      if( fabs(cc)>epsilon ) ders[ndim*i+j] *= val / cc;
     }
-  } else plumed_error();
-  for(unsigned j=0; j<args.size(); ++j) {
-    if( fabs(contr[j])>epsilon ) der[j] *= val / contr[j];
   }
-  return val;
 }
 
 void KDE::gatherStoredValue( const unsigned& valindex, const unsigned& code, const MultiValue& myvals,
@@ -474,8 +699,8 @@ void KDE::gatherStoredValue( const unsigned& valindex, const unsigned& code, con
   plumed_dbg_assert( valindex==0 );
   if( numberOfKernels==1 ) {
     unsigned istart = bufstart + (1+gridobject.getDimension())*code;
-    unsigned valout = getConstPntrToComponent(0)->getPositionInStream(); buffer[istart] += myvals.get( valout );
-    for(unsigned i=0; i<gridobject.getDimension(); ++i) buffer[istart+1+i] += myvals.getDerivative( valout, i );
+    unsigned valout = getConstPntrToComponent(0)->getPositionInStream(); addToBuffer( istart, myvals.get( valout ), buffer );
+    for(unsigned i=0; i<gridobject.getDimension(); ++i) addToBuffer( istart+1+i, myvals.getDerivative( valout, i ), buffer );
     return;
   }
   std::vector<double> args( gridobject.getDimension() ); double height; retrieveArgumentsAndHeight( myvals, args, height );
@@ -493,20 +718,18 @@ void KDE::gatherStoredValue( const unsigned& valindex, const unsigned& code, con
         std::vector<double> newargs( args.size() );
         for(unsigned i=0; i<args.size(); ++i) newargs[i] = args[i] + 0.5*gridobject.getGridSpacing()[i];
         plumed_assert( bufstart + gridobject.getIndex( newargs )*(1+args.size())<buffer.size() );
-        buffer[ bufstart + gridobject.getIndex( newargs )*(1+args.size()) ] += height;
+        addToBuffer( bufstart + gridobject.getIndex( newargs )*(1+args.size()), height, buffer );
       } else if( kerneltype.find("bin")!=std::string::npos ) {
-        std::vector<HistogramBead> bead( args.size() ); setupHistogramBeads( bead );
+        std::vector<double> vals, ders; evaluateBeadValues( args, height, num_neigh, neighbors, vals, ders );
         for(unsigned i=0; i<num_neigh; ++i) {
-          gridobject.getGridPointCoordinates( neighbors[i], gpoint );
-          double val = evaluateBeadValue( bead, gpoint, args, height, der );
-          buffer[ bufstart + neighbors[i]*(1+der.size()) ] += val;
-          for(unsigned j=0; j<der.size(); ++j) buffer[ bufstart + neighbors[i]*(1+der.size()) + 1 + j ] += val*der[j];
+          addToBuffer( bufstart + neighbors[i]*(1+der.size()), vals[i], buffer );
+          for(unsigned j=0; j<der.size(); ++j) addToBuffer( bufstart + neighbors[i]*(1+der.size()) + 1 + j, vals[i]*ders[der.size()*i+j], buffer );
         }
       } else {
         for(unsigned i=0; i<num_neigh; ++i) {
           gridobject.getGridPointCoordinates( neighbors[i], gpoint );
-          buffer[ bufstart + neighbors[i]*(1+der.size()) ] += evaluateKernel( gpoint, args, height, der );
-          for(unsigned j=0; j<der.size(); ++j) buffer[ bufstart + neighbors[i]*(1+der.size()) + 1 + j ] += der[j];
+          addToBuffer( bufstart + neighbors[i]*(1+der.size()), evaluateKernel( gpoint, args, height, der ), buffer );
+          for(unsigned j=0; j<der.size(); ++j) addToBuffer( bufstart + neighbors[i]*(1+der.size()) + 1 + j, der[j], buffer );
         }
       }
     } else {
@@ -514,8 +737,8 @@ void KDE::gatherStoredValue( const unsigned& valindex, const unsigned& code, con
         gridobject.getGridPointCoordinates( neighbors[i], gpoint );
         double dot=0; for(unsigned j=0; j<gpoint.size(); ++j) dot += args[j]*gpoint[j];
         double newval = height*von_misses_norm*exp( von_misses_concentration*dot );
-        buffer[ bufstart + neighbors[i]*(1+gpoint.size()) ] += newval;
-        for(unsigned j=0; j<gpoint.size(); ++j) buffer[ bufstart + neighbors[i]*(1+gpoint.size()) + 1 + j ] += von_misses_concentration*newval*gpoint[j];
+        addToBuffer( bufstart + neighbors[i]*(1+gpoint.size()), newval, buffer );
+        for(unsigned j=0; j<gpoint.size(); ++j) addToBuffer( bufstart + neighbors[i]*(1+gpoint.size()) + 1 + j, von_misses_concentration*newval*gpoint[j], buffer );
       }
     }
   }
@@ -545,13 +768,12 @@ void KDE::gatherForcesOnStoredValue( const Value* myval, const unsigned& itask,
   if( fabs(height)>epsilon ) {
     if( getName()=="KDE" ) {
       if( kerneltype.find("bin")!=std::string::npos ) {
-        std::vector<HistogramBead> bead( args.size() ); setupHistogramBeads( bead );
+        std::vector<double> vals, ders; evaluateBeadValues( args, height, num_neigh, neighbors, vals, ders );
         for(unsigned i=0; i<num_neigh; ++i) {
-          gridobject.getGridPointCoordinates( neighbors[i], gpoint );
-          double val = evaluateBeadValue( bead, gpoint, args, height, der ); double fforce = getConstPntrToComponent(0)->getForce( neighbors[i] );
+          double val = vals[i]; double fforce = getConstPntrToComponent(0)->getForce( neighbors[i] );
           if( hasheight && getPntrToArgument(args.size())->getRank()==0 ) forces[ hforce_start ] += val*fforce / height;
           else if( hasheight ) forces[ hforce_start + getPntrToArgument(args.size())->getIndexInStore(itask) ] += val*fforce / height;
-          unsigned n=0; for(unsigned j=0; j<der.size(); ++j) { forces[n + getPntrToArgument(j)->getIndexInStore(itask)] += der[j]*fforce; n += getPntrToArgument(j)->getNumberOfStoredValues(); }
+          unsigned n=0; for(unsigned j=0; j<der.size(); ++j) { forces[n + getPntrToArgument(j)->getIndexInStore(itask)] += ders[der.size()*i+j]*fforce; n += getPntrToArgument(j)->getNumberOfStoredValues(); }
         }
       } else {
         for(unsigned i=0; i<num_neigh; ++i) {
@@ -26,8 +26,19 @@
 /*
 Calculate the radial distribution function
 
+By default the RDF is computed from the full matrix of distances between the atoms so forces can be applied on it.  If the LINKCELLS flag is
+used the RDF is computed by \ref RDF_PAIRS, which finds the pairs of atoms that are close together with link cells and adds the kernels on the grid
+directly.  This is much cheaper for large systems but forces cannot then be applied on the RDF.
+
 \par Examples
 
+The following input computes the RDF of a group of atoms averaged over the whole trajectory using link cells:
+
+\plumedfile
+rdf: RDF GROUP=1-1000 MAXR=1.5 GRID_BIN=150 BANDWIDTH=0.02 CLEAR=0 LINKCELLS
+DUMPGRID ARG=rdf FILE=rdf.dat STRIDE=1000
+\endplumedfile
+
 */
 //+ENDPLUMEDOC
 
@@ -57,10 +68,11 @@ void RDF::registerKeywords( Keywords& keys ) {
   keys.add("compulsory","STRIDE","1","the frequency with which to compute the rdf and accumulate averages");
   keys.add("optional","DENSITY","the reference density to use when normalizing the RDF");
   keys.add("hidden","REFERENCE","this is the label of the reference objects");
+  keys.addFlag("LINKCELLS",false,"compute the rdf with RDF_PAIRS, which finds the pairs of atoms using link cells and does not store the matrix of distances.  Forces cannot be applied on the rdf if this flag is used");
   keys.setValueDescription("grid","the radial distribution function");
   keys.needsAction("REFERENCE_GRID"); keys.needsAction("VOLUME"); keys.needsAction("DISTANCE_MATRIX");
   keys.needsAction("CUSTOM"); keys.needsAction("KDE"); keys.needsAction("ACCUMULATE");
-  keys.needsAction("CONSTANT");
+  keys.needsAction("CONSTANT"); keys.needsAction("RDF_PAIRS");
 }
 
 RDF::RDF(const ActionOptions&ao):
@@ -69,6 +81,24 @@ RDF::RDF(const ActionOptions&ao):
 {
   // Read in grid extent and number of bins
   std::string maxr, nbins, dens; parse("MAXR",maxr); parse("GRID_BIN",nbins); parse("DENSITY",dens);
+  bool linkcells; parseFlag("LINKCELLS",linkcells);
+  if( linkcells ) {
+    std::string refstr, group_str, kernel, bandwidth, cutoff; parse("REFERENCE",refstr); parse("GROUP",group_str); parse("KERNEL",kernel); parse("CUTOFF",cutoff);
+    std::string input = "MAXR=" + maxr + " GRID_BIN=" + nbins + " KERNEL=" + kernel + " CUTOFF=" + cutoff;
+    if( kernel!="DISCRETE" ) { parse("BANDWIDTH",bandwidth); input += " BANDWIDTH=" + bandwidth; }
+    if( dens.length()>0 ) input += " DENSITY=" + dens;
+    if( group_str.length()>0 ) input += " GROUP=" + group_str;
+    else { std::string groupa_str, groupb_str; parse("GROUPA",groupa_str); parse("GROUPB",groupb_str); input += " GROUPA=" + groupa_str + " GROUPB=" + groupb_str; }
+    unsigned clear, stride; parse("CLEAR",clear); parse("STRIDE",stride);
+    if( clear==1 ) { readInputLine( getShortcutLabel() + ": RDF_PAIRS " + input ); return; }
+    std::string stridestr, clearstr; Tools::convert( stride, stridestr ); Tools::convert( clear, clearstr );
+    readInputLine( getShortcutLabel() + "_inst: RDF_PAIRS " + input );
+    readInputLine( getShortcutLabel() + "_sum: ACCUMULATE ARG=" + getShortcutLabel() + "_inst STRIDE=" + stridestr + " CLEAR=" + clearstr );
+    readInputLine( getShortcutLabel() + "_one: CONSTANT VALUE=1");
+    readInputLine( getShortcutLabel() + "_norm: ACCUMULATE ARG=" + getShortcutLabel() + "_one STRIDE=" + stridestr + " CLEAR=" + clearstr );
+    readInputLine( getShortcutLabel() + ": CUSTOM ARG=" + getShortcutLabel() + "_sum," + getShortcutLabel() + "_norm FUNC=x/y PERIODIC=NO");
+    return;
+  }
   std::string grid_setup = "GRID_MIN=0 GRID_MAX=" + maxr + " GRID_BIN=" + nbins;
   // Create grid with normalizing function on it
   std::string refstr; parse("REFERENCE",refstr);
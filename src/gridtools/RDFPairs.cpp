@@ -0,0 +1,285 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "ActionWithGrid.h"
+#include "core/ActionRegister.h"
+#include "tools/LinkCells.h"
+#include "tools/Communicator.h"
+#include "tools/OpenMP.h"
+#include <algorithm>
+
+//+PLUMEDOC ANALYSIS RDF_PAIRS
+/*
+Calculate the radial distribution functions for one or more pairs of groups of atoms using link cells
+
+This action computes the radial distribution function
+
+\f[
+g_{AB}(r) = \frac{V}{N_{AB}} \frac{1}{4\pi r^2} \sum_{i\in A} \sum_{j \in B, j\ne i} K(r - r_{ij})
+\f]
+
+where \f$K\f$ is a normalized Gaussian kernel with width BANDWIDTH, \f$V\f$ is the volume of the box and \f$N_{AB}\f$ is the number of pairs
+of distinct atoms in the sum.  If DENSITY is given \f$V/N_{AB}\f$ is replaced by \f$1/(N_A \rho)\f$.  The pairs of atoms that are closer
+than MAXR plus the support of the kernel are found using link cells and the kernels are added on the grid directly, so neither the cost nor the
+memory grow with the square of the number of atoms.  A single list of link cells is built for all the atoms in input so that
+the RDFs for several pairs of groups are computed in one pass over the pairs of neighboring atoms.  The RDF between a group and itself is computed with the
+GROUP keyword, while GROUPA and GROUPB give the RDF between two groups.  Numbered keywords are used to compute more than one RDF, in which case
+the RDFs are components of the action called pair-1, pair-2 and so on.
+
+Forces cannot be applied on the output of this action.  Use \ref RDF if you need to bias the radial distribution function.  To average the RDF over the
+trajectory use \ref ACCUMULATE or the LINKCELLS flag of \ref RDF.
+
+\par Examples
+
+The following input computes the RDFs between the atoms of the first and second species and between the atoms of the first species in one pass:
+
+\plumedfile
+rdf: RDF_PAIRS GROUPA1=1-100 GROUPB1=101-200 GROUP2=1-100 MAXR=1.5 GRID_BIN=150 BANDWIDTH=0.02
+DUMPGRID ARG=rdf.pair-1 FILE=rdf_ab STRIDE=1
+DUMPGRID ARG=rdf.pair-2 FILE=rdf_aa STRIDE=1
+\endplumedfile
+
+*/
+//+ENDPLUMEDOC
+
+namespace PLMD {
+namespace gridtools {
+
+class RDFPairs : public ActionWithGrid {
+private:
+  GridCoordinatesObject gridobject;
+/// The width of the kernels and the distance at which the kernels are truncated
+  double bandwidth, support;
+  bool discrete;
+/// The reference density
+  double density;
+/// The number of pairs and whether each atom is in the first and second group of each pair
+  unsigned npairs;
+  std::vector<unsigned char> ina, inb;
+/// The number of atoms in the first group and the number of distinct pairs of atoms for each pair of groups
+  std::vector<double> nfirst, ndistinct;
+  LinkCells linkcells;
+  std::vector<unsigned> lcell_indices;
+/// Add the kernel for a distance to the histogram
+  void addToHistogram( const double& dist, const double& weight, double* hist, double* hder ) const ;
+public:
+  static void registerKeywords( Keywords& keys );
+  explicit RDFPairs(const ActionOptions&ao);
+  unsigned getNumberOfDerivatives() override { return 1; }
+  void setupOnFirstStep( const bool /*incalc*/ ) override {}
+  void performTask( const unsigned& /*current*/, MultiValue& /*myvals*/ ) const override { plumed_merror("should not be in RDF_PAIRS performTask"); }
+  std::vector<std::string> getGridCoordinateNames() const override ;
+  const GridCoordinatesObject& getGridCoordinatesObject() const override ;
+  void calculate() override ;
+  void apply() override ;
+};
+
+PLUMED_REGISTER_ACTION(RDFPairs,"RDF_PAIRS")
+
+void RDFPairs::registerKeywords( Keywords& keys ) {
+  ActionWithGrid::registerKeywords( keys );
+  keys.add("numbered","GROUP","the atoms in the group for which the RDF of the atoms around each other is computed");
+  keys.add("numbered","GROUPA","the atoms at the centers of the shells when the RDF between two groups is computed");
+  keys.add("numbered","GROUPB","the atoms that are counted in the shells when the RDF between two groups is computed");
+  keys.reset_style("GROUP","atoms"); keys.reset_style("GROUPA","atoms"); keys.reset_style("GROUPB","atoms");
+  keys.add("compulsory","MAXR","the maximum distance to use for the rdf");
+  keys.add("compulsory","GRID_BIN","the number of bins to use when computing the RDF");
+  keys.add("compulsory","KERNEL","GAUSSIAN","the type of kernel to use for computing the histograms for the RDF.  Can be GAUSSIAN or DISCRETE");
+  keys.add("optional","BANDWIDTH","the bandwidth of the gaussian kernels");
+  keys.add("compulsory","CUTOFF","6.25","the cutoff at which to stop evaluating the kernel functions is set equal to sqrt(2*x)*bandwidth where x is this number");
+  keys.add("optional","DENSITY","the reference density to use when normalizing the RDF.  If it is not given the volume of the box and the number of atoms are used");
+  keys.addOutputComponent("pair","GROUPA1","grid","the radial distribution function for each of the pairs of groups in input");
+  keys.setValueDescription("grid","the radial distribution function");
+}
+
+RDFPairs::RDFPairs(const ActionOptions&ao):
+  Action(ao),
+  ActionWithGrid(ao),
+  bandwidth(0),
+  support(0),
+  discrete(false),
+  density(0),
+  npairs(0),
+  linkcells(comm)
+{
+  // Read the pairs of groups
+  std::vector<AtomNumber> all_atoms; std::vector<std::vector<unsigned> > lista, listb;
+  auto getLocalIndices = [&]( const std::vector<AtomNumber>& atoms ) {
+    std::vector<unsigned> ind( atoms.size() );
+    for(unsigned i=0; i<atoms.size(); ++i) {
+      auto it = std::find( all_atoms.begin(), all_atoms.end(), atoms[i] );
+      ind[i] = it - all_atoms.begin(); if( it==all_atoms.end() ) all_atoms.push_back( atoms[i] );
+    }
+    return ind;
+  };
+  auto addPair = [&]( const std::vector<AtomNumber>& ga, const std::vector<AtomNumber>& gb ) {
+    lista.push_back( getLocalIndices( ga ) );
+    if( gb.size()>0 ) {
+      listb.push_back( getLocalIndices( gb ) );
+      log.printf("  rdf %d is between %d atoms in GROUPA and %d atoms in GROUPB\n", static_cast<int>(lista.size()), static_cast<int>(ga.size()), static_cast<int>(gb.size()) );
+    } else {
+      listb.push_back( lista.back() );
+      log.printf("  rdf %d is for %d atoms in GROUP\n", static_cast<int>(lista.size()), static_cast<int>(ga.size()) );
+    }
+  };
+  std::vector<AtomNumber> ga, gb; parseAtomList("GROUP",ga);
+  if( ga.size()==0 ) { parseAtomList("GROUPA",ga); parseAtomList("GROUPB",gb); }
+  if( ga.size()>0 ) addPair( ga, gb );
+  for(int i=1;; ++i) {
+    // parseAtomList leaves the vector untouched when the keyword is absent
+    ga.resize(0); gb.resize(0); parseAtomList("GROUP",i,ga);
+    if( ga.size()==0 ) { parseAtomList("GROUPA",i,ga); parseAtomList("GROUPB",i,gb); }
+    if( ga.size()==0 ) break;
+    if( i==1 && lista.size()>0 ) error("cannot mix numbered and unnumbered GROUP keywords");
+    addPair( ga, gb );
+  }
+  if( lista.size()==0 ) error("no groups of atoms were specified");
+  npairs = lista.size();
+  // Store the group of each atom so the RDFs can all be computed in one loop over the pairs
+  ina.assign( npairs*all_atoms.size(), 0 ); inb.assign( npairs*all_atoms.size(), 0 );
+  nfirst.resize( npairs ); ndistinct.resize( npairs );
+  for(unsigned p=0; p<npairs; ++p) {
+    for(const auto & j : lista[p]) ina[p*all_atoms.size()+j]=1;
+    for(const auto & j : listb[p]) inb[p*all_atoms.size()+j]=1;
+    double nboth=0; for(unsigned j=0; j<all_atoms.size(); ++j) nboth += ina[p*all_atoms.size()+j]*inb[p*all_atoms.size()+j];
+    nfirst[p] = lista[p].size(); ndistinct[p] = lista[p].size()*double(listb[p].size()) - nboth;
+    if( ndistinct[p]==0 ) error("there are no pairs of distinct atoms in one of the groups");
+  }
+  requestAtoms( all_atoms );
+
+  // Read the kernel
+  double maxr, dp2cutoff; unsigned nbins; parse("MAXR",maxr); parse("GRID_BIN",nbins); parse("CUTOFF",dp2cutoff);
+  std::string kerneltype; parse("KERNEL",kerneltype);
+  if( kerneltype=="DISCRETE" ) {
+    discrete=true; log.printf("  distances are binned on the grid\n");
+  } else if( kerneltype=="GAUSSIAN" || kerneltype=="gaussian" ) {
+    parse("BANDWIDTH",bandwidth); if( bandwidth<=0 ) error("BANDWIDTH should be set and positive for gaussian kernels");
+    support = std::sqrt(2.0*dp2cutoff)*bandwidth;
+    log.printf("  using gaussian kernels with bandwidth %f that are truncated at %f\n", bandwidth, support );
+  } else error("KERNEL should be GAUSSIAN or DISCRETE");
+  parse("DENSITY",density);
+  if( density>0 ) log.printf("  normalizing with reference density %f\n", density );
+  else log.printf("  normalizing with the volume of the box\n");
+  linkcells.setCutoff( maxr + support ); lcell_indices.resize( all_atoms.size() );
+  for(unsigned i=0; i<lcell_indices.size(); ++i) lcell_indices[i]=i;
+  log.printf("  rdf is calculated up to %f on a grid with %d bins using link cells with cutoff %f\n", maxr, nbins, maxr + support );
+
+  // Setup the grid and the values
+  std::vector<bool> ipbc( 1, false ); gridobject.setup( "flat", ipbc, 0, 0.0 );
+  std::vector<std::string> gmin( 1, "0" ), gmax( 1 ); Tools::convert( maxr, gmax[0] );
+  std::vector<unsigned> gbin( 1, nbins ); std::vector<double> gspacing; gridobject.setBounds( gmin, gmax, gbin, gspacing );
+  std::vector<unsigned> shape( gridobject.getNbin(true) );
+  if( npairs==1 ) { addValueWithDerivatives( shape ); setNotPeriodic(); }
+  else {
+    for(unsigned p=0; p<npairs; ++p) {
+      std::string num; Tools::convert( p+1, num );
+      addComponentWithDerivatives( "pair-" + num, shape ); componentIsNotPeriodic( "pair-" + num );
+    }
+  }
+  checkRead();
+}
+
+std::vector<std::string> RDFPairs::getGridCoordinateNames() const {
+  std::vector<std::string> names( 1, "r" ); return names;
+}
+
+const GridCoordinatesObject& RDFPairs::getGridCoordinatesObject() const {
+  return gridobject;
+}
+
+void RDFPairs::addToHistogram( const double& dist, const double& weight, double* hist, double* hder ) const {
+  double dx = gridobject.getGridSpacing()[0]; int npts = gridobject.getNbin(true)[0];
+  if( discrete ) {
+    int k = static_cast<int>( std::floor( dist/dx + 0.5 ) );
+    if( k<npts ) hist[k] += weight/dx;
+    return;
+  }
+  // The kernel is evaluated on the same grid points that KDE uses so the result matches that of RDF
+  int nneigh = static_cast<int>( std::ceil( support/dx ) ), k0 = static_cast<int>( std::floor( dist/dx ) );
+  int kmin = k0 - nneigh, kmax = k0 + nneigh;
+  if( kmin<0 ) kmin=0;
+  if( kmax>=npts ) kmax=npts-1;
+  double norm = weight / ( std::sqrt(2*pi)*bandwidth );
+  for(int k=kmin; k<=kmax; ++k) {
+    double u = ( k*dx - dist ) / bandwidth, val = norm*std::exp( -0.5*u*u );
+    hist[k] += val; hder[k] -= u*val/bandwidth;
+  }
+}
+
+void RDFPairs::calculate() {
+  if( !getPbc().isSet() ) error("RDF_PAIRS can only be used with periodic boundary conditions");
+  const std::vector<Vector>& pos( getPositions() ); unsigned natoms = pos.size();
+  linkcells.buildCellLists( pos, lcell_indices, getPbc() );
+
+  unsigned stride=comm.Get_size(), rank=comm.Get_rank();
+  if( runInSerial() ) { stride=1; rank=0; }
+  unsigned nt=OpenMP::getNumThreads();
+  if( nt*stride*10>natoms ) nt=1;
+
+  unsigned npts = gridobject.getNbin(true)[0]; double rcut2 = linkcells.getCutoff()*linkcells.getCutoff();
+  std::vector<double> hist( 2*npairs*npts, 0 );
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double> omp_hist( hist.size(), 0 );
+    std::vector<unsigned> cells_required( linkcells.getNumberOfCells() ), neighbors( natoms );
+    #pragma omp for nowait
+    for(unsigned i=rank; i<natoms; i+=stride) {
+      unsigned natomsper=1; neighbors[0]=i;
+      linkcells.retrieveNeighboringAtoms( pos[i], cells_required, natomsper, neighbors );
+      for(unsigned n=1; n<natomsper; ++n) {
+        unsigned j=neighbors[n];
+        // Each pair of atoms is only visited once
+        if( j<i ) continue;
+        double d2 = pbcDistance( pos[i], pos[j] ).modulo2();
+        if( d2>rcut2 ) continue;
+        double dist = std::sqrt(d2);
+        for(unsigned p=0; p<npairs; ++p) {
+          unsigned w = ina[p*natoms+i]*inb[p*natoms+j] + ina[p*natoms+j]*inb[p*natoms+i];
+          if( w>0 ) addToHistogram( dist, w, omp_hist.data() + 2*p*npts, omp_hist.data() + (2*p+1)*npts );
+        }
+      }
+    }
+    #pragma omp critical
+    for(unsigned k=0; k<hist.size(); ++k) hist[k] += omp_hist[k];
+  }
+  if( !runInSerial() ) comm.Sum( hist );
+
+  // And normalize the histograms
+  double dx = gridobject.getGridSpacing()[0], volume = getPbc().getBox().determinant();
+  for(unsigned p=0; p<npairs; ++p) {
+    Value* myval = getPntrToComponent(p); const double* h = hist.data() + 2*p*npts; const double* hd = hist.data() + (2*p+1)*npts;
+    double norm = density>0 ? 1.0 / ( nfirst[p]*density ) : volume / ndistinct[p];
+    myval->set( 0, 0.0 ); myval->setGridDerivatives( 0, 0, 0.0 );
+    for(unsigned k=1; k<npts; ++k) {
+      double r = k*dx, shell = 4*pi*r*r;
+      myval->set( k, norm*h[k]/shell ); myval->setGridDerivatives( k, 0, norm*( hd[k]/shell - 2*h[k]/(shell*r) ) );
+    }
+  }
+}
+
+void RDFPairs::apply() {
+  for(int i=0; i<getNumberOfComponents(); ++i) {
+    if( getPntrToComponent(i)->forcesWereAdded() ) error("forces cannot be applied on the output of RDF_PAIRS.  Use RDF instead");
+  }
+}
+
+}
+}
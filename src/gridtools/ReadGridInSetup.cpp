@@ -23,6 +23,7 @@
 #include "core/ActionRegister.h"
 #include "lepton/Lepton.h"
 #include "tools/IFile.h"
+#include "tools/MappedGrid.h"
 
 //+PLUMEDOC GRIDCALC REFERENCE_GRID
 /*
@@ -80,7 +81,7 @@ void ReadGridInSetup::registerKeywords( Keywords& keys ) {
   keys.add("optional","GRID_BIN","the number of bins for the grid");
   keys.add("optional","GRID_SPACING","the approximate grid spacing (to be used as an alternative or together with GRID_BIN)");
   keys.add("optional","VAR","the names to give each of the grid directions in the function.  If you have up to three grid coordinates in your function you can use x, y and z to refer to them.  Otherwise you must use this flag to give your variables names.");
-  keys.add("compulsory","FILE","the name of the file that contains the reference data");
+  keys.add("compulsory","FILE","the name of the file that contains the reference data. Binary grid files are recognized automatically");
   keys.add("compulsory","VALUE","the name of the value that should be read from the grid");
   keys.setValueDescription("grid","the constant function on the grid that was specified in input");
 }
@@ -174,6 +175,28 @@ ReadGridInSetup::ReadGridInSetup(const ActionOptions&ao):
   } else {
     std::string valuestr; parse("VALUE",valuestr);
     std::string tstyle, filen; parse("FILE",filen);
+    if( filen.length()>0 && MappedGrid::isBinary(filen) ) {
+      // binary grids written by DUMPGRID or METAD contain the same information of the header of the text files
+      log.printf("  reading function %s on grid from binary file %s \n", valuestr.c_str(), filen.c_str() );
+      MappedGrid mapped( filen, false );
+      if( mapped.getFuncName()!=valuestr ) error("could not find grid value in input file");
+      if( !mapped.hasDerivatives() ) error("missing derivatives from grid file");
+      dernames=mapped.getArgNames(); std::vector<bool> ipbc( mapped.getIsPeriodic() );
+      std::vector<unsigned> gbin( mapped.getNbin() );
+      for(unsigned i=0; i<dernames.size(); ++i) {
+        if( !ipbc[i] ) gbin[i]--;
+        log.printf("   for %scoordinate %s minimum is %s maximum is %s and number of bins is %d \n", ipbc[i] ? "periodic " : "", dernames[i].c_str(),mapped.getMin()[i].c_str(),mapped.getMax()[i].c_str(),gbin[i]);
+      }
+      createGridAndValue( "flat", ipbc, 0, mapped.getMin(), mapped.getMax(), gbin );
+      // the points are stored in the same order that is used for the value
+      Value* valout=getPntrToComponent(0); std::vector<double> dder( dernames.size() );
+      plumed_assert( valout->getNumberOfValues()==mapped.getSize() );
+      for(unsigned i=0; i<valout->getNumberOfValues(); ++i) {
+        valout->set( i, mapped.getValueAndDerivatives( i, dder ) );
+        for(unsigned j=0; j<dernames.size(); ++j) valout->addGridDerivatives( i, j, dder[j] );
+      }
+      return;
+    }
     if( filen.length()>0 ) {
       std::size_t dot=filen.find_first_of(".");
       if( dot!=std::string::npos ) tstyle=filen.substr(dot+1);
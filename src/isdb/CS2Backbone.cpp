@@ -41,6 +41,8 @@
 #include "tools/PDB.h"
 #include "tools/Torsion.h"
 #include "tools/Communicator.h"
+#include "CellGrid.h"
+#include <algorithm>
 
 namespace PLMD {
 namespace isdb {
@@ -398,6 +400,7 @@ private:
 class CS2Backbone : public MetainferenceBase {
   struct ChemicalShift {
     double exp_cs;              // a reference chemical shifts
+    double const_shift;         // random coil contribution, fixed by the sequence
     Value *comp;                // a pointer to the component
     unsigned res_kind;          // residue type (STD/GLY/PRO)
     unsigned atm_kind;          // nuclues (HA/CA/CB/CO/NH/HN)
@@ -417,9 +420,11 @@ class CS2Backbone : public MetainferenceBase {
     std::vector<int> xd1;            // additional couple of atoms
     std::vector<int> xd2;            // additional couple of atoms
     std::vector<unsigned> box_nb;    // non-bonded atoms
+    std::vector<unsigned> rings;     // rings contributing to the ring current
 
     ChemicalShift():
       exp_cs(0.),
+      const_shift(0.),
       comp(NULL),
       res_kind(0),
       atm_kind(0),
@@ -476,6 +481,10 @@ class CS2Backbone : public MetainferenceBase {
   bool             camshift;
   bool             pbc;
   bool             serial;
+  double           ring_cutoff2;
+  unsigned         total_rings_atoms;
+  CellGrid         atom_cells;
+  CellGrid         ring_cells;
 
   void init_cs(const std::string &file, const std::string &k, const PDB &pdb);
   void update_neighb();
@@ -506,6 +515,7 @@ void CS2Backbone::registerKeywords( Keywords& keys ) {
   keys.add("compulsory","DATADIR","data/","The folder with the experimental chemical shifts.");
   keys.add("compulsory","TEMPLATE","template.pdb","A PDB file of the protein system.");
   keys.add("compulsory","NEIGH_FREQ","20","Period in step for neighbor list update.");
+  keys.add("optional","RING_CUTOFF","Include in the ring current contribution only the rings whose center is closer than this distance to the atom, the list is updated every NEIGH_FREQ steps (by default all rings are included).");
   keys.addFlag("CAMSHIFT",false,"Set to TRUE if you to calculate a single CamShift score.");
   keys.addFlag("NOEXP",false,"Set to TRUE if you don't want to have fixed components with the experimental values.");
   keys.addOutputComponent("ha","default","scalar","the calculated Ha hydrogen chemical shifts");
@@ -528,7 +538,9 @@ CS2Backbone::CS2Backbone(const ActionOptions&ao):
   max_cs_atoms(0),
   camshift(false),
   pbc(true),
-  serial(false)
+  serial(false),
+  ring_cutoff2(-1.),
+  total_rings_atoms(0)
 {
   std::vector<AtomNumber> used_atoms;
   parseAtomList("ATOMS",used_atoms);
@@ -555,6 +567,13 @@ CS2Backbone::CS2Backbone(const ActionOptions&ao):
   box_nupdate=20;
   parse("NEIGH_FREQ", box_nupdate);
 
+  double ring_cutoff=-1.;
+  parse("RING_CUTOFF", ring_cutoff);
+  if(ring_cutoff>0.) {
+    ring_cutoff2 = ring_cutoff*ring_cutoff;
+    log.printf("  ring current contributions from rings within %f\n", ring_cutoff);
+  }
+
   std::string stringadb  = stringa_data + std::string("/camshift.db");
   std::string stringapdb = stringa_data + std::string("/") + stringa_template;
 
@@ -708,10 +727,21 @@ void CS2Backbone::init_cs(const std::string &file, const std::string &nucl, cons
     if(RES!="ALA"&&RES!="GLY") {tmp_cs.bb.resize(18); tmp_cs.has_chi1=true;}
     else {tmp_cs.bb.resize(16); tmp_cs.has_chi1=false;}
 
-    std::vector<AtomNumber> res_atoms = pdb.getAtomsInResidue(resnum, chains[ichain]);
+    tmp_cs.const_shift = db.CONSTAAPREV(tmp_cs.res_kind,tmp_cs.atm_kind)[tmp_cs.res_type_prev] +
+                         db.CONSTAACURR(tmp_cs.res_kind,tmp_cs.atm_kind)[tmp_cs.res_type_curr] +
+                         db.CONSTAANEXT(tmp_cs.res_kind,tmp_cs.atm_kind)[tmp_cs.res_type_next];
+
+    // the atom names of the three residues are looked up only once
+    const std::vector<AtomNumber> res_atoms = pdb.getAtomsInResidue(resnum, chains[ichain]);
+    const std::vector<AtomNumber> prev_res_atoms = pdb.getAtomsInResidue(resnum-1, chains[ichain]);
+    const std::vector<AtomNumber> next_res_atoms = pdb.getAtomsInResidue(resnum+1, chains[ichain]);
+    std::vector<std::string> res_names(res_atoms.size()), prev_res_names(prev_res_atoms.size()), next_res_names(next_res_atoms.size());
+    for(unsigned a=0; a<res_atoms.size(); a++) res_names[a] = pdb.getAtomName(res_atoms[a]);
+    for(unsigned a=0; a<prev_res_atoms.size(); a++) prev_res_names[a] = pdb.getAtomName(prev_res_atoms[a]);
+    for(unsigned a=0; a<next_res_atoms.size(); a++) next_res_names[a] = pdb.getAtomName(next_res_atoms[a]);
     // find the position of the nucleus and of the other backbone atoms as well as for phi/psi/chi
     for(unsigned a=0; a<res_atoms.size(); a++) {
-      std::string AN = pdb.getAtomName(res_atoms[a]);
+      const std::string &AN = res_names[a];
       if(nucl=="HA"&&(AN=="HA"||AN=="HA1"||AN=="HA3")) tmp_cs.ipos = res_atoms[a].index();
       else if(nucl=="H"&&(AN=="H"||AN=="HN"))          tmp_cs.ipos = res_atoms[a].index();
       else if(nucl=="N"&&AN=="N")                      tmp_cs.ipos = res_atoms[a].index();
@@ -720,10 +750,9 @@ void CS2Backbone::init_cs(const std::string &file, const std::string &nucl, cons
       else if(nucl=="C"&&AN=="C" )                     tmp_cs.ipos = res_atoms[a].index();
     }
 
-    std::vector<AtomNumber> prev_res_atoms = pdb.getAtomsInResidue(resnum-1, chains[ichain]);
     // find the position of the previous residues backbone atoms
     for(unsigned a=0; a<prev_res_atoms.size(); a++) {
-      std::string AN = pdb.getAtomName(prev_res_atoms[a]);
+      const std::string &AN = prev_res_names[a];
       if(AN=="N")                             { tmp_cs.bb[Np]  = prev_res_atoms[a].index(); }
       else if(AN=="CA")                       { tmp_cs.bb[CAp] = prev_res_atoms[a].index(); }
       else if(AN=="HA"||AN=="HA1"||AN=="HA3") { tmp_cs.bb[HAp] = prev_res_atoms[a].index(); }
@@ -732,7 +761,7 @@ void CS2Backbone::init_cs(const std::string &file, const std::string &nucl, cons
     }
 
     for(unsigned a=0; a<res_atoms.size(); a++) {
-      std::string AN = pdb.getAtomName(res_atoms[a]);
+      const std::string &AN = res_names[a];
       if(AN=="N")                                         { tmp_cs.bb[Nc]  = res_atoms[a].index(); }
       else if(AN=="H" ||AN=="HN"||(AN=="CD"&&RES=="PRO")) { tmp_cs.bb[Hc]  = res_atoms[a].index(); }
       else if(AN=="CA")                                   { tmp_cs.bb[CAc] = res_atoms[a].index(); }
@@ -746,11 +775,10 @@ void CS2Backbone::init_cs(const std::string &file, const std::string &nucl, cons
       }
     }
 
-    std::vector<AtomNumber> next_res_atoms = pdb.getAtomsInResidue(resnum+1, chains[ichain]);
     std::string NRES = pdb.getResidueName(resnum+1, chains[ichain]);
     // find the position of the previous residues backbone atoms
     for(unsigned a=0; a<next_res_atoms.size(); a++) {
-      std::string AN = pdb.getAtomName(next_res_atoms[a]);
+      const std::string &AN = next_res_names[a];
       if(AN=="N")                                          { tmp_cs.bb[Nn]  = next_res_atoms[a].index(); }
       else if(AN=="H" ||AN=="HN"||(AN=="CD"&&NRES=="PRO")) { tmp_cs.bb[Hn]  = next_res_atoms[a].index(); }
       else if(AN=="CA")                                    { tmp_cs.bb[CAn] = next_res_atoms[a].index(); }
@@ -763,7 +791,7 @@ void CS2Backbone::init_cs(const std::string &file, const std::string &nucl, cons
 
     for(unsigned sc=0; sc<sc_atm.size(); sc++) {
       for(unsigned aa=0; aa<res_atoms.size(); aa++) {
-        if(pdb.getAtomName(res_atoms[aa])==sc_atm[sc]) {
+        if(res_names[aa]==sc_atm[sc]) {
           tmp_cs.side_chain.push_back(res_atoms[aa].index());
         }
       }
@@ -777,34 +805,34 @@ void CS2Backbone::init_cs(const std::string &file, const std::string &nucl, cons
     const int resOffsetP2[] = { 0,    0,   0,    0,    0,   0,    0,    0,   0,    0,    0,   0,    -1,  -1,   -1,   -1,  -1,   -1,   0,    0,   0,   -1,  1,   0,    0,    1};
 
     for(unsigned q=0; q<db.get_numXtraDists()-1; q++) {
-      std::vector<AtomNumber> at1;
-      if(resOffsetP1[q]== 0) at1 = res_atoms;
-      if(resOffsetP1[q]==-1) at1 = prev_res_atoms;
-      if(resOffsetP1[q]==+1) at1 = next_res_atoms;
+      const std::vector<AtomNumber> *at1 = &res_atoms;
+      const std::vector<std::string> *nm1 = &res_names;
+      if(resOffsetP1[q]==-1) { at1 = &prev_res_atoms; nm1 = &prev_res_names; }
+      if(resOffsetP1[q]==+1) { at1 = &next_res_atoms; nm1 = &next_res_names; }
 
-      std::vector<AtomNumber> at2;
-      if(resOffsetP2[q]== 0) at2 = res_atoms;
-      if(resOffsetP2[q]==-1) at2 = prev_res_atoms;
-      if(resOffsetP2[q]==+1) at2 = next_res_atoms;
+      const std::vector<AtomNumber> *at2 = &res_atoms;
+      const std::vector<std::string> *nm2 = &res_names;
+      if(resOffsetP2[q]==-1) { at2 = &prev_res_atoms; nm2 = &prev_res_names; }
+      if(resOffsetP2[q]==+1) { at2 = &next_res_atoms; nm2 = &next_res_names; }
 
       int tmp1 = -1;
-      for(unsigned a=0; a<at1.size(); a++) {
-        std::string name = pdb.getAtomName(at1[a]);
+      for(unsigned a=0; a<at1->size(); a++) {
+        std::string name = (*nm1)[a];
         xdist_name_map(name);
 
         if(name==atomsP1[q]) {
-          tmp1 = at1[a].index();
+          tmp1 = (*at1)[a].index();
           break;
         }
       }
 
       int tmp2 = -1;
-      for(unsigned a=0; a<at2.size(); a++) {
-        std::string name = pdb.getAtomName(at2[a]);
+      for(unsigned a=0; a<at2->size(); a++) {
+        std::string name = (*nm2)[a];
         xdist_name_map(name);
 
         if(name==atomsP2[q]) {
-          tmp2 = at2[a].index();
+          tmp2 = (*at2)[a].index();
           break;
         }
       }
@@ -861,7 +889,7 @@ void CS2Backbone::init_rings(const PDB &pdb)
   // number of chains
   std::vector<std::string> chains;
   pdb.getChainNames( chains );
-  unsigned total_rings_atoms = 0;
+  total_rings_atoms = 0;
 
   // cycle over chains
   for(unsigned i=0; i<chains.size(); i++) {
@@ -957,8 +985,8 @@ void CS2Backbone::calculate()
 {
   if(pbc) makeWhole();
   if(getExchangeStep()) box_count=0;
-  if(box_count==0) update_neighb();
   compute_ring_parameters();
+  if(box_count==0) update_neighb();
 
   std::vector<double> camshift_sigma2(6);
   camshift_sigma2[0] = 0.08; // HA
@@ -998,9 +1026,7 @@ void CS2Backbone::calculate()
       const unsigned aa_kind = myfrag->res_kind;
       const unsigned at_kind = myfrag->atm_kind;
 
-      double shift = db.CONSTAAPREV(aa_kind,at_kind)[myfrag->res_type_prev] +
-                     db.CONSTAACURR(aa_kind,at_kind)[myfrag->res_type_curr] +
-                     db.CONSTAANEXT(aa_kind,at_kind)[myfrag->res_type_next];
+      double shift = myfrag->const_shift;
 
       const unsigned ipos = myfrag->ipos;
       cs_atoms[kdx+0] = ipos;
@@ -1149,9 +1175,10 @@ void CS2Backbone::calculate()
 
       //RINGS
       const double *rc = db.CO_RING(aa_kind,at_kind);
-      const unsigned rsize = ringInfo.size();
+      const unsigned rsize = myfrag->rings.size();
       // cycle over the list of rings
-      for(unsigned q=0; q<rsize; q++) {
+      for(unsigned qr=0; qr<rsize; qr++) {
+        const unsigned q = myfrag->rings[qr];
         // compute angle from ring middle point to current atom position
         // get distance std::vector from query atom to ring center and normal std::vector to ring plane
         const Vector n   = ringInfo[q].normVect;
@@ -1357,22 +1384,50 @@ void CS2Backbone::calculate()
 }
 
 void CS2Backbone::update_neighb() {
+  // bin the atoms and the ring centers so that only the close ones are checked
+  atom_cells.build(getPositions(), cutOffNB);
+  std::vector<Vector> ring_pos(ringInfo.size());
+  for(unsigned q=0; q<ringInfo.size(); q++) ring_pos[q] = ringInfo[q].position;
+  if(ring_cutoff2>0.) ring_cells.build(ring_pos, std::sqrt(ring_cutoff2));
   // cycle over chemical shifts
   unsigned nt=OpenMP::getNumThreads();
-  #pragma omp parallel for num_threads(nt)
-  for(unsigned cs=0; cs<chemicalshifts.size(); cs++) {
-    const unsigned boxsize = getNumberOfAtoms();
-    chemicalshifts[cs].box_nb.clear();
-    chemicalshifts[cs].box_nb.reserve(150);
-    const unsigned res_curr = res_num[chemicalshifts[cs].ipos];
-    for(unsigned bat=0; bat<boxsize; bat++) {
-      const unsigned res_dist = std::abs(static_cast<int>(res_curr-res_num[bat]));
-      if(res_dist<2) continue;
-      const Vector distance = delta(getPosition(bat),getPosition(chemicalshifts[cs].ipos));
-      const double d2=distance.modulo2();
-      if(d2<cutOffNB2) chemicalshifts[cs].box_nb.push_back(bat);
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<unsigned> close;
+    #pragma omp for
+    for(unsigned cs=0; cs<chemicalshifts.size(); cs++) {
+      const unsigned ipos = chemicalshifts[cs].ipos;
+      chemicalshifts[cs].box_nb.clear();
+      chemicalshifts[cs].box_nb.reserve(150);
+      const unsigned res_curr = res_num[ipos];
+      // atoms are kept in increasing order
+      close.clear();
+      atom_cells.retrieve(getPosition(ipos), cutOffNB, close);
+      std::sort(close.begin(), close.end());
+      for(unsigned i=0; i<close.size(); i++) {
+        const unsigned bat = close[i];
+        const unsigned res_dist = std::abs(static_cast<int>(res_curr-res_num[bat]));
+        if(res_dist<2) continue;
+        const Vector distance = delta(getPosition(bat),getPosition(ipos));
+        const double d2=distance.modulo2();
+        if(d2<cutOffNB2) chemicalshifts[cs].box_nb.push_back(bat);
+      }
+      // rings contributing to the ring current
+      chemicalshifts[cs].rings.clear();
+      if(ring_cutoff2>0.) {
+        close.clear();
+        ring_cells.retrieve(getPosition(ipos), std::sqrt(ring_cutoff2), close);
+        std::sort(close.begin(), close.end());
+        for(unsigned i=0; i<close.size(); i++) {
+          if(delta(ring_pos[close[i]],getPosition(ipos)).modulo2()<ring_cutoff2) chemicalshifts[cs].rings.push_back(close[i]);
+        }
+      } else {
+        for(unsigned q=0; q<ringInfo.size(); q++) chemicalshifts[cs].rings.push_back(q);
+      }
+      unsigned rings_atoms = 0;
+      for(unsigned i=0; i<chemicalshifts[cs].rings.size(); i++) rings_atoms += (ringInfo[chemicalshifts[cs].rings[i]].numAtoms==6) ? 6 : 3;
+      chemicalshifts[cs].totcsatoms = chemicalshifts[cs].csatoms - total_rings_atoms + rings_atoms + chemicalshifts[cs].box_nb.size();
     }
-    chemicalshifts[cs].totcsatoms = chemicalshifts[cs].csatoms + chemicalshifts[cs].box_nb.size();
   }
   max_cs_atoms=0;
   for(unsigned cs=0; cs<chemicalshifts.size(); cs++) {
@@ -0,0 +1,87 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "CellGrid.h"
+#include "tools/Exception.h"
+#include <algorithm>
+#include <cmath>
+
+namespace PLMD {
+namespace isdb {
+
+CellGrid::CellGrid():
+  ncells_({1,1,1}),
+  starts_(2,0)
+{
+}
+
+void CellGrid::build(const Vector* pos, unsigned n, double side) {
+  plumed_massert(side>0.0, "the side of the cells should be positive");
+  // bounding box of the points
+  Vector upper;
+  if(n>0) lower_ = upper = pos[0];
+  for(unsigned i=1; i<n; ++i) {
+    for(unsigned k=0; k<3; ++k) {
+      lower_[k] = std::min(lower_[k], pos[i][k]);
+      upper[k]  = std::max(upper[k],  pos[i][k]);
+    }
+  }
+  // the number of cells is limited so that there are not many more cells than points
+  double maxcells = std::floor(std::cbrt(static_cast<double>(n))) + 1.0;
+  for(unsigned k=0; k<3; ++k) {
+    double extent = upper[k] - lower_[k];
+    side_[k] = std::max(side, extent/maxcells);
+    ncells_[k] = static_cast<unsigned>(std::floor(extent/side_[k])) + 1;
+  }
+  // counting sort of the points on the cells
+  std::vector<unsigned> mycell(n);
+  starts_.assign(ncells_[0]*ncells_[1]*ncells_[2]+1, 0);
+  for(unsigned i=0; i<n; ++i) {
+    mycell[i] = getCellIndex(0,pos[i][0]) + ncells_[0]*(getCellIndex(1,pos[i][1]) + ncells_[1]*getCellIndex(2,pos[i][2]));
+    starts_[mycell[i]+1]++;
+  }
+  for(unsigned i=1; i<starts_.size(); ++i) starts_[i] += starts_[i-1];
+  std::vector<unsigned> fill(starts_.begin(), starts_.end()-1);
+  points_.resize(n);
+  for(unsigned i=0; i<n; ++i) points_[fill[mycell[i]]++] = i;
+}
+
+int CellGrid::getCellIndex(unsigned k, double x) const {
+  int n = static_cast<int>(std::floor((x-lower_[k])/side_[k]));
+  return std::min(std::max(n,0), static_cast<int>(ncells_[k])-1);
+}
+
+void CellGrid::retrieve(const Vector& pos, double r, std::vector<unsigned>& list) const {
+  std::array<int,3> lo, hi;
+  for(unsigned k=0; k<3; ++k) {
+    // no cell overlaps the cube around pos
+    if(pos[k]+r<lower_[k] || pos[k]-r>lower_[k]+ncells_[k]*side_[k]) return;
+    lo[k] = getCellIndex(k,pos[k]-r);
+    hi[k] = getCellIndex(k,pos[k]+r);
+  }
+  for(int iz=lo[2]; iz<=hi[2]; ++iz) for(int iy=lo[1]; iy<=hi[1]; ++iy) for(int ix=lo[0]; ix<=hi[0]; ++ix) {
+        unsigned cell = ix + ncells_[0]*(iy + ncells_[1]*iz);
+        list.insert(list.end(), points_.begin()+starts_[cell], points_.begin()+starts_[cell+1]);
+      }
+}
+
+}
+}
@@ -0,0 +1,61 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_isdb_CellGrid_h
+#define __PLUMED_isdb_CellGrid_h
+
+#include "tools/Vector.h"
+#include <array>
+#include <vector>
+
+namespace PLMD {
+namespace isdb {
+
+/// Non periodic grid of cells over a set of points.
+/// It is used to find the points that are within a given distance from a position
+/// without looping over all the points, e.g. the voxels or GMM components close to an atom.
+class CellGrid {
+/// Lower corner of the grid
+  Vector lower_;
+/// Side of the cells in each direction
+  Vector side_;
+/// Number of cells in each direction
+  std::array<unsigned,3> ncells_;
+/// Position of the first point of each cell in points_
+  std::vector<unsigned> starts_;
+/// Indices of the points ordered by cell
+  std::vector<unsigned> points_;
+/// Index of the cell containing coordinate x along direction k
+  int getCellIndex(unsigned k, double x) const ;
+public:
+  CellGrid();
+/// Bin the points in cells with the given side (larger cells are used if there are too many)
+  void build(const std::vector<Vector>& pos, double side) { build(pos.data(), pos.size(), side); }
+/// Same as above, for n points stored contiguously
+  void build(const Vector* pos, unsigned n, double side);
+/// Append to list the indices of the points in the cells that overlap the cube of half side r centered in pos
+  void retrieve(const Vector& pos, double r, std::vector<unsigned>& list) const ;
+};
+
+}
+}
+
+#endif
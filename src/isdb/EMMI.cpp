@@ -30,6 +30,7 @@
 #include "core/ActionSet.h"
 #include "tools/File.h"
 #include "tools/Random.h"
+#include "CellGrid.h"
 
 #include <string>
 #include <map>
@@ -157,6 +158,8 @@ private:
   bool first_time_;
   bool no_aver_;
   std::vector<unsigned> nl_;
+// cells over the atoms, used to build the neighbor list
+  CellGrid atom_cells_;
 // parallel stuff
   unsigned size_;
   unsigned rank_;
@@ -1281,15 +1284,54 @@ void EMMI::update_neighbor_list()
   // clear old neighbor list
   nl_.clear();
 
+  // an atom contributes only if the exponent of the overlap is within the tabulated range.
+  // Since the exponent is larger than the squared distance divided by the largest eigenvalue
+  // of the sum of covariances, which is smaller than its trace, this defines a distance cutoff per component
+  double expmax = 2.0 * dexp_ * (static_cast<double>(nexp_) - 0.5);
+  double s2max = 0.5 * (*max_element(GMM_m_s_.begin(), GMM_m_s_.end())) / pi / pi;
+  std::vector<double> rcut(GMM_d_size);
+  double rmax = 0.0;
+  for(unsigned id=0; id<GMM_d_size; ++id) {
+    double trace = 3.0*s2max + GMM_d_cov_[id][0] + GMM_d_cov_[id][3] + GMM_d_cov_[id][5];
+    rcut[id] = 1.0001 * std::sqrt(expmax * trace);
+    rmax = std::max(rmax, rcut[id]);
+  }
+  // with pbc, atoms are brought to the image closest to the center of the map.
+  // This is the image closest to each component only if the box is large enough
+  bool usecells = true;
+  std::vector<Vector> pos(getPositions());
+  if(pbc_ && getPbc().isSet()) {
+    Vector center;
+    for(unsigned id=0; id<GMM_d_size; ++id) center += GMM_d_m_[id];
+    if(GMM_d_size>0) center /= static_cast<double>(GMM_d_size);
+    double radius = 0.0;
+    for(unsigned id=0; id<GMM_d_size; ++id) radius = std::max(radius, delta(center, GMM_d_m_[id]).modulo());
+    Tensor reciprocal(transpose(getPbc().getInvBox()));
+    for(unsigned k=0; k<3; ++k) if(radius+rmax >= 0.5/reciprocal.getRow(k).modulo()) usecells = false;
+    if(usecells) for(unsigned im=0; im<GMM_m_size; ++im) pos[im] = center + pbcDistance(center, pos[im]);
+  }
+  if(usecells) atom_cells_.build(pos, rmax);
+
   // cycle on GMM components - in parallel
+  std::vector<unsigned> close;
   for(unsigned id=rank_; id<GMM_d_size; id+=size_) {
     // overlap lists and map
     std::vector<double> ov_l;
     std::map<double, unsigned> ov_m;
     // total overlap with id
     double ov_tot = 0.0;
-    // cycle on all atoms
-    for(unsigned im=0; im<GMM_m_size; ++im) {
+    // atoms that can overlap with id, in increasing order
+    close.clear();
+    if(usecells) {
+      atom_cells_.retrieve(GMM_d_m_[id], rcut[id], close);
+      std::sort(close.begin(), close.end());
+    } else {
+      close.resize(GMM_m_size);
+      for(unsigned im=0; im<GMM_m_size; ++im) close[im] = im;
+    }
+    // cycle on close atoms
+    for(unsigned i=0; i<close.size(); ++i) {
+      unsigned im = close[i];
       // get index in auxiliary lists
       unsigned kaux = GMM_m_type_[im] * GMM_d_size + id;
       // calculate exponent of overlap
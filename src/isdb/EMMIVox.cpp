@@ -36,6 +36,8 @@
 #include <numeric>
 #include <ctime>
 #include "tools/Random.h"
+#include "CellGrid.h"
+#include "EMMap.h"
 
 #include <torch/torch.h>
 #include <torch/script.h>
@@ -59,6 +61,16 @@ A coarse-grained forward model can also be used in combination with the MARTINI
 Combined with a multi-replica framework (such as the -multi option in GROMACS), the user can model an ensemble of structures using
 the Metainference approach \cite Bonomi:2016ip . The approach can be used to model continous dynamics of flexible regions as well as semi-ordered waters, lipids, and ions.
 
+By default the overlaps between atoms and voxels are computed in single precision. With PRECISION=MIXED the per-pair overlaps and their derivatives
+are still computed in single precision, while the sums over pairs, the score and the atomic derivatives are accumulated in double precision.
+PRECISION=DOUBLE performs the whole calculation in double precision. VALIDATE_STRIDE can be used to periodically compare the model density
+with a double precision calculation on the CPU; the largest deviation is written in the log.
+
+DATA_FILE can be a text file with the voxel centers, densities and errors, an MRC/CCP4 map (with extension .mrc, .map or .ccp4)
+or a binary map written with WRITE_BINARY_MAP. For MRC/CCP4 maps only the voxels with density larger than MAP_THRESHOLD are used,
+the positions are converted from Angstrom and the error of each voxel is set to the minimum error. Binary maps are memory-mapped read-only,
+so that all the replicas running on the same node share a single copy of the map and no time is spent parsing the file at startup.
+
 \warning
     To use EMMIVOX, PLUMED must be linked against the LibTorch library as described \ref ISDB "here"
 
@@ -94,12 +106,16 @@ private:
 // model density
   std::vector<double> ovmd_;
 
+// data map - storage, possibly memory-mapped
+  EMMap map_;
+// data map - number of voxels
+  unsigned nvox_;
 // data map - voxel position
-  std::vector<Vector> Map_m_;
+  const Vector* Map_m_;
 // data map - density
-  std::vector<double> ovdd_;
+  const double* ovdd_;
 // data map - error
-  std::vector<double> exp_err_;
+  const double* exp_err_;
 
 // derivatives
   std::vector<Vector> ovmd_der_;
@@ -123,6 +139,8 @@ private:
   std::vector< std::pair<unsigned,unsigned> > nl_;
   std::vector< std::pair<unsigned,unsigned> > ns_;
   std::vector<Vector> refpos_;
+// cells over the voxels, used to build the neighbor sphere
+  CellGrid voxel_cells_;
 // averaging
   bool no_aver_;
 // correlation;
@@ -174,6 +192,16 @@ private:
   torch::Tensor invs2_nl_gpu_;
   torch::Tensor Map_m_nl_gpu_;
   torch::DeviceType device_t_;
+// precision of the per-pair overlaps and of the accumulations
+  torch::Dtype ftype_;
+  torch::Dtype rtype_;
+// buffers reused at every step
+  std::vector<double> posg_;
+  torch::Tensor pos_gpu_;
+  torch::Tensor atoms_der_gpu_;
+// stride for checking the model density against a double precision calculation
+  unsigned validate_stride_;
+  void validate_fmod();
 //
 // write file with model density
   void write_model_density(long int step);
@@ -191,7 +219,7 @@ private:
 // calculate model parameters
   std::vector<double> get_Model_param(std::vector<AtomNumber> &atoms);
 // read data file
-  void get_exp_data(const std::string &datafile);
+  void get_exp_data(const std::string &datafile, double threshold);
 // auxiliary methods
   void prepare_gpu();
   void initialize_Bfactor(double reso);
@@ -226,7 +254,9 @@ PLUMED_REGISTER_ACTION(EMMIVOX,"EMMIVOX")
 void EMMIVOX::registerKeywords( Keywords& keys ) {
   Colvar::registerKeywords( keys );
   keys.add("atoms","ATOMS","atoms used in the calculation of the density map, typically all heavy atoms");
-  keys.add("compulsory","DATA_FILE","file with cryo-EM map");
+  keys.add("compulsory","DATA_FILE","file with cryo-EM map: text, MRC/CCP4 or binary format");
+  keys.add("optional","MAP_THRESHOLD","only voxels with density larger than this value are read from MRC/CCP4 maps");
+  keys.add("optional","WRITE_BINARY_MAP","write the map read from DATA_FILE in binary format, to be used as DATA_FILE in later runs");
   keys.add("compulsory","RESOLUTION", "cryo-EM map resolution");
   keys.add("compulsory","NORM_DENSITY","integral of experimental density");
   keys.add("compulsory","WRITE_STRIDE","stride for writing status file");
@@ -247,6 +277,8 @@ void EMMIVOX::registerKeywords( Keywords& keys ) {
   keys.addFlag("NO_AVER",false,"no ensemble averaging in multi-replica mode");
   keys.addFlag("CORRELATION",false,"calculate correlation coefficient");
   keys.addFlag("GPU",false,"calculate EMMIVOX on GPU with Libtorch");
+  keys.add("compulsory","PRECISION","FLOAT","precision of the calculation: FLOAT, MIXED (overlaps in single precision, accumulations and score in double precision) or DOUBLE");
+  keys.add("optional","VALIDATE_STRIDE","stride for comparing the model density with a double precision calculation on the CPU");
   keys.addFlag("BFACT_NOCHAIN",false,"Do not use chain ID for Bfactor MC");
   keys.addFlag("BFACT_READ",false,"Read Bfactor on RESTART (automatic with DBFACT>0)");
   keys.addFlag("BFACT_MINIMIZE",false,"Accept only moves that decrease energy");
@@ -261,6 +293,7 @@ void EMMIVOX::registerKeywords( Keywords& keys ) {
 
 EMMIVOX::EMMIVOX(const ActionOptions&ao):
   PLUMED_COLVAR_INIT(ao),
+  nvox_(0), Map_m_(nullptr), ovdd_(nullptr), exp_err_(nullptr),
   nl_dist_cutoff_(1.0), nl_gauss_cutoff_(3.0), nl_stride_(50),
   first_time_(true), no_aver_(false), do_corr_(false),
   scale_(1.), offset_(0.),
@@ -268,7 +301,8 @@ EMMIVOX::EMMIVOX(const ActionOptions&ao):
   bfactsig_(0.1), bfactnoc_(false), bfactread_(false),
   MCBstride_(1), MCBaccept_(0.), MCBtrials_(0.), bfactemin_(false),
   martini_(false), statusstride_(0), first_status_(true),
-  eps_(0.0001), mapstride_(0), gpu_(false)
+  eps_(0.0001), mapstride_(0), gpu_(false),
+  ftype_(torch::kFloat32), rtype_(torch::kFloat32), validate_stride_(0)
 {
   // set constants
   inv_sqrt2_ = 1.0/sqrt(2.0);
@@ -282,6 +316,10 @@ EMMIVOX::EMMIVOX(const ActionOptions&ao):
   // file with experimental cryo-EM map
   std::string datafile;
   parse("DATA_FILE", datafile);
+  double map_threshold = 0.0;
+  parse("MAP_THRESHOLD", map_threshold);
+  std::string binmapfile;
+  parse("WRITE_BINARY_MAP", binmapfile);
 
   // neighbor list cutoffs
   parse("NL_DIST_CUTOFF",nl_dist_cutoff_);
@@ -360,6 +398,17 @@ EMMIVOX::EMMIVOX(const ActionOptions&ao):
     device_t_ = torch::kCPU;
     gpu_ = false;
   }
+  // precision
+  std::string precision;
+  parse("PRECISION",precision);
+  if(precision=="FLOAT") {
+    ftype_ = torch::kFloat32; rtype_ = torch::kFloat32;
+  } else if(precision=="MIXED") {
+    ftype_ = torch::kFloat32; rtype_ = torch::kFloat64;
+  } else if(precision=="DOUBLE") {
+    ftype_ = torch::kFloat64; rtype_ = torch::kFloat64;
+  } else error("PRECISION should be FLOAT, MIXED or DOUBLE");
+  parse("VALIDATE_STRIDE",validate_stride_);
 
 // Martini model
   parseFlag("MARTINI",martini_);
@@ -386,6 +435,8 @@ EMMIVOX::EMMIVOX(const ActionOptions&ao):
   if(no_aver_) log.printf("  without ensemble averaging\n");
   if(gpu_) {log.printf("  running on GPU \n");}
   else {log.printf("  running on CPU \n");}
+  log.printf("  precision : %s\n", precision.c_str());
+  if(validate_stride_>0) log.printf("  comparing model density with double precision calculation every %u steps\n", validate_stride_);
   if(nl_dist_cutoff_ <1.0e+10) log.printf("  neighbor list distance cutoff : %lf\n", nl_dist_cutoff_);
   if(nl_gauss_cutoff_<1.0e+10) log.printf("  neighbor list Gaussian sigma cutoff : %lf\n", nl_gauss_cutoff_);
   log.printf("  neighbor list update stride : %u\n",  nl_stride_);
@@ -415,8 +466,12 @@ EMMIVOX::EMMIVOX(const ActionOptions&ao):
   std::vector<double> Model_w = get_Model_param(atoms);
 
   // read experimental map and errors
-  get_exp_data(datafile);
-  log.printf("  number of voxels : %u\n", static_cast<unsigned>(ovdd_.size()));
+  get_exp_data(datafile, map_threshold);
+  log.printf("  number of voxels : %u\n", nvox_);
+  if(binmapfile.length()>0) {
+    log.printf("  writing binary map to file : %s\n", binmapfile.c_str());
+    if(comm.Get_rank()==0 && replica_==0) map_.writeBinary(binmapfile);
+  }
 
   // normalize atom weight map
   double norm_m = accumulate(Model_w.begin(),  Model_w.end(),  0.0);
@@ -431,9 +486,9 @@ EMMIVOX::EMMIVOX(const ActionOptions&ao):
   }
 
   // median density
-  double ovdd_m = get_median(ovdd_);
+  double ovdd_m = get_median(std::vector<double>(ovdd_, ovdd_+nvox_));
   // median experimental error
-  double err_m  = get_median(exp_err_);
+  double err_m  = get_median(std::vector<double>(exp_err_, exp_err_+nvox_));
   // minimum error
   double minerr = sigma_min*ovdd_m;
   // print out statistics
@@ -441,7 +496,7 @@ EMMIVOX::EMMIVOX(const ActionOptions&ao):
   log.printf("     minimum error  : %lf\n", minerr);
   log.printf("     median error   : %lf\n", err_m);
   // populate ismin: cycle on all voxels
-  for(unsigned id=0; id<ovdd_.size(); ++id) {
+  for(unsigned id=0; id<nvox_; ++id) {
     // define smin
     double smin = std::max(minerr, exp_err_[id]);
     // and to ismin_
@@ -460,10 +515,13 @@ EMMIVOX::EMMIVOX(const ActionOptions&ao):
   // prepare auxiliary vectors
   get_auxiliary_vectors();
 
+  // bin the voxels in cells as large as the neighbor sphere radius
+  voxel_cells_.build(Map_m_, nvox_, 2.0*(*max_element(cut_.begin(), cut_.end())));
+
   // prepare other vectors: data and derivatives
-  ovmd_.resize(ovdd_.size());
+  ovmd_.resize(nvox_);
   atom_der_.resize(Model_type_.size());
-  score_der_.resize(ovdd_.size());
+  score_der_.resize(nvox_);
 
   // add components
   addComponentWithDerivatives("scoreb"); componentIsNotPeriodic("scoreb");
@@ -490,11 +548,11 @@ EMMIVOX::EMMIVOX(const ActionOptions&ao):
 void EMMIVOX::prepare_gpu()
 {
   // number of data points
-  int nd = ovdd_.size();
+  int nd = nvox_;
   // 1) put ismin_ on device_t_
-  ismin_gpu_ = torch::from_blob(ismin_.data(), {nd}, torch::kFloat64).to(torch::kFloat32).to(device_t_);
-  // 2) put ovdd_ on device_t_
-  ovdd_gpu_  = torch::from_blob(ovdd_.data(),  {nd}, torch::kFloat64).to(torch::kFloat32).to(device_t_);
+  ismin_gpu_ = torch::from_blob(ismin_.data(), {nd}, torch::kFloat64).to(rtype_).to(device_t_);
+  // 2) put ovdd_ on device_t_, the data are read-only and not copied on the CPU in double precision
+  ovdd_gpu_  = torch::from_blob(const_cast<double*>(ovdd_),  {nd}, torch::kFloat64).to(rtype_).to(device_t_);
   // 3) put Map_m_ on device_t_
   std::vector<double> Map_m_gpu(3*nd);
   #pragma omp parallel for num_threads(OpenMP::getNumThreads())
@@ -504,7 +562,13 @@ void EMMIVOX::prepare_gpu()
     Map_m_gpu[i+2*nd] = Map_m_[i][2];
   }
   // libtorch tensor
-  Map_m_gpu_ = torch::from_blob(Map_m_gpu.data(), {3,nd}, torch::kFloat64).clone().to(torch::kFloat32).to(device_t_);
+  Map_m_gpu_ = torch::from_blob(Map_m_gpu.data(), {3,nd}, torch::kFloat64).clone().to(ftype_).to(device_t_);
+  // 4) allocate the tensors that are filled at every step
+  int natoms = Model_type_.size();
+  posg_.resize(3*natoms);
+  pos_gpu_       = torch::zeros({3,natoms}, torch::TensorOptions().device(device_t_).dtype(ftype_));
+  ovmd_gpu_      = torch::zeros({nd}, torch::TensorOptions().device(device_t_).dtype(rtype_));
+  atoms_der_gpu_ = torch::zeros({3,natoms}, torch::TensorOptions().device(device_t_).dtype(rtype_));
 }
 
 void EMMIVOX::write_model_density(long int step)
@@ -872,36 +936,24 @@ std::vector<double> EMMIVOX::get_Model_param(std::vector<AtomNumber> &atoms)
 }
 
 // read experimental data file in PLUMED format:
-void EMMIVOX::get_exp_data(const std::string &datafile)
+void EMMIVOX::get_exp_data(const std::string &datafile, double threshold)
 {
-  Vector pos;
-  double dens, err;
-  int idcomp;
-
-// open file
-  IFile *ifile = new IFile();
-  if(ifile->FileExist(datafile)) {
-    ifile->open(datafile);
-    while(ifile->scanField("Id",idcomp)) {
-      ifile->scanField("Pos_0",pos[0]);
-      ifile->scanField("Pos_1",pos[1]);
-      ifile->scanField("Pos_2",pos[2]);
-      ifile->scanField("Density",dens);
-      ifile->scanField("Error",err);
-      // voxel center
-      Map_m_.push_back(pos);
-      // experimental density
-      ovdd_.push_back(dens);
-      // error
-      exp_err_.push_back(err);
-      // new line
-      ifile->scanField();
-    }
-    ifile->close();
+  IFile ifile;
+  if(!ifile.FileExist(datafile)) error("Cannot find DATA_FILE "+datafile+"\n");
+  if(EMMap::isBinary(datafile)) {
+    log.printf("  memory-mapping binary map\n");
+    map_.readBinary(datafile);
+  } else if(EMMap::isMRC(datafile)) {
+    log.printf("  reading MRC/CCP4 map with threshold : %lf\n", threshold);
+    // the error is set to zero, so that the minimum error is used for all voxels
+    map_.readMRC(datafile, threshold, 0.1/getUnits().getLength(), 0.0);
   } else {
-    error("Cannot find DATA_FILE "+datafile+"\n");
+    map_.readText(datafile);
   }
-  delete ifile;
+  nvox_    = map_.size();
+  Map_m_   = map_.positions();
+  ovdd_    = map_.densities();
+  exp_err_ = map_.errors();
 }
 
 void EMMIVOX::initialize_Bfactor(double reso)
@@ -987,8 +1039,8 @@ void EMMIVOX::push_auxiliary_gpu()
     }
   }
   // 2) initialize gpu tensors
-  pref_gpu_  = torch::from_blob(pref.data(),  {5,natoms}, torch::kFloat64).clone().to(torch::kFloat32).to(device_t_);
-  invs2_gpu_ = torch::from_blob(invs2.data(), {5,natoms}, torch::kFloat64).clone().to(torch::kFloat32).to(device_t_);
+  pref_gpu_  = torch::from_blob(pref.data(),  {5,natoms}, torch::kFloat64).clone().to(ftype_).to(device_t_);
+  invs2_gpu_ = torch::from_blob(invs2.data(), {5,natoms}, torch::kFloat64).clone().to(ftype_).to(device_t_);
 }
 
 void EMMIVOX::get_close_residues()
@@ -1228,21 +1280,22 @@ void EMMIVOX::update_neighbor_sphere()
   // store reference positions
   refpos_ = getPositions();
 
-  // cycle on voxels - in parallel
+  // cycle on atoms - in parallel
   #pragma omp parallel num_threads(OpenMP::getNumThreads())
   {
     // private variables
     std::vector< std::pair<unsigned,unsigned> > ns_l;
+    std::vector<unsigned> close;
     #pragma omp for
-    for(unsigned id=0; id<ovdd_.size(); ++id) {
-      // grid point
-      Vector d_m = Map_m_[id];
-      // cycle on atoms
-      for(unsigned im=0; im<natoms; ++im) {
+    for(unsigned im=0; im<natoms; ++im) {
+      // voxels in the cells close to the atom
+      close.clear();
+      voxel_cells_.retrieve(getPosition(im), 2.0*cut_[im], close);
+      for(unsigned i=0; i<close.size(); ++i) {
         // calculate distance
-        double dist = delta(getPosition(im), d_m).modulo();
+        double dist = delta(getPosition(im), Map_m_[close[i]]).modulo();
         // add to local list
-        if(dist<=2.0*cut_[im]) ns_l.push_back(std::make_pair(id,im));
+        if(dist<=2.0*cut_[im]) ns_l.push_back(std::make_pair(close[i],im));
       }
     }
     // add to global list
@@ -1358,21 +1411,20 @@ void EMMIVOX::calculate_fmod()
   // number of atoms
   int natoms = Model_type_.size();
   // number of data points
-  int nd = ovdd_.size();
+  int nd = nvox_;
 
   // fill positions in in parallel
-  std::vector<double> posg(3*natoms);
   #pragma omp parallel for num_threads(OpenMP::getNumThreads())
   for (int i=0; i<natoms; ++i) {
     // fill vectors
-    posg[i]          = getPosition(i)[0];
-    posg[i+natoms]   = getPosition(i)[1];
-    posg[i+2*natoms] = getPosition(i)[2];
+    posg_[i]          = getPosition(i)[0];
+    posg_[i+natoms]   = getPosition(i)[1];
+    posg_[i+2*natoms] = getPosition(i)[2];
   }
-  // transfer positions to pos_gpu [3,natoms]
-  torch::Tensor pos_gpu = torch::from_blob(posg.data(), {3,natoms}, torch::kFloat64).to(torch::kFloat32).to(device_t_);
+  // transfer positions to pos_gpu_ [3,natoms], converting to the working precision
+  pos_gpu_.copy_(torch::from_blob(posg_.data(), {3,natoms}, torch::kFloat64));
   // create pos_nl_gpu_ [3,nl_size]
-  torch::Tensor pos_nl_gpu = torch::index_select(pos_gpu,1,nl_im_gpu_);
+  torch::Tensor pos_nl_gpu = torch::index_select(pos_gpu_,1,nl_im_gpu_);
   // calculate vector difference [3,nl_size]
   torch::Tensor md = Map_m_nl_gpu_ - pos_nl_gpu;
   // calculate norm squared by column [1,nl_size]
@@ -1381,14 +1433,15 @@ void EMMIVOX::calculate_fmod()
   torch::Tensor ov = pref_nl_gpu_ * torch::exp(-0.5 * md2 * invs2_nl_gpu_);
   // and derivatives [5,nl_size]
   ovmd_der_gpu_ = invs2_nl_gpu_ * ov;
-  // sum density over 5 columns [1,nl_size]
-  ov = torch::sum(ov,0);
+  // sum density over 5 columns [1,nl_size], accumulating in the reduction precision
+  ov = torch::sum(ov,{0},false,rtype_);
   // sum contributions from the same atom
-  auto options = torch::TensorOptions().device(device_t_).dtype(torch::kFloat32);
-  ovmd_gpu_ = torch::zeros({nd}, options);
+  ovmd_gpu_.zero_();
   ovmd_gpu_.index_add_(0, nl_id_gpu_, ov);
   // sum derivatives over 5 rows [1,nl_size] and multiply by md [3,nl_size]
   ovmd_der_gpu_ = md * torch::sum(ovmd_der_gpu_,0);
+  // check the model density of this replica against a double precision calculation
+  if(validate_stride_>0 && getStep()%validate_stride_==0) validate_fmod();
 
   // in case of metainference: average them across replicas
   if(!no_aver_ && nrep_>1) {
@@ -1402,7 +1455,7 @@ void EMMIVOX::calculate_fmod()
     double escale = 1.0 / static_cast<double>(nrep_);
     for(int i=0; i<nd; ++i) ovmd_[i] *= escale;
     // put back on device
-    ovmd_gpu_ = torch::from_blob(ovmd_.data(), {nd}, torch::kFloat64).to(torch::kFloat32).to(device_t_);
+    ovmd_gpu_.copy_(torch::from_blob(ovmd_.data(), {nd}, torch::kFloat64));
   }
 
   // communicate back model density
@@ -1422,6 +1475,40 @@ void EMMIVOX::calculate_fmod()
   }
 }
 
+// compare the model density on device with a double precision calculation
+void EMMIVOX::validate_fmod()
+{
+  // number of data points
+  int nd = nvox_;
+  // model density on device
+  torch::Tensor ovmd_cpu = ovmd_gpu_.detach().to(torch::kCPU).to(torch::kFloat64);
+  std::vector<double> ovmd(ovmd_cpu.data_ptr<double>(), ovmd_cpu.data_ptr<double>() + ovmd_cpu.numel());
+  // reference model density
+  std::vector<double> ovmd_ref(nd, 0.0);
+  #pragma omp parallel num_threads(OpenMP::getNumThreads())
+  {
+    std::vector<double> omp_ovmd(nd, 0.0);
+    #pragma omp for nowait
+    for(unsigned i=0; i<nl_.size(); ++i) {
+      unsigned id = nl_[i].first;
+      unsigned im = nl_[i].second;
+      Vector md = Map_m_[id] - getPosition(im);
+      double md2 = md.modulo2();
+      for(unsigned j=0; j<5; ++j) omp_ovmd[id] += pref_[im][j] * std::exp(-0.5 * md2 * invs2_[im][j]);
+    }
+    #pragma omp critical
+    for(int i=0; i<nd; ++i) ovmd_ref[i] += omp_ovmd[i];
+  }
+  // largest absolute deviation and largest reference density
+  double maxdev = 0.0, maxref = 0.0;
+  for(int i=0; i<nd; ++i) {
+    maxdev = std::max(maxdev, std::abs(ovmd[i]-ovmd_ref[i]));
+    maxref = std::max(maxref, std::abs(ovmd_ref[i]));
+  }
+  double reldev = maxref>0.0 ? maxdev/maxref : 0.0;
+  log.printf("  EMMIVOX step %ld: largest deviation of model density from double precision calculation %e (relative %e)\n", getStep(), maxdev, reldev);
+}
+
 // calculate score
 void EMMIVOX::calculate_score()
 {
@@ -1449,13 +1536,12 @@ void EMMIVOX::calculate_score()
   // and derivatives [1, nd]
   torch::Tensor d_der = -kbt_ * zeros * ( sqrt2_pi_ * torch::exp( -0.5 * dev * dev * ismin_gpu_ * ismin_gpu_ ) * ismin_gpu_ / errf - 1.0 / dev );
   // tensor for derivatives wrt atoms [1, nl_size]
-  torch::Tensor der_gpu = torch::index_select(d_der,0,nl_id_gpu_);
+  torch::Tensor der_gpu = torch::index_select(d_der.to(ftype_),0,nl_id_gpu_);
   // multiply by ovmd_der_gpu_ and scale [3, nl_size]
   der_gpu = ovmd_der_gpu_ * scale_ * der_gpu;
   // sum contributions for each atom
-  auto options = torch::TensorOptions().device(device_t_).dtype(torch::kFloat32);
-  torch::Tensor atoms_der_gpu = torch::zeros({3,natoms}, options);
-  atoms_der_gpu.index_add_(1, nl_im_gpu_, der_gpu);
+  atoms_der_gpu_.zero_();
+  atoms_der_gpu_.index_add_(1, nl_im_gpu_, der_gpu.to(rtype_));
 
   // FINAL STUFF
   //
@@ -1466,7 +1552,7 @@ void EMMIVOX::calculate_score()
   if(!no_aver_ && nrep_>1) ene_ *= static_cast<double>(nrep_);
   //
   // 2) communicate derivatives to CPU
-  torch::Tensor atom_der_cpu = atoms_der_gpu.detach().to(torch::kCPU).to(torch::kFloat64);
+  torch::Tensor atom_der_cpu = atoms_der_gpu_.detach().to(torch::kCPU).to(torch::kFloat64);
   // convert to std::vector<double>
   std::vector<double> atom_der = std::vector<double>(atom_der_cpu.data_ptr<double>(), atom_der_cpu.data_ptr<double>() + atom_der_cpu.numel());
   // and put in atom_der_
@@ -1548,16 +1634,16 @@ void EMMIVOX::calculate()
 void EMMIVOX::calculate_corr()
 {
 // number of data points
-  double nd = static_cast<double>(ovdd_.size());
+  double nd = static_cast<double>(nvox_);
 // average ovmd_ and ovdd_
   double ave_md = std::accumulate(ovmd_.begin(), ovmd_.end(), 0.) / nd;
-  double ave_dd = std::accumulate(ovdd_.begin(), ovdd_.end(), 0.) / nd;
+  double ave_dd = std::accumulate(ovdd_, ovdd_+nvox_, 0.) / nd;
 // calculate correlation
   double num = 0.;
   double den1 = 0.;
   double den2 = 0.;
   #pragma omp parallel for num_threads(OpenMP::getNumThreads()) reduction( + : num, den1, den2)
-  for(unsigned i=0; i<ovdd_.size(); ++i) {
+  for(unsigned i=0; i<nvox_; ++i) {
     double md = ovmd_[i]-ave_md;
     double dd = ovdd_[i]-ave_dd;
     num  += md*dd;
@@ -0,0 +1,273 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "EMMap.h"
+#include "tools/Exception.h"
+#include "tools/File.h"
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#if defined(__unix__) || defined(__APPLE__)
+#define __PLUMED_EMMAP_POSIX 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace PLMD {
+namespace isdb {
+
+static_assert(sizeof(Vector)==3*sizeof(double), "Vector is expected to be made of three contiguous doubles");
+
+static const char emMapMagic[8]= {'P','L','M','D','E','M','A','P'};
+static constexpr std::uint64_t emMapVersion=1;
+/// The data start at a multiple of this, so that they are aligned to a page
+static constexpr std::uint64_t emMapAlignment=4096;
+/// Size of the header of MRC/CCP4 files
+static constexpr std::size_t mrcHeaderSize=1024;
+
+EMMap::~EMMap() {
+  clear();
+}
+
+void EMMap::clear() {
+#ifdef __PLUMED_EMMAP_POSIX
+  if(map_) munmap(map_,mapsize_);
+#endif
+  map_=nullptr; mapsize_=0;
+  pos_data_.clear(); dens_data_.clear(); err_data_.clear();
+  pos_=nullptr; dens_=nullptr; err_=nullptr; n_=0;
+}
+
+void EMMap::useOwnedData() {
+  n_=dens_data_.size();
+  pos_=pos_data_.data(); dens_=dens_data_.data(); err_=err_data_.data();
+}
+
+bool EMMap::isBinary(const std::string& fname) {
+  std::FILE* fp=std::fopen(fname.c_str(),"rb");
+  if(!fp) return false;
+  char magic[8];
+  const bool ok=(std::fread(magic,1,8,fp)==8 && std::memcmp(magic,emMapMagic,8)==0);
+  std::fclose(fp);
+  return ok;
+}
+
+bool EMMap::isMRC(const std::string& fname) {
+  const std::size_t dot=fname.find_last_of('.');
+  if(dot==std::string::npos) return false;
+  std::string ext=fname.substr(dot+1);
+  for(auto & c : ext) c=std::tolower(static_cast<unsigned char>(c));
+  return ext=="mrc" || ext=="map" || ext=="ccp4";
+}
+
+void EMMap::readText(const std::string& fname) {
+  clear();
+  IFile ifile;
+  plumed_assert(ifile.FileExist(fname))<<"cannot find map file "<<fname;
+  ifile.open(fname);
+  Vector pos;
+  double dens, err;
+  int idcomp;
+  while(ifile.scanField("Id",idcomp)) {
+    ifile.scanField("Pos_0",pos[0]);
+    ifile.scanField("Pos_1",pos[1]);
+    ifile.scanField("Pos_2",pos[2]);
+    ifile.scanField("Density",dens);
+    ifile.scanField("Error",err);
+    pos_data_.push_back(pos);
+    dens_data_.push_back(dens);
+    err_data_.push_back(err);
+    ifile.scanField();
+  }
+  ifile.close();
+  useOwnedData();
+}
+
+void EMMap::readBinary(const std::string& fname) {
+  clear();
+  std::FILE* fp=std::fopen(fname.c_str(),"rb");
+  plumed_assert(fp)<<"cannot open binary map file "<<fname;
+  char magic[8];
+  std::uint64_t header[3];
+  const bool ok=(std::fread(magic,1,8,fp)==8 && std::memcmp(magic,emMapMagic,8)==0 && std::fread(header,sizeof(std::uint64_t),3,fp)==3);
+  std::fclose(fp);
+  plumed_assert(ok)<<fname<<" is not a binary map file";
+  plumed_assert(header[0]>0 && header[0]<=emMapVersion)<<"unsupported version "<<header[0]<<" of binary map file "<<fname;
+  const std::uint64_t n=header[1], offset=header[2];
+  const std::size_t ndata=5*n;
+#ifdef __PLUMED_EMMAP_POSIX
+  mapsize_=offset+ndata*sizeof(double);
+  const int fd=::open(fname.c_str(),O_RDONLY);
+  plumed_assert(fd>=0)<<"cannot open binary map file "<<fname;
+  struct stat st;
+  if(fstat(fd,&st)!=0 || static_cast<std::size_t>(st.st_size)<mapsize_) {
+    ::close(fd);
+    plumed_error()<<"binary map file "<<fname<<" is shorter than expected";
+  }
+  map_=mmap(nullptr,mapsize_,PROT_READ,MAP_SHARED,fd,0);
+  ::close(fd);
+  if(map_==MAP_FAILED) {
+    map_=nullptr;
+    plumed_error()<<"cannot map binary map file "<<fname;
+  }
+  const double* data=reinterpret_cast<const double*>(static_cast<const char*>(map_)+offset);
+  pos_=reinterpret_cast<const Vector*>(data);
+  dens_=data+3*n;
+  err_=data+4*n;
+  n_=n;
+#else
+  fp=std::fopen(fname.c_str(),"rb");
+  plumed_assert(fp)<<"cannot open binary map file "<<fname;
+  pos_data_.resize(n); dens_data_.resize(n); err_data_.resize(n);
+  const bool okdata=(std::fseek(fp,offset,SEEK_SET)==0 &&
+                     std::fread(&pos_data_[0][0],sizeof(double),3*n,fp)==3*n &&
+                     std::fread(dens_data_.data(),sizeof(double),n,fp)==n &&
+                     std::fread(err_data_.data(),sizeof(double),n,fp)==n);
+  std::fclose(fp);
+  plumed_assert(okdata)<<"binary map file "<<fname<<" is shorter than expected";
+  useOwnedData();
+#endif
+}
+
+void EMMap::writeBinary(const std::string& fname) const {
+#ifdef __PLUMED_EMMAP_POSIX
+  const std::string tmpname=fname+".tmp."+std::to_string(getpid());
+#else
+  const std::string tmpname=fname;
+#endif
+  std::FILE* fp=std::fopen(tmpname.c_str(),"wb");
+  plumed_assert(fp)<<"cannot open binary map file "<<tmpname<<" for writing";
+  const std::uint64_t header[3]= {emMapVersion, n_, emMapAlignment};
+  std::fwrite(emMapMagic,1,8,fp);
+  std::fwrite(header,sizeof(std::uint64_t),3,fp);
+  std::vector<char> pad(emMapAlignment-8-sizeof(header),0);
+  std::fwrite(pad.data(),1,pad.size(),fp);
+  if(n_>0) {
+    std::fwrite(&pos_[0][0],sizeof(double),3*n_,fp);
+    std::fwrite(dens_,sizeof(double),n_,fp);
+    std::fwrite(err_,sizeof(double),n_,fp);
+  }
+  const bool ok=(std::ferror(fp)==0);
+  std::fclose(fp);
+  plumed_assert(ok)<<"error while writing binary map file "<<tmpname;
+  if(tmpname!=fname) plumed_assert(std::rename(tmpname.c_str(),fname.c_str())==0)<<"cannot rename "<<tmpname<<" to "<<fname;
+}
+
+/// Read a 4-byte word of an MRC header, swapping the bytes if needed
+template<typename T>
+static T getMRCWord(const char* header, unsigned word, bool swap) {
+  static_assert(sizeof(T)==4, "MRC header words are four bytes long");
+  char b[4];
+  std::memcpy(b,header+4*word,4);
+  if(swap) { std::swap(b[0],b[3]); std::swap(b[1],b[2]); }
+  T v;
+  std::memcpy(&v,b,4);
+  return v;
+}
+
+void EMMap::readMRC(const std::string& fname, double threshold, double lscale, double error) {
+  clear();
+  std::FILE* fp=std::fopen(fname.c_str(),"rb");
+  plumed_assert(fp)<<"cannot open MRC/CCP4 map "<<fname;
+  std::array<char,mrcHeaderSize> header;
+  if(std::fread(header.data(),1,mrcHeaderSize,fp)!=mrcHeaderSize) {
+    std::fclose(fp);
+    plumed_error()<<"truncated header in MRC/CCP4 map "<<fname;
+  }
+  // the axis order (MAPC) is 1, 2 or 3 in the byte order of the file
+  const std::int32_t mapc=getMRCWord<std::int32_t>(header.data(),16,false);
+  const bool swap=(mapc<1 || mapc>3);
+  auto ival=[&](unsigned w) { return getMRCWord<std::int32_t>(header.data(),w,swap); };
+  auto fval=[&](unsigned w) { return static_cast<double>(getMRCWord<float>(header.data(),w,swap)); };
+  // number of columns, rows and sections, data mode and start of each of them
+  const std::array<std::int32_t,3> nc= {ival(0),ival(1),ival(2)};
+  const std::int32_t mode=ival(3);
+  const std::array<std::int32_t,3> ncstart= {ival(4),ival(5),ival(6)};
+  // sampling and size of the cell along x, y and z
+  const std::array<std::int32_t,3> m= {ival(7),ival(8),ival(9)};
+  const std::array<double,3> cella= {fval(10),fval(11),fval(12)};
+  const std::array<double,3> cellb= {fval(13),fval(14),fval(15)};
+  // which of x, y and z correspond to columns, rows and sections
+  const std::array<std::int32_t,3> axis= {ival(16)-1,ival(17)-1,ival(18)-1};
+  const std::int32_t nsymbt=ival(23);
+  const std::array<double,3> origin= {fval(49),fval(50),fval(51)};
+  try {
+    for(unsigned k=0; k<3; ++k) {
+      if(nc[k]<=0 || m[k]<=0 || axis[k]<0 || axis[k]>2) plumed_error()<<"invalid header in MRC/CCP4 map "<<fname;
+      if(std::fabs(cellb[k]-90.0)>1.0e-3) plumed_error()<<"only orthogonal cells are supported in MRC/CCP4 map "<<fname;
+    }
+    if(axis[0]==axis[1] || axis[0]==axis[2] || axis[1]==axis[2]) plumed_error()<<"invalid axis order in MRC/CCP4 map "<<fname;
+    std::size_t wsize;
+    if(mode==0) wsize=1;
+    else if(mode==1 || mode==6) wsize=2;
+    else if(mode==2) wsize=4;
+    else plumed_error()<<"unsupported data mode "<<mode<<" in MRC/CCP4 map "<<fname;
+    if(std::fseek(fp,mrcHeaderSize+nsymbt,SEEK_SET)!=0) plumed_error()<<"MRC/CCP4 map "<<fname<<" is shorter than expected";
+    // voxel size along x, y and z
+    Vector vsize;
+    for(unsigned k=0; k<3; ++k) vsize[k]=cella[k]/m[k];
+    // an origin different from zero (MRC2014) is used instead of the start of columns, rows and sections
+    const bool useorigin=(origin[0]!=0.0 || origin[1]!=0.0 || origin[2]!=0.0);
+    std::vector<char> section(wsize*nc[0]*nc[1]);
+    for(std::int32_t s=0; s<nc[2]; ++s) {
+      if(std::fread(section.data(),1,section.size(),fp)!=section.size()) plumed_error()<<"MRC/CCP4 map "<<fname<<" is shorter than expected";
+      for(std::int32_t r=0; r<nc[1]; ++r) for(std::int32_t c=0; c<nc[0]; ++c) {
+          const char* w=section.data()+wsize*(c+nc[0]*r);
+          double dens;
+          if(mode==0) {
+            dens=static_cast<signed char>(w[0]);
+          } else if(mode==2) {
+            char b[4]; std::memcpy(b,w,4);
+            if(swap) { std::swap(b[0],b[3]); std::swap(b[1],b[2]); }
+            float f; std::memcpy(&f,b,4); dens=f;
+          } else {
+            char b[2]; std::memcpy(b,w,2);
+            if(swap) std::swap(b[0],b[1]);
+            if(mode==1) { std::int16_t i; std::memcpy(&i,b,2); dens=i; }
+            else { std::uint16_t i; std::memcpy(&i,b,2); dens=i; }
+          }
+          if(!(dens>threshold)) continue;
+          const std::array<std::int32_t,3> crs= {c,r,s};
+          Vector pos;
+          for(unsigned k=0; k<3; ++k) {
+            const unsigned x=axis[k];
+            pos[x] = useorigin ? origin[x]+crs[k]*vsize[x] : (ncstart[k]+crs[k])*vsize[x];
+          }
+          pos_data_.push_back(lscale*pos);
+          dens_data_.push_back(dens);
+          err_data_.push_back(error);
+        }
+    }
+  } catch(...) {
+    std::fclose(fp);
+    throw;
+  }
+  std::fclose(fp);
+  useOwnedData();
+}
+
+}
+}
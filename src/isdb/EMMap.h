@@ -0,0 +1,79 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_isdb_EMMap_h
+#define __PLUMED_isdb_EMMap_h
+
+#include "tools/Vector.h"
+#include <string>
+#include <vector>
+
+namespace PLMD {
+namespace isdb {
+
+/**
+Voxels of an experimental cryo-EM map: centers, densities and errors.
+
+The voxels can be read from a text file, from an MRC/CCP4 map or from a binary file
+written with EMMap::writeBinary. Binary files are mapped read-only, so that all the
+replicas that run on a node share a single copy of the map in the page cache and no
+time is spent in parsing at startup.
+*/
+class EMMap {
+  void* map_=nullptr;
+  std::size_t mapsize_=0;
+/// Used when the data are not mapped from a file
+  std::vector<Vector> pos_data_;
+  std::vector<double> dens_data_, err_data_;
+  const Vector* pos_=nullptr;
+  const double* dens_=nullptr;
+  const double* err_=nullptr;
+  unsigned n_=0;
+  void clear();
+  void useOwnedData();
+public:
+  EMMap() = default;
+  ~EMMap();
+  EMMap(const EMMap&) = delete;
+  EMMap& operator=(const EMMap&) = delete;
+/// Check if a file starts with the header of a binary map
+  static bool isBinary(const std::string& fname);
+/// Check if a file name has the extension of an MRC/CCP4 map
+  static bool isMRC(const std::string& fname);
+/// Read a text file with fields Id, Pos_0, Pos_1, Pos_2, Density and Error
+  void readText(const std::string& fname);
+/// Map a binary file written with writeBinary
+  void readBinary(const std::string& fname);
+/// Read the voxels of an MRC/CCP4 map with density larger than threshold.
+/// Positions in Angstrom are multiplied by lscale, all the voxels are given the same error.
+  void readMRC(const std::string& fname, double threshold, double lscale, double error);
+/// Write the map to a binary file, the file is replaced atomically so that other processes never map a partial file
+  void writeBinary(const std::string& fname) const;
+  unsigned size() const { return n_; }
+  const Vector* positions() const { return pos_; }
+  const double* densities() const { return dens_; }
+  const double* errors() const { return err_; }
+};
+
+}
+}
+
+#endif
@@ -21,6 +21,8 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "MetainferenceBase.h"
 #include "core/ActionRegister.h"
+#include "PairBatch.h"
+#include "tools/OpenMP.h"
 #include "tools/Pbc.h"
 #include "tools/Torsion.h"
 
@@ -95,6 +97,10 @@ private:
   double kb_;
   double kc_;
   double kshift_;
+/// The three bond vectors defining each torsion
+  PairBatch bonds_;
+/// The components with the calculated couplings
+  std::vector<Value*> j_comps_;
 
 public:
   static void registerKeywords(Keywords& keys);
@@ -282,6 +288,15 @@ JCoupling::JCoupling(const ActionOptions&ao):
     }
   }
 
+  std::vector<std::pair<unsigned,unsigned> > pairs(3*ncoupl_);
+  j_comps_.resize(ncoupl_);
+  for (unsigned i = 0; i < ncoupl_; i++) {
+    for (unsigned k = 0; k < 3; k++) pairs[3*i+k] = std::pair<unsigned,unsigned>(6*i+2*k+1, 6*i+2*k);
+    std::string num; Tools::convert(i, num);
+    j_comps_[i] = getPntrToComponent("j-" + num);
+  }
+  bonds_.setPairs(pairs);
+
   requestAtoms(atoms, false);
   if(getDoScore()) {
     setParameters(coupl);
@@ -297,6 +312,9 @@ void JCoupling::calculate()
   std::vector<Vector> deriv(ncoupl_*6);
   std::vector<double> j(ncoupl_,0.);
 
+  // all the bond vectors are computed at once, molecules are already whole
+  bonds_.computeVectors(getPositions(), nullptr);
+
   #pragma omp parallel num_threads(OpenMP::getNumThreads())
   {
     #pragma omp for
@@ -306,9 +324,9 @@ void JCoupling::calculate()
       unsigned a0 = 6*r;
 
       // 6 atoms -> 3 vectors
-      Vector d0 = delta(getPosition(a0+1), getPosition(a0));
-      Vector d1 = delta(getPosition(a0+3), getPosition(a0+2));
-      Vector d2 = delta(getPosition(a0+5), getPosition(a0+4));
+      Vector d0 = bonds_.getVector(3*r);
+      Vector d1 = bonds_.getVector(3*r+1);
+      Vector d2 = bonds_.getVector(3*r+2);
 
       // Calculate dihedral with 3 vectors, get the derivatives
       Vector dd0, dd1, dd2;
@@ -363,8 +381,7 @@ void JCoupling::calculate()
   } else {
     for (unsigned r=0; r<ncoupl_; r++) {
       const unsigned a0 = 6*r;
-      std::string num; Tools::convert(r,num);
-      Value* val=getPntrToComponent("j-"+num);
+      Value* val=j_comps_[r];
       val->set(j[r]);
       setAtomsDerivatives(val, a0, deriv[a0]);
       setAtomsDerivatives(val, a0+1, deriv[a0+1]);
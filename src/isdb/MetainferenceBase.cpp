@@ -125,7 +125,8 @@ MetainferenceBase::MetainferenceBase(const ActionOptions&ao):
   N_optimized_step_(0),
   optimized_step_(0),
   sigmamax_opt_done_(false),
-  decay_w_(1.)
+  decay_w_(1.),
+  replica_sum_pending_(false)
 {
   parseFlag("DOSCORE", doscore_);
 
@@ -1091,15 +1092,8 @@ double MetainferenceBase::doMonteCarlo(const std::vector<double> &mean_)
     valueAccept->set(accept);
   }
 
-  // here we sum the score over the replicas to get the full metainference score that we save as a bias
-  if(master) {
-    if(nrep_>1) multi_sim_comm.Sum(old_energy);
-  } else {
-    old_energy=0;
-  }
-  comm.Sum(old_energy);
-
-  // this is the energy with current coordinates and parameters
+  // this is the energy of this replica with current coordinates and parameters,
+  // the sum over the replicas is done together with the one needed for the forces
   return old_energy;
 }
 
@@ -1110,12 +1104,13 @@ double MetainferenceBase::doMonteCarlo(const std::vector<double> &mean_)
 */
 
 void MetainferenceBase::getEnergyForceSP(const std::vector<double> &mean, const std::vector<double> &dmean_x,
-    const std::vector<double> &dmean_b)
+    const std::vector<double> &dmean_b, double &ene)
 {
   const double scale2 = scale_*scale_;
   const double sm2    = sigma_mean2_[0];
   const double ss2    = sigma_[0]*sigma_[0] + scale2*sm2;
-  std::vector<double> f(narg,0);
+  // the last element is the score
+  std::vector<double> f(narg+1,0);
 
   if(master) {
     #pragma omp parallel num_threads(OpenMP::getNumThreads())
@@ -1135,11 +1130,12 @@ void MetainferenceBase::getEnergyForceSP(const std::vector<double> &mean, const
         }
       }
     }
-    // collect contribution to forces and energy from other replicas
-    if(nrep_>1) multi_sim_comm.Sum(&f[0],narg);
+    f[narg] = ene;
   }
-  // intra-replica summation
-  comm.Sum(&f[0],narg);
+  // collect contribution to forces and energy from other replicas
+  startReplicaSum(f);
+  endReplicaSum(f);
+  ene = f[narg];
 
   double w_tmp = 0.;
   for(unsigned i=0; i<narg; ++i) {
@@ -1154,10 +1150,11 @@ void MetainferenceBase::getEnergyForceSP(const std::vector<double> &mean, const
 }
 
 void MetainferenceBase::getEnergyForceSPE(const std::vector<double> &mean, const std::vector<double> &dmean_x,
-    const std::vector<double> &dmean_b)
+    const std::vector<double> &dmean_b, double &ene)
 {
   const double scale2 = scale_*scale_;
-  std::vector<double> f(narg,0);
+  // the last element is the score
+  std::vector<double> f(narg+1,0);
 
   if(master) {
     #pragma omp parallel num_threads(OpenMP::getNumThreads())
@@ -1179,10 +1176,12 @@ void MetainferenceBase::getEnergyForceSPE(const std::vector<double> &mean, const
         }
       }
     }
-    // collect contribution to forces and energy from other replicas
-    if(nrep_>1) multi_sim_comm.Sum(&f[0],narg);
+    f[narg] = ene;
   }
-  comm.Sum(&f[0],narg);
+  // collect contribution to forces and energy from other replicas
+  startReplicaSum(f);
+  endReplicaSum(f);
+  ene = f[narg];
 
   double w_tmp = 0.;
   for(unsigned i=0; i<narg; ++i) {
@@ -1197,24 +1196,30 @@ void MetainferenceBase::getEnergyForceSPE(const std::vector<double> &mean, const
 }
 
 void MetainferenceBase::getEnergyForceGJ(const std::vector<double> &mean, const std::vector<double> &dmean_x,
-    const std::vector<double> &dmean_b)
+    const std::vector<double> &dmean_b, double &ene)
 {
   const double scale2 = scale_*scale_;
-  double inv_s2=0.;
-
+  // inverse variance and score summed over replicas
+  std::vector<double> buf(2,0.);
   if(master) {
-    inv_s2 = 1./(sigma_[0]*sigma_[0] + scale2*sigma_mean2_[0]);
-    if(nrep_>1) multi_sim_comm.Sum(inv_s2);
-  }
-  comm.Sum(inv_s2);
+    buf[0] = 1./(sigma_[0]*sigma_[0] + scale2*sigma_mean2_[0]);
+    buf[1] = ene;
+  }
+  startReplicaSum(buf);
+  // the deviations are calculated while the sum is in progress
+  std::vector<double> dev(narg);
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads())
+  for(unsigned i=0; i<narg; ++i) dev[i] = scale_*mean[i]-parameters[i]+offset_;
+  endReplicaSum(buf);
+  const double inv_s2 = buf[0];
+  ene = buf[1];
 
   double w_tmp = 0.;
   #pragma omp parallel num_threads(OpenMP::getNumThreads()) shared(w_tmp)
   {
     #pragma omp for reduction( + : w_tmp)
     for(unsigned i=0; i<narg; ++i) {
-      const double dev = scale_*mean[i]-parameters[i]+offset_;
-      const double mult = dev*scale_*inv_s2;
+      const double mult = dev[i]*scale_*inv_s2;
       setMetaDer(i, kbt_*dmean_x[i]*mult);
       w_tmp += kbt_*dmean_b[i]*mult;
     }
@@ -1227,24 +1232,30 @@ void MetainferenceBase::getEnergyForceGJ(const std::vector<double> &mean, const
 }
 
 void MetainferenceBase::getEnergyForceGJE(const std::vector<double> &mean, const std::vector<double> &dmean_x,
-    const std::vector<double> &dmean_b)
+    const std::vector<double> &dmean_b, double &ene)
 {
   const double scale2 = scale_*scale_;
-  std::vector<double> inv_s2(sigma_.size(),0.);
-
+  // inverse variances and score (last element) summed over replicas
+  const unsigned ns = sigma_.size();
+  std::vector<double> inv_s2(ns+1,0.);
   if(master) {
-    for(unsigned i=0; i<sigma_.size(); ++i) inv_s2[i] = 1./(sigma_[i]*sigma_[i] + scale2*sigma_mean2_[i]);
-    if(nrep_>1) multi_sim_comm.Sum(&inv_s2[0],sigma_.size());
+    for(unsigned i=0; i<ns; ++i) inv_s2[i] = 1./(sigma_[i]*sigma_[i] + scale2*sigma_mean2_[i]);
+    inv_s2[ns] = ene;
   }
-  comm.Sum(&inv_s2[0],sigma_.size());
+  startReplicaSum(inv_s2);
+  // the deviations are calculated while the sum is in progress
+  std::vector<double> dev(narg);
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads())
+  for(unsigned i=0; i<narg; ++i) dev[i] = scale_*mean[i]-parameters[i]+offset_;
+  endReplicaSum(inv_s2);
+  ene = inv_s2[ns];
 
   double w_tmp = 0.;
   #pragma omp parallel num_threads(OpenMP::getNumThreads()) shared(w_tmp)
   {
     #pragma omp for reduction( + : w_tmp)
     for(unsigned i=0; i<narg; ++i) {
-      const double dev  = scale_*mean[i]-parameters[i]+offset_;
-      const double mult = dev*scale_*inv_s2[i];
+      const double mult = dev[i]*scale_*inv_s2[i];
       setMetaDer(i, kbt_*dmean_x[i]*mult);
       w_tmp += kbt_*dmean_b[i]*mult;
     }
@@ -1256,25 +1267,25 @@ void MetainferenceBase::getEnergyForceGJE(const std::vector<double> &mean, const
   }
 }
 
-void MetainferenceBase::getEnergyForceMIGEN(const std::vector<double> &mean, const std::vector<double> &dmean_x, const std::vector<double> &dmean_b)
+void MetainferenceBase::getEnergyForceMIGEN(const std::vector<double> &mean, const std::vector<double> &dmean_x, const std::vector<double> &dmean_b, double &ene)
 {
-  std::vector<double> inv_s2(sigma_.size(),0.);
-  std::vector<double> dev(sigma_.size(),0.);
-  std::vector<double> dev2(sigma_.size(),0.);
-
-  for(unsigned i=0; i<sigma_.size(); ++i) {
-    inv_s2[i]   = 1./sigma_mean2_[i];
-    if(master) {
-      dev[i]  = (mean[i]-ftilde_[i]);
-      dev2[i] = dev[i]*dev[i];
+  const unsigned ns = sigma_.size();
+  // deviations, their squares and the score are summed over replicas in a single buffer
+  std::vector<double> buf(2*ns+1,0.);
+  if(master) {
+    for(unsigned i=0; i<ns; ++i) {
+      buf[i]    = (mean[i]-ftilde_[i]);
+      buf[ns+i] = buf[i]*buf[i];
     }
+    buf[2*ns] = ene;
   }
-  if(master&&nrep_>1) {
-    multi_sim_comm.Sum(&dev[0],dev.size());
-    multi_sim_comm.Sum(&dev2[0],dev2.size());
-  }
-  comm.Sum(&dev[0],dev.size());
-  comm.Sum(&dev2[0],dev2.size());
+  startReplicaSum(buf);
+  // the inverse variances are calculated while the sum is in progress
+  std::vector<double> inv_s2(ns,0.);
+  for(unsigned i=0; i<ns; ++i) inv_s2[i] = 1./sigma_mean2_[i];
+  endReplicaSum(buf);
+  std::vector<double> dev(buf.begin(), buf.begin()+ns);
+  ene = buf[2*ns];
 
   double dene_b = 0.;
   #pragma omp parallel num_threads(OpenMP::getNumThreads()) shared(dene_b)
@@ -1337,7 +1348,7 @@ void MetainferenceBase::get_weights(double &weight, double &norm, double &neff)
   getPntrToComponent("neff")->set(neff);
 }
 
-void MetainferenceBase::get_sigma_mean(const double weight, const double norm, const double neff, const std::vector<double> &mean)
+void MetainferenceBase::get_sigma_mean(const double norm, const double neff)
 {
   const double dnrep    = static_cast<double>(nrep_);
   std::vector<double> sigma_mean2_tmp(sigma_mean2_.size());
@@ -1349,12 +1360,7 @@ void MetainferenceBase::get_sigma_mean(const double weight, const double norm, c
     /* this is the current estimate of sigma mean for each argument
        there is one of this per argument in any case  because it is
        the maximum among these to be used in case of GAUSS/OUTLIER */
-    std::vector<double> sigma_mean2_now(narg,0);
-    if(master) {
-      for(unsigned i=0; i<narg; ++i) sigma_mean2_now[i] = weight*(calc_data_[i]-mean[i])*(calc_data_[i]-mean[i]);
-      if(nrep_>1) multi_sim_comm.Sum(&sigma_mean2_now[0], narg);
-    }
-    comm.Sum(&sigma_mean2_now[0], narg);
+    std::vector<double> sigma_mean2_now(sigma_mean2_now_);
     for(unsigned i=0; i<narg; ++i) sigma_mean2_now[i] *= 1.0/(neff-1.)/norm;
 
     // add sigma_mean2 to history
@@ -1420,11 +1426,27 @@ void MetainferenceBase::get_sigma_mean(const double weight, const double norm, c
 
 void MetainferenceBase::replica_averaging(const double weight, const double norm, std::vector<double> &mean, std::vector<double> &dmean_b)
 {
+  /* when sigma mean is optimized the weighted squares of the data are reduced together with the mean:
+     sum_r w_r (x_r-mean)^2 = sum_r w_r (x_r-c)^2 - norm (mean-c)^2, where the shift c is the previous
+     average, common to all replicas, so that there is no large cancellation */
+  const bool dovar = do_optsigmamean_>0;
+  if(mean_shift_.size()!=narg) mean_shift_.assign(narg,0.);
+  replica_buf_.assign(dovar ? 2*narg : narg, 0.);
   if(master) {
-    for(unsigned i=0; i<narg; ++i) mean[i] = weight/norm*calc_data_[i];
-    if(nrep_>1) multi_sim_comm.Sum(&mean[0], narg);
+    for(unsigned i=0; i<narg; ++i) {
+      const double y = calc_data_[i]-mean_shift_[i];
+      replica_buf_[i] = weight/norm*y;
+      if(dovar) replica_buf_[narg+i] = weight*y*y;
+    }
+  }
+  startReplicaSum(replica_buf_);
+  endReplicaSum(replica_buf_);
+  for(unsigned i=0; i<narg; ++i) mean[i] = mean_shift_[i] + replica_buf_[i];
+  if(dovar) {
+    sigma_mean2_now_.resize(narg);
+    for(unsigned i=0; i<narg; ++i) sigma_mean2_now_[i] = std::max(0., replica_buf_[narg+i] - norm*replica_buf_[i]*replica_buf_[i]);
   }
-  comm.Sum(&mean[0], narg);
+  mean_shift_ = mean;
   // set the derivative of the mean with respect to the bias
   for(unsigned i=0; i<narg; ++i) dmean_b[i] = weight/norm/kbt_*(calc_data_[i]-mean[i])*decay_w_;
 
@@ -1432,6 +1454,22 @@ void MetainferenceBase::replica_averaging(const double weight, const double norm
   if(firstTime) {ftilde_ = mean; firstTime = false;}
 }
 
+void MetainferenceBase::startReplicaSum(std::vector<double> &buf)
+{
+  // only the master of each replica takes part in the sum, the other ranks contribute zero within the replica
+  if(!master) buf.assign(buf.size(),0.);
+  replica_sum_pending_ = master && nrep_>1 && buf.size()>0;
+  if(replica_sum_pending_) replica_req_ = multi_sim_comm.Isum(&buf[0], buf.size());
+}
+
+void MetainferenceBase::endReplicaSum(std::vector<double> &buf)
+{
+  if(replica_sum_pending_) replica_req_.wait();
+  replica_sum_pending_ = false;
+  // intra-replica summation
+  comm.Sum(buf);
+}
+
 void MetainferenceBase::do_regression_zero(const std::vector<double> &mean)
 {
 // parameters[i] = scale_ * mean[i]: find scale_ with linear regression
@@ -1467,7 +1505,7 @@ double MetainferenceBase::getScore()
   replica_averaging(weight, norm, mean, dmean_b);
 
   /* 3) calculates parameters */
-  get_sigma_mean(weight, norm, neff, mean);
+  get_sigma_mean(norm, neff);
 
   // in case of regression with zero intercept, calculate scale
   if(doregres_zero_ && getStep()%nregres_zero_==0) do_regression_zero(mean);
@@ -1475,22 +1513,22 @@ double MetainferenceBase::getScore()
   /* 4) run monte carlo */
   double ene = doMonteCarlo(mean);
 
-  // calculate bias and forces
+  // calculate bias and forces, the score is summed over replicas together with the forces
   switch(noise_type_) {
   case GAUSS:
-    getEnergyForceGJ(mean, dmean_x, dmean_b);
+    getEnergyForceGJ(mean, dmean_x, dmean_b, ene);
     break;
   case MGAUSS:
-    getEnergyForceGJE(mean, dmean_x, dmean_b);
+    getEnergyForceGJE(mean, dmean_x, dmean_b, ene);
     break;
   case OUTLIERS:
-    getEnergyForceSP(mean, dmean_x, dmean_b);
+    getEnergyForceSP(mean, dmean_x, dmean_b, ene);
     break;
   case MOUTLIERS:
-    getEnergyForceSPE(mean, dmean_x, dmean_b);
+    getEnergyForceSPE(mean, dmean_x, dmean_b, ene);
     break;
   case GENERIC:
-    getEnergyForceMIGEN(mean, dmean_x, dmean_b);
+    getEnergyForceMIGEN(mean, dmean_x, dmean_b, ene);
     break;
   }
 
@@ -152,6 +152,17 @@ private:
   double decay_w_;
   std::vector< std::vector <double> >  average_weights_;
 
+  // the data are shifted by the previous average to get their variance in the same reduction as the mean
+  std::vector<double> mean_shift_;
+  // weighted variance of the data across replicas
+  std::vector<double> sigma_mean2_now_;
+  // packed buffer and pending request for the reductions across replicas
+  std::vector<double> replica_buf_;
+  Communicator::Request replica_req_;
+  bool replica_sum_pending_;
+  void startReplicaSum(std::vector<double> &buf);
+  void endReplicaSum(std::vector<double> &buf);
+
   double getEnergyMIGEN(const std::vector<double> &mean, const std::vector<double> &ftilde, const std::vector<double> &sigma,
                         const double scale, const double offset);
   double getEnergySP(const std::vector<double> &mean, const std::vector<double> &sigma,
@@ -163,15 +174,15 @@ private:
   double getEnergyGJE(const std::vector<double> &mean, const std::vector<double> &sigma,
                       const double scale, const double offset);
   void setMetaDer(const unsigned index, const double der);
-  void getEnergyForceSP(const std::vector<double> &mean, const std::vector<double> &dmean_x, const std::vector<double> &dmean_b);
-  void getEnergyForceSPE(const std::vector<double> &mean, const std::vector<double> &dmean_x, const std::vector<double> &dmean_b);
-  void getEnergyForceGJ(const std::vector<double> &mean, const std::vector<double> &dmean_x, const std::vector<double> &dmean_b);
-  void getEnergyForceGJE(const std::vector<double> &mean, const std::vector<double> &dmean_x, const std::vector<double> &dmean_b);
-  void getEnergyForceMIGEN(const std::vector<double> &mean, const std::vector<double> &dmean_x, const std::vector<double> &dmean_b);
+  void getEnergyForceSP(const std::vector<double> &mean, const std::vector<double> &dmean_x, const std::vector<double> &dmean_b, double &ene);
+  void getEnergyForceSPE(const std::vector<double> &mean, const std::vector<double> &dmean_x, const std::vector<double> &dmean_b, double &ene);
+  void getEnergyForceGJ(const std::vector<double> &mean, const std::vector<double> &dmean_x, const std::vector<double> &dmean_b, double &ene);
+  void getEnergyForceGJE(const std::vector<double> &mean, const std::vector<double> &dmean_x, const std::vector<double> &dmean_b, double &ene);
+  void getEnergyForceMIGEN(const std::vector<double> &mean, const std::vector<double> &dmean_x, const std::vector<double> &dmean_b, double &ene);
   double getCalcData(const unsigned index);
   void get_weights(double &weight, double &norm, double &neff);
   void replica_averaging(const double weight, const double norm, std::vector<double> &mean, std::vector<double> &dmean_b);
-  void get_sigma_mean(const double weight, const double norm, const double neff, const std::vector<double> &mean);
+  void get_sigma_mean(const double norm, const double neff);
   void do_regression_zero(const std::vector<double> &mean);
   void moveTilde(const std::vector<double> &mean_, double &old_energy);
   void moveScaleOffset(const std::vector<double> &mean_, double &old_energy);
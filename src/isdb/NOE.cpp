@@ -21,7 +21,9 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "MetainferenceBase.h"
 #include "core/ActionRegister.h"
+#include "PairBatch.h"
 #include "tools/NeighborList.h"
+#include "tools/OpenMP.h"
 #include "tools/Pbc.h"
 #include <memory>
 
@@ -72,6 +74,13 @@ private:
   std::vector<unsigned> nga;
   std::unique_ptr<NeighborList> nl;
   unsigned         tot_size;
+/// Index of the first couple of each NOE
+  std::vector<unsigned> first_couple;
+/// The couples of atoms, their distances and the powers used in the calculation
+  PairBatch        couples;
+  std::vector<double> ir6, dir6;
+/// The components with the calculated NOEs
+  std::vector<Value*> noe_comps;
 public:
   static void registerKeywords( Keywords& keys );
   explicit NOE(const ActionOptions&);
@@ -186,6 +195,17 @@ NOE::NOE(const ActionOptions&ao):
     }
   }
 
+  first_couple.resize(nga.size()+1,0);
+  for(unsigned i=0; i<nga.size(); i++) first_couple[i+1]=first_couple[i]+nga[i];
+  std::vector<std::pair<unsigned,unsigned> > pairs(tot_size);
+  for(unsigned i=0; i<tot_size; i++) pairs[i]=nl->getClosePair(i);
+  couples.setPairs(pairs);
+  noe_comps.resize(nga.size());
+  for(unsigned i=0; i<nga.size(); i++) {
+    std::string num; Tools::convert(i,num);
+    noe_comps[i]=getPntrToComponent("noe-"+num);
+  }
+
   requestAtoms(nl->getFullAtomList(), false);
   if(getDoScore()) {
     setParameters(noedist);
@@ -200,33 +220,24 @@ void NOE::calculate()
   const unsigned ngasz=nga.size();
   std::vector<Vector> deriv(tot_size, Vector{0,0,0});
 
+  // all the distances and their inverse powers are computed at once
+  couples.computeVectors(getPositions(), pbc?&getPbc():nullptr);
+  couples.inversePowers(6, ir6, dir6);
+
   #pragma omp parallel for num_threads(OpenMP::getNumThreads())
   for(unsigned i=0; i<ngasz; i++) {
     Tensor dervir;
     double noe=0;
-    unsigned index=0;
-    for(unsigned k=0; k<i; k++) index+=nga[k];
-    std::string num; Tools::convert(i,num);
-    Value* val=getPntrToComponent("noe-"+num);
+    Value* val=noe_comps[i];
     // cycle over equivalent atoms
-    for(unsigned j=0; j<nga[i]; j++) {
-      const unsigned i0=nl->getClosePair(index+j).first;
-      const unsigned i1=nl->getClosePair(index+j).second;
-
-      Vector distance;
-      if(pbc) distance=pbcDistance(getPosition(i0),getPosition(i1));
-      else    distance=delta(getPosition(i0),getPosition(i1));
-
-      const double ir2=1./distance.modulo2();
-      const double ir6=ir2*ir2*ir2;
-      const double ir8=6*ir6*ir2;
-
-      noe += ir6;
-      deriv[index+j] = ir8*distance;
+    for(unsigned k=first_couple[i]; k<first_couple[i+1]; k++) {
+      const Vector distance=couples.getVector(k);
+      noe += ir6[k];
+      deriv[k] = dir6[k]*distance;
       if(!getDoScore()) {
-        dervir += Tensor(distance, deriv[index+j]);
-        setAtomsDerivatives(val, i0,  deriv[index+j]);
-        setAtomsDerivatives(val, i1, -deriv[index+j]);
+        dervir += Tensor(distance, deriv[k]);
+        setAtomsDerivatives(val, couples.getFirst(k),  deriv[k]);
+        setAtomsDerivatives(val, couples.getSecond(k), -deriv[k]);
       }
     }
     val->set(noe);
@@ -244,20 +255,12 @@ void NOE::calculate()
     /* calculate final derivatives */
     Value* val=getPntrToComponent("score");
     for(unsigned i=0; i<ngasz; i++) {
-      unsigned index=0;
-      for(unsigned k=0; k<i; k++) index+=nga[k];
       // cycle over equivalent atoms
-      for(unsigned j=0; j<nga[i]; j++) {
-        const unsigned i0=nl->getClosePair(index+j).first;
-        const unsigned i1=nl->getClosePair(index+j).second;
-
-        Vector distance;
-        if(pbc) distance=pbcDistance(getPosition(i0),getPosition(i1));
-        else    distance=delta(getPosition(i0),getPosition(i1));
-
-        dervir += Tensor(distance,deriv[index+j]*getMetaDer(i));
-        setAtomsDerivatives(val, i0,  deriv[index+j]*getMetaDer(i));
-        setAtomsDerivatives(val, i1, -deriv[index+j]*getMetaDer(i));
+      for(unsigned k=first_couple[i]; k<first_couple[i+1]; k++) {
+        const Vector der=deriv[k]*getMetaDer(i);
+        dervir += Tensor(couples.getVector(k),der);
+        setAtomsDerivatives(val, couples.getFirst(k),  der);
+        setAtomsDerivatives(val, couples.getSecond(k), -der);
       }
     }
     setBoxDerivatives(val, dervir);
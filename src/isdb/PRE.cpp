@@ -21,7 +21,9 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "MetainferenceBase.h"
 #include "core/ActionRegister.h"
+#include "PairBatch.h"
 #include "tools/NeighborList.h"
+#include "tools/OpenMP.h"
 #include "tools/Pbc.h"
 #include <memory>
 
@@ -79,6 +81,13 @@ private:
   std::vector<unsigned> nga;
   std::unique_ptr<NeighborList> nl;
   unsigned         tot_size;
+/// Index of the first couple of each PRE
+  std::vector<unsigned> first_couple;
+/// The couples of atoms, their distances and the powers used in the calculation
+  PairBatch        couples;
+  std::vector<double> ir6, dir6;
+/// The components with the calculated PREs
+  std::vector<Value*> pre_comps;
 public:
   static void registerKeywords( Keywords& keys );
   explicit PRE(const ActionOptions&);
@@ -236,6 +245,17 @@ PRE::PRE(const ActionOptions&ao):
     }
   }
 
+  first_couple.resize(nga.size()+1,0);
+  for(unsigned i=0; i<nga.size(); i++) first_couple[i+1]=first_couple[i]+nga[i];
+  std::vector<std::pair<unsigned,unsigned> > pairs(tot_size);
+  for(unsigned i=0; i<tot_size; i++) pairs[i]=nl->getClosePair(i);
+  couples.setPairs(pairs);
+  pre_comps.resize(nga.size());
+  for(unsigned i=0; i<nga.size(); i++) {
+    std::string num; Tools::convert(i,num);
+    pre_comps[i]=getPntrToComponent("pre-"+num);
+  }
+
   requestAtoms(nl->getFullAtomList(), false);
   if(getDoScore()) {
     setParameters(exppre);
@@ -250,35 +270,22 @@ void PRE::calculate()
   std::vector<Vector> deriv(tot_size, Vector{0,0,0});
   std::vector<double> fact(nga.size(), 0.);
 
+  // all the distances and their inverse powers are computed at once
+  couples.computeVectors(getPositions(), pbc?&getPbc():nullptr);
+  couples.inversePowers(6, ir6, dir6);
+
   // cycle over the number of PRE
   #pragma omp parallel for num_threads(OpenMP::getNumThreads())
   for(unsigned i=0; i<nga.size(); i++) {
     Tensor dervir;
     double pre=0;
-    unsigned index=0;
-    for(unsigned k=0; k<i; k++) index+=nga[k];
     const double c_aver=constant/static_cast<double>(nga[i]);
-    std::string num; Tools::convert(i,num);
-    Value* val=getPntrToComponent("pre-"+num);
-    // cycle over equivalent atoms
-    for(unsigned j=0; j<nga[i]; j++) {
-      // the first atom is always the same (the paramagnetic group)
-      const unsigned i0=nl->getClosePair(index+j).first;
-      const unsigned i1=nl->getClosePair(index+j).second;
-
-      Vector distance;
-      if(pbc) distance=pbcDistance(getPosition(i0),getPosition(i1));
-      else    distance=delta(getPosition(i0),getPosition(i1));
-
-      const double r2=distance.modulo2();
-      const double r6=r2*r2*r2;
-      const double r8=r6*r2;
-      const double tmpir6=c_aver/r6;
-      const double tmpir8=-6.*c_aver/r8;
-
-      pre += tmpir6;
-      deriv[index+j] = -tmpir8*distance;
-      if(!getDoScore()) dervir   +=  Tensor(distance,deriv[index+j]);
+    Value* val=pre_comps[i];
+    // cycle over equivalent atoms, the first atom is always the same (the paramagnetic group)
+    for(unsigned k=first_couple[i]; k<first_couple[i+1]; k++) {
+      pre += c_aver*ir6[k];
+      deriv[k] = c_aver*dir6[k]*couples.getVector(k);
+      if(!getDoScore()) dervir   +=  Tensor(couples.getVector(k),deriv[k]);
     }
     double tmpratio;
     if(!doratio) {
@@ -292,11 +299,9 @@ void PRE::calculate()
     val->set(ratio) ;
     if(!getDoScore()) {
       setBoxDerivatives(val, fact[i]*dervir);
-      for(unsigned j=0; j<nga[i]; j++) {
-        const unsigned i0=nl->getClosePair(index+j).first;
-        const unsigned i1=nl->getClosePair(index+j).second;
-        setAtomsDerivatives(val, i0,  fact[i]*deriv[index+j]);
-        setAtomsDerivatives(val, i1, -fact[i]*deriv[index+j]);
+      for(unsigned k=first_couple[i]; k<first_couple[i+1]; k++) {
+        setAtomsDerivatives(val, couples.getFirst(k),  fact[i]*deriv[k]);
+        setAtomsDerivatives(val, couples.getSecond(k), -fact[i]*deriv[k]);
       }
     } else setCalcData(i, ratio);
   }
@@ -310,20 +315,12 @@ void PRE::calculate()
     /* calculate final derivatives */
     Value* val=getPntrToComponent("score");
     for(unsigned i=0; i<nga.size(); i++) {
-      unsigned index=0;
-      for(unsigned k=0; k<i; k++) index+=nga[k];
       // cycle over equivalent atoms
-      for(unsigned j=0; j<nga[i]; j++) {
-        const unsigned i0=nl->getClosePair(index+j).first;
-        const unsigned i1=nl->getClosePair(index+j).second;
-
-        Vector distance;
-        if(pbc) distance=pbcDistance(getPosition(i0),getPosition(i1));
-        else    distance=delta(getPosition(i0),getPosition(i1));
-
-        dervir += Tensor(distance,fact[i]*deriv[index+j]*getMetaDer(i));
-        setAtomsDerivatives(val, i0,  fact[i]*deriv[index+j]*getMetaDer(i));
-        setAtomsDerivatives(val, i1, -fact[i]*deriv[index+j]*getMetaDer(i));
+      for(unsigned k=first_couple[i]; k<first_couple[i+1]; k++) {
+        const Vector der=fact[i]*deriv[k]*getMetaDer(i);
+        dervir += Tensor(couples.getVector(k),der);
+        setAtomsDerivatives(val, couples.getFirst(k),  der);
+        setAtomsDerivatives(val, couples.getSecond(k), -der);
       }
     }
     setBoxDerivatives(val, dervir);
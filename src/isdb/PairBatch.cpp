@@ -0,0 +1,77 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "PairBatch.h"
+#include "tools/Pbc.h"
+#include "tools/OpenMP.h"
+#include <algorithm>
+#include <cmath>
+
+namespace PLMD {
+namespace isdb {
+
+void PairBatch::setPairs(const std::vector<std::pair<unsigned,unsigned> >& pairs) {
+  first_.resize(pairs.size()); second_.resize(pairs.size());
+  for(unsigned k=0; k<pairs.size(); ++k) { first_[k]=pairs[k].first; second_[k]=pairs[k].second; }
+  dx_.resize(pairs.size()); dy_.resize(pairs.size()); dz_.resize(pairs.size()); r2_.resize(pairs.size());
+}
+
+void PairBatch::computeVectors(const std::vector<Vector>& pos, const Pbc* pbc) {
+  const unsigned n=first_.size();
+  // the pairs are processed in blocks, so that pbc are applied to many vectors at once
+  constexpr unsigned blocksize=256;
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*blocksize>n) nt=1;
+  #pragma omp parallel for num_threads(nt)
+  for(unsigned b=0; b<n; b+=blocksize) {
+    const unsigned e=std::min(b+blocksize,n);
+    for(unsigned k=b; k<e; ++k) {
+      const Vector & p0=pos[first_[k]];
+      const Vector & p1=pos[second_[k]];
+      dx_[k]=p1[0]-p0[0]; dy_[k]=p1[1]-p0[1]; dz_[k]=p1[2]-p0[2];
+    }
+    if(pbc) pbc->apply(&dx_[b], &dy_[b], &dz_[b], e-b);
+    #pragma omp simd
+    for(unsigned k=b; k<e; ++k) r2_[k]=dx_[k]*dx_[k]+dy_[k]*dy_[k]+dz_[k]*dz_[k];
+  }
+}
+
+void PairBatch::inversePowers(unsigned n, std::vector<double>& irn, std::vector<double>& dirn) const {
+  const unsigned m=r2_.size();
+  irn.resize(m); dirn.resize(m);
+  const double dn=static_cast<double>(n);
+  const unsigned half=n/2;
+  const bool odd=(n%2==1);
+  const double* r2=r2_.data();
+  double* ir=irn.data();
+  double* dir=dirn.data();
+  #pragma omp simd
+  for(unsigned k=0; k<m; ++k) {
+    const double ir2=1./r2[k];
+    double p = odd ? std::sqrt(ir2) : 1.;
+    for(unsigned j=0; j<half; ++j) p*=ir2;
+    ir[k]=p;
+    dir[k]=dn*p*ir2;
+  }
+}
+
+}
+}
@@ -0,0 +1,61 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_isdb_PairBatch_h
+#define __PLUMED_isdb_PairBatch_h
+
+#include "tools/Vector.h"
+#include <utility>
+#include <vector>
+
+namespace PLMD {
+
+class Pbc;
+
+namespace isdb {
+
+/// Distance vectors between a fixed list of pairs of atoms, stored as a structure of arrays.
+/// The vectors, their periodic images and the inverse powers of the distances used by the
+/// NMR forward models (NOE, PRE, RDC and J-couplings) are evaluated for all the pairs at once.
+class PairBatch {
+/// Indices of the two atoms of each pair
+  std::vector<unsigned> first_, second_;
+/// Components and squared modulo of the vectors
+  std::vector<double> dx_, dy_, dz_, r2_;
+public:
+/// Set the list of pairs
+  void setPairs(const std::vector<std::pair<unsigned,unsigned> >& pairs);
+/// Number of pairs
+  unsigned size() const { return first_.size(); }
+  unsigned getFirst(unsigned k) const { return first_[k]; }
+  unsigned getSecond(unsigned k) const { return second_[k]; }
+/// Compute the vectors going from the first to the second atom of each pair, pbc are used if a pointer is passed
+  void computeVectors(const std::vector<Vector>& pos, const Pbc* pbc);
+  Vector getVector(unsigned k) const { return Vector(dx_[k],dy_[k],dz_[k]); }
+  double getModulo2(unsigned k) const { return r2_[k]; }
+/// Compute r^-n and n*r^-(n+2) for all the pairs, the derivative of r^-n with respect to the first atom is n*r^-(n+2) times the vector
+  void inversePowers(unsigned n, std::vector<double>& irn, std::vector<double>& dirn) const;
+};
+
+}
+}
+
+#endif
@@ -21,6 +21,8 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "MetainferenceBase.h"
 #include "core/ActionRegister.h"
+#include "PairBatch.h"
+#include "tools/OpenMP.h"
 #include "tools/Pbc.h"
 
 #ifdef __PLUMED_HAS_GSL
@@ -181,6 +183,11 @@ private:
   std::vector<double> coupl;
   bool           svd;
   bool           pbc;
+/// The bond vectors and their inverse cubes
+  PairBatch      bonds;
+  std::vector<double> ir3, dir3;
+/// The components with the calculated couplings
+  std::vector<Value*> rdc_comps;
 
 #ifdef __PLUMED_HAS_GSL
 /// Auxiliary class to delete a gsl_vector.
@@ -356,6 +363,15 @@ RDC::RDC(const ActionOptions&ao):
     addComponent("Syz"); componentIsNotPeriodic("Syz");
   }
 
+  std::vector<std::pair<unsigned,unsigned> > pairs(ndata);
+  rdc_comps.resize(ndata);
+  for(unsigned i=0; i<ndata; i++) {
+    pairs[i]=std::pair<unsigned,unsigned>(2*i,2*i+1);
+    std::string num; Tools::convert(i,num);
+    rdc_comps[i]=getPntrToComponent("rdc-"+num);
+  }
+  bonds.setPairs(pairs);
+
   requestAtoms(atoms, false);
   if(getDoScore()) {
     setParameters(coupl);
@@ -383,16 +399,13 @@ void RDC::do_svd()
 
   unsigned index=0;
   std::vector<double> dmax(coupl.size());
+  bonds.computeVectors(getPositions(), pbc?&getPbc():nullptr);
+  bonds.inversePowers(3, ir3, dir3);
   for(unsigned r=0; r<getNumberOfAtoms(); r+=2) {
-    Vector  distance;
-    if(pbc) distance = pbcDistance(getPosition(r),getPosition(r+1));
-    else    distance = delta(getPosition(r),getPosition(r+1));
+    const Vector distance = bonds.getVector(index);
     double d    = distance.modulo();
-    double d2   = d*d;
-    double d3   = d2*d;
-    double id3  = 1./d3;
     double max  = -Const*mu_s*scale;
-    dmax[index] = id3*max;
+    dmax[index] = ir3[index]*max;
     double mu_x = distance[0]/d;
     double mu_y = distance[1]/d;
     double mu_z = distance[2]/d;
@@ -431,8 +444,7 @@ void RDC::do_svd()
   gsl_blas_dgemv(CblasNoTrans, 1.0, coef_mat.get(), S.get(), 0., bc.get());
   for(index=0; index<coupl.size(); index++) {
     double rdc = gsl_vector_get(bc.get(),index)*dmax[index];
-    Value* val=getPntrToComponent(index);
-    val->set(rdc);
+    rdc_comps[index]->set(rdc);
   }
 #endif
 }
@@ -446,46 +458,41 @@ void RDC::calculate()
 
   const double max  = -Const*scale*mu_s;
   const unsigned N=getNumberOfAtoms();
-  std::vector<Vector> dRDC(N/2, Vector{0.,0.,0.});
+  const unsigned ndata=N/2;
+  std::vector<Vector> dRDC(ndata, Vector{0.,0.,0.});
+
+  // all the bond vectors and their inverse cubes are computed at once
+  bonds.computeVectors(getPositions(), pbc?&getPbc():nullptr);
+  bonds.inversePowers(3, ir3, dir3);
 
   /* RDC Calculations and forces */
-  #pragma omp parallel num_threads(OpenMP::getNumThreads())
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads())
+  for(unsigned index=0; index<ndata; index++)
   {
-    #pragma omp for
-    for(unsigned r=0; r<N; r+=2)
-    {
-      const unsigned index=r/2;
-      Vector  distance;
-      if(pbc) distance   = pbcDistance(getPosition(r),getPosition(r+1));
-      else    distance   = delta(getPosition(r),getPosition(r+1));
-      const double d2    = distance.modulo2();
-      const double ind   = 1./std::sqrt(d2);
-      const double ind2  = 1./d2;
-      const double ind3  = ind2*ind;
-      const double x2    = distance[0]*distance[0]*ind2;
-      const double y2    = distance[1]*distance[1]*ind2;
-      const double z2    = distance[2]*distance[2]*ind2;
-      const double dmax  = ind3*max;
-      const double ddmax = dmax*ind2;
-
-      const double rdc   = 0.5*dmax*(3.*z2-1.);
-      const double prod_xy = (x2+y2-4.*z2);
-      const double prod_z =  (3.*x2 + 3.*y2 - 2.*z2);
-
-      dRDC[index] = -1.5*ddmax*distance;
-      dRDC[index][0] *= prod_xy;
-      dRDC[index][1] *= prod_xy;
-      dRDC[index][2] *= prod_z;
-
-      std::string num; Tools::convert(index,num);
-      Value* val=getPntrToComponent("rdc-"+num);
-      val->set(rdc);
-      if(!getDoScore()) {
-        setBoxDerivatives(val, Tensor(distance,dRDC[index]));
-        setAtomsDerivatives(val, r,  dRDC[index]);
-        setAtomsDerivatives(val, r+1, -dRDC[index]);
-      } else setCalcData(index, rdc);
-    }
+    const Vector distance = bonds.getVector(index);
+    const double ind2  = 1./bonds.getModulo2(index);
+    const double x2    = distance[0]*distance[0]*ind2;
+    const double y2    = distance[1]*distance[1]*ind2;
+    const double z2    = distance[2]*distance[2]*ind2;
+    const double dmax  = ir3[index]*max;
+    const double ddmax = dmax*ind2;
+
+    const double rdc   = 0.5*dmax*(3.*z2-1.);
+    const double prod_xy = (x2+y2-4.*z2);
+    const double prod_z =  (3.*x2 + 3.*y2 - 2.*z2);
+
+    dRDC[index] = -1.5*ddmax*distance;
+    dRDC[index][0] *= prod_xy;
+    dRDC[index][1] *= prod_xy;
+    dRDC[index][2] *= prod_z;
+
+    Value* val=rdc_comps[index];
+    val->set(rdc);
+    if(!getDoScore()) {
+      setBoxDerivatives(val, Tensor(distance,dRDC[index]));
+      setAtomsDerivatives(val, 2*index,  dRDC[index]);
+      setAtomsDerivatives(val, 2*index+1, -dRDC[index]);
+    } else setCalcData(index, rdc);
   }
 
   if(getDoScore()) {
@@ -496,16 +503,12 @@ void RDC::calculate()
 
     /* calculate final derivatives */
     Value* val=getPntrToComponent("score");
-    for(unsigned r=0; r<N; r+=2)
+    for(unsigned index=0; index<ndata; index++)
     {
-      const unsigned index=r/2;
-      Vector  distance;
-      if(pbc) distance   = pbcDistance(getPosition(r),getPosition(r+1));
-      else    distance   = delta(getPosition(r),getPosition(r+1));
       const Vector der = dRDC[index]*getMetaDer(index);
-      dervir += Tensor(distance, der);
-      setAtomsDerivatives(val, r,  der);
-      setAtomsDerivatives(val, r+1, -der);
+      dervir += Tensor(bonds.getVector(index), der);
+      setAtomsDerivatives(val, 2*index,  der);
+      setAtomsDerivatives(val, 2*index+1, -der);
     }
     setBoxDerivatives(val, dervir);
   }
@@ -38,6 +38,7 @@
 #include "tools/PDB.h"
 #include "tools/Tools.h"
 #include "tools/IFile.h"
+#include "CellGrid.h"
 
 #include <map>
 #include <iterator>
@@ -88,7 +89,10 @@ solvent accessible beads only: the form factors of the amino acids / phosphate g
 nucleobases with a SASA (computed via LCPO algorithm) greater than a threshold are corrected according to an
 electron density term. Both the surface cut-off threshold and the electron density term can be set by the user
 with the SASA_CUTOFF and SOLVATION_CORRECTION keywords. Moreover, SASA stride calculation can be modified using
-SOLVATION_STRIDE, which is set to 10 steps by default.
+SOLVATION_STRIDE, which is set to 10 steps by default. The pairs of overlapping atoms are taken from a neighbor list
+with a skin of SASA_SKIN, built with a cell list and only rebuilt when an atom has moved by more than half the skin.
+With SASA_TOLERANCE larger than zero only the atoms whose neighborhood has moved by more than the tolerance since
+their last evaluation are recomputed, so that small values of SOLVATION_STRIDE can be used at a small cost.
 ONEBEAD requires an additional PDB file to perform mapping conversion, which must be provided via TEMPLATE
 keyword. This PDB file should only include the atoms for which the SAXS intensity will be computed.
 The AMBER OL3 (RNA) and OL15 (DNA) naming is required for nucleic acids.
@@ -113,7 +117,23 @@ The ABSOLUTE flag can be used in order to calculate intensities in the absolute
 the ATOMISTIC scheme and cannot be used with SCALE_EXPINT.
 
 By default SAXS is calculated using Debye on CPU, by adding the GPU flag it is possible to solve the equation on
-a GPU if the ARRAYFIRE libraries are installed and correctly linked.
+a GPU if the ARRAYFIRE libraries are installed and correctly linked.  If more than one device is given with DEVICEID the
+pairs of atoms are split among them.  By default only the first MPI rank runs the calculation on GPU, with the GPU_MPI flag
+the calculation is split among all the ranks so that each of them uses its own devices.
+For large systems the HISTOGRAM flag can be used to bin the distances between the pairs of atoms or beads with the same
+pair of form factors in histograms with bins of width HISTOGRAM_BIN.  The intensities are then computed from the histograms,
+so the cost of the Debye sum does not grow with the product of the number of pairs and the number of q values.
+
+For many q values and large systems the MULTIPOLE flag can be used to expand the scattering amplitude around the center of the
+atoms or beads in spherical harmonics up to the angular momentum MULTIPOLE_LMAX, so that the orientationally averaged intensity is
+
+\f[
+I(q) = 4\pi \sum_{l=0}^{L} \sum_{m=-l}^{l} \left| \sum_j f_j(q) j_l(q r_j) Y_{lm}(\hat{r}_j) \right|^2
+\f]
+
+where \f$j_l\f$ are spherical Bessel functions and \f$Y_{lm}\f$ real spherical harmonics.  The cost is linear in the number of atoms and the
+expansion converges to the Debye equation when \f$L\f$ is larger than \f$q D/2\f$, with \f$D\f$ the largest distance
+of an atom from the center.
 \ref METAINFERENCE can be activated using DOSCORE and the other relevant keywords.
 
 \par Examples
@@ -205,6 +225,9 @@ the ATOMISTIC scheme and cannot be used with SCALE_EXPINT.
 
 By default SANS is calculated using Debye on CPU, by adding the GPU flag it is possible to solve the equation on a
 GPU if the ARRAYFIRE libraries are installed and correctly linked.
+As for \ref SAXS the HISTOGRAM flag can be used to compute the intensities from histograms of the distances between the pairs
+of beads with the same pair of form factors, and the MULTIPOLE flag to use a spherical harmonics expansion of the
+scattering amplitude.
 \ref METAINFERENCE can be activated using DOSCORE and the other relevant keywords.
 
 \par Examples
@@ -308,11 +331,22 @@ private:
   bool pbc;
   bool serial;
   bool gpu;
+  bool histogram;
+  bool multipole;
   bool onebead;
   bool resolution;
   bool isFirstStep;
-  int  deviceid;
+  bool gpu_mpi;
+  std::vector<int> deviceid;
   unsigned nres;
+  // histogram of distances: the width of the bins, the form factor type of each bead, the form factors of each type and the histograms
+  double histo_bin;
+  std::vector<unsigned> ff_type;
+  std::vector<std::vector<double> > ff_type_value;
+  std::vector<double> histo, histo_slope;
+  unsigned histo_nbins;
+  // largest angular momentum of the spherical harmonics expansion of the scattering amplitude
+  unsigned lmax;
   std::vector<unsigned> atoi;
   std::vector<unsigned> atoms_per_bead;
   std::vector<double>   atoms_masses;
@@ -332,6 +366,12 @@ private:
 
   std::vector<std::vector<double> > LCPOparam;
   std::vector<unsigned> residue_atom;
+  // SASA: neighbor list with a skin, positions at which it was built, positions of the atoms at their last evaluation, SASA of each atom
+  std::vector<std::vector<int> > sasa_nlist;
+  std::vector<Vector> sasa_nlist_pos;
+  std::vector<Vector> sasa_ref_pos;
+  std::vector<double> sasa_atom;
+  double sasa_skin, sasa_tolerance;
 
   double rho, rho_corr, sasa_cutoff;
   double deuter_conc;
@@ -415,7 +455,13 @@ private:
     };
 
   void calculate_gpu(std::vector<Vector> &pos, std::vector<Vector> &deriv);
+  void setGpuDevice(const int id) const;
   void calculate_cpu(std::vector<Vector> &pos, std::vector<Vector> &deriv);
+  void calculate_histogram(std::vector<Vector> &pos, std::vector<Vector> &deriv);
+  void calculate_histogram_score_derivatives(std::vector<Vector> &pos, std::vector<Vector> &deriv);
+  void calculate_multipole(std::vector<Vector> &pos, std::vector<Vector> &deriv);
+  void sphericalBessel(const double x, double* jl, double* djl) const;
+  void realSphericalHarmonics(const Vector &dir, double* ylm, Vector* dylm) const;
   void getMartiniFFparam(const std::vector<AtomNumber> &atoms, std::vector<std::vector<long double> > &parameter);
   void getOnebeadparam(const PDB &pdb, const std::vector<AtomNumber> &atoms, std::vector<std::vector<long double> > &parameter_vac, std::vector<std::vector<long double> > &parameter_mix, std::vector<std::vector<long double> > &parameter_solv, const std::vector<unsigned> & residue_atom);
   unsigned getOnebeadMapping(const PDB &pdb, const std::vector<AtomNumber> &atoms);
@@ -448,8 +494,13 @@ void SAXS::registerKeywords(Keywords& keys) {
   MetainferenceBase::registerKeywords(keys);
   keys.addFlag("NOPBC",false,"Ignore the periodic boundary conditions when calculating distances");
   keys.addFlag("SERIAL",false,"Perform the calculation in serial - for debug purpose");
-  keys.add("compulsory","DEVICEID","-1","Identifier of the GPU to be used");
+  keys.add("compulsory","DEVICEID","-1","Identifiers of the GPUs to be used.  If more than one GPU is given the pairs of atoms are split among them");
+  keys.addFlag("GPU_MPI",false,"Split the calculation on GPU among all the MPI ranks, each of them using its own GPUs, rather than running it on the first rank only");
   keys.addFlag("GPU",false,"Calculate SAXS using ARRAYFIRE on an accelerator device");
+  keys.addFlag("HISTOGRAM",false,"Calculate SAXS from histograms of the distances between the pairs of atoms with the same pair of form factors");
+  keys.add("compulsory","HISTOGRAM_BIN","0.01","Width in nm of the bins of the histograms of distances used with HISTOGRAM");
+  keys.addFlag("MULTIPOLE",false,"Calculate SAXS from a spherical harmonics expansion of the scattering amplitude");
+  keys.add("compulsory","MULTIPOLE_LMAX","20","Largest angular momentum in the spherical harmonics expansion used with MULTIPOLE");
   keys.addFlag("ABSOLUTE",false,"Absolute intensity: the intensities for each q-value are not normalised for the intensity at q=0.");
   keys.addFlag("ATOMISTIC",false,"Calculate SAXS for an atomistic model");
   keys.addFlag("MARTINI",false,"Calculate SAXS for a Martini model");
@@ -463,6 +514,8 @@ void SAXS::registerKeywords(Keywords& keys) {
   keys.add("compulsory","SOLVDENS","0.334","Density of the solvent to be used for the correction of atomistic form factors");
   keys.add("compulsory","SOLVATION_CORRECTION","0.0","Solvation layer electron density correction (ONEBEAD only)");
   keys.add("compulsory","SASA_CUTOFF","1.0","SASA value to consider a residue as exposed to the solvent (ONEBEAD only)");
+  keys.add("compulsory","SASA_SKIN","0.1","Skin of the neighbor list used in the SASA calculation, the list is rebuilt when an atom has moved by more than half the skin (ONEBEAD only)");
+  keys.add("compulsory","SASA_TOLERANCE","0.0","The SASA of an atom is recomputed only if the atom or one of its neighbors has moved by more than this distance (ONEBEAD only)");
   keys.add("numbered","EXPINT","Add an experimental value for each q value");
   keys.add("numbered","SIGMARES","Variance of Gaussian distribution describing the deviation in the scattering angle for each q value");
   keys.add("compulsory","N","10","Number of points in the resolution function integral");
@@ -479,9 +532,14 @@ SAXS::SAXS(const ActionOptions&ao):
   pbc(true),
   serial(false),
   gpu(false),
+  histogram(false),
+  multipole(false),
   onebead(false),
   isFirstStep(true),
-  deviceid(-1)
+  gpu_mpi(false),
+  histo_bin(0.01),
+  histo_nbins(0),
+  lmax(20)
 {
   if( getName().find("SAXS")!=std::string::npos) { saxs=true; }
   else if( getName().find("SANS")!=std::string::npos) { saxs=false; }
@@ -503,21 +561,42 @@ SAXS::SAXS(const ActionOptions&ao):
   if(gpu) error("To use the GPU mode PLUMED must be compiled with ARRAYFIRE");
 #endif
 
-  parse("DEVICEID",deviceid);
+  parseFlag("HISTOGRAM",histogram);
+  if(histogram&&gpu) error("HISTOGRAM cannot be used with GPU");
+  parse("HISTOGRAM_BIN",histo_bin);
+  if(histogram) {
+    if(histo_bin<=0.) error("HISTOGRAM_BIN must be greater than 0");
+    log.printf("  using histograms of distances with bins of width %lf nm\n", histo_bin);
+  }
+
+  parseFlag("MULTIPOLE",multipole);
+  if(multipole&&(gpu||histogram)) error("MULTIPOLE cannot be used with GPU or HISTOGRAM");
+  parse("MULTIPOLE_LMAX",lmax);
+  if(multipole) log.printf("  using a spherical harmonics expansion of the scattering amplitude up to l=%u\n", lmax);
+
+  parseVector("DEVICEID",deviceid);
+  parseFlag("GPU_MPI",gpu_mpi);
+  if(gpu_mpi&&!gpu) error("GPU_MPI can only be used with GPU");
+  if(gpu_mpi&&serial) error("GPU_MPI cannot be used with SERIAL");
 #ifdef  __PLUMED_HAS_ARRAYFIRE
-  if(gpu&&comm.Get_rank()==0) {
-    // if not set try to check the one set by the API
-    if(deviceid==-1) deviceid=plumed.getGpuDeviceId();
-    // if still not set use 0
-    if(deviceid==-1) deviceid=0;
-#ifdef  __PLUMED_HAS_ARRAYFIRE_CUDA
-    af::setDevice(afcu::getNativeId(deviceid));
-#elif   __PLUMED_HAS_ARRAYFIRE_OCL
-    af::setDevice(afcl::getNativeId(deviceid));
-#else
-    af::setDevice(deviceid);
-#endif
-    af::info();
+  if(gpu&&(gpu_mpi||comm.Get_rank()==0)) {
+    if(deviceid.size()==1&&deviceid[0]==-1) {
+      // if not set try to check the one set by the API
+      deviceid[0]=plumed.getGpuDeviceId();
+      // if still not set use 0, or share the devices of the node among the ranks
+      if(deviceid[0]==-1) deviceid[0]=gpu_mpi ? comm.Get_rank()%af::getDeviceCount() : 0;
+    }
+    for(unsigned i=0; i<deviceid.size(); ++i) {
+      setGpuDevice(deviceid[i]);
+      char dname[64], dplatform[10], dtoolkit[64], dcompute[10];
+      af::deviceInfo(dname,dplatform,dtoolkit,dcompute);
+      log.printf("  rank %d uses GPU device %d: %s (%s %s, compute %s)\n",comm.Get_rank(),deviceid[i],dname,dplatform,dtoolkit,dcompute);
+    }
+  }
+  if(gpu) {
+    log.printf("  using %u GPUs", static_cast<unsigned>(deviceid.size()));
+    if(gpu_mpi) log.printf(" on each of the %u MPI ranks", comm.Get_size());
+    log.printf("\n");
   }
 #endif
 
@@ -587,6 +666,17 @@ SAXS::SAXS(const ActionOptions&ao):
   parse("SASA_CUTOFF", sasa_cutoff);
   if(sasa_cutoff <= 0.) error("SASA_CUTOFF must be greater than 0");
 
+  sasa_skin = 0.1;
+  parse("SASA_SKIN", sasa_skin);
+  if(sasa_skin < 0.) error("SASA_SKIN cannot be negative");
+  sasa_tolerance = 0.;
+  parse("SASA_TOLERANCE", sasa_tolerance);
+  if(sasa_tolerance < 0.) error("SASA_TOLERANCE cannot be negative");
+  if(onebead&&(rho_corr!=rho||deuter_conc!=0.)) {
+    log.printf("  SASA neighbor list skin: %lf\n", sasa_skin);
+    if(sasa_tolerance>0.) log.printf("  SASA recomputed for atoms whose neighborhood moved by more than: %lf\n", sasa_tolerance);
+  }
+
   deuter_conc = 0.;
   parse("DEUTER_CONC", deuter_conc);
   if ((deuter_conc)&&(fromfile)) error("DEUTER_CONC cannot be used with PARAMETERSFILE");
@@ -850,6 +940,8 @@ SAXS::SAXS(const ActionOptions&ao):
   if(ntarget==numq) resolution=true;
 
   if(gpu && resolution) error("Resolution function is not supported in GPUs");
+  if(histogram && resolution) error("Resolution function is not supported with HISTOGRAM");
+  if(multipole && resolution) error("Resolution function is not supported with MULTIPOLE");
 
   Nj = 10;
   parse("N", Nj);
@@ -1015,81 +1107,122 @@ SAXS::SAXS(const ActionOptions&ao):
   checkRead();
 }
 
-// calculates SASA neighbor list
+// calculates SASA neighbor list, including the pairs within the skin
 void SAXS::calcNlist(std::vector<std::vector<int> > &Nlist)
 {
   unsigned natoms = getNumberOfAtoms();
-  for(unsigned i = 0; i < natoms; ++i) {
-    if (LCPOparam[i].size()>0) {
-      for (unsigned j = 0; j < i; ++j) {
-        if (LCPOparam[j].size()>0) {
-          double Delta_ij_mod = modulo(delta(getPosition(i), getPosition(j)))*10.;
-          double overlapD = LCPOparam[i][0]+LCPOparam[j][0];
-          if(Delta_ij_mod < overlapD) {
-            Nlist.at(i).push_back(j);
-            Nlist.at(j).push_back(i);
-          }
-        }
+  Nlist.assign(natoms, std::vector<int>());
+  double rmax = 0.;
+  for(unsigned i = 0; i < natoms; ++i) if(LCPOparam[i].size()>0) rmax = std::max(rmax, LCPOparam[i][0]);
+  // radii are in Angstrom
+  const double rcut = 0.2*rmax + sasa_skin;
+  if(rcut<=0.) return;
+  CellGrid cells;
+  cells.build(getPositions(), rcut);
+  #pragma omp parallel num_threads(OpenMP::getNumThreads())
+  {
+    std::vector<unsigned> close;
+    #pragma omp for
+    for(unsigned i = 0; i < natoms; ++i) {
+      if (LCPOparam[i].size()==0) continue;
+      close.clear();
+      cells.retrieve(getPosition(i), rcut, close);
+      std::sort(close.begin(), close.end());
+      for(const auto j : close) {
+        if(j==i || LCPOparam[j].size()==0) continue;
+        double Delta_ij_mod = modulo(delta(getPosition(i), getPosition(j)))*10.;
+        double overlapD = LCPOparam[i][0]+LCPOparam[j][0]+10.*sasa_skin;
+        if(Delta_ij_mod < overlapD) Nlist[i].push_back(j);
       }
     }
   }
-
+  sasa_nlist_pos = getPositions();
 }
 
 // calculates SASA according to LCPO algorithm
 void SAXS::sasa_calculate(std::vector<bool> &solv_res) {
   unsigned natoms = getNumberOfAtoms();
+  const bool first = (sasa_atom.size()!=natoms);
+  // the neighbor list is rebuilt when an atom has moved by more than half the skin
+  bool rebuild = first;
+  for(unsigned i = 0; i < natoms && !rebuild; ++i) {
+    if(modulo2(getPosition(i)-sasa_nlist_pos[i]) > 0.25*sasa_skin*sasa_skin) rebuild = true;
+  }
+  if(rebuild) calcNlist(sasa_nlist);
+  // atoms that have moved since their last evaluation
+  std::vector<char> moved(natoms, 1);
+  if(first) {
+    sasa_atom.assign(natoms, 0.);
+    sasa_ref_pos = getPositions();
+  } else {
+    const double tol2 = sasa_tolerance*sasa_tolerance;
+    for(unsigned i = 0; i < natoms; ++i) moved[i] = (modulo2(getPosition(i)-sasa_ref_pos[i]) > tol2);
+  }
+  // pairs of overlapping atoms: as the neighbor list is sorted, these are sorted too
   std::vector<std::vector<int> > Nlist(natoms);
-  calcNlist(Nlist);
-  std::vector<double> sasares(nres, 0.);
+  std::vector<char> update(natoms, 0);
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads())
+  for (unsigned i = 0; i < natoms; ++i) {
+    if (LCPOparam[i].size()==0) continue;
+    update[i] = moved[i];
+    for (const auto j : sasa_nlist[i]) {
+      if(moved[j]) update[i] = 1;
+      double Delta_ij_mod = modulo(delta(getPosition(i), getPosition(j)))*10.;
+      double overlapD = LCPOparam[i][0]+LCPOparam[j][0];
+      if(Delta_ij_mod < overlapD) Nlist[i].push_back(j);
+    }
+  }
 
-  #pragma omp parallel num_threads(OpenMP::getNumThreads())
-  {
-    std::vector<double> private_sasares(nres, 0.);
-    #pragma omp for
-    for (unsigned i = 0; i < natoms; ++i) {
-      if (LCPOparam[i].size() > 1 && LCPOparam[i][1] > 0.0) {
-        double Aij = 0.0;
-        double Aijk = 0.0;
-        double Ajk = 0.0;
-        double ri = LCPOparam[i][0];
-        double S1 = 4.*M_PI*ri*ri;
-        for (unsigned j = 0; j < Nlist[i].size(); ++j) {
-          double d_ij = modulo(delta( getPosition(i), getPosition(Nlist[i][j]) ))*10.;
-          double rj = LCPOparam[Nlist[i][j]][0];
-          double Aijt = (2.*M_PI*ri*(ri-d_ij/2.-((ri*ri-rj*rj)/(2.*d_ij))));
-          double Ajkt = 0.0;
-          for (unsigned k = 0; k < Nlist[Nlist[i][j]].size(); ++k) {
-            if (std::find (Nlist[i].begin(), Nlist[i].end(), Nlist[Nlist[i][j]][k]) !=  Nlist[i].end()) {
-              double d_jk = modulo(delta( getPosition(Nlist[i][j]), getPosition(Nlist[Nlist[i][j]][k]) ))*10.;
-              double rk = LCPOparam[Nlist[Nlist[i][j]][k]][0];
-              double sjk =  (2.*M_PI*rj*(rj-d_jk/2.-((rj*rj-rk*rk)/(2.*d_jk))));
-              Ajkt += sjk;
-            }
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads())
+  for (unsigned i = 0; i < natoms; ++i) {
+    if (update[i] && LCPOparam[i].size() > 1 && LCPOparam[i][1] > 0.0) {
+      double Aij = 0.0;
+      double Aijk = 0.0;
+      double Ajk = 0.0;
+      double ri = LCPOparam[i][0];
+      double S1 = 4.*M_PI*ri*ri;
+      for (unsigned j = 0; j < Nlist[i].size(); ++j) {
+        double d_ij = modulo(delta( getPosition(i), getPosition(Nlist[i][j]) ))*10.;
+        double rj = LCPOparam[Nlist[i][j]][0];
+        double Aijt = (2.*M_PI*ri*(ri-d_ij/2.-((ri*ri-rj*rj)/(2.*d_ij))));
+        double Ajkt = 0.0;
+        for (unsigned k = 0; k < Nlist[Nlist[i][j]].size(); ++k) {
+          if (std::binary_search(Nlist[i].begin(), Nlist[i].end(), Nlist[Nlist[i][j]][k])) {
+            double d_jk = modulo(delta( getPosition(Nlist[i][j]), getPosition(Nlist[Nlist[i][j]][k]) ))*10.;
+            double rk = LCPOparam[Nlist[Nlist[i][j]][k]][0];
+            double sjk =  (2.*M_PI*rj*(rj-d_jk/2.-((rj*rj-rk*rk)/(2.*d_jk))));
+            Ajkt += sjk;
           }
-          Aijk += (Aijt * Ajkt);
-          Aij += Aijt;
-          Ajk += Ajkt;
-        }
-        double sasai = (LCPOparam[i][1]*S1+LCPOparam[i][2]*Aij+LCPOparam[i][3]*Ajk+LCPOparam[i][4]*Aijk);
-        if (sasai > 0) {
-          private_sasares[residue_atom[i]] += sasai / 100.0;
         }
+        Aijk += (Aijt * Ajkt);
+        Aij += Aijt;
+        Ajk += Ajkt;
       }
-    }
-    #pragma omp critical
-    { // combining private_sasares into sasares
-      for (unsigned i = 0; i < nres; ++i) {
-        sasares[i] += private_sasares[i];
-      }
+      double sasai = (LCPOparam[i][1]*S1+LCPOparam[i][2]*Aij+LCPOparam[i][3]*Ajk+LCPOparam[i][4]*Aijk);
+      sasa_atom[i] = (sasai > 0) ? sasai / 100.0 : 0.;
     }
   }
+  for (unsigned i = 0; i < natoms; ++i) if(moved[i]) sasa_ref_pos[i] = getPosition(i);
+
+  std::vector<double> sasares(nres, 0.);
+  for (unsigned i = 0; i < natoms; ++i) if(sasa_atom[i] > 0) sasares[residue_atom[i]] += sasa_atom[i];
   for(unsigned i=0; i<nres; ++i) { // updating solv_res based on sasares
     if(sasares[i]>sasa_cutoff) solv_res[i] = 1;
     else solv_res[i] = 0;
   }
 }
 
+void SAXS::setGpuDevice(const int id) const
+{
+#ifdef  __PLUMED_HAS_ARRAYFIRE_CUDA
+  af::setDevice(afcu::getNativeId(id));
+#elif   __PLUMED_HAS_ARRAYFIRE_OCL
+  af::setDevice(afcl::getNativeId(id));
+#elif   __PLUMED_HAS_ARRAYFIRE
+  af::setDevice(id);
+#endif
+}
+
 void SAXS::calculate_gpu(std::vector<Vector> &pos, std::vector<Vector> &deriv)
 {
 #ifdef __PLUMED_HAS_ARRAYFIRE
@@ -1098,14 +1231,11 @@ void SAXS::calculate_gpu(std::vector<Vector> &pos, std::vector<Vector> &deriv)
   else size = getNumberOfAtoms();
   const unsigned numq = q_list.size();
 
-  std::vector<float> sum;
-  sum.resize(numq);
-
-  std::vector<float> dd;
-  dd.resize(size*3*numq);
+  std::vector<float> sum(numq,0.);
+  std::vector<float> dd(size*3*numq,0.);
 
-  // on gpu only the master rank run the calculation
-  if(comm.Get_rank()==0) {
+  // the rows of the matrix of distances are split among the devices of all the ranks that run the calculation
+  if(gpu_mpi||comm.Get_rank()==0) {
     std::vector<float> posi;
     posi.resize(3*size);
     #pragma omp parallel for num_threads(OpenMP::getNumThreads())
@@ -1116,83 +1246,98 @@ void SAXS::calculate_gpu(std::vector<Vector> &pos, std::vector<Vector> &deriv)
       posi[3*i+2] = static_cast<float>(tmp[2]);
     }
 
-    // create array a and b containing atomic coordinates
-#ifdef  __PLUMED_HAS_ARRAYFIRE_CUDA
-    af::setDevice(afcu::getNativeId(deviceid));
-#elif   __PLUMED_HAS_ARRAYFIRE_OCL
-    af::setDevice(afcl::getNativeId(deviceid));
-#else
-    af::setDevice(deviceid);
-#endif
-    // 3,size,1,1
-    af::array pos_a = af::array(3, size, &posi.front());
-    // size,3,1,1
-    pos_a = af::moddims(pos_a.T(), size, 3, 1);
-    // size,3,1,1
-    af::array pos_b = pos_a(af::span, af::span);
-    // size,1,3,1
-    pos_a = af::moddims(pos_a, size, 1, 3);
-    // 1,size,3,1
-    pos_b = af::moddims(pos_b, 1, size, 3);
-
-    // size,size,3,1
-    af::array pos_a_t = af::tile(pos_a, 1, size, 1);
-    // size,size,3,1: for some reason we need this
-    pos_a_t = af::moddims(pos_a_t, size, size, 3);
-    // size,size,3,1
-    af::array pos_b_t = af::tile(pos_b, size, 1, 1);
-    // size,size,3,1: for some reason we need this
-    pos_b_t = af::moddims(pos_b_t, size, size, 3);
-    // size,size,3,1
-    af::array xyz_dist = pos_a_t - pos_b_t;
-    // size,size,1,1
-    af::array square = af::sum(xyz_dist*xyz_dist,2);
-    // size,size,1,1
-    af::array dist_sqrt = af::sqrt(square);
-    // replace the zero of square with one to avoid nan in the derivatives (the number does not matter because this are multiplied by zero)
-    af::replace(square,!(af::iszero(square)),1.);
-    // size,size,3,1
-    xyz_dist = xyz_dist / af::tile(square, 1, 1, 3);
-    // numq,1,1,1
-    af::array sum_device   = af::constant(0, numq, f32);
-    // numq,size,3,1
-    af::array deriv_device = af::constant(0, numq, size, 3, f32);
-
-    for (unsigned k=0; k<numq; ++k) {
-      // calculate FF matrix
-      // size,1,1,1
-      af::array AFF_value(size, &FFf_value[k].front());
-      // size,size,1,1
-      af::array FFdist_mod = af::tile(AFF_value(af::span), 1, size)*af::transpose(af::tile(AFF_value(af::span), 1, size));
-
-      // get q
-      const float qvalue = static_cast<float>(q_list[k]);
-      // size,size,1,1
-      af::array dist_q = qvalue*dist_sqrt;
-      // size,size,1
-      af::array dist_sin = af::sin(dist_q)/dist_q;
-      af::replace(dist_sin,!(af::isNaN(dist_sin)),1.);
-      // 1,1,1,1
-      sum_device(k) = af::sum(af::flat(dist_sin)*af::flat(FFdist_mod));
-
-      // size,size,1,1
-      af::array tmp = FFdist_mod*(dist_sin - af::cos(dist_q));
-      // size,size,3,1
-      af::array dd_all = af::tile(tmp, 1, 1, 3)*xyz_dist;
-      // it should become 1,size,3
-      deriv_device(k, af::span, af::span) = af::sum(dd_all,0);
+    const unsigned ndev = deviceid.size();
+    const unsigned nparts = gpu_mpi ? ndev*comm.Get_size() : ndev;
+    const unsigned first_part = gpu_mpi ? ndev*comm.Get_rank() : 0;
+    std::vector<af::array> sum_device(ndev), deriv_device(ndev);
+    std::vector<unsigned> nrows(ndev);
+    for (unsigned d=0; d<ndev; ++d) {
+      const unsigned row_start = (static_cast<size_t>(first_part+d)*size)/nparts;
+      const unsigned row_end = (static_cast<size_t>(first_part+d+1)*size)/nparts;
+      nrows[d] = row_end - row_start;
+      if(nrows[d]==0) continue;
+      setGpuDevice(deviceid[d]);
+      const unsigned nr = nrows[d];
+
+      // create array a and b containing atomic coordinates
+      // 3,size,1,1
+      af::array pos_all = af::array(3, size, &posi.front());
+      // size,3,1,1
+      pos_all = af::moddims(pos_all.T(), size, 3, 1);
+      // nr,1,3,1
+      af::array pos_a = af::moddims(pos_all(af::seq(row_start,row_end-1), af::span), nr, 1, 3);
+      // 1,size,3,1
+      af::array pos_b = af::moddims(pos_all, 1, size, 3);
+
+      // nr,size,3,1
+      af::array pos_a_t = af::tile(pos_a, 1, size, 1);
+      // nr,size,3,1: for some reason we need this
+      pos_a_t = af::moddims(pos_a_t, nr, size, 3);
+      // nr,size,3,1
+      af::array pos_b_t = af::tile(pos_b, nr, 1, 1);
+      // nr,size,3,1: for some reason we need this
+      pos_b_t = af::moddims(pos_b_t, nr, size, 3);
+      // nr,size,3,1
+      af::array xyz_dist = pos_a_t - pos_b_t;
+      // nr,size,1,1
+      af::array square = af::sum(xyz_dist*xyz_dist,2);
+      // nr,size,1,1
+      af::array dist_sqrt = af::sqrt(square);
+      // replace the zero of square with one to avoid nan in the derivatives (the number does not matter because this are multiplied by zero)
+      af::replace(square,!(af::iszero(square)),1.);
+      // nr,size,3,1
+      xyz_dist = xyz_dist / af::tile(square, 1, 1, 3);
+      // numq,1,1,1
+      sum_device[d]   = af::constant(0, numq, f32);
+      // numq,size,3,1
+      deriv_device[d] = af::constant(0, numq, size, 3, f32);
+
+      for (unsigned k=0; k<numq; ++k) {
+        // calculate FF matrix
+        // size,1,1,1
+        af::array AFF_value(size, &FFf_value[k].front());
+        // nr,size,1,1
+        af::array FFdist_mod = af::tile(AFF_value(af::seq(row_start,row_end-1)), 1, size)*af::transpose(af::tile(AFF_value(af::span), 1, nr));
+
+        // get q
+        const float qvalue = static_cast<float>(q_list[k]);
+        // nr,size,1,1
+        af::array dist_q = qvalue*dist_sqrt;
+        // nr,size,1
+        af::array dist_sin = af::sin(dist_q)/dist_q;
+        af::replace(dist_sin,!(af::isNaN(dist_sin)),1.);
+        // 1,1,1,1
+        sum_device[d](k) = af::sum(af::flat(dist_sin)*af::flat(FFdist_mod));
+
+        // nr,size,1,1
+        af::array tmp = FFdist_mod*(dist_sin - af::cos(dist_q));
+        // nr,size,3,1
+        af::array dd_all = af::tile(tmp, 1, 1, 3)*xyz_dist;
+        // it should become 1,size,3
+        deriv_device[d](k, af::span, af::span) = af::sum(dd_all,0);
+      }
+      deriv_device[d] = af::flat(af::reorder(deriv_device[d], 2, 1, 0));
     }
 
-    // read out results
-    sum_device.host(&sum.front());
-
-    deriv_device = af::reorder(deriv_device, 2, 1, 0);
-    deriv_device = af::flat(deriv_device);
-    deriv_device.host(&dd.front());
+    // the devices run asynchronously so the results are read out only once the work has been queued on all of them
+    std::vector<float> dev_sum(numq), dev_dd(size*3*numq);
+    for (unsigned d=0; d<ndev; ++d) {
+      if(nrows[d]==0) continue;
+      setGpuDevice(deviceid[d]);
+      sum_device[d].host(&dev_sum.front());
+      deriv_device[d].host(&dev_dd.front());
+      for (unsigned k=0; k<numq; ++k) sum[k] += dev_sum[k];
+      for (unsigned i=0; i<dd.size(); ++i) dd[i] += dev_dd[i];
+    }
   }
 
-  comm.Bcast(dd, 0);
-  comm.Bcast(sum, 0);
+  if(gpu_mpi) {
+    comm.Sum(&dd[0], dd.size());
+    comm.Sum(&sum[0], numq);
+  } else {
+    comm.Bcast(dd, 0);
+    comm.Bcast(sum, 0);
+  }
 
   for(unsigned k=0; k<numq; ++k) {
     std::string num; Tools::convert(k,num);
@@ -1330,6 +1475,396 @@ void SAXS::calculate_cpu(std::vector<Vector> &pos, std::vector<Vector> &deriv)
   }
 }
 
+void SAXS::calculate_histogram(std::vector<Vector> &pos, std::vector<Vector> &deriv)
+{
+  unsigned size;
+  if(onebead) size = nres;
+  else size = getNumberOfAtoms();
+  const unsigned numq = q_list.size();
+
+  unsigned stride = comm.Get_size();
+  unsigned rank   = comm.Get_rank();
+  if(serial) {
+    stride = 1;
+    rank   = 0;
+  }
+
+  // beads that have the same form factors for all the q values are of the same type
+  std::map<std::vector<double>,unsigned> types;
+  ff_type.resize(size); ff_type_value.clear();
+  for(unsigned i=0; i<size; ++i) {
+    auto it = types.find(FF_value[i]);
+    if(it==types.end()) {
+      it = types.insert(std::make_pair(FF_value[i],static_cast<unsigned>(ff_type_value.size()))).first;
+      ff_type_value.push_back(FF_value[i]);
+    }
+    ff_type[i] = it->second;
+  }
+  const unsigned ntypes = ff_type_value.size();
+
+  // the largest distance is smaller than the diagonal of the box that contains all the beads
+  Vector pmin = pos[0], pmax = pos[0];
+  for(unsigned i=1; i<size; ++i) {
+    for(unsigned l=0; l<3; ++l) {
+      pmin[l] = std::min(pmin[l],pos[i][l]);
+      pmax[l] = std::max(pmax[l],pos[i][l]);
+    }
+  }
+  const double ibin = 1./histo_bin;
+  const unsigned nbins = histo_nbins = static_cast<unsigned>(std::floor(delta(pmin,pmax).modulo()*ibin)) + 2;
+
+  // each distance is shared between the two closest bins so the intensity is a linear interpolation of the Debye sum
+  histo.assign(ntypes*ntypes*nbins,0.);
+  unsigned nt=OpenMP::getNumThreads();
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double> omp_histo;
+    if(nt>1) omp_histo.assign(histo.size(),0.);
+    std::vector<double> & myhisto = (nt>1) ? omp_histo : histo;
+    #pragma omp for schedule(dynamic) nowait
+    for (unsigned i=rank; i<size-1; i+=stride) {
+      const Vector posi = pos[i];
+      const unsigned ti = ff_type[i];
+      for (unsigned j=i+1; j<size ; ++j) {
+        const unsigned tj = ff_type[j];
+        double x = delta(posi,pos[j]).modulo()*ibin;
+        const unsigned n = static_cast<unsigned>(x);
+        x -= n;
+        double* h = myhisto.data() + (std::min(ti,tj)*ntypes+std::max(ti,tj))*nbins + n;
+        h[0] += 1.-x;
+        h[1] += x;
+      }
+    }
+    #pragma omp critical
+    if(nt>1) {
+      for(unsigned i=0; i<histo.size(); ++i) histo[i]+=omp_histo[i];
+    }
+  }
+  if(!serial) comm.Sum(&histo[0], histo.size());
+
+  // the Debye function and its slope between the centers of the bins
+  std::vector<double> sinc(numq*nbins);
+  histo_slope.resize(numq*nbins);
+  for (unsigned k=0; k<numq; ++k) {
+    sinc[k*nbins] = 1.;
+    for (unsigned n=1; n<nbins; ++n) {
+      const double qdist = q_list[k]*n*histo_bin;
+      sinc[k*nbins+n] = std::sin(qdist)/qdist;
+    }
+    for (unsigned n=0; n<nbins-1; ++n) histo_slope[k*nbins+n] = (sinc[k*nbins+n+1]-sinc[k*nbins+n])*ibin;
+    histo_slope[k*nbins+nbins-1] = 0.;
+  }
+
+  std::vector<std::pair<unsigned,unsigned> > tpairs;
+  for(unsigned a=0; a<ntypes; ++a) {
+    for(unsigned b=a; b<ntypes; ++b) {
+      const double* h = histo.data() + (a*ntypes+b)*nbins;
+      if(std::any_of(h, h+nbins, [](double v) { return v!=0.; })) tpairs.push_back(std::make_pair(a,b));
+    }
+  }
+
+  std::vector<double> sum(numq,0);
+  #pragma omp parallel for num_threads(nt)
+  for (unsigned k=0; k<numq; ++k) {
+    for(const auto & tp : tpairs) {
+      const double* h = histo.data() + (tp.first*ntypes+tp.second)*nbins;
+      const double* sk = sinc.data() + k*nbins;
+      double hsum = 0.;
+      for (unsigned n=0; n<nbins; ++n) hsum += h[n]*sk[n];
+      sum[k] += 2.*ff_type_value[tp.first][k]*ff_type_value[tp.second][k]*hsum;
+    }
+  }
+
+  // with metainference the derivatives of the score are computed once the score is known
+  if(!getDoScore()) {
+    #pragma omp parallel num_threads(nt)
+    {
+      std::vector<Vector> omp_deriv;
+      if(nt>1) omp_deriv.resize(deriv.size());
+      std::vector<Vector> & myderiv = (nt>1) ? omp_deriv : deriv;
+      #pragma omp for schedule(dynamic) nowait
+      for (unsigned i=rank; i<size-1; i+=stride) {
+        const Vector posi = pos[i];
+        for (unsigned j=i+1; j<size ; ++j) {
+          Vector c_distances = delta(posi,pos[j]);
+          const double m_distances = c_distances.modulo();
+          if(m_distances==0.) continue;
+          c_distances /= m_distances;
+          const unsigned n = static_cast<unsigned>(m_distances*ibin);
+          for (unsigned k=0; k<numq; ++k) {
+            const unsigned kdx=k*size;
+            const Vector dd = c_distances*(2.*FF_value[i][k]*FF_value[j][k]*histo_slope[k*nbins+n]);
+            myderiv[kdx+i] -= dd;
+            myderiv[kdx+j] += dd;
+          }
+        }
+      }
+      #pragma omp critical
+      if(nt>1) {
+        for(unsigned i=0; i<deriv.size(); ++i) deriv[i]+=omp_deriv[i];
+      }
+    }
+    if(!serial) comm.Sum(&deriv[0][0], 3*deriv.size());
+  }
+
+  for (unsigned k=0; k<numq; ++k) {
+    sum[k]+=FF_rank[k];
+    std::string num; Tools::convert(k,num);
+    Value* val=getPntrToComponent("q-"+num);
+    val->set(sum[k]);
+    if(getDoScore()) setCalcData(k, sum[k]);
+  }
+}
+
+void SAXS::calculate_histogram_score_derivatives(std::vector<Vector> &pos, std::vector<Vector> &deriv)
+{
+  unsigned size;
+  if(onebead) size = nres;
+  else size = getNumberOfAtoms();
+  const unsigned numq = q_list.size();
+  const unsigned ntypes = ff_type_value.size();
+  const unsigned nbins = histo_nbins;
+  const double ibin = 1./histo_bin;
+
+  unsigned stride = comm.Get_size();
+  unsigned rank   = comm.Get_rank();
+  if(serial) {
+    stride = 1;
+    rank   = 0;
+  }
+
+  // the derivative of the score with respect to the distance between two beads of each pair of types in each bin
+  std::vector<double> dscore(ntypes*ntypes*nbins,0.);
+  unsigned nt=OpenMP::getNumThreads();
+  #pragma omp parallel for num_threads(nt)
+  for(unsigned a=0; a<ntypes; ++a) {
+    for(unsigned b=a; b<ntypes; ++b) {
+      double* g = dscore.data() + (a*ntypes+b)*nbins;
+      for (unsigned k=0; k<numq; ++k) {
+        const double FFF = 2.*ff_type_value[a][k]*ff_type_value[b][k]*getMetaDer(k);
+        const double* sk = histo_slope.data() + k*nbins;
+        for (unsigned n=0; n<nbins; ++n) g[n] += FFF*sk[n];
+      }
+    }
+  }
+
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<Vector> omp_deriv;
+    if(nt>1) omp_deriv.resize(size);
+    std::vector<Vector> & myderiv = (nt>1) ? omp_deriv : deriv;
+    #pragma omp for schedule(dynamic) nowait
+    for (unsigned i=rank; i<size-1; i+=stride) {
+      const Vector posi = pos[i];
+      const unsigned ti = ff_type[i];
+      for (unsigned j=i+1; j<size ; ++j) {
+        Vector c_distances = delta(posi,pos[j]);
+        const double m_distances = c_distances.modulo();
+        if(m_distances==0.) continue;
+        const unsigned tj = ff_type[j];
+        const unsigned n = static_cast<unsigned>(m_distances*ibin);
+        const Vector dd = c_distances*(dscore[(std::min(ti,tj)*ntypes+std::max(ti,tj))*nbins+n]/m_distances);
+        myderiv[i] -= dd;
+        myderiv[j] += dd;
+      }
+    }
+    #pragma omp critical
+    if(nt>1) {
+      for(unsigned i=0; i<size; ++i) deriv[i]+=omp_deriv[i];
+    }
+  }
+  if(!serial) comm.Sum(&deriv[0][0], 3*size);
+}
+
+void SAXS::sphericalBessel(const double x, double* jl, double* djl) const
+{
+  // for small arguments only the l=0 and l=1 functions and derivatives are not negligible
+  if(x<1.e-12) {
+    for(unsigned l=0; l<=lmax; ++l) { jl[l]=0.; djl[l]=0.; }
+    jl[0]=1.;
+    if(lmax>0) djl[1]=1./3.;
+    return;
+  }
+  const double sx=std::sin(x), cx=std::cos(x), j0=sx/x, j1=sx/(x*x)-cx/x;
+  if(x>lmax || lmax==0) {
+    // upward recurrence is stable for x larger than l
+    jl[0]=j0;
+    if(lmax>0) jl[1]=j1;
+    for(unsigned l=1; l<lmax; ++l) jl[l+1]=(2*l+1)/x*jl[l]-jl[l-1];
+  } else {
+    // downward recurrence (Miller algorithm) normalized on the largest of j0 and j1
+    const unsigned lstart = lmax + 20 + static_cast<unsigned>(x);
+    double jp1=0., jc=1.e-30;
+    for(unsigned l=lstart; l>0; --l) {
+      const double jm1=(2*l+1)/x*jc-jp1;
+      jp1=jc; jc=jm1;
+      if(l-1<=lmax) jl[l-1]=jc;
+      if(std::fabs(jc)>1.e250) {
+        jc*=1.e-250; jp1*=1.e-250;
+        for(unsigned k=l-1; k<=lmax; ++k) jl[k]*=1.e-250;
+      }
+    }
+    // jl[0] and jl[1] are now known up to a common factor
+    const double norm = (std::fabs(j0)>std::fabs(j1)) ? j0/jl[0] : j1/jl[1];
+    for(unsigned l=0; l<=lmax; ++l) jl[l]*=norm;
+  }
+  djl[0]=-jl[1];
+  for(unsigned l=1; l<=lmax; ++l) djl[l]=jl[l-1]-(l+1)/x*jl[l];
+}
+
+void SAXS::realSphericalHarmonics(const Vector &dir, double* ylm, Vector* dylm) const
+{
+  // the direction in spherical coordinates, the poles have phi=0
+  const double ct=dir[2], st=std::sqrt(std::max(0.,1.-ct*ct));
+  double cp=1., sp=0.;
+  if(st>1.e-12) { cp=dir[0]/st; sp=dir[1]/st; }
+  const Vector etheta(ct*cp,ct*sp,-st), ephi(-sp,cp,0.);
+
+  // normalized associated Legendre functions p and the same divided by sin(theta)
+  const unsigned nl=lmax+1;
+  std::vector<double> p(nl*nl,0.), q(nl*nl,0.);
+  p[0]=1./std::sqrt(4.*pi);
+  for(unsigned m=1; m<=lmax; ++m) {
+    const double f=-std::sqrt((2.*m+1.)/(2.*m));
+    q[m*nl+m] = (m==1) ? f*p[0] : f*st*q[(m-1)*nl+m-1];
+    p[m*nl+m] = f*st*p[(m-1)*nl+m-1];
+  }
+  for(unsigned m=0; m<=lmax; ++m) {
+    if(m+1<=lmax) {
+      p[(m+1)*nl+m]=std::sqrt(2.*m+3.)*ct*p[m*nl+m];
+      q[(m+1)*nl+m]=std::sqrt(2.*m+3.)*ct*q[m*nl+m];
+    }
+    for(unsigned l=m+2; l<=lmax; ++l) {
+      const double a=std::sqrt((4.*l*l-1.)/(1.*l*l-1.*m*m)), b=std::sqrt(((l-1.)*(l-1.)-1.*m*m)/(4.*(l-1.)*(l-1.)-1.));
+      p[l*nl+m]=a*(ct*p[(l-1)*nl+m]-b*p[(l-2)*nl+m]);
+      q[l*nl+m]=a*(ct*q[(l-1)*nl+m]-b*q[(l-2)*nl+m]);
+    }
+  }
+
+  // real spherical harmonics and their gradient on the unit sphere
+  for(unsigned l=0; l<=lmax; ++l) {
+    const unsigned l0=l*l+l;
+    ylm[l0]=p[l*nl];
+    dylm[l0] = (l>0) ? std::sqrt(l*(l+1.))*p[l*nl+1]*etheta : Vector(0.,0.,0.);
+    double cm=1., sm=0.;
+    for(unsigned m=1; m<=l; ++m) {
+      const double cm1=cm*cp-sm*sp; sm=sm*cp+cm*sp; cm=cm1;
+      const double dtheta = l*ct*q[l*nl+m]-std::sqrt((2.*l+1.)*(1.*l*l-1.*m*m)/(2.*l-1.))*q[(l-1)*nl+m];
+      ylm[l0+m]=std::sqrt(2.)*p[l*nl+m]*cm;
+      ylm[l0-m]=std::sqrt(2.)*p[l*nl+m]*sm;
+      dylm[l0+m]=std::sqrt(2.)*(dtheta*cm*etheta-m*q[l*nl+m]*sm*ephi);
+      dylm[l0-m]=std::sqrt(2.)*(dtheta*sm*etheta+m*q[l*nl+m]*cm*ephi);
+    }
+  }
+}
+
+void SAXS::calculate_multipole(std::vector<Vector> &pos, std::vector<Vector> &deriv)
+{
+  unsigned size;
+  if(onebead) size = nres;
+  else size = getNumberOfAtoms();
+  const unsigned numq = q_list.size();
+  const unsigned nlm = (lmax+1)*(lmax+1);
+
+  unsigned stride = comm.Get_size();
+  unsigned rank   = comm.Get_rank();
+  if(serial) {
+    stride = 1;
+    rank   = 0;
+  }
+
+  // the expansion is done around the center of the beads
+  Vector center;
+  for(unsigned i=0; i<size; ++i) center += pos[i];
+  center /= size;
+
+  // the coefficients of the expansion of the scattering amplitude for each q value
+  std::vector<double> alm(numq*nlm,0.);
+  unsigned nt=OpenMP::getNumThreads();
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double> omp_alm;
+    if(nt>1) omp_alm.assign(alm.size(),0.);
+    std::vector<double> & myalm = (nt>1) ? omp_alm : alm;
+    std::vector<double> ylm(nlm), jl(lmax+1), djl(lmax+1);
+    std::vector<Vector> dylm(nlm);
+    #pragma omp for nowait
+    for (unsigned i=rank; i<size; i+=stride) {
+      const Vector ri = delta(center,pos[i]);
+      const double mod = ri.modulo();
+      realSphericalHarmonics( (mod>0.) ? ri/mod : Vector(0.,0.,1.), ylm.data(), dylm.data() );
+      for (unsigned k=0; k<numq; ++k) {
+        sphericalBessel(q_list[k]*mod, jl.data(), djl.data());
+        double* ak = myalm.data() + k*nlm;
+        for (unsigned l=0; l<=lmax; ++l) {
+          const double fj = FF_value[i][k]*jl[l];
+          for (unsigned lm=l*l; lm<(l+1)*(l+1); ++lm) ak[lm] += fj*ylm[lm];
+        }
+      }
+    }
+    #pragma omp critical
+    if(nt>1) {
+      for(unsigned i=0; i<alm.size(); ++i) alm[i]+=omp_alm[i];
+    }
+  }
+  if(!serial) comm.Sum(&alm[0], alm.size());
+
+  std::vector<double> sum(numq,0);
+  for (unsigned k=0; k<numq; ++k) {
+    for (unsigned lm=0; lm<nlm; ++lm) sum[k] += alm[k*nlm+lm]*alm[k*nlm+lm];
+    sum[k] *= 4.*pi;
+  }
+
+  // the gradient of each term of the expansion is the radial derivative of the Bessel function plus the gradient of the harmonic
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double> ylm(nlm), jl(lmax+1), djl(lmax+1);
+    std::vector<Vector> dylm(nlm);
+    #pragma omp for
+    for (unsigned i=rank; i<size; i+=stride) {
+      const Vector ri = delta(center,pos[i]);
+      const double mod = ri.modulo();
+      const Vector dir = (mod>0.) ? ri/mod : Vector(0.,0.,1.);
+      realSphericalHarmonics( dir, ylm.data(), dylm.data() );
+      for (unsigned k=0; k<numq; ++k) {
+        const double qk = q_list[k], x = qk*mod;
+        sphericalBessel(x, jl.data(), djl.data());
+        const double* ak = alm.data() + k*nlm;
+        double radial = 0.;
+        Vector angular;
+        for (unsigned l=0; l<=lmax; ++l) {
+          const double jlx = (x<1.e-12) ? ((l==1) ? 1./3. : 0.) : jl[l]/x;
+          double ay = 0.;
+          Vector ady;
+          for (unsigned lm=l*l; lm<(l+1)*(l+1); ++lm) {
+            ay += ak[lm]*ylm[lm];
+            ady += ak[lm]*dylm[lm];
+          }
+          radial += djl[l]*ay;
+          angular += jlx*ady;
+        }
+        deriv[k*size+i] = (8.*pi*FF_value[i][k]*qk)*(radial*dir+angular);
+      }
+    }
+  }
+  if(!serial) comm.Sum(&deriv[0][0], 3*deriv.size());
+
+  // the center depends on the positions of all the beads
+  for (unsigned k=0; k<numq; ++k) {
+    Vector mean;
+    for (unsigned i=0; i<size; ++i) mean += deriv[k*size+i];
+    mean /= size;
+    for (unsigned i=0; i<size; ++i) deriv[k*size+i] -= mean;
+  }
+
+  for (unsigned k=0; k<numq; ++k) {
+    std::string num; Tools::convert(k,num);
+    Value* val=getPntrToComponent("q-"+num);
+    val->set(sum[k]);
+    if(getDoScore()) setCalcData(k, sum[k]);
+  }
+}
+
 void SAXS::calculate()
 {
   if(pbc) makeWhole();
@@ -1471,15 +2006,20 @@ void SAXS::calculate()
   }
 
   if(gpu) calculate_gpu(beads_pos, bd_deriv);
+  else if(histogram) calculate_histogram(beads_pos, bd_deriv);
+  else if(multipole) calculate_multipole(beads_pos, bd_deriv);
   else calculate_cpu(beads_pos, bd_deriv);
 
   if(getDoScore()) {
     /* Metainference */
     double score = getScore();
     setScore(score);
+    // with histograms the derivatives of the score are computed directly and stored in the first block of bd_deriv
+    if(histogram) calculate_histogram_score_derivatives(beads_pos, bd_deriv);
   }
 
-  for (unsigned k=0; k<numq; ++k) {
+  const size_t nderq = (histogram&&getDoScore()) ? 1 : numq;
+  for (unsigned k=0; k<nderq; ++k) {
     const unsigned kdx=k*beads_size;
     Tensor deriv_box;
     Value* val;
@@ -1512,27 +2052,28 @@ void SAXS::calculate()
       }
     } else {
       val=getPntrToComponent("score");
+      const double metader = histogram ? 1. : getMetaDer(k);
       if(onebead) {
         unsigned atom_id=0;
         for(unsigned i=0; i<beads_size; ++i) {
           for(unsigned j=0; j<atoms_per_bead[i]; ++j) {
-            setAtomsDerivatives(val, atom_id, Vector(aa_deriv[atom_id][0]*bd_deriv[kdx+i][0]*getMetaDer(k),
-                                aa_deriv[atom_id][1]*bd_deriv[kdx+i][1]*getMetaDer(k),
-                                aa_deriv[atom_id][2]*bd_deriv[kdx+i][2]*getMetaDer(k)) );
-            deriv_box += Tensor(getPosition(atom_id),Vector(aa_deriv[atom_id][0]*bd_deriv[kdx+i][0]*getMetaDer(k),
-                                aa_deriv[atom_id][1]*bd_deriv[kdx+i][1]*getMetaDer(k),
-                                aa_deriv[atom_id][2]*bd_deriv[kdx+i][2]*getMetaDer(k)) );
+            setAtomsDerivatives(val, atom_id, Vector(aa_deriv[atom_id][0]*bd_deriv[kdx+i][0]*metader,
+                                aa_deriv[atom_id][1]*bd_deriv[kdx+i][1]*metader,
+                                aa_deriv[atom_id][2]*bd_deriv[kdx+i][2]*metader) );
+            deriv_box += Tensor(getPosition(atom_id),Vector(aa_deriv[atom_id][0]*bd_deriv[kdx+i][0]*metader,
+                                aa_deriv[atom_id][1]*bd_deriv[kdx+i][1]*metader,
+                                aa_deriv[atom_id][2]*bd_deriv[kdx+i][2]*metader) );
             atom_id++;
           }
         }
       } else {
         for(unsigned i=0; i<beads_size; ++i) {
-          setAtomsDerivatives(val, i, Vector(bd_deriv[kdx+i][0]*getMetaDer(k),
-                                             bd_deriv[kdx+i][1]*getMetaDer(k),
-                                             bd_deriv[kdx+i][2]*getMetaDer(k)) );
-          deriv_box += Tensor(getPosition(i),Vector(bd_deriv[kdx+i][0]*getMetaDer(k),
-                              bd_deriv[kdx+i][1]*getMetaDer(k),
-                              bd_deriv[kdx+i][2]*getMetaDer(k)) );
+          setAtomsDerivatives(val, i, Vector(bd_deriv[kdx+i][0]*metader,
+                                             bd_deriv[kdx+i][1]*metader,
+                                             bd_deriv[kdx+i][2]*metader) );
+          deriv_box += Tensor(getPosition(i),Vector(bd_deriv[kdx+i][0]*metader,
+                              bd_deriv[kdx+i][1]*metader,
+                              bd_deriv[kdx+i][2]*metader) );
         }
       }
     }
@@ -21,12 +21,27 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "matrixtools/MatrixOperationBase.h"
 #include "core/ActionRegister.h"
+#include "tools/OpenMP.h"
 #include "tools/Random.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 //+PLUMEDOC LANDMARKS FARTHEST_POINT_SAMPLING
 /*
 Select a set of landmarks using farthest point sampling.
 
+The input can be a square matrix of dissimilarities or, if the flag DATA is present, a matrix that contains one
+collected frame in each row. In the second case the squared Euclidean distances between the frames and the landmarks are computed
+when they are needed, so the full matrix of dissimilarities is never stored. In both cases only the minimum distance between each point
+and the landmarks selected so far is kept, so the memory used by this action grows linearly with the number of points.
+
+If the flag INCREMENTAL is present the first landmark is chosen only once, and the landmarks and the minimum distances are kept
+from one calculation to the next. When new frames have been appended to the input, only the distances between
+the new frames and the landmarks are computed. If none of the new frames would have been chosen in place of one of the landmarks, the selection is
+unchanged. Otherwise the landmarks that come before the first one that changes are kept and the rest of them are selected again.
+The result is always the same as that of the farthest point sampling of all the points starting from the same first landmark.
+
 \par Examples
 
 */
@@ -39,6 +54,21 @@ class FarthestPointSampling : public matrixtools::MatrixOperationBase {
 private:
   unsigned seed;
   unsigned nlandmarks;
+/// Is the input the frames rather than the dissimilarities
+  bool data;
+/// Are the landmarks kept between calculations
+  bool incremental;
+/// The landmarks and the minimum distance from each landmark to those selected before it
+  std::vector<unsigned> landmarks;
+  std::vector<double> radius;
+/// The minimum distance between each point and the landmarks
+  std::vector<double> mindist;
+/// Get the distance between two points
+  double getDistance( const unsigned& i, const unsigned& j ) const ;
+/// Compute the distance between the points from first onwards and landmark k and keep the smallest
+  void updateMinimumDistances( const unsigned& k, const unsigned& first );
+/// Select the landmarks from n onwards
+  void selectLandmarks( const unsigned& n );
 public:
   static void registerKeywords( Keywords& keys );
   explicit FarthestPointSampling( const ActionOptions& ao );
@@ -55,6 +85,8 @@ void FarthestPointSampling::registerKeywords( Keywords& keys ) {
   matrixtools::MatrixOperationBase::registerKeywords( keys );
   keys.add("compulsory","NZEROS","the number of landmark points that you want to select");
   keys.add("compulsory","SEED","1234","a random number seed");
+  keys.addFlag("DATA",false,"the input matrix contains one frame in each row and the squared Euclidean distances between the frames are computed on the fly");
+  keys.addFlag("INCREMENTAL",false,"keep the landmarks between calculations and only compute the distances for the frames that have been added");
   keys.setValueDescription("vector","a vector which has as many elements as there are rows in the input matrix of dissimilarities. NZEROS of the elements in this vector are equal to one, the rest of the elements are equal to zero.  The nodes that have elements equal to one are the NZEROS points that are farthest appart according to the input dissimilarities");
 }
 
@@ -62,9 +94,13 @@ FarthestPointSampling::FarthestPointSampling( const ActionOptions& ao ):
   Action(ao),
   MatrixOperationBase(ao)
 {
-  if( getPntrToArgument(0)->getShape()[0]!=getPntrToArgument(0)->getShape()[1] ) error("input to this argument should be a square matrix of dissimilarities");
+  parseFlag("DATA",data);
+  if( !data && getPntrToArgument(0)->getShape()[0]!=getPntrToArgument(0)->getShape()[1] ) error("input to this argument should be a square matrix of dissimilarities");
   parse("NZEROS",nlandmarks); parse("SEED",seed);
   log.printf("  selecting %d landmark points \n", nlandmarks );
+  if( data ) log.printf("  input matrix contains the frames, squared Euclidean distances are computed on the fly \n");
+  parseFlag("INCREMENTAL",incremental);
+  if( incremental ) log.printf("  landmarks are kept between calculations and updated when frames are added \n");
 
   std::vector<unsigned> shape(1); shape[0] = getPntrToArgument(0)->getShape()[0];
   addValue( shape ); setNotPeriodic(); getPntrToComponent(0)->buildDataStore();
@@ -75,37 +111,80 @@ void FarthestPointSampling::prepare() {
   if( myval->getShape()[0]!=getPntrToArgument(0)->getShape()[0] ) {
     std::vector<unsigned> shape(1); shape[0] = getPntrToArgument(0)->getShape()[0]; myval->setShape(shape);
   }
-  for(unsigned i=0; i<nlandmarks; ++i) myval->set( i, 0.0 );
-  for(unsigned i=nlandmarks; i<myval->getShape()[0]; ++i) myval->set( i, 1.0 );
+  // There may be fewer points than landmarks when the frames are still being collected
+  unsigned npoints = myval->getShape()[0], nzeros = std::min( nlandmarks, npoints );
+  for(unsigned i=0; i<nzeros; ++i) myval->set( i, 0.0 );
+  for(unsigned i=nzeros; i<npoints; ++i) myval->set( i, 1.0 );
 }
 
-void FarthestPointSampling::calculate() {
-  Value* myval=getPntrToComponent(0); unsigned npoints = getPntrToArgument(0)->getShape()[0];
-  for(unsigned i=0; i<npoints; ++i) myval->set( i, 1.0 );
-  std::vector<unsigned> landmarks( nlandmarks );
-
-  // Select first point at random
-  Random random; random.setSeed(-seed); double rand=random.RandU01();
-  landmarks[0] = std::floor( npoints*rand ); myval->set( landmarks[0], 0 );
+double FarthestPointSampling::getDistance( const unsigned& i, const unsigned& j ) const {
+  Value* myarg = getPntrToArgument(0); std::size_t ncols = myarg->getShape()[1];
+  if( !data ) return myarg->get( i*ncols + j );
+  // N.B. We can use squared distances here for speed
+  double d2=0;
+  for(std::size_t k=0; k<ncols; ++k) { double tmp = myarg->get( i*ncols + k ) - myarg->get( j*ncols + k ); d2 += tmp*tmp; }
+  return d2;
+}
 
-  // Now find distance to all other points (N.B. We can use squared distances here for speed)
-  Matrix<double> distances( nlandmarks, npoints ); Value* myarg = getPntrToArgument(0);
-  for(unsigned i=0; i<npoints; ++i) distances(0,i) = myarg->get( landmarks[0]*npoints + i );
+void FarthestPointSampling::updateMinimumDistances( const unsigned& k, const unsigned& first ) {
+  unsigned npoints = mindist.size();
+  #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(mindist.data()+first,npoints-first))
+  for(unsigned j=first; j<npoints; ++j) {
+    double d = getDistance( landmarks[k], j );
+    if( d<mindist[j] ) mindist[j]=d;
+  }
+}
 
-  // Now find all other landmarks
-  for(unsigned i=1; i<nlandmarks; ++i) {
+void FarthestPointSampling::selectLandmarks( const unsigned& n ) {
+  unsigned npoints = mindist.size();
+  for(unsigned i=n; i<nlandmarks; ++i) {
     // Find point that has the largest minimum distance from the landmarks selected thus far
-    double maxd=0;
+    double maxd=0; unsigned maxj=0;
     for(unsigned j=0; j<npoints; ++j) {
-      double mind=distances(0,j);
-      for(unsigned k=1; k<i; ++k) {
-        if( distances(k,j)<mind ) { mind=distances(k,j); }
+      if( mindist[j]>maxd ) { maxd=mindist[j]; maxj=j; }
+    }
+    landmarks[i]=maxj; radius[i]=maxd;
+    updateMinimumDistances( i, 0 );
+  }
+}
+
+void FarthestPointSampling::calculate() {
+  Value* myval=getPntrToComponent(0); unsigned npoints = getPntrToArgument(0)->getShape()[0];
+  if( nlandmarks>npoints ) error("cannot select more landmarks than there are points");
+  for(unsigned i=0; i<npoints; ++i) myval->set( i, 1.0 );
+
+  unsigned nold = incremental ? mindist.size() : 0;
+  if( nold>npoints ) nold=0;
+  unsigned nkeep = 0;
+  if( nold==0 ) {
+    // Select first point at random
+    Random random; random.setSeed(-seed); double rand=random.RandU01();
+    landmarks.resize( nlandmarks ); radius.resize( nlandmarks );
+    landmarks[0] = std::floor( npoints*rand ); radius[0] = std::numeric_limits<double>::max();
+    mindist.assign( npoints, std::numeric_limits<double>::max() );
+    updateMinimumDistances( 0, 0 ); nkeep = 1;
+  } else {
+    // Find the first landmark that would be replaced by one of the new frames
+    mindist.resize( npoints, std::numeric_limits<double>::max() ); nkeep = nlandmarks;
+    #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(mindist.data()+nold,npoints-nold)) reduction(min:nkeep)
+    for(unsigned j=nold; j<npoints; ++j) {
+      double mind = std::numeric_limits<double>::max();
+      for(unsigned k=0; k<nlandmarks; ++k) {
+        if( k>=nkeep ) break;
+        if( k>0 && mind>radius[k] ) { nkeep=k; break; }
+        double d = getDistance( landmarks[k], j ); if( d<mind ) mind=d;
       }
-      if( mind>maxd ) { maxd=mind; landmarks[i]=j; }
+      mindist[j]=mind;
+    }
+    if( nkeep<nlandmarks ) {
+      // Recompute the minimum distances from the landmarks that are kept
+      std::fill( mindist.begin(), mindist.end(), std::numeric_limits<double>::max() );
+      for(unsigned k=0; k<nkeep; ++k) updateMinimumDistances( k, 0 );
     }
-    myval->set( landmarks[i], 0 );
-    for(unsigned k=0; k<npoints; ++k) distances(i,k) = myarg->get( landmarks[i]*npoints + k );
   }
+  // Now find all other landmarks
+  selectLandmarks( nkeep );
+  for(unsigned i=0; i<nlandmarks; ++i) myval->set( landmarks[i], 0 );
 }
 
 }
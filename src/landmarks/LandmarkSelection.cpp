@@ -48,6 +48,9 @@ Select a random set of landmarks from a large set of configurations.
 /*
 Select a of landmarks from a large set of configurations using farthest point sampling.
 
+If NODISSIMILARITIES is used the matrix of dissimilarities between all the frames is not computed and the distances that are
+needed to select the landmarks are computed from the collected frames.
+
 \par Examples
 
 */
@@ -121,9 +124,10 @@ LandmarkSelection::LandmarkSelection( const ActionOptions& ao ):
     std::string seed; parse("SEED",seed); if( seed.length()>0 ) seed = " SEED=" + seed;
     readInputLine( getShortcutLabel() + "_mask: CREATE_MASK ARG=" + getShortcutLabel() + "_allweights TYPE=random NZEROS=" + nlandmarks + seed );
   } else if( getName()=="LANDMARK_SELECT_FPS" ) {
-    if( dissims.length()==0 ) error("dissimiarities must be defined to use FPS sampling");
     std::string seed; parse("SEED",seed); if( seed.length()>0 ) seed = " SEED=" + seed;
-    readInputLine( getShortcutLabel() + "_mask: FARTHEST_POINT_SAMPLING ARG=" + dissims + " NZEROS=" + nlandmarks + seed );
+    if( dissims.length()>0 ) readInputLine( getShortcutLabel() + "_mask: FARTHEST_POINT_SAMPLING ARG=" + dissims + " NZEROS=" + nlandmarks + seed );
+    else if( argn.length()>0 ) readInputLine( getShortcutLabel() + "_mask: FARTHEST_POINT_SAMPLING ARG=" + argn + "_data DATA NZEROS=" + nlandmarks + seed );
+    else error("dissimiarities or frames must be defined to use FPS sampling");
   }
 
   if( argn.length()>0 ) readInputLine( getShortcutLabel() + "_data: SELECT_WITH_MASK ARG=" + argn + "_data ROW_MASK=" + getShortcutLabel() + "_mask");
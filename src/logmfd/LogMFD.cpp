@@ -374,6 +374,7 @@ replica.out.1
 #include "tools/Communicator.h"
 
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
 using namespace PLMD;
@@ -430,6 +431,10 @@ class LogMFD : public Bias {
   std::vector<double> ffict;    ///< current force of each fictitous dynamical variable.
   std::vector<double> fict_ave; ///< averaged values of each collective variable.
 
+  std::vector<double> pd_send;  ///< work and mean forces of this replica packed for LogPD.
+  std::vector<double> pd_recv;  ///< work and mean forces of all replicas gathered for LogPD.
+  std::vector<double> pd_weight;///< unnormalized Jarzynski weights of all replicas.
+
   std::vector<Value*>  fictValue; ///< pointers to fictitious dynamical variables
   std::vector<Value*> vfictValue; ///< pointers to velocity of fictitious dynamical variables
 
@@ -761,17 +766,21 @@ void LogMFD::calculate() {
     step_initial = getStep();
 
     // set initial values of fictitious variables if they were not specified.
+    std::vector<unsigned> unset;
     for(unsigned i=0; i<getNumberOfArguments(); ++i) {
       if( fict[i] != -999.0 ) continue; // -999 means no initial values given in plumed.dat
 
       // use the collective variables as the initial of the fictitious variable.
       fict[i] = getArgument(i);
+      unset.push_back(i);
+    }
 
-      // average values of fictitious variables by all replica.
-      if( multi_sim_comm.Get_size()>1 ) {
-        multi_sim_comm.Sum(fict[i]);
-        fict[i] /= multi_sim_comm.Get_size();
-      }
+    // average values of fictitious variables by all replica.
+    if( multi_sim_comm.Get_size()>1 && unset.size()>0 ) {
+      std::vector<double> fict_sum( unset.size() );
+      for(unsigned j=0; j<unset.size(); ++j) fict_sum[j] = fict[unset[j]];
+      multi_sim_comm.Sum(fict_sum);
+      for(unsigned j=0; j<unset.size(); ++j) fict[unset[j]] = fict_sum[j] / multi_sim_comm.Get_size();
     }
 
     // initialize accumulation value to zero
@@ -1154,32 +1163,47 @@ void LogMFD::calcMeanForce() {
 
   // for replica parallel
   if( multi_sim_comm.Get_size()>1 ) {
+    const unsigned nrep = multi_sim_comm.Get_size();
+    const unsigned narg = getNumberOfArguments();
+    const unsigned stride = narg + 1;
+
+    // gather work and mean forces of all replicas with a single collective
+    pd_send.resize( stride );
+    pd_recv.resize( nrep*stride );
+    pd_weight.resize( nrep );
+    pd_send[0] = work;
+    for(unsigned i=0; i<narg; ++i) pd_send[i+1] = ffict[i];
+    multi_sim_comm.Allgather(pd_send,pd_recv);
+
     // find the minimum work among all replicas
-    double work_min = work;
-    multi_sim_comm.Min(work_min);
+    double work_min = pd_recv[0];
+    for(unsigned r=1; r<nrep; ++r) work_min = std::min( work_min, pd_recv[r*stride] );
 
-    // weight of this replica.
+    // weights of all replicas.
     // here, work is reduced by work_min to avoid all exp(-work/kbt)s disconverge
-    if( kbtpd == 0.0 ) {
-      weight = work==work_min ? 1.0 : 0.0;
-    }
-    else {
-      weight = exp(-(work-work_min)/kbtpd);
-    }
-
-    // normalize the weight
-    double sum_weight = weight;
-    multi_sim_comm.Sum(sum_weight);
-    weight /= sum_weight;
-
-    // weighting force of this replica
-    for(unsigned i=0; i<getNumberOfArguments(); ++i) {
-      ffict[i] *= weight;
+    double sum_weight = 0.0;
+    for(unsigned r=0; r<nrep; ++r) {
+      const double rwork = pd_recv[r*stride];
+      if( kbtpd == 0.0 ) {
+        pd_weight[r] = rwork==work_min ? 1.0 : 0.0;
+      }
+      else {
+        pd_weight[r] = exp(-(rwork-work_min)/kbtpd);
+      }
+      sum_weight += pd_weight[r];
     }
 
-    // averaged mean forces of all replica.
-    for(unsigned i=0; i<getNumberOfArguments(); ++i) {
-      multi_sim_comm.Sum(ffict[i]);
+    // normalized weight of this replica
+    weight = pd_weight[multi_sim_comm.Get_rank()] / sum_weight;
+
+    // averaged mean forces of all replica weighted by their normalized weights.
+    // every replica does the same sum so that all of them obtain the same mean force.
+    for(unsigned i=0; i<narg; ++i) ffict[i] = 0.0;
+    for(unsigned r=0; r<nrep; ++r) {
+      if( pd_weight[r]==0.0 ) continue;
+      const double rweight = pd_weight[r] / sum_weight;
+      const double* rforce = pd_recv.data() + r*stride + 1;
+      for(unsigned i=0; i<narg; ++i) ffict[i] += rweight*rforce[i];
     }
     // now, mean force is obtained.
   }
@@ -23,6 +23,7 @@
 #include "core/ActionRegister.h"
 #include "core/ActionSet.h"
 #include "PathProjectionCalculator.h"
+#include "tools/OpenMP.h"
 
 //+PLUMEDOC COLVAR GEOMETRIC_PATH
 /*
@@ -39,6 +40,8 @@ namespace mapping {
 class GeometricPath : public ActionWithVector {
 private:
   PathProjectionCalculator path_projector;
+/// The squared distances from each of the frames
+  std::vector<double> framedist;
 public:
   static void registerKeywords(Keywords& keys);
   explicit GeometricPath(const ActionOptions&);
@@ -84,12 +87,21 @@ void GeometricPath::calculate() {
   unsigned k=0, iclose1=0, iclose2=0; double v1v1=0, v3v3=0;
   unsigned nrows = getPntrToArgument(0)->getShape()[0];
   unsigned ncols = getPntrToArgument(0)->getShape()[1];
+  // Compute the squared distances from all the frames
+  if( framedist.size()!=nrows ) framedist.resize( nrows );
+  Value* disp = getPntrToArgument(0);
+  #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(framedist))
   for(unsigned i=0; i<nrows; ++i) {
     double dist = 0;
     for(unsigned j=0; j<ncols; ++j) {
-      double tmp = getPntrToArgument(0)->get(k);
-      dist += tmp*tmp; k++;
+      double tmp = disp->get(i*ncols+j);
+      dist += tmp*tmp;
     }
+    framedist[i] = dist;
+  }
+  // And find the two closest frames
+  for(unsigned i=0; i<nrows; ++i) {
+    double dist = framedist[i];
     if( i==0 ) { v1v1 = dist; iclose1 = 0; }
     else if( dist<v1v1 ) { v3v3=v1v1; v1v1=dist; iclose2=iclose1; iclose1=i; }
     else if( i==1 ) { v3v3=dist; iclose2=1; }
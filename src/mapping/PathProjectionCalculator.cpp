@@ -112,9 +112,31 @@ void PathProjectionCalculator::computeVectorBetweenFrames( const unsigned& ifrom
   metric.cmd("calc");
 }
 
+void PathProjectionCalculator::checkReferenceFrame( const unsigned& iframe ) {
+  unsigned nvals = data.size();
+  if( frame_version.size()!=getNumberOfFrames() ) {
+    refframes.resize( getNumberOfFrames()*nvals ); frame_version.assign( getNumberOfFrames(), 0 );
+    displace_cache.clear();
+  }
+  // The reference frames can be changed by other actions so they are compared with the copy that was used to compute the displacements
+  std::vector<double> refpos( nvals ); getReferenceConfiguration( iframe, refpos );
+  bool changed = frame_version[iframe]==0;
+  for(unsigned i=0; i<nvals; ++i) {
+    if( refframes[iframe*nvals+i]!=refpos[i] ) { refframes[iframe*nvals+i]=refpos[i]; changed=true; }
+  }
+  if( changed ) frame_version[iframe]++;
+}
+
 void PathProjectionCalculator::getDisplaceVector( const unsigned& ifrom, const unsigned& ito, std::vector<double>& displace ) {
   if( displace.size()!=data.size() ) displace.resize( data.size() );
-  computeVectorBetweenFrames( ifrom, ito ); for(unsigned i=0; i<data.size(); ++i) displace[i] = data[i];
+  checkReferenceFrame( ifrom ); checkReferenceFrame( ito );
+  // The displacement is only recomputed if one of the two frames has changed since it was last computed
+  CachedDisplacement& cached = displace_cache[std::pair<unsigned,unsigned>( ifrom, ito )];
+  if( cached.displace.size()!=data.size() || cached.from_version!=frame_version[ifrom] || cached.to_version!=frame_version[ito] ) {
+    computeVectorBetweenFrames( ifrom, ito ); cached.displace.assign( data.begin(), data.end() );
+    cached.from_version=frame_version[ifrom]; cached.to_version=frame_version[ito];
+  }
+  for(unsigned i=0; i<data.size(); ++i) displace[i] = cached.displace[i];
 }
 
 void PathProjectionCalculator::getReferenceConfiguration( const unsigned& iframe, std::vector<double>& refpos ) const {
@@ -26,6 +26,7 @@
 #include "core/PlumedMain.h"
 #include "tools/Keywords.h"
 #include "colvar/RMSDVector.h"
+#include <map>
 
 namespace PLMD {
 namespace mapping {
@@ -37,6 +38,18 @@ private:
   std::vector<double> data;
   std::vector<Value*> refargs;
   std::vector<colvar::RMSDVector*> rmsd_objects;
+/// The reference frames that were used to compute the cached displacements, stored one after the other
+  std::vector<double> refframes;
+/// This is incremented every time a reference frame changes
+  std::vector<unsigned> frame_version;
+/// The displacements between pairs of frames and the versions of the frames they were computed from
+  struct CachedDisplacement {
+    unsigned from_version, to_version;
+    std::vector<double> displace;
+  };
+  std::map<std::pair<unsigned,unsigned>,CachedDisplacement> displace_cache;
+/// Check if a reference frame has changed since the displacements were cached
+  void checkReferenceFrame( const unsigned& iframe );
 /// Compute the vector connecting two of the frames in the path
   void computeVectorBetweenFrames( const unsigned& ifrom, const unsigned& ito );
 public:
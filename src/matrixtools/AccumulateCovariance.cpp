@@ -0,0 +1,236 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2017-2019 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "core/ActionWithValue.h"
+#include "core/ActionWithArguments.h"
+#include "core/ActionPilot.h"
+#include "core/ActionRegister.h"
+#include "core/Checkpoint.h"
+#include "tools/Communicator.h"
+
+//+PLUMEDOC REWEIGHTING ACCUMULATE_COVARIANCE
+/*
+Accumulate the weighted mean and covariance matrix of a set of arguments over the course of the trajectory
+
+The mean and covariance are updated each time data is collected using the weighted version of Welford's algorithm.
+The cost of each update thus scales with the square of the number of arguments and the trajectory frames do not need to be stored
+as they would if you used \ref COLLECT_FRAMES and \ref COVARIANCE_MATRIX.  The weights are provided as logarithms using the LOGWEIGHTS keyword.
+If the WALKERS_MPI flag is used the accumulators from each of the replicas are merged before the output values are set so the
+mean and covariance that are output are computed from the data collected by all the replicas.
+
+The following input computes the covariance between three distances:
+
+\plumedfile
+d1: DISTANCE ATOMS=1,2
+d2: DISTANCE ATOMS=1,3
+d3: DISTANCE ATOMS=2,3
+cov: ACCUMULATE_COVARIANCE ARG=d1,d2,d3 STRIDE=10
+\endplumedfile
+
+*/
+//+ENDPLUMEDOC
+
+namespace PLMD {
+namespace matrixtools {
+
+class AccumulateCovariance :
+  public ActionWithValue,
+  public ActionWithArguments,
+  public ActionPilot
+{
+private:
+  bool clearnextstep, unormalized, walkers_mpi;
+  unsigned clearstride, ndata, nargs;
+/// The logarithm of the largest weight seen.  The weights are stored relative to this value to avoid overflows
+  double logwmax;
+/// The sum of the weights
+  double wsum;
+/// The running mean and the sum of the weighted products of the deviations from the mean
+  std::vector<double> mean, comoment, delta;
+/// Combine the accumulators from all the replicas
+  void mergeReplicas( double& logwtot, double& wtot, std::vector<double>& mtot, std::vector<double>& ctot );
+public:
+  static void registerKeywords( Keywords& keys );
+  AccumulateCovariance( const ActionOptions& );
+  unsigned getNumberOfDerivatives() override { return 0; }
+  bool calculateOnUpdate() override { return false; }
+  bool calculateConstantValues( const bool& /*have_atoms*/ ) override { return false; }
+  void calculate() override {}
+  void apply() override {}
+  void update() override ;
+  void writeCheckpoint( std::ostream& o ) override ;
+  void readCheckpoint( std::istream& i ) override ;
+};
+
+PLUMED_REGISTER_ACTION(AccumulateCovariance,"ACCUMULATE_COVARIANCE")
+
+void AccumulateCovariance::registerKeywords( Keywords& keys ) {
+  Action::registerKeywords( keys ); ActionWithValue::registerKeywords( keys );
+  ActionWithArguments::registerKeywords( keys ); ActionPilot::registerKeywords( keys );
+  keys.use("UPDATE_FROM"); keys.use("UPDATE_UNTIL");
+  keys.addInputKeyword("compulsory","ARG","scalar/vector","the values whose mean and covariance are being accumulated");
+  keys.addInputKeyword("optional","LOGWEIGHTS","scalar","the logarithm of the weight that should be ascribed to each data point");
+  keys.add("compulsory","STRIDE","1","the frequency with which the data should be collected and added to the accumulated covariance");
+  keys.add("compulsory","CLEAR","0","the frequency with which to clear all the accumulated data.  The default value "
+           "of 0 implies that all the data will be used and that the accumulators will never be cleared");
+  keys.addFlag("UNORMALIZED",false,"do not divide by the sum of the weights");
+  keys.addFlag("WALKERS_MPI",false,"merge the accumulated data from all the replicas of a multiple replica simulation");
+  keys.addOutputComponent("mean","default","vector","the weighted mean of the arguments");
+  keys.addOutputComponent("covar","default","matrix","the weighted covariance matrix of the arguments");
+}
+
+AccumulateCovariance::AccumulateCovariance( const ActionOptions& ao ):
+  Action(ao),
+  ActionWithValue(ao),
+  ActionWithArguments(ao),
+  ActionPilot(ao),
+  clearnextstep(true),
+  ndata(0),
+  nargs(getNumberOfArguments()),
+  logwmax(0),
+  wsum(0)
+{
+  for(unsigned i=0; i<nargs; ++i) {
+    if( getPntrToArgument(i)->isPeriodic() ) error("cannot accumulate the covariance of a periodic quantity");
+    if( getPntrToArgument(i)->hasDerivatives() && getPntrToArgument(i)->getRank()>0 ) error("cannot accumulate the covariance of a grid");
+    ndata += getPntrToArgument(i)->getNumberOfValues();
+  }
+  std::vector<Value*> wval; parseArgumentList("LOGWEIGHTS",wval);
+  if( wval.size()>1 ) error("keyword LOGWEIGHTS should be provided with the label of a single scalar");
+  if( wval.size()==1 ) {
+    if( wval[0]->getRank()!=0 ) error("keyword LOGWEIGHTS should be provided with the label of a single scalar");
+    log.printf("  weights are the exponentials of %s \n", wval[0]->getName().c_str() );
+    std::vector<Value*> myargs( getArguments() ); myargs.push_back( wval[0] ); requestArguments( myargs );
+  }
+  log.printf("  accumulating the covariance of %u quantities \n", ndata );
+
+  parse("CLEAR",clearstride);
+  if( clearstride>0 ) {
+    if( clearstride%getStride()!=0 ) error("CLEAR parameter must be a multiple of STRIDE");
+    log.printf("  clearing accumulated data every %u steps \n",clearstride);
+  }
+  parseFlag("UNORMALIZED",unormalized); if( unormalized ) log.printf("  covariance is not divided by the sum of the weights \n");
+  parseFlag("WALKERS_MPI",walkers_mpi); if( walkers_mpi ) log.printf("  merging data from all replicas \n");
+
+  mean.resize( ndata ); delta.resize( ndata ); comoment.resize( ndata*ndata );
+  std::vector<unsigned> shape(1); shape[0]=ndata;
+  addComponent( "mean", shape ); componentIsNotPeriodic("mean"); getPntrToComponent(0)->buildDataStore();
+  shape.resize(2); shape[1]=ndata;
+  addComponent( "covar", shape ); componentIsNotPeriodic("covar"); getPntrToComponent(1)->buildDataStore();
+  getPntrToComponent(1)->reshapeMatrixStore( ndata );
+}
+
+void AccumulateCovariance::update() {
+  if( clearnextstep ) {
+    clearnextstep=false; logwmax=0; wsum=0;
+    std::fill( mean.begin(), mean.end(), 0 ); std::fill( comoment.begin(), comoment.end(), 0 );
+  }
+  if( getStep()==0 ) return;
+
+  double logw=0; if( getNumberOfArguments()>nargs ) logw=getPntrToArgument(nargs)->get();
+  // Rescale everything if this weight is larger than all the weights seen so far
+  if( wsum==0 ) logwmax=logw;
+  else if( logw>logwmax ) {
+    double scale = std::exp( logwmax - logw ); wsum *= scale;
+    for(unsigned i=0; i<comoment.size(); ++i) comoment[i] *= scale;
+    logwmax=logw;
+  }
+  double w = std::exp( logw - logwmax ); wsum += w; double wfrac = w / wsum;
+
+  // Update the mean
+  unsigned k=0;
+  for(unsigned i=0; i<nargs; ++i) {
+    Value* myarg=getPntrToArgument(i); unsigned nv=myarg->getNumberOfValues();
+    for(unsigned j=0; j<nv; ++j) { delta[k] = myarg->get(j) - mean[k]; mean[k] += wfrac*delta[k]; k++; }
+  }
+  // And the lower triangle of the co-moment matrix using w*(x-old mean)*(x-new mean)
+  for(unsigned i=0; i<ndata; ++i) {
+    double wd = w*delta[i]*(1-wfrac);
+    for(unsigned j=0; j<=i; ++j) comoment[i*ndata+j] += wd*delta[j];
+  }
+
+  // Set the output values
+  Value* meanout=getPntrToComponent(0); Value* covout=getPntrToComponent(1);
+  if( walkers_mpi ) {
+    double logwtot, wtot; std::vector<double> mtot, ctot;
+    mergeReplicas( logwtot, wtot, mtot, ctot );
+    double norm = unormalized ? std::exp(logwtot) : 1.0 / wtot;
+    for(unsigned i=0; i<ndata; ++i) {
+      meanout->set( i, mtot[i] );
+      for(unsigned j=0; j<=i; ++j) { double cc = norm*ctot[i*ndata+j]; covout->set( i*ndata+j, cc ); covout->set( j*ndata+i, cc ); }
+    }
+  } else {
+    double norm = unormalized ? std::exp(logwmax) : 1.0 / wsum;
+    for(unsigned i=0; i<ndata; ++i) {
+      meanout->set( i, mean[i] );
+      for(unsigned j=0; j<=i; ++j) { double cc = norm*comoment[i*ndata+j]; covout->set( i*ndata+j, cc ); covout->set( j*ndata+i, cc ); }
+    }
+  }
+
+  // Clear if required
+  if( clearstride>0 && getStep()%clearstride==0 ) clearnextstep=true;
+}
+
+void AccumulateCovariance::writeCheckpoint( std::ostream& o ) {
+  checkpoint::write( o, clearnextstep ); checkpoint::write( o, logwmax ); checkpoint::write( o, wsum );
+  checkpoint::write( o, mean ); checkpoint::write( o, comoment );
+}
+
+void AccumulateCovariance::readCheckpoint( std::istream& i ) {
+  checkpoint::read( i, clearnextstep ); checkpoint::read( i, logwmax ); checkpoint::read( i, wsum );
+  checkpoint::read( i, mean ); checkpoint::read( i, comoment );
+  if( mean.size()!=ndata || comoment.size()!=ndata*ndata ) error("number of accumulated quantities in checkpoint does not match the input");
+}
+
+void AccumulateCovariance::mergeReplicas( double& logwtot, double& wtot, std::vector<double>& mtot, std::vector<double>& ctot ) {
+  // Pack the sum of the weights, the logarithm of the largest weight, the mean and the co-moment
+  unsigned nstore = 2 + ndata + ndata*ndata; std::vector<double> mydata( nstore );
+  mydata[0]=logwmax; mydata[1]=wsum;
+  for(unsigned i=0; i<ndata; ++i) mydata[2+i]=mean[i];
+  for(unsigned i=0; i<comoment.size(); ++i) mydata[2+ndata+i]=comoment[i];
+
+  unsigned nreplicas=0; if( comm.Get_rank()==0 ) nreplicas=multi_sim_comm.Get_size();
+  comm.Bcast( nreplicas, 0 ); std::vector<double> alldata( nreplicas*nstore );
+  if( comm.Get_rank()==0 ) multi_sim_comm.Allgather( mydata, alldata );
+  comm.Bcast( alldata, 0 );
+
+  // Combine the accumulators pairwise as described by Chan, Golub and LeVeque
+  logwtot=0; bool first=true; for(unsigned r=0; r<nreplicas; ++r) {
+    if( alldata[r*nstore+1]==0 ) continue;
+    if( first || alldata[r*nstore]>logwtot ) logwtot=alldata[r*nstore];
+    first=false;
+  }
+  wtot=0; mtot.assign( ndata, 0 ); ctot.assign( ndata*ndata, 0 );
+  for(unsigned r=0; r<nreplicas; ++r) {
+    const double* rdata = alldata.data() + r*nstore; if( rdata[1]==0 ) continue;
+    double scale = std::exp( rdata[0] - logwtot ), wr = scale*rdata[1], wnew = wtot + wr, fac = wtot*wr / wnew;
+    for(unsigned i=0; i<ndata; ++i) delta[i] = rdata[2+i] - mtot[i];
+    for(unsigned i=0; i<ndata; ++i) {
+      for(unsigned j=0; j<=i; ++j) ctot[i*ndata+j] += scale*rdata[2+ndata+i*ndata+j] + fac*delta[i]*delta[j];
+      mtot[i] += (wr/wnew)*delta[i];
+    }
+    wtot = wnew;
+  }
+  if( wtot==0 ) wtot=1;
+}
+
+}
+}
@@ -26,6 +26,10 @@
 /*
 Calculate a covariance matix
 
+By default the covariance is computed from the data points that have been stored by a \ref COLLECT_FRAMES action.  If the ONLINE flag is used
+the arguments should instead be the quantities that are calculated on each step.  The weighted mean and covariance of these quantities are then accumulated
+as the trajectory proceeds by an \ref ACCUMULATE_COVARIANCE action so the memory required does not grow with the length of the trajectory.
+
 \par Examples
 
 */
@@ -45,11 +49,17 @@ PLUMED_REGISTER_ACTION(CovarianceMatrix,"COVARIANCE_MATRIX")
 void CovarianceMatrix::registerKeywords(Keywords& keys ) {
   ActionShortcut::registerKeywords( keys );
   keys.add("numbered","ARG","the vectors of data from which we are calculating the covariance");
-  keys.add("compulsory","WEIGHTS","this keyword takes the label of an action that calculates a vector of values.  The elements of this vector "
+  keys.add("optional","WEIGHTS","this keyword takes the label of an action that calculates a vector of values.  The elements of this vector "
            "are used as weights for the input data points.");
   keys.addFlag("UNORMALIZED",false,"do not divide by the sum of the weights");
+  keys.addFlag("ONLINE",false,"accumulate the covariance of the arguments over the trajectory rather than computing it from stored data");
+  keys.add("optional","LOGWEIGHTS","the logarithm of the weights to use for each data point when the ONLINE flag is used");
+  keys.add("compulsory","STRIDE","1","the frequency with which data is added to the covariance when the ONLINE flag is used");
+  keys.add("compulsory","CLEAR","0","the frequency with which to clear the accumulated covariance when the ONLINE flag is used");
+  keys.addFlag("WALKERS_MPI",false,"merge the data accumulated by all the replicas when the ONLINE flag is used");
   keys.setValueDescription("matrix","the covariance matrix");
   keys.needsAction("SUM"); keys.needsAction("CUSTOM"); keys.needsAction("VSTACK"); keys.needsAction("TRANSPOSE");
+  keys.needsAction("ACCUMULATE_COVARIANCE");
   keys.needsAction("ONES"); keys.needsAction("OUTER_PRODUCT"); keys.needsAction("MATRIX_PRODUCT");
 }
 
@@ -61,7 +71,19 @@ CovarianceMatrix::CovarianceMatrix(const ActionOptions&ao):
   unsigned nargs=args.size(); std::string argstr="ARG=" + args[0];
   for(unsigned i=1; i<args.size(); ++i) argstr += "," + args[i];
 
-  bool unorm; parseFlag("UNORMALIZED",unorm); std::string wstr; parse("WEIGHTS",wstr);
+  bool unorm; parseFlag("UNORMALIZED",unorm); bool online; parseFlag("ONLINE",online);
+  if( online ) {
+    std::string lw, stride, clearstride; parse("LOGWEIGHTS",lw); parse("STRIDE",stride); parse("CLEAR",clearstride);
+    if( lw.length()>0 ) lw = " LOGWEIGHTS=" + lw;
+    bool walkers_mpi; parseFlag("WALKERS_MPI",walkers_mpi); std::string flags;
+    if( unorm ) flags += " UNORMALIZED";
+    if( walkers_mpi ) flags += " WALKERS_MPI";
+    readInputLine( getShortcutLabel() + "_acc: ACCUMULATE_COVARIANCE " + argstr + lw + " STRIDE=" + stride + " CLEAR=" + clearstride + flags );
+    readInputLine( getShortcutLabel() + ": CUSTOM ARG=" + getShortcutLabel() + "_acc.covar FUNC=x PERIODIC=NO");
+    return;
+  }
+  std::string wstr; parse("WEIGHTS",wstr);
+  if( wstr.length()==0 ) error("WEIGHTS should be specified if you are not using the ONLINE flag");
   if( !unorm ) {
     // Normalize the weights
     readInputLine( getShortcutLabel() + "_wsum: SUM ARG=" + wstr + " PERIODIC=NO");
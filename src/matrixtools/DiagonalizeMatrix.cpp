@@ -21,11 +21,21 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "MatrixOperationBase.h"
 #include "core/ActionRegister.h"
+#include "tools/Random.h"
 
 //+PLUMEDOC ANALYSIS DIAGONALIZE
 /*
 Calculate the eigenvalues and eigenvectors of a square matrix
 
+By default the full set of eigenvalues and eigenvectors is computed using LAPACK.  If you only need a few of the
+largest eigenvalues and eigenvectors of a large and sparse matrix you can use the LOBPCG flag.  The required eigenpairs are then
+found using the locally optimal block preconditioned conjugate gradient method, which only requires products of the
+matrix with a small block of vectors.  The cost of each iteration thus scales with the number of non-zero elements in
+the matrix rather than as the cube of the number of rows.  The eigenvectors found on one step are used as the starting
+guess on the next step so only a few iterations are usually needed.  Forces on the eigenvector with the largest eigenvalue
+are propagated back to the matrix by solving a linear system with the conjugate gradient method.  If forces act on any of the other
+eigenvectors, or if either method does not converge, the full decomposition is computed instead.
+
 \par Examples
 
 */
@@ -40,6 +50,27 @@ private:
   Matrix<double> mymatrix;
   std::vector<double> eigvals;
   Matrix<double> eigvecs;
+/// Are we using LOBPCG to find the eigenvectors, the tolerance and the maximum number of iterations
+  bool lobpcg; double lobpcg_tol; unsigned lobpcg_maxiter;
+/// Does eigvecs contain the full decomposition of the current matrix
+  bool fullsolve;
+/// The eigenvalues and eigenvectors found with LOBPCG in descending order of eigenvalue.  Eigenvectors are the rows of bvecs
+  std::vector<double> bvals;
+  Matrix<double> bvecs, bavecs, resid, pdirs, basis, abasis;
+/// The vectors (lambda I - A)^+ g for the forces g on the eigenvectors when the full decomposition is not available
+  Matrix<double> vecforces;
+/// Multiply the first nv rows of x by the input matrix
+  void multiplyByMatrix( const unsigned& nv, const Matrix<double>& x, Matrix<double>& ax ) const ;
+/// Orthonormalize the rows of a matrix with Gram-Schmidt, rows that are linearly dependent are removed and the number of rows kept is returned
+  static unsigned orthonormalize( Matrix<double>& vecs, const unsigned& nv, const unsigned& naccepted );
+/// Do the Rayleigh-Ritz procedure in the space spanned by the first nb rows of basis
+  void rayleighRitz( const unsigned& nb );
+/// Find the required eigenpairs with LOBPCG
+  bool solvePartial();
+/// Compute all the eigenpairs with LAPACK
+  void solveFull();
+/// Solve (lambda I - A) y = g for the force g on the largest eigenvector with conjugate gradients
+  bool solveVectorForce( const unsigned& i );
 public:
   static void registerKeywords( Keywords& keys );
 /// Constructor
@@ -52,6 +83,8 @@ public:
   void calculate() override ;
 ///
   double getForceOnMatrixElement( const unsigned& jrow, const unsigned& krow ) const override;
+///
+  void apply() override ;
 };
 
 PLUMED_REGISTER_ACTION(DiagonalizeMatrix,"DIAGONALIZE")
@@ -59,13 +92,17 @@ PLUMED_REGISTER_ACTION(DiagonalizeMatrix,"DIAGONALIZE")
 void DiagonalizeMatrix::registerKeywords( Keywords& keys ) {
   MatrixOperationBase::registerKeywords( keys );
   keys.add("compulsory","VECTORS","all","the eigenvalues and vectors that you would like to calculate.  1=largest, 2=second largest and so on");
+  keys.addFlag("LOBPCG",false,"find the eigenvalues and vectors with the iterative LOBPCG method rather than by computing the full decomposition");
+  keys.add("compulsory","LOBPCG_TOL","1e-10","the tolerance on the norm of the residual relative to the magnitude of the eigenvalue");
+  keys.add("compulsory","LOBPCG_MAXITER","1000","the maximum number of LOBPCG iterations.  The full decomposition is computed if the method has not converged after this many iterations");
   keys.addOutputComponent("vals","default","scalar","the eigevalues of the input matrix");
   keys.addOutputComponent("vecs","default","vector","the eigenvectors of the input matrix");
 }
 
 DiagonalizeMatrix::DiagonalizeMatrix(const ActionOptions& ao):
   Action(ao),
-  MatrixOperationBase(ao)
+  MatrixOperationBase(ao),
+  fullsolve(true)
 {
   if( getPntrToArgument(0)->getShape()[0]!=getPntrToArgument(0)->getShape()[1] ) error("input matrix should be square");
 
@@ -95,8 +132,15 @@ DiagonalizeMatrix::DiagonalizeMatrix(const ActionOptions& ao):
     getPntrToComponent( 2*i+1 )->buildDataStore();
   }
 
-  std::vector<unsigned> eigvecs_shape(2); eigvecs_shape[0]=eigvecs_shape[1]=getPntrToArgument(0)->getShape()[0];
-  mymatrix.resize( eigvecs_shape[0], eigvecs_shape[1] ); eigvals.resize( eigvecs_shape[0] ); eigvecs.resize( eigvecs_shape[0], eigvecs_shape[1] );
+  parseFlag("LOBPCG",lobpcg);
+  if( lobpcg ) {
+    parse("LOBPCG_TOL",lobpcg_tol); parse("LOBPCG_MAXITER",lobpcg_maxiter);
+    log.printf("  eigenpairs are found using LOBPCG with tolerance %g and at most %u iterations\n", lobpcg_tol, lobpcg_maxiter );
+  } else {
+    // The full matrices are only allocated here when they will certainly be needed
+    std::vector<unsigned> eigvecs_shape(2); eigvecs_shape[0]=eigvecs_shape[1]=getPntrToArgument(0)->getShape()[0];
+    mymatrix.resize( eigvecs_shape[0], eigvecs_shape[1] ); eigvals.resize( eigvecs_shape[0] ); eigvecs.resize( eigvecs_shape[0], eigvecs_shape[1] );
+  }
 }
 
 void DiagonalizeMatrix::prepare() {
@@ -107,26 +151,194 @@ void DiagonalizeMatrix::prepare() {
 
 }
 
-void DiagonalizeMatrix::calculate() {
-  if( getPntrToArgument(0)->getShape()[0]==0 ) return ;
+void DiagonalizeMatrix::solveFull() {
   // Resize stuff that might need resizing
   unsigned nvals=getPntrToArgument(0)->getShape()[0];
   if( eigvals.size()!=nvals ) { mymatrix.resize( nvals, nvals ); eigvals.resize( nvals ); eigvecs.resize( nvals, nvals ); }
-
   // Retrieve the matrix from input
   retrieveFullMatrix( mymatrix );
   // Now diagonalize the matrix
-  diagMat( mymatrix, eigvals, eigvecs );
+  diagMat( mymatrix, eigvals, eigvecs ); fullsolve=true;
+  // Make the signs of the eigenvectors consistent with those found by LOBPCG.  In apply this ensures the
+  // forces are computed for the same eigenvectors that were output in calculate
+  if( lobpcg && bvecs.ncols()==nvals ) {
+    for(unsigned k=0; k<bvecs.nrows(); ++k) {
+      unsigned vreq = nvals-1-k; double dot=0;
+      for(unsigned j=0; j<nvals; ++j) dot += eigvecs(vreq,j)*bvecs(k,j);
+      if( dot<0 ) for(unsigned j=0; j<nvals; ++j) eigvecs(vreq,j) = -eigvecs(vreq,j);
+    }
+  }
+}
+
+void DiagonalizeMatrix::calculate() {
+  if( getPntrToArgument(0)->getShape()[0]==0 ) return ;
+  if( lobpcg && solvePartial() ) {
+    fullsolve=false;
+    for(unsigned i=0; i<desired_vectors.size(); ++i) {
+      getPntrToComponent(2*i)->set( bvals[desired_vectors[i]-1] );
+      Value* evec_out = getPntrToComponent(2*i+1); unsigned vreq = desired_vectors[i]-1;
+      for(unsigned j=0; j<bvecs.ncols(); ++j) evec_out->set( j, bvecs( vreq, j ) );
+    }
+    return;
+  }
+  solveFull();
   // And set the eigenvalues and eigenvectors
   for(unsigned i=0; i<desired_vectors.size(); ++i) {
     getPntrToComponent(2*i)->set( eigvals[ mymatrix.ncols()-desired_vectors[i]] );
     Value* evec_out = getPntrToComponent(2*i+1); unsigned vreq = mymatrix.ncols()-desired_vectors[i];
     for(unsigned j=0; j<mymatrix.ncols(); ++j) evec_out->set( j, eigvecs( vreq, j ) );
   }
+  // Store the eigenvectors so they can be used as the starting guess for LOBPCG on the next step
+  if( lobpcg && bvecs.ncols()==mymatrix.ncols() ) {
+    for(unsigned i=0; i<bvecs.nrows(); ++i) for(unsigned j=0; j<bvecs.ncols(); ++j) bvecs(i,j) = eigvecs( mymatrix.ncols()-1-i, j );
+  }
+}
+
+void DiagonalizeMatrix::multiplyByMatrix( const unsigned& nv, const Matrix<double>& x, Matrix<double>& ax ) const {
+  const Value* mat = getPntrToArgument(0); unsigned n=mat->getShape()[0], ncols=mat->getNumberOfColumns();
+  bool symmetric = mat->isSymmetric();
+  for(unsigned k=0; k<nv; ++k) for(unsigned i=0; i<n; ++i) ax(k,i)=0;
+  for(unsigned i=0; i<n; ++i) {
+    unsigned nrow = mat->getRowLength(i);
+    for(unsigned j=0; j<nrow; ++j) {
+      double aij = mat->get( i*ncols+j, false ); if( fabs(aij)<epsilon ) continue;
+      unsigned jcol = mat->getRowIndex(i,j);
+      // Only the lower triangle of symmetric matrices is used as is done in retrieveFullMatrix
+      if( symmetric && jcol>i ) continue;
+      for(unsigned k=0; k<nv; ++k) ax(k,i) += aij*x(k,jcol);
+      if( symmetric && jcol!=i ) for(unsigned k=0; k<nv; ++k) ax(k,jcol) += aij*x(k,i);
+    }
+  }
+}
+
+unsigned DiagonalizeMatrix::orthonormalize( Matrix<double>& vecs, const unsigned& nv, const unsigned& naccepted ) {
+  unsigned nacc=naccepted, n=vecs.ncols();
+  for(unsigned k=naccepted; k<nv; ++k) {
+    double norm0=0; for(unsigned i=0; i<n; ++i) norm0 += vecs(k,i)*vecs(k,i);
+    // Gram-Schmidt is done twice for numerical stability
+    for(unsigned pass=0; pass<2; ++pass) {
+      for(unsigned l=0; l<nacc; ++l) {
+        double dot=0; for(unsigned i=0; i<n; ++i) dot += vecs(k,i)*vecs(l,i);
+        for(unsigned i=0; i<n; ++i) vecs(k,i) -= dot*vecs(l,i);
+      }
+    }
+    double norm=0; for(unsigned i=0; i<n; ++i) norm += vecs(k,i)*vecs(k,i);
+    if( norm0==0 || norm<1e-16*norm0 ) continue;
+    norm = 1.0 / sqrt(norm);
+    for(unsigned i=0; i<n; ++i) vecs(nacc,i) = norm*vecs(k,i);
+    nacc++;
+  }
+  return nacc;
+}
+
+void DiagonalizeMatrix::rayleighRitz( const unsigned& nb ) {
+  unsigned n=basis.ncols(), p=bvecs.nrows();
+  Matrix<double> hmat( nb, nb ), hvecs( nb, nb ); std::vector<double> hvals( nb );
+  for(unsigned k=0; k<nb; ++k) for(unsigned l=0; l<=k; ++l) {
+      double dot=0; for(unsigned i=0; i<n; ++i) dot += basis(k,i)*abasis(l,i);
+      hmat(k,l)=hmat(l,k)=dot;
+    }
+  diagMat( hmat, hvals, hvecs );
+  // The largest Ritz values are stored in descending order
+  for(unsigned k=0; k<p; ++k) {
+    unsigned kk=nb-1-k; bvals[k]=hvals[kk];
+    for(unsigned i=0; i<n; ++i) {
+      double x=0, ax=0, pd=0;
+      for(unsigned l=0; l<nb; ++l) { x += hvecs(kk,l)*basis(l,i); ax += hvecs(kk,l)*abasis(l,i); }
+      // The search direction is the part of the new vector that is not in the span of the old vectors
+      for(unsigned l=p; l<nb; ++l) pd += hvecs(kk,l)*basis(l,i);
+      bvecs(k,i)=x; bavecs(k,i)=ax; pdirs(k,i)=pd;
+    }
+  }
+}
+
+bool DiagonalizeMatrix::solvePartial() {
+  unsigned n=getPntrToArgument(0)->getShape()[0], nwant=0;
+  for(unsigned i=0; i<desired_vectors.size(); ++i) if( desired_vectors[i]>nwant ) nwant=desired_vectors[i];
+  // A few extra vectors in the block help convergence and ensure degenerate eigenvalues are found
+  unsigned p = nwant + std::max( 3u, nwant );
+  if( 3*p>=n ) return false;
+  if( bvecs.nrows()!=p || bvecs.ncols()!=n ) {
+    // The starting guess is random on the first step.  The random number generator is seeded so all ranks get the same guess
+    bvecs.resize( p, n ); bavecs.resize( p, n ); resid.resize( p, n ); pdirs.resize( p, n );
+    basis.resize( 3*p, n ); abasis.resize( 3*p, n ); bvals.resize( p );
+    Random rnd; rnd.setSeed(-1);
+    for(unsigned k=0; k<p; ++k) for(unsigned i=0; i<n; ++i) bvecs(k,i)=rnd.RandU01()-0.5;
+  }
+  // Rayleigh-Ritz in the space of the starting vectors
+  for(unsigned k=0; k<p; ++k) for(unsigned i=0; i<n; ++i) basis(k,i)=bvecs(k,i);
+  unsigned nb=orthonormalize( basis, p, 0 ); if( nb<p ) return false;
+  multiplyByMatrix( nb, basis, abasis ); rayleighRitz( nb );
+  bool haspdirs=false;
+  for(unsigned iter=0; iter<lobpcg_maxiter; ++iter) {
+    // Compute the residuals and check for convergence of the eigenpairs that are required
+    bool converged=true;
+    for(unsigned k=0; k<p; ++k) {
+      double rnorm=0;
+      for(unsigned i=0; i<n; ++i) { resid(k,i) = bavecs(k,i) - bvals[k]*bvecs(k,i); rnorm += resid(k,i)*resid(k,i); }
+      if( k<nwant && sqrt(rnorm)>lobpcg_tol*std::max(1.0,fabs(bvals[k])) ) converged=false;
+    }
+    if( converged ) return true;
+    // Build the basis from the current vectors, the residuals and the previous search directions
+    nb=p;
+    for(unsigned k=0; k<p; ++k) for(unsigned i=0; i<n; ++i) { basis(k,i)=bvecs(k,i); basis(p+k,i)=resid(k,i); }
+    if( haspdirs ) for(unsigned k=0; k<p; ++k) for(unsigned i=0; i<n; ++i) basis(2*p+k,i)=pdirs(k,i);
+    nb = orthonormalize( basis, haspdirs ? 3*p : 2*p, 0 );
+    if( nb<p ) return false;
+    multiplyByMatrix( nb, basis, abasis ); rayleighRitz( nb ); haspdirs=true;
+  }
+  return false;
+}
+
+bool DiagonalizeMatrix::solveVectorForce( const unsigned& i ) {
+  // Only the largest eigenvalue gives a system that is positive definite in the space orthogonal to the eigenvector
+  if( desired_vectors[i]!=1 ) return false;
+  const Value* evec = getConstPntrToComponent(2*i+1); unsigned n=bvecs.ncols(); double lambda=bvals[0];
+  if( vecforces.nrows()!=desired_vectors.size() || vecforces.ncols()!=n ) vecforces.resize( desired_vectors.size(), n );
+  // The right hand side is the force with the component along the eigenvector removed
+  std::vector<double> res( n ); Matrix<double> dir( 1, n ), adir( 1, n ); double gdot=0;
+  for(unsigned j=0; j<n; ++j) { res[j]=evec->getForce(j); gdot += res[j]*bvecs(0,j); }
+  double rr=0; for(unsigned j=0; j<n; ++j) { res[j] -= gdot*bvecs(0,j); dir(0,j)=res[j]; rr += res[j]*res[j]; vecforces(i,j)=0; }
+  const double rr0=rr; if( rr0==0 ) return true;
+  for(unsigned iter=0; iter<lobpcg_maxiter; ++iter) {
+    multiplyByMatrix( 1, dir, adir ); double vdot=0;
+    for(unsigned j=0; j<n; ++j) { adir(0,j) = lambda*dir(0,j) - adir(0,j); vdot += adir(0,j)*bvecs(0,j); }
+    double pap=0; for(unsigned j=0; j<n; ++j) { adir(0,j) -= vdot*bvecs(0,j); pap += dir(0,j)*adir(0,j); }
+    if( pap<=0 ) return false;
+    double alpha=rr/pap, rrnew=0;
+    for(unsigned j=0; j<n; ++j) { vecforces(i,j) += alpha*dir(0,j); res[j] -= alpha*adir(0,j); rrnew += res[j]*res[j]; }
+    if( rrnew<=lobpcg_tol*lobpcg_tol*rr0 ) return true;
+    double beta=rrnew/rr; rr=rrnew;
+    for(unsigned j=0; j<n; ++j) dir(0,j) = res[j] + beta*dir(0,j);
+  }
+  return false;
+}
+
+void DiagonalizeMatrix::apply() {
+  if( doNotCalculateDerivatives() ) return;
+  // Forces on the eigenvectors other than the largest one need all the eigenvalues and eigenvectors
+  if( !fullsolve ) {
+    for(unsigned i=0; i<desired_vectors.size(); ++i) {
+      if( getPntrToComponent(2*i+1)->forcesWereAdded() && !solveVectorForce(i) ) { solveFull(); break; }
+    }
+  }
+  MatrixOperationBase::apply();
 }
 
 double DiagonalizeMatrix::getForceOnMatrixElement( const unsigned& jrow, const unsigned& kcol ) const {
   double ff = 0;
+  if( !fullsolve ) {
+    for(unsigned i=0; i<desired_vectors.size(); ++i) {
+      if( !getConstPntrToComponent(2*i)->forcesWereAdded() ) continue;
+      unsigned k = desired_vectors[i]-1;
+      ff += getConstPntrToComponent(2*i)->getForce(0)*bvecs(k,jrow)*bvecs(k,kcol);
+    }
+    // This is the sum over the other eigenvectors in the perturbation expression below
+    for(unsigned i=0; i<desired_vectors.size(); ++i) {
+      if( getConstPntrToComponent(2*i+1)->forcesWereAdded() ) ff += vecforces(i,jrow)*bvecs(desired_vectors[i]-1,kcol);
+    }
+    return ff;
+  }
   for(unsigned i=0; i<desired_vectors.size(); ++i) {
     // Deal with forces on eigenvalues
     if( getConstPntrToComponent(2*i)->forcesWereAdded() ) {
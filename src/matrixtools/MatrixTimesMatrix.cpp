@@ -21,11 +21,16 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "core/ActionWithMatrix.h"
 #include "core/ActionRegister.h"
+#include "blas/blas.h"
+#include <algorithm>
 
 //+PLUMEDOC MCOLVAR MATRIX_PRODUCT
 /*
 Calculate the product of two matrices
 
+If both input matrices are stored densely and the product is not used in a chain of matrix operations, the product and the forces on the
+input matrices are computed with calls to the BLAS routine dgemm.  An optimized BLAS library will thus be used if PLUMED was linked against one.
+
 \par Examples
 
 */
@@ -48,13 +53,31 @@ private:
   bool squared;
   unsigned nderivatives;
   bool stored_matrix1, stored_matrix2;
+/// Is the second matrix sparse and stored in the csr arrays below
+  bool usecsr;
+/// The second matrix in compressed sparse row format
+  std::vector<unsigned> csr_starts, csr_cols;
+  std::vector<double> csr_vals;
+/// Was the product computed with dgemm on the last step
+  bool usegemm;
+/// Dense row major copies of the two input matrices and workspace for the product
+  std::vector<double> gemm_a, gemm_b, gemm_c;
+/// Check if both input matrices are stored densely so the product can be computed with dgemm
+  bool canUseGemm() const ;
+/// Copy a dense input matrix into a row major array
+  void getDenseArgument( const unsigned& iarg, std::vector<double>& mat ) const ;
+/// Get an element of the second matrix
+  double getElementOfSecondMatrix( const unsigned& irow, const unsigned& jcol, const MultiValue& myvals ) const ;
 public:
   static void registerKeywords( Keywords& keys );
   explicit MatrixTimesMatrix(const ActionOptions&);
   void prepare() override ;
+  void calculate() override ;
+  void apply() override ;
   unsigned getNumberOfDerivatives();
   unsigned getNumberOfColumns() const override { return getConstPntrToComponent(0)->getShape()[1]; }
   void getAdditionalTasksRequired( ActionWithVector* action, std::vector<unsigned>& atasks ) override ;
+  void updateNeighbourList() override ;
   void setupForTask( const unsigned& task_index, std::vector<unsigned>& indices, MultiValue& myvals ) const ;
   void performTask( const std::string& controller, const unsigned& index1, const unsigned& index2, MultiValue& myvals ) const override;
   void runEndOfRowJobs( const unsigned& ival, const std::vector<unsigned> & indices, MultiValue& myvals ) const override ;
@@ -72,7 +95,9 @@ void MatrixTimesMatrix::registerKeywords( Keywords& keys ) {
 
 MatrixTimesMatrix::MatrixTimesMatrix(const ActionOptions&ao):
   Action(ao),
-  ActionWithMatrix(ao)
+  ActionWithMatrix(ao),
+  usecsr(false),
+  usegemm(false)
 {
   if( getNumberOfArguments()!=2 ) error("should be two arguments to this action, a matrix and a vector");
   if( getPntrToArgument(0)->getRank()!=2 || getPntrToArgument(0)->hasDerivatives() ) error("first argument to this action should be a matrix");
@@ -94,12 +119,55 @@ unsigned MatrixTimesMatrix::getNumberOfDerivatives() {
 }
 
 void MatrixTimesMatrix::prepare() {
-  Value* myval = getPntrToComponent(0);
+  ActionWithVector::prepare(); Value* myval = getPntrToComponent(0);
   if( myval->getShape()[0]==getPntrToArgument(0)->getShape()[0] && myval->getShape()[1]==getPntrToArgument(1)->getShape()[1] ) return;
   std::vector<unsigned> shape(2); shape[0]=getPntrToArgument(0)->getShape()[0]; shape[1]=getPntrToArgument(1)->getShape()[1];
   myval->setShape(shape); if( myval->valueIsStored() ) myval->reshapeMatrixStore( shape[1] );
 }
 
+bool MatrixTimesMatrix::canUseGemm() const {
+  if( getName()!="MATRIX_PRODUCT" || actionInChain() || chainContinues() || !getConstPntrToComponent(0)->valueIsStored() ) return false;
+  for(unsigned i=0; i<2; ++i) {
+    const Value* myarg = getPntrToArgument(i);
+    if( !myarg->valueHasBeenSet() || myarg->getNumberOfColumns()<myarg->getShape()[1] ) return false;
+  }
+  return true;
+}
+
+void MatrixTimesMatrix::getDenseArgument( const unsigned& iarg, std::vector<double>& mat ) const {
+  const Value* myarg = getPntrToArgument(iarg); unsigned nvals = myarg->getShape()[0]*myarg->getShape()[1];
+  if( mat.size()!=nvals ) mat.resize( nvals );
+  for(unsigned i=0; i<nvals; ++i) mat[i] = myarg->get( i, false );
+}
+
+void MatrixTimesMatrix::calculate() {
+  usegemm = canUseGemm();
+  if( !usegemm ) { ActionWithMatrix::calculate(); return; }
+  // Both matrices are dense so the product is computed with a single call to dgemm.  A row major matrix is the transpose of a column major one
+  // so we compute C^T = B^T A^T in column major order to get C in row major order
+  int n = getPntrToArgument(0)->getShape()[0], k = getPntrToArgument(0)->getShape()[1], m = getPntrToArgument(1)->getShape()[1];
+  getDenseArgument( 0, gemm_a ); getDenseArgument( 1, gemm_b ); gemm_c.resize( n*m );
+  double one=1.0, zero=0.0;
+  if( n>0 && m>0 && k>0 ) plumed_blas_dgemm( "N", "N", &m, &n, &k, &one, gemm_b.data(), &m, gemm_a.data(), &k, &zero, gemm_c.data(), &m );
+  else std::fill( gemm_c.begin(), gemm_c.end(), 0.0 );
+  Value* myval = getPntrToComponent(0);
+  for(unsigned i=0; i<gemm_c.size(); ++i) myval->set( i, gemm_c[i] );
+}
+
+void MatrixTimesMatrix::apply() {
+  if( !usegemm ) { ActionWithMatrix::apply(); return; }
+  if( doNotCalculateDerivatives() || !getPntrToComponent(0)->forcesWereAdded() ) return;
+  // The forces on the output are G so the forces on the inputs are G B^T and A^T G.  These are computed in column major order as above
+  int n = getPntrToArgument(0)->getShape()[0], k = getPntrToArgument(0)->getShape()[1], m = getPntrToArgument(1)->getShape()[1];
+  if( n==0 || m==0 || k==0 ) return;
+  Value* myval = getPntrToComponent(0); for(unsigned i=0; i<gemm_c.size(); ++i) gemm_c[i] = myval->getForce(i);
+  std::vector<double> forcea( n*k ), forceb( k*m ); double one=1.0, zero=0.0;
+  plumed_blas_dgemm( "T", "N", &k, &n, &m, &one, gemm_b.data(), &m, gemm_c.data(), &m, &zero, forcea.data(), &k );
+  plumed_blas_dgemm( "N", "T", &m, &k, &n, &one, gemm_c.data(), &m, gemm_a.data(), &k, &zero, forceb.data(), &m );
+  for(unsigned i=0; i<forcea.size(); ++i) getPntrToArgument(0)->addForce( i, forcea[i], false );
+  for(unsigned i=0; i<forceb.size(); ++i) getPntrToArgument(1)->addForce( i, forceb[i], false );
+}
+
 void MatrixTimesMatrix::getAdditionalTasksRequired( ActionWithVector* action, std::vector<unsigned>& atasks ) {
 
   ActionWithMatrix* adj=dynamic_cast<ActionWithMatrix*>( getPntrToArgument(0)->getPntrToAction() );
@@ -107,6 +175,21 @@ void MatrixTimesMatrix::getAdditionalTasksRequired( ActionWithVector* action, st
   adj->retrieveAtoms(); adj->getAdditionalTasksRequired( action, atasks );
 }
 
+void MatrixTimesMatrix::updateNeighbourList() {
+  // If the second matrix is stored sparsely we copy it into csr format so that elements can be found by a binary search
+  Value* mat2 = getPntrToArgument(1);
+  usecsr = !stored_matrix2 && mat2->valueHasBeenSet() && mat2->getNumberOfColumns()>0 && mat2->getNumberOfColumns()<mat2->getShape()[1];
+  if( usecsr ) mat2->retrieveCSR( csr_starts, csr_cols, csr_vals );
+}
+
+double MatrixTimesMatrix::getElementOfSecondMatrix( const unsigned& irow, const unsigned& jcol, const MultiValue& myvals ) const {
+  if( !usecsr ) return getElementOfMatrixArgument( 1, irow, jcol, myvals );
+  std::vector<unsigned>::const_iterator start=csr_cols.begin()+csr_starts[irow], end=csr_cols.begin()+csr_starts[irow+1];
+  std::vector<unsigned>::const_iterator pos=std::lower_bound( start, end, jcol );
+  if( pos==end || *pos!=jcol ) return 0.0;
+  return csr_vals[ pos - csr_cols.begin() ];
+}
+
 void MatrixTimesMatrix::setupForTask( const unsigned& task_index, std::vector<unsigned>& indices, MultiValue& myvals ) const {
   unsigned start_n = getPntrToArgument(0)->getShape()[0], size_v = getPntrToArgument(1)->getShape()[1];
   if( indices.size()!=size_v+1 ) indices.resize( size_v+1 );
@@ -123,8 +206,9 @@ void MatrixTimesMatrix::performTask( const std::string& controller, const unsign
   std::vector<double>  dvec1(nmult), dvec2(nmult);
   for(unsigned i=0; i<nmult; ++i) {
     unsigned kind = myarg->getRowIndex( index1, i );
-    double val1 = getElementOfMatrixArgument( 0, index1, kind, myvals );
-    double val2 = getElementOfMatrixArgument( 1, kind, ind2, myvals );
+    // The position of the element in the row is known so we do not search for it when the first matrix is stored
+    double val1 = ( myarg->valueHasBeenSet() && myarg->getNumberOfColumns()>0 ) ? myarg->get( index1*myarg->getNumberOfColumns() + i, false ) : getElementOfMatrixArgument( 0, index1, kind, myvals );
+    double val2 = getElementOfSecondMatrix( kind, ind2, myvals );
     if( getName()=="DISSIMILARITIES" ) {
       double tmp = getPntrToArgument(0)->difference(val2, val1); matval += tmp*tmp;
       if( !squared ) {
@@ -21,11 +21,15 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "core/ActionWithMatrix.h"
 #include "core/ActionRegister.h"
+#include "blas/blas.h"
 
 //+PLUMEDOC MCOLVAR MATRIX_VECTOR_PRODUCT
 /*
 Calculate the product of the matrix and the vector
 
+If the input matrix and vectors are stored densely and the product is not used in a chain of matrix operations, the products and the forces on the
+inputs are computed with calls to the BLAS routine dgemv.
+
 \par Examples
 
 */
@@ -39,6 +43,16 @@ private:
   bool sumrows;
   unsigned nderivatives;
   std::vector<bool> stored_arg;
+/// Were the products computed with dgemv on the last step
+  bool usegemv;
+/// Dense row major copy of the input matrix and workspace for the vectors
+  std::vector<double> gemv_mat, gemv_vec, gemv_out;
+/// Get the index of the matrix and the vector that are multiplied to get component ic
+  void getProductArguments( const unsigned& ic, unsigned& imat, unsigned& ivec ) const ;
+/// Check if all the inputs are stored densely so the products can be computed with dgemv
+  bool canUseGemv() const ;
+/// Copy a dense input matrix into a row major array
+  void getDenseMatrix( const unsigned& iarg, std::vector<double>& mat ) const ;
 public:
   static void registerKeywords( Keywords& keys );
   explicit MatrixTimesVector(const ActionOptions&);
@@ -46,6 +60,8 @@ public:
   unsigned getNumberOfColumns() const override { plumed_error(); }
   unsigned getNumberOfDerivatives();
   void prepare() override ;
+  void calculate() override ;
+  void apply() override ;
   bool isInSubChain( unsigned& nder ) override { nder = arg_deriv_starts[0]; return true; }
   void setupForTask( const unsigned& task_index, std::vector<unsigned>& indices, MultiValue& myvals ) const ;
   void performTask( const std::string& controller, const unsigned& index1, const unsigned& index2, MultiValue& myvals ) const override;
@@ -81,7 +97,8 @@ std::string MatrixTimesVector::getOutputComponentDescription( const std::string&
 MatrixTimesVector::MatrixTimesVector(const ActionOptions&ao):
   Action(ao),
   ActionWithMatrix(ao),
-  sumrows(false)
+  sumrows(false),
+  usegemv(false)
 {
   if( getNumberOfArguments()<2 ) error("Not enough arguments specified");
   unsigned nvectors=0, nmatrices=0;
@@ -162,6 +179,68 @@ void MatrixTimesVector::prepare() {
   std::vector<unsigned> shape(1); shape[0] = getPntrToArgument(0)->getShape()[0]; myval->setShape(shape);
 }
 
+void MatrixTimesVector::getProductArguments( const unsigned& ic, unsigned& imat, unsigned& ivec ) const {
+  if( getPntrToArgument(1)->getRank()==1 ) { imat=0; ivec=ic+1; }
+  else { imat=ic; ivec=getNumberOfArguments()-1; }
+}
+
+bool MatrixTimesVector::canUseGemv() const {
+  if( actionInChain() || chainContinues() ) return false;
+  for(int i=0; i<getNumberOfComponents(); ++i) {
+    if( !getConstPntrToComponent(i)->valueIsStored() ) return false;
+  }
+  for(unsigned i=0; i<getNumberOfArguments(); ++i) {
+    const Value* myarg = getPntrToArgument(i);
+    if( myarg->getRank()==0 || !myarg->valueHasBeenSet() ) return false;
+    if( myarg->getRank()==2 && myarg->getNumberOfColumns()<myarg->getShape()[1] ) return false;
+  }
+  return true;
+}
+
+void MatrixTimesVector::getDenseMatrix( const unsigned& iarg, std::vector<double>& mat ) const {
+  const Value* myarg = getPntrToArgument(iarg); unsigned nvals = myarg->getShape()[0]*myarg->getShape()[1];
+  if( mat.size()!=nvals ) mat.resize( nvals );
+  for(unsigned i=0; i<nvals; ++i) mat[i] = myarg->get( i, false );
+}
+
+void MatrixTimesVector::calculate() {
+  usegemv = canUseGemv();
+  if( !usegemv ) { ActionWithMatrix::calculate(); return; }
+  // The inputs are dense so each product is computed with dgemv.  The row major matrix is the transpose of a column major one
+  int n = getPntrToArgument(0)->getShape()[0], k = getPntrToArgument(0)->getShape()[1], inc=1; double one=1.0, zero=0.0;
+  gemv_vec.resize( k ); gemv_out.resize( n ); unsigned lastmat=getNumberOfArguments();
+  for(int i=0; i<getNumberOfComponents(); ++i) {
+    unsigned imat, ivec; getProductArguments( i, imat, ivec );
+    if( imat!=lastmat ) { getDenseMatrix( imat, gemv_mat ); lastmat=imat; }
+    Value* myvec = getPntrToArgument(ivec); for(int j=0; j<k; ++j) gemv_vec[j] = myvec->get(j);
+    if( n>0 && k>0 ) plumed_blas_dgemv( "T", &k, &n, &one, gemv_mat.data(), &k, gemv_vec.data(), &inc, &zero, gemv_out.data(), &inc );
+    else std::fill( gemv_out.begin(), gemv_out.end(), 0.0 );
+    Value* myval = getPntrToComponent(i); for(int j=0; j<n; ++j) myval->set( j, gemv_out[j] );
+  }
+}
+
+void MatrixTimesVector::apply() {
+  if( !usegemv ) { ActionWithMatrix::apply(); return; }
+  if( doNotCalculateDerivatives() ) return;
+  // The forces on the output are g so the force on the matrix is the outer product of g and the vector and the force on the vector is A^T g
+  int n = getPntrToArgument(0)->getShape()[0], k = getPntrToArgument(0)->getShape()[1], inc=1; double one=1.0, zero=0.0;
+  if( n==0 || k==0 ) return;
+  std::vector<double> vforce( k ); unsigned lastmat=getNumberOfArguments();
+  for(int i=0; i<getNumberOfComponents(); ++i) {
+    Value* myval = getPntrToComponent(i); if( !myval->forcesWereAdded() ) continue;
+    unsigned imat, ivec; getProductArguments( i, imat, ivec );
+    if( imat!=lastmat ) { getDenseMatrix( imat, gemv_mat ); lastmat=imat; }
+    for(int j=0; j<n; ++j) gemv_out[j] = myval->getForce(j);
+    Value* myvec = getPntrToArgument(ivec); Value* mymat = getPntrToArgument(imat);
+    plumed_blas_dgemv( "N", &k, &n, &one, gemv_mat.data(), &k, gemv_out.data(), &inc, &zero, vforce.data(), &inc );
+    for(int j=0; j<k; ++j) myvec->addForce( j, vforce[j] );
+    for(int j=0; j<n; ++j) {
+      if( gemv_out[j]==0 ) continue;
+      for(int l=0; l<k; ++l) mymat->addForce( j*k+l, gemv_out[j]*myvec->get(l), false );
+    }
+  }
+}
+
 void MatrixTimesVector::setupForTask( const unsigned& task_index, std::vector<unsigned>& indices, MultiValue& myvals ) const {
   unsigned start_n = getPntrToArgument(0)->getShape()[0], size_v = getPntrToArgument(0)->getRowLength(task_index);
   if( indices.size()!=size_v+1 ) indices.resize( size_v + 1 );
@@ -0,0 +1,218 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "MatrixOperationBase.h"
+#include "core/ActionRegister.h"
+#include "tools/OpenMP.h"
+#include "tools/Random.h"
+
+//+PLUMEDOC ANALYSIS RANDOMIZED_SVD
+/*
+Calculate the largest singular values and right singular vectors of a matrix using a randomized method
+
+If \f$A\f$ is the \f$n \times d\f$ input matrix this action outputs the largest eigenvalues and the corresponding eigenvectors
+of \f$A^T A\f$, which are the squares of the singular values and the right singular vectors of \f$A\f$.  The output
+is thus the same as the output of \ref DIAGONALIZE for the matrix \f$A^T A\f$ but the \f$d \times d\f$ matrix is never computed.
+Instead the range of \f$A\f$ is sampled by multiplying it by a block of \f$k+p\f$ random vectors, where \f$k\f$ is the number of
+singular vectors required and \f$p\f$ is given with OVERSAMPLE.  The sampled range is refined with a few power iterations
+and the singular vectors are then found from the decomposition of a \f$(k+p) \times (k+p)\f$ matrix.  The cost thus scales as \f$n d (k+p)\f$
+rather than as \f$n d^2 + d^3\f$.  The products with the input matrix are parallelized with OpenMP.
+
+The result is an approximation whose accuracy increases with OVERSAMPLE and with the number of power iterations.  It is accurate when
+there is a gap between the singular values that are required and those that are not.  Forces cannot be applied on the output of this action.
+
+\par Examples
+
+*/
+//+ENDPLUMEDOC
+
+namespace PLMD {
+namespace matrixtools {
+
+class RandomizedSVD : public MatrixOperationBase {
+private:
+  unsigned rank, oversample, niter, seed;
+/// The random vectors, the sample of the range of the input matrix and its projection on the sampled range
+  Matrix<double> omega, range, proj;
+/// The Gram matrix of the projection and its eigenvalues and eigenvectors
+  Matrix<double> gram, gramvecs;
+  std::vector<double> gramvals;
+/// Multiply the input matrix by the columns of x
+  void multiplyByMatrix( const Matrix<double>& x, Matrix<double>& ax ) const ;
+/// Multiply the transpose of the input matrix by the columns of y
+  void multiplyByTranspose( const Matrix<double>& y, Matrix<double>& aty ) const ;
+/// Orthonormalize the columns of a matrix with Gram-Schmidt
+  static void orthonormalizeColumns( Matrix<double>& m );
+public:
+  static void registerKeywords( Keywords& keys );
+/// Constructor
+  explicit RandomizedSVD(const ActionOptions&);
+/// There are no derivatives
+  unsigned getNumberOfDerivatives() override { return 0; }
+///
+  void prepare() override ;
+///
+  void calculate() override ;
+///
+  void apply() override ;
+///
+  double getForceOnMatrixElement( const unsigned& /*jrow*/, const unsigned& /*krow*/ ) const override { plumed_merror("this should not be called"); }
+};
+
+PLUMED_REGISTER_ACTION(RandomizedSVD,"RANDOMIZED_SVD")
+
+void RandomizedSVD::registerKeywords( Keywords& keys ) {
+  MatrixOperationBase::registerKeywords( keys );
+  keys.add("compulsory","RANK","the number of singular values and vectors that you would like to calculate");
+  keys.add("compulsory","OVERSAMPLE","10","the number of random vectors that are used in addition to RANK to sample the range of the matrix");
+  keys.add("compulsory","NITER","2","the number of power iterations that are used to refine the sampled range");
+  keys.add("compulsory","SEED","1234","the seed for the random number generator");
+  keys.addOutputComponent("vals","default","scalar","the eigenvalues of the product of the transpose of the input matrix and the input matrix");
+  keys.addOutputComponent("vecs","default","vector","the eigenvectors of the product of the transpose of the input matrix and the input matrix");
+}
+
+RandomizedSVD::RandomizedSVD(const ActionOptions& ao):
+  Action(ao),
+  MatrixOperationBase(ao)
+{
+  parse("RANK",rank); parse("OVERSAMPLE",oversample); parse("NITER",niter); parse("SEED",seed);
+  if( rank==0 || rank>getPntrToArgument(0)->getShape()[1] ) error("RANK should be between one and the number of columns of the input matrix");
+  log.printf("  computing %u singular vectors using %u random vectors and %u power iterations \n", rank, rank+oversample, niter );
+
+  std::string num; std::vector<unsigned> eval_shape(0);
+  std::vector<unsigned> evec_shape(1); evec_shape[0] = getPntrToArgument(0)->getShape()[1];
+  for(unsigned i=0; i<rank; ++i) {
+    Tools::convert( i+1, num );
+    addComponent( "vals-" + num, eval_shape ); componentIsNotPeriodic( "vals-" + num );
+    addComponent( "vecs-" + num, evec_shape ); componentIsNotPeriodic( "vecs-" + num );
+    getPntrToComponent( 2*i+1 )->buildDataStore();
+  }
+}
+
+void RandomizedSVD::prepare() {
+  std::vector<unsigned> shape(1); shape[0]=getPntrToArgument(0)->getShape()[1];
+  for(unsigned i=0; i<rank; ++i) {
+    if( getPntrToComponent( 2*i+1 )->getShape()[0]!=shape[0] ) getPntrToComponent( 2*i+1 )->setShape( shape );
+  }
+}
+
+void RandomizedSVD::multiplyByMatrix( const Matrix<double>& x, Matrix<double>& ax ) const {
+  const Value* mat = getPntrToArgument(0); unsigned n=mat->getShape()[0], d=mat->getShape()[1], nv=x.ncols();
+  #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(&ax(0,0),n*nv))
+  for(unsigned i=0; i<n; ++i) {
+    for(unsigned k=0; k<nv; ++k) ax(i,k)=0;
+    for(unsigned j=0; j<d; ++j) {
+      double aij = mat->get( std::size_t(i)*d+j ); if( aij==0 ) continue;
+      for(unsigned k=0; k<nv; ++k) ax(i,k) += aij*x(j,k);
+    }
+  }
+}
+
+void RandomizedSVD::multiplyByTranspose( const Matrix<double>& y, Matrix<double>& aty ) const {
+  const Value* mat = getPntrToArgument(0); unsigned n=mat->getShape()[0], d=mat->getShape()[1], nv=y.ncols();
+  aty=0;
+  #pragma omp parallel num_threads(OpenMP::getGoodNumThreads(&aty(0,0),d*nv))
+  {
+    // Each thread accumulates the contribution from a block of rows
+    Matrix<double> partial( d, nv ); partial=0;
+    #pragma omp for nowait
+    for(unsigned i=0; i<n; ++i) {
+      for(unsigned j=0; j<d; ++j) {
+        double aij = mat->get( std::size_t(i)*d+j ); if( aij==0 ) continue;
+        for(unsigned k=0; k<nv; ++k) partial(j,k) += aij*y(i,k);
+      }
+    }
+    #pragma omp critical
+    for(unsigned j=0; j<d; ++j) for(unsigned k=0; k<nv; ++k) aty(j,k) += partial(j,k);
+  }
+}
+
+void RandomizedSVD::orthonormalizeColumns( Matrix<double>& m ) {
+  unsigned n=m.nrows(), nv=m.ncols();
+  for(unsigned k=0; k<nv; ++k) {
+    // Orthogonalize twice to keep the vectors orthogonal to machine precision
+    for(unsigned pass=0; pass<2; ++pass) {
+      for(unsigned l=0; l<k; ++l) {
+        double dot=0; for(unsigned i=0; i<n; ++i) dot += m(i,l)*m(i,k);
+        for(unsigned i=0; i<n; ++i) m(i,k) -= dot*m(i,l);
+      }
+    }
+    double norm=0; for(unsigned i=0; i<n; ++i) norm += m(i,k)*m(i,k);
+    // Vectors that are linearly dependent on the previous ones are set to zero
+    norm = sqrt(norm); double inorm = norm>epsilon ? 1.0/norm : 0.0;
+    for(unsigned i=0; i<n; ++i) m(i,k) *= inorm;
+  }
+}
+
+void RandomizedSVD::calculate() {
+  unsigned n=getPntrToArgument(0)->getShape()[0], d=getPntrToArgument(0)->getShape()[1];
+  if( n==0 ) return;
+  unsigned nv = std::min( rank + oversample, std::min( n, d ) );
+  if( nv<rank ) error("cannot compute more singular vectors than there are rows in the input matrix");
+  if( omega.nrows()!=d || omega.ncols()!=nv ) omega.resize( d, nv );
+  if( range.nrows()!=n || range.ncols()!=nv ) range.resize( n, nv );
+  if( proj.nrows()!=d || proj.ncols()!=nv ) proj.resize( d, nv );
+
+  // Sample the range of the input matrix with Gaussian random vectors
+  Random random; random.setSeed(-seed);
+  for(unsigned j=0; j<d; ++j) for(unsigned k=0; k<nv; ++k) omega(j,k) = random.Gaussian();
+  multiplyByMatrix( omega, range );
+  // And refine it with power iterations
+  for(unsigned it=0; it<niter; ++it) {
+    orthonormalizeColumns( range ); multiplyByTranspose( range, omega );
+    orthonormalizeColumns( omega ); multiplyByMatrix( omega, range );
+  }
+  orthonormalizeColumns( range );
+  // Project the input matrix on the sampled range.  The columns of proj are the rows of Q^T A
+  multiplyByTranspose( range, proj );
+
+  // Diagonalize the small Gram matrix (Q^T A)(Q^T A)^T
+  if( gram.nrows()!=nv ) { gram.resize( nv, nv ); gramvecs.resize( nv, nv ); gramvals.resize( nv ); }
+  for(unsigned k=0; k<nv; ++k) {
+    for(unsigned l=0; l<=k; ++l) {
+      double dot=0; for(unsigned j=0; j<d; ++j) dot += proj(j,k)*proj(j,l);
+      gram(k,l) = gram(l,k) = dot;
+    }
+  }
+  diagMat( gram, gramvals, gramvecs );
+
+  // The right singular vectors are (Q^T A)^T u / sigma
+  for(unsigned i=0; i<rank; ++i) {
+    unsigned ivec = nv-1-i; double eval = gramvals[ivec];
+    getPntrToComponent(2*i)->set( eval );
+    Value* evec_out = getPntrToComponent(2*i+1);
+    double inorm = eval>epsilon ? 1.0/sqrt(eval) : 0.0;
+    for(unsigned j=0; j<d; ++j) {
+      double vj=0; for(unsigned k=0; k<nv; ++k) vj += proj(j,k)*gramvecs(ivec,k);
+      evec_out->set( j, inorm*vj );
+    }
+  }
+}
+
+void RandomizedSVD::apply() {
+  if( doNotCalculateDerivatives() ) return;
+  for(int i=0; i<getNumberOfComponents(); ++i) {
+    if( getPntrToComponent(i)->forcesWereAdded() ) error("forces cannot be applied on the output of RANDOMIZED_SVD");
+  }
+}
+
+}
+}
@@ -74,7 +74,8 @@ void Loss::registerKeywords(Keywords& keys) {
 }
 
 Loss::Loss(const ActionOptions& ao)
-  : PLUMED_COLVAR_INIT(ao)
+  : PLUMED_COLVAR_INIT(ao),
+    length_scale_(1.0)
 {
   if (keywords.exists("PARAMS")) {
     parseVector("PARAMS", params_);
@@ -96,6 +97,10 @@ Loss::Loss(const ActionOptions& ao)
     log.printf("\n");
   }
 
+  if (getUnits().getLengthString() == "nm") {
+    length_scale_ = 10.0;
+  }
+
   checkRead();
 }
 
@@ -104,9 +109,7 @@ double Loss::pairing(double distance) {
   double beta = params_[1];
   double gamma = params_[2];
 
-  if (getUnits().getLengthString() == "nm") {
-    distance *= 10.0;
-  }
+  distance *= length_scale_;
 
   return pow(distance, -alpha) * exp(-beta * pow(distance, gamma));
 }
@@ -78,6 +78,8 @@ public:
 protected:
   //! Parameters of the loss function.
   std::vector<double> params_;
+  //! Conversion of distances to angstroms, the loss is parametrized in angstroms.
+  double length_scale_;
 };
 
 } // namespace maze
@@ -272,6 +272,9 @@ Memetic::Memetic(const ActionOptions& ao)
 }
 
 void Memetic::optimize() {
+  // Positions do not change during the optimization.
+  set_sampling_radius(sampling_radius());
+
   Vector t = solve();
 
   set_opt(t);
@@ -332,9 +332,16 @@ void Memetic::initialize_members() {
 }
 
 void Memetic::score_members() {
+  std::vector<Vector> translations(members_.size());
   for (size_t i = 0; i < members_.size(); ++i) {
-    double s = score_member(members_[i].translation);
-    members_[i].score=s;
+    translations[i] = members_[i].translation;
+  }
+
+  std::vector<double> scores;
+  score(translations, scores);
+
+  for (size_t i = 0; i < members_.size(); ++i) {
+    members_[i].score=scores[i];
   }
 }
 
@@ -641,47 +648,20 @@ void Memetic::mating(std::vector<Member>& m) {
 }
 
 Vector Memetic::create_coding() {
-  double s = sampling_radius();
+  double s = get_sampling_radius();
   double r = rnd::next_double(s);
 
   return rnd::next_plmd_vector(r);
 }
 
 bool Memetic::out_of_bounds(double v) {
-  double s = sampling_radius();
+  double s = get_sampling_radius();
 
   return v > s;
 }
 
 double Memetic::score_member(const Vector& coding) {
-  double action = 0;
-  Vector distance;
-  const unsigned nl_size = neighbor_list_->size();
-  Vector dev = coding;
-
-  #pragma omp parallel num_threads(get_n_threads_openmp())
-  {
-    #pragma omp for reduction(+:action)
-    for (unsigned int i = 0; i < nl_size; i++) {
-      unsigned i0 = neighbor_list_->getClosePair(i).first;
-      unsigned i1 = neighbor_list_->getClosePair(i).second;
-
-      if (getAbsoluteIndex(i0) == getAbsoluteIndex(i1)) {
-        continue;
-      }
-
-      if (pbc_) {
-        distance = pbcDistance(getPosition(i0) + dev, getPosition(i1));
-      }
-      else {
-        distance = delta(getPosition(i0) + dev, getPosition(i1));
-      }
-
-      action += pairing(distance.modulo());
-    }
-  }
-
-  return action;
+  return score(coding);
 }
 
 void Memetic::print_status() const {
@@ -417,27 +417,49 @@ void Optimizer::prepare() {
   }
 }
 
-double Optimizer::score() {
+void Optimizer::gather_pairs() {
   const unsigned nl_size = neighbor_list_->size();
-  Vector distance;
+
+  pair_ligand_.clear();
+  pair_protein_.clear();
+  pair_ligand_.reserve(nl_size);
+  pair_protein_.reserve(nl_size);
+
+  for (unsigned int i = 0; i < nl_size; i++) {
+    unsigned i0 = neighbor_list_->getClosePair(i).first;
+    unsigned i1 = neighbor_list_->getClosePair(i).second;
+
+    if (getAbsoluteIndex(i0) == getAbsoluteIndex(i1)) {
+      continue;
+    }
+
+    pair_ligand_.push_back(getPosition(i0));
+    pair_protein_.push_back(getPosition(i1));
+  }
+}
+
+double Optimizer::score() {
+  Vector zero;
+  zero.zero();
+
+  return score(zero);
+}
+
+double Optimizer::score(const Vector& translation) const {
+  const unsigned n_pairs = pair_ligand_.size();
   double function = 0;
 
   #pragma omp parallel num_threads(n_threads_)
   {
     #pragma omp for reduction(+:function)
-    for(unsigned int i = 0; i < nl_size; i++) {
-      unsigned i0 = neighbor_list_->getClosePair(i).first;
-      unsigned i1 = neighbor_list_->getClosePair(i).second;
-
-      if (getAbsoluteIndex(i0) == getAbsoluteIndex(i1)) {
-        continue;
-      }
+    for (unsigned int i = 0; i < n_pairs; i++) {
+      Vector distance;
 
       if (pbc_) {
-        distance = pbcDistance(getPosition(i0), getPosition(i1));
+        distance = pbcDistance(pair_ligand_[i] + translation, pair_protein_[i]);
       }
       else {
-        distance = delta(getPosition(i0), getPosition(i1));
+        distance = delta(pair_ligand_[i] + translation, pair_protein_[i]);
       }
 
       function += pairing(distance.modulo());
@@ -447,6 +469,46 @@ double Optimizer::score() {
   return function;
 }
 
+void Optimizer::score(
+  const std::vector<Vector>& translations,
+  std::vector<double>& scores
+) const
+{
+  const unsigned n_pairs = pair_ligand_.size();
+  const unsigned n_translations = translations.size();
+  scores.assign(n_translations, 0.0);
+
+  unsigned nt = OpenMP::getNumThreads();
+  if (nt > n_translations) {
+    nt = n_translations;
+  }
+  if (nt == 0) {
+    nt = 1;
+  }
+
+  // Each thread scores whole candidates, so the scores need no reduction.
+  #pragma omp parallel for num_threads(nt) schedule(dynamic)
+  for (unsigned int t = 0; t < n_translations; t++) {
+    const Vector& translation = translations[t];
+    double function = 0;
+
+    for (unsigned int i = 0; i < n_pairs; i++) {
+      Vector distance;
+
+      if (pbc_) {
+        distance = pbcDistance(pair_ligand_[i] + translation, pair_protein_[i]);
+      }
+      else {
+        distance = delta(pair_ligand_[i] + translation, pair_protein_[i]);
+      }
+
+      function += pairing(distance.modulo());
+    }
+
+    scores[t] = function;
+  }
+}
+
 void Optimizer::update_nl() {
   if (neighbor_list_->getStride() > 0 && validate_list_) {
     neighbor_list_->update(getPositions());
@@ -455,23 +517,16 @@ void Optimizer::update_nl() {
 
 double Optimizer::sampling_radius()
 {
-  const unsigned nl_size=neighbor_list_->size();
+  const unsigned n_pairs = pair_ligand_.size();
   Vector d;
   double min=std::numeric_limits<int>::max();
 
-  for (unsigned int i = 0; i < nl_size; ++i) {
-    unsigned i0 = neighbor_list_->getClosePair(i).first;
-    unsigned i1 = neighbor_list_->getClosePair(i).second;
-
-    if (getAbsoluteIndex(i0) == getAbsoluteIndex(i1)) {
-      continue;
-    }
-
+  for (unsigned int i = 0; i < n_pairs; ++i) {
     if (pbc_) {
-      d = pbcDistance(getPosition(i0), getPosition(i1));
+      d = pbcDistance(pair_ligand_[i], pair_protein_[i]);
     }
     else {
-      d = delta(getPosition(i0), getPosition(i1));
+      d = delta(pair_ligand_[i], pair_protein_[i]);
     }
 
     double dist = d.modulo();
@@ -486,6 +541,7 @@ double Optimizer::sampling_radius()
 
 void Optimizer::calculate() {
   update_nl();
+  gather_pairs();
 
   if (getStep() % optimizer_stride_ == 0 && !first_step_) {
     optimize();
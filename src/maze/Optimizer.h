@@ -117,6 +117,31 @@ public:
    */
   void update_nl();
 
+  /**
+   * Copy the positions of the ligand-protein pairs in the neighbor list to
+   * contiguous buffers shared by all candidates scored in one optimization.
+   */
+  void gather_pairs();
+
+  /**
+   * Score a ligand-protein configuration with the ligand translated.
+   *
+   * @param[in] translation translation of the ligand
+   * @return score
+   */
+  double score(const Vector& translation) const;
+
+  /**
+   * Score a population of ligand translations, in parallel over candidates.
+   *
+   * @param[in] translations translations of the ligand
+   * @param[out] scores score of each translation
+   */
+  void score(
+    const std::vector<Vector>& translations,
+    std::vector<double>& scores
+  ) const;
+
   /**
    * Calculate the center of mass.
    *
@@ -213,6 +238,10 @@ protected:
   //! Neighbor list stride.
   int nl_stride_;
 
+  //! Positions of the ligand and protein atoms of each pair, see gather_pairs.
+  std::vector<Vector> pair_ligand_;
+  std::vector<Vector> pair_protein_;
+
 private:
   bool serial_;
   bool validate_list_;
@@ -202,55 +202,19 @@ void Simulated_Annealing::decrease_probability(unsigned int time) {
 void Simulated_Annealing::optimize() {
   sampling_r_ = sampling_radius();
   double rad_s;
-  const unsigned nl_size = neighbor_list_->size();
-
-  Vector distance, distance_next;
+  std::vector<Vector> candidates(2);
+  std::vector<double> actions;
 
   for (unsigned int iter=0; iter < get_n_iterations(); ++iter) {
-    double action = 0;
-    double action_next = 0;
-
     rad_s = rnd::next_double(sampling_r_);
     Vector dev = rnd::next_plmd_vector(rad_s);
 
-    #pragma omp parallel num_threads(get_n_threads_openmp())
-    {
-      #pragma omp for reduction(+:action_next, action)
-      for (unsigned int i=0; i < nl_size; i++) {
-        unsigned i0 = neighbor_list_->getClosePair(i).first;
-        unsigned i1 = neighbor_list_->getClosePair(i).second;
-
-        if (getAbsoluteIndex(i0) == getAbsoluteIndex(i1)) {
-          continue;
-        }
-
-        if (pbc_) {
-          distance = pbcDistance(
-                       getPosition(i0) + get_opt(),
-                       getPosition(i1)
-                     );
-
-          distance_next = pbcDistance(
-                            getPosition(i0) + dev,
-                            getPosition(i1)
-                          );
-        }
-        else {
-          distance = delta(
-                       getPosition(i0) + get_opt(),
-                       getPosition(i1)
-                     );
-
-          distance_next = delta(
-                            getPosition(i0) + dev,
-                            getPosition(i1)
-                          );
-        }
-
-        action += pairing(distance.modulo());
-        action_next += pairing(distance_next.modulo());
-      }
-    }
+    candidates[0] = get_opt();
+    candidates[1] = dev;
+    score(candidates, actions);
+
+    double action = actions[0];
+    double action_next = actions[1];
 
     double p = std::min(
                  1.0,
@@ -271,9 +271,6 @@ void fusionPoreExpansionP::calculate()
   // Slices to analyze per particle.
   unsigned s1_Mem, s2_Mem;
 
-  // Eq. 7 Hub & Awasthi JCTC 2017.
-  std::vector<double> faxial_Mem(TAILS.size() * NSMEM[0]);
-
   // Eq. 10 Hub & Awasthi JCTC 2017.
   std::vector<double> Fs_Mem(NSMEM[0]);
 
@@ -333,6 +330,8 @@ void fusionPoreExpansionP::calculate()
       }
 
       TailPosition = getPbc().realToScaled(pbcDistance(Vector(0.0, 0.0, 0.0), getPosition(i + membraneBeads)));
+      const double sinX_Mem = sin(2.0 * M_PI * TailPosition[0]), sinY_Mem = sin(2.0 * M_PI * TailPosition[1]);
+      const double cosX_Mem = cos(2.0 * M_PI * TailPosition[0]), cosY_Mem = cos(2.0 * M_PI * TailPosition[1]);
 
       for (unsigned s = s1_Mem; s <= s2_Mem; s++)
       {
@@ -341,32 +340,29 @@ void fusionPoreExpansionP::calculate()
         {
           if (((-1.0 + HMEM[0]) <= x) && (x <= (1.0 - HMEM[0])))
           {
-            faxial_Mem[i + TAILS.size() * s] = 1.0;
             Fs_Mem[s] += 1.0;
-            sx_Mem[s] += sin(2.0 * M_PI * TailPosition[0]);
-            sy_Mem[s] += sin(2.0 * M_PI * TailPosition[1]);
-            cx_Mem[s] += cos(2.0 * M_PI * TailPosition[0]);
-            cy_Mem[s] += cos(2.0 * M_PI * TailPosition[1]);
+            sx_Mem[s] += sinX_Mem;
+            sy_Mem[s] += sinY_Mem;
+            cx_Mem[s] += cosX_Mem;
+            cy_Mem[s] += cosY_Mem;
           }
           else if (((1.0 - HMEM[0]) < x) && (x < (1.0 + HMEM[0])))
           {
             aux = 0.5 - ((3.0 * x - 3.0) / (4.0 * HMEM[0])) + (pow((x - 1.0), 3) / (4.0 * pow(HMEM[0], 3)));
-            faxial_Mem[i + TAILS.size() * s] = aux;
             Fs_Mem[s] += aux;
-            sx_Mem[s] += aux * sin(2.0 * M_PI * TailPosition[0]);
-            sy_Mem[s] += aux * sin(2.0 * M_PI * TailPosition[1]);
-            cx_Mem[s] += aux * cos(2.0 * M_PI * TailPosition[0]);
-            cy_Mem[s] += aux * cos(2.0 * M_PI * TailPosition[1]);
+            sx_Mem[s] += aux * sinX_Mem;
+            sy_Mem[s] += aux * sinY_Mem;
+            cx_Mem[s] += aux * cosX_Mem;
+            cy_Mem[s] += aux * cosY_Mem;
           }
           else if (((-1.0 - HMEM[0]) < x) && (x < (-1.0 + HMEM[0])))
           {
             aux = 0.5 + ((3.0 * x + 3.0) / (4.0 * HMEM[0])) - (pow((x + 1.0), 3) / (4.0 * pow(HMEM[0], 3)));
-            faxial_Mem[i + TAILS.size() * s] = aux;
             Fs_Mem[s] += aux;
-            sx_Mem[s] += (aux * sin(2.0 * M_PI * TailPosition[0]));
-            sy_Mem[s] += (aux * sin(2.0 * M_PI * TailPosition[1]));
-            cx_Mem[s] += (aux * cos(2.0 * M_PI * TailPosition[0]));
-            cy_Mem[s] += (aux * cos(2.0 * M_PI * TailPosition[1]));
+            sx_Mem[s] += (aux * sinX_Mem);
+            sy_Mem[s] += (aux * sinY_Mem);
+            cx_Mem[s] += (aux * cosX_Mem);
+            cy_Mem[s] += (aux * cosY_Mem);
           }
         }
       }
@@ -284,9 +284,6 @@ void fusionPoreNucleationP::calculate()
   // Slices to analyze per particle.
   unsigned s1_Mem, s2_Mem;
 
-  // Eq. 7 Hub & Awasthi JCTC 2017.
-  std::vector<double> faxial_Mem(TAILS.size() * NSMEM[0]);
-
   // Eq. 10 Hub & Awasthi JCTC 2017.
   std::vector<double> Fs_Mem(NSMEM[0]);
 
@@ -346,6 +343,8 @@ void fusionPoreNucleationP::calculate()
       }
 
       TailPosition = getPbc().realToScaled(pbcDistance(Vector(0.0, 0.0, 0.0), getPosition(i + membraneBeads)));
+      const double sinX_Mem = sin(2.0 * M_PI * TailPosition[0]), sinY_Mem = sin(2.0 * M_PI * TailPosition[1]);
+      const double cosX_Mem = cos(2.0 * M_PI * TailPosition[0]), cosY_Mem = cos(2.0 * M_PI * TailPosition[1]);
 
       for (unsigned s = s1_Mem; s <= s2_Mem; s++)
       {
@@ -354,32 +353,29 @@ void fusionPoreNucleationP::calculate()
         {
           if (((-1.0 + HMEM[0]) <= x) && (x <= (1.0 - HMEM[0])))
           {
-            faxial_Mem[i + TAILS.size() * s] = 1.0;
             Fs_Mem[s] += 1.0;
-            sx_Mem[s] += sin(2.0 * M_PI * TailPosition[0]);
-            sy_Mem[s] += sin(2.0 * M_PI * TailPosition[1]);
-            cx_Mem[s] += cos(2.0 * M_PI * TailPosition[0]);
-            cy_Mem[s] += cos(2.0 * M_PI * TailPosition[1]);
+            sx_Mem[s] += sinX_Mem;
+            sy_Mem[s] += sinY_Mem;
+            cx_Mem[s] += cosX_Mem;
+            cy_Mem[s] += cosY_Mem;
           }
           else if (((1.0 - HMEM[0]) < x) && (x < (1.0 + HMEM[0])))
           {
             aux = 0.5 - ((3.0 * x - 3.0) / (4.0 * HMEM[0])) + (pow((x - 1.0), 3) / (4.0 * pow(HMEM[0], 3)));
-            faxial_Mem[i + TAILS.size() * s] = aux;
             Fs_Mem[s] += aux;
-            sx_Mem[s] += aux * sin(2.0 * M_PI * TailPosition[0]);
-            sy_Mem[s] += aux * sin(2.0 * M_PI * TailPosition[1]);
-            cx_Mem[s] += aux * cos(2.0 * M_PI * TailPosition[0]);
-            cy_Mem[s] += aux * cos(2.0 * M_PI * TailPosition[1]);
+            sx_Mem[s] += aux * sinX_Mem;
+            sy_Mem[s] += aux * sinY_Mem;
+            cx_Mem[s] += aux * cosX_Mem;
+            cy_Mem[s] += aux * cosY_Mem;
           }
           else if (((-1.0 - HMEM[0]) < x) && (x < (-1.0 + HMEM[0])))
           {
             aux = 0.5 + ((3.0 * x + 3.0) / (4.0 * HMEM[0])) - (pow((x + 1.0), 3) / (4.0 * pow(HMEM[0], 3)));
-            faxial_Mem[i + TAILS.size() * s] = aux;
             Fs_Mem[s] += aux;
-            sx_Mem[s] += (aux * sin(2.0 * M_PI * TailPosition[0]));
-            sy_Mem[s] += (aux * sin(2.0 * M_PI * TailPosition[1]));
-            cx_Mem[s] += (aux * cos(2.0 * M_PI * TailPosition[0]));
-            cy_Mem[s] += (aux * cos(2.0 * M_PI * TailPosition[1]));
+            sx_Mem[s] += (aux * sinX_Mem);
+            sy_Mem[s] += (aux * sinY_Mem);
+            cx_Mem[s] += (aux * cosX_Mem);
+            cy_Mem[s] += (aux * cosY_Mem);
           }
         }
       }
@@ -470,11 +466,14 @@ void fusionPoreNucleationP::calculate()
   // Slices to analyze per particle.
   std::vector<unsigned> s1(chainBeads), s2(chainBeads);
 
-  // Eq. 7 Hub & Awasthi JCTC 2017.
-  std::vector<double> faxial(chainBeads * NS[0]);
+  // Sine and cosine of the scaled XY position of each bead, computed once and reused for every slice.
+  std::vector<double> sinX(chainBeads), sinY(chainBeads), cosX(chainBeads), cosY(chainBeads);
+
+  // Eq. 7 Hub & Awasthi JCTC 2017. Only the three slices s1[i]..s2[i] that can overlap bead i are stored.
+  std::vector<double> faxial(3 * chainBeads);
 
   // Eq. 16 Hub & Awasthi JCTC 2017.
-  std::vector<double> d_faxial_dz(chainBeads * NS[0]);
+  std::vector<double> d_faxial_dz(3 * chainBeads);
 
   // Eq. 10 Hub & Awasthi JCTC 2017.
   std::vector<double> Fs(NS[0]);
@@ -530,6 +529,10 @@ void fusionPoreNucleationP::calculate()
         }
 
         Position = getPbc().realToScaled(pbcDistance(Vector(0.0, 0.0, 0.0), getPosition(i + noChainBeads)));
+        sinX[i] = sin(2.0 * M_PI * Position[0]);
+        sinY[i] = sin(2.0 * M_PI * Position[1]);
+        cosX[i] = cos(2.0 * M_PI * Position[0]);
+        cosY[i] = cos(2.0 * M_PI * Position[1]);
 
         for (unsigned s = s1[i]; s <= s2[i]; s++)
         {
@@ -538,34 +541,34 @@ void fusionPoreNucleationP::calculate()
           {
             if (((-1.0 + HCH[0]) <= x) && (x <= (1.0 - HCH[0])))
             {
-              faxial[i + chainBeads * s] = 1.0;
+              faxial[3 * i + s - s1[i]] = 1.0;
               Fs[s] += 1.0;
-              sx[s] += sin(2.0 * M_PI * Position[0]);
-              sy[s] += sin(2.0 * M_PI * Position[1]);
-              cx[s] += cos(2.0 * M_PI * Position[0]);
-              cy[s] += cos(2.0 * M_PI * Position[1]);
+              sx[s] += sinX[i];
+              sy[s] += sinY[i];
+              cx[s] += cosX[i];
+              cy[s] += cosY[i];
             }
             else if (((1.0 - HCH[0]) < x) && (x < (1.0 + HCH[0])))
             {
               aux = 0.5 - ((3.0 * x - 3.0) / (4.0 * HCH[0])) + (pow((x - 1.0), 3) / (4.0 * pow(HCH[0], 3)));
-              faxial[i + chainBeads * s] = aux;
-              d_faxial_dz[i + chainBeads * s] = ((-3.0 / (4.0 * HCH[0])) + ((3.0 * pow((x - 1), 2)) / (4.0 * pow(HCH[0], 3)))) * 2.0 / DS[0];
+              faxial[3 * i + s - s1[i]] = aux;
+              d_faxial_dz[3 * i + s - s1[i]] = ((-3.0 / (4.0 * HCH[0])) + ((3.0 * pow((x - 1), 2)) / (4.0 * pow(HCH[0], 3)))) * 2.0 / DS[0];
               Fs[s] += aux;
-              sx[s] += aux * sin(2.0 * M_PI * Position[0]);
-              sy[s] += aux * sin(2.0 * M_PI * Position[1]);
-              cx[s] += aux * cos(2.0 * M_PI * Position[0]);
-              cy[s] += aux * cos(2.0 * M_PI * Position[1]);
+              sx[s] += aux * sinX[i];
+              sy[s] += aux * sinY[i];
+              cx[s] += aux * cosX[i];
+              cy[s] += aux * cosY[i];
             }
             else if (((-1.0 - HCH[0]) < x) && (x < (-1.0 + HCH[0])))
             {
               aux = 0.5 + ((3.0 * x + 3.0) / (4.0 * HCH[0])) - (pow((x + 1.0), 3) / (4.0 * pow(HCH[0], 3)));
-              faxial[i + chainBeads * s] = aux;
-              d_faxial_dz[i + chainBeads * s] = ((3.0 / (4.0 * HCH[0])) - ((3.0 * pow((x + 1), 2)) / (4.0 * pow(HCH[0], 3)))) * 2.0 / DS[0];
+              faxial[3 * i + s - s1[i]] = aux;
+              d_faxial_dz[3 * i + s - s1[i]] = ((3.0 / (4.0 * HCH[0])) - ((3.0 * pow((x + 1), 2)) / (4.0 * pow(HCH[0], 3)))) * 2.0 / DS[0];
               Fs[s] += aux;
-              sx[s] += (aux * sin(2.0 * M_PI * Position[0]));
-              sy[s] += (aux * sin(2.0 * M_PI * Position[1]));
-              cx[s] += (aux * cos(2.0 * M_PI * Position[0]));
-              cy[s] += (aux * cos(2.0 * M_PI * Position[1]));
+              sx[s] += (aux * sinX[i]);
+              sy[s] += (aux * sinY[i]);
+              cx[s] += (aux * cosX[i]);
+              cy[s] += (aux * cosY[i]);
             }
           }
         }
@@ -656,7 +659,7 @@ void fusionPoreNucleationP::calculate()
   double b = (ZETA[0] / (1.0 - ZETA[0])), c = ((1.0 - ZETA[0]) * exp(b));
 
   // Eq. 19 Hub & Awasthi JCTC 2017.
-  std::vector<double> fradial_d_faxial_dz(chainBeads * NS[0]);
+  std::vector<double> fradial_d_faxial_dz(3 * chainBeads);
 
   // Eq. 20 Hub & Awasthi JCTC 2017.
   std::vector<double> Axs(NS[0]), Ays(NS[0]);
@@ -671,7 +674,6 @@ void fusionPoreNucleationP::calculate()
   CylDistances[i] = pbcDistance(xyzCyl, pbcDistance(Vector(0.0, 0.0, 0.0), getPosition(i + noChainBeads)));
     if (analyzeThisParticle[i])
     {
-      Position = getPbc().realToScaled(pbcDistance(Vector(0.0, 0.0, 0.0), getPosition(i + noChainBeads)));
       d_Xsc_dx = 0.0;
       d_Xcc_dx = 0.0;
       d_Ysc_dy = 0.0;
@@ -684,20 +686,20 @@ void fusionPoreNucleationP::calculate()
       {
         if (Fs[s] != 0.0)
         {
-          d_sx_dx = faxial[i + chainBeads * s] * 2.0 * M_PI * cos(2.0 * M_PI * Position[0]) / (Lx * Fs[s]);
-          d_sy_dy = faxial[i + chainBeads * s] * 2.0 * M_PI * cos(2.0 * M_PI * Position[1]) / (Ly * Fs[s]);
-          d_cx_dx = -faxial[i + chainBeads * s] * 2.0 * M_PI * sin(2.0 * M_PI * Position[0]) / (Lx * Fs[s]);
-          d_cy_dy = -faxial[i + chainBeads * s] * 2.0 * M_PI * sin(2.0 * M_PI * Position[1]) / (Ly * Fs[s]);
+          d_sx_dx = faxial[3 * i + s - s1[i]] * 2.0 * M_PI * cosX[i] / (Lx * Fs[s]);
+          d_sy_dy = faxial[3 * i + s - s1[i]] * 2.0 * M_PI * cosY[i] / (Ly * Fs[s]);
+          d_cx_dx = -faxial[3 * i + s - s1[i]] * 2.0 * M_PI * sinX[i] / (Lx * Fs[s]);
+          d_cy_dy = -faxial[3 * i + s - s1[i]] * 2.0 * M_PI * sinY[i] / (Ly * Fs[s]);
           d_Xsc_dx += ws[s] * d_sx_dx / W;
           d_Xcc_dx += ws[s] * d_cx_dx / W;
           d_Ysc_dy += ws[s] * d_sy_dy / W;
           d_Ycc_dy += ws[s] * d_cy_dy / W;
 
-          d_sx_dz = d_faxial_dz[i + chainBeads * s] * (sin(2.0 * M_PI * Position[0]) - sx[s]) / Fs[s];
-          d_sy_dz = d_faxial_dz[i + chainBeads * s] * (sin(2.0 * M_PI * Position[1]) - sy[s]) / Fs[s];
-          d_cx_dz = d_faxial_dz[i + chainBeads * s] * (cos(2.0 * M_PI * Position[0]) - cx[s]) / Fs[s];
-          d_cy_dz = d_faxial_dz[i + chainBeads * s] * (cos(2.0 * M_PI * Position[1]) - cy[s]) / Fs[s];
-          d_ws_dz = (1 - pow(ws[s], 2)) * d_faxial_dz[i + chainBeads * s];
+          d_sx_dz = d_faxial_dz[3 * i + s - s1[i]] * (sinX[i] - sx[s]) / Fs[s];
+          d_sy_dz = d_faxial_dz[3 * i + s - s1[i]] * (sinY[i] - sy[s]) / Fs[s];
+          d_cx_dz = d_faxial_dz[3 * i + s - s1[i]] * (cosX[i] - cx[s]) / Fs[s];
+          d_cy_dz = d_faxial_dz[3 * i + s - s1[i]] * (cosY[i] - cy[s]) / Fs[s];
+          d_ws_dz = (1 - pow(ws[s], 2)) * d_faxial_dz[3 * i + s - s1[i]];
           d_Xsc_dz += (ws[s] * d_sx_dz + d_ws_dz * (sx[s] - Xsc)) / W;
           d_Xcc_dz += (ws[s] * d_cx_dz + d_ws_dz * (cx[s] - Xcc)) / W;
           d_Ysc_dz += (ws[s] * d_sy_dz + d_ws_dz * (sy[s] - Ysc)) / W;
@@ -732,10 +734,10 @@ void fusionPoreNucleationP::calculate()
 
         for (unsigned s = s1[i]; s <= s2[i]; s++)
         {
-          Nsp[s] += fradial * faxial[i + chainBeads * s];
-          Axs[s] += faxial[i + chainBeads * s] * d_fradial_dx[i];
-          Ays[s] += faxial[i + chainBeads * s] * d_fradial_dy[i];
-          fradial_d_faxial_dz[i + chainBeads * s] = fradial * d_faxial_dz[i + chainBeads * s];
+          Nsp[s] += fradial * faxial[3 * i + s - s1[i]];
+          Axs[s] += faxial[3 * i + s - s1[i]] * d_fradial_dx[i];
+          Ays[s] += faxial[3 * i + s - s1[i]] * d_fradial_dy[i];
+          fradial_d_faxial_dz[3 * i + s - s1[i]] = fradial * d_faxial_dz[3 * i + s - s1[i]];
         }
       }
     }
@@ -760,7 +762,7 @@ void fusionPoreNucleationP::calculate()
   Xi_n = Xi_n / NS[0];
 
   // Eq. 18 Hub & Awasthi JCTC 2017.
-  std::vector<double> faxial_d_fradial_dx(chainBeads * NS[0]), faxial_d_fradial_dy(chainBeads * NS[0]), faxial_d_fradial_dz(chainBeads * NS[0]);
+  std::vector<double> faxial_d_fradial_dx(3 * chainBeads), faxial_d_fradial_dy(3 * chainBeads), faxial_d_fradial_dz(3 * chainBeads);
 
   // Eq. 13 Hub & Awasthi JCTC 2017 modified to considere the Heaviside_Chain step function (this only affect during the transition).
   std::vector<Vector> derivatives_Chain(chainBeads);
@@ -776,20 +778,20 @@ void fusionPoreNucleationP::calculate()
     {
       for (unsigned s = s1[i]; s <= s2[i]; s++)
       {
-        if (faxial[i + chainBeads * s])
+        if (faxial[3 * i + s - s1[i]])
         {
-          faxial_d_fradial_dx[i + chainBeads * s] = faxial[i + chainBeads * s] * d_fradial_dx[i] - d_Xcyl_dx[i] * Axs[s];
-          faxial_d_fradial_dy[i + chainBeads * s] = faxial[i + chainBeads * s] * d_fradial_dy[i] - d_Ycyl_dy[i] * Ays[s];
-          faxial_d_fradial_dz[i + chainBeads * s] = -d_Xcyl_dz[i] * Axs[s] - d_Ycyl_dz[i] * Ays[s];
+          faxial_d_fradial_dx[3 * i + s - s1[i]] = faxial[3 * i + s - s1[i]] * d_fradial_dx[i] - d_Xcyl_dx[i] * Axs[s];
+          faxial_d_fradial_dy[3 * i + s - s1[i]] = faxial[3 * i + s - s1[i]] * d_fradial_dy[i] - d_Ycyl_dy[i] * Ays[s];
+          faxial_d_fradial_dz[3 * i + s - s1[i]] = -d_Xcyl_dz[i] * Axs[s] - d_Ycyl_dz[i] * Ays[s];
         }
       }
 
       for (unsigned s = s1[i]; s <= s2[i]; s++)
       {
         aux = d_psi[s] / NS[0];
-        derivatives_Chain[i][0] += aux * faxial_d_fradial_dx[i + chainBeads * s];
-        derivatives_Chain[i][1] += aux * faxial_d_fradial_dy[i + chainBeads * s];
-        derivatives_Chain[i][2] += aux * (faxial_d_fradial_dz[i + chainBeads * s] + fradial_d_faxial_dz[i + chainBeads * s]);
+        derivatives_Chain[i][0] += aux * faxial_d_fradial_dx[3 * i + s - s1[i]];
+        derivatives_Chain[i][1] += aux * faxial_d_fradial_dy[3 * i + s - s1[i]];
+        derivatives_Chain[i][2] += aux * (faxial_d_fradial_dz[3 * i + s - s1[i]] + fradial_d_faxial_dz[3 * i + s - s1[i]]);
       }
     }
   }
@@ -253,11 +253,14 @@ void memFusionP::calculate()
   // Mark the particles to analyze.
   std::vector<double> analyzeThisParticle_Mem(TAILS.size());
 
-  // Eq. 7 Hub & Awasthi JCTC 2017.
-  std::vector<double> faxial_Mem(TAILS.size() * NSMEM[0]);
+  // Sine and cosine of the scaled XY position of each lipid tail, computed once and reused for every slice.
+  std::vector<double> sinX_Mem(TAILS.size()), sinY_Mem(TAILS.size()), cosX_Mem(TAILS.size()), cosY_Mem(TAILS.size());
+
+  // Eq. 7 Hub & Awasthi JCTC 2017. Only the three slices s1_Mem[i]..s2_Mem[i] that can overlap bead i are stored.
+  std::vector<double> faxial_Mem(3 * TAILS.size());
 
   // Eq. 16 Hub & Awasthi JCTC 2017.
-  std::vector<double> d_faxial_Mem_dz(TAILS.size() * NSMEM[0]);
+  std::vector<double> d_faxial_Mem_dz(3 * TAILS.size());
 
   // Eq. 10 Hub & Awasthi JCTC 2017.
   std::vector<double> Fs_Mem(NSMEM[0]);
@@ -320,6 +323,10 @@ void memFusionP::calculate()
       }
 
       TailPosition = getPbc().realToScaled(pbcDistance(Vector(0.0, 0.0, 0.0), getPosition(i + membraneBeads)));
+      sinX_Mem[i] = sin(2.0 * M_PI * TailPosition[0]);
+      sinY_Mem[i] = sin(2.0 * M_PI * TailPosition[1]);
+      cosX_Mem[i] = cos(2.0 * M_PI * TailPosition[0]);
+      cosY_Mem[i] = cos(2.0 * M_PI * TailPosition[1]);
 
       for (unsigned s = s1_Mem[i]; s <= s2_Mem[i]; s++)
       {
@@ -328,34 +335,34 @@ void memFusionP::calculate()
         {
           if (((-1.0 + HMEM[0]) <= x) && (x <= (1.0 - HMEM[0])))
           {
-            faxial_Mem[i + TAILS.size() * s] = 1.0;
+            faxial_Mem[3 * i + s - s1_Mem[i]] = 1.0;
             Fs_Mem[s] += 1.0;
-            sx_Mem[s] += sin(2.0 * M_PI * TailPosition[0]);
-            sy_Mem[s] += sin(2.0 * M_PI * TailPosition[1]);
-            cx_Mem[s] += cos(2.0 * M_PI * TailPosition[0]);
-            cy_Mem[s] += cos(2.0 * M_PI * TailPosition[1]);
+            sx_Mem[s] += sinX_Mem[i];
+            sy_Mem[s] += sinY_Mem[i];
+            cx_Mem[s] += cosX_Mem[i];
+            cy_Mem[s] += cosY_Mem[i];
           }
           else if (((1.0 - HMEM[0]) < x) && (x < (1.0 + HMEM[0])))
           {
             aux = 0.5 - ((3.0 * x - 3.0) / (4.0 * HMEM[0])) + (pow((x - 1.0), 3) / (4.0 * pow(HMEM[0], 3)));
-            faxial_Mem[i + TAILS.size() * s] = aux;
-            d_faxial_Mem_dz[i + TAILS.size() * s] = ((-3.0 / (4.0 * HMEM[0])) + ((3.0 * pow((x - 1), 2)) / (4.0 * pow(HMEM[0], 3)))) * 2.0 / DSMEM[0];
+            faxial_Mem[3 * i + s - s1_Mem[i]] = aux;
+            d_faxial_Mem_dz[3 * i + s - s1_Mem[i]] = ((-3.0 / (4.0 * HMEM[0])) + ((3.0 * pow((x - 1), 2)) / (4.0 * pow(HMEM[0], 3)))) * 2.0 / DSMEM[0];
             Fs_Mem[s] += aux;
-            sx_Mem[s] += aux * sin(2.0 * M_PI * TailPosition[0]);
-            sy_Mem[s] += aux * sin(2.0 * M_PI * TailPosition[1]);
-            cx_Mem[s] += aux * cos(2.0 * M_PI * TailPosition[0]);
-            cy_Mem[s] += aux * cos(2.0 * M_PI * TailPosition[1]);
+            sx_Mem[s] += aux * sinX_Mem[i];
+            sy_Mem[s] += aux * sinY_Mem[i];
+            cx_Mem[s] += aux * cosX_Mem[i];
+            cy_Mem[s] += aux * cosY_Mem[i];
           }
           else if (((-1.0 - HMEM[0]) < x) && (x < (-1.0 + HMEM[0])))
           {
             aux = 0.5 + ((3.0 * x + 3.0) / (4.0 * HMEM[0])) - (pow((x + 1.0), 3) / (4.0 * pow(HMEM[0], 3)));
-            faxial_Mem[i + TAILS.size() * s] = aux;
-            d_faxial_Mem_dz[i + TAILS.size() * s] = ((3.0 / (4.0 * HMEM[0])) - ((3.0 * pow((x + 1), 2)) / (4.0 * pow(HMEM[0], 3)))) * 2.0 / DSMEM[0];
+            faxial_Mem[3 * i + s - s1_Mem[i]] = aux;
+            d_faxial_Mem_dz[3 * i + s - s1_Mem[i]] = ((3.0 / (4.0 * HMEM[0])) - ((3.0 * pow((x + 1), 2)) / (4.0 * pow(HMEM[0], 3)))) * 2.0 / DSMEM[0];
             Fs_Mem[s] += aux;
-            sx_Mem[s] += (aux * sin(2.0 * M_PI * TailPosition[0]));
-            sy_Mem[s] += (aux * sin(2.0 * M_PI * TailPosition[1]));
-            cx_Mem[s] += (aux * cos(2.0 * M_PI * TailPosition[0]));
-            cy_Mem[s] += (aux * cos(2.0 * M_PI * TailPosition[1]));
+            sx_Mem[s] += (aux * sinX_Mem[i]);
+            sy_Mem[s] += (aux * sinY_Mem[i]);
+            cx_Mem[s] += (aux * cosX_Mem[i]);
+            cy_Mem[s] += (aux * cosY_Mem[i]);
           }
         }
       }
@@ -453,7 +460,7 @@ void memFusionP::calculate()
   double b_Mem = (ZETAMEM[0] / (1.0 - ZETAMEM[0])), c_Mem = ((1.0 - ZETAMEM[0]) * exp(b_Mem));
 
   // Eq. 19 Hub & Awasthi JCTC 2017.
-  std::vector<double> fradial_Mem_d_faxial_Mem_dz(TAILS.size() * NSMEM[0]);
+  std::vector<double> fradial_Mem_d_faxial_Mem_dz(3 * TAILS.size());
 
   // Eq. 20 Hub & Awasthi JCTC 2017.
   std::vector<double> Axs_Mem(NSMEM[0]), Ays_Mem(NSMEM[0]);
@@ -463,14 +470,13 @@ void memFusionP::calculate()
 
 #ifdef _OPENMP
 #if _OPENMP >= 201307
-  #pragma omp parallel for private(TailPosition,d_Xsc_Mem_dx,d_Xcc_Mem_dx,d_Ysc_Mem_dy,d_Ycc_Mem_dy,d_Xsc_Mem_dz,d_Xcc_Mem_dz,d_Ysc_Mem_dz,d_Ycc_Mem_dz,d_sx_Mem_dx,d_sy_Mem_dy,d_cx_Mem_dx,d_cy_Mem_dy,d_sx_Mem_dz,d_sy_Mem_dz,d_cx_Mem_dz,d_cy_Mem_dz,d_ws_Mem_dz,ri_Mem,x,fradial_Mem) reduction(vec_double_plus: Nsp_Mem, Axs_Mem, Ays_Mem)
+  #pragma omp parallel for private(d_Xsc_Mem_dx,d_Xcc_Mem_dx,d_Ysc_Mem_dy,d_Ycc_Mem_dy,d_Xsc_Mem_dz,d_Xcc_Mem_dz,d_Ysc_Mem_dz,d_Ycc_Mem_dz,d_sx_Mem_dx,d_sy_Mem_dy,d_cx_Mem_dx,d_cy_Mem_dy,d_sx_Mem_dz,d_sy_Mem_dz,d_cx_Mem_dz,d_cy_Mem_dz,d_ws_Mem_dz,ri_Mem,x,fradial_Mem) reduction(vec_double_plus: Nsp_Mem, Axs_Mem, Ays_Mem)
 #endif
 #endif
   for (unsigned i = 0; i < TAILS.size(); i++)
   {
     if (analyzeThisParticle_Mem[i])
     {
-      TailPosition = getPbc().realToScaled(pbcDistance(Vector(0.0, 0.0, 0.0), getPosition(i + membraneBeads)));
       d_Xsc_Mem_dx = 0.0;
       d_Xcc_Mem_dx = 0.0;
       d_Ysc_Mem_dy = 0.0;
@@ -483,20 +489,20 @@ void memFusionP::calculate()
       {
         if (Fs_Mem[s] != 0.0)
         {
-          d_sx_Mem_dx = faxial_Mem[i + TAILS.size() * s] * 2.0 * M_PI * cos(2.0 * M_PI * TailPosition[0]) / (Lx * Fs_Mem[s]);
-          d_sy_Mem_dy = faxial_Mem[i + TAILS.size() * s] * 2.0 * M_PI * cos(2.0 * M_PI * TailPosition[1]) / (Ly * Fs_Mem[s]);
-          d_cx_Mem_dx = -faxial_Mem[i + TAILS.size() * s] * 2.0 * M_PI * sin(2.0 * M_PI * TailPosition[0]) / (Lx * Fs_Mem[s]);
-          d_cy_Mem_dy = -faxial_Mem[i + TAILS.size() * s] * 2.0 * M_PI * sin(2.0 * M_PI * TailPosition[1]) / (Ly * Fs_Mem[s]);
+          d_sx_Mem_dx = faxial_Mem[3 * i + s - s1_Mem[i]] * 2.0 * M_PI * cosX_Mem[i] / (Lx * Fs_Mem[s]);
+          d_sy_Mem_dy = faxial_Mem[3 * i + s - s1_Mem[i]] * 2.0 * M_PI * cosY_Mem[i] / (Ly * Fs_Mem[s]);
+          d_cx_Mem_dx = -faxial_Mem[3 * i + s - s1_Mem[i]] * 2.0 * M_PI * sinX_Mem[i] / (Lx * Fs_Mem[s]);
+          d_cy_Mem_dy = -faxial_Mem[3 * i + s - s1_Mem[i]] * 2.0 * M_PI * sinY_Mem[i] / (Ly * Fs_Mem[s]);
           d_Xsc_Mem_dx += ws_Mem[s] * d_sx_Mem_dx / W_Mem;
           d_Xcc_Mem_dx += ws_Mem[s] * d_cx_Mem_dx / W_Mem;
           d_Ysc_Mem_dy += ws_Mem[s] * d_sy_Mem_dy / W_Mem;
           d_Ycc_Mem_dy += ws_Mem[s] * d_cy_Mem_dy / W_Mem;
 
-          d_sx_Mem_dz = d_faxial_Mem_dz[i + TAILS.size() * s] * (sin(2.0 * M_PI * TailPosition[0]) - sx_Mem[s]) / Fs_Mem[s];
-          d_sy_Mem_dz = d_faxial_Mem_dz[i + TAILS.size() * s] * (sin(2.0 * M_PI * TailPosition[1]) - sy_Mem[s]) / Fs_Mem[s];
-          d_cx_Mem_dz = d_faxial_Mem_dz[i + TAILS.size() * s] * (cos(2.0 * M_PI * TailPosition[0]) - cx_Mem[s]) / Fs_Mem[s];
-          d_cy_Mem_dz = d_faxial_Mem_dz[i + TAILS.size() * s] * (cos(2.0 * M_PI * TailPosition[1]) - cy_Mem[s]) / Fs_Mem[s];
-          d_ws_Mem_dz = (1 - pow(ws_Mem[s], 2)) * d_faxial_Mem_dz[i + TAILS.size() * s];
+          d_sx_Mem_dz = d_faxial_Mem_dz[3 * i + s - s1_Mem[i]] * (sinX_Mem[i] - sx_Mem[s]) / Fs_Mem[s];
+          d_sy_Mem_dz = d_faxial_Mem_dz[3 * i + s - s1_Mem[i]] * (sinY_Mem[i] - sy_Mem[s]) / Fs_Mem[s];
+          d_cx_Mem_dz = d_faxial_Mem_dz[3 * i + s - s1_Mem[i]] * (cosX_Mem[i] - cx_Mem[s]) / Fs_Mem[s];
+          d_cy_Mem_dz = d_faxial_Mem_dz[3 * i + s - s1_Mem[i]] * (cosY_Mem[i] - cy_Mem[s]) / Fs_Mem[s];
+          d_ws_Mem_dz = (1 - pow(ws_Mem[s], 2)) * d_faxial_Mem_dz[3 * i + s - s1_Mem[i]];
           d_Xsc_Mem_dz += (ws_Mem[s] * d_sx_Mem_dz + d_ws_Mem_dz * (sx_Mem[s] - Xsc_Mem)) / W_Mem;
           d_Xcc_Mem_dz += (ws_Mem[s] * d_cx_Mem_dz + d_ws_Mem_dz * (cx_Mem[s] - Xcc_Mem)) / W_Mem;
           d_Ysc_Mem_dz += (ws_Mem[s] * d_sy_Mem_dz + d_ws_Mem_dz * (sy_Mem[s] - Ysc_Mem)) / W_Mem;
@@ -532,10 +538,10 @@ void memFusionP::calculate()
 
         for (unsigned s = s1_Mem[i]; s <= s2_Mem[i]; s++)
         {
-          Nsp_Mem[s] += fradial_Mem * faxial_Mem[i + TAILS.size() * s];
-          Axs_Mem[s] += faxial_Mem[i + TAILS.size() * s] * d_fradial_Mem_dx[i];
-          Ays_Mem[s] += faxial_Mem[i + TAILS.size() * s] * d_fradial_Mem_dy[i];
-          fradial_Mem_d_faxial_Mem_dz[i + TAILS.size() * s] = fradial_Mem * d_faxial_Mem_dz[i + TAILS.size() * s];
+          Nsp_Mem[s] += fradial_Mem * faxial_Mem[3 * i + s - s1_Mem[i]];
+          Axs_Mem[s] += faxial_Mem[3 * i + s - s1_Mem[i]] * d_fradial_Mem_dx[i];
+          Ays_Mem[s] += faxial_Mem[3 * i + s - s1_Mem[i]] * d_fradial_Mem_dy[i];
+          fradial_Mem_d_faxial_Mem_dz[3 * i + s - s1_Mem[i]] = fradial_Mem * d_faxial_Mem_dz[3 * i + s - s1_Mem[i]];
         }
       }
     }
@@ -560,7 +566,7 @@ void memFusionP::calculate()
   Xi_Mem = Xi_Mem / NSMEM[0];
 
   // Eq. 18 Hub & Awasthi JCTC 2017.
-  std::vector<double> faxial_Mem_d_fradial_Mem_dx(TAILS.size() * NSMEM[0]), faxial_Mem_d_fradial_Mem_dy(TAILS.size() * NSMEM[0]), faxial_Mem_d_fradial_Mem_dz(TAILS.size() * NSMEM[0]);
+  std::vector<double> faxial_Mem_d_fradial_Mem_dx(3 * TAILS.size()), faxial_Mem_d_fradial_Mem_dy(3 * TAILS.size()), faxial_Mem_d_fradial_Mem_dz(3 * TAILS.size());
 
   // Eq. 13 Hub & Awasthi JCTC 2017.
   std::vector<Vector> derivatives_Mem(TAILS.size());
@@ -576,20 +582,20 @@ void memFusionP::calculate()
     {
       for (unsigned s = s1_Mem[i]; s <= s2_Mem[i]; s++)
       {
-        if (faxial_Mem[i + TAILS.size() * s])
+        if (faxial_Mem[3 * i + s - s1_Mem[i]])
         {
-          faxial_Mem_d_fradial_Mem_dx[i + TAILS.size() * s] = faxial_Mem[i + TAILS.size() * s] * d_fradial_Mem_dx[i] - d_Xcyl_Mem_dx[i] * Axs_Mem[s];
-          faxial_Mem_d_fradial_Mem_dy[i + TAILS.size() * s] = faxial_Mem[i + TAILS.size() * s] * d_fradial_Mem_dy[i] - d_Ycyl_Mem_dy[i] * Ays_Mem[s];
-          faxial_Mem_d_fradial_Mem_dz[i + TAILS.size() * s] = -d_Xcyl_Mem_dz[i] * Axs_Mem[s] - d_Ycyl_Mem_dz[i] * Ays_Mem[s];
+          faxial_Mem_d_fradial_Mem_dx[3 * i + s - s1_Mem[i]] = faxial_Mem[3 * i + s - s1_Mem[i]] * d_fradial_Mem_dx[i] - d_Xcyl_Mem_dx[i] * Axs_Mem[s];
+          faxial_Mem_d_fradial_Mem_dy[3 * i + s - s1_Mem[i]] = faxial_Mem[3 * i + s - s1_Mem[i]] * d_fradial_Mem_dy[i] - d_Ycyl_Mem_dy[i] * Ays_Mem[s];
+          faxial_Mem_d_fradial_Mem_dz[3 * i + s - s1_Mem[i]] = -d_Xcyl_Mem_dz[i] * Axs_Mem[s] - d_Ycyl_Mem_dz[i] * Ays_Mem[s];
         }
       }
 
       for (unsigned s = s1_Mem[i]; s <= s2_Mem[i]; s++)
       {
         aux = d_psi_Mem[s] / NSMEM[0];
-        derivatives_Mem[i][0] += aux * faxial_Mem_d_fradial_Mem_dx[i + TAILS.size() * s];
-        derivatives_Mem[i][1] += aux * faxial_Mem_d_fradial_Mem_dy[i + TAILS.size() * s];
-        derivatives_Mem[i][2] += aux * (faxial_Mem_d_fradial_Mem_dz[i + TAILS.size() * s] + fradial_Mem_d_faxial_Mem_dz[i + TAILS.size() * s]);
+        derivatives_Mem[i][0] += aux * faxial_Mem_d_fradial_Mem_dx[3 * i + s - s1_Mem[i]];
+        derivatives_Mem[i][1] += aux * faxial_Mem_d_fradial_Mem_dy[3 * i + s - s1_Mem[i]];
+        derivatives_Mem[i][2] += aux * (faxial_Mem_d_fradial_Mem_dz[3 * i + s - s1_Mem[i]] + fradial_Mem_d_faxial_Mem_dz[3 * i + s - s1_Mem[i]]);
       }
     }
   }
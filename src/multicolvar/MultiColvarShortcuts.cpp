@@ -22,6 +22,7 @@
 #include "MultiColvarShortcuts.h"
 #include "core/PlumedMain.h"
 #include "core/ActionSet.h"
+#include "core/ActionWithValue.h"
 #include "core/Group.h"
 
 namespace PLMD {
@@ -67,6 +68,7 @@ void MultiColvarShortcuts::shortcutKeywords( Keywords& keys ) {
   keys.addOutputComponent("mean","MEAN","scalar","the mean of the colvars");
   keys.needsAction("SUM"); keys.needsAction("MEAN"); keys.needsAction("CUSTOM"); keys.needsAction("HIGHEST"); keys.needsAction("LOWEST");
   keys.needsAction("LESS_THAN"); keys.needsAction("MORE_THAN"); keys.needsAction("BETWEEN");
+  keys.needsAction("LESS_THAN_VECTOR"); keys.needsAction("MORE_THAN_VECTOR"); keys.needsAction("BETWEEN_VECTOR"); keys.needsAction("CUSTOM_VECTOR");
 }
 
 void MultiColvarShortcuts::expandFunctions( const std::string& labout, const std::string& argin, const std::string& weights, ActionShortcut* action ) {
@@ -98,21 +100,34 @@ void MultiColvarShortcuts::parseAtomList( const std::string& key, std::vector<st
 void MultiColvarShortcuts::expandFunctions( const std::string& labout, const std::string& argin, const std::string& weights,
     const std::map<std::string,std::string>& keymap, ActionShortcut* action ) {
   if( keymap.empty() ) return;
+  // If there are no weights the functions of a vector are summed as the elements are computed so the vector of function values is never stored
+  bool fuse=false;
+  if( weights.length()==0 ) {
+    // The value is looked up directly as the shortcut does not declare the types of its arguments
+    std::size_t dot=argin.find_first_of(".");
+    ActionWithValue* av=action->plumed.getActionSet().selectWithLabel<ActionWithValue*>( argin.substr(0,dot) );
+    Value* val=NULL;
+    if( av && dot!=std::string::npos && av->exists( argin ) ) val=av->copyOutput( argin );
+    else if( av && dot==std::string::npos && av->getNumberOfComponents()==1 ) val=av->copyOutput(0);
+    fuse = val && val->getRank()==1 && !val->hasDerivatives();
+  }
   // Parse LESS_THAN
   if( keymap.count("LESS_THAN") ) {
     std::string sum_arg = labout + "_lt", lt_string = keymap.find("LESS_THAN")->second;
-    action->readInputLine( labout + "_lt: LESS_THAN ARG=" + argin + " SWITCH={" + lt_string + "}");
+    if( fuse ) action->readInputLine( labout + "_lessthan: LESS_THAN_VECTOR ARG=" + argin + " SWITCH={" + lt_string + "} SUM_ELEMENTS");
+    else action->readInputLine( labout + "_lt: LESS_THAN ARG=" + argin + " SWITCH={" + lt_string + "}");
     if( weights.length()>0 ) {
       sum_arg = labout + "_wlt";
       action->readInputLine( labout + "_wlt: CUSTOM ARG=" + weights + "," + labout + "_lt FUNC=x*y PERIODIC=NO");
     }
-    action->readInputLine( labout + "_lessthan: SUM ARG=" + sum_arg + " PERIODIC=NO");
+    if( !fuse ) action->readInputLine( labout + "_lessthan: SUM ARG=" + sum_arg + " PERIODIC=NO");
   }
   if( keymap.count("LESS_THAN1") ) {
     for(unsigned i=1;; ++i) {
       std::string istr; Tools::convert( i, istr );
       if( !keymap.count("LESS_THAN" + istr ) ) { break; }
       std::string sum_arg = labout + "_lt" + istr, lt_string1 = keymap.find("LESS_THAN" + istr)->second;
+      if( fuse ) { action->readInputLine( labout + "_lessthan-" + istr + ": LESS_THAN_VECTOR ARG=" + argin + " SWITCH={" + lt_string1 + "} SUM_ELEMENTS"); continue; }
       action->readInputLine( labout + "_lt" + istr + ": LESS_THAN ARG=" + argin + " SWITCH={" + lt_string1 + "}");
       if( weights.length()>0 ) {
         sum_arg = labout + "_wlt" + istr;
@@ -124,22 +139,24 @@ void MultiColvarShortcuts::expandFunctions( const std::string& labout, const std
   // Parse MORE_THAN
   if( keymap.count("MORE_THAN") ) {
     std::string sum_arg=labout + "_mt", mt_string = keymap.find("MORE_THAN")->second;
-    action->readInputLine( labout + "_mt: MORE_THAN ARG=" + argin + " SWITCH={" + mt_string + "}");
+    if( fuse ) action->readInputLine( labout + "_morethan: MORE_THAN_VECTOR ARG=" + argin + " SWITCH={" + mt_string + "} SUM_ELEMENTS");
+    else action->readInputLine( labout + "_mt: MORE_THAN ARG=" + argin + " SWITCH={" + mt_string + "}");
     if( weights.length()>0 ) {
       sum_arg = labout + "_wmt";
       action->readInputLine( labout + "_wmt: CUSTOM ARG=" + weights + "," + labout + "_mt FUNC=x*y PERIODIC=NO" );
     }
-    action->readInputLine( labout + "_morethan: SUM ARG=" + sum_arg + " PERIODIC=NO");
+    if( !fuse ) action->readInputLine( labout + "_morethan: SUM ARG=" + sum_arg + " PERIODIC=NO");
   }
   if(  keymap.count("MORE_THAN1") ) {
     for(unsigned i=1;; ++i) {
       std::string istr; Tools::convert( i, istr );
       if( !keymap.count("MORE_THAN" + istr ) ) { break; }
       std::string sum_arg = labout + "_mt" + istr, mt_string1 = keymap.find("MORE_THAN" + istr)->second;
+      if( fuse ) { action->readInputLine( labout + "_morethan-" + istr + ": MORE_THAN_VECTOR ARG=" + argin + " SWITCH={" + mt_string1 + "} SUM_ELEMENTS"); continue; }
       action->readInputLine( labout + "_mt" + istr + ": MORE_THAN ARG=" + argin + " SWITCH={" + mt_string1 + "}");
       if( weights.length()>0 ) {
         sum_arg = labout + "_wmt" + istr;
-        action->readInputLine( labout + "_wmt" + istr + ": CUSTOM ARG=" + weights + "," + labout + "_lt" + istr + " FUNC=x*y PERIODIC=NO");
+        action->readInputLine( labout + "_wmt" + istr + ": CUSTOM ARG=" + weights + "," + labout + "_mt" + istr + " FUNC=x*y PERIODIC=NO");
       }
       action->readInputLine( labout + "_morethan-" + istr + ": SUM ARG=" + sum_arg + " PERIODIC=NO");
     }
@@ -150,8 +167,11 @@ void MultiColvarShortcuts::expandFunctions( const std::string& labout, const std
     std::string amin_string = keymap.find("ALT_MIN")->second;
     std::size_t dd = amin_string.find("BETA"); std::string beta_str = amin_string.substr(dd+5);
     beta_str.erase(std::remove_if(beta_str.begin(), beta_str.end(), ::isspace), beta_str.end());
-    action->readInputLine( labout + "_me_altmin: CUSTOM ARG=" + argin + " FUNC=exp(-x*" + beta_str + ") PERIODIC=NO");
-    action->readInputLine( labout + "_mec_altmin: SUM ARG=" + labout + "_me_altmin PERIODIC=NO");
+    if( fuse ) action->readInputLine( labout + "_mec_altmin: CUSTOM_VECTOR ARG=" + argin + " FUNC=exp(-x*" + beta_str + ") PERIODIC=NO SUM_ELEMENTS");
+    else {
+      action->readInputLine( labout + "_me_altmin: CUSTOM ARG=" + argin + " FUNC=exp(-x*" + beta_str + ") PERIODIC=NO");
+      action->readInputLine( labout + "_mec_altmin: SUM ARG=" + labout + "_me_altmin PERIODIC=NO");
+    }
     action->readInputLine( labout + "_altmin: CUSTOM ARG=" + labout + "_mec_altmin FUNC=-log(x)/" + beta_str + " PERIODIC=NO");
   }
   // Parse MIN
@@ -160,8 +180,11 @@ void MultiColvarShortcuts::expandFunctions( const std::string& labout, const std
     std::string min_string = keymap.find("MIN")->second;
     std::size_t dd = min_string.find("BETA"); std::string beta_str = min_string.substr(dd+5);
     beta_str.erase(std::remove_if(beta_str.begin(), beta_str.end(), ::isspace), beta_str.end());
-    action->readInputLine( labout + "_me_min: CUSTOM ARG=" + argin + " FUNC=exp(" + beta_str + "/x) PERIODIC=NO");
-    action->readInputLine( labout + "_mec_min: SUM ARG=" + labout + "_me_min PERIODIC=NO");
+    if( fuse ) action->readInputLine( labout + "_mec_min: CUSTOM_VECTOR ARG=" + argin + " FUNC=exp(" + beta_str + "/x) PERIODIC=NO SUM_ELEMENTS");
+    else {
+      action->readInputLine( labout + "_me_min: CUSTOM ARG=" + argin + " FUNC=exp(" + beta_str + "/x) PERIODIC=NO");
+      action->readInputLine( labout + "_mec_min: SUM ARG=" + labout + "_me_min PERIODIC=NO");
+    }
     action->readInputLine( labout + "_min: CUSTOM ARG=" + labout + "_mec_min FUNC=" + beta_str + "/log(x) PERIODIC=NO");
   }
   // Parse MAX
@@ -170,8 +193,11 @@ void MultiColvarShortcuts::expandFunctions( const std::string& labout, const std
     std::string max_string = keymap.find("MAX")->second;
     std::size_t dd = max_string.find("BETA"); std::string beta_str = max_string.substr(dd+5);
     beta_str.erase(std::remove_if(beta_str.begin(), beta_str.end(), ::isspace), beta_str.end());
-    action->readInputLine( labout + "_me_max: CUSTOM ARG=" + argin + " FUNC=exp(x/" + beta_str + ") PERIODIC=NO");
-    action->readInputLine( labout + "_mec_max: SUM ARG=" + labout + "_me_max PERIODIC=NO");
+    if( fuse ) action->readInputLine( labout + "_mec_max: CUSTOM_VECTOR ARG=" + argin + " FUNC=exp(x/" + beta_str + ") PERIODIC=NO SUM_ELEMENTS");
+    else {
+      action->readInputLine( labout + "_me_max: CUSTOM ARG=" + argin + " FUNC=exp(x/" + beta_str + ") PERIODIC=NO");
+      action->readInputLine( labout + "_mec_max: SUM ARG=" + labout + "_me_max PERIODIC=NO");
+    }
     action->readInputLine( labout + "_max: CUSTOM ARG=" + labout + "_mec_max FUNC=" + beta_str  + "*log(x) PERIODIC=NO");
   }
   // Parse HIGHEST
@@ -201,12 +227,13 @@ void MultiColvarShortcuts::expandFunctions( const std::string& labout, const std
   // Parse BETWEEN
   if( keymap.count("BETWEEN") ) {
     std::string sum_arg=labout + "_bt", bt_string = keymap.find("BETWEEN")->second;
-    action->readInputLine( labout + "_bt: BETWEEN ARG=" + argin + " SWITCH={" + bt_string + "}" );
+    if( fuse ) action->readInputLine( labout + "_between: BETWEEN_VECTOR ARG=" + argin + " SWITCH={" + bt_string + "} SUM_ELEMENTS");
+    else action->readInputLine( labout + "_bt: BETWEEN ARG=" + argin + " SWITCH={" + bt_string + "}" );
     if( weights.length()>0 ) {
       sum_arg = labout + "_wbt";
       action->readInputLine( labout + "_wbt: CUSTOM ARG=" + weights + "," + labout + "_bt FUNC=x*y PERIODIC=NO");
     }
-    action->readInputLine( labout + "_between: SUM ARG=" + sum_arg + " PERIODIC=NO");
+    if( !fuse ) action->readInputLine( labout + "_between: SUM ARG=" + sum_arg + " PERIODIC=NO");
   }
   std::string bt_string1;
   if( keymap.count("BETWEEN1") ) {
@@ -214,6 +241,7 @@ void MultiColvarShortcuts::expandFunctions( const std::string& labout, const std
       std::string istr; Tools::convert( i, istr );
       if( !keymap.count("BETWEEN" + istr) ) break;
       std::string sum_arg=labout + "_bt" + istr, bt_string1 = keymap.find("BETWEEN" + istr)->second;
+      if( fuse ) { action->readInputLine( labout + "_between-" + istr + ": BETWEEN_VECTOR ARG=" + argin + " SWITCH={" + bt_string1 + "} SUM_ELEMENTS"); continue; }
       action->readInputLine( labout + "_bt" + istr + ": BETWEEN ARG=" + argin + " SWITCH={" + bt_string1 + "}" );
       if( weights.length()>0 ) {
         sum_arg = labout + "_wbt" + istr;
@@ -126,7 +126,9 @@ private:
   std::vector<const double *> ECVs_;
   std::vector<const double *> derECVs_;
   std::vector<opes::ExpansionCVs*> pntrToECVsClass_;
-  std::vector< std::vector<unsigned> > index_k_;
+  std::vector< std::vector<unsigned> > index_k_; //index_k_[j][i] is the ECV of CV j used by deltaF i, contiguous in i
+  std::vector<double> expansion_; //the expansion of all the deltaFs, see computeExpansions()
+  std::vector<double> add_; //the weight of each deltaF in the log-sum-exp
 // A note on indexes usage:
 //  j -> underlying CVs
 //  i -> DeltaFs
@@ -168,6 +170,8 @@ private:
   void dumpStateToFile();
   void updateDeltaF(double);
   double getExpansion(const unsigned) const;
+  void computeExpansions();
+  double getLogSumExp(double&);
 
 public:
   explicit OPESexpanded(const ActionOptions&);
@@ -525,59 +529,24 @@ void OPESexpanded::calculate()
   if(deltaF_size_==0) //no bias before initialization
     return;
 
-//get diffMax, to avoid over/underflow
-  double diffMax=-std::numeric_limits<double>::max();
-  #pragma omp parallel num_threads(NumOMP_)
-  {
-    #pragma omp for reduction(max:diffMax)
-    for(unsigned i=0; i<deltaF_.size(); i++)
-    {
-      diff_[i]=(-getExpansion(i)+deltaF_[i]/kbt_);
-      if(diff_[i]>diffMax)
-        diffMax=diff_[i];
-    }
-  }
-  if(NumParallel_>1)
-    comm.Max(diffMax);
-
 //calculate the bias and the forces
   double sum=0;
+  const double diffMax=getLogSumExp(sum);
   std::vector<double> der_sum_cv(ncv_,0);
-  if(NumOMP_==1)
-  {
-    for(unsigned i=0; i<deltaF_.size(); i++)
-    {
-      double add_i=std::exp(diff_[i]-diffMax);
-      sum+=add_i;
-      //set derivatives
-      for(unsigned j=0; j<ncv_; j++)
-        der_sum_cv[j]-=derECVs_[j][index_k_[i][j]]*add_i;
-    }
-  }
-  else
+  const unsigned size=deltaF_.size();
+  const double * add=add_.data();
+  for(unsigned j=0; j<ncv_; j++)
   {
-    #pragma omp parallel num_threads(NumOMP_)
-    {
-      std::vector<double> omp_der_sum_cv(ncv_,0);
-      #pragma omp for reduction(+:sum) nowait
-      for(unsigned i=0; i<deltaF_.size(); i++)
-      {
-        double add_i=std::exp(diff_[i]-diffMax);
-        sum+=add_i;
-        //set derivatives
-        for(unsigned j=0; j<ncv_; j++)
-          omp_der_sum_cv[j]-=derECVs_[j][index_k_[i][j]]*add_i;
-      }
-      #pragma omp critical
-      for(unsigned j=0; j<ncv_; j++)
-        der_sum_cv[j]+=omp_der_sum_cv[j];
-    }
+    const double * derECVs=derECVs_[j];
+    const unsigned * index=index_k_[j].data();
+    double der_j=0;
+    #pragma omp parallel for simd num_threads(NumOMP_) reduction(+:der_j)
+    for(unsigned i=0; i<size; i++)
+      der_j+=derECVs[index[i]]*add[i];
+    der_sum_cv[j]-=der_j;
   }
-  if(NumParallel_>1)
-  { //each MPI process has part of the full deltaF_ vector, so must Sum
-    comm.Sum(sum);
+  if(NumParallel_>1) //each MPI process has part of the full deltaF_ vector, so must Sum
     comm.Sum(der_sum_cv);
-  }
 
 //set bias and forces
   const double bias=-kbt_*(diffMax+std::log(sum/deltaF_size_));
@@ -649,31 +618,9 @@ void OPESexpanded::update()
 
     //calculate work if requested
     if(calc_work_)
-    { //some copy and paste from calculate()
-      //get diffMax, to avoid over/underflow
-      double diffMax=-std::numeric_limits<double>::max();
-      #pragma omp parallel num_threads(NumOMP_)
-      {
-        #pragma omp for reduction(max:diffMax)
-        for(unsigned i=0; i<deltaF_.size(); i++)
-        {
-          diff_[i]=(-getExpansion(i)+deltaF_[i]/kbt_);
-          if(diff_[i]>diffMax)
-            diffMax=diff_[i];
-        }
-      }
-      if(NumParallel_>1)
-        comm.Max(diffMax);
-      //calculate the bias
+    {
       double sum=0;
-      #pragma omp parallel num_threads(NumOMP_)
-      {
-        #pragma omp for reduction(+:sum) nowait
-        for(unsigned i=0; i<deltaF_.size(); i++)
-          sum+=std::exp(diff_[i]-diffMax);
-      }
-      if(NumParallel_>1)
-        comm.Sum(sum);
+      const double diffMax=getLogSumExp(sum);
       const double new_bias=-kbt_*(diffMax+std::log(sum/deltaF_size_));
       //accumulate work
       work_+=new_bias-current_bias;
@@ -748,9 +695,11 @@ void OPESexpanded::init_linkECVs()
     }
   }
   diff_.resize(deltaF_.size());
+  expansion_.resize(deltaF_.size());
+  add_.resize(deltaF_.size());
   ECVs_.resize(ncv_);
   derECVs_.resize(ncv_);
-  index_k_.resize(deltaF_.size(),std::vector<unsigned>(ncv_));
+  index_k_.resize(ncv_,std::vector<unsigned>(deltaF_.size()));
   unsigned index_j=0;
   unsigned sizeSkip=deltaF_size_;
   for(unsigned l=0; l<pntrToECVsClass_.size(); l++)
@@ -766,14 +715,14 @@ void OPESexpanded::init_linkECVs()
       if(NumParallel_==1)
       {
         for(unsigned i=0; i<deltaF_size_; i++)
-          index_k_[i][index_j+h]=l_index_k[(i/sizeSkip)%l_index_k.size()][h];
+          index_k_[index_j+h][i]=l_index_k[(i/sizeSkip)%l_index_k.size()][h];
       }
       else
       {
         const unsigned start=(deltaF_size_/NumParallel_)*rank_+std::min(rank_,deltaF_size_%NumParallel_);
         unsigned iter=0;
         for(unsigned i=start; i<start+deltaF_.size(); i++)
-          index_k_[iter++][index_j+h]=l_index_k[(i/sizeSkip)%l_index_k.size()][h];
+          index_k_[index_j+h][iter++]=l_index_k[(i/sizeSkip)%l_index_k.size()][h];
       }
     }
     index_j+=pntrToECVsClass_[l]->getNumberOfArguments();
@@ -812,7 +761,7 @@ void OPESexpanded::init_fromObs() //This could probably be faster and/or require
   index_j=0;
   for(unsigned i=0; i<deltaF_.size(); i++)
     for(unsigned j=0; j<ncv_; j++)
-      deltaF_[i]+=kbt_*ECVs_[j][index_k_[i][j]];
+      deltaF_[i]+=kbt_*ECVs_[j][index_k_[j][i]];
   for(unsigned t=1; t<obs_steps_; t++) //starts from t=1
   {
     unsigned index_j=0;
@@ -821,9 +770,10 @@ void OPESexpanded::init_fromObs() //This could probably be faster and/or require
       pntrToECVsClass_[l]->calculateECVs(&obs_cvs_[t*ncv_+index_j]);
       index_j+=pntrToECVsClass_[l]->getNumberOfArguments();
     }
+    computeExpansions();
     for(unsigned i=0; i<deltaF_.size(); i++)
     {
-      const double diff_i=(-getExpansion(i)+deltaF_[i]/kbt_-std::log(t));
+      const double diff_i=(-expansion_[i]+deltaF_[i]/kbt_-std::log(t));
       if(diff_i>0) //save exp from overflow
         deltaF_[i]-=kbt_*(diff_i+std::log1p(std::exp(-diff_i))+std::log1p(-1./(1.+t)));
       else
@@ -915,12 +865,13 @@ void OPESexpanded::updateDeltaF(double bias)
     increment=kbt_*(arg+std::log1p(std::exp(-arg)));
   else
     increment=kbt_*(std::log1p(std::exp(arg)));
+  computeExpansions();
   #pragma omp parallel num_threads(NumOMP_)
   {
     #pragma omp for
     for(unsigned i=0; i<deltaF_.size(); i++)
     {
-      const double diff_i=(-getExpansion(i)+(bias-rct_+deltaF_[i])/kbt_-std::log(counter_-1.));
+      const double diff_i=(-expansion_[i]+(bias-rct_+deltaF_[i])/kbt_-std::log(counter_-1.));
       if(diff_i>0) //save exp from overflow
         deltaF_[i]+=increment-kbt_*(diff_i+std::log1p(std::exp(-diff_i)));
       else
@@ -934,9 +885,55 @@ double OPESexpanded::getExpansion(unsigned i) const
 {
   double expansion=0;
   for(unsigned j=0; j<ncv_; j++)
-    expansion+=ECVs_[j][index_k_[i][j]]; //the index_k could be trivially guessed for most ECVs, but unfourtunately not all
+    expansion+=ECVs_[j][index_k_[j][i]]; //the index_k could be trivially guessed for most ECVs, but unfourtunately not all
   return expansion;
 }
 
+void OPESexpanded::computeExpansions()
+{ //same as getExpansion, but for all the deltaFs at once with contiguous loops over them
+  const unsigned size=deltaF_.size();
+  double * expansion=expansion_.data();
+  std::fill(expansion_.begin(),expansion_.end(),0.);
+  for(unsigned j=0; j<ncv_; j++)
+  {
+    const double * ECVs=ECVs_[j];
+    const unsigned * index=index_k_[j].data();
+    #pragma omp parallel for simd num_threads(NumOMP_)
+    for(unsigned i=0; i<size; i++)
+      expansion[i]+=ECVs[index[i]];
+  }
+}
+
+double OPESexpanded::getLogSumExp(double& sum)
+{ //sets diff_ and add_, returns diffMax and the sum of add_ over all the deltaFs, so that the bias is -kbt_*(diffMax+log(sum/deltaF_size_))
+  computeExpansions();
+  const unsigned size=deltaF_.size();
+  const double * expansion=expansion_.data();
+  const double * deltaF=deltaF_.data();
+  double * diff=diff_.data();
+  double * add=add_.data();
+  const double ikbt=1./kbt_;
+//get diffMax, to avoid over/underflow
+  double diffMax=-std::numeric_limits<double>::max();
+  #pragma omp parallel for simd num_threads(NumOMP_) reduction(max:diffMax)
+  for(unsigned i=0; i<size; i++)
+  {
+    diff[i]=-expansion[i]+deltaF[i]*ikbt;
+    diffMax=std::max(diffMax,diff[i]);
+  }
+  if(NumParallel_>1)
+    comm.Max(diffMax);
+  sum=0;
+  #pragma omp parallel for simd num_threads(NumOMP_) reduction(+:sum)
+  for(unsigned i=0; i<size; i++)
+  {
+    add[i]=std::exp(diff[i]-diffMax);
+    sum+=add[i];
+  }
+  if(NumParallel_>1)
+    comm.Sum(sum);
+  return diffMax;
+}
+
 }
 }
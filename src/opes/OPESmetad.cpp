@@ -22,6 +22,8 @@
 #include "tools/Communicator.h"
 #include "tools/File.h"
 #include "tools/OpenMP.h"
+#include "tools/KernelCells.h"
+#include "tools/SharedRingBuffer.h"
 
 namespace PLMD {
 namespace opes {
@@ -82,7 +84,18 @@ For an exact restart you must use STATE_RFILE to read a checkpoint with all the
 To save such checkpoints, define a STATE_WFILE and choose how often to print them with STATE_WSTRIDE.
 By default this file is overwritten, but you can instead append to it using the flag STORE_STATES.
 
-Multiple walkers are supported only with MPI communication, via the keyword WALKERS_MPI.
+Multiple walkers are supported with MPI communication, via the keyword WALKERS_MPI.
+Walkers that run as separate processes on the same node can instead share their kernels
+through shared memory, using WALKERS_SHM=name and giving each of them a different WALKERS_ID.
+Each walker appends its new kernels to a ring buffer in the shared memory segment with this name,
+and at every PACE it adds to its bias all the kernels published so far, its own included.
+Since all the walkers add the kernels in the same order, the compression gives the same result on all of them.
+Walkers do not wait for each other, so the kernels of the others can be added with a delay of a few PACE.
+Each walker writes all the kernels in its own KERNELS file, so a different FILE should be used for each of them.
+The segment is kept after the run so that the walkers can be restarted. When a new
+simulation that is not a restart is started, the walker with WALKERS_ID=0 replaces the
+segment of the previous run with a new one, and the other walkers wait for it.
+At most 64 walkers can share a segment.
 
 \par Examples
 
@@ -173,6 +186,10 @@ private:
   unsigned rank_;
   unsigned NumWalkers_;
   unsigned walker_rank_;
+//kernels exchanged through shared memory by walkers on the same node
+  std::string walkers_shm_;
+  int walkers_shm_id_;
+  std::unique_ptr<SharedRingBuffer> walkers_shm_buffer_;
   unsigned long long counter_;
   std::size_t ncv_;
 
@@ -223,6 +240,11 @@ private:
   unsigned nlist_steps_;
   bool nlist_update_;
   bool nlist_pace_reset_;
+//cells in CV space that contain the kernels, used with KERNEL_CELLS
+  bool kernel_cells_;
+  KernelCells kernel_cells_grid_;
+  std::vector<unsigned> kernel_cells_candidates_;
+  void addToKernelCells(const unsigned);
 
   bool calc_work_;
   double work_;
@@ -241,6 +263,7 @@ private:
   void addKernel(const double,const std::vector<double>&,const std::vector<double>&,const double); //also print to file
   unsigned getMergeableKernel(const std::vector<double>&,const unsigned);
   void updateNlist(const std::vector<double>&);
+  void addSharedKernels(const double,const std::vector<double>&,const std::vector<double>&,const double);
   void dumpStateToFile();
 
 public:
@@ -248,6 +271,14 @@ public:
   void calculate() override;
   void update() override;
   static void registerKeywords(Keywords& keys);
+//with a neighbor list only the kernels close to the current CVs are summed
+  bool canComputeBiasFromArguments() const override {return !nlist_;}
+  double computeBiasFromArguments(const std::vector<double>& args) override
+  {
+    std::vector<double> der_prob(ncv_,0);
+    const double prob=getProbAndDerivatives(args,der_prob);
+    return kbt_*bias_prefactor_*std::log(prob/Zed_+epsilon_);
+  }
 };
 
 struct convergence { static const bool explore=false; };
@@ -325,6 +356,7 @@ void OPESmetad<mode>::registerKeywords(Keywords& keys)
   keys.add("optional","NLIST_PARAMETERS","( default=3.0,0.5 ) the two cutoff parameters for the kernels neighbor list");
   keys.addFlag("NLIST",false,"use neighbor list for kernels summation, faster but experimental");
   keys.addFlag("NLIST_PACE_RESET",false,"force the reset of the neighbor list at each PACE. Can be useful with WALKERS_MPI");
+  keys.addFlag("KERNEL_CELLS",false,"store the kernels in cells in CV space, so that only the kernels close to the CVs are searched for merging and summed for the bias");
   keys.addFlag("FIXED_SIGMA",false,"do not decrease sigma as the simulation proceeds. Can be added in a RESTART, to keep in check the number of compressed kernels");
   keys.addFlag("RECURSIVE_MERGE_OFF",false,"do not recursively attempt kernel merging when a new one is added");
   keys.addFlag("NO_ZED",false,"do not normalize over the explored CV space, Z_n=1");
@@ -341,6 +373,9 @@ void OPESmetad<mode>::registerKeywords(Keywords& keys)
     keys.addInputKeyword("optional","EXTRA_BIAS","scalar","consider also these other bias potentials for the internal reweighting. This can be used e.g. for sampling a custom target distribution (see example above)");
   keys.addFlag("CALC_WORK",false,"calculate the total accumulated work done by the bias since last restart");
   keys.addFlag("WALKERS_MPI",false,"switch on MPI version of multiple walkers");
+  keys.add("optional","WALKERS_SHM","name of a shared memory segment that is used to exchange the kernels between walkers running on the same node");
+  keys.add("optional","WALKERS_ID","the id of this walker when using WALKERS_SHM");
+  keys.add("optional","WALKERS_SHM_SIZE","(default=100000) the number of kernels that are kept in the shared memory segment");
   keys.addFlag("SERIAL",false,"perform calculations in serial");
   keys.use("RESTART");
   keys.use("UPDATE_FROM");
@@ -488,6 +523,22 @@ OPESmetad<mode>::OPESmetad(const ActionOptions& ao)
   nlist_dev2_.resize(ncv_,0.);
   nlist_steps_=0;
   nlist_update_=true;
+  kernel_cells_=false;
+  parseFlag("KERNEL_CELLS",kernel_cells_);
+  if(kernel_cells_)
+  {
+    std::vector<double> cmin(ncv_,0.), cperiod(ncv_,0.);
+    for(unsigned i=0; i<ncv_; i++)
+    {
+      if(!getPntrToArgument(i)->isPeriodic())
+        continue;
+      double min,max;
+      getPntrToArgument(i)->getDomain(min,max);
+      cmin[i]=min;
+      cperiod[i]=max-min;
+    }
+    kernel_cells_grid_.setup(cmin,cperiod,cutoff);
+  }
 
 //optional stuff
   no_Zed_=false;
@@ -564,6 +615,21 @@ OPESmetad<mode>::OPESmetad(const ActionOptions& ao)
     NumWalkers_=1;
     walker_rank_=0;
   }
+  parse("WALKERS_SHM",walkers_shm_);
+  walkers_shm_id_=-1;
+  parse("WALKERS_ID",walkers_shm_id_);
+  unsigned walkers_shm_size=100000;
+  parse("WALKERS_SHM_SIZE",walkers_shm_size);
+  if(walkers_shm_.length()>0)
+  {
+    plumed_massert(!walkers_mpi,"WALKERS_SHM cannot be used together with WALKERS_MPI");
+    plumed_massert(walkers_shm_id_>=0,"WALKERS_SHM requires a non negative WALKERS_ID");
+    plumed_massert(!nlist_,"WALKERS_SHM cannot be used together with NLIST");
+    plumed_massert(SharedRingBuffer::available(),"WALKERS_SHM is not available on this system");
+    //record layout: walker id, log weight, height, center, sigma
+    if(comm.Get_rank()==0)
+      walkers_shm_buffer_=Tools::make_unique<SharedRingBuffer>(walkers_shm_,3+2*ncv_,walkers_shm_size,walkers_shm_id_,!getRestart());
+  }
 
 //parallelization stuff
   NumOMP_=OpenMP::getNumThreads();
@@ -706,6 +772,8 @@ OPESmetad<mode>::OPESmetad(const ActionOptions& ao)
           ifile.scanField("height",height);
           ifile.scanField();
           kernels_.emplace_back(height,center,sigma);
+          if(kernel_cells_)
+            addToKernelCells(kernels_.size()-1);
         }
         log.printf("    a total of %lu kernels where read\n",kernels_.size());
       }
@@ -771,6 +839,10 @@ OPESmetad<mode>::OPESmetad(const ActionOptions& ao)
   else if(restartFileName.length()>0)
     log.printf(" +++ WARNING +++ the provided STATE_RFILE will be ignored, since RESTART was not requested\n");
 
+//the kernels already in the shared memory segment have been read from the files
+  if(walkers_shm_buffer_ && getRestart())
+    walkers_shm_buffer_->skipToEnd();
+
 //sync all walkers to avoid opening files before reading is over (see also METAD)
   comm.Barrier();
   if(comm.Get_rank()==0 && walkers_mpi)
@@ -904,6 +976,8 @@ OPESmetad<mode>::OPESmetad(const ActionOptions& ao)
     log.printf(" -- NLIST: using neighbor list for kernels, with parameters: %g,%g\n",nlist_param_[0],nlist_param_[1]);
   if(nlist_pace_reset_)
     log.printf(" -- NLIST_PACE_RESET: forcing the neighbor list to update every PACE\n");
+  if(kernel_cells_)
+    log.printf(" -- KERNEL_CELLS: kernels are stored in cells in CV space as wide as the KERNEL_CUTOFF\n");
   if(no_Zed_)
     log.printf(" -- NO_ZED: using fixed normalization factor = %g\n",Zed_);
   if(wStateStride_>0)
@@ -912,6 +986,8 @@ OPESmetad<mode>::OPESmetad(const ActionOptions& ao)
     log.printf("  state checkpoints are written on file %s only on CPT events (or never if MD code does define them!)\n",stateFileName.c_str());
   if(walkers_mpi)
     log.printf(" -- WALKERS_MPI: if multiple replicas are present, they will share the same bias via MPI\n");
+  if(walkers_shm_.length()>0)
+    log.printf(" -- WALKERS_SHM: walker %d shares the kernels through shared memory segment %s holding %u kernels\n",walkers_shm_id_,walkers_shm_.c_str(),walkers_shm_size);
   if(NumWalkers_>1)
   {
     log.printf("  using multiple walkers\n");
@@ -1109,7 +1185,9 @@ void OPESmetad<mode>::update()
       center[i]=getArgument(i);
 
     //add new kernel(s)
-    if(NumWalkers_==1)
+    if(walkers_shm_.length()>0)
+      addSharedKernels(height,center,sigma,log_weight);
+    else if(NumWalkers_==1)
       addKernel(height,center,sigma,log_weight);
     else
     {
@@ -1264,7 +1342,16 @@ template <class mode>
 double OPESmetad<mode>::getProbAndDerivatives(const std::vector<double>& cv,std::vector<double>& der_prob)
 {
   double prob=0.0;
-  if(!nlist_)
+  //with KERNEL_CELLS only the kernels in the cells around cv are summed
+  const std::vector<unsigned>* index=NULL;
+  if(nlist_)
+    index=&nlist_index_;
+  else if(kernel_cells_)
+  {
+    kernel_cells_grid_.getCandidates(cv,std::sqrt(cutoff2_),kernel_cells_candidates_);
+    index=&kernel_cells_candidates_;
+  }
+  if(!index)
   {
     if(NumOMP_==1 || (unsigned)kernels_.size()<2*NumOMP_*NumParallel_)
     {
@@ -1291,12 +1378,12 @@ double OPESmetad<mode>::getProbAndDerivatives(const std::vector<double>& cv,std:
   }
   else
   {
-    if(NumOMP_==1 || (unsigned)nlist_index_.size()<2*NumOMP_*NumParallel_)
+    if(NumOMP_==1 || (unsigned)index->size()<2*NumOMP_*NumParallel_)
     {
       // for performances and thread safety
       std::vector<double> dist(ncv_);
-      for(unsigned nk=rank_; nk<nlist_index_.size(); nk+=NumParallel_)
-        prob+=evaluateKernel(kernels_[nlist_index_[nk]],cv,der_prob,dist);
+      for(unsigned nk=rank_; nk<index->size(); nk+=NumParallel_)
+        prob+=evaluateKernel(kernels_[(*index)[nk]],cv,der_prob,dist);
     }
     else
     {
@@ -1306,8 +1393,8 @@ double OPESmetad<mode>::getProbAndDerivatives(const std::vector<double>& cv,std:
         // for performances and thread safety
         std::vector<double> dist(ncv_);
         #pragma omp for reduction(+:prob) nowait
-        for(unsigned nk=rank_; nk<nlist_index_.size(); nk+=NumParallel_)
-          prob+=evaluateKernel(kernels_[nlist_index_[nk]],cv,omp_deriv,dist);
+        for(unsigned nk=rank_; nk<index->size(); nk+=NumParallel_)
+          prob+=evaluateKernel(kernels_[(*index)[nk]],cv,omp_deriv,dist);
         #pragma omp critical
         for(unsigned i=0; i<ncv_; i++)
           der_prob[i]+=omp_deriv[i];
@@ -1338,7 +1425,11 @@ void OPESmetad<mode>::addKernel(const double height,const std::vector<double>& c
     {
       no_match=false;
       delta_kernels_.emplace_back(-1*kernels_[taker_k].height,kernels_[taker_k].center,kernels_[taker_k].sigma);
+      if(kernel_cells_)
+        kernel_cells_grid_.remove(kernels_[taker_k].center,taker_k);
       mergeKernels(kernels_[taker_k],kernel(height,center,sigma));
+      if(kernel_cells_)
+        addToKernelCells(taker_k);
       delta_kernels_.push_back(kernels_[taker_k]);
       if(recursive_merge_) //the overhead is worth it if it keeps low the total number of kernels
       {
@@ -1350,9 +1441,16 @@ void OPESmetad<mode>::addKernel(const double height,const std::vector<double>& c
           delta_kernels_.emplace_back(-1*kernels_[taker_k].height,kernels_[taker_k].center,kernels_[taker_k].sigma);
           if(taker_k>giver_k) //saves time when erasing
             std::swap(taker_k,giver_k);
+          if(kernel_cells_)
+          {
+            kernel_cells_grid_.remove(kernels_[taker_k].center,taker_k);
+            kernel_cells_grid_.remove(kernels_[giver_k].center,giver_k,true); //the indexes above giver_k shift due to erase
+          }
           mergeKernels(kernels_[taker_k],kernels_[giver_k]);
           delta_kernels_.push_back(kernels_[taker_k]);
           kernels_.erase(kernels_.begin()+giver_k);
+          if(kernel_cells_)
+            addToKernelCells(taker_k);
           if(nlist_)
           {
             unsigned giver_nk=0;
@@ -1382,7 +1480,22 @@ void OPESmetad<mode>::addKernel(const double height,const std::vector<double>& c
     delta_kernels_.emplace_back(height,center,sigma);
     if(nlist_)
       nlist_index_.push_back(kernels_.size()-1);
+    if(kernel_cells_)
+      addToKernelCells(kernels_.size()-1);
+  }
+}
+
+template <class mode>
+void OPESmetad<mode>::addToKernelCells(const unsigned k)
+{
+  if(!kernel_cells_grid_.updateWidths(kernels_[k].sigma))
+  {
+    kernel_cells_grid_.add(kernels_[k].center,k);
+    return;
   }
+  //the cells were too narrow for this kernel and have been emptied
+  for(unsigned kk=0; kk<kernels_.size(); kk++)
+    kernel_cells_grid_.add(kernels_[kk].center,kk);
 }
 
 template <class mode>
@@ -1400,12 +1513,76 @@ void OPESmetad<mode>::addKernel(const double height,const std::vector<double>& c
   kernelsOfile_.printField();
 }
 
+template <class mode>
+void OPESmetad<mode>::addSharedKernels(const double height,const std::vector<double>& center,const std::vector<double>& sigma,const double logweight)
+{
+//the own kernel is also added when read back, so that all walkers merge the kernels in the same order
+  const unsigned recsize=3+2*ncv_;
+  std::vector<double> recs;
+  unsigned nrec=0;
+  if(comm.Get_rank()==0)
+  {
+    std::vector<double> rec(recsize);
+    rec[0]=walkers_shm_id_;
+    rec[1]=logweight;
+    rec[2]=height;
+    for(unsigned i=0; i<ncv_; i++)
+    {
+      rec[3+i]=center[i];
+      rec[3+ncv_+i]=sigma[i];
+    }
+    walkers_shm_buffer_->push(rec);
+    nrec=walkers_shm_buffer_->pull(recs);
+  }
+  comm.Bcast(nrec,0);
+  if(nrec==0)
+    return;
+  recs.resize(nrec*recsize);
+  comm.Bcast(recs,0);
+  std::vector<double> center_w(ncv_);
+  std::vector<double> sigma_w(ncv_);
+  bool others=false;
+  for(unsigned k=0; k<nrec; k++)
+  {
+    const double* rec=recs.data()+k*recsize;
+    if(static_cast<int>(rec[0])!=walkers_shm_id_)
+    { //the weights of this walker have already been accounted for
+      const double w=std::exp(rec[1]);
+      counter_++;
+      sum_weights_+=w;
+      sum_weights2_+=w*w;
+      others=true;
+    }
+    for(unsigned i=0; i<ncv_; i++)
+    {
+      center_w[i]=rec[3+i];
+      sigma_w[i]=rec[3+ncv_+i];
+    }
+    addKernel(rec[2],center_w,sigma_w,rec[1]);
+  }
+  if(others)
+  {
+    getPntrToComponent("rct")->set(kbt_*std::log(sum_weights_/counter_));
+    getPntrToComponent("neff")->set(std::pow(1+sum_weights_,2)/(1+sum_weights2_));
+    KDEnorm_=mode::explore?counter_:sum_weights_;
+  }
+}
+
 template <class mode>
 unsigned OPESmetad<mode>::getMergeableKernel(const std::vector<double>& giver_center,const unsigned giver_k)
 { //returns kernels_.size() if no match is found
   unsigned min_k=kernels_.size();
   double min_norm2=threshold2_;
-  if(!nlist_)
+  //with KERNEL_CELLS only the kernels in the cells around the giver are searched
+  const std::vector<unsigned>* index=NULL;
+  if(kernel_cells_)
+  {
+    kernel_cells_grid_.getCandidates(giver_center,std::sqrt(threshold2_),kernel_cells_candidates_);
+    index=&kernel_cells_candidates_;
+  }
+  else if(nlist_)
+    index=&nlist_index_;
+  if(!index)
   {
     #pragma omp parallel num_threads(NumOMP_)
     {
@@ -1447,9 +1624,9 @@ unsigned OPESmetad<mode>::getMergeableKernel(const std::vector<double>& giver_ce
       unsigned min_k_omp = min_k;
       double min_norm2_omp = threshold2_;
       #pragma omp for nowait
-      for(unsigned nk=rank_; nk<nlist_index_.size(); nk+=NumParallel_)
+      for(unsigned nk=rank_; nk<index->size(); nk+=NumParallel_)
       {
-        const unsigned k=nlist_index_[nk];
+        const unsigned k=(*index)[nk];
         if(k==giver_k) //a kernel should not be merged with itself
           continue;
         double norm2=0;
@@ -1496,11 +1673,16 @@ void OPESmetad<mode>::updateNlist(const std::vector<double>& new_center)
 
   nlist_center_=new_center;
   nlist_index_.clear();
+  //with KERNEL_CELLS only the kernels in the cells around the center are checked
+  if(kernel_cells_)
+    kernel_cells_grid_.getCandidates(nlist_center_,std::sqrt(nlist_param_[0]*cutoff2_),kernel_cells_candidates_);
+  const unsigned ncand=kernel_cells_ ? kernel_cells_candidates_.size() : kernels_.size();
   //first we gather all the nlist_index
-  if(NumOMP_==1 || (unsigned)kernels_.size()<2*NumOMP_*NumParallel_)
+  if(NumOMP_==1 || ncand<2*NumOMP_*NumParallel_)
   {
-    for(unsigned k=rank_; k<kernels_.size(); k+=NumParallel_)
+    for(unsigned m=rank_; m<ncand; m+=NumParallel_)
     {
+      const unsigned k=kernel_cells_ ? kernel_cells_candidates_[m] : m;
       double norm2_k=0;
       for(unsigned i=0; i<ncv_; i++)
       {
@@ -1517,8 +1699,9 @@ void OPESmetad<mode>::updateNlist(const std::vector<double>& new_center)
     {
       std::vector<unsigned> private_nlist_index;
       #pragma omp for nowait
-      for(unsigned k=rank_; k<kernels_.size(); k+=NumParallel_)
+      for(unsigned m=rank_; m<ncand; m+=NumParallel_)
       {
+        const unsigned k=kernel_cells_ ? kernel_cells_candidates_[m] : m;
         double norm2_k=0;
         for(unsigned i=0; i<ncv_; i++)
         {
@@ -26,6 +26,7 @@
 #include "core/PlumedMain.h"
 #include "core/ActionSet.h"
 #include "tools/IFile.h"
+#include "small_vector/small_vector.h"
 
 //+PLUMEDOC MATRIX HBPAMM_MATRIX
 /*
@@ -72,7 +73,8 @@ private:
   Tensor incoord_to_hbcoord;
   std::vector<double> weight;
   std::vector<Vector> centers;
-  std::vector<Tensor> kmat;
+/// Lower triangular Cholesky factors of the inverse covariances (kmat = L L^T)
+  std::vector<Tensor> kchol;
 public:
 /// Create manual
   static void registerKeywords( Keywords& keys );
@@ -129,7 +131,16 @@ HBPammMatrix::HBPammMatrix(const ActionOptions& ao):
     covar[1][0] = covar[0][1]; ifile.scanField("sigma_ssc_ssc",covar[1][1]); ifile.scanField("sigma_ssc_adc",covar[1][2]);
     covar[2][0] = covar[0][2]; covar[2][1] = covar[1][2]; ifile.scanField("sigma_adc_adc",covar[2][2]);
     weight.push_back( ww / ( sqrt2pi3 * sqrt(covar.determinant()) ) );
-    centers.push_back( cent ); kmat.push_back( covar.inverse() );
+    centers.push_back( cent );
+    // The quadratic form is evaluated as |L^T d|^2 so the full product with the inverse covariance is only needed for the derivatives
+    Tensor kmat( covar.inverse() ), chol; double d0, d1, d2;
+    d0 = kmat(0,0); if( d0<=0 ) error("covariance of kernel in CLUSTERS file is not positive definite");
+    chol(0,0) = sqrt( d0 ); chol(1,0) = kmat(1,0) / chol(0,0); chol(2,0) = kmat(2,0) / chol(0,0);
+    d1 = kmat(1,1) - chol(1,0)*chol(1,0); if( d1<=0 ) error("covariance of kernel in CLUSTERS file is not positive definite");
+    chol(1,1) = sqrt( d1 ); chol(2,1) = ( kmat(2,1) - chol(2,0)*chol(1,0) ) / chol(1,1);
+    d2 = kmat(2,2) - chol(2,0)*chol(2,0) - chol(2,1)*chol(2,1); if( d2<=0 ) error("covariance of kernel in CLUSTERS file is not positive definite");
+    chol(2,2) = sqrt( d2 );
+    kchol.push_back( chol );
 
     Vector eigval; Tensor eigvec; diagMatSym( covar, eigval, eigvec );
     unsigned ind_maxeval=0; double max_eval=eigval[0];
@@ -147,28 +158,31 @@ double HBPammMatrix::calculateWeight( const Vector& pos1, const Vector& pos2, co
   Vector ddij, ddik, ddin, in_dists, hb_pamm_dists, hb_pamm_ders, real_ders;
   ddin = pbcDistance( pos1, pos2 ); in_dists[2] = ddin.modulo();
   if( in_dists[2]<epsilon ) return 0;
-
-  double tot=0; Vector disp, der, tmp_der;
+  const unsigned nk=weight.size(); gch::small_vector<double,16> kval( nk ); gch::small_vector<Vector,16> ky( nk );
+  double tot=0; Vector disp, der;
   for(unsigned i=0; i<natoms; ++i) {
     ddij = getPosition(i,myvals); in_dists[0] = ddij.modulo();
     ddik = pbcDistance( pos2, getPosition(i,myvals) ); in_dists[1] = ddik.modulo();
     if( in_dists[1]<epsilon ) continue;
-
     hb_pamm_dists = matmul( incoord_to_hbcoord, in_dists );
-    disp = hb_pamm_dists - centers[0]; der = matmul( kmat[0], disp );
-    double vv = weight[0]*exp( -dotProduct( disp, der ) / 2. ); der *= -vv;
-
-    double denom = regulariser + vv; for(unsigned j=0; j<3; ++j) hb_pamm_ders[j] = der[j];
-    for(unsigned k=1; k<weight.size(); ++k) {
-      disp = hb_pamm_dists - centers[k]; tmp_der = matmul( kmat[k], disp );
-      double tval = weight[k]*exp( -dotProduct( disp, tmp_der ) / 2. );
-      denom += tval; hb_pamm_ders += -tmp_der*tval;
+    // Evaluate all the kernels using the Cholesky factors
+    double denom = regulariser;
+    for(unsigned k=0; k<nk; ++k) {
+      disp = hb_pamm_dists - centers[k]; const Tensor & L( kchol[k] );
+      ky[k] = Vector( L(0,0)*disp[0] + L(1,0)*disp[1] + L(2,0)*disp[2], L(1,1)*disp[1] + L(2,1)*disp[2], L(2,2)*disp[2] );
+      kval[k] = weight[k]*exp( -ky[k].modulo2() / 2. ); denom += kval[k];
+    }
+    double vv = kval[0], vf = vv / denom; tot += vf;
+    if( fabs(vf)<epsilon || doNotCalculateDerivatives() ) continue;
+    // Now get derivatives.  The product of the inverse covariance with the displacement is L y
+    hb_pamm_ders.zero();
+    for(unsigned k=0; k<nk; ++k) {
+      const Tensor & L( kchol[k] ); const Vector & y( ky[k] );
+      Vector kd( L(0,0)*y[0], L(1,0)*y[0] + L(1,1)*y[1], L(2,0)*y[0] + L(2,1)*y[1] + L(2,2)*y[2] );
+      if( k==0 ) der = -vv*kd;
+      hb_pamm_ders += -kd*kval[k];
     }
-    double vf = vv / denom; tot += vf;
-    if( fabs(vf)<epsilon ) continue;
-    // Now get derivatives
     real_ders = matmul( der / denom - vf*hb_pamm_ders/denom, incoord_to_hbcoord );
-
     // And add the derivatives to the underlying atoms
     addAtomDerivatives( 0, -(real_ders[0]/in_dists[0])*ddij - (real_ders[2]/in_dists[2])*ddin, myvals );
     addAtomDerivatives( 1, -(real_ders[1]/in_dists[1])*ddik + (real_ders[2]/in_dists[2])*ddin, myvals );
@@ -19,6 +19,7 @@ along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 #include "core/PlumedMain.h"
 #include "core/ActionWithVirtualAtom.h"
 #include "tools/NeighborList.h"
+#include "tools/OpenMP.h"
 #include "tools/SwitchingFunction.h"
 #include "tools/PDB.h"
 #include "tools/Pbc.h"
@@ -746,6 +747,48 @@ PIV::PIV(const ActionOptions&ao):
   m_deriv.resize(getNumberOfAtoms());
 }
 
+// Stable counting sort of the pairs (first[i],second[i]) according to the integer key[i]<count.size().
+// Every thread counts the occupancies of its own chunk of pairs and then
+// scatters them after the offsets of all the chunks have been computed.
+static void countingSort(const std::vector<int>& key, const std::vector<int>& first, const std::vector<int>& second, unsigned nt,
+                         std::vector<int>& count, std::vector<int>& sfirst, std::vector<int>& ssecond)
+{
+  const unsigned npairs=key.size();
+  const unsigned nbins=count.size();
+  if(nt>1+npairs/nbins) nt=1+npairs/nbins;
+  std:: vector<int> offset(nt*nbins,0);
+  sfirst.resize(npairs);
+  ssecond.resize(npairs);
+  #pragma omp parallel num_threads(nt)
+  {
+    #pragma omp for schedule(static,1)
+    for(unsigned t=0; t<nt; t++) {
+      for(unsigned i=t*npairs/nt; i<(t+1)*npairs/nt; i++) offset[t*nbins+key[i]]++;
+    }
+    #pragma omp single
+    {
+      int pos=0;
+      for(unsigned b=0; b<nbins; b++) {
+        count[b]=0;
+        for(unsigned t=0; t<nt; t++) {
+          const int n=offset[t*nbins+b];
+          offset[t*nbins+b]=pos;
+          pos+=n;
+          count[b]+=n;
+        }
+      }
+    }
+    #pragma omp for schedule(static,1)
+    for(unsigned t=0; t<nt; t++) {
+      for(unsigned i=t*npairs/nt; i<(t+1)*npairs/nt; i++) {
+        const int pos=offset[t*nbins+key[i]]++;
+        sfirst[pos]=first[i];
+        ssecond[pos]=second[i];
+      }
+    }
+  }
+}
+
 void PIV::calculate()
 {
 
@@ -768,8 +811,7 @@ void PIV::calculate()
   auto & Atom0(sharedData->Atom0);
   auto & Atom1(sharedData->Atom1);
 
-  std:: vector<std:: vector<int> > A0(Nprec);
-  std:: vector<std:: vector<int> > A1(Nprec);
+  const unsigned nt=OpenMP::getNumThreads();
   size_t stride=1;
   unsigned rank=0;
 
@@ -911,7 +953,6 @@ void PIV::calculate()
     if(Svol) {
       Fvol=cbrt(Vol0/getBox().determinant());
     }
-    Vector ddist;
     // Global to local variables
     bool doserial=serial;
     // Build "Nlist" PIV blocks
@@ -927,10 +968,15 @@ void PIV::calculate()
         Atom1[j].resize(0);
         // Building distances for the PIV vector at time t
         if(timer) stopwatch.start("1 Build cPIV");
-        for(unsigned i=rank; i<nl[j]->size(); i+=stride) {
+        // Pairs handled by this rank, with the integer transformed distances
+        const unsigned npairs=(nl[j]->size()>rank ? (nl[j]->size()-rank+stride-1)/stride : 0);
+        std:: vector<int> Vint(npairs),P0(npairs),P1(npairs);
+        #pragma omp parallel for num_threads(nt)
+        for(unsigned p=0; p<npairs; p++) {
+          const unsigned i=rank+p*stride;
           unsigned i0=(nl[j]->getClosePairAtomNumber(i).first).index();
           unsigned i1=(nl[j]->getClosePairAtomNumber(i).second).index();
-          Vector Pos0,Pos1;
+          Vector Pos0,Pos1,ddist;
           if(docom) {
             Pos0=compos[i0];
             Pos1=compos[i1];
@@ -944,17 +990,18 @@ void PIV::calculate()
             ddist=delta(Pos0,Pos1);
           }
           double df=0.;
-          //Integer sorting ... faster!
           //Transforming distances with the Switching function + real to integer transformation
-          int Vint=int(sfs[j].calculate(ddist.modulo()*Fvol, df)*double(Nprec-1)+0.5);
-          //Integer transformed distance values as index of the Ordering Vector OrdVec
-          OrdVec[Vint]+=1;
+          Vint[p]=int(sfs[j].calculate(ddist.modulo()*Fvol, df)*double(Nprec-1)+0.5);
           //Keeps track of atom indices for force and virial calculations
-          A0[Vint].push_back(i0);
-          A1[Vint].push_back(i1);
+          P0[p]=i0;
+          P1[p]=i1;
         }
         if(timer) stopwatch.stop("1 Build cPIV");
         if(timer) stopwatch.start("2 Sort cPIV");
+        //Integer sorting ... faster!
+        //Integer transformed distance values are the keys of a counting sort, OrdVec holds the occupancies
+        std:: vector<int> A0,A1;
+        countingSort(Vint,P0,P1,nt,OrdVec,A0,A1);
         if(!doserial && comm.initialized()) {
           // Vectors keeping track of the dimension and the starting-position of the rank-specific pair vector in the big pair vector.
           std:: vector<int> Vdim(stride,0);
@@ -967,20 +1014,9 @@ void PIV::calculate()
           // Vector used to reconstruct arrays
           std:: vector<unsigned> k(stride,0);
           // Zeros might be many, this slows down a lot due to MPI communication
-          // Avoid passing the zeros (i=1) for atom indices
-          for(unsigned i=1; i<Nprec; i++) {
-            // Building long vectors with all atom indexes for occupancies ordered from i=1 to i=Nprec-1
-            // Can this be avoided ???
-            Atom0F.insert(Atom0F.end(),A0[i].begin(),A0[i].end());
-            Atom1F.insert(Atom1F.end(),A1[i].begin(),A1[i].end());
-            A0[i].resize(0);
-            A1[i].resize(0);
-          }
-          // Resize partial arrays to fill up for the next PIV block
-          A0[0].resize(0);
-          A1[0].resize(0);
-          A0[Nprec-1].resize(0);
-          A1[Nprec-1].resize(0);
+          // Avoid passing the zeros (i=0) for atom indices, pairs are sorted so they come first
+          Atom0F.assign(A0.begin()+OrdVec[0],A0.end());
+          Atom1F.assign(A1.begin()+OrdVec[0],A1.end());
           // Avoid passing the zeros (i=1) for atom indices
           OrdVec[0]=0;
           OrdVec[Nprec-1]=0;
@@ -1034,12 +1070,13 @@ void PIV::calculate()
           }
           if(timer) stopwatch.stop("3 Reconstruct cPIV");
         } else {
+          if(timer) stopwatch.stop("2 Sort cPIV");
+          // Zeros are skipped, pairs are sorted so they come first
+          Atom0[j].assign(A0.begin()+OrdVec[0],A0.end());
+          Atom1[j].assign(A1.begin()+OrdVec[0],A1.end());
+          cPIV[j].reserve(Atom0[j].size());
           for(unsigned i=1; i<Nprec; i++) {
-            for(unsigned m=0; m<OrdVec[i]; m++) {
-              cPIV[j].push_back(double(i)/double(Nprec-1));
-              Atom0[j].push_back(A0[i][m]);
-              Atom1[j].push_back(A1[i][m]);
-            }
+            cPIV[j].insert(cPIV[j].end(),OrdVec[i],double(i)/double(Nprec-1));
           }
         }
       }
@@ -1118,122 +1155,139 @@ void PIV::calculate()
       }
     }
     m_PIVdistance=0.;
-    // Re-compute atomic distances for derivatives and compute PIV-PIV distance
-    for(unsigned j=0; j<Nlist; j++) {
-      unsigned limit=0;
-      // dosorting definition is to speedup if structure in cycles with non-global variables
-      bool dosorting=dosort[j];
-      bool docom=com;
-      bool dopbc=pbc;
-      if(dosorting) {
-        limit = cPIV[j].size();
-      } else {
-        limit = rPIV[j].size();
-      }
-      for(unsigned i=rank; i<limit; i+=stride) {
-        unsigned i0=0;
-        unsigned i1=0;
+    // Every thread accumulates the derivatives of its pairs in its own buffer
+    #pragma omp parallel num_threads(nt)
+    {
+      std:: vector<Vector> omp_deriv(m_deriv.size());
+      Tensor omp_virial;
+      double omp_PIVdistance=0.;
+      // Re-compute atomic distances for derivatives and compute PIV-PIV distance
+      for(unsigned j=0; j<Nlist; j++) {
+        unsigned limit=0;
+        // dosorting definition is to speedup if structure in cycles with non-global variables
+        bool dosorting=dosort[j];
+        bool docom=com;
+        bool dopbc=pbc;
         if(dosorting) {
-          i0=Atom0[j][i];
-          i1=Atom1[j][i];
-        } else {
-          i0=(nl[j]->getClosePairAtomNumber(i).first).index();
-          i1=(nl[j]->getClosePairAtomNumber(i).second).index();
-        }
-        Vector Pos0,Pos1;
-        if(docom) {
-          Pos0=compos[i0];
-          Pos1=compos[i1];
+          limit = cPIV[j].size();
         } else {
-          Pos0=getPosition(i0);
-          Pos1=getPosition(i1);
+          limit = rPIV[j].size();
         }
-        if(dopbc) {
-          distance=pbcDistance(Pos0,Pos1);
-        } else {
-          distance=delta(Pos0,Pos1);
-        }
-        dfunc=0.;
-        // this is needed for dfunc and dervatives
-        double dm=distance.modulo();
-        double tPIV = sfs[j].calculate(dm*Fvol, dfunc);
-        // PIV distance
-        double coord=0.;
-        if(!dosorting||Nder) {
-          coord = tPIV - rPIV[j][i];
-        } else {
-          coord = cPIV[j][i] - rPIV[j][rPIV[j].size()-cPIV[j].size()+i];
-        }
-        // Calculate derivatives, virial, and variable=sum_j (scaling[j] *(cPIV-rPIV)_j^2)
-        // WARNING: dfunc=dswf/(Fvol*dm)  (this may change in future Plumed versions)
-        double tmp = 2.*scaling[j]*coord*Fvol*Fvol*dfunc;
-        Vector tmpder = tmp*distance;
-        // 0.5*(x_i-x_k)*f_ik         (force on atom k due to atom i)
-        if(docom) {
-          Vector dist;
-          for(unsigned k=0; k<nlcom[i0]->getFullAtomList().size(); k++) {
-            unsigned x0=nlcom[i0]->getFullAtomList()[k].index();
-            m_deriv[x0] -= tmpder*fmass[x0];
-            for(unsigned l=0; l<3; l++) {
-              dist[l]=0.;
-            }
-            Vector P0=getPosition(x0);
-            for(unsigned l=0; l<nlcom[i0]->getFullAtomList().size(); l++) {
-              unsigned x1=nlcom[i0]->getFullAtomList()[l].index();
-              Vector P1=getPosition(x1);
-              if(dopbc) {
-                dist+=pbcDistance(P0,P1);
-              } else {
-                dist+=delta(P0,P1);
-              }
-            }
-            for(unsigned l=0; l<nlcom[i1]->getFullAtomList().size(); l++) {
-              unsigned x1=nlcom[i1]->getFullAtomList()[l].index();
-              Vector P1=getPosition(x1);
-              if(dopbc) {
-                dist+=pbcDistance(P0,P1);
-              } else {
-                dist+=delta(P0,P1);
-              }
-            }
-            m_virial    -= 0.25*fmass[x0]*Tensor(dist,tmpder);
+        const unsigned nlocal=(limit>rank ? (limit-rank+stride-1)/stride : 0);
+        #pragma omp for nowait
+        for(unsigned p=0; p<nlocal; p++) {
+          const unsigned i=rank+p*stride;
+          Vector distance;
+          double dfunc=0.;
+          unsigned i0=0;
+          unsigned i1=0;
+          if(dosorting) {
+            i0=Atom0[j][i];
+            i1=Atom1[j][i];
+          } else {
+            i0=(nl[j]->getClosePairAtomNumber(i).first).index();
+            i1=(nl[j]->getClosePairAtomNumber(i).second).index();
           }
-          for(unsigned k=0; k<nlcom[i1]->getFullAtomList().size(); k++) {
-            unsigned x1=nlcom[i1]->getFullAtomList()[k].index();
-            m_deriv[x1] += tmpder*fmass[x1];
-            for(unsigned l=0; l<3; l++) {
-              dist[l]=0.;
-            }
-            Vector P1=getPosition(x1);
-            for(unsigned l=0; l<nlcom[i1]->getFullAtomList().size(); l++) {
-              unsigned x0=nlcom[i1]->getFullAtomList()[l].index();
+          Vector Pos0,Pos1;
+          if(docom) {
+            Pos0=compos[i0];
+            Pos1=compos[i1];
+          } else {
+            Pos0=getPosition(i0);
+            Pos1=getPosition(i1);
+          }
+          if(dopbc) {
+            distance=pbcDistance(Pos0,Pos1);
+          } else {
+            distance=delta(Pos0,Pos1);
+          }
+          // this is needed for dfunc and dervatives
+          double dm=distance.modulo();
+          double tPIV = sfs[j].calculate(dm*Fvol, dfunc);
+          // PIV distance
+          double coord=0.;
+          if(!dosorting||Nder) {
+            coord = tPIV - rPIV[j][i];
+          } else {
+            coord = cPIV[j][i] - rPIV[j][rPIV[j].size()-cPIV[j].size()+i];
+          }
+          // Calculate derivatives, virial, and variable=sum_j (scaling[j] *(cPIV-rPIV)_j^2)
+          // WARNING: dfunc=dswf/(Fvol*dm)  (this may change in future Plumed versions)
+          double tmp = 2.*scaling[j]*coord*Fvol*Fvol*dfunc;
+          Vector tmpder = tmp*distance;
+          // 0.5*(x_i-x_k)*f_ik         (force on atom k due to atom i)
+          if(docom) {
+            Vector dist;
+            for(unsigned k=0; k<nlcom[i0]->getFullAtomList().size(); k++) {
+              unsigned x0=nlcom[i0]->getFullAtomList()[k].index();
+              omp_deriv[x0] -= tmpder*fmass[x0];
+              for(unsigned l=0; l<3; l++) {
+                dist[l]=0.;
+              }
               Vector P0=getPosition(x0);
-              if(dopbc) {
-                dist+=pbcDistance(P1,P0);
-              } else {
-                dist+=delta(P1,P0);
+              for(unsigned l=0; l<nlcom[i0]->getFullAtomList().size(); l++) {
+                unsigned x1=nlcom[i0]->getFullAtomList()[l].index();
+                Vector P1=getPosition(x1);
+                if(dopbc) {
+                  dist+=pbcDistance(P0,P1);
+                } else {
+                  dist+=delta(P0,P1);
+                }
+              }
+              for(unsigned l=0; l<nlcom[i1]->getFullAtomList().size(); l++) {
+                unsigned x1=nlcom[i1]->getFullAtomList()[l].index();
+                Vector P1=getPosition(x1);
+                if(dopbc) {
+                  dist+=pbcDistance(P0,P1);
+                } else {
+                  dist+=delta(P0,P1);
+                }
               }
+              omp_virial    -= 0.25*fmass[x0]*Tensor(dist,tmpder);
             }
-            for(unsigned l=0; l<nlcom[i0]->getFullAtomList().size(); l++) {
-              unsigned x0=nlcom[i0]->getFullAtomList()[l].index();
-              Vector P0=getPosition(x0);
-              if(dopbc) {
-                dist+=pbcDistance(P1,P0);
-              } else {
-                dist+=delta(P1,P0);
+            for(unsigned k=0; k<nlcom[i1]->getFullAtomList().size(); k++) {
+              unsigned x1=nlcom[i1]->getFullAtomList()[k].index();
+              omp_deriv[x1] += tmpder*fmass[x1];
+              for(unsigned l=0; l<3; l++) {
+                dist[l]=0.;
+              }
+              Vector P1=getPosition(x1);
+              for(unsigned l=0; l<nlcom[i1]->getFullAtomList().size(); l++) {
+                unsigned x0=nlcom[i1]->getFullAtomList()[l].index();
+                Vector P0=getPosition(x0);
+                if(dopbc) {
+                  dist+=pbcDistance(P1,P0);
+                } else {
+                  dist+=delta(P1,P0);
+                }
               }
+              for(unsigned l=0; l<nlcom[i0]->getFullAtomList().size(); l++) {
+                unsigned x0=nlcom[i0]->getFullAtomList()[l].index();
+                Vector P0=getPosition(x0);
+                if(dopbc) {
+                  dist+=pbcDistance(P1,P0);
+                } else {
+                  dist+=delta(P1,P0);
+                }
+              }
+              omp_virial    += 0.25*fmass[x1]*Tensor(dist,tmpder);
             }
-            m_virial    += 0.25*fmass[x1]*Tensor(dist,tmpder);
+          } else {
+            omp_deriv[i0] -= tmpder;
+            omp_deriv[i1] += tmpder;
+            omp_virial    -= tmp*Tensor(distance,distance);
           }
-        } else {
-          m_deriv[i0] -= tmpder;
-          m_deriv[i1] += tmpder;
-          m_virial    -= tmp*Tensor(distance,distance);
-        }
-        if(Scalevol) {
-          m_virial+=1./3.*tmp*dm*dm*Tensor::identity();
+          if(Scalevol) {
+            omp_virial+=1./3.*tmp*dm*dm*Tensor::identity();
+          }
+          omp_PIVdistance += scaling[j]*coord*coord;
         }
-        m_PIVdistance    += scaling[j]*coord*coord;
+      }
+      #pragma omp critical
+      {
+        for(unsigned k=0; k<m_deriv.size(); k++) m_deriv[k]+=omp_deriv[k];
+        m_virial+=omp_virial;
+        m_PIVdistance+=omp_PIVdistance;
       }
     }
 
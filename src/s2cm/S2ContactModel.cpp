@@ -22,10 +22,12 @@
 #include "tools/Communicator.h"
 #include "core/ActionRegister.h"
 #include "core/PlumedMain.h"
+#include "tools/OpenMP.h"
 
 
 #include <string>
 #include <cmath>
+#include <array>
 
 namespace PLMD {
 namespace s2cm {
@@ -86,6 +88,7 @@ void S2ContactModel::registerKeywords( Keywords& keys ) {
   keys.addFlag("NLIST",false,"Use a neighbour list to speed up the calculation");
   keys.add("optional","NL_CUTOFF","The cutoff for the neighbour list");
   keys.add("optional","NL_STRIDE","The frequency with which we are updating the atoms in the neighbour list");
+  keys.add("optional","NL_SKIN","If this is set the neighbor list is only updated when an atom has moved by more than half this distance.  NL_CUTOFF should then be at least the distance beyond which contacts are negligible plus the skin");
   keys.add("atoms","METHYL_ATOM","the methyl carbon atom of the residue (i)");
   keys.add("atoms","NH_ATOMS","the hydrogen atom of the NH group of the residue (i) and carbonyl oxygen of the preceding residue (i-1)");
   keys.add("atoms","HEAVY_ATOMS","the heavy atoms to be included in the calculation");
@@ -157,13 +160,17 @@ S2ContactModel::S2ContactModel(const ActionOptions&ao):
 
   // neighbor list stuff
   bool doneigh=false;
-  double nl_cut=0.0;
+  double nl_cut=0.0, nl_skin=0.0;
   int nl_st=0;
   parseFlag("NLIST",doneigh);
   if(doneigh) {
     parse("NL_CUTOFF",nl_cut);
     if(nl_cut<=0.0) error("NL_CUTOFF should be explicitly specified and positive");
-    parse("NL_STRIDE",nl_st);
+    parse("NL_SKIN",nl_skin);
+    if(nl_skin<0.0 || nl_skin>=nl_cut) error("NL_SKIN should be positive and smaller than NL_CUTOFF");
+    // with a skin the list is checked on every step
+    if(nl_skin>0.0) nl_st=1;
+    else parse("NL_STRIDE",nl_st);
     if(nl_st<=0) error("NL_STRIDE should be explicitly specified and positive");
   }
 
@@ -191,6 +198,7 @@ S2ContactModel::S2ContactModel(const ActionOptions&ao):
   else {
     nl=Tools::make_unique<NeighborList>(main_atoms,heavy_atoms,serial_,dopair,pbc_,getPbc(),comm);
   }
+  if(nl_skin>0.0) nl->setSkin(nl_skin);
 
   requestAtoms(nl->getFullAtomList());
 
@@ -233,7 +241,8 @@ S2ContactModel::S2ContactModel(const ActionOptions&ao):
   }
   if(doneigh) {
     log.printf("  using neighbor lists with\n");
-    log.printf("  update every %d steps and cutoff %f\n",nl_st,nl_cut);
+    if(nl_skin>0.0) log.printf("  cutoff %f updated when an atom has moved by more than half the skin %f\n",nl_cut,nl_skin);
+    else log.printf("  update every %d steps and cutoff %f\n",nl_st,nl_cut);
   }
   if(serial_) {
     log.printf("  calculation done in serial\n");
@@ -244,7 +253,11 @@ S2ContactModel::~S2ContactModel() {
 }
 
 void S2ContactModel::prepare() {
-  if(nl->getStride()>0) {
+  if(nl->getSkin()>0) {
+    // The positions of all the atoms are needed on every step to check if they have moved too far
+    if(firsttime || getExchangeStep()) invalidateList=true;
+    firsttime=false;
+  } else if(nl->getStride()>0) {
     if(firsttime || (getStep()%nl->getStride()==0)) {
       requestAtoms(nl->getFullAtomList());
       invalidateList=true;
@@ -264,7 +277,10 @@ void S2ContactModel::calculate() {
   Tensor virial;
   std::vector<Vector> deriv(getNumberOfAtoms());
 
-  if(nl->getStride()>0 && invalidateList) {
+  if(nl->getSkin()>0) {
+    if(invalidateList || nl->displacementExceedsSkin(getPositions())) nl->update(getPositions());
+    invalidateList=false;
+  } else if(nl->getStride()>0 && invalidateList) {
     nl->update(getPositions());
   }
 
@@ -278,28 +294,63 @@ void S2ContactModel::calculate() {
   double contact_sum = 0.0;
 
   const unsigned int nn=nl->size();
-
-  for(unsigned int i=rank; i<nn; i+=stride) {
-    Vector distance;
-    unsigned int i0=nl->getClosePair(i).first;
-    unsigned int i1=nl->getClosePair(i).second;
-    if(getAbsoluteIndex(i0)==getAbsoluteIndex(i1)) {continue;}
-
-    if(pbc_) {
-      distance=pbcDistance(getPosition(i0),getPosition(i1));
-    } else {
-      distance=delta(getPosition(i0),getPosition(i1));
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*stride*10>nn) nt=1;
+
+  const unsigned elementsPerRank = std::ceil(double(nn)/stride);
+  const unsigned int start= rank*elementsPerRank;
+  const unsigned int end = ((start + elementsPerRank)< nn)?(start + elementsPerRank): nn;
+
+  // The contacts are processed in blocks so that the minimum image convention is applied to many distances at once
+  constexpr unsigned blocksize=64;
+
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<Vector> omp_deriv(nt>1 ? deriv.size() : 0);
+    Tensor omp_virial;
+    std::array<double,blocksize> dx, dy, dz;
+    std::array<unsigned,blocksize> ind0, ind1;
+
+    #pragma omp for reduction(+:contact_sum) nowait
+    for(unsigned int b=start; b<end; b+=blocksize) {
+
+      unsigned nb=0;
+      const unsigned bend=std::min(b+blocksize,end);
+      for(unsigned int i=b; i<bend; ++i) {
+        const unsigned int i0=nl->getClosePair(i).first;
+        const unsigned int i1=nl->getClosePair(i).second;
+        if(getAbsoluteIndex(i0)==getAbsoluteIndex(i1)) {continue;}
+
+        const Vector dd(delta(getPosition(i0),getPosition(i1)));
+        dx[nb]=dd[0]; dy[nb]=dd[1]; dz[nb]=dd[2]; ind0[nb]=i0; ind1[nb]=i1; nb++;
+      }
+      if(pbc_) getPbc().apply(dx.data(), dy.data(), dz.data(), nb);
+
+      for(unsigned k=0; k<nb; ++k) {
+        const Vector distance(dx[k],dy[k],dz[k]);
+        const double dist = distance.modulo();
+        const double exp_arg = exp(-(dist-r_globalshift_)*inv_r_eff_);
+        contact_sum += exp_arg;
+
+        Vector dd((exp_arg/dist)*distance);
+        Tensor vv(dd,distance);
+        if(nt>1) {
+          omp_deriv[ind0[k]]-=dd;
+          omp_deriv[ind1[k]]+=dd;
+          omp_virial-=vv;
+        } else {
+          deriv[ind0[k]]-=dd;
+          deriv[ind1[k]]+=dd;
+          virial-=vv;
+        }
+      }
+    }
+    #pragma omp critical
+    if(nt>1) {
+      for(unsigned i=0; i<deriv.size(); i++)
+        deriv[i]+=omp_deriv[i];
+      virial+=omp_virial;
     }
-
-    double exp_arg = exp(-(distance.modulo()-r_globalshift_)*inv_r_eff_);
-    contact_sum += exp_arg;
-
-    exp_arg /= distance.modulo();
-    Vector dd(exp_arg*distance);
-    Tensor vv(dd,distance);
-    deriv[i0]-=dd;
-    deriv[i1]+=dd;
-    virial-=vv;
   }
 
   if(!serial_) {
@@ -0,0 +1,117 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "OverlapList.h"
+#include "tools/Communicator.h"
+#include "tools/LinkCells.h"
+#include "tools/Pbc.h"
+#include "tools/Tensor.h"
+#include <algorithm>
+
+namespace PLMD {
+namespace sasa {
+
+void OverlapList::build(const std::vector<Vector>& positions,const std::vector<double>& radius,double pad,unsigned nt,std::vector<std::vector<int> >& list) {
+  list.resize(positions.size());
+  for(auto & l : list) l.clear();
+
+  std::vector<Vector> cellpos;
+  std::vector<unsigned> cellind;
+  Vector lo,hi;
+  double rmax=0.0;
+  for(unsigned i=0; i<positions.size(); i++) {
+    if(radius[i]<=0.0) continue;
+    if(cellind.empty()) { lo=positions[i]; hi=positions[i]; }
+    for(unsigned k=0; k<3; k++) {
+      lo[k]=std::min(lo[k],positions[i][k]);
+      hi[k]=std::max(hi[k],positions[i][k]);
+    }
+    cellpos.push_back(positions[i]);
+    cellind.push_back(i);
+    rmax=std::max(rmax,radius[i]);
+  }
+  if(cellind.empty()) return;
+
+  // the molecule is whole, so the cells are built in a box that contains it
+  // with enough empty space to separate it from its periodic images
+  const double cutoff=(2*rmax+pad)/10;
+  Tensor box;
+  for(unsigned k=0; k<3; k++) box[k][k]=hi[k]-lo[k]+cutoff;
+  for(auto & p : cellpos) p-=lo;
+  Pbc pbc;
+  pbc.setBox(box);
+  Communicator serial;
+  LinkCells cells(serial);
+  cells.setCutoff(cutoff);
+  cells.buildCellLists(cellpos,cellind,pbc);
+
+  // every atom only writes its own list
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<unsigned> cell_list(cells.getNumberOfCells()), neighbors(1+cellpos.size());
+    #pragma omp for
+    for(unsigned k=0; k<cellpos.size(); k++) {
+      const unsigned i=cellind[k];
+      // The first element is skipped by retrieveNeighboringAtoms so it is set to the atom itself
+      unsigned natomsper=1; neighbors[0]=i;
+      cells.retrieveNeighboringAtoms(cellpos[k],cell_list,natomsper,neighbors);
+      for(unsigned m=1; m<natomsper; m++) {
+        const unsigned j=neighbors[m];
+        const double d=delta(positions[i],positions[j]).modulo()*10;
+        if(d<radius[i]+radius[j]+pad) list[i].push_back(j);
+      }
+      std::sort(list[i].begin(),list[i].end());
+    }
+  }
+}
+
+bool OverlapList::needsUpdate(const std::vector<Vector>& positions) const {
+  if(reference.size()!=positions.size()) return true;
+  const double limit=0.25*skin*skin;
+  for(unsigned i=0; i<positions.size(); i++) {
+    if(modulo2(delta(reference[i],positions[i]))>limit) return true;
+  }
+  return false;
+}
+
+void OverlapList::update(const std::vector<Vector>& positions,const std::vector<double>& radius,unsigned nt,bool rebuild,std::vector<std::vector<int> >& list) {
+  if(skin<=0.0) {
+    if(rebuild) build(positions,radius,0.0,nt,list);
+    return;
+  }
+
+  if(rebuild || needsUpdate(positions)) {
+    build(positions,radius,10*skin,nt,candidates);
+    reference=positions;
+  }
+
+  list.resize(positions.size());
+  #pragma omp parallel for num_threads(nt)
+  for(unsigned i=0; i<positions.size(); i++) {
+    list[i].clear();
+    for(const auto j : candidates[i]) {
+      if(delta(positions[i],positions[j]).modulo()*10<radius[i]+radius[j]) list[i].push_back(j);
+    }
+  }
+}
+
+}
+}
@@ -0,0 +1,67 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_sasa_OverlapList_h
+#define __PLUMED_sasa_OverlapList_h
+
+#include "tools/Vector.h"
+#include <vector>
+
+namespace PLMD {
+namespace sasa {
+
+/**
+Lists of the atoms whose spheres overlap, used by the SASA collective variables.
+
+The radii are in Angstrom and the positions in nm, as in the SASA actions.
+The positions are those of a whole molecule, so that distances are computed
+without periodic boundary conditions. Atoms with a non-positive radius are ignored.
+The lists are built with link cells, and each of them is sorted.
+
+If a skin is set, the pairs within the sum of the radii plus the skin are stored
+as candidates, and they are recomputed only when an atom moved by more than half
+the skin. The exact lists are then obtained at every step by filtering the candidates.
+*/
+class OverlapList {
+/// The skin, in nm
+  double skin=0.0;
+/// The candidate pairs, only used with a skin
+  std::vector<std::vector<int> > candidates;
+/// The positions at which the candidates were computed
+  std::vector<Vector> reference;
+/// Build the lists of the spheres whose distance is smaller than the sum of their radii plus pad
+  static void build(const std::vector<Vector>& positions,const std::vector<double>& radius,double pad,unsigned nt,std::vector<std::vector<int> >& list);
+/// Check if an atom moved by more than half the skin since the candidates were built
+  bool needsUpdate(const std::vector<Vector>& positions) const;
+public:
+/// Set the skin, in nm
+  void setSkin(double s) { skin=s; }
+/// Get the skin, in nm
+  double getSkin() const { return skin; }
+/// Update the lists. If rebuild is true, the lists are always recomputed from scratch.
+/// Without a skin, the lists are left unchanged unless rebuild is true.
+  void update(const std::vector<Vector>& positions,const std::vector<double>& radius,unsigned nt,bool rebuild,std::vector<std::vector<int> >& list);
+};
+
+}
+}
+
+#endif
@@ -19,10 +19,12 @@ freely, subject to the following restrictions:
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 
 #include "Sasa.h"
+#include "OverlapList.h"
 #include "core/ActionRegister.h"
 #include "core/PlumedMain.h"
 #include "core/GenericMolInfo.h"
 #include "core/ActionSet.h"
+#include "tools/OpenMP.h"
 #include <cstdio>
 #include <iostream>
 #include <string>
@@ -42,7 +44,7 @@ namespace sasa {
 /*
 Calculates the solvent accessible surface area (SASA) of a protein molecule, or other properties related to it.
 
-The atoms for which the SASA is desired should be indicated with the keyword ATOMS, and a pdb file of the protein must be provided in input with the MOLINFO keyword. The algorithm described in \cite Hasel1988 is used for the calculation. The radius of the solvent is assumed to be 0.14 nm, which is the radius of water molecules. Using the keyword NL_STRIDE it is also possible to specify the frequency with which the neighbor list for the calculation of SASA is updated (the default is every 10 steps).
+The atoms for which the SASA is desired should be indicated with the keyword ATOMS, and a pdb file of the protein must be provided in input with the MOLINFO keyword. The algorithm described in \cite Hasel1988 is used for the calculation. The radius of the solvent is assumed to be 0.14 nm, which is the radius of water molecules. Using the keyword NL_STRIDE it is also possible to specify the frequency with which the neighbor list for the calculation of SASA is updated (the default is every 10 steps). With the keyword NL_SKIN the list is built with a skin, it is also updated whenever an atom moved by more than half the skin, and the overlaps are then exact at every step. The neighbor list is built with link cells and the calculation is parallelized with OpenMP.
 
 Different properties can be calculated and selected using the TYPE keyword:
 
@@ -148,6 +150,7 @@ private:
   vector < vector < double > > MaxSurf;
   vector < vector < double > > DeltaG;
   vector < vector < int > > Nlist;
+  OverlapList overlaps;
 public:
   static void registerKeywords(Keywords& keys);
   explicit SASA_HASEL(const ActionOptions&);
@@ -169,6 +172,7 @@ void SASA_HASEL::registerKeywords(Keywords& keys) {
   keys.add("atoms","ATOMS","the group of atoms that you are calculating the SASA for");
   keys.add("compulsory","TYPE","TOTAL","The type of calculation you want to perform. Can be TOTAL or TRANSFER");
   keys.add("compulsory", "NL_STRIDE", "The frequency with which the neighbor list for the calculation of SASA is updated.");
+  keys.add("optional","NL_SKIN","a skin in nm for the neighbor list. The list is then also updated whenever an atom moved by more than half the skin, and the overlaps are recomputed exactly at every step");
   keys.add("optional","DELTAGFILE","a file containing the free energy of transfer values for backbone and sidechains atoms. Necessary only if TYPE = TRANSFER. A Python script for the computation of free energy of transfer values to describe the effect of osmolyte concentration, temperature and pressure is freely available at https://github.com/andrea-arsiccio/DeltaG-calculation. The script automatically outputs a DeltaG.dat file compatible with this SASA module. If TYPE = TRANSFER and no DELTAGFILE is provided, the free energy values are those describing the effect of temperature, and are computed using the temperature value passed by the MD engine");
   keys.add("optional","APPROACH","either approach 2 or 3. Necessary only if TYPE = TRANSFER and no DELTAGFILE is provided. If TYPE = TRANSFER and no DELTAGFILE is provided, the free energy values are those describing the effect of temperature, and the program must know if approach 2 or 3 (as described in Arsiccio and Shea, Protein Cold Denaturation in Implicit Solvent Simulations: A Transfer Free Energy Approach, J. Phys. Chem. B, 2021) needs to be used to compute them");
   keys.setValueDescription("scalar","the solvent accessible surface area (SASA) of the molecule");
@@ -192,6 +196,9 @@ SASA_HASEL::SASA_HASEL(const ActionOptions&ao):
   std::string Type;
   parse("TYPE",Type);
   parse("NL_STRIDE", stride);
+  double skin=0.0;
+  parse("NL_SKIN", skin);
+  overlaps.setSkin(skin);
   parseFlag("NOPBC",nopbc);
   checkRead();
 
@@ -212,6 +219,8 @@ SASA_HASEL::SASA_HASEL(const ActionOptions&ao):
   }
   log.printf("\n");
 
+  if(skin>0.0) log.printf("  neighbor list skin %f nm\n",skin);
+
   if(nopbc) {
     log<<"  PBC will be ignored\n";
   } else {
@@ -760,27 +769,11 @@ void SASA_HASEL::computeDeltaG() {
 
 //calculates neighbor list
 void SASA_HASEL::calcNlist() {
-  if(!nopbc) makeWhole();
-
-  for(unsigned i = 0; i < natoms; i++) {
-    Nlist[i].clear();
-  }
-
+  vector<double> radius(natoms,0.0);
   for(unsigned i = 0; i < natoms; i++) {
-    if (SASAparam[i].size()>0) {
-      for (unsigned j = 0; j < i; j++) {
-        if (SASAparam[j].size()>0) {
-          const Vector Delta_ij_vec = delta( getPosition(i), getPosition(j) );
-          double Delta_ij_mod = Delta_ij_vec.modulo()*10;
-          double overlapD = SASAparam[i][0]+SASAparam[j][0];
-          if (Delta_ij_mod < overlapD) {
-            Nlist.at(i).push_back (j);
-            Nlist.at(j).push_back (i);
-          }
-        }
-      }
-    }
+    if (SASAparam[i].size()>0) radius[i] = SASAparam[i][0];
   }
+  overlaps.update(getPositions(), radius, OpenMP::getNumThreads(), nl_update == 0, Nlist);
 }
 
 
@@ -793,14 +786,14 @@ void SASA_HASEL::calculate() {
     readPDB();
     readSASAparam();
   }
-  if (nl_update == 0) {
-    calcNlist();
-  }
+  calcNlist();
 
 
   auto* moldat = plumed.getActionSet().selectLatest<GenericMolInfo*>(this);
   if( ! moldat ) error("Unable to find MOLINFO in input");
-  double Si, sasai, bij;
+  // the derivatives with respect to the neighbors are accumulated by each
+  // thread in its own buffer, and summed at the end
+  const unsigned nt=OpenMP::getNumThreads();
   double sasa = 0;
   vector<Vector> derivatives( natoms );
   for(unsigned i = 0; i < natoms; i++) {
@@ -810,77 +803,85 @@ void SASA_HASEL::calculate() {
   }
 
   Tensor virial;
-  vector <double> ddij_di(3);
-  vector <double> dbij_di(3);
-  vector <double> dAijt_di(3);
 
   if( sasa_type==TOTAL ) {
-    for(unsigned i = 0; i < natoms; i++) {
-      if(SASAparam[i].size() > 0) {
-        double ri = SASAparam[i][0];
-        Si = 4*M_PI*ri*ri;
-        sasai = 1.0;
-
-        vector <vector <double> > derTerm( Nlist[i].size(), vector <double>(3));
-
-        dAijt_di[0] = 0;
-        dAijt_di[1] = 0;
-        dAijt_di[2] = 0;
-        int NumRes_i = moldat->getResidueNumber(atoms[i]);
-
-        for (unsigned j = 0; j < Nlist[i].size(); j++) {
-          double pij = 0.3516;
-
-          int NumRes_j = moldat->getResidueNumber(atoms[Nlist[i][j]]);
-          if (NumRes_i==NumRes_j) {
-            if (CONNECTparam[i][0].compare(AtomResidueName[0][Nlist[i][j]])==0 || CONNECTparam[i][1].compare(AtomResidueName[0][Nlist[i][j]])==0 || CONNECTparam[i][2].compare(AtomResidueName[0][Nlist[i][j]])==0 || CONNECTparam[i][3].compare(AtomResidueName[0][Nlist[i][j]])==0) {
-              pij = 0.8875;
+    #pragma omp parallel num_threads(nt)
+    {
+      double Si, sasai, bij;
+      vector <double> ddij_di(3);
+      vector <double> dbij_di(3);
+      vector <double> dAijt_di(3);
+      vector<Vector> omp_deriv( natoms );
+      #pragma omp for reduction(+:sasa) nowait
+      for(unsigned i = 0; i < natoms; i++) {
+        if(SASAparam[i].size() > 0) {
+          double ri = SASAparam[i][0];
+          Si = 4*M_PI*ri*ri;
+          sasai = 1.0;
+
+          vector <vector <double> > derTerm( Nlist[i].size(), vector <double>(3));
+
+          dAijt_di[0] = 0;
+          dAijt_di[1] = 0;
+          dAijt_di[2] = 0;
+          int NumRes_i = moldat->getResidueNumber(atoms[i]);
+
+          for (unsigned j = 0; j < Nlist[i].size(); j++) {
+            double pij = 0.3516;
+
+            int NumRes_j = moldat->getResidueNumber(atoms[Nlist[i][j]]);
+            if (NumRes_i==NumRes_j) {
+              if (CONNECTparam[i][0].compare(AtomResidueName[0][Nlist[i][j]])==0 || CONNECTparam[i][1].compare(AtomResidueName[0][Nlist[i][j]])==0 || CONNECTparam[i][2].compare(AtomResidueName[0][Nlist[i][j]])==0 || CONNECTparam[i][3].compare(AtomResidueName[0][Nlist[i][j]])==0) {
+                pij = 0.8875;
+              }
             }
-          }
-          if ( abs(NumRes_i-NumRes_j) == 1 ) {
-            if ((AtomResidueName[0][i] == "N"  && AtomResidueName[0][Nlist[i][j]]== "CA") || (AtomResidueName[0][Nlist[i][j]] == "N"  && AtomResidueName[0][i]== "CA")) {
-              pij = 0.8875;
+            if ( abs(NumRes_i-NumRes_j) == 1 ) {
+              if ((AtomResidueName[0][i] == "N"  && AtomResidueName[0][Nlist[i][j]]== "CA") || (AtomResidueName[0][Nlist[i][j]] == "N"  && AtomResidueName[0][i]== "CA")) {
+                pij = 0.8875;
+              }
             }
-          }
 
-          const Vector d_ij_vec = delta( getPosition(i), getPosition(Nlist[i][j]) );
-          double d_ij = d_ij_vec.modulo()*10;
+            const Vector d_ij_vec = delta( getPosition(i), getPosition(Nlist[i][j]) );
+            double d_ij = d_ij_vec.modulo()*10;
 
-          double rj = SASAparam[Nlist[i][j]][0];
-          bij = M_PI*ri*(ri+rj-d_ij)*(1+(rj-ri)/d_ij); //Angstrom2
+            double rj = SASAparam[Nlist[i][j]][0];
+            bij = M_PI*ri*(ri+rj-d_ij)*(1+(rj-ri)/d_ij); //Angstrom2
 
-          sasai = sasai*(1-SASAparam[i][1]*pij*bij/Si); //nondimensional
+            sasai = sasai*(1-SASAparam[i][1]*pij*bij/Si); //nondimensional
 
-          ddij_di[0] = -10*(getPosition(Nlist[i][j])[0]-getPosition(i)[0])/d_ij; //nondimensional
-          ddij_di[1] = -10*(getPosition(Nlist[i][j])[1]-getPosition(i)[1])/d_ij;
-          ddij_di[2] = -10*(getPosition(Nlist[i][j])[2]-getPosition(i)[2])/d_ij;
+            ddij_di[0] = -10*(getPosition(Nlist[i][j])[0]-getPosition(i)[0])/d_ij; //nondimensional
+            ddij_di[1] = -10*(getPosition(Nlist[i][j])[1]-getPosition(i)[1])/d_ij;
+            ddij_di[2] = -10*(getPosition(Nlist[i][j])[2]-getPosition(i)[2])/d_ij;
 
-          dbij_di[0] = -M_PI*ri*ddij_di[0]*(1+(ri+rj)*(rj-ri)/(d_ij*d_ij)); //Angstrom
-          dbij_di[1] = -M_PI*ri*ddij_di[1]*(1+(ri+rj)*(rj-ri)/(d_ij*d_ij));
-          dbij_di[2] = -M_PI*ri*ddij_di[2]*(1+(ri+rj)*(rj-ri)/(d_ij*d_ij));
+            dbij_di[0] = -M_PI*ri*ddij_di[0]*(1+(ri+rj)*(rj-ri)/(d_ij*d_ij)); //Angstrom
+            dbij_di[1] = -M_PI*ri*ddij_di[1]*(1+(ri+rj)*(rj-ri)/(d_ij*d_ij));
+            dbij_di[2] = -M_PI*ri*ddij_di[2]*(1+(ri+rj)*(rj-ri)/(d_ij*d_ij));
 
-          dAijt_di[0] += -1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[0]; //Angstrom-1
-          dAijt_di[1] += -1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[1];
-          dAijt_di[2] += -1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[2];
+            dAijt_di[0] += -1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[0]; //Angstrom-1
+            dAijt_di[1] += -1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[1];
+            dAijt_di[2] += -1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[2];
 
-          derTerm[j][0] = 1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[0]; //Angstrom-1
-          derTerm[j][1] = 1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[1];
-          derTerm[j][2] = 1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[2];
+            derTerm[j][0] = 1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[0]; //Angstrom-1
+            derTerm[j][1] = 1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[1];
+            derTerm[j][2] = 1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[2];
 
-        }
+          }
 
-        sasa += Si*sasai/100; //nm2
+          sasa += Si*sasai/100; //nm2
 
-        derivatives[i][0] += Si*sasai/10*dAijt_di[0]; //nm
-        derivatives[i][1] += Si*sasai/10*dAijt_di[1];
-        derivatives[i][2] += Si*sasai/10*dAijt_di[2];
+          omp_deriv[i][0] += Si*sasai/10*dAijt_di[0]; //nm
+          omp_deriv[i][1] += Si*sasai/10*dAijt_di[1];
+          omp_deriv[i][2] += Si*sasai/10*dAijt_di[2];
 
-        for (unsigned j = 0; j < Nlist[i].size(); j++) {
-          derivatives[Nlist[i][j]][0] += Si*sasai/10*derTerm[j][0]; //nm
-          derivatives[Nlist[i][j]][1] += Si*sasai/10*derTerm[j][1];
-          derivatives[Nlist[i][j]][2] += Si*sasai/10*derTerm[j][2];
+          for (unsigned j = 0; j < Nlist[i].size(); j++) {
+            omp_deriv[Nlist[i][j]][0] += Si*sasai/10*derTerm[j][0]; //nm
+            omp_deriv[Nlist[i][j]][1] += Si*sasai/10*derTerm[j][1];
+            omp_deriv[Nlist[i][j]][2] += Si*sasai/10*derTerm[j][2];
+          }
         }
       }
+      #pragma omp critical
+      for(unsigned i = 0; i < natoms; i++) derivatives[i] += omp_deriv[i];
     }
   }
 
@@ -900,96 +901,104 @@ void SASA_HASEL::calculate() {
     }
 
 
-    for(unsigned i = 0; i < natoms; i++) {
-
-
-
-      if(SASAparam[i].size() > 0) {
-        double ri = SASAparam[i][0];
-        Si = 4*M_PI*ri*ri;
-        sasai = 1.0;
-
-        vector <vector <double> > derTerm( Nlist[i].size(), vector <double>(3));
-
-        dAijt_di[0] = 0;
-        dAijt_di[1] = 0;
-        dAijt_di[2] = 0;
-        int NumRes_i = moldat->getResidueNumber(atoms[i]);
-
-        for (unsigned j = 0; j < Nlist[i].size(); j++) {
-          double pij = 0.3516;
-
-          int NumRes_j = moldat->getResidueNumber(atoms[Nlist[i][j]]);
-          if (NumRes_i==NumRes_j) {
-            if (CONNECTparam[i][0].compare(AtomResidueName[0][Nlist[i][j]])==0 || CONNECTparam[i][1].compare(AtomResidueName[0][Nlist[i][j]])==0 || CONNECTparam[i][2].compare(AtomResidueName[0][Nlist[i][j]])==0 || CONNECTparam[i][3].compare(AtomResidueName[0][Nlist[i][j]])==0) {
-              pij = 0.8875;
+    #pragma omp parallel num_threads(nt)
+    {
+      double Si, sasai, bij;
+      vector <double> ddij_di(3);
+      vector <double> dbij_di(3);
+      vector <double> dAijt_di(3);
+      vector<Vector> omp_deriv( natoms );
+      #pragma omp for reduction(+:sasa) nowait
+      for(unsigned i = 0; i < natoms; i++) {
+        if(SASAparam[i].size() > 0) {
+          double ri = SASAparam[i][0];
+          Si = 4*M_PI*ri*ri;
+          sasai = 1.0;
+
+          vector <vector <double> > derTerm( Nlist[i].size(), vector <double>(3));
+
+          dAijt_di[0] = 0;
+          dAijt_di[1] = 0;
+          dAijt_di[2] = 0;
+          int NumRes_i = moldat->getResidueNumber(atoms[i]);
+
+          for (unsigned j = 0; j < Nlist[i].size(); j++) {
+            double pij = 0.3516;
+
+            int NumRes_j = moldat->getResidueNumber(atoms[Nlist[i][j]]);
+            if (NumRes_i==NumRes_j) {
+              if (CONNECTparam[i][0].compare(AtomResidueName[0][Nlist[i][j]])==0 || CONNECTparam[i][1].compare(AtomResidueName[0][Nlist[i][j]])==0 || CONNECTparam[i][2].compare(AtomResidueName[0][Nlist[i][j]])==0 || CONNECTparam[i][3].compare(AtomResidueName[0][Nlist[i][j]])==0) {
+                pij = 0.8875;
+              }
             }
-          }
-          if ( abs(NumRes_i-NumRes_j) == 1 ) {
-            if ((AtomResidueName[0][i] == "N"  && AtomResidueName[0][Nlist[i][j]]== "CA") || (AtomResidueName[0][Nlist[i][j]] == "N"  && AtomResidueName[0][i]== "CA")) {
-              pij = 0.8875;
+            if ( abs(NumRes_i-NumRes_j) == 1 ) {
+              if ((AtomResidueName[0][i] == "N"  && AtomResidueName[0][Nlist[i][j]]== "CA") || (AtomResidueName[0][Nlist[i][j]] == "N"  && AtomResidueName[0][i]== "CA")) {
+                pij = 0.8875;
+              }
             }
-          }
 
-          const Vector d_ij_vec = delta( getPosition(i), getPosition(Nlist[i][j]) );
-          double d_ij = d_ij_vec.modulo()*10;
+            const Vector d_ij_vec = delta( getPosition(i), getPosition(Nlist[i][j]) );
+            double d_ij = d_ij_vec.modulo()*10;
 
-          double rj = SASAparam[Nlist[i][j]][0];
-          bij = M_PI*ri*(ri+rj-d_ij)*(1+(rj-ri)/d_ij); //Angstrom2
+            double rj = SASAparam[Nlist[i][j]][0];
+            bij = M_PI*ri*(ri+rj-d_ij)*(1+(rj-ri)/d_ij); //Angstrom2
 
-          sasai = sasai*(1-SASAparam[i][1]*pij*bij/Si); //nondimensional
+            sasai = sasai*(1-SASAparam[i][1]*pij*bij/Si); //nondimensional
 
-          ddij_di[0] = -10*(getPosition(Nlist[i][j])[0]-getPosition(i)[0])/d_ij; //nondimensional
-          ddij_di[1] = -10*(getPosition(Nlist[i][j])[1]-getPosition(i)[1])/d_ij;
-          ddij_di[2] = -10*(getPosition(Nlist[i][j])[2]-getPosition(i)[2])/d_ij;
+            ddij_di[0] = -10*(getPosition(Nlist[i][j])[0]-getPosition(i)[0])/d_ij; //nondimensional
+            ddij_di[1] = -10*(getPosition(Nlist[i][j])[1]-getPosition(i)[1])/d_ij;
+            ddij_di[2] = -10*(getPosition(Nlist[i][j])[2]-getPosition(i)[2])/d_ij;
 
-          dbij_di[0] = -M_PI*ri*ddij_di[0]*(1+(ri+rj)*(rj-ri)/(d_ij*d_ij)); //Angstrom
-          dbij_di[1] = -M_PI*ri*ddij_di[1]*(1+(ri+rj)*(rj-ri)/(d_ij*d_ij));
-          dbij_di[2] = -M_PI*ri*ddij_di[2]*(1+(ri+rj)*(rj-ri)/(d_ij*d_ij));
+            dbij_di[0] = -M_PI*ri*ddij_di[0]*(1+(ri+rj)*(rj-ri)/(d_ij*d_ij)); //Angstrom
+            dbij_di[1] = -M_PI*ri*ddij_di[1]*(1+(ri+rj)*(rj-ri)/(d_ij*d_ij));
+            dbij_di[2] = -M_PI*ri*ddij_di[2]*(1+(ri+rj)*(rj-ri)/(d_ij*d_ij));
 
-          dAijt_di[0] += -1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[0]; //Angstrom-1
-          dAijt_di[1] += -1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[1];
-          dAijt_di[2] += -1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[2];
+            dAijt_di[0] += -1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[0]; //Angstrom-1
+            dAijt_di[1] += -1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[1];
+            dAijt_di[2] += -1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[2];
 
-          derTerm[j][0] = 1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[0]; //Angstrom-1
-          derTerm[j][1] = 1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[1];
-          derTerm[j][2] = 1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[2];
+            derTerm[j][0] = 1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[0]; //Angstrom-1
+            derTerm[j][1] = 1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[1];
+            derTerm[j][2] = 1/(Si/(SASAparam[i][1]*pij)-bij)*dbij_di[2];
 
-        }
+          }
 
-        if (AtomResidueName[0][i] == "N" || AtomResidueName[0][i] == "CA"  || AtomResidueName[0][i] == "C" || AtomResidueName[0][i] == "O" || AtomResidueName[0][i] == "H") {
+          if (AtomResidueName[0][i] == "N" || AtomResidueName[0][i] == "CA"  || AtomResidueName[0][i] == "C" || AtomResidueName[0][i] == "O" || AtomResidueName[0][i] == "H") {
 
-          sasa += Si*sasai/MaxSurf[i][0]*DeltaG[natoms][0]; //kJ/mol
+            sasa += Si*sasai/MaxSurf[i][0]*DeltaG[natoms][0]; //kJ/mol
 
 
-          derivatives[i][0] += Si*sasai*dAijt_di[0]/MaxSurf[i][0]*DeltaG[natoms][0]*10; //kJ/mol/nm
-          derivatives[i][1] += Si*sasai*dAijt_di[1]/MaxSurf[i][0]*DeltaG[natoms][0]*10;
-          derivatives[i][2] += Si*sasai*dAijt_di[2]/MaxSurf[i][0]*DeltaG[natoms][0]*10;
-        }
+            omp_deriv[i][0] += Si*sasai*dAijt_di[0]/MaxSurf[i][0]*DeltaG[natoms][0]*10; //kJ/mol/nm
+            omp_deriv[i][1] += Si*sasai*dAijt_di[1]/MaxSurf[i][0]*DeltaG[natoms][0]*10;
+            omp_deriv[i][2] += Si*sasai*dAijt_di[2]/MaxSurf[i][0]*DeltaG[natoms][0]*10;
+          }
 
-        if (AtomResidueName[0][i] != "N" && AtomResidueName[0][i] != "CA"  && AtomResidueName[0][i] != "C" && AtomResidueName[0][i] != "O" && AtomResidueName[0][i] != "H") {
-          sasa += Si*sasai/MaxSurf[i][1]*DeltaG[i][0]; //kJ/mol
+          if (AtomResidueName[0][i] != "N" && AtomResidueName[0][i] != "CA"  && AtomResidueName[0][i] != "C" && AtomResidueName[0][i] != "O" && AtomResidueName[0][i] != "H") {
+            sasa += Si*sasai/MaxSurf[i][1]*DeltaG[i][0]; //kJ/mol
 
-          derivatives[i][0] += Si*sasai*dAijt_di[0]/MaxSurf[i][1]*DeltaG[i][0]*10; //kJ/mol/nm
-          derivatives[i][1] += Si*sasai*dAijt_di[1]/MaxSurf[i][1]*DeltaG[i][0]*10;
-          derivatives[i][2] += Si*sasai*dAijt_di[2]/MaxSurf[i][1]*DeltaG[i][0]*10;
-        }
+            omp_deriv[i][0] += Si*sasai*dAijt_di[0]/MaxSurf[i][1]*DeltaG[i][0]*10; //kJ/mol/nm
+            omp_deriv[i][1] += Si*sasai*dAijt_di[1]/MaxSurf[i][1]*DeltaG[i][0]*10;
+            omp_deriv[i][2] += Si*sasai*dAijt_di[2]/MaxSurf[i][1]*DeltaG[i][0]*10;
+          }
 
 
-        for (unsigned j = 0; j < Nlist[i].size(); j++) {
-          if (AtomResidueName[0][i] == "N" || AtomResidueName[0][i] == "CA"  || AtomResidueName[0][i] == "C" || AtomResidueName[0][i] == "O" || AtomResidueName[0][i] == "H") {
-            derivatives[Nlist[i][j]][0] += Si*sasai*10*derTerm[j][0]/MaxSurf[i][0]*DeltaG[natoms][0]; //kJ/mol/nm
-            derivatives[Nlist[i][j]][1] += Si*sasai*10*derTerm[j][1]/MaxSurf[i][0]*DeltaG[natoms][0];
-            derivatives[Nlist[i][j]][2] += Si*sasai*10*derTerm[j][2]/MaxSurf[i][0]*DeltaG[natoms][0];
-          }
+          for (unsigned j = 0; j < Nlist[i].size(); j++) {
+            if (AtomResidueName[0][i] == "N" || AtomResidueName[0][i] == "CA"  || AtomResidueName[0][i] == "C" || AtomResidueName[0][i] == "O" || AtomResidueName[0][i] == "H") {
+              omp_deriv[Nlist[i][j]][0] += Si*sasai*10*derTerm[j][0]/MaxSurf[i][0]*DeltaG[natoms][0]; //kJ/mol/nm
+              omp_deriv[Nlist[i][j]][1] += Si*sasai*10*derTerm[j][1]/MaxSurf[i][0]*DeltaG[natoms][0];
+              omp_deriv[Nlist[i][j]][2] += Si*sasai*10*derTerm[j][2]/MaxSurf[i][0]*DeltaG[natoms][0];
+            }
 
-          if (AtomResidueName[0][i] != "N" && AtomResidueName[0][i] != "CA"  && AtomResidueName[0][i] != "C" && AtomResidueName[0][i] != "O" && AtomResidueName[0][i] != "H") {
-            derivatives[Nlist[i][j]][0] += Si*sasai*10*derTerm[j][0]/MaxSurf[i][1]*DeltaG[i][0]; //kJ/mol/nm
-            derivatives[Nlist[i][j]][1] += Si*sasai*10*derTerm[j][1]/MaxSurf[i][1]*DeltaG[i][0];
-            derivatives[Nlist[i][j]][2] += Si*sasai*10*derTerm[j][2]/MaxSurf[i][1]*DeltaG[i][0];
+            if (AtomResidueName[0][i] != "N" && AtomResidueName[0][i] != "CA"  && AtomResidueName[0][i] != "C" && AtomResidueName[0][i] != "O" && AtomResidueName[0][i] != "H") {
+              omp_deriv[Nlist[i][j]][0] += Si*sasai*10*derTerm[j][0]/MaxSurf[i][1]*DeltaG[i][0]; //kJ/mol/nm
+              omp_deriv[Nlist[i][j]][1] += Si*sasai*10*derTerm[j][1]/MaxSurf[i][1]*DeltaG[i][0];
+              omp_deriv[Nlist[i][j]][2] += Si*sasai*10*derTerm[j][2]/MaxSurf[i][1]*DeltaG[i][0];
+            }
           }
         }
       }
+      #pragma omp critical
+      for(unsigned i = 0; i < natoms; i++) derivatives[i] += omp_deriv[i];
     }
   }
 
@@ -19,10 +19,12 @@ freely, subject to the following restrictions:
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 
 #include "Sasa.h"
+#include "OverlapList.h"
 #include "core/ActionRegister.h"
 #include "core/PlumedMain.h"
 #include "core/GenericMolInfo.h"
 #include "core/ActionSet.h"
+#include "tools/OpenMP.h"
 #include <cstdio>
 #include <iostream>
 #include <string>
@@ -42,7 +44,7 @@ namespace sasa {
 /*
 Calculates the solvent accessible surface area (SASA) of a protein molecule, or other properties related to it.
 
-The atoms for which the SASA is desired should be indicated with the keyword ATOMS, and a pdb file of the protein must be provided in input with the MOLINFO keyword. The LCPO algorithm is used for the calculation (please, read and cite \cite Weiser1999). The radius of the solvent is assumed to be 0.14 nm, which is the radius of water molecules. Using the keyword NL_STRIDE it is also possible to specify the frequency with which the neighbor list for the calculation of the SASA is updated (the default is every 10 steps).
+The atoms for which the SASA is desired should be indicated with the keyword ATOMS, and a pdb file of the protein must be provided in input with the MOLINFO keyword. The LCPO algorithm is used for the calculation (please, read and cite \cite Weiser1999). The radius of the solvent is assumed to be 0.14 nm, which is the radius of water molecules. Using the keyword NL_STRIDE it is also possible to specify the frequency with which the neighbor list for the calculation of the SASA is updated (the default is every 10 steps). With the keyword NL_SKIN the list is built with a skin, it is also updated whenever an atom moved by more than half the skin, and the overlaps are then exact at every step. The neighbor list is built with link cells and the calculation is parallelized with OpenMP.
 
 Different properties can be calculated and selected using the TYPE keyword:
 
@@ -146,6 +148,7 @@ private:
   vector < vector < double > > MaxSurf;
   vector < vector < double > > DeltaG;
   vector < vector < int > > Nlist;
+  OverlapList overlaps;
 public:
   static void registerKeywords(Keywords& keys);
   explicit SASA_LCPO(const ActionOptions&);
@@ -167,6 +170,7 @@ void SASA_LCPO::registerKeywords(Keywords& keys) {
   keys.add("atoms","ATOMS","the group of atoms that you are calculating the SASA for");
   keys.add("compulsory","TYPE","TOTAL","The type of calculation you want to perform. Can be TOTAL or TRANSFER");
   keys.add("compulsory", "NL_STRIDE", "The frequency with which the neighbor list is updated.");
+  keys.add("optional","NL_SKIN","a skin in nm for the neighbor list. The list is then also updated whenever an atom moved by more than half the skin, and the overlaps are recomputed exactly at every step");
   keys.add("optional","DELTAGFILE","a file containing the free energy values for backbone and sidechains. Necessary only if TYPE = TRANSFER. A Python script for the computation of free energy of transfer values to describe the effect of osmolyte concentration, temperature and pressure is freely available at https://github.com/andrea-arsiccio/DeltaG-calculation. The script automatically outputs a DeltaG.dat file compatible with this SASA module. If TYPE = TRANSFER and no DELTAGFILE is provided, the free energy values are those describing the effect of temperature, and are computed using the temperature value passed by the MD engine");
   keys.add("optional","APPROACH","either approach 2 or 3. Necessary only if TYPE = TRANSFER and no DELTAGFILE is provided. If TYPE = TRANSFER and no DELTAGFILE is provided, the free energy values are those describing the effect of temperature, and the program must know if approach 2 or 3 (as described in Arsiccio and Shea, Protein Cold Denaturation in Implicit Solvent Simulations: A Transfer Free Energy Approach, J. Phys. Chem. B, 2021) needs to be used to compute them");
   keys.setValueDescription("scalar","the solvent accessible surface area (SASA) of the molecule");
@@ -190,6 +194,9 @@ SASA_LCPO::SASA_LCPO(const ActionOptions&ao):
   std::string Type;
   parse("TYPE",Type);
   parse("NL_STRIDE", stride);
+  double skin=0.0;
+  parse("NL_SKIN", skin);
+  overlaps.setSkin(skin);
   parseFlag("NOPBC",nopbc);
   checkRead();
 
@@ -210,6 +217,8 @@ SASA_LCPO::SASA_LCPO(const ActionOptions&ao):
   }
   log.printf("\n");
 
+  if(skin>0.0) log.printf("  neighbor list skin %f nm\n",skin);
+
   if(nopbc) {
     log<<"  PBC will be ignored\n";
   } else {
@@ -726,27 +735,11 @@ void SASA_LCPO::computeDeltaG() {
 
 //calculates neighbor list
 void SASA_LCPO::calcNlist() {
-  if(!nopbc) makeWhole();
-
+  vector<double> radius(natoms,0.0);
   for(unsigned i = 0; i < natoms; i++) {
-    Nlist[i].clear();
-  }
-
-  for(unsigned i = 0; i < natoms; i++) {
-    if (LCPOparam[i].size()>0) {
-      for (unsigned j = 0; j < i; j++) {
-        if (LCPOparam[j].size()>0) {
-          const Vector Delta_ij_vec = delta( getPosition(i), getPosition(j) );
-          double Delta_ij_mod = Delta_ij_vec.modulo()*10;
-          double overlapD = LCPOparam[i][0]+LCPOparam[j][0];
-          if (Delta_ij_mod < overlapD) {
-            Nlist.at(i).push_back (j);
-            Nlist.at(j).push_back (i);
-          }
-        }
-      }
-    }
+    if (LCPOparam[i].size()>0) radius[i] = LCPOparam[i][0];
   }
+  overlaps.update(getPositions(), radius, OpenMP::getNumThreads(), nl_update == 0, Nlist);
 }
 
 
@@ -759,148 +752,155 @@ void SASA_LCPO::calculate() {
     readPDB();
     readLCPOparam();
   }
-  if (nl_update == 0) {
-    calcNlist();
-  }
-
+  calcNlist();
 
 
-  double S1, Aij, Ajk, Aijk, Aijt, Ajkt, Aikt;
-  double dAdd;
+  // every atom only writes its own derivatives, so the loops over atoms are
+  // split among threads and only the virial is reduced
+  const unsigned nt=OpenMP::getNumThreads();
   double sasa = 0;
   vector<Vector> derivatives( natoms );
   Tensor virial;
-  vector <double> dAijdc_2t(3);
-  vector <double> dSASA_2_neigh_dc(3);
-  vector <double> ddij_di(3);
-  vector <double> ddik_di(3);
 
   if( sasa_type==TOTAL ) {
-    for(unsigned i = 0; i < natoms; i++) {
-      derivatives[i][0] = 0.;
-      derivatives[i][1] = 0.;
-      derivatives[i][2] = 0.;
-      if ( LCPOparam[i].size()>1) {
-        if (LCPOparam[i][1]>0.0) {
-          Aij = 0.0;
-          Aijk = 0.0;
-          Ajk = 0.0;
-          double ri = LCPOparam[i][0];
-          S1 = 4*M_PI*ri*ri;
-          vector <double> dAijdc_2(3, 0);
-          vector <double> dAijdc_4(3, 0);
-
-
-          for (unsigned j = 0; j < Nlist[i].size(); j++) {
-            const Vector d_ij_vec = delta( getPosition(i), getPosition(Nlist[i][j]) );
-            double d_ij = d_ij_vec.modulo()*10;
-
-            double rj = LCPOparam[Nlist[i][j]][0];
-            Aijt = (2*M_PI*ri*(ri-d_ij/2-((ri*ri-rj*rj)/(2*d_ij))));
-            double sji = (2*M_PI*rj*(rj-d_ij/2+((ri*ri-rj*rj)/(2*d_ij))));
-
-            dAdd = M_PI*rj*(-(ri*ri-rj*rj)/(d_ij*d_ij)-1);
-
-            ddij_di[0] = -10*(getPosition(Nlist[i][j])[0]-getPosition(i)[0])/d_ij;
-            ddij_di[1] = -10*(getPosition(Nlist[i][j])[1]-getPosition(i)[1])/d_ij;
-            ddij_di[2] = -10*(getPosition(Nlist[i][j])[2]-getPosition(i)[2])/d_ij;
-
-            Ajkt = 0.0;
-            Aikt = 0.0;
-
-            vector <double> dSASA_3_neigh_dc(3, 0.0);
-            vector <double> dSASA_4_neigh_dc(3, 0.0);
-            vector <double> dSASA_3_neigh_dc2(3, 0.0);
-            vector <double> dSASA_4_neigh_dc2(3, 0.0);
-
-            dSASA_2_neigh_dc[0] = dAdd * ddij_di[0];
-            dSASA_2_neigh_dc[1] = dAdd * ddij_di[1];
-            dSASA_2_neigh_dc[2] = dAdd * ddij_di[2];
-
-            dAdd = M_PI*ri*((ri*ri-rj*rj)/(d_ij*d_ij)-1);
-
-
-            dAijdc_2t[0] = dAdd * ddij_di[0];
-            dAijdc_2t[1] = dAdd * ddij_di[1];
-            dAijdc_2t[2] = dAdd * ddij_di[2];
-
-            for (unsigned k = 0; k < Nlist[Nlist[i][j]].size(); k++) {
-              if (std::find (Nlist[i].begin(), Nlist[i].end(), Nlist[Nlist[i][j]][k]) !=  Nlist[i].end()) {
-                const Vector d_jk_vec = delta( getPosition(Nlist[i][j]), getPosition(Nlist[Nlist[i][j]][k]) );
-                const Vector d_ik_vec = delta( getPosition(i), getPosition(Nlist[Nlist[i][j]][k]) );
-
-                double d_jk = d_jk_vec.modulo()*10;
-                double d_ik = d_ik_vec.modulo()*10;
-
-                double rk = LCPOparam[Nlist[Nlist[i][j]][k]][0];
-                double sjk =  (2*M_PI*rj*(rj-d_jk/2-((rj*rj-rk*rk)/(2*d_jk))));
-                Ajkt += sjk;
-                Aikt += (2*M_PI*ri*(ri-d_ik/2-((ri*ri-rk*rk)/(2*d_ik))));
-
-                dAdd = M_PI*ri*((ri*ri-rk*rk)/(d_ik*d_ik)-1);
-
-                ddik_di[0] = -10*(getPosition(Nlist[Nlist[i][j]][k])[0]-getPosition(i)[0])/d_ik;
-                ddik_di[1] = -10*(getPosition(Nlist[Nlist[i][j]][k])[1]-getPosition(i)[1])/d_ik;
-                ddik_di[2] = -10*(getPosition(Nlist[Nlist[i][j]][k])[2]-getPosition(i)[2])/d_ik;
-
-
-                dSASA_3_neigh_dc[0] += dAdd*ddik_di[0];
-                dSASA_3_neigh_dc[1] += dAdd*ddik_di[1];
-                dSASA_3_neigh_dc[2] += dAdd*ddik_di[2];
-
-                dAdd = M_PI*rk*(-(ri*ri-rk*rk)/(d_ik*d_ik)-1);
-
-                dSASA_3_neigh_dc2[0] += dAdd*ddik_di[0];
-                dSASA_3_neigh_dc2[1] += dAdd*ddik_di[1];
-                dSASA_3_neigh_dc2[2] += dAdd*ddik_di[2];
-
-                dSASA_4_neigh_dc2[0] += sjk*dAdd*ddik_di[0];
-                dSASA_4_neigh_dc2[1] += sjk*dAdd*ddik_di[1];
-                dSASA_4_neigh_dc2[2] += sjk*dAdd*ddik_di[2];
-
+    #pragma omp parallel num_threads(nt)
+    {
+      double S1, Aij, Ajk, Aijk, Aijt, Ajkt, Aikt;
+      double dAdd;
+      Tensor omp_virial;
+      vector <double> dAijdc_2t(3);
+      vector <double> dSASA_2_neigh_dc(3);
+      vector <double> ddij_di(3);
+      vector <double> ddik_di(3);
+      #pragma omp for reduction(+:sasa) nowait
+      for(unsigned i = 0; i < natoms; i++) {
+        derivatives[i][0] = 0.;
+        derivatives[i][1] = 0.;
+        derivatives[i][2] = 0.;
+        if ( LCPOparam[i].size()>1) {
+          if (LCPOparam[i][1]>0.0) {
+            Aij = 0.0;
+            Aijk = 0.0;
+            Ajk = 0.0;
+            double ri = LCPOparam[i][0];
+            S1 = 4*M_PI*ri*ri;
+            vector <double> dAijdc_2(3, 0);
+            vector <double> dAijdc_4(3, 0);
+
+
+            for (unsigned j = 0; j < Nlist[i].size(); j++) {
+              const Vector d_ij_vec = delta( getPosition(i), getPosition(Nlist[i][j]) );
+              double d_ij = d_ij_vec.modulo()*10;
+
+              double rj = LCPOparam[Nlist[i][j]][0];
+              Aijt = (2*M_PI*ri*(ri-d_ij/2-((ri*ri-rj*rj)/(2*d_ij))));
+              double sji = (2*M_PI*rj*(rj-d_ij/2+((ri*ri-rj*rj)/(2*d_ij))));
+
+              dAdd = M_PI*rj*(-(ri*ri-rj*rj)/(d_ij*d_ij)-1);
+
+              ddij_di[0] = -10*(getPosition(Nlist[i][j])[0]-getPosition(i)[0])/d_ij;
+              ddij_di[1] = -10*(getPosition(Nlist[i][j])[1]-getPosition(i)[1])/d_ij;
+              ddij_di[2] = -10*(getPosition(Nlist[i][j])[2]-getPosition(i)[2])/d_ij;
+
+              Ajkt = 0.0;
+              Aikt = 0.0;
+
+              vector <double> dSASA_3_neigh_dc(3, 0.0);
+              vector <double> dSASA_4_neigh_dc(3, 0.0);
+              vector <double> dSASA_3_neigh_dc2(3, 0.0);
+              vector <double> dSASA_4_neigh_dc2(3, 0.0);
+
+              dSASA_2_neigh_dc[0] = dAdd * ddij_di[0];
+              dSASA_2_neigh_dc[1] = dAdd * ddij_di[1];
+              dSASA_2_neigh_dc[2] = dAdd * ddij_di[2];
+
+              dAdd = M_PI*ri*((ri*ri-rj*rj)/(d_ij*d_ij)-1);
+
+
+              dAijdc_2t[0] = dAdd * ddij_di[0];
+              dAijdc_2t[1] = dAdd * ddij_di[1];
+              dAijdc_2t[2] = dAdd * ddij_di[2];
+
+              for (unsigned k = 0; k < Nlist[Nlist[i][j]].size(); k++) {
+                if (std::binary_search (Nlist[i].begin(), Nlist[i].end(), Nlist[Nlist[i][j]][k])) {
+                  const Vector d_jk_vec = delta( getPosition(Nlist[i][j]), getPosition(Nlist[Nlist[i][j]][k]) );
+                  const Vector d_ik_vec = delta( getPosition(i), getPosition(Nlist[Nlist[i][j]][k]) );
+
+                  double d_jk = d_jk_vec.modulo()*10;
+                  double d_ik = d_ik_vec.modulo()*10;
+
+                  double rk = LCPOparam[Nlist[Nlist[i][j]][k]][0];
+                  double sjk =  (2*M_PI*rj*(rj-d_jk/2-((rj*rj-rk*rk)/(2*d_jk))));
+                  Ajkt += sjk;
+                  Aikt += (2*M_PI*ri*(ri-d_ik/2-((ri*ri-rk*rk)/(2*d_ik))));
+
+                  dAdd = M_PI*ri*((ri*ri-rk*rk)/(d_ik*d_ik)-1);
+
+                  ddik_di[0] = -10*(getPosition(Nlist[Nlist[i][j]][k])[0]-getPosition(i)[0])/d_ik;
+                  ddik_di[1] = -10*(getPosition(Nlist[Nlist[i][j]][k])[1]-getPosition(i)[1])/d_ik;
+                  ddik_di[2] = -10*(getPosition(Nlist[Nlist[i][j]][k])[2]-getPosition(i)[2])/d_ik;
+
+
+                  dSASA_3_neigh_dc[0] += dAdd*ddik_di[0];
+                  dSASA_3_neigh_dc[1] += dAdd*ddik_di[1];
+                  dSASA_3_neigh_dc[2] += dAdd*ddik_di[2];
+
+                  dAdd = M_PI*rk*(-(ri*ri-rk*rk)/(d_ik*d_ik)-1);
+
+                  dSASA_3_neigh_dc2[0] += dAdd*ddik_di[0];
+                  dSASA_3_neigh_dc2[1] += dAdd*ddik_di[1];
+                  dSASA_3_neigh_dc2[2] += dAdd*ddik_di[2];
+
+                  dSASA_4_neigh_dc2[0] += sjk*dAdd*ddik_di[0];
+                  dSASA_4_neigh_dc2[1] += sjk*dAdd*ddik_di[1];
+                  dSASA_4_neigh_dc2[2] += sjk*dAdd*ddik_di[2];
+
+                }
               }
-            }
-            dSASA_4_neigh_dc[0] = sji*dSASA_3_neigh_dc[0] + dSASA_4_neigh_dc2[0];
-            dSASA_4_neigh_dc[1] = sji*dSASA_3_neigh_dc[1] + dSASA_4_neigh_dc2[1];
-            dSASA_4_neigh_dc[2] = sji*dSASA_3_neigh_dc[2] + dSASA_4_neigh_dc2[2];
+              dSASA_4_neigh_dc[0] = sji*dSASA_3_neigh_dc[0] + dSASA_4_neigh_dc2[0];
+              dSASA_4_neigh_dc[1] = sji*dSASA_3_neigh_dc[1] + dSASA_4_neigh_dc2[1];
+              dSASA_4_neigh_dc[2] = sji*dSASA_3_neigh_dc[2] + dSASA_4_neigh_dc2[2];
 
-            dSASA_3_neigh_dc[0] += dSASA_3_neigh_dc2[0];
-            dSASA_3_neigh_dc[1] += dSASA_3_neigh_dc2[1];
-            dSASA_3_neigh_dc[2] += dSASA_3_neigh_dc2[2];
+              dSASA_3_neigh_dc[0] += dSASA_3_neigh_dc2[0];
+              dSASA_3_neigh_dc[1] += dSASA_3_neigh_dc2[1];
+              dSASA_3_neigh_dc[2] += dSASA_3_neigh_dc2[2];
 
-            dSASA_4_neigh_dc[0] += dSASA_2_neigh_dc[0] * Aikt;
-            dSASA_4_neigh_dc[1] += dSASA_2_neigh_dc[1] * Aikt;
-            dSASA_4_neigh_dc[2] += dSASA_2_neigh_dc[2] * Aikt;
+              dSASA_4_neigh_dc[0] += dSASA_2_neigh_dc[0] * Aikt;
+              dSASA_4_neigh_dc[1] += dSASA_2_neigh_dc[1] * Aikt;
+              dSASA_4_neigh_dc[2] += dSASA_2_neigh_dc[2] * Aikt;
 
 
-            derivatives[i][0] += (dSASA_2_neigh_dc[0]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[0]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[0]*LCPOparam[Nlist[i][j]][4])/10;
-            derivatives[i][1] += (dSASA_2_neigh_dc[1]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[1]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[1]*LCPOparam[Nlist[i][j]][4])/10;
-            derivatives[i][2] += (dSASA_2_neigh_dc[2]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[2]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[2]*LCPOparam[Nlist[i][j]][4])/10;
+              derivatives[i][0] += (dSASA_2_neigh_dc[0]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[0]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[0]*LCPOparam[Nlist[i][j]][4])/10;
+              derivatives[i][1] += (dSASA_2_neigh_dc[1]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[1]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[1]*LCPOparam[Nlist[i][j]][4])/10;
+              derivatives[i][2] += (dSASA_2_neigh_dc[2]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[2]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[2]*LCPOparam[Nlist[i][j]][4])/10;
 
 
-            Aijk += (Aijt * Ajkt);
-            Aij += Aijt;
-            Ajk += Ajkt;
+              Aijk += (Aijt * Ajkt);
+              Aij += Aijt;
+              Ajk += Ajkt;
 
-            dAijdc_2[0] += dAijdc_2t[0];
-            dAijdc_2[1] += dAijdc_2t[1];
-            dAijdc_2[2] += dAijdc_2t[2];
+              dAijdc_2[0] += dAijdc_2t[0];
+              dAijdc_2[1] += dAijdc_2t[1];
+              dAijdc_2[2] += dAijdc_2t[2];
 
 
-            dAijdc_4[0] += Ajkt*dAijdc_2t[0];
-            dAijdc_4[1] += Ajkt*dAijdc_2t[1];
-            dAijdc_4[2] += Ajkt*dAijdc_2t[2];
+              dAijdc_4[0] += Ajkt*dAijdc_2t[0];
+              dAijdc_4[1] += Ajkt*dAijdc_2t[1];
+              dAijdc_4[2] += Ajkt*dAijdc_2t[2];
 
 
+            }
+            double sasai = (LCPOparam[i][1]*S1+LCPOparam[i][2]*Aij+LCPOparam[i][3]*Ajk+LCPOparam[i][4]*Aijk);
+            if (sasai > 0 ) sasa += sasai/100;
+            derivatives[i][0] += (dAijdc_2[0]*LCPOparam[i][2]+dAijdc_4[0]*LCPOparam[i][4])/10;
+            derivatives[i][1] += (dAijdc_2[1]*LCPOparam[i][2]+dAijdc_4[1]*LCPOparam[i][4])/10;
+            derivatives[i][2] += (dAijdc_2[2]*LCPOparam[i][2]+dAijdc_4[2]*LCPOparam[i][4])/10;
           }
-          double sasai = (LCPOparam[i][1]*S1+LCPOparam[i][2]*Aij+LCPOparam[i][3]*Ajk+LCPOparam[i][4]*Aijk);
-          if (sasai > 0 ) sasa += sasai/100;
-          derivatives[i][0] += (dAijdc_2[0]*LCPOparam[i][2]+dAijdc_4[0]*LCPOparam[i][4])/10;
-          derivatives[i][1] += (dAijdc_2[1]*LCPOparam[i][2]+dAijdc_4[1]*LCPOparam[i][4])/10;
-          derivatives[i][2] += (dAijdc_2[2]*LCPOparam[i][2]+dAijdc_4[2]*LCPOparam[i][4])/10;
         }
+        omp_virial -= Tensor(getPosition(i),derivatives[i]);
       }
-      virial -= Tensor(getPosition(i),derivatives[i]);
+      #pragma omp critical
+      virial += omp_virial;
     }
   }
 
@@ -921,147 +921,157 @@ void SASA_LCPO::calculate() {
     }
 
 
-    for(unsigned i = 0; i < natoms; i++) {
-
+    #pragma omp parallel num_threads(nt)
+    {
+      double S1, Aij, Ajk, Aijk, Aijt, Ajkt, Aikt;
+      double dAdd;
+      Tensor omp_virial;
+      vector <double> dAijdc_2t(3);
+      vector <double> dSASA_2_neigh_dc(3);
+      vector <double> ddij_di(3);
+      vector <double> ddik_di(3);
+      #pragma omp for reduction(+:sasa) nowait
+      for(unsigned i = 0; i < natoms; i++) {
+        derivatives[i][0] = 0.;
+        derivatives[i][1] = 0.;
+        derivatives[i][2] = 0.;
 
+        if ( LCPOparam[i].size()>1) {
+          if (LCPOparam[i][1]>0.0) {
+            Aij = 0.0;
+            Aijk = 0.0;
+            Ajk = 0.0;
+            double ri = LCPOparam[i][0];
+            S1 = 4*M_PI*ri*ri;
+            vector <double> dAijdc_2(3, 0);
+            vector <double> dAijdc_4(3, 0);
 
-      derivatives[i][0] = 0.;
-      derivatives[i][1] = 0.;
-      derivatives[i][2] = 0.;
 
-      if ( LCPOparam[i].size()>1) {
-        if (LCPOparam[i][1]>0.0) {
-          Aij = 0.0;
-          Aijk = 0.0;
-          Ajk = 0.0;
-          double ri = LCPOparam[i][0];
-          S1 = 4*M_PI*ri*ri;
-          vector <double> dAijdc_2(3, 0);
-          vector <double> dAijdc_4(3, 0);
+            for (unsigned j = 0; j < Nlist[i].size(); j++) {
+              const Vector d_ij_vec = delta( getPosition(i), getPosition(Nlist[i][j]) );
+              double d_ij = d_ij_vec.modulo()*10;
 
+              double rj = LCPOparam[Nlist[i][j]][0];
+              Aijt = (2*M_PI*ri*(ri-d_ij/2-((ri*ri-rj*rj)/(2*d_ij))));
+              double sji = (2*M_PI*rj*(rj-d_ij/2+((ri*ri-rj*rj)/(2*d_ij))));
 
-          for (unsigned j = 0; j < Nlist[i].size(); j++) {
-            const Vector d_ij_vec = delta( getPosition(i), getPosition(Nlist[i][j]) );
-            double d_ij = d_ij_vec.modulo()*10;
+              dAdd = M_PI*rj*(-(ri*ri-rj*rj)/(d_ij*d_ij)-1);
+              ddij_di[0] = -10*(getPosition(Nlist[i][j])[0]-getPosition(i)[0])/d_ij;
+              ddij_di[1] = -10*(getPosition(Nlist[i][j])[1]-getPosition(i)[1])/d_ij;
+              ddij_di[2] = -10*(getPosition(Nlist[i][j])[2]-getPosition(i)[2])/d_ij;
 
-            double rj = LCPOparam[Nlist[i][j]][0];
-            Aijt = (2*M_PI*ri*(ri-d_ij/2-((ri*ri-rj*rj)/(2*d_ij))));
-            double sji = (2*M_PI*rj*(rj-d_ij/2+((ri*ri-rj*rj)/(2*d_ij))));
+              Ajkt = 0.0;
+              Aikt = 0.0;
 
-            dAdd = M_PI*rj*(-(ri*ri-rj*rj)/(d_ij*d_ij)-1);
-            ddij_di[0] = -10*(getPosition(Nlist[i][j])[0]-getPosition(i)[0])/d_ij;
-            ddij_di[1] = -10*(getPosition(Nlist[i][j])[1]-getPosition(i)[1])/d_ij;
-            ddij_di[2] = -10*(getPosition(Nlist[i][j])[2]-getPosition(i)[2])/d_ij;
+              vector <double> dSASA_3_neigh_dc(3, 0.0);
+              vector <double> dSASA_4_neigh_dc(3, 0.0);
+              vector <double> dSASA_3_neigh_dc2(3, 0.0);
+              vector <double> dSASA_4_neigh_dc2(3, 0.0);
 
-            Ajkt = 0.0;
-            Aikt = 0.0;
+              dSASA_2_neigh_dc[0] = dAdd * ddij_di[0];
+              dSASA_2_neigh_dc[1] = dAdd * ddij_di[1];
+              dSASA_2_neigh_dc[2] = dAdd * ddij_di[2];
 
-            vector <double> dSASA_3_neigh_dc(3, 0.0);
-            vector <double> dSASA_4_neigh_dc(3, 0.0);
-            vector <double> dSASA_3_neigh_dc2(3, 0.0);
-            vector <double> dSASA_4_neigh_dc2(3, 0.0);
+              dAdd = M_PI*ri*((ri*ri-rj*rj)/(d_ij*d_ij)-1);
 
-            dSASA_2_neigh_dc[0] = dAdd * ddij_di[0];
-            dSASA_2_neigh_dc[1] = dAdd * ddij_di[1];
-            dSASA_2_neigh_dc[2] = dAdd * ddij_di[2];
+              dAijdc_2t[0] = dAdd * ddij_di[0];
+              dAijdc_2t[1] = dAdd * ddij_di[1];
+              dAijdc_2t[2] = dAdd * ddij_di[2];
 
-            dAdd = M_PI*ri*((ri*ri-rj*rj)/(d_ij*d_ij)-1);
+              for (unsigned k = 0; k < Nlist[Nlist[i][j]].size(); k++) {
+                if (std::binary_search (Nlist[i].begin(), Nlist[i].end(), Nlist[Nlist[i][j]][k])) {
+                  const Vector d_jk_vec = delta( getPosition(Nlist[i][j]), getPosition(Nlist[Nlist[i][j]][k]) );
+                  const Vector d_ik_vec = delta( getPosition(i), getPosition(Nlist[Nlist[i][j]][k]) );
 
-            dAijdc_2t[0] = dAdd * ddij_di[0];
-            dAijdc_2t[1] = dAdd * ddij_di[1];
-            dAijdc_2t[2] = dAdd * ddij_di[2];
+                  double d_jk = d_jk_vec.modulo()*10;
+                  double d_ik = d_ik_vec.modulo()*10;
 
-            for (unsigned k = 0; k < Nlist[Nlist[i][j]].size(); k++) {
-              if (std::find (Nlist[i].begin(), Nlist[i].end(), Nlist[Nlist[i][j]][k]) !=  Nlist[i].end()) {
-                const Vector d_jk_vec = delta( getPosition(Nlist[i][j]), getPosition(Nlist[Nlist[i][j]][k]) );
-                const Vector d_ik_vec = delta( getPosition(i), getPosition(Nlist[Nlist[i][j]][k]) );
+                  double rk = LCPOparam[Nlist[Nlist[i][j]][k]][0];
+                  double sjk =  (2*M_PI*rj*(rj-d_jk/2-((rj*rj-rk*rk)/(2*d_jk))));
+                  Ajkt += sjk;
+                  Aikt += (2*M_PI*ri*(ri-d_ik/2-((ri*ri-rk*rk)/(2*d_ik))));
 
-                double d_jk = d_jk_vec.modulo()*10;
-                double d_ik = d_ik_vec.modulo()*10;
+                  dAdd = M_PI*ri*((ri*ri-rk*rk)/(d_ik*d_ik)-1);
 
-                double rk = LCPOparam[Nlist[Nlist[i][j]][k]][0];
-                double sjk =  (2*M_PI*rj*(rj-d_jk/2-((rj*rj-rk*rk)/(2*d_jk))));
-                Ajkt += sjk;
-                Aikt += (2*M_PI*ri*(ri-d_ik/2-((ri*ri-rk*rk)/(2*d_ik))));
+                  ddik_di[0] = -10*(getPosition(Nlist[Nlist[i][j]][k])[0]-getPosition(i)[0])/d_ik;
+                  ddik_di[1] = -10*(getPosition(Nlist[Nlist[i][j]][k])[1]-getPosition(i)[1])/d_ik;
+                  ddik_di[2] = -10*(getPosition(Nlist[Nlist[i][j]][k])[2]-getPosition(i)[2])/d_ik;
 
-                dAdd = M_PI*ri*((ri*ri-rk*rk)/(d_ik*d_ik)-1);
 
-                ddik_di[0] = -10*(getPosition(Nlist[Nlist[i][j]][k])[0]-getPosition(i)[0])/d_ik;
-                ddik_di[1] = -10*(getPosition(Nlist[Nlist[i][j]][k])[1]-getPosition(i)[1])/d_ik;
-                ddik_di[2] = -10*(getPosition(Nlist[Nlist[i][j]][k])[2]-getPosition(i)[2])/d_ik;
+                  dSASA_3_neigh_dc[0] += dAdd*ddik_di[0];
+                  dSASA_3_neigh_dc[1] += dAdd*ddik_di[1];
+                  dSASA_3_neigh_dc[2] += dAdd*ddik_di[2];
 
+                  dAdd = M_PI*rk*(-(ri*ri-rk*rk)/(d_ik*d_ik)-1);
 
-                dSASA_3_neigh_dc[0] += dAdd*ddik_di[0];
-                dSASA_3_neigh_dc[1] += dAdd*ddik_di[1];
-                dSASA_3_neigh_dc[2] += dAdd*ddik_di[2];
+                  dSASA_3_neigh_dc2[0] += dAdd*ddik_di[0];
+                  dSASA_3_neigh_dc2[1] += dAdd*ddik_di[1];
+                  dSASA_3_neigh_dc2[2] += dAdd*ddik_di[2];
 
-                dAdd = M_PI*rk*(-(ri*ri-rk*rk)/(d_ik*d_ik)-1);
-
-                dSASA_3_neigh_dc2[0] += dAdd*ddik_di[0];
-                dSASA_3_neigh_dc2[1] += dAdd*ddik_di[1];
-                dSASA_3_neigh_dc2[2] += dAdd*ddik_di[2];
-
-                dSASA_4_neigh_dc2[0] += sjk*dAdd*ddik_di[0];
-                dSASA_4_neigh_dc2[1] += sjk*dAdd*ddik_di[1];
-                dSASA_4_neigh_dc2[2] += sjk*dAdd*ddik_di[2];
+                  dSASA_4_neigh_dc2[0] += sjk*dAdd*ddik_di[0];
+                  dSASA_4_neigh_dc2[1] += sjk*dAdd*ddik_di[1];
+                  dSASA_4_neigh_dc2[2] += sjk*dAdd*ddik_di[2];
 
+                }
+              }
+              dSASA_4_neigh_dc[0] = sji*dSASA_3_neigh_dc[0] + dSASA_4_neigh_dc2[0];
+              dSASA_4_neigh_dc[1] = sji*dSASA_3_neigh_dc[1] + dSASA_4_neigh_dc2[1];
+              dSASA_4_neigh_dc[2] = sji*dSASA_3_neigh_dc[2] + dSASA_4_neigh_dc2[2];
+
+              dSASA_3_neigh_dc[0] += dSASA_3_neigh_dc2[0];
+              dSASA_3_neigh_dc[1] += dSASA_3_neigh_dc2[1];
+              dSASA_3_neigh_dc[2] += dSASA_3_neigh_dc2[2];
+
+              dSASA_4_neigh_dc[0] += dSASA_2_neigh_dc[0] * Aikt;
+              dSASA_4_neigh_dc[1] += dSASA_2_neigh_dc[1] * Aikt;
+              dSASA_4_neigh_dc[2] += dSASA_2_neigh_dc[2] * Aikt;
+
+              if (AtomResidueName[0][Nlist[i][j]] == "N" || AtomResidueName[0][Nlist[i][j]] == "CA"  || AtomResidueName[0][Nlist[i][j]] == "C" || AtomResidueName[0][Nlist[i][j]] == "O") {
+                derivatives[i][0] += ((dSASA_2_neigh_dc[0]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[0]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[0]*LCPOparam[Nlist[i][j]][4])/MaxSurf[Nlist[i][j]][0]*DeltaG[natoms][0])*10;
+                derivatives[i][1] += ((dSASA_2_neigh_dc[1]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[1]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[1]*LCPOparam[Nlist[i][j]][4])/MaxSurf[Nlist[i][j]][0]*DeltaG[natoms][0])*10;
+                derivatives[i][2] += ((dSASA_2_neigh_dc[2]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[2]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[2]*LCPOparam[Nlist[i][j]][4])/MaxSurf[Nlist[i][j]][0]*DeltaG[natoms][0])*10;
               }
-            }
-            dSASA_4_neigh_dc[0] = sji*dSASA_3_neigh_dc[0] + dSASA_4_neigh_dc2[0];
-            dSASA_4_neigh_dc[1] = sji*dSASA_3_neigh_dc[1] + dSASA_4_neigh_dc2[1];
-            dSASA_4_neigh_dc[2] = sji*dSASA_3_neigh_dc[2] + dSASA_4_neigh_dc2[2];
-
-            dSASA_3_neigh_dc[0] += dSASA_3_neigh_dc2[0];
-            dSASA_3_neigh_dc[1] += dSASA_3_neigh_dc2[1];
-            dSASA_3_neigh_dc[2] += dSASA_3_neigh_dc2[2];
-
-            dSASA_4_neigh_dc[0] += dSASA_2_neigh_dc[0] * Aikt;
-            dSASA_4_neigh_dc[1] += dSASA_2_neigh_dc[1] * Aikt;
-            dSASA_4_neigh_dc[2] += dSASA_2_neigh_dc[2] * Aikt;
-
-            if (AtomResidueName[0][Nlist[i][j]] == "N" || AtomResidueName[0][Nlist[i][j]] == "CA"  || AtomResidueName[0][Nlist[i][j]] == "C" || AtomResidueName[0][Nlist[i][j]] == "O") {
-              derivatives[i][0] += ((dSASA_2_neigh_dc[0]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[0]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[0]*LCPOparam[Nlist[i][j]][4])/MaxSurf[Nlist[i][j]][0]*DeltaG[natoms][0])*10;
-              derivatives[i][1] += ((dSASA_2_neigh_dc[1]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[1]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[1]*LCPOparam[Nlist[i][j]][4])/MaxSurf[Nlist[i][j]][0]*DeltaG[natoms][0])*10;
-              derivatives[i][2] += ((dSASA_2_neigh_dc[2]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[2]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[2]*LCPOparam[Nlist[i][j]][4])/MaxSurf[Nlist[i][j]][0]*DeltaG[natoms][0])*10;
-            }
 
-            if (AtomResidueName[0][Nlist[i][j]] != "N" && AtomResidueName[0][Nlist[i][j]] != "CA"  && AtomResidueName[0][Nlist[i][j]] != "C" && AtomResidueName[0][Nlist[i][j]] != "O") {
-              derivatives[i][0] += ((dSASA_2_neigh_dc[0]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[0]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[0]*LCPOparam[Nlist[i][j]][4])/MaxSurf[Nlist[i][j]][1]*DeltaG[Nlist[i][j]][0])*10;
-              derivatives[i][1] += ((dSASA_2_neigh_dc[1]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[1]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[1]*LCPOparam[Nlist[i][j]][4])/MaxSurf[Nlist[i][j]][1]*DeltaG[Nlist[i][j]][0])*10;
-              derivatives[i][2] += ((dSASA_2_neigh_dc[2]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[2]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[2]*LCPOparam[Nlist[i][j]][4])/MaxSurf[Nlist[i][j]][1]*DeltaG[Nlist[i][j]][0])*10;
-            }
+              if (AtomResidueName[0][Nlist[i][j]] != "N" && AtomResidueName[0][Nlist[i][j]] != "CA"  && AtomResidueName[0][Nlist[i][j]] != "C" && AtomResidueName[0][Nlist[i][j]] != "O") {
+                derivatives[i][0] += ((dSASA_2_neigh_dc[0]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[0]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[0]*LCPOparam[Nlist[i][j]][4])/MaxSurf[Nlist[i][j]][1]*DeltaG[Nlist[i][j]][0])*10;
+                derivatives[i][1] += ((dSASA_2_neigh_dc[1]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[1]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[1]*LCPOparam[Nlist[i][j]][4])/MaxSurf[Nlist[i][j]][1]*DeltaG[Nlist[i][j]][0])*10;
+                derivatives[i][2] += ((dSASA_2_neigh_dc[2]*LCPOparam[Nlist[i][j]][2] + dSASA_3_neigh_dc[2]*LCPOparam[Nlist[i][j]][3]+dSASA_4_neigh_dc[2]*LCPOparam[Nlist[i][j]][4])/MaxSurf[Nlist[i][j]][1]*DeltaG[Nlist[i][j]][0])*10;
+              }
 
-            Aijk += (Aijt * Ajkt);
-            Aij += Aijt;
-            Ajk += Ajkt;
+              Aijk += (Aijt * Ajkt);
+              Aij += Aijt;
+              Ajk += Ajkt;
 
-            dAijdc_2[0] += dAijdc_2t[0];
-            dAijdc_2[1] += dAijdc_2t[1];
-            dAijdc_2[2] += dAijdc_2t[2];
+              dAijdc_2[0] += dAijdc_2t[0];
+              dAijdc_2[1] += dAijdc_2t[1];
+              dAijdc_2[2] += dAijdc_2t[2];
 
-            dAijdc_4[0] += Ajkt*dAijdc_2t[0];
-            dAijdc_4[1] += Ajkt*dAijdc_2t[1];
-            dAijdc_4[2] += Ajkt*dAijdc_2t[2];
+              dAijdc_4[0] += Ajkt*dAijdc_2t[0];
+              dAijdc_4[1] += Ajkt*dAijdc_2t[1];
+              dAijdc_4[2] += Ajkt*dAijdc_2t[2];
 
-          }
-          double sasai = (LCPOparam[i][1]*S1+LCPOparam[i][2]*Aij+LCPOparam[i][3]*Ajk+LCPOparam[i][4]*Aijk);
+            }
+            double sasai = (LCPOparam[i][1]*S1+LCPOparam[i][2]*Aij+LCPOparam[i][3]*Ajk+LCPOparam[i][4]*Aijk);
 
-          if (AtomResidueName[0][i] == "N" || AtomResidueName[0][i] == "CA"  || AtomResidueName[0][i] == "C" || AtomResidueName[0][i] == "O") {
-            if (sasai > 0 ) sasa += (sasai/MaxSurf[i][0]*DeltaG[natoms][0]);
-            derivatives[i][0] += ((dAijdc_2[0]*LCPOparam[i][2]+dAijdc_4[0]*LCPOparam[i][4])/MaxSurf[i][0]*DeltaG[natoms][0])*10;
-            derivatives[i][1] += ((dAijdc_2[1]*LCPOparam[i][2]+dAijdc_4[1]*LCPOparam[i][4])/MaxSurf[i][0]*DeltaG[natoms][0])*10;
-            derivatives[i][2] += ((dAijdc_2[2]*LCPOparam[i][2]+dAijdc_4[2]*LCPOparam[i][4])/MaxSurf[i][0]*DeltaG[natoms][0])*10;
-          }
+            if (AtomResidueName[0][i] == "N" || AtomResidueName[0][i] == "CA"  || AtomResidueName[0][i] == "C" || AtomResidueName[0][i] == "O") {
+              if (sasai > 0 ) sasa += (sasai/MaxSurf[i][0]*DeltaG[natoms][0]);
+              derivatives[i][0] += ((dAijdc_2[0]*LCPOparam[i][2]+dAijdc_4[0]*LCPOparam[i][4])/MaxSurf[i][0]*DeltaG[natoms][0])*10;
+              derivatives[i][1] += ((dAijdc_2[1]*LCPOparam[i][2]+dAijdc_4[1]*LCPOparam[i][4])/MaxSurf[i][0]*DeltaG[natoms][0])*10;
+              derivatives[i][2] += ((dAijdc_2[2]*LCPOparam[i][2]+dAijdc_4[2]*LCPOparam[i][4])/MaxSurf[i][0]*DeltaG[natoms][0])*10;
+            }
 
-          if (AtomResidueName[0][i] != "N" && AtomResidueName[0][i] != "CA"  && AtomResidueName[0][i] != "C" && AtomResidueName[0][i] != "O") {
-            if (sasai > 0. ) sasa += (sasai/MaxSurf[i][1]*DeltaG[i][0]);
-            derivatives[i][0] += ((dAijdc_2[0]*LCPOparam[i][2]+dAijdc_4[0]*LCPOparam[i][4])/MaxSurf[i][1]*DeltaG[i][0])*10;
-            derivatives[i][1] += ((dAijdc_2[1]*LCPOparam[i][2]+dAijdc_4[1]*LCPOparam[i][4])/MaxSurf[i][1]*DeltaG[i][0])*10;
-            derivatives[i][2] += ((dAijdc_2[2]*LCPOparam[i][2]+dAijdc_4[2]*LCPOparam[i][4])/MaxSurf[i][1]*DeltaG[i][0])*10;
+            if (AtomResidueName[0][i] != "N" && AtomResidueName[0][i] != "CA"  && AtomResidueName[0][i] != "C" && AtomResidueName[0][i] != "O") {
+              if (sasai > 0. ) sasa += (sasai/MaxSurf[i][1]*DeltaG[i][0]);
+              derivatives[i][0] += ((dAijdc_2[0]*LCPOparam[i][2]+dAijdc_4[0]*LCPOparam[i][4])/MaxSurf[i][1]*DeltaG[i][0])*10;
+              derivatives[i][1] += ((dAijdc_2[1]*LCPOparam[i][2]+dAijdc_4[1]*LCPOparam[i][4])/MaxSurf[i][1]*DeltaG[i][0])*10;
+              derivatives[i][2] += ((dAijdc_2[2]*LCPOparam[i][2]+dAijdc_4[2]*LCPOparam[i][4])/MaxSurf[i][1]*DeltaG[i][0])*10;
+            }
           }
         }
+        omp_virial -= Tensor(getPosition(i),derivatives[i]);
       }
-      virial -= Tensor(getPosition(i),derivatives[i]);
+      #pragma omp critical
+      virial += omp_virial;
     }
   }
 
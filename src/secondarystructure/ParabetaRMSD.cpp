@@ -265,6 +265,8 @@ ParabetaRMSD::ParabetaRMSD(const ActionOptions&ao):
   std::string strands_cutoff; parse("STRANDS_CUTOFF",strands_cutoff);
   std::string nopbcstr=""; bool nopbc; parseFlag("NOPBC",nopbc); if( nopbc ) nopbcstr = " NOPBC";
   if( strands_cutoff.length()>0 ) strands_cutoff=" CUTOFF_ATOMS=6,21 STRANDS_CUTOFF="+strands_cutoff;
+  std::string strands_skin; parse("STRANDS_SKIN",strands_skin);
+  if( strands_skin.length()>0 ) strands_cutoff+=" STRANDS_SKIN="+strands_skin;
   std::string type; parse("TYPE",type); std::string lab = getShortcutLabel() + "_low"; if( uselessthan ) lab = getShortcutLabel();
   readInputLine( getShortcutLabel() + "_both: SECONDARY_STRUCTURE_RMSD BONDLENGTH=0.17" + seglist + structure + " " + atoms + " TYPE=" + type + strands_cutoff + nopbcstr );
   if( ltmap.length()>0 ) {
@@ -25,6 +25,10 @@
 #include "core/GenericMolInfo.h"
 #include "core/ActionShortcut.h"
 #include "core/ActionRegister.h"
+#include "tools/Communicator.h"
+#include "tools/LinkCells.h"
+#include <algorithm>
+#include <map>
 
 //+PLUMEDOC MCOLVAR SECONDARY_STRUCTURE_RMSD
 /*
@@ -80,6 +84,9 @@ void SecondaryStructureRMSD::registerKeywords( Keywords& keys ) {
            "This keyword speeds up the calculation enormously when you are using the LESS_THAN option. "
            "However, if you are using some other option, then this cannot be used");
   keys.add("optional","CUTOFF_ATOMS","the pair of atoms that are used to calculate the strand cutoff");
+  keys.add("optional","STRANDS_SKIN","the skin of the list of segments whose strands might be closer than STRANDS_CUTOFF. "
+           "If it is set, the list is only rebuilt when one of the atoms used for the cutoff moves by more than half the skin. "
+           "Otherwise the list is rebuilt with link cells on every step");
   keys.addFlag("VERBOSE",false,"write a more detailed output");
   keys.add("optional","LESS_THAN","calculate the number of a residue segments that are within a certain target distance of this secondary structure type. "
            "This quantity is calculated using \\f$\\sum_i \\sigma(s_i)\\f$, where \\f$\\sigma(s)\\f$ is a \\ref switchingfunction.");
@@ -130,7 +137,8 @@ SecondaryStructureRMSD::SecondaryStructureRMSD(const ActionOptions&ao):
   align_strands(false),
   s_cutoff2(0),
   align_atom_1(0),
-  align_atom_2(0)
+  align_atom_2(0),
+  s_skin(0)
 {
   if( plumed.usingNaturalUnits() ) error("cannot use this collective variable when using natural units");
 
@@ -150,6 +158,8 @@ SecondaryStructureRMSD::SecondaryStructureRMSD(const ActionOptions&ao):
         align_atom_1=cutatoms[0]; align_atom_2=cutatoms[1];
       } else error("did not find CUTOFF_ATOMS in input");
     }
+    parse("STRANDS_SKIN",s_skin);
+    if( s_cutoff>0 && s_skin>0 ) log.printf("  list of segments is updated when the strand atoms move by more than %f\n",0.5*s_skin);
     s_cutoff2=s_cutoff*s_cutoff;
   }
 
@@ -166,6 +176,7 @@ SecondaryStructureRMSD::SecondaryStructureRMSD(const ActionOptions&ao):
     }
     colvar_atoms.push_back( newatoms );
   }
+  if( s_cutoff2>0 ) setupStrandLists();
 
   double bondlength; parse("BONDLENGTH",bondlength); bondlength=bondlength/getUnits().getLength();
 
@@ -186,7 +197,13 @@ SecondaryStructureRMSD::SecondaryStructureRMSD(const ActionOptions&ao):
           if(distance > bondlength) targets[std::make_pair(i,j)] = distance;
         }
       }
-      drmsd_targets.push_back( targets );
+      DRMSDTargets flat;
+      for(const auto & it : targets ) {
+        flat.first.push_back( it.first.first );
+        flat.second.push_back( it.first.second );
+        flat.length.push_back( it.second );
+      }
+      drmsd_targets.push_back( flat );
     } else {
       Vector center; std::vector<double> align( structure.size(), 1.0 ), displace( structure.size(), 1.0 );
       for(unsigned i=0; i<structure.size(); ++i) center+=structure[i]*align[i];
@@ -217,6 +234,7 @@ void SecondaryStructureRMSD::areAllTasksRequired( std::vector<ActionWithVector*>
 
 int SecondaryStructureRMSD::checkTaskStatus( const unsigned& taskno, int& flag ) const {
   if( s_cutoff2>0 ) {
+    if( active_segments.size()==colvar_atoms.size() ) return active_segments[taskno];
     Vector distance=pbcDistance( ActionAtomistic::getPosition( getAtomIndex(taskno,align_atom_1) ),
                                  ActionAtomistic::getPosition( getAtomIndex(taskno,align_atom_2) ) );
     if( distance.modulo2()<s_cutoff2 ) return 1;
@@ -224,7 +242,86 @@ int SecondaryStructureRMSD::checkTaskStatus( const unsigned& taskno, int& flag )
   } return flag;
 }
 
+void SecondaryStructureRMSD::setupStrandLists() {
+  std::map<unsigned,unsigned> position;
+  for(unsigned i=0; i<colvar_atoms.size(); ++i) {
+    for(const unsigned a : { getAtomIndex(i,align_atom_1), getAtomIndex(i,align_atom_2) } ) {
+      if( position.count(a)==0 ) { position[a]=strand_atoms.size(); strand_atoms.push_back(a); }
+    }
+  }
+  strand_segments.resize( strand_atoms.size() );
+  for(unsigned i=0; i<colvar_atoms.size(); ++i) {
+    strand_segments[ position[getAtomIndex(i,align_atom_1)] ].push_back( std::pair<unsigned,unsigned>( position[getAtomIndex(i,align_atom_2)], i ) );
+  }
+  for(auto & s : strand_segments) std::sort( s.begin(), s.end() );
+}
+
+void SecondaryStructureRMSD::buildStrandCandidates() {
+  const double cutoff = std::sqrt(s_cutoff2) + s_skin, cutoff2 = cutoff*cutoff;
+  strand_candidates.clear();
+  strand_reference.resize( strand_atoms.size() );
+  for(unsigned i=0; i<strand_atoms.size(); ++i) strand_reference[i]=getPosition( strand_atoms[i] );
+  strand_box=getBox();
+
+  if( !getPbc().isSet() ) {
+    // Without a box there are no link cells, so all the segments are checked
+    for(unsigned i=0; i<colvar_atoms.size(); ++i) {
+      Vector distance=pbcDistance( getPosition( getAtomIndex(i,align_atom_1) ), getPosition( getAtomIndex(i,align_atom_2) ) );
+      if( distance.modulo2()<cutoff2 ) strand_candidates.push_back(i);
+    }
+    return;
+  }
+
+  // The link cells only contain the atoms used for the cutoff, so the cost
+  // is linear in the number of residues rather than in the number of segments
+  std::vector<unsigned> indices( strand_atoms.size() );
+  for(unsigned i=0; i<indices.size(); ++i) indices[i]=i;
+  Communicator serial;
+  LinkCells cells( serial );
+  cells.setCutoff( cutoff );
+  cells.buildCellLists( strand_reference, indices, getPbc() );
+  std::vector<unsigned> cell_list( cells.getNumberOfCells() ), neighbors( 1+strand_atoms.size() );
+  for(unsigned i=0; i<strand_atoms.size(); ++i) {
+    if( strand_segments[i].empty() ) continue;
+    // The first element is skipped by retrieveNeighboringAtoms so it is set to the atom itself
+    unsigned natomsper=1; neighbors[0]=i;
+    cells.retrieveNeighboringAtoms( strand_reference[i], cell_list, natomsper, neighbors );
+    for(unsigned k=1; k<natomsper; ++k) {
+      const unsigned j=neighbors[k];
+      auto range=std::equal_range( strand_segments[i].begin(), strand_segments[i].end(), std::pair<unsigned,unsigned>( j, 0 ),
+      []( const std::pair<unsigned,unsigned>& a, const std::pair<unsigned,unsigned>& b ) { return a.first<b.first; } );
+      if( range.first==range.second ) continue;
+      if( pbcDistance( strand_reference[i], strand_reference[j] ).modulo2()>=cutoff2 ) continue;
+      for(auto it=range.first; it!=range.second; ++it) strand_candidates.push_back( it->second );
+    }
+  }
+  std::sort( strand_candidates.begin(), strand_candidates.end() );
+}
+
+void SecondaryStructureRMSD::updateActiveSegments() {
+  // The list of candidates is rebuilt when an atom has moved by more than half the skin
+  bool rebuild = s_skin<=0 || strand_reference.size()!=strand_atoms.size() || getExchangeStep();
+  if( !rebuild ) {
+    const Tensor & box=getBox();
+    for(unsigned i=0; i<3 && !rebuild; ++i) for(unsigned j=0; j<3; ++j) if( box(i,j)!=strand_box(i,j) ) { rebuild=true; break; }
+  }
+  if( !rebuild ) {
+    const double limit=0.25*s_skin*s_skin;
+    for(unsigned i=0; i<strand_atoms.size(); ++i) {
+      if( delta( strand_reference[i], getPosition( strand_atoms[i] ) ).modulo2()>limit ) { rebuild=true; break; }
+    }
+  }
+  if( rebuild ) buildStrandCandidates();
+
+  active_segments.assign( colvar_atoms.size(), 0 );
+  for(const unsigned i : strand_candidates) {
+    Vector distance=pbcDistance( getPosition( getAtomIndex(i,align_atom_1) ), getPosition( getAtomIndex(i,align_atom_2) ) );
+    if( distance.modulo2()<s_cutoff2 ) active_segments[i]=1;
+  }
+}
+
 void SecondaryStructureRMSD::calculate() {
+  if( s_cutoff2>0 ) updateActiveSegments();
   runAllTasks();
 }
 
@@ -259,13 +356,15 @@ void SecondaryStructureRMSD::performTask( const unsigned& current, MultiValue& m
     for(unsigned i=0; i<rs; ++i) {
       double drmsd=0; Vector distance; Tensor vir; vir.zero();
       for(unsigned j=0; j<natoms; ++j) deriv[j].zero();
-      for(const auto & it : drmsd_targets[i] ) {
-        const unsigned k=it.first.first;
-        const unsigned j=it.first.second;
+      const DRMSDTargets & targets=drmsd_targets[i];
+      const unsigned npairs=targets.length.size();
+      for(unsigned p=0; p<npairs; ++p) {
+        const unsigned k=targets.first[p];
+        const unsigned j=targets.second[p];
 
         distance=delta( pos[k], pos[j] );
         const double len = distance.modulo();
-        const double diff = len - it.second;
+        const double diff = len - targets.length[p];
         const double der = diff / len;
         drmsd += diff*diff;
 
@@ -275,7 +374,7 @@ void SecondaryStructureRMSD::performTask( const unsigned& current, MultiValue& m
         }
       }
 
-      const double inpairs = 1./static_cast<double>(drmsd_targets[i].size());
+      const double inpairs = 1./static_cast<double>(npairs);
       unsigned ostrn = getConstPntrToComponent(i)->getPositionInStream();
       drmsd = sqrt(inpairs*drmsd); myvals.setValue( ostrn, drmsd );
 
@@ -48,14 +48,37 @@ private:
   std::vector< std::vector<unsigned> > colvar_atoms;
 /// The list of reference configurations
   std::vector<RMSD> myrmsd;
-  std::vector<std::map<std::pair<unsigned,unsigned>, double> > drmsd_targets;
+/// The pairs of atoms and the reference distances for the DRMSD, stored as separate arrays
+  struct DRMSDTargets {
+    std::vector<unsigned> first, second;
+    std::vector<double> length;
+  };
+  std::vector<DRMSDTargets> drmsd_targets;
 /// Variables for strands cutoff
   bool align_strands;
   double s_cutoff2;
   unsigned align_atom_1, align_atom_2;
   bool verbose_output;
+/// The skin of the list of segments whose strands might be within the cutoff
+  double s_skin;
+/// The atoms that are used for the strands cutoff and their positions when the list was built
+  std::vector<unsigned> strand_atoms;
+  std::vector<Vector> strand_reference;
+  Tensor strand_box;
+/// For each of the strand_atoms, the second strand atom and the index of each segment in which it is the first strand atom
+  std::vector<std::vector<std::pair<unsigned,unsigned> > > strand_segments;
+/// The segments whose strands were within the cutoff plus the skin when the list was built
+  std::vector<unsigned> strand_candidates;
+/// The segments whose strands are within the cutoff on this step
+  std::vector<char> active_segments;
 /// Get the index of an atom
   unsigned getAtomIndex( const unsigned& current, const unsigned& iatom ) const ;
+/// Setup the lists that are used to find the segments whose strands are within the cutoff
+  void setupStrandLists();
+/// Build the list of segments whose strands are within the cutoff plus the skin
+  void buildStrandCandidates();
+/// Find the segments whose strands are within the cutoff
+  void updateActiveSegments();
 public:
   static void registerKeywords( Keywords& keys );
   static void readBackboneAtoms( ActionShortcut* action, PlumedMain& plumed, const std::string& backnames, std::vector<unsigned>& chain_lengths, std::string& all_atoms );
@@ -65,6 +88,7 @@ public:
   unsigned getNumberOfDerivatives() override ;
   void areAllTasksRequired( std::vector<ActionWithVector*>& task_reducing_actions ) override;
   int checkTaskStatus( const unsigned& taskno, int& flag ) const override;
+  bool checkTaskStatusIsUnchanged() const override { return !(s_cutoff2>0); }
   void calculate() override;
   void performTask( const unsigned&, MultiValue& ) const override;
 };
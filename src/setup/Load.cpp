@@ -89,6 +89,20 @@ variables. Of course, after your implementation is ready you might
 want to add it to the PLUMED source tree and recompile
 the whole PLUMED.
 
+When many replicas or many consecutive jobs load the same cpp file, compiling it every time can take a considerable
+part of the startup time. If the CACHE keyword (or the PLUMED_LOAD_CACHE environment variable) is set to
+a directory, the compiled library is stored there with a name that contains a hash of the content of the cpp file
+and of the headers that it includes with `#include "..."` and that are found in the same directory (or in directories given relative to it).
+Changes in other headers, for instance in headers found through the include path of the compiler, are not detected,
+so the cache directory should be emptied when one of them is modified.
+The next time the same file is loaded, the library found in that directory is used directly. The directory can be
+shared by simultaneously running simulations.
+
+\plumedfile
+LOAD FILE=Distance2.cpp CACHE=/scratch/plumed-cache
+d2: DISTANCE2 ATOMS=1,10
+\endplumedfile
+
 Starting with PLUMED 2.10, the LOAD action can be placed in any point of the input
 file, and will only affect commands that are placed after the LOAD action.
 In other words, you can create a file named `Distance.cpp` and that reimplement
@@ -129,6 +143,7 @@ PLUMED_REGISTER_ACTION(Load,"LOAD")
 void Load::registerKeywords( Keywords& keys ) {
   ActionAnyorder::registerKeywords(keys);
   keys.add("compulsory","FILE","file to be loaded");
+  keys.add("optional","CACHE","directory where the libraries compiled from cpp files are stored so they can be reused by other replicas and later runs. If not given the PLUMED_LOAD_CACHE environment variable is used");
 }
 
 Load::Load(const ActionOptions&ao):
@@ -137,8 +152,10 @@ Load::Load(const ActionOptions&ao):
 {
   std::string f;
   parse("FILE",f);
+  std::string cache;
+  parse("CACHE",cache);
   checkRead();
-  plumed.load(f);
+  plumed.load(f,cache);
 }
 
 }
@@ -42,6 +42,10 @@ two atoms/molecules are within some cutoff of each other.  Further complexity ca
 insisting that two molecules are adjacent if they are within a certain distance of each
 other and if they have similar orientations.
 
+For clusters with many atoms computing the full eigendecomposition of the adjacency matrix on every step is expensive.
+If you use the LOBPCG flag only the largest eigenvalue and eigenvector are found.  They are computed iteratively using products of
+the adjacency matrix with a few vectors, starting from the eigenvector found on the previous step.  See \ref DIAGONALIZE for more details.
+
 \par Examples
 
 This example input calculates the 7 SPRINT coordinates for a 7 atom cluster of Lennard-Jones
@@ -94,6 +98,7 @@ void Sprint::registerKeywords(Keywords& keys) {
   keys.add("optional","MATRIX","the matrix that you would like to perform SPRINT on");
   keys.add("numbered","GROUP","specifies the list of atoms that should be assumed indistinguishable");
   keys.add("numbered","SWITCH","specify the switching function to use between two sets of indistinguishable atoms");
+  keys.addFlag("LOBPCG",false,"find the largest eigenvalue and eigenvector of the contact matrix iteratively starting from the eigenvector found on the previous step rather than by computing the full decomposition");
   keys.needsAction("CONTACT_MATRIX"); keys.needsAction("DIAGONALIZE"); keys.needsAction("CUSTOM");
   keys.needsAction("SELECT_COMPONENTS"); keys.needsAction("SORT"); keys.needsAction("COMBINE");
   keys.addOutputComponent("coord","default","scalar","the sprint coordinates");
@@ -104,6 +109,7 @@ Sprint::Sprint(const ActionOptions& ao):
   ActionShortcut(ao)
 {
   std::string matinp; parse("MATRIX",matinp);
+  bool lobpcg; parseFlag("LOBPCG",lobpcg);
   if( matinp.length()==0 ) {
     readInputLine( getShortcutLabel() + "_jmat: CONTACT_MATRIX " + convertInputLineToString() );
     matinp = getShortcutLabel() + "_jmat";
@@ -117,7 +123,7 @@ Sprint::Sprint(const ActionOptions& ao):
   }
 
   // Diagonalization
-  readInputLine( getShortcutLabel() + "_diag: DIAGONALIZE ARG=" + matinp + " VECTORS=1");
+  readInputLine( getShortcutLabel() + "_diag: DIAGONALIZE ARG=" + matinp + " VECTORS=1" + (lobpcg ? " LOBPCG" : "") );
   // Compute sprint coordinates as product of eigenvalue and eigenvector times square root of number of atoms in all groups
   std::string str_natoms; Tools::convert( ntot_atoms, str_natoms );
   readInputLine( getShortcutLabel() + "_sp: CUSTOM ARG=" + getShortcutLabel() + "_diag.vals-1," + getShortcutLabel() +
@@ -280,11 +280,13 @@ PLUMED_REGISTER_ACTION(Steinhardt,"Q6")
 void Steinhardt::registerKeywords( Keywords& keys ) {
   CoordinationNumbers::shortcutKeywords( keys );
   keys.addFlag("LOWMEM",false,"this flag does nothing and is present only to ensure back-compatibility");
+  keys.addFlag("DIRECT",false,"accumulate the spherical harmonics directly for each atom with STEINHARDT_VECTORS rather than computing them from the elements of a CONTACT_MATRIX. "
+               "No matrices are stored but this action is not part of the chain of actions that use the contact matrix and so it cannot use masks to skip atoms");
   keys.addFlag("VMEAN",false,"calculate the norm of the mean vector.");
   keys.addOutputComponent("_vmean","VMEAN","scalar","the norm of the mean vector");
   keys.addFlag("VSUM",false,"calculate the norm of the sum of all the vectors");
   keys.addOutputComponent("_vsum","VSUM","scalar","the norm of the mean vector");
-  keys.needsAction("GROUP"); keys.needsAction("CONTACT_MATRIX"); keys.needsAction("SPHERICAL_HARMONIC"); keys.needsAction("ONES");
+  keys.needsAction("GROUP"); keys.needsAction("CONTACT_MATRIX"); keys.needsAction("SPHERICAL_HARMONIC"); keys.needsAction("ONES"); keys.needsAction("STEINHARDT_VECTORS");
   keys.needsAction("MATRIX_VECTOR_PRODUCT"); keys.needsAction("COMBINE"); keys.needsAction("CUSTOM"); keys.needsAction("MEAN"); keys.needsAction("SUM");
   keys.setValueDescription("vector","the norms of the vectors of spherical harmonic coefficients");
 }
@@ -296,30 +298,44 @@ Steinhardt::Steinhardt( const ActionOptions& ao):
   bool lowmem; parseFlag("LOWMEM",lowmem);
   if( lowmem ) warning("LOWMEM flag is deprecated and is no longer required for this action");
   std::string sp_str, specA, specB; parse("SPECIES",sp_str); parse("SPECIESA",specA); parse("SPECIESB",specB);
-  CoordinationNumbers::expandMatrix( true, getShortcutLabel(), sp_str, specA, specB, this ); int l;
-  std::string sph_input = getShortcutLabel() + "_sh: SPHERICAL_HARMONIC ARG=" + getShortcutLabel() + "_mat.x," + getShortcutLabel() + "_mat.y," + getShortcutLabel() + "_mat.z," + getShortcutLabel() + "_mat.w";
-
-  if( getName()=="Q1" ) {
-    sph_input +=" L=1"; l=1;
-  } else if( getName()=="Q3" ) {
-    sph_input += " L=3"; l=3;
-  } else if( getName()=="Q4" ) {
-    sph_input += " L=4"; l=4;
-  } else if( getName()=="Q6" ) {
-    sph_input += " L=6"; l=6;
+  int l;
+  if( getName()=="Q1" ) l=1;
+  else if( getName()=="Q3" ) l=3;
+  else if( getName()=="Q4" ) l=4;
+  else if( getName()=="Q6" ) l=6;
+  else plumed_merror("invalid input");
+  std::string lstr; Tools::convert( l, lstr );
+  bool direct; parseFlag("DIRECT",direct);
+  if( !direct ) {
+    CoordinationNumbers::expandMatrix( true, getShortcutLabel(), sp_str, specA, specB, this );
+    readInputLine( getShortcutLabel() + "_sh: SPHERICAL_HARMONIC ARG=" + getShortcutLabel() + "_mat.x," + getShortcutLabel() + "_mat.y," + getShortcutLabel() + "_mat.z," + getShortcutLabel() + "_mat.w L=" + lstr );
+    // Input for denominator (coord)
+    ActionWithValue* av = plumed.getActionSet().selectWithLabel<ActionWithValue*>( getShortcutLabel() + "_mat");
+    plumed_assert( av && av->getNumberOfComponents()>0 && (av->copyOutput(0))->getRank()==2 );
+    std::string size; Tools::convert( (av->copyOutput(0))->getShape()[1], size );
+    readInputLine( getShortcutLabel() + "_denom_ones: ONES SIZE=" + size );
+    readInputLine( getShortcutLabel() + "_denom: MATRIX_VECTOR_PRODUCT ARG=" + getShortcutLabel() + "_mat.w," + getShortcutLabel() + "_denom_ones" );
+    readInputLine( getShortcutLabel() + "_sp: MATRIX_VECTOR_PRODUCT ARG=" + getShortcutLabel() + "_sh.*," + getShortcutLabel() + "_denom_ones");
   } else {
-    plumed_merror("invalid input");
+    // The sums of the spherical harmonics are accumulated directly for each atom so the matrices of spherical harmonics are never stored
+    std::string spinp = getShortcutLabel() + "_sp: STEINHARDT_VECTORS L=" + lstr;
+    if( sp_str.length()>0 ) {
+      spinp += " GROUP=" + sp_str; readInputLine( getShortcutLabel() + "_grp: GROUP ATOMS=" + sp_str );
+    } else if( specA.length()>0 ) {
+      spinp += " GROUPA=" + specA + " GROUPB=" + specB; readInputLine( getShortcutLabel() + "_grp: GROUP ATOMS=" + specA );
+    } else error("missing atoms input use SPECIES or SPECIESA/SPECIESB");
+    std::string sw_str; parse("SWITCH",sw_str);
+    if( sw_str.length()>0 ) {
+      spinp += " SWITCH={" + sw_str + "}";
+    } else {
+      std::string r0; parse("R_0",r0); std::string d0; parse("D_0",d0);
+      if( r0.length()==0 ) error("missing switching function parameters use SWITCH/R_0");
+      std::string nn; parse("NN",nn); std::string mm; parse("MM",mm);
+      spinp += " R_0=" + r0 + " D_0=" + d0 + " NN=" + nn + " MM=" + mm;
+    }
+    readInputLine( spinp );
+    readInputLine( getShortcutLabel() + "_denom: CUSTOM ARG=" + getShortcutLabel() + "_sp.coord FUNC=x PERIODIC=NO" );
   }
-  readInputLine( sph_input );
-
-  // Input for denominator (coord)
-  ActionWithValue* av = plumed.getActionSet().selectWithLabel<ActionWithValue*>( getShortcutLabel() + "_mat");
-  plumed_assert( av && av->getNumberOfComponents()>0 && (av->copyOutput(0))->getRank()==2 );
-  std::string size; Tools::convert( (av->copyOutput(0))->getShape()[1], size );
-  readInputLine( getShortcutLabel() + "_denom_ones: ONES SIZE=" + size );
-  readInputLine( getShortcutLabel() + "_denom: MATRIX_VECTOR_PRODUCT ARG=" + getShortcutLabel() + "_mat.w," + getShortcutLabel() + "_denom_ones" );
-  readInputLine( getShortcutLabel() + "_sp: MATRIX_VECTOR_PRODUCT ARG=" + getShortcutLabel() + "_sh.*," + getShortcutLabel() + "_denom_ones");
-
   // If we are doing VMEAN determine sum of vector components
   std::string snum;
   bool do_vmean; parseFlag("VMEAN",do_vmean);
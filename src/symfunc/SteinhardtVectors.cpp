@@ -0,0 +1,318 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "core/ActionAtomistic.h"
+#include "core/ActionWithValue.h"
+#include "core/ActionRegister.h"
+#include "tools/SwitchingFunction.h"
+#include "tools/LinkCells.h"
+#include "tools/Communicator.h"
+#include "tools/OpenMP.h"
+#include <complex>
+
+namespace PLMD {
+namespace symfunc {
+
+//+PLUMEDOC MCOLVAR STEINHARDT_VECTORS
+/*
+Calculate the unnormalized vectors of spherical harmonics that are used in the Steinhardt parameters
+
+For each atom \f$i\f$ in GROUP (or GROUPA) this action computes the \f$2l+1\f$ complex numbers
+
+\f[
+s_{lm}(i) = \sum_j \sigma( r_{ij} ) Y_{lm}(\mathbf{r}_{ij})
+\f]
+
+together with the coordination number \f$\sum_j \sigma( r_{ij} )\f$.  The sum runs over the atoms in GROUP (or GROUPB)
+and the spherical harmonics are evaluated with the same conventions that are used in \ref SPHERICAL_HARMONIC.
+The result is identical to the one that would be obtained by multiplying the matrices of spherical harmonics that are
+output by \ref SPHERICAL_HARMONIC by a vector of ones. Here, however, the spherical harmonics for each pair of atoms are
+evaluated and accumulated directly in a single pass over the neighbors of each atom so no matrices are stored.
+This action is used within the shortcuts for \ref Q1, \ref Q3, \ref Q4 and \ref Q6 when the DIRECT flag is used.
+
+\par Examples
+
+The following input computes the sums of the sixth order spherical harmonics for the first 64 atoms.
+
+\plumedfile
+s6: STEINHARDT_VECTORS GROUP=1-64 SWITCH={RATIONAL D_0=1.3 R_0=0.2} L=6
+PRINT ARG=s6.rm-0,s6.coord FILE=colvar
+\endplumedfile
+
+*/
+//+ENDPLUMEDOC
+
+class SteinhardtVectors :
+  public ActionAtomistic,
+  public ActionWithValue
+{
+private:
+  bool nopbc, serial;
+/// The order of the spherical harmonics
+  unsigned tmom;
+/// The number of central atoms and the index of the first neighbor atom
+  unsigned ncentral, bstart;
+/// The indices of the atoms that can be neighbors
+  std::vector<unsigned> bindices;
+  SwitchingFunction switchingFunction;
+  LinkCells linkcells;
+/// Coefficients of N_m d^m P_l(t)/dt^m as a polynomial in t for each m
+  std::vector<std::vector<double> > dpoly;
+/// Evaluate N_m d^m P_l(t)/dt^m and its derivative
+  double evalPoly( const unsigned& m, const double& t, double& df ) const ;
+/// Build the link cells for the neighbor atoms
+  void buildLinkCells();
+/// Get the neighbors of central atom i
+  void getNeighbors( const unsigned& i, std::vector<unsigned>& cell_list, unsigned& natoms, std::vector<unsigned>& atoms ) const ;
+/// Get the spherical harmonics for a vector and, if derivatives is true, their derivatives
+  void sphericalHarmonics( const Vector& d, std::vector<double>& vals, std::vector<Vector>& ders, const bool& derivatives ) const ;
+public:
+  static void registerKeywords( Keywords& keys );
+  explicit SteinhardtVectors(const ActionOptions&);
+  unsigned getNumberOfDerivatives() override ;
+  void calculateNumericalDerivatives( ActionWithValue* a=NULL ) override ;
+  void calculate() override ;
+  void apply() override ;
+};
+
+PLUMED_REGISTER_ACTION(SteinhardtVectors,"STEINHARDT_VECTORS")
+
+void SteinhardtVectors::registerKeywords( Keywords& keys ) {
+  Action::registerKeywords( keys ); ActionAtomistic::registerKeywords( keys ); ActionWithValue::registerKeywords( keys );
+  keys.add("atoms","GROUP","the atoms for which the vectors are computed and that are counted as neighbors");
+  keys.add("atoms","GROUPA","the atoms for which the vectors are computed");
+  keys.add("atoms","GROUPB","the atoms that are counted as neighbors of the atoms in GROUPA");
+  keys.add("compulsory","L","the value of the angular momentum");
+  keys.add("compulsory","NN","6","The n parameter of the switching function ");
+  keys.add("compulsory","MM","0","The m parameter of the switching function; 0 implies 2*NN");
+  keys.add("compulsory","D_0","0.0","The d_0 parameter of the switching function");
+  keys.add("compulsory","R_0","The r_0 parameter of the switching function");
+  keys.add("optional","SWITCH","This keyword is used if you want to employ an alternative to the continuous swiching function defined above. "
+           "The following provides information on the \\ref switchingfunction that are available. "
+           "When this keyword is present you no longer need the NN, MM, D_0 and R_0 keywords.");
+  keys.addFlag("NOPBC",false,"ignore the periodic boundary conditions when calculating distances");
+  keys.addFlag("SERIAL",false,"do the calculation in serial.  Do not parallelize");
+  keys.addOutputComponent("rm","default","vector","the real parts of the sums of the spherical harmonics");
+  keys.addOutputComponent("im","default","vector","the imaginary parts of the sums of the spherical harmonics");
+  keys.addOutputComponent("coord","default","vector","the sum of the switching functions");
+}
+
+SteinhardtVectors::SteinhardtVectors(const ActionOptions&ao):
+  Action(ao),
+  ActionAtomistic(ao),
+  ActionWithValue(ao),
+  nopbc(false),
+  serial(false),
+  linkcells(comm)
+{
+  std::vector<AtomNumber> ga, gb; parseAtomList("GROUP",ga);
+  if( ga.size()>0 ) {
+    ncentral=ga.size(); bstart=0;
+    log.printf("  computing vectors for %u atoms and counting neighbors in the same group\n", ncentral );
+  } else {
+    parseAtomList("GROUPA",ga); parseAtomList("GROUPB",gb);
+    if( ga.size()==0 || gb.size()==0 ) error("atoms should be specified using GROUP or GROUPA and GROUPB");
+    ncentral=ga.size(); bstart=ga.size();
+    log.printf("  computing vectors for %u atoms from the positions of %u neighbor atoms\n", ncentral, static_cast<unsigned>(gb.size()) );
+  }
+  std::vector<AtomNumber> t( ga ); t.insert( t.end(), gb.begin(), gb.end() );
+  bindices.resize( t.size()-bstart ); for(unsigned i=0; i<bindices.size(); ++i) bindices[i]=bstart+i;
+
+  std::string errors, input; parse("SWITCH",input);
+  if( input.length()>0 ) {
+    switchingFunction.set( input, errors );
+    if( errors.length()!=0 ) error("problem reading switching function description " + errors);
+  } else {
+    double r_0=-1.0, d_0; int nn, mm;
+    parse("NN",nn); parse("MM",mm);
+    parse("R_0",r_0); parse("D_0",d_0);
+    if( r_0<0.0 ) error("you must set a value for R_0");
+    switchingFunction.set(nn,mm,r_0,d_0);
+  }
+  log.printf("  switching function cutoff is %s \n",switchingFunction.description().c_str() );
+  linkcells.setCutoff( switchingFunction.get_dmax() );
+
+  parse("L",tmom); if( tmom==0 ) error("L should be larger than zero");
+  log.printf("  calculating %u th order spherical harmonic \n", tmom );
+  // Coefficients of the Legendre polynomial P_l(t) = 2^-l sum_k (-1)^k C(l,k) C(2l-2k,l) t^(l-2k)
+  auto binomial = [](unsigned n, unsigned k) { double b=1.0; for(unsigned i=1; i<=k; ++i) b = b*(n-k+i)/i; return b; };
+  std::vector<double> coeff_poly( tmom+1, 0.0 );
+  for(unsigned k=0; 2*k<=tmom; ++k) coeff_poly[tmom-2*k] = ( k%2==1 ? -1.0 : 1.0 )*binomial(tmom,k)*binomial(2*tmom-2*k,tmom)/std::pow(2.0,tmom);
+  // Coefficients of the normalized derivatives of the polynomial
+  dpoly.resize( tmom+1 );
+  for(unsigned m=0; m<=tmom; ++m) {
+    double fact=1.0; for(unsigned j=tmom-m+1; j<=tmom+m; ++j) fact=fact*j;
+    double normaliz = sqrt( (2*tmom+1)/(4*pi*fact) ); if( m%2==1 ) normaliz*=-1;
+    dpoly[m].resize( tmom-m+1 );
+    for(unsigned k=0; k<=tmom-m; ++k) {
+      double dfact=1.0; for(unsigned j=k+1; j<=k+m; ++j) dfact=dfact*j;
+      dpoly[m][k] = normaliz*coeff_poly[m+k]*dfact;
+    }
+  }
+
+  parseFlag("NOPBC",nopbc); parseFlag("SERIAL",serial);
+  if( nopbc ) log.printf("  ignoring periodic boundary conditions\n");
+  checkRead(); requestAtoms( t );
+
+  std::vector<unsigned> shape(1); shape[0]=ncentral; std::string num;
+  for(int i=-static_cast<int>(tmom); i<=static_cast<int>(tmom); ++i) {
+    Tools::convert(std::abs(i),num);
+    std::string cname = i<0 ? "-n" + num : ( i>0 ? "-p" + num : "-0" );
+    addComponent( "rm" + cname, shape ); componentIsNotPeriodic( "rm" + cname ); getPntrToComponent("rm" + cname)->buildDataStore();
+  }
+  for(int i=-static_cast<int>(tmom); i<=static_cast<int>(tmom); ++i) {
+    Tools::convert(std::abs(i),num);
+    std::string cname = i<0 ? "-n" + num : ( i>0 ? "-p" + num : "-0" );
+    addComponent( "im" + cname, shape ); componentIsNotPeriodic( "im" + cname ); getPntrToComponent("im" + cname)->buildDataStore();
+  }
+  addComponent( "coord", shape ); componentIsNotPeriodic( "coord" ); getPntrToComponent("coord")->buildDataStore();
+}
+
+unsigned SteinhardtVectors::getNumberOfDerivatives() {
+  return 3*getNumberOfAtoms() + 9;
+}
+
+void SteinhardtVectors::calculateNumericalDerivatives( ActionWithValue* ) {
+  error("numerical derivatives are not implemented for STEINHARDT_VECTORS");
+}
+
+double SteinhardtVectors::evalPoly( const unsigned& m, const double& t, double& df ) const {
+  const std::vector<double>& c( dpoly[m] ); unsigned n=c.size(); double res=c[n-1]; df=0.0;
+  for(unsigned k=n-1; k>0; --k) { df = df*t + res; res = res*t + c[k-1]; }
+  return res;
+}
+
+void SteinhardtVectors::buildLinkCells() {
+  std::vector<Vector> ltmp_pos( bindices.size() );
+  for(unsigned i=0; i<bindices.size(); ++i) ltmp_pos[i]=getPosition( bindices[i] );
+  linkcells.buildCellLists( ltmp_pos, bindices, getPbc() );
+}
+
+void SteinhardtVectors::getNeighbors( const unsigned& i, std::vector<unsigned>& cell_list, unsigned& natoms, std::vector<unsigned>& atoms ) const {
+  natoms=1; atoms[0]=i; linkcells.retrieveNeighboringAtoms( getPosition(i), cell_list, natoms, atoms );
+}
+
+void SteinhardtVectors::sphericalHarmonics( const Vector& d, std::vector<double>& vals, std::vector<Vector>& ders, const bool& derivatives ) const {
+  const unsigned nv=2*tmom+1; double dlen2 = d.modulo2(), dlen = sqrt( dlen2 ), t = d[2]/dlen;
+  // Derivatives of z/r wrt x, y, z
+  Vector dz( -t*d[0]/dlen2, -t*d[1]/dlen2, -t*d[2]/dlen2 + 1.0/dlen );
+  double dpoly_ass, poly_ass = evalPoly( 0, t, dpoly_ass );
+  vals[tmom] = poly_ass; vals[nv+tmom] = 0.0;
+  if( derivatives ) { ders[tmom] = dpoly_ass*dz; ders[nv+tmom].zero(); }
+  // The complex number of which we have to take powers and its derivatives wrt x, y, z
+  std::complex<double> com1( d[0]/dlen, d[1]/dlen ), ii( 0.0, 1.0 ), powered( 1.0, 0.0 );
+  std::complex<double> dc_x = 1.0/dlen - com1*d[0]/dlen2, dc_y = ii/dlen - com1*d[1]/dlen2, dc_z = -com1*d[2]/dlen2;
+  for(unsigned m=1; m<=tmom; ++m) {
+    poly_ass = evalPoly( m, t, dpoly_ass );
+    // powered holds com1^(m-1) here
+    std::complex<double> zm = powered*com1, mp = static_cast<double>(m)*powered;
+    double pref = ( m%2==1 ) ? -1.0 : 1.0;
+    vals[tmom+m] = poly_ass*real(zm); vals[nv+tmom+m] = poly_ass*imag(zm);
+    vals[tmom-m] = pref*vals[tmom+m]; vals[nv+tmom-m] = -pref*vals[nv+tmom+m];
+    if( derivatives ) {
+      std::complex<double> dp_x = mp*dc_x, dp_y = mp*dc_y, dp_z = mp*dc_z;
+      ders[tmom+m] = dpoly_ass*real(zm)*dz + poly_ass*Vector( real(dp_x), real(dp_y), real(dp_z) );
+      ders[nv+tmom+m] = dpoly_ass*imag(zm)*dz + poly_ass*Vector( imag(dp_x), imag(dp_y), imag(dp_z) );
+      ders[tmom-m] = pref*ders[tmom+m]; ders[nv+tmom-m] = -pref*ders[nv+tmom+m];
+    }
+    powered = zm;
+  }
+}
+
+void SteinhardtVectors::calculate() {
+  buildLinkCells();
+  unsigned stride=comm.Get_size(), rank=comm.Get_rank(); if( serial ) { stride=1; rank=0; }
+  unsigned nt=OpenMP::getNumThreads(); if( nt*stride*10>ncentral ) nt=ncentral/stride/10; if( nt==0 ) nt=1;
+  const unsigned nv=2*tmom+1, ncomp=2*nv+1;
+  // Values are accumulated for each atom in a single buffer so that they can be summed over ranks at once
+  std::vector<double> buffer( ncomp*ncentral, 0.0 );
+
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<unsigned> atoms( 1+bindices.size() ), cell_list; std::vector<double> sph( 2*nv ); std::vector<Vector> ders;
+    #pragma omp for
+    for(unsigned i=rank; i<ncentral; i+=stride) {
+      unsigned natoms; getNeighbors( i, cell_list, natoms, atoms ); double* myvals = buffer.data() + i*ncomp;
+      for(unsigned j=1; j<natoms; ++j) {
+        if( getAbsoluteIndex(atoms[j])==getAbsoluteIndex(i) ) continue;
+        Vector d; if( nopbc ) d=delta( getPosition(i), getPosition(atoms[j]) ); else d=pbcDistance( getPosition(i), getPosition(atoms[j]) );
+        double mod2 = d.modulo2(); if( mod2<epsilon ) continue;
+        double dfunc, w = switchingFunction.calculateSqr( mod2, dfunc ); if( w<epsilon ) continue;
+        sphericalHarmonics( d, sph, ders, false );
+        for(unsigned k=0; k<2*nv; ++k) myvals[k] += w*sph[k];
+        myvals[2*nv] += w;
+      }
+    }
+  }
+  if( !serial ) comm.Sum( buffer );
+  for(unsigned k=0; k<ncomp; ++k) {
+    Value* myval=getPntrToComponent(k);
+    for(unsigned i=0; i<ncentral; ++i) myval->set( i, buffer[i*ncomp+k] );
+  }
+}
+
+void SteinhardtVectors::apply() {
+  if( doNotCalculateDerivatives() ) return;
+  const unsigned nv=2*tmom+1, ncomp=2*nv+1; bool hasforce=false;
+  for(unsigned k=0; k<ncomp; ++k) if( getPntrToComponent(k)->forcesWereAdded() ) { hasforce=true; break; }
+  if( !hasforce ) return;
+  // Collect the forces on each of the outputs for each atom
+  std::vector<double> fvals( ncomp*ncentral, 0.0 );
+  for(unsigned k=0; k<ncomp; ++k) {
+    Value* myval=getPntrToComponent(k); if( !myval->forcesWereAdded() ) continue;
+    for(unsigned i=0; i<ncentral; ++i) fvals[i*ncomp+k] = myval->getForce(i);
+  }
+
+  unsigned stride=comm.Get_size(), rank=comm.Get_rank(); if( serial ) { stride=1; rank=0; }
+  unsigned nt=OpenMP::getNumThreads(); if( nt*stride*10>ncentral ) nt=ncentral/stride/10; if( nt==0 ) nt=1;
+  std::vector<double> forces( 3*getNumberOfAtoms() + 9, 0.0 );
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<unsigned> atoms( 1+bindices.size() ), cell_list; std::vector<double> sph( 2*nv ); std::vector<Vector> ders( 2*nv );
+    std::vector<double> omp_forces; if( nt>1 ) omp_forces.resize( forces.size(), 0.0 );
+    std::vector<double>& myforces( nt>1 ? omp_forces : forces );
+    #pragma omp for nowait
+    for(unsigned i=rank; i<ncentral; i+=stride) {
+      unsigned natoms; getNeighbors( i, cell_list, natoms, atoms ); const double* myf = fvals.data() + i*ncomp;
+      for(unsigned j=1; j<natoms; ++j) {
+        if( getAbsoluteIndex(atoms[j])==getAbsoluteIndex(i) ) continue;
+        Vector d; if( nopbc ) d=delta( getPosition(i), getPosition(atoms[j]) ); else d=pbcDistance( getPosition(i), getPosition(atoms[j]) );
+        double mod2 = d.modulo2(); if( mod2<epsilon ) continue;
+        double dfunc, w = switchingFunction.calculateSqr( mod2, dfunc ); if( w<epsilon ) continue;
+        sphericalHarmonics( d, sph, ders, true );
+        // The force on the weight is accumulated first so the derivative of the switching function is only applied once
+        double fw = myf[2*nv]; Vector g;
+        for(unsigned k=0; k<2*nv; ++k) { fw += myf[k]*sph[k]; g += (myf[k]*w)*ders[k]; }
+        g += (fw*dfunc)*d;
+        for(unsigned n=0; n<3; ++n) { myforces[3*atoms[j]+n] += g[n]; myforces[3*i+n] -= g[n]; }
+        Tensor vir( d, g ); unsigned vstart=3*getNumberOfAtoms();
+        for(unsigned n=0; n<3; ++n) for(unsigned m=0; m<3; ++m) myforces[vstart+3*n+m] -= vir(n,m);
+      }
+    }
+    #pragma omp critical
+    if( nt>1 ) for(unsigned k=0; k<forces.size(); ++k) forces[k] += omp_forces[k];
+  }
+  if( !serial ) comm.Sum( forces );
+  unsigned ind=0; setForcesOnAtoms( forces, ind );
+}
+
+}
+}
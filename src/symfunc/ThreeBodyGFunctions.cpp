@@ -22,7 +22,6 @@
 #include "core/ActionWithVector.h"
 #include "core/ActionRegister.h"
 #include "tools/LeptonCall.h"
-#include "tools/Angle.h"
 
 namespace PLMD {
 namespace symfunc {
@@ -122,29 +121,39 @@ void ThreeBodyGFunctions::performTask( const unsigned& task_index, MultiValue& m
   const Value* xval = getPntrToArgument(0);
   const Value* yval = getPntrToArgument(1);
   const Value* zval = getPntrToArgument(2);
-  Angle angle; Vector disti, distj; unsigned matsize = wval->getNumberOfValues();
+  unsigned matsize = wval->getNumberOfValues();
   std::vector<double> values(4); std::vector<Vector> der_i(4), der_j(4);
   unsigned nbonds = wval->getRowLength( task_index ), ncols = wval->getShape()[1];
+  // The bonds with non-zero weights are collected first so that the bond vectors, their lengths and the unit vectors
+  // are computed once for each bond rather than once for each pair of bonds
+  std::vector<unsigned> bpos( nbonds ); std::vector<double> bw( nbonds ), br2( nbonds ), binvr( nbonds ); std::vector<Vector> bvec( nbonds ), bunit( nbonds );
+  unsigned nactive=0;
   for(unsigned i=0; i<nbonds; ++i) {
     unsigned ipos = ncols*task_index + wval->getRowIndex( task_index, i );
     double weighti = wval->get( ipos );
     if( weighti<epsilon ) continue ;
-    disti[0] = xval->get( ipos );
-    disti[1] = yval->get( ipos );
-    disti[2] = zval->get( ipos );
-    values[1] = disti.modulo2(); der_i[1]=2*disti; der_i[2].zero();
+    bpos[nactive] = ipos; bw[nactive] = weighti;
+    bvec[nactive] = Vector( xval->get( ipos ), yval->get( ipos ), zval->get( ipos ) );
+    br2[nactive] = bvec[nactive].modulo2(); binvr[nactive] = 1.0 / sqrt( br2[nactive] );
+    bunit[nactive] = binvr[nactive]*bvec[nactive]; nactive++;
+  }
+  for(unsigned i=0; i<nactive; ++i) {
+    unsigned ipos = bpos[i]; double weighti = bw[i]; const Vector& disti( bvec[i] );
+    values[1] = br2[i]; der_i[1]=2*disti; der_i[2].zero();
     for(unsigned j=0; j<i; ++j) {
-      unsigned jpos = ncols*task_index + wval->getRowIndex( task_index, j );
-      double weightj = wval->get( jpos );
-      if( weightj<epsilon ) continue ;
-      distj[0] = xval->get( jpos );
-      distj[1] = yval->get( jpos );
-      distj[2] = zval->get( jpos );
-      values[2] = distj.modulo2(); der_j[1].zero(); der_j[2]=2*distj;
+      unsigned jpos = bpos[j]; double weightj = bw[j]; const Vector& distj( bvec[j] );
+      values[2] = br2[j]; der_j[1].zero(); der_j[2]=2*distj;
       der_i[3] = ( disti - distj ); values[3] = der_i[3].modulo2();
       der_i[3] = 2*der_i[3]; der_j[3] = -der_i[3];
-      // Compute angle between bonds
-      values[0] = angle.compute( disti, distj, der_i[0], der_j[0] );
+      // Compute angle between bonds from the unit vectors
+      double cosang = dotProduct( bunit[i], bunit[j] );
+      if( cosang>=1.0-epsilon ) { values[0]=0.0; der_i[0].zero(); der_j[0].zero(); }
+      else if( cosang<=-1.0+epsilon ) { values[0]=pi; der_i[0].zero(); der_j[0].zero(); }
+      else {
+        double x = -1.0 / sqrt( 1 - cosang*cosang ); values[0] = std::acos( cosang );
+        der_i[0] = (x*binvr[i])*( bunit[j] - cosang*bunit[i] );
+        der_j[0] = (x*binvr[j])*( bunit[i] - cosang*bunit[j] );
+      }
       // Compute product of weights
       double weightij = weighti*weightj;
       // Now compute all symmetry functions
@@ -152,7 +161,6 @@ void ThreeBodyGFunctions::performTask( const unsigned& task_index, MultiValue& m
         unsigned ostrn = getConstPntrToComponent(n)->getPositionInStream();
         double nonweight = functions[n].evaluate( values ); myvals.addValue( ostrn, nonweight*weightij );
         if( doNotCalculateDerivatives() ) continue;
-
         for(unsigned m=0; m<functions[n].getNumberOfArguments(); ++m) {
           double der = weightij*functions[n].evaluateDeriv( m, values );
           myvals.addDerivative( ostrn, ipos, der*der_i[m][0] );
@@ -171,11 +179,8 @@ void ThreeBodyGFunctions::performTask( const unsigned& task_index, MultiValue& m
 
   // And update the elements that have derivatives
   // Needs a separate loop here as there may be forces from j
-  for(unsigned i=0; i<nbonds; ++i) {
-    unsigned ipos = ncols*task_index + wval->getRowIndex( task_index, i );
-    double weighti = wval->get( ipos );
-    if( weighti<epsilon ) continue ;
-
+  for(unsigned i=0; i<nactive; ++i) {
+    unsigned ipos = bpos[i];
     for(unsigned n=0; n<functions.size(); ++n) {
       unsigned ostrn = getConstPntrToComponent(n)->getPositionInStream();
       myvals.updateIndex( ostrn, ipos ); myvals.updateIndex( ostrn, matsize+ipos );
@@ -0,0 +1,108 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "AsyncWriter.h"
+#include "Exception.h"
+#include "Tools.h"
+#include <cstdlib>
+#include <exception>
+
+namespace PLMD {
+
+bool AsyncWriter::enabled() {
+  static const bool res=[]() {
+    const char* env=std::getenv("PLUMED_ASYNC_OUTPUT");
+    if(!env) return false;
+    std::string s(env);
+    if(s=="yes") return true;
+    if(s=="no") return false;
+    plumed_merror("PLUMED_ASYNC_OUTPUT variable is set to " + s + "; should be yes or no");
+  }();
+  return res;
+}
+
+AsyncWriter::AsyncWriter():
+  maxBytes(64*1024*1024)
+{
+  if(const char* env=std::getenv("PLUMED_ASYNC_OUTPUT_BUFFER")) {
+    long unsigned n;
+    plumed_massert(Tools::convertNoexcept(std::string(env),n) && n>0,"cannot interpret PLUMED_ASYNC_OUTPUT_BUFFER=" + std::string(env));
+    maxBytes=n;
+  }
+  worker=std::thread([this]() { run(); });
+}
+
+AsyncWriter::~AsyncWriter() {
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    stop=true;
+  }
+  workAvailable.notify_one();
+  // the thread completes the queued jobs before exiting
+  worker.join();
+}
+
+void AsyncWriter::run() {
+  std::unique_lock<std::mutex> lock(mtx);
+  while(true) {
+    workAvailable.wait(lock,[this]() { return stop || !jobs.empty(); });
+    if(jobs.empty()) return;
+    auto job=std::move(jobs.front());
+    jobs.pop_front();
+    busy=true;
+    lock.unlock();
+    try {
+      job.first();
+    } catch(const std::exception & e) {
+      lock.lock();
+      if(errorMessage.empty()) errorMessage=e.what();
+      lock.unlock();
+    }
+    lock.lock();
+    busy=false;
+    queuedBytes-=job.second;
+    spaceAvailable.notify_all();
+    if(jobs.empty()) idle.notify_all();
+  }
+}
+
+void AsyncWriter::submit(std::function<void()> job,std::size_t bytes) {
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    // a job larger than the buffer is accepted when the queue is empty
+    spaceAvailable.wait(lock,[this,bytes]() { return queuedBytes==0 || queuedBytes+bytes<=maxBytes; });
+    jobs.emplace_back(std::move(job),bytes);
+    queuedBytes+=bytes;
+  }
+  workAvailable.notify_one();
+}
+
+void AsyncWriter::drain() {
+  std::string msg;
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    idle.wait(lock,[this]() { return jobs.empty() && !busy; });
+    std::swap(msg,errorMessage);
+  }
+  if(!msg.empty()) plumed_merror("error in asynchronous output: " + msg);
+}
+
+}
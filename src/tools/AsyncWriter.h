@@ -0,0 +1,81 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_AsyncWriter_h
+#define __PLUMED_tools_AsyncWriter_h
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace PLMD {
+
+/**
+A background thread that performs the writes of an OFile.
+
+Each asynchronous OFile owns its writer. The thread is started by the constructor
+and is joined by the destructor, after the queued jobs have been completed.
+Jobs are executed in the order in which they are submitted, so the data that is
+written to the file remains in order.
+The total size of the queued data is bounded: submit() waits if the writer is
+too far behind. drain() waits until all the jobs submitted so far have been completed
+and rethrows any error that was raised while writing.
+
+Asynchronous output is switched on by setting the environment variable
+PLUMED_ASYNC_OUTPUT to yes. The maximum number of bytes that can be queued
+for each file can be set with PLUMED_ASYNC_OUTPUT_BUFFER (default 64 MiB).
+*/
+class AsyncWriter {
+  std::mutex mtx;
+  std::condition_variable workAvailable;
+  std::condition_variable spaceAvailable;
+  std::condition_variable idle;
+  std::deque<std::pair<std::function<void()>,std::size_t>> jobs;
+  std::size_t queuedBytes=0;
+  std::size_t maxBytes;
+  bool busy=false;
+  bool stop=false;
+  std::string errorMessage;
+  std::thread worker;
+  void run();
+public:
+/// Start the thread
+  AsyncWriter();
+/// Complete the queued jobs and join the thread
+  ~AsyncWriter();
+  AsyncWriter(const AsyncWriter&) = delete;
+  AsyncWriter& operator=(const AsyncWriter&) = delete;
+/// True if asynchronous output has been requested with PLUMED_ASYNC_OUTPUT
+  static bool enabled();
+/// Queue a job, bytes is the amount of data that it holds
+  void submit(std::function<void()> job,std::size_t bytes);
+/// Wait until all the queued jobs have been completed
+  void drain();
+};
+
+}
+
+#endif
@@ -22,6 +22,8 @@
 #include "BiasRepresentation.h"
 #include "core/Value.h"
 #include "Communicator.h"
+#include "OpenMP.h"
+#include "Tools.h"
 #include <iostream>
 #include "KernelFunctions.h"
 #include "File.h"
@@ -90,7 +92,7 @@ BiasRepresentation::BiasRepresentation(const std::vector<Value*> & tmpvalues, Co
 }
 
 void BiasRepresentation::addGrid(const std::vector<std::string> & gmin, const std::vector<std::string> & gmax, const std::vector<unsigned> & nbin ) {
-  plumed_massert(hills.size()==0,"you can set the grid before loading the hills");
+  plumed_massert(nkernels==0,"you can set the grid before loading the hills");
   plumed_massert(hasgrid==false,"to build the grid you should not having the grid in this bias representation");
   std::string ss; ss="file.free";
   std::vector<Value*> vv; for(unsigned i=0; i<values.size(); i++) vv.push_back(values[i]);
@@ -103,7 +105,7 @@ bool BiasRepresentation::hasSigmaInInput() {
 }
 
 void BiasRepresentation::setRescaledToBias(bool rescaled) {
-  plumed_massert(hills.size()==0,"you can set the rescaling function only before loading hills");
+  plumed_massert(nkernels==0,"you can set the rescaling function only before loading hills");
   rescaledToBias=rescaled;
 }
 
@@ -158,7 +160,6 @@ void BiasRepresentation::pushKernel( IFile *ifile ) {
     ifile->scanField("biasf",dummy);
     Tools::convert(dummy,dummyd);
   } else {dummyd=1.0;}
-  biasf.push_back(dummyd);
   // the domain does not pertain to the kernel but to the values here defined
   std::string mins,maxs,minv,maxv,mini,maxi; mins="min_"; maxs="max_";
   for(int i=0 ; i<ndim; i++) {
@@ -171,68 +172,69 @@ void BiasRepresentation::pushKernel( IFile *ifile ) {
       plumed_massert(maxi==maxv,"the input periodicity in hills and in value definition does not match"  );
     }
   }
-  // if grid is defined then it should be added on the grid
-  //cerr<<"now with "<<hills.size()<<endl;
-  if(hasgrid) {
-    std::vector<unsigned> nneighb;
-    if(doInt_&&(kk->getCenter()[0]+kk->getContinuousSupport()[0] > uppI_ || kk->getCenter()[0]-kk->getContinuousSupport()[0] < lowI_ )) {
-      nneighb=BiasGrid_->getNbin();
-    } else nneighb=kk->getSupport(BiasGrid_->getDx());
-    std::vector<Grid::index_t> neighbors=BiasGrid_->getNeighbors(kk->getCenter(),nneighb);
+  pushKernel(std::move(kk),dummyd);
+}
+
+void BiasRepresentation::pushKernel( std::unique_ptr<KernelFunctions> kk, double biasf ) {
+  nkernels++;
+  // without a grid the kernels are stored, e.g. to find the extent of the grid
+  if(!hasgrid) {
+    hills.emplace_back(std::move(kk));
+    return;
+  }
+  std::vector<unsigned> nneighb;
+  if(doInt_&&(kk->getCenter()[0]+kk->getContinuousSupport()[0] > uppI_ || kk->getCenter()[0]-kk->getContinuousSupport()[0] < lowI_ )) {
+    nneighb=BiasGrid_->getNbin();
+  } else nneighb=kk->getSupport(BiasGrid_->getDx());
+  std::vector<Grid::index_t> neighbors=BiasGrid_->getNeighbors(kk->getCenter(),nneighb);
+  double f=1.0;
+  if(rescaledToBias) f=(biasf-1.)/biasf;
+  // the points are shared between the processes and the threads, the values are then summed
+  // and added on the grid in serial as the same point can appear twice for periodic variables
+  unsigned stride=mycomm.Get_size();
+  unsigned rank=mycomm.Get_rank();
+  std::vector<double> allder(ndim*neighbors.size(),0.0);
+  std::vector<double> allbias(neighbors.size(),0.0);
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*stride*10>neighbors.size()) nt=1;
+  #pragma omp parallel num_threads(nt)
+  {
+    // each thread needs its own values to evaluate the kernel
+    std::vector<std::unique_ptr<Value>> vv(ndim);
+    for(int j=0; j<ndim; ++j) {
+      vv[j]=Tools::make_unique<Value>();
+      if(values[j]->isPeriodic()) {
+        std::string str_min, str_max; values[j]->getDomain(str_min,str_max);
+        vv[j]->setDomain(str_min,str_max);
+      } else vv[j]->setNotPeriodic();
+    }
+    auto vv_ptr=Tools::unique2raw(vv);
     std::vector<double> der(ndim);
     std::vector<double> xx(ndim);
-    if(mycomm.Get_size()==1) {
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        for(int j=0; j<ndim; ++j) {der[j]=0.0;}
-        BiasGrid_->getPoint(ineigh,xx);
-        // assign xx to a new vector of values
-        for(int j=0; j<ndim; ++j) {values[j]->set(xx[j]);}
-        double bias;
-        if(doInt_) bias=kk->evaluate(values,der,true,doInt_,lowI_,uppI_);
-        else bias=kk->evaluate(values,der,true);
-        if(rescaledToBias) {
-          double f=(biasf.back()-1.)/(biasf.back());
-          bias*=f;
-          for(int j=0; j<ndim; ++j) {der[j]*=f;}
-        }
-        BiasGrid_->addValueAndDerivatives(ineigh,bias,der);
-      }
-    } else {
-      unsigned stride=mycomm.Get_size();
-      unsigned rank=mycomm.Get_rank();
-      std::vector<double> allder(ndim*neighbors.size(),0.0);
-      std::vector<double> allbias(neighbors.size(),0.0);
-      std::vector<double> tmpder(ndim);
-      for(unsigned i=rank; i<neighbors.size(); i+=stride) {
-        Grid::index_t ineigh=neighbors[i];
-        BiasGrid_->getPoint(ineigh,xx);
-        for(int j=0; j<ndim; ++j) {values[j]->set(xx[j]);}
-        if(doInt_) allbias[i]=kk->evaluate(values,der,true,doInt_,lowI_,uppI_);
-        else allbias[i]=kk->evaluate(values,der,true);
-        if(rescaledToBias) {
-          double f=(biasf.back()-1.)/(biasf.back());
-          allbias[i]*=f;
-          for(int j=0; j<ndim; ++j) {tmpder[j]*=f;}
-        }
-        // this solution with the temporary vector is rather bad, probably better to take
-        // a pointer of double as it was in old gaussian
-        for(int j=0; j<ndim; ++j) { allder[ndim*i+j]=tmpder[j]; tmpder[j]=0.;}
-      }
-      mycomm.Sum(allbias);
-      mycomm.Sum(allder);
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        for(int j=0; j<ndim; ++j) {der[j]=allder[ndim*i+j];}
-        BiasGrid_->addValueAndDerivatives(ineigh,allbias[i],der);
-      }
+    #pragma omp for
+    for(unsigned i=rank; i<neighbors.size(); i+=stride) {
+      BiasGrid_->getPoint(neighbors[i],xx);
+      for(int j=0; j<ndim; ++j) {vv[j]->set(xx[j]);}
+      double bias;
+      if(doInt_) bias=kk->evaluate(vv_ptr,der,true,doInt_,lowI_,uppI_);
+      else bias=kk->evaluate(vv_ptr,der,true);
+      allbias[i]=f*bias;
+      for(int j=0; j<ndim; ++j) {allder[ndim*i+j]=f*der[j];}
     }
   }
-  hills.emplace_back(std::move(kk));
+  if(stride>1) {
+    mycomm.Sum(allbias);
+    mycomm.Sum(allder);
+  }
+  std::vector<double> der(ndim);
+  for(unsigned i=0; i<neighbors.size(); ++i) {
+    for(int j=0; j<ndim; ++j) {der[j]=allder[ndim*i+j];}
+    BiasGrid_->addValueAndDerivatives(neighbors[i],allbias[i],der);
+  }
 }
 
 int BiasRepresentation::getNumberOfKernels() {
-  return hills.size();
+  return nkernels;
 }
 
 Grid* BiasRepresentation::getGridPtr() {
@@ -277,6 +279,7 @@ void BiasRepresentation::getMinMaxBin(std::vector<double> &vmin, std::vector<dou
 
 void BiasRepresentation::clear() {
   hills.clear();
+  nkernels=0;
   // clear the grid
   if(hasgrid) {
     BiasGrid_->clear();
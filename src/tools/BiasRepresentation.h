@@ -61,6 +61,8 @@ public:
   void 		addGrid(const std::vector<std::string> & gmin, const std::vector<std::string> & gmax, const std::vector<unsigned> & nbin );
   /// push a kernel on the representation (includes widths and height)
   void 		pushKernel( IFile * ff);
+  /// push a kernel that has already been read, biasf is the bias factor that was used when it was deposited
+  void 		pushKernel( std::unique_ptr<KernelFunctions> kk, double biasf );
   /// set the flag that rescales the free energy to the bias
   void 		setRescaledToBias(bool rescaled);
   /// check if the representation is rescaled to the bias
@@ -94,8 +96,9 @@ private:
   double uppI_;
   std::vector<Value*> values;
   std::vector<std::string> names;
+  /// the kernels are only kept when there is no grid, otherwise they are added to the grid and discarded
   std::vector<std::unique_ptr<KernelFunctions>> hills;
-  std::vector<double> biasf;
+  int nkernels=0;
   std::vector<double> histosigma;
   Communicator& mycomm;
   std::unique_ptr<Grid> BiasGrid_;
@@ -0,0 +1,89 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_BinaryColumns_h
+#define __PLUMED_tools_BinaryColumns_h
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace PLMD {
+
+/**
+Tools for the binary columnar format that can be written by OFile and read by IFile.
+
+The file starts with the eight characters in binarycolumns::magic. It is then composed of
+blocks, each starting with a single character:
+- 'H' is followed by the length of a text header, as a 32 bit integer, and by the header itself.
+  The header contains the same "#! FIELDS" and "#! SET" lines that are used in text files,
+  a "#! FORMAT" line with float32 or float64, a "#! TYPES" line with the type of each field
+  (float32, float64, int32 or int64) and an optional "#! UNITS" line.
+  If the "#! TYPES" line is missing all the fields have the type given in the "#! FORMAT" line.
+- 'R' is followed by one value for each of the fields listed in the last header.
+All numbers are little endian. The file can be compressed with gzip by using a .gz extension.
+*/
+namespace binarycolumns {
+
+/// The first bytes of a binary columnar file
+static constexpr char magic[8]= {'P','L','M','D','B','I','N','1'};
+
+inline bool hostIsBigEndian() {
+  const std::uint16_t one=1;
+  unsigned char c;
+  std::memcpy(&c,&one,1);
+  return c==0;
+}
+
+/// Number of bytes used to store a value of the given type, zero if the type is not known
+inline unsigned typeSize(const std::string & type) {
+  if(type=="float32" || type=="int32") return 4;
+  if(type=="float64" || type=="int64") return 8;
+  return 0;
+}
+
+/// Append the little endian representation of v
+template<typename T>
+void append(std::vector<char> & buffer,T v) {
+  char b[sizeof(T)];
+  std::memcpy(b,&v,sizeof(T));
+  if(hostIsBigEndian()) std::reverse(b,b+sizeof(T));
+  buffer.insert(buffer.end(),b,b+sizeof(T));
+}
+
+/// Read a value from its little endian representation
+template<typename T>
+T extract(const char* ptr) {
+  char b[sizeof(T)];
+  std::memcpy(b,ptr,sizeof(T));
+  if(hostIsBigEndian()) std::reverse(b,b+sizeof(T));
+  T v;
+  std::memcpy(&v,b,sizeof(T));
+  return v;
+}
+
+}
+
+}
+
+#endif
@@ -36,6 +36,77 @@ bool Communicator::plumedHasMPI() {
 #endif
 }
 
+/// Shared memory window and communicators of the processes on the same node
+class Communicator::SharedSum {
+public:
+/// Arrays smaller than this are summed with a plain MPI_Allreduce
+  std::size_t minBytes=0;
+#ifdef __PLUMED_HAS_MPI
+  MPI_Comm node=MPI_COMM_NULL;
+  MPI_Comm leaders=MPI_COMM_NULL;
+  int nodeRank=0;
+  int nodeSize=1;
+  MPI_Win win=MPI_WIN_NULL;
+/// Start of the window: one slice for each process on the node
+  double* base=nullptr;
+/// Size of each slice
+  std::size_t capacity=0;
+  ~SharedSum() {
+// nothing can be freed once MPI has been finalized
+    int finalized=0; MPI_Finalized(&finalized);
+    if(finalized) return;
+    freeWindow();
+    if(leaders!=MPI_COMM_NULL) MPI_Comm_free(&leaders);
+    if(node!=MPI_COMM_NULL) MPI_Comm_free(&node);
+  }
+  void freeWindow() {
+    if(win==MPI_WIN_NULL) return;
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+    base=nullptr; capacity=0;
+  }
+/// Make sure there are n doubles for each process on the node (collective on node)
+  void reserve(std::size_t n) {
+    if(n<=capacity) return;
+    freeWindow();
+    void* ptr=nullptr;
+    MPI_Aint bytes=(nodeRank==0 ? MPI_Aint(n)*nodeSize*sizeof(double) : 0);
+    MPI_Win_allocate_shared(bytes,sizeof(double),MPI_INFO_NULL,node,&ptr,&win);
+    MPI_Aint size; int disp;
+    MPI_Win_shared_query(win,0,&size,&disp,&ptr);
+    base=static_cast<double*>(ptr);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK,win);
+    capacity=n;
+  }
+/// Make the writes to the window visible to all the processes on the node
+  void synchronize() {
+    MPI_Win_sync(win);
+    MPI_Barrier(node);
+    MPI_Win_sync(win);
+  }
+  void sum(double* data,std::size_t n) {
+    reserve(n);
+    double* mine=base+nodeRank*n;
+    for(std::size_t i=0; i<n; i++) mine[i]=data[i];
+    synchronize();
+// each process on the node sums a part of the array into the first slice
+    std::size_t start=(n*nodeRank)/nodeSize, end=(n*(nodeRank+1))/nodeSize;
+    for(std::size_t i=start; i<end; i++) {
+      double s=base[i];
+      for(int r=1; r<nodeSize; r++) s+=base[r*n+i];
+      base[i]=s;
+    }
+    synchronize();
+// only one process per node communicates with the other nodes
+    if(leaders!=MPI_COMM_NULL) MPI_Allreduce(MPI_IN_PLACE,base,n,MPI_DOUBLE,MPI_SUM,leaders);
+    synchronize();
+    for(std::size_t i=0; i<n; i++) data[i]=base[i];
+// the first slice cannot be overwritten by the next sum before everybody has read it
+    MPI_Barrier(node);
+  }
+#endif
+};
+
 Communicator::Communicator()
 #ifdef __PLUMED_HAS_MPI
   : communicator(MPI_COMM_SELF)
@@ -47,6 +118,23 @@ Communicator::Communicator(const Communicator&pc) {
   Set_comm(pc.communicator);
 }
 
+void Communicator::setHierarchicalSum(std::size_t minBytes) {
+  sharedSum.reset();
+#ifdef __PLUMED_HAS_MPI
+  if(!initialized() || Get_size()==1) return;
+  auto shared=std::make_unique<SharedSum>();
+  shared->minBytes=minBytes;
+  const int rank=Get_rank();
+  MPI_Comm_split_type(communicator,MPI_COMM_TYPE_SHARED,rank,MPI_INFO_NULL,&shared->node);
+  MPI_Comm_rank(shared->node,&shared->nodeRank);
+  MPI_Comm_size(shared->node,&shared->nodeSize);
+  MPI_Comm_split(communicator,(shared->nodeRank==0 ? 0 : MPI_UNDEFINED),rank,&shared->leaders);
+  sharedSum=std::move(shared);
+#else
+  (void) minBytes;
+#endif
+}
+
 Communicator::Status Communicator::StatusIgnore;
 
 Communicator& Communicator::operator=(const Communicator&pc) {
@@ -73,6 +161,7 @@ int Communicator::Get_size()const {
 }
 
 void Communicator::Set_comm(MPI_Comm c) {
+  sharedSum.reset();
 #ifdef __PLUMED_HAS_MPI
   if(initialized()) {
     if(communicator!=MPI_COMM_SELF && communicator!=MPI_COMM_WORLD) MPI_Comm_free(&communicator);
@@ -133,12 +222,26 @@ void Communicator::Bcast(Data data,int root) {
 
 void Communicator::Sum(Data data) {
 #if defined(__PLUMED_HAS_MPI)
+  if(sharedSum && data.type==MPI_DOUBLE && std::size_t(data.size)*sizeof(double)>=sharedSum->minBytes) {
+    sharedSum->sum(static_cast<double*>(data.pointer),data.size);
+    return;
+  }
   if(initialized()) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_SUM,communicator);
 #else
   (void) data;
 #endif
 }
 
+Communicator::Request Communicator::Isum(Data data) {
+  Request req;
+#if defined(__PLUMED_HAS_MPI)
+  if(initialized()) MPI_Iallreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_SUM,communicator,&req.r);
+#else
+  (void) data;
+#endif
+  return req;
+}
+
 void Communicator::Prod(Data data) {
 #if defined(__PLUMED_HAS_MPI)
   if(initialized()) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_PROD,communicator);
@@ -205,6 +308,27 @@ void Communicator::Allgatherv(ConstData in,Data out,const int*recvcounts,const i
 #endif
 }
 
+Communicator::Request Communicator::Iallgatherv(ConstData in,Data out,const int*recvcounts,const int*displs) {
+  Request req;
+  void*s=const_cast<void*>((const void*)in.pointer);
+  void*r=const_cast<void*>((const void*)out.pointer);
+#if defined(__PLUMED_HAS_MPI)
+  if(initialized()) {
+    if(s==NULL)s=MPI_IN_PLACE;
+    MPI_Iallgatherv(s,in.size,in.type,r,recvcounts,displs,out.type,communicator,&req.r);
+    return req;
+  }
+#endif
+  // without MPI the data is copied and the request is already completed
+  plumed_assert(in.nbytes==out.nbytes);
+  plumed_assert(in.size==out.size);
+  plumed_assert(recvcounts);
+  plumed_assert(recvcounts[0]==in.size);
+  plumed_assert(displs);
+  if(s) std::memcpy(static_cast<char*>(r)+displs[0]*in.nbytes,s,size_t(in.size)*in.nbytes);
+  return req;
+}
+
 void Communicator::Allgather(ConstData in,Data out) {
   void*s=const_cast<void*>((const void*)in.pointer);
   void*r=const_cast<void*>((const void*)out.pointer);
@@ -260,12 +384,13 @@ bool Communicator::initialized() {
 
 void Communicator::Request::wait(Status&s) {
 #ifdef __PLUMED_HAS_MPI
+// requests that were completed at once, e.g. because MPI was not initialized, have nothing to wait for
+  if(r==MPI_REQUEST_NULL) return;
   plumed_massert(initialized(),"you are trying to use an MPI function, but MPI is not initialized");
   if(&s==&StatusIgnore) MPI_Wait(&r,MPI_STATUS_IGNORE);
   else MPI_Wait(&r,&s.s);
 #else
   (void) s;
-  plumed_merror("you are trying to use an MPI function, but PLUMED has been compiled without MPI support");
 #endif
 }
 
@@ -29,6 +29,7 @@
 #include "TypesafePtr.h"
 #include <vector>
 #include <string>
+#include <memory>
 #include "Vector.h"
 #include "Tensor.h"
 #include "Matrix.h"
@@ -52,6 +53,9 @@ class MPI_Request {};
 class Communicator {
 /// Communicator
   MPI_Comm communicator;
+/// Communicators and shared memory used by the hierarchical sum, see setHierarchicalSum
+  class SharedSum;
+  std::unique_ptr<SharedSum> sharedSum;
 /// Function returning the MPI type.
 /// You can use it to access to the MPI type of a C++ type, e.g.
 /// `MPI_Datatype type=getMPIType<double>();`
@@ -137,10 +141,15 @@ public:
 /// Notice that this is the default for Recv, so this is equivalent to
 /// `Recv(a,0,1);`
   static Status StatusIgnore;
-/// Wrapper class for MPI_Request
+/// Wrapper class for MPI_Request.
+/// A default constructed request is already completed, so waiting for it returns immediately
   class Request {
   public:
+#ifdef __PLUMED_HAS_MPI
+    MPI_Request r=MPI_REQUEST_NULL;
+#else
     MPI_Request r;
+#endif
     void wait(Status&s=StatusIgnore);
   };
 /// Default constructor
@@ -175,12 +184,25 @@ public:
   void Barrier()const;
 /// Tests if MPI library is initialized
   static bool initialized();
+/// Sum arrays of doubles of at least minBytes bytes hierarchically: first within each node through
+/// an MPI shared memory window, then between one process per node.  Must be called by all the processes.
+/// It is disabled if the communicator is changed with Set_comm
+  void setHierarchicalSum(std::size_t minBytes);
+/// True if setHierarchicalSum is active
+  bool hierarchicalSum() const { return sharedSum!=nullptr; }
 /// Wrapper for MPI_Allreduce with MPI_SUM (data struct)
   void Sum(Data);
 /// Wrapper for MPI_Allreduce with MPI_SUM (pointer)
   template <class T> void Sum(T*buf,int count) {Sum(Data(buf,count));}
 /// Wrapper for MPI_Allreduce with MPI_SUM (reference)
   template <class T> void Sum(T&buf) {Sum(Data(buf));}
+/// Wrapper for MPI_Iallreduce with MPI_SUM (data struct).
+/// The buffer should not be accessed until the returned request has been waited for
+  Request Isum(Data);
+/// Wrapper for MPI_Iallreduce with MPI_SUM (pointer)
+  template <class T> Request Isum(T*buf,int count) {return Isum(Data(buf,count));}
+/// Wrapper for MPI_Iallreduce with MPI_SUM (reference)
+  template <class T> Request Isum(T&buf) {return Isum(Data(buf));}
 /// Wrapper for MPI_Allreduce with MPI_PROD (data struct)
   void Prod(Data);
 /// Wrapper for MPI_Allreduce with MPI_PROD (pointer)
@@ -225,6 +247,18 @@ public:
     Allgatherv(ConstData(sendbuf),Data(recvbuf),recvcounts,displs);
   }
 
+/// Wrapper for MPI_Iallgatherv (data struct).
+/// The buffers, the counts and the displacements should not be accessed until the returned request has been waited for
+  Request Iallgatherv(ConstData in,Data out,const int*,const int*);
+/// Wrapper for MPI_Iallgatherv (pointer)
+  template <class T,class S> Request Iallgatherv(const T*sendbuf,int sendcount,S*recvbuf,const int*recvcounts,const int*displs) {
+    return Iallgatherv(ConstData(sendbuf,sendcount),Data(recvbuf,0),recvcounts,displs);
+  }
+/// Wrapper for MPI_Iallgatherv (reference)
+  template <class T,class S> Request Iallgatherv(const T&sendbuf,S&recvbuf,const int*recvcounts,const int*displs) {
+    return Iallgatherv(ConstData(sendbuf),Data(recvbuf),recvcounts,displs);
+  }
+
 /// Wrapper for MPI_Allgather (data struct)
   void Allgather(ConstData in,Data out);
 /// Wrapper for MPI_Allgatherv (pointer)
@@ -0,0 +1,208 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "CompressedTrajectory.h"
+#include "Exception.h"
+#include <cstring>
+
+#ifdef __PLUMED_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace PLMD {
+
+static const char compressedTrajectoryMagic[8]= {'P','L','M','D','T','R','J','1'};
+/// The size of the part of a frame that precedes the positions: step, time and box
+static constexpr std::size_t frameHeaderSize=sizeof(std::int64_t)+sizeof(double)+9*sizeof(float);
+
+CompressedTrajectory::~CompressedTrajectory() {
+  close();
+}
+
+void CompressedTrajectory::writeHeader() {
+  std::fwrite(compressedTrajectoryMagic,1,8,fp);
+  const std::uint32_t head[2]= {natoms,compressed ? 1u : 0u};
+  std::fwrite(head,sizeof(std::uint32_t),2,fp);
+}
+
+void CompressedTrajectory::readHeader() {
+  char magic[8];
+  std::uint32_t head[2];
+  plumed_massert(std::fread(magic,1,8,fp)==8 && std::memcmp(magic,compressedTrajectoryMagic,8)==0,"file "+fname+" is not a compressed trajectory");
+  plumed_massert(std::fread(head,sizeof(std::uint32_t),2,fp)==2,"cannot read the header of compressed trajectory "+fname);
+  natoms=head[0];
+  compressed=(head[1]!=0);
+#ifndef __PLUMED_HAS_ZLIB
+  plumed_massert(!compressed,"file "+fname+": reading a compressed trajectory without zlib being linked");
+#endif
+}
+
+void CompressedTrajectory::create(const std::string& fname, unsigned natoms, bool append) {
+  plumed_assert(!fp);
+  this->fname=fname;
+  bool exists=false;
+  if(append) {
+    std::FILE* f=std::fopen(fname.c_str(),"rb");
+    if(f) { exists=(std::fgetc(f)!=EOF); std::fclose(f); }
+  }
+  if(exists) {
+    open(fname);
+    plumed_massert(this->natoms==natoms,"the number of atoms in compressed trajectory "+fname+" does not match the input");
+    // the index is rewritten so that it is consistent with the frames that are actually in the file
+    const std::vector<std::uint64_t> old=offsets;
+    close();
+    fp=std::fopen(fname.c_str(),"ab");
+    plumed_massert(fp,"cannot open compressed trajectory "+fname+" for appending");
+    idx=std::fopen(indexName(fname).c_str(),"wb");
+    if(!old.empty() && idx) std::fwrite(old.data(),sizeof(std::uint64_t),old.size(),idx);
+  } else {
+    this->natoms=natoms;
+#ifdef __PLUMED_HAS_ZLIB
+    compressed=true;
+#else
+    compressed=false;
+#endif
+    fp=std::fopen(fname.c_str(),"wb");
+    plumed_massert(fp,"cannot open compressed trajectory "+fname+" for writing");
+    idx=std::fopen(indexName(fname).c_str(),"wb");
+    writeHeader();
+  }
+  this->fname=fname;
+  writing=true;
+}
+
+void CompressedTrajectory::buildIndex() {
+  offsets.clear();
+  std::FILE* f=std::fopen(indexName(fname).c_str(),"rb");
+  if(f) {
+    std::uint64_t o;
+    while(std::fread(&o,sizeof(o),1,f)==1) offsets.push_back(o);
+    std::fclose(f);
+  }
+  // frames that are not in the index (or the whole file if there is no index) are found by scanning
+  std::uint64_t pos=8+2*sizeof(std::uint32_t);
+  if(!offsets.empty()) {
+    pos=offsets.back();
+    offsets.pop_back();
+  }
+  while(true) {
+    std::uint64_t len[2];
+    if(std::fseek(fp,pos,SEEK_SET)!=0 || std::fread(len,sizeof(std::uint64_t),2,fp)!=2) break;
+    // a truncated frame at the end of the file is ignored
+    if(std::fseek(fp,pos+2*sizeof(std::uint64_t)+len[0]-1,SEEK_SET)!=0 || std::fgetc(fp)==EOF) break;
+    offsets.push_back(pos);
+    pos+=2*sizeof(std::uint64_t)+len[0];
+  }
+  std::clearerr(fp);
+}
+
+void CompressedTrajectory::open(const std::string& fname) {
+  plumed_assert(!fp);
+  this->fname=fname;
+  writing=false;
+  fp=std::fopen(fname.c_str(),"rb");
+  plumed_massert(fp,"cannot open compressed trajectory "+fname);
+  readHeader();
+  buildIndex();
+}
+
+void CompressedTrajectory::close() {
+  if(fp) std::fclose(fp);
+  if(idx) std::fclose(idx);
+  fp=nullptr;
+  idx=nullptr;
+  offsets.clear();
+}
+
+void CompressedTrajectory::write(const Frame& frame) {
+  plumed_assert(fp && writing);
+  plumed_massert(frame.positions.size()==3*natoms,"wrong number of atoms written on compressed trajectory "+fname);
+  const std::size_t npos=frame.positions.size()*sizeof(float);
+  raw.resize(frameHeaderSize+npos);
+  const std::int64_t step=frame.step;
+  unsigned char* r=raw.data();
+  std::memcpy(r,&step,sizeof(step));
+  std::memcpy(r+sizeof(step),&frame.time,sizeof(double));
+  std::memcpy(r+sizeof(step)+sizeof(double),frame.box.data(),9*sizeof(float));
+  // byte shuffle of the positions
+  const unsigned char* p=reinterpret_cast<const unsigned char*>(frame.positions.data());
+  const std::size_t n=frame.positions.size();
+  for(std::size_t b=0; b<sizeof(float); ++b) {
+    unsigned char* out=r+frameHeaderSize+b*n;
+    for(std::size_t i=0; i<n; ++i) out[i]=p[i*sizeof(float)+b];
+  }
+  const unsigned char* data=raw.data();
+  std::uint64_t len[2]= {raw.size(),raw.size()};
+  if(compressed) {
+#ifdef __PLUMED_HAS_ZLIB
+    uLongf plen=compressBound(raw.size());
+    packed.resize(plen);
+    plumed_massert(compress2(packed.data(),&plen,raw.data(),raw.size(),Z_BEST_SPEED)==Z_OK,"error compressing frame of "+fname);
+    len[0]=plen;
+    data=packed.data();
+#endif
+  }
+  const long pos=std::ftell(fp);
+  plumed_massert(std::fwrite(len,sizeof(std::uint64_t),2,fp)==2 && std::fwrite(data,1,len[0],fp)==len[0],"cannot write on compressed trajectory "+fname);
+  if(idx) {
+    const std::uint64_t o=pos;
+    std::fwrite(&o,sizeof(o),1,idx);
+  }
+}
+
+void CompressedTrajectory::flush() {
+  if(fp) std::fflush(fp);
+  if(idx) std::fflush(idx);
+}
+
+void CompressedTrajectory::read(std::size_t i, Frame& frame) {
+  plumed_assert(fp && !writing);
+  plumed_massert(i<offsets.size(),"frame not present in compressed trajectory "+fname);
+  std::uint64_t len[2];
+  bool ok=std::fseek(fp,offsets[i],SEEK_SET)==0 && std::fread(len,sizeof(std::uint64_t),2,fp)==2;
+  plumed_massert(ok && len[1]==frameHeaderSize+3*sizeof(float)*natoms,"corrupted frame in compressed trajectory "+fname);
+  packed.resize(len[0]);
+  plumed_massert(std::fread(packed.data(),1,len[0],fp)==len[0],"truncated frame in compressed trajectory "+fname);
+  if(compressed) {
+#ifdef __PLUMED_HAS_ZLIB
+    raw.resize(len[1]);
+    uLongf rlen=len[1];
+    plumed_massert(uncompress(raw.data(),&rlen,packed.data(),len[0])==Z_OK && rlen==len[1],"error decompressing frame of "+fname);
+#endif
+  } else {
+    std::swap(raw,packed);
+  }
+  const unsigned char* r=raw.data();
+  std::int64_t step;
+  std::memcpy(&step,r,sizeof(step));
+  frame.step=step;
+  std::memcpy(&frame.time,r+sizeof(step),sizeof(double));
+  std::memcpy(frame.box.data(),r+sizeof(step)+sizeof(double),9*sizeof(float));
+  const std::size_t n=3*natoms;
+  frame.positions.resize(n);
+  unsigned char* p=reinterpret_cast<unsigned char*>(frame.positions.data());
+  for(std::size_t b=0; b<sizeof(float); ++b) {
+    const unsigned char* in=r+frameHeaderSize+b*n;
+    for(std::size_t i=0; i<n; ++i) p[i*sizeof(float)+b]=in[i];
+  }
+}
+
+}
@@ -0,0 +1,92 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_CompressedTrajectory_h
+#define __PLUMED_tools_CompressedTrajectory_h
+
+#include <array>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PLMD {
+
+/**
+Trajectory of single precision coordinates stored in compressed frames.
+
+The file starts with a header that contains the number of atoms and the compression method.
+Each frame is then stored as a block that contains the step, the time, the box and the positions.
+Before compressing the positions with zlib their bytes are reordered so that the first byte of
+all the numbers comes first, then the second and so on. As neighboring atoms have similar coordinates
+this makes the data much more compressible. When PLUMED is compiled without zlib the frames are
+stored uncompressed.
+
+The offsets of the frames are also written in a separate index file (with suffix .idx), so that
+any frame can be read without decompressing the previous ones. If the index is missing or
+incomplete it is rebuilt by scanning the file.
+*/
+class CompressedTrajectory {
+public:
+  struct Frame {
+    long long int step=0;
+    double time=0.0;
+    std::array<float,9> box{};
+/// Positions as x1,y1,z1,x2,...
+    std::vector<float> positions;
+  };
+private:
+  std::FILE* fp=nullptr;
+  std::FILE* idx=nullptr;
+  std::string fname;
+  std::uint32_t natoms=0;
+  bool compressed=false;
+  bool writing=false;
+/// Offsets of the frames when reading
+  std::vector<std::uint64_t> offsets;
+  std::vector<unsigned char> raw, packed;
+  void writeHeader();
+  void readHeader();
+  void buildIndex();
+public:
+  CompressedTrajectory()=default;
+  ~CompressedTrajectory();
+  CompressedTrajectory(const CompressedTrajectory&) = delete;
+  CompressedTrajectory& operator=(const CompressedTrajectory&) = delete;
+/// Name of the index file associated to a trajectory
+  static std::string indexName(const std::string& fname) { return fname+".idx"; }
+/// Open a file for writing, when append is true and the file exists the frames are appended
+  void create(const std::string& fname, unsigned natoms, bool append);
+/// Open a file for reading
+  void open(const std::string& fname);
+  void close();
+  bool isOpen() const { return fp!=nullptr; }
+  unsigned getNumberOfAtoms() const { return natoms; }
+  std::size_t getNumberOfFrames() const { return offsets.size(); }
+  void write(const Frame& frame);
+  void flush();
+/// Read frame i
+  void read(std::size_t i, Frame& frame);
+};
+
+}
+
+#endif
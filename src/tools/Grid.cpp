@@ -28,6 +28,7 @@
 #include "KernelFunctions.h"
 #include "RootFindingBase.h"
 #include "Communicator.h"
+#include "OpenMP.h"
 #include "small_vector/small_vector.h"
 
 #include <vector>
@@ -37,6 +38,7 @@
 #include <cstdio>
 #include <cfloat>
 #include <array>
+#include <algorithm>
 
 namespace PLMD {
 
@@ -318,8 +320,12 @@ std::vector<GridBase::index_t> GridBase::getNearestNeighbors(const std::vector<u
 void GridBase::addKernel( const KernelFunctions& kernel ) {
   plumed_dbg_assert( kernel.ndim()==dimension_ );
   std::vector<unsigned> nneighb=kernel.getSupport( dx_ );
-  std::vector<index_t> neighbors=getNeighbors( kernel.getCenter(), nneighb );
-  std::vector<double> xx( dimension_ );
+  if( kernel.isSeparable() ) {
+    std::vector<double> invwidth( dimension_ );
+    for(unsigned j=0; j<dimension_; ++j) invwidth[j]=1.0/kernel.getWidth()[j];
+    addSeparableGaussian( kernel.getCenter(), invwidth, kernel.getHeight(), nneighb );
+    return;
+  }
   std::vector<std::unique_ptr<Value>> vv( dimension_ );
   std::string str_min, str_max;
   for(unsigned i=0; i<dimension_; ++i) {
@@ -332,6 +338,8 @@ void GridBase::addKernel( const KernelFunctions& kernel ) {
       vv[i]->setNotPeriodic();
     }
   }
+  std::vector<index_t> neighbors=getNeighbors( kernel.getCenter(), nneighb );
+  std::vector<double> xx( dimension_ );
 
 // vv_ptr contains plain pointers obtained from vv.
 // this is the simplest way to replace a unique_ptr here.
@@ -350,6 +358,85 @@ void GridBase::addKernel( const KernelFunctions& kernel ) {
   }
 }
 
+void GridBase::addSeparableGaussian( const std::vector<double>& center, const std::vector<double>& invwidth, double height, const std::vector<unsigned>& nneighb,
+                                     double dp2cutoff, double stretchA, double stretchB ) {
+  plumed_dbg_assert( center.size()==dimension_ && invwidth.size()==dimension_ && nneighb.size()==dimension_ );
+// The gaussian is the product of one dimensional gaussians, so these are computed once
+// for each bin of the stencil along each dimension, together with the contribution of
+// the bin to the index of the points and to the exponent. The stencil is then the outer product of these.
+  std::vector<unsigned> cindices( dimension_ );
+  getIndices( center, cindices );
+  std::vector<std::vector<index_t>> offset( dimension_ );
+  std::vector<std::vector<double>> fval( dimension_ ), fder( dimension_ ), fexp( dimension_ );
+  bool duplicates=false;
+  index_t stride=1;
+  Value vv; std::string str_min, str_max;
+  for(unsigned j=0; j<dimension_; ++j) {
+    const int nb=nbin_[j];
+    if( pbc_[j] ) {
+      Tools::convert(min_[j],str_min); Tools::convert(max_[j],str_max);
+      vv.setDomain( str_min, str_max );
+    } else vv.setNotPeriodic();
+    if( pbc_[j] && 2*nneighb[j]+1>nbin_[j] ) duplicates=true;
+    for(int k=-static_cast<int>(nneighb[j]); k<=static_cast<int>(nneighb[j]); ++k) {
+      int i0=static_cast<int>(cindices[j])+k;
+      if( !pbc_[j] && (i0<0 || i0>=nb) ) continue;
+      if( pbc_[j] ) i0=((i0%nb)+nb)%nb;
+      vv.set( min_[j]+i0*dx_[j] );
+      const double dp=-vv.difference( center[j] )*invwidth[j];
+      const double ee=std::exp(-0.5*dp*dp);
+      offset[j].push_back( i0*stride );
+      fval[j].push_back( ee );
+      fder[j].push_back( -ee*dp*invwidth[j]*stretchA );
+      fexp[j].push_back( 0.5*dp*dp );
+    }
+    if( offset[j].empty() ) return;
+    stride*=nbin_[j];
+  }
+// the first dimension is the innermost loop, the others are distributed over the threads
+  std::size_t nouter=1;
+  for(unsigned j=1; j<dimension_; ++j) nouter*=offset[j].size();
+  unsigned nt=OpenMP::getNumThreads();
+// only a dense grid can be updated concurrently, and points cannot be visited twice
+  if( duplicates || !dynamic_cast<Grid*>(this) || nouter*offset[0].size()<10000 ) nt=1;
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double> der( dimension_ ), qder( dimension_ );
+    std::vector<unsigned> pos( dimension_, 0 );
+    #pragma omp for
+    for(std::size_t c=0; c<nouter; ++c) {
+      std::size_t cc=c;
+      index_t base=0;
+      double prod=height, qexp=0.0;
+      for(unsigned j=1; j<dimension_; ++j) {
+        pos[j]=cc%offset[j].size(); cc/=offset[j].size();
+        base+=offset[j][pos[j]];
+        prod*=fval[j][pos[j]];
+        qexp+=fexp[j][pos[j]];
+      }
+      if( qexp>=dp2cutoff ) continue;
+      if( usederiv_ ) {
+        // derivative along j, without the factor from the first dimension
+        for(unsigned j=1; j<dimension_; ++j) {
+          qder[j]=height*fder[j][pos[j]];
+          for(unsigned l=1; l<dimension_; ++l) if( l!=j ) qder[j]*=fval[l][pos[l]];
+        }
+      }
+      for(unsigned i0=0; i0<offset[0].size(); ++i0) {
+        if( qexp+fexp[0][i0]>=dp2cutoff ) continue;
+        const double newval=stretchA*prod*fval[0][i0]+height*stretchB;
+        if( usederiv_ ) {
+          der[0]=prod*fder[0][i0];
+          for(unsigned j=1; j<dimension_; ++j) der[j]=qder[j]*fval[0][i0];
+          addValueAndDerivatives( base+offset[0][i0], newval, der );
+        } else {
+          addValue( base+offset[0][i0], newval );
+        }
+      }
+    }
+  }
+}
+
 double GridBase::getValue(const std::vector<unsigned> & indices) const {
   return getValue(getIndex(indices));
 }
@@ -376,7 +463,51 @@ double GridBase::getValueAndDerivatives(const std::vector<unsigned> & indices, s
 double GridBase::getValueAndDerivatives(const std::vector<double> & x, std::vector<double>& der) const {
   plumed_dbg_assert(der.size()==dimension_ && usederiv_);
 
-  if(dospline_) {
+  if(dospline_ && spline_table_.enabled()) {
+    std::array<unsigned,maxdim> indices;
+    getIndices(x, indices.data(),dimension_);
+    std::array<double,maxdim> xfloor;
+    getPoint(indices.data(), dimension_, xfloor.data(),dimension_);
+    const std::size_t nc=spline_table_.getNumberOfCoefficients();
+    const index_t cell=getIndex(indices.data(),dimension_);
+    const double* c=spline_table_.get(cell);
+    gch::small_vector<double,256> v;
+    if(c) v.assign(c,c+nc);
+    else {
+      v.resize(nc);
+      computeSplineCoefficients(indices.data(),v.data());
+      #pragma omp critical(gridSplineTable)
+      spline_table_.set(cell,v.data());
+    }
+// powers of the reduced coordinates and their derivatives with respect to x
+    std::array<std::array<double,4>,maxdim> pw, dpw;
+    for(unsigned j=0; j<dimension_; ++j) {
+      const double dx=getDx(j);
+      const double t=(x[j]-xfloor[j])/dx;
+      pw[j]= {1.0,t,t*t,t*t*t};
+      dpw[j]= {0.0,1.0/dx,2.0*t/dx,3.0*t*t/dx};
+    }
+// contract the dimensions one at a time, starting from the slowest one
+    const std::size_t nd=nc/4;
+    gch::small_vector<double,256> d(dimension_*nd);
+    std::size_t m=nc;
+    for(unsigned j=dimension_; j-->0;) {
+      m/=4;
+      const auto & p(pw[j]);
+      const auto & dp(dpw[j]);
+      for(unsigned l=j+1; l<dimension_; ++l) {
+        double* dl=d.data()+l*nd;
+        for(std::size_t r=0; r<m; ++r) dl[r]=dl[r]*p[0]+dl[r+m]*p[1]+dl[r+2*m]*p[2]+dl[r+3*m]*p[3];
+      }
+      double* dj=d.data()+j*nd;
+      for(std::size_t r=0; r<m; ++r) {
+        dj[r]=v[r]*dp[0]+v[r+m]*dp[1]+v[r+2*m]*dp[2]+v[r+3*m]*dp[3];
+        v[r]=v[r]*p[0]+v[r+m]*p[1]+v[r+2*m]*p[2]+v[r+3*m]*p[3];
+      }
+    }
+    for(unsigned j=0; j<dimension_; ++j) der[j]=d[j*nd];
+    return v[0];
+  } else if(dospline_) {
     double X,X2,X3,value;
     std::array<double,maxdim> fd, C, D;
     std::array<double,maxdim> dder;
@@ -426,6 +557,89 @@ double GridBase::getValueAndDerivatives(const std::vector<double> & x, std::vect
   }
 }
 
+GridBase::SplineTable::Block::Block(std::size_t ncoeffs):
+  coeffs(blocksize*ncoeffs,0.0),
+  valid(new std::atomic<unsigned char>[blocksize])
+{
+  for(std::size_t i=0; i<blocksize; ++i) valid[i].store(0,std::memory_order_relaxed);
+}
+
+void GridBase::SplineTable::setup(std::size_t ncells, std::size_t ncoeffs) {
+  this->ncells=ncells;
+  this->ncoeffs=ncoeffs;
+  const std::size_t nblocks=(ncells+blocksize-1)/blocksize;
+  blocks.reset(new std::atomic<Block*>[nblocks]);
+  for(std::size_t i=0; i<nblocks; ++i) blocks[i].store(nullptr,std::memory_order_relaxed);
+  owned.clear();
+}
+
+void GridBase::SplineTable::set(index_t cell, const double* c) {
+  Block* b=blocks[cell/blocksize].load(std::memory_order_relaxed);
+  if(!b) {
+    owned.push_back(Tools::make_unique<Block>(ncoeffs));
+    b=owned.back().get();
+    blocks[cell/blocksize].store(b,std::memory_order_release);
+  }
+  std::copy(c,c+ncoeffs,b->coeffs.data()+(cell%blocksize)*ncoeffs);
+  b->valid[cell%blocksize].store(1,std::memory_order_release);
+}
+
+void GridBase::SplineTable::invalidate() {
+  for(const auto & b : owned) for(std::size_t i=0; i<blocksize; ++i) b->valid[i].store(0,std::memory_order_relaxed);
+}
+
+void GridBase::enableSplineTable() {
+  plumed_massert(dospline_ && usederiv_,"the spline table can only be used with spline interpolation");
+  spline_table_.setup(maxsize_,std::size_t(1)<<(2*dimension_));
+}
+
+void GridBase::invalidateSplineCellsOf(index_t index) {
+// the point is a corner of the cells whose lower corner is at most one bin below it
+  std::array<unsigned,maxdim> indices, cindices;
+  getIndices(index,indices.data(),dimension_);
+  for(unsigned e=0; e<(1u<<dimension_); ++e) {
+    bool ok=true;
+    for(unsigned j=0; j<dimension_; ++j) {
+      cindices[j]=indices[j];
+      if(!(e&(1u<<j))) continue;
+      if(indices[j]>0) cindices[j]--;
+      else if(pbc_[j]) cindices[j]=nbin_[j]-1;
+      else {ok=false; break;}
+    }
+    if(ok) spline_table_.invalidate(getIndex(cindices.data(),dimension_));
+  }
+}
+
+void GridBase::computeSplineCoefficients(const unsigned* indices, double* c) const {
+// same interpolant of getValueAndDerivatives, written as a polynomial in the reduced coordinates
+  const std::size_t nc=spline_table_.getNumberOfCoefficients();
+  std::fill(c,c+nc,0.0);
+  gch::small_vector<index_t,16> neigh(1<<dimension_);
+  auto nneigh = getSplineNeighbors(indices,dimension_, neigh.data(), neigh.size());
+  std::array<double,maxdim> dder;
+  std::array<unsigned,maxdim> nindices;
+  std::array<std::array<double,4>,maxdim> f;
+  for(unsigned int ipoint=0; ipoint<nneigh; ++ipoint) {
+    double grid=getValueAndDerivatives(neigh[ipoint],dder.data(),dimension_);
+    getIndices(neigh[ipoint], nindices.data(), dimension_);
+    for(unsigned j=0; j<dimension_; ++j) {
+      double yy;
+      if(std::abs(grid)<0.0000001) yy=0.0;
+      else yy=-dder[j]/grid;
+      const double h=yy*getDx(j);
+      if(nindices[j]==indices[j]) f[j]= {1.0,-h,-3.0+2.0*h,2.0-h};
+      else f[j]= {0.0,0.0,3.0+h,-2.0-h};
+    }
+// outer product of the polynomials of each dimension, with the first dimension running fastest
+    for(std::size_t k=0; k<nc; ++k) {
+      double prod=grid;
+      std::size_t kk=k;
+      for(unsigned j=0; j<dimension_; ++j) {prod*=f[j][kk&3]; kk>>=2;}
+      c[k]+=prod;
+    }
+  }
+}
+
 void GridBase::setValue(const std::vector<unsigned> & indices, double value) {
   setValue(getIndex(indices),value);
 }
@@ -452,6 +666,7 @@ void GridBase::writeHeader(OFile& ofile) {
 }
 
 void Grid::clear() {
+  invalidateSplineTable();
   grid_.assign(maxsize_,0.0);
   if(usederiv_) der_.assign(maxsize_*dimension_,0.0);
 }
@@ -612,6 +827,7 @@ double Grid::getMaxValue() const {
 }
 
 void Grid::scaleAllValuesAndDerivatives( const double& scalef ) {
+  invalidateSplineTable();
   if(usederiv_) {
     for(index_t i=0; i<grid_.size(); ++i) {
       grid_[i]*=scalef;
@@ -623,6 +839,7 @@ void Grid::scaleAllValuesAndDerivatives( const double& scalef ) {
 }
 
 void Grid::logAllValuesAndDerivatives( const double& scalef ) {
+  invalidateSplineTable();
   if(usederiv_) {
     for(index_t i=0; i<grid_.size(); ++i) {
       grid_[i] = scalef*std::log(grid_[i]);
@@ -634,12 +851,14 @@ void Grid::logAllValuesAndDerivatives( const double& scalef ) {
 }
 
 void Grid::setMinToZero() {
+  invalidateSplineTable();
   double min=grid_[0];
   for(index_t i=1; i<grid_.size(); ++i) if(grid_[i]<min) min=grid_[i];
   for(index_t i=0; i<grid_.size(); ++i) grid_[i] -= min;
 }
 
 void Grid::applyFunctionAllValuesAndDerivatives( double (*func)(double val), double (*funcder)(double valder) ) {
+  invalidateSplineTable();
   if(usederiv_) {
     for(index_t i=0; i<grid_.size(); ++i) {
       grid_[i]=func(grid_[i]);
@@ -699,6 +918,10 @@ void Grid::findSetOfPointsOnContour(const double& target, const std::vector<bool
 
 /// OVERRIDES ARE BELOW
 
+std::size_t Grid::getMemoryUsage() const {
+  return GridBase::getMemoryUsage()+Tools::getMemoryUsage(grid_)+Tools::getMemoryUsage(der_);
+}
+
 Grid::index_t Grid::getSize() const {
   return maxsize_;
 }
@@ -716,26 +939,37 @@ double Grid::getValueAndDerivatives(index_t index, double* der,std::size_t der_s
 
 void Grid::setValue(index_t index, double value) {
   plumed_dbg_assert(index<maxsize_ && !usederiv_);
+  invalidateSplineCells(index);
   grid_[index]=value;
 }
 
 void Grid::setValueAndDerivatives(index_t index, double value, std::vector<double>& der) {
   plumed_dbg_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
+  invalidateSplineCells(index);
   grid_[index]=value;
   for(unsigned i=0; i<dimension_; i++) der_[dimension_*index+i]=der[i];
 }
 
 void Grid::addValue(index_t index, double value) {
   plumed_dbg_assert(index<maxsize_ && !usederiv_);
+  invalidateSplineCells(index);
   grid_[index]+=value;
 }
 
 void Grid::addValueAndDerivatives(index_t index, double value, std::vector<double>& der) {
   plumed_dbg_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
+  invalidateSplineCells(index);
   grid_[index]+=value;
   for(unsigned int i=0; i<dimension_; ++i) der_[index*dimension_+i]+=der[i];
 }
 
+std::size_t SparseGrid::getMemoryUsage() const {
+// each node of a std::map also stores three pointers and a color
+  std::size_t bytes=GridBase::getMemoryUsage()+map_.size()*(sizeof(index_t)+sizeof(double)+4*sizeof(void*));
+  for(const auto & d : der_) bytes+=sizeof(index_t)+sizeof(d.second)+4*sizeof(void*)+Tools::getMemoryUsage(d.second);
+  return bytes;
+}
+
 Grid::index_t SparseGrid::getSize() const {
   return map_.size();
 }
@@ -768,22 +1002,26 @@ double SparseGrid::getValueAndDerivatives(index_t index, double* der, std::size_
 
 void SparseGrid::setValue(index_t index, double value) {
   plumed_assert(index<maxsize_ && !usederiv_);
+  invalidateSplineCells(index);
   map_[index]=value;
 }
 
 void SparseGrid::setValueAndDerivatives(index_t index, double value, std::vector<double>& der) {
   plumed_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
+  invalidateSplineCells(index);
   map_[index]=value;
   der_[index]=der;
 }
 
 void SparseGrid::addValue(index_t index, double value) {
   plumed_assert(index<maxsize_ && !usederiv_);
+  invalidateSplineCells(index);
   map_[index]+=value;
 }
 
 void SparseGrid::addValueAndDerivatives(index_t index, double value, std::vector<double>& der) {
   plumed_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
+  invalidateSplineCells(index);
   map_[index]+=value;
   der_[index].resize(dimension_);
   for(unsigned int i=0; i<dimension_; ++i) der_[index][i]+=der[i];
@@ -815,6 +1053,200 @@ void SparseGrid::writeToFile(OFile& ofile) {
   }
 }
 
+void TiledGrid::setupTiles() {
+  // tiles of a few thousands points, like 8^3 in three dimensions
+  unsigned edge=8;
+  if(dimension_==1) edge=256;
+  else if(dimension_==2) edge=32;
+  edge_.resize(dimension_);
+  ntiles_.resize(dimension_);
+  tilesize_=1;
+  std::size_t ntiles=1;
+  for(unsigned i=0; i<dimension_; ++i) {
+    edge_[i]=std::min(edge,nbin_[i]);
+    ntiles_[i]=(nbin_[i]+edge_[i]-1)/edge_[i];
+    tilesize_*=edge_[i];
+    ntiles*=ntiles_[i];
+  }
+  tiles_.clear();
+  tiles_.resize(ntiles);
+  nalloc_=0;
+}
+
+TiledGrid::TiledGrid(const TiledGrid& other):
+  GridBase(other)
+{
+  *this=other;
+}
+
+TiledGrid& TiledGrid::operator=(const TiledGrid& other) {
+  if(this==&other) return *this;
+  GridBase::operator=(other);
+  edge_=other.edge_;
+  ntiles_=other.ntiles_;
+  tilesize_=other.tilesize_;
+  nalloc_=other.nalloc_;
+  const std::size_t len=tilesize_*(usederiv_ ? 1+dimension_ : 1);
+  tiles_.clear();
+  tiles_.resize(other.tiles_.size());
+  for(std::size_t t=0; t<tiles_.size(); ++t) {
+    if(!other.tiles_[t]) continue;
+    tiles_[t].reset(new double[len]);
+    std::copy(other.tiles_[t].get(),other.tiles_[t].get()+len,tiles_[t].get());
+  }
+  return *this;
+}
+
+void TiledGrid::getTile(index_t index, std::size_t& tile, std::size_t& pos) const {
+  std::size_t tstride=1, pstride=1;
+  tile=0; pos=0;
+  for(unsigned i=0; i<dimension_; ++i) {
+    const unsigned ind=index%nbin_[i];
+    index/=nbin_[i];
+    tile+=(ind/edge_[i])*tstride;
+    pos+=(ind%edge_[i])*pstride;
+    tstride*=ntiles_[i];
+    pstride*=edge_[i];
+  }
+}
+
+double* TiledGrid::touchTile(std::size_t tile) {
+  if(!tiles_[tile]) {
+    const std::size_t len=tilesize_*(usederiv_ ? 1+dimension_ : 1);
+    tiles_[tile].reset(new double[len]);
+    std::fill(tiles_[tile].get(),tiles_[tile].get()+len,0.0);
+    nalloc_++;
+  }
+  return tiles_[tile].get();
+}
+
+void TiledGrid::copyFrom(const GridBase& other) {
+  plumed_assert(other.getDimension()==dimension_ && other.getNbin()==nbin_ && other.hasDerivatives()==usederiv_);
+  std::vector<double> der(dimension_);
+  for(index_t i=0; i<maxsize_; ++i) {
+    if(usederiv_) {
+      const double f=other.getValueAndDerivatives(i,der);
+      bool zero=(f==0.0);
+      for(unsigned j=0; j<dimension_; ++j) if(der[j]!=0.0) zero=false;
+      if(!zero) setValueAndDerivatives(i,f,der);
+    } else {
+      const double f=other.getValue(i);
+      if(f!=0.0) setValue(i,f);
+    }
+  }
+}
+
+std::size_t TiledGrid::getMemoryUsage() const {
+  return GridBase::getMemoryUsage()+Tools::getMemoryUsage(tiles_)+nalloc_*tilesize_*(usederiv_?1+dimension_:1)*sizeof(double);
+}
+
+Grid::index_t TiledGrid::getSize() const {
+  return maxsize_;
+}
+
+double TiledGrid::getValue(index_t index) const {
+  plumed_dbg_assert(index<maxsize_);
+  std::size_t tile,pos;
+  getTile(index,tile,pos);
+  if(!tiles_[tile]) return 0.0;
+  return tiles_[tile][pos];
+}
+
+double TiledGrid::getValueAndDerivatives(index_t index, double* der, std::size_t der_size) const {
+  plumed_dbg_assert(index<maxsize_ && usederiv_ && der_size==dimension_);
+  std::size_t tile,pos;
+  getTile(index,tile,pos);
+  if(!tiles_[tile]) {
+    for(unsigned i=0; i<dimension_; ++i) der[i]=0.0;
+    return 0.0;
+  }
+  const double* d=tiles_[tile].get()+tilesize_+pos*dimension_;
+  for(unsigned i=0; i<dimension_; ++i) der[i]=d[i];
+  return tiles_[tile][pos];
+}
+
+void TiledGrid::setValue(index_t index, double value) {
+  plumed_dbg_assert(index<maxsize_ && !usederiv_);
+  invalidateSplineCells(index);
+  std::size_t tile,pos;
+  getTile(index,tile,pos);
+  touchTile(tile)[pos]=value;
+}
+
+void TiledGrid::setValueAndDerivatives(index_t index, double value, std::vector<double>& der) {
+  plumed_dbg_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
+  invalidateSplineCells(index);
+  std::size_t tile,pos;
+  getTile(index,tile,pos);
+  double* t=touchTile(tile);
+  t[pos]=value;
+  for(unsigned i=0; i<dimension_; ++i) t[tilesize_+pos*dimension_+i]=der[i];
+}
+
+void TiledGrid::addValue(index_t index, double value) {
+  plumed_dbg_assert(index<maxsize_ && !usederiv_);
+  invalidateSplineCells(index);
+  std::size_t tile,pos;
+  getTile(index,tile,pos);
+  touchTile(tile)[pos]+=value;
+}
+
+void TiledGrid::addValueAndDerivatives(index_t index, double value, std::vector<double>& der) {
+  plumed_dbg_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
+  invalidateSplineCells(index);
+  std::size_t tile,pos;
+  getTile(index,tile,pos);
+  double* t=touchTile(tile);
+  t[pos]+=value;
+  for(unsigned i=0; i<dimension_; ++i) t[tilesize_+pos*dimension_+i]+=der[i];
+}
+
+double TiledGrid::getMinValue() const {
+  // points that have never been touched are zero, as in SparseGrid
+  double minval=0.0;
+  for(const auto & t : tiles_) {
+    if(!t) continue;
+    for(std::size_t i=0; i<tilesize_; ++i) if(t[i]<minval) minval=t[i];
+  }
+  return minval;
+}
+
+double TiledGrid::getMaxValue() const {
+  double maxval=0.0;
+  for(const auto & t : tiles_) {
+    if(!t) continue;
+    for(std::size_t i=0; i<tilesize_; ++i) if(t[i]>maxval) maxval=t[i];
+  }
+  return maxval;
+}
+
+void TiledGrid::writeToFile(OFile& ofile) {
+  std::vector<double> xx(dimension_);
+  std::vector<double> der(dimension_);
+  double f;
+  writeHeader(ofile);
+  for(index_t i=0; i<maxsize_; ++i) {
+    std::size_t tile,pos;
+    getTile(i,tile,pos);
+    if(!tiles_[tile]) continue;
+    xx=getPoint(i);
+    if(usederiv_) {f=getValueAndDerivatives(i,der);}
+    else {f=getValue(i);}
+    if(i>0 && dimension_>1 && getIndices(i)[dimension_-2]==0) ofile.printf("\n");
+    for(unsigned j=0; j<dimension_; ++j) {
+      ofile.printField("min_" + argnames[j], str_min_[j] );
+      ofile.printField("max_" + argnames[j], str_max_[j] );
+      ofile.printField("nbins_" + argnames[j], static_cast<int>(nbin_[j]) );
+      if( pbc_[j] ) ofile.printField("periodic_" + argnames[j], "true" );
+      else          ofile.printField("periodic_" + argnames[j], "false" );
+    }
+    for(unsigned j=0; j<dimension_; ++j) { ofile.fmtField(" "+fmt_); ofile.printField(argnames[j],xx[j]); }
+    ofile.fmtField(" "+fmt_); ofile.printField(funcname,f);
+    if(usederiv_) for(unsigned j=0; j<dimension_; ++j) { ofile.fmtField(" "+fmt_); ofile.printField("der_" + argnames[j],der[j]); }
+    ofile.printField();
+  }
+}
+
 double SparseGrid::getMinValue() const {
   double minval;
   minval=0.0;
@@ -911,16 +1343,28 @@ Grid Grid::project(const std::vector<std::string> & proj, WeightBase *ptr2obj )
     if(doappend)toBeIntegrated.push_back(i);
   }
 
-  // loop over all the points in the Grid, find the corresponding fixed index, rotate over all the other ones
-  for(unsigned i=0; i<smallgrid.getSize(); i++) {
-    std::vector<unsigned> v;
-    v=smallgrid.getIndices(i);
-    std::vector<int> vHigh((getArgNames()).size(),-1);
-    for(unsigned j=0; j<dimMapping.size(); j++)vHigh[dimMapping[j]]=int(v[j]);
-    // the vector vhigh now contains at the beginning the index of the low dimension and -1 for the values that need to be integrated
-    double initval=0.;
-    projectOnLowDimension(initval,vHigh, ptr2obj);
-    smallgrid.setValue(i,ptr2obj->projectOuterLoop(initval));
+  // the offsets of all the points that are integrated out from the point that has index zero in all these directions
+  std::vector<index_t> stride(dimension_); stride[0]=1;
+  for(unsigned i=1; i<dimension_; i++) stride[i]=stride[i-1]*nbin_[i-1];
+  std::vector<index_t> offsets(1,0);
+  for(const auto & k : toBeIntegrated) {
+    const std::size_t m=offsets.size(); offsets.resize(m*nbin_[k]);
+    for(unsigned j=1; j<nbin_[k]; j++) for(std::size_t l=0; l<m; l++) offsets[j*m+l]=offsets[l]+j*stride[k];
+  }
+
+  // loop over all the points in the small grid, find the corresponding point in this grid and get the values at all the points that are integrated out
+  unsigned nt=OpenMP::getNumThreads();
+  if( nt>smallgrid.getSize() ) nt=1;
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<unsigned> v(dimMapping.size()); std::vector<double> vals(offsets.size());
+    #pragma omp for
+    for(index_t i=0; i<smallgrid.getSize(); i++) {
+      smallgrid.getIndices(i,v.data(),v.size()); index_t start=0;
+      for(unsigned j=0; j<dimMapping.size(); j++) start+=v[j]*stride[dimMapping[j]];
+      for(std::size_t l=0; l<offsets.size(); l++) vals[l]=getValue(start+offsets[l]);
+      smallgrid.setValue(i,ptr2obj->projectValues(vals));
+    }
   }
 
   return smallgrid;
@@ -958,6 +1402,7 @@ double Grid::integrate( std::vector<unsigned>& npoints ) {
 }
 
 void Grid::mpiSumValuesAndDerivatives( Communicator& comm ) {
+  invalidateSplineTable();
   comm.Sum( grid_ ); for(unsigned i=0; i<der_.size(); ++i) comm.Sum( der_[i] );
 }
 
@@ -29,6 +29,9 @@
 #include <cmath>
 #include <memory>
 #include <cstddef>
+#include <atomic>
+#include <algorithm>
+#include <limits>
 
 #include "Exception.h"
 
@@ -41,6 +44,9 @@ class WeightBase {
 public:
   virtual double projectInnerLoop(double &input, double &v)=0;
   virtual double projectOuterLoop(double &v)=0;
+/// Get the projected value from the values of all the grid points that are integrated out.
+/// This is called by many threads at once so it must not modify the object
+  virtual double projectValues(const std::vector<double> &v) const=0;
   virtual ~WeightBase() {}
 };
 
@@ -66,6 +72,12 @@ public:
     shift=0.0;
     return res;
   }
+  double projectValues(const std::vector<double> &v) const override {
+    // the largest exponent is factored out of the sum so that the exponentials cannot overflow
+    double vmax=*std::max_element(v.begin(),v.end()), sum=0;
+    for(const auto & vv : v) sum+=std::exp(beta*(vv-vmax));
+    return -invbeta*std::log(sum)-vmax;
+  }
 };
 
 class ProbWeight:public WeightBase {
@@ -74,6 +86,10 @@ public:
   explicit ProbWeight(double v) {beta=v; invbeta=1./beta;}
   double projectInnerLoop(double &input, double &v) override {return  input+v;}
   double projectOuterLoop(double &v) override {return -invbeta*std::log(v);}
+  double projectValues(const std::vector<double> &v) const override {
+    double sum=0; for(const auto & vv : v) sum+=vv;
+    return -invbeta*std::log(sum);
+  }
 };
 
 
@@ -202,6 +218,68 @@ public:
     {}
   };
 
+  /**
+  Table of the coefficients of the spline polynomial of each cell.
+
+  Inside the cell whose lower corner is a grid point the spline is a polynomial
+  of degree three in each of the reduced coordinates t_j=(x_j-x0_j)/dx_j.
+  Its 4^d coefficients are computed the first time the cell is used and are then
+  reused until one of the corners of the cell is modified, so that interpolating
+  becomes a short tensor contraction.
+  The coefficients are stored in blocks of consecutive cells that are only allocated
+  when one of their cells is used, so that the memory is proportional to the region
+  of the grid where the bias is interpolated.
+  Copies of the table are empty, they are filled again when used.
+
+  \warning
+  Interface might change at any time.
+  Do not use this outside of class GridBase and children.
+  */
+  class SplineTable {
+    static constexpr std::size_t blocksize=256;
+    struct Block {
+      std::vector<double> coeffs;
+      std::unique_ptr<std::atomic<unsigned char>[]> valid;
+      explicit Block(std::size_t ncoeffs);
+    };
+    std::size_t ncells=0;
+    std::size_t ncoeffs=0;
+/// pointers to the allocated blocks, null for blocks that were never used.  They can be read while set() is called by another thread
+    std::unique_ptr<std::atomic<Block*>[]> blocks;
+    std::vector<std::unique_ptr<Block>> owned;
+  public:
+    SplineTable() = default;
+    SplineTable(const SplineTable& other) {
+      if(other.enabled()) setup(other.ncells,other.ncoeffs);
+    }
+    SplineTable & operator=(const SplineTable & other) {
+      if(this!=&other) {
+        if(other.enabled()) setup(other.ncells,other.ncoeffs);
+        else *this=SplineTable();
+      }
+      return *this;
+    }
+    SplineTable & operator=(SplineTable && other) = default;
+    void setup(std::size_t ncells, std::size_t ncoeffs);
+    bool enabled() const {return ncells>0;}
+    std::size_t getNumberOfCoefficients() const {return ncoeffs;}
+    const double* get(index_t cell) const {
+      const Block* b=blocks[cell/blocksize].load(std::memory_order_acquire);
+      if(!b || !b->valid[cell%blocksize].load(std::memory_order_acquire)) return nullptr;
+      return b->coeffs.data()+(cell%blocksize)*ncoeffs;
+    }
+/// store the coefficients of a cell, calls should not be concurrent
+    void set(index_t cell, const double* c);
+    void invalidate(index_t cell) {
+      Block* b=blocks[cell/blocksize].load(std::memory_order_relaxed);
+      if(b) b->valid[cell%blocksize].store(0,std::memory_order_relaxed);
+    }
+    void invalidate();
+    std::size_t getMemoryUsage() const {
+      return owned.size()*blocksize*(ncoeffs*sizeof(double)+1)+(blocks ? (ncells+blocksize-1)/blocksize*sizeof(Block*) : 0);
+    }
+  };
+
 protected:
   AcceleratorHandler accelerator;
   std::string funcname;
@@ -214,6 +292,15 @@ protected:
   unsigned dimension_;
   bool dospline_, usederiv_;
   std::string fmt_; // format for output
+/// coefficients of the spline, only used after enableSplineTable()
+  mutable SplineTable spline_table_;
+/// mark as outdated the coefficients of the cells that have a point as a corner
+  void invalidateSplineCells(index_t index) {if(spline_table_.enabled()) invalidateSplineCellsOf(index);}
+  void invalidateSplineCellsOf(index_t index);
+/// mark as outdated all the coefficients, to be used when all the grid is modified
+  void invalidateSplineTable() {if(spline_table_.enabled()) spline_table_.invalidate();}
+/// compute the coefficients of the spline in a cell
+  void computeSplineCoefficients(const unsigned* indices, double* c) const;
 /// get "neighbors" for spline
   unsigned getSplineNeighbors(const unsigned* indices, std::size_t indices_size, index_t* neighbors, std::size_t neighbors_size)const;
 // std::vector<index_t> getSplineNeighbors(const std::vector<unsigned> & indices)const;
@@ -250,6 +337,8 @@ public:
   unsigned getDimension() const;
 /// get argument names  of this grid
   std::vector<std::string> getArgNames() const;
+/// get the name of the function stored in this grid
+  const std::string& getFuncName() const {return funcname;}
 /// get if the grid has derivatives
   bool hasDerivatives() const {return usederiv_;}
 
@@ -316,6 +405,14 @@ public:
   void addValueAndDerivatives(const std::vector<unsigned> & indices, double value, std::vector<double>& der);
 /// add a kernel function to the grid
   void addKernel( const KernelFunctions& kernel );
+/// add a gaussian with a diagonal metric to the points within nneighb bins of its center.  With dp_j=(x_j-center_j)*invwidth_j
+/// and dp2=0.5*sum_j dp_j^2 the value is height*(stretchA*exp(-dp2)+stretchB) where dp2<dp2cutoff and zero elsewhere.
+/// The one dimensional gaussians are computed once for each bin, so this is much faster than evaluating the gaussian at each point
+  void addSeparableGaussian( const std::vector<double>& center, const std::vector<double>& invwidth, double height, const std::vector<unsigned>& nneighb,
+                             double dp2cutoff=std::numeric_limits<double>::max(), double stretchA=1.0, double stretchB=0.0 );
+/// store the polynomial coefficients of the spline of each cell, which makes interpolation faster.
+/// This requires 4^d doubles for each point in the region of the grid where the interpolation is used
+  void enableSplineTable();
 
 /// get minimum value
   virtual double getMinValue() const = 0;
@@ -327,6 +424,8 @@ public:
 /// dump grid to gaussian cube file
   void writeCubeFile(OFile&, const double& lunit);
 
+/// number of bytes allocated by the grid
+  virtual std::size_t getMemoryUsage() const {return spline_table_.getMemoryUsage();}
   virtual ~GridBase() = default;
 
 /// set output format
@@ -364,6 +463,7 @@ public:
     if(usederiv_) der_.assign(maxsize_*dimension_,0.0);
   }
   index_t getSize() const override;
+  std::size_t getMemoryUsage() const override;
 /// this is to access to Grid:: version of these methods (allowing overloading of virtual methods)
   using GridBase::getValue;
   using GridBase::getValueAndDerivatives;
@@ -406,6 +506,8 @@ public:
 /// Since this method returns a concrete Grid, it should be here and not in GridBase - GB
 /// project a high dimensional grid onto a low dimensional one: this should be changed at some time
 /// to enable many types of weighting
+/// The grid points that are integrated out for each point of the projection are found using the strides of the grid
+/// and the points of the projection are computed in parallel
   Grid project( const std::vector<std::string> & proj, WeightBase *ptr2obj  );
   void projectOnLowDimension(double &val, std::vector<int> &varHigh, WeightBase* ptr2obj );
   void mpiSumValuesAndDerivatives( Communicator& comm );
@@ -428,6 +530,7 @@ public:
     GridBase(funcl,args,gmin,gmax,nbin,dospline,usederiv) {}
 
   index_t getSize() const override;
+  std::size_t getMemoryUsage() const override;
   index_t getMaxSize() const;
 
 /// this is to access to Grid:: version of these methods (allowing overloading of virtual methods)
@@ -462,6 +565,77 @@ public:
   virtual ~SparseGrid() = default;
 };
 
+/// Grid stored in dense tiles that are allocated the first time one of their points is set.
+/// Points in tiles that have never been touched are zero, so that only the explored regions
+/// cost memory, while the points close to each other (as in spline stencils and kernels)
+/// stay contiguous in memory.
+class TiledGrid : public GridBase
+{
+/// number of points of a tile along each dimension
+  std::vector<unsigned> edge_;
+/// number of tiles along each dimension
+  std::vector<unsigned> ntiles_;
+/// number of points in a tile
+  std::size_t tilesize_;
+/// each tile contains the values followed by the derivatives
+  std::vector<std::unique_ptr<double[]>> tiles_;
+  std::size_t nalloc_=0;
+  void setupTiles();
+/// get the tile of a point and its position in the tile
+  void getTile(index_t index, std::size_t& tile, std::size_t& pos) const;
+  double* touchTile(std::size_t tile);
+
+public:
+  TiledGrid(const std::string& funcl, const std::vector<Value*> & args, const std::vector<std::string> & gmin,
+            const std::vector<std::string> & gmax,
+            const std::vector<unsigned> & nbin, bool dospline, bool usederiv):
+    GridBase(funcl,args,gmin,gmax,nbin,dospline,usederiv) {setupTiles();}
+  TiledGrid(const std::string& funcl, const std::vector<std::string> &names, const std::vector<std::string> & gmin,
+            const std::vector<std::string> & gmax, const std::vector<unsigned> & nbin, bool dospline,
+            bool usederiv, const std::vector<bool> &isperiodic, const std::vector<std::string> &pmin,
+            const std::vector<std::string> &pmax ):
+    GridBase(funcl,names,gmin,gmax,nbin,dospline,usederiv,isperiodic,pmin,pmax) {setupTiles();}
+  TiledGrid(const TiledGrid&);
+  TiledGrid& operator=(const TiledGrid&);
+
+  index_t getSize() const override;
+  std::size_t getMemoryUsage() const override;
+/// number of points in the tiles that have been allocated
+  index_t getNumberOfAllocatedPoints() const {return nalloc_*tilesize_;}
+/// copy all the non zero points of another grid with the same layout
+  void copyFrom(const GridBase&);
+
+  using GridBase::getValue;
+  using GridBase::getValueAndDerivatives;
+  using GridBase::setValue;
+  using GridBase::setValueAndDerivatives;
+  using GridBase::addValue;
+  using GridBase::addValueAndDerivatives;
+
+/// get grid value
+  double getValue(index_t index) const override;
+/// get grid value and derivatives
+  double getValueAndDerivatives(index_t index, double* der, std::size_t der_size) const override;
+
+/// set grid value
+  void setValue(index_t index, double value) override;
+/// set grid value and derivatives
+  void setValueAndDerivatives(index_t index, double value, std::vector<double>& der) override;
+/// add to grid value
+  void addValue(index_t index, double value) override;
+/// add to grid value and derivatives
+  void addValueAndDerivatives(index_t index, double value, std::vector<double>& der) override;
+
+/// get minimum value
+  double getMinValue() const override;
+/// get maximum value
+  double getMaxValue() const override;
+/// dump the points of the allocated tiles on file
+  void writeToFile(OFile&) override;
+
+  virtual ~TiledGrid() = default;
+};
+
 
 inline
 GridBase::index_t GridBase::getIndex(const unsigned* indices,std::size_t indices_size) const {
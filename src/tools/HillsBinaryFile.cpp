@@ -0,0 +1,185 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "HillsBinaryFile.h"
+#include "Exception.h"
+#include <algorithm>
+#include <cstring>
+
+namespace PLMD {
+
+static const char hillsBinaryMagic[8]= {'P','L','M','D','H','I','L','L'};
+static constexpr std::uint32_t hillsBinaryVersion=1;
+/// The number of records that are read at once
+static constexpr std::size_t hillsBinaryBlock=4096;
+
+HillsBinaryFile::~HillsBinaryFile() {
+  if(fp) std::fclose(fp);
+}
+
+std::size_t HillsBinaryFile::getRecordSize() const {
+  const std::size_t ncv=variables.size();
+  // time, height, biasf, multivariate, centers and widths, followed by the checksum that also takes the space of a double
+  return 4+ncv+ncv*(ncv+1)/2+(checksum ? 1 : 0);
+}
+
+std::uint64_t HillsBinaryFile::computeChecksum(const double* rec, std::size_t n) {
+  // FNV-1a on the bytes of the record
+  std::uint64_t h=14695981039346656037ULL;
+  const unsigned char* p=reinterpret_cast<const unsigned char*>(rec);
+  for(std::size_t i=0; i<n*sizeof(double); ++i) { h^=p[i]; h*=1099511628211ULL; }
+  return h;
+}
+
+static void writeString(std::FILE* fp, const std::string& s) {
+  const std::uint32_t n=s.length();
+  std::fwrite(&n,sizeof(n),1,fp);
+  std::fwrite(s.data(),1,n,fp);
+}
+
+static bool readString(std::FILE* fp, std::string& s) {
+  std::uint32_t n;
+  if(std::fread(&n,sizeof(n),1,fp)!=1) return false;
+  s.resize(n);
+  return n==0 || std::fread(&s[0],1,n,fp)==n;
+}
+
+void HillsBinaryFile::writeHeader() {
+  std::fwrite(hillsBinaryMagic,1,8,fp);
+  const std::uint32_t head[3]= {hillsBinaryVersion,static_cast<std::uint32_t>(variables.size()),checksum ? 1u : 0u};
+  std::fwrite(head,sizeof(std::uint32_t),3,fp);
+  for(const auto & v : variables) {
+    writeString(fp,v.name);
+    const std::uint32_t p=v.periodic ? 1 : 0;
+    std::fwrite(&p,sizeof(p),1,fp);
+    if(v.periodic) { writeString(fp,v.min); writeString(fp,v.max); }
+  }
+}
+
+void HillsBinaryFile::readHeader() {
+  char magic[8];
+  std::uint32_t head[3];
+  plumed_massert(std::fread(magic,1,8,fp)==8 && std::memcmp(magic,hillsBinaryMagic,8)==0,"file "+fname+" is not a binary hills file");
+  plumed_massert(std::fread(head,sizeof(std::uint32_t),3,fp)==3,"cannot read the header of binary hills file "+fname);
+  plumed_massert(head[0]==hillsBinaryVersion,"unsupported version of binary hills file "+fname);
+  checksum=(head[2]&1);
+  variables.resize(head[1]);
+  for(auto & v : variables) {
+    std::uint32_t p=0;
+    bool ok=readString(fp,v.name) && std::fread(&p,sizeof(p),1,fp)==1;
+    v.periodic=(p!=0);
+    if(ok && v.periodic) ok=readString(fp,v.min) && readString(fp,v.max);
+    plumed_massert(ok,"cannot read the header of binary hills file "+fname);
+  }
+}
+
+bool HillsBinaryFile::isBinary(const std::string& fname) {
+  std::FILE* f=std::fopen(fname.c_str(),"rb");
+  if(!f) return false;
+  char magic[8];
+  const bool res=std::fread(magic,1,8,f)==8 && std::memcmp(magic,hillsBinaryMagic,8)==0;
+  std::fclose(f);
+  return res;
+}
+
+void HillsBinaryFile::create(const std::string& fname, const std::vector<Variable>& vars, bool checksum, bool append) {
+  plumed_assert(!fp);
+  this->fname=fname;
+  writing=true;
+  if(append && isBinary(fname)) {
+    open(fname);
+    const std::vector<Variable> old=variables;
+    close();
+    plumed_massert(old.size()==vars.size(),"the CVs in binary hills file "+fname+" do not match those in input");
+    for(unsigned i=0; i<old.size(); ++i) {
+      plumed_massert(old[i].name==vars[i].name && old[i].periodic==vars[i].periodic && old[i].min==vars[i].min && old[i].max==vars[i].max,
+                     "the CVs in binary hills file "+fname+" do not match those in input");
+    }
+    fp=std::fopen(fname.c_str(),"ab");
+    plumed_massert(fp,"cannot open binary hills file "+fname+" for appending");
+    this->fname=fname; writing=true;
+  } else {
+    variables=vars;
+    this->checksum=checksum;
+    fp=std::fopen(fname.c_str(),"wb");
+    plumed_massert(fp,"cannot open binary hills file "+fname+" for writing");
+    writeHeader();
+  }
+}
+
+void HillsBinaryFile::open(const std::string& fname) {
+  plumed_assert(!fp);
+  this->fname=fname;
+  writing=false;
+  fp=std::fopen(fname.c_str(),"rb");
+  plumed_massert(fp,"cannot open binary hills file "+fname);
+  readHeader();
+  bufferpos=buffersize=0;
+}
+
+void HillsBinaryFile::close() {
+  if(fp) std::fclose(fp);
+  fp=nullptr;
+}
+
+void HillsBinaryFile::write(const Record& rec) {
+  plumed_assert(fp && writing);
+  const std::size_t ncv=variables.size(), n=getRecordSize();
+  plumed_assert(rec.center.size()==ncv && rec.sigma.size()<=ncv*(ncv+1)/2);
+  buffer.assign(n,0.0);
+  buffer[0]=rec.time; buffer[1]=rec.height; buffer[2]=rec.biasf; buffer[3]=rec.multivariate ? 1.0 : 0.0;
+  std::copy(rec.center.begin(),rec.center.end(),buffer.begin()+4);
+  std::copy(rec.sigma.begin(),rec.sigma.end(),buffer.begin()+4+ncv);
+  if(checksum) {
+    const std::uint64_t h=computeChecksum(buffer.data(),n-1);
+    std::memcpy(&buffer[n-1],&h,sizeof(h));
+  }
+  plumed_massert(std::fwrite(buffer.data(),sizeof(double),n,fp)==n,"cannot write on binary hills file "+fname);
+}
+
+void HillsBinaryFile::flush() {
+  if(fp) std::fflush(fp);
+}
+
+bool HillsBinaryFile::read(Record& rec) {
+  plumed_assert(fp && !writing);
+  const std::size_t ncv=variables.size(), n=getRecordSize();
+  if(bufferpos==buffersize) {
+    buffer.resize(n*hillsBinaryBlock);
+    const std::size_t nread=std::fread(buffer.data(),sizeof(double),n*hillsBinaryBlock,fp);
+    // a truncated record at the end of the file is ignored
+    buffersize=nread/n; bufferpos=0;
+    if(buffersize==0) return false;
+  }
+  const double* r=buffer.data()+n*bufferpos;
+  if(checksum) {
+    std::uint64_t h;
+    std::memcpy(&h,r+n-1,sizeof(h));
+    plumed_massert(h==computeChecksum(r,n-1),"wrong checksum in binary hills file "+fname);
+  }
+  rec.time=r[0]; rec.height=r[1]; rec.biasf=r[2]; rec.multivariate=(r[3]!=0.0);
+  rec.center.assign(r+4,r+4+ncv);
+  rec.sigma.assign(r+4+ncv,r+4+ncv+(rec.multivariate ? ncv*(ncv+1)/2 : ncv));
+  bufferpos++;
+  return true;
+}
+
+}
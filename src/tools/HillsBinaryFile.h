@@ -0,0 +1,96 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_HillsBinaryFile_h
+#define __PLUMED_tools_HillsBinaryFile_h
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PLMD {
+
+/**
+Binary log of the Gaussians deposited by metadynamics.
+
+The file starts with a header that contains the names and the periodicity of
+the CVs. The Gaussians follow as records of fixed width that contain the same quantities
+that are written in the text HILLS files: time, height, bias factor, a multivariate flag,
+the centers and the widths. For multivariate Gaussians the widths are the elements of the
+Cholesky factor in the band order used in the text files, otherwise only the first
+ncv widths are used. When the header requests it each record is followed by a checksum.
+
+Records can be read with a single fread per block, so that loading is limited by I/O
+rather than by parsing the text fields.
+*/
+class HillsBinaryFile {
+public:
+  struct Variable {
+    std::string name;
+    bool periodic=false;
+    std::string min, max;
+  };
+  struct Record {
+    double time=0.0;
+    double height=0.0;
+    double biasf=1.0;
+    bool multivariate=false;
+    std::vector<double> center;
+    std::vector<double> sigma;
+  };
+private:
+  std::FILE* fp=nullptr;
+  std::string fname;
+  std::vector<Variable> variables;
+  bool checksum=false;
+  bool writing=false;
+/// Records read from the file but not yet returned
+  std::vector<double> buffer;
+  std::size_t bufferpos=0, buffersize=0;
+  std::size_t getRecordSize() const ;
+  void writeHeader();
+  void readHeader();
+  static std::uint64_t computeChecksum(const double* rec, std::size_t n);
+public:
+  HillsBinaryFile()=default;
+  ~HillsBinaryFile();
+  HillsBinaryFile(const HillsBinaryFile&) = delete;
+  HillsBinaryFile& operator=(const HillsBinaryFile&) = delete;
+/// Check if a file starts with the header of a binary hills file
+  static bool isBinary(const std::string& fname);
+/// Open a file for writing, when append is true and the file exists the header is checked and the records are appended
+  void create(const std::string& fname, const std::vector<Variable>& vars, bool checksum, bool append);
+/// Open a file for reading
+  void open(const std::string& fname);
+  void close();
+  bool isOpen() const { return fp!=nullptr; }
+  const std::vector<Variable>& getVariables() const { return variables; }
+  bool hasChecksum() const { return checksum; }
+  void write(const Record& rec);
+  void flush();
+/// Read the next record, returns false at the end of the file
+  bool read(Record& rec);
+};
+
+}
+
+#endif
@@ -231,6 +231,36 @@ double HistogramBead::calculateWithCutoff( double x, double& df ) const {
   return f;
 }
 
+void HistogramBead::calculateWithCutoff( double x, const std::vector<double>& lb, const std::vector<double>& ub, std::vector<double>& f, std::vector<double>& df ) const {
+  plumed_dbg_assert(init && periodicity!=unset && lb.size()==ub.size() );
+  const unsigned n=lb.size(); f.resize(n); df.resize(n);
+  // The normalisation is the same for all the beads so it is only computed once
+  const double dnorm=std::sqrt(2*pi)*width;
+  for(unsigned k=0; k<n; ++k) {
+    double lowB = difference( x, lb[k] ) / width, upperB = difference( x, ub[k] ) / width;
+    if( upperB<=-cutoff || lowB>=cutoff ) { f[k]=df[k]=0; continue; }
+    if( type==gaussian ) {
+      lowB /= std::sqrt(2.0); upperB /= std::sqrt(2.0);
+      df[k] = ( exp( -lowB*lowB ) - exp( -upperB*upperB ) ) / dnorm;
+      f[k] = 0.5*( erf( upperB ) - erf( lowB ) );
+    } else if( type==triangular ) {
+      df[k]=0;
+      if( std::fabs(lowB)<1. ) df[k] = (1 - std::fabs(lowB)) / width;
+      if( std::fabs(upperB)<1. ) df[k] -= (1 - std::fabs(upperB)) / width;
+      if (upperB<=-1. || lowB >=1.) {
+        f[k]=0.;
+      } else {
+        double ia, ib;
+        if( lowB>-1.0 ) { ia=lowB; } else { ia=-1.0; }
+        if( upperB<1.0 ) { ib=upperB; } else { ib=1.0; }
+        f[k] = (ib*(2.-std::fabs(ib))-ia*(2.-std::fabs(ia)))*0.5;
+      }
+    } else {
+      plumed_merror("function type does not exist");
+    }
+  }
+}
+
 double HistogramBead::lboundDerivative( const double& x ) const {
   if( type==gaussian ) {
     double lowB = difference( x, lowb ) / ( std::sqrt(2.0) * width );
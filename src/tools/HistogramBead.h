@@ -61,6 +61,9 @@ public:
   void set(double l, double h, double w);
   double calculate(double x, double&df) const;
   double calculateWithCutoff( double x, double& df ) const;
+/// Evaluate a set of beads that have the same width and kernel as this one at x.  Bead k covers [lb[k],ub[k]].
+/// This gives the same result as calling calculateWithCutoff for each bead
+  void calculateWithCutoff( double x, const std::vector<double>& lb, const std::vector<double>& ub, std::vector<double>& f, std::vector<double>& df ) const;
   double lboundDerivative( const double& x ) const;
   double uboundDerivative( const double& x ) const;
   double getlowb() const ;
@@ -20,6 +20,7 @@
    along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "IFile.h"
+#include "BinaryColumns.h"
 #include "Exception.h"
 #include "core/Action.h"
 #include "core/PlumedMain.h"
@@ -29,6 +30,11 @@
 #include <cstdarg>
 #include <cstring>
 #include <cmath>
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cstdlib>
+#include <string_view>
 
 #include <iostream>
 #include <string>
@@ -38,9 +44,75 @@
 
 namespace PLMD {
 
+namespace {
+
+/// Split a data line in place, stopping at comments.
+/// Returns false if the line contains braces, which are handled by Tools::getWords
+bool splitDataLine(std::string_view line,std::vector<std::string_view> & words) {
+  words.clear();
+  std::size_t start=0;
+  bool inword=false;
+  for(std::size_t i=0; i<line.length(); i++) {
+    const char c=line[i];
+    if(c=='#') {
+      line=line.substr(0,i);
+      break;
+    }
+    if(c=='{' || c=='}') return false;
+    const bool is_separator=(c==' ' || c=='\t' || c=='\n');
+    if(!is_separator && !inword) {
+      start=i;
+      inword=true;
+    } else if(is_separator && inword) {
+      words.push_back(line.substr(start,i-start));
+      inword=false;
+    }
+  }
+  if(inword) words.push_back(line.substr(start));
+  return true;
+}
+
+/// Plain numbers are converted without streams, anything else (e.g. pi or expressions)
+/// is left to Tools::convert
+template<typename T>
+bool fastConvert(const std::string & str,T & t) {
+  const char* end=str.data()+str.length();
+  auto res=std::from_chars(str.data(),end,t);
+  return res.ec==std::errc() && res.ptr==end;
+}
+
+template<>
+bool fastConvert(const std::string & str,double & t) {
+  if(str.empty() || str.find_first_not_of("0123456789+-.eE")!=std::string::npos) return false;
+  const char* end=str.data()+str.length();
+#ifdef __cpp_lib_to_chars
+  // from_chars does not accept a leading +
+  const char* begin=str.data();
+  if(*begin=='+') begin++;
+  auto res=std::from_chars(begin,end,t);
+  return res.ec==std::errc() && res.ptr==end;
+#else
+  char* ptr;
+  errno=0;
+  t=std::strtod(str.c_str(),&ptr);
+  return errno==0 && ptr==end;
+#endif
+}
+
+}
+
 size_t IFile::llread(char*ptr,size_t s) {
   plumed_assert(fp);
   size_t r;
+  size_t npeek=0;
+  if(peekPos<peekBuffer.length()) {
+    npeek=std::min(s,peekBuffer.length()-peekPos);
+    std::memcpy(ptr,peekBuffer.data()+peekPos,npeek);
+    peekPos+=npeek;
+    if(npeek==s) return npeek;
+    ptr+=npeek;
+    s-=npeek;
+  }
   if(gzfp) {
 #ifdef __PLUMED_HAS_ZLIB
     int rr=gzread(gzFile(gzfp),ptr,s);
@@ -55,20 +127,44 @@ size_t IFile::llread(char*ptr,size_t s) {
     if(std::feof(fp))   eof=true;
     if(std::ferror(fp)) err=true;
   }
-  return r;
+  return r+npeek;
 }
 
 IFile& IFile::advanceField() {
   plumed_assert(!inMiddleOfField);
-  std::string line;
+  if(binary) return advanceBinaryField();
+  std::string & line(lineBuffer);
+  std::vector<std::string_view> datawords;
   bool done=false;
   while(!done) {
     getline(line);
 // using explicit conversion not to confuse cppcheck 1.86
     if(!bool(*this)) {return *this;}
+// Data lines are split in place and the values are copied in the existing fields
+// without allocating new strings
+    std::size_t first=line.find_first_not_of(" \t");
+    bool header=(first!=std::string::npos && line.compare(first,2,"#!")==0);
+    if(!header && splitDataLine(line,datawords)) {
+      unsigned nf=0;
+      for(unsigned i=0; i<fields.size(); i++) if(!fields[i].constant) nf++;
+      if( datawords.size()==nf ) {
+        unsigned j=0;
+        for(unsigned i=0; i<fields.size(); i++) {
+          if(fields[i].constant) continue;
+          fields[i].value.assign(datawords[j].data(),datawords[j].length());
+          fields[i].read=false;
+          j++;
+        }
+        done=true;
+      } else if( !datawords.empty() ) {
+        plumed_merror("file " + getPath() + ": mismatch between number of fields in file and expected number\n this is the faulty line:\n"+line);
+      }
+      continue;
+    }
     std::vector<std::string> words=Tools::getWords(line);
     if(words.size()>=2 && words[0]=="#!" && words[1]=="FIELDS") {
       fields.clear();
+      nextField=0;
       for(unsigned i=2; i<words.size(); i++) {
         Field field;
         field.name=words[i];
@@ -103,6 +199,79 @@ IFile& IFile::advanceField() {
   return *this;
 }
 
+IFile& IFile::advanceBinaryField() {
+  char tag;
+  while(llread(&tag,1)==1) {
+    if(tag=='H') {
+      char len[4];
+      plumed_massert(llread(len,4)==4,"file " + getPath() + ": truncated header");
+      std::uint32_t n=binarycolumns::extract<std::uint32_t>(len);
+      std::string header(n,' ');
+      plumed_massert(llread(&header[0],n)==n,"file " + getPath() + ": truncated header");
+      std::vector<std::string> lines=Tools::getWords(header,"\n");
+      for(const auto & l : lines) {
+        std::vector<std::string> words=Tools::getWords(l);
+        if(words.size()>=2 && words[0]=="#!" && words[1]=="FIELDS") {
+          fields.clear();
+          binaryTypes.clear();
+          nextField=0;
+          for(unsigned i=2; i<words.size(); i++) {
+            Field field;
+            field.name=words[i];
+            fields.push_back(field);
+          }
+        } else if(words.size()==4 && words[0]=="#!" && words[1]=="SET") {
+          Field field;
+          field.name=words[2];
+          field.value=words[3];
+          field.constant=true;
+          fields.push_back(field);
+        } else if(words.size()==3 && words[0]=="#!" && words[1]=="FORMAT") {
+          if(words[2]=="float32") binaryPrecision=4;
+          else if(words[2]=="float64") binaryPrecision=8;
+          else plumed_merror("file " + getPath() + ": unknown binary format " + words[2]);
+        } else if(words.size()>=2 && words[0]=="#!" && words[1]=="TYPES") {
+          binaryTypes.assign(words.begin()+2,words.end());
+          for(const auto & t : binaryTypes) plumed_massert(binarycolumns::typeSize(t)>0,"file " + getPath() + ": unknown binary type " + t);
+        }
+      }
+    } else if(tag=='R') {
+      plumed_massert(binaryPrecision>0,"file " + getPath() + ": record found before the header");
+      unsigned nf=0, nbytes=0;
+      for(unsigned i=0; i<fields.size(); i++) if(!fields[i].constant) nf++;
+      plumed_massert(binaryTypes.empty() || binaryTypes.size()==nf,"file " + getPath() + ": the number of types does not match the number of fields");
+      if(binaryTypes.empty()) nbytes=nf*binaryPrecision;
+      else for(const auto & t : binaryTypes) nbytes+=binarycolumns::typeSize(t);
+      binaryBuffer.resize(nbytes);
+      plumed_massert(llread(binaryBuffer.data(),binaryBuffer.size())==binaryBuffer.size(),"file " + getPath() + ": truncated record");
+      const char* ptr=binaryBuffer.data();
+      unsigned k=0;
+      for(unsigned i=0; i<fields.size(); i++) {
+        if(fields[i].constant) continue;
+        const std::string & type(binaryTypes.empty() ? (binaryPrecision==4 ? "float32" : "float64") : binaryTypes[k]);
+        fields[i].integral=false;
+        if(type=="float32") fields[i].number=binarycolumns::extract<float>(ptr);
+        else if(type=="float64") fields[i].number=binarycolumns::extract<double>(ptr);
+        else {
+          if(type=="int32") fields[i].integer=binarycolumns::extract<std::int32_t>(ptr);
+          else fields[i].integer=binarycolumns::extract<std::int64_t>(ptr);
+          fields[i].number=fields[i].integer;
+          fields[i].integral=true;
+        }
+        fields[i].numeric=true;
+        fields[i].read=false;
+        ptr+=binarycolumns::typeSize(type);
+        k++;
+      }
+      inMiddleOfField=true;
+      return *this;
+    } else {
+      plumed_merror("file " + getPath() + ": corrupted binary file");
+    }
+  }
+  return *this;
+}
+
 IFile& IFile::open(const std::string&path) {
   plumed_massert(!cloned,"file "+path+" appears to be cloned");
   eof=false;
@@ -119,6 +288,24 @@ IFile& IFile::open(const std::string&path) {
     plumed_merror("file " + getPath() + ": trying to use a gz file without zlib being linked");
 #endif
   }
+// binary files are recognized from their first bytes, otherwise these bytes are kept and
+// returned by llread before the rest of the file, which is then read as text
+  binary=false;
+  binaryPrecision=0;
+  binaryTypes.clear();
+  peekBuffer.clear();
+  peekPos=0;
+  if(fp) {
+    char magic[sizeof(binarycolumns::magic)];
+    std::size_t n=llread(magic,sizeof(magic));
+    if(n==sizeof(magic) && std::memcmp(magic,binarycolumns::magic,sizeof(magic))==0) {
+      binary=true;
+    } else {
+      peekBuffer.assign(magic,n);
+      eof=false;
+      err=false;
+    }
+  }
   if(plumed) plumed->insertFile(*this);
   return *this;
 }
@@ -146,58 +333,58 @@ IFile& IFile::scanField(const std::string&name,std::string&str) {
 // using explicit conversion not to confuse cppcheck 1.86
   if(!bool(*this)) return *this;
   unsigned i=findField(name);
-  str=fields[i].value;
+  if(fields[i].numeric) {
+// numbers read from binary files are printed with all their digits
+    char buf[32];
+    if(fields[i].integral) std::snprintf(buf,sizeof(buf),"%lld",fields[i].integer);
+    else std::snprintf(buf,sizeof(buf),"%.17g",fields[i].number);
+    str=buf;
+  } else {
+    str=fields[i].value;
+  }
   fields[i].read=true;
   return *this;
 }
 
-IFile& IFile::scanField(const std::string&name,double &x) {
-  std::string str;
-  scanField(name,str);
-  if(*this) Tools::convert(str,x);
+template<typename T>
+IFile& IFile::scanNumericField(const std::string&name,T &x) {
+  if(!inMiddleOfField) advanceField();
+// using explicit conversion not to confuse cppcheck 1.86
+  if(!bool(*this)) return *this;
+  unsigned i=findField(name);
+  fields[i].read=true;
+  if(fields[i].integral) x=static_cast<T>(fields[i].integer);
+  else if(fields[i].numeric) x=static_cast<T>(fields[i].number);
+  else if(!fastConvert(fields[i].value,x)) Tools::convert(fields[i].value,x);
   return *this;
 }
 
+IFile& IFile::scanField(const std::string&name,double &x) {
+  return scanNumericField(name,x);
+}
+
 IFile& IFile::scanField(const std::string&name,int &x) {
-  std::string str;
-  scanField(name,str);
-  if(*this) Tools::convert(str,x);
-  return *this;
+  return scanNumericField(name,x);
 }
 
 IFile& IFile::scanField(const std::string&name,long int &x) {
-  std::string str;
-  scanField(name,str);
-  if(*this) Tools::convert(str,x);
-  return *this;
+  return scanNumericField(name,x);
 }
 
 IFile& IFile::scanField(const std::string&name,long long int &x) {
-  std::string str;
-  scanField(name,str);
-  if(*this) Tools::convert(str,x);
-  return *this;
+  return scanNumericField(name,x);
 }
 
 IFile& IFile::scanField(const std::string&name,unsigned &x) {
-  std::string str;
-  scanField(name,str);
-  if(*this) Tools::convert(str,x);
-  return *this;
+  return scanNumericField(name,x);
 }
 
 IFile& IFile::scanField(const std::string&name,long unsigned &x) {
-  std::string str;
-  scanField(name,str);
-  if(*this) Tools::convert(str,x);
-  return *this;
+  return scanNumericField(name,x);
 }
 
 IFile& IFile::scanField(const std::string&name,long long unsigned &x) {
-  std::string str;
-  scanField(name,str);
-  if(*this) Tools::convert(str,x);
-  return *this;
+  return scanNumericField(name,x);
 }
 
 IFile& IFile::scanField(Value* val) {
@@ -226,9 +413,13 @@ IFile& IFile::scanField() {
 }
 
 IFile::IFile():
+  nextField(0),
   inMiddleOfField(false),
   ignoreFields(false),
-  noEOL(false)
+  noEOL(false),
+  binaryPrecision(0),
+  binary(false),
+  peekPos(0)
 {
 }
 
@@ -241,6 +432,7 @@ IFile& IFile::getline(std::string &str) {
   str="";
   fpos_t pos;
   fgetpos(fp,&pos);
+  std::size_t peekpos=peekPos;
   while(llread(&tmp,1)==1 && tmp && tmp!='\n' && tmp!='\r' && !eof && !err) {
     str+=tmp;
   }
@@ -253,7 +445,10 @@ IFile& IFile::getline(std::string &str) {
   } else if(eof || err || tmp!='\n') {
     eof = true;
     str="";
-    if(!err) fsetpos(fp,&pos);
+    if(!err) {
+      fsetpos(fp,&pos);
+      peekPos=peekpos;
+    }
 // there was a fsetpos here that apparently is not necessary
 //  fsetpos(fp,&pos);
 // I think it was necessary to have rewind working correctly
@@ -266,11 +461,16 @@ IFile& IFile::getline(std::string &str) {
 }
 
 unsigned IFile::findField(const std::string&name)const {
-  unsigned i;
+  unsigned i=nextField;
+  if(i<fields.size() && fields[i].name==name) {
+    nextField=i+1;
+    return i;
+  }
   for(i=0; i<fields.size(); i++) if(fields[i].name==name) break;
   if(i>=fields.size()) {
     plumed_merror("file " + getPath() + ": field " + name + " cannot be found");
   }
+  nextField=i+1;
   return i;
 }
 
@@ -45,23 +45,52 @@ class IFile:
     public FieldBase {
   public:
     bool read;
-    Field(): read(false) {}
+/// True if the value was read from a binary file and is stored in number
+    bool numeric;
+    double number;
+/// True if the value read from a binary file is an integer, which is also stored in integer
+    bool integral;
+    long long int integer;
+    Field(): read(false), numeric(false), number(0.0), integral(false), integer(0) {}
   };
 /// Low-level read.
 /// Note: in parallel, all processes read
   std::size_t llread(char*,std::size_t);
 /// All the defined fields
   std::vector<Field> fields;
+/// Buffer for the line that is being parsed, reused to avoid allocations
+  std::string lineBuffer;
+/// Index following the last field found by findField.
+/// Fields are usually read in the order in which they appear, so this is checked first
+  mutable unsigned nextField;
 /// Flag set in the middle of a field reading
   bool inMiddleOfField;
 /// Set to true if you want to allow fields to be ignored in the read in file
   bool ignoreFields;
 /// Set to true to allow files without end-of-line at the end
   bool noEOL;
+/// Number of bytes used for each value in a binary file, zero for text files
+  unsigned binaryPrecision;
+/// True if the file is in the binary columnar format described in BinaryColumns.h
+  bool binary;
+/// Buffer used to read the blocks of binary files
+  std::vector<char> binaryBuffer;
+/// Type of each of the fields that are not constant in a binary file, empty if they all have binaryPrecision bytes
+  std::vector<std::string> binaryTypes;
+/// The bytes read by open() to recognize binary files, which are returned first by llread.
+/// They are kept in memory so that files that cannot be rewound (e.g. pipes) can be read
+  std::string peekBuffer;
+/// Number of bytes of peekBuffer that have been returned by llread
+  std::size_t peekPos;
 /// Advance to next field (= read one line)
   IFile& advanceField();
+/// Advance to next field in a binary file (= read one record)
+  IFile& advanceBinaryField();
 /// Find field index by name
   unsigned findField(const std::string&name)const;
+/// Read a numeric field, converting it in place when possible
+  template<typename T>
+  IFile& scanNumericField(const std::string&,T&);
 public:
 /// Constructor
   IFile();
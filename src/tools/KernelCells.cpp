@@ -0,0 +1,109 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "KernelCells.h"
+#include "Exception.h"
+#include <algorithm>
+#include <cmath>
+
+namespace PLMD {
+
+void KernelCells::setup(const std::vector<double>& min, const std::vector<double>& period, double cutoff) {
+  plumed_assert(min.size()==period.size() && cutoff>0.0);
+  this->min=min; this->period=period; this->cutoff=cutoff;
+  width.assign(min.size(),0.0); maxsigma.assign(min.size(),0.0); ncells.assign(min.size(),0);
+  cells.clear();
+}
+
+void KernelCells::setWidths() {
+  for(unsigned i=0; i<width.size(); ++i) {
+    width[i]=cutoff*maxsigma[i]; ncells[i]=0;
+    if(period[i]>0.0) {
+      if(width[i]>0.0) ncells[i]=static_cast<int>(std::floor(period[i]/width[i]));
+      if(ncells[i]<3) ncells[i]=0;
+      else width[i]=period[i]/ncells[i];
+    }
+  }
+}
+
+bool KernelCells::updateWidths(const std::vector<double>& sigma) {
+  plumed_dbg_assert(sigma.size()==maxsigma.size());
+  bool wider=false;
+  for(unsigned i=0; i<sigma.size(); ++i) {
+    if(sigma[i]>maxsigma[i]) { maxsigma[i]=sigma[i]; wider=true; }
+  }
+  if(!wider) return false;
+  setWidths();
+  cells.clear();
+  return true;
+}
+
+std::vector<int> KernelCells::getCell(const std::vector<double>& x) const {
+  std::vector<int> c(x.size(),0);
+  for(unsigned i=0; i<x.size(); ++i) {
+    if(period[i]==0.0) c[i]=static_cast<int>(std::floor(x[i]/width[i]));
+    else if(ncells[i]>0) c[i]=(static_cast<int>(std::floor((x[i]-min[i])/width[i]))%ncells[i]+ncells[i])%ncells[i];
+  }
+  return c;
+}
+
+void KernelCells::add(const std::vector<double>& center, unsigned index) {
+  cells[getCell(center)].push_back(index);
+}
+
+void KernelCells::remove(const std::vector<double>& center, unsigned index, bool shift) {
+  const auto it=cells.find(getCell(center));
+  plumed_massert(it!=cells.end(),"kernel is not in its cell");
+  std::vector<unsigned>& c(it->second);
+  const auto pos=std::find(c.begin(),c.end(),index);
+  plumed_massert(pos!=c.end(),"kernel is not in its cell");
+  c.erase(pos);
+  if(c.empty()) cells.erase(it);
+  if(!shift) return;
+  for(auto & cc : cells) for(auto & k : cc.second) if(k>index) k--;
+}
+
+void KernelCells::getCandidates(const std::vector<double>& x, double radius, std::vector<unsigned>& out) const {
+  out.clear();
+  if(cells.empty()) return;
+  const unsigned ncv=x.size();
+  const std::vector<int> c=getCell(x);
+  std::vector<int> lo(ncv), hi(ncv);
+  for(unsigned i=0; i<ncv; ++i) {
+    lo[i]=hi[i]=c[i];
+    if(period[i]>0.0 && ncells[i]==0) continue;
+    const int m=static_cast<int>(std::ceil(radius*maxsigma[i]/width[i]));
+    if(period[i]>0.0 && 2*m+1>=ncells[i]) { lo[i]=0; hi[i]=ncells[i]-1; }
+    else { lo[i]=c[i]-m; hi[i]=c[i]+m; }
+  }
+  std::vector<int> cur(lo), key(ncv);
+  while(true) {
+    for(unsigned i=0; i<ncv; ++i) key[i]=(period[i]>0.0 && ncells[i]>0) ? (cur[i]%ncells[i]+ncells[i])%ncells[i] : cur[i];
+    const auto it=cells.find(key);
+    if(it!=cells.end()) out.insert(out.end(),it->second.begin(),it->second.end());
+    unsigned i=0;
+    for(; i<ncv; ++i) { if(cur[i]<hi[i]) { cur[i]++; break; } cur[i]=lo[i]; }
+    if(i==ncv) break;
+  }
+  std::sort(out.begin(),out.end());
+}
+
+}
@@ -0,0 +1,67 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_KernelCells_h
+#define __PLUMED_tools_KernelCells_h
+
+#include <map>
+#include <vector>
+
+namespace PLMD {
+
+/**
+A sparse grid of cells in CV space that contains the indices of a set of kernels.
+
+Every kernel is stored in the cell that contains its center. The cells are as wide as
+cutoff times the largest width of the kernels along each CV, so that the kernels that can
+be closer than this cutoff (in units of their width) to a point are all in the cells that
+surround the cell of the point. Periodic CVs wrap around the cells of a period, or are not
+split at all when the period contains less than three cells.
+
+When a kernel wider than all the previous ones is added updateWidths returns true:
+the cells have then been emptied and all the kernels should be added again.
+*/
+class KernelCells {
+  std::vector<double> min, period, width, maxsigma;
+/// Number of cells in a period, zero for non periodic CVs and for periods that are not split
+  std::vector<int> ncells;
+  double cutoff=0.0;
+  std::map<std::vector<int>,std::vector<unsigned> > cells;
+  void setWidths();
+public:
+/// Set the domain of the CVs, period is zero for non periodic ones, and the cutoff in units of the kernel widths
+  void setup(const std::vector<double>& min, const std::vector<double>& period, double cutoff);
+/// Enlarge the cells if the widths of a new kernel require it, returns true if the cells have been emptied
+  bool updateWidths(const std::vector<double>& sigma);
+/// Get the cell that contains a point
+  std::vector<int> getCell(const std::vector<double>& x) const;
+  void add(const std::vector<double>& center, unsigned index);
+/// Remove a kernel, if shift is true the larger indices are decreased by one as after erasing from a vector
+  void remove(const std::vector<double>& center, unsigned index, bool shift=false);
+  void clear() { cells.clear(); }
+/// Get the indices of the kernels with centers closer than radius times their largest width to x in all directions, sorted
+  void getCandidates(const std::vector<double>& x, double radius, std::vector<unsigned>& out) const;
+  const std::vector<double>& getWidths() const { return width; }
+};
+
+}
+
+#endif
@@ -63,6 +63,12 @@ public:
   std::vector<double> getCenter() const;
 /// Get the support
   std::vector<unsigned> getSupport( const std::vector<double>& dx ) const;
+/// Check if the kernel is a product of one dimensional gaussians, see getWidth and getHeight
+  bool isSeparable() const { return dtype==diagonal && (ktype==gaussian || ktype==truncatedgaussian); }
+/// Get the widths, they are the standard deviations along each dimension when the metric is diagonal
+  const std::vector<double>& getWidth() const { return width; }
+/// Get the height
+  double getHeight() const { return height; }
 /// get it in continuous form
   std::vector<double> getContinuousSupport( ) const;
 /// Evaluate the kernel function with constant intervals
@@ -21,9 +21,138 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "LeptonCall.h"
 #include "OpenMP.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
 
 namespace PLMD {
 
+namespace {
+/// True for the operations that cost more than a few arithmetic instructions
+bool isExpensive( const lepton::Operation& op ) {
+  switch( op.getId() ) {
+  case lepton::Operation::CONSTANT:
+  case lepton::Operation::VARIABLE:
+  case lepton::Operation::ADD:
+  case lepton::Operation::SUBTRACT:
+  case lepton::Operation::MULTIPLY:
+  case lepton::Operation::DIVIDE:
+  case lepton::Operation::NEGATE:
+  case lepton::Operation::SQUARE:
+  case lepton::Operation::CUBE:
+  case lepton::Operation::RECIPROCAL:
+  case lepton::Operation::ADD_CONSTANT:
+  case lepton::Operation::MULTIPLY_CONSTANT:
+  case lepton::Operation::MIN:
+  case lepton::Operation::MAX:
+  case lepton::Operation::ABS:
+  case lepton::Operation::STEP:
+  case lepton::Operation::DELTA:
+  case lepton::Operation::NANDELTA:
+  case lepton::Operation::FLOOR:
+  case lepton::Operation::CEIL:
+  case lepton::Operation::SELECT:
+    return false;
+  default:
+    return true;
+  }
+}
+
+unsigned countExpensive( const lepton::ExpressionTreeNode& node, std::vector<const lepton::ExpressionTreeNode*>& seen ) {
+  for(const auto s : seen) if( *s==node ) return 0;
+  seen.push_back(&node);
+  unsigned n=isExpensive( node.getOperation() ) ? 1 : 0;
+  for(const auto & c : node.getChildren()) n+=countExpensive( c, seen );
+  return n;
+}
+}
+
+unsigned LeptonGradient::countExpensiveOperations( const lepton::ExpressionTreeNode& node ) {
+  std::vector<const lepton::ExpressionTreeNode*> seen;
+  return countExpensive( node, seen );
+}
+
+int LeptonGradient::compile( const lepton::ExpressionTreeNode& node, std::vector<std::pair<lepton::ExpressionTreeNode,int> >& temps, const std::vector<std::string>& var ) {
+  // identical subexpressions are only computed once
+  for(const auto & t : temps) if( t.first==node ) return t.second;
+  std::vector<int> args;
+  for(const auto & c : node.getChildren()) args.push_back( compile( c, temps, var ) );
+  const int index=initial.size(); initial.push_back(0.0);
+  const lepton::Operation& op( node.getOperation() );
+  if( op.getId()==lepton::Operation::VARIABLE ) {
+    auto found=std::find( var.begin(), var.end(), op.getName() );
+    if( found!=var.end() ) variables[found-var.begin()]=index;
+  } else if( op.getId()==lepton::Operation::CONSTANT ) {
+    initial[index]=dynamic_cast<const lepton::Operation::Constant&>(op).getValue();
+  } else {
+    Step s; s.operation.reset( op.clone() ); s.target=index; s.sequential=true;
+    for(unsigned i=1; i<args.size(); ++i) if( args[i]!=args[i-1]+1 ) s.sequential=false;
+    s.arguments=args; if( s.arguments.empty() ) s.arguments.push_back(0);
+    if( isExpensive( op ) ) nexpensive++;
+    steps.push_back( std::move(s) );
+  }
+  temps.emplace_back( node, index );
+  return index;
+}
+
+void LeptonGradient::build( const lepton::ParsedExpression& function, const std::vector<lepton::ParsedExpression>& derivatives, const std::vector<std::string>& var ) {
+  steps.clear(); initial.clear(); outputs.clear(); nexpensive=0;
+  variables.assign( var.size(), -1 );
+  std::vector<std::pair<lepton::ExpressionTreeNode,int> > temps;
+  outputs.push_back( compile( function.getRootNode(), temps, var ) );
+  for(const auto & d : derivatives) outputs.push_back( compile( d.getRootNode(), temps, var ) );
+  // variables that do not appear anywhere still need somewhere to be written
+  for(auto & v : variables) if( v<0 ) { v=initial.size(); initial.push_back(0.0); }
+  std::size_t maxargs=0;
+  for(const auto & s : steps) maxargs=std::max( maxargs, s.arguments.size() );
+  gather=initial.size(); initial.resize( initial.size()+maxargs, 0.0 );
+}
+
+double LeptonGradient::evaluate( double* workspace, double* derivs ) const {
+  static const std::map<std::string,double> dummyVariables;
+  for(const auto & s : steps) {
+    double* a=workspace+s.arguments[0];
+    if( !s.sequential ) {
+      a=workspace+gather;
+      for(unsigned i=0; i<s.arguments.size(); ++i) a[i]=workspace[s.arguments[i]];
+    }
+    workspace[s.target]=s.operation->evaluate( a, dummyVariables );
+  }
+  for(unsigned j=1; j<outputs.size(); ++j) derivs[j-1]=workspace[outputs[j]];
+  return workspace[outputs[0]];
+}
+
+std::shared_ptr<const CompiledLepton> getCompiledLepton( const std::string & func, const std::vector<std::string>& var ) {
+  static std::mutex mtx;
+  static std::map<std::string,std::shared_ptr<const CompiledLepton>> cache;
+  // blanks are not relevant in the expression
+  std::string key;
+  for(const auto c : func) if( c!=' ' && c!='\t' ) key+=c;
+  for(const auto & v : var) key+="|"+v;
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto found=cache.find(key);
+    if( found!=cache.end() ) return found->second;
+  }
+  auto entry=std::make_shared<CompiledLepton>();
+  entry->function=lepton::Parser::parse(func).optimize(lepton::Constants());
+  entry->compiled=entry->function.createCompiledExpression();
+  for(const auto & v : var) {
+    entry->derivatives.push_back( lepton::Parser::parse(func).differentiate(v).optimize(lepton::Constants()) );
+    entry->compiled_derivatives.push_back( entry->derivatives.back().createCompiledExpression() );
+  }
+  entry->gradient.build( entry->function, entry->derivatives, var );
+  // The gradient program is interpreted, so when the expressions are compiled with asmjit
+  // it is only used if it saves some of the expensive operations
+  unsigned separate=LeptonGradient::countExpensiveOperations( entry->function.getRootNode() );
+  for(const auto & d : entry->derivatives) separate+=LeptonGradient::countExpensiveOperations( d.getRootNode() );
+  entry->use_gradient=( !lepton::useAsmJit() || entry->gradient.getNumberOfExpensiveOperations()<separate );
+  std::lock_guard<std::mutex> lock(mtx);
+  auto & cached=cache[key];
+  if( !cached ) cached=entry;
+  return cached;
+}
+
 void LeptonCall::set(const std::string & func, const std::vector<std::string>& var, Action* action, const bool& a ) {
   unsigned nth=OpenMP::getNumThreads(); expression.resize(nth); expression_deriv.resize(var.size());
   // Resize the expression for the derivatives
@@ -31,10 +160,12 @@ void LeptonCall::set(const std::string & func, const std::vector<std::string>& v
   allow_extra_args=a; nargs=var.size();
 
   lepton_ref.resize(nth*nargs,nullptr);
-  lepton::ParsedExpression pe=lepton::Parser::parse(func).optimize(lepton::Constants()); unsigned nt=0;
+  compiled=getCompiledLepton( func, var );
+  gradient_workspace.assign( nth, compiled->gradient.getInitialWorkspace() );
+  const lepton::ParsedExpression& pe( compiled->function ); unsigned nt=0;
   if( action ) action->log<<"  function as parsed by lepton: "<<pe<<"\n";
   for(auto & e : expression) {
-    e=pe.createCompiledExpression();
+    e=compiled->compiled;
     for(unsigned j=0; j<var.size(); ++j) {
       try {
         lepton_ref[nt*var.size()+j]=&const_cast<lepton::CompiledExpression*>(&expression[nt])->getVariableReference(var[j]);
@@ -54,9 +185,9 @@ void LeptonCall::set(const std::string & func, const std::vector<std::string>& v
   if( action ) action->log<<"  derivatives as computed by lepton:\n";
   lepton_ref_deriv.resize(nth*nargs*nargs,nullptr);
   for(unsigned i=0; i<var.size(); i++) {
-    lepton::ParsedExpression pe=lepton::Parser::parse(func).differentiate(var[i]).optimize(lepton::Constants()); nt=0; if( action ) action->log<<"    "<<pe<<"\n";
+    const lepton::ParsedExpression& pe( compiled->derivatives[i] ); nt=0; if( action ) action->log<<"    "<<pe<<"\n";
     for(auto & e : expression_deriv[i]) {
-      e=pe.createCompiledExpression();
+      e=compiled->compiled_derivatives[i];
       for(unsigned j=0; j<var.size(); ++j) {
         try {
           lepton_ref_deriv[i*OpenMP::getNumThreads()*var.size() + nt*var.size()+j]=&const_cast<lepton::CompiledExpression*>(&expression_deriv[i][nt])->getVariableReference(var[j]);
@@ -68,6 +199,7 @@ void LeptonCall::set(const std::string & func, const std::vector<std::string>& v
       nt++;
     }
   }
+  if( action && compiled->use_gradient ) action->log.printf("  value and derivatives are computed together in %zu operations\n", compiled->gradient.getNumberOfSteps() );
 }
 
 double LeptonCall::evaluate( const std::vector<double>& args ) const {
@@ -79,6 +211,34 @@ double LeptonCall::evaluate( const std::vector<double>& args ) const {
   return expression[t].evaluate();
 }
 
+void LeptonCall::evaluateBlock( std::size_t npoints, const double* const* args, const std::size_t* strides, double* values, double* derivs ) const {
+  const unsigned t=OpenMP::getThreadNum(), nt=OpenMP::getNumThreads();
+  double* const* ref=lepton_ref.data()+t*nargs;
+  if( derivs && compiled->use_gradient ) {
+    double* w=gradient_workspace[t].data();
+    for(std::size_t k=0; k<npoints; ++k) {
+      for(unsigned i=0; i<nargs; ++i) compiled->gradient.setVariable( w, i, args[i][k*strides[i]] );
+      values[k] = compiled->gradient.evaluate( w, derivs+k*nargs );
+    }
+    return;
+  }
+  const lepton::CompiledExpression& expr( expression[t] );
+  for(std::size_t k=0; k<npoints; ++k) {
+    for(unsigned i=0; i<nargs; ++i) if( ref[i] ) *ref[i] = args[i][k*strides[i]];
+    values[k] = expr.evaluate();
+  }
+  if( !derivs ) return;
+  // derivatives are computed one expression at a time so that the same compiled code is reused for the whole block
+  for(unsigned ider=0; ider<nargs; ++ider) {
+    double* const* dref=lepton_ref_deriv.data()+ider*nt*nargs+t*nargs;
+    const lepton::CompiledExpression& dexpr( expression_deriv[ider][t] );
+    for(std::size_t k=0; k<npoints; ++k) {
+      for(unsigned j=0; j<nargs; ++j) if( dref[j] ) *dref[j] = args[j][k*strides[j]];
+      derivs[k*nargs+ider] = dexpr.evaluate();
+    }
+  }
+}
+
 double LeptonCall::evaluateDeriv( const unsigned& ider, const std::vector<double>& args ) const {
   plumed_dbg_assert( allow_extra_args || args.size()==nargs ); plumed_dbg_assert( ider<nargs );
   const unsigned t=OpenMP::getThreadNum(), dbas = ider*OpenMP::getNumThreads()*nargs + t*nargs;
@@ -88,4 +248,15 @@ double LeptonCall::evaluateDeriv( const unsigned& ider, const std::vector<double
   return expression_deriv[ider][t].evaluate();
 }
 
+double LeptonCall::evaluateWithDerivatives( const std::vector<double>& args, double* derivs ) const {
+  if( !compiled->use_gradient ) {
+    for(unsigned i=0; i<nargs; ++i) derivs[i]=evaluateDeriv( i, args );
+    return evaluate( args );
+  }
+  plumed_dbg_assert( allow_extra_args || args.size()==nargs );
+  double* w=gradient_workspace[OpenMP::getThreadNum()].data();
+  for(unsigned i=0; i<nargs; ++i) compiled->gradient.setVariable( w, i, args[i] );
+  return compiled->gradient.evaluate( w, derivs );
+}
+
 }
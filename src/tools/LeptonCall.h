@@ -24,9 +24,67 @@
 
 #include "core/Action.h"
 #include "lepton/Lepton.h"
+#include <memory>
 
 namespace PLMD {
 
+/// The value and all the derivatives of a function as a single list of operations,
+/// so that the subexpressions they have in common (e.g. exp(...) or sqrt(...)) are only computed once.
+/// The program is read-only once built. Each thread evaluates it on its own workspace,
+/// which should be initialized as a copy of getInitialWorkspace()
+class LeptonGradient {
+  struct Step {
+    std::unique_ptr<lepton::Operation> operation;
+    std::vector<int> arguments;
+    bool sequential;
+    int target;
+  };
+  std::vector<Step> steps;
+/// Workspace with the constants already set
+  std::vector<double> initial;
+/// Position of each variable in the workspace
+  std::vector<int> variables;
+/// Position of the value and of each derivative in the workspace
+  std::vector<int> outputs;
+/// Position in the workspace where non-contiguous arguments are copied
+  int gather=0;
+  unsigned nexpensive=0;
+  int compile( const lepton::ExpressionTreeNode& node, std::vector<std::pair<lepton::ExpressionTreeNode,int> >& temps, const std::vector<std::string>& var );
+public:
+/// Build the program from the function and from its derivatives with respect to each of the variables
+  void build( const lepton::ParsedExpression& function, const std::vector<lepton::ParsedExpression>& derivatives, const std::vector<std::string>& var );
+/// Count the operations that are more expensive than arithmetic, after removing the subexpressions that are repeated in node
+  static unsigned countExpensiveOperations( const lepton::ExpressionTreeNode& node );
+/// Number of operations that are more expensive than arithmetic in the whole program
+  unsigned getNumberOfExpensiveOperations() const { return nexpensive; }
+/// Number of operations in the whole program
+  std::size_t getNumberOfSteps() const { return steps.size(); }
+  const std::vector<double>& getInitialWorkspace() const { return initial; }
+/// Set the value of the j-th variable
+  void setVariable( double* workspace, unsigned j, double value ) const {
+    workspace[variables[j]]=value;
+  }
+/// Evaluate the program. Returns the value and stores the derivatives in derivs
+  double evaluate( double* workspace, double* derivs ) const ;
+};
+
+/// Parsed and compiled forms of a function and of its derivatives with respect to a list of variables
+struct CompiledLepton {
+  lepton::ParsedExpression function;
+  lepton::CompiledExpression compiled;
+  std::vector<lepton::ParsedExpression> derivatives;
+  std::vector<lepton::CompiledExpression> compiled_derivatives;
+/// Value and derivatives evaluated together
+  LeptonGradient gradient;
+/// True if evaluating the gradient program is expected to be cheaper than evaluating the compiled expressions one at a time
+  bool use_gradient=false;
+};
+
+/// Get the parsed and compiled expressions for a function, building them only the first time
+/// the same function (blanks are ignored) is used with the same variables in this process.
+/// Users should keep copies of the compiled expressions, since they store the values of the variables
+std::shared_ptr<const CompiledLepton> getCompiledLepton( const std::string & func, const std::vector<std::string>& var );
+
 /// \ingroup TOOLBOX
 class LeptonCall {
 private:
@@ -40,11 +98,26 @@ private:
   std::vector<std::vector<lepton::CompiledExpression> > expression_deriv;
   std::vector<double*> lepton_ref;
   std::vector<double*> lepton_ref_deriv;
+/// Program for the value and the derivatives together, shared with all the other users of the same function
+  std::shared_ptr<const CompiledLepton> compiled;
+/// Workspace for the gradient program
+/// \warning A vector is necessary for multithreading!
+  mutable std::vector<std::vector<double> > gradient_workspace;
 public:
   void set(const std::string & func, const std::vector<std::string>& var, Action* action=NULL, const bool& a=false );
   unsigned getNumberOfArguments() const ;
   double evaluate( const std::vector<double>& args ) const ;
   double evaluateDeriv( const unsigned& ider, const std::vector<double>& args ) const ;
+/// Evaluate the function and store its derivative with respect to the j-th argument in derivs[j].
+/// The subexpressions that the value and the derivatives have in common are computed once
+  double evaluateWithDerivatives( const std::vector<double>& args, double* derivs ) const ;
+/// Evaluate the function on a block of npoints points.
+/// args[j] points to the values of the j-th argument, that are read with stride strides[j]
+/// (a stride of zero can be used for arguments that are the same for all the points).
+/// The values are stored in values and, if derivs is not NULL, the derivative with
+/// respect to the j-th argument at point k in derivs[k*nargs+j].
+/// The variable references are resolved once for the whole block.
+  void evaluateBlock( std::size_t npoints, const double* const* args, const std::size_t* strides, double* values, double* derivs ) const ;
 };
 
 inline
@@ -22,6 +22,8 @@
 #include "LinkCells.h"
 #include "Communicator.h"
 #include "Tools.h"
+#include <algorithm>
+#include <cstdint>
 
 namespace PLMD {
 
@@ -30,10 +32,37 @@ LinkCells::LinkCells( Communicator& cc ) :
   cutoffwasset(false),
   link_cutoff(0.0),
   ncells(3),
-  nstride(3)
+  nstride(3),
+  morton(false),
+  cell_order_ncells({0,0,0})
 {
 }
 
+void LinkCells::setMortonOrdering( const bool& order ) {
+  morton=order;
+}
+
+void LinkCells::setupCellOrder() {
+  if( cell_order.size()==getNumberOfCells() && cell_order_ncells[0]==ncells[0] &&
+      cell_order_ncells[1]==ncells[1] && cell_order_ncells[2]==ncells[2] ) return;
+  for(unsigned j=0; j<3; ++j) cell_order_ncells[j]=ncells[j];
+  // Interleave the bits of the three cell indices to get the position of each cell on the Morton curve
+  std::vector<std::pair<uint64_t,unsigned> > codes( getNumberOfCells() );
+  for(unsigned nx=0; nx<ncells[0]; ++nx) for(unsigned ny=0; ny<ncells[1]; ++ny) for(unsigned nz=0; nz<ncells[2]; ++nz) {
+        uint64_t code=0;
+        for(unsigned b=0; b<21; ++b) {
+          code |= ( (uint64_t(nx)>>b)&1 ) << (3*b);
+          code |= ( (uint64_t(ny)>>b)&1 ) << (3*b+1);
+          code |= ( (uint64_t(nz)>>b)&1 ) << (3*b+2);
+        }
+        unsigned ind=convertIndicesToIndex( nx, ny, nz );
+        codes[ind]=std::pair<uint64_t,unsigned>( code, ind );
+      }
+  std::sort( codes.begin(), codes.end() );
+  cell_order.resize( codes.size() );
+  for(unsigned i=0; i<codes.size(); ++i) cell_order[i]=codes[i].second;
+}
+
 void LinkCells::setCutoff( const double& lcut ) {
   cutoffwasset=true; link_cutoff=lcut;
 }
@@ -52,7 +81,7 @@ void LinkCells::buildCellLists( const std::vector<Vector>& pos, const std::vecto
 
   // Setup the lists
   if( pos.size()!=allcells.size() ) {
-    allcells.resize( pos.size() ); lcell_lists.resize( pos.size() );
+    allcells.resize( pos.size() ); lcell_lists.resize( pos.size() ); lcell_pos.resize( pos.size() );
   }
 
   {
@@ -90,14 +119,18 @@ void LinkCells::buildCellLists( const std::vector<Vector>& pos, const std::vecto
   comm.Sum( allcells ); comm.Sum( lcell_tots );
 
   // Now prepare the link cell lists
+  if( morton ) setupCellOrder();
   unsigned tot=0;
-  for(unsigned i=0; i<lcell_tots.size(); ++i) { lcell_starts[i]=tot; tot+=lcell_tots[i]; lcell_tots[i]=0; }
+  for(unsigned k=0; k<lcell_tots.size(); ++k) {
+    unsigned i = morton ? cell_order[k] : k;
+    lcell_starts[i]=tot; tot+=lcell_tots[i]; lcell_tots[i]=0;
+  }
   plumed_assert( tot==pos.size() );
 
   // And setup the link cells properly
   for(unsigned j=0; j<pos.size(); ++j) {
     unsigned myind = lcell_starts[ allcells[j] ] + lcell_tots[ allcells[j] ];
-    lcell_lists[ myind ] = indices[j];
+    lcell_lists[ myind ] = indices[j]; lcell_pos[ myind ] = pos[j];
     lcell_tots[allcells[j]]++;
   }
 }
@@ -152,6 +185,22 @@ void LinkCells::retrieveAtomsInCells( const unsigned& ncells_required,
   }
 }
 
+void LinkCells::retrieveAtomsInCells( const unsigned& ncells_required,
+                                      const std::vector<unsigned>& cells_required,
+                                      unsigned& natomsper, std::vector<unsigned>& atoms,
+                                      std::vector<Vector>& positions ) const {
+  for(unsigned i=0; i<ncells_required; ++i) {
+    unsigned mybox=cells_required[i], start=lcell_starts[mybox];
+    for(unsigned k=0; k<lcell_tots[mybox]; ++k) {
+      unsigned myatom = lcell_lists[start+k];
+      if( myatom!=atoms[0] ) {
+        atoms[natomsper]=myatom; positions[natomsper]=lcell_pos[start+k];
+        natomsper++;
+      }
+    }
+  }
+}
+
 std::array<unsigned,3> LinkCells::findMyCell( const Vector& pos ) const {
   Vector fpos=mypbc.realToScaled( pos );
   std::array<unsigned,3> celn;
@@ -23,6 +23,7 @@
 #define __PLUMED_tools_LinkCells_h
 
 #include <vector>
+#include <array>
 #include "Vector.h"
 #include "Pbc.h"
 
@@ -54,6 +55,16 @@ private:
   std::vector<unsigned> lcell_tots;
 /// The atoms ordered by link cells
   std::vector<unsigned> lcell_lists;
+/// The positions of the atoms in the same order as lcell_lists
+  std::vector<Vector> lcell_pos;
+/// Are the cells stored in the order of a Morton (Z-order) curve
+  bool morton;
+/// The order in which the cells are stored in lcell_lists
+  std::vector<unsigned> cell_order;
+/// The number of cells in each direction when cell_order was computed
+  std::array<unsigned,3> cell_order_ncells;
+/// Setup the order in which the cells are stored
+  void setupCellOrder();
 public:
 ///
   explicit LinkCells( Communicator& comm );
@@ -63,6 +74,8 @@ public:
   void setCutoff( const double& lcut );
 /// Get the value of the cutoff
   double getCutoff() const ;
+/// Store the cells along a Morton curve so that atoms in neighboring cells are close in memory
+  void setMortonOrdering( const bool& order );
 /// Get the total number of link cells
   unsigned getNumberOfCells() const ;
 /// Get the nuumber of atoms in the cell that contains the most atoms
@@ -82,6 +95,11 @@ public:
   void retrieveAtomsInCells( const unsigned& ncells_required,
                              const std::vector<unsigned>& cells_required,
                              unsigned& natomsper, std::vector<unsigned>& atoms ) const ;
+/// Retrieve the atoms in a list of cells together with their positions, which are read from the cell-sorted copy
+  void retrieveAtomsInCells( const unsigned& ncells_required,
+                             const std::vector<unsigned>& cells_required,
+                             unsigned& natomsper, std::vector<unsigned>& atoms,
+                             std::vector<Vector>& positions ) const ;
 /// Retrieve the atoms we need to consider
   void retrieveNeighboringAtoms( const Vector& pos, std::vector<unsigned>& cell_list, unsigned& natomsper, std::vector<unsigned>& atoms ) const ;
 };
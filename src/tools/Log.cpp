@@ -20,4 +20,21 @@
    along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "Log.h"
+#include "Tools.h"
+#include <cstdlib>
+
+namespace PLMD {
+
+Log::Log() {
+  const char* size=std::getenv("PLUMED_LOG_BUFFER");
+  if(!size) return;
+  std::size_t bytes=0;
+  plumed_massert(Tools::convertNoexcept(size,bytes),"cannot parse PLUMED_LOG_BUFFER=" + std::string(size));
+  double interval=0.0;
+  const char* seconds=std::getenv("PLUMED_LOG_FLUSH_INTERVAL");
+  if(seconds) plumed_massert(Tools::convertNoexcept(seconds,interval),"cannot parse PLUMED_LOG_FLUSH_INTERVAL=" + std::string(seconds));
+  setBuffered(bytes,interval);
+}
+
+}
 
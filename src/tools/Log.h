@@ -31,10 +31,18 @@ namespace PLMD {
 /// It is similar to a FILE stream. It allows a printf() function, and
 /// also to write with a << operator. Moreover, it can prefix
 /// lines with the "PLUMED:" prefix, useful to grep out plumed
-/// log from output
+/// log from output.
+///
+/// If the environment variable PLUMED_LOG_BUFFER is set to a number of bytes,
+/// the log is kept in memory and written when this size is exceeded or,
+/// if PLUMED_LOG_FLUSH_INTERVAL is set, when it is older than the given number of seconds.
+/// In any case, the log is written when explicitly flushed, which is done
+/// periodically by PlumedMain and when an exception is caught.
 class Log :
   public OFile
 {
+public:
+  Log();
 };
 
 }
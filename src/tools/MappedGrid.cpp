@@ -0,0 +1,418 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "MappedGrid.h"
+#include "Exception.h"
+#include "File.h"
+#include "Tools.h"
+#include "core/Value.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#ifdef __PLUMED_HAS_ZLIB
+#include <zlib.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define __PLUMED_MAPPEDGRID_POSIX 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace PLMD {
+
+static const char mappedGridMagic[8]= {'P','L','M','D','G','R','I','D'};
+static constexpr std::uint64_t mappedGridVersion=2;
+/// The data start at a multiple of this, so that they are aligned to a page
+static constexpr std::uint64_t mappedGridAlignment=4096;
+/// Number of doubles in each compressed block
+static constexpr std::size_t mappedGridBlock=65536;
+
+static void writeUint(std::FILE* fp, std::uint64_t n) {
+  std::fwrite(&n,sizeof(n),1,fp);
+}
+
+static void writeString(std::FILE* fp, const std::string& s) {
+  writeUint(fp,s.length());
+  std::fwrite(s.data(),1,s.length(),fp);
+}
+
+static std::uint64_t readUint(std::FILE* fp, const std::string& fname) {
+  std::uint64_t n;
+  if(std::fread(&n,sizeof(n),1,fp)!=1) plumed_error()<<"truncated header in binary grid file "<<fname;
+  return n;
+}
+
+static std::string readString(std::FILE* fp, const std::string& fname) {
+  const std::uint64_t n=readUint(fp,fname);
+  std::string s(n,' ');
+  if(n>0 && std::fread(&s[0],1,n,fp)!=n) plumed_error()<<"truncated header in binary grid file "<<fname;
+  return s;
+}
+
+bool MappedGrid::isBinary(const std::string& fname) {
+  std::FILE* fp=std::fopen(fname.c_str(),"rb");
+  if(!fp) return false;
+  char magic[8];
+  const bool ok=(std::fread(magic,1,8,fp)==8 && std::memcmp(magic,mappedGridMagic,8)==0);
+  std::fclose(fp);
+  return ok;
+}
+
+static void writeData(std::FILE* fp, const std::vector<double>& buffer, bool compress, const std::string& fname) {
+  if(!compress) {
+    std::fwrite(buffer.data(),sizeof(double),buffer.size(),fp);
+    return;
+  }
+#ifdef __PLUMED_HAS_ZLIB
+  // each block is preceded by its compressed size, so that blocks can be inflated one at a time
+  std::vector<Bytef> cbuf(compressBound(mappedGridBlock*sizeof(double)));
+  for(std::size_t start=0; start<buffer.size(); start+=mappedGridBlock) {
+    const std::size_t n=std::min(mappedGridBlock,buffer.size()-start);
+    uLongf csize=cbuf.size();
+    plumed_assert(compress2(cbuf.data(),&csize,reinterpret_cast<const Bytef*>(buffer.data()+start),n*sizeof(double),Z_DEFAULT_COMPRESSION)==Z_OK)<<"error while compressing binary grid file "<<fname;
+    writeUint(fp,csize);
+    std::fwrite(cbuf.data(),1,csize,fp);
+  }
+#else
+  plumed_error()<<"cannot write compressed binary grid file "<<fname<<" without zlib being linked";
+#endif
+}
+
+static void readCompressedData(std::FILE* fp, double* data, std::size_t ndata, const std::string& fname) {
+#ifdef __PLUMED_HAS_ZLIB
+  std::vector<Bytef> cbuf;
+  for(std::size_t start=0; start<ndata; start+=mappedGridBlock) {
+    const std::size_t n=std::min(mappedGridBlock,ndata-start);
+    const std::uint64_t csize=readUint(fp,fname);
+    cbuf.resize(csize);
+    if(std::fread(cbuf.data(),1,csize,fp)!=csize) plumed_error()<<"binary grid file "<<fname<<" is shorter than expected";
+    uLongf size=n*sizeof(double);
+    if(uncompress(reinterpret_cast<Bytef*>(data+start),&size,cbuf.data(),csize)!=Z_OK || size!=n*sizeof(double)) plumed_error()<<"corrupted data in compressed binary grid file "<<fname;
+  }
+#else
+  (void) fp; (void) data; (void) ndata;
+  plumed_error()<<"cannot read compressed binary grid file "<<fname<<" without zlib being linked";
+#endif
+}
+
+void MappedGrid::write(const std::string& fname, const GridBase& grid, bool withder, bool compress) {
+  const unsigned dim=grid.getDimension();
+  const std::vector<std::string> names(grid.getArgNames()), gmin(grid.getMin()), gmax(grid.getMax());
+  const std::vector<bool> periodic(grid.getIsPeriodic());
+  const std::vector<unsigned> nbin(grid.getNbin());
+  index_t size=1;
+  for(unsigned i=0; i<dim; ++i) size*=nbin[i];
+#ifdef __PLUMED_MAPPEDGRID_POSIX
+  const std::string tmpname=fname+".tmp."+std::to_string(getpid());
+#else
+  const std::string tmpname=fname;
+#endif
+  std::FILE* fp=std::fopen(tmpname.c_str(),"wb");
+  plumed_assert(fp)<<"cannot open binary grid file "<<tmpname<<" for writing";
+  std::fwrite(mappedGridMagic,1,8,fp);
+  writeUint(fp,mappedGridVersion);
+  writeUint(fp,dim);
+  withder=withder && grid.hasDerivatives();
+  writeUint(fp,withder);
+  writeUint(fp,compress);
+  writeString(fp,grid.getFuncName());
+  for(unsigned i=0; i<dim; ++i) {
+    writeString(fp,names[i]);
+    writeString(fp,gmin[i]);
+    writeString(fp,gmax[i]);
+    writeUint(fp,periodic[i]);
+    // the number of bins as given in input, that is without the extra point of non periodic grids
+    writeUint(fp,periodic[i] ? nbin[i] : nbin[i]-1);
+  }
+  // position of the data, written last in the header
+  const std::uint64_t offset=((std::ftell(fp)+sizeof(std::uint64_t)+mappedGridAlignment-1)/mappedGridAlignment)*mappedGridAlignment;
+  writeUint(fp,offset);
+  std::vector<char> pad(offset-std::ftell(fp),0);
+  std::fwrite(pad.data(),1,pad.size(),fp);
+  std::vector<double> buffer;
+  buffer.reserve(size);
+  for(index_t i=0; i<size; ++i) buffer.push_back(grid.getValue(i));
+  writeData(fp,buffer,compress,tmpname);
+  if(withder) {
+    std::vector<double> der(dim);
+    buffer.clear();
+    for(index_t i=0; i<size; ++i) {
+      grid.getValueAndDerivatives(i,der);
+      buffer.insert(buffer.end(),der.begin(),der.end());
+    }
+    writeData(fp,buffer,compress,tmpname);
+  }
+  const bool ok=(std::ferror(fp)==0);
+  std::fclose(fp);
+  plumed_assert(ok)<<"error while writing binary grid file "<<tmpname;
+  if(tmpname!=fname) plumed_assert(std::rename(tmpname.c_str(),fname.c_str())==0)<<"cannot rename "<<tmpname<<" to "<<fname;
+}
+
+MappedGrid::Info MappedGrid::readInfo(const std::string& fname) {
+  std::FILE* fp=std::fopen(fname.c_str(),"rb");
+  plumed_assert(fp)<<"cannot open binary grid file "<<fname;
+  Info info;
+  try {
+    char magic[8];
+    if(std::fread(magic,1,8,fp)!=8 || std::memcmp(magic,mappedGridMagic,8)!=0) plumed_error()<<fname<<" is not a binary grid file";
+    const std::uint64_t version=readUint(fp,fname);
+    if(version==0 || version>mappedGridVersion) plumed_error()<<"unsupported version "<<version<<" of binary grid file "<<fname;
+    const std::uint64_t dim=readUint(fp,fname);
+    info.hasder=readUint(fp,fname);
+    // version 1 files are never compressed
+    if(version>1) info.compressed=readUint(fp,fname);
+    info.funcname=readString(fp,fname);
+    for(unsigned i=0; i<dim; ++i) {
+      info.names.push_back(readString(fp,fname));
+      info.gmin.push_back(readString(fp,fname));
+      info.gmax.push_back(readString(fp,fname));
+      info.periodic.push_back(readUint(fp,fname));
+      info.nbin.push_back(readUint(fp,fname));
+    }
+    info.offset=readUint(fp,fname);
+  } catch(...) {
+    std::fclose(fp);
+    throw;
+  }
+  std::fclose(fp);
+  return info;
+}
+
+MappedGrid::MappedGrid(const std::string& fname, bool dospline):
+  MappedGrid(fname,readInfo(fname),dospline)
+{
+}
+
+MappedGrid::MappedGrid(const std::string& fname, const Info& info, bool dospline):
+  GridBase(info.funcname,info.names,info.gmin,info.gmax,info.nbin,dospline,info.hasder,info.periodic,info.gmin,info.gmax),
+  fname(fname)
+{
+  plumed_assert(!dospline || info.hasder)<<"spline interpolation requires the derivatives, which are missing from binary grid file "<<fname;
+  const std::size_t ndata=maxsize_*(info.hasder ? 1+dimension_ : 1);
+  if(info.compressed) {
+    // compressed data cannot be mapped and are inflated in memory
+    std::FILE* fp=std::fopen(fname.c_str(),"rb");
+    plumed_assert(fp)<<"cannot open binary grid file "<<fname;
+    data_.resize(ndata);
+    try {
+      if(std::fseek(fp,info.offset,SEEK_SET)!=0) plumed_error()<<"binary grid file "<<fname<<" is shorter than expected";
+      // values and derivatives are compressed separately
+      readCompressedData(fp,data_.data(),maxsize_,fname);
+      if(info.hasder) readCompressedData(fp,data_.data()+maxsize_,ndata-maxsize_,fname);
+    } catch(...) {
+      std::fclose(fp);
+      throw;
+    }
+    std::fclose(fp);
+    grid_=data_.data();
+  } else {
+    mapsize=info.offset+ndata*sizeof(double);
+#ifdef __PLUMED_MAPPEDGRID_POSIX
+    const int fd=::open(fname.c_str(),O_RDONLY);
+    plumed_assert(fd>=0)<<"cannot open binary grid file "<<fname;
+    struct stat st;
+    if(fstat(fd,&st)!=0 || static_cast<std::size_t>(st.st_size)<mapsize) {
+      ::close(fd);
+      plumed_error()<<"binary grid file "<<fname<<" is shorter than expected";
+    }
+    map=mmap(nullptr,mapsize,PROT_READ,MAP_SHARED,fd,0);
+    ::close(fd);
+    if(map==MAP_FAILED) {
+      map=nullptr;
+      plumed_error()<<"cannot map binary grid file "<<fname;
+    }
+    grid_=reinterpret_cast<const double*>(static_cast<const char*>(map)+info.offset);
+#else
+    std::FILE* fp=std::fopen(fname.c_str(),"rb");
+    plumed_assert(fp)<<"cannot open binary grid file "<<fname;
+    data_.resize(ndata);
+    const bool ok=(std::fseek(fp,info.offset,SEEK_SET)==0 && std::fread(data_.data(),sizeof(double),ndata,fp)==ndata);
+    std::fclose(fp);
+    plumed_assert(ok)<<"binary grid file "<<fname<<" is shorter than expected";
+    grid_=data_.data();
+#endif
+  }
+  if(info.hasder) der_=grid_+maxsize_;
+}
+
+std::unique_ptr<Grid> MappedGrid::load(const std::string& fname) {
+  const MappedGrid mapped(fname,false);
+  const std::vector<bool> periodic(mapped.getIsPeriodic());
+  std::vector<unsigned> nbin(mapped.getNbin());
+  for(unsigned i=0; i<nbin.size(); ++i) if(!periodic[i]) nbin[i]--;
+  auto grid=Tools::make_unique<Grid>(mapped.getFuncName(),mapped.getArgNames(),mapped.getMin(),mapped.getMax(),nbin,false,
+                                     mapped.hasDerivatives(),periodic,mapped.getMin(),mapped.getMax());
+  std::vector<double> der(mapped.getDimension());
+  for(index_t i=0; i<mapped.getSize(); ++i) {
+    if(mapped.hasDerivatives()) {
+      const double f=mapped.getValueAndDerivatives(i,der);
+      grid->setValueAndDerivatives(i,f,der);
+    } else grid->setValue(i,mapped.getValue(i));
+  }
+  return grid;
+}
+
+std::unique_ptr<GridBase> MappedGrid::load(const std::string& funcl, const std::vector<Value*> & args, const std::string& fname,
+    bool dosparse, bool dospline, bool doder) {
+  const MappedGrid mapped(fname,false);
+  const unsigned nvar=args.size();
+  plumed_massert( mapped.getDimension()==nvar, "mismatch between dimensionality of grid file " + fname + " and number of arguments");
+  plumed_massert( mapped.getFuncName()==funcl, "no function labelled " + funcl + " in grid input " + fname);
+  if( doder && !mapped.hasDerivatives() ) plumed_merror("missing derivatives from grid file " + fname);
+  const std::vector<std::string> names(mapped.getArgNames()), gmin(mapped.getMin()), gmax(mapped.getMax());
+  const std::vector<bool> periodic(mapped.getIsPeriodic());
+  std::vector<unsigned> gbin(mapped.getNbin());
+  for(unsigned i=0; i<nvar; ++i) {
+    std::string label=args[i]->getName();
+    // same handling of old style names for multicolvars as in GridBase::create
+    const std::size_t und=label.find_first_of("_");
+    if( label!=names[i] && und!=std::string::npos ) label=label.substr(0,und) + "." + label.substr(und+1);
+    if( label!=names[i] ) plumed_merror("arguments in input are not in same order as in grid file " + fname);
+    if( args[i]->isPeriodic() ) {
+      plumed_massert( periodic[i], "input value is periodic but grid is not");
+      std::string pmin, pmax;
+      args[i]->getDomain( pmin, pmax );
+      if( pmin!=gmin[i] || pmax!=gmax[i] ) plumed_merror("mismatch between grid boundaries and periods of values");
+    } else {
+      plumed_massert( !periodic[i], "input value is not periodic but grid is");
+      gbin[i]--;
+    }
+  }
+
+  std::unique_ptr<GridBase> grid;
+  if(!dosparse) {grid=Tools::make_unique<Grid>(funcl,args,gmin,gmax,gbin,dospline,doder);}
+  else {grid=Tools::make_unique<SparseGrid>(funcl,args,gmin,gmax,gbin,dospline,doder);}
+
+  std::vector<double> der(nvar);
+  for(index_t i=0; i<mapped.getSize(); ++i) {
+    double f;
+    if(mapped.hasDerivatives()) f=mapped.getValueAndDerivatives(i,der);
+    else f=mapped.getValue(i);
+    if(doder) {
+      // points that are exactly zero need not be stored in a sparse grid
+      if(dosparse && f==0.0 && std::all_of(der.begin(),der.end(),[](double d) {return d==0.0;})) continue;
+      grid->setValueAndDerivatives(i,f,der);
+    } else {
+      if(dosparse && f==0.0) continue;
+      grid->setValue(i,f);
+    }
+  }
+  return grid;
+}
+
+std::unique_ptr<GridBase> MappedGrid::load(const std::string& funcl, const std::vector<Value*> & args, const std::string& fname,
+    const std::vector<std::string> & gmin,const std::vector<std::string> & gmax,
+    const std::vector<unsigned> & nbin,bool dosparse, bool dospline, bool doder) {
+  std::unique_ptr<GridBase> grid=load(funcl,args,fname,dosparse,dospline,doder);
+  std::vector<unsigned> cbin( grid->getNbin() );
+  std::vector<std::string> cmin( grid->getMin() ), cmax( grid->getMax() );
+  for(unsigned i=0; i<args.size(); ++i) {
+    plumed_massert( cmin[i]==gmin[i], "mismatched grid min" );
+    plumed_massert( cmax[i]==gmax[i], "mismatched grid max" );
+    if( args[i]->isPeriodic() ) {
+      plumed_massert( cbin[i]==nbin[i], "mismatched grid nbins" );
+    } else {
+      plumed_massert( (cbin[i]-1)==nbin[i], "mismatched grid nbins");
+    }
+  }
+  return grid;
+}
+
+MappedGrid::~MappedGrid() {
+#ifdef __PLUMED_MAPPEDGRID_POSIX
+  if(map) munmap(map,mapsize);
+#endif
+}
+
+GridBase::index_t MappedGrid::getSize() const {
+  return maxsize_;
+}
+
+double MappedGrid::getValue(index_t index) const {
+  plumed_dbg_assert(index<maxsize_);
+  return grid_[index];
+}
+
+double MappedGrid::getValueAndDerivatives(index_t index, double* der, std::size_t der_size) const {
+  plumed_dbg_assert(index<maxsize_ && usederiv_ && der_size==dimension_);
+  for(unsigned i=0; i<dimension_; i++) der[i]=der_[dimension_*index+i];
+  return grid_[index];
+}
+
+void MappedGrid::setValue(index_t /*index*/, double /*value*/) {
+  plumed_error()<<"grid mapped from "<<fname<<" is read-only";
+}
+
+void MappedGrid::setValueAndDerivatives(index_t /*index*/, double /*value*/, std::vector<double>& /*der*/) {
+  plumed_error()<<"grid mapped from "<<fname<<" is read-only";
+}
+
+void MappedGrid::addValue(index_t /*index*/, double /*value*/) {
+  plumed_error()<<"grid mapped from "<<fname<<" is read-only";
+}
+
+void MappedGrid::addValueAndDerivatives(index_t /*index*/, double /*value*/, std::vector<double>& /*der*/) {
+  plumed_error()<<"grid mapped from "<<fname<<" is read-only";
+}
+
+double MappedGrid::getMinValue() const {
+  double minval=DBL_MAX;
+  for(index_t i=0; i<maxsize_; ++i) if(grid_[i]<minval) minval=grid_[i];
+  return minval;
+}
+
+double MappedGrid::getMaxValue() const {
+  double maxval=-DBL_MAX;
+  for(index_t i=0; i<maxsize_; ++i) if(grid_[i]>maxval) maxval=grid_[i];
+  return maxval;
+}
+
+void MappedGrid::writeToFile(OFile& ofile) {
+  // same format as Grid::writeToFile
+  std::vector<double> xx(dimension_);
+  std::vector<double> der(dimension_);
+  double f;
+  writeHeader(ofile);
+  for(index_t i=0; i<getSize(); ++i) {
+    xx=getPoint(i);
+    if(usederiv_) {f=getValueAndDerivatives(i,der);}
+    else {f=getValue(i);}
+    if(i>0 && dimension_>1 && getIndices(i)[dimension_-2]==0) ofile.printf("\n");
+    for(unsigned j=0; j<dimension_; ++j) {
+      ofile.printField("min_" + argnames[j], str_min_[j] );
+      ofile.printField("max_" + argnames[j], str_max_[j] );
+      ofile.printField("nbins_" + argnames[j], static_cast<int>(nbin_[j]) );
+      if( pbc_[j] ) ofile.printField("periodic_" + argnames[j], "true" );
+      else          ofile.printField("periodic_" + argnames[j], "false" );
+    }
+    for(unsigned j=0; j<dimension_; ++j) { ofile.fmtField(" "+fmt_); ofile.printField(argnames[j],xx[j]); }
+    ofile.fmtField(" "+fmt_); ofile.printField(funcname,f);
+    if(usederiv_) for(unsigned j=0; j<dimension_; ++j) { ofile.fmtField(" "+fmt_); ofile.printField("der_" + argnames[j],der[j]); }
+    ofile.printField();
+  }
+}
+
+}
@@ -0,0 +1,108 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_MappedGrid_h
+#define __PLUMED_tools_MappedGrid_h
+
+#include "Grid.h"
+#include <memory>
+#include <string>
+
+namespace PLMD {
+
+/**
+Read-only grid whose values are memory-mapped from a binary file.
+
+The file contains a header with the same information that is found in the
+header of a text grid file, followed by the values and, if present, by the
+derivatives of the function in the same order used by Grid. The data are
+mapped read-only, so that all the processes that open the same file on a node
+share a single copy of the grid in the page cache and no time is spent in
+parsing at startup. Values and derivatives are interpolated exactly as in Grid.
+
+Files are written in the native byte order with MappedGrid::write.
+The derivatives can be omitted to save space, and the data can be compressed
+with zlib in independent blocks. Compressed files and files on systems without
+mmap are read into memory. MappedGrid::load reads a binary file into a writable
+grid, which is used to restart a simulation from a binary grid.
+*/
+class MappedGrid : public GridBase {
+public:
+  struct Info {
+    std::string funcname;
+    std::vector<std::string> names, gmin, gmax;
+    std::vector<unsigned> nbin;
+    std::vector<bool> periodic;
+    bool hasder=false;
+    bool compressed=false;
+    std::size_t offset=0;
+  };
+private:
+  std::string fname;
+  void* map=nullptr;
+  std::size_t mapsize=0;
+/// Used when the file cannot be mapped
+  std::vector<double> data_;
+  const double* grid_=nullptr;
+  const double* der_=nullptr;
+  static Info readInfo(const std::string& fname);
+  MappedGrid(const std::string& fname, const Info& info, bool dospline);
+public:
+/// Map a binary grid file, spline interpolation requires the derivatives to be stored in the file
+  MappedGrid(const std::string& fname, bool dospline);
+  ~MappedGrid();
+  MappedGrid(const MappedGrid&) = delete;
+  MappedGrid& operator=(const MappedGrid&) = delete;
+/// Check if a file starts with the header of a binary grid file
+  static bool isBinary(const std::string& fname);
+/// Write a grid to a binary file, the file is replaced atomically so that other processes never map a partial file
+  static void write(const std::string& fname, const GridBase& grid, bool withder=true, bool compress=false);
+/// Read a binary grid file in a writable Grid that is not attached to Values
+  static std::unique_ptr<Grid> load(const std::string& fname);
+/// Read a binary grid file in a writable grid, with the same checks on the arguments done by GridBase::create
+  static std::unique_ptr<GridBase> load(const std::string& funcl, const std::vector<Value*> & args, const std::string& fname,
+                                        bool dosparse, bool dospline, bool doder);
+/// As above, also checking the boundaries and the number of bins
+  static std::unique_ptr<GridBase> load(const std::string& funcl, const std::vector<Value*> & args, const std::string& fname,
+                                        const std::vector<std::string> & gmin,const std::vector<std::string> & gmax,
+                                        const std::vector<unsigned> & nbin,bool dosparse, bool dospline, bool doder);
+  index_t getSize() const override;
+  using GridBase::getValue;
+  using GridBase::getValueAndDerivatives;
+  using GridBase::setValue;
+  using GridBase::setValueAndDerivatives;
+  using GridBase::addValue;
+  using GridBase::addValueAndDerivatives;
+  double getValue(index_t index) const override;
+  double getValueAndDerivatives(index_t index, double* der, std::size_t der_size) const override;
+/// The grid is read-only, these methods throw
+  void setValue(index_t index, double value) override;
+  void setValueAndDerivatives(index_t index, double value, std::vector<double>& der) override;
+  void addValue(index_t index, double value) override;
+  void addValueAndDerivatives(index_t index, double value, std::vector<double>& der) override;
+  double getMinValue() const override;
+  double getMaxValue() const override;
+  void writeToFile(OFile&) override;
+};
+
+}
+
+#endif
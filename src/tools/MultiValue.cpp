@@ -52,6 +52,18 @@ MultiValue::MultiValue( const size_t& nvals, const size_t& nder, const size_t& n
   for(unsigned i=0; i<nder; ++i) myind[i]=i;
 }
 
+std::size_t MultiValue::getMemoryUsage() const {
+  std::size_t bytes=Tools::getMemoryUsage(values)+Tools::getMemoryUsage(derivatives)+hasderiv.capacity()/8
+                    +Tools::getMemoryUsage(nactive)+Tools::getMemoryUsage(active_list)+Tools::getMemoryUsage(tmpder)
+                    +Tools::getMemoryUsage(matrix_row_stash)+Tools::getMemoryUsage(matrix_force_stash)+Tools::getMemoryUsage(matrix_bookeeping)
+                    +Tools::getMemoryUsage(matrix_row_nderivatives)+Tools::getMemoryUsage(indices)+Tools::getMemoryUsage(tmp_atoms)
+                    +Tools::getMemoryUsage(tmp_atom_virial);
+  for(const auto & v : matrix_row_derivative_indices) bytes+=Tools::getMemoryUsage(v);
+  for(const auto & v : tmp_atom_der) bytes+=Tools::getMemoryUsage(v);
+  for(const auto & v : tmp_vectors) bytes+=Tools::getMemoryUsage(v);
+  return bytes;
+}
+
 void MultiValue::resize( const size_t& nvals, const size_t& nder, const size_t& nmat, const size_t& maxcol, const size_t& nbook ) {
   values.resize(nvals); nderivatives=nder; derivatives.resize( nvals*nder );
   hasderiv.resize(nvals*nder,false); nactive.resize(nvals); active_list.resize(nvals*nder);
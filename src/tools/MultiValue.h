@@ -27,12 +27,20 @@
 #include "Tensor.h"
 #include <vector>
 #include <cstddef>
+#include <algorithm>
 
 namespace PLMD {
 
 class MultiValue {
   friend class ActionWithVector;
 private:
+#ifdef __PLUMED_MIXED_PRECISION
+/// With -D__PLUMED_MIXED_PRECISION (configure --enable-mixed-precision) the stashed matrix elements are stored in single precision.
+/// Derivatives and forces are accumulated with += and are therefore always kept in double precision.
+  typedef float stash_type;
+#else
+  typedef double stash_type;
+#endif
 /// The index of the task we are currently performing
   std::size_t task_index, task2_index;
 /// Values of quantities
@@ -56,7 +64,7 @@ private:
   unsigned nindices, nsplit;
 /// This allows us to store matrix elements
   unsigned nmatrix_cols;
-  std::vector<double> matrix_row_stash;
+  std::vector<stash_type> matrix_row_stash;
   std::vector<double> matrix_force_stash;
   std::vector<unsigned> matrix_bookeeping;
 /// These are used to store the indices that have derivatives wrt to at least one
@@ -100,6 +108,8 @@ public:
   const std::vector<std::vector<Vector> >& getConstFirstAtomDerivativeVector() const ;
   std::vector<Tensor>& getFirstAtomVirialVector();
   void resizeTemporyVector(const unsigned& n );
+/// Number of bytes allocated by this object
+  std::size_t getMemoryUsage() const ;
   std::vector<double>& getTemporyVector(const unsigned& ind );
 ///
   bool inVectorCall() const ;
@@ -138,6 +148,8 @@ public:
   unsigned getActiveIndex( const unsigned& ) const ;
 /// Get the matrix bookeeping array
   const std::vector<unsigned> & getMatrixBookeeping() const ;
+/// Clear the matrix bookeeping array (this is needed if the MultiValue is reused for a new loop over tasks)
+  void clearMatrixBookeeping();
   void stashMatrixElement( const unsigned& nmat, const unsigned& rowstart, const unsigned& jcol, const double& val );
   double getStashedMatrixElement( const unsigned& nmat, const unsigned& jcol ) const ;
 /// Get the bookeeping stuff for the derivatives wrt to rows of matrix
@@ -319,6 +331,11 @@ const std::vector<unsigned> & MultiValue::getMatrixBookeeping() const {
   return matrix_bookeeping;
 }
 
+inline
+void MultiValue::clearMatrixBookeeping() {
+  std::fill( matrix_bookeeping.begin(), matrix_bookeeping.end(), 0 );
+}
+
 inline
 void MultiValue::setNumberOfMatrixRowDerivatives( const unsigned& nmat, const unsigned& nind ) {
   plumed_dbg_assert( nmat<matrix_row_nderivatives.size() && nind<=matrix_row_derivative_indices[nmat].size() );
@@ -24,6 +24,7 @@
 #include "Pbc.h"
 #include "AtomNumber.h"
 #include "Communicator.h"
+#include "LinkCells.h"
 #include "OpenMP.h"
 #include "Tools.h"
 #include <vector>
@@ -147,6 +148,8 @@ void NeighborList::update(const std::vector<Vector>& positions) {
   const double d2=distance_*distance_;
   // check if positions array has the correct length
   plumed_assert(positions.size()==fullatomlist_.size());
+  nupdates_++;
+  if(skin_>0) reference_=positions;
 
   unsigned stride=comm.Get_size();
   unsigned rank=comm.Get_rank();
@@ -158,30 +161,35 @@ void NeighborList::update(const std::vector<Vector>& positions) {
   }
   std::vector<unsigned> local_flat_nl;
 
-  #pragma omp parallel num_threads(nt)
-  {
-    std::vector<unsigned> private_flat_nl;
-    #pragma omp for nowait
-    for(unsigned int i=rank; i<nallpairs_; i+=stride) {
-      pairIDs index=getIndexPair(i);
-      unsigned index0=index.first;
-      unsigned index1=index.second;
-      Vector distance;
-      if(do_pbc_) {
-        distance=pbc_->distance(positions[index0],positions[index1]);
-      } else {
-        distance=delta(positions[index0],positions[index1]);
-      }
-      double value=modulo2(distance);
-      if(value<=d2) {
-        private_flat_nl.push_back(index0);
-        private_flat_nl.push_back(index1);
+  // Link cells are only used when there is a cutoff and a periodic box to bin the atoms in
+  if( !do_pair_ && do_pbc_ && pbc_->isSet() && distance_<1.0e+30 ) {
+    findPairsWithLinkCells( positions, rank, stride, nt, local_flat_nl );
+  } else {
+    #pragma omp parallel num_threads(nt)
+    {
+      std::vector<unsigned> private_flat_nl;
+      #pragma omp for nowait
+      for(unsigned int i=rank; i<nallpairs_; i+=stride) {
+        pairIDs index=getIndexPair(i);
+        unsigned index0=index.first;
+        unsigned index1=index.second;
+        Vector distance;
+        if(do_pbc_) {
+          distance=pbc_->distance(positions[index0],positions[index1]);
+        } else {
+          distance=delta(positions[index0],positions[index1]);
+        }
+        double value=modulo2(distance);
+        if(value<=d2) {
+          private_flat_nl.push_back(index0);
+          private_flat_nl.push_back(index1);
+        }
       }
+      #pragma omp critical
+      local_flat_nl.insert(local_flat_nl.end(),
+                           private_flat_nl.begin(),
+                           private_flat_nl.end());
     }
-    #pragma omp critical
-    local_flat_nl.insert(local_flat_nl.end(),
-                         private_flat_nl.begin(),
-                         private_flat_nl.end());
   }
 
   // find total dimension of neighborlist
@@ -223,6 +231,45 @@ void NeighborList::update(const std::vector<Vector>& positions) {
   setRequestList();
 }
 
+void NeighborList::findPairsWithLinkCells(const std::vector<Vector>& positions, const unsigned& rank, const unsigned& stride, const unsigned& nt, std::vector<unsigned>& local_flat_nl) const {
+  const double d2=distance_*distance_;
+  // The cells are built from the atoms in the second list (or from all the atoms if there is only one list)
+  // The cost of building them is linear in the number of atoms so every rank builds the full set
+  unsigned nstart = twolists_ ? nlist0_ : 0;
+  std::vector<Vector> cellpos( positions.begin()+nstart, positions.end() );
+  std::vector<unsigned> cellind( cellpos.size() );
+  std::iota( cellind.begin(), cellind.end(), nstart );
+  Communicator serial;
+  LinkCells cells( serial );
+  cells.setCutoff( distance_ );
+  cells.buildCellLists( cellpos, cellind, *pbc_ );
+
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<unsigned> private_flat_nl;
+    std::vector<unsigned> cell_list( cells.getNumberOfCells() ), neighbors( 1+cellpos.size() );
+    #pragma omp for nowait
+    for(unsigned int i=rank; i<nlist0_; i+=stride) {
+      // The first element is skipped by retrieveNeighboringAtoms so it is set to the atom itself
+      unsigned natomsper=1; neighbors[0]=i;
+      cells.retrieveNeighboringAtoms( positions[i], cell_list, natomsper, neighbors );
+      for(unsigned k=1; k<natomsper; ++k) {
+        unsigned j=neighbors[k];
+        if( !twolists_ && j<i ) continue;
+        double value=modulo2(pbc_->distance(positions[i],positions[j]));
+        if(value<=d2) {
+          private_flat_nl.push_back(i);
+          private_flat_nl.push_back(j);
+        }
+      }
+    }
+    #pragma omp critical
+    local_flat_nl.insert(local_flat_nl.end(),
+                         private_flat_nl.begin(),
+                         private_flat_nl.end());
+  }
+}
+
 void NeighborList::setRequestList() {
   requestlist_.clear();
   for(unsigned int i=0; i<size(); ++i) {
@@ -256,6 +303,34 @@ unsigned NeighborList::getStride() const {
   return stride_;
 }
 
+void NeighborList::setSkin(const double skin) {
+  plumed_assert(skin<distance_) << "the skin should be smaller than the neighbor list cutoff";
+  skin_=skin;
+}
+
+double NeighborList::getSkin() const {
+  return skin_;
+}
+
+bool NeighborList::displacementExceedsSkin(const std::vector<Vector>& positions) const {
+  if(reference_.size()!=positions.size()) return true;
+  const double d2=0.25*skin_*skin_;
+  for(unsigned i=0; i<positions.size(); ++i) {
+    Vector displacement;
+    if(do_pbc_) {
+      displacement=pbc_->distance(reference_[i],positions[i]);
+    } else {
+      displacement=delta(reference_[i],positions[i]);
+    }
+    if(modulo2(displacement)>d2) return true;
+  }
+  return false;
+}
+
+unsigned NeighborList::getNumberOfUpdates() const {
+  return nupdates_;
+}
+
 unsigned NeighborList::getLastUpdate() const {
   return lastupdate_;
 }
@@ -264,6 +339,10 @@ void NeighborList::setLastUpdate(const unsigned step) {
   lastupdate_=step;
 }
 
+std::size_t NeighborList::getMemoryUsage() const {
+  return Tools::getMemoryUsage(fullatomlist_)+Tools::getMemoryUsage(requestlist_)+Tools::getMemoryUsage(neighbors_)+Tools::getMemoryUsage(reference_);
+}
+
 unsigned NeighborList::size() const {
   return neighbors_.size();
 }
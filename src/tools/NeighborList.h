@@ -55,6 +55,10 @@ private:
   size_t nallpairs_;
   unsigned stride_=0;
   unsigned lastupdate_=0;
+  double skin_=0.0;
+  unsigned nupdates_=0;
+/// The positions of the atoms when the list was last updated (only stored if there is a skin)
+  std::vector<PLMD::Vector> reference_{};
 /// Initialize the neighbor list with all possible pairs
   void initialize();
 /// Return the pair of indexes in the positions array
@@ -62,6 +66,8 @@ private:
   pairIDs getIndexPair(unsigned i);
 /// Extract the list of atoms from the current list of close pairs
   void setRequestList();
+/// Find the close pairs by binning the atoms in link cells rather than by looping over all pairs
+  void findPairsWithLinkCells(const std::vector<PLMD::Vector>& positions, const unsigned& rank, const unsigned& stride, const unsigned& nt, std::vector<unsigned>& local_flat_nl) const;
 public:
   NeighborList(const std::vector<PLMD::AtomNumber>& list0,
                const std::vector<PLMD::AtomNumber>& list1,
@@ -91,12 +97,22 @@ public:
   void update(const std::vector<PLMD::Vector>& positions);
 /// Get the update stride of the neighbor list
   unsigned getStride() const;
+/// Set the skin.  If this is set the list only needs to be updated when an atom has moved by more than half the skin
+  void setSkin(double skin);
+/// Get the skin of the neighbor list
+  double getSkin() const;
+/// Check if any atom has moved by more than half the skin since the last update
+  bool displacementExceedsSkin(const std::vector<PLMD::Vector>& positions) const;
+/// Get the number of times the list has been updated
+  unsigned getNumberOfUpdates() const;
 /// Get the last step in which the neighbor list was updated
   unsigned getLastUpdate() const;
 /// Set the step of the last update
   void setLastUpdate(unsigned step);
 /// Get the size of the neighbor list
   unsigned size() const;
+/// Number of bytes allocated by the list
+  std::size_t getMemoryUsage() const;
 /// Get the distance used to create the neighbor list
   double distance() const;
 /// Get the i-th pair of the neighbor list
@@ -20,10 +20,13 @@
    along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "OFile.h"
+#include "AsyncWriter.h"
+#include "BinaryColumns.h"
 #include "Exception.h"
 #include "core/Action.h"
 #include "core/PlumedMain.h"
 #include "core/Value.h"
+#include "Units.h"
 #include "Communicator.h"
 #include "Tools.h"
 #include <cstdarg>
@@ -43,21 +46,50 @@
 
 namespace PLMD {
 
-size_t OFile::llwrite(const char*ptr,size_t s) {
+/// Size of the chunks that are handed to the AsyncWriter
+static constexpr std::size_t asyncChunkSize=64*1024;
+
+size_t OFile::directWrite(const char*ptr,size_t s) {
   size_t r;
-  if(linked) return linked->llwrite(ptr,s);
-  if(! (comm && comm->Get_rank()>0)) {
-    if(!fp) plumed_merror("writing on uninitialized File");
-    if(gzfp) {
+  if(!fp) plumed_merror("writing on uninitialized File");
+  if(gzfp) {
 #ifdef __PLUMED_HAS_ZLIB
-      r=gzwrite(gzFile(gzfp),ptr,s);
+    r=gzwrite(gzFile(gzfp),ptr,s);
 #else
-      plumed_merror("file " + getPath() + ": trying to use a gz file without zlib being linked");
+    plumed_merror("file " + getPath() + ": trying to use a gz file without zlib being linked");
 #endif
-    } else {
-      r=std::fwrite(ptr,1,s,fp);
+  } else {
+    r=std::fwrite(ptr,1,s,fp);
+  }
+  return r;
+}
+
+size_t OFile::llwrite(const char*ptr,size_t s) {
+  size_t r;
+  if(linked) return linked->llwrite(ptr,s);
+  if(async_) {
+// The data is only collected here, it is written by the AsyncWriter thread.
+// Thus there is no need to broadcast the result of the write
+    if(! (comm && comm->Get_rank()>0)) {
+      asyncBuffer.append(ptr,s);
+      if(asyncBuffer.length()>=asyncChunkSize) submitAsyncBuffer();
+    }
+    return s;
+  }
+  if(bufferedSize_>0) {
+// As for asynchronous output, only the root process keeps the data, which
+// is written with a single call when the buffer is full or too old
+    if(! (comm && comm->Get_rank()>0)) {
+      pendingBuffer.append(ptr,s);
+      if(pendingBuffer.length()>=bufferedSize_) writePendingBuffer();
+      else if(bufferedInterval_>0.0) {
+        std::chrono::duration<double> age=std::chrono::steady_clock::now()-lastBufferedWrite;
+        if(age.count()>=bufferedInterval_) writePendingBuffer();
+      }
     }
+    return s;
   }
+  if(! (comm && comm->Get_rank()>0)) r=directWrite(ptr,s);
   if(comm) {
 //  This barrier is apparently useless since it comes
 //  just before a Bcast.
@@ -72,12 +104,77 @@ size_t OFile::llwrite(const char*ptr,size_t s) {
   return r;
 }
 
+void OFile::submitAsyncBuffer() {
+  if(asyncBuffer.empty()) return;
+  std::size_t n=asyncBuffer.length();
+  if(!asyncWriter) asyncWriter=Tools::make_unique<AsyncWriter>();
+  asyncWriter->submit([this,data=std::move(asyncBuffer)]() { directWrite(data.c_str(),data.length()); },n);
+  asyncBuffer.clear();
+}
+
+void OFile::writePendingBuffer() {
+  lastBufferedWrite=std::chrono::steady_clock::now();
+  if(pendingBuffer.empty()) return;
+  directWrite(pendingBuffer.c_str(),pendingBuffer.length());
+  pendingBuffer.clear();
+  directFlush();
+}
+
+OFile& OFile::sync() {
+  if(async_) {
+    submitAsyncBuffer();
+    if(asyncWriter) asyncWriter->drain();
+  }
+  writePendingBuffer();
+  return *this;
+}
+
+OFile& OFile::setBuffered(std::size_t size,double interval) {
+  if(size==0) writePendingBuffer();
+  bufferedSize_=size;
+  bufferedInterval_=interval;
+  lastBufferedWrite=std::chrono::steady_clock::now();
+  return *this;
+}
+
+OFile& OFile::setAsync(bool a) {
+  if(async_ && !a) {
+    sync();
+    asyncWriter.reset();
+  }
+  async_=a;
+  return *this;
+}
+
+void OFile::close() {
+  sync();
+// the thread is joined here, so that closed files do not keep it alive
+  asyncWriter.reset();
+  FileBase::close();
+}
+
+OFile::~OFile() {
+  if(async_ || !pendingBuffer.empty()) {
+// errors cannot be reported from a destructor
+    try {
+      sync();
+    } catch(...) {
+    }
+  }
+// join the writer thread before the file pointers are closed by FileBase
+  asyncWriter.reset();
+}
+
 OFile::OFile():
   linked(NULL),
   fieldChanged(false),
   backstring("bck"),
   enforceRestart_(false),
-  enforceBackup_(false)
+  enforceBackup_(false),
+  async_(AsyncWriter::enabled()),
+  bufferedSize_(0),
+  bufferedInterval_(0.0),
+  binaryPrecision(0)
 {
   fmtField();
   buflen=1;
@@ -168,42 +265,66 @@ OFile& OFile::printField(const std::string&name,double v) {
 // The distinction between +nan and -nan is not well defined
 // Always printing nan simplifies some regtest (special functions computed our of range).
   if(std::isnan(v)) v=std::numeric_limits<double>::quiet_NaN();
+  if(binaryPrecision>0) {
+// binary values are stored as they are and only converted when the record is written
+    Field field;
+    field.name=name;
+    field.number=v;
+    fields.push_back(field);
+    return *this;
+  }
   std::snprintf(buffer_string.data(),buffer_string.size(),fieldFmt.c_str(),v);
   printField(name,buffer_string.data());
   return *this;
 }
 
+OFile& OFile::printBinaryIntegerField(const std::string&name,long long int v,unsigned bytes) {
+  Field field;
+  field.name=name;
+  field.number=v;
+  field.integer=v;
+  field.integerBytes=bytes;
+  fields.push_back(field);
+  return *this;
+}
+
 OFile& OFile::printField(const std::string&name,int v) {
+  if(binaryPrecision>0) return printBinaryIntegerField(name,v,4);
   std::snprintf(buffer_string.data(),buffer_string.size()," %d",v);
   printField(name,buffer_string.data());
   return *this;
 }
 
 OFile& OFile::printField(const std::string&name,long int v) {
+  if(binaryPrecision>0) return printBinaryIntegerField(name,v,8);
   std::snprintf(buffer_string.data(),buffer_string.size()," %ld",v);
   printField(name,buffer_string.data());
   return *this;
 }
 
 OFile& OFile::printField(const std::string&name,long long int v) {
+  if(binaryPrecision>0) return printBinaryIntegerField(name,v,8);
   std::snprintf(buffer_string.data(),buffer_string.size()," %lld",v);
   printField(name,buffer_string.data());
   return *this;
 }
 
 OFile& OFile::printField(const std::string&name,unsigned v) {
+  if(binaryPrecision>0) return printBinaryIntegerField(name,v,8);
   std::snprintf(buffer_string.data(),buffer_string.size()," %u",v);
   printField(name,buffer_string.data());
   return *this;
 }
 
 OFile& OFile::printField(const std::string&name,long unsigned v) {
+  if(binaryPrecision>0) return printBinaryIntegerField(name,v,8);
   std::snprintf(buffer_string.data(),buffer_string.size()," %lu",v);
   printField(name,buffer_string.data());
   return *this;
 }
 
 OFile& OFile::printField(const std::string&name,long long unsigned v) {
+  if(binaryPrecision>0) return printBinaryIntegerField(name,v,8);
   std::snprintf(buffer_string.data(),buffer_string.size()," %llu",v);
   printField(name,buffer_string.data());
   return *this;
@@ -216,6 +337,8 @@ OFile& OFile::printField(const std::string&name,const std::string & v) {
     Field field;
     field.name=name;
     field.value=v;
+    if(binaryPrecision>0 && !Tools::convertNoexcept(v,field.number))
+      plumed_merror("file " + getPath() + ": field " + name + " cannot be written on a binary file since its value " + v + " is not a number");
     fields.push_back(field);
   } else {
     if(const_fields[i].value!=v) fieldChanged=true;
@@ -248,28 +371,78 @@ OFile& OFile::printField() {
     reprint=true;
   } else for(unsigned i=0; i<fields.size(); i++) {
       if( previous_fields[i].name!=fields[i].name ||
+          previous_fields[i].integerBytes!=fields[i].integerBytes ||
           (fields[i].constant && fields[i].value!=previous_fields[i].value) ) {
         reprint=true;
         break;
       }
     }
-  if(reprint) {
-    printf("#! FIELDS");
-    for(unsigned i=0; i<fields.size(); i++) printf(" %s",fields[i].name.c_str());
-    printf("\n");
-    for(unsigned i=0; i<const_fields.size(); i++) {
-      printf("#! SET %s %s",const_fields[i].name.c_str(),const_fields[i].value.c_str());
+  if(binaryPrecision>0) {
+    printBinaryField(reprint);
+  } else {
+    if(reprint) {
+      printf("#! FIELDS");
+      for(unsigned i=0; i<fields.size(); i++) printf(" %s",fields[i].name.c_str());
       printf("\n");
+      for(unsigned i=0; i<const_fields.size(); i++) {
+        printf("#! SET %s %s",const_fields[i].name.c_str(),const_fields[i].value.c_str());
+        printf("\n");
+      }
     }
+    for(unsigned i=0; i<fields.size(); i++) printf("%s",fields[i].value.c_str());
+    printf("\n");
   }
-  for(unsigned i=0; i<fields.size(); i++) printf("%s",fields[i].value.c_str());
-  printf("\n");
   previous_fields=fields;
   fields.clear();
   fieldChanged=false;
   return *this;
 }
 
+void OFile::printBinaryField(bool reprint) {
+  binaryBuffer.clear();
+  if(reprint) {
+    std::string header="#! FIELDS";
+    for(unsigned i=0; i<fields.size(); i++) header+=" "+fields[i].name;
+    header+="\n";
+    for(unsigned i=0; i<const_fields.size(); i++) header+="#! SET "+const_fields[i].name+" "+const_fields[i].value+"\n";
+    const std::string format(binaryPrecision==4 ? "float32" : "float64");
+    header+="#! FORMAT "+format+"\n";
+    header+="#! TYPES";
+    for(unsigned i=0; i<fields.size(); i++) {
+      if(fields[i].integerBytes==4) header+=" int32";
+      else if(fields[i].integerBytes==8) header+=" int64";
+      else header+=" "+format;
+    }
+    header+="\n";
+    if(plumed) {
+      const Units& units(plumed->getUnits());
+      header+="#! UNITS "+units.getEnergyString()+" "+units.getLengthString()+" "+units.getTimeString()+"\n";
+    }
+    binaryBuffer.push_back('H');
+    binarycolumns::append<std::uint32_t>(binaryBuffer,header.length());
+    binaryBuffer.insert(binaryBuffer.end(),header.begin(),header.end());
+  }
+  binaryBuffer.push_back('R');
+  for(unsigned i=0; i<fields.size(); i++) {
+    if(fields[i].integerBytes==4) binarycolumns::append<std::int32_t>(binaryBuffer,fields[i].integer);
+    else if(fields[i].integerBytes==8) binarycolumns::append<std::int64_t>(binaryBuffer,fields[i].integer);
+    else if(binaryPrecision==4) binarycolumns::append<float>(binaryBuffer,fields[i].number);
+    else binarycolumns::append<double>(binaryBuffer,fields[i].number);
+  }
+  llwrite(binaryBuffer.data(),binaryBuffer.size());
+}
+
+void OFile::writeBinaryMagic() {
+  llwrite(binarycolumns::magic,sizeof(binarycolumns::magic));
+}
+
+OFile& OFile::setBinary(unsigned precision) {
+  plumed_massert(precision==4 || precision==8,"binary files can only be written with 4 or 8 bytes per value");
+  plumed_massert(!fp && !linked,"setBinary should be called before opening the file");
+  binaryPrecision=precision;
+  return *this;
+}
+
 void OFile::setBackupString( const std::string& str ) {
   backstring=str;
 }
@@ -321,13 +494,23 @@ void OFile::backupFile( const std::string& bstring, const std::string& fname ) {
 
 OFile& OFile::open(const std::string&path) {
   plumed_assert(!cloned);
+  sync();
   eof=false;
   err=false;
   fp=NULL;
   gzfp=NULL;
   this->path=path;
   this->path=appendSuffix(path,getSuffix());
+  bool writeMagic=(binaryPrecision>0);
   if(checkRestart()) {
+// when appending to a binary file the magic string is only needed if the file is empty
+    if(writeMagic) {
+      FILE* ff=std::fopen(const_cast<char*>(this->path.c_str()),"r");
+      if(ff) {
+        if(std::fgetc(ff)!=EOF) writeMagic=false;
+        std::fclose(ff);
+      }
+    }
     fp=std::fopen(const_cast<char*>(this->path.c_str()),"a");
     mode="a";
     if(Tools::extension(this->path)=="gz") {
@@ -350,6 +533,7 @@ OFile& OFile::open(const std::string&path) {
 #endif
     }
   }
+  if(writeMagic) writeBinaryMagic();
   if(plumed) plumed->insertFile(*this);
   return *this;
 }
@@ -358,6 +542,7 @@ OFile& OFile::rewind() {
 // we use here "hard" rewind, which means close/reopen
 // the reason is that normal rewind does not work when in append mode
 // moreover, we can take a backup of the file
+  sync();
   plumed_assert(fp);
   clearFields();
 
@@ -384,10 +569,28 @@ OFile& OFile::rewind() {
     // no exception here
     fp=std::fopen(const_cast<char*>(path.c_str()),"w");
   }
+  if(binaryPrecision>0) writeBinaryMagic();
   return *this;
 }
 
 FileBase& OFile::flush() {
+  if(async_ && heavyFlush) {
+// a heavy flush reopens the file, so fp is only changed by this thread after the writer is idle
+    sync();
+    directFlush();
+  } else if(async_) {
+// the flush is queued after the data so that it does not stall the caller
+    submitAsyncBuffer();
+    if(asyncWriter) asyncWriter->submit([this]() { directFlush(); },0);
+  } else {
+// writing the buffered data also flushes the file
+    if(!pendingBuffer.empty()) writePendingBuffer();
+    else directFlush();
+  }
+  return *this;
+}
+
+void OFile::directFlush() {
   if(heavyFlush) {
     if(gzfp) {
 #ifdef __PLUMED_HAS_ZLIB
@@ -409,7 +612,6 @@ FileBase& OFile::flush() {
     if(gzfp) gzflush(gzFile(gzfp),Z_FULL_FLUSH);
 #endif
   }
-  return *this;
 }
 
 bool OFile::checkRestart()const {
@@ -25,12 +25,14 @@
 #include "FileBase.h"
 #include <vector>
 #include <sstream>
+#include <chrono>
 #include <memory>
 #include <cstddef>
 
 namespace PLMD {
 
 class Value;
+class AsyncWriter;
 
 /**
 \ingroup TOOLBOX
@@ -164,9 +166,22 @@ class OFile:
 /// Class identifying a single field for fielded output
   class Field:
     public FieldBase {
+  public:
+/// Value of the field when writing binary files
+    double number;
+/// Integer value and its size in bytes (4 or 8) for the integer fields of binary files, zero size for floating point fields
+    long long int integer;
+    unsigned integerBytes;
+    Field(): number(0.0), integer(0), integerBytes(0) {}
   };
 /// Low-level write
   std::size_t llwrite(const char*,std::size_t);
+/// Write directly to the underlying file
+  std::size_t directWrite(const char*,std::size_t);
+/// Flush directly the underlying file
+  void directFlush();
+/// Hand the data in asyncBuffer to the AsyncWriter
+  void submitAsyncBuffer();
 /// True if fields has changed.
 /// This could be due to a change in the list of fields or a reset
 /// of a nominally constant field
@@ -193,9 +208,37 @@ class OFile:
   bool enforceRestart_;
 /// True if backup behavior (i.e. non restart) should be forced
   bool enforceBackup_;
+/// True if the writes are done by the AsyncWriter thread
+  bool async_;
+/// Data waiting to be handed to the AsyncWriter
+  std::string asyncBuffer;
+/// The thread that writes this file, started with the first asynchronous write
+  std::unique_ptr<AsyncWriter> asyncWriter;
+/// Size in bytes above which buffered data is written, zero if output is not buffered
+  std::size_t bufferedSize_;
+/// Time in seconds after which buffered data is written, zero for no time limit
+  double bufferedInterval_;
+/// Data collected when output is buffered
+  std::string pendingBuffer;
+/// Last time buffered data was written
+  std::chrono::steady_clock::time_point lastBufferedWrite;
+/// Write and flush the buffered data
+  void writePendingBuffer();
+/// Number of bytes used for each value in binary files, zero for text files
+  unsigned binaryPrecision;
+/// Buffer used to assemble the blocks of binary files
+  std::vector<char> binaryBuffer;
+/// Write the magic string that starts binary files
+  void writeBinaryMagic();
+/// Write a record, and the header if needed, on a binary file
+  void printBinaryField(bool reprint);
+/// Store an integer field that is written on a binary file with the given number of bytes
+  OFile& printBinaryIntegerField(const std::string&name,long long int v,unsigned bytes);
 public:
 /// Constructor
   OFile();
+/// Destructor, waits for pending asynchronous writes
+  ~OFile();
 /// Allows overloading of link
   using FileBase::link;
 /// Allows overloading of open
@@ -264,6 +307,20 @@ public:
   OFile&rewind();
 /// Flush a file
   FileBase&flush() override;
+/// Close the file, after the pending asynchronous writes have been completed
+  void close();
+/// Write this file using the AsyncWriter thread.
+/// By default this is done if the environment variable PLUMED_ASYNC_OUTPUT is set to yes
+  OFile&setAsync(bool);
+/// Wait until all the data written so far has reached the file
+  OFile&sync();
+/// Collect the output in memory and write it only when it exceeds size bytes
+/// or when it is older than interval seconds (zero means no time limit).
+/// A zero size disables buffering. Explicit flushes always write the data
+  OFile&setBuffered(std::size_t size,double interval=0.0);
+/// Write the fields in the binary columnar format described in BinaryColumns.h,
+/// using 4 or 8 bytes per value. Should be called before open
+  OFile&setBinary(unsigned precision);
 /// Enforce restart, also if the attached plumed object is not restarting.
 /// Useful for tests
   OFile&enforceRestart();
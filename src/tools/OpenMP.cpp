@@ -78,5 +78,13 @@ unsigned getThreadNum() {
 #endif
 }
 
+unsigned getTeamSize() {
+#if defined(_OPENMP)
+  return omp_get_num_threads();
+#else
+  return 1;
+#endif
+}
+
 }//namespace OpenMP
 }//namespace PLMD
@@ -37,6 +37,9 @@ unsigned getNumThreads();
 /// Returns a unique thread identification number within the current team
 unsigned getThreadNum();
 
+/// Returns the number of threads in the current team, which can be smaller than the number requested
+unsigned getTeamSize();
+
 /// get cacheline size
 unsigned getCachelineSize();
 
@@ -24,6 +24,9 @@
 #include "Log.h"
 #include "h36.h"
 #include <cstdio>
+#include <cerrno>
+#include <charconv>
+#include <string_view>
 #include <iostream>
 #include "core/GenericMolInfo.h"
 #include "Tensor.h"
@@ -286,48 +289,83 @@ unsigned PDB::size()const {
   return positions.size();
 }
 
+namespace {
+
+/// Fixed PDB column, clipped to the length of the line and stripped of blanks
+std::string_view pdbColumn(std::string_view line,std::size_t start,std::size_t len) {
+  if(start>=line.length()) return std::string_view();
+  auto col=line.substr(start,len);
+  auto first=col.find_first_not_of(" \t");
+  if(first==std::string_view::npos) return std::string_view();
+  auto last=col.find_last_not_of(" \t");
+  return col.substr(first,last-first+1);
+}
+
+/// Plain numbers are converted in place, anything else is left to Tools::convert
+void pdbConvert(std::string_view col,double & t) {
+  if(!col.empty() && col.find_first_not_of("0123456789+-.eE")==std::string_view::npos) {
+    const char* begin=col.data();
+    const char* end=begin+col.length();
+#ifdef __cpp_lib_to_chars
+    if(*begin=='+') begin++;
+    auto res=std::from_chars(begin,end,t);
+    if(res.ec==std::errc() && res.ptr==end) return;
+#else
+    std::string buffer(col);
+    char* ptr;
+    errno=0;
+    t=std::strtod(buffer.c_str(),&ptr);
+    if(errno==0 && ptr==buffer.c_str()+buffer.length()) return;
+#endif
+  }
+  Tools::convert(std::string(col),t);
+}
+
+/// Decimal serials are converted directly, hybrid 36 decoding is only used when needed
+int pdbDecodeSerial(std::string_view col,unsigned width) {
+  int result=0;
+  if(!col.empty() && col.length()<=width && col.find_first_not_of("0123456789")==std::string_view::npos) {
+    auto res=std::from_chars(col.data(),col.data()+col.length(),result);
+    if(res.ec==std::errc()) return result;
+  }
+  std::string padded(col);
+  while(padded.length()<width) padded = std::string(" ") + padded;
+  const char* errmsg = h36::hy36decode(width, padded.c_str(),padded.length(), &result);
+  if(errmsg) {
+    std::string msg(errmsg);
+    plumed_merror(msg);
+  }
+  return result;
+}
+
+}
+
 bool PDB::readFromFilepointer(FILE *fp,bool naturalUnits,double scale) {
   //cerr<<file<<endl;
   bool file_is_alive=false;
   if(naturalUnits) scale=1.0;
-  std::string line;
-  fpos_t pos; bool between_ters=true;
-  while(Tools::getline(fp,line)) {
+  std::string buffer;
+  bool between_ters=true;
+  while(Tools::getline(fp,buffer)) {
     //cerr<<line<<"\n";
-    fgetpos (fp,&pos);
-    while(line.length()<80) line.push_back(' ');
-    std::string record=line.substr(0,6);
-    std::string serial=line.substr(6,5);
-    std::string atomname=line.substr(12,4);
-    std::string residuename=line.substr(17,3);
-    std::string chainID=line.substr(21,1);
-    std::string resnum=line.substr(22,4);
-    std::string x=line.substr(30,8);
-    std::string y=line.substr(38,8);
-    std::string z=line.substr(46,8);
-    std::string occ=line.substr(54,6);
-    std::string bet=line.substr(60,6);
-    std::string BoxX=line.substr(6,9);
-    std::string BoxY=line.substr(15,9);
-    std::string BoxZ=line.substr(24,9);
-    std::string BoxA=line.substr(33,7);
-    std::string BoxB=line.substr(40,7);
-    std::string BoxG=line.substr(47,7);
-    Tools::trim(record);
+    // columns are accessed through views of the line, no copy is made unless the field is stored
+    const std::string_view line(buffer);
+    std::string_view record=line.substr(0,6);
+    record=record.substr(0,record.find_last_not_of(" \t")+1);
     if(record=="TER") { between_ters=false; block_ends.push_back( positions.size() ); }
     if(record=="END") { file_is_alive=true;  break;}
     if(record=="ENDMDL") { file_is_alive=true;  break;}
     if(record=="REMARK") {
-      std::vector<std::string> v1;  v1=Tools::getWords(line.substr(6));
+      std::vector<std::string> v1;  v1=Tools::getWords(line.length()>6?buffer.substr(6):std::string());
       addRemark( v1 );
     }
     if(record=="CRYST1") {
-      Tools::convert(BoxX,BoxXYZ[0]);
-      Tools::convert(BoxY,BoxXYZ[1]);
-      Tools::convert(BoxZ,BoxXYZ[2]);
-      Tools::convert(BoxA,BoxABG[0]);
-      Tools::convert(BoxB,BoxABG[1]);
-      Tools::convert(BoxG,BoxABG[2]);
+      pdbConvert(pdbColumn(line,6,9),BoxXYZ[0]);
+      pdbConvert(pdbColumn(line,15,9),BoxXYZ[1]);
+      pdbConvert(pdbColumn(line,24,9),BoxXYZ[2]);
+      pdbConvert(pdbColumn(line,33,7),BoxABG[0]);
+      pdbConvert(pdbColumn(line,40,7),BoxABG[1]);
+      pdbConvert(pdbColumn(line,47,7),BoxABG[2]);
       BoxXYZ*=scale;
       double cosA=std::cos(BoxABG[0]*pi/180.);
       double cosB=std::cos(BoxABG[1]*pi/180.);
@@ -347,52 +385,33 @@ bool PDB::readFromFilepointer(FILE *fp,bool naturalUnits,double scale) {
       unsigned resno=0; // GB: when resnum string is not present, we set res number to zero
       double o,b;
       Vector p;
-      {
-        int result;
-        auto trimmed=serial;
-        Tools::trim(trimmed);
-        while(trimmed.length()<5) trimmed = std::string(" ") + trimmed;
-        const char* errmsg = h36::hy36decode(5, trimmed.c_str(),trimmed.length(), &result);
-        if(errmsg) {
-          std::string msg(errmsg);
-          plumed_merror(msg);
-        }
-        a.setSerial(result);
-      }
+      a.setSerial(pdbDecodeSerial(pdbColumn(line,6,5),5));
 
       // allow skipping residue number
-      {
-        auto trimmed=resnum;
-        Tools::trim(trimmed);
-        if(trimmed.length()>0) {
-          int result;
-          while(trimmed.length()<4) trimmed = std::string(" ") + trimmed;
-          const char* errmsg = h36::hy36decode(4, trimmed.c_str(),trimmed.length(), &result);
-          if(errmsg) {
-            std::string msg(errmsg);
-            plumed_merror(msg);
-          }
-          resno=result;
-        }
-      }
-
-      Tools::convert(occ,o);
-      Tools::convert(bet,b);
-      Tools::convert(x,p[0]);
-      Tools::convert(y,p[1]);
-      Tools::convert(z,p[2]);
+      const auto resnum=pdbColumn(line,22,4);
+      if(resnum.length()>0) resno=pdbDecodeSerial(resnum,4);
+
+      pdbConvert(pdbColumn(line,54,6),o);
+      pdbConvert(pdbColumn(line,60,6),b);
+      pdbConvert(pdbColumn(line,30,8),p[0]);
+      pdbConvert(pdbColumn(line,38,8),p[1]);
+      pdbConvert(pdbColumn(line,46,8),p[2]);
       // scale into nm
       p*=scale;
       numbers.push_back(a);
       number2index[a]=positions.size();
-      std::size_t startpos=atomname.find_first_not_of(" \t");
-      std::size_t endpos=atomname.find_last_not_of(" \t");
-      atomsymb.push_back( atomname.substr(startpos, endpos-startpos+1) );
+      atomsymb.emplace_back( pdbColumn(line,12,4) );
+      residue2index[resno].push_back(positions.size());
       residue.push_back(resno);
+      // chain id and residue name keep their blanks, as in fixed width columns
+      std::string chainID(1,' ');
+      if(line.length()>21) chainID[0]=line[21];
       chain.push_back(chainID);
       occupancy.push_back(o);
       beta.push_back(b);
       positions.push_back(p);
+      std::string residuename(3,' ');
+      for(unsigned i=0; i<3 && 17+i<line.length(); i++) residuename[i]=line[17+i];
       residuenames.push_back(residuename);
     }
   }
@@ -452,17 +471,23 @@ void PDB::getAtomRange( const std::string& chainname, AtomNumber& a_start, AtomN
   if(inres) a_end=numbers[size()-1];
 }
 
+const std::vector<unsigned>& PDB::getResidueIndices( const unsigned& resnum ) const {
+  static const std::vector<unsigned> empty;
+  const auto p=residue2index.find(resnum);
+  if(p==residue2index.end()) return empty;
+  return p->second;
+}
+
 std::string PDB::getResidueName( const unsigned& resnum ) const {
-  for(unsigned i=0; i<size(); ++i) {
-    if( residue[i]==resnum ) return residuenames[i];
-  }
+  const auto & ind=getResidueIndices(resnum);
+  if( !ind.empty() ) return residuenames[ind[0]];
   std::string num; Tools::convert( resnum, num );
   plumed_merror("residue " + num + " not found" );
 }
 
 std::string PDB::getResidueName(const unsigned& resnum,const std::string& chainid ) const {
-  for(unsigned i=0; i<size(); ++i) {
-    if( residue[i]==resnum && ( chainid=="*" || chain[i]==chainid) ) return residuenames[i];
+  for(const auto & i : getResidueIndices(resnum)) {
+    if( chainid=="*" || chain[i]==chainid ) return residuenames[i];
   }
   std::string num; Tools::convert( resnum, num );
   plumed_merror("residue " + num + " not found in chain " + chainid );
@@ -470,16 +495,16 @@ std::string PDB::getResidueName(const unsigned& resnum,const std::string& chaini
 
 
 AtomNumber PDB::getNamedAtomFromResidue( const std::string& aname, const unsigned& resnum ) const {
-  for(unsigned i=0; i<size(); ++i) {
-    if( residue[i]==resnum && atomsymb[i]==aname ) return numbers[i];
+  for(const auto & i : getResidueIndices(resnum)) {
+    if( atomsymb[i]==aname ) return numbers[i];
   }
   std::string num; Tools::convert( resnum, num );
   plumed_merror("residue " + num + " does not contain an atom named " + aname );
 }
 
 AtomNumber PDB::getNamedAtomFromResidueAndChain( const std::string& aname, const unsigned& resnum, const std::string& chainid ) const {
-  for(unsigned i=0; i<size(); ++i) {
-    if( residue[i]==resnum && atomsymb[i]==aname && ( chainid=="*" || chain[i]==chainid) ) return numbers[i];
+  for(const auto & i : getResidueIndices(resnum)) {
+    if( atomsymb[i]==aname && ( chainid=="*" || chain[i]==chainid) ) return numbers[i];
   }
   std::string num; Tools::convert( resnum, num );
   plumed_merror("residue " + num + " from chain " + chainid + " does not contain an atom named " + aname );
@@ -487,8 +512,8 @@ AtomNumber PDB::getNamedAtomFromResidueAndChain( const std::string& aname, const
 
 std::vector<AtomNumber> PDB::getAtomsInResidue(const unsigned& resnum,const std::string& chainid)const {
   std::vector<AtomNumber> tmp;
-  for(unsigned i=0; i<size(); ++i) {
-    if( residue[i]==resnum && ( chainid=="*" || chain[i]==chainid) ) tmp.push_back(numbers[i]);
+  for(const auto & i : getResidueIndices(resnum)) {
+    if( chainid=="*" || chain[i]==chainid ) tmp.push_back(numbers[i]);
   }
   if(tmp.size()==0) {
     std::string num; Tools::convert( resnum, num );
@@ -509,9 +534,8 @@ std::vector<AtomNumber> PDB::getAtomsInChain(const std::string& chainid)const {
 }
 
 std::string PDB::getChainID(const unsigned& resnumber) const {
-  for(unsigned i=0; i<size(); ++i) {
-    if(resnumber==residue[i]) return chain[i];
-  }
+  const auto & ind=getResidueIndices(resnumber);
+  if( !ind.empty() ) return chain[ind[0]];
   plumed_merror("Not enough residues in pdb input file");
 }
 
@@ -48,6 +48,8 @@ class PDB {
   std::vector<double> beta;
   std::vector<AtomNumber> numbers;
   std::map<AtomNumber,unsigned> number2index;
+/// The indices of the atoms in each residue, in the order they appear in the file
+  std::map<unsigned,std::vector<unsigned> > residue2index;
   std::vector<std::string> residuenames;
   std::string mtype;
   std::vector<std::string> flags;
@@ -55,6 +57,8 @@ class PDB {
   std::map<std::string,std::vector<double> > arg_data;
   Vector BoxXYZ,BoxABG;
   Tensor Box;
+/// The indices of the atoms in residue resnum (empty if there is no such residue)
+  const std::vector<unsigned>& getResidueIndices( const unsigned& resnum ) const ;
 public:
 /// Read the pdb from a file, scaling positions by a factor scale
   bool read(const std::string&file,bool naturalUnits,double scale);
@@ -26,6 +26,8 @@
 #include <iostream>
 #include "Random.h"
 #include <cmath>
+#include <array>
+#include <algorithm>
 
 namespace PLMD {
 
@@ -219,6 +221,37 @@ void Pbc::apply(VectorView dlist, unsigned max_index) const {
   } else plumed_merror("unknown pbc type");
 }
 
+void Pbc::apply(double* dx, double* dy, double* dz, unsigned n) const {
+  if(type==unset) {
+    // do nothing
+  } else if(type==orthorombic) {
+    double* d[3]= {dx,dy,dz};
+    for(int i=0; i<3; i++) {
+      double* di=d[i];
+#ifdef __PLUMED_PBC_WHILE
+      const double l=diag[i], hl=hdiag[i], ml=mdiag[i];
+      for(unsigned k=0; k<n; ++k) {
+        while(di[k]>hl)  di[k]-=l;
+        while(di[k]<=ml) di[k]+=l;
+      }
+#else
+      const double l=box(i,i), il=invBox(i,i);
+      for(unsigned k=0; k<n; ++k) di[k]=Tools::pbc(di[k]*il)*l;
+#endif
+    }
+  } else if(type==generic) {
+    // the reduced box kernel works on an array of vectors so we copy the components in small chunks
+    constexpr unsigned chunk=64;
+    std::array<Vector,chunk> buffer;
+    for(unsigned k=0; k<n; k+=chunk) {
+      const unsigned m=std::min(chunk,n-k);
+      for(unsigned j=0; j<m; ++j) buffer[j]=Vector(dx[k+j],dy[k+j],dz[k+j]);
+      apply(VectorView(&buffer[0][0],m),m);
+      for(unsigned j=0; j<m; ++j) { dx[k+j]=buffer[j][0]; dy[k+j]=buffer[j][1]; dz[k+j]=buffer[j][2]; }
+    }
+  } else plumed_merror("unknown pbc type");
+}
+
 Vector Pbc::distance(const Vector&v1,const Vector&v2,int*nshifts)const {
   Vector d=delta(v1,v2);
   if(type==unset) {
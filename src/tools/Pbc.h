@@ -115,6 +115,9 @@ public:
 /// Apply PBC to a set of positions or distance vectors
   void apply(VectorView dlist, unsigned max_index=0) const;
   void apply(std::vector<Vector>&dlist, unsigned max_index=0) const;
+/// Apply PBC to n distance vectors whose x, y and z components are stored in three separate arrays.
+/// The type of box is only checked once so this is cheaper than calling distance for each pair
+  void apply(double* dx, double* dy, double* dz, unsigned n) const;
 /// Set the lattice vectors.
 /// b[i][j] is the j-th component of the i-th vector
   void setBox(const Tensor&b);
@@ -0,0 +1,134 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "PerfCounters.h"
+#include "Log.h"
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace PLMD {
+
+PerfCounters::Handler::Handler(Handler && other) noexcept:
+  counters(other.counters),name(std::move(other.name)),start(other.start)
+{
+  other.counters=nullptr;
+}
+
+PerfCounters::Handler& PerfCounters::Handler::operator=(Handler && other) noexcept {
+  if(this!=&other) {
+    if(counters) counters->add(name,start);
+    counters=other.counters;
+    name=std::move(other.name);
+    start=other.start;
+    other.counters=nullptr;
+  }
+  return *this;
+}
+
+PerfCounters::Handler::~Handler() {
+  if(counters) counters->add(name,start);
+}
+
+PerfCounters::PerfCounters() {
+  fd.fill(-1);
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for(auto f : fd) if(f>=0) close(f);
+#endif
+}
+
+bool PerfCounters::open() {
+#ifdef __linux__
+  if(open_) return true;
+  const std::array<std::uint64_t,ncounters> events{ {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_REFERENCES,
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES
+    }
+  };
+  for(unsigned i=0; i<ncounters; i++) {
+    perf_event_attr attr;
+    std::memset(&attr,0,sizeof(attr));
+    attr.size=sizeof(attr);
+    attr.type=PERF_TYPE_HARDWARE;
+    attr.config=events[i];
+    attr.exclude_hv=1;
+    // count only this thread, on any cpu
+    fd[i]=syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+    if(fd[i]<0) {
+      // kernel events might not be allowed, try again with user space only
+      attr.exclude_kernel=1;
+      fd[i]=syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+    }
+    if(fd[i]<0) {
+      for(unsigned j=0; j<i; j++) { close(fd[j]); fd[j]=-1; }
+      return false;
+    }
+  }
+  open_=true;
+#endif
+  return open_;
+}
+
+PerfCounters::Counts PerfCounters::read() const {
+  Counts c{};
+#ifdef __linux__
+  for(unsigned i=0; i<ncounters; i++) {
+    long long int v=0;
+    if(::read(fd[i],&v,sizeof(v))==sizeof(v)) c[i]=v;
+  }
+#endif
+  return c;
+}
+
+void PerfCounters::add(const std::string & name,const Counts & start) {
+  const Counts end=read();
+  auto & s=sections[name];
+  for(unsigned i=0; i<ncounters; i++) s.counts[i]+=end[i]-start[i];
+  s.calls++;
+}
+
+void PerfCounters::print(Log & log) const {
+  if(!open_ || sections.empty()) return;
+  log.printf("Hardware counters (per call; IPC = instructions per cycle):\n");
+  log.printf("  %-40s %10s %14s %14s %6s %12s %8s %12s\n","","calls","cycles","instructions","IPC","cache-miss","miss%","branch-miss");
+  for(const auto & s : sections) {
+    const double n=s.second.calls;
+    const auto & c=s.second.counts;
+    const double ipc=(c[0]>0 ? double(c[1])/c[0] : 0.0);
+    const double missRate=(c[2]>0 ? 100.0*c[3]/c[2] : 0.0);
+    log.printf("  %-40s %10llu %14.0f %14.0f %6.2f %12.0f %7.1f%% %12.0f\n",s.first.c_str(),s.second.calls,
+               c[0]/n,c[1]/n,ipc,c[3]/n,missRate,c[4]/n);
+  }
+}
+
+}
@@ -0,0 +1,102 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_PerfCounters_h
+#define __PLUMED_tools_PerfCounters_h
+
+#include <array>
+#include <map>
+#include <string>
+
+namespace PLMD {
+
+class Log;
+
+/**
+Hardware performance counters accumulated over named sections of code.
+
+The counters are read with the Linux perf_event interface, so no external
+library is needed. They count the events of the calling thread only,
+both in user and kernel space if allowed by /proc/sys/kernel/perf_event_paranoid.
+On other systems, or if the counters cannot be opened, open() returns false and
+all the other methods do nothing.
+
+Sections are measured with scoped objects, in the same way as with Stopwatch:
+\verbatim
+  auto pc=counters.measure("section");
+\endverbatim
+*/
+class PerfCounters {
+public:
+/// cycles, instructions, cache references, cache misses, branch misses
+  static constexpr unsigned ncounters=5;
+  using Counts=std::array<long long int,ncounters>;
+private:
+  std::array<int,ncounters> fd;
+  bool open_=false;
+  struct Section {
+    Counts counts{};
+    unsigned long long int calls=0;
+  };
+  std::map<std::string,Section> sections;
+  Counts read() const;
+  void add(const std::string & name,const Counts & start);
+public:
+/// Scoped measurement, accumulated when it goes out of scope
+  class Handler {
+    PerfCounters* counters=nullptr;
+    std::string name;
+    Counts start{};
+    Handler(PerfCounters* c,std::string && n): counters(c),name(std::move(n)),start(c->read()) {}
+    friend class PerfCounters;
+  public:
+    Handler() = default;
+    Handler(const Handler&) = delete;
+    Handler& operator=(const Handler&) = delete;
+    Handler(Handler && other) noexcept;
+    Handler& operator=(Handler && other) noexcept;
+    ~Handler();
+  };
+  PerfCounters();
+  ~PerfCounters();
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+/// Open the counters. Returns false if they are not available
+  bool open();
+/// True if the counters have been opened
+  bool enabled() const { return open_; }
+/// Measure a section of code. The name is only built if the counters are enabled
+  Handler measure(const std::string & name) {
+    if(!open_) return Handler();
+    return Handler(this,std::string(name));
+  }
+/// Measure a section of code whose name is made by a prefix and a label
+  Handler measure(const char* prefix,const std::string & label) {
+    if(!open_) return Handler();
+    return Handler(this,prefix+label);
+  }
+/// Write a table with the counters of all the sections
+  void print(Log & log) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,131 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_Prefetcher_h
+#define __PLUMED_tools_Prefetcher_h
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace PLMD {
+
+/**
+Read items ahead of time in a separate thread.
+
+The reader function is called repeatedly by a background thread and fills
+a ring buffer with the given number of slots. It should return false when there
+is nothing left to read. next() hands the oldest item to the caller by swapping
+it with the item that is passed, so that the memory allocated in the items is
+reused by the reader once the ring buffer is full. Exceptions raised by the reader
+are rethrown by next() once the items read before the error have been consumed.
+*/
+template<class T>
+class Prefetcher {
+  std::function<bool(T&)> reader;
+  std::vector<T> slots;
+  std::size_t first=0;
+  std::size_t count=0;
+  bool finished=false;
+  bool stop=false;
+  std::exception_ptr error;
+  std::mutex mtx;
+  std::condition_variable notEmpty;
+  std::condition_variable notFull;
+  std::thread worker;
+  void run();
+public:
+/// Start reading, keeping up to nslots items ready
+  Prefetcher(std::size_t nslots,std::function<bool(T&)> reader);
+  ~Prefetcher();
+  Prefetcher(const Prefetcher&) = delete;
+  Prefetcher& operator=(const Prefetcher&) = delete;
+/// Swap the next item with t, returns false when there are no more items
+  bool next(T& t);
+};
+
+template<class T>
+Prefetcher<T>::Prefetcher(std::size_t nslots,std::function<bool(T&)> reader):
+  reader(std::move(reader)),
+  slots(nslots>0?nslots:1)
+{
+  worker=std::thread([this]() { run(); });
+}
+
+template<class T>
+Prefetcher<T>::~Prefetcher() {
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    stop=true;
+  }
+  notFull.notify_one();
+  worker.join();
+}
+
+template<class T>
+void Prefetcher<T>::run() {
+  T item;
+  while(true) {
+    bool ok=false;
+    std::exception_ptr err;
+    try {
+      ok=reader(item);
+    } catch(...) {
+      err=std::current_exception();
+    }
+    std::unique_lock<std::mutex> lock(mtx);
+    if(!ok) {
+      error=err;
+      finished=true;
+      notEmpty.notify_one();
+      return;
+    }
+    notFull.wait(lock,[this]() { return stop || count<slots.size(); });
+    if(stop) return;
+    std::swap(slots[(first+count)%slots.size()],item);
+    count++;
+    notEmpty.notify_one();
+  }
+}
+
+template<class T>
+bool Prefetcher<T>::next(T& t) {
+  std::unique_lock<std::mutex> lock(mtx);
+  notEmpty.wait(lock,[this]() { return count>0 || finished; });
+  if(count==0) {
+    if(error) std::rethrow_exception(error);
+    return false;
+  }
+  std::swap(slots[first],t);
+  first=(first+1)%slots.size();
+  count--;
+  notFull.notify_one();
+  return true;
+}
+
+}
+
+#endif
@@ -203,6 +203,20 @@ double RMSD::calculate(const std::vector<Vector> & positions,std::vector<Vector>
 }
 
 
+double RMSD::calculate(const std::vector<Vector> & positions,const Vector & center,std::vector<Vector> &derivatives, bool squared)const {
+  if(alignmentMethod==SIMPLE) return calculate(positions,derivatives,squared);
+  RMSDCoreData cd(align,displace,positions,reference);
+  cd.setPositionsCenterIsRemoved(false);
+  cd.setPositionsCenter(center);
+  cd.setReferenceCenterIsRemoved(reference_center_is_removed);
+  if(!reference_center_is_calculated) {cd.calcReferenceCenter();}
+  else {cd.setReferenceCenter(reference_center);}
+  cd.doCoreCalc(alignmentMethod==OPTIMAL,align==displace);
+  double dist=cd.getDistance(squared);
+  derivatives=cd.getDDistanceDPositions();
+  return dist;
+}
+
 /// convenience method for calculating the standard derivatives and the derivative of the rmsd respect to the reference position
 double RMSD::calc_DDistDRef( const std::vector<Vector>& positions, std::vector<Vector> &derivatives, std::vector<Vector>& DDistDRef, const bool squared  ) {
   double ret=0.;
@@ -229,6 +229,9 @@ public:
 
 /// Compute rmsd: note that this is an intermediate layer which is kept in order to evtl expand with more alignment types/user options to be called while keeping the workhorses separated
   double calculate(const std::vector<Vector> & positions,std::vector<Vector> &derivatives, bool squared=false)const;
+/// Compute rmsd when the center of the positions (computed with the align weights) is already known.
+/// This is useful when the same structure is compared with many references that have the same align weights
+  double calculate(const std::vector<Vector> & positions,const Vector & positions_center,std::vector<Vector> &derivatives, bool squared=false)const;
 /// Other convenience methods:
 /// calculate the derivative of distance respect to position(DDistDPos) and reference (DDistDPos)
   double calc_DDistDRef( const std::vector<Vector>& positions, std::vector<Vector> &DDistDPos, std::vector<Vector>& DDistDRef, const bool squared=false   );
@@ -0,0 +1,168 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2023 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "RandomStream.h"
+#include "OpenMP.h"
+#include "Exception.h"
+#include "Tools.h"
+#include <cmath>
+#include <sstream>
+
+namespace PLMD {
+
+namespace {
+
+const std::uint32_t PHILOX_M0=0xD2511F53;
+const std::uint32_t PHILOX_M1=0xCD9E8D57;
+const std::uint32_t PHILOX_W0=0x9E3779B9;
+const std::uint32_t PHILOX_W1=0xBB67AE85;
+
+inline void mulhilo( std::uint32_t a, std::uint32_t b, std::uint32_t& hi, std::uint32_t& lo ) {
+  const std::uint64_t p=std::uint64_t(a)*std::uint64_t(b);
+  hi=std::uint32_t(p>>32); lo=std::uint32_t(p);
+}
+
+inline std::array<std::uint32_t,4> philox( std::uint64_t seed, std::uint64_t stream, std::uint64_t counter ) {
+  std::array<std::uint32_t,4> c{ std::uint32_t(counter), std::uint32_t(counter>>32), std::uint32_t(stream), std::uint32_t(stream>>32) };
+  std::uint32_t k0=std::uint32_t(seed), k1=std::uint32_t(seed>>32);
+  for(unsigned r=0; r<10; ++r) {
+    std::uint32_t hi0, lo0, hi1, lo1;
+    mulhilo( PHILOX_M0, c[0], hi0, lo0 ); mulhilo( PHILOX_M1, c[2], hi1, lo1 );
+    c = { hi1^c[1]^k0, lo1, hi0^c[3]^k1, lo0 };
+    k0+=PHILOX_W0; k1+=PHILOX_W1;
+  }
+  return c;
+}
+
+/// Build a double in [0,1) with 53 random bits from two 32 bit numbers
+inline double toU01( std::uint32_t a, std::uint32_t b ) {
+  return ( (a>>5)*67108864.0 + (b>>6) )*(1.0/9007199254740992.0);
+}
+
+/// Draw two gaussian numbers from one block using the Box-Muller transform
+inline void toGaussian( const std::array<std::uint32_t,4>& r, double& g1, double& g2 ) {
+  const double u1=1.0-toU01(r[0],r[1]), u2=toU01(r[2],r[3]);
+  const double rad=std::sqrt(-2.0*std::log(u1)), theta=2.0*pi*u2;
+  g1=rad*std::cos(theta); g2=rad*std::sin(theta);
+}
+
+}
+
+RandomStream::RandomStream(std::uint64_t s, std::uint64_t st):
+  seed(s),
+  stream(st),
+  counter(0),
+  ubuffer{0.0,0.0},
+  nubuffer(0),
+  ublock(0),
+  gbuffer(0.0),
+  hasgbuffer(false),
+  gblock(0)
+{
+}
+
+void RandomStream::setSeed(std::uint64_t s) {
+  seed=s; setCounter(0);
+}
+
+void RandomStream::setStream(std::uint64_t s) {
+  stream=s; setCounter(0);
+}
+
+void RandomStream::setCounter(std::uint64_t c) {
+  counter=c; nubuffer=0; hasgbuffer=false;
+}
+
+std::array<std::uint32_t,4> RandomStream::block(std::uint64_t c) const {
+  return philox( seed, stream, c );
+}
+
+void RandomStream::fillUBuffer() {
+  const auto r=block(ublock);
+  ubuffer[0]=toU01(r[2],r[3]); ubuffer[1]=toU01(r[0],r[1]);
+}
+
+void RandomStream::fillGBuffer() {
+  double g1; toGaussian( block(gblock), g1, gbuffer );
+}
+
+double RandomStream::U01() {
+  if( nubuffer==0 ) {
+    ublock=counter; counter++;
+    fillUBuffer(); nubuffer=2;
+  }
+  nubuffer--; return ubuffer[nubuffer];
+}
+
+double RandomStream::Gaussian() {
+  if( hasgbuffer ) { hasgbuffer=false; return gbuffer; }
+  gblock=counter; counter++;
+  double g1; toGaussian( block(gblock), g1, gbuffer ); hasgbuffer=true;
+  return g1;
+}
+
+void RandomStream::fillU01(std::vector<double>& v) {
+  const std::uint64_t start=counter; const unsigned nblocks=(v.size()+1)/2;
+  double* vv=v.data(); const unsigned n=v.size();
+  #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(v))
+  for(unsigned b=0; b<nblocks; ++b) {
+    const auto r=philox( seed, stream, start+b );
+    vv[2*b]=toU01(r[0],r[1]);
+    if( 2*b+1<n ) vv[2*b+1]=toU01(r[2],r[3]);
+  }
+  setCounter( start+nblocks );
+}
+
+void RandomStream::fillGaussian(std::vector<double>& v) {
+  const std::uint64_t start=counter; const unsigned nblocks=(v.size()+1)/2;
+  double* vv=v.data(); const unsigned n=v.size();
+  #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(v))
+  for(unsigned b=0; b<nblocks; ++b) {
+    double g1, g2; toGaussian( philox( seed, stream, start+b ), g1, g2 );
+    vv[2*b]=g1;
+    if( 2*b+1<n ) vv[2*b+1]=g2;
+  }
+  setCounter( start+nblocks );
+}
+
+void RandomStream::toString(std::string & str) const {
+  std::ostringstream ostr;
+  ostr<<seed<<"|"<<stream<<"|"<<counter<<"|"<<nubuffer<<"|"<<ublock<<"|"<<hasgbuffer<<"|"<<gblock;
+  str=ostr.str();
+}
+
+void RandomStream::fromString(const std::string & str) {
+  std::string s=str;
+  for(unsigned i=0; i<s.length(); i++) if(s[i]=='|') s[i]=' ';
+  std::istringstream istr(s.c_str());
+  std::uint64_t c;
+  istr>>seed>>stream>>c;
+  plumed_assert( !istr.fail() ) << "cannot read the state of the random number generator from " << str;
+  setCounter(c);
+  // the numbers left over from the last blocks are regenerated, states without them are also accepted
+  unsigned nu; bool hasg; std::uint64_t ub, gb;
+  if( !(istr>>nu>>ub>>hasg>>gb) ) return;
+  plumed_assert( nu<=2 ) << "cannot read the state of the random number generator from " << str;
+  nubuffer=nu; ublock=ub; if( nubuffer>0 ) fillUBuffer();
+  hasgbuffer=hasg; gblock=gb; if( hasgbuffer ) fillGBuffer();
+}
+
+}
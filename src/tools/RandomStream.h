@@ -0,0 +1,98 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2023 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_RandomStream_h
+#define __PLUMED_tools_RandomStream_h
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PLMD {
+
+/**
+\ingroup TOOLBOX
+Counter based random number generator with independent streams
+
+This class implements the Philox4x32-10 generator of Salmon et al. (SC11).
+Each random block is a pure function of the seed, the stream number and a
+64 bit counter, so numbers can be generated in any order.  This has two
+consequences:
+- different threads or replicas can use the same seed with a different stream
+  number and obtain independent sequences without any communication;
+- the bulk fill functions are parallelized with OpenMP and give exactly the
+  same numbers irrespective of the number of threads.
+
+Each counter gives two doubles, so element i of a bulk fill is obtained from
+counter c+i/2, where c is the current value of the counter.  After the fill the counter is
+advanced past the blocks that were used.  Single numbers drawn with U01() and Gaussian() consume
+the same sequence of blocks.  Each of them keeps its own copy of the second number of the last block
+it used, so uniform and gaussian draws can be mixed.
+
+\verbatim
+RandomStream rng(seed,replica_index);
+std::vector<double> noise(natoms*3);
+rng.fillGaussian(noise);
+\endverbatim
+*/
+class RandomStream {
+  std::uint64_t seed;
+  std::uint64_t stream;
+  std::uint64_t counter;
+/// Numbers of the last block drawn by U01 that have not been used yet and the counter of that block
+  std::array<double,2> ubuffer;
+  unsigned nubuffer;
+  std::uint64_t ublock;
+/// Second number of the last block drawn by Gaussian if it has not been used yet and the counter of that block
+  double gbuffer;
+  bool hasgbuffer;
+  std::uint64_t gblock;
+/// Fill the buffers from the blocks they were drawn from
+  void fillUBuffer();
+  void fillGBuffer();
+public:
+  explicit RandomStream(std::uint64_t seed=0, std::uint64_t stream=0);
+/// Set the seed and reset the counter
+  void setSeed(std::uint64_t s);
+/// Set the stream number and reset the counter
+  void setStream(std::uint64_t s);
+/// Set the counter.  This can be used to skip ahead in the sequence
+  void setCounter(std::uint64_t c);
+  std::uint64_t getCounter() const { return counter; }
+/// Return the four 32 bit numbers generated from a given counter
+  std::array<std::uint32_t,4> block(std::uint64_t c) const;
+/// Return a uniform number in [0,1)
+  double U01();
+/// Return a number from a normal distribution with zero mean and unit variance
+  double Gaussian();
+/// Fill the vector with uniform numbers in [0,1)
+  void fillU01(std::vector<double>& v);
+/// Fill the vector with numbers from a normal distribution with zero mean and unit variance
+  void fillGaussian(std::vector<double>& v);
+/// Save and restore the state of the generator, including the numbers left over from blocks drawn by U01() and Gaussian()
+  void toString(std::string & str) const;
+  void fromString(const std::string & str);
+};
+
+}
+
+#endif
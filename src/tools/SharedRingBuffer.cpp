@@ -0,0 +1,215 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "SharedRingBuffer.h"
+#include "Exception.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#if defined(__unix__) || defined(__APPLE__)
+#define __PLUMED_SHAREDRINGBUFFER_POSIX 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace PLMD {
+
+struct SharedRingBuffer::Header {
+  /// Set once the buffer has been initialized by the process that created it
+  std::atomic<std::uint64_t> magic;
+  std::atomic<std::uint64_t> head;
+  /// The walkers that have attached to the buffer, one bit each
+  std::atomic<std::uint64_t> attached;
+  /// Set when walker 0 has replaced the buffer with the one of a new run
+  std::atomic<std::uint64_t> removed;
+  std::uint64_t recsize;
+  std::uint64_t capacity;
+};
+
+static constexpr std::uint64_t sharedRingBufferMagic=0x504c4d4452494e47ULL;
+
+bool SharedRingBuffer::available() {
+#ifdef __PLUMED_SHAREDRINGBUFFER_POSIX
+  return std::atomic<std::uint64_t>::is_always_lock_free;
+#else
+  return false;
+#endif
+}
+
+// each slot contains the sequence number followed by the record
+std::atomic<std::uint64_t>* SharedRingBuffer::sequence(std::uint64_t n) const {
+  char* base=static_cast<char*>(map)+sizeof(Header);
+  return reinterpret_cast<std::atomic<std::uint64_t>*>(base+(n%capacity)*(recsize+1)*sizeof(double));
+}
+
+double* SharedRingBuffer::record(std::uint64_t n) const {
+  return reinterpret_cast<double*>(sequence(n)+1);
+}
+
+SharedRingBuffer::SharedRingBuffer(const std::string & name, std::size_t recsize, std::size_t capacity, unsigned walker, bool fresh):
+  name(name[0]=='/' ? name : "/"+name),
+  recsize(recsize),
+  capacity(capacity)
+{
+  plumed_massert(available(),"shared memory is not available on this system");
+  plumed_assert(recsize>0 && capacity>0);
+  plumed_massert(!fresh || walker<64,"shared memory segments can only be used by walkers with id smaller than 64");
+#ifdef __PLUMED_SHAREDRINGBUFFER_POSIX
+  mapsize=sizeof(Header)+capacity*(recsize+1)*sizeof(double);
+  if(fresh && walker==0) {
+    // the segment left by a previous run is marked as removed, so that walkers still attached to it stop
+    int fd=shm_open(this->name.c_str(),O_RDWR,0600);
+    if(fd>=0) {
+      struct stat st;
+      if(fstat(fd,&st)==0 && static_cast<std::size_t>(st.st_size)>=sizeof(Header)) {
+        void* old=mmap(nullptr,sizeof(Header),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+        if(old!=MAP_FAILED) {
+          static_cast<Header*>(old)->removed.store(1,std::memory_order_release);
+          munmap(old,sizeof(Header));
+        }
+      }
+      close(fd);
+      shm_unlink(this->name.c_str());
+    }
+    fd=shm_open(this->name.c_str(),O_RDWR|O_CREAT|O_EXCL,0600);
+    plumed_massert(fd>=0,"cannot create shared memory segment "+this->name+": "+std::strerror(errno));
+    bool attached=attach(fd,true,walker,fresh);
+    plumed_assert(attached);
+    return;
+  }
+  for(unsigned i=0;; ++i) {
+    bool creator=!fresh;
+    int fd=(fresh ? -1 : shm_open(this->name.c_str(),O_RDWR|O_CREAT|O_EXCL,0600));
+    if(fd<0 && (fresh || errno==EEXIST)) {
+      creator=false;
+      fd=shm_open(this->name.c_str(),O_RDWR,0600);
+    }
+    // in a new run the other walkers wait until walker 0 has created the segment
+    if(fd<0 && fresh && errno==ENOENT) {
+      plumed_massert(i<60000,"shared memory segment "+this->name+" was not created by walker 0");
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+    plumed_massert(fd>=0,"cannot open shared memory segment "+this->name+": "+std::strerror(errno));
+    if(attach(fd,creator,walker,fresh)) return;
+    // this is the segment of the previous run, walker 0 has not replaced it yet
+    plumed_massert(i<60000,"shared memory segment "+this->name+" belongs to a previous run and was not replaced by walker 0");
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+#endif
+}
+
+bool SharedRingBuffer::attach(int fd, bool creator, unsigned walker, bool fresh) {
+#ifdef __PLUMED_SHAREDRINGBUFFER_POSIX
+  if(creator) {
+    if(ftruncate(fd,mapsize)!=0) {
+      close(fd); shm_unlink(this->name.c_str());
+      plumed_error()<<"cannot allocate shared memory segment "<<this->name;
+    }
+  } else {
+    // wait for the creator to set the size of the segment
+    struct stat st;
+    for(unsigned i=0;; ++i) {
+      plumed_massert(fstat(fd,&st)==0,"cannot stat shared memory segment "+this->name);
+      if(static_cast<std::size_t>(st.st_size)>=sizeof(Header)) break;
+      plumed_massert(i<10000,"shared memory segment "+this->name+" was not initialized");
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    plumed_massert(static_cast<std::size_t>(st.st_size)==mapsize,"shared memory segment "+this->name+" has a different size, remove it or use another name");
+  }
+  map=mmap(nullptr,mapsize,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  close(fd);
+  plumed_massert(map!=MAP_FAILED,"cannot map shared memory segment "+this->name);
+  header=static_cast<Header*>(map);
+  if(creator) {
+    // ftruncate fills the segment with zeros, so the slots are already marked as empty
+    header->recsize=recsize;
+    header->capacity=capacity;
+    header->head.store(0);
+    header->magic.store(sharedRingBufferMagic,std::memory_order_release);
+  } else {
+    for(unsigned i=0; header->magic.load(std::memory_order_acquire)!=sharedRingBufferMagic; ++i) {
+      plumed_massert(i<10000,"shared memory segment "+this->name+" was not initialized");
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    plumed_massert(header->recsize==recsize && header->capacity==capacity,"shared memory segment "+this->name+" has a different layout, remove it or use another name");
+  }
+  const std::uint64_t bit=(walker<64 ? std::uint64_t(1)<<walker : 0);
+  const std::uint64_t previous=header->attached.fetch_or(bit,std::memory_order_acq_rel);
+  if(fresh && (header->removed.load(std::memory_order_acquire) || (previous&bit))) {
+    munmap(map,mapsize); map=nullptr; header=nullptr;
+    return false;
+  }
+#endif
+  return true;
+}
+
+void SharedRingBuffer::checkNotRemoved() const {
+  plumed_massert(!header->removed.load(std::memory_order_relaxed),"shared memory segment "+name+" was replaced by walker 0 when starting a new run");
+}
+
+SharedRingBuffer::~SharedRingBuffer() {
+#ifdef __PLUMED_SHAREDRINGBUFFER_POSIX
+  if(map) munmap(map,mapsize);
+#endif
+}
+
+void SharedRingBuffer::push(const std::vector<double> & rec) {
+  plumed_assert(rec.size()==recsize);
+  checkNotRemoved();
+  const std::uint64_t n=header->head.fetch_add(1,std::memory_order_acq_rel);
+  std::atomic<std::uint64_t>& seq(*sequence(n));
+  // the slot is marked as being written before the record is overwritten
+  seq.store(0,std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(record(n),rec.data(),recsize*sizeof(double));
+  seq.store(n+1,std::memory_order_release);
+}
+
+std::size_t SharedRingBuffer::pull(std::vector<double> & recs) {
+  recs.clear();
+  checkNotRemoved();
+  const std::uint64_t head=header->head.load(std::memory_order_acquire);
+  plumed_massert(head<=readpos+capacity,"records in shared memory segment "+name+" were overwritten before being read, increase its capacity");
+  std::size_t nread=0;
+  while(readpos<head) {
+    const std::atomic<std::uint64_t>& seq(*sequence(readpos));
+    // the record has been reserved but not published yet, it will be read at the next call
+    if(seq.load(std::memory_order_acquire)!=readpos+1) break;
+    const std::size_t k=recs.size();
+    recs.resize(k+recsize);
+    std::memcpy(recs.data()+k,record(readpos),recsize*sizeof(double));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    plumed_massert(seq.load(std::memory_order_relaxed)==readpos+1,"records in shared memory segment "+name+" were overwritten while being read, increase its capacity");
+    readpos++; nread++;
+  }
+  return nread;
+}
+
+void SharedRingBuffer::skipToEnd() {
+  readpos=header->head.load(std::memory_order_acquire);
+}
+
+}
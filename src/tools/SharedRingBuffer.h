@@ -0,0 +1,84 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_SharedRingBuffer_h
+#define __PLUMED_tools_SharedRingBuffer_h
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace PLMD {
+
+/**
+A ring buffer of fixed size records that lives in POSIX shared memory.
+
+Independent processes running on the same node open the buffer with the same name.
+Records are appended without locks: a writer reserves a slot with an atomic counter,
+fills it and then publishes it by setting the sequence number of the slot.
+Every reader keeps its own position and copies the records that have been published
+since its last call. If a reader is so slow that a record it has not read yet
+is overwritten an exception is raised, so the capacity should be chosen large enough.
+
+The segment is not removed when the processes end, so that a run can be restarted.
+When a new run is started, walker 0 removes the segment left by the previous run and creates
+a new one. The other walkers wait for it: each of them marks the segment when it attaches,
+so a segment to which a walker was already attached is recognized as belonging to an earlier run.
+Fresh segments can thus be used with at most 64 walkers.
+*/
+class SharedRingBuffer {
+  struct Header;
+  std::string name;
+  std::size_t recsize=0;
+  std::size_t capacity=0;
+  std::size_t mapsize=0;
+  void* map=nullptr;
+  Header* header=nullptr;
+  /// Position of the next record to be read
+  std::uint64_t readpos=0;
+  double* record(std::uint64_t n) const;
+/// Map the segment, returns false if it was removed or if this walker was already attached to it
+  bool attach(int fd, bool creator, unsigned walker, bool fresh);
+/// Check that the segment has not been removed by walker 0
+  void checkNotRemoved() const;
+  std::atomic<std::uint64_t>* sequence(std::uint64_t n) const;
+public:
+/// Create the buffer or attach to it if it already exists, records are made of recsize doubles.
+/// If fresh is true the buffer is the one created by walker 0 for this run
+  SharedRingBuffer(const std::string & name, std::size_t recsize, std::size_t capacity, unsigned walker=0, bool fresh=false);
+  ~SharedRingBuffer();
+  SharedRingBuffer(const SharedRingBuffer&) = delete;
+  SharedRingBuffer& operator=(const SharedRingBuffer&) = delete;
+/// Append a record
+  void push(const std::vector<double> & rec);
+/// Copy all the records published since the last call in recs, returns the number of records read
+  std::size_t pull(std::vector<double> & recs);
+/// Skip all the records published so far
+  void skipToEnd();
+/// Is shared memory available in this build
+  static bool available();
+};
+
+}
+
+#endif
@@ -0,0 +1,134 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "SharedWindow.h"
+#include "Communicator.h"
+#include "Exception.h"
+
+namespace PLMD {
+
+class SharedWindow::Implementation {
+public:
+  bool enabled=false;
+  int rank=0;
+  int size=1;
+/// Number of doubles in each slice, the first one is the step
+  std::size_t slice=0;
+#ifdef __PLUMED_HAS_MPI
+  MPI_Comm node=MPI_COMM_NULL;
+  MPI_Win win=MPI_WIN_NULL;
+  double* base=nullptr;
+  ~Implementation() {
+// nothing can be freed once MPI has been finalized
+    int finalized=0; MPI_Finalized(&finalized);
+    if(finalized) return;
+    freeWindow();
+    if(node!=MPI_COMM_NULL) MPI_Comm_free(&node);
+  }
+  void freeWindow() {
+    if(win==MPI_WIN_NULL) return;
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+    base=nullptr; slice=0;
+  }
+#endif
+/// Slot 0 or 1 of process r, used at even and odd steps respectively
+  double* slot(int r,long long int step) const {
+#ifdef __PLUMED_HAS_MPI
+    return base+(2*std::size_t(r)+(step%2!=0 ? 1 : 0))*slice;
+#else
+    (void) r; (void) step;
+    return nullptr;
+#endif
+  }
+};
+
+SharedWindow::SharedWindow(Communicator& comm):
+  impl(std::make_unique<Implementation>())
+{
+#ifdef __PLUMED_HAS_MPI
+  if(!Communicator::initialized()) return;
+  impl->rank=comm.Get_rank();
+  impl->size=comm.Get_size();
+  MPI_Comm_split_type(comm.Get_comm(),MPI_COMM_TYPE_SHARED,impl->rank,MPI_INFO_NULL,&impl->node);
+  int nodeSize=0;
+  MPI_Comm_size(impl->node,&nodeSize);
+// all the processes take the same decision
+  int local=(nodeSize==impl->size ? 1 : 0), all=0;
+  MPI_Allreduce(&local,&all,1,MPI_INT,MPI_MIN,comm.Get_comm());
+  impl->enabled=(all==1);
+#else
+  (void) comm;
+#endif
+}
+
+SharedWindow::~SharedWindow() {
+}
+
+bool SharedWindow::enabled() const {
+  return impl->enabled;
+}
+
+void SharedWindow::reserve(std::size_t n) {
+  plumed_assert(impl->enabled);
+#ifdef __PLUMED_HAS_MPI
+  if(n+1<=impl->slice) return;
+  impl->freeWindow();
+  void* ptr=nullptr;
+  const std::size_t slice=n+1;
+  MPI_Aint bytes=(impl->rank==0 ? MPI_Aint(2*slice)*impl->size*sizeof(double) : 0);
+  MPI_Win_allocate_shared(bytes,sizeof(double),MPI_INFO_NULL,impl->node,&ptr,&impl->win);
+  MPI_Aint size; int disp;
+  MPI_Win_shared_query(impl->win,0,&size,&disp,&ptr);
+  impl->base=static_cast<double*>(ptr);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK,impl->win);
+  impl->slice=slice;
+// no slot has been written yet
+  for(unsigned k=0; k<2; k++) impl->slot(impl->rank,k)[0]=-1;
+  publish();
+#else
+  (void) n;
+#endif
+}
+
+double* SharedWindow::write(long long int step) {
+  plumed_assert(impl->enabled && impl->slice>0);
+  double* s=impl->slot(impl->rank,step);
+  s[0]=step;
+  return s+1;
+}
+
+void SharedWindow::publish() {
+#ifdef __PLUMED_HAS_MPI
+  MPI_Win_sync(impl->win);
+  MPI_Barrier(impl->node);
+  MPI_Win_sync(impl->win);
+#endif
+}
+
+const double* SharedWindow::read(int rank,long long int step) const {
+  plumed_assert(impl->enabled && impl->slice>0);
+  const double* s=impl->slot(rank,step);
+  plumed_massert(s[0]==double(step),"data in the shared memory window was not written at this step");
+  return s+1;
+}
+
+}
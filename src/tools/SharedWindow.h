@@ -0,0 +1,65 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_SharedWindow_h
+#define __PLUMED_tools_SharedWindow_h
+
+#include <cstddef>
+#include <memory>
+
+namespace PLMD {
+
+class Communicator;
+
+/**
+An MPI shared memory window in which every process of a communicator owns a slice of doubles.
+
+It can only be used when all the processes of the communicator run on the same node,
+which can be checked with enabled(). A process writes its data in place in its own slice and,
+after publish() has been called by all the processes, the others read it directly from there.
+Each slice is double buffered and tagged with the step at which it was written,
+so that a process can already write the data of the next step while the others are still reading
+the previous one, and only a single barrier per step is needed.
+*/
+class SharedWindow {
+  class Implementation;
+  std::unique_ptr<Implementation> impl;
+public:
+/// Create the window for the processes in comm. Must be called by all of them
+  explicit SharedWindow(Communicator& comm);
+  ~SharedWindow();
+  SharedWindow(const SharedWindow&) = delete;
+  SharedWindow& operator=(const SharedWindow&) = delete;
+/// True if all the processes are on the same node and the window can be used
+  bool enabled() const;
+/// Make sure that each slice holds n doubles. Must be called by all the processes with the same n
+  void reserve(std::size_t n);
+/// The slice of this process where the data for step should be written
+  double* write(long long int step);
+/// Make the data written at this step visible to all the processes. Must be called by all of them
+  void publish();
+/// The slice written by process rank at step
+  const double* read(int rank,long long int step) const;
+};
+
+}
+
+#endif
@@ -23,6 +23,7 @@
 #include "Tools.h"
 #include "Keywords.h"
 #include "OpenMP.h"
+#include "LeptonCall.h"
 #include <vector>
 #include <limits>
 #include <algorithm>
@@ -171,6 +172,16 @@ removed in the future. Similarly, the STRETCH keyword is still allowed but has n
 Notice that switching functions defined with the simplified syntax are never stretched
 for backward compatibility. This might change in the future.
 
+Switching functions that are expensive to evaluate (e.g. CUSTOM or Q) can be replaced by a cubic spline
+that is tabulated between \f$d_0\f$ and \f$d_{max}\f$ when the switching function is set up
+by using the TABULATED flag.  The number of points in the table can be set with the TABLE_POINTS
+keyword (the default is 1000).  D_MAX must be set to use this option.  The largest errors in the value
+and the derivative of the tabulated function are reported in the log.  The function must be constant below \f$d_0\f$,
+so TABULATED cannot be used together with a nonzero D_0 for CUSTOM functions of x2.
+\verbatim
+KEYWORD={CUSTOM FUNC=1/(1+x2^3) R_0=0.3 D_MAX=1.0 TABULATED TABLE_POINTS=2000}
+\endverbatim
+
 */
 //+ENDPLUMEDOC
 
@@ -221,6 +232,10 @@ double baseSwitch::calculateSqr(double distance2,double&dfunc) const {
   double res= calculate(std::sqrt(distance2),dfunc);//RVO!
   return res;
 }
+
+void baseSwitch::calculateSqrArray(const double* distance2, double* res, double* dfunc, const std::size_t n) const {
+  for(std::size_t i=0; i<n; ++i) res[i]=calculateSqr(distance2[i],dfunc[i]);
+}
 double baseSwitch::get_d0() const {return d0;}
 double baseSwitch::get_r0() const {return 1.0/invr0;}
 double baseSwitch::get_dmax() const {return dmax;}
@@ -290,6 +305,17 @@ public:
     return result;
 
   }
+
+  void calculateSqrArray(const double* distance2, double* res, double* dfunc, const std::size_t n) const override {
+    // no branches in the loop so that it can be vectorized
+    for(std::size_t i=0; i<n; ++i) {
+      double df=0.0;
+      const double result = doRational<N/2>(distance2[i]*invr0_2,df);
+      const bool inside = distance2[i] <= dmax_2;
+      res[i] = inside ? result*stretch+shift : 0.0;
+      dfunc[i] = inside ? df*2*invr0_2*stretch : 0.0;
+    }
+  }
 };
 
 //these enums are useful for clarifying the settings in the factory
@@ -386,6 +412,10 @@ public:
       return res;
     }
   }
+
+  void calculateSqrArray(const double* distance2, double* res, double* dfunc, const std::size_t n) const override {
+    for(std::size_t i=0; i<n; ++i) res[i]=rational::calculateSqr(distance2[i],dfunc[i]);
+  }
 };
 
 
@@ -624,8 +654,9 @@ class leptonSwitch: public baseSwitch {
     double* varDevRef=nullptr;
   public:
     funcAndDeriv(const std::string &func) {
-      lepton::ParsedExpression pe=lepton::Parser::parse(func).optimize(lepton::Constants());
-      expression=pe.createCompiledExpression();
+      // expressions are compiled once per process, then copied
+      auto compiled=getCompiledLepton(func, {"x"});
+      expression=compiled->compiled;
       std::string arg="x";
 
       {
@@ -649,8 +680,8 @@ class leptonSwitch: public baseSwitch {
         }
       }
 
-      lepton::ParsedExpression ped=lepton::Parser::parse(func).differentiate(arg).optimize(lepton::Constants());
-      deriv=ped.createCompiledExpression();
+      if(arg!="x") compiled=getCompiledLepton(func, {arg});
+      deriv=compiled->compiled_derivatives[0];
       {
         auto vars=expression.getVariables();
         if (vars.size()==0) {
@@ -813,6 +844,77 @@ public:
     return result;
   }
 };
+
+/// A cubic spline that is tabulated from another switching function between d0 and dmax
+class tabulatedSwitch: public baseSwitch {
+  /// The number of intervals in the table
+  unsigned nint;
+  /// The spacing between the points in the table and its inverse
+  double dr, invdr;
+  /// The values of the function and its derivative with respect to r at the points in the table
+  std::vector<double> values, slopes;
+  /// The description of the function that was tabulated
+  std::string tabulated;
+  /// The largest errors in the value and in dfunc at the midpoints of the intervals
+  double maxerr=0.0, maxderr=0.0;
+  std::string specificDescription() const override {
+    std::ostringstream ostr;
+    ostr<<" tabulated with "<<nint+1<<" points from the "<<tabulated
+        <<".  Largest errors in value and derivative are "<<maxerr<<" and "<<maxderr;
+    return ostr.str();
+  }
+  inline double function(const double,double&) const override {return 0.0;}
+  /// Get the slope of the tabulated function with respect to r
+  static double getSlope(const baseSwitch& sw, const double distance) {
+    double dfunc; sw.calculate(distance,dfunc); return dfunc*distance;
+  }
+public:
+  tabulatedSwitch(const baseSwitch& sw, const unsigned npoints)
+    : baseSwitch(sw.get_d0(),sw.get_dmax(),sw.get_r0(),"tabulated"),
+      nint(npoints-1),
+      dr((dmax-d0)/nint),
+      invdr(1.0/dr),
+      values(npoints),
+      slopes(npoints),
+      tabulated(sw.description()) {
+    // drop the leading r0 that is already printed by this switching function
+    std::size_t pos=tabulated.find("Using ");
+    if(pos!=std::string::npos) tabulated=tabulated.substr(pos+6);
+    for(unsigned i=0; i<npoints; ++i) {
+      double rr=d0+i*dr, dfunc;
+      values[i]=sw.calculate(rr,dfunc);
+      // the function is flat below d0 so we use the slope just above d0 at the first point
+      slopes[i]=getSlope(sw, i==0 ? d0+1.0e-6*dr : rr);
+    }
+    for(unsigned i=0; i<nint; ++i) {
+      double rr=d0+(i+0.5)*dr, df, tdf;
+      double val=sw.calculate(rr,df), tval=calculate(rr,tdf);
+      maxerr=std::max(maxerr,std::fabs(val-tval));
+      maxderr=std::max(maxderr,std::fabs(df-tdf));
+    }
+  }
+
+  double calculate(const double distance,double&dfunc) const override {
+    dfunc=0.0;
+    if(distance>dmax) return 0.0;
+    if(distance<=d0) return values[0];
+    const double x=(distance-d0)*invdr;
+    unsigned i=std::min(unsigned(x),nint-1);
+    const double t=x-i, t2=t*t, t3=t2*t;
+    // cubic Hermite interpolation between points i and i+1
+    const double res = (2*t3-3*t2+1)*values[i] + (t3-2*t2+t)*dr*slopes[i]
+                       + (-2*t3+3*t2)*values[i+1] + (t3-t2)*dr*slopes[i+1];
+    const double ds = 6*(t2-t)*(values[i]-values[i+1])*invdr + (3*t2-4*t+1)*slopes[i] + (3*t2-2*t)*slopes[i+1];
+    dfunc=ds/distance;
+    return res;
+  }
+
+  double calculateSqr(const double distance2,double&dfunc) const override {
+    dfunc=0.0;
+    if(distance2>dmax_2) return 0.0;
+    return calculate(std::sqrt(distance2),dfunc);
+  }
+};
 } // namespace switchContainers
 
 void SwitchingFunction::registerKeywords( Keywords& keys ) {
@@ -854,6 +956,12 @@ void SwitchingFunction::set(const std::string & definition,std::string& errormsg
   Tools::parseFlag(data,"NOSTRETCH",dontstretch); // this is ignored now
   if(dontstretch)
     dostretch=false;
+  bool dotabulate=false;
+  Tools::parseFlag(data,"TABULATED",dotabulate);
+  unsigned npoints=1000;
+  CHECKandPARSE(data,"TABLE_POINTS",npoints,errormsg);
+  if(dotabulate && dmax==std::numeric_limits<double>::max()) errormsg="D_MAX is required to use TABULATED";
+  if(dotabulate && npoints<2) errormsg="TABLE_POINTS should be at least 2";
   if(name=="CUBIC") {
     //cubic is the only switch type that only uses d0 and dmax
     function = PLMD::Tools::make_unique<switchContainers::cubicSwitch>(d0,dmax);
@@ -916,6 +1024,15 @@ void SwitchingFunction::set(const std::string & definition,std::string& errormsg
   if(dostretch && dmax!=std::numeric_limits<double>::max()) {
     function->setupStretch();
   }
+  if(dotabulate && function && errormsg.empty()) {
+    // the table assumes that the function is constant below d0, which is not the case for instance for CUSTOM functions of x2
+    double df0, dfd0;
+    if(function->get_d0()>0.0 && function->calculate(0.0,df0)!=function->calculate(function->get_d0(),dfd0)) {
+      errormsg="TABULATED cannot be used with " + name + " as this function is not constant below D_0";
+    } else {
+      function = PLMD::Tools::make_unique<switchContainers::tabulatedSwitch>(*function,npoints);
+    }
+  }
 }
 
 std::string SwitchingFunction::description() const {
@@ -928,6 +1045,10 @@ double SwitchingFunction::calculateSqr(double distance2,double&dfunc)const {
   return function -> calculateSqr(distance2, dfunc);
 }
 
+void SwitchingFunction::calculateSqr(const double* distance2, double* res, double* dfunc, const std::size_t n)const {
+  function -> calculateSqrArray(distance2, res, dfunc, n);
+}
+
 double SwitchingFunction::calculate(double distance,double&dfunc)const {
   plumed_massert(init,"you are trying to use an unset SwitchingFunction");
   double result=function->calculate(distance,dfunc);
@@ -58,6 +58,8 @@ public:
   ///the driver for the function (prepares rdist or returns 1 or 0 automatically)
   virtual double calculate(double distance, double& dfunc) const;
   virtual double calculateSqr(double distance2, double& dfunc) const;
+  ///evaluates calculateSqr() on n squared distances with a single virtual call
+  virtual void calculateSqrArray(const double* distance2, double* res, double* dfunc, std::size_t n) const;
   void setupStretch();
   void removeStretch();
   std::string description() const;
@@ -103,6 +105,11 @@ public:
 /// The advantage is that in some case the expensive square root can be avoided
 /// (namely for rational functions, if nn and mm are even and d0 is zero)
   double calculateSqr(double distance2,double&dfunc)const;
+/// Compute the switching function for the n squared distances in distance2.
+/// The values are stored in res and the derivatives (as in calculateSqr()) in dfunc.
+/// Evaluating a block of distances in one call avoids a virtual call per distance
+/// and allows the loops for the most common functions to be vectorized.
+  void calculateSqr(const double* distance2, double* res, double* dfunc, std::size_t n)const;
 /// Returns d0
   double get_d0() const;
 /// Returns r0
@@ -138,6 +138,11 @@ public:
   static void trimComments(std::string & s);
 /// Apply pbc for a unitary cell
   static double pbc(double);
+/// Number of bytes allocated by a vector
+  template<class T>
+  static std::size_t getMemoryUsage(const std::vector<T>& v) {
+    return v.capacity()*sizeof(T);
+  }
 /// Retrieve a key from a vector of options.
 /// It finds a key starting with "key=" or equal to "key" and copy the
 /// part after the = on s. E.g.:
@@ -0,0 +1,142 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "Tracer.h"
+#include "Communicator.h"
+#include "Exception.h"
+#include "OpenMP.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace PLMD {
+
+namespace {
+/// Escape a string so that it can be used inside a JSON string
+std::string jsonEscape(const std::string & s) {
+  std::string r;
+  r.reserve(s.length());
+  for(const auto c : s) {
+    if(c=='"' || c=='\\') { r+='\\'; r+=c; }
+    else if(static_cast<unsigned char>(c)<0x20) {
+      char buf[8];
+      std::snprintf(buf,sizeof(buf),"\\u%04x",c);
+      r+=buf;
+    } else r+=c;
+  }
+  return r;
+}
+}
+
+Tracer::Scope::Scope(Scope && other) noexcept:
+  tracer(other.tracer),name(std::move(other.name)),category(other.category),begin(other.begin)
+{
+  other.tracer=nullptr;
+}
+
+Tracer::Scope& Tracer::Scope::operator=(Scope && other) noexcept {
+  if(this!=&other) {
+    if(tracer) tracer->add(std::move(name),category,begin,clock::now());
+    tracer=other.tracer;
+    name=std::move(other.name);
+    category=other.category;
+    begin=other.begin;
+    other.tracer=nullptr;
+  }
+  return *this;
+}
+
+Tracer::Scope::~Scope() {
+  if(tracer) tracer->add(std::move(name),category,begin,clock::now());
+}
+
+Tracer::Tracer():
+  origin(clock::now())
+{
+}
+
+void Tracer::setFile(const std::string & file) {
+  filename=file;
+  recording=false;
+}
+
+void Tracer::setWindow(long long int first,long long int last) {
+  firstStep=first;
+  lastStep=last;
+}
+
+bool Tracer::setStep(long long int step) {
+  if(!enabled()) return false;
+  recording=(step>=firstStep && (lastStep<0 || step<=lastStep));
+  return lastStep>=0 && step>lastStep;
+}
+
+void Tracer::add(std::string && name,const char* category,clock::time_point begin,clock::time_point end) {
+  Event e;
+  e.name=std::move(name);
+  e.category=category;
+  e.thread=OpenMP::getThreadNum();
+  e.begin=std::chrono::duration_cast<std::chrono::nanoseconds>(begin-origin).count();
+  e.duration=std::chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count();
+// events can be closed by different threads when actions are computed concurrently
+  std::lock_guard<std::mutex> lock(mtx);
+  events.push_back(std::move(e));
+}
+
+void Tracer::write(Communicator& comm) {
+  if(!enabled()) return;
+  const int rank=comm.Get_rank();
+  std::string local;
+  for(const auto & e : events) {
+    char buf[256];
+// times are in microseconds
+    std::snprintf(buf,sizeof(buf),"\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u},\n",
+                  e.category,e.begin/1000.0,e.duration/1000.0,rank,e.thread);
+    local+="{\"name\":\""+jsonEscape(e.name)+buf;
+  }
+  events.clear();
+  events.shrink_to_fit();
+
+  const int size=comm.Get_size();
+  std::vector<int> counts(size,0),displs(size,0);
+  counts[rank]=local.length();
+  comm.Sum(counts);
+  for(int i=1; i<size; i++) displs[i]=displs[i-1]+counts[i-1];
+  std::vector<char> all(displs[size-1]+counts[size-1]+1,'\0');
+  if(size>1) comm.Allgatherv(local.data(),counts[rank],all.data(),counts.data(),displs.data());
+  else std::copy(local.begin(),local.end(),all.begin());
+
+  if(rank==0) {
+    std::ofstream ofs(filename);
+    plumed_assert(ofs) << "cannot open trace file " << filename;
+    ofs<<"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    std::string text(all.data());
+// remove the trailing comma of the last event
+    if(text.length()>1) text.erase(text.length()-2,1);
+    ofs<<text;
+    for(int i=0; i<size; i++) ofs<<(text.empty() && i==0?"":",")<<"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":"<<i<<",\"args\":{\"name\":\"rank "<<i<<"\"}}\n";
+    ofs<<"]}\n";
+  }
+  filename.clear();
+  recording=false;
+}
+
+}
@@ -0,0 +1,114 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_Tracer_h
+#define __PLUMED_tools_Tracer_h
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace PLMD {
+
+class Communicator;
+
+/**
+Records a timeline of events that can be visualized with chrome://tracing or https://ui.perfetto.dev
+
+Each event has a name, a category, a begin time and a duration, and it is
+associated to the MPI rank (used as the process id) and to the OpenMP thread
+that generated it. Events are recorded with scoped objects:
+\verbatim
+  auto t=tracer.scope("calculate","action");
+\endverbatim
+When the tracer is disabled, or the current step is outside the window set with
+setWindow(), scope() returns an empty object and nothing is recorded.
+
+The events of all the ranks are collected on the root process and written
+as a single file in the Chrome trace event JSON format, which is also read by Perfetto.
+*/
+class Tracer {
+  using clock=std::chrono::steady_clock;
+  struct Event {
+    std::string name;
+    const char* category;
+    unsigned thread;
+    long long int begin;
+    long long int duration;
+  };
+  std::string filename;
+  long long int firstStep=0;
+  long long int lastStep=-1;
+  bool recording=false;
+  clock::time_point origin;
+  std::mutex mtx;
+  std::vector<Event> events;
+  void add(std::string && name,const char* category,clock::time_point begin,clock::time_point end);
+public:
+/// Scoped event, recorded when it goes out of scope
+  class Scope {
+    Tracer* tracer=nullptr;
+    std::string name;
+    const char* category=nullptr;
+    clock::time_point begin;
+    Scope(Tracer* t,std::string && n,const char* c): tracer(t),name(std::move(n)),category(c),begin(clock::now()) {}
+    friend class Tracer;
+  public:
+    Scope() = default;
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    Scope(Scope && other) noexcept;
+    Scope& operator=(Scope && other) noexcept;
+    ~Scope();
+  };
+  Tracer();
+/// Set the file where the trace is written. An empty name disables the tracer
+  void setFile(const std::string & file);
+/// Only record steps from first to last (included). A negative last means no limit
+  void setWindow(long long int first,long long int last);
+/// Name of the file where the trace is written
+  const std::string & getFile() const { return filename; }
+/// True if a file has been set
+  bool enabled() const { return !filename.empty(); }
+/// Decide if events should be recorded at this step.
+/// Returns true if the step is past the end of the window and the trace should be written
+  bool setStep(long long int step);
+/// True if events are currently recorded
+  bool isRecording() const { return recording; }
+/// Start an event. The name is only built when recording
+  Scope scope(const std::string & name,const char* category) {
+    if(!recording) return Scope();
+    return Scope(this,std::string(name),category);
+  }
+/// Start an event whose name is made by a prefix and a label
+  Scope scope(const char* prefix,const std::string & label,const char* category) {
+    if(!recording) return Scope();
+    return Scope(this,prefix+label,category);
+  }
+/// Collect the events of all the ranks and write them on the root process.
+/// The tracer is disabled afterwards. Must be called by all the processes of comm
+  void write(Communicator& comm);
+};
+
+}
+
+#endif
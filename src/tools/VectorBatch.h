@@ -0,0 +1,237 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2011-2023 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_VectorBatch_h
+#define __PLUMED_tools_VectorBatch_h
+
+#include <vector>
+#include "Vector.h"
+#include "Tensor.h"
+#include "Exception.h"
+
+namespace PLMD {
+
+/**
+\ingroup TOOLBOX
+Class implementing a batch of three dimensional vectors stored as structure of arrays
+
+Vector and Tensor store their components contiguously so loops over many of them
+(e.g. the positions and derivatives of a CV) operate on one object at a time.
+This class stores the x, y and z components of a set of vectors in three separate
+arrays so that the operations below can be vectorized by the compiler.
+It can be filled from and copied back to a std::vector<Vector>.  The raw
+arrays can also be passed directly to Pbc::apply(double*,double*,double*,unsigned).
+
+\verbatim
+#include "VectorBatch.h"
+
+using namespace PLMD;
+
+void f(const std::vector<Vector>& pos, const Pbc& pbc){
+  VectorBatch b(pos), d;
+  delta(pos[0],b,d);
+  pbc.apply(d.x(),d.y(),d.z(),d.size());
+  std::vector<double> d2;
+  modulo2(d,d2);
+}
+\endverbatim
+*/
+class VectorBatch {
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<double> z_;
+public:
+/// create an empty batch
+  VectorBatch() {}
+/// create a batch of n null vectors
+  explicit VectorBatch(unsigned n) : x_(n,0.0), y_(n,0.0), z_(n,0.0) {}
+/// create a batch from a vector of Vectors
+  explicit VectorBatch(const std::vector<Vector>& v) { load(v); }
+/// number of vectors in the batch
+  unsigned size() const { return x_.size(); }
+/// resize the batch
+  void resize(unsigned n) { x_.resize(n); y_.resize(n); z_.resize(n); }
+/// set all the vectors to zero
+  void zero() { std::fill(x_.begin(),x_.end(),0.0); std::fill(y_.begin(),y_.end(),0.0); std::fill(z_.begin(),z_.end(),0.0); }
+/// access to the arrays of components
+  double* x() { return x_.data(); }
+  double* y() { return y_.data(); }
+  double* z() { return z_.data(); }
+  const double* x() const { return x_.data(); }
+  const double* y() const { return y_.data(); }
+  const double* z() const { return z_.data(); }
+/// return the i-th vector
+  Vector get(unsigned i) const { return Vector(x_[i],y_[i],z_[i]); }
+/// set the i-th vector
+  void set(unsigned i, const Vector& v) { x_[i]=v[0]; y_[i]=v[1]; z_[i]=v[2]; }
+/// add to the i-th vector
+  void add(unsigned i, const Vector& v) { x_[i]+=v[0]; y_[i]+=v[1]; z_[i]+=v[2]; }
+/// copy the contents of a vector of Vectors in the batch
+  void load(const std::vector<Vector>& v);
+/// copy the contents of the batch in a vector of Vectors
+  void store(std::vector<Vector>& v) const;
+/// add the contents of the batch to a vector of Vectors
+  void addTo(std::vector<Vector>& v) const;
+/// multiply all the vectors by a scalar
+  VectorBatch& operator*=(double s);
+/// scale the i-th vector by s[i]
+  void scale(const std::vector<double>& s);
+/// compute the differences b[i]-a
+  friend void delta(const Vector& a, const VectorBatch& b, VectorBatch& d);
+/// compute the differences b[i]-a[i]
+  friend void delta(const VectorBatch& a, const VectorBatch& b, VectorBatch& d);
+/// compute the squared moduli of the vectors
+  friend void modulo2(const VectorBatch& a, std::vector<double>& m2);
+/// compute the cross products a[i] x b[i]
+  friend void crossProduct(const VectorBatch& a, const VectorBatch& b, VectorBatch& c);
+/// compute the dot products a[i] . b[i]
+  friend void dotProduct(const VectorBatch& a, const VectorBatch& b, std::vector<double>& d);
+/// compute the products t . a[i]
+  friend void matmul(const Tensor& t, const VectorBatch& a, VectorBatch& b);
+/// return the sum over i of the outer products a[i] x b[i] (e.g. to compute the virial)
+  friend Tensor sumOuterProduct(const VectorBatch& a, const VectorBatch& b);
+};
+
+inline
+void VectorBatch::load(const std::vector<Vector>& v) {
+  const unsigned n=v.size(); resize(n);
+  #pragma omp simd
+  for(unsigned i=0; i<n; ++i) { x_[i]=v[i][0]; y_[i]=v[i][1]; z_[i]=v[i][2]; }
+}
+
+inline
+void VectorBatch::store(std::vector<Vector>& v) const {
+  const unsigned n=size(); v.resize(n);
+  for(unsigned i=0; i<n; ++i) { v[i][0]=x_[i]; v[i][1]=y_[i]; v[i][2]=z_[i]; }
+}
+
+inline
+void VectorBatch::addTo(std::vector<Vector>& v) const {
+  plumed_dbg_assert( v.size()==size() );
+  const unsigned n=size();
+  for(unsigned i=0; i<n; ++i) { v[i][0]+=x_[i]; v[i][1]+=y_[i]; v[i][2]+=z_[i]; }
+}
+
+inline
+VectorBatch& VectorBatch::operator*=(double s) {
+  const unsigned n=size(); double* x=x_.data(); double* y=y_.data(); double* z=z_.data();
+  #pragma omp simd
+  for(unsigned i=0; i<n; ++i) { x[i]*=s; y[i]*=s; z[i]*=s; }
+  return *this;
+}
+
+inline
+void VectorBatch::scale(const std::vector<double>& s) {
+  plumed_dbg_assert( s.size()==size() );
+  const unsigned n=size(); double* x=x_.data(); double* y=y_.data(); double* z=z_.data(); const double* ss=s.data();
+  #pragma omp simd
+  for(unsigned i=0; i<n; ++i) { x[i]*=ss[i]; y[i]*=ss[i]; z[i]*=ss[i]; }
+}
+
+inline
+void delta(const Vector& a, const VectorBatch& b, VectorBatch& d) {
+  const unsigned n=b.size(); d.resize(n);
+  const double ax=a[0], ay=a[1], az=a[2];
+  const double* bx=b.x(); const double* by=b.y(); const double* bz=b.z();
+  double* dx=d.x(); double* dy=d.y(); double* dz=d.z();
+  #pragma omp simd
+  for(unsigned i=0; i<n; ++i) { dx[i]=bx[i]-ax; dy[i]=by[i]-ay; dz[i]=bz[i]-az; }
+}
+
+inline
+void delta(const VectorBatch& a, const VectorBatch& b, VectorBatch& d) {
+  plumed_dbg_assert( a.size()==b.size() );
+  const unsigned n=b.size(); d.resize(n);
+  const double* ax=a.x(); const double* ay=a.y(); const double* az=a.z();
+  const double* bx=b.x(); const double* by=b.y(); const double* bz=b.z();
+  double* dx=d.x(); double* dy=d.y(); double* dz=d.z();
+  #pragma omp simd
+  for(unsigned i=0; i<n; ++i) { dx[i]=bx[i]-ax[i]; dy[i]=by[i]-ay[i]; dz[i]=bz[i]-az[i]; }
+}
+
+inline
+void modulo2(const VectorBatch& a, std::vector<double>& m2) {
+  const unsigned n=a.size(); m2.resize(n);
+  const double* ax=a.x(); const double* ay=a.y(); const double* az=a.z(); double* m=m2.data();
+  #pragma omp simd
+  for(unsigned i=0; i<n; ++i) m[i]=ax[i]*ax[i]+ay[i]*ay[i]+az[i]*az[i];
+}
+
+inline
+void crossProduct(const VectorBatch& a, const VectorBatch& b, VectorBatch& c) {
+  plumed_dbg_assert( a.size()==b.size() && &c!=&a && &c!=&b );
+  const unsigned n=a.size(); c.resize(n);
+  const double* ax=a.x(); const double* ay=a.y(); const double* az=a.z();
+  const double* bx=b.x(); const double* by=b.y(); const double* bz=b.z();
+  double* cx=c.x(); double* cy=c.y(); double* cz=c.z();
+  #pragma omp simd
+  for(unsigned i=0; i<n; ++i) {
+    cx[i]=ay[i]*bz[i]-az[i]*by[i];
+    cy[i]=az[i]*bx[i]-ax[i]*bz[i];
+    cz[i]=ax[i]*by[i]-ay[i]*bx[i];
+  }
+}
+
+inline
+void dotProduct(const VectorBatch& a, const VectorBatch& b, std::vector<double>& d) {
+  plumed_dbg_assert( a.size()==b.size() );
+  const unsigned n=a.size(); d.resize(n);
+  const double* ax=a.x(); const double* ay=a.y(); const double* az=a.z();
+  const double* bx=b.x(); const double* by=b.y(); const double* bz=b.z(); double* dd=d.data();
+  #pragma omp simd
+  for(unsigned i=0; i<n; ++i) dd[i]=ax[i]*bx[i]+ay[i]*by[i]+az[i]*bz[i];
+}
+
+inline
+void matmul(const Tensor& t, const VectorBatch& a, VectorBatch& b) {
+  plumed_dbg_assert( &a!=&b );
+  const unsigned n=a.size(); b.resize(n);
+  const double t00=t(0,0), t01=t(0,1), t02=t(0,2);
+  const double t10=t(1,0), t11=t(1,1), t12=t(1,2);
+  const double t20=t(2,0), t21=t(2,1), t22=t(2,2);
+  const double* ax=a.x(); const double* ay=a.y(); const double* az=a.z();
+  double* bx=b.x(); double* by=b.y(); double* bz=b.z();
+  #pragma omp simd
+  for(unsigned i=0; i<n; ++i) {
+    bx[i]=t00*ax[i]+t01*ay[i]+t02*az[i];
+    by[i]=t10*ax[i]+t11*ay[i]+t12*az[i];
+    bz[i]=t20*ax[i]+t21*ay[i]+t22*az[i];
+  }
+}
+
+inline
+Tensor sumOuterProduct(const VectorBatch& a, const VectorBatch& b) {
+  plumed_dbg_assert( a.size()==b.size() );
+  const unsigned n=a.size();
+  const double* ax=a.x(); const double* ay=a.y(); const double* az=a.z();
+  const double* bx=b.x(); const double* by=b.y(); const double* bz=b.z();
+  double s00=0, s01=0, s02=0, s10=0, s11=0, s12=0, s20=0, s21=0, s22=0;
+  #pragma omp simd reduction(+:s00,s01,s02,s10,s11,s12,s20,s21,s22)
+  for(unsigned i=0; i<n; ++i) {
+    s00+=ax[i]*bx[i]; s01+=ax[i]*by[i]; s02+=ax[i]*bz[i];
+    s10+=ay[i]*bx[i]; s11+=ay[i]*by[i]; s12+=ay[i]*bz[i];
+    s20+=az[i]*bx[i]; s21+=az[i]*by[i]; s22+=az[i]*bz[i];
+  }
+  return Tensor(s00,s01,s02,s10,s11,s12,s20,s21,s22);
+}
+
+}
+#endif
@@ -22,6 +22,7 @@
 #include "ActionWithVirtualAtom.h"
 #include "core/ActionRegister.h"
 #include "core/PlumedMain.h"
+#include "tools/OpenMP.h"
 #include <cmath>
 #include <limits>
 
@@ -129,8 +130,8 @@ class Center:
   public ActionWithVirtualAtom
 {
   std::vector<double> weights;
-  std::vector<Tensor> dcenter_sin;
-  std::vector<Tensor> dcenter_cos;
+/// Cosines and sines of the scaled coordinates, stored as [l*natoms+i] and [(3+l)*natoms+i]
+  std::vector<double> trig;
   std::vector<Tensor> deriv;
   bool isChargeSet_;
   bool isMassSet_;
@@ -217,7 +218,6 @@ Center::Center(const ActionOptions&ao):
 }
 
 void Center::calculate() {
-  Vector pos;
   const bool dophases=(getPbc().isSet() ? phases : false);
 
   if(!nopbc && !dophases) makeWhole();
@@ -255,39 +255,40 @@ void Center::calculate() {
     }
   }
 
-  deriv.resize(getNumberOfAtoms());
+  const unsigned natoms=getNumberOfAtoms();
+  const unsigned nt=OpenMP::getGoodNumThreads(weights);
 
   if(dophases) {
-    dcenter_sin.resize(getNumberOfAtoms());
-    dcenter_cos.resize(getNumberOfAtoms());
-    Vector center_sin;
-    Vector center_cos;
+    deriv.resize(natoms);
+    trig.resize(6*natoms);
+    double* cosv=trig.data();
+    double* sinv=trig.data()+3*natoms;
     Tensor invbox2pi=2*pi*getPbc().getInvBox();
     Tensor box2pi=getPbc().getBox() / (2*pi);
-    for(unsigned i=0; i<getNumberOfAtoms(); ++i) {
-      double w=weights[i];
-
+    double c0=0.0, c1=0.0, c2=0.0, s0=0.0, s1=0.0, s2=0.0;
+    #pragma omp parallel num_threads(nt)
+    {
       // real to scaled
-      const Vector scaled=matmul(getPosition(i),invbox2pi);
-      const Vector ccos(
-        w*std::cos(scaled[0]),
-        w*std::cos(scaled[1]),
-        w*std::cos(scaled[2])
-      );
-      const Vector csin(
-        w*std::sin(scaled[0]),
-        w*std::sin(scaled[1]),
-        w*std::sin(scaled[2])
-      );
-      center_cos+=ccos;
-      center_sin+=csin;
-      for(unsigned l=0; l<3; l++) for(unsigned k=0; k<3; k++) {
-          // k over real coordinates
-          // l over scaled coordinates
-          dcenter_sin[i][l][k]=ccos[l]*invbox2pi[k][l];
-          dcenter_cos[i][l][k]=-csin[l]*invbox2pi[k][l];
-        }
+      #pragma omp for
+      for(unsigned i=0; i<natoms; ++i) {
+        const Vector scaled=matmul(getPosition(i),invbox2pi);
+        for(unsigned l=0; l<3; l++) cosv[l*natoms+i]=scaled[l];
+      }
+      #pragma omp for simd
+      for(unsigned k=0; k<3*natoms; ++k) {
+        const double a=cosv[k];
+        cosv[k]=std::cos(a);
+        sinv[k]=std::sin(a);
+      }
+      #pragma omp for reduction(+:c0,c1,c2,s0,s1,s2)
+      for(unsigned i=0; i<natoms; ++i) {
+        const double w=weights[i];
+        c0+=w*cosv[i]; c1+=w*cosv[natoms+i]; c2+=w*cosv[2*natoms+i];
+        s0+=w*sinv[i]; s1+=w*sinv[natoms+i]; s2+=w*sinv[2*natoms+i];
+      }
     }
+    Vector center_sin(s0,s1,s2);
+    Vector center_cos(c0,c1,c2);
     const Vector c(
       std::atan2(center_sin[0],center_cos[0]),
       std::atan2(center_sin[1],center_cos[1]),
@@ -301,27 +302,32 @@ void Center::calculate() {
       center_cos[l]*=norm;
     }
 
-    for(unsigned i=0; i<getNumberOfAtoms(); ++i) {
-      Tensor dd;
-      for(unsigned l=0; l<3; l++) for(unsigned k=0; k<3; k++) {
-          // k over real coordinates
-          // l over scaled coordinates
-          dd[l][k]= (center_cos[l]*dcenter_sin[i][l][k] - center_sin[l]*dcenter_cos[i][l][k]);
-        }
-      // scaled to real
-      deriv[i]=matmul(dd,box2pi);
+    // the derivative of scaled component l wrt the real coordinates is proportional
+    // to column l of invbox2pi, so going back to real coordinates each atom only
+    // contributes a scalar factor per row of the same matrix
+    const Tensor rowfactor=matmul(transpose(invbox2pi),box2pi);
+    #pragma omp parallel for num_threads(nt)
+    for(unsigned i=0; i<natoms; ++i) {
+      const double w=weights[i];
+      for(unsigned l=0; l<3; l++) {
+        const double a=w*(center_cos[l]*cosv[l*natoms+i]+center_sin[l]*sinv[l*natoms+i]);
+        for(unsigned k=0; k<3; k++) deriv[i][l][k]=a*rowfactor[l][k];
+      }
     }
     setAtomsDerivatives(deriv);
     // scaled to real
     setPosition(matmul(c,box2pi));
   } else {
-    for(unsigned i=0; i<getNumberOfAtoms(); i++) {
-      double w=weights[i];
-      pos+=w*getPosition(i);
-      deriv[i]=w*Tensor::identity();
+    double px=0.0, py=0.0, pz=0.0;
+    #pragma omp parallel for num_threads(nt) reduction(+:px,py,pz)
+    for(unsigned i=0; i<natoms; i++) {
+      const double w=weights[i];
+      const Vector & p=getPosition(i);
+      px+=w*p[0]; py+=w*p[1]; pz+=w*p[2];
     }
-    setPosition(pos);
-    setAtomsDerivatives(deriv);
+    setPosition(Vector(px,py,pz));
+    // the derivatives are the weights times the identity
+    setAtomsDerivatives(weights);
   }
 }
 
@@ -93,6 +93,8 @@ public:
   static void registerKeywords( Keywords&);
   explicit BF_CubicBsplines(const ActionOptions&);
   void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  bool hasLocalSupport() const override {return true;}
+  void getSupport(const double, unsigned int&, unsigned int&) const override;
 };
 
 
@@ -148,10 +150,16 @@ void BF_CubicBsplines::getAllValues(const double arg, double& argT, bool& inside
   inside_range=true;
   argT=checkIfArgumentInsideInterval(arg,inside_range);
   //
+  std::fill(values.begin(),values.end(),0.0);
+  std::fill(derivs.begin(),derivs.end(),0.0);
   values[0]=1.0;
   derivs[0]=0.0;
   //
-  for(unsigned int i=1; i < getNumberOfBasisFunctions(); i++) {
+  // only the splines whose support contains the argument are evaluated
+  unsigned int first, count;
+  getSupport(argT,first,count);
+  const unsigned int nbf = getNumberOfBasisFunctions();
+  for(unsigned int j=0, i=first; j<count; j++, i=(i+1<nbf ? i+1 : 1)) {
     double argx = ((argT-intervalMin())*inv_spacing_) - (static_cast<double>(i) - 2.0);
     if(arePeriodic()) { // periodic range of argx is [-intervalRange/spacing,+intervalRange/spacing]
       argx /= intervalRange()*inv_spacing_;
@@ -165,6 +173,25 @@ void BF_CubicBsplines::getAllValues(const double arg, double& argT, bool& inside
 }
 
 
+void BF_CubicBsplines::getSupport(const double argT, unsigned int& first, unsigned int& count) const {
+  // the spline i is nonzero for (argT-intervalMin())/spacing in (i-4,i)
+  const unsigned int nbf = getNumberOfBasisFunctions();
+  const int cell = static_cast<int>(std::floor((argT-intervalMin())*inv_spacing_));
+  if(arePeriodic()) {
+    const int order = nbf-1;
+    if(order<=4) {first=1; count=nbf-1; return;}
+    first = ((cell%order)+order)%order + 1;
+    count = 4;
+  }
+  else {
+    const int lo = std::max(cell+1,1);
+    const int hi = std::min(cell+4,static_cast<int>(nbf)-1);
+    first = lo;
+    count = (hi>=lo ? hi-lo+1 : 0);
+  }
+}
+
+
 double BF_CubicBsplines::spline(const double arg, double& deriv) const {
   double value=0.0;
   double x=arg;
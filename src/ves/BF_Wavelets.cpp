@@ -22,7 +22,6 @@
 
 
 #include "BasisFunctions.h"
-#include "GridLinearInterpolation.h"
 #include "tools/Grid.h"
 #include "VesTools.h"
 #include "WaveletGrid.h"
@@ -208,10 +207,19 @@ private:
   double scale_;
   /// shift of the individual BFs
   std::vector<double> shifts_;
+  /// values and derivatives of the wavelet grid stored contiguously for the lookup
+  std::vector<double> table_values_;
+  std::vector<double> table_derivs_;
+  /// number of grid bins per unit of the intrinsic interval, all the shifts are multiples of this
+  unsigned bins_per_unit_;
+  /// interpolate the wavelet at the point with grid index coordinate xi
+  void lookupWavelet(const double xi, double& value, double& deriv) const;
 public:
   static void registerKeywords( Keywords&);
   explicit BF_Wavelets(const ActionOptions&);
   void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const override;
+  bool hasLocalSupport() const override {return !arePeriodic();}
+  void getSupport(const double, unsigned int&, unsigned int&) const override;
 };
 
 
@@ -254,6 +262,13 @@ BF_Wavelets::BF_Wavelets(const ActionOptions& ao):
   if(min_grid_size != 1000) {addKeywordToList("MIN_GRID_SIZE",min_grid_size);}
 
   waveletGrid_ = WaveletGrid::setupGrid(getOrder(), min_grid_size, use_mother_wavelet, WaveletGrid::stringToType(wavelet_type_str));
+  // copy the grid into a lookup table, the grid starts at 0 and the integer shifts of the wavelets are an integer number of bins
+  bins_per_unit_ = static_cast<unsigned>(std::lround(1.0/waveletGrid_->getDx(0)));
+  table_values_.resize(waveletGrid_->getSize());
+  table_derivs_.resize(waveletGrid_->getSize());
+  for(Grid::index_t i=0; i<waveletGrid_->getSize(); ++i) {
+    table_values_[i] = waveletGrid_->getValueAndDerivatives(i, &table_derivs_[i], 1);
+  }
   bool dump_wavelet_grid=false;
   parseFlag("DUMP_WAVELET_GRID", dump_wavelet_grid);
   if (dump_wavelet_grid) {
@@ -351,31 +366,69 @@ BF_Wavelets::BF_Wavelets(const ActionOptions& ao):
 }
 
 
+void BF_Wavelets::lookupWavelet(const double xi, double& value, double& deriv) const {
+  const double fi = std::floor(xi);
+  const std::size_t i0 = static_cast<std::size_t>(fi);
+  const double t = xi - fi;
+  if(i0+1<table_values_.size()) {
+    value = table_values_[i0] + t*(table_values_[i0+1]-table_values_[i0]);
+    deriv = table_derivs_[i0] + t*(table_derivs_[i0+1]-table_derivs_[i0]);
+  }
+  else {
+    value = table_values_[i0]; deriv = table_derivs_[i0];
+  }
+}
+
+
 void BF_Wavelets::getAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
   argT=checkIfArgumentInsideInterval(arg,inside_range);
   //
+  std::fill(values.begin(),values.end(),0.0);
+  std::fill(derivs.begin(),derivs.end(),0.0);
   values[0]=1.0;
   derivs[0]=0.0;
-  for(unsigned int i = 1; i < getNumberOfBasisFunctions(); ++i) {
-    // scale and shift argument to match current wavelet
-    double x = shifts_[i] + argT*scale_;
-    if (arePeriodic()) { // periodic interval [0,intervalRange*scale]
+  // only the wavelets whose support contains the argument are evaluated
+  unsigned int first, count;
+  getSupport(argT,first,count);
+  const unsigned int nbf = getNumberOfBasisFunctions();
+  if (arePeriodic()) {
+    for(unsigned int j=0, i=first; j<count; j++, i=(i+1<nbf ? i+1 : 1)) {
+      // scale and shift argument to match current wavelet, periodic interval [0,intervalRange*scale]
+      double x = shifts_[i] + argT*scale_;
       x = x - floor(x/(intervalRange()*scale_))*intervalRange()*scale_;
+      if (x < 0 || x >= intrinsicIntervalMax()) {continue;} // Wavelets are 0 outside the defined range
+      lookupWavelet(x*bins_per_unit_, values[i], derivs[i]);
+      derivs[i] *= scale_; // scale derivative
     }
-
-    if (x < 0 || x >= intrinsicIntervalMax()) { // Wavelets are 0 outside the defined range
-      values[i] = 0.0; derivs[i] = 0.0;
-    }
-    else {
-      std::vector<double> temp_deriv (1);
-      values[i] = GridLinearInterpolation::getGridValueAndDerivativesWithLinearInterpolation(waveletGrid_.get(), {x}, temp_deriv);
-      derivs[i] = temp_deriv[0] * scale_; // scale derivative
+  }
+  else {
+    // the wavelets are shifted by one with respect to each other, so the interpolation
+    // is done at the same position within a grid bin and the bins are bins_per_unit_ apart
+    const double xi1 = (shifts_[1] + argT*scale_)*bins_per_unit_;
+    const double xmax = intrinsicIntervalMax()*bins_per_unit_;
+    for(unsigned int j=0, i=first; j<count; j++, i++) {
+      const double xi = xi1 - static_cast<double>((i-1)*bins_per_unit_);
+      if (xi < 0 || xi >= xmax) {continue;} // Wavelets are 0 outside the defined range
+      lookupWavelet(xi, values[i], derivs[i]);
+      derivs[i] *= scale_; // scale derivative
     }
   }
   if(!inside_range) {for(auto& deriv : derivs) {deriv=0.0;}}
 }
 
 
+void BF_Wavelets::getSupport(const double argT, unsigned int& first, unsigned int& count) const {
+  const unsigned int nbf = getNumberOfBasisFunctions();
+  if(arePeriodic() || nbf<2) {first=1; count=nbf-1; return;}
+  // shifts_[i] decreases by one with i, the wavelet i is nonzero for 0 <= shifts_[i]+argT*scale_ < intrinsicIntervalMax()
+  const double x1 = shifts_[1] + argT*scale_;
+  const int lo = std::max(static_cast<int>(std::floor(x1-intrinsicIntervalMax()))+2,1);
+  const int hi = std::min(static_cast<int>(std::floor(x1))+1,static_cast<int>(nbf)-1);
+  first = lo;
+  count = (hi>=lo ? hi-lo+1 : 0);
+}
+
+
 // returns left and right cutoff point of Wavelet
 // threshold is a percent value of maximum
 std::vector<double> BF_Wavelets::getCutoffPoints(const double& threshold) {
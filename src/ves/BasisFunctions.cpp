@@ -157,6 +157,7 @@ void BasisFunctions::setInterval(const std::string& interval_min_str_in, const s
 
 
 void BasisFunctions::setupInterval() {
+  cache_valid_=false;
   // if(!intervalBounded()){plumed_merror("setupInterval() only works for bounded interval");}
   interval_intrinsic_range_ = interval_intrinsic_max_-interval_intrinsic_min_;
   interval_intrinsic_mean_  = 0.5*(interval_intrinsic_max_+interval_intrinsic_min_);
@@ -96,6 +96,13 @@ private:
   //
   VesBias* vesbias_pntr_;
   Action* action_pntr_;
+  // the values at the last argument, reused by getAllValuesCached()
+  mutable bool cache_valid_=false;
+  mutable double cache_arg_=0.0;
+  mutable double cache_argT_=0.0;
+  mutable bool cache_inside_=true;
+  mutable std::vector<double> cache_values_;
+  mutable std::vector<double> cache_derivs_;
   //
   void getAllValuesNumericalDerivs(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
 
@@ -183,6 +190,15 @@ public:
   double getValue(const double, const unsigned int, double&, bool&) const;
   // calculate the values for all basis functions
   virtual void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const = 0;
+  // same as getAllValues() but the values are reused if the argument is the same as in the previous call,
+  // as it happens for all but one of the dimensions when looping over a grid
+  void getAllValuesCached(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  // true if only a few basis functions are nonzero at any argument, see getSupport()
+  virtual bool hasLocalSupport() const {return false;}
+  // the window of basis functions that can be nonzero at the transformed argument: count functions
+  // starting from first, continuing from 1 after the last one. The constant function 0 is not part
+  // of the window. By default all the basis functions are in the window
+  virtual void getSupport(const double, unsigned int& first, unsigned int& count) const;
   //virtual void get2ndDerivatives(const double, std::vector<double>&)=0;
   void printInfo() const;
   //
@@ -191,9 +207,34 @@ public:
 };
 
 
+inline
+void BasisFunctions::getAllValuesCached(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+  if(!cache_valid_ || arg!=cache_arg_) {
+    cache_values_.assign(nbasis_,0.0);
+    cache_derivs_.assign(nbasis_,0.0);
+    cache_inside_=true;
+    getAllValues(arg,cache_argT_,cache_inside_,cache_values_,cache_derivs_);
+    cache_arg_=arg;
+    cache_valid_=true;
+  }
+  argT=cache_argT_;
+  inside_range=cache_inside_;
+  values=cache_values_;
+  derivs=cache_derivs_;
+}
+
+
+inline
+void BasisFunctions::getSupport(const double argT, unsigned int& first, unsigned int& count) const {
+  first=1;
+  count=nbasis_-1;
+}
+
+
 inline
 void BasisFunctions::setNumberOfBasisFunctions(const unsigned int nbasis_in) {
   nbasis_=nbasis_in;
+  cache_valid_=false;
   bf_labels_.assign(nbasis_,"");
   uniform_integrals_.assign(nbasis_,0.0);
 }
@@ -34,6 +34,10 @@ public:
   explicit MarginalWeight() {}
   double projectInnerLoop(double &input, double &v) {return  input+v;}
   double projectOuterLoop(double &v) {return v;}
+  double projectValues(const std::vector<double> &v) const {
+    double sum=0; for(const auto & vv : v) sum+=vv;
+    return sum;
+  }
 };
 
 class FesWeight:public WeightBase {
@@ -42,6 +46,12 @@ public:
   explicit FesWeight(double v) {beta=v; invbeta=1./beta;}
   double projectInnerLoop(double &input, double &v) {return  input+exp(-beta*v);}
   double projectOuterLoop(double &v) {return -invbeta*std::log(v);}
+  double projectValues(const std::vector<double> &v) const {
+    // the largest exponent is factored out of the sum so that the exponentials cannot overflow
+    double vmin=*std::min_element(v.begin(),v.end()), sum=0;
+    for(const auto & vv : v) sum+=exp(-beta*(vv-vmin));
+    return -invbeta*std::log(sum)+vmin;
+  }
 };
 
 }
@@ -32,6 +32,7 @@
 #include "tools/Keywords.h"
 #include "tools/Grid.h"
 #include "tools/Communicator.h"
+#include "tools/OpenMP.h"
 
 #include "GridProjWeights.h"
 
@@ -357,7 +358,8 @@ double LinearBasisSetExpansion::getBiasAndForces(const std::vector<double>& args
   plumed_assert(coeffs_pntr_in->numberOfDimensions()==nargs);
   plumed_assert(basisf_pntrs_in.size()==nargs);
   plumed_assert(forces.size()==nargs);
-  plumed_assert(coeffsderivs_values.size()==coeffs_pntr_in->numberOfCoeffs());
+  // an empty coeffsderivs_values means that the derivatives with respect to the coeffs are not needed
+  plumed_assert(coeffsderivs_values.empty() || coeffsderivs_values.size()==coeffs_pntr_in->numberOfCoeffs());
 
   std::vector<double> args_values_trsfrm(nargs);
   // std::vector<bool>   inside_interval(nargs,true);
@@ -367,10 +369,9 @@ double LinearBasisSetExpansion::getBiasAndForces(const std::vector<double>& args
   std::vector< std::vector <double> > bf_derivs(nargs);
   //
   for(unsigned int k=0; k<nargs; k++) {
-    bf_values[k].assign(basisf_pntrs_in[k]->getNumberOfBasisFunctions(),0.0);
-    bf_derivs[k].assign(basisf_pntrs_in[k]->getNumberOfBasisFunctions(),0.0);
+    plumed_assert(coeffs_pntr_in->shapeOfIndices(k)==basisf_pntrs_in[k]->getNumberOfBasisFunctions());
     bool curr_inside=true;
-    basisf_pntrs_in[k]->getAllValues(args_values[k],args_values_trsfrm[k],curr_inside,bf_values[k],bf_derivs[k]);
+    basisf_pntrs_in[k]->getAllValuesCached(args_values[k],args_values_trsfrm[k],curr_inside,bf_values[k],bf_derivs[k]);
     // inside_interval[k]=curr_inside;
     if(!curr_inside) {all_inside=false;}
     forces[k]=0.0;
@@ -383,26 +384,56 @@ double LinearBasisSetExpansion::getBiasAndForces(const std::vector<double>& args
     stride=comm_in->Get_size();
     rank=comm_in->Get_rank();
   }
-  // loop over coeffs
-  double bias=0.0;
-  for(size_t i=rank; i<coeffs_pntr_in->numberOfCoeffs(); i+=stride) {
-    std::vector<unsigned int> indices=coeffs_pntr_in->getIndices(i);
-    double coeff = coeffs_pntr_in->getValue(i);
-    double bf_curr=1.0;
+  // with localized basis functions only the coeffs of the few nonzero products are needed
+  bool local_support=true;
+  for(unsigned int k=0; k<nargs; k++) {
+    if(!basisf_pntrs_in[k]->hasLocalSupport()) {local_support=false;}
+  }
+  std::vector< std::vector<unsigned int> > support;
+  if(local_support) {
+    support.resize(nargs);
+    size_t nsupport=1;
     for(unsigned int k=0; k<nargs; k++) {
-      bf_curr*=bf_values[k][indices[k]];
+      unsigned int first, count;
+      basisf_pntrs_in[k]->getSupport(args_values_trsfrm[k],first,count);
+      const unsigned int nbf = bf_values[k].size();
+      support[k].push_back(0);
+      for(unsigned int j=0, i=first; j<count; j++, i=(i+1<nbf ? i+1 : 1)) {support[k].push_back(i);}
+      nsupport*=support[k].size();
     }
-    bias+=coeff*bf_curr;
-    coeffsderivs_values[i] = bf_curr;
-    for(unsigned int k=0; k<nargs; k++) {
-      double der = 1.0;
-      for(unsigned int l=0; l<nargs; l++) {
-        if(l!=k) {der*=bf_values[l][indices[l]];}
-        else {der*=bf_derivs[l][indices[l]];}
+    if(2*nsupport>coeffs_pntr_in->numberOfCoeffs()) {local_support=false;}
+  }
+  double bias=0.0;
+  if(local_support) {
+    bias=contractLocalSupport(forces,coeffsderivs_values,support,bf_values,bf_derivs,coeffs_pntr_in,rank,stride);
+  }
+  else if(coeffsderivs_values.empty()) {
+    bias=contractBiasAndForces(forces,bf_values,bf_derivs,coeffs_pntr_in,rank,stride);
+  }
+  else {
+    // loop over coeffs, the products of the other dimensions needed for the forces are
+    // obtained from the partial products on the left and on the right of each dimension
+    std::vector<unsigned int> indices(nargs,0);
+    std::vector<double> left(nargs+1), right(nargs+1);
+    size_t ilast=0;
+    for(size_t i=rank; i<coeffs_pntr_in->numberOfCoeffs(); i+=stride) {
+      // column-major order, the first index is the fastest
+      for(; ilast<i; ilast++) {
+        for(unsigned int k=0; k<nargs; k++) {
+          if(++indices[k]<bf_values[k].size()) {break;}
+          indices[k]=0;
+        }
+      }
+      double coeff = coeffs_pntr_in->getValue(i);
+      left[0]=1.0; right[nargs]=1.0;
+      for(unsigned int k=0; k<nargs; k++) {left[k+1]=left[k]*bf_values[k][indices[k]];}
+      for(unsigned int k=nargs; k>0; k--) {right[k-1]=right[k]*bf_values[k-1][indices[k-1]];}
+      double bf_curr=left[nargs];
+      bias+=coeff*bf_curr;
+      coeffsderivs_values[i] = bf_curr;
+      for(unsigned int k=0; k<nargs; k++) {
+        forces[k]-=coeff*left[k]*bf_derivs[k][indices[k]]*right[k+1];
       }
-      forces[k]-=coeff*der;
-      // maybe faster but dangerous
-      // forces[k]-=coeff*bf_curr*(bf_derivs[k][indices[k]]/bf_values[k][indices[k]]);
     }
   }
   //
@@ -415,6 +446,87 @@ double LinearBasisSetExpansion::getBiasAndForces(const std::vector<double>& args
 }
 
 
+double LinearBasisSetExpansion::contractBiasAndForces(std::vector<double>& forces, const std::vector< std::vector<double> >& bf_values, const std::vector< std::vector<double> >& bf_derivs, CoeffsVector* coeffs_pntr_in, const size_t rank, const size_t stride) {
+  // The sum over the coeffs of the product of the basis functions is done one dimension
+  // at a time, starting from the first one that is contiguous in memory, so that the
+  // product over all the dimensions is never formed. Each entry of the partially contracted
+  // tensor holds the bias and the derivatives with respect to the dimensions already contracted.
+  unsigned int nargs = bf_values.size();
+  size_t nrest = coeffs_pntr_in->numberOfCoeffs()/bf_values[0].size();
+  const unsigned int ncomp = nargs+1;
+  std::vector<double> tensor(nrest*ncomp,0.0);
+  // first dimension from the coeffs, the ranks split the rows
+  for(size_t r=rank; r<nrest; r+=stride) {
+    const size_t n0 = bf_values[0].size();
+    double val=0.0, der=0.0;
+    for(size_t i0=0; i0<n0; i0++) {
+      double coeff = coeffs_pntr_in->getValue(r*n0+i0);
+      val+=coeff*bf_values[0][i0];
+      der+=coeff*bf_derivs[0][i0];
+    }
+    tensor[r*ncomp]=val;
+    tensor[r*ncomp+1]=der;
+  }
+  // the following dimensions from the partially contracted tensor
+  for(unsigned int k=1; k<nargs; k++) {
+    const size_t nk = bf_values[k].size();
+    nrest/=nk;
+    std::vector<double> next(nrest*ncomp,0.0);
+    for(size_t r=0; r<nrest; r++) {
+      double* out=&next[r*ncomp];
+      for(size_t ik=0; ik<nk; ik++) {
+        const double* in=&tensor[(r*nk+ik)*ncomp];
+        const double f=bf_values[k][ik];
+        out[0]+=in[0]*f;
+        for(unsigned int l=1; l<=k; l++) {out[l]+=in[l]*f;}
+        out[k+1]+=in[0]*bf_derivs[k][ik];
+      }
+    }
+    tensor.swap(next);
+  }
+  for(unsigned int k=0; k<nargs; k++) {forces[k]-=tensor[k+1];}
+  return tensor[0];
+}
+
+
+double LinearBasisSetExpansion::contractLocalSupport(std::vector<double>& forces, std::vector<double>& coeffsderivs_values, const std::vector< std::vector<unsigned int> >& support, const std::vector< std::vector<double> >& bf_values, const std::vector< std::vector<double> >& bf_derivs, CoeffsVector* coeffs_pntr_in, const size_t rank, const size_t stride) {
+  // all the other products of basis functions are zero, so are their derivatives with respect to the coeffs.
+  // Each coeff is handled by the same rank as in the loop over all the coeffs, as the sum over
+  // the ranks of the derivatives with respect to the coeffs is done later on in the averages
+  unsigned int nargs = bf_values.size();
+  if(!coeffsderivs_values.empty()) {std::fill(coeffsderivs_values.begin(),coeffsderivs_values.end(),0.0);}
+  // column-major order, the first index is the fastest
+  std::vector<size_t> cstride(nargs,1);
+  for(unsigned int k=1; k<nargs; k++) {cstride[k]=cstride[k-1]*bf_values[k-1].size();}
+  std::vector<unsigned int> pos(nargs,0);
+  std::vector<double> left(nargs+1), right(nargs+1);
+  double bias=0.0;
+  bool done=false;
+  while(!done) {
+    size_t i=0;
+    for(unsigned int k=0; k<nargs; k++) {i+=support[k][pos[k]]*cstride[k];}
+    if(i%stride==rank) {
+      double coeff = coeffs_pntr_in->getValue(i);
+      left[0]=1.0; right[nargs]=1.0;
+      for(unsigned int k=0; k<nargs; k++) {left[k+1]=left[k]*bf_values[k][support[k][pos[k]]];}
+      for(unsigned int k=nargs; k>0; k--) {right[k-1]=right[k]*bf_values[k-1][support[k-1][pos[k-1]]];}
+      double bf_curr=left[nargs];
+      bias+=coeff*bf_curr;
+      if(!coeffsderivs_values.empty()) {coeffsderivs_values[i] = bf_curr;}
+      for(unsigned int k=0; k<nargs; k++) {
+        forces[k]-=coeff*left[k]*bf_derivs[k][support[k][pos[k]]]*right[k+1];
+      }
+    }
+    done=true;
+    for(unsigned int k=0; k<nargs; k++) {
+      if(++pos[k]<support[k].size()) {done=false; break;}
+      pos[k]=0;
+    }
+  }
+  return bias;
+}
+
+
 void LinearBasisSetExpansion::getBasisSetValues(const std::vector<double>& args_values, std::vector<double>& basisset_values, std::vector<BasisFunctions*>& basisf_pntrs_in, CoeffsVector* coeffs_pntr_in, Communicator* comm_in) {
   unsigned int nargs = args_values.size();
   plumed_assert(coeffs_pntr_in->numberOfDimensions()==nargs);
@@ -427,7 +539,7 @@ void LinearBasisSetExpansion::getBasisSetValues(const std::vector<double>& args_
     std::vector<double> tmp_val(basisf_pntrs_in[k]->getNumberOfBasisFunctions());
     std::vector<double> tmp_der(tmp_val.size());
     bool inside=true;
-    basisf_pntrs_in[k]->getAllValues(args_values[k],args_values_trsfrm[k],inside,tmp_val,tmp_der);
+    basisf_pntrs_in[k]->getAllValuesCached(args_values[k],args_values_trsfrm[k],inside,tmp_val,tmp_der);
     bf_values.push_back(tmp_val);
   }
   //
@@ -466,7 +578,7 @@ double LinearBasisSetExpansion::getBasisSetValue(const std::vector<double>& args
     std::vector<double> tmp_val(basisf_pntrs_in[k]->getNumberOfBasisFunctions());
     std::vector<double> tmp_der(tmp_val.size());
     bool inside=true;
-    basisf_pntrs_in[k]->getAllValues(args_values[k],args_values_trsfrm[k],inside,tmp_val,tmp_der);
+    basisf_pntrs_in[k]->getAllValuesCached(args_values[k],args_values_trsfrm[k],inside,tmp_val,tmp_der);
     bf_values.push_back(tmp_val);
   }
   //
@@ -555,24 +667,67 @@ void LinearBasisSetExpansion::restartTargetDistribution() {
 
 void LinearBasisSetExpansion::calculateTargetDistAveragesFromGrid(const Grid* targetdist_grid_pntr) {
   plumed_assert(targetdist_grid_pntr!=NULL);
-  std::vector<double> targetdist_averages(ncoeffs_,0.0);
+  // The averages are the integrals of the products of the basis functions weighted by the target distribution.
+  // As the basis functions are products over the dimensions and the grid is a tensor product of axes,
+  // the integral is done one dimension at a time, from tables of the basis functions on each axis,
+  // so that the product of all the basis functions is never formed at each grid point.
   std::vector<double> integration_weights = GridIntegrationWeights::getIntegrationWeights(targetdist_grid_pntr);
-  Grid::index_t stride=mycomm_.Get_size();
-  Grid::index_t rank=mycomm_.Get_rank();
-  for(Grid::index_t l=rank; l<targetdist_grid_pntr->getSize(); l+=stride) {
-    std::vector<double> args_values = targetdist_grid_pntr->getPoint(l);
-    std::vector<double> basisset_values(ncoeffs_);
-    // parallelization done over the grid -> should NOT use parallel in getBasisSetValues!!
-    getBasisSetValues(args_values,basisset_values,false);
-    double weight = integration_weights[l]*targetdist_grid_pntr->getValue(l);
-    for(unsigned int i=0; i<ncoeffs_; i++) {
-      targetdist_averages[i] += weight*basisset_values[i];
+  std::vector<unsigned> nbins = targetdist_grid_pntr->getNbin();
+  plumed_assert(nbins.size()==nargs_);
+  // weights of the grid points, with the first dimension as the fastest one
+  const Grid::index_t npoints = targetdist_grid_pntr->getSize();
+  std::vector<double> tensor(npoints);
+  std::vector<unsigned> indices(nargs_);
+  for(Grid::index_t l=0; l<npoints; l++) {
+    targetdist_grid_pntr->getIndices(l,indices);
+    size_t m=0;
+    for(unsigned int k=nargs_; k>0; k--) {m=m*nbins[k-1]+indices[k-1];}
+    tensor[m] = integration_weights[l]*targetdist_grid_pntr->getValue(l);
+  }
+  // values of the basis functions on the points of each axis
+  std::vector< std::vector<double> > axis_values(nargs_);
+  for(unsigned int k=0; k<nargs_; k++) {
+    const unsigned int nbf = basisf_pntrs_[k]->getNumberOfBasisFunctions();
+    axis_values[k].resize(nbins[k]*nbf);
+    std::vector<unsigned> point_indices(nargs_,0);
+    std::vector<double> tmp_val(nbf), tmp_der(nbf);
+    for(unsigned a=0; a<nbins[k]; a++) {
+      point_indices[k]=a;
+      std::vector<double> point = targetdist_grid_pntr->getPoint(targetdist_grid_pntr->getIndex(point_indices));
+      double argT; bool inside=true;
+      basisf_pntrs_[k]->getAllValuesCached(point[k],argT,inside,tmp_val,tmp_der);
+      std::copy(tmp_val.begin(),tmp_val.end(),axis_values[k].begin()+a*nbf);
     }
   }
-  mycomm_.Sum(targetdist_averages);
+  // after contracting the first k dimensions the tensor is indexed by the basis functions of
+  // the contracted dimensions (fastest) and then by the points of the remaining ones
+  size_t ncontracted=1;
+  size_t nrest=npoints;
+  for(unsigned int k=0; k<nargs_; k++) {
+    const size_t nk = nbins[k];
+    const size_t nbf = basisf_pntrs_[k]->getNumberOfBasisFunctions();
+    nrest/=nk;
+    std::vector<double> next(ncontracted*nbf*nrest,0.0);
+    const double* bk = axis_values[k].data();
+    #pragma omp parallel for num_threads(OpenMP::getNumThreads())
+    for(size_t r=0; r<nrest; r++) {
+      for(size_t a=0; a<nk; a++) {
+        const double* in = &tensor[(r*nk+a)*ncontracted];
+        for(size_t i=0; i<nbf; i++) {
+          const double f = bk[a*nbf+i];
+          if(f==0.0) {continue;}
+          double* out = &next[(r*nbf+i)*ncontracted];
+          for(size_t c=0; c<ncontracted; c++) {out[c]+=in[c]*f;}
+        }
+      }
+    }
+    tensor.swap(next);
+    ncontracted*=nbf;
+  }
+  plumed_assert(tensor.size()==ncoeffs_);
   // the overall constant;
-  targetdist_averages[0] = getBasisSetConstant();
-  TargetDistAverages() = targetdist_averages;
+  tensor[0] = getBasisSetConstant();
+  TargetDistAverages() = tensor;
 }
 
 
@@ -119,7 +119,7 @@ public:
   //
   void linkVesBias(VesBias*);
   void linkAction(Action*);
-  // calculate bias and derivatives
+  // calculate bias and derivatives, the derivatives with respect to the coeffs are skipped if the vector passed for them is empty
   static double getBiasAndForces(const std::vector<double>&, bool&, std::vector<double>&, std::vector<double>&, std::vector<BasisFunctions*>&, CoeffsVector*, Communicator* comm_in=NULL);
   double getBiasAndForces(const std::vector<double>&, bool&, std::vector<double>&, std::vector<double>&);
   double getBiasAndForces(const std::vector<double>&, bool&, std::vector<double>&);
@@ -186,6 +186,10 @@ public:
 private:
   //
   std::unique_ptr<Grid> setupGeneralGrid(const std::string&, const bool usederiv=false);
+  // bias and forces by contracting the coeffs one dimension at a time
+  static double contractBiasAndForces(std::vector<double>&, const std::vector< std::vector<double> >&, const std::vector< std::vector<double> >&, CoeffsVector*, const size_t, const size_t);
+  // bias and forces from the coeffs of the basis functions that are nonzero, for basis sets with local support
+  static double contractLocalSupport(std::vector<double>&, std::vector<double>&, const std::vector< std::vector<unsigned int> >&, const std::vector< std::vector<double> >&, const std::vector< std::vector<double> >&, CoeffsVector*, const size_t, const size_t);
   //
   void calculateTargetDistAveragesFromGrid(const Grid*);
   //
@@ -201,7 +205,7 @@ double LinearBasisSetExpansion::getBiasAndForces(const std::vector<double>& args
 
 inline
 double LinearBasisSetExpansion::getBiasAndForces(const std::vector<double>& args_values, bool& all_inside, std::vector<double>& forces) {
-  std::vector<double> coeffsderivs_values_dummy(ncoeffs_);
+  std::vector<double> coeffsderivs_values_dummy;
   return getBiasAndForces(args_values,all_inside,forces,coeffsderivs_values_dummy,basisf_pntrs_, bias_coeffs_pntr_, &mycomm_);
 }
 
@@ -209,7 +213,7 @@ double LinearBasisSetExpansion::getBiasAndForces(const std::vector<double>& args
 inline
 double LinearBasisSetExpansion::getBias(const std::vector<double>& args_values, bool& all_inside, const bool parallel) {
   std::vector<double> forces_dummy(nargs_);
-  std::vector<double> coeffsderivs_values_dummy(ncoeffs_);
+  std::vector<double> coeffsderivs_values_dummy;
   if(parallel) {
     return getBiasAndForces(args_values,all_inside,forces_dummy,coeffsderivs_values_dummy,basisf_pntrs_, bias_coeffs_pntr_, &mycomm_);
   }
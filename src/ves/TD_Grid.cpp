@@ -27,6 +27,8 @@
 
 #include "core/ActionRegister.h"
 #include "tools/Grid.h"
+#include "tools/MappedGrid.h"
+#include "tools/Communicator.h"
 #include "core/Value.h"
 #include "tools/File.h"
 
@@ -96,6 +98,15 @@ is shown below:
    1.3200   0.3948   7.1055
 \endauxfile
 
+Large grids can be stored in a binary file that is memory mapped read-only
+and shared by all the processes running on the same node. With MAPPED_FILE the
+grid file is converted once to the given binary file, which is then used
+in this and in the following runs. The binary file is not updated when the grid
+file changes, so it should be removed in that case.
+\plumedfile
+td: TD_GRID FILE=input-grid.data MAPPED_FILE=input-grid.bin
+\endplumedfile
+
 */
 //+ENDPLUMEDOC
 
@@ -107,6 +118,7 @@ class TD_Grid : public TargetDistribution {
   std::vector<bool> periodic_;
   bool zero_outside_;
   double shift_;
+  std::unique_ptr<GridBase> readGridFile(const std::string&);
 public:
   static void registerKeywords( Keywords&);
   explicit TD_Grid(const ActionOptions& ao);
@@ -120,6 +132,7 @@ PLUMED_REGISTER_ACTION(TD_Grid,"TD_GRID")
 void TD_Grid::registerKeywords(Keywords& keys) {
   TargetDistribution::registerKeywords(keys);
   keys.add("compulsory","FILE","The name of the external grid file to be used as a target distribution.");
+  keys.add("optional","MAPPED_FILE","A binary copy of the grid in FILE that is memory mapped read-only and shared by the processes on a node. It is written from FILE if it does not exist.");
   keys.add("optional","SHIFT","Shift the grid read in by some constant value. Due to normalization the final shift in the target distribution will generally not be the same as the value given here");
   keys.addFlag("ZERO_OUTSIDE",false,"By default the target distribution is continuous such that values outside the boundary of the external grid file are the same as at the boundary. This can be changed by using this flag which will make values outside to be taken as zero.");
   keys.addFlag("DO_NOT_NORMALIZE",false,"By default the target distribution from the external grid is always normalized inside the code. You can use this flag to disable this normalization. However, be warned that this will generally lead to the wrong behavior if the distribution from the external grid is not properly normalized to 1.");
@@ -147,8 +160,43 @@ TD_Grid::TD_Grid(const ActionOptions& ao):
   if(do_not_normalize && shift_!=0.0) {plumed_merror(getName() + ": using both SHIFT and DO_NOT_NORMALIZE is not allowed.");}
   if(!do_not_normalize) {setForcedNormalization();}
 
+  std::string mappedname;
+  parse("MAPPED_FILE",mappedname);
+
   checkRead();
 
+  if(MappedGrid::isBinary(filename)) {
+    if(mappedname.length()>0 && mappedname!=filename) {plumed_merror(getName() + ": MAPPED_FILE cannot be used when FILE is already a binary grid file");}
+    mappedname=filename;
+  }
+
+  if(mappedname.length()>0) {
+    if(mappedname!=filename) {
+      // the binary file is written once, the other processes wait for it
+      if(comm.Get_rank()==0 && !MappedGrid::isBinary(mappedname)) {MappedGrid::write(mappedname,*readGridFile(filename));}
+      comm.Barrier();
+    }
+    distGrid_=Tools::make_unique<MappedGrid>(mappedname,false);
+  }
+  else {
+    distGrid_=readGridFile(filename);
+  }
+  setDimension(distGrid_->getDimension());
+
+  minima_.resize(getDimension());
+  maxima_.resize(getDimension());
+  periodic_.resize(getDimension());
+  for (unsigned int i=0; i < getDimension(); i++) {
+    Tools::convert(distGrid_->getMin()[i],minima_[i]);
+    Tools::convert(distGrid_->getMax()[i],maxima_[i]);
+    periodic_[i] = distGrid_->getIsPeriodic()[i];
+    if(periodic_[i]) {maxima_[i]-=distGrid_->getDx()[i];}
+  }
+
+}
+
+
+std::unique_ptr<GridBase> TD_Grid::readGridFile(const std::string& filename) {
   std::string gridlabel;
   std::vector<std::string> arglabels;
   std::vector<std::string> argmin;
@@ -161,7 +209,6 @@ TD_Grid::TD_Grid(const ActionOptions& ao):
     plumed_merror(getName() + ": problem in parsing information from grid file");
   }
 
-  setDimension(arglabels.size());
   std::vector<std::unique_ptr<Value>> arguments(arglabels.size());
   for(unsigned int i=0; i < arglabels.size(); i++) {
     arguments[i]= Tools::make_unique<Value>(nullptr,arglabels[i],false);
@@ -173,26 +220,16 @@ TD_Grid::TD_Grid(const ActionOptions& ao):
     }
   }
 
+  std::unique_ptr<GridBase> grid;
   IFile gridfile; gridfile.open(filename);
   if(has_deriv) {
-    distGrid_=GridBase::create(gridlabel,Tools::unique2raw(arguments),gridfile,false,true,true);
+    grid=GridBase::create(gridlabel,Tools::unique2raw(arguments),gridfile,false,true,true);
   }
   else {
-    distGrid_=GridBase::create(gridlabel,Tools::unique2raw(arguments),gridfile,false,false,false);
+    grid=GridBase::create(gridlabel,Tools::unique2raw(arguments),gridfile,false,false,false);
   }
   gridfile.close();
-
-
-  minima_.resize(getDimension());
-  maxima_.resize(getDimension());
-  periodic_.resize(getDimension());
-  for (unsigned int i=0; i < getDimension(); i++) {
-    Tools::convert(distGrid_->getMin()[i],minima_[i]);
-    Tools::convert(distGrid_->getMax()[i],maxima_[i]);
-    periodic_[i] = argperiodic[i];
-    if(periodic_[i]) {maxima_[i]-=distGrid_->getDx()[i];}
-  }
-
+  return grid;
 }
 
 
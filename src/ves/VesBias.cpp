@@ -407,17 +407,23 @@ bool VesBias::readCoeffsFromFiles() {
 void VesBias::updateGradientAndHessian(const bool use_mwalkers_mpi) {
   for(unsigned int k=0; k<ncoeffssets_; k++) {
     //
-    comm.Sum(sampled_averages[k]);
-    comm.Sum(sampled_cross_averages[k]);
+    // the cross averages are only needed for the Hessian
+    size_t nsum = packSampledAverages(k);
+    comm.Sum(reduction_buffer_.data(),nsum);
+    unsigned int total_samples = aver_counters[k];
     if(use_mwalkers_mpi) {
       double walker_weight=1.0;
       if(aver_counters[k]==0) {walker_weight=0.0;}
-      multiSimSumAverages(k,walker_weight);
+      multiSimSumAverages(k,walker_weight,total_samples);
+    } else {
+      unpackSampledAverages(k,1.0);
     }
     // NOTE: this assumes that all walkers have the same TargetDist, might change later on!!
     Gradient(k).setValues( TargetDistAverages(k) - sampled_averages[k] );
-    Hessian(k) = computeCovarianceFromAverages(k);
-    Hessian(k) *= getBeta();
+    if(compute_hessian_) {
+      Hessian(k) = computeCovarianceFromAverages(k);
+      Hessian(k) *= getBeta();
+    }
 
     if(optimization_threshold_ != 0.0) {
       for(size_t c_id=0; c_id < sampled_averages[k].size(); ++c_id) {
@@ -433,11 +439,6 @@ void VesBias::updateGradientAndHessian(const bool use_mwalkers_mpi) {
     //
     // Check the total number of samples (from all walkers) and deactivate the Gradient and Hessian if it
     // is zero
-    unsigned int total_samples = aver_counters[k];
-    if(use_mwalkers_mpi) {
-      if(comm.Get_rank()==0) {multi_sim_comm.Sum(total_samples);}
-      comm.Bcast(total_samples,0);
-    }
     if(total_samples==0) {
       Gradient(k).deactivate();
       Gradient(k).clear();
@@ -452,32 +453,48 @@ void VesBias::updateGradientAndHessian(const bool use_mwalkers_mpi) {
 }
 
 
-void VesBias::multiSimSumAverages(const unsigned int c_id, const double walker_weight) {
-  plumed_massert(walker_weight>=0.0,"the weight of the walker cannot be negative!");
-  if(walker_weight!=1.0) {
-    for(size_t i=0; i<sampled_averages[c_id].size(); i++) {
-      sampled_averages[c_id][i] *= walker_weight;
-    }
-    for(size_t i=0; i<sampled_cross_averages[c_id].size(); i++) {
-      sampled_cross_averages[c_id][i] *= walker_weight;
-    }
+size_t VesBias::packSampledAverages(const unsigned int c_id) {
+  const size_t naver = sampled_averages[c_id].size();
+  const size_t ncross = compute_hessian_ ? sampled_cross_averages[c_id].size() : 0;
+  // two extra slots for the weight of the walker and the number of samples
+  reduction_buffer_.resize(naver+ncross+2);
+  std::copy(sampled_averages[c_id].begin(),sampled_averages[c_id].end(),reduction_buffer_.begin());
+  std::copy(sampled_cross_averages[c_id].begin(),sampled_cross_averages[c_id].begin()+ncross,reduction_buffer_.begin()+naver);
+  return naver+ncross;
+}
+
+
+void VesBias::unpackSampledAverages(const unsigned int c_id, const double norm_weights) {
+  const size_t naver = sampled_averages[c_id].size();
+  const size_t ncross = compute_hessian_ ? sampled_cross_averages[c_id].size() : 0;
+  for(size_t i=0; i<naver; i++) {
+    sampled_averages[c_id][i] = norm_weights*reduction_buffer_[i];
   }
-  //
+  for(size_t i=0; i<ncross; i++) {
+    sampled_cross_averages[c_id][i] = norm_weights*reduction_buffer_[naver+i];
+  }
+}
+
+
+void VesBias::multiSimSumAverages(const unsigned int c_id, const double walker_weight, unsigned int& total_samples) {
+  plumed_massert(walker_weight>=0.0,"the weight of the walker cannot be negative!");
+  // the averages, the weights and the number of samples of all the walkers are summed with a single reduction
+  const size_t nsum = reduction_buffer_.size()-2;
   if(comm.Get_rank()==0) {
-    multi_sim_comm.Sum(sampled_averages[c_id]);
-    multi_sim_comm.Sum(sampled_cross_averages[c_id]);
-    double norm_weights = walker_weight;
-    multi_sim_comm.Sum(norm_weights);
-    if(norm_weights>0.0) {norm_weights=1.0/norm_weights;}
-    for(size_t i=0; i<sampled_averages[c_id].size(); i++) {
-      sampled_averages[c_id][i] *= norm_weights;
-    }
-    for(size_t i=0; i<sampled_cross_averages[c_id].size(); i++) {
-      sampled_cross_averages[c_id][i] *= norm_weights;
+    if(walker_weight!=1.0) {
+      for(size_t i=0; i<nsum; i++) {
+        reduction_buffer_[i] *= walker_weight;
+      }
     }
+    reduction_buffer_[nsum] = walker_weight;
+    reduction_buffer_[nsum+1] = static_cast<double>(total_samples);
+    multi_sim_comm.Sum(reduction_buffer_);
   }
-  comm.Bcast(sampled_averages[c_id],0);
-  comm.Bcast(sampled_cross_averages[c_id],0);
+  comm.Bcast(reduction_buffer_,0);
+  double norm_weights = reduction_buffer_[nsum];
+  if(norm_weights>0.0) {norm_weights=1.0/norm_weights;}
+  unpackSampledAverages(c_id,norm_weights);
+  total_samples = static_cast<unsigned int>(reduction_buffer_[nsum+1]+0.5);
 }
 
 
@@ -489,17 +506,14 @@ void VesBias::addToSampledAverages(const std::vector<double>& values, const unsi
   */
   double counter_dbl = static_cast<double>(aver_counters[c_id]);
   size_t ncoeffs = numberOfCoeffs(c_id);
-  std::vector<double> deltas(ncoeffs,0.0);
   size_t stride = comm.Get_size();
   size_t rank = comm.Get_rank();
   // update average and diagonal part of Hessian
   for(size_t i=rank; i<ncoeffs; i+=stride) {
     size_t midx = getHessianIndex(i,i,c_id);
-    deltas[i] = (values[i]-sampled_averages[c_id][i])/(counter_dbl+1); // (x[n+1]-xm[n])/(n+1)
-    sampled_averages[c_id][i] += deltas[i];
+    sampled_averages[c_id][i] += (values[i]-sampled_averages[c_id][i])/(counter_dbl+1); // (x[n+1]-xm[n])/(n+1)
     sampled_cross_averages[c_id][midx] += (values[i]*values[i]-sampled_cross_averages[c_id][midx])/(counter_dbl+1);
   }
-  comm.Sum(deltas);
   // update off-diagonal part of the Hessian
   if(!diagonal_hessian_) {
     for(size_t i=rank; i<ncoeffs; i+=stride) {
@@ -68,6 +68,8 @@ private:
   std::vector<std::unique_ptr<CoeffsMatrix>> hessian_pntrs_;
   std::vector<std::vector<double> > sampled_averages;
   std::vector<std::vector<double> > sampled_cross_averages;
+  // buffer used to sum the sampled averages over the processes and the walkers
+  std::vector<double> reduction_buffer_;
   bool use_multiple_coeffssets_;
   //
   std::vector<std::string> coeffs_fnames;
@@ -124,7 +126,9 @@ private:
 private:
   void initializeCoeffs(std::unique_ptr<CoeffsVector>);
   std::vector<double> computeCovarianceFromAverages(const unsigned int) const;
-  void multiSimSumAverages(const unsigned int, const double walker_weight=1.0);
+  void multiSimSumAverages(const unsigned int, const double walker_weight, unsigned int& total_samples);
+  size_t packSampledAverages(const unsigned int);
+  void unpackSampledAverages(const unsigned int, const double);
 protected:
   //
   void checkThatTemperatureIsGiven();
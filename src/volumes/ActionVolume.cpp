@@ -67,6 +67,13 @@ void ActionVolume::requestAtoms( const std::vector<AtomNumber> & a ) {
   if( getPntrToComponent(0)->getRank()==0 ) getPntrToComponent(0)->resizeDerivatives( 3*getNumberOfAtoms()+9 );
 }
 
+double ActionVolume::getKernelRange() const {
+  // 0.5*erfc(8.5/sqrt(2)) is well below epsilon, the triangular kernel vanishes exactly
+  if( kerneltype=="gaussian" ) return 8.5*sigma;
+  else if( kerneltype=="triangular" ) return sigma;
+  return std::numeric_limits<double>::max();
+}
+
 void ActionVolume::areAllTasksRequired( std::vector<ActionWithVector*>& task_reducing_actions ) {
   task_reducing_actions.push_back(this);
 }
@@ -76,6 +83,7 @@ void ActionVolume::getNumberOfTasks( unsigned& ntasks ) {
 }
 
 int ActionVolume::checkTaskStatus( const unsigned& taskno, int& flag ) const {
+  if( !not_in && isFarFromRegion( ActionAtomistic::getPosition(taskno) ) ) return 0;
   unsigned nref=getNumberOfAtoms()-getConstPntrToComponent(0)->getShape()[0];
   Vector wdf; Tensor vir; std::vector<Vector> refders( nref );
   double weight=calculateNumberInside( ActionAtomistic::getPosition(taskno), wdf, vir, refders );
@@ -108,6 +116,12 @@ void ActionVolume::calculate() {
 }
 
 void ActionVolume::performTask( const unsigned& curr, MultiValue& outvals ) const {
+  unsigned ostrn = getConstPntrToComponent(0)->getPositionInStream();
+  // Atoms far from the region have a constant weight and negligible derivatives
+  if( isFarFromRegion( ActionAtomistic::getPosition(curr) ) ) {
+    outvals.setValue( ostrn, not_in ? 1.0 : 0.0 );
+    return;
+  }
   unsigned nref=getNumberOfAtoms()-getConstPntrToComponent(0)->getShape()[0];
   Vector wdf; Tensor vir; std::vector<Vector> refders( nref );
   double weight=calculateNumberInside( ActionAtomistic::getPosition(curr), wdf, vir, refders );
@@ -116,7 +130,6 @@ void ActionVolume::performTask( const unsigned& curr, MultiValue& outvals ) cons
     weight = 1.0 - weight; wdf *= -1.; vir *=-1;
     for(unsigned i=0; i<refders.size(); ++i) refders[i]*=-1;
   }
-  unsigned ostrn = getConstPntrToComponent(0)->getPositionInStream();
   outvals.setValue( ostrn, weight );
 
   if( doNotCalculateDerivatives() ) return;
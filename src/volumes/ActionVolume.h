@@ -48,6 +48,10 @@ protected:
   std::string getKernelType() const ;
   Vector getPosition( const unsigned& index ) const ;
   void requestAtoms( const std::vector<AtomNumber> & a );
+/// Distance from the edges of a bin beyond which the kernel contributes less than epsilon
+  double getKernelRange() const ;
+/// Check if x is so far from the bin between lo and hi that the kernel contribution is negligible
+  bool isOutsideBin( const double& x, const double& lo, const double& hi ) const ;
 public:
   static void registerKeywords( Keywords& keys );
   explicit ActionVolume(const ActionOptions&);
@@ -55,11 +59,15 @@ public:
   void areAllTasksRequired( std::vector<ActionWithVector*>& task_reducing_actions ) override;
   void getNumberOfTasks( unsigned& ntasks ) override ;
   int checkTaskStatus( const unsigned& taskno, int& flag ) const override;
+  bool checkTaskStatusIsUnchanged() const override { return false; }
   void calculate();
   virtual void setupRegions() = 0;
   bool isInSubChain( unsigned& nder ) override ;
   void performTask( const unsigned&, MultiValue& ) const ;
   virtual double calculateNumberInside( const Vector& cpos, Vector& derivatives, Tensor& vir, std::vector<Vector>& refders ) const=0;
+/// Cheap test that returns true only if the atom at cpos is certainly outside the region, i.e. if
+/// calculateNumberInside would return a number below epsilon. It is used to discard tasks quickly.
+  virtual bool isFarFromRegion( const Vector& ) const { return false; }
 };
 
 inline
@@ -77,6 +85,12 @@ std::string ActionVolume::getKernelType() const {
   return kerneltype;
 }
 
+inline
+bool ActionVolume::isOutsideBin( const double& x, const double& lo, const double& hi ) const {
+  const double range=getKernelRange();
+  return x<std::min(lo,hi)-range || x>std::max(lo,hi)+range;
+}
+
 inline
 Vector ActionVolume::getPosition( const unsigned& index ) const {
   if( getConstPntrToComponent(0)->getRank()==0 ) return ActionAtomistic::getPosition( 1 + index );
@@ -88,6 +88,7 @@ public:
   explicit VolumeAround(const ActionOptions& ao);
   void setupRegions() override;
   double calculateNumberInside( const Vector& cpos, Vector& derivatives, Tensor& vir, std::vector<Vector>& refders ) const override;
+  bool isFarFromRegion( const Vector& cpos ) const override;
 };
 
 PLUMED_REGISTER_ACTION(VolumeAround,"AROUND_CALC")
@@ -129,6 +130,13 @@ VolumeAround::VolumeAround(const ActionOptions& ao):
 
 void VolumeAround::setupRegions() { }
 
+bool VolumeAround::isFarFromRegion( const Vector& cpos ) const {
+  Vector fpos=pbcDistance( getPosition(0), cpos );
+  return ( dox && isOutsideBin( fpos[0], xlow, xhigh ) ) ||
+         ( doy && isOutsideBin( fpos[1], ylow, yhigh ) ) ||
+         ( doz && isOutsideBin( fpos[2], zlow, zhigh ) );
+}
+
 double VolumeAround::calculateNumberInside( const Vector& cpos, Vector& derivatives, Tensor& vir, std::vector<Vector>& refders ) const {
   // Setup the histogram bead
   HistogramBead bead; bead.isNotPeriodic(); bead.setKernelType( getKernelType() );
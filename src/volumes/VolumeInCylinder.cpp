@@ -92,6 +92,7 @@ public:
   explicit VolumeInCylinder (const ActionOptions& ao);
   void setupRegions() override;
   double calculateNumberInside( const Vector& cpos, Vector& derivatives, Tensor& vir, std::vector<Vector>& refders ) const override;
+  bool isFarFromRegion( const Vector& cpos ) const override;
 };
 
 PLUMED_REGISTER_ACTION(VolumeInCylinder,"INCYLINDER_CALC")
@@ -145,6 +146,12 @@ VolumeInCylinder::VolumeInCylinder(const ActionOptions& ao):
 
 void VolumeInCylinder::setupRegions() { }
 
+bool VolumeInCylinder::isFarFromRegion( const Vector& cpos ) const {
+  Vector fpos=pbcDistance( getPosition(0), cpos );
+  if( docylinder && isOutsideBin( fpos[dir[2]], bead.getlowb(), bead.getbigb() ) ) return true;
+  return fpos[dir[0]]*fpos[dir[0]] + fpos[dir[1]]*fpos[dir[1]]>switchingFunction.get_dmax2();
+}
+
 double VolumeInCylinder::calculateNumberInside( const Vector& cpos, Vector& derivatives, Tensor& vir, std::vector<Vector>& refders ) const {
   // Calculate position of atom wrt to origin
   Vector fpos=pbcDistance( getPosition(0), cpos );
@@ -88,6 +88,7 @@ public:
   explicit VolumeInSphere(const ActionOptions& ao);
   void setupRegions() override;
   double calculateNumberInside( const Vector& cpos, Vector& derivatives, Tensor& vir, std::vector<Vector>& refders ) const override;
+  bool isFarFromRegion( const Vector& cpos ) const override;
 };
 
 PLUMED_REGISTER_ACTION(VolumeInSphere,"INSPHERE_CALC")
@@ -123,6 +124,10 @@ VolumeInSphere::VolumeInSphere(const ActionOptions& ao):
 
 void VolumeInSphere::setupRegions() { }
 
+bool VolumeInSphere::isFarFromRegion( const Vector& cpos ) const {
+  return pbcDistance( getPosition(0), cpos ).modulo2()>switchingFunction.get_dmax2();
+}
+
 double VolumeInSphere::calculateNumberInside( const Vector& cpos, Vector& derivatives, Tensor& vir, std::vector<Vector>& refders ) const {
   // Calculate position of atom wrt to origin
   Vector fpos=pbcDistance( getPosition(0), cpos );
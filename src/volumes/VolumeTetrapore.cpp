@@ -139,6 +139,7 @@ public:
   void setupRegions() override;
   void update() override;
   double calculateNumberInside( const Vector& cpos, Vector& derivatives, Tensor& vir, std::vector<Vector>& refders ) const override;
+  bool isFarFromRegion( const Vector& cpos ) const override;
 };
 
 PLUMED_REGISTER_ACTION(VolumeTetrapore,"TETRAHEDRALPORE_CALC")
@@ -399,6 +400,13 @@ void VolumeTetrapore::update() {
   }
 }
 
+bool VolumeTetrapore::isFarFromRegion( const Vector& cpos ) const {
+  Vector datom=pbcDistance( origin, cpos );
+  return isOutsideBin( dotProduct( datom, bi ), 0, len_bi ) ||
+         isOutsideBin( dotProduct( datom, cross ), 0, len_cross ) ||
+         isOutsideBin( dotProduct( datom, perp ), 0, len_perp );
+}
+
 double VolumeTetrapore::calculateNumberInside( const Vector& cpos, Vector& derivatives, Tensor& vir, std::vector<Vector>& rderiv ) const {
   // Setup the histogram bead
   HistogramBead bead; bead.isNotPeriodic(); bead.setKernelType( getKernelType() );
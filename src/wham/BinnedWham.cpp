@@ -0,0 +1,230 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2024 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "core/ActionPilot.h"
+#include "core/ActionRegister.h"
+#include "core/Checkpoint.h"
+#include "gridtools/ActionWithGrid.h"
+#include <algorithm>
+#include <limits>
+
+//+PLUMEDOC REWEIGHTING BINNED_WHAM
+/*
+Calculate a histogram on the fly using the binned weighted histogram analysis method.
+
+This action computes the same histogram as \ref WHAM_HISTOGRAM with KERNEL=DISCRETE but the time series of the biases is not stored.
+Instead, for each bin of the histogram, the number of frames that fell in the bin and the sum of the exponentials
+of the biases of all the replicas over these frames are accumulated as the simulation proceeds.  The WHAM equations (see \ref WHAM) are then solved using the
+average of the exponential of each bias over the frames in each bin in place of the values for the individual frames.  The memory used thus depends
+on the number of bins and replicas and not on the length of the trajectory.  The solution found at one step is used as the starting point for the
+iterations at the next step, so only a few iterations are usually needed.
+
+The result is the same as that of binless WHAM if the biases are constant within each bin.  Frames that are outside the grid are ignored.
+
+\par Examples
+
+This action is used by \ref WHAM_HISTOGRAM when the ONLINE flag is present.  The following input thus accumulates the
+histogram for the torsion phi from four umbrella sampling simulations without storing the trajectory.
+
+\plumedfile
+#SETTINGS NREPLICAS=4
+phi: TORSION ATOMS=5,7,9,15
+rp: RESTRAINT ARG=phi KAPPA=50.0 AT=@replicas:{-3.00,-1.45,0.10,1.65}
+hh: WHAM_HISTOGRAM ARG=phi BIAS=rp.bias TEMP=300 GRID_MIN=-pi GRID_MAX=pi GRID_BIN=50 ONLINE
+fes: CONVERT_TO_FES GRID=hh TEMP=300
+DUMPGRID GRID=fes FILE=fes.dat
+\endplumedfile
+
+*/
+//+ENDPLUMEDOC
+
+namespace PLMD {
+namespace wham {
+
+class BinnedWham :
+  public gridtools::ActionWithGrid,
+  public ActionPilot {
+private:
+  double thresh, simtemp;
+  unsigned maxiter, nargs, nreplicas;
+  gridtools::GridCoordinatesObject gridobject;
+/// The number of frames in each bin
+  std::vector<double> counts;
+/// The logarithm of the largest exponential of the bias in each bin.  The sums of the exponentials are stored relative to this value to avoid overflows
+  std::vector<double> logmax;
+/// The sums of the exponentials of the biases of all the replicas for each bin
+  std::vector<double> expsum;
+/// The logarithms of the normalizations of the biased distributions from the last time the equations were solved
+  std::vector<double> logZ;
+/// The sums over replicas for each bin
+  std::vector<double> rowsum;
+/// Solve the WHAM equations starting from the current value of logZ
+  void solve();
+public:
+  static void registerKeywords(Keywords&);
+  explicit BinnedWham(const ActionOptions&ao);
+  unsigned getNumberOfDerivatives() override { return gridobject.getDimension(); }
+  bool calculateOnUpdate() override { return false; }
+  bool calculateConstantValues( const bool& /*have_atoms*/ ) override { return false; }
+  void calculate() override {}
+  void apply() override {}
+  void update() override ;
+  void setupOnFirstStep( const bool /*incalc*/ ) override {}
+  void performTask( const unsigned& /*current*/, MultiValue& /*myvals*/ ) const override { plumed_merror("should not be in BinnedWham performTask"); }
+  std::vector<std::string> getGridCoordinateNames() const override ;
+  const gridtools::GridCoordinatesObject& getGridCoordinatesObject() const override { return gridobject; }
+  void writeCheckpoint( std::ostream& o ) override ;
+  void readCheckpoint( std::istream& i ) override ;
+};
+
+PLUMED_REGISTER_ACTION(BinnedWham,"BINNED_WHAM")
+
+void BinnedWham::registerKeywords(Keywords& keys ) {
+  gridtools::ActionWithGrid::registerKeywords( keys ); ActionPilot::registerKeywords( keys ); keys.remove("SERIAL");
+  keys.addInputKeyword("compulsory","ARG","scalar","the arguments that you would like to make the histogram for");
+  keys.addInputKeyword("compulsory","BIAS","scalar/vector","the values of the biases of all the replicas for the current configuration");
+  keys.add("compulsory","STRIDE","1","the frequency with which the data should be added to the histogram");
+  keys.add("compulsory","GRID_MIN","the minimum to use for the grid");
+  keys.add("compulsory","GRID_MAX","the maximum to use for the grid");
+  keys.add("compulsory","GRID_BIN","the number of bins to use for the grid");
+  keys.add("compulsory","MAXITER","1000","maximum number of iterations for WHAM algorithm");
+  keys.add("compulsory","WHAMTOL","1e-10","threshold for convergence of WHAM algorithm");
+  keys.add("optional","TEMP","the system temperature.  This is not required if your MD code passes this quantity to PLUMED");
+  keys.setValueDescription("grid","the histogram that was generated using the WHAM weights");
+}
+
+BinnedWham::BinnedWham(const ActionOptions&ao):
+  Action(ao),
+  ActionWithGrid(ao),
+  ActionPilot(ao),
+  nargs(getNumberOfArguments()),
+  nreplicas(0)
+{
+  simtemp=getkBT();
+  if(simtemp==0) error("The MD engine does not pass the temperature to plumed so you have to specify it using TEMP");
+  parse("MAXITER",maxiter); parse("WHAMTOL",thresh);
+  // Read in the biases
+  std::vector<Value*> bvals; parseArgumentList("BIAS",bvals);
+  for(unsigned i=0; i<bvals.size(); ++i) { bvals[i]->buildDataStore(); nreplicas += bvals[i]->getNumberOfValues(); }
+  log.printf("  solving WHAM equations for %u biases \n", nreplicas );
+  std::vector<Value*> args( getArguments() ); args.insert( args.end(), bvals.begin(), bvals.end() ); requestArguments( args );
+  // Setup the grid
+  std::vector<std::string> gmin( nargs ), gmax( nargs ); parseVector("GRID_MIN",gmin); parseVector("GRID_MAX",gmax);
+  std::vector<unsigned> gbin( nargs ); parseVector("GRID_BIN",gbin);
+  std::vector<bool> ipbc( nargs );
+  for(unsigned i=0; i<nargs; ++i) {
+    ipbc[i] = getPntrToArgument(i)->isPeriodic();
+    if( ipbc[i] ) {
+      std::string str_min, str_max; getPntrToArgument(i)->getDomain( str_min, str_max );
+      if( gmin[i]!=str_min || gmax[i]!=str_max ) error("all periodic arguments should have the same domain as the grid");
+    }
+  }
+  gridobject.setup( "flat", ipbc, 0, 0.0 ); std::vector<double> gspacing; gridobject.setBounds( gmin, gmax, gbin, gspacing );
+  std::vector<unsigned> shape( gridobject.getNbin(true) );
+  addValueWithDerivatives( shape ); setNotPeriodic(); getPntrToComponent(0)->setDerivativeIsZeroWhenValueIsZero();
+  unsigned npoints = getPntrToComponent(0)->getNumberOfValues();
+  counts.assign( npoints, 0 ); logmax.assign( npoints, 0 ); expsum.assign( npoints*nreplicas, 0 ); rowsum.resize( npoints );
+  logZ.assign( nreplicas, -std::log( static_cast<double>(nreplicas) ) );
+}
+
+std::vector<std::string> BinnedWham::getGridCoordinateNames() const {
+  std::vector<std::string> names( nargs );
+  for(unsigned i=0; i<nargs; ++i) names[i] = getPntrToArgument(i)->getName();
+  return names;
+}
+
+void BinnedWham::update() {
+  if( getStep()==0 ) return;
+  // Find the bin
+  std::vector<double> point( nargs );
+  for(unsigned i=0; i<nargs; ++i) point[i] = getPntrToArgument(i)->get();
+  if( !gridobject.inbounds( point ) ) return;
+  // Each frame is assigned to the nearest grid point as is done for the DISCRETE kernel in KDE
+  for(unsigned i=0; i<nargs; ++i) point[i] += 0.5*gridobject.getGridSpacing()[i];
+  unsigned ibin = gridobject.getIndex( point );
+  // Get the exponents of the biases
+  std::vector<double> logv( nreplicas ); unsigned k=0;
+  for(unsigned i=nargs; i<getNumberOfArguments(); ++i) {
+    Value* myarg = getPntrToArgument(i);
+    for(unsigned j=0; j<myarg->getNumberOfValues(); ++j) { logv[k] = -myarg->get(j) / simtemp; k++; }
+  }
+  double maxv = *std::max_element( logv.begin(), logv.end() );
+  // Rescale the sums for this bin if the new exponentials are larger than all those seen so far
+  double* bsum = expsum.data() + std::size_t(ibin)*nreplicas;
+  if( counts[ibin]==0 ) logmax[ibin] = maxv;
+  else if( maxv>logmax[ibin] ) {
+    double scale = std::exp( logmax[ibin] - maxv );
+    for(unsigned j=0; j<nreplicas; ++j) bsum[j] *= scale;
+    logmax[ibin] = maxv;
+  }
+  for(unsigned j=0; j<nreplicas; ++j) bsum[j] += std::exp( logv[j] - logmax[ibin] );
+  counts[ibin] += 1;
+  solve();
+}
+
+void BinnedWham::solve() {
+  unsigned npoints = counts.size();
+  std::vector<double> invZ( nreplicas ), Z( nreplicas );
+  for(unsigned iter=0; iter<maxiter; ++iter) {
+    // The probability of bin b is counts[b]^2 exp(-logmax[b]) / rowsum[b] and the sums for Z do not depend on logmax
+    for(unsigned k=0; k<nreplicas; ++k) { invZ[k] = std::exp( -logZ[k] ); Z[k] = 0; }
+    for(unsigned b=0; b<npoints; ++b) {
+      if( counts[b]==0 ) continue;
+      const double* bsum = expsum.data() + std::size_t(b)*nreplicas;
+      double ew=0; for(unsigned k=0; k<nreplicas; ++k) ew += bsum[k]*invZ[k];
+      rowsum[b]=ew; double pref = counts[b] / ew;
+      for(unsigned k=0; k<nreplicas; ++k) Z[k] += pref*bsum[k];
+    }
+    // Normalize Z and compute change in Z
+    double norm=0; for(unsigned k=0; k<nreplicas; ++k) norm+=Z[k];
+    double change=0;
+    for(unsigned k=0; k<nreplicas; ++k) {
+      double newlogZ = std::log( Z[k] / norm ); double d = newlogZ - logZ[k];
+      change += d*d; logZ[k] = newlogZ;
+    }
+    if( change<thresh ) {
+      // Compute the normalized probabilities of the bins from the sums in the last iteration
+      double maxp=-std::numeric_limits<double>::max();
+      for(unsigned b=0; b<npoints; ++b) {
+        if( counts[b]==0 ) continue;
+        rowsum[b] = 2*std::log( counts[b] ) - logmax[b] - std::log( rowsum[b] );
+        maxp = std::max( maxp, rowsum[b] );
+      }
+      double pnorm=0; for(unsigned b=0; b<npoints; ++b) if( counts[b]>0 ) pnorm += std::exp( rowsum[b] - maxp );
+      double lognorm = maxp + std::log( pnorm ); Value* myval = getPntrToComponent(0);
+      for(unsigned b=0; b<npoints; ++b) myval->set( b, counts[b]>0 ? std::exp( rowsum[b] - lognorm ) : 0.0 );
+      return;
+    }
+  }
+  error("Too many iterations in WHAM" );
+}
+
+void BinnedWham::writeCheckpoint( std::ostream& o ) {
+  checkpoint::write( o, counts ); checkpoint::write( o, logmax ); checkpoint::write( o, expsum ); checkpoint::write( o, logZ );
+}
+
+void BinnedWham::readCheckpoint( std::istream& i ) {
+  checkpoint::read( i, counts ); checkpoint::read( i, logmax ); checkpoint::read( i, expsum ); checkpoint::read( i, logZ );
+  if( counts.size()!=rowsum.size() || logZ.size()!=nreplicas ) error("size of histogram in checkpoint does not match the input");
+}
+
+}
+}
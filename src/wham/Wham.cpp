@@ -24,6 +24,9 @@
 #include "core/ActionWithArguments.h"
 #include "core/PlumedMain.h"
 #include "tools/Communicator.h"
+#include "tools/Matrix.h"
+#include "tools/OpenMP.h"
+#include <limits>
 
 //+PLUMEDOC REWEIGHTING WHAM
 /*
@@ -69,6 +72,11 @@ Notice that only \f$\sum_k t_{kj}\f$, which is the total number of configuration
 There is thus no need to record which replica generated each of the frames.  One can thus simply gather the trajectories from all the replicas together at the outset.
 This observation is important as it is the basis of the binless formulation of WHAM that is implemented within PLUMED.
 
+The exponentials of the biases are shifted for each frame by the largest of them, so the WHAM equations can be solved
+without overflows or underflows whatever the range of the biases.  The loops over the frames are parallelized with OpenMP.
+To reduce the number of iterations the fixed point iterations for \f$\ln c_k\f$ are accelerated using Anderson mixing of the last few iterations, which
+is controlled by the ANDERSON keyword.  Setting ANDERSON=0 gives the plain fixed point iterations.
+
 \par Examples
 
 */
@@ -84,6 +92,14 @@ private:
   double thresh, simtemp;
   unsigned nreplicas;
   unsigned maxiter;
+/// The number of previous iterations used for Anderson acceleration
+  unsigned anderson;
+/// The exponentials of the biases shifted by the largest value for each frame
+  std::vector<double> expv, rowmax;
+/// The sums over the replicas for each frame
+  std::vector<double> rowsum;
+/// Do one iteration of the WHAM equations for the logarithms of the normalizations
+  void iterate( const std::vector<double>& logZ, std::vector<double>& newlogZ );
 public:
   static void registerKeywords(Keywords&);
   explicit Wham(const ActionOptions&ao);
@@ -100,6 +116,7 @@ void Wham::registerKeywords(Keywords& keys ) {
   keys.addInputKeyword("compulsory","ARG","scalar/vector/matrix","the stored values for the bias");
   keys.add("compulsory","MAXITER","1000","maximum number of iterations for WHAM algorithm");
   keys.add("compulsory","WHAMTOL","1e-10","threshold for convergence of WHAM algorithm");
+  keys.add("compulsory","ANDERSON","5","the number of previous iterations that are used to accelerate the convergence of WHAM algorithm.  Use 0 for plain fixed point iterations");
   keys.add("optional","TEMP","the system temperature.  This is not required if your MD code passes this quantity to PLUMED");
   keys.remove("NUMERICAL_DERIVATIVES");
   keys.setValueDescription("vector","the vector of WHAM weights to use for reweighting the elements in a time series");
@@ -114,55 +131,103 @@ Wham::Wham(const ActionOptions&ao):
   simtemp=getkBT();
   if(simtemp==0) error("The MD engine does not pass the temperature to plumed so you have to specify it using TEMP");
   // Now read in parameters of WHAM
-  parse("MAXITER",maxiter); parse("WHAMTOL",thresh);
+  parse("MAXITER",maxiter); parse("WHAMTOL",thresh); parse("ANDERSON",anderson);
+  if( anderson>0 ) log.printf("  accelerating WHAM iterations with Anderson mixing of the last %u iterations\n", anderson );
   if(comm.Get_rank()==0) nreplicas=multi_sim_comm.Get_size();
   comm.Bcast(nreplicas,0); addValue( getPntrToArgument(0)->getShape() ); setNotPeriodic();
 }
 
+void Wham::iterate( const std::vector<double>& logZ, std::vector<double>& newlogZ ) {
+  unsigned nrep=logZ.size(), nframes=rowsum.size();
+  std::vector<double> invZ( nrep ); for(unsigned k=0; k<nrep; ++k) invZ[k] = exp( -logZ[k] );
+  std::vector<double> Z( nrep, 0.0 );
+  #pragma omp parallel num_threads(OpenMP::getGoodNumThreads(rowsum))
+  {
+    std::vector<double> Zpart( nrep, 0.0 );
+    #pragma omp for nowait
+    for(unsigned j=0; j<nframes; ++j) {
+      // Recompute the weight of this frame (up to the factor exp(-rowmax[j]))
+      double ew=0; const double* ev=expv.data() + std::size_t(j)*nrep;
+      for(unsigned k=0; k<nrep; ++k) ew += ev[k]*invZ[k];
+      rowsum[j]=ew; double iew=1.0/ew;
+      // And its contribution to Z
+      for(unsigned k=0; k<nrep; ++k) Zpart[k] += ev[k]*iew;
+    }
+    #pragma omp critical
+    for(unsigned k=0; k<nrep; ++k) Z[k] += Zpart[k];
+  }
+  // Normalize Z
+  double norm=0; for(unsigned k=0; k<nrep; ++k) norm+=Z[k];
+  for(unsigned k=0; k<nrep; ++k) newlogZ[k] = std::log( Z[k] / norm );
+}
+
 void Wham::calculate() {
   // Retrieve the values that were stored for the biase
-  std::vector<double> stored_biases( getPntrToArgument(0)->getNumberOfValues() );
-  for(unsigned i=0; i<stored_biases.size(); ++i) stored_biases[i] = getPntrToArgument(0)->get(i);
-  // Get the minimum value of the bias
-  double minv = *min_element(std::begin(stored_biases), std::end(stored_biases));
+  unsigned nvals = getPntrToArgument(0)->getNumberOfValues();
   // Resize final weights array
-  plumed_assert( stored_biases.size()%nreplicas==0 );
-  std::vector<double> final_weights( stored_biases.size() / nreplicas, 1.0 );
-  if( getPntrToComponent(0)->getNumberOfValues()!=final_weights.size() ) {
-    std::vector<unsigned> shape(1); shape[0]=final_weights.size(); getPntrToComponent(0)->setShape( shape );
+  plumed_assert( nvals%nreplicas==0 );
+  unsigned nframes = nvals / nreplicas;
+  if( getPntrToComponent(0)->getNumberOfValues()!=nframes ) {
+    std::vector<unsigned> shape(1); shape[0]=nframes; getPntrToComponent(0)->setShape( shape );
+  }
+  // Offset and exponential of the bias.  The offset is the smallest bias for each frame so all the exponentials are smaller than one and at least one is equal to one
+  expv.resize( nvals ); rowmax.resize( nframes ); rowsum.resize( nframes );
+  Value* biases = getPntrToArgument(0);
+  #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(rowmax))
+  for(unsigned j=0; j<nframes; ++j) {
+    double maxv = -biases->get(std::size_t(j)*nreplicas) / simtemp;
+    for(unsigned k=1; k<nreplicas; ++k) maxv = std::max( maxv, -biases->get(std::size_t(j)*nreplicas+k) / simtemp );
+    rowmax[j] = maxv;
+    for(unsigned k=0; k<nreplicas; ++k) expv[std::size_t(j)*nreplicas+k] = exp( -biases->get(std::size_t(j)*nreplicas+k) / simtemp - maxv );
   }
-  // Offset and exponential of the bias
-  std::vector<double> expv( stored_biases.size() );
-  for(unsigned i=0; i<expv.size(); ++i) expv[i] = exp( (-stored_biases[i]+minv) / simtemp );
-  // Initialize Z
-  std::vector<double> Z( nreplicas, 1.0 ), oldZ( nreplicas );
+  // Initialize the logarithms of Z
+  std::vector<double> logZ( nreplicas, -std::log( static_cast<double>(nreplicas) ) ), newlogZ( nreplicas ), resid( nreplicas );
+  // Previous iterates and residuals for Anderson acceleration
+  std::vector<std::vector<double> > hist_g, hist_f; double lastchange=std::numeric_limits<double>::max();
+  Matrix<double> ftf, ftfinv; std::vector<double> ftr, gamma;
   // Now the iterative loop to calculate the WHAM weights
   for(unsigned iter=0; iter<maxiter; ++iter) {
-    // Store Z
-    for(unsigned j=0; j<Z.size(); ++j) oldZ[j]=Z[j];
-    // Recompute weights
-    double norm=0;
-    for(unsigned j=0; j<final_weights.size(); ++j) {
-      double ew=0;
-      for(unsigned k=0; k<Z.size(); ++k) ew += expv[j*Z.size()+k]  / Z[k];
-      final_weights[j] = 1.0 / ew; norm += final_weights[j];
-    }
-    // Normalize weights
-    for(unsigned j=0; j<final_weights.size(); ++j) final_weights[j] /= norm;
-    // Recompute Z
-    for(unsigned j=0; j<Z.size(); ++j) Z[j] = 0.0;
-    for(unsigned j=0; j<final_weights.size(); ++j) {
-      for(unsigned k=0; k<Z.size(); ++k) Z[k] += final_weights[j]*expv[j*Z.size()+k];
-    }
-    // Normalize Z and compute change in Z
-    double change=0; norm=0; for(unsigned k=0; k<Z.size(); ++k) norm+=Z[k];
-    for(unsigned k=0; k<Z.size(); ++k) {
-      Z[k] /= norm; double d = std::log( Z[k] / oldZ[k] ); change += d*d;
-    }
+    iterate( logZ, newlogZ );
+    // Compute change in Z
+    double change=0;
+    for(unsigned k=0; k<nreplicas; ++k) { resid[k] = newlogZ[k] - logZ[k]; change += resid[k]*resid[k]; }
     if( change<thresh ) {
-      for(unsigned j=0; j<final_weights.size(); ++j) getPntrToComponent(0)->set( j, final_weights[j] );
+      // Compute the normalized weights from the sums that were computed in the last iteration
+      double maxw=-std::numeric_limits<double>::max();
+      for(unsigned j=0; j<nframes; ++j) { rowsum[j] = -rowmax[j] - std::log( rowsum[j] ); maxw = std::max( maxw, rowsum[j] ); }
+      double norm=0; for(unsigned j=0; j<nframes; ++j) norm += exp( rowsum[j] - maxw );
+      double lognorm = maxw + std::log( norm );
+      for(unsigned j=0; j<nframes; ++j) getPntrToComponent(0)->set( j, exp( rowsum[j] - lognorm ) );
       return;
     }
+    if( anderson==0 ) { logZ=newlogZ; continue; }
+    // Restart the acceleration if the residual has increased
+    if( change>lastchange ) { hist_g.clear(); hist_f.clear(); }
+    lastchange=change; hist_g.push_back( newlogZ ); hist_f.push_back( resid );
+    if( hist_g.size()>anderson+1 ) { hist_g.erase( hist_g.begin() ); hist_f.erase( hist_f.begin() ); }
+    unsigned m = hist_g.size()-1;
+    if( m==0 ) { logZ=newlogZ; continue; }
+    // Find the combination of the differences between the residuals that best cancels the current residual
+    ftf.resize( m, m ); ftr.resize( m ); gamma.resize( m );
+    for(unsigned a=0; a<m; ++a) {
+      ftr[a]=0; for(unsigned k=0; k<nreplicas; ++k) ftr[a] += (hist_f[a+1][k]-hist_f[a][k])*resid[k];
+      for(unsigned b=0; b<=a; ++b) {
+        double dot=0; for(unsigned k=0; k<nreplicas; ++k) dot += (hist_f[a+1][k]-hist_f[a][k])*(hist_f[b+1][k]-hist_f[b][k]);
+        ftf(a,b)=ftf(b,a)=dot;
+      }
+    }
+    pseudoInvert( ftf, ftfinv ); mult( ftfinv, ftr, gamma );
+    // And mix the previous iterates
+    for(unsigned k=0; k<nreplicas; ++k) {
+      logZ[k] = newlogZ[k];
+      for(unsigned a=0; a<m; ++a) logZ[k] -= gamma[a]*(hist_g[a+1][k]-hist_g[a][k]);
+    }
+    // Keep the normalization of Z and fall back to the plain iteration if something went wrong
+    double maxl=*std::max_element( logZ.begin(), logZ.end() ), norm=0;
+    for(unsigned k=0; k<nreplicas; ++k) norm += exp( logZ[k] - maxl );
+    double lognorm = maxl + std::log( norm );
+    if( !std::isfinite(lognorm) ) { logZ=newlogZ; hist_g.clear(); hist_f.clear(); continue; }
+    for(unsigned k=0; k<nreplicas; ++k) logZ[k] -= lognorm;
   }
   error("Too many iterations in WHAM" );
 }
@@ -71,6 +71,9 @@ The script above must be run with multiple replicas using the following command:
 mpirun -np 4 plumed driver --mf_xtc alltraj.xtc --multi 4
 \endverbatim
 
+If the ONLINE flag is present the biases are not stored.  The histogram is instead accumulated on the fly using \ref BINNED_WHAM,
+so the memory used does not grow with the length of the trajectory.
+
 */
 //+ENDPLUMEDOC
 
@@ -92,9 +95,10 @@ void WhamHistogram::registerKeywords( Keywords& keys ) {
   keys.add("compulsory","GRID_MAX","the maximum to use for the grid");
   keys.add("compulsory","GRID_BIN","the number of bins to use for the grid");
   keys.add("optional","BANDWIDTH","the bandwidth for kernel density estimation");
+  keys.addFlag("ONLINE",false,"accumulate the histogram on the fly using binned WHAM rather than storing the biases and the arguments");
   keys.setValueDescription("grid","the histogram that was generated using the WHAM weights");
   keys.needsAction("GATHER_REPLICAS"); keys.needsAction("CONCATENATE");
-  keys.needsAction("COLLECT"); keys.needsAction("WHAM"); keys.needsAction("KDE");
+  keys.needsAction("COLLECT"); keys.needsAction("WHAM"); keys.needsAction("KDE"); keys.needsAction("BINNED_WHAM");
 }
 
 
@@ -109,10 +113,21 @@ WhamHistogram::WhamHistogram( const ActionOptions& ao ) :
   readInputLine( getShortcutLabel() + "_gather: GATHER_REPLICAS ARG=" + bias );
   // Put all the replicas in a single vector
   readInputLine( getShortcutLabel() + "_gatherv: CONCATENATE ARG=" + getShortcutLabel() + "_gather.*");
+  std::string temp, tempstr=""; parse("TEMP",temp); if( temp.length()>0 ) tempstr="TEMP=" + temp;
+  bool online; parseFlag("ONLINE",online);
+  if( online ) {
+    // Accumulate the binned histogram without storing anything
+    std::vector<std::string> args; parseVector("ARG",args); std::string argstr=args[0];
+    for(unsigned i=1; i<args.size(); ++i) argstr += "," + args[i];
+    std::string bw=""; parse("BANDWIDTH",bw); if( bw!="" ) error("BANDWIDTH cannot be used with ONLINE");
+    std::string min; parse("GRID_MIN",min); std::string max; parse("GRID_MAX",max); std::string bin; parse("GRID_BIN",bin);
+    readInputLine( getShortcutLabel() + ": BINNED_WHAM ARG=" + argstr + " BIAS=" + getShortcutLabel() + "_gatherv STRIDE=" + stride + " " + tempstr +
+                   " GRID_MIN=" + min + " GRID_MAX=" + max + " GRID_BIN=" + bin );
+    return;
+  }
   // Input for COLLECT_FRAMES
   readInputLine( getShortcutLabel() + "_collect: COLLECT TYPE=vector ARG=" + getShortcutLabel() + "_gatherv STRIDE=" + stride);
   // Input for WHAM
-  std::string temp, tempstr=""; parse("TEMP",temp); if( temp.length()>0 ) tempstr="TEMP=" + temp;
   readInputLine( getShortcutLabel() + "_wham: WHAM ARG=" + getShortcutLabel() + "_collect " + tempstr );
   // Input for COLLECT_FRAMES
   std::vector<std::string> args; parseVector("ARG",args); std::string argstr;
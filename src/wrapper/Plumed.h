@@ -108,6 +108,18 @@
   (FORTRAN)  PLUMED_F_CMD
 \endverbatim
 
+  As of PLUMED 2.11, a command that is sent at every step can be resolved once
+  into an integer handle with `cmd("getCommandHandle setPositions",&handle)`.
+  The handle can then be passed in place of the command string, so that the string
+  is not parsed and looked up at every call. Several handles can be sent at once,
+  for instance to set all the pointers of a step with a single call:
+\verbatim
+  (C)        plumed_cmd_handle, plumed_cmd_handles
+  (C++)      PLMD::Plumed::cmd with a PLMD::Plumed::CommandHandle, PLMD::Plumed::cmd_handles
+  (FORTRAN)  PLUMED_F_CMD_HANDLE
+\endverbatim
+  These functions require a PLUMED>=2.11 kernel.
+
   To initialize a plumed object, use:
 \verbatim
   (C)        plumed_create
@@ -239,6 +251,10 @@
       CHARACTER(LEN=32), INTENT(IN)    :: p
       CHARACTER(LEN=*),  INTENT(IN)    :: key
       UNSPECIFIED_TYPE,  INTENT(INOUT) :: val(*)
+    SUBROUTINE PLUMED_F_CMD_HANDLE(p,handle,val)
+      CHARACTER(LEN=32), INTENT(IN)    :: p
+      INTEGER,           INTENT(IN)    :: handle
+      UNSPECIFIED_TYPE,  INTENT(INOUT) :: val(*)
     SUBROUTINE PLUMED_F_FINALIZE(p)
       CHARACTER(LEN=32), INTENT(IN)    :: p
     SUBROUTINE PLUMED_F_INSTALLED(i)
@@ -1335,6 +1351,44 @@ __PLUMED_WRAPPER_C_BEGIN
 void plumed_cmd_safe(plumed p,const char*key,plumed_safeptr);
 __PLUMED_WRAPPER_C_END
 
+/** \relates plumed
+    \brief Tells p to execute a command that has been resolved in advance.
+
+    Same as \ref plumed_cmd, but the command is identified by a handle obtained with
+    `plumed_cmd(p,"getCommandHandle setPositions",&handle)`. The string is thus not parsed
+    at every call. Handles are specific to the plumed object that returned them.
+    Available as of PLUMED 2.11. With an older kernel, this function will exit.
+
+    \param p The plumed object on which command is acting
+    \param handle The handle of the command to be executed
+    \param val The argument.
+*/
+
+__PLUMED_WRAPPER_C_BEGIN
+void plumed_cmd_handle(plumed p,int handle,const void*val);
+__PLUMED_WRAPPER_C_END
+
+/** \relates plumed
+    \brief Tells p to execute several commands that have been resolved in advance.
+
+    Equivalent to calling \ref plumed_cmd_handle n times, with handles[i] and vals[i].
+    It can be used to pass all the pointers of a step (positions, forces, box, ...) with a single call.
+    Available as of PLUMED 2.11. With an older kernel, this function will exit.
+
+    \param p The plumed object on which command is acting
+    \param n The number of commands
+    \param handles The handles of the commands to be executed
+    \param vals The arguments.
+*/
+
+__PLUMED_WRAPPER_C_BEGIN
+void plumed_cmd_handles(plumed p,int n,const int*handles,const void*const*vals);
+__PLUMED_WRAPPER_C_END
+
+__PLUMED_WRAPPER_C_BEGIN
+void plumed_cmd_handles_safe_nothrow(plumed p,int n,const int*handles,const plumed_safeptr*,plumed_nothrow_handler nothrow);
+__PLUMED_WRAPPER_C_END
+
 /** \relates plumed
     \brief Destructor.
 
@@ -2994,10 +3048,50 @@ private:
     if(!error && error_cxx.code!=0) plumed_error_rethrow_cxx(error_cxx);
   }
 
+  /**
+    Private version of cmd for command handles, see cmd_priv.
+  */
+  static void cmd_handles_priv(plumed main,int n,const int*handles,const plumed_safeptr*safe, plumed_error*error=__PLUMED_WRAPPER_CXX_NULLPTR) {
+
+    plumed_error error_cxx;
+    plumed_error_init(&error_cxx);
+
+    plumed_nothrow_handler nothrow;
+    if(error) {
+      plumed_error_init(error);
+      nothrow.ptr=error;
+    } else {
+      nothrow.ptr=&error_cxx;
+    }
+    nothrow.handler=plumed_error_set;
+
+    plumed_cmd_handles_safe_nothrow(main,n,handles,safe,nothrow);
+    /* plumed_error_rethrow is finalizing */
+    if(!error && error_cxx.code!=0) plumed_error_rethrow_cxx(error_cxx);
+  }
+
 public:
 
 #if __cplusplus > 199711L
 
+  /**
+    Handle of a command that has been resolved in advance, as in
+\verbatim
+  int id;
+  p.cmd("getCommandHandle setPositions",&id);
+  Plumed::CommandHandle setPositions(id);
+  // at every step:
+  p.cmd(setPositions,positions,{natoms,3});
+\endverbatim
+    It can be passed to cmd() in place of the command string, so that the string is not parsed at every call.
+    Available as of PLUMED 2.11.
+  */
+  class CommandHandle {
+  public:
+    int id;
+    explicit CommandHandle(int id=-1) noexcept : id(id) {}
+  };
+
 private:
 
   // Small class to manage termination of string_view.
@@ -3010,6 +3104,10 @@ private:
     std::unique_ptr<char[]> dynamic_buffer;
     /// actual pointer
     const char * str;
+    /// true if this is a command handle rather than a string
+    bool is_handle;
+    /// handle of the command, only meaningful if is_handle is true
+    int handle;
     /// Move constructor is deleted
     CString(CString&&) = delete;
     /// Move assignment operator is deleted
@@ -3019,12 +3117,24 @@ private:
     CString(const char* str) noexcept
     {
       this->str=str;
+      this->is_handle=false;
+      this->handle=-1;
       this->static_buffer[0]='\0';
     }
     /// Initialize from a std:string, taking the address of the corresponding c_str
     CString(const std::string & str) noexcept
     {
       this->str=str.c_str();
+      this->is_handle=false;
+      this->handle=-1;
+      this->static_buffer[0]='\0';
+    }
+    /// Initialize from a command handle, no string is stored
+    CString(const CommandHandle & handle) noexcept
+    {
+      this->str=nullptr;
+      this->is_handle=true;
+      this->handle=handle.id;
       this->static_buffer[0]='\0';
     }
 #if __cplusplus >= 201703L
@@ -3046,14 +3156,34 @@ private:
       str.copy(buffer,len);
       buffer[len]='\0'; // ensure null termination
       this->str=buffer;
+      this->is_handle=false;
+      this->handle=-1;
       this->static_buffer[0]='\0';
     }
 #endif
     operator const char* () const noexcept {
       return str;
     }
+    /// True if this was initialized from a command handle
+    bool isHandle() const noexcept {
+      return is_handle;
+    }
+    /// Pointer to the handle, only meaningful if isHandle() is true
+    const int* getHandle() const noexcept {
+      return &handle;
+    }
   };
 
+  /// Version of cmd_priv that also accepts command handles
+  static void cmd_priv(plumed main,const CString & key, SafePtr& safe, plumed_error*error=nullptr) {
+    if(key.isHandle()) {
+      plumed_safeptr s=safe.get_safeptr();
+      cmd_handles_priv(main,1,key.getHandle(),&s,error);
+    } else {
+      cmd_priv(main,static_cast<const char*>(key),safe,error);
+    }
+  }
+
   /// Internal tool to convert initializer_list to shape
   /// This is just taking an initializer list and making a std::array
   std::array<std::size_t,5>  make_shape(std::initializer_list<SizeLike> shape) {
@@ -3257,6 +3387,32 @@ public:
     cmd_helper_with_shape(std::forward<Key>(key),val,shape_.data());
   }
 
+  /**
+     Send several commands that have been resolved in advance to this plumed object
+      \param n The number of commands
+      \param handles The handles of the commands to be executed
+      \param vals The arguments
+      \note Similar to \ref plumed_cmd_handles(). It can be used to set all the pointers of a step with a single call.
+            No type or shape information is passed with the arguments.
+  */
+  void cmd_handles(int n,const CommandHandle* handles,const void*const* vals) {
+    int ids[16];
+    plumed_safeptr safe[16];
+    // commands are sent in blocks, so that no allocation is needed
+    for(int i=0; i<n; i+=16) {
+      int m=(n-i<16?n-i:16);
+      for(int j=0; j<m; j++) {
+        ids[j]=handles[i+j].id;
+        safe[j].ptr=vals[i+j];
+        safe[j].flags=0;
+        safe[j].nelem=0;
+        safe[j].shape=nullptr;
+        safe[j].opt=nullptr;
+      }
+      cmd_handles_priv(main,m,ids,safe);
+    }
+  }
+
 public:
 
 #else
@@ -3707,6 +3863,12 @@ typedef struct {
   These functions allow to access a thread-safe reference counter that is stored within the PlumedMain object.
   This allows avoiding to enable atomic access also the C compiler used build Plumed.c. It's added here and not as a new
   cmd since this is a very low-level functionality.
+
+  version=5, cmd_handle_safe_nothrow and cmd_handles_safe_nothrow
+
+  These functions execute commands that have been resolved in advance with cmd("getCommandHandle").
+  The purpose is to avoid parsing and looking up the command string at every call. Since no string is passed,
+  this can only be obtained by adding new functions.
 */
 typedef struct {
   /**
@@ -3759,6 +3921,18 @@ typedef struct {
     Available with version>=4.
   */
   unsigned (*use_count)(void*);
+  /**
+    Pointer to a cmd function that accepts a command handle and typeinfos, and is guaranteed not to throw exceptions.
+
+    Available with version>=5.
+  */
+  void (*cmd_handle_safe_nothrow)(void*plumed,int handle,plumed_safeptr,plumed_nothrow_handler);
+  /**
+    Pointer to a cmd function that accepts several command handles and typeinfos, and is guaranteed not to throw exceptions.
+
+    Available with version>=5.
+  */
+  void (*cmd_handles_safe_nothrow)(void*plumed,int n,const int*handles,const plumed_safeptr*,plumed_nothrow_handler);
 } plumed_symbol_table_type;
 
 /* Utility to convert function pointers to pointers, just for the sake of printing them */
@@ -4383,6 +4557,56 @@ void plumed_cmd_safe(plumed p,const char*key,plumed_safeptr safe) {
 }
 __PLUMED_WRAPPER_C_END
 
+__PLUMED_WRAPPER_C_BEGIN
+void plumed_cmd_handles_safe_nothrow(plumed p,int n,const int*handles,const plumed_safeptr*safe,plumed_nothrow_handler nothrow) {
+  plumed_implementation* pimpl;
+  /* obtain pimpl */
+  pimpl=__PLUMED_WRAPPER_STATIC_CAST(plumed_implementation*, p.p);
+  assert(plumed_check_pimpl(pimpl));
+  if(!pimpl->p || !pimpl->table || pimpl->table->version<5) {
+    const char* msg;
+    if(!pimpl->p) msg="You are trying to use plumed, but it is not available.";
+    else msg="Command handles are only available with PLUMED>=2.11.";
+    if(nothrow.handler) {
+      nothrow.handler(nothrow.ptr,1,msg,__PLUMED_WRAPPER_CXX_NULLPTR);
+      return;
+    }
+    __PLUMED_FPRINTF(stderr,"+++ ERROR: %s +++\n",msg);
+    __PLUMED_WRAPPER_STD abort();
+  }
+  /* execute, a null handler means that exceptions are not translated */
+  (*(pimpl->table->cmd_handles_safe_nothrow))(pimpl->p,n,handles,safe,nothrow);
+}
+__PLUMED_WRAPPER_C_END
+
+__PLUMED_WRAPPER_C_BEGIN
+void plumed_cmd_handles(plumed p,int n,const int*handles,const void*const*vals) {
+  plumed_nothrow_handler nothrow;
+  plumed_safeptr safe[16];
+  int i,j,m;
+  nothrow.ptr=__PLUMED_WRAPPER_CXX_NULLPTR;
+  nothrow.handler=__PLUMED_WRAPPER_CXX_NULLPTR;
+  /* commands are sent in blocks, so that no allocation is needed */
+  for(i=0; i<n; i+=m) {
+    m=(n-i<16?n-i:16);
+    for(j=0; j<m; j++) {
+      safe[j].ptr=vals[i+j];
+      safe[j].flags=0;
+      safe[j].nelem=0;
+      safe[j].shape=__PLUMED_WRAPPER_CXX_NULLPTR;
+      safe[j].opt=__PLUMED_WRAPPER_CXX_NULLPTR;
+    }
+    plumed_cmd_handles_safe_nothrow(p,m,handles+i,safe,nothrow);
+  }
+}
+__PLUMED_WRAPPER_C_END
+
+__PLUMED_WRAPPER_C_BEGIN
+void plumed_cmd_handle(plumed p,int handle,const void*val) {
+  plumed_cmd_handles(p,1,&handle,&val);
+}
+__PLUMED_WRAPPER_C_END
+
 
 __PLUMED_WRAPPER_C_BEGIN
 void plumed_finalize(plumed p) {
@@ -4653,6 +4877,12 @@ __PLUMED_IMPLEMENT_FORTRAN(plumed_f_cmd,PLUMED_F_CMD,(char*c,char*key,void*val),
   plumed_cmd(plumed_f2c(c),key,val);
 }
 
+/* New in PLUMED 2.11 */
+__PLUMED_IMPLEMENT_FORTRAN(plumed_f_cmd_handle,PLUMED_F_CMD_HANDLE,(char*c,int*handle,void*val),(c,handle,val)) {
+  assert(handle);
+  plumed_cmd_handle(plumed_f2c(c),*handle,val);
+}
+
 __PLUMED_IMPLEMENT_FORTRAN(plumed_f_finalize,PLUMED_F_FINALIZE,(char*c),(c)) {
   plumed_finalize(plumed_f2c(c));
 }
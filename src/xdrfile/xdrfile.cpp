@@ -286,6 +286,18 @@ xdrfile_close(XDRFILE *xfp)
 	return ret; /* return 0 if ok */
 }
 
+long
+xdrfile_tell(XDRFILE *xfp)
+{
+	return ftell(xfp->fp);
+}
+
+int
+xdrfile_seek(XDRFILE *xfp, long offset)
+{
+	return fseek(xfp->fp,offset,SEEK_SET);
+}
+
 
 
 int 
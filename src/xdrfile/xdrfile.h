@@ -168,6 +168,31 @@ namespace xdrfile
 	xdrfile_close   (XDRFILE *       xfp);
 
 
+	/*! \brief Get the current position in a portable binary file, just like ftell()
+	 *
+	 *  \param xfp  Pointer to an abstract XDRFILE datatype
+	 *
+	 *  \return     Offset from the beginning of the file, -1 on error.
+	 */
+	long
+	xdrfile_tell    (XDRFILE *       xfp);
+
+
+	/*! \brief Move to a position in a portable binary file, just like fseek() with SEEK_SET
+	 *
+	 *  The position should have been obtained with xdrfile_tell() and should be
+	 *  at the beginning of an XDR item (e.g. of a frame).
+	 *
+	 *  \param xfp     Pointer to an abstract XDRFILE datatype
+	 *  \param offset  Offset from the beginning of the file
+	 *
+	 *  \return     0 on success, non-zero on error.
+	 */
+	int
+	xdrfile_seek    (XDRFILE *       xfp,
+					 long            offset);
+
+
 
 
 	/*! \brief Read one or more \a char type variable(s) 
@@ -518,6 +518,24 @@ int write_trr(XDRFILE *xd,int natoms,int step,float t,float lambda,
 	return do_trn(xd,0,&step,&t,&lambda,box,&natoms,x,v,f);
 }
 
+int skip_trr(XDRFILE *xd,int *step,float *t)
+{
+	t_trnheader sh;
+	int result;
+	long nbytes;
+
+	if ((result = do_trnheader(xd,1,&sh)) != exdrOK)
+		return result;
+	*step = sh.step;
+	*t    = sh.td;
+	/* the header contains the size of all the blocks that follow */
+	nbytes = (long)sh.ir_size+sh.e_size+sh.box_size+sh.vir_size+sh.pres_size+
+		sh.top_size+sh.sym_size+sh.x_size+sh.v_size+sh.f_size;
+	if (xdrfile_seek(xd,xdrfile_tell(xd)+nbytes) != 0)
+		return exdr3DX;
+	return exdrOK;
+}
+
 int read_trr(XDRFILE *xd,int natoms,int *step,float *t,float *lambda,
 			 matrix box,rvec *x,rvec *v,rvec *f)
 {
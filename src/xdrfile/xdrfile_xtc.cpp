@@ -130,6 +130,38 @@ int read_xtc_natoms(char *fn,int *natoms)
 	return result;
 }
 
+int skip_xtc(XDRFILE *xd,int *step,float *time)
+/* Skip a frame reading only the sizes of the compressed data */
+{
+	int result,natoms,lsize,nbytes;
+	float box[DIM*DIM],prec;
+	int minmax[6],smallidx;
+
+	if ((result = xtc_header(xd,&natoms,step,time,TRUE)) != exdrOK)
+		return result;
+	if (xdrfile_read_float(box,DIM*DIM,xd) != DIM*DIM)
+		return exdrFLOAT;
+	if (xdrfile_read_int(&lsize,1,xd) != 1)
+		return exdrINT;
+	/* few atoms are stored uncompressed */
+	if (lsize<=9)
+		nbytes=lsize*DIM*sizeof(float);
+	else
+		{
+			if (xdrfile_read_float(&prec,1,xd) != 1)
+				return exdrFLOAT;
+			if (xdrfile_read_int(minmax,6,xd) != 6 || xdrfile_read_int(&smallidx,1,xd) != 1)
+				return exdrINT;
+			if (xdrfile_read_int(&nbytes,1,xd) != 1)
+				return exdrINT;
+			/* opaque data is padded to a multiple of four bytes */
+			nbytes=(nbytes+3)&~3;
+		}
+	if (xdrfile_seek(xd,xdrfile_tell(xd)+nbytes) != 0)
+		return exdr3DX;
+	return exdrOK;
+}
+
 int read_xtc(XDRFILE *xd,
 			 int natoms,int *step,float *time,
 			 matrix box,rvec *x,float *prec)